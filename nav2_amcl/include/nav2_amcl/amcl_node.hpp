@@ -22,9 +22,13 @@
 #define NAV2_AMCL__AMCL_NODE_HPP_
 
 #include <atomic>
+#include <condition_variable>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -32,13 +36,20 @@
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "message_filters/subscriber.h"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/product_cache.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "nav2_util/timing_diagnostics.hpp"
 #include "nav2_amcl/motion_model/motion_model.hpp"
+#include "nav2_amcl/scan_matcher.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
+#include "nav2_msgs/msg/compact_particle_cloud.hpp"
 #include "nav2_msgs/msg/particle.hpp"
 #include "nav2_msgs/msg/particle_cloud.hpp"
 #include "nav_msgs/srv/set_map.hpp"
 #include "sensor_msgs/msg/laser_scan.hpp"
 #include "std_srvs/srv/empty.hpp"
+#include "std_srvs/srv/trigger.hpp"
 #include "tf2_ros/transform_broadcaster.h"
 #include "tf2_ros/transform_listener.h"
 
@@ -56,7 +67,7 @@ namespace nav2_amcl
 class AmclNode : public nav2_util::LifecycleNode
 {
 public:
-  AmclNode();
+  explicit AmclNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~AmclNode();
 
 protected:
@@ -86,14 +97,33 @@ protected:
   void freeMapDependentMemory();
   map_t * map_{nullptr};
   map_t * convertMap(const nav_msgs::msg::OccupancyGrid & map_msg);
+
+  // Identifies a map by its map_load_time and geometry, which a map server keeps for a map
+  // it switches back to
+  struct MapKey
+  {
+    int64_t load_time{0};
+    uint32_t width{0}, height{0};
+    float resolution{0.0f};
+    double origin_x{0.0}, origin_y{0.0};
+    bool operator==(const MapKey & other) const;
+  };
+  static MapKey mapKey(const nav_msgs::msg::OccupancyGrid & map_msg);
+  void clearMapCache();
+  MapKey map_key_;
+  // The last maps replaced, most recent first, with their distance fields and range tables
+  std::list<std::pair<MapKey, map_t *>> map_cache_;
+  int map_cache_size_{0};
+
+  // Reads the distance field and the free space of a new map from the product cache, on the
+  // hash of its occupancy states, or computes and stores them there
+  void loadMapProducts();
+  nav2_util::ProductCache product_cache_;
   bool first_map_only_{true};
   std::atomic<bool> first_map_received_{false};
   amcl_hyp_t * initial_pose_hyp_;
   std::recursive_mutex configuration_mutex_;
   rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::ConstSharedPtr map_sub_;
-#if NEW_UNIFORM_SAMPLING
-  static std::vector<std::pair<int, int>> free_space_indices;
-#endif
 
   // Transforms
   void initTransforms();
@@ -103,6 +133,11 @@ protected:
   bool sent_first_transform_{false};
   bool latest_tf_valid_{false};
   tf2::Transform latest_tf_;
+  // Guards latest_tf_ and latest_tf_valid_, the transform timer may read them while filtering
+  std::mutex tf_mutex_;
+  // Republishes the last map to odom transform at tf_publish_rate, if it is positive
+  rclcpp::TimerBase::SharedPtr tf_timer_;
+  void publishLatestTransform();
   void waitForTransforms();
 
   // Message filters
@@ -120,8 +155,32 @@ protected:
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PoseArray>::SharedPtr particlecloud_pub_;
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::ParticleCloud>::SharedPtr
     particle_cloud_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CompactParticleCloud>::SharedPtr
+    compact_particle_cloud_pub_;
+
+  // Times of the sensor updates and resamples, published as diagnostics
+  std::shared_ptr<nav2_util::TimingStats> timing_stats_;
+  nav2_util::TimingHistogram * sensor_timing_{nullptr};
+  nav2_util::TimingHistogram * resample_timing_{nullptr};
+  std::unique_ptr<nav2_util::TimingDiagnostics> timing_diagnostics_;
   void initialPoseReceived(geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg);
   void laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan);
+  // Update the filter with a scan, on the subscription's thread or the filter thread
+  void processScan(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan);
+
+  // Filter thread, see filter_thread. The scans wait for it in a mailbox holding the latest
+  // scan of every laser, a newer scan of a laser replaces the one waiting
+  void startFilterThread();
+  void stopFilterThread();
+  void filterThreadLoop();
+  std::thread filter_thread_;
+  std::mutex mailbox_mutex_;
+  std::condition_variable mailbox_cv_;
+  std::vector<sensor_msgs::msg::LaserScan::ConstSharedPtr> mailbox_;
+  bool stop_filter_thread_{false};
+  std::size_t dropped_scans_{0};
+  rclcpp::Time last_drop_warning_;
+  nav2_util::TimingHistogram * scan_latency_timing_{nullptr};
 
   // Services and service callbacks
   void initServices();
@@ -138,6 +197,19 @@ protected:
     const std::shared_ptr<std_srvs::srv::Empty::Request> request,
     std::shared_ptr<std_srvs::srv::Empty::Response> response);
 
+  // Match the last scan against the whole map and seed the filter around the best pose
+  rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr relocalize_srv_;
+  void relocalizeCallback(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<std_srvs::srv::Trigger::Request> request,
+    std::shared_ptr<std_srvs::srv::Trigger::Response> response);
+  // Endpoints of the last scan in the robot frame, thinned out for the scan matcher
+  bool relocalizationPoints(std::vector<ScanMatcher::Point> & points);
+  // Score pyramid of the map, built on the first relocalization request
+  std::unique_ptr<ScanMatcher> scan_matcher_;
+  sensor_msgs::msg::LaserScan::ConstSharedPtr last_scan_;
+  int last_scan_laser_{-1};
+
   // Nomotion update control. Used to temporarily let amcl update samples even when no motion occurs
   std::atomic<bool> force_update_{false};
 
@@ -159,6 +231,9 @@ protected:
   void initParticleFilter();
   // Pose-generating function used to uniformly distribute particles over the map
   static pf_vector_t uniformPoseGenerator(void * arg);
+  // Runs the tasks of the filter on the thread pool given as pool
+  static void runParallel(
+    void * pool, int task_count, void (* task)(void * task_data, int i), void * task_data);
   pf_t * pf_{nullptr};
   bool pf_init_;
   pf_vector_t pf_odom_pose_;
@@ -170,7 +245,23 @@ protected:
   int scan_error_count_{0};
   std::vector<nav2_amcl::Laser *> lasers_;
   std::vector<bool> lasers_update_;
+  // Threads the laser models weigh the particles on, shared by all the lasers
+  std::shared_ptr<nav2_util::ThreadPool> weighting_pool_;
   std::map<std::string, int> frame_to_laser_;
+  // Per laser scan buffer, reused from scan to scan
+  std::vector<std::unique_ptr<nav2_amcl::LaserData>> laser_data_;
+  // Per laser angles of the scans in the base frame, and the scan angles they were found for
+  struct LaserAngles
+  {
+    bool valid{false};
+    float scan_angle_min, scan_angle_increment;
+    double angle_min, angle_increment;
+  };
+  std::vector<LaserAngles> laser_angles_;
+  // Scans held back to be fused into one filter update, and the stamp of the first of them.
+  // They point into laser_data_, a laser has at most one of them
+  std::vector<nav2_amcl::LaserData *> pending_scans_;
+  rclcpp::Time pending_stamp_;
   rclcpp::Time last_laser_received_ts_;
   void checkLaserReceived();
   std::chrono::seconds laser_check_interval_;  // TODO(mjeronimo): not initialized
@@ -183,12 +274,70 @@ protected:
     const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
     const std::string & laser_scan_frame_id,
     geometry_msgs::msg::PoseStamped & laser_pose);
+  // Pick the lasers' beam count from the spread of the particles, see min_beams
+  void adaptBeams();
   bool shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta);
   bool updateFilter(
     const int & laser_index,
     const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
     const pf_vector_t & pose);
+  // Convert a scan into the sensor models' input, with its bearings in the base frame.
+  // Fills the laser's buffer in laser_data_ and returns it, or nullptr if tf fails
+  nav2_amcl::LaserData * fillLaserData(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan);
+  // Hold a scan back to be fused with the other lasers' scans of the same instant
+  bool bufferScan(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+    const pf_vector_t & pose);
+  // A scan can join the held back ones if its laser has none of them and it is close in time
+  bool canFuseScan(
+    const int & laser_index,
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan);
+  // Update the filter with all the held back scans at once. Returns true if it resampled
+  bool fusePendingScans();
+  // Resample if it is due and publish the particles. Returns true if it resampled
+  bool resampleFilter();
+
+  // Snapshots of the filter updates, see nav2_util::SnapshotRecorder. An update is recorded
+  // as the steps processScan took on the particles, to be taken again by amcl_replay
+  enum class UpdateStep : int32_t {MOTION, SENSOR, FUSED_SENSOR, RESAMPLE};
+  struct UpdateRecord
+  {
+    std::vector<int32_t> steps;
+    // Particles before the update, kept only when updates over budget are saved
+    std::vector<double> particles;
+    double w_slow{0.0}, w_fast{0.0};
+    pf_vector_t pose, delta;
+    // Laser index and range_max, then the ranges and bearings, of the scans weighed.
+    // A sensor step weighs the scans after the ones of the steps before it
+    struct Scan
+    {
+      int laser;
+      int range_count;
+      double range_max;
+      std::vector<double> ranges;
+    };
+    std::vector<Scan> scans;
+    std::vector<int32_t> scan_counts;
+    double duration{0.0};
+  };
+  void beginUpdateRecord();
+  void recordSensorStep(
+    UpdateStep step, nav2_amcl::LaserData * const * data, std::size_t count);
+  void endUpdateRecord(double duration);
+  bool fillSnapshot(nav2_util::SnapshotWriter & writer);
+  std::unique_ptr<nav2_util::SnapshotRecorder> snapshot_recorder_;
+  // The update being recorded, and the last one that weighed the particles
+  UpdateRecord update_record_, last_update_;
+  bool last_update_valid_{false};
   void publishParticleCloud(const pf_sample_set_t * set);
+  // Pick the particles to publish into cloud_particles_, see particle_cloud_max_particles
+  void selectCloudParticles(const pf_sample_set_t * set);
+  std::vector<int> cloud_particles_;
+  rclcpp::Time last_particle_cloud_time_;
+  bool particle_cloud_published_{false};
   bool getMaxWeightHyp(
     std::vector<amcl_hyp_t> & hyps, amcl_hyp_t & max_weight_hyps,
     int & max_weight_hyp);
@@ -202,7 +351,7 @@ protected:
   void sendMapToOdomTransform(const tf2::TimePoint & transform_expiration);
   void handleInitialPose(geometry_msgs::msg::PoseWithCovarianceStamped & msg);
   bool init_pose_received_on_inactive{false};
-  bool initial_pose_is_known_{false};
+  std::atomic<bool> initial_pose_is_known_{false};
   bool set_initial_pose_{false};
   bool always_reset_initial_pose_;
   double initial_pose_x_;
@@ -218,29 +367,48 @@ protected:
   double alpha4_;
   double alpha5_;
   std::string base_frame_id_;
+  int beam_range_table_directions_;
   double beam_skip_distance_;
   double beam_skip_error_threshold_;
   double beam_skip_threshold_;
   bool do_beamskip_;
+  double diagnostics_period_;
+  bool filter_thread_enabled_;
   std::string global_frame_id_;
   double lambda_short_;
   double laser_likelihood_max_dist_;
+  double laser_fusion_tolerance_;
   double laser_max_range_;
   double laser_min_range_;
   std::string sensor_model_type_;
+  bool lazy_weight_normalization_;
   int max_beams_;
+  int min_beams_;
+  double min_beams_spread_;
+  double min_beam_spacing_;
   int max_particles_;
   int min_particles_;
+  int motion_model_seed_;
+  double particle_cloud_rate_;
+  int particle_cloud_max_particles_;
+  std::string particle_cloud_decimation_;
+  int particle_weighting_threads_;
   std::string odom_frame_id_;
   double pf_err_;
+  int relocalization_levels_;
+  int relocalization_max_points_;
+  double relocalization_min_score_;
   double pf_z_;
   double alpha_fast_;
   double alpha_slow_;
   int resample_interval_;
+  std::string resample_method_;
   std::string robot_model_type_;
   tf2::Duration save_pose_period_;
   double sigma_hit_;
   bool tf_broadcast_;
+  double tf_publish_rate_;
+  bool share_tf_buffer_;
   tf2::Duration transform_tolerance_;
   double a_thresh_;
   double d_thresh_;
@@ -28,6 +28,7 @@
 #ifndef NAV2_AMCL__MAP__MAP_HPP_
 #define NAV2_AMCL__MAP__MAP_HPP_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -42,18 +43,53 @@ struct _rtk_fig_t;
 #define MAP_WIFI_MAX_LEVELS 8
 
 
-// Description for a single map cell.
+// Largest quantized distance, standing for max_occ_dist
+#define MAP_OCC_DIST_MAX 65535
+
+
+// A blocked cell seen along one direction of the range table
+typedef struct
+{
+  // Coordinates (in cells) of its center along and across the direction
+  float along, across;
+} map_range_cell_t;
+
+
+// Precomputed ranges: for each of a set of directions the map is cut into
+// one cell wide lanes along it, and each lane keeps the blocked cells next to
+// free space it overlaps, sorted along the direction. A ray is answered by a
+// search in its lane instead of walking the grid
 typedef struct
 {
-  // Occupancy state (-1 = free, 0 = unknown, +1 = occ)
-  int occ_state;
+  // Directions, evenly spaced over [0, pi); rays of the other half plane
+  // search their lane backwards
+  int direction_count;
+  double * direction_cos, * direction_sin;
 
-  // Distance to the nearest occupied cell
-  double occ_dist;
+  // Lanes per direction, and the offset of the first one, in cells
+  int lane_count;
+  double * lane_origin;
+
+  // Start of each lane in cells, direction_count * lane_count + 1 entries
+  size_t * lane_start;
+
+  // The cells of all the lanes, lane after lane
+  map_range_cell_t * cells;
+} map_range_table_t;
+
+
+// The free cells of a map as runs along its rows, to draw uniformly
+// distributed free cells from in O(log runs)
+typedef struct
+{
+  int span_count;
 
-  // Wifi levels
-  // int wifi_levels[MAP_WIFI_MAX_LEVELS];
-} map_cell_t;
+  // First cell (i, j) of each run, in row-major order
+  int * span_i, * span_j;
+
+  // Free cells before each run, span_count + 1 entries; the last is the total
+  int64_t * cells_before;
+} map_free_space_t;
 
 
 // Description for a map
@@ -68,12 +104,34 @@ typedef struct
   // Map dimensions (number of cells)
   int size_x, size_y;
 
-  // The map data, stored as a grid
-  map_cell_t * cells;
+  // The map data, stored as dense grids of one field each: the occupancy
+  // state (-1 = free, 0 = unknown, +1 = occ) of every cell
+  int8_t * occ_state;
+
+  // and the distance from every cell to the nearest occupied cell, in steps of
+  // occ_dist_step up to MAP_OCC_DIST_MAX. NULL until map_update_cspace is called
+  uint16_t * occ_dist;
+  double occ_dist_step;
 
   // Max distance at which we care about obstacles, for constructing
   // likelihood field
   double max_occ_dist;
+
+  // Optional likelihood field, z_hit * exp(-occ_dist^2 / (2 * sigma_hit^2)) per cell.
+  // Kept apart from the cells, and cache line aligned, so that sensor models
+  // only gather 4 bytes per beam. NULL until map_update_likelihood is called
+  float * likelihood;
+  void * likelihood_storage;
+
+  // Parameters the likelihood field was computed with. A negative sigma marks it stale
+  double likelihood_z_hit, likelihood_sigma_hit;
+
+  // Optional range table, used by map_calc_range when present.
+  // NULL until map_update_range_table is called
+  map_range_table_t * range_table;
+
+  // Optional free space runs. NULL until map_update_free_space is called
+  map_free_space_t * free_space;
 } map_t;
 
 
@@ -87,8 +145,8 @@ map_t * map_alloc(void);
 // Destroy a map
 void map_free(map_t * map);
 
-// Get the cell at the given point
-map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa);
+// Allocate the occupancy states of a map of the given size, all unknown
+void map_alloc_cells(map_t * map, int size_x, int size_y);
 
 // Load an occupancy map
 int map_load_occ(map_t * map, const char * filename, double scale, int negate);
@@ -96,9 +154,19 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate);
 // Load a wifi signal strength map
 // int map_load_wifi(map_t *map, const char *filename, int index);
 
-// Update the cspace distances
+// Update the cspace distances, unless they are up to date for max_occ_dist
 void map_update_cspace(map_t * map, double max_occ_dist);
 
+// Update the likelihood field from the cspace distances, unless it is up to date
+void map_update_likelihood(map_t * map, double z_hit, double sigma_hit);
+
+// (Re)build the free space runs from the occupancy states
+void map_update_free_space(map_t * map);
+
+// Free cell number floor(u * total) for u in [0, 1), in row-major order.
+// Returns 0 if the map has no free cells (or no free space runs)
+int map_sample_free(map_t * map, double u, int * i, int * j);
+
 
 /**************************************************************************
  * Range functions
@@ -107,6 +175,10 @@ void map_update_cspace(map_t * map, double max_occ_dist);
 // Extract a single range reading from the map
 double map_calc_range(map_t * map, double ox, double oy, double oa, double max_range);
 
+// Build the range table with the given number of directions, unless it
+// already has them. Zero directions frees it, so that ranges are ray cast
+void map_update_range_table(map_t * map, int direction_count);
+
 
 /**************************************************************************
  * GUI/diagnostic functions
@@ -140,6 +212,9 @@ void map_draw_wifi(map_t * map, struct _rtk_fig_t * fig, int index);
 // Compute the cell index for the given map coords.
 #define MAP_INDEX(map, i, j) ((i) + (j) * map->size_x)
 
+// Distance (m) from the cell at the given index to the nearest occupied cell
+#define MAP_OCC_DIST(map, index) ((map)->occ_dist[index] * (map)->occ_dist_step)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_AMCL__MOTION_MODEL__GAUSSIAN_SAMPLER_HPP_
+#define NAV2_AMCL__MOTION_MODEL__GAUSSIAN_SAMPLER_HPP_
+
+#include <cstdint>
+
+namespace nav2_amcl
+{
+
+/**
+ * @class GaussianSampler
+ * @brief Normally distributed noise from a xoshiro256++ stream, with the ziggurat method.
+ *
+ * Most draws take one random number, a table lookup and a multiply, without the logarithm
+ * and square root of Box-Muller. A stream is fully determined by its seed, so that several
+ * can be drawn from side by side (one per range of particles) and still be reproduced.
+ */
+class GaussianSampler
+{
+public:
+  /**
+   * @brief Start the stream for a seed, expanded into the state with splitmix64
+   */
+  explicit GaussianSampler(uint64_t seed);
+
+  /**
+   * @brief Fill out with count draws of zero mean and standard deviation sigma
+   */
+  void fill(double * out, int count, double sigma);
+
+  /**
+   * @brief Standard normal draw
+   */
+  double next();
+
+  /**
+   * @brief Mix several values into one well spread seed, e.g. (seed, update, range)
+   */
+  static uint64_t mixSeed(uint64_t a, uint64_t b, uint64_t c);
+
+private:
+  uint64_t nextBits();
+  double nextUniform();
+  double nextTail(int64_t hz, int iz);
+
+  uint64_t state_[4];
+};
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__MOTION_MODEL__GAUSSIAN_SAMPLER_HPP_
@@ -17,9 +17,14 @@
 #ifndef NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 #define NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include "nav2_amcl/motion_model/gaussian_sampler.hpp"
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_amcl
 {
@@ -33,6 +38,38 @@ public:
   static MotionModel * createMotionModel(
     std::string & type, double alpha1, double alpha2,
     double alpha3, double alpha4, double alpha5);
+
+  /**
+   * @brief Move the particles on a pool of threads. Without one, they are moved inline
+   */
+  void setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool);
+
+  /**
+   * @brief Seed the noise. The same seed and odometry give the same particles, whatever
+   * the number of threads
+   */
+  void setSeed(uint64_t seed);
+
+protected:
+  /**
+   * @brief Split the samples into fixed ranges and move them, in parallel when there is a pool.
+   * Each range is handed over as a structure-of-arrays batch, which is copied back once moved.
+   * Its noise comes from its own stream, seeded from the seed, the update count and the range,
+   * so that the result does not depend on the thread count
+   * @param set Samples to move
+   * @param move_range Called with (batch of at most SAMPLES_PER_RANGE samples, noise of the range)
+   */
+  void updateSamples(
+    pf_sample_set_t * set,
+    const std::function<void(pf_sample_batch_t &, GaussianSampler &)> & move_range);
+
+  // Samples moved by one task
+  static const int SAMPLES_PER_RANGE = 64;
+
+private:
+  std::shared_ptr<nav2_util::ThreadPool> pool_;
+  uint64_t seed_{0};
+  uint64_t update_count_{0};
 };
 
 class OmniMotionModel : public MotionModel
@@ -29,7 +29,7 @@
 #define NAV2_AMCL__PF__PF_HPP_
 
 #include "nav2_amcl/pf/pf_vector.hpp"
-#include "nav2_amcl/pf/pf_kdtree.hpp"
+#include "nav2_amcl/pf/pf_bins.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +52,11 @@ typedef void (* pf_action_model_fn_t) (
 
 // Function prototype for the sensor model; determines the probability
 // for the given set of sample poses.
+// Function running task(task_data, i) for every i in [0, task_count), possibly
+// in parallel, and returning once all of them are done
+typedef void (* pf_parallel_fn_t) (
+  void * parallel_data, int task_count, void (* task)(void * task_data, int i), void * task_data);
+
 typedef double (* pf_sensor_model_fn_t) (
   void * sensor_data,
   struct _pf_sample_set_t * set);
@@ -64,10 +69,20 @@ typedef struct
   pf_vector_t pose;
 
   // Weight for this pose
-  double weight;
+  pf_real_t weight;
 } pf_sample_t;
 
 
+// Structure-of-arrays copy of a range of samples, for models that work on
+// many samples at once.  The caller owns the arrays, count entries each.
+typedef struct
+{
+  int count;
+  pf_real_t * x, * y, * theta;
+  pf_real_t * weight;
+} pf_sample_batch_t;
+
+
 // Information for a cluster of samples
 typedef struct
 {
@@ -93,8 +108,15 @@ typedef struct _pf_sample_set_t
   int sample_count;
   pf_sample_t * samples;
 
-  // A kdtree encoding the histogram
-  pf_kdtree_t * kdtree;
+  // Log of the factor the sensor models divided the weights of the current
+  // update by to keep them in range, the likelihoods are weight * exp(log_scale)
+  double log_scale;
+
+  // Sum of the sample weights, 1 unless the filter normalizes lazily
+  double total_weight;
+
+  // The histogram, for KLD sampling and clustering
+  pf_bins_t * bins;
 
   // Clusters
   int cluster_count, cluster_max_count;
@@ -107,6 +129,13 @@ typedef struct _pf_sample_set_t
 } pf_sample_set_t;
 
 
+// Resampling methods
+// Independent draws from the weights, KLD adaptive
+#define PF_RESAMPLE_MULTINOMIAL 0
+// Low-variance resampling, with the sample count taken from the current histogram
+#define PF_RESAMPLE_SYSTEMATIC 1
+
+
 // Information for an entire filter
 typedef struct _pf_t
 {
@@ -134,6 +163,32 @@ typedef struct _pf_t
   double dist_threshold;  // distance threshold in each axis over which the pf is considered to not
                           // be converged
   int converged;
+
+  // One of the PF_RESAMPLE_ methods
+  int resample_method;
+
+  // Leave the weights unnormalized between resamplings, keeping their sum in
+  // the set's total_weight; they are only rescaled when it gets out of range
+  int lazy_normalization;
+
+  // Walker alias table for multinomial resampling, and its workspace,
+  // max_samples entries each
+  double * alias_prob;
+  int * alias_index;
+  int * alias_work;
+
+  // Runs the ranges of samples of pf_cluster_stats, NULL runs them in turn
+  pf_parallel_fn_t parallel_fn;
+  void * parallel_data;
+
+  // Per cluster sums of every range of samples of pf_cluster_stats
+  double * cluster_sums;
+  int cluster_sums_size;
+
+  // Weight before every range of samples of the parallel systematic
+  // resampling, and the first sample each range draws
+  double * resample_sums;
+  int * resample_first;
 } pf_t;
 
 
@@ -152,15 +207,31 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov);
 // Initialize the filter using some model
 void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data);
 
+// Initialize the filter with the given samples, at most max_samples of them, keeping
+// their weights as they are
+void pf_init_samples(
+  pf_t * pf, int sample_count, const pf_vector_t * poses, const double * weights);
+
 // Update the filter with some new action
 void pf_update_action(pf_t * pf, pf_action_model_fn_t action_fn, void * action_data);
 
 // Update the filter with some new sensor observation
 void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data);
 
+// Update the filter with several observations taken at the same time; the
+// weights are normalized once, after all the models have been applied
+void pf_update_sensors(
+  pf_t * pf, int sensor_count, pf_sensor_model_fn_t * sensor_fns, void ** sensor_data);
+
 // Resample the distribution
 void pf_update_resample(pf_t * pf);
 
+// Copy the samples [first, first + batch->count) of a set into the batch arrays
+void pf_sample_set_gather(const pf_sample_set_t * set, int first, pf_sample_batch_t * batch);
+
+// Copy a batch back into the samples it was gathered from
+void pf_sample_set_scatter(pf_sample_set_t * set, int first, const pf_sample_batch_t * batch);
+
 // Compute the CEP statistics (mean and variance).
 void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var);
 
@@ -170,6 +241,9 @@ int pf_get_cluster_stats(
   pf_t * pf, int cluster, double * weight,
   pf_vector_t * mean, pf_matrix_t * cov);
 
+// Label of the cluster with the largest weight in the current set, -1 if none weighs
+int pf_get_max_weight_cluster(pf_t * pf);
+
 // Re-compute the cluster statistics for a sample set
 void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set);
 
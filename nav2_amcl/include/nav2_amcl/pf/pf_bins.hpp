@@ -0,0 +1,88 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_AMCL__PF__PF_BINS_HPP_
+#define NAV2_AMCL__PF__PF_BINS_HPP_
+
+#include "nav2_amcl/pf/pf_vector.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A histogram bin of discretized (x, y, theta)
+typedef struct
+{
+  // The key for this bin
+  int key[3];
+
+  // The value for this bin
+  double value;
+
+  // The cluster label
+  int cluster;
+
+  // Slot of the hash table pointing at this bin
+  int slot;
+} pf_bin_t;
+
+
+// Histogram of sample poses, an alternative to pf_kdtree_t kept in flat arrays:
+// the occupied bins in insertion order, and an open addressing hash table
+// of indices into them
+typedef struct
+{
+  // Cell size
+  double size[3];
+
+  // Hash table, a power of two of slots holding a bin index or -1
+  int slot_count;
+  int * slots;
+
+  // The occupied bins
+  int bin_count, bin_max_count;
+  pf_bin_t * bins;
+
+  // Workspace for clustering
+  int * queue;
+} pf_bins_t;
+
+
+// Create a histogram with room for max_bins bins
+pf_bins_t * pf_bins_alloc(int max_bins);
+
+// Destroy a histogram
+void pf_bins_free(pf_bins_t * self);
+
+// Clear all entries from the histogram, in the number of occupied bins
+void pf_bins_clear(pf_bins_t * self);
+
+// Insert a pose into the histogram
+void pf_bins_insert(pf_bins_t * self, pf_vector_t pose, double value);
+
+// Label the connected components of occupied bins, linear in their number.
+// Returns the number of components, labelled from 0
+int pf_bins_cluster(pf_bins_t * self);
+
+// Determine the probability estimate for the given pose
+double pf_bins_get_prob(pf_bins_t * self, pf_vector_t pose);
+
+// Determine the cluster label for the given pose
+int pf_bins_get_cluster(pf_bins_t * self, pf_vector_t pose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // NAV2_AMCL__PF__PF_BINS_HPP_
@@ -34,10 +34,19 @@ extern "C" {
 
 #include <stdio.h>
 
+// Scalar of the poses and weights of the samples.  Built with PF_FLOAT32
+// (the AMCL_FLOAT32 CMake option) for targets with slow or no double SIMD;
+// covariances and statistics are accumulated in double either way.
+#ifdef PF_FLOAT32
+typedef float pf_real_t;
+#else
+typedef double pf_real_t;
+#endif
+
 // The basic vector
 typedef struct
 {
-  double v[3];
+  pf_real_t v[3];
 } pf_vector_t;
 
 
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_AMCL__SCAN_MATCHER_HPP_
+#define NAV2_AMCL__SCAN_MATCHER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_amcl
+{
+
+/**
+ * @class ScanMatcher
+ * @brief Finds the pose of a map a scan matches best, by branch and bound over the whole map
+ *
+ * Every map cell scores exp(-d^2 / (2 sigma^2)), d being its distance to the nearest obstacle,
+ * and a pose scores the mean of the cells its scan points fall in. Level h of the pyramid
+ * keeps, at every cell, the best score of the 2^h x 2^h cells from it up, so it bounds the score
+ * of all the positions of a block of that size. The search walks down from the blocks of the
+ * top level, best bound first, and drops every block bounded below the best pose found so far.
+ * The rotations are searched in parallel, one step apart where the farthest point moves by
+ * one cell.
+ */
+class ScanMatcher
+{
+public:
+  /// A scan endpoint in the robot frame (m)
+  struct Point
+  {
+    double x, y;
+  };
+
+  /// Best pose found by match()
+  struct Match
+  {
+    double x, y, yaw;
+    double score;  ///< Mean cell score of the points, in [0, 1]
+    double angular_step;  ///< Step between the rotations searched (rad)
+  };
+
+  /**
+   * @brief Build the score pyramid of a map
+   * @param map Map with up to date cspace distances, it must outlive the matcher
+   * @param sigma Standard deviation of the scores around obstacles (m)
+   * @param levels Levels above the map, the top one searching blocks of 2^levels cells
+   * @param pool Pool to build and search on, nullptr to run on the calling thread
+   */
+  ScanMatcher(const map_t * map, double sigma, int levels, nav2_util::ThreadPool * pool);
+
+  /**
+   * @brief Find the free cell and heading scoring best for a scan
+   * @param points Scan endpoints in the robot frame
+   * @param min_score Lowest score of a pose to accept
+   * @param[out] match Best pose, if one scores at least min_score
+   * @return Whether a pose scores at least min_score
+   */
+  bool match(const std::vector<Point> & points, double min_score, Match & match) const;
+
+protected:
+  /// A block of positions of a rotation, and the bound of its score
+  struct Candidate
+  {
+    int x, y;  ///< Cell of the block's lowest corner
+    int score;  ///< Sum of the quantized scores of the points
+  };
+
+  /// Cell offsets of the points at one rotation
+  struct Rotation
+  {
+    std::vector<int> dx, dy;
+  };
+
+  /**
+   * @brief Bound of the score of the 2^level blocks of positions in candidate
+   */
+  int score(int level, const Rotation & rotation, int x, int y) const;
+
+  /**
+   * @brief Search candidates of a level, sorted by decreasing score, for the best position
+   * scoring above best. Raises best and sets result on finding one
+   * @param best Best score over all the rotations, shared by the searches running in parallel
+   */
+  void search(
+    int level, const Rotation & rotation, const std::vector<Candidate> & candidates,
+    std::atomic<int> & best, Candidate & result) const;
+
+  bool isFree(int x, int y) const;
+
+  void runTasks(std::size_t count, const std::function<void(std::size_t)> & task) const;
+
+  const map_t * map_;
+  nav2_util::ThreadPool * pool_;
+  int levels_;
+  int pad_;  ///< Cells the pyramid reaches below the map, so that blocks overlapping it are bound
+  int width_, height_;  ///< Size of the padded levels
+  std::vector<std::vector<uint8_t>> pyramid_;  ///< Quantized scores, level 0 being the map's
+  std::vector<uint8_t> top_free_;  ///< Whether each block of the top level has a free cell
+};
+
+}  // namespace nav2_amcl
+
+#endif  // NAV2_AMCL__SCAN_MATCHER_HPP_
@@ -18,10 +18,14 @@
 #ifndef NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 #define NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_amcl
 {
@@ -37,7 +41,81 @@ public:
   virtual bool sensorUpdate(pf_t * pf, LaserData * data) = 0;
   void SetLaserPose(pf_vector_t & laser_pose);
 
+  /**
+   * @brief Pose of the laser in the robot frame, as given to SetLaserPose()
+   */
+  const pf_vector_t & laserPose() const {return laser_pose_;}
+
+  /**
+   * @brief Weigh the particles on a pool of threads. Without one, they are weighed inline
+   */
+  void setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool);
+
+  /**
+   * @brief Change how many evenly-spaced beams of each scan are used, from the next update on
+   */
+  void setMaxBeams(int max_beams);
+
+  /**
+   * @brief Have cacheBeams() skip a beam ending closer than spacing (m) to the previous one kept
+   */
+  void setMinBeamSpacing(double spacing);
+
+  /**
+   * @brief Update the filter with scans taken at the same time by several lasers.
+   * Every model weighs the particles in turn and the weights are normalized once
+   * @param pf Particle filter to update
+   * @param data One scan per laser, each pointing at the laser that took it
+   * @return true if at least one of the scans was used
+   */
+  static bool fusedSensorUpdate(pf_t * pf, const std::vector<LaserData *> & data);
+
 protected:
+  // Samples weighed by one task. Fixed, so the partial sums do not depend on the thread count
+  static const int SAMPLES_PER_RANGE = 64;
+
+  /**
+   * @brief Sensor model weighing the particles against one scan of this laser
+   */
+  virtual pf_sensor_model_fn_t sensorModel() const = 0;
+
+  /**
+   * @brief Split the samples into fixed ranges and weigh them, in parallel when there is a pool.
+   * The partial sums are added in range order, so the total does not depend on the thread count
+   * @param sample_count Number of samples to weigh
+   * @param weigh_range Called with (range index, first sample, last sample), returns the range's
+   * total weight
+   * @return Total weight of the samples
+   */
+  double weighSamples(
+    int sample_count, const std::function<double(int, int, int)> & weigh_range);
+
+  /**
+   * @brief Number of ranges weighSamples() splits the samples into
+   */
+  static int sampleRanges(int sample_count);
+
+  /**
+   * @brief Scratch space for the beam endpoints of one range of samples, see projectBeams().
+   * Call reserveHits() with the sample count first; the space is kept from scan to scan
+   */
+  void reserveHits(int sample_count);
+  pf_real_t * rangeHits(int range);
+
+  /**
+   * @brief Cache every step-th beam of a scan as its endpoint in the laser frame.
+   * Max range and NaN readings are left out, beam_index_ keeps their place among the stepped beams
+   */
+  void cacheBeams(LaserData * data, int step);
+
+  /**
+   * @brief Endpoints of the cached beams seen from a laser pose, rotated with one sincos
+   * @param pose Laser pose in the map frame
+   * @param hit_x Output x coordinates, one per cached beam
+   * @param hit_y Output y coordinates, one per cached beam
+   */
+  void projectBeams(const pf_vector_t & pose, pf_real_t * hit_x, pf_real_t * hit_y) const;
+
   double z_hit_;
   double z_rand_;
   double sigma_hit_;
@@ -46,22 +124,49 @@ protected:
   map_t * map_;
   pf_vector_t laser_pose_;
   int max_beams_;
+  double min_beam_spacing_;
   int max_samples_;
   int max_obs_;
   double ** temp_obs_;
+  std::shared_ptr<nav2_util::ThreadPool> pool_;
+
+  // Beams of the current scan, in the sample scalar so projecting them stays in one SIMD width
+  std::vector<pf_real_t> beam_x_;
+  std::vector<pf_real_t> beam_y_;
+  std::vector<int> beam_index_;
+
+  // Scratch reused scan after scan so weighing does not allocate
+  std::vector<pf_real_t> beam_hits_;
+  std::vector<double> partial_weights_;
+  double * temp_obs_storage_;
 };
 
 class LaserData
 {
 public:
   Laser * laser;
-  LaserData() {ranges = NULL;}
+  LaserData() {ranges = NULL; range_count = 0; range_capacity = 0;}
   virtual ~LaserData() {delete[] ranges;}
 
+  /**
+   * @brief Make room for count readings. The buffer only ever grows, so a LaserData
+   * reused scan after scan stops allocating once it has seen the largest scan
+   */
+  void setRangeCount(int count)
+  {
+    if (count > range_capacity) {
+      delete[] ranges;
+      ranges = new double[count][2];
+      range_capacity = count;
+    }
+    range_count = count;
+  }
+
 public:
   int range_count;
   double range_max;
   double(*ranges)[2];
+  int range_capacity;
 };
 
 
@@ -70,9 +175,13 @@ class BeamModel : public Laser
 public:
   BeamModel(
     double z_hit, double z_short, double z_max, double z_rand, double sigma_hit,
-    double lambda_short, double chi_outlier, size_t max_beams, map_t * map);
+    double lambda_short, double chi_outlier, int range_table_directions,
+    size_t max_beams, map_t * map);
   bool sensorUpdate(pf_t * pf, LaserData * data);
 
+protected:
+  pf_sensor_model_fn_t sensorModel() const override;
+
 private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
   double z_short_;
@@ -89,6 +198,9 @@ public:
     size_t max_beams, map_t * map);
   bool sensorUpdate(pf_t * pf, LaserData * data);
 
+protected:
+  pf_sensor_model_fn_t sensorModel() const override;
+
 private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
 };
@@ -103,9 +215,25 @@ public:
     size_t max_beams, map_t * map);
   bool sensorUpdate(pf_t * pf, LaserData * data);
 
+protected:
+  pf_sensor_model_fn_t sensorModel() const override;
+
 private:
   static double sensorFunction(LaserData * data, pf_sample_set_t * set);
+
+  /**
+   * @brief Multiply the sample weights by exp(log_p_) scaled by their maximum, so
+   * the product of many beams does not underflow, and add the scale to the set's
+   * @return Total of the scaled weights
+   */
+  double applyLogLikelihoods(pf_sample_set_t * set);
+
+  // Log likelihood of each sample for the current scan
+  std::vector<double> log_p_;
   bool do_beamskip_;
+  // Beam skipping scratch, kept from scan to scan
+  std::vector<int> range_obs_count_;
+  std::vector<bool> obs_mask_;
   double beam_skip_distance_;
   double beam_skip_threshold_;
   double beam_skip_error_threshold_;
@@ -23,6 +23,10 @@
 #include "nav2_amcl/amcl_node.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
@@ -32,7 +36,9 @@
 #include "nav2_amcl/angleutils.hpp"
 #include "nav2_util/geometry_utils.hpp"
 #include "nav2_amcl/pf/pf.hpp"
+#include "nav2_util/shared_tf_buffer.hpp"
 #include "nav2_util/string_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
 #include "tf2/convert.h"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
@@ -57,8 +63,8 @@ namespace nav2_amcl
 {
 using nav2_util::geometry_utils::orientationAroundZAxis;
 
-AmclNode::AmclNode()
-: nav2_util::LifecycleNode("amcl", "", true)
+AmclNode::AmclNode(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("amcl", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -86,11 +92,27 @@ AmclNode::AmclNode()
     "base_frame_id", rclcpp::ParameterValue(std::string("base_footprint")),
     "Which frame to use for the robot base");
 
+  add_parameter(
+    "beam_range_table_directions", rclcpp::ParameterValue(0),
+    "Number of directions, over 180 degrees, of the range table the beam model looks its expected "
+    "ranges up in. The table is built once per map and takes the place of ray casting",
+    "0 ray casts every beam through the map");
+
   add_parameter("beam_skip_distance", rclcpp::ParameterValue(0.5));
   add_parameter("beam_skip_error_threshold", rclcpp::ParameterValue(0.9));
   add_parameter("beam_skip_threshold", rclcpp::ParameterValue(0.3));
   add_parameter("do_beamskip", rclcpp::ParameterValue(false));
 
+  add_parameter(
+    "diagnostics_period", rclcpp::ParameterValue(1.0),
+    "Seconds between publications of the sensor update and resampling times on /diagnostics, "
+    "0 disables the timing");
+
+  add_parameter(
+    "filter_thread", rclcpp::ParameterValue(false),
+    "Update the filter on a thread of its own, which takes the latest scan of every laser when "
+    "it is done with the previous ones. Scans it had no time for are dropped and counted");
+
   add_parameter(
     "global_frame_id", rclcpp::ParameterValue(std::string("map")),
     "The name of the coordinate frame published by the localization system");
@@ -99,6 +121,12 @@ AmclNode::AmclNode()
     "lambda_short", rclcpp::ParameterValue(0.1),
     "Exponential decay parameter for z_short part of model");
 
+  add_parameter(
+    "laser_fusion_tolerance", rclcpp::ParameterValue(0.0),
+    "Scans of different lasers stamped within this many seconds of each other are fused into "
+    "one filter update, with a single resampling",
+    "0.0 updates the filter with every laser's scan on its own");
+
   add_parameter(
     "laser_likelihood_max_dist", rclcpp::ParameterValue(2.0),
     "Maximum distance to do obstacle inflation on map, for use in likelihood_field model");
@@ -118,6 +146,11 @@ AmclNode::AmclNode()
     "Which model to use, either beam, likelihood_field, or likelihood_field_prob",
     "Same as likelihood_field but incorporates the beamskip feature, if enabled");
 
+  add_parameter(
+    "lazy_weight_normalization", rclcpp::ParameterValue(false),
+    "Leave the particle weights unnormalized between resamplings, tracking their total, "
+    "rather than normalizing them after every laser update");
+
   add_parameter(
     "set_initial_pose", rclcpp::ParameterValue(false),
     "Causes AMCL to set initial pose from the initial_pose* parameters instead of "
@@ -143,6 +176,22 @@ AmclNode::AmclNode()
     "max_beams", rclcpp::ParameterValue(60),
     "How many evenly-spaced beams in each scan to be used when updating the filter");
 
+  add_parameter(
+    "min_beams", rclcpp::ParameterValue(0),
+    "How many beams to use once the particles have converged. The count grows linearly with "
+    "the spread of the particles, up to max_beams at min_beams_spread",
+    "0 always uses max_beams");
+
+  add_parameter(
+    "min_beams_spread", rclcpp::ParameterValue(0.5),
+    "Spread of the particles (m) from which on all max_beams are used, see min_beams");
+
+  add_parameter(
+    "min_beam_spacing", rclcpp::ParameterValue(0.0),
+    "Likelihood field models skip a beam whose endpoint is closer than this (m) to the one of "
+    "the previous beam used, as it would mostly look up the same cell",
+    "0.0 uses all the evenly-spaced beams");
+
   add_parameter(
     "max_particles", rclcpp::ParameterValue(2000),
     "Minimum allowed number of particles");
@@ -151,10 +200,36 @@ AmclNode::AmclNode()
     "min_particles", rclcpp::ParameterValue(500),
     "Maximum allowed number of particles");
 
+  add_parameter(
+    "motion_model_seed", rclcpp::ParameterValue(0),
+    "Seed of the noise the motion model adds to the particles. The same seed and odometry move "
+    "the particles the same way, whatever particle_weighting_threads is");
+
   add_parameter(
     "odom_frame_id", rclcpp::ParameterValue(std::string("odom")),
     "Which frame to use for odometry");
 
+  add_parameter(
+    "particle_cloud_rate", rclcpp::ParameterValue(0.0),
+    "Maximum rate (Hz) at which the particle clouds are published. They are only built when "
+    "somebody subscribes to them",
+    "0.0 publishes on every filter update");
+
+  add_parameter(
+    "particle_cloud_max_particles", rclcpp::ParameterValue(0),
+    "Maximum number of particles in the published clouds",
+    "0 publishes all of them");
+
+  add_parameter(
+    "particle_cloud_decimation", rclcpp::ParameterValue(std::string("stratified")),
+    "How particles are picked when there are more than particle_cloud_max_particles: stratified "
+    "(spread over the cumulative weight, so that clusters keep their share) or top_k (heaviest)");
+
+  add_parameter(
+    "particle_weighting_threads", rclcpp::ParameterValue(1),
+    "Number of threads weighing the particles on a laser update, including the filter's thread",
+    "0 uses all hardware threads");
+
   add_parameter("pf_err", rclcpp::ParameterValue(0.05));
   add_parameter("pf_z", rclcpp::ParameterValue(0.99));
 
@@ -170,10 +245,29 @@ AmclNode::AmclNode()
     "by adding random poses",
     "A good value might be 0.001");
 
+  add_parameter(
+    "relocalization_levels", rclcpp::ParameterValue(6),
+    "Levels of the score pyramid of the relocalize service above the map. The coarsest level "
+    "bounds blocks of 2^levels cells, each level takes a byte a cell");
+
+  add_parameter(
+    "relocalization_max_points", rclcpp::ParameterValue(200),
+    "Most scan points the relocalize service matches, evenly picked from the scan");
+
+  add_parameter(
+    "relocalization_min_score", rclcpp::ParameterValue(0.5),
+    "Lowest mean score, in [0, 1], of the scan points at a pose for the relocalize service to "
+    "accept it");
+
   add_parameter(
     "resample_interval", rclcpp::ParameterValue(1),
     "Number of filter updates required before resampling");
 
+  add_parameter(
+    "resample_method", rclcpp::ParameterValue(std::string("multinomial")),
+    "How particles are resampled: multinomial (independent draws, KLD adaptive) or systematic "
+    "(low variance, with the particle count taken from the current distribution)");
+
   add_parameter("robot_model_type", rclcpp::ParameterValue(std::string("differential")));
 
   add_parameter(
@@ -185,11 +279,21 @@ AmclNode::AmclNode()
 
   add_parameter("sigma_hit", rclcpp::ParameterValue(0.2));
 
+  add_parameter(
+    "share_tf_buffer", rclcpp::ParameterValue(false),
+    "Use the TF buffer shared by the servers composed in this process");
+
   add_parameter(
     "tf_broadcast", rclcpp::ParameterValue(true),
     "Set this to false to prevent amcl from publishing the transform between the global frame and "
     "the odometry frame");
 
+  add_parameter(
+    "tf_publish_rate", rclcpp::ParameterValue(0.0),
+    "Rate (Hz) at which the last transform between the global frame and the odometry frame is "
+    "republished from a timer, instead of on the scans that don't update the filter",
+    "0.0 republishes it on the scans");
+
   add_parameter(
     "transform_tolerance", rclcpp::ParameterValue(1.0),
     "Time with which to post-date the transform that is published, to indicate that this transform "
@@ -221,11 +325,22 @@ AmclNode::AmclNode()
   add_parameter(
     "map_topic", rclcpp::ParameterValue("map"),
     "Topic to subscribe to in order to receive the map to localize on");
+
+  add_parameter(
+    "map_cache_size", rclcpp::ParameterValue(0),
+    "Number of replaced maps kept with their distance fields, for a map server switching back "
+    "to a preloaded map");
+
+  add_parameter(
+    "product_cache_dir", rclcpp::ParameterValue(""),
+    "Directory where the distance field and free space of each map are stored and read back "
+    "from on later starts with the same map, empty to recompute them every time");
 }
 
 AmclNode::~AmclNode()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
+  stopFilterThread();
 }
 
 nav2_util::CallbackReturn
@@ -277,6 +392,13 @@ AmclNode::on_activate(const rclcpp_lifecycle::State & /*state*/)
   pose_pub_->on_activate();
   particlecloud_pub_->on_activate();
   particle_cloud_pub_->on_activate();
+  compact_particle_cloud_pub_->on_activate();
+
+  if (timing_stats_) {
+    timing_diagnostics_ = std::make_unique<nav2_util::TimingDiagnostics>(
+      shared_from_this(), timing_stats_, get_name(),
+      std::chrono::duration<double>(diagnostics_period_));
+  }
 
   RCLCPP_WARN(
     get_logger(),
@@ -289,6 +411,16 @@ AmclNode::on_activate(const rclcpp_lifecycle::State & /*state*/)
   // process incoming callbacks until we are
   active_ = true;
 
+  if (filter_thread_enabled_) {
+    startFilterThread();
+  }
+  if (tf_publish_rate_ > 0.0) {
+    tf_timer_ = create_wall_timer(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(1.0 / tf_publish_rate_)),
+      std::bind(&AmclNode::publishLatestTransform, this));
+  }
+
   if (set_initial_pose_) {
     auto msg = std::make_shared<geometry_msgs::msg::PoseWithCovarianceStamped>();
 
@@ -316,11 +448,15 @@ AmclNode::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   active_ = false;
+  stopFilterThread();
+  tf_timer_.reset();
 
   // Lifecycle publishers must be explicitly deactivated
   pose_pub_->on_deactivate();
   particlecloud_pub_->on_deactivate();
   particle_cloud_pub_->on_deactivate();
+  compact_particle_cloud_pub_->on_deactivate();
+  timing_diagnostics_.reset();
 
   // destroy bond connection
   destroyBond();
@@ -336,17 +472,20 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   // Get rid of the inputs first (services and message filter input), so we
   // don't continue to process incoming messages
   global_loc_srv_.reset();
+  relocalize_srv_.reset();
   nomotion_update_srv_.reset();
+  snapshot_recorder_.reset();
   initial_pose_sub_.reset();
   laser_scan_connection_.disconnect();
   laser_scan_filter_.reset();
   laser_scan_sub_.reset();
 
   // Map
+  scan_matcher_.reset();
   map_free(map_);
   map_ = nullptr;
+  clearMapCache();
   first_map_received_ = false;
-  free_space_indices.resize(0);
 
   // Transforms
   tf_broadcaster_.reset();
@@ -357,6 +496,11 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   pose_pub_.reset();
   particlecloud_pub_.reset();
   particle_cloud_pub_.reset();
+  compact_particle_cloud_pub_.reset();
+  sensor_timing_ = nullptr;
+  resample_timing_ = nullptr;
+  scan_latency_timing_ = nullptr;
+  timing_stats_.reset();
 
   // Odometry
   motion_model_.reset();
@@ -364,8 +508,14 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   // Particle Filter
   pf_free(pf_);
   pf_ = nullptr;
+  last_update_valid_ = false;
 
   // Laser Scan
+  last_scan_.reset();
+  last_scan_laser_ = -1;
+  pending_scans_.clear();
+  laser_data_.clear();
+  laser_angles_.clear();
   lasers_.clear();
   lasers_update_.clear();
   frame_to_laser_.clear();
@@ -430,10 +580,6 @@ AmclNode::checkElapsedTime(std::chrono::seconds check_interval, rclcpp::Time las
   return false;
 }
 
-#if NEW_UNIFORM_SAMPLING
-std::vector<std::pair<int, int>> AmclNode::free_space_indices;
-#endif
-
 bool
 AmclNode::getOdomPose(
   geometry_msgs::msg::PoseStamped & odom_pose,
@@ -461,22 +607,31 @@ AmclNode::getOdomPose(
   scan_error_count_ = 0;  // reset since we got a good transform
   x = odom_pose.pose.position.x;
   y = odom_pose.pose.position.y;
-  yaw = tf2::getYaw(odom_pose.pose.orientation);
+  yaw = nav2_util::se2::yaw(odom_pose.pose.orientation);
 
   return true;
 }
 
+void
+AmclNode::runParallel(
+  void * pool, int task_count, void (* task)(void * task_data, int i), void * task_data)
+{
+  static_cast<nav2_util::ThreadPool *>(pool)->parallelFor(
+    static_cast<std::size_t>(task_count),
+    [task, task_data](std::size_t i) {task(task_data, static_cast<int>(i));});
+}
+
 pf_vector_t
 AmclNode::uniformPoseGenerator(void * arg)
 {
   map_t * map = reinterpret_cast<map_t *>(arg);
 
 #if NEW_UNIFORM_SAMPLING
-  unsigned int rand_index = drand48() * free_space_indices.size();
-  std::pair<int, int> free_point = free_space_indices[rand_index];
+  int i = 0, j = 0;
+  map_sample_free(map, drand48(), &i, &j);
   pf_vector_t p;
-  p.v[0] = MAP_WXGX(map, free_point.first);
-  p.v[1] = MAP_WYGY(map, free_point.second);
+  p.v[0] = MAP_WXGX(map, i);
+  p.v[1] = MAP_WYGY(map, j);
   p.v[2] = drand48() * 2 * M_PI - M_PI;
 #else
   double min_x, max_x, min_y, max_y;
@@ -497,7 +652,7 @@ AmclNode::uniformPoseGenerator(void * arg)
     int i, j;
     i = MAP_GXWX(map, p.v[0]);
     j = MAP_GYWY(map, p.v[1]);
-    if (MAP_VALID(map, i, j) && (map->cells[MAP_INDEX(map, i, j)].occ_state == -1)) {
+    if (MAP_VALID(map, i, j) && (map->occ_state[MAP_INDEX(map, i, j)] == -1)) {
       break;
     }
   }
@@ -511,6 +666,7 @@ AmclNode::globalLocalizationCallback(
   const std::shared_ptr<std_srvs::srv::Empty::Request>/*req*/,
   std::shared_ptr<std_srvs::srv::Empty::Response>/*res*/)
 {
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
   RCLCPP_INFO(get_logger(), "Initializing with uniform distribution");
 
   pf_init_model(
@@ -521,6 +677,94 @@ AmclNode::globalLocalizationCallback(
   pf_init_ = false;
 }
 
+void
+AmclNode::relocalizeCallback(
+  const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+  const std::shared_ptr<std_srvs::srv::Trigger::Request>/*req*/,
+  std::shared_ptr<std_srvs::srv::Trigger::Response> res)
+{
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+  res->success = false;
+  if (!active_ || map_ == nullptr || !last_scan_) {
+    res->message = "No map or scan to match yet";
+    return;
+  }
+  std::vector<ScanMatcher::Point> points;
+  if (!relocalizationPoints(points)) {
+    res->message = "The last scan has no usable reading";
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (!scan_matcher_) {
+    scan_matcher_ = std::make_unique<ScanMatcher>(
+      map_, sigma_hit_, relocalization_levels_, weighting_pool_.get());
+  }
+  ScanMatcher::Match match;
+  const bool found = scan_matcher_->match(points, relocalization_min_score_, match);
+  const double elapsed = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+  if (!found) {
+    res->message = "No pose matches the last scan with a score of " +
+      std::to_string(relocalization_min_score_);
+    RCLCPP_WARN(get_logger(), "Relocalization failed after %.3f s", elapsed);
+    return;
+  }
+  RCLCPP_INFO(
+    get_logger(), "Relocalized at %.3f %.3f %.3f, score %.3f, in %.3f s",
+    match.x, match.y, match.yaw, match.score, elapsed);
+
+  // The match is off by up to half a cell and half a rotation step
+  pf_vector_t mean = pf_vector_zero();
+  mean.v[0] = match.x;
+  mean.v[1] = match.y;
+  mean.v[2] = match.yaw;
+  pf_matrix_t cov = pf_matrix_zero();
+  cov.m[0][0] = cov.m[1][1] = map_->scale * map_->scale;
+  cov.m[2][2] = match.angular_step * match.angular_step;
+  pf_init(pf_, mean, cov);
+  pf_init_ = false;
+  initial_pose_is_known_ = true;
+
+  res->success = true;
+  res->message = "Relocalized at " + std::to_string(match.x) + " " + std::to_string(match.y) +
+    " " + std::to_string(match.yaw) + " with a score of " + std::to_string(match.score);
+}
+
+bool
+AmclNode::relocalizationPoints(std::vector<ScanMatcher::Point> & points)
+{
+  nav2_amcl::LaserData * ldata = fillLaserData(last_scan_laser_, last_scan_);
+  if (!ldata) {
+    return false;
+  }
+  const pf_vector_t & laser_pose = lasers_[last_scan_laser_]->laserPose();
+
+  // Points closer than a cell to the previous one add little but time
+  std::vector<ScanMatcher::Point> all;
+  for (int i = 0; i < ldata->range_count; i++) {
+    const double range = ldata->ranges[i][0];
+    if (!std::isfinite(range) || range >= ldata->range_max) {
+      continue;
+    }
+    const double bearing = ldata->ranges[i][1];
+    const ScanMatcher::Point p{
+      laser_pose.v[0] + range * cos(bearing), laser_pose.v[1] + range * sin(bearing)};
+    if (!all.empty() && hypot(p.x - all.back().x, p.y - all.back().y) < map_->scale) {
+      continue;
+    }
+    all.push_back(p);
+  }
+
+  points.clear();
+  const std::size_t max_points = static_cast<std::size_t>(std::max(relocalization_max_points_, 1));
+  const double step = std::max(1.0, static_cast<double>(all.size()) / max_points);
+  for (double k = 0.0; k < all.size(); k += step) {
+    points.push_back(all[static_cast<std::size_t>(k)]);
+  }
+  return !points.empty();
+}
+
 // force nomotion updates (amcl updating without requiring motion)
 void
 AmclNode::nomotionUpdateCallback(
@@ -552,6 +796,7 @@ AmclNode::initialPoseReceived(geometry_msgs::msg::PoseWithCovarianceStamped::Sha
       global_frame_id_.c_str());
     return;
   }
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
   // Overriding last published pose to initial pose
   last_published_pose_ = *msg;
 
@@ -631,10 +876,122 @@ AmclNode::handleInitialPose(geometry_msgs::msg::PoseWithCovarianceStamped & msg)
 
 void
 AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
+{
+  if (!filter_thread_.joinable()) {
+    processScan(laser_scan);
+    return;
+  }
+
+  bool dropped = false;
+  std::size_t dropped_scans;
+  {
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    auto waiting = std::find_if(
+      mailbox_.begin(), mailbox_.end(),
+      [&](const sensor_msgs::msg::LaserScan::ConstSharedPtr & scan) {
+        return scan->header.frame_id == laser_scan->header.frame_id;
+      });
+    if (waiting != mailbox_.end()) {
+      *waiting = laser_scan;
+      dropped = true;
+      dropped_scans_++;
+    } else {
+      mailbox_.push_back(laser_scan);
+    }
+    dropped_scans = dropped_scans_;
+  }
+  mailbox_cv_.notify_one();
+
+  if (dropped && checkElapsedTime(2s, last_drop_warning_)) {
+    RCLCPP_WARN(
+      get_logger(), "The filter is behind the scans, %zu were dropped so far", dropped_scans);
+    last_drop_warning_ = now();
+  }
+}
+
+void
+AmclNode::startFilterThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    stop_filter_thread_ = false;
+    mailbox_.clear();
+  }
+  last_drop_warning_ = now();
+  filter_thread_ = std::thread(&AmclNode::filterThreadLoop, this);
+}
+
+void
+AmclNode::stopFilterThread()
+{
+  if (!filter_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mailbox_mutex_);
+    stop_filter_thread_ = true;
+  }
+  mailbox_cv_.notify_one();
+  filter_thread_.join();
+  mailbox_.clear();
+}
+
+void
+AmclNode::filterThreadLoop()
+{
+  std::vector<sensor_msgs::msg::LaserScan::ConstSharedPtr> scans;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mailbox_mutex_);
+      mailbox_cv_.wait(lock, [this]() {return stop_filter_thread_ || !mailbox_.empty();});
+      if (stop_filter_thread_) {
+        return;
+      }
+      scans.swap(mailbox_);
+    }
+
+    // Oldest first, as they would have come on the subscription
+    std::sort(
+      scans.begin(), scans.end(),
+      [](
+        const sensor_msgs::msg::LaserScan::ConstSharedPtr & a,
+        const sensor_msgs::msg::LaserScan::ConstSharedPtr & b) {
+        return rclcpp::Time(a->header.stamp) < rclcpp::Time(b->header.stamp);
+      });
+    for (const auto & scan : scans) {
+      if (scan_latency_timing_) {
+        scan_latency_timing_->record(
+          std::chrono::nanoseconds((now() - rclcpp::Time(scan->header.stamp)).nanoseconds()));
+      }
+      processScan(scan);
+    }
+    scans.clear();
+  }
+}
+
+void
+AmclNode::publishLatestTransform()
+{
+  if (!tf_broadcast_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(tf_mutex_);
+    if (!latest_tf_valid_) {
+      return;
+    }
+  }
+  tf2::TimePoint stamp(std::chrono::nanoseconds(now().nanoseconds()));
+  sendMapToOdomTransform(stamp + transform_tolerance_);
+}
+
+void
+AmclNode::processScan(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
 {
   // Since the sensor data is continually being published by the simulator or robot,
   // we don't want our callbacks to fire until we're in the active state
   if (!active_) {return;}
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
   if (!first_map_received_) {
     if (checkElapsedTime(2s, last_time_printed_msg_)) {
       RCLCPP_WARN(get_logger(), "Waiting for map....");
@@ -657,16 +1014,37 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     // we have the laser pose, retrieve laser index
     laser_index = frame_to_laser_[laser_scan->header.frame_id];
   }
+  last_scan_ = laser_scan;
+  last_scan_laser_ = laser_index;
 
   // Where was the robot when this scan was taken?
-  pf_vector_t pose;
+  double odom_x, odom_y, odom_yaw;
   if (!getOdomPose(
-      latest_odom_pose_, pose.v[0], pose.v[1], pose.v[2],
+      latest_odom_pose_, odom_x, odom_y, odom_yaw,
       laser_scan->header.stamp, base_frame_id_))
   {
     RCLCPP_ERROR(get_logger(), "Couldn't determine robot's pose associated with laser scan");
     return;
   }
+  pf_vector_t pose;
+  pose.v[0] = odom_x;
+  pose.v[1] = odom_y;
+  pose.v[2] = odom_yaw;
+
+  beginUpdateRecord();
+  const auto update_start = std::chrono::steady_clock::now();
+  bool resampled = false;
+
+  if (!pending_scans_.empty()) {
+    if (!pf_init_) {
+      // The filter was reset, the scans were taken for the particles it had before
+      pending_scans_.clear();
+    } else if (!canFuseScan(laser_index, laser_scan)) {
+      // The held back scans are complete as they are, apply them before this
+      // scan's odometry moves the particles on
+      resampled = fusePendingScans();
+    }
+  }
 
   pf_vector_t delta = pf_vector_zero();
   bool force_publication = false;
@@ -690,29 +1068,29 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     }
     if (lasers_update_[laser_index]) {
       motion_model_->odometryUpdate(pf_, pose, delta);
+      update_record_.steps.push_back(static_cast<int32_t>(UpdateStep::MOTION));
+      update_record_.pose = pose;
+      update_record_.delta = delta;
     }
     force_update_ = false;
   }
 
-  bool resampled = false;
-
   // If the robot has moved, update the filter
   if (lasers_update_[laser_index]) {
-    updateFilter(laser_index, laser_scan, pose);
-
-    // Resample the particles
-    if (!(++resample_count_ % resample_interval_)) {
-      pf_update_resample(pf_);
-      resampled = true;
-    }
-
-    pf_sample_set_t * set = pf_->sets + pf_->current_set;
-    RCLCPP_DEBUG(get_logger(), "Num samples: %d\n", set->sample_count);
-
-    if (!force_update_) {
-      publishParticleCloud(set);
+    adaptBeams();
+    if (laser_fusion_tolerance_ > 0.0) {
+      // Hold the scan back until every laser has one from the same instant
+      if (bufferScan(laser_index, laser_scan, pose) && pending_scans_.size() == lasers_.size()) {
+        resampled = fusePendingScans() || resampled;
+      }
+    } else {
+      updateFilter(laser_index, laser_scan, pose);
+      resampled = resampleFilter();
     }
   }
+  endUpdateRecord(
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - update_start).count());
+
   if (resampled || force_publication || !first_pose_sent_) {
     amcl_hyp_t max_weight_hyps;
     std::vector<amcl_hyp_t> hyps;
@@ -732,7 +1110,7 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     } else {
       RCLCPP_ERROR(get_logger(), "No pose!");
     }
-  } else if (latest_tf_valid_) {
+  } else if (latest_tf_valid_ && !tf_timer_) {
     if (tf_broadcast_ == true) {
       // Nothing changed, so we'll just republish the last transform, to keep
       // everybody happy.
@@ -751,6 +1129,8 @@ bool AmclNode::addNewScanner(
 {
   lasers_.push_back(createLaserObject());
   lasers_update_.push_back(true);
+  laser_data_.push_back(std::make_unique<nav2_amcl::LaserData>());
+  laser_angles_.push_back(LaserAngles());
   laser_index = frame_to_laser_.size();
 
   geometry_msgs::msg::PoseStamped ident;
@@ -778,6 +1158,24 @@ bool AmclNode::addNewScanner(
   return true;
 }
 
+void AmclNode::adaptBeams()
+{
+  if (min_beams_ <= 0 || min_beams_ >= max_beams_) {
+    return;
+  }
+
+  // A converged filter is told apart by few beams, one still searching needs all of them
+  pf_vector_t mean;
+  double var;
+  pf_get_cep_stats(pf_, &mean, &var);
+  double fraction = std::min(1.0, sqrt(std::max(var, 0.0)) / min_beams_spread_);
+  int beams = std::max(2, min_beams_ + static_cast<int>((max_beams_ - min_beams_) * fraction));
+  for (nav2_amcl::Laser * laser : lasers_) {
+    laser->setMaxBeams(beams);
+  }
+  RCLCPP_DEBUG(get_logger(), "Particle spread %.3f m, using %d beams", sqrt(var), beams);
+}
+
 bool AmclNode::shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta)
 {
   delta.v[0] = pose.v[0] - pf_odom_pose_.v[0];
@@ -797,45 +1195,149 @@ bool AmclNode::updateFilter(
   const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
   const pf_vector_t & pose)
 {
-  nav2_amcl::LaserData ldata;
-  ldata.laser = lasers_[laser_index];
-  ldata.range_count = laser_scan->ranges.size();
-  // To account for lasers that are mounted upside-down, we determine the
-  // min, max, and increment angles of the laser in the base frame.
-  //
-  // Construct min and max angles of laser, in the base_link frame.
-  // Here we set the roll pich yaw of the lasers.  We assume roll and pich are zero.
-  geometry_msgs::msg::QuaternionStamped min_q, inc_q;
-  min_q.header.stamp = laser_scan->header.stamp;
-  min_q.header.frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
-  min_q.quaternion = orientationAroundZAxis(laser_scan->angle_min);
-
-  inc_q.header = min_q.header;
-  inc_q.quaternion = orientationAroundZAxis(laser_scan->angle_min + laser_scan->angle_increment);
-  try {
-    tf_buffer_->transform(min_q, min_q, base_frame_id_);
-    tf_buffer_->transform(inc_q, inc_q, base_frame_id_);
-  } catch (tf2::TransformException & e) {
-    RCLCPP_WARN(
-      get_logger(), "Unable to transform min/max laser angles into base frame: %s",
-      e.what());
+  nav2_amcl::LaserData * ldata = fillLaserData(laser_index, laser_scan);
+  if (!ldata) {
     return false;
   }
-  double angle_min = tf2::getYaw(min_q.quaternion);
-  double angle_increment = tf2::getYaw(inc_q.quaternion) - angle_min;
+  {
+    nav2_util::ScopedTrace trace(
+      "amcl.sensor_update", laser_scan->header.frame_id,
+      nav2_util::traceStamp(laser_scan->header.stamp));
+    nav2_util::ScopedTiming timing(sensor_timing_);
+    lasers_[laser_index]->sensorUpdate(pf_, ldata);
+  }
+  recordSensorStep(UpdateStep::SENSOR, &ldata, 1);
+  lasers_update_[laser_index] = false;
+  pf_odom_pose_ = pose;
+  return true;
+}
 
-  // wrapping angle to [-pi .. pi]
-  angle_increment = fmod(angle_increment + 5 * M_PI, 2 * M_PI) - M_PI;
+bool AmclNode::bufferScan(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+  const pf_vector_t & pose)
+{
+  nav2_amcl::LaserData * ldata = fillLaserData(laser_index, laser_scan);
+  if (!ldata) {
+    return false;
+  }
+  if (pending_scans_.empty()) {
+    pending_stamp_ = laser_scan->header.stamp;
+  }
+  pending_scans_.push_back(ldata);
+  lasers_update_[laser_index] = false;
+  pf_odom_pose_ = pose;
+  return true;
+}
 
-  RCLCPP_DEBUG(
-    get_logger(), "Laser %d angles in base frame: min: %.3f inc: %.3f", laser_index, angle_min,
-    angle_increment);
+bool AmclNode::canFuseScan(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan)
+{
+  for (const nav2_amcl::LaserData * pending : pending_scans_) {
+    if (pending->laser == lasers_[laser_index]) {
+      return false;
+    }
+  }
+  rclcpp::Duration age = rclcpp::Time(laser_scan->header.stamp) - pending_stamp_;
+  return fabs(age.seconds()) <= laser_fusion_tolerance_;
+}
+
+bool AmclNode::fusePendingScans()
+{
+  RCLCPP_DEBUG(get_logger(), "Fusing the scans of %zu lasers", pending_scans_.size());
+  {
+    nav2_util::ScopedTrace trace(
+      "amcl.fused_sensor_update", "", pending_stamp_.nanoseconds());
+    nav2_util::ScopedTiming timing(sensor_timing_);
+    nav2_amcl::Laser::fusedSensorUpdate(pf_, pending_scans_);
+  }
+  recordSensorStep(UpdateStep::FUSED_SENSOR, pending_scans_.data(), pending_scans_.size());
+  pending_scans_.clear();
+  return resampleFilter();
+}
+
+bool AmclNode::resampleFilter()
+{
+  bool resampled = false;
+
+  // Resample the particles
+  if (!(++resample_count_ % resample_interval_)) {
+    nav2_util::ScopedTrace trace("amcl.resample");
+    nav2_util::ScopedTiming timing(resample_timing_);
+    pf_update_resample(pf_);
+    resampled = true;
+    update_record_.steps.push_back(static_cast<int32_t>(UpdateStep::RESAMPLE));
+  }
+
+  pf_sample_set_t * set = pf_->sets + pf_->current_set;
+  RCLCPP_DEBUG(get_logger(), "Num samples: %d\n", set->sample_count);
+
+  if (!force_update_) {
+    publishParticleCloud(set);
+  }
+  return resampled;
+}
+
+nav2_amcl::LaserData * AmclNode::fillLaserData(
+  const int & laser_index,
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan)
+{
+  // Lasers are mounted rigidly (their pose is only looked up once, see addNewScanner),
+  // so the angles of their scans in the base frame only change with the scan angles
+  LaserAngles & angles = laser_angles_[laser_index];
+  if (!angles.valid || angles.scan_angle_min != laser_scan->angle_min ||
+    angles.scan_angle_increment != laser_scan->angle_increment)
+  {
+    // To account for lasers that are mounted upside-down, we determine the
+    // min, max, and increment angles of the laser in the base frame.
+    //
+    // Construct min and max angles of laser, in the base_link frame.
+    // Here we set the roll pich yaw of the lasers.  We assume roll and pich are zero.
+    geometry_msgs::msg::QuaternionStamped min_q, inc_q;
+    min_q.header.stamp = laser_scan->header.stamp;
+    min_q.header.frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
+    min_q.quaternion = orientationAroundZAxis(laser_scan->angle_min);
+
+    inc_q.header = min_q.header;
+    inc_q.quaternion = orientationAroundZAxis(
+      laser_scan->angle_min + laser_scan->angle_increment);
+    try {
+      tf_buffer_->transform(min_q, min_q, base_frame_id_);
+      tf_buffer_->transform(inc_q, inc_q, base_frame_id_);
+    } catch (tf2::TransformException & e) {
+      RCLCPP_WARN(
+        get_logger(), "Unable to transform min/max laser angles into base frame: %s",
+        e.what());
+      return nullptr;
+    }
+    angles.angle_min = tf2::getYaw(min_q.quaternion);
+    angles.angle_increment = tf2::getYaw(inc_q.quaternion) - angles.angle_min;
+
+    // wrapping angle to [-pi .. pi]
+    angles.angle_increment = fmod(angles.angle_increment + 5 * M_PI, 2 * M_PI) - M_PI;
+
+    angles.scan_angle_min = laser_scan->angle_min;
+    angles.scan_angle_increment = laser_scan->angle_increment;
+    angles.valid = true;
+
+    RCLCPP_DEBUG(
+      get_logger(), "Laser %d angles in base frame: min: %.3f inc: %.3f", laser_index,
+      angles.angle_min, angles.angle_increment);
+  }
+  const double angle_min = angles.angle_min;
+  const double angle_increment = angles.angle_increment;
+
+  // The laser's buffer is reused scan after scan
+  nav2_amcl::LaserData * ldata = laser_data_[laser_index].get();
+  ldata->laser = lasers_[laser_index];
+  ldata->setRangeCount(laser_scan->ranges.size());
 
   // Apply range min/max thresholds, if the user supplied them
   if (laser_max_range_ > 0.0) {
-    ldata.range_max = std::min(laser_scan->range_max, static_cast<float>(laser_max_range_));
+    ldata->range_max = std::min(laser_scan->range_max, static_cast<float>(laser_max_range_));
   } else {
-    ldata.range_max = laser_scan->range_max;
+    ldata->range_max = laser_scan->range_max;
   }
   double range_min;
   if (laser_min_range_ > 0.0) {
@@ -844,23 +1346,146 @@ bool AmclNode::updateFilter(
     range_min = laser_scan->range_min;
   }
 
-  // The LaserData destructor will free this memory
-  ldata.ranges = new double[ldata.range_count][2];
-  for (int i = 0; i < ldata.range_count; i++) {
+  for (int i = 0; i < ldata->range_count; i++) {
     // amcl doesn't (yet) have a concept of min range.  So we'll map short
     // readings to max range.
     if (laser_scan->ranges[i] <= range_min) {
-      ldata.ranges[i][0] = ldata.range_max;
+      ldata->ranges[i][0] = ldata->range_max;
     } else {
-      ldata.ranges[i][0] = laser_scan->ranges[i];
+      ldata->ranges[i][0] = laser_scan->ranges[i];
     }
     // Compute bearing
-    ldata.ranges[i][1] = angle_min +
+    ldata->ranges[i][1] = angle_min +
       (i * angle_increment);
   }
-  lasers_[laser_index]->sensorUpdate(pf_, reinterpret_cast<nav2_amcl::LaserData *>(&ldata));
-  lasers_update_[laser_index] = false;
-  pf_odom_pose_ = pose;
+  return ldata;
+}
+
+void
+AmclNode::beginUpdateRecord()
+{
+  update_record_.steps.clear();
+  update_record_.scan_counts.clear();
+  update_record_.pose = pf_vector_zero();
+  update_record_.delta = pf_vector_zero();
+  update_record_.w_slow = pf_->w_slow;
+  update_record_.w_fast = pf_->w_fast;
+
+  // Copying the particles on every update is only worth it if the update may be saved
+  // by itself, a snapshot asked for starts from the particles the filter has then
+  update_record_.particles.clear();
+  if (snapshot_recorder_ && snapshot_recorder_->automatic()) {
+    const pf_sample_set_t * set = pf_->sets + pf_->current_set;
+    update_record_.particles.reserve(4 * set->sample_count);
+    for (int i = 0; i < set->sample_count; i++) {
+      const pf_sample_t & sample = set->samples[i];
+      update_record_.particles.insert(
+        update_record_.particles.end(),
+        {sample.pose.v[0], sample.pose.v[1], sample.pose.v[2], sample.weight});
+    }
+  }
+}
+
+void
+AmclNode::recordSensorStep(
+  UpdateStep step, nav2_amcl::LaserData * const * data, std::size_t count)
+{
+  std::size_t first = 0;
+  for (int32_t scan_count : update_record_.scan_counts) {
+    first += scan_count;
+  }
+  // The scans keep their buffers from update to update
+  if (update_record_.scans.size() < first + count) {
+    update_record_.scans.resize(first + count);
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    UpdateRecord::Scan & scan = update_record_.scans[first + i];
+    scan.laser = static_cast<int>(
+      std::find(lasers_.begin(), lasers_.end(), data[i]->laser) - lasers_.begin());
+    scan.range_count = data[i]->range_count;
+    scan.range_max = data[i]->range_max;
+    scan.ranges.assign(&data[i]->ranges[0][0], &data[i]->ranges[0][0] + 2 * scan.range_count);
+  }
+  update_record_.steps.push_back(static_cast<int32_t>(step));
+  update_record_.scan_counts.push_back(static_cast<int32_t>(count));
+}
+
+void
+AmclNode::endUpdateRecord(double duration)
+{
+  // Updates holding scans back for fusion, or not moving enough, didn't weigh anything
+  if (update_record_.scan_counts.empty()) {
+    return;
+  }
+  update_record_.duration = duration;
+  std::swap(update_record_, last_update_);
+  last_update_valid_ = true;
+  if (snapshot_recorder_) {
+    snapshot_recorder_->checkCycle(duration);
+  }
+}
+
+bool
+AmclNode::fillSnapshot(nav2_util::SnapshotWriter & writer)
+{
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+  if (!last_update_valid_ || !map_ || !pf_) {
+    return false;
+  }
+
+  const int32_t map_size[] = {map_->size_x, map_->size_y};
+  const double map_geometry[] = {map_->scale, map_->origin_x, map_->origin_y};
+  writer.addArray("amcl/map/size", map_size, 2);
+  writer.addArray("amcl/map/geometry", map_geometry, 3);
+  writer.addArray(
+    "amcl/map/occupancy", map_->occ_state, static_cast<std::size_t>(map_->size_x) * map_->size_y);
+
+  std::vector<double> laser_poses;
+  for (const nav2_amcl::Laser * laser : lasers_) {
+    const pf_vector_t & laser_pose = laser->laserPose();
+    laser_poses.insert(laser_poses.end(), {laser_pose.v[0], laser_pose.v[1], laser_pose.v[2]});
+  }
+  writer.addArray("amcl/lasers", laser_poses);
+
+  if (!last_update_.particles.empty()) {
+    writer.addArray("amcl/particles", last_update_.particles);
+    const double weights[] = {last_update_.w_slow, last_update_.w_fast};
+    writer.addArray("amcl/filter", weights, 2);
+  } else {
+    // Saved on demand, the next update starts from the particles as they are now
+    std::vector<double> particles;
+    const pf_sample_set_t * set = pf_->sets + pf_->current_set;
+    particles.reserve(4 * set->sample_count);
+    for (int i = 0; i < set->sample_count; i++) {
+      const pf_sample_t & sample = set->samples[i];
+      particles.insert(
+        particles.end(),
+        {sample.pose.v[0], sample.pose.v[1], sample.pose.v[2], sample.weight});
+    }
+    writer.addArray("amcl/particles", particles);
+    const double weights[] = {pf_->w_slow, pf_->w_fast};
+    writer.addArray("amcl/filter", weights, 2);
+  }
+
+  const double odometry[] = {
+    last_update_.pose.v[0], last_update_.pose.v[1], last_update_.pose.v[2],
+    last_update_.delta.v[0], last_update_.delta.v[1], last_update_.delta.v[2]};
+  writer.addArray("amcl/odometry", odometry, 6);
+  writer.addArray("amcl/steps", last_update_.steps);
+  writer.addArray("amcl/scan_counts", last_update_.scan_counts);
+  std::size_t scan_count = 0;
+  for (int32_t count : last_update_.scan_counts) {
+    scan_count += count;
+  }
+  for (std::size_t i = 0; i < scan_count; i++) {
+    const UpdateRecord::Scan & scan = last_update_.scans[i];
+    const std::string name = "amcl/scans/" + std::to_string(i);
+    const double info[] = {static_cast<double>(scan.laser), scan.range_max};
+    writer.addArray(name + "/info", info, 2);
+    writer.addArray(name + "/ranges", scan.ranges.data(), 2 * scan.range_count);
+  }
+  writer.addValue("amcl/duration", last_update_.duration);
+  nav2_util::addParameters(writer, "amcl/parameters", nav2_util::allParameters(this));
   return true;
 }
 
@@ -869,25 +1494,129 @@ AmclNode::publishParticleCloud(const pf_sample_set_t * set)
 {
   // If initial pose is not known, AMCL does not know the current pose
   if (!initial_pose_is_known_) {return;}
-  auto cloud_with_weights_msg = std::make_unique<nav2_msgs::msg::ParticleCloud>();
-  cloud_with_weights_msg->header.stamp = this->now();
-  cloud_with_weights_msg->header.frame_id = global_frame_id_;
-  cloud_with_weights_msg->particles.resize(set->sample_count);
-
-  auto cloud_msg = std::make_unique<geometry_msgs::msg::PoseArray>();
-  cloud_msg->header.stamp = this->now();
-  cloud_msg->header.frame_id = global_frame_id_;
-  cloud_msg->poses.resize(set->sample_count);
-  for (int i = 0; i < set->sample_count; i++) {
-    cloud_msg->poses[i].position.x = set->samples[i].pose.v[0];
-    cloud_msg->poses[i].position.y = set->samples[i].pose.v[1];
-    cloud_msg->poses[i].position.z = 0;
-    cloud_msg->poses[i].orientation = orientationAroundZAxis(set->samples[i].pose.v[2]);
-    cloud_with_weights_msg->particles[i].pose = (*cloud_msg).poses[i];
-    cloud_with_weights_msg->particles[i].weight = set->samples[i].weight;
-  }
-  particlecloud_pub_->publish(std::move(cloud_msg));
-  particle_cloud_pub_->publish(std::move(cloud_with_weights_msg));
+
+  // The clouds are only built for somebody to look at
+  const bool pose_array = particlecloud_pub_->get_subscription_count() > 0;
+  const bool with_weights = particle_cloud_pub_->get_subscription_count() > 0;
+  const bool compact = compact_particle_cloud_pub_->get_subscription_count() > 0;
+  if (!pose_array && !with_weights && !compact) {return;}
+
+  rclcpp::Time now = this->now();
+  if (particle_cloud_rate_ > 0.0 && particle_cloud_published_ &&
+    (now - last_particle_cloud_time_).seconds() < 1.0 / particle_cloud_rate_)
+  {
+    return;
+  }
+  last_particle_cloud_time_ = now;
+  particle_cloud_published_ = true;
+
+  selectCloudParticles(set);
+  const size_t count = cloud_particles_.size();
+
+  std::unique_ptr<geometry_msgs::msg::PoseArray> cloud_msg;
+  std::unique_ptr<nav2_msgs::msg::ParticleCloud> cloud_with_weights_msg;
+  std::unique_ptr<nav2_msgs::msg::CompactParticleCloud> compact_msg;
+  if (pose_array) {
+    cloud_msg = std::make_unique<geometry_msgs::msg::PoseArray>();
+    cloud_msg->header.stamp = now;
+    cloud_msg->header.frame_id = global_frame_id_;
+    cloud_msg->poses.resize(count);
+  }
+  if (with_weights) {
+    cloud_with_weights_msg = std::make_unique<nav2_msgs::msg::ParticleCloud>();
+    cloud_with_weights_msg->header.stamp = now;
+    cloud_with_weights_msg->header.frame_id = global_frame_id_;
+    cloud_with_weights_msg->particles.resize(count);
+  }
+  if (compact) {
+    compact_msg = std::make_unique<nav2_msgs::msg::CompactParticleCloud>();
+    compact_msg->header.stamp = now;
+    compact_msg->header.frame_id = global_frame_id_;
+    compact_msg->x.resize(count);
+    compact_msg->y.resize(count);
+    compact_msg->yaw.resize(count);
+    compact_msg->weight.resize(count);
+  }
+
+  // Published weights are normalized, whether or not the filter keeps them so
+  const double weight_scale = 1.0 / set->total_weight;
+  for (size_t i = 0; i < count; i++) {
+    const pf_sample_t & sample = set->samples[cloud_particles_[i]];
+    if (pose_array || with_weights) {
+      geometry_msgs::msg::Pose pose;
+      pose.position.x = sample.pose.v[0];
+      pose.position.y = sample.pose.v[1];
+      pose.position.z = 0;
+      pose.orientation = orientationAroundZAxis(sample.pose.v[2]);
+      if (pose_array) {
+        cloud_msg->poses[i] = pose;
+      }
+      if (with_weights) {
+        cloud_with_weights_msg->particles[i].pose = pose;
+        cloud_with_weights_msg->particles[i].weight = sample.weight * weight_scale;
+      }
+    }
+    if (compact) {
+      compact_msg->x[i] = sample.pose.v[0];
+      compact_msg->y[i] = sample.pose.v[1];
+      compact_msg->yaw[i] = sample.pose.v[2];
+      compact_msg->weight[i] = sample.weight * weight_scale;
+    }
+  }
+
+  if (pose_array) {
+    particlecloud_pub_->publish(std::move(cloud_msg));
+  }
+  if (with_weights) {
+    particle_cloud_pub_->publish(std::move(cloud_with_weights_msg));
+  }
+  if (compact) {
+    compact_particle_cloud_pub_->publish(std::move(compact_msg));
+  }
+}
+
+void
+AmclNode::selectCloudParticles(const pf_sample_set_t * set)
+{
+  const int sample_count = set->sample_count;
+  const int max_particles = particle_cloud_max_particles_;
+  cloud_particles_.resize(sample_count);
+  for (int i = 0; i < sample_count; i++) {
+    cloud_particles_[i] = i;
+  }
+  if (max_particles <= 0 || sample_count <= max_particles) {
+    return;
+  }
+
+  if (particle_cloud_decimation_ == "top_k") {
+    std::nth_element(
+      cloud_particles_.begin(), cloud_particles_.begin() + max_particles, cloud_particles_.end(),
+      [set](int a, int b) {return set->samples[a].weight > set->samples[b].weight;});
+    cloud_particles_.resize(max_particles);
+    std::sort(cloud_particles_.begin(), cloud_particles_.end());
+    return;
+  }
+
+  // Stratified: one pick in the middle of each of max_particles equal slices of the
+  // cumulative weight. A particle heavier than a slice is picked once
+  double total = 0.0;
+  for (int i = 0; i < sample_count; i++) {
+    total += set->samples[i].weight;
+  }
+  const double stride = total / max_particles;
+  double cumulative = 0.0;
+  double next_pick = 0.5 * stride;
+  size_t picked = 0;
+  for (int i = 0; i < sample_count && picked < static_cast<size_t>(max_particles); i++) {
+    cumulative += set->samples[i].weight;
+    if (cumulative > next_pick) {
+      cloud_particles_[picked++] = i;
+      while (next_pick < cumulative) {
+        next_pick += stride;
+      }
+    }
+  }
+  cloud_particles_.resize(picked);
 }
 
 bool
@@ -895,41 +1624,26 @@ AmclNode::getMaxWeightHyp(
   std::vector<amcl_hyp_t> & hyps, amcl_hyp_t & max_weight_hyps,
   int & max_weight_hyp)
 {
-  // Read out the current hypotheses
-  double max_weight = 0.0;
-  hyps.resize(pf_->sets[pf_->current_set].cluster_count);
-  for (int hyp_count = 0;
-    hyp_count < pf_->sets[pf_->current_set].cluster_count; hyp_count++)
+  // Only the heaviest hypothesis is published, it is the only one read out
+  const int cluster = pf_get_max_weight_cluster(pf_);
+  if (cluster < 0) {
+    return false;
+  }
+  hyps.resize(1);
+  max_weight_hyp = 0;
+  if (!pf_get_cluster_stats(
+      pf_, cluster, &hyps[0].weight, &hyps[0].pf_pose_mean, &hyps[0].pf_pose_cov))
   {
-    double weight;
-    pf_vector_t pose_mean;
-    pf_matrix_t pose_cov;
-    if (!pf_get_cluster_stats(pf_, hyp_count, &weight, &pose_mean, &pose_cov)) {
-      RCLCPP_ERROR(get_logger(), "Couldn't get stats on cluster %d", hyp_count);
-      return false;
-    }
-
-    hyps[hyp_count].weight = weight;
-    hyps[hyp_count].pf_pose_mean = pose_mean;
-    hyps[hyp_count].pf_pose_cov = pose_cov;
-
-    if (hyps[hyp_count].weight > max_weight) {
-      max_weight = hyps[hyp_count].weight;
-      max_weight_hyp = hyp_count;
-    }
+    RCLCPP_ERROR(get_logger(), "Couldn't get stats on cluster %d", cluster);
+    return false;
   }
 
-  if (max_weight > 0.0) {
-    RCLCPP_DEBUG(
-      get_logger(), "Max weight pose: %.3f %.3f %.3f",
-      hyps[max_weight_hyp].pf_pose_mean.v[0],
-      hyps[max_weight_hyp].pf_pose_mean.v[1],
-      hyps[max_weight_hyp].pf_pose_mean.v[2]);
+  RCLCPP_DEBUG(
+    get_logger(), "Max weight pose: %.3f %.3f %.3f",
+    hyps[0].pf_pose_mean.v[0], hyps[0].pf_pose_mean.v[1], hyps[0].pf_pose_mean.v[2]);
 
-    max_weight_hyps = hyps[max_weight_hyp];
-    return true;
-  }
-  return false;
+  max_weight_hyps = hyps[0];
+  return true;
 }
 
 void
@@ -1016,6 +1730,7 @@ AmclNode::calculateMaptoOdomTransform(
     return;
   }
 
+  std::lock_guard<std::mutex> lock(tf_mutex_);
   tf2::impl::Converter<true, false>::convert(odom_to_map.pose, latest_tf_);
   latest_tf_valid_ = true;
 }
@@ -1029,7 +1744,10 @@ AmclNode::sendMapToOdomTransform(const tf2::TimePoint & transform_expiration)
   tmp_tf_stamped.header.frame_id = global_frame_id_;
   tmp_tf_stamped.header.stamp = tf2_ros::toMsg(transform_expiration);
   tmp_tf_stamped.child_frame_id = odom_frame_id_;
-  tf2::impl::Converter<false, true>::convert(latest_tf_.inverse(), tmp_tf_stamped.transform);
+  {
+    std::lock_guard<std::mutex> lock(tf_mutex_);
+    tf2::impl::Converter<false, true>::convert(latest_tf_.inverse(), tmp_tf_stamped.transform);
+  }
   tf_broadcaster_->sendTransform(tmp_tf_stamped);
 }
 
@@ -1038,22 +1756,25 @@ AmclNode::createLaserObject()
 {
   RCLCPP_INFO(get_logger(), "createLaserObject");
 
+  nav2_amcl::Laser * laser;
   if (sensor_model_type_ == "beam") {
-    return new nav2_amcl::BeamModel(
+    laser = new nav2_amcl::BeamModel(
       z_hit_, z_short_, z_max_, z_rand_, sigma_hit_, lambda_short_,
-      0.0, max_beams_, map_);
-  }
-
-  if (sensor_model_type_ == "likelihood_field_prob") {
-    return new nav2_amcl::LikelihoodFieldModelProb(
+      0.0, beam_range_table_directions_, max_beams_, map_);
+  } else if (sensor_model_type_ == "likelihood_field_prob") {
+    laser = new nav2_amcl::LikelihoodFieldModelProb(
       z_hit_, z_rand_, sigma_hit_,
       laser_likelihood_max_dist_, do_beamskip_, beam_skip_distance_, beam_skip_threshold_,
       beam_skip_error_threshold_, max_beams_, map_);
+  } else {
+    laser = new nav2_amcl::LikelihoodFieldModel(
+      z_hit_, z_rand_, sigma_hit_,
+      laser_likelihood_max_dist_, max_beams_, map_);
   }
 
-  return new nav2_amcl::LikelihoodFieldModel(
-    z_hit_, z_rand_, sigma_hit_,
-    laser_likelihood_max_dist_, max_beams_, map_);
+  laser->setThreadPool(weighting_pool_);
+  laser->setMinBeamSpacing(min_beam_spacing_);
+  return laser;
 }
 
 void
@@ -1068,34 +1789,53 @@ AmclNode::initParameters()
   get_parameter("alpha4", alpha4_);
   get_parameter("alpha5", alpha5_);
   get_parameter("base_frame_id", base_frame_id_);
+  get_parameter("beam_range_table_directions", beam_range_table_directions_);
   get_parameter("beam_skip_distance", beam_skip_distance_);
   get_parameter("beam_skip_error_threshold", beam_skip_error_threshold_);
   get_parameter("beam_skip_threshold", beam_skip_threshold_);
   get_parameter("do_beamskip", do_beamskip_);
+  get_parameter("diagnostics_period", diagnostics_period_);
+  get_parameter("filter_thread", filter_thread_enabled_);
   get_parameter("global_frame_id", global_frame_id_);
   get_parameter("lambda_short", lambda_short_);
+  get_parameter("laser_fusion_tolerance", laser_fusion_tolerance_);
   get_parameter("laser_likelihood_max_dist", laser_likelihood_max_dist_);
   get_parameter("laser_max_range", laser_max_range_);
   get_parameter("laser_min_range", laser_min_range_);
   get_parameter("laser_model_type", sensor_model_type_);
+  get_parameter("lazy_weight_normalization", lazy_weight_normalization_);
   get_parameter("set_initial_pose", set_initial_pose_);
   get_parameter("initial_pose.x", initial_pose_x_);
   get_parameter("initial_pose.y", initial_pose_y_);
   get_parameter("initial_pose.z", initial_pose_z_);
   get_parameter("initial_pose.yaw", initial_pose_yaw_);
   get_parameter("max_beams", max_beams_);
+  get_parameter("min_beams", min_beams_);
+  get_parameter("min_beams_spread", min_beams_spread_);
+  get_parameter("min_beam_spacing", min_beam_spacing_);
   get_parameter("max_particles", max_particles_);
   get_parameter("min_particles", min_particles_);
+  get_parameter("motion_model_seed", motion_model_seed_);
   get_parameter("odom_frame_id", odom_frame_id_);
+  get_parameter("particle_cloud_rate", particle_cloud_rate_);
+  get_parameter("particle_cloud_max_particles", particle_cloud_max_particles_);
+  get_parameter("particle_cloud_decimation", particle_cloud_decimation_);
+  get_parameter("particle_weighting_threads", particle_weighting_threads_);
   get_parameter("pf_err", pf_err_);
   get_parameter("pf_z", pf_z_);
+  get_parameter("relocalization_levels", relocalization_levels_);
+  get_parameter("relocalization_max_points", relocalization_max_points_);
+  get_parameter("relocalization_min_score", relocalization_min_score_);
   get_parameter("recovery_alpha_fast", alpha_fast_);
   get_parameter("recovery_alpha_slow", alpha_slow_);
   get_parameter("resample_interval", resample_interval_);
+  get_parameter("resample_method", resample_method_);
   get_parameter("robot_model_type", robot_model_type_);
   get_parameter("save_pose_rate", save_pose_rate);
   get_parameter("sigma_hit", sigma_hit_);
   get_parameter("tf_broadcast", tf_broadcast_);
+  get_parameter("tf_publish_rate", tf_publish_rate_);
+  get_parameter("share_tf_buffer", share_tf_buffer_);
   get_parameter("transform_tolerance", tmp_tol);
   get_parameter("update_min_a", a_thresh_);
   get_parameter("update_min_d", d_thresh_);
@@ -1107,6 +1847,8 @@ AmclNode::initParameters()
   get_parameter("always_reset_initial_pose", always_reset_initial_pose_);
   get_parameter("scan_topic", scan_topic_);
   get_parameter("map_topic", map_topic_);
+  get_parameter("map_cache_size", map_cache_size_);
+  product_cache_ = nav2_util::ProductCache(get_parameter("product_cache_dir").as_string());
 
   save_pose_period_ = tf2::durationFromSec(1.0 / save_pose_rate);
   transform_tolerance_ = tf2::durationFromSec(tmp_tol);
@@ -1129,6 +1871,28 @@ AmclNode::initParameters()
   if (always_reset_initial_pose_) {
     initial_pose_is_known_ = false;
   }
+
+  if (resample_method_ != "multinomial" && resample_method_ != "systematic") {
+    RCLCPP_WARN(
+      get_logger(), "Unknown resample_method \"%s\", using multinomial resampling",
+      resample_method_.c_str());
+    resample_method_ = "multinomial";
+  }
+
+  if (particle_cloud_decimation_ != "stratified" && particle_cloud_decimation_ != "top_k") {
+    RCLCPP_WARN(
+      get_logger(), "Unknown particle_cloud_decimation \"%s\", using stratified",
+      particle_cloud_decimation_.c_str());
+    particle_cloud_decimation_ = "stratified";
+  }
+
+  weighting_pool_.reset();
+  if (particle_weighting_threads_ != 1) {
+    weighting_pool_ = std::make_shared<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::LOCALIZATION, std::max(particle_weighting_threads_, 0));
+    RCLCPP_INFO(
+      get_logger(), "Weighing particles on %u threads", weighting_pool_->size());
+  }
 }
 
 void
@@ -1160,7 +1924,18 @@ AmclNode::handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg)
       global_frame_id_.c_str());
   }
   freeMapDependentMemory();
-  map_ = convertMap(msg);
+  map_key_ = mapKey(msg);
+  auto cached = std::find_if(
+    map_cache_.begin(), map_cache_.end(),
+    [this](const std::pair<MapKey, map_t *> & entry) {return entry.first == map_key_;});
+  if (cached != map_cache_.end()) {
+    RCLCPP_INFO(get_logger(), "Reusing the map cached from its last use");
+    map_ = cached->second;
+    map_cache_.erase(cached);
+  } else {
+    map_ = convertMap(msg);
+    loadMapProducts();
+  }
 
 #if NEW_UNIFORM_SAMPLING
   createFreeSpaceVector();
@@ -1170,32 +1945,142 @@ AmclNode::handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg)
 void
 AmclNode::createFreeSpaceVector()
 {
-  // Index of free space
-  free_space_indices.resize(0);
-  for (int i = 0; i < map_->size_x; i++) {
-    for (int j = 0; j < map_->size_y; j++) {
-      if (map_->cells[MAP_INDEX(map_, i, j)].occ_state == -1) {
-        free_space_indices.push_back(std::make_pair(i, j));
-      }
-    }
+  // Index of free space, as runs along the map rows
+  if (!map_->free_space) {
+    map_update_free_space(map_);
   }
 }
 
 void
 AmclNode::freeMapDependentMemory()
 {
+  scan_matcher_.reset();
   if (map_ != NULL) {
-    map_free(map_);
+    // Without a map_load_time, the map can't be told from the next ones of the same size
+    if (map_cache_size_ > 0 && map_key_.load_time != 0) {
+      map_cache_.emplace_front(map_key_, map_);
+      while (map_cache_.size() > static_cast<size_t>(map_cache_size_)) {
+        map_free(map_cache_.back().second);
+        map_cache_.pop_back();
+      }
+    } else {
+      map_free(map_);
+    }
     map_ = NULL;
   }
 
   // Clear queued laser objects because they hold pointers to the existing
   // map, #5202.
+  last_update_valid_ = false;
+  last_scan_.reset();
+  last_scan_laser_ = -1;
+  pending_scans_.clear();
+  laser_data_.clear();
+  laser_angles_.clear();
   lasers_.clear();
   lasers_update_.clear();
   frame_to_laser_.clear();
 }
 
+void
+AmclNode::loadMapProducts()
+{
+  if (!product_cache_.enabled()) {
+    return;
+  }
+  const size_t count = static_cast<size_t>(map_->size_x) * map_->size_y;
+  uint64_t key = nav2_util::hashBytes(map_->occ_state, count);
+  const double geometry[] = {
+    static_cast<double>(map_->size_x), static_cast<double>(map_->size_y), map_->scale,
+    map_->origin_x, map_->origin_y};
+  key = nav2_util::hashBytes(geometry, sizeof(geometry), key);
+
+  // The beam model ray casts through the occupancy states only
+  if (sensor_model_type_ != "beam") {
+    const double max_occ_dist = laser_likelihood_max_dist_;
+    const uint64_t cspace_key = nav2_util::hashBytes(&max_occ_dist, sizeof(max_occ_dist), key);
+    auto product = product_cache_.load("amcl_cspace_v1", cspace_key);
+    if (product && product->sectionCount() == 2 &&
+      product->sectionSize(0) == count * sizeof(uint16_t) &&
+      product->sectionSize(1) == sizeof(double))
+    {
+      map_->occ_dist = static_cast<uint16_t *>(std::malloc(product->sectionSize(0)));
+      std::memcpy(map_->occ_dist, product->sectionData(0), product->sectionSize(0));
+      std::memcpy(&map_->occ_dist_step, product->sectionData(1), sizeof(double));
+      map_->max_occ_dist = max_occ_dist;
+      map_->likelihood_sigma_hit = -1;
+      RCLCPP_INFO(get_logger(), "Read the distance field from the product cache");
+    } else {
+      map_update_cspace(map_, max_occ_dist);
+      if (!product_cache_.store(
+          "amcl_cspace_v1", cspace_key,
+          {{map_->occ_dist, count * sizeof(uint16_t)},
+            {&map_->occ_dist_step, sizeof(double)}}))
+      {
+        RCLCPP_WARN(get_logger(), "Failed to store the distance field in the product cache");
+      }
+    }
+  }
+
+#if NEW_UNIFORM_SAMPLING
+  auto product = product_cache_.load("amcl_free_space_v1", key);
+  if (product && product->sectionCount() == 3 &&
+    product->sectionSize(0) % sizeof(int) == 0 && product->sectionSize(0) >= sizeof(int) &&
+    product->sectionSize(1) == product->sectionSize(0) &&
+    product->sectionSize(2) == product->sectionSize(0) / sizeof(int) * sizeof(int64_t))
+  {
+    // Laid out as map_update_free_space allocates it, with span_count + 1 entries each
+    auto free_space = static_cast<map_free_space_t *>(std::malloc(sizeof(map_free_space_t)));
+    free_space->span_count = static_cast<int>(product->sectionSize(0) / sizeof(int)) - 1;
+    free_space->span_i = static_cast<int *>(std::malloc(product->sectionSize(0)));
+    free_space->span_j = static_cast<int *>(std::malloc(product->sectionSize(1)));
+    free_space->cells_before = static_cast<int64_t *>(std::malloc(product->sectionSize(2)));
+    std::memcpy(free_space->span_i, product->sectionData(0), product->sectionSize(0));
+    std::memcpy(free_space->span_j, product->sectionData(1), product->sectionSize(1));
+    std::memcpy(free_space->cells_before, product->sectionData(2), product->sectionSize(2));
+    map_->free_space = free_space;
+  } else {
+    map_update_free_space(map_);
+    const size_t entries = static_cast<size_t>(map_->free_space->span_count) + 1;
+    product_cache_.store(
+      "amcl_free_space_v1", key,
+      {{map_->free_space->span_i, entries * sizeof(int)},
+        {map_->free_space->span_j, entries * sizeof(int)},
+        {map_->free_space->cells_before, entries * sizeof(int64_t)}});
+  }
+#endif
+}
+
+bool
+AmclNode::MapKey::operator==(const MapKey & other) const
+{
+  return load_time == other.load_time && width == other.width && height == other.height &&
+         resolution == other.resolution && origin_x == other.origin_x &&
+         origin_y == other.origin_y;
+}
+
+AmclNode::MapKey
+AmclNode::mapKey(const nav_msgs::msg::OccupancyGrid & map_msg)
+{
+  MapKey key;
+  key.load_time = rclcpp::Time(map_msg.info.map_load_time).nanoseconds();
+  key.width = map_msg.info.width;
+  key.height = map_msg.info.height;
+  key.resolution = map_msg.info.resolution;
+  key.origin_x = map_msg.info.origin.position.x;
+  key.origin_y = map_msg.info.origin.position.y;
+  return key;
+}
+
+void
+AmclNode::clearMapCache()
+{
+  for (auto & entry : map_cache_) {
+    map_free(entry.second);
+  }
+  map_cache_.clear();
+}
+
 // Convert an OccupancyGrid map message into the internal representation. This function
 // allocates a map_t and returns it.
 map_t *
@@ -1203,23 +2088,17 @@ AmclNode::convertMap(const nav_msgs::msg::OccupancyGrid & map_msg)
 {
   map_t * map = map_alloc();
 
-  map->size_x = map_msg.info.width;
-  map->size_y = map_msg.info.height;
+  map_alloc_cells(map, map_msg.info.width, map_msg.info.height);
   map->scale = map_msg.info.resolution;
   map->origin_x = map_msg.info.origin.position.x + (map->size_x / 2) * map->scale;
   map->origin_y = map_msg.info.origin.position.y + (map->size_y / 2) * map->scale;
 
-  map->cells =
-    reinterpret_cast<map_cell_t *>(malloc(sizeof(map_cell_t) * map->size_x * map->size_y));
-
   // Convert to player format
   for (int i = 0; i < map->size_x * map->size_y; i++) {
     if (map_msg.data[i] == 0) {
-      map->cells[i].occ_state = -1;
+      map->occ_state[i] = -1;
     } else if (map_msg.data[i] == 100) {
-      map->cells[i].occ_state = +1;
-    } else {
-      map->cells[i].occ_state = 0;
+      map->occ_state[i] = +1;
     }
   }
 
@@ -1232,12 +2111,16 @@ AmclNode::initTransforms()
   RCLCPP_INFO(get_logger(), "initTransforms");
 
   // Initialize transform listener and broadcaster
-  tf_buffer_ = std::make_shared<tf2_ros::Buffer>(rclcpp_node_->get_clock());
-  auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
-    rclcpp_node_->get_node_base_interface(),
-    rclcpp_node_->get_node_timers_interface());
-  tf_buffer_->setCreateTimerInterface(timer_interface);
-  tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+  if (share_tf_buffer_) {
+    tf_buffer_ = nav2_util::getSharedTfBuffer(get_parameter("use_sim_time").as_bool());
+  } else {
+    tf_buffer_ = std::make_shared<tf2_ros::Buffer>(rclcpp_node_->get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      rclcpp_node_->get_node_base_interface(),
+      rclcpp_node_->get_node_timers_interface());
+    tf_buffer_->setCreateTimerInterface(timer_interface);
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+  }
   tf_broadcaster_ = std::make_shared<tf2_ros::TransformBroadcaster>(rclcpp_node_);
 
   sent_first_transform_ = false;
@@ -1273,10 +2156,23 @@ AmclNode::initPubSub()
     "particle_cloud",
     rclcpp::SensorDataQoS());
 
+  compact_particle_cloud_pub_ = create_publisher<nav2_msgs::msg::CompactParticleCloud>(
+    "particle_cloud_compact",
+    rclcpp::SensorDataQoS());
+
   pose_pub_ = create_publisher<geometry_msgs::msg::PoseWithCovarianceStamped>(
     "amcl_pose",
     rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
 
+  if (diagnostics_period_ > 0.0) {
+    timing_stats_ = std::make_shared<nav2_util::TimingStats>();
+    sensor_timing_ = &timing_stats_->histogram("sensor_update");
+    resample_timing_ = &timing_stats_->histogram("resample");
+    if (filter_thread_enabled_) {
+      scan_latency_timing_ = &timing_stats_->histogram("scan_latency");
+    }
+  }
+
   initial_pose_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
     "initialpose", rclcpp::SystemDefaultsQoS(),
     std::bind(&AmclNode::initialPoseReceived, this, std::placeholders::_1));
@@ -1295,9 +2191,16 @@ AmclNode::initServices()
     "reinitialize_global_localization",
     std::bind(&AmclNode::globalLocalizationCallback, this, _1, _2, _3));
 
+  relocalize_srv_ = create_service<std_srvs::srv::Trigger>(
+    "relocalize",
+    std::bind(&AmclNode::relocalizeCallback, this, _1, _2, _3));
+
   nomotion_update_srv_ = create_service<std_srvs::srv::Empty>(
     "request_nomotion_update",
     std::bind(&AmclNode::nomotionUpdateCallback, this, _1, _2, _3));
+
+  snapshot_recorder_ = std::make_unique<nav2_util::SnapshotRecorder>(
+    this, [this](nav2_util::SnapshotWriter & writer) {return fillSnapshot(writer);});
 }
 
 void
@@ -1324,6 +2227,10 @@ AmclNode::initOdometry()
   motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(
     nav2_amcl::MotionModel::createMotionModel(
       robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  if (motion_model_) {
+    motion_model_->setSeed(static_cast<uint64_t>(motion_model_seed_));
+    motion_model_->setThreadPool(weighting_pool_);
+  }
 
   latest_odom_pose_ = geometry_msgs::msg::PoseStamped();
 }
@@ -1338,6 +2245,13 @@ AmclNode::initParticleFilter()
     reinterpret_cast<void *>(map_));
   pf_->pop_err = pf_err_;
   pf_->pop_z = pf_z_;
+  pf_->resample_method =
+    resample_method_ == "systematic" ? PF_RESAMPLE_SYSTEMATIC : PF_RESAMPLE_MULTINOMIAL;
+  pf_->lazy_normalization = lazy_weight_normalization_;
+  if (weighting_pool_) {
+    pf_->parallel_fn = &AmclNode::runParallel;
+    pf_->parallel_data = weighting_pool_.get();
+  }
 
   // Initialize the filter
   pf_vector_t pf_init_pose_mean = pf_vector_zero();
@@ -1365,3 +2279,7 @@ AmclNode::initLaserScan()
 }
 
 }  // namespace nav2_amcl
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_amcl::AmclNode)
@@ -0,0 +1,223 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Updates again the particles of an AMCL snapshot, with the odometry and the scans of the
+// update recorded, in a filter configured as the node had it:
+//
+//   ros2 run nav2_amcl amcl_replay <snapshot> [--runs <n>] [--trace <file>]
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_amcl/amcl_node.hpp"
+#include "nav2_amcl/pf/pf.hpp"
+#include "nav2_util/snapshot.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
+#include "nav2_util/snapshot_replay.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace
+{
+
+// The node, for its filter, motion model and laser models, fed from the snapshot rather
+// than from topics
+class AmclReplay : public nav2_amcl::AmclNode
+{
+public:
+  using nav2_amcl::AmclNode::AmclNode;
+
+  // Rebuild the map, the lasers and the update of the snapshot, in the configured node
+  bool load(const nav2_util::Snapshot & snapshot)
+  {
+    std::size_t count = 0;
+    const int32_t * size = snapshot.array<int32_t>("amcl/map/size", count);
+    std::size_t geometry_count = 0;
+    const double * geometry = snapshot.array<double>("amcl/map/geometry", geometry_count);
+    std::size_t cell_count = 0;
+    const int8_t * occupancy = snapshot.array<int8_t>("amcl/map/occupancy", cell_count);
+    if (!size || count != 2 || !geometry || geometry_count != 3 || !occupancy ||
+      cell_count != static_cast<std::size_t>(size[0]) * size[1])
+    {
+      return false;
+    }
+    freeMapDependentMemory();
+    map_ = map_alloc();
+    map_alloc_cells(map_, size[0], size[1]);
+    map_->scale = geometry[0];
+    map_->origin_x = geometry[1];
+    map_->origin_y = geometry[2];
+    std::memcpy(map_->occ_state, occupancy, cell_count);
+    loadMapProducts();
+    createFreeSpaceVector();
+    first_map_received_ = true;
+
+    // The laser models measure the map as they are created
+    std::vector<double> laser_poses = snapshot.vector<double>("amcl/lasers");
+    for (std::size_t i = 0; i + 2 < laser_poses.size(); i += 3) {
+      lasers_.push_back(createLaserObject());
+      pf_vector_t laser_pose = pf_vector_zero();
+      laser_pose.v[0] = laser_poses[i];
+      laser_pose.v[1] = laser_poses[i + 1];
+      laser_pose.v[2] = laser_poses[i + 2];
+      lasers_.back()->SetLaserPose(laser_pose);
+    }
+
+    steps_ = snapshot.vector<int32_t>("amcl/steps");
+    scan_counts_ = snapshot.vector<int32_t>("amcl/scan_counts");
+    int32_t scan_count = 0;
+    for (int32_t step_scans : scan_counts_) {
+      scan_count += step_scans;
+    }
+    for (int32_t i = 0; i < scan_count; i++) {
+      const std::string name = "amcl/scans/" + std::to_string(i);
+      std::vector<double> info = snapshot.vector<double>(name + "/info");
+      std::vector<double> ranges = snapshot.vector<double>(name + "/ranges");
+      if (info.size() != 2 || info[0] < 0 || info[0] >= lasers_.size()) {
+        return false;
+      }
+      auto scan = std::make_unique<nav2_amcl::LaserData>();
+      scan->laser = lasers_[static_cast<std::size_t>(info[0])];
+      scan->range_max = info[1];
+      scan->setRangeCount(static_cast<int>(ranges.size() / 2));
+      std::memcpy(scan->ranges, ranges.data(), ranges.size() / 2 * 2 * sizeof(double));
+      scans_.push_back(std::move(scan));
+    }
+
+    std::vector<double> odometry = snapshot.vector<double>("amcl/odometry");
+    std::vector<double> particles = snapshot.vector<double>("amcl/particles");
+    std::vector<double> filter = snapshot.vector<double>("amcl/filter");
+    if (odometry.size() != 6 || particles.empty() || filter.size() != 2) {
+      return false;
+    }
+    for (int i = 0; i < 3; i++) {
+      pose_.v[i] = odometry[i];
+      delta_.v[i] = odometry[3 + i];
+    }
+    for (std::size_t i = 0; i + 3 < particles.size(); i += 4) {
+      pf_vector_t particle = pf_vector_zero();
+      particle.v[0] = particles[i];
+      particle.v[1] = particles[i + 1];
+      particle.v[2] = particles[i + 2];
+      poses_.push_back(particle);
+      weights_.push_back(particles[i + 3]);
+    }
+    w_slow_ = filter[0];
+    w_fast_ = filter[1];
+    return true;
+  }
+
+  // Put the particles back as they were before the update
+  void restore()
+  {
+    pf_init_samples(pf_, static_cast<int>(poses_.size()), poses_.data(), weights_.data());
+    pf_->w_slow = w_slow_;
+    pf_->w_fast = w_fast_;
+  }
+
+  // Take the steps of the recorded update. The beam count is adapted before each sensor
+  // update, from the particles then
+  void update()
+  {
+    std::size_t step_index = 0, first_scan = 0;
+    std::vector<nav2_amcl::LaserData *> data;
+    for (int32_t step : steps_) {
+      switch (static_cast<UpdateStep>(step)) {
+        case UpdateStep::MOTION:
+          motion_model_->odometryUpdate(pf_, pose_, delta_);
+          break;
+        case UpdateStep::SENSOR:
+        case UpdateStep::FUSED_SENSOR:
+          {
+            const std::size_t count = static_cast<std::size_t>(scan_counts_[step_index++]);
+            adaptBeams();
+            if (static_cast<UpdateStep>(step) == UpdateStep::SENSOR && count == 1) {
+              scans_[first_scan]->laser->sensorUpdate(pf_, scans_[first_scan].get());
+            } else {
+              data.clear();
+              for (std::size_t i = first_scan; i < first_scan + count; i++) {
+                data.push_back(scans_[i].get());
+              }
+              nav2_amcl::Laser::fusedSensorUpdate(pf_, data);
+            }
+            first_scan += count;
+          }
+          break;
+        case UpdateStep::RESAMPLE:
+          pf_update_resample(pf_);
+          break;
+      }
+    }
+  }
+
+  std::size_t particleCount() const {return poses_.size();}
+  std::size_t scanCount() const {return scans_.size();}
+  std::size_t stepCount() const {return steps_.size();}
+  int sampleCount() const {return pf_->sets[pf_->current_set].sample_count;}
+
+protected:
+  std::vector<pf_vector_t> poses_;
+  std::vector<double> weights_;
+  double w_slow_{0.0}, w_fast_{0.0};
+  pf_vector_t pose_, delta_;
+  std::vector<int32_t> steps_, scan_counts_;
+  std::vector<std::unique_ptr<nav2_amcl::LaserData>> scans_;
+};
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  nav2_util::ReplayOptions options;
+  if (!nav2_util::parseReplayOptions(rclcpp::remove_ros_arguments(argc, argv), options)) {
+    return 1;
+  }
+  auto snapshot = nav2_util::Snapshot::load(options.snapshot);
+  if (!snapshot || !snapshot->has("amcl/steps")) {
+    std::fprintf(stderr, "%s is not an AMCL snapshot\n", options.snapshot.c_str());
+    return 1;
+  }
+  if (!options.plugin.empty()) {
+    std::fprintf(stderr, "AMCL has no plugins, --plugin is ignored\n");
+  }
+
+  // The node of the recorded parameters, which it declares itself
+  rclcpp::NodeOptions node_options;
+  node_options.parameter_overrides(nav2_util::readParameters(*snapshot, "amcl/parameters"));
+  auto node = std::make_shared<AmclReplay>(node_options);
+  node->configure();
+  if (!node->load(*snapshot)) {
+    std::fprintf(stderr, "The update of %s is incomplete\n", options.snapshot.c_str());
+    return 1;
+  }
+
+  double recorded_duration = 0.0;
+  snapshot->value("amcl/duration", recorded_duration);
+  std::printf(
+    "Replaying an update of %zu particles in %zu steps weighing %zu scans, recorded in "
+    "%.3f ms\n", node->particleCount(), node->stepCount(), node->scanCount(),
+    recorded_duration * 1e3);
+
+  nav2_util::runReplay(
+    options, "amcl.update", "", [&]() {node->update();}, [&]() {node->restore();});
+  std::printf("Replayed update left %d particles\n", node->sampleCount());
+
+  node->cleanup();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -51,7 +51,20 @@ map_t * map_alloc(void)
   map->scale = 0;
 
   // Allocate storage for main map
-  map->cells = (map_cell_t *) NULL;
+  map->occ_state = (int8_t *) NULL;
+  map->occ_dist = (uint16_t *) NULL;
+  map->occ_dist_step = 0;
+  map->max_occ_dist = 0;
+
+  // The likelihood field is only built on demand
+  map->likelihood = (float *) NULL;
+  map->likelihood_storage = NULL;
+  map->likelihood_z_hit = 0;
+  map->likelihood_sigma_hit = -1;
+
+  // As is the range table
+  map->range_table = (map_range_table_t *) NULL;
+  map->free_space = (map_free_space_t *) NULL;
 
   return map;
 }
@@ -60,25 +73,27 @@ map_t * map_alloc(void)
 // Destroy a map
 void map_free(map_t * map)
 {
-  free(map->cells);
+  free(map->occ_state);
+  free(map->occ_dist);
+  free(map->likelihood_storage);
+  map_update_range_table(map, 0);
+  if (map->free_space) {
+    free(map->free_space->span_i);
+    free(map->free_space->span_j);
+    free(map->free_space->cells_before);
+    free(map->free_space);
+  }
   free(map);
 }
 
 
-// Get the cell at the given point
-map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa)
+// Allocate the occupancy states of a map
+void map_alloc_cells(map_t * map, int size_x, int size_y)
 {
-  (void)oa;
-  int i, j;
-  map_cell_t * cell;
-
-  i = MAP_GXWX(map, ox);
-  j = MAP_GYWY(map, oy);
-
-  if (!MAP_VALID(map, i, j)) {
-    return NULL;
-  }
-
-  cell = map->cells + MAP_INDEX(map, i, j);
-  return cell;
+  free(map->occ_state);
+  free(map->occ_dist);
+  map->size_x = size_x;
+  map->size_y = size_y;
+  map->occ_state = (int8_t *) calloc((size_t) size_x * size_y, sizeof(map->occ_state[0]));
+  map->occ_dist = (uint16_t *) NULL;
 }
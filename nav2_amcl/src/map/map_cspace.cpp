@@ -20,164 +20,261 @@
  */
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <queue>
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include "nav2_amcl/map/map.hpp"
 
-class CellData
+// Run f(first, last) over contiguous blocks of [0, n), one block per hardware thread
+template<typename F>
+static void parallel_blocks(int n, F f)
 {
-public:
-  map_t * map_;
-  unsigned int i_, j_;
-  unsigned int src_i_, src_j_;
-};
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, std::max(1, n / 64));
+  if (num_threads == 1) {
+    f(0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  int block = (n + num_threads - 1) / num_threads;
+  for (int first = block; first < n; first += block) {
+    threads.emplace_back(f, first, std::min(n, first + block));
+  }
+  f(0, std::min(n, block));
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+}
 
-class CachedDistanceMap
+// Squared Euclidean distance transform of one line of samples, as the lower
+// envelope of the parabolas rooted at the samples with a finite f
+// (Felzenszwalb and Huttenlocher). v and z are scratch of n and n + 1 entries
+static void distance_transform_1d(
+  const double * f, int n, double infinity, double * d, int * v, double * z)
 {
-public:
-  CachedDistanceMap(double scale, double max_dist)
-  : distances_(NULL), scale_(scale), max_dist_(max_dist)
-  {
-    cell_radius_ = max_dist / scale;
-    distances_ = new double *[cell_radius_ + 2];
-    for (int i = 0; i <= cell_radius_ + 1; i++) {
-      distances_[i] = new double[cell_radius_ + 2];
-      for (int j = 0; j <= cell_radius_ + 1; j++) {
-        distances_[i][j] = sqrt(i * i + j * j);
-      }
+  int k = -1;
+  for (int q = 0; q < n; q++) {
+    if (f[q] >= infinity) {
+      continue;
     }
-  }
-  ~CachedDistanceMap()
-  {
-    if (distances_) {
-      for (int i = 0; i <= cell_radius_ + 1; i++) {
-        delete[] distances_[i];
+    double s = -HUGE_VAL;
+    while (k >= 0) {
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+      if (s > z[k]) {
+        break;
       }
-      delete[] distances_;
+      k--;
+    }
+    if (k < 0) {
+      s = -HUGE_VAL;
     }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = HUGE_VAL;
   }
-  double ** distances_;
-  double scale_;
-  double max_dist_;
-  int cell_radius_;
-};
 
+  if (k < 0) {
+    std::fill(d, d + n, infinity);
+    return;
+  }
 
-bool operator<(const CellData & a, const CellData & b)
-{
-  return a.map_->cells[MAP_INDEX(
-             a.map_, a.i_,
-             a.j_)].occ_dist > a.map_->cells[MAP_INDEX(b.map_, b.i_, b.j_)].occ_dist;
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    double dq = q - v[k];
+    d[q] = dq * dq + f[v[k]];
+  }
 }
 
-CachedDistanceMap *
-get_distance_map(double scale, double max_dist)
+// Update the cspace distance values
+void map_update_cspace(map_t * map, double max_occ_dist)
 {
-  static CachedDistanceMap * cdm = NULL;
+  // The occupancy states don't change once the map is built, so a map reused for another
+  // sensor model or after a map switch keeps its distances
+  if (map->occ_dist && map->max_occ_dist == max_occ_dist) {
+    return;
+  }
+  map->max_occ_dist = max_occ_dist;
 
-  if (!cdm || (cdm->scale_ != scale) || (cdm->max_dist_ != max_dist)) {
-    if (cdm) {
-      delete cdm;
-    }
-    cdm = new CachedDistanceMap(scale, max_dist);
+  // The likelihood field follows the distances
+  map->likelihood_sigma_hit = -1;
+
+  const int size_x = map->size_x;
+  const int size_y = map->size_y;
+
+  // Distances past the radius are all max_occ_dist, so both passes stop counting there
+  const int cell_radius = static_cast<int>(max_occ_dist / map->scale);
+  const int bound = cell_radius + 1;
+  // Representable as a float, the row distances are stored as floats
+  const double infinity = static_cast<float>(static_cast<double>(bound) * bound * 2 + 1);
+
+  const size_t count = static_cast<size_t>(size_x) * size_y;
+  if (!map->occ_dist) {
+    map->occ_dist = static_cast<uint16_t *>(malloc(count * sizeof(map->occ_dist[0])));
   }
+  map->occ_dist_step = max_occ_dist / MAP_OCC_DIST_MAX;
+  const double cells_to_steps = map->occ_dist_step > 0 ? map->scale / map->occ_dist_step : 0;
+
+  // Pass 1, along the rows: distance to the closest obstacle of the same row
+  std::vector<float> row_dist_sq(count);
+  parallel_blocks(
+    size_y, [&](int first, int last) {
+      for (int j = first; j < last; j++) {
+        const int8_t * occ = map->occ_state + MAP_INDEX(map, 0, j);
+        float * out = &row_dist_sq[MAP_INDEX(map, 0, j)];
+        int dist = bound;
+        for (int i = 0; i < size_x; i++) {
+          dist = occ[i] == +1 ? 0 : std::min(dist + 1, bound);
+          out[i] = static_cast<float>(dist);
+        }
+        dist = bound;
+        for (int i = size_x - 1; i >= 0; i--) {
+          dist = occ[i] == +1 ? 0 : std::min(dist + 1, bound);
+          double d = std::min(static_cast<double>(dist), static_cast<double>(out[i]));
+          out[i] = static_cast<float>(d >= bound ? infinity : d * d);
+        }
+      }
+    });
 
-  return cdm;
+  // Pass 2, along the columns: combine the row distances into the Euclidean
+  // distance to the closest obstacle
+  parallel_blocks(
+    size_x, [&](int first, int last) {
+      std::vector<double> f(size_y), d(size_y), z(size_y + 1);
+      std::vector<int> v(size_y);
+      for (int i = first; i < last; i++) {
+        for (int j = 0; j < size_y; j++) {
+          f[j] = row_dist_sq[MAP_INDEX(map, i, j)];
+        }
+        distance_transform_1d(f.data(), size_y, infinity, d.data(), v.data(), z.data());
+        for (int j = 0; j < size_y; j++) {
+          double distance = sqrt(d[j]);
+          map->occ_dist[MAP_INDEX(map, i, j)] = distance > cell_radius ?
+            MAP_OCC_DIST_MAX : static_cast<uint16_t>(std::min<long>(
+              std::lround(distance * cells_to_steps), MAP_OCC_DIST_MAX));
+        }
+      }
+    });
 }
 
-void enqueue(
-  map_t * map, int i, int j,
-  int src_i, int src_j,
-  std::priority_queue<CellData> & Q,
-  CachedDistanceMap * cdm,
-  unsigned char * marked)
+// Update the likelihood field values
+void map_update_likelihood(map_t * map, double z_hit, double sigma_hit)
 {
-  if (marked[MAP_INDEX(map, i, j)]) {
+  if (map->likelihood && map->likelihood_z_hit == z_hit &&
+    map->likelihood_sigma_hit == sigma_hit)
+  {
     return;
   }
 
-  int di = abs(i - src_i);
-  int dj = abs(j - src_j);
-  double distance = cdm->distances_[di][dj];
+  const size_t line = 64;
+  const size_t count = static_cast<size_t>(map->size_x) * map->size_y;
+  free(map->likelihood_storage);
+  map->likelihood_storage = malloc(count * sizeof(float) + line);
+  map->likelihood = reinterpret_cast<float *>(
+    (reinterpret_cast<uintptr_t>(map->likelihood_storage) + line - 1) & ~(line - 1));
 
-  if (distance > cdm->cell_radius_) {
-    return;
+  const double z_hit_denom = 2 * sigma_hit * sigma_hit;
+  for (size_t k = 0; k < count; k++) {
+    double z = MAP_OCC_DIST(map, k);
+    map->likelihood[k] = static_cast<float>(z_hit * exp(-(z * z) / z_hit_denom));
   }
 
-  map->cells[MAP_INDEX(map, i, j)].occ_dist = distance * map->scale;
-
-  CellData cell;
-  cell.map_ = map;
-  cell.i_ = i;
-  cell.j_ = j;
-  cell.src_i_ = src_i;
-  cell.src_j_ = src_j;
-
-  Q.push(cell);
-
-  marked[MAP_INDEX(map, i, j)] = 1;
+  map->likelihood_z_hit = z_hit;
+  map->likelihood_sigma_hit = sigma_hit;
 }
 
-// Update the cspace distance values
-void map_update_cspace(map_t * map, double max_occ_dist)
+// Build the free space runs. Rows are scanned in parallel blocks twice:
+// first counting their runs, then writing them where the counts say
+void map_update_free_space(map_t * map)
 {
-  unsigned char * marked;
-  std::priority_queue<CellData> Q;
+  const int size_x = map->size_x;
+  const int size_y = map->size_y;
+  auto is_free = [map, size_x](int i, int j) {
+      return map->occ_state[i + j * size_x] == -1;
+    };
 
-  marked = new unsigned char[map->size_x * map->size_y];
-  memset(marked, 0, sizeof(unsigned char) * map->size_x * map->size_y);
+  std::vector<int> row_spans(size_y + 1, 0);
+  parallel_blocks(
+    size_y, [&](int first, int last) {
+      for (int j = first; j < last; j++) {
+        int spans = 0;
+        for (int i = 0; i < size_x; i++) {
+          if (is_free(i, j) && (i == 0 || !is_free(i - 1, j))) {
+            spans++;
+          }
+        }
+        row_spans[j + 1] = spans;
+      }
+    });
+  for (int j = 0; j < size_y; j++) {
+    row_spans[j + 1] += row_spans[j];
+  }
 
-  map->max_occ_dist = max_occ_dist;
+  map_free_space_t * free_space = map->free_space;
+  if (!free_space) {
+    free_space = reinterpret_cast<map_free_space_t *>(malloc(sizeof(map_free_space_t)));
+  } else {
+    free(free_space->span_i);
+    free(free_space->span_j);
+    free(free_space->cells_before);
+  }
+  const int span_count = row_spans[size_y];
+  free_space->span_count = span_count;
+  free_space->span_i = reinterpret_cast<int *>(malloc(sizeof(int) * (span_count + 1)));
+  free_space->span_j = reinterpret_cast<int *>(malloc(sizeof(int) * (span_count + 1)));
+  free_space->cells_before =
+    reinterpret_cast<int64_t *>(malloc(sizeof(int64_t) * (span_count + 1)));
 
-  CachedDistanceMap * cdm = get_distance_map(map->scale, map->max_occ_dist);
-
-  // Enqueue all the obstacle cells
-  CellData cell;
-  cell.map_ = map;
-  for (int i = 0; i < map->size_x; i++) {
-    cell.src_i_ = cell.i_ = i;
-    for (int j = 0; j < map->size_y; j++) {
-      if (map->cells[MAP_INDEX(map, i, j)].occ_state == +1) {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = 0.0;
-        cell.src_j_ = cell.j_ = j;
-        marked[MAP_INDEX(map, i, j)] = 1;
-        Q.push(cell);
-      } else {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = max_occ_dist;
+  // Span lengths go into cells_before first, and are summed up afterwards
+  parallel_blocks(
+    size_y, [&](int first, int last) {
+      for (int j = first; j < last; j++) {
+        int span = row_spans[j];
+        for (int i = 0; i < size_x; i++) {
+          if (!is_free(i, j)) {
+            continue;
+          }
+          if (i == 0 || !is_free(i - 1, j)) {
+            free_space->span_i[span] = i;
+            free_space->span_j[span] = j;
+            free_space->cells_before[span + 1] = 0;
+            span++;
+          }
+          free_space->cells_before[span]++;
+        }
       }
-    }
+    });
+  free_space->cells_before[0] = 0;
+  for (int k = 0; k < span_count; k++) {
+    free_space->cells_before[k + 1] += free_space->cells_before[k];
   }
 
-  while (!Q.empty()) {
-    CellData current_cell = Q.top();
-    if (current_cell.i_ > 0) {
-      enqueue(
-        map, current_cell.i_ - 1, current_cell.j_,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-    if (current_cell.j_ > 0) {
-      enqueue(
-        map, current_cell.i_, current_cell.j_ - 1,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-    if (static_cast<int>(current_cell.i_) < map->size_x - 1) {
-      enqueue(
-        map, current_cell.i_ + 1, current_cell.j_,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-    if (static_cast<int>(current_cell.j_) < map->size_y - 1) {
-      enqueue(
-        map, current_cell.i_, current_cell.j_ + 1,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
+  map->free_space = free_space;
+}
 
-    Q.pop();
+// Draw a free cell from the free space runs
+int map_sample_free(map_t * map, double u, int * i, int * j)
+{
+  const map_free_space_t * free_space = map->free_space;
+  if (!free_space || free_space->cells_before[free_space->span_count] == 0) {
+    return 0;
   }
 
-  delete[] marked;
+  const int64_t total = free_space->cells_before[free_space->span_count];
+  const int64_t cell = std::min(total - 1, static_cast<int64_t>(u * total));
+
+  // Last run starting at or before the cell
+  const int64_t * runs = free_space->cells_before;
+  int k = static_cast<int>(
+    std::upper_bound(runs, runs + free_space->span_count + 1, cell) - runs) - 1;
+  *i = free_space->span_i[k] + static_cast<int>(cell - runs[k]);
+  *j = free_space->span_j[k];
+  return 1;
 }
@@ -32,11 +32,17 @@
 
 #include "nav2_amcl/map/map.hpp"
 
+static double map_table_range(map_t * map, double ox, double oy, double oa, double max_range);
+
 // Extract a single range reading from the map.  Unknown cells and/or
 // out-of-bound cells are treated as occupied, which makes it easy to
 // use Stage bitmap files.
 double map_calc_range(map_t * map, double ox, double oy, double oa, double max_range)
 {
+  if (map->range_table) {
+    return map_table_range(map, ox, oy, oa, max_range);
+  }
+
   // Bresenham raytracing
   int x0, x1, y0, y1;
   int x, y;
@@ -87,11 +93,11 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
   }
 
   if (steep) {
-    if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+    if (!MAP_VALID(map, y, x) || map->occ_state[MAP_INDEX(map, y, x)] > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   } else {
-    if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+    if (!MAP_VALID(map, x, y) || map->occ_state[MAP_INDEX(map, x, y)] > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   }
@@ -105,14 +111,252 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
     }
 
     if (steep) {
-      if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+      if (!MAP_VALID(map, y, x) || map->occ_state[MAP_INDEX(map, y, x)] > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     } else {
-      if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+      if (!MAP_VALID(map, x, y) || map->occ_state[MAP_INDEX(map, x, y)] > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     }
   }
   return max_range;
 }
+
+
+// Blocked cells stop rays, like in map_calc_range
+static int map_blocked(map_t * map, int i, int j)
+{
+  return !MAP_VALID(map, i, j) || map->occ_state[MAP_INDEX(map, i, j)] > -1;
+}
+
+
+static int map_next_to_free(map_t * map, int i, int j)
+{
+  int di, dj;
+  for (dj = -1; dj <= 1; dj++) {
+    for (di = -1; di <= 1; di++) {
+      if (MAP_VALID(map, i + di, j + dj) && !map_blocked(map, i + di, j + dj)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+static int map_compare_along(const void * a, const void * b)
+{
+  float pa = ((const map_range_cell_t *) a)->along;
+  float pb = ((const map_range_cell_t *) b)->along;
+  return (pa > pb) - (pa < pb);
+}
+
+
+// Build the range table with the given number of directions
+void map_update_range_table(map_t * map, int direction_count)
+{
+  map_range_table_t * table = map->range_table;
+  int i, j, k, lane, first_lane, last_lane;
+  int edge_count, edge;
+  int * edges;
+  size_t lane_total, n;
+  size_t * fill;
+  map_range_cell_t * cell;
+  double c, s, half, cs, corner;
+
+  if (table && table->direction_count == direction_count) {
+    return;
+  }
+  if (table) {
+    free(table->direction_cos);
+    free(table->direction_sin);
+    free(table->lane_origin);
+    free(table->lane_start);
+    free(table->cells);
+    free(table);
+    map->range_table = NULL;
+  }
+  if (direction_count <= 0) {
+    return;
+  }
+
+  // A ray leaving a free cell stops at a blocked cell next to free space, so
+  // only those are kept; the inside of walls and unknown space never is
+  edges = (int *) malloc(2 * sizeof(int) * map->size_x * map->size_y);
+  edge_count = 0;
+  for (j = 0; j < map->size_y; j++) {
+    for (i = 0; i < map->size_x; i++) {
+      if (map_blocked(map, i, j) && map_next_to_free(map, i, j)) {
+        edges[2 * edge_count] = i;
+        edges[2 * edge_count + 1] = j;
+        edge_count++;
+      }
+    }
+  }
+
+  table = (map_range_table_t *) malloc(sizeof(map_range_table_t));
+  table->direction_count = direction_count;
+  table->direction_cos = (double *) malloc(sizeof(double) * direction_count);
+  table->direction_sin = (double *) malloc(sizeof(double) * direction_count);
+  table->lane_origin = (double *) malloc(sizeof(double) * direction_count);
+  table->lane_count = (int) ceil(hypot(map->size_x, map->size_y)) + 2;
+  lane_total = (size_t) direction_count * table->lane_count;
+  table->lane_start = (size_t *) calloc(lane_total + 1, sizeof(size_t));
+
+  // Lanes are counted first, then filled. Lane l of direction k covers the
+  // across coordinates [origin + l, origin + l + 1). Like Bresenham, a ray
+  // hits a cell when it passes within half a cell of its center along the
+  // minor axis; a cell goes into every lane that band overlaps
+  for (k = 0; k < direction_count; k++) {
+    c = cos(M_PI * k / direction_count);
+    s = sin(M_PI * k / direction_count);
+    table->direction_cos[k] = c;
+    table->direction_sin[k] = s;
+    table->lane_origin[k] = INFINITY;
+    for (j = 0; j < 2; j++) {
+      for (i = 0; i < 2; i++) {
+        corner = -(i * map->size_x - 0.5) * s + (j * map->size_y - 0.5) * c;
+        if (corner < table->lane_origin[k]) {
+          table->lane_origin[k] = corner;
+        }
+      }
+    }
+    half = 0.5 * fmax(fabs(c), fabs(s));
+    for (edge = 0; edge < edge_count; edge++) {
+      cs = -edges[2 * edge] * s + edges[2 * edge + 1] * c - table->lane_origin[k];
+      first_lane = (int) floor(cs - half);
+      last_lane = (int) floor(cs + half);
+      for (lane = first_lane; lane <= last_lane; lane++) {
+        if (lane >= 0 && lane < table->lane_count) {
+          table->lane_start[(size_t) k * table->lane_count + lane + 1]++;
+        }
+      }
+    }
+  }
+  for (n = 0; n < lane_total; n++) {
+    table->lane_start[n + 1] += table->lane_start[n];
+  }
+
+  table->cells = (map_range_cell_t *) malloc(
+    sizeof(map_range_cell_t) * (table->lane_start[lane_total] + 1));
+  fill = (size_t *) malloc(sizeof(size_t) * lane_total);
+  memcpy(fill, table->lane_start, sizeof(size_t) * lane_total);
+  for (k = 0; k < direction_count; k++) {
+    c = table->direction_cos[k];
+    s = table->direction_sin[k];
+    half = 0.5 * fmax(fabs(c), fabs(s));
+    for (edge = 0; edge < edge_count; edge++) {
+      i = edges[2 * edge];
+      j = edges[2 * edge + 1];
+      cs = -i * s + j * c - table->lane_origin[k];
+      first_lane = (int) floor(cs - half);
+      last_lane = (int) floor(cs + half);
+      for (lane = first_lane; lane <= last_lane; lane++) {
+        if (lane >= 0 && lane < table->lane_count) {
+          cell = table->cells + fill[(size_t) k * table->lane_count + lane]++;
+          cell->along = (float) (i * c + j * s);
+          cell->across = (float) cs;
+        }
+      }
+    }
+  }
+  for (n = 0; n < lane_total; n++) {
+    if (table->lane_start[n + 1] - table->lane_start[n] > 1) {
+      qsort(
+        table->cells + table->lane_start[n], table->lane_start[n + 1] - table->lane_start[n],
+        sizeof(map_range_cell_t), map_compare_along);
+    }
+  }
+
+  free(fill);
+  free(edges);
+  map->range_table = table;
+}
+
+
+// Extract a single range reading from the range table. The ray's direction
+// is rounded to the nearest one of the table
+static double map_table_range(map_t * map, double ox, double oy, double oa, double max_range)
+{
+  const map_range_table_t * table = map->range_table;
+  const map_range_cell_t * cells;
+  int k, lane, backward;
+  size_t first, last, mid, n;
+  double a, gx, gy, c, s, half, along, across, dist, exit_x, exit_y;
+
+  if (map_blocked(map, MAP_GXWX(map, ox), MAP_GYWY(map, oy))) {
+    return 0.0;
+  }
+
+  // Pick the direction, and whether the ray runs against it
+  a = fmod(oa, 2 * M_PI);
+  if (a < 0) {
+    a += 2 * M_PI;
+  }
+  k = (int) floor(a * table->direction_count / M_PI + 0.5);
+  backward = 0;
+  while (k >= table->direction_count) {
+    k -= table->direction_count;
+    backward = !backward;
+  }
+  c = table->direction_cos[k];
+  s = table->direction_sin[k];
+  half = 0.5 * fmax(fabs(c), fabs(s));
+
+  // Like Bresenham, start from the center of the cell
+  gx = MAP_GXWX(map, ox);
+  gy = MAP_GYWY(map, oy);
+  along = gx * c + gy * s;
+  across = -gx * s + gy * c - table->lane_origin[k];
+  lane = (int) floor(across);
+  if (lane < 0) {
+    lane = 0;
+  } else if (lane >= table->lane_count) {
+    lane = table->lane_count - 1;
+  }
+
+  // Distance to the edge of the map, where the ray leaves it
+  if (backward) {
+    c = -c;
+    s = -s;
+  }
+  exit_x = c > 0 ? (map->size_x - 0.5 - gx) / c : (c < 0 ? (-0.5 - gx) / c : INFINITY);
+  exit_y = s > 0 ? (map->size_y - 0.5 - gy) / s : (s < 0 ? (-0.5 - gy) / s : INFINITY);
+  dist = exit_x < exit_y ? exit_x : exit_y;
+
+  // Find where the start falls in the lane, then step in the direction of
+  // the ray to the first cell it passes close enough to. Cells the lane only
+  // grazes are rare, so this is almost always the next one
+  cells = table->cells + table->lane_start[(size_t) k * table->lane_count + lane];
+  first = 0;
+  last = table->lane_start[(size_t) k * table->lane_count + lane + 1] -
+    table->lane_start[(size_t) k * table->lane_count + lane];
+  n = last;
+  while (first < last) {
+    mid = first + (last - first) / 2;
+    if (cells[mid].along <= along) {
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  if (!backward) {
+    for (; first < n && cells[first].along - along < dist; first++) {
+      if (fabs(cells[first].across - across) <= half) {
+        dist = cells[first].along - along;
+        break;
+      }
+    }
+  } else {
+    for (; first > 0 && along - cells[first - 1].along < dist; first--) {
+      if (fabs(cells[first - 1].across - across) <= half) {
+        dist = along - cells[first - 1].along;
+        break;
+      }
+    }
+  }
+
+  dist *= map->scale;
+  return dist < max_range ? dist : max_range;
+}
@@ -53,7 +53,6 @@ DifferentialMotionModel::odometryUpdate(
 
   // Implement sample_motion_odometry (Prob Rob p 136)
   double delta_rot1, delta_trans, delta_rot2;
-  double delta_rot1_hat, delta_trans_hat, delta_rot2_hat;
   double delta_rot1_noise, delta_rot2_noise;
 
   // Avoid computing a bearing from two poses that are extremely near each
@@ -83,36 +82,40 @@ DifferentialMotionModel::odometryUpdate(
     fabs(angleutils::angle_diff(delta_rot2, 0.0)),
     fabs(angleutils::angle_diff(delta_rot2, M_PI)));
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
+  const double rot1_stddev = sqrt(
+    alpha1_ * delta_rot1_noise * delta_rot1_noise +
+    alpha2_ * delta_trans * delta_trans);
+  const double trans_stddev = sqrt(
+    alpha3_ * delta_trans * delta_trans +
+    alpha4_ * delta_rot1_noise * delta_rot1_noise +
+    alpha4_ * delta_rot2_noise * delta_rot2_noise);
+  const double rot2_stddev = sqrt(
+    alpha1_ * delta_rot2_noise * delta_rot2_noise +
+    alpha2_ * delta_trans * delta_trans);
 
-    // Sample pose differences
-    delta_rot1_hat = angleutils::angle_diff(
-      delta_rot1,
-      pf_ran_gaussian(
-        sqrt(
-          alpha1_ * delta_rot1_noise * delta_rot1_noise +
-          alpha2_ * delta_trans * delta_trans)));
-    delta_trans_hat = delta_trans -
-      pf_ran_gaussian(
-      sqrt(
-        alpha3_ * delta_trans * delta_trans +
-        alpha4_ * delta_rot1_noise * delta_rot1_noise +
-        alpha4_ * delta_rot2_noise * delta_rot2_noise));
-    delta_rot2_hat = angleutils::angle_diff(
-      delta_rot2,
-      pf_ran_gaussian(
-        sqrt(
-          alpha1_ * delta_rot2_noise * delta_rot2_noise +
-          alpha2_ * delta_trans * delta_trans)));
+  // The noise of a range of samples is drawn in bulk, then applied in one pass
+  updateSamples(
+    set, [&](pf_sample_batch_t & batch, GaussianSampler & noise) {
+      double rot1_noise[SAMPLES_PER_RANGE];
+      double trans_noise[SAMPLES_PER_RANGE];
+      double rot2_noise[SAMPLES_PER_RANGE];
+      const int count = batch.count;
+      noise.fill(rot1_noise, count, rot1_stddev);
+      noise.fill(trans_noise, count, trans_stddev);
+      noise.fill(rot2_noise, count, rot2_stddev);
 
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += delta_trans_hat *
-      cos(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[1] += delta_trans_hat *
-      sin(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[2] += delta_rot1_hat + delta_rot2_hat;
-  }
+      for (int k = 0; k < count; k++) {
+        // Sample pose differences
+        double delta_rot1_hat = angleutils::angle_diff(delta_rot1, rot1_noise[k]);
+        double delta_trans_hat = delta_trans - trans_noise[k];
+        double delta_rot2_hat = angleutils::angle_diff(delta_rot2, rot2_noise[k]);
+
+        // Apply sampled update to particle pose
+        batch.x[k] += delta_trans_hat * cos(batch.theta[k] + delta_rot1_hat);
+        batch.y[k] += delta_trans_hat * sin(batch.theta[k] + delta_rot1_hat);
+        batch.theta[k] += delta_rot1_hat + delta_rot2_hat;
+      }
+    });
 }
 
 }  // namespace nav2_amcl
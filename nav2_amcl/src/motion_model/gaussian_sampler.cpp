@@ -0,0 +1,166 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_amcl/motion_model/gaussian_sampler.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace nav2_amcl
+{
+
+namespace
+{
+
+// Ziggurat of 128 layers under the standard normal density (Marsaglia and Tsang, 2000),
+// for 32 bit signed draws
+struct Ziggurat
+{
+  static constexpr double R = 3.442619855899;
+  uint32_t k[128];
+  double w[128];
+  double f[128];
+
+  Ziggurat()
+  {
+    const double m1 = 2147483648.0;
+    const double v = 9.91256303526217e-3;
+    double dn = R, tn = R;
+    double q = v / exp(-0.5 * dn * dn);
+
+    k[0] = static_cast<uint32_t>((dn / q) * m1);
+    k[1] = 0;
+    w[0] = q / m1;
+    w[127] = dn / m1;
+    f[0] = 1.0;
+    f[127] = exp(-0.5 * dn * dn);
+    for (int i = 126; i >= 1; i--) {
+      dn = sqrt(-2.0 * log(v / dn + exp(-0.5 * dn * dn)));
+      k[i + 1] = static_cast<uint32_t>((dn / tn) * m1);
+      tn = dn;
+      f[i] = exp(-0.5 * dn * dn);
+      w[i] = dn / m1;
+    }
+  }
+};
+
+const Ziggurat & ziggurat()
+{
+  static const Ziggurat table;
+  return table;
+}
+
+uint64_t splitmix64(uint64_t & x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+}  // namespace
+
+GaussianSampler::GaussianSampler(uint64_t seed)
+{
+  for (uint64_t & s : state_) {
+    s = splitmix64(seed);
+  }
+}
+
+uint64_t
+GaussianSampler::mixSeed(uint64_t a, uint64_t b, uint64_t c)
+{
+  uint64_t x = a;
+  uint64_t h = splitmix64(x);
+  x = h ^ b;
+  h = splitmix64(x);
+  x = h ^ c;
+  return splitmix64(x);
+}
+
+uint64_t
+GaussianSampler::nextBits()
+{
+  // xoshiro256++ (Blackman and Vigna)
+  const uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+  const uint64_t t = state_[1] << 17;
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3] = rotl(state_[3], 45);
+  return result;
+}
+
+double
+GaussianSampler::nextUniform()
+{
+  // (0, 1), never 0 so that it can be passed to log
+  return ((nextBits() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+double
+GaussianSampler::next()
+{
+  const Ziggurat & z = ziggurat();
+  const int64_t hz = static_cast<int32_t>(nextBits() >> 32);
+  const int iz = static_cast<int>(hz & 127);
+  if (static_cast<uint64_t>(std::llabs(hz)) < z.k[iz]) {
+    return hz * z.w[iz];
+  }
+  return nextTail(hz, iz);
+}
+
+double
+GaussianSampler::nextTail(int64_t hz, int iz)
+{
+  const Ziggurat & z = ziggurat();
+  for (;; ) {
+    double x = hz * z.w[iz];
+    if (iz == 0) {
+      // Beyond the base layer, from the exponential tail
+      double y;
+      do {
+        x = -log(nextUniform()) / Ziggurat::R;
+        y = -log(nextUniform());
+      } while (y + y < x * x);
+      return hz > 0 ? Ziggurat::R + x : -Ziggurat::R - x;
+    }
+    // Wedge between the layer and the density
+    if (z.f[iz] + nextUniform() * (z.f[iz - 1] - z.f[iz]) < exp(-0.5 * x * x)) {
+      return x;
+    }
+    hz = static_cast<int32_t>(nextBits() >> 32);
+    iz = static_cast<int>(hz & 127);
+    if (static_cast<uint64_t>(std::llabs(hz)) < z.k[iz]) {
+      return hz * z.w[iz];
+    }
+  }
+}
+
+void
+GaussianSampler::fill(double * out, int count, double sigma)
+{
+  for (int i = 0; i < count; i++) {
+    out[i] = sigma * next();
+  }
+}
+
+}  // namespace nav2_amcl
@@ -16,11 +16,15 @@
 
 #include "nav2_amcl/motion_model/motion_model.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 
 namespace nav2_amcl
 {
 
+const int MotionModel::SAMPLES_PER_RANGE;
+
 MotionModel *
 MotionModel::createMotionModel(
   std::string & type, double alpha1, double alpha2,
@@ -35,4 +39,50 @@ MotionModel::createMotionModel(
   return nullptr;
 }
 
+void
+MotionModel::setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool)
+{
+  pool_ = pool;
+}
+
+void
+MotionModel::setSeed(uint64_t seed)
+{
+  seed_ = seed;
+  update_count_ = 0;
+}
+
+void
+MotionModel::updateSamples(
+  pf_sample_set_t * set,
+  const std::function<void(pf_sample_batch_t &, GaussianSampler &)> & move_range)
+{
+  const int sample_count = set->sample_count;
+  const int num_ranges = (sample_count + SAMPLES_PER_RANGE - 1) / SAMPLES_PER_RANGE;
+  const uint64_t update = update_count_++;
+  auto move = [&](std::size_t k) {
+      GaussianSampler noise(GaussianSampler::mixSeed(seed_, update, k));
+      pf_real_t x[SAMPLES_PER_RANGE], y[SAMPLES_PER_RANGE], theta[SAMPLES_PER_RANGE];
+      pf_real_t weight[SAMPLES_PER_RANGE];
+      int first = k * SAMPLES_PER_RANGE;
+      pf_sample_batch_t batch;
+      batch.count = std::min(sample_count - first, SAMPLES_PER_RANGE);
+      batch.x = x;
+      batch.y = y;
+      batch.theta = theta;
+      batch.weight = weight;
+      pf_sample_set_gather(set, first, &batch);
+      move_range(batch, noise);
+      pf_sample_set_scatter(set, first, &batch);
+    };
+
+  if (pool_ && pool_->size() > 1 && num_ranges > 1) {
+    pool_->parallelFor(num_ranges, move);
+  } else {
+    for (int k = 0; k < num_ranges; k++) {
+      move(k);
+    }
+  }
+}
+
 }  // namespace nav2_amcl
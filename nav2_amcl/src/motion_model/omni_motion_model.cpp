@@ -49,8 +49,7 @@ OmniMotionModel::odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_ve
   set = pf->sets + pf->current_set;
   pf_vector_t old_pose = pf_vector_sub(pose, delta);
 
-  double delta_trans, delta_rot, delta_bearing;
-  double delta_trans_hat, delta_rot_hat, delta_strafe_hat;
+  double delta_trans, delta_rot;
 
   delta_trans = sqrt(
     delta.v[0] * delta.v[0] +
@@ -68,26 +67,39 @@ OmniMotionModel::odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_ve
     alpha4_ * (delta_rot * delta_rot) +
     alpha5_ * (delta_trans * delta_trans) );
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
+  // The same for every sample
+  const double bearing = angleutils::angle_diff(
+    atan2(delta.v[1], delta.v[0]),
+    old_pose.v[2]);
 
-    delta_bearing = angleutils::angle_diff(
-      atan2(delta.v[1], delta.v[0]),
-      old_pose.v[2]) + sample->pose.v[2];
-    double cs_bearing = cos(delta_bearing);
-    double sn_bearing = sin(delta_bearing);
+  // The noise of a range of samples is drawn in bulk, then applied in one pass
+  updateSamples(
+    set, [&](pf_sample_batch_t & batch, GaussianSampler & noise) {
+      double trans_noise[SAMPLES_PER_RANGE];
+      double rot_noise[SAMPLES_PER_RANGE];
+      double strafe_noise[SAMPLES_PER_RANGE];
+      const int count = batch.count;
+      noise.fill(trans_noise, count, trans_hat_stddev);
+      noise.fill(rot_noise, count, rot_hat_stddev);
+      noise.fill(strafe_noise, count, strafe_hat_stddev);
 
-    // Sample pose differences
-    delta_trans_hat = delta_trans + pf_ran_gaussian(trans_hat_stddev);
-    delta_rot_hat = delta_rot + pf_ran_gaussian(rot_hat_stddev);
-    delta_strafe_hat = 0 + pf_ran_gaussian(strafe_hat_stddev);
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += (delta_trans_hat * cs_bearing +
-      delta_strafe_hat * sn_bearing);
-    sample->pose.v[1] += (delta_trans_hat * sn_bearing -
-      delta_strafe_hat * cs_bearing);
-    sample->pose.v[2] += delta_rot_hat;
-  }
+      for (int k = 0; k < count; k++) {
+        double delta_bearing = bearing + batch.theta[k];
+        double cs_bearing = cos(delta_bearing);
+        double sn_bearing = sin(delta_bearing);
+
+        // Sample pose differences
+        double delta_trans_hat = delta_trans + trans_noise[k];
+        double delta_rot_hat = delta_rot + rot_noise[k];
+        double delta_strafe_hat = 0 + strafe_noise[k];
+        // Apply sampled update to particle pose
+        batch.x[k] += (delta_trans_hat * cs_bearing +
+          delta_strafe_hat * sn_bearing);
+        batch.y[k] += (delta_trans_hat * sn_bearing -
+          delta_strafe_hat * cs_bearing);
+        batch.theta[k] += delta_rot_hat;
+      }
+    });
 }
 
 }  // namespace nav2_amcl
@@ -29,19 +29,47 @@
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
-#include "nav2_amcl/pf/pf_kdtree.hpp"
+#include "nav2_amcl/pf/pf_bins.hpp"
 
 #include "portable_utils.h"
 
+// Lazily normalized weights are rescaled once their total leaves
+// [1 / PF_LAZY_TOTAL_MAX, PF_LAZY_TOTAL_MAX], well inside the range of pf_real_t
+#ifdef PF_FLOAT32
+#define PF_LAZY_TOTAL_MAX 1e12
+#else
+#define PF_LAZY_TOTAL_MAX 1e100
+#endif
+
+// Samples of a range of pf_cluster_stats, fixed so that the sums don't depend
+// on the thread count. There are fewer ranges when there are many clusters,
+// to keep the per range sums within PF_STATS_MAX_SUMS clusters
+#define PF_STATS_RANGE_SIZE 256
+#define PF_STATS_MAX_SUMS 4096
+
+// Sums of a cluster over a range: count, weight, weighted x, y, cos(theta),
+// sin(theta), x * x, x * y and y * y
+#define PF_STATS_SUM_SIZE 9
+
+// Samples of a range of the parallel systematic resampling, which only runs
+// on sets of at least two ranges
+#define PF_RESAMPLE_RANGE_SIZE 4096
+
 
 // Compute the required number of samples, given that there are k bins
 // with samples in them.
 static int pf_resample_limit(pf_t * pf, int k);
 
+// Re-compute the cluster statistics of a set with the weights divided by
+// divisor, storing the divided weights if normalize is set
+static void pf_cluster_stats_scaled(
+  pf_t * pf, pf_sample_set_t * set, double divisor, int normalize);
+
 
 // Create a new filter
 pf_t * pf_alloc(
@@ -73,12 +101,29 @@ pf_t * pf_alloc(
   pf->pop_z = 3;
   pf->dist_threshold = 0.5;
 
+  pf->resample_method = PF_RESAMPLE_MULTINOMIAL;
+  pf->lazy_normalization = 0;
+  pf->alias_prob = calloc(max_samples, sizeof(double));
+  pf->alias_index = calloc(max_samples, sizeof(int));
+  pf->alias_work = calloc(max_samples, sizeof(int));
+  pf->parallel_fn = NULL;
+  pf->parallel_data = NULL;
+  // A single range needs the sums of as many clusters as there are samples
+  pf->cluster_sums_size = max_samples > PF_STATS_MAX_SUMS ? max_samples : PF_STATS_MAX_SUMS;
+  pf->cluster_sums = calloc(
+    (size_t)pf->cluster_sums_size * PF_STATS_SUM_SIZE, sizeof(double));
+  i = (max_samples + PF_RESAMPLE_RANGE_SIZE - 1) / PF_RESAMPLE_RANGE_SIZE + 1;
+  pf->resample_sums = calloc(i, sizeof(double));
+  pf->resample_first = calloc(i, sizeof(int));
+
   pf->current_set = 0;
   for (j = 0; j < 2; j++) {
     set = pf->sets + j;
 
     set->sample_count = max_samples;
     set->samples = calloc(max_samples, sizeof(pf_sample_t));
+    set->log_scale = 0.0;
+    set->total_weight = 1.0;
 
     for (i = 0; i < set->sample_count; i++) {
       sample = set->samples + i;
@@ -88,8 +133,8 @@ pf_t * pf_alloc(
       sample->weight = 1.0 / max_samples;
     }
 
-    // HACK: is 3 times max_samples enough?
-    set->kdtree = pf_kdtree_alloc(3 * max_samples);
+    // There are never more occupied bins than samples
+    set->bins = pf_bins_alloc(max_samples);
 
     set->cluster_count = 0;
     set->cluster_max_count = max_samples;
@@ -118,9 +163,15 @@ void pf_free(pf_t * pf)
 
   for (i = 0; i < 2; i++) {
     free(pf->sets[i].clusters);
-    pf_kdtree_free(pf->sets[i].kdtree);
+    pf_bins_free(pf->sets[i].bins);
     free(pf->sets[i].samples);
   }
+  free(pf->alias_prob);
+  free(pf->alias_index);
+  free(pf->alias_work);
+  free(pf->cluster_sums);
+  free(pf->resample_sums);
+  free(pf->resample_first);
   free(pf);
 }
 
@@ -134,8 +185,8 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
 
   set = pf->sets + pf->current_set;
 
-  // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set->kdtree);
+  // Create the histogram for adaptive sampling
+  pf_bins_clear(set->bins);
 
   set->sample_count = pf->max_samples;
 
@@ -148,8 +199,9 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
     sample->pose = pf_pdf_gaussian_sample(pdf);
 
     // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    pf_bins_insert(set->bins, sample->pose, sample->weight);
   }
+  set->total_weight = 1.0;
 
   pf->w_slow = pf->w_fast = 0.0;
 
@@ -172,8 +224,8 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
 
   set = pf->sets + pf->current_set;
 
-  // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set->kdtree);
+  // Create the histogram for adaptive sampling
+  pf_bins_clear(set->bins);
 
   set->sample_count = pf->max_samples;
 
@@ -184,8 +236,9 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
     sample->pose = (*init_fn)(init_data);
 
     // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    pf_bins_insert(set->bins, sample->pose, sample->weight);
   }
+  set->total_weight = 1.0;
 
   pf->w_slow = pf->w_fast = 0.0;
 
@@ -196,6 +249,43 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
   pf_init_converged(pf);
 }
 
+// Initialize the filter with given samples, e.g. the ones of a snapshot
+void pf_init_samples(
+  pf_t * pf, int sample_count, const pf_vector_t * poses, const double * weights)
+{
+  int i;
+  pf_sample_set_t * set;
+  pf_sample_t * sample;
+
+  set = pf->sets + pf->current_set;
+
+  // Create the histogram for adaptive sampling
+  pf_bins_clear(set->bins);
+
+  if (sample_count > pf->max_samples) {
+    sample_count = pf->max_samples;
+  }
+  set->sample_count = sample_count;
+  set->log_scale = 0.0;
+  set->total_weight = 0.0;
+
+  for (i = 0; i < set->sample_count; i++) {
+    sample = set->samples + i;
+    sample->weight = weights[i];
+    sample->pose = poses[i];
+    set->total_weight += weights[i];
+
+    // Add sample to histogram
+    pf_bins_insert(set->bins, sample->pose, sample->weight);
+  }
+
+  // Re-compute cluster statistics
+  pf_cluster_stats(pf, set);
+
+  // set converged to 0
+  pf_init_converged(pf);
+}
+
 void pf_init_converged(pf_t * pf)
 {
   pf_sample_set_t * set;
@@ -247,29 +337,84 @@ void pf_update_action(pf_t * pf, pf_action_model_fn_t action_fn, void * action_d
   (*action_fn)(action_data, set);
 }
 
+// Copy a range of samples into a batch
+void pf_sample_set_gather(const pf_sample_set_t * set, int first, pf_sample_batch_t * batch)
+{
+  int i;
+  const pf_sample_t * sample;
+
+  assert(first >= 0 && first + batch->count <= set->sample_count);
+
+  for (i = 0; i < batch->count; i++) {
+    sample = set->samples + first + i;
+    batch->x[i] = sample->pose.v[0];
+    batch->y[i] = sample->pose.v[1];
+    batch->theta[i] = sample->pose.v[2];
+    batch->weight[i] = sample->weight;
+  }
+}
+
+// Copy a batch back into its samples
+void pf_sample_set_scatter(pf_sample_set_t * set, int first, const pf_sample_batch_t * batch)
+{
+  int i;
+  pf_sample_t * sample;
+
+  assert(first >= 0 && first + batch->count <= set->sample_count);
+
+  for (i = 0; i < batch->count; i++) {
+    sample = set->samples + first + i;
+    sample->pose.v[0] = batch->x[i];
+    sample->pose.v[1] = batch->y[i];
+    sample->pose.v[2] = batch->theta[i];
+    sample->weight = batch->weight[i];
+  }
+}
+
 // Update the filter with some new sensor observation
 void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_data)
+{
+  pf_update_sensors(pf, 1, &sensor_fn, &sensor_data);
+}
+
+
+// Update the filter with several observations taken at the same time
+void pf_update_sensors(
+  pf_t * pf, int sensor_count, pf_sensor_model_fn_t * sensor_fns, void ** sensor_data)
 {
   int i;
   pf_sample_set_t * set;
   pf_sample_t * sample;
-  double total;
+  double total, w_avg;
 
   set = pf->sets + pf->current_set;
 
-  // Compute the sample weights
-  total = (*sensor_fn)(sensor_data, set);
+  // Compute the sample weights. Each model multiplies its likelihood into
+  // the weights, so the last total is the one of the joint likelihood
+  total = 0.0;
+  set->log_scale = 0.0;
+  for (i = 0; i < sensor_count; i++) {
+    total = (*sensor_fns[i])(sensor_data[i], set);
+  }
 
   if (total > 0.0) {
-    // Normalize weights
-    double w_avg = 0.0;
-    for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      w_avg += sample->weight;
-      sample->weight /= total;
+    // Average likelihood of the samples, the weights summed to total_weight
+    // before the update
+    w_avg = total / set->total_weight / set->sample_count * exp(set->log_scale);
+
+    // Normalize weights, unless they are normalized lazily and still in range
+    if (!pf->lazy_normalization ||
+      total > PF_LAZY_TOTAL_MAX || total < 1.0 / PF_LAZY_TOTAL_MAX)
+    {
+      for (i = 0; i < set->sample_count; i++) {
+        sample = set->samples + i;
+        sample->weight /= total;
+      }
+      total = 1.0;
     }
+    set->total_weight = total;
+
     // Update running averages of likelihood of samples (Prob Rob p258)
-    w_avg /= set->sample_count;
     if (pf->w_slow == 0.0) {
       pf->w_slow = w_avg;
     } else {
@@ -286,6 +431,186 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
       sample = set->samples + i;
       sample->weight = 1.0 / set->sample_count;
     }
+    set->total_weight = 1.0;
+  }
+}
+
+
+// Build the alias table of a sample set's weights (Vose's method), O(n)
+static void pf_build_alias_table(pf_t * pf, pf_sample_set_t * set, double total)
+{
+  int i, s, l;
+  int n = set->sample_count;
+  int small = 0, large = n;
+  double * prob = pf->alias_prob;
+  int * alias = pf->alias_index;
+  int * work = pf->alias_work;
+
+  // Underfull columns are stacked from the front of the workspace, overfull ones from the back
+  for (i = 0; i < n; i++) {
+    prob[i] = set->samples[i].weight * n / total;
+    alias[i] = i;
+    if (prob[i] < 1.0) {
+      work[small++] = i;
+    } else {
+      work[--large] = i;
+    }
+  }
+
+  // Top up each underfull column from an overfull one
+  while (small > 0 && large < n) {
+    s = work[--small];
+    l = work[large];
+    alias[s] = l;
+    prob[l] -= 1.0 - prob[s];
+    if (prob[l] < 1.0) {
+      large++;
+      work[small++] = l;
+    }
+  }
+
+  // Whatever is left is full, up to rounding
+  while (small > 0) {
+    prob[work[--small]] = 1.0;
+  }
+  while (large < n) {
+    prob[work[large++]] = 1.0;
+  }
+}
+
+
+// Draw a sample index from the alias table, O(1)
+static int pf_draw_alias(pf_t * pf, int n)
+{
+  double u = drand48() * n;
+  int i = (int) u;
+  if (i >= n) {
+    i = n - 1;
+  }
+  return (u - i < pf->alias_prob[i]) ? i : pf->alias_index[i];
+}
+
+
+// A range of samples of the parallel systematic resampling
+typedef struct
+{
+  const pf_sample_set_t * set_a;
+  pf_sample_set_t * set_b;
+  double * sums;
+  const int * first;
+  double start, step;
+} pf_resample_task_t;
+
+// Sum the weights of a range of samples
+static void pf_resample_sum_range(void * task_data, int range)
+{
+  pf_resample_task_t * task = task_data;
+  const pf_sample_set_t * set = task->set_a;
+  int i, last;
+  double sum = 0.0;
+
+  last = (range + 1) * PF_RESAMPLE_RANGE_SIZE;
+  if (last > set->sample_count) {
+    last = set->sample_count;
+  }
+  for (i = range * PF_RESAMPLE_RANGE_SIZE; i < last; i++) {
+    sum += set->samples[i].weight;
+  }
+  task->sums[range] = sum;
+}
+
+// Draw the samples whose comb teeth fall within the weight of a range, sums
+// holding the weight before it
+static void pf_resample_draw_range(void * task_data, int range)
+{
+  pf_resample_task_t * task = task_data;
+  const pf_sample_set_t * set_a = task->set_a;
+  pf_sample_t * sample_b;
+  int i, k, last;
+  double cumulative, target;
+
+  i = range * PF_RESAMPLE_RANGE_SIZE;
+  last = i + PF_RESAMPLE_RANGE_SIZE;
+  if (last > set_a->sample_count) {
+    last = set_a->sample_count;
+  }
+  cumulative = task->sums[range] + set_a->samples[i].weight;
+
+  for (k = task->first[range]; k < task->first[range + 1]; k++) {
+    target = task->start + k * task->step;
+    while ((target > cumulative || set_a->samples[i].weight <= 0) && i < last - 1) {
+      i++;
+      cumulative += set_a->samples[i].weight;
+    }
+    sample_b = task->set_b->samples + k;
+    sample_b->pose = set_a->samples[i].pose;
+    sample_b->weight = 1.0;
+  }
+}
+
+// Systematic resampling of count samples from set a into set b, over ranges of
+// samples in parallel: the weight before every range is a prefix sum of the
+// range weights, which tells which teeth of the comb fall in each range. The
+// random samples and the histogram are then filled in turn
+static void pf_resample_systematic_parallel(
+  pf_t * pf, const pf_sample_set_t * set_a, pf_sample_set_t * set_b,
+  int count, double start, double step, double w_diff)
+{
+  pf_resample_task_t task;
+  pf_sample_t * sample_b;
+  int r, k, j, first, range_count;
+  double sum, before;
+
+  range_count = (set_a->sample_count + PF_RESAMPLE_RANGE_SIZE - 1) / PF_RESAMPLE_RANGE_SIZE;
+  task.set_a = set_a;
+  task.set_b = set_b;
+  task.sums = pf->resample_sums;
+  task.first = pf->resample_first;
+  task.start = start;
+  task.step = step;
+  (*pf->parallel_fn)(pf->parallel_data, range_count, pf_resample_sum_range, &task);
+
+  // A tooth at t is drawn from the range whose weight ends at or after t, the
+  // last range taking whatever rounding leaves past the end
+  before = 0.0;
+  for (r = 0; r < range_count; r++) {
+    sum = pf->resample_sums[r];
+    pf->resample_sums[r] = before;
+    first = 0;
+    if (r > 0 && before >= task.start) {
+      first = (int) floor((before - task.start) / step) + 1;
+    }
+    if (r > 0 && first < pf->resample_first[r - 1]) {
+      first = pf->resample_first[r - 1];
+    }
+    pf->resample_first[r] = first < count ? first : count;
+    before += sum;
+  }
+  pf->resample_first[range_count] = count;
+
+  set_b->sample_count = count;
+  (*pf->parallel_fn)(pf->parallel_data, range_count, pf_resample_draw_range, &task);
+
+  if (w_diff > 0.0) {
+    for (k = 0; k < count; k++) {
+      if (drand48() < w_diff) {
+        set_b->samples[k].pose = (pf->random_pose_fn)(pf->random_pose_data);
+      }
+    }
+  }
+
+  // Copies of a sample are next to each other, and go into their bin at once
+  for (k = 0; k < count; k = j) {
+    sample_b = set_b->samples + k;
+    for (j = k + 1; j < count; j++) {
+      if (set_b->samples[j].pose.v[0] != sample_b->pose.v[0] ||
+        set_b->samples[j].pose.v[1] != sample_b->pose.v[1] ||
+        set_b->samples[j].pose.v[2] != sample_b->pose.v[2])
+      {
+        break;
+      }
+    }
+    pf_bins_insert(set_b->bins, sample_b->pose, (double) (j - k));
   }
 }
 
@@ -293,32 +618,41 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
 // Resample the distribution
 void pf_update_resample(pf_t * pf)
 {
-  int i;
+  int i, count;
   double total;
   pf_sample_set_t * set_a, * set_b;
   pf_sample_t * sample_a, * sample_b;
 
-  // double r,c,U;
-  // int m;
-  // double count_inv;
-  double * c;
-
   double w_diff;
+  double weight_total;
+  double step, target, cumulative;
 
   set_a = pf->sets + pf->current_set;
   set_b = pf->sets + (pf->current_set + 1) % 2;
 
-  // Build up cumulative probability table for resampling.
-  // TODO(?): Replace this with a more efficient procedure
-  // (e.g., http://www.network-theory.co.uk/docs/gslref/GeneralDiscreteDistributions.html)
-  c = (double *)malloc(sizeof(double) * (set_a->sample_count + 1));
-  c[0] = 0.0;
-  for (i = 0; i < set_a->sample_count; i++) {
-    c[i + 1] = c[i] + set_a->samples[i].weight;
+  // Lazily normalized sets track their total, saving a pass over the samples
+  if (pf->lazy_normalization) {
+    weight_total = set_a->total_weight;
+  } else {
+    weight_total = 0.0;
+    for (i = 0; i < set_a->sample_count; i++) {
+      weight_total += set_a->samples[i].weight;
+    }
   }
 
-  // Create the kd tree for adaptive sampling
-  pf_kdtree_clear(set_b->kdtree);
+  // Systematic resampling needs the sample count up front. It is taken from
+  // the histogram of the current set, which is what KLD sampling measures
+  count = pf->max_samples;
+  step = 0.0;
+  if (pf->resample_method == PF_RESAMPLE_SYSTEMATIC) {
+    count = pf_resample_limit(pf, set_a->bins->bin_count);
+    step = weight_total / count;
+  } else {
+    pf_build_alias_table(pf, set_a, weight_total);
+  }
+
+  // Create the histogram for adaptive sampling
+  pf_bins_clear(set_b->bins);
 
   // Draw samples from set a to create set b.
   total = 0;
@@ -330,56 +664,38 @@ void pf_update_resample(pf_t * pf)
   }
   // printf("w_diff: %9.6f\n", w_diff);
 
-  // Can't (easily) combine low-variance sampler with KLD adaptive
-  // sampling, so we'll take the more traditional route.
-  /*
   // Low-variance resampler, taken from Probabilistic Robotics, p110
-  count_inv = 1.0/set_a->sample_count;
-  r = drand48() * count_inv;
-  c = set_a->samples[0].weight;
+  target = drand48() * step;
+  cumulative = set_a->samples[0].weight;
   i = 0;
-  m = 0;
-  */
-  while (set_b->sample_count < pf->max_samples) {
+
+  // Large sets are resampled over ranges of samples in parallel
+  if (pf->resample_method == PF_RESAMPLE_SYSTEMATIC && pf->parallel_fn != NULL &&
+    set_a->sample_count >= 2 * PF_RESAMPLE_RANGE_SIZE)
+  {
+    pf_resample_systematic_parallel(pf, set_a, set_b, count, target, step, w_diff);
+    total = set_b->sample_count;
+  }
+
+  while (set_b->sample_count < count) {
     sample_b = set_b->samples + set_b->sample_count++;
 
-    if (drand48() < w_diff) {
-      sample_b->pose = (pf->random_pose_fn)(pf->random_pose_data);
-    } else {
-      // Can't (easily) combine low-variance sampler with KLD adaptive
-      // sampling, so we'll take the more traditional route.
-      /*
-      // Low-variance resampler, taken from Probabilistic Robotics, p110
-      U = r + m * count_inv;
-      while(U>c)
+    if (pf->resample_method == PF_RESAMPLE_SYSTEMATIC) {
+      // Every sample advances the comb, random ones included
+      while ((target > cumulative || set_a->samples[i].weight <= 0) &&
+        i < set_a->sample_count - 1)
       {
         i++;
-        // Handle wrap-around by resetting counters and picking a new random
-        // number
-        if(i >= set_a->sample_count)
-        {
-          r = drand48() * count_inv;
-          c = set_a->samples[0].weight;
-          i = 0;
-          m = 0;
-          U = r + m * count_inv;
-          continue;
-        }
-        c += set_a->samples[i].weight;
+        cumulative += set_a->samples[i].weight;
       }
-      m++;
-      */
-
-      // Naive discrete event sampler
-      double r;
-      r = drand48();
-      for (i = 0; i < set_a->sample_count; i++) {
-        if ((c[i] <= r) && (r < c[i + 1])) {
-          break;
-        }
-      }
-      assert(i < set_a->sample_count);
+      target += step;
+    } else {
+      i = pf_draw_alias(pf, set_a->sample_count);
+    }
 
+    if (drand48() < w_diff) {
+      sample_b->pose = (pf->random_pose_fn)(pf->random_pose_data);
+    } else {
       sample_a = set_a->samples + i;
 
       assert(sample_a->weight > 0);
@@ -392,10 +708,12 @@ void pf_update_resample(pf_t * pf)
     total += sample_b->weight;
 
     // Add sample to histogram
-    pf_kdtree_insert(set_b->kdtree, sample_b->pose, sample_b->weight);
+    pf_bins_insert(set_b->bins, sample_b->pose, sample_b->weight);
 
     // See if we have enough samples yet
-    if (set_b->sample_count > pf_resample_limit(pf, set_b->kdtree->leaf_count)) {
+    if (pf->resample_method == PF_RESAMPLE_MULTINOMIAL &&
+      set_b->sample_count > pf_resample_limit(pf, set_b->bins->bin_count))
+    {
       break;
     }
   }
@@ -407,21 +725,20 @@ void pf_update_resample(pf_t * pf)
 
   // fprintf(stderr, "\n\n");
 
-  // Normalize weights
-  for (i = 0; i < set_b->sample_count; i++) {
-    sample_b = set_b->samples + i;
-    sample_b->weight /= total;
+  // Re-compute cluster statistics. The weights are normalized in the same
+  // pass, lazily normalized sets keep the unit weights
+  if (pf->lazy_normalization) {
+    set_b->total_weight = total;
+    pf_cluster_stats(pf, set_b);
+  } else {
+    pf_cluster_stats_scaled(pf, set_b, total, 1);
+    set_b->total_weight = 1.0;
   }
 
-  // Re-compute cluster statistics
-  pf_cluster_stats(pf, set_b);
-
   // Use the newly created sample set
   pf->current_set = (pf->current_set + 1) % 2;
 
   pf_update_converged(pf);
-
-  free(c);
 }
 
 
@@ -455,43 +772,112 @@ int pf_resample_limit(pf_t * pf, int k)
 
 
 // Re-compute the cluster statistics for a sample set
-void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
+// A range of samples summed by pf_cluster_stats
+typedef struct
+{
+  pf_sample_set_t * set;
+  int cluster_count;
+  int range_size;
+  double divisor;
+  int normalize;
+  double * sums;
+} pf_stats_task_t;
+
+static void pf_cluster_stats_range(void * task_data, int range)
 {
-  (void)pf;
-  int i, j, k, cidx;
+  pf_stats_task_t * task = task_data;
+  pf_sample_set_t * set = task->set;
   pf_sample_t * sample;
+  double * sums, * s;
+  double w, x, y;
+  int i, first, last, cidx;
+
+  sums = task->sums + (size_t)range * task->cluster_count * PF_STATS_SUM_SIZE;
+  memset(sums, 0, (size_t)task->cluster_count * PF_STATS_SUM_SIZE * sizeof(double));
+
+  first = range * task->range_size;
+  last = first + task->range_size;
+  if (last > set->sample_count) {
+    last = set->sample_count;
+  }
+  for (i = first; i < last; i++) {
+    sample = set->samples + i;
+
+    // The statistics are those of the normalized weights
+    w = sample->weight / task->divisor;
+    if (task->normalize) {
+      sample->weight = w;
+    }
+
+    // Get the cluster label for this sample
+    cidx = pf_bins_get_cluster(set->bins, sample->pose);
+    assert(cidx >= 0);
+    if (cidx >= task->cluster_count) {
+      continue;
+    }
+
+    x = sample->pose.v[0];
+    y = sample->pose.v[1];
+    s = sums + (size_t)cidx * PF_STATS_SUM_SIZE;
+    s[0] += 1;
+    s[1] += w;
+    s[2] += w * x;
+    s[3] += w * y;
+    s[4] += w * cos(sample->pose.v[2]);
+    s[5] += w * sin(sample->pose.v[2]);
+    s[6] += w * x * x;
+    s[7] += w * x * y;
+    s[8] += w * y * y;
+  }
+}
+
+void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
+{
+  pf_cluster_stats_scaled(pf, set, set->total_weight, 0);
+}
+
+static void pf_cluster_stats_scaled(
+  pf_t * pf, pf_sample_set_t * set, double divisor, int normalize)
+{
+  int i, j, k, r, range_count, max_ranges;
   pf_cluster_t * cluster;
+  pf_stats_task_t task;
+  const double * s;
 
   // Workspace
   double m[4], c[2][2];
-  size_t count;
   double weight;
 
   // Cluster the samples
-  pf_kdtree_cluster(set->kdtree);
-
-  // Initialize cluster stats
-  set->cluster_count = 0;
-
-  for (i = 0; i < set->cluster_max_count; i++) {
-    cluster = set->clusters + i;
-    cluster->count = 0;
-    cluster->weight = 0;
-    cluster->mean = pf_vector_zero();
-    cluster->cov = pf_matrix_zero();
+  set->cluster_count = pf_bins_cluster(set->bins);
+  if (set->cluster_count > set->cluster_max_count) {
+    set->cluster_count = set->cluster_max_count;
+  }
 
-    for (j = 0; j < 4; j++) {
-      cluster->m[j] = 0.0;
-    }
-    for (j = 0; j < 2; j++) {
-      for (k = 0; k < 2; k++) {
-        cluster->c[j][k] = 0.0;
-      }
+  // Sum every range of samples on its own, in parallel if possible
+  task.set = set;
+  task.cluster_count = set->cluster_count > 0 ? set->cluster_count : 1;
+  task.divisor = divisor;
+  task.normalize = normalize;
+  task.sums = pf->cluster_sums;
+  range_count = (set->sample_count + PF_STATS_RANGE_SIZE - 1) / PF_STATS_RANGE_SIZE;
+  max_ranges = pf->cluster_sums_size / task.cluster_count;
+  if (range_count > max_ranges) {
+    range_count = max_ranges;
+  }
+  if (range_count < 1) {
+    range_count = 1;
+  }
+  task.range_size = (set->sample_count + range_count - 1) / range_count;
+  if (pf->parallel_fn != NULL && range_count > 1) {
+    (*pf->parallel_fn)(pf->parallel_data, range_count, pf_cluster_stats_range, &task);
+  } else {
+    for (r = 0; r < range_count; r++) {
+      pf_cluster_stats_range(&task, r);
     }
   }
 
   // Initialize overall filter stats
-  count = 0;
   weight = 0.0;
   set->mean = pf_vector_zero();
   set->cov = pf_matrix_zero();
@@ -504,53 +890,41 @@ void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
     }
   }
 
-  // Compute cluster stats
-  for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-
-    // printf("%d %f %f %f\n", i, sample->pose.v[0], sample->pose.v[1], sample->pose.v[2]);
-
-    // Get the cluster label for this sample
-    cidx = pf_kdtree_get_cluster(set->kdtree, sample->pose);
-    assert(cidx >= 0);
-    if (cidx >= set->cluster_max_count) {
-      continue;
+  // Add the ranges up in order, and normalize
+  for (i = 0; i < set->cluster_count; i++) {
+    cluster = set->clusters + i;
+    cluster->count = 0;
+    cluster->weight = 0.0;
+    for (j = 0; j < 4; j++) {
+      cluster->m[j] = 0.0;
+    }
+    for (j = 0; j < 2; j++) {
+      for (k = 0; k < 2; k++) {
+        cluster->c[j][k] = 0.0;
+      }
     }
-    if (cidx + 1 > set->cluster_count) {
-      set->cluster_count = cidx + 1;
+    for (r = 0; r < range_count; r++) {
+      s = pf->cluster_sums + ((size_t)r * task.cluster_count + i) * PF_STATS_SUM_SIZE;
+      cluster->count += (int)s[0];
+      cluster->weight += s[1];
+      for (j = 0; j < 4; j++) {
+        cluster->m[j] += s[2 + j];
+      }
+      cluster->c[0][0] += s[6];
+      cluster->c[0][1] += s[7];
+      cluster->c[1][1] += s[8];
     }
+    cluster->c[1][0] = cluster->c[0][1];
 
-    cluster = set->clusters + cidx;
-
-    cluster->count += 1;
-    cluster->weight += sample->weight;
-
-    count += 1;
-    weight += sample->weight;
-
-    // Compute mean
-    cluster->m[0] += sample->weight * sample->pose.v[0];
-    cluster->m[1] += sample->weight * sample->pose.v[1];
-    cluster->m[2] += sample->weight * cos(sample->pose.v[2]);
-    cluster->m[3] += sample->weight * sin(sample->pose.v[2]);
-
-    m[0] += sample->weight * sample->pose.v[0];
-    m[1] += sample->weight * sample->pose.v[1];
-    m[2] += sample->weight * cos(sample->pose.v[2]);
-    m[3] += sample->weight * sin(sample->pose.v[2]);
-
-    // Compute covariance in linear components
+    weight += cluster->weight;
+    for (j = 0; j < 4; j++) {
+      m[j] += cluster->m[j];
+    }
     for (j = 0; j < 2; j++) {
       for (k = 0; k < 2; k++) {
-        cluster->c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
-        c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
+        c[j][k] += cluster->c[j][k];
       }
     }
-  }
-
-  // Normalize
-  for (i = 0; i < set->cluster_count; i++) {
-    cluster = set->clusters + i;
 
     cluster->mean.v[0] = cluster->m[0] / cluster->weight;
     cluster->mean.v[1] = cluster->m[1] / cluster->weight;
@@ -650,3 +1024,23 @@ int pf_get_cluster_stats(
 
   return 1;
 }
+
+
+// Label of the cluster with the largest weight in the current set
+int pf_get_max_weight_cluster(pf_t * pf)
+{
+  int i, best;
+  double max_weight;
+  pf_sample_set_t * set;
+
+  set = pf->sets + pf->current_set;
+  best = -1;
+  max_weight = 0.0;
+  for (i = 0; i < set->cluster_count; i++) {
+    if (set->clusters[i].weight > max_weight) {
+      max_weight = set->clusters[i].weight;
+      best = i;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,215 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "nav2_amcl/pf/pf_bins.hpp"
+
+
+// Discretize a pose into a bin key
+static void pf_bins_key(pf_bins_t * self, pf_vector_t pose, int key[])
+{
+  key[0] = floor(pose.v[0] / self->size[0]);
+  key[1] = floor(pose.v[1] / self->size[1]);
+  key[2] = floor(pose.v[2] / self->size[2]);
+}
+
+
+// First slot to probe for a key
+static int pf_bins_hash(pf_bins_t * self, int key[])
+{
+  unsigned int h = (unsigned int) key[0] * 73856093u;
+  h ^= (unsigned int) key[1] * 19349663u;
+  h ^= (unsigned int) key[2] * 83492791u;
+  return (int) (h & (unsigned int) (self->slot_count - 1));
+}
+
+
+// Find the slot holding a key, or the empty slot where it belongs
+static int pf_bins_find_slot(pf_bins_t * self, int key[])
+{
+  int slot = pf_bins_hash(self, key);
+  while (self->slots[slot] >= 0) {
+    pf_bin_t * bin = self->bins + self->slots[slot];
+    if (bin->key[0] == key[0] && bin->key[1] == key[1] && bin->key[2] == key[2]) {
+      break;
+    }
+    slot = (slot + 1) & (self->slot_count - 1);
+  }
+  return slot;
+}
+
+
+// Find the bin of a key, NULL if it is empty
+static pf_bin_t * pf_bins_find(pf_bins_t * self, int key[])
+{
+  int index = self->slots[pf_bins_find_slot(self, key)];
+  return index < 0 ? NULL : self->bins + index;
+}
+
+
+// Create a histogram
+pf_bins_t * pf_bins_alloc(int max_bins)
+{
+  int i;
+  pf_bins_t * self;
+
+  self = calloc(1, sizeof(pf_bins_t));
+
+  // Same cells as the kd tree
+  self->size[0] = 0.50;
+  self->size[1] = 0.50;
+  self->size[2] = (10 * M_PI / 180);
+
+  // At most half full, so that probe sequences stay short
+  self->slot_count = 1;
+  while (self->slot_count < 2 * max_bins) {
+    self->slot_count *= 2;
+  }
+  self->slots = malloc(self->slot_count * sizeof(int));
+  for (i = 0; i < self->slot_count; i++) {
+    self->slots[i] = -1;
+  }
+
+  self->bin_count = 0;
+  self->bin_max_count = max_bins;
+  self->bins = calloc(max_bins, sizeof(pf_bin_t));
+  self->queue = calloc(max_bins, sizeof(int));
+
+  return self;
+}
+
+
+// Destroy a histogram
+void pf_bins_free(pf_bins_t * self)
+{
+  free(self->queue);
+  free(self->bins);
+  free(self->slots);
+  free(self);
+}
+
+
+// Clear all entries from the histogram
+void pf_bins_clear(pf_bins_t * self)
+{
+  int i;
+
+  // Only the slots in use need resetting
+  for (i = 0; i < self->bin_count; i++) {
+    self->slots[self->bins[i].slot] = -1;
+  }
+  self->bin_count = 0;
+}
+
+
+// Insert a pose into the histogram
+void pf_bins_insert(pf_bins_t * self, pf_vector_t pose, double value)
+{
+  int key[3];
+  int slot;
+  pf_bin_t * bin;
+
+  pf_bins_key(self, pose, key);
+  slot = pf_bins_find_slot(self, key);
+
+  if (self->slots[slot] >= 0) {
+    self->bins[self->slots[slot]].value += value;
+    return;
+  }
+
+  assert(self->bin_count < self->bin_max_count);
+  bin = self->bins + self->bin_count;
+  bin->key[0] = key[0];
+  bin->key[1] = key[1];
+  bin->key[2] = key[2];
+  bin->value = value;
+  bin->cluster = -1;
+  bin->slot = slot;
+  self->slots[slot] = self->bin_count++;
+}
+
+
+// Label the connected components of the occupied bins
+int pf_bins_cluster(pf_bins_t * self)
+{
+  int i, j, head, tail, cluster_count;
+  int nkey[3];
+  pf_bin_t * bin, * nbin;
+
+  for (i = 0; i < self->bin_count; i++) {
+    self->bins[i].cluster = -1;
+  }
+
+  // Breadth first over the 26 neighbours of each bin
+  cluster_count = 0;
+  for (i = 0; i < self->bin_count; i++) {
+    if (self->bins[i].cluster >= 0) {
+      continue;
+    }
+
+    self->bins[i].cluster = cluster_count;
+    head = tail = 0;
+    self->queue[tail++] = i;
+    while (head < tail) {
+      bin = self->bins + self->queue[head++];
+      for (j = 0; j < 3 * 3 * 3; j++) {
+        nkey[0] = bin->key[0] + (j / 9) - 1;
+        nkey[1] = bin->key[1] + ((j % 9) / 3) - 1;
+        nkey[2] = bin->key[2] + ((j % 9) % 3) - 1;
+
+        nbin = pf_bins_find(self, nkey);
+        if (nbin == NULL || nbin->cluster >= 0) {
+          continue;
+        }
+        nbin->cluster = cluster_count;
+        self->queue[tail++] = nbin - self->bins;
+      }
+    }
+    cluster_count++;
+  }
+  return cluster_count;
+}
+
+
+// Determine the probability estimate for the given pose
+double pf_bins_get_prob(pf_bins_t * self, pf_vector_t pose)
+{
+  int key[3];
+  pf_bin_t * bin;
+
+  pf_bins_key(self, pose, key);
+  bin = pf_bins_find(self, key);
+  if (bin == NULL) {
+    return 0.0;
+  }
+  return bin->value;
+}
+
+
+// Determine the cluster label for the given pose
+int pf_bins_get_cluster(pf_bins_t * self, pf_vector_t pose)
+{
+  int key[3];
+  pf_bin_t * bin;
+
+  pf_bins_key(self, pose, key);
+  bin = pf_bins_find(self, key);
+  if (bin == NULL) {
+    return -1;
+  }
+  return bin->cluster;
+}
@@ -30,6 +30,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 
@@ -37,7 +38,7 @@
 
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
-#include "nav2_amcl/pf/pf_kdtree.hpp"
+#include "nav2_amcl/pf/pf_bins.hpp"
 
 // Draw the statistics
 void pf_draw_statistics(pf_t * pf, rtk_fig_t * fig);
@@ -70,15 +71,28 @@ void pf_draw_samples(pf_t * pf, rtk_fig_t * fig, int max_samples)
 }
 
 
-// Draw the hitogram (kd tree)
+// Draw the hitogram
 void pf_draw_hist(pf_t * pf, rtk_fig_t * fig)
 {
+  int i;
+  double ox, oy;
+  char text[64];
   pf_sample_set_t * set;
+  pf_bin_t * bin;
 
   set = pf->sets + pf->current_set;
 
   rtk_fig_color(fig, 0.0, 0.0, 1.0);
-  pf_kdtree_draw(set->kdtree, fig);
+  for (i = 0; i < set->bins->bin_count; i++) {
+    bin = set->bins->bins + i;
+    ox = (bin->key[0] + 0.5) * set->bins->size[0];
+    oy = (bin->key[1] + 0.5) * set->bins->size[1];
+
+    rtk_fig_rectangle(fig, ox, oy, 0.0, set->bins->size[0], set->bins->size[1], 0);
+
+    snprintf(text, sizeof(text), "%d", bin->cluster);
+    rtk_fig_text(fig, ox, oy, 0.0, text);
+  }
 }
 
 
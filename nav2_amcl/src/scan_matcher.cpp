@@ -0,0 +1,253 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_amcl/scan_matcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace nav2_amcl
+{
+
+ScanMatcher::ScanMatcher(
+  const map_t * map, double sigma, int levels, nav2_util::ThreadPool * pool)
+: map_(map), pool_(pool), levels_(std::max(levels, 0))
+{
+  pad_ = (1 << levels_) - 1;
+  width_ = map_->size_x + pad_;
+  height_ = map_->size_y + pad_;
+  pyramid_.resize(levels_ + 1);
+
+  // The padding scores 0, the positions there only see the map through their block
+  std::vector<uint8_t> & scores = pyramid_[0];
+  scores.assign(static_cast<std::size_t>(width_) * height_, 0);
+  const double scale = -0.5 / (sigma * sigma);
+  runTasks(
+    map_->size_y, [&](std::size_t j) {
+      const std::size_t first = j * map_->size_x;
+      uint8_t * row = &scores[(j + pad_) * width_ + pad_];
+      for (int i = 0; i < map_->size_x; i++) {
+        const double d = MAP_OCC_DIST(map_, first + i);
+        row[i] = static_cast<uint8_t>(std::lround(255.0 * std::exp(scale * d * d)));
+      }
+    });
+
+  // Blocks of 2^h are the max of four blocks of 2^(h-1)
+  for (int h = 1; h <= levels_; h++) {
+    const std::vector<uint8_t> & prev = pyramid_[h - 1];
+    std::vector<uint8_t> & level = pyramid_[h];
+    level.assign(prev.size(), 0);
+    const int half = 1 << (h - 1);
+    runTasks(
+      height_, [&](std::size_t j) {
+        const uint8_t * row = &prev[j * width_];
+        const uint8_t * up = j + half < static_cast<std::size_t>(height_) ?
+        &prev[(j + half) * width_] : nullptr;
+        uint8_t * out = &level[j * width_];
+        for (int i = 0; i < width_; i++) {
+          uint8_t v = row[i];
+          if (i + half < width_) {
+            v = std::max(v, row[i + half]);
+          }
+          if (up) {
+            v = std::max(v, up[i]);
+            if (i + half < width_) {
+              v = std::max(v, up[i + half]);
+            }
+          }
+          out[i] = v;
+        }
+      });
+  }
+
+  // Blocks of the top level without a free cell can't hold the robot
+  const int block = 1 << levels_;
+  const int blocks_x = (map_->size_x + block - 1) / block;
+  const int blocks_y = (map_->size_y + block - 1) / block;
+  top_free_.assign(static_cast<std::size_t>(blocks_x) * blocks_y, 0);
+  for (int j = 0; j < map_->size_y; j++) {
+    for (int i = 0; i < map_->size_x; i++) {
+      if (map_->occ_state[MAP_INDEX(map_, i, j)] == -1) {
+        top_free_[(j / block) * blocks_x + i / block] = 1;
+      }
+    }
+  }
+}
+
+bool
+ScanMatcher::match(const std::vector<Point> & points, double min_score, Match & match) const
+{
+  if (points.empty()) {
+    return false;
+  }
+
+  // One step moves the farthest point by about a cell
+  double max_range = 0.0;
+  for (const Point & p : points) {
+    max_range = std::max(max_range, std::hypot(p.x, p.y));
+  }
+  const double resolution = map_->scale;
+  double step = M_PI / 4;
+  if (max_range > resolution) {
+    step = std::min(
+      step, std::acos(1.0 - resolution * resolution / (2.0 * max_range * max_range)));
+  }
+  const int rotations = static_cast<int>(std::ceil(2 * M_PI / step));
+  step = 2 * M_PI / rotations;
+
+  const int count = static_cast<int>(points.size());
+  std::atomic<int> best(
+    static_cast<int>(std::ceil(min_score * 255.0 * count)) - 1);
+  std::vector<Candidate> results(rotations, Candidate{0, 0, -1});
+
+  const int block = 1 << levels_;
+  const int blocks_x = (map_->size_x + block - 1) / block;
+  const int blocks_y = (map_->size_y + block - 1) / block;
+  runTasks(
+    rotations, [&](std::size_t r) {
+      Rotation rotation;
+      rotation.dx.resize(count);
+      rotation.dy.resize(count);
+      const double yaw = -M_PI + r * step;
+      const double c = std::cos(yaw);
+      const double s = std::sin(yaw);
+      for (int k = 0; k < count; k++) {
+        const Point & p = points[k];
+        rotation.dx[k] = static_cast<int>(std::floor((c * p.x - s * p.y) / resolution + 0.5));
+        rotation.dy[k] = static_cast<int>(std::floor((s * p.x + c * p.y) / resolution + 0.5));
+      }
+
+      std::vector<Candidate> candidates;
+      for (int by = 0; by < blocks_y; by++) {
+        for (int bx = 0; bx < blocks_x; bx++) {
+          if (!top_free_[by * blocks_x + bx]) {
+            continue;
+          }
+          const int bound = score(levels_, rotation, bx * block, by * block);
+          if (bound > best.load(std::memory_order_relaxed)) {
+            candidates.push_back(Candidate{bx * block, by * block, bound});
+          }
+        }
+      }
+      std::sort(
+        candidates.begin(), candidates.end(),
+        [](const Candidate & a, const Candidate & b) {return a.score > b.score;});
+      search(levels_, rotation, candidates, best, results[r]);
+    });
+
+  int best_rotation = -1;
+  for (int r = 0; r < rotations; r++) {
+    if (results[r].score >= 0 &&
+      (best_rotation < 0 || results[r].score > results[best_rotation].score))
+    {
+      best_rotation = r;
+    }
+  }
+  if (best_rotation < 0) {
+    return false;
+  }
+
+  const Candidate & found = results[best_rotation];
+  match.x = MAP_WXGX(map_, found.x);
+  match.y = MAP_WYGY(map_, found.y);
+  match.yaw = -M_PI + best_rotation * step;
+  match.score = found.score / (255.0 * count);
+  match.angular_step = step;
+  return true;
+}
+
+int
+ScanMatcher::score(int level, const Rotation & rotation, int x, int y) const
+{
+  const uint8_t * grid = pyramid_[level].data();
+  int sum = 0;
+  for (std::size_t k = 0; k < rotation.dx.size(); k++) {
+    const int i = x + rotation.dx[k] + pad_;
+    const int j = y + rotation.dy[k] + pad_;
+    if (i >= 0 && i < width_ && j >= 0 && j < height_) {
+      sum += grid[j * width_ + i];
+    }
+  }
+  return sum;
+}
+
+void
+ScanMatcher::search(
+  int level, const Rotation & rotation, const std::vector<Candidate> & candidates,
+  std::atomic<int> & best, Candidate & result) const
+{
+  std::vector<Candidate> children;
+  for (const Candidate & candidate : candidates) {
+    int current = best.load(std::memory_order_relaxed);
+    if (candidate.score <= current) {
+      return;  // the rest are bound lower still
+    }
+
+    if (level == 0) {
+      if (!isFree(candidate.x, candidate.y)) {
+        continue;
+      }
+      while (candidate.score > current &&
+        !best.compare_exchange_weak(current, candidate.score, std::memory_order_relaxed))
+      {
+      }
+      if (candidate.score > current) {
+        result = candidate;
+      }
+      continue;
+    }
+
+    const int half = 1 << (level - 1);
+    children.clear();
+    for (int dy = 0; dy <= half; dy += half) {
+      for (int dx = 0; dx <= half; dx += half) {
+        const int x = candidate.x + dx;
+        const int y = candidate.y + dy;
+        if (x >= map_->size_x || y >= map_->size_y) {
+          continue;
+        }
+        const int bound = score(level - 1, rotation, x, y);
+        if (bound > current) {
+          children.push_back(Candidate{x, y, bound});
+        }
+      }
+    }
+    std::sort(
+      children.begin(), children.end(),
+      [](const Candidate & a, const Candidate & b) {return a.score > b.score;});
+    search(level - 1, rotation, children, best, result);
+  }
+}
+
+bool
+ScanMatcher::isFree(int x, int y) const
+{
+  return MAP_VALID(map_, x, y) && map_->occ_state[MAP_INDEX(map_, x, y)] == -1;
+}
+
+void
+ScanMatcher::runTasks(std::size_t count, const std::function<void(std::size_t)> & task) const
+{
+  if (pool_) {
+    pool_->parallelFor(count, task);
+  } else {
+    for (std::size_t i = 0; i < count; i++) {
+      task(i);
+    }
+  }
+}
+
+}  // namespace nav2_amcl
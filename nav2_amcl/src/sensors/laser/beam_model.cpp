@@ -29,7 +29,8 @@ namespace nav2_amcl
 
 BeamModel::BeamModel(
   double z_hit, double z_short, double z_max, double z_rand, double sigma_hit,
-  double lambda_short, double chi_outlier, size_t max_beams, map_t * map)
+  double lambda_short, double chi_outlier, int range_table_directions,
+  size_t max_beams, map_t * map)
 : Laser(max_beams, map)
 {
   z_hit_ = z_hit;
@@ -39,6 +40,9 @@ BeamModel::BeamModel(
   z_max_ = z_max;
   lambda_short_ = lambda_short;
   chi_outlier_ = chi_outlier;
+
+  // Answer the expected ranges from the table rather than ray casting them
+  map_update_range_table(map, range_table_directions);
 }
 
 // Determine the probability for the given pose
@@ -46,74 +50,70 @@ double
 BeamModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 {
   BeamModel * self;
-  int i, j, step;
-  double z, pz;
-  double p;
-  double map_range;
-  double obs_range, obs_bearing;
-  double total_weight;
-  pf_sample_t * sample;
-  pf_vector_t pose;
+  int step;
 
   self = reinterpret_cast<BeamModel *>(data->laser);
 
-  total_weight = 0.0;
-
-  // Compute the sample weights
-  for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
-
-    // Take account of the laser pose relative to the robot
-    pose = pf_vector_coord_add(self->laser_pose_, pose);
-
-    p = 1.0;
-
-    step = (data->range_count - 1) / (self->max_beams_ - 1);
-    for (i = 0; i < data->range_count; i += step) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
-
-      // Compute the range according to the map
-      map_range = map_calc_range(
-        self->map_, pose.v[0], pose.v[1],
-        pose.v[2] + obs_bearing, data->range_max);
-      pz = 0.0;
-
-      // Part 1: good, but noisy, hit
-      z = obs_range - map_range;
-      pz += self->z_hit_ * exp(-(z * z) / (2 * self->sigma_hit_ * self->sigma_hit_));
-
-      // Part 2: short reading from unexpected obstacle (e.g., a person)
-      if (z < 0) {
-        pz += self->z_short_ * self->lambda_short_ * exp(-self->lambda_short_ * obs_range);
-      }
-
-      // Part 3: Failure to detect obstacle, reported as max-range
-      if (obs_range == data->range_max) {
-        pz += self->z_max_ * 1.0;
+  step = (data->range_count - 1) / (self->max_beams_ - 1);
+
+  // Compute the sample weights. Samples are independent, so ranges of them
+  // may be weighed concurrently
+  return self->weighSamples(
+    set->sample_count, [&](int, int first, int last) {
+      double total_weight = 0.0;
+      for (int j = first; j < last; j++) {
+        pf_sample_t * sample = set->samples + j;
+        pf_vector_t pose = sample->pose;
+
+        // Take account of the laser pose relative to the robot
+        pose = pf_vector_coord_add(self->laser_pose_, pose);
+
+        double p = 1.0;
+
+        for (int i = 0; i < data->range_count; i += step) {
+          double obs_range = data->ranges[i][0];
+          double obs_bearing = data->ranges[i][1];
+
+          // Compute the range according to the map
+          double map_range = map_calc_range(
+            self->map_, pose.v[0], pose.v[1],
+            pose.v[2] + obs_bearing, data->range_max);
+          double pz = 0.0;
+
+          // Part 1: good, but noisy, hit
+          double z = obs_range - map_range;
+          pz += self->z_hit_ * exp(-(z * z) / (2 * self->sigma_hit_ * self->sigma_hit_));
+
+          // Part 2: short reading from unexpected obstacle (e.g., a person)
+          if (z < 0) {
+            pz += self->z_short_ * self->lambda_short_ * exp(-self->lambda_short_ * obs_range);
+          }
+
+          // Part 3: Failure to detect obstacle, reported as max-range
+          if (obs_range == data->range_max) {
+            pz += self->z_max_ * 1.0;
+          }
+
+          // Part 4: Random measurements
+          if (obs_range < data->range_max) {
+            pz += self->z_rand_ * 1.0 / data->range_max;
+          }
+
+          // TODO(?): outlier rejection for short readings
+
+          assert(pz <= 1.0);
+          assert(pz >= 0.0);
+          //      p *= pz;
+          // here we have an ad-hoc weighting scheme for combining beam probs
+          // works well, though...
+          p += pz * pz * pz;
+        }
+
+        sample->weight *= p;
+        total_weight += sample->weight;
       }
-
-      // Part 4: Random measurements
-      if (obs_range < data->range_max) {
-        pz += self->z_rand_ * 1.0 / data->range_max;
-      }
-
-      // TODO(?): outlier rejection for short readings
-
-      assert(pz <= 1.0);
-      assert(pz >= 0.0);
-      //      p *= pz;
-      // here we have an ad-hoc weighting scheme for combining beam probs
-      // works well, though...
-      p += pz * pz * pz;
-    }
-
-    sample->weight *= p;
-    total_weight += sample->weight;
-  }
-
-  return total_weight;
+      return total_weight;
+    });
 }
 
 bool
@@ -127,4 +127,10 @@ BeamModel::sensorUpdate(pf_t * pf, LaserData * data)
   return true;
 }
 
+pf_sensor_model_fn_t
+BeamModel::sensorModel() const
+{
+  return (pf_sensor_model_fn_t) sensorFunction;
+}
+
 }  // namespace nav2_amcl
@@ -24,13 +24,20 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
 namespace nav2_amcl
 {
 
+const int Laser::SAMPLES_PER_RANGE;
+
 Laser::Laser(size_t max_beams, map_t * map)
-: max_samples_(0), max_obs_(0), temp_obs_(NULL)
+: min_beam_spacing_(0.0), max_samples_(0), max_obs_(0), temp_obs_(NULL),
+  temp_obs_storage_(NULL)
 {
   max_beams_ = max_beams;
   map_ = map;
@@ -38,29 +45,25 @@ Laser::Laser(size_t max_beams, map_t * map)
 
 Laser::~Laser()
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
-    }
-    delete[] temp_obs_;
-  }
+  delete[] temp_obs_;
+  delete[] temp_obs_storage_;
 }
 
 void
 Laser::reallocTempData(int new_max_samples, int new_max_obs)
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
-    }
-    delete[] temp_obs_;
-  }
+  delete[] temp_obs_;
+  delete[] temp_obs_storage_;
   max_obs_ = new_max_obs;
-  max_samples_ = fmax(max_samples_, new_max_samples);
+  // Grow by at least half again, so that an adaptive particle count creeping up does not
+  // reallocate scan after scan
+  max_samples_ = std::max(new_max_samples, max_samples_ + max_samples_ / 2);
 
-  temp_obs_ = new double *[max_samples_]();
+  // One block, cut into a row per sample
+  temp_obs_storage_ = new double[static_cast<size_t>(max_samples_) * max_obs_]();
+  temp_obs_ = new double *[max_samples_];
   for (int k = 0; k < max_samples_; k++) {
-    temp_obs_[k] = new double[max_obs_]();
+    temp_obs_[k] = temp_obs_storage_ + static_cast<size_t>(k) * max_obs_;
   }
 }
 
@@ -70,4 +73,138 @@ Laser::SetLaserPose(pf_vector_t & laser_pose)
   laser_pose_ = laser_pose;
 }
 
+bool
+Laser::fusedSensorUpdate(pf_t * pf, const std::vector<LaserData *> & data)
+{
+  std::vector<pf_sensor_model_fn_t> sensor_fns;
+  std::vector<void *> sensor_data;
+  for (LaserData * scan : data) {
+    if (scan->laser->max_beams_ < 2) {
+      continue;
+    }
+    sensor_fns.push_back(scan->laser->sensorModel());
+    sensor_data.push_back(scan);
+  }
+  if (sensor_fns.empty()) {
+    return false;
+  }
+  pf_update_sensors(pf, sensor_fns.size(), sensor_fns.data(), sensor_data.data());
+
+  return true;
+}
+
+void
+Laser::setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool)
+{
+  pool_ = pool;
+}
+
+void
+Laser::setMaxBeams(int max_beams)
+{
+  max_beams_ = max_beams;
+}
+
+void
+Laser::setMinBeamSpacing(double spacing)
+{
+  min_beam_spacing_ = spacing;
+}
+
+int
+Laser::sampleRanges(int sample_count)
+{
+  return (sample_count + SAMPLES_PER_RANGE - 1) / SAMPLES_PER_RANGE;
+}
+
+double
+Laser::weighSamples(
+  int sample_count, const std::function<double(int, int, int)> & weigh_range)
+{
+  const int num_ranges = sampleRanges(sample_count);
+  partial_weights_.assign(num_ranges, 0.0);
+  auto weigh = [&](std::size_t k) {
+      int first = k * SAMPLES_PER_RANGE;
+      int last = std::min(sample_count, first + SAMPLES_PER_RANGE);
+      partial_weights_[k] = weigh_range(k, first, last);
+    };
+
+  if (pool_ && pool_->size() > 1 && num_ranges > 1) {
+    pool_->parallelFor(num_ranges, weigh);
+  } else {
+    for (int k = 0; k < num_ranges; k++) {
+      weigh(k);
+    }
+  }
+
+  double total_weight = 0.0;
+  for (double weight : partial_weights_) {
+    total_weight += weight;
+  }
+  return total_weight;
+}
+
+void
+Laser::cacheBeams(LaserData * data, int step)
+{
+  beam_x_.clear();
+  beam_y_.clear();
+  beam_index_.clear();
+  int beam = 0;
+  for (int i = 0; i < data->range_count; i += step, beam++) {
+    double obs_range = data->ranges[i][0];
+    double obs_bearing = data->ranges[i][1];
+
+    // Max range readings and NaNs are not integrated
+    if (obs_range >= data->range_max || obs_range != obs_range) {
+      continue;
+    }
+
+    // Neither are beams ending next to the previous one, they carry little new information
+    double x = obs_range * cos(obs_bearing);
+    double y = obs_range * sin(obs_bearing);
+    if (min_beam_spacing_ > 0.0 && !beam_x_.empty() &&
+      hypot(x - beam_x_.back(), y - beam_y_.back()) < min_beam_spacing_)
+    {
+      continue;
+    }
+
+    beam_x_.push_back(x);
+    beam_y_.push_back(y);
+    beam_index_.push_back(beam);
+  }
+}
+
+void
+Laser::projectBeams(const pf_vector_t & pose, pf_real_t * hit_x, pf_real_t * hit_y) const
+{
+  const pf_real_t c = cos(pose.v[2]);
+  const pf_real_t s = sin(pose.v[2]);
+  const pf_real_t * bx = beam_x_.data();
+  const pf_real_t * by = beam_y_.data();
+  const int n = static_cast<int>(beam_x_.size());
+
+  // Branch free, so that the compiler can vectorize it
+  for (int k = 0; k < n; k++) {
+    hit_x[k] = pose.v[0] + c * bx[k] - s * by[k];
+    hit_y[k] = pose.v[1] + s * bx[k] + c * by[k];
+  }
+}
+
+void
+Laser::reserveHits(int sample_count)
+{
+  // Only grows, resize() keeps the capacity
+  size_t size = static_cast<size_t>(sampleRanges(sample_count)) * 2 * beam_x_.size();
+  if (beam_hits_.size() < size) {
+    beam_hits_.resize(size);
+  }
+}
+
+pf_real_t *
+Laser::rangeHits(int range)
+{
+  return beam_hits_.data() + static_cast<size_t>(range) * 2 * beam_x_.size();
+}
+
 }  // namespace nav2_amcl
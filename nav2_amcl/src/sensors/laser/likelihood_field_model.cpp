@@ -22,6 +22,8 @@
 #include <math.h>
 #include <assert.h>
 
+#include <vector>
+
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
 namespace nav2_amcl
@@ -36,99 +38,103 @@ LikelihoodFieldModel::LikelihoodFieldModel(
   z_rand_ = z_rand;
   sigma_hit_ = sigma_hit;
   map_update_cspace(map, max_occ_dist);
+  map_update_likelihood(map, z_hit_, sigma_hit_);
 }
 
 double
 LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 {
   LikelihoodFieldModel * self;
-  int i, j, step;
-  double z, pz;
-  double p;
-  double obs_range, obs_bearing;
-  double total_weight;
-  pf_sample_t * sample;
-  pf_vector_t pose;
-  pf_vector_t hit;
+  int step;
 
   self = reinterpret_cast<LikelihoodFieldModel *>(data->laser);
 
-  total_weight = 0.0;
-
-  // Compute the sample weights
-  for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
-
-    // Take account of the laser pose relative to the robot
-    pose = pf_vector_coord_add(self->laser_pose_, pose);
-
-    p = 1.0;
-
-    // Pre-compute a couple of things
-    double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
-    double z_rand_mult = 1.0 / data->range_max;
+  // Pre-compute a couple of things
+  double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
+  double z_rand_mult = 1.0 / data->range_max;
 
-    step = (data->range_count - 1) / (self->max_beams_ - 1);
+  step = (data->range_count - 1) / (self->max_beams_ - 1);
 
-    // Step size must be at least 1
-    if (step < 1) {
-      step = 1;
-    }
-
-    for (i = 0; i < data->range_count; i += step) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
-
-      // This model ignores max range readings
-      if (obs_range >= data->range_max) {
-        continue;
-      }
-
-      // Check for NaN
-      if (obs_range != obs_range) {
-        continue;
-      }
-
-      pz = 0.0;
-
-      // Compute the endpoint of the beam
-      hit.v[0] = pose.v[0] + obs_range * cos(pose.v[2] + obs_bearing);
-      hit.v[1] = pose.v[1] + obs_range * sin(pose.v[2] + obs_bearing);
-
-      // Convert to map grid coords.
-      int mi, mj;
-      mi = MAP_GXWX(self->map_, hit.v[0]);
-      mj = MAP_GYWY(self->map_, hit.v[1]);
-
-      // Part 1: Get distance from the hit to closest obstacle.
-      // Off-map penalized as max distance
-      if (!MAP_VALID(self->map_, mi, mj)) {
-        z = self->map_->max_occ_dist;
-      } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
-      }
-      // Gaussian model
-      // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
-      pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
-      // Part 2: random measurements
-      pz += self->z_rand_ * z_rand_mult;
-
-      // TODO(?): outlier rejection for short readings
-
-      assert(pz <= 1.0);
-      assert(pz >= 0.0);
-      //      p *= pz;
-      // here we have an ad-hoc weighting scheme for combining beam probs
-      // works well, though...
-      p += pz * pz * pz;
-    }
-
-    sample->weight *= p;
-    total_weight += sample->weight;
+  // Step size must be at least 1
+  if (step < 1) {
+    step = 1;
   }
 
-  return total_weight;
+  // The beams are rotated by each particle's heading rather than evaluating
+  // a sine and a cosine per particle and beam
+  self->cacheBeams(data, step);
+  const int num_beams = static_cast<int>(self->beam_x_.size());
+
+  // Part 2: random measurements
+  const double rand_pz = self->z_rand_ * z_rand_mult;
+  // Off-map penalized as max distance
+  const double off_map_pz =
+    self->z_hit_ * exp(-(self->map_->max_occ_dist * self->map_->max_occ_dist) / z_hit_denom);
+
+  // Compute the sample weights. Samples are independent, so ranges of them
+  // may be weighed concurrently
+  self->reserveHits(set->sample_count);
+  return self->weighSamples(
+    set->sample_count, [&](int range, int first, int last) {
+      pf_real_t * hit_x = self->rangeHits(range);
+      pf_real_t * hit_y = hit_x + num_beams;
+      pf_real_t x[SAMPLES_PER_RANGE], y[SAMPLES_PER_RANGE], theta[SAMPLES_PER_RANGE];
+      pf_real_t weight[SAMPLES_PER_RANGE];
+      pf_sample_batch_t batch;
+      batch.count = last - first;
+      batch.x = x;
+      batch.y = y;
+      batch.theta = theta;
+      batch.weight = weight;
+      pf_sample_set_gather(set, first, &batch);
+
+      double total_weight = 0.0;
+      for (int j = 0; j < batch.count; j++) {
+        pf_vector_t pose;
+        pose.v[0] = batch.x[j];
+        pose.v[1] = batch.y[j];
+        pose.v[2] = batch.theta[j];
+
+        // Take account of the laser pose relative to the robot
+        pose = pf_vector_coord_add(self->laser_pose_, pose);
+
+        // Compute the endpoints of the beams
+        self->projectBeams(pose, hit_x, hit_y);
+
+        double p = 1.0;
+
+        for (int k = 0; k < num_beams; k++) {
+          // Convert to map grid coords.
+          int mi, mj;
+          mi = MAP_GXWX(self->map_, hit_x[k]);
+          mj = MAP_GYWY(self->map_, hit_y[k]);
+
+          // Part 1: Gaussian model of the distance from the hit to the closest
+          // obstacle, precomputed in the map's likelihood field
+          // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
+          double pz = rand_pz;
+          if (!MAP_VALID(self->map_, mi, mj)) {
+            pz += off_map_pz;
+          } else {
+            pz += self->map_->likelihood[MAP_INDEX(self->map_, mi, mj)];
+          }
+
+          // TODO(?): outlier rejection for short readings
+
+          assert(pz <= 1.0);
+          assert(pz >= 0.0);
+          //      p *= pz;
+          // here we have an ad-hoc weighting scheme for combining beam probs
+          // works well, though...
+          p += pz * pz * pz;
+        }
+
+        batch.weight[j] *= p;
+        total_weight += batch.weight[j];
+      }
+      pf_sample_set_scatter(set, first, &batch);
+      return total_weight;
+    });
 }
 
 
@@ -143,4 +149,10 @@ LikelihoodFieldModel::sensorUpdate(pf_t * pf, LaserData * data)
   return true;
 }
 
+pf_sensor_model_fn_t
+LikelihoodFieldModel::sensorModel() const
+{
+  return (pf_sensor_model_fn_t) sensorFunction;
+}
+
 }  // namespace nav2_amcl
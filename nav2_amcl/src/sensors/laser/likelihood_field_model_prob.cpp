@@ -23,6 +23,11 @@
 #include <math.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
 namespace nav2_amcl
@@ -45,6 +50,7 @@ LikelihoodFieldModelProb::LikelihoodFieldModelProb(
   beam_skip_threshold_ = beam_skip_threshold;
   beam_skip_error_threshold_ = beam_skip_error_threshold;
   map_update_cspace(map, max_occ_dist);
+  map_update_likelihood(map, z_hit_, sigma_hit_);
 }
 
 // Determine the probability for the given pose
@@ -52,19 +58,11 @@ double
 LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set)
 {
   LikelihoodFieldModelProb * self;
-  int i, j, step;
-  double z, pz;
-  double log_p;
-  double obs_range, obs_bearing;
-  double total_weight;
-  pf_sample_t * sample;
-  pf_vector_t pose;
-  pf_vector_t hit;
+  int step;
+  int beam_ind;
 
   self = reinterpret_cast<LikelihoodFieldModelProb *>(data->laser);
 
-  total_weight = 0.0;
-
   step = ceil((data->range_count) / static_cast<double>(self->max_beams_));
 
   // Step size must be at least 1
@@ -91,14 +89,16 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     do_beamskip = false;
   }
 
-  // we need a count the no of particles for which the beam agreed with the map
-  int * obs_count = new int[self->max_beams_]();
+  // we need a count the no of particles for which the beam agreed with the map. Each range
+  // of samples counts into its own row, so that ranges can be weighed concurrently
+  const int num_ranges = do_beamskip ? sampleRanges(set->sample_count) : 0;
+  std::vector<int> & range_obs_count = self->range_obs_count_;
+  range_obs_count.assign(num_ranges * self->max_beams_, 0);
 
   // we also need a mask of which observations to integrate (to decide which beams to integrate to
   // all particles)
-  bool * obs_mask = new bool[self->max_beams_]();
-
-  int beam_ind = 0;
+  std::vector<bool> & obs_mask = self->obs_mask_;
+  obs_mask.assign(self->max_beams_, false);
 
   // realloc indicates if we need to reallocate the temp data structure needed to do beamskipping
   bool realloc = false;
@@ -118,83 +118,83 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     }
   }
 
-  // Compute the sample weights
-  for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
-
-    // Take account of the laser pose relative to the robot
-    pose = pf_vector_coord_add(self->laser_pose_, pose);
-
-    log_p = 0;
-
-    beam_ind = 0;
-
-    for (i = 0; i < data->range_count; i += step, beam_ind++) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
-
-      // This model ignores max range readings
-      if (obs_range >= data->range_max) {
-        continue;
-      }
-
-      // Check for NaN
-      if (obs_range != obs_range) {
-        continue;
-      }
-
-      pz = 0.0;
-
-      // Compute the endpoint of the beam
-      hit.v[0] = pose.v[0] + obs_range * cos(pose.v[2] + obs_bearing);
-      hit.v[1] = pose.v[1] + obs_range * sin(pose.v[2] + obs_bearing);
-
-      // Convert to map grid coords.
-      int mi, mj;
-      mi = MAP_GXWX(self->map_, hit.v[0]);
-      mj = MAP_GYWY(self->map_, hit.v[1]);
-
-      // Part 1: Get distance from the hit to closest obstacle.
-      // Off-map penalized as max distance
-
-      if (!MAP_VALID(self->map_, mi, mj)) {
-        pz += self->z_hit_ * max_dist_prob;
-      } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
-        if (z < beam_skip_distance) {
-          obs_count[beam_ind] += 1;
+  // The beams are rotated by each particle's heading rather than evaluating
+  // a sine and a cosine per particle and beam
+  self->cacheBeams(data, step);
+  const int num_beams = static_cast<int>(self->beam_x_.size());
+
+  // Part 2: random measurements
+  const double rand_pz = self->z_rand_ * z_rand_mult;
+
+  // Compute the sample log likelihoods
+  self->reserveHits(set->sample_count);
+  self->log_p_.resize(set->sample_count);
+  self->weighSamples(
+    set->sample_count, [&](int range, int first, int last) {
+      pf_real_t * hit_x = self->rangeHits(range);
+      pf_real_t * hit_y = hit_x + num_beams;
+      int * obs_count = do_beamskip ? &range_obs_count[range * self->max_beams_] : nullptr;
+      for (int j = first; j < last; j++) {
+        pf_sample_t * sample = set->samples + j;
+        pf_vector_t pose = sample->pose;
+
+        // Take account of the laser pose relative to the robot
+        pose = pf_vector_coord_add(self->laser_pose_, pose);
+
+        // Compute the endpoints of the beams
+        self->projectBeams(pose, hit_x, hit_y);
+
+        double log_p = 0;
+
+        for (int k = 0; k < num_beams; k++) {
+          int beam = self->beam_index_[k];
+
+          // Convert to map grid coords.
+          int mi, mj;
+          mi = MAP_GXWX(self->map_, hit_x[k]);
+          mj = MAP_GYWY(self->map_, hit_y[k]);
+
+          // Part 1: Get distance from the hit to closest obstacle.
+          // Off-map penalized as max distance
+          // Gaussian model
+          // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
+          double pz = 0.0;
+          if (!MAP_VALID(self->map_, mi, mj)) {
+            pz += self->z_hit_ * max_dist_prob;
+          } else {
+            int index = MAP_INDEX(self->map_, mi, mj);
+            // Beam skipping also needs the distance itself
+            if (obs_count && MAP_OCC_DIST(self->map_, index) < beam_skip_distance) {
+              obs_count[beam] += 1;
+            }
+            pz += self->map_->likelihood[index];
+          }
+          pz += rand_pz;
+
+          assert(pz <= 1.0);
+          assert(pz >= 0.0);
+
+          // TODO(?): outlier rejection for short readings
+
+          if (!do_beamskip) {
+            log_p += log(pz);
+          } else {
+            self->temp_obs_[j][beam] = pz;
+          }
         }
-        pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
+        self->log_p_[j] = log_p;
       }
-
-      // Gaussian model
-      // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
-
-      // Part 2: random measurements
-      pz += self->z_rand_ * z_rand_mult;
-
-      assert(pz <= 1.0);
-      assert(pz >= 0.0);
-
-      // TODO(?): outlier rejection for short readings
-
-      if (!do_beamskip) {
-        log_p += log(pz);
-      } else {
-        self->temp_obs_[j][beam_ind] = pz;
-      }
-    }
-    if (!do_beamskip) {
-      sample->weight *= exp(log_p);
-      total_weight += sample->weight;
-    }
-  }
+      return 0.0;
+    });
 
   if (do_beamskip) {
     int skipped_beam_count = 0;
     for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
-      if ((obs_count[beam_ind] / static_cast<double>(set->sample_count)) > beam_skip_threshold) {
+      int obs_count = 0;
+      for (int range = 0; range < num_ranges; range++) {
+        obs_count += range_obs_count[range * self->max_beams_ + beam_ind];
+      }
+      if ((obs_count / static_cast<double>(set->sample_count)) > beam_skip_threshold) {
         obs_mask[beam_ind] = true;
       } else {
         obs_mask[beam_ind] = false;
@@ -217,26 +217,47 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
       error = true;
     }
 
-    for (j = 0; j < set->sample_count; j++) {
-      sample = set->samples + j;
-      pose = sample->pose;
+    self->weighSamples(
+      set->sample_count, [&](int, int first, int last) {
+        for (int j = first; j < last; j++) {
+          double log_p = 0;
 
-      log_p = 0;
+          for (int beam = 0; beam < self->max_beams_; beam++) {
+            if (error || obs_mask[beam]) {
+              log_p += log(self->temp_obs_[j][beam]);
+            }
+          }
 
-      for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
-        if (error || obs_mask[beam_ind]) {
-          log_p += log(self->temp_obs_[j][beam_ind]);
+          self->log_p_[j] = log_p;
         }
-      }
+        return 0.0;
+      });
+  }
 
-      sample->weight *= exp(log_p);
+  return self->applyLogLikelihoods(set);
+}
 
-      total_weight += sample->weight;
-    }
+double
+LikelihoodFieldModelProb::applyLogLikelihoods(pf_sample_set_t * set)
+{
+  // exp() of the sum of tens of beam log likelihoods is out of the range of a
+  // float, and of a double for long scans. The weights are normalized by the
+  // filter, so only the ratios between samples need to be kept
+  double max_log_p = -std::numeric_limits<double>::infinity();
+  for (int j = 0; j < set->sample_count; j++) {
+    max_log_p = std::max(max_log_p, log_p_[j]);
+  }
+  if (!std::isfinite(max_log_p)) {
+    max_log_p = 0.0;
   }
 
-  delete[] obs_count;
-  delete[] obs_mask;
+  double total_weight = 0.0;
+  for (int j = 0; j < set->sample_count; j++) {
+    pf_sample_t * sample = set->samples + j;
+    sample->weight *= exp(log_p_[j] - max_log_p);
+    total_weight += sample->weight;
+  }
+  set->log_scale += max_log_p;
   return total_weight;
 }
 
@@ -251,4 +272,10 @@ LikelihoodFieldModelProb::sensorUpdate(pf_t * pf, LaserData * data)
   return true;
 }
 
+pf_sensor_model_fn_t
+LikelihoodFieldModelProb::sensorModel() const
+{
+  return (pf_sensor_model_fn_t) sensorFunction;
+}
+
 }  // namespace nav2_amcl
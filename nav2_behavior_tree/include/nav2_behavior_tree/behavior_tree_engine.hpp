@@ -17,11 +17,13 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "behaviortree_cpp_v3/behavior_tree.h"
 #include "behaviortree_cpp_v3/bt_factory.h"
 #include "behaviortree_cpp_v3/xml_parsing.h"
+#include "rclcpp/rclcpp.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -34,16 +36,46 @@ public:
   explicit BehaviorTreeEngine(const std::vector<std::string> & plugin_libraries);
   virtual ~BehaviorTreeEngine() {}
 
+  /**
+   * @brief Tick the tree until it completes or is canceled
+   * @param tree Tree to run
+   * @param onLoop Called after every tick
+   * @param cancelRequested Polled before every tick
+   * @param loopTimeout Period of the ticks, or longest time between two ticks with a wake node
+   * @param wakeNode If set, the tree is ticked again as soon as a callback of this node has been
+   * run, for instance when an action of the tree completes, instead of at the next period
+   * @return How the tree completed
+   */
   BtStatus run(
     BT::Tree * tree,
     std::function<void()> onLoop,
     std::function<bool()> cancelRequested,
-    std::chrono::milliseconds loopTimeout = std::chrono::milliseconds(10));
+    std::chrono::milliseconds loopTimeout = std::chrono::milliseconds(10),
+    rclcpp::Node::SharedPtr wakeNode = nullptr);
 
+  /**
+   * @brief Create a tree from its XML description. The description is parsed and validated
+   * once, later calls with the same text only create the nodes
+   * @param xml_string XML description of the tree
+   * @param blackboard Blackboard of the tree
+   * @return The tree
+   */
   BT::Tree buildTreeFromText(
     const std::string & xml_string,
     BT::Blackboard::Ptr blackboard);
 
+  /**
+   * @brief Parse and validate an XML description ahead of buildTreeFromText()
+   * @param xml_string XML description of the tree
+   * @throw BT::RuntimeError if the description is invalid
+   */
+  void parseTreeFromText(const std::string & xml_string);
+
+  /**
+   * @brief Forget the parsed descriptions
+   */
+  void clearParsedTrees() {parsers_.clear();}
+
   // In order to re-run a Behavior Tree, we must be able to reset all nodes to the initial state
   void haltAllActions(BT::TreeNode * root_node)
   {
@@ -60,8 +92,16 @@ public:
   }
 
 protected:
+  /**
+   * @brief Get the parser of an XML description, parsing it if it is new
+   */
+  BT::XMLParser & getParser(const std::string & xml_string);
+
   // The factory that will be used to dynamically construct the behavior tree
   BT::BehaviorTreeFactory factory_;
+
+  // Parsed XML descriptions, by text
+  std::unordered_map<std::string, std::unique_ptr<BT::XMLParser>> parsers_;
 };
 
 }  // namespace nav2_behavior_tree
@@ -15,11 +15,14 @@
 #ifndef NAV2_BEHAVIOR_TREE__BT_ACTION_NODE_HPP_
 #define NAV2_BEHAVIOR_TREE__BT_ACTION_NODE_HPP_
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 
 #include "behaviortree_cpp_v3/action_node.h"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 #include "nav2_behavior_tree/bt_conversions.hpp"
 
@@ -38,6 +41,11 @@ public:
   {
     node_ = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
 
+    // Get the required items from the blackboard
+    server_timeout_ =
+      config().blackboard->get<std::chrono::milliseconds>("server_timeout");
+    getInput<std::chrono::milliseconds>("server_timeout", server_timeout_);
+
     // Initialize the input and output messages
     goal_ = typename ActionT::Goal();
     result_ = typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult();
@@ -122,9 +130,13 @@ public:
     return BT::NodeStatus::SUCCESS;
   }
 
-  // The main override required by a BT action
+  // The main override required by a BT action. The tick never waits on the action server:
+  // responses are picked up by spinning the node without blocking, or by whoever spins it
+  // between ticks, and the node yields RUNNING until they arrive
   BT::NodeStatus tick() override
   {
+    nav2_util::ScopedTrace trace("bt.action", name());
+
     // first step to be done only at the beginning of the Action
     if (status() == BT::NodeStatus::IDLE) {
       // setting the status to RUNNING to notify the BT Loggers (if any)
@@ -141,6 +153,13 @@ public:
       // user defined callback. May modify the value of "goal_updated_"
       on_wait_for_result();
 
+      rclcpp::spin_some(node_);
+
+      // Yield until the server has acknowledged the goal that was sent
+      if (!is_goal_handle_received()) {
+        return BT::NodeStatus::RUNNING;
+      }
+
       auto goal_status = goal_handle_->get_status();
       if (goal_updated_ && (goal_status == action_msgs::msg::GoalStatus::STATUS_EXECUTING ||
         goal_status == action_msgs::msg::GoalStatus::STATUS_ACCEPTED))
@@ -149,8 +168,6 @@ public:
         on_new_goal_received();
       }
 
-      rclcpp::spin_some(node_);
-
       // check if, after invoking spin_some(), we finally received the result
       if (!goal_result_available_) {
         // Yield this Action, returning RUNNING
@@ -174,20 +191,15 @@ public:
   }
 
   // The other (optional) override required by a BT action. In this case, we
-  // make sure to cancel the ROS2 action if it is still running.
+  // make sure to cancel the ROS2 action if it is still running. The cancel request
+  // is sent without waiting for the server to answer it.
   void halt() override
   {
     if (should_cancel_goal()) {
-      auto future_cancel = action_client_->async_cancel_goal(goal_handle_);
-      if (rclcpp::spin_until_future_complete(node_, future_cancel) !=
-        rclcpp::FutureReturnCode::SUCCESS)
-      {
-        RCLCPP_ERROR(
-          node_->get_logger(),
-          "Failed to cancel action server for %s", action_name_.c_str());
-      }
+      action_client_->async_cancel_goal(goal_handle_);
     }
 
+    future_goal_handle_ = {};
     setStatus(BT::NodeStatus::IDLE);
   }
 
@@ -200,6 +212,26 @@ protected:
     }
 
     rclcpp::spin_some(node_);
+
+    // A goal that has not been acknowledged yet can't be cancelled by handle. Give the server
+    // up to server_timeout to acknowledge it, so that it isn't left running unattended
+    if (future_goal_handle_.valid() &&
+      rclcpp::spin_until_future_complete(node_, future_goal_handle_, server_timeout_) !=
+      rclcpp::FutureReturnCode::SUCCESS)
+    {
+      RCLCPP_ERROR(
+        node_->get_logger(),
+        "Failed to cancel action server for %s", action_name_.c_str());
+      return false;
+    }
+
+    if (future_goal_handle_.valid()) {
+      goal_handle_ = future_goal_handle_.get();
+      future_goal_handle_ = {};
+    }
+    if (!goal_handle_) {
+      return false;
+    }
     auto status = goal_handle_->get_status();
 
     // Check if the goal is still executing
@@ -207,6 +239,25 @@ protected:
            status == action_msgs::msg::GoalStatus::STATUS_EXECUTING;
   }
 
+  // Collect the goal handle once the server has answered the goal request, without waiting.
+  // Returns false while the answer is still outstanding
+  bool is_goal_handle_received()
+  {
+    if (!future_goal_handle_.valid()) {
+      return static_cast<bool>(goal_handle_);
+    }
+
+    if (future_goal_handle_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+
+    goal_handle_ = future_goal_handle_.get();
+    future_goal_handle_ = {};
+    if (!goal_handle_) {
+      throw std::runtime_error("Goal was rejected by the action server");
+    }
+    return true;
+  }
 
   void on_new_goal_received()
   {
@@ -214,6 +265,10 @@ protected:
     auto send_goal_options = typename rclcpp_action::Client<ActionT>::SendGoalOptions();
     send_goal_options.result_callback =
       [this](const typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult & result) {
+        // The result can arrive in the same spin as the goal response, so pick that up first
+        if (!is_goal_handle_received()) {
+          return;
+        }
         // TODO(#1652): a work around until rcl_action interface is updated
         // if goal ids are not matched, the older goal call this callback so ignore the result
         // if matched, it must be processed (including aborted)
@@ -223,18 +278,9 @@ protected:
         }
       };
 
-    auto future_goal_handle = action_client_->async_send_goal(goal_, send_goal_options);
-
-    if (rclcpp::spin_until_future_complete(node_, future_goal_handle) !=
-      rclcpp::FutureReturnCode::SUCCESS)
-    {
-      throw std::runtime_error("send_goal failed");
-    }
-
-    goal_handle_ = future_goal_handle.get();
-    if (!goal_handle_) {
-      throw std::runtime_error("Goal was rejected by the action server");
-    }
+    // The goal handle is collected on a later tick, once the server has responded
+    goal_handle_.reset();
+    future_goal_handle_ = action_client_->async_send_goal(goal_, send_goal_options);
   }
 
   void increment_recovery_count()
@@ -253,10 +299,15 @@ protected:
   bool goal_updated_{false};
   bool goal_result_available_{false};
   typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr goal_handle_;
+  std::shared_future<typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr>
+  future_goal_handle_;
   typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult result_;
 
   // The node that will be used for any ROS operations
   rclcpp::Node::SharedPtr node_;
+
+  // The longest halt() waits for the server to acknowledge a goal, so that it can be cancelled
+  std::chrono::milliseconds server_timeout_;
 };
 
 }  // namespace nav2_behavior_tree
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_BEHAVIOR_TREE__BT_CACHED_INPUT_HPP_
+#define NAV2_BEHAVIOR_TREE__BT_CACHED_INPUT_HPP_
+
+#include <exception>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "behaviortree_cpp_v3/tree_node.h"
+#include "nav2_behavior_tree/bt_conversions.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @class CachedInput
+ * @brief Input port of a node read on every tick without parsing the same string again
+ *
+ * getInput() converts a literal port value from its XML string on every call, and so
+ * does a blackboard entry holding a string. A literal is converted once, when the
+ * CachedInput is built with the node, and a string entry again only when the string
+ * changes. Typed blackboard entries are cast as getInput() does.
+ */
+template<typename T>
+class CachedInput
+{
+public:
+  CachedInput(const BT::TreeNode & node, const std::string & port)
+  : node_(node)
+  {
+    auto it = node.config().input_ports.find(port);
+    if (it == node.config().input_ports.end()) {
+      return;
+    }
+    if (BT::TreeNode::isBlackboardPointer(it->second)) {
+      const BT::StringView entry = BT::TreeNode::stripBlackboardPointer(it->second);
+      entry_.assign(entry.data(), entry.size());
+    } else {
+      valid_ = static_cast<bool>(node.getInput<T>(port, value_));
+    }
+  }
+
+  /**
+   * @brief Current value of the port
+   * @return False if the port or its blackboard entry is missing or can't be converted
+   */
+  bool get(T & value)
+  {
+    if (!entry_.empty() && !update()) {
+      return false;
+    }
+    if (valid_) {
+      value = value_;
+    }
+    return valid_;
+  }
+
+protected:
+  /**
+   * @brief Refresh the value from the blackboard entry
+   */
+  bool update()
+  {
+    const BT::Any * any = node_.config().blackboard ?
+      node_.config().blackboard->getAny(entry_) : nullptr;
+    if (!any || any->empty()) {
+      return false;
+    }
+    try {
+      if (!std::is_same<T, std::string>::value && any->type() == typeid(std::string)) {
+        std::string text = any->cast<std::string>();
+        if (!valid_ || text != text_) {
+          valid_ = false;
+          value_ = BT::convertFromString<T>(text);
+          text_ = std::move(text);
+          valid_ = true;
+        }
+      } else {
+        value_ = any->cast<T>();
+        text_.clear();
+        valid_ = true;
+      }
+    } catch (const std::exception &) {
+      valid_ = false;
+    }
+    return valid_;
+  }
+
+  const BT::TreeNode & node_;
+  std::string entry_;  ///< Blackboard entry the port is remapped to, empty for a literal
+  std::string text_;  ///< String value_ was converted from, if the entry holds one
+  T value_{};
+  bool valid_{false};
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__BT_CACHED_INPUT_HPP_
@@ -15,11 +15,14 @@
 #ifndef NAV2_BEHAVIOR_TREE__BT_SERVICE_NODE_HPP_
 #define NAV2_BEHAVIOR_TREE__BT_SERVICE_NODE_HPP_
 
+#include <chrono>
+#include <future>
 #include <string>
 #include <memory>
 
 #include "behaviortree_cpp_v3/action_node.h"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_behavior_tree/bt_conversions.hpp"
 
@@ -27,13 +30,13 @@ namespace nav2_behavior_tree
 {
 
 template<class ServiceT>
-class BtServiceNode : public BT::SyncActionNode
+class BtServiceNode : public BT::ActionNodeBase
 {
 public:
   BtServiceNode(
     const std::string & service_node_name,
     const BT::NodeConfiguration & conf)
-  : BT::SyncActionNode(service_node_name, conf), service_node_name_(service_node_name)
+  : BT::ActionNodeBase(service_node_name, conf), service_node_name_(service_node_name)
   {
     node_ = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
 
@@ -84,12 +87,33 @@ public:
     return providedBasicPorts({});
   }
 
-  // The main override required by a BT service
+  // The main override required by a BT service. The request is sent on the first tick and
+  // the node yields RUNNING on later ticks until the response arrives or server_timeout passes,
+  // so a slow server never stalls the rest of the tree
   BT::NodeStatus tick() override
   {
-    on_tick();
-    auto future_result = service_client_->async_send_request(request_);
-    return check_future(future_result);
+    nav2_util::ScopedTrace trace("bt.service", name());
+
+    if (status() == BT::NodeStatus::IDLE) {
+      setStatus(BT::NodeStatus::RUNNING);
+      on_tick();
+      future_result_ = service_client_->async_send_request(request_);
+      request_sent_time_ = std::chrono::steady_clock::now();
+    }
+
+    rclcpp::spin_some(node_);
+    auto node_status = check_future(future_result_);
+    if (node_status != BT::NodeStatus::RUNNING) {
+      future_result_ = {};
+    }
+    return node_status;
+  }
+
+  // Dropping the outstanding request is all that is needed, its response will be ignored
+  void halt() override
+  {
+    future_result_ = {};
+    setStatus(BT::NodeStatus::IDLE);
   }
 
   // Fill in service request with information if necessary
@@ -97,22 +121,20 @@ public:
   {
   }
 
-  // Check the future and decide the status of Behaviortree
+  // Check the future without waiting on it and decide the status of Behaviortree
   virtual BT::NodeStatus check_future(
     std::shared_future<typename ServiceT::Response::SharedPtr> future_result)
   {
-    rclcpp::FutureReturnCode rc;
-    rc = rclcpp::spin_until_future_complete(
-      node_,
-      future_result, server_timeout_);
-    if (rc == rclcpp::FutureReturnCode::SUCCESS) {
+    if (future_result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
       return BT::NodeStatus::SUCCESS;
-    } else if (rc == rclcpp::FutureReturnCode::TIMEOUT) {
-      RCLCPP_WARN(
-        node_->get_logger(),
-        "Node timed out while executing service call to %s.", service_name_.c_str());
-      on_wait_for_result();
     }
+    if (std::chrono::steady_clock::now() - request_sent_time_ < server_timeout_) {
+      return BT::NodeStatus::RUNNING;
+    }
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Node timed out while executing service call to %s.", service_name_.c_str());
+    on_wait_for_result();
     return BT::NodeStatus::FAILURE;
   }
 
@@ -134,11 +156,13 @@ protected:
   std::string service_name_, service_node_name_;
   typename std::shared_ptr<rclcpp::Client<ServiceT>> service_client_;
   std::shared_ptr<typename ServiceT::Request> request_;
+  std::shared_future<typename ServiceT::Response::SharedPtr> future_result_;
+  std::chrono::steady_clock::time_point request_sent_time_;
 
   // The node that will be used for any ROS operations
   rclcpp::Node::SharedPtr node_;
 
-  // The timeout value while to use in the tick loop while waiting for
+  // How long the node keeps returning RUNNING while waiting for
   // a result from the server
   std::chrono::milliseconds server_timeout_;
 };
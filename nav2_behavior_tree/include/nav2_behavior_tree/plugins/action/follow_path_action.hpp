@@ -18,6 +18,7 @@
 #include <string>
 
 #include "nav2_msgs/action/follow_path.hpp"
+#include "nav2_util/compact_path.hpp"
 #include "nav2_behavior_tree/bt_action_node.hpp"
 
 namespace nav2_behavior_tree
@@ -40,9 +41,15 @@ public:
     return providedBasicPorts(
       {
         BT::InputPort<nav_msgs::msg::Path>("path", "Path to follow"),
+        BT::InputPort<nav2_util::CompactPathView>(
+          "compact_path", "Path to follow, instead of path when set"),
         BT::InputPort<std::string>("controller_id", ""),
       });
   }
+
+private:
+  // The view the goal was built from, a new path or truncation comes as a new view
+  nav2_util::CompactPathView compact_path_;
 };
 
 }  // namespace nav2_behavior_tree
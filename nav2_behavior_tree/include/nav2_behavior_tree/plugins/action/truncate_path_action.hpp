@@ -20,6 +20,7 @@
 #include <string>
 
 #include "nav_msgs/msg/path.hpp"
+#include "nav2_util/compact_path.hpp"
 
 #include "behaviortree_cpp_v3/action_node.h"
 
@@ -39,6 +40,10 @@ public:
     return {
       BT::InputPort<nav_msgs::msg::Path>("input_path", "Original Path"),
       BT::OutputPort<nav_msgs::msg::Path>("output_path", "Path truncated to a certain distance"),
+      BT::InputPort<nav2_util::CompactPathView>(
+        "input_compact_path", "Original compact path, instead of input_path when given"),
+      BT::OutputPort<nav2_util::CompactPathView>(
+        "output_compact_path", "View of the compact path truncated to a certain distance"),
       BT::InputPort<double>("distance", 1.0, "distance"),
     };
   }
@@ -47,7 +52,16 @@ private:
   void halt() override {}
   BT::NodeStatus tick() override;
 
+  /**
+   * @brief Truncate a view of a compact path into output_compact_path, by narrowing it
+   */
+  void truncateCompact(const nav2_util::CompactPathView & input_path);
+
   double distance_;
+
+  // Last compact path truncated and its truncation, the same view is truncated only once
+  nav2_util::CompactPathView last_input_;
+  nav2_util::CompactPathView last_output_;
 };
 
 }  // namespace nav2_behavior_tree
@@ -20,6 +20,7 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp_v3/condition_node.h"
+#include "nav2_behavior_tree/bt_cached_input.hpp"
 #include "tf2_ros/buffer.h"
 
 namespace nav2_behavior_tree
@@ -64,6 +65,7 @@ private:
   std::string global_frame_;
   std::string robot_base_frame_;
   double transform_tolerance_;
+  CachedInput<geometry_msgs::msg::PoseStamped> goal_input_;
 };
 
 }  // namespace nav2_behavior_tree
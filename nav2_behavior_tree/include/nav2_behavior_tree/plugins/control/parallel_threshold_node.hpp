@@ -0,0 +1,77 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__PLUGINS__CONTROL__PARALLEL_THRESHOLD_NODE_HPP_
+#define NAV2_BEHAVIOR_TREE__PLUGINS__CONTROL__PARALLEL_THRESHOLD_NODE_HPP_
+
+#include <string>
+#include <vector>
+
+#include "behaviortree_cpp_v3/control_node.h"
+#include "behaviortree_cpp_v3/bt_factory.h"
+
+namespace nav2_behavior_tree
+{
+
+/** @brief Type of control node that ticks all of its children on every tick
+ *
+ * Type of Control Node  | Child Returns Failure | Child Returns Running
+ * ---------------------------------------------------------------------
+ *  ParallelThreshold    |  Count, Tick Others   | Tick Others
+ *
+ * Every child that hasn't finished yet is ticked each time this node is ticked, so long running
+ * children such as ComputePathToPose and FollowPath make progress side by side. A child that
+ * returns SUCCESS or FAILURE is not ticked again until this node is halted.
+ *
+ * Once success_threshold children have succeeded this node halts the children that are still
+ * running and returns SUCCESS. Once failure_threshold children have failed, or too few are left
+ * to reach success_threshold, it halts them and returns FAILURE. Otherwise it returns RUNNING.
+ * Halting a running BtActionNode child cancels its goal on the action server.
+ *
+ * A negative threshold counts back from the number of children, so -1 (the default for
+ * success_threshold) means all of them. failure_threshold defaults to 1.
+ *
+ * Usage in XML: <ParallelThreshold success_threshold="-1" failure_threshold="1">
+ */
+class ParallelThresholdNode : public BT::ControlNode
+{
+public:
+  explicit ParallelThresholdNode(const std::string & name);
+  ParallelThresholdNode(const std::string & name, const BT::NodeConfiguration & config);
+  BT::NodeStatus tick() override;
+  void halt() override;
+
+  static BT::PortsList providedPorts()
+  {
+    return {
+      BT::InputPort<int>("success_threshold", -1, "Number of children that must succeed"),
+      BT::InputPort<int>("failure_threshold", 1, "Number of children that may fail")
+    };
+  }
+
+private:
+  // Turn a threshold port value into a number of children
+  int resolveThreshold(int threshold) const;
+
+  int success_threshold_{-1};
+  int failure_threshold_{1};
+
+  std::vector<bool> completed_;
+  int success_count_{0};
+  int failure_count_{0};
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__PLUGINS__CONTROL__PARALLEL_THRESHOLD_NODE_HPP_
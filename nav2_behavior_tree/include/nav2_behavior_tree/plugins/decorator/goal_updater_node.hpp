@@ -24,6 +24,7 @@
 #include "behaviortree_cpp_v3/decorator_node.h"
 
 #include "rclcpp/rclcpp.hpp"
+#include "nav2_behavior_tree/bt_cached_input.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -54,6 +55,7 @@ private:
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr goal_sub_;
 
   geometry_msgs::msg::PoseStamped last_goal_received_;
+  CachedInput<geometry_msgs::msg::PoseStamped> input_goal_;
 };
 
 }  // namespace nav2_behavior_tree
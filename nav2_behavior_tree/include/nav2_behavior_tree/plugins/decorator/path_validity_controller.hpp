@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__PLUGINS__DECORATOR__PATH_VALIDITY_CONTROLLER_HPP_
+#define NAV2_BEHAVIOR_TREE__PLUGINS__DECORATOR__PATH_VALIDITY_CONTROLLER_HPP_
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_util/compact_path.hpp"
+#include "tf2_ros/buffer.h"
+
+#include "behaviortree_cpp_v3/decorator_node.h"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @brief Decorator that only ticks its child (typically ComputePathToPose) when the current path
+ * needs replacing: the first time through, when the goal changes, when a costmap update puts a
+ * cell at or above cost_threshold on the rest of the path, when the robot is further than
+ * max_deviation from the path, or when max_period has passed since the last plan. Once the child
+ * begins to run, it is ticked each time 'til completion.
+ */
+class PathValidityController : public BT::DecoratorNode
+{
+public:
+  PathValidityController(
+    const std::string & name,
+    const BT::NodeConfiguration & conf);
+
+  // Any BT node that accepts parameters must provide a requiredNodeParameters method
+  static BT::PortsList providedPorts()
+  {
+    return {
+      BT::InputPort<nav_msgs::msg::Path>("path", "Path to keep valid"),
+      BT::InputPort<nav2_util::CompactPathView>(
+        "compact_path", "Compact path to keep valid, instead of path when given"),
+      BT::InputPort<std::string>(
+        "costmap_topic", std::string("global_costmap/costmap_raw"), "Costmap topic"),
+      BT::InputPort<int>("cost_threshold", 253, "Lowest cost that blocks the path"),
+      BT::InputPort<double>("max_deviation", 0.5, "Distance from the path that causes a replan"),
+      BT::InputPort<double>("max_period", 10.0, "Longest time (secs) between replans"),
+      BT::InputPort<std::string>("global_frame", std::string("map"), "Global frame"),
+      BT::InputPort<std::string>("robot_base_frame", std::string("base_link"), "Robot base frame")
+    };
+  }
+
+private:
+  BT::NodeStatus tick() override;
+
+  // Whether the path on the blackboard should be replaced
+  bool isReplanNeeded();
+
+  // Whether the robot strayed from a path or a cell on it ahead of the robot is blocked,
+  // position(i) giving the position of pose i. A compact path is read in place this way
+  template<typename PositionT>
+  bool isPathInvalid(const std::string & frame, std::size_t size, PositionT position);
+
+  // Whether a cell on the path from the given pose onwards is blocked in the latest costmap
+  template<typename PositionT>
+  bool isPathBlocked(
+    const std::string & frame, std::size_t size, PositionT position, std::size_t first_pose);
+
+  void costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg);
+
+  rclcpp::Node::SharedPtr node_;
+  std::shared_ptr<tf2_ros::Buffer> tf_;
+  double transform_tolerance_;
+
+  rclcpp::Subscription<nav2_msgs::msg::Costmap>::SharedPtr costmap_sub_;
+
+  // The costmap is received on whatever thread spins the node
+  std::mutex costmap_mutex_;
+  nav2_msgs::msg::Costmap::SharedPtr costmap_;
+  bool costmap_updated_;
+
+  geometry_msgs::msg::PoseStamped goal_;
+  rclcpp::Time plan_time_;
+
+  int cost_threshold_;
+  double max_deviation_;
+  double max_period_;
+
+  std::string global_frame_;
+  std::string robot_base_frame_;
+
+  bool first_time_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__PLUGINS__DECORATOR__PATH_VALIDITY_CONTROLLER_HPP_
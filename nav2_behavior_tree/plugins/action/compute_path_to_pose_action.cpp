@@ -32,11 +32,21 @@ void ComputePathToPoseAction::on_tick()
 {
   getInput("goal", goal_.pose);
   getInput("planner_id", goal_.planner_id);
+  getInput("compact", goal_.use_compact_path);
 }
 
 BT::NodeStatus ComputePathToPoseAction::on_success()
 {
-  setOutput("path", result_.result->path);
+  if (goal_.use_compact_path) {
+    // Shares the path with the result rather than copying it
+    setOutput(
+      "compact_path",
+      nav2_util::CompactPathView(
+        nav2_msgs::msg::CompactPath::ConstSharedPtr(
+          result_.result, &result_.result->compact_path)));
+  } else {
+    setOutput("path", result_.result->path);
+  }
   return BT::NodeStatus::SUCCESS;
 }
 
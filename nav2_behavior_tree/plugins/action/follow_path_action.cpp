@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "nav2_behavior_tree/plugins/action/follow_path_action.hpp"
 
@@ -30,12 +31,34 @@ FollowPathAction::FollowPathAction(
 
 void FollowPathAction::on_tick()
 {
-  getInput("path", goal_.path);
+  compact_path_ = nav2_util::CompactPathView();
+  getInput("compact_path", compact_path_);
+  if (!compact_path_.empty()) {
+    goal_.compact_path = compact_path_.toCompactPath();
+    goal_.path = nav_msgs::msg::Path();
+  } else {
+    getInput("path", goal_.path);
+    goal_.compact_path = nav2_msgs::msg::CompactPath();
+  }
   getInput("controller_id", goal_.controller_id);
 }
 
 void FollowPathAction::on_wait_for_result()
 {
+  if (!compact_path_.empty()) {
+    nav2_util::CompactPathView new_path;
+    getInput("compact_path", new_path);
+    if (!new_path.empty() && new_path != compact_path_) {
+      compact_path_ = new_path;
+      nav2_msgs::msg::CompactPath poses = new_path.toCompactPath();
+      if (poses != goal_.compact_path) {
+        goal_.compact_path = std::move(poses);
+        goal_updated_ = true;
+      }
+    }
+    return;
+  }
+
   // Grab the new path
   nav_msgs::msg::Path new_path;
   getInput("path", new_path);
@@ -16,9 +16,12 @@
 #include <string>
 #include <memory>
 #include <limits>
+#include <cmath>
+#include <utility>
 
 #include "nav_msgs/msg/path.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_util/compact_path.hpp"
 #include "nav2_util/geometry_utils.hpp"
 #include "behaviortree_cpp_v3/decorator_node.h"
 
@@ -40,6 +43,16 @@ inline BT::NodeStatus TruncatePath::tick()
 {
   setStatus(BT::NodeStatus::RUNNING);
 
+  nav2_util::CompactPathView input_compact_path;
+  if (getInput("input_compact_path", input_compact_path)) {
+    if (input_compact_path.empty()) {
+      setOutput("output_compact_path", input_compact_path);
+    } else {
+      truncateCompact(input_compact_path);
+    }
+    return BT::NodeStatus::SUCCESS;
+  }
+
   nav_msgs::msg::Path input_path;
 
   getInput("input_path", input_path);
@@ -80,6 +93,27 @@ inline BT::NodeStatus TruncatePath::tick()
   return BT::NodeStatus::SUCCESS;
 }
 
+void TruncatePath::truncateCompact(const nav2_util::CompactPathView & input_path)
+{
+  if (input_path != last_input_) {
+    const size_t size = input_path.size();
+    const float final_x = input_path.x(size - 1);
+    const float final_y = input_path.y(size - 1);
+    size_t kept = size;
+    while (kept > 2 &&
+      std::hypot(input_path.x(kept - 1) - final_x, input_path.y(kept - 1) - final_y) < distance_)
+    {
+      kept--;
+    }
+
+    last_input_ = input_path;
+    last_output_ = input_path.slice(0, kept).withEndYaw(
+      std::atan2(final_y - input_path.y(kept - 1), final_x - input_path.x(kept - 1)));
+  }
+
+  setOutput("output_compact_path", last_output_);
+}
+
 }  // namespace nav2_behavior_tree
 
 #include "behaviortree_cpp_v3/bt_factory.h"
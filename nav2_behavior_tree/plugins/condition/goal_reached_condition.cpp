@@ -30,7 +30,8 @@ GoalReachedCondition::GoalReachedCondition(
 : BT::ConditionNode(condition_name, conf),
   initialized_(false),
   global_frame_("map"),
-  robot_base_frame_("base_link")
+  robot_base_frame_("base_link"),
+  goal_input_(*this, "goal")
 {
   getInput("global_frame", global_frame_);
   getInput("robot_base_frame", robot_base_frame_);
@@ -80,7 +81,7 @@ bool GoalReachedCondition::isGoalReached()
   }
 
   geometry_msgs::msg::PoseStamped goal;
-  getInput("goal", goal);
+  goal_input_.get(goal);
   double dx = goal.pose.position.x - current_pose.pose.position.x;
   double dy = goal.pose.position.y - current_pose.pose.position.y;
 
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "nav2_behavior_tree/plugins/control/parallel_threshold_node.hpp"
+
+namespace nav2_behavior_tree
+{
+
+ParallelThresholdNode::ParallelThresholdNode(const std::string & name)
+: BT::ControlNode::ControlNode(name, {})
+{
+}
+
+ParallelThresholdNode::ParallelThresholdNode(
+  const std::string & name,
+  const BT::NodeConfiguration & config)
+: BT::ControlNode(name, config)
+{
+  getInput("success_threshold", success_threshold_);
+  getInput("failure_threshold", failure_threshold_);
+}
+
+int ParallelThresholdNode::resolveThreshold(int threshold) const
+{
+  const int children_count = static_cast<int>(children_nodes_.size());
+  const int resolved = threshold < 0 ? children_count + threshold + 1 : threshold;
+
+  if (resolved < 1 || resolved > children_count) {
+    throw BT::BehaviorTreeException(
+            "ParallelThreshold Node '" + name() + "' has a threshold of " +
+            std::to_string(threshold) + " for " + std::to_string(children_count) +
+            " children.");
+  }
+  return resolved;
+}
+
+BT::NodeStatus ParallelThresholdNode::tick()
+{
+  const int children_count = static_cast<int>(children_nodes_.size());
+  const int success_threshold = resolveThreshold(success_threshold_);
+  const int failure_threshold = resolveThreshold(failure_threshold_);
+
+  setStatus(BT::NodeStatus::RUNNING);
+
+  if (completed_.size() != children_nodes_.size()) {
+    completed_.assign(children_nodes_.size(), false);
+  }
+
+  for (int i = 0; i < children_count; ++i) {
+    if (completed_[i]) {
+      continue;
+    }
+
+    switch (children_nodes_[i]->executeTick()) {
+      case BT::NodeStatus::SUCCESS:
+        completed_[i] = true;
+        success_count_++;
+        break;
+
+      case BT::NodeStatus::FAILURE:
+        completed_[i] = true;
+        failure_count_++;
+        break;
+
+      case BT::NodeStatus::RUNNING:
+        break;
+
+      default:
+        throw BT::LogicError("Invalid status return from BT node");
+    }
+
+    if (success_count_ >= success_threshold) {
+      halt();
+      return BT::NodeStatus::SUCCESS;
+    }
+
+    if (failure_count_ >= failure_threshold ||
+      children_count - failure_count_ < success_threshold)
+    {
+      halt();
+      return BT::NodeStatus::FAILURE;
+    }
+  }
+
+  return BT::NodeStatus::RUNNING;
+}
+
+void ParallelThresholdNode::halt()
+{
+  ControlNode::halt();
+  completed_.clear();
+  success_count_ = 0;
+  failure_count_ = 0;
+}
+
+}  // namespace nav2_behavior_tree
+
+BT_REGISTER_NODES(factory)
+{
+  factory.registerNodeType<nav2_behavior_tree::ParallelThresholdNode>("ParallelThreshold");
+}
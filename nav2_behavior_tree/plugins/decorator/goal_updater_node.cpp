@@ -31,7 +31,8 @@ using std::placeholders::_1;
 GoalUpdater::GoalUpdater(
   const std::string & name,
   const BT::NodeConfiguration & conf)
-: BT::DecoratorNode(name, conf)
+: BT::DecoratorNode(name, conf),
+  input_goal_(*this, "input_goal")
 {
   auto node = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
 
@@ -46,7 +47,7 @@ inline BT::NodeStatus GoalUpdater::tick()
 {
   geometry_msgs::msg::PoseStamped goal;
 
-  getInput("input_goal", goal);
+  input_goal_.get(goal);
 
   if (rclcpp::Time(last_goal_received_.header.stamp) > rclcpp::Time(goal.header.stamp)) {
     goal = last_goal_received_;
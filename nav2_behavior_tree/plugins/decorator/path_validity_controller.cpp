@@ -0,0 +1,232 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "nav2_util/robot_utils.hpp"
+#include "nav2_util/geometry_utils.hpp"
+
+#include "nav2_behavior_tree/plugins/decorator/path_validity_controller.hpp"
+
+namespace nav2_behavior_tree
+{
+
+// Cost of cells the costmap knows nothing about, which never invalidate a path
+static constexpr unsigned char NO_INFORMATION = 255;
+
+PathValidityController::PathValidityController(
+  const std::string & name,
+  const BT::NodeConfiguration & conf)
+: BT::DecoratorNode(name, conf),
+  costmap_updated_(false),
+  cost_threshold_(253),
+  max_deviation_(0.5),
+  max_period_(10.0),
+  global_frame_("map"),
+  robot_base_frame_("base_link"),
+  first_time_(false)
+{
+  node_ = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
+  tf_ = config().blackboard->get<std::shared_ptr<tf2_ros::Buffer>>("tf_buffer");
+  node_->get_parameter("transform_tolerance", transform_tolerance_);
+  plan_time_ = node_->now();
+
+  std::string costmap_topic("global_costmap/costmap_raw");
+  getInput("costmap_topic", costmap_topic);
+  getInput("cost_threshold", cost_threshold_);
+  getInput("max_deviation", max_deviation_);
+  getInput("max_period", max_period_);
+  getInput("global_frame", global_frame_);
+  getInput("robot_base_frame", robot_base_frame_);
+
+  costmap_sub_ = node_->create_subscription<nav2_msgs::msg::Costmap>(
+    costmap_topic, rclcpp::SystemDefaultsQoS(),
+    std::bind(&PathValidityController::costmapCallback, this, std::placeholders::_1));
+}
+
+void PathValidityController::costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg)
+{
+  std::lock_guard<std::mutex> lock(costmap_mutex_);
+  costmap_ = msg;
+  costmap_updated_ = true;
+}
+
+inline BT::NodeStatus PathValidityController::tick()
+{
+  if (status() == BT::NodeStatus::IDLE) {
+    // Plan from scratch since we're starting a new iteration of
+    // the controller (moving from IDLE to RUNNING)
+    plan_time_ = node_->now();
+    first_time_ = true;
+  }
+
+  setStatus(BT::NodeStatus::RUNNING);
+
+  // The child gets ticked the first time through and every time the path needs
+  // replacing. In addition, once the child begins to run, it is ticked each time
+  // 'til completion
+  if (first_time_ || (child_node_->status() == BT::NodeStatus::RUNNING) || isReplanNeeded()) {
+    first_time_ = false;
+    const BT::NodeStatus child_state = child_node_->executeTick();
+
+    switch (child_state) {
+      case BT::NodeStatus::RUNNING:
+        return BT::NodeStatus::RUNNING;
+
+      case BT::NodeStatus::SUCCESS:
+        config().blackboard->get<geometry_msgs::msg::PoseStamped>("goal", goal_);
+        plan_time_ = node_->now();
+        {
+          // The new path is checked against costmaps received from here on
+          std::lock_guard<std::mutex> lock(costmap_mutex_);
+          costmap_updated_ = costmap_ != nullptr;
+        }
+        return BT::NodeStatus::SUCCESS;
+
+      case BT::NodeStatus::FAILURE:
+      default:
+        return BT::NodeStatus::FAILURE;
+    }
+  }
+
+  return status();
+}
+
+bool PathValidityController::isReplanNeeded()
+{
+  if ((node_->now() - plan_time_).seconds() >= max_period_) {
+    return true;
+  }
+
+  geometry_msgs::msg::PoseStamped goal;
+  config().blackboard->get<geometry_msgs::msg::PoseStamped>("goal", goal);
+  if (goal != goal_) {
+    return true;
+  }
+
+  nav2_util::CompactPathView compact_path;
+  if (getInput("compact_path", compact_path)) {
+    if (compact_path.empty()) {
+      return true;
+    }
+    return isPathInvalid(
+      compact_path.path()->header.frame_id, compact_path.size(),
+      [&compact_path](std::size_t i) {
+        geometry_msgs::msg::Point point;
+        point.x = compact_path.x(i);
+        point.y = compact_path.y(i);
+        return point;
+      });
+  }
+
+  nav_msgs::msg::Path path;
+  if (!getInput("path", path) || path.poses.empty()) {
+    return true;
+  }
+  return isPathInvalid(
+    path.header.frame_id, path.poses.size(),
+    [&path](std::size_t i) {return path.poses[i].pose.position;});
+}
+
+template<typename PositionT>
+bool PathValidityController::isPathInvalid(
+  const std::string & frame, std::size_t size, PositionT position)
+{
+  geometry_msgs::msg::PoseStamped current_pose;
+  if (!nav2_util::getCurrentPose(
+      current_pose, *tf_, global_frame_, robot_base_frame_,
+      transform_tolerance_))
+  {
+    RCLCPP_DEBUG(node_->get_logger(), "Current robot pose is not available.");
+    return false;
+  }
+
+  // Only the part of the path ahead of the closest pose matters from here on
+  std::size_t closest = 0;
+  double closest_dist = std::numeric_limits<double>::max();
+  for (std::size_t i = 0; i < size; ++i) {
+    double dist = nav2_util::geometry_utils::euclidean_distance(
+      current_pose.pose.position, position(i));
+    if (dist < closest_dist) {
+      closest_dist = dist;
+      closest = i;
+    }
+  }
+
+  if (closest_dist > max_deviation_) {
+    return true;
+  }
+
+  return isPathBlocked(frame, size, position, closest);
+}
+
+template<typename PositionT>
+bool PathValidityController::isPathBlocked(
+  const std::string & frame, std::size_t size, PositionT position, std::size_t first_pose)
+{
+  nav2_msgs::msg::Costmap::SharedPtr costmap;
+  {
+    std::lock_guard<std::mutex> lock(costmap_mutex_);
+    if (!costmap_updated_) {
+      return false;
+    }
+    costmap_updated_ = false;
+    costmap = costmap_;
+  }
+
+  // Without a transform the cells can't be compared, so rely on the other triggers
+  if (costmap->header.frame_id != frame) {
+    RCLCPP_DEBUG(
+      node_->get_logger(), "Costmap frame %s doesn't match path frame %s.",
+      costmap->header.frame_id.c_str(), frame.c_str());
+    return false;
+  }
+
+  const auto & metadata = costmap->metadata;
+  if (costmap->data.size() < static_cast<std::size_t>(metadata.size_x) * metadata.size_y) {
+    return false;
+  }
+
+  for (std::size_t i = first_pose; i < size; ++i) {
+    const geometry_msgs::msg::Point point = position(i);
+    int mx = static_cast<int>(std::floor(
+        (point.x - metadata.origin.position.x) / metadata.resolution));
+    int my = static_cast<int>(std::floor(
+        (point.y - metadata.origin.position.y) / metadata.resolution));
+    if (mx < 0 || my < 0 || mx >= static_cast<int>(metadata.size_x) ||
+      my >= static_cast<int>(metadata.size_y))
+    {
+      continue;
+    }
+
+    unsigned char cost = costmap->data[my * metadata.size_x + mx];
+    if (cost != NO_INFORMATION && cost >= cost_threshold_) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace nav2_behavior_tree
+
+#include "behaviortree_cpp_v3/bt_factory.h"
+BT_REGISTER_NODES(factory)
+{
+  factory.registerNodeType<nav2_behavior_tree::PathValidityController>("PathValidityController");
+}
@@ -14,12 +14,15 @@
 
 #include "nav2_behavior_tree/behavior_tree_engine.hpp"
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp_v3/utils/shared_library.h"
+#include "nav2_util/trace.hpp"
 
 using namespace std::chrono_literals;
 
@@ -39,23 +42,40 @@ BehaviorTreeEngine::run(
   BT::Tree * tree,
   std::function<void()> onLoop,
   std::function<bool()> cancelRequested,
-  std::chrono::milliseconds loopTimeout)
+  std::chrono::milliseconds loopTimeout,
+  rclcpp::Node::SharedPtr wakeNode)
 {
   rclcpp::WallRate loopRate(loopTimeout);
+  rclcpp::executors::SingleThreadedExecutor executor;
   BT::NodeStatus result = BT::NodeStatus::RUNNING;
 
   // Loop until something happens with ROS or the node completes
   while (rclcpp::ok() && result == BT::NodeStatus::RUNNING) {
+    auto tick_start = std::chrono::steady_clock::now();
     if (cancelRequested()) {
       tree->rootNode()->halt();
       return BtStatus::CANCELED;
     }
 
-    result = tree->tickRoot();
+    {
+      nav2_util::ScopedTrace trace("bt.tick", tree->rootNode()->name());
+      result = tree->tickRoot();
+    }
 
     onLoop();
 
-    loopRate.sleep();
+    if (!wakeNode) {
+      loopRate.sleep();
+    } else if (result == BT::NodeStatus::RUNNING) {
+      // Wait for the next callback of the node, up to the end of the period. The tree nodes
+      // spin the node themselves while ticking, so it is only in the executor meanwhile
+      auto remaining = loopTimeout - (std::chrono::steady_clock::now() - tick_start);
+      if (remaining > std::chrono::nanoseconds::zero()) {
+        executor.add_node(wakeNode, false);
+        executor.spin_once(std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        executor.remove_node(wakeNode, false);
+      }
+    }
   }
 
   return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
@@ -66,9 +86,25 @@ BehaviorTreeEngine::buildTreeFromText(
   const std::string & xml_string,
   BT::Blackboard::Ptr blackboard)
 {
-  BT::XMLParser p(factory_);
-  p.loadFromText(xml_string);
-  return p.instantiateTree(blackboard);
+  return getParser(xml_string).instantiateTree(blackboard);
+}
+
+void
+BehaviorTreeEngine::parseTreeFromText(const std::string & xml_string)
+{
+  getParser(xml_string);
+}
+
+BT::XMLParser &
+BehaviorTreeEngine::getParser(const std::string & xml_string)
+{
+  auto it = parsers_.find(xml_string);
+  if (it == parsers_.end()) {
+    auto parser = std::make_unique<BT::XMLParser>(factory_);
+    parser->loadFromText(xml_string);
+    it = parsers_.emplace(xml_string, std::move(parser)).first;
+  }
+  return *it->second;
 }
 
 }  // namespace nav2_behavior_tree
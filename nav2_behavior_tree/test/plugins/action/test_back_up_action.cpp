@@ -144,6 +144,11 @@ TEST_F(BackUpActionTestFixture, test_tick)
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
   EXPECT_EQ(config_->blackboard->get<int>("number_recoveries"), 1);
 
+  // the goal reaches the server while the node keeps running
+  while (!action_server_->getCurrentGoal()) {
+    EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
+  }
+
   auto goal = action_server_->getCurrentGoal();
   EXPECT_EQ(goal->target.x, 2.0);
   EXPECT_EQ(goal->speed, 0.26f);
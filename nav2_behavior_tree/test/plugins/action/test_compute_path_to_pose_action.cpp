@@ -41,8 +41,14 @@ protected:
   {
     const auto goal = goal_handle->get_goal();
     auto result = std::make_shared<nav2_msgs::action::ComputePathToPose::Result>();
-    result->path.poses.resize(1);
-    result->path.poses[0].pose.position.x = goal->pose.pose.position.x;
+    if (goal->use_compact_path) {
+      result->compact_path.x = {static_cast<float>(goal->pose.pose.position.x)};
+      result->compact_path.y = {0.0f};
+      result->compact_path.yaw = {0.0f};
+    } else {
+      result->path.poses.resize(1);
+      result->path.poses[0].pose.position.x = goal->pose.pose.position.x;
+    }
     goal_handle->succeed(result);
   }
 };
@@ -131,13 +137,13 @@ TEST_F(ComputePathToPoseActionTestFixture, test_tick)
   // first tick should send the goal to our server
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
   EXPECT_EQ(tree_->rootNode()->getInput<std::string>("planner_id"), std::string("GridBased"));
-  EXPECT_EQ(action_server_->getCurrentGoal()->pose.pose.position.x, 1.0);
-  EXPECT_EQ(action_server_->getCurrentGoal()->planner_id, std::string("GridBased"));
 
   // tick until node succeeds
   while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
     tree_->rootNode()->executeTick();
   }
+  EXPECT_EQ(action_server_->getCurrentGoal()->pose.pose.position.x, 1.0);
+  EXPECT_EQ(action_server_->getCurrentGoal()->planner_id, std::string("GridBased"));
 
   // check if returned path is correct
   nav_msgs::msg::Path path;
@@ -154,17 +160,46 @@ TEST_F(ComputePathToPoseActionTestFixture, test_tick)
   config_->blackboard->set("goal", goal);
 
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
-  EXPECT_EQ(action_server_->getCurrentGoal()->pose.pose.position.x, -2.5);
 
   while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
     tree_->rootNode()->executeTick();
   }
+  EXPECT_EQ(action_server_->getCurrentGoal()->pose.pose.position.x, -2.5);
 
   config_->blackboard->get<nav_msgs::msg::Path>("path", path);
   EXPECT_EQ(path.poses.size(), 1u);
   EXPECT_EQ(path.poses[0].pose.position.x, -2.5);
 }
 
+TEST_F(ComputePathToPoseActionTestFixture, test_tick_compact)
+{
+  std::string xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+            <ComputePathToPose goal="{goal}" compact_path="{compact_path}" compact="true"
+              planner_id="GridBased"/>
+        </BehaviorTree>
+      </root>)";
+
+  tree_ = std::make_shared<BT::Tree>(factory_->createTreeFromText(xml_txt, config_->blackboard));
+
+  geometry_msgs::msg::PoseStamped goal;
+  goal.header.stamp = node_->now();
+  goal.pose.position.x = 3.0;
+  config_->blackboard->set("goal", goal);
+
+  while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
+    tree_->rootNode()->executeTick();
+  }
+  EXPECT_TRUE(action_server_->getCurrentGoal()->use_compact_path);
+
+  nav2_util::CompactPathView path;
+  config_->blackboard->get("compact_path", path);
+  ASSERT_EQ(path.size(), 1u);
+  EXPECT_EQ(path.x(0), 3.0f);
+}
+
 int main(int argc, char ** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -129,15 +129,15 @@ TEST_F(FollowPathActionTestFixture, test_tick)
   // first tick should send the goal to our server
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
   EXPECT_EQ(tree_->rootNode()->getInput<std::string>("controller_id"), std::string("FollowPath"));
-  EXPECT_EQ(action_server_->getCurrentGoal()->path.poses.size(), 1u);
-  EXPECT_EQ(action_server_->getCurrentGoal()->path.poses[0].pose.position.x, 1.0);
-  EXPECT_EQ(action_server_->getCurrentGoal()->controller_id, std::string("FollowPath"));
 
   // tick until node succeeds
   while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
     tree_->rootNode()->executeTick();
   }
   EXPECT_EQ(tree_->rootNode()->status(), BT::NodeStatus::SUCCESS);
+  EXPECT_EQ(action_server_->getCurrentGoal()->path.poses.size(), 1u);
+  EXPECT_EQ(action_server_->getCurrentGoal()->path.poses[0].pose.position.x, 1.0);
+  EXPECT_EQ(action_server_->getCurrentGoal()->controller_id, std::string("FollowPath"));
 
   // halt node so another goal can be sent
   tree_->rootNode()->halt();
@@ -148,12 +148,50 @@ TEST_F(FollowPathActionTestFixture, test_tick)
   config_->blackboard->set<nav_msgs::msg::Path>("path", path);
 
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
+
+  while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
+    tree_->rootNode()->executeTick();
+  }
   EXPECT_EQ(action_server_->getCurrentGoal()->path.poses.size(), 1u);
   EXPECT_EQ(action_server_->getCurrentGoal()->path.poses[0].pose.position.x, -2.5);
+}
 
+TEST_F(FollowPathActionTestFixture, test_tick_compact)
+{
+  std::string xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+            <FollowPath path="{path}" compact_path="{compact_path}" controller_id="FollowPath"/>
+        </BehaviorTree>
+      </root>)";
+
+  tree_ = std::make_shared<BT::Tree>(factory_->createTreeFromText(xml_txt, config_->blackboard));
+
+  // the compact path is followed instead of the path left on the blackboard
+  auto path = std::make_shared<nav2_msgs::msg::CompactPath>();
+  path->x = {1.0f, 2.0f};
+  path->y = {0.0f, 0.0f};
+  path->yaw = {0.0f, 0.0f};
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(path));
+
+  EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
+  while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
+    tree_->rootNode()->executeTick();
+  }
+  EXPECT_TRUE(action_server_->getCurrentGoal()->path.poses.empty());
+  ASSERT_EQ(action_server_->getCurrentGoal()->compact_path.x.size(), 2u);
+  EXPECT_EQ(action_server_->getCurrentGoal()->compact_path.x[1], 2.0f);
+
+  // only the poses of a view are sent
+  tree_->rootNode()->halt();
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(path, 1, 2));
+  EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
   while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
     tree_->rootNode()->executeTick();
   }
+  ASSERT_EQ(action_server_->getCurrentGoal()->compact_path.x.size(), 1u);
+  EXPECT_EQ(action_server_->getCurrentGoal()->compact_path.x[0], 2.0f);
 }
 
 int main(int argc, char ** argv)
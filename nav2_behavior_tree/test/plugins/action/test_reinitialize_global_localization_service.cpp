@@ -98,7 +98,12 @@ TEST_F(ReinitializeGlobalLocalizationServiceTestFixture, test_tick)
       </root>)";
 
   tree_ = std::make_shared<BT::Tree>(factory_->createTreeFromText(xml_txt, config_->blackboard));
-  EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::SUCCESS);
+  // the request is sent on the first tick and the response picked up on a later one
+  auto status = BT::NodeStatus::RUNNING;
+  while (status == BT::NodeStatus::RUNNING) {
+    status = tree_->rootNode()->executeTick();
+  }
+  EXPECT_EQ(status, BT::NodeStatus::SUCCESS);
 }
 
 int main(int argc, char ** argv)
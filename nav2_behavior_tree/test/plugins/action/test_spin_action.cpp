@@ -141,6 +141,11 @@ TEST_F(SpinActionTestFixture, test_tick)
   EXPECT_EQ(config_->blackboard->get<int>("number_recoveries"), 0);
   EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
   EXPECT_EQ(config_->blackboard->get<int>("number_recoveries"), 1);
+
+  // the goal reaches the server while the node keeps running
+  while (!action_server_->getCurrentGoal()) {
+    EXPECT_EQ(tree_->rootNode()->executeTick(), BT::NodeStatus::RUNNING);
+  }
   EXPECT_EQ(action_server_->getCurrentGoal()->target_yaw, 3.14f);
 }
 
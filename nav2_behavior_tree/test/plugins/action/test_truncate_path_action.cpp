@@ -20,6 +20,7 @@
 
 #include "nav_msgs/msg/path.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_util/compact_path.hpp"
 #include "nav2_util/geometry_utils.hpp"
 
 #include "behaviortree_cpp_v3/bt_factory.h"
@@ -140,6 +141,41 @@ TEST_F(TruncatePathTestFixture, test_tick)
   EXPECT_NEAR(y, 0.463, 0.001);
 }
 
+TEST_F(TruncatePathTestFixture, test_tick_compact)
+{
+  std::string xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+          <TruncatePath distance="1.0" input_compact_path="{compact_path}"
+            output_compact_path="{truncated_compact_path}"/>
+        </BehaviorTree>
+      </root>)";
+
+  tree_ = std::make_shared<BT::Tree>(factory_->createTreeFromText(xml_txt, config_->blackboard));
+
+  auto path = std::make_shared<nav2_msgs::msg::CompactPath>();
+  path->x = {0.0f, 0.5f, 0.9f, 1.5f};
+  path->y = {0.0f, 0.0f, 0.0f, 0.5f};
+  path->yaw = {0.0f, 0.0f, 0.0f, 0.0f};
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(path));
+
+  while (tree_->rootNode()->status() != BT::NodeStatus::SUCCESS) {
+    tree_->rootNode()->executeTick();
+  }
+
+  nav2_util::CompactPathView truncated_path;
+  config_->blackboard->get("truncated_compact_path", truncated_path);
+
+  // a view of the same path, left as it was
+  EXPECT_EQ(truncated_path.path(), path);
+  EXPECT_EQ(path->x.size(), 4u);
+  EXPECT_EQ(path->yaw[1], 0.0f);
+  EXPECT_EQ(truncated_path.size(), 2u);
+  EXPECT_NEAR(truncated_path.yaw(1), 0.463, 0.001);
+  EXPECT_NEAR(truncated_path.toCompactPath().yaw.back(), 0.463, 0.001);
+}
+
 int main(int argc, char ** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
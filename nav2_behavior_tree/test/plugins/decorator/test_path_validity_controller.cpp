@@ -0,0 +1,183 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_msgs/msg/costmap.hpp"
+
+#include "../../test_behavior_tree_fixture.hpp"
+#include "../../test_dummy_tree_node.hpp"
+#include "nav2_behavior_tree/plugins/decorator/path_validity_controller.hpp"
+
+class PathValidityControllerTestFixture : public nav2_behavior_tree::BehaviorTreeTestFixture
+{
+public:
+  void SetUp()
+  {
+    BT::NodeConfiguration config = *config_;
+    config.input_ports["path"] = "{path}";
+    config.input_ports["costmap_topic"] = "test_costmap";
+    config.input_ports["max_period"] = "1000.0";
+
+    config_->blackboard->set("goal", geometry_msgs::msg::PoseStamped());
+    config_->blackboard->set("path", makePath(0.0));
+
+    bt_node_ = std::make_shared<nav2_behavior_tree::PathValidityController>(
+      "path_validity_controller", config);
+    dummy_node_ = std::make_shared<nav2_behavior_tree::DummyNode>();
+    bt_node_->setChild(dummy_node_.get());
+
+    costmap_pub_ = node_->create_publisher<nav2_msgs::msg::Costmap>(
+      "test_costmap", rclcpp::SystemDefaultsQoS());
+  }
+
+  void TearDown()
+  {
+    costmap_pub_.reset();
+    dummy_node_.reset();
+    bt_node_.reset();
+  }
+
+  // A straight path along x from the robot at the origin
+  static nav_msgs::msg::Path makePath(double y)
+  {
+    nav_msgs::msg::Path path;
+    path.header.frame_id = "map";
+    for (int i = 0; i <= 20; i++) {
+      geometry_msgs::msg::PoseStamped pose;
+      pose.header.frame_id = "map";
+      pose.pose.position.x = i * 0.1;
+      pose.pose.position.y = y;
+      path.poses.push_back(pose);
+    }
+    return path;
+  }
+
+  // A 4m x 4m costmap around the origin with one blocked cell at (x, y)
+  static nav2_msgs::msg::Costmap makeCostmap(double x, double y)
+  {
+    nav2_msgs::msg::Costmap costmap;
+    costmap.header.frame_id = "map";
+    costmap.metadata.resolution = 0.1;
+    costmap.metadata.size_x = 40;
+    costmap.metadata.size_y = 40;
+    costmap.metadata.origin.position.x = -2.0;
+    costmap.metadata.origin.position.y = -2.0;
+    costmap.data.assign(40 * 40, 0);
+    costmap.data[static_cast<int>((y + 2.0) / 0.1) * 40 + static_cast<int>((x + 2.0) / 0.1)] = 254;
+    return costmap;
+  }
+
+protected:
+  static std::shared_ptr<nav2_behavior_tree::PathValidityController> bt_node_;
+  static std::shared_ptr<nav2_behavior_tree::DummyNode> dummy_node_;
+  static rclcpp::Publisher<nav2_msgs::msg::Costmap>::SharedPtr costmap_pub_;
+};
+
+std::shared_ptr<nav2_behavior_tree::PathValidityController>
+PathValidityControllerTestFixture::bt_node_ = nullptr;
+std::shared_ptr<nav2_behavior_tree::DummyNode>
+PathValidityControllerTestFixture::dummy_node_ = nullptr;
+rclcpp::Publisher<nav2_msgs::msg::Costmap>::SharedPtr
+PathValidityControllerTestFixture::costmap_pub_ = nullptr;
+
+TEST_F(PathValidityControllerTestFixture, test_behavior)
+{
+  EXPECT_EQ(bt_node_->status(), BT::NodeStatus::IDLE);
+
+  // the child is ticked the first time through
+  dummy_node_->changeStatus(BT::NodeStatus::SUCCESS);
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::SUCCESS);
+
+  // nothing changed, so no replanning
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::RUNNING);
+
+  // a new goal needs a new path
+  geometry_msgs::msg::PoseStamped goal;
+  goal.pose.position.x = 2.0;
+  config_->blackboard->set("goal", goal);
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::SUCCESS);
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::RUNNING);
+
+  // the robot is too far from the path
+  config_->blackboard->set("path", makePath(2.0));
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::SUCCESS);
+  config_->blackboard->set("path", makePath(0.0));
+  EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::RUNNING);
+
+  // an obstacle off the path doesn't matter
+  auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+    costmap_pub_->publish(makeCostmap(1.0, 1.0));
+    EXPECT_EQ(bt_node_->executeTick(), BT::NodeStatus::RUNNING);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // an obstacle on the path ahead of the robot causes a replan
+  BT::NodeStatus status = BT::NodeStatus::RUNNING;
+  start = std::chrono::steady_clock::now();
+  while (status == BT::NodeStatus::RUNNING &&
+    std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+  {
+    costmap_pub_->publish(makeCostmap(1.0, 0.0));
+    status = bt_node_->executeTick();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(status, BT::NodeStatus::SUCCESS);
+}
+
+TEST_F(PathValidityControllerTestFixture, test_compact_path)
+{
+  BT::NodeConfiguration config = *config_;
+  config.input_ports["compact_path"] = "{compact_path}";
+  config.input_ports["costmap_topic"] = "test_costmap";
+  config.input_ports["max_period"] = "1000.0";
+
+  auto on_path = std::make_shared<nav2_msgs::msg::CompactPath>(
+    nav2_util::toCompactPath(makePath(0.0)));
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(on_path));
+
+  nav2_behavior_tree::PathValidityController bt_node("path_validity_controller", config);
+  bt_node.setChild(dummy_node_.get());
+
+  dummy_node_->changeStatus(BT::NodeStatus::SUCCESS);
+  EXPECT_EQ(bt_node.executeTick(), BT::NodeStatus::SUCCESS);
+  EXPECT_EQ(bt_node.executeTick(), BT::NodeStatus::RUNNING);
+
+  // the robot is too far from the part of the path viewed
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(on_path, 15, 21));
+  EXPECT_EQ(bt_node.executeTick(), BT::NodeStatus::SUCCESS);
+  config_->blackboard->set("compact_path", nav2_util::CompactPathView(on_path));
+  EXPECT_EQ(bt_node.executeTick(), BT::NodeStatus::RUNNING);
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // initialize ROS
+  rclcpp::init(argc, argv);
+
+  bool all_successful = RUN_ALL_TESTS();
+
+  // shutdown ROS
+  rclcpp::shutdown();
+
+  return all_successful;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "geometry_msgs/msg/point.hpp"
+
+#include "behaviortree_cpp_v3/bt_factory.h"
+#include "nav2_behavior_tree/bt_cached_input.hpp"
+
+class PointNode : public BT::SyncActionNode
+{
+public:
+  PointNode(const std::string & name, const BT::NodeConfiguration & config)
+  : SyncActionNode(name, config), point(*this, "test")
+  {}
+
+  BT::NodeStatus tick() override
+  {
+    return BT::NodeStatus::SUCCESS;
+  }
+
+  static BT::PortsList providedPorts()
+  {
+    return {
+      BT::InputPort<geometry_msgs::msg::Point>("test")
+    };
+  }
+
+  nav2_behavior_tree::CachedInput<geometry_msgs::msg::Point> point;
+};
+
+TEST(CachedInputTest, test_literal)
+{
+  std::string xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+            <PointNode test="1.0;2.0;3.0" />
+        </BehaviorTree>
+      </root>)";
+
+  BT::BehaviorTreeFactory factory;
+  factory.registerNodeType<PointNode>("PointNode");
+  auto tree = factory.createTreeFromText(xml_txt);
+  auto node = static_cast<PointNode *>(tree.rootNode());
+
+  geometry_msgs::msg::Point value;
+  EXPECT_TRUE(node->point.get(value));
+  EXPECT_EQ(value.x, 1.0);
+  EXPECT_EQ(value.y, 2.0);
+  EXPECT_EQ(value.z, 3.0);
+
+  xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+            <PointNode test="1.0;2.0" />
+        </BehaviorTree>
+      </root>)";
+
+  tree = factory.createTreeFromText(xml_txt);
+  node = static_cast<PointNode *>(tree.rootNode());
+  EXPECT_FALSE(node->point.get(value));
+}
+
+TEST(CachedInputTest, test_blackboard)
+{
+  std::string xml_txt =
+    R"(
+      <root main_tree_to_execute = "MainTree" >
+        <BehaviorTree ID="MainTree">
+            <PointNode test="{point}" />
+        </BehaviorTree>
+      </root>)";
+
+  BT::BehaviorTreeFactory factory;
+  factory.registerNodeType<PointNode>("PointNode");
+  auto blackboard = BT::Blackboard::create();
+  auto tree = factory.createTreeFromText(xml_txt, blackboard);
+  auto node = static_cast<PointNode *>(tree.rootNode());
+
+  geometry_msgs::msg::Point value;
+  EXPECT_FALSE(node->point.get(value));
+
+  // Every read sees the current entry
+  blackboard->set<std::string>("point", "1.0;2.0;3.0");
+  EXPECT_TRUE(node->point.get(value));
+  EXPECT_EQ(value.x, 1.0);
+  blackboard->set<std::string>("point", "4.0;5.0;6.0");
+  EXPECT_TRUE(node->point.get(value));
+  EXPECT_EQ(value.x, 4.0);
+  EXPECT_EQ(value.z, 6.0);
+
+  geometry_msgs::msg::Point point;
+  point.y = 7.0;
+  blackboard->set("point", point);
+  EXPECT_TRUE(node->point.get(value));
+  EXPECT_EQ(value.x, 0.0);
+  EXPECT_EQ(value.y, 7.0);
+}
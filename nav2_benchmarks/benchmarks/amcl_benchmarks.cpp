@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_amcl/pf/pf.hpp"
+#include "nav2_amcl/sensors/laser/laser.hpp"
+#include "nav2_benchmarks/synthetic_maps.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace
+{
+
+const int MAP_SIZE = 400;
+const double MAP_RESOLUTION = 0.05;
+const int BEAMS = 360;
+
+// The rooms map, converted the way AmclNode::convertMap does
+map_t * makeMap()
+{
+  const auto grid = nav2_benchmarks::roomsAndCorridors(MAP_SIZE, MAP_SIZE);
+  map_t * map = map_alloc();
+  map_alloc_cells(map, MAP_SIZE, MAP_SIZE);
+  map->scale = MAP_RESOLUTION;
+  map->origin_x = (map->size_x / 2) * map->scale;
+  map->origin_y = (map->size_y / 2) * map->scale;
+  for (std::size_t i = 0; i < grid.size(); ++i) {
+    map->occ_state[i] = grid[i] == nav2_benchmarks::OCCUPIED_CELL ? +1 : -1;
+  }
+  return map;
+}
+
+pf_vector_t uniformPose(void * data)
+{
+  map_t * map = reinterpret_cast<map_t *>(data);
+  pf_vector_t pose = pf_vector_zero();
+  pose.v[0] = map->size_x * map->scale * drand48();
+  pose.v[1] = map->size_y * map->scale * drand48();
+  pose.v[2] = 2.0 * M_PI * drand48() - M_PI;
+  return pose;
+}
+
+// The middle of a room, with the filter initialized around it as from an initial pose
+struct Filter
+{
+  explicit Filter(int particles, int threads)
+  : map(makeMap()),
+    model(0.5, 0.5, 0.2, 2.0, 60, map)
+  {
+    srand48(42);
+    pf = pf_alloc(particles / 10, particles, 0.0, 0.0, uniformPose, map);
+    mean = pf_vector_zero();
+    mean.v[0] = 10.5;
+    mean.v[1] = 10.5;
+    cov = pf_matrix_zero();
+    cov.m[0][0] = 0.25;
+    cov.m[1][1] = 0.25;
+    cov.m[2][2] = 0.07;
+    pf_init(pf, mean, cov);
+
+    pf_vector_t laser_pose = pf_vector_zero();
+    model.SetLaserPose(laser_pose);
+    if (threads > 0) {
+      model.setThreadPool(std::make_shared<nav2_util::ThreadPool>(threads));
+    }
+
+    // A scan ray cast from the true pose
+    scan.laser = &model;
+    scan.range_max = 12.0;
+    scan.setRangeCount(BEAMS);
+    for (int i = 0; i < BEAMS; ++i) {
+      const double bearing = -M_PI + 2.0 * M_PI * i / BEAMS;
+      scan.ranges[i][0] = map_calc_range(map, mean.v[0], mean.v[1], bearing, scan.range_max);
+      scan.ranges[i][1] = bearing;
+    }
+  }
+
+  ~Filter()
+  {
+    pf_free(pf);
+    map_free(map);
+  }
+
+  map_t * map;
+  nav2_amcl::LikelihoodFieldModel model;
+  nav2_amcl::LaserData scan;
+  pf_t * pf;
+  pf_vector_t mean;
+  pf_matrix_t cov;
+};
+
+}  // namespace
+
+// Weighing every particle against one scan, args: {particles, weighing threads}
+static void BM_LikelihoodFieldSensorUpdate(benchmark::State & state)
+{
+  Filter filter(state.range(0), state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filter.model.sensorUpdate(filter.pf, &filter.scan));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LikelihoodFieldSensorUpdate)
+->ArgNames({"particles", "threads"})
+->Args({500, 0})
+->Args({2000, 0})
+->Args({5000, 0})
+->Args({5000, 4})
+->Unit(benchmark::kMicrosecond);
+
+// Resampling a freshly weighed set, args: {particles}
+static void BM_PfUpdateResample(benchmark::State & state)
+{
+  Filter filter(state.range(0), 0);
+  for (auto _ : state) {
+    // Resampling shrinks the set, start every iteration from a full, weighed one
+    state.PauseTiming();
+    pf_init(filter.pf, filter.mean, filter.cov);
+    filter.model.sensorUpdate(filter.pf, &filter.scan);
+    state.ResumeTiming();
+
+    pf_update_resample(filter.pf);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PfUpdateResample)->Arg(500)->Arg(2000)->Arg(5000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,352 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "geometry_msgs/msg/point.hpp"
+#include "nav2_benchmarks/synthetic_maps.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/footprint_collision_checker.hpp"
+#include "nav2_costmap_2d/inflation_layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+#include "nav2_costmap_2d/observation.hpp"
+#include "nav2_costmap_2d/tiled_grid.hpp"
+#include "nav2_util/line_iterator.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+#include "tf2_ros/buffer.h"
+
+using nav2_benchmarks::MapKind;
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+namespace
+{
+
+const double RESOLUTION = 0.05;
+
+// Exposes the ray tracing Costmap2D keeps for its subclasses
+class RaytracingCostmap : public nav2_costmap_2d::Costmap2D
+{
+public:
+  using nav2_costmap_2d::Costmap2D::Costmap2D;
+
+  void clearRay(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+  {
+    MarkCell marker(costmap_, nav2_costmap_2d::FREE_SPACE);
+    raytraceLine(marker, x0, y0, x1, y1);
+  }
+};
+
+nav2_util::LifecycleNode::SharedPtr makeNode(const std::vector<rclcpp::Parameter> & parameters)
+{
+  auto options = rclcpp::NodeOptions();
+  options.parameter_overrides(parameters);
+  auto node = std::make_shared<nav2_util::LifecycleNode>(
+    "costmap_benchmarks", "", false, options);
+
+  // The parameters Costmap2DROS declares for its layers
+  node->declare_parameter("map_topic", rclcpp::ParameterValue(std::string("map")));
+  node->declare_parameter("track_unknown_space", rclcpp::ParameterValue(false));
+  node->declare_parameter("use_maximum", rclcpp::ParameterValue(false));
+  node->declare_parameter("lethal_cost_threshold", rclcpp::ParameterValue(100));
+  node->declare_parameter(
+    "unknown_cost_value",
+    rclcpp::ParameterValue(static_cast<unsigned char>(0xff)));
+  node->declare_parameter("trinary_costmap", rclcpp::ParameterValue(true));
+  node->declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.3));
+  node->declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
+  return node;
+}
+
+std::vector<geometry_msgs::msg::Point> squareFootprint(double half_side)
+{
+  std::vector<geometry_msgs::msg::Point> footprint(4);
+  footprint[0].x = half_side;
+  footprint[0].y = half_side;
+  footprint[1].x = -half_side;
+  footprint[1].y = half_side;
+  footprint[2].x = -half_side;
+  footprint[2].y = -half_side;
+  footprint[3].x = half_side;
+  footprint[3].y = -half_side;
+  return footprint;
+}
+
+// A 2D scan as a point cloud, one point per beam on a circle around (x, y)
+sensor_msgs::msg::PointCloud2 ringCloud(double x, double y, double range, unsigned int beams)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  sensor_msgs::PointCloud2Modifier modifier(cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(beams);
+  sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+  for (unsigned int i = 0; i < beams; ++i, ++iter_x, ++iter_y, ++iter_z) {
+    const double angle = 2.0 * M_PI * i / beams;
+    *iter_x = x + range * std::cos(angle);
+    *iter_y = y + range * std::sin(angle);
+    *iter_z = 0.5;
+  }
+  return cloud;
+}
+
+// Height of the wide maps the row-major and tiled layouts are compared on
+const unsigned int WIDE_MAP_HEIGHT = 1000;
+
+// Corners of a 20 cell square footprint at poses spread over a wide map, four per pose
+std::vector<int> footprintCorners(unsigned int size_x, unsigned int size_y, std::size_t poses)
+{
+  const double half_side = 10.0;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> pick_x(half_side * 1.5, size_x - half_side * 1.5);
+  std::uniform_real_distribution<double> pick_y(half_side * 1.5, size_y - half_side * 1.5);
+  std::uniform_real_distribution<double> pick_theta(-M_PI, M_PI);
+  const double corners[4][2] = {
+    {half_side, half_side}, {-half_side, half_side}, {-half_side, -half_side},
+    {half_side, -half_side}};
+
+  std::vector<int> points;
+  points.reserve(poses * 8);
+  for (std::size_t i = 0; i < poses; ++i) {
+    const double x = pick_x(generator);
+    const double y = pick_y(generator);
+    const double theta = pick_theta(generator);
+    for (const auto & corner : corners) {
+      points.push_back(
+        static_cast<int>(x + corner[0] * std::cos(theta) - corner[1] * std::sin(theta)));
+      points.push_back(
+        static_cast<int>(y + corner[0] * std::sin(theta) + corner[1] * std::cos(theta)));
+    }
+  }
+  return points;
+}
+
+// Highest cost of the outlines of the footprints, as FootprintCollisionChecker walks them
+template<typename LineCost>
+double outlinesCost(const std::vector<int> & corners, LineCost line_cost)
+{
+  double cost = 0.0;
+  for (std::size_t i = 0; i < corners.size(); i += 8) {
+    for (std::size_t j = 0; j < 8; j += 2) {
+      const std::size_t k = (j + 2) % 8;
+      cost = std::max(
+        cost, line_cost(corners[i + j], corners[i + k], corners[i + j + 1], corners[i + k + 1]));
+    }
+  }
+  return cost;
+}
+
+}  // namespace
+
+// Full inflation pass over the whole map, args: {map side in cells, MapKind}
+static void BM_InflationUpdateCosts(benchmark::State & state)
+{
+  const unsigned int size = state.range(0);
+  auto node = makeNode(
+    {rclcpp::Parameter("inflation.inflation_radius", 0.55),
+      rclcpp::Parameter("inflation.cost_scaling_factor", 3.0)});
+  tf2_ros::Buffer tf(node->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap layers("map", false, false);
+  layers.resizeMap(size, size, RESOLUTION, 0.0, 0.0);
+  auto ilayer = std::make_shared<nav2_costmap_2d::InflationLayer>();
+  ilayer->initialize(&layers, "inflation", &tf, node, nullptr, nullptr);
+  layers.addPlugin(ilayer);
+  layers.setFootprint(squareFootprint(0.2));
+
+  // Inflation only raises costs, so passes after the first see the same input
+  nav2_costmap_2d::Costmap2D * master = layers.getCostmap();
+  const auto grid = nav2_benchmarks::syntheticMap(static_cast<MapKind>(state.range(1)), size, size);
+  std::copy(grid.begin(), grid.end(), master->getCharMap());
+
+  for (auto _ : state) {
+    ilayer->updateCosts(*master, 0, 0, size, size);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_InflationUpdateCosts)
+->Args({200, static_cast<int>(MapKind::RANDOM_OBSTACLES)})
+->Args({200, static_cast<int>(MapKind::ROOMS)})
+->Args({1000, static_cast<int>(MapKind::RANDOM_OBSTACLES)})
+->Args({1000, static_cast<int>(MapKind::ROOMS)})
+->Unit(benchmark::kMillisecond);
+
+// 360 rays from the center of the map, args: {ray length in cells}
+static void BM_RaytraceLine(benchmark::State & state)
+{
+  const unsigned int length = state.range(0);
+  const unsigned int size = 2 * length + 2;
+  RaytracingCostmap costmap(size, size, RESOLUTION, 0.0, 0.0);
+
+  std::vector<unsigned int> ends_x, ends_y;
+  for (int degree = 0; degree < 360; ++degree) {
+    const double angle = degree * M_PI / 180.0;
+    ends_x.push_back(static_cast<unsigned int>(size / 2 + length * std::cos(angle)));
+    ends_y.push_back(static_cast<unsigned int>(size / 2 + length * std::sin(angle)));
+  }
+
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < ends_x.size(); ++i) {
+      costmap.clearRay(size / 2, size / 2, ends_x[i], ends_y[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * ends_x.size());
+}
+BENCHMARK(BM_RaytraceLine)->Arg(20)->Arg(100)->Arg(500)->Unit(benchmark::kMicrosecond);
+
+// One marking and clearing cycle of a scan 5 m around the robot, args: {beams}
+static void BM_ObstacleLayerUpdate(benchmark::State & state)
+{
+  const unsigned int size = 400;
+  const double center = size * RESOLUTION / 2.0;
+  auto node = makeNode({});
+  tf2_ros::Buffer tf(node->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap layers("map", false, false);
+  layers.resizeMap(size, size, RESOLUTION, 0.0, 0.0);
+  auto olayer = std::make_shared<nav2_costmap_2d::ObstacleLayer>();
+  olayer->initialize(&layers, "obstacles", &tf, node, nullptr, nullptr);
+  layers.addPlugin(olayer);
+  layers.setFootprint(squareFootprint(0.2));
+
+  geometry_msgs::msg::Point origin;
+  origin.x = center;
+  origin.y = center;
+  origin.z = 0.5;
+  nav2_costmap_2d::Observation observation(
+    origin, ringCloud(center, center, 5.0, state.range(0)), 6.0, 6.0);
+  olayer->addStaticObservation(observation, true, true);
+
+  nav2_costmap_2d::Costmap2D * master = layers.getCostmap();
+  for (auto _ : state) {
+    double min_x = 1e30, min_y = 1e30, max_x = -1e30, max_y = -1e30;
+    olayer->updateBounds(center, center, 0.0, &min_x, &min_y, &max_x, &max_y);
+
+    int min_i, min_j, max_i, max_j;
+    master->worldToMapEnforceBounds(min_x, min_y, min_i, min_j);
+    master->worldToMapEnforceBounds(max_x, max_y, max_i, max_j);
+    olayer->updateCosts(*master, min_i, min_j, max_i + 1, max_j + 1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ObstacleLayerUpdate)->Arg(360)->Arg(1440)->Unit(benchmark::kMicrosecond);
+
+// FootprintCollisionChecker::lineCost over the outlines of 4096 footprints on a row-major
+// Costmap2D, args: {map width in cells}
+static void BM_LineCostRowMajor(benchmark::State & state)
+{
+  const unsigned int size_x = state.range(0);
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(
+    size_x, WIDE_MAP_HEIGHT, RESOLUTION, 0.0, 0.0);
+  const auto grid = nav2_benchmarks::randomObstacles(size_x, WIDE_MAP_HEIGHT);
+  std::copy(grid.begin(), grid.end(), costmap->getCharMap());
+  nav2_costmap_2d::FootprintCollisionChecker checker(costmap);
+  const auto corners = footprintCorners(size_x, WIDE_MAP_HEIGHT, 4096);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      outlinesCost(
+        corners, [&checker](int x0, int x1, int y0, int y1) {
+          return checker.lineCost(x0, x1, y0, y1);
+        }));
+  }
+  state.SetItemsProcessed(state.iterations() * corners.size() / 2);
+}
+BENCHMARK(BM_LineCostRowMajor)->Arg(2000)->Arg(8000)->Unit(benchmark::kMicrosecond);
+
+// The same walks as BM_LineCostRowMajor over a TiledGrid of the same map,
+// args: {map width in cells}
+static void BM_LineCostTiled(benchmark::State & state)
+{
+  const unsigned int size_x = state.range(0);
+  nav2_costmap_2d::TiledGrid tiled(size_x, WIDE_MAP_HEIGHT);
+  tiled.copyFromRowMajor(nav2_benchmarks::randomObstacles(size_x, WIDE_MAP_HEIGHT).data());
+  const auto corners = footprintCorners(size_x, WIDE_MAP_HEIGHT, 4096);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      outlinesCost(
+        corners, [&tiled](int x0, int x1, int y0, int y1) {
+          return nav2_util::maxCostAlongLine(
+            nav2_util::LineIterator(x0, y0, x1, y1),
+            [&tiled](int x, int y) {return static_cast<double>(tiled.getCost(x, y));},
+            static_cast<double>(nav2_costmap_2d::NO_INFORMATION));
+        }));
+  }
+  state.SetItemsProcessed(state.iterations() * corners.size() / 2);
+}
+BENCHMARK(BM_LineCostTiled)->Arg(2000)->Arg(8000)->Unit(benchmark::kMicrosecond);
+
+// Lethal cells of every row of a row-major Costmap2D, args: {map width in cells}
+static void BM_RowScanRowMajor(benchmark::State & state)
+{
+  const unsigned int size_x = state.range(0);
+  nav2_costmap_2d::Costmap2D costmap(size_x, WIDE_MAP_HEIGHT, RESOLUTION, 0.0, 0.0);
+  const auto grid = nav2_benchmarks::randomObstacles(size_x, WIDE_MAP_HEIGHT);
+  std::copy(grid.begin(), grid.end(), costmap.getCharMap());
+
+  for (auto _ : state) {
+    std::size_t lethal = 0;
+    for (unsigned int y = 0; y < WIDE_MAP_HEIGHT; ++y) {
+      const unsigned char * row = costmap.getCharMap() + costmap.getIndex(0, y);
+      lethal += std::count(row, row + size_x, nav2_costmap_2d::LETHAL_OBSTACLE);
+    }
+    benchmark::DoNotOptimize(lethal);
+  }
+  state.SetItemsProcessed(state.iterations() * size_x * WIDE_MAP_HEIGHT);
+}
+BENCHMARK(BM_RowScanRowMajor)->Arg(2000)->Arg(8000)->Unit(benchmark::kMicrosecond);
+
+// The same count over a TiledGrid, a row being visited as per tile runs,
+// args: {map width in cells}
+static void BM_RowScanTiled(benchmark::State & state)
+{
+  const unsigned int size_x = state.range(0);
+  nav2_costmap_2d::TiledGrid tiled(size_x, WIDE_MAP_HEIGHT);
+  tiled.copyFromRowMajor(nav2_benchmarks::randomObstacles(size_x, WIDE_MAP_HEIGHT).data());
+
+  for (auto _ : state) {
+    std::size_t lethal = 0;
+    for (unsigned int y = 0; y < WIDE_MAP_HEIGHT; ++y) {
+      tiled.forEachRowSegment(
+        y, 0, size_x, [&lethal](const unsigned char * run, unsigned int, unsigned int length) {
+          lethal += std::count(run, run + length, nav2_costmap_2d::LETHAL_OBSTACLE);
+        });
+    }
+    benchmark::DoNotOptimize(lethal);
+  }
+  state.SetItemsProcessed(state.iterations() * size_x * WIDE_MAP_HEIGHT);
+}
+BENCHMARK(BM_RowScanTiled)->Arg(2000)->Arg(8000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,178 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "dwb_core/dwb_local_planner.hpp"
+#include "dwb_core/illegal_trajectory_tracker.hpp"
+#include "nav2_benchmarks/synthetic_maps.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_ros/buffer.h"
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+namespace
+{
+
+const char PLUGIN_NAME[] = "FollowPath";
+
+enum class Scoring : int
+{
+  SERIAL = 0,
+  BATCH = 1,
+  PARALLEL = 2,
+};
+
+// Runs one control cycle's scoring without the plan transform, which needs TF
+class ScoringPlanner : public dwb_core::DWBLocalPlanner
+{
+public:
+  void prepareCritics(
+    const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity,
+    const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & plan)
+  {
+    for (auto & critic : critics_) {
+      critic->prepare(pose, velocity, goal, plan);
+    }
+  }
+
+  dwb_msgs::msg::TrajectoryScore score(
+    const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity)
+  {
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results;
+    return coreScoringAlgorithm(pose, velocity, results);
+  }
+};
+
+std::vector<rclcpp::Parameter> plannerParameters(int samples, Scoring scoring)
+{
+  // The turtlebot3 configuration of nav2_bringup
+  const std::string prefix = std::string(PLUGIN_NAME) + ".";
+  return {
+    rclcpp::Parameter(prefix + "max_vel_x", 0.26),
+    rclcpp::Parameter(prefix + "max_vel_theta", 1.0),
+    rclcpp::Parameter(prefix + "max_speed_xy", 0.26),
+    rclcpp::Parameter(prefix + "acc_lim_x", 2.5),
+    rclcpp::Parameter(prefix + "acc_lim_theta", 3.2),
+    rclcpp::Parameter(prefix + "decel_lim_x", -2.5),
+    rclcpp::Parameter(prefix + "decel_lim_theta", -3.2),
+    rclcpp::Parameter(prefix + "vx_samples", samples),
+    rclcpp::Parameter(prefix + "vtheta_samples", samples),
+    rclcpp::Parameter(prefix + "sim_time", 1.7),
+    rclcpp::Parameter(prefix + "linear_granularity", 0.05),
+    rclcpp::Parameter(prefix + "angular_granularity", 0.025),
+    rclcpp::Parameter(prefix + "xy_goal_tolerance", 0.25),
+    rclcpp::Parameter(
+      prefix + "critics",
+      std::vector<std::string>{
+      "RotateToGoal", "Oscillation", "BaseObstacle", "GoalAlign", "PathAlign", "PathDist",
+      "GoalDist"}),
+    rclcpp::Parameter(prefix + "BaseObstacle.scale", 0.02),
+    rclcpp::Parameter(prefix + "PathAlign.scale", 32.0),
+    rclcpp::Parameter(prefix + "PathAlign.forward_point_distance", 0.1),
+    rclcpp::Parameter(prefix + "GoalAlign.scale", 24.0),
+    rclcpp::Parameter(prefix + "GoalAlign.forward_point_distance", 0.1),
+    rclcpp::Parameter(prefix + "PathDist.scale", 32.0),
+    rclcpp::Parameter(prefix + "GoalDist.scale", 24.0),
+    rclcpp::Parameter(prefix + "RotateToGoal.scale", 32.0),
+    rclcpp::Parameter(prefix + "batch_scoring", scoring == Scoring::BATCH),
+    rclcpp::Parameter(
+      prefix + "parallel_scoring_threads", scoring == Scoring::PARALLEL ? 4 : 1),
+  };
+}
+
+// A 4 m local costmap with scattered obstacles, kept clear around the robot
+std::shared_ptr<nav2_costmap_2d::Costmap2DROS> makeCostmap()
+{
+  auto costmap_ros = std::make_shared<nav2_costmap_2d::Costmap2DROS>("local_costmap");
+  costmap_ros->set_parameter(rclcpp::Parameter("plugins", std::vector<std::string>{}));
+  costmap_ros->set_parameter(rclcpp::Parameter("global_frame", std::string("odom")));
+  costmap_ros->set_parameter(rclcpp::Parameter("width", 4));
+  costmap_ros->set_parameter(rclcpp::Parameter("height", 4));
+  costmap_ros->set_parameter(rclcpp::Parameter("resolution", 0.05));
+  costmap_ros->set_parameter(rclcpp::Parameter("robot_radius", 0.22));
+  costmap_ros->configure();
+
+  nav2_costmap_2d::Costmap2D * costmap = costmap_ros->getCostmap();
+  const unsigned int size = costmap->getSizeInCellsX();
+  auto grid = nav2_benchmarks::randomObstacles(size, size, 0.03);
+  for (unsigned int y = size / 2 - 8; y < size / 2 + 8; ++y) {
+    std::fill_n(&grid[y * size + size / 2 - 8], 16, nav2_benchmarks::FREE_CELL);
+  }
+  std::copy(grid.begin(), grid.end(), costmap->getCharMap());
+  return costmap_ros;
+}
+
+}  // namespace
+
+// Scoring every sampled twist once, args: {vx and vtheta samples, Scoring}
+static void BM_CoreScoringAlgorithm(benchmark::State & state)
+{
+  auto options = rclcpp::NodeOptions();
+  options.parameter_overrides(
+    plannerParameters(state.range(0), static_cast<Scoring>(state.range(1))));
+  auto node = std::make_shared<nav2_util::LifecycleNode>("dwb_benchmarks", "", false, options);
+  auto costmap_ros = makeCostmap();
+  auto tf = std::make_shared<tf2_ros::Buffer>(node->get_clock());
+
+  ScoringPlanner planner;
+  planner.configure(node, PLUGIN_NAME, tf, costmap_ros);
+
+  geometry_msgs::msg::Pose2D pose;
+  pose.x = 2.0;
+  pose.y = 2.0;
+  nav_2d_msgs::msg::Twist2D velocity;
+  velocity.x = 0.15;
+
+  nav_2d_msgs::msg::Path2D plan;
+  plan.header.frame_id = "odom";
+  for (int i = 0; i <= 36; ++i) {
+    geometry_msgs::msg::Pose2D waypoint;
+    waypoint.x = pose.x + 0.05 * i;
+    waypoint.y = pose.y + 0.0004 * i * i;
+    plan.poses.push_back(waypoint);
+  }
+  planner.prepareCritics(pose, velocity, plan.poses.back(), plan);
+
+  for (auto _ : state) {
+    try {
+      benchmark::DoNotOptimize(planner.score(pose, velocity));
+    } catch (const dwb_core::NoLegalTrajectoriesException &) {
+      state.SkipWithError("No legal trajectory");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(0));
+}
+BENCHMARK(BM_CoreScoringAlgorithm)
+->ArgNames({"samples", "scoring"})
+->Args({20, static_cast<int>(Scoring::SERIAL)})
+->Args({40, static_cast<int>(Scoring::SERIAL)})
+->Args({40, static_cast<int>(Scoring::BATCH)})
+->Args({40, static_cast<int>(Scoring::PARALLEL)})
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
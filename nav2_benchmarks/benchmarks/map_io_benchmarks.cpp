@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "ament_index_cpp/get_package_share_directory.hpp"
+#include "benchmark/benchmark.h"
+#include "nav2_benchmarks/synthetic_maps.hpp"
+#include "nav2_map_server/map_io.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+using nav2_benchmarks::MapKind;
+
+// Decoding a synthetic PGM of the given size, args: {map side in pixels, MapKind}
+static void BM_LoadMapFromFile(benchmark::State & state)
+{
+  const unsigned int size = state.range(0);
+  const auto grid = nav2_benchmarks::syntheticMap(static_cast<MapKind>(state.range(1)), size, size);
+
+  nav2_map_server::LoadParameters parameters;
+  parameters.image_file_name = std::string(P_tmpdir) + "/nav2_benchmarks_" +
+    std::to_string(size) + "_" + std::to_string(state.range(1)) + ".pgm";
+  parameters.resolution = 0.05;
+  parameters.free_thresh = 0.196;
+  parameters.occupied_thresh = 0.65;
+  parameters.mode = nav2_map_server::MapMode::Trinary;
+  parameters.negate = false;
+  if (!nav2_benchmarks::writePgm(parameters.image_file_name, grid, size, size)) {
+    state.SkipWithError("Could not write the map image");
+    return;
+  }
+
+  nav_msgs::msg::OccupancyGrid map;
+  for (auto _ : state) {
+    nav2_map_server::loadMapFromFile(parameters, map);
+    benchmark::DoNotOptimize(map.data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+  std::remove(parameters.image_file_name.c_str());
+}
+BENCHMARK(BM_LoadMapFromFile)
+->Args({400, static_cast<int>(MapKind::ROOMS)})
+->Args({2000, static_cast<int>(MapKind::ROOMS)})
+->Args({2000, static_cast<int>(MapKind::RANDOM_OBSTACLES)})
+->Unit(benchmark::kMillisecond);
+
+// Loading the map nav2_bringup ships for the turtlebot3 world, YAML included
+static void BM_LoadMapFromYamlTurtlebot3World(benchmark::State & state)
+{
+  std::string yaml;
+  try {
+    yaml = ament_index_cpp::get_package_share_directory("nav2_bringup") +
+      "/maps/turtlebot3_world.yaml";
+  } catch (const std::exception &) {
+    state.SkipWithError("nav2_bringup is not installed");
+    return;
+  }
+
+  nav_msgs::msg::OccupancyGrid map;
+  for (auto _ : state) {
+    if (nav2_map_server::loadMapFromYaml(yaml, map) != nav2_map_server::LOAD_MAP_SUCCESS) {
+      state.SkipWithError("Could not load the map");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * map.info.width * map.info.height);
+}
+BENCHMARK(BM_LoadMapFromYamlTurtlebot3World)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
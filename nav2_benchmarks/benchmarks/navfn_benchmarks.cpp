@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "nav2_benchmarks/synthetic_maps.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
+
+using nav2_benchmarks::MapKind;
+
+namespace
+{
+
+// Clear a block around a start or goal cell, which may have landed on an obstacle
+void clearAround(std::vector<unsigned char> & grid, int size, int x, int y)
+{
+  for (int j = std::max(0, y - 3); j <= std::min(size - 1, y + 3); ++j) {
+    for (int i = std::max(0, x - 3); i <= std::min(size - 1, x + 3); ++i) {
+      grid[j * size + i] = nav2_benchmarks::FREE_CELL;
+    }
+  }
+}
+
+enum class Search : int
+{
+  DIJKSTRA = 0,
+  DIJKSTRA_BUCKETS = 1,
+  ASTAR = 2,
+};
+
+}  // namespace
+
+// Corner to corner query, args: {map side in cells, MapKind, Search}
+static void BM_NavFn(benchmark::State & state)
+{
+  const int size = state.range(0);
+  auto grid = nav2_benchmarks::syntheticMap(static_cast<MapKind>(state.range(1)), size, size);
+  const Search search = static_cast<Search>(state.range(2));
+
+  // As NavfnPlanner does, the potential is propagated from the goal
+  int start[2] = {size / 10, size / 10};
+  int goal[2] = {size - size / 10, size - size / 10};
+  clearAround(grid, size, start[0], start[1]);
+  clearAround(grid, size, goal[0], goal[1]);
+
+  nav2_navfn_planner::NavFn navfn(size, size);
+  navfn.setCostmap(grid.data(), true, true);
+  navfn.setUseBucketQueue(search == Search::DIJKSTRA_BUCKETS);
+  navfn.setStart(goal);
+  navfn.setGoal(start);
+
+  for (auto _ : state) {
+    const bool found = search == Search::ASTAR ?
+      navfn.calcNavFnAstar() : navfn.calcNavFnDijkstra(true);
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_NavFn)
+->ArgNames({"size", "map", "search"})
+->Args({200, static_cast<int>(MapKind::RANDOM_OBSTACLES), static_cast<int>(Search::DIJKSTRA)})
+->Args({200, static_cast<int>(MapKind::ROOMS), static_cast<int>(Search::DIJKSTRA)})
+->Args({1000, static_cast<int>(MapKind::RANDOM_OBSTACLES), static_cast<int>(Search::DIJKSTRA)})
+->Args({1000, static_cast<int>(MapKind::ROOMS), static_cast<int>(Search::DIJKSTRA)})
+->Args({1000, static_cast<int>(MapKind::ROOMS), static_cast<int>(Search::DIJKSTRA_BUCKETS)})
+->Args({200, static_cast<int>(MapKind::ROOMS), static_cast<int>(Search::ASTAR)})
+->Args({1000, static_cast<int>(MapKind::RANDOM_OBSTACLES), static_cast<int>(Search::ASTAR)})
+->Args({1000, static_cast<int>(MapKind::ROOMS), static_cast<int>(Search::ASTAR)})
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,149 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BENCHMARKS__SYNTHETIC_MAPS_HPP_
+#define NAV2_BENCHMARKS__SYNTHETIC_MAPS_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace nav2_benchmarks
+{
+
+// Cell values of the generated maps, the costmap_2d convention
+const unsigned char FREE_CELL = 0;
+const unsigned char OCCUPIED_CELL = 254;
+
+/**
+ * @brief Maps the benchmarks run on. Every generator is seeded, so that a map
+ * of a given kind and size is the same from one run, and one machine, to the next
+ */
+enum class MapKind : int
+{
+  RANDOM_OBSTACLES = 0,  ///< Square obstacles scattered over open space
+  ROOMS = 1,  ///< Office like grid of rooms joined by doors
+};
+
+/**
+ * @brief Scatter square obstacles until about density of the map is occupied
+ * @param size_x Width in cells
+ * @param size_y Height in cells
+ * @param density Fraction of the cells to occupy, in [0, 1]
+ * @param obstacle_size Side of the obstacles in cells
+ * @param seed Seed of the generator
+ * @return Row major grid of FREE_CELL and OCCUPIED_CELL
+ */
+inline std::vector<unsigned char> randomObstacles(
+  unsigned int size_x, unsigned int size_y, double density = 0.05,
+  unsigned int obstacle_size = 4, uint32_t seed = 42)
+{
+  std::vector<unsigned char> grid(static_cast<std::size_t>(size_x) * size_y, FREE_CELL);
+  if (size_x < obstacle_size || size_y < obstacle_size || obstacle_size == 0) {
+    return grid;
+  }
+
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<unsigned int> pick_x(0, size_x - obstacle_size);
+  std::uniform_int_distribution<unsigned int> pick_y(0, size_y - obstacle_size);
+  const std::size_t count = static_cast<std::size_t>(
+    density * grid.size() / (obstacle_size * obstacle_size));
+
+  for (std::size_t n = 0; n < count; ++n) {
+    const unsigned int x0 = pick_x(generator);
+    const unsigned int y0 = pick_y(generator);
+    for (unsigned int y = y0; y < y0 + obstacle_size; ++y) {
+      std::fill_n(&grid[static_cast<std::size_t>(y) * size_x + x0], obstacle_size, OCCUPIED_CELL);
+    }
+  }
+  return grid;
+}
+
+/**
+ * @brief Lay out a grid of rooms with one cell thick walls and a door in the middle of each wall
+ * @param size_x Width in cells
+ * @param size_y Height in cells
+ * @param room_size Distance between walls in cells
+ * @param door_width Width of the doors in cells
+ * @return Row major grid of FREE_CELL and OCCUPIED_CELL
+ */
+inline std::vector<unsigned char> roomsAndCorridors(
+  unsigned int size_x, unsigned int size_y, unsigned int room_size = 60,
+  unsigned int door_width = 16)
+{
+  std::vector<unsigned char> grid(static_cast<std::size_t>(size_x) * size_y, FREE_CELL);
+  room_size = std::max(room_size, door_width + 2);
+
+  auto is_door = [&](unsigned int along) {
+      const unsigned int offset = along % room_size;
+      return offset >= (room_size - door_width) / 2 && offset < (room_size + door_width) / 2;
+    };
+
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      const bool border = x == 0 || y == 0 || x == size_x - 1 || y == size_y - 1;
+      const bool vertical_wall = x % room_size == 0 && !is_door(y);
+      const bool horizontal_wall = y % room_size == 0 && !is_door(x);
+      if (border || vertical_wall || horizontal_wall) {
+        grid[static_cast<std::size_t>(y) * size_x + x] = OCCUPIED_CELL;
+      }
+    }
+  }
+  return grid;
+}
+
+/**
+ * @brief Generate a map of the given kind with the default settings of its generator
+ */
+inline std::vector<unsigned char> syntheticMap(
+  MapKind kind, unsigned int size_x, unsigned int size_y)
+{
+  if (kind == MapKind::ROOMS) {
+    return roomsAndCorridors(size_x, size_y);
+  }
+  return randomObstacles(size_x, size_y);
+}
+
+/**
+ * @brief Write a grid as a binary PGM image, the way map_saver would: free is white,
+ * occupied black. The first row of the grid is the bottom row of the image
+ * @return False if the file could not be written
+ */
+inline bool writePgm(
+  const std::string & path, const std::vector<unsigned char> & grid,
+  unsigned int size_x, unsigned int size_y)
+{
+  std::ofstream image(path, std::ios::binary);
+  if (!image) {
+    return false;
+  }
+
+  image << "P5\n" << size_x << " " << size_y << "\n255\n";
+  std::vector<char> row(size_x);
+  for (unsigned int y = size_y; y-- > 0; ) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      const bool occupied = grid[static_cast<std::size_t>(y) * size_x + x] == OCCUPIED_CELL;
+      row[x] = static_cast<char>(occupied ? 0 : 254);
+    }
+    image.write(row.data(), row.size());
+  }
+  return static_cast<bool>(image);
+}
+
+}  // namespace nav2_benchmarks
+
+#endif  // NAV2_BENCHMARKS__SYNTHETIC_MAPS_HPP_
@@ -15,12 +15,15 @@
 #ifndef NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 #define NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_behavior_tree/behavior_tree_engine.hpp"
+#include "nav2_bt_navigator/ros_topic_logger.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
 #include "nav_msgs/msg/path.hpp"
@@ -41,8 +44,9 @@ class BtNavigator : public nav2_util::LifecycleNode
 public:
   /**
    * @brief A constructor for nav2_bt_navigator::BtNavigator class
+   * @param options Additional options to control creation of the node.
    */
-  BtNavigator();
+  explicit BtNavigator(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_bt_navigator::BtNavigator class
    */
@@ -108,14 +112,31 @@ protected:
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr goal_sub_;
 
   /**
-   * @brief Replace current BT with another one
+   * @brief Replace current BT with another one, instantiated the first time only
    * @param bt_xml_filename The file containing the new BT
    * @return true if the resulting BT correspond to the one in bt_xml_filename. false
    * if something went wrong, and previous BT is mantained
    */
   bool loadBehaviorTree(const std::string & bt_id);
 
-  BT::Tree tree_;
+  /**
+   * @brief Read the XML description of a BT
+   * @param bt_xml_filename The file containing the BT
+   * @param xml_string Output description
+   * @return false if the file could not be read
+   */
+  bool readBehaviorTree(const std::string & bt_xml_filename, std::string & xml_string);
+
+  // A tree kept instantiated between goals, with its action clients connected
+  struct WarmTree
+  {
+    BT::Tree tree;
+    std::unique_ptr<RosTopicLogger> topic_logger;
+  };
+
+  // Every tree loaded so far by file name, and the one goals run
+  std::unordered_map<std::string, WarmTree> trees_;
+  WarmTree * current_tree_{nullptr};
 
   // The blackboard shared by all of the nodes in the tree
   BT::Blackboard::Ptr blackboard_;
@@ -145,6 +166,15 @@ protected:
   std::string robot_frame_;
   std::string global_frame_;
   double transform_tolerance_;
+
+  // Period of the BT ticks, or longest time between two ticks when ticking on events
+  std::chrono::milliseconds bt_loop_duration_;
+  // Whether to tick the BT as soon as a callback of client_node_ has run
+  bool tick_on_events_;
+
+  // Least time between two behavior tree logs, and whether they are compact
+  std::chrono::milliseconds bt_log_period_;
+  bool compact_bt_log_;
 };
 
 }  // namespace nav2_bt_navigator
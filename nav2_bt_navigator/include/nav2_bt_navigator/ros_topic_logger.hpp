@@ -15,19 +15,46 @@
 #ifndef NAV2_BT_NAVIGATOR__ROS_TOPIC_LOGGER_HPP_
 #define NAV2_BT_NAVIGATOR__ROS_TOPIC_LOGGER_HPP_
 
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 #include "behaviortree_cpp_v3/loggers/abstract_logger.h"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_msgs/msg/behavior_tree_log.hpp"
+#include "nav2_msgs/msg/behavior_tree_nodes.hpp"
 #include "nav2_msgs/msg/behavior_tree_status_change.h"
+#include "nav2_msgs/msg/compact_behavior_tree_log.hpp"
 
 namespace nav2_bt_navigator
 {
 
+/**
+ * @class RosTopicLogger
+ * @brief Publishes the status changes of a behavior tree
+ *
+ * The changes are published on behavior_tree_log, or with compact set on
+ * behavior_tree_log_compact as node ids and packed statuses, the names of the
+ * nodes going once to the latched behavior_tree_log_nodes. They are batched
+ * until publish_period has passed since the last log, and dropped without being
+ * encoded while nothing subscribes to the log.
+ */
 class RosTopicLogger : public BT::StatusChangeLogger
 {
 public:
-  RosTopicLogger(const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree);
+  /**
+   * @param publish_period Least time between two logs, 0 publishes on every flush
+   * @param compact Whether to publish compact logs
+   */
+  RosTopicLogger(
+    const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree,
+    std::chrono::milliseconds publish_period = std::chrono::milliseconds(0),
+    bool compact = false);
+
+  /**
+   * @brief Publishes the changes still waiting
+   */
+  ~RosTopicLogger() override;
 
   void callback(
     BT::Duration timestamp,
@@ -38,9 +65,24 @@ public:
   void flush() override;
 
 protected:
+  /**
+   * @brief Publishes the waiting changes, if anything subscribes
+   */
+  void publish();
+
   rclcpp::Node::SharedPtr ros_node_;
   rclcpp::Publisher<nav2_msgs::msg::BehaviorTreeLog>::SharedPtr log_pub_;
   std::vector<nav2_msgs::msg::BehaviorTreeStatusChange> event_log_;
+
+  std::chrono::milliseconds publish_period_;
+  std::chrono::steady_clock::time_point last_publish_;
+  bool compact_;
+  bool subscribed_{false};  ///< Whether the log had subscribers at the last publish
+  rclcpp::Publisher<nav2_msgs::msg::CompactBehaviorTreeLog>::SharedPtr compact_pub_;
+  rclcpp::Publisher<nav2_msgs::msg::BehaviorTreeNodes>::SharedPtr nodes_pub_;
+  nav2_msgs::msg::CompactBehaviorTreeLog compact_log_;
+  BT::Duration first_change_;  ///< Time of the first change of compact_log_
+  std::unordered_map<uint16_t, uint16_t> node_ids_;  ///< Log ids of the tree nodes by UID
 };
 
 }   // namespace nav2_bt_navigator
@@ -24,14 +24,14 @@
 
 #include "nav2_util/geometry_utils.hpp"
 #include "nav2_util/robot_utils.hpp"
+#include "nav2_util/shared_tf_buffer.hpp"
 #include "nav2_behavior_tree/bt_conversions.hpp"
-#include "nav2_bt_navigator/ros_topic_logger.hpp"
 
 namespace nav2_bt_navigator
 {
 
-BtNavigator::BtNavigator()
-: nav2_util::LifecycleNode("bt_navigator", "", false),
+BtNavigator::BtNavigator(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("bt_navigator", "", false, options),
   start_time_(0)
 {
   RCLCPP_INFO(get_logger(), "Creating");
@@ -51,11 +51,13 @@ BtNavigator::BtNavigator()
     "nav2_rate_controller_bt_node",
     "nav2_distance_controller_bt_node",
     "nav2_speed_controller_bt_node",
+    "nav2_path_validity_controller_bt_node",
     "nav2_truncate_path_action_bt_node",
     "nav2_change_goal_node_bt_node",
     "nav2_recovery_node_bt_node",
     "nav2_pipeline_sequence_bt_node",
     "nav2_round_robin_node_bt_node",
+    "nav2_parallel_threshold_node_bt_node",
     "nav2_transform_available_condition_bt_node",
     "nav2_time_expired_condition_bt_node",
     "nav2_distance_traveled_condition_bt_node"
@@ -63,11 +65,17 @@ BtNavigator::BtNavigator()
 
   // Declare this node's parameters
   declare_parameter("default_bt_xml_filename");
+  declare_parameter("preload_bt_xml_filenames", std::vector<std::string>());
   declare_parameter("plugin_lib_names", plugin_libs);
   declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.1));
   declare_parameter("global_frame", std::string("map"));
   declare_parameter("robot_base_frame", std::string("base_link"));
   declare_parameter("odom_topic", std::string("odom"));
+  declare_parameter("bt_loop_duration", 10);
+  declare_parameter("tick_on_events", false);
+  declare_parameter("share_tf_buffer", false);
+  declare_parameter("bt_log_period", 0);
+  declare_parameter("compact_bt_log", false);
 }
 
 BtNavigator::~BtNavigator()
@@ -91,12 +99,16 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
   self_client_ = rclcpp_action::create_client<nav2_msgs::action::NavigateToPose>(
     client_node_, "navigate_to_pose");
 
-  tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
-  auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
-    get_node_base_interface(), get_node_timers_interface());
-  tf_->setCreateTimerInterface(timer_interface);
-  tf_->setUsingDedicatedThread(true);
-  tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_, this, false);
+  if (get_parameter("share_tf_buffer").as_bool()) {
+    tf_ = nav2_util::getSharedTfBuffer(get_parameter("use_sim_time").as_bool());
+  } else {
+    tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      get_node_base_interface(), get_node_timers_interface());
+    tf_->setCreateTimerInterface(timer_interface);
+    tf_->setUsingDedicatedThread(true);
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_, this, false);
+  }
 
   goal_sub_ = create_subscription<geometry_msgs::msg::PoseStamped>(
     "goal_pose",
@@ -115,6 +127,10 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
   global_frame_ = get_parameter("global_frame").as_string();
   robot_frame_ = get_parameter("robot_base_frame").as_string();
   transform_tolerance_ = get_parameter("transform_tolerance").as_double();
+  bt_loop_duration_ = std::chrono::milliseconds(get_parameter("bt_loop_duration").as_int());
+  tick_on_events_ = get_parameter("tick_on_events").as_bool();
+  bt_log_period_ = std::chrono::milliseconds(get_parameter("bt_log_period").as_int());
+  compact_bt_log_ = get_parameter("compact_bt_log").as_bool();
 
   // Create the class that registers our custom nodes and executes the BT
   bt_ = std::make_unique<nav2_behavior_tree::BehaviorTreeEngine>(plugin_lib_names_);
@@ -139,10 +155,36 @@ bool
 BtNavigator::loadBehaviorTree(const std::string & bt_xml_filename)
 {
   // Use previous BT if it is the existing one
-  if (current_bt_xml_filename_ == bt_xml_filename) {
+  if (current_tree_ && current_bt_xml_filename_ == bt_xml_filename) {
     return true;
   }
 
+  // Trees stay instantiated once loaded, so going back to one never waits for its
+  // action servers again
+  auto it = trees_.find(bt_xml_filename);
+  if (it == trees_.end()) {
+    std::string xml_string;
+    if (!readBehaviorTree(bt_xml_filename, xml_string)) {
+      return false;
+    }
+
+    // Create the Behavior Tree from the XML input. Only new file contents are parsed
+    WarmTree warm;
+    warm.tree = bt_->buildTreeFromText(xml_string, blackboard_);
+    it = trees_.emplace(bt_xml_filename, std::move(warm)).first;
+    it->second.topic_logger = std::make_unique<RosTopicLogger>(
+      client_node_, it->second.tree, bt_log_period_, compact_bt_log_);
+  }
+
+  current_tree_ = &it->second;
+  current_bt_xml_filename_ = bt_xml_filename;
+
+  return true;
+}
+
+bool
+BtNavigator::readBehaviorTree(const std::string & bt_xml_filename, std::string & xml_string)
+{
   // Read the input BT XML from the specified file into a string
   std::ifstream xml_file(bt_xml_filename);
 
@@ -151,17 +193,12 @@ BtNavigator::loadBehaviorTree(const std::string & bt_xml_filename)
     return false;
   }
 
-  auto xml_string = std::string(
+  xml_string = std::string(
     std::istreambuf_iterator<char>(xml_file),
     std::istreambuf_iterator<char>());
 
   RCLCPP_DEBUG(get_logger(), "Behavior Tree file: '%s'", bt_xml_filename.c_str());
   RCLCPP_DEBUG(get_logger(), "Behavior Tree XML: %s", xml_string.c_str());
-
-  // Create the Behavior Tree from the XML input
-  tree_ = bt_->buildTreeFromText(xml_string, blackboard_);
-  current_bt_xml_filename_ = bt_xml_filename;
-
   return true;
 }
 
@@ -175,6 +212,20 @@ BtNavigator::on_activate(const rclcpp_lifecycle::State & /*state*/)
     return nav2_util::CallbackReturn::FAILURE;
   }
 
+  // Instantiate the trees goals may ask for, so that switching to them costs nothing. The
+  // default tree stays the current one
+  WarmTree * default_tree = current_tree_;
+  for (const auto & bt_xml_filename : get_parameter("preload_bt_xml_filenames").as_string_array()) {
+    try {
+      loadBehaviorTree(bt_xml_filename);
+    } catch (const std::exception & e) {
+      RCLCPP_WARN(
+        get_logger(), "Failed to preload BT file %s: %s", bt_xml_filename.c_str(), e.what());
+    }
+  }
+  current_tree_ = default_tree;
+  current_bt_xml_filename_ = default_bt_xml_filename_;
+
   action_server_->activate();
 
   // create bond connection
@@ -214,8 +265,16 @@ BtNavigator::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   action_server_.reset();
   plugin_lib_names_.clear();
   current_bt_xml_filename_.clear();
+  current_tree_ = nullptr;
+  for (auto & tree : trees_) {
+    bt_->haltAllActions(tree.second.tree.rootNode());
+  }
+  // The loggers go first, they watch the trees' nodes
+  for (auto & tree : trees_) {
+    tree.second.topic_logger.reset();
+  }
+  trees_.clear();
   blackboard_.reset();
-  bt_->haltAllActions(tree_.rootNode());
   bt_.reset();
 
   RCLCPP_INFO(get_logger(), "Completed Cleaning up");
@@ -261,7 +320,8 @@ BtNavigator::navigateToPose()
     return;
   }
 
-  RosTopicLogger topic_logger(client_node_, tree_);
+  BT::Tree & tree = current_tree_->tree;
+  RosTopicLogger & topic_logger = *current_tree_->topic_logger;
   std::shared_ptr<Action::Feedback> feedback_msg = std::make_shared<Action::Feedback>();
 
   auto on_loop = [&]() {
@@ -290,11 +350,16 @@ BtNavigator::navigateToPose()
       action_server_->publish_feedback(feedback_msg);
     };
 
-  // Execute the BT that was previously created in the configure step
-  nav2_behavior_tree::BtStatus rc = bt_->run(&tree_, on_loop, is_canceling);
+  // Execute the BT that was previously created, the first tick sends its first requests
+  // over the clients it connected when it was instantiated
+  nav2_behavior_tree::BtStatus rc = bt_->run(
+    &tree, on_loop, is_canceling, bt_loop_duration_,
+    tick_on_events_ ? client_node_ : nullptr);
   // Make sure that the Bt is not in a running state from a previous execution
   // note: if all the ControlNodes are implemented correctly, this is not needed.
-  bt_->haltAllActions(tree_.rootNode());
+  bt_->haltAllActions(tree.rootNode());
+  // The halt is logged with this goal rather than the next one to run the tree
+  topic_logger.flush();
 
   switch (rc) {
     case nav2_behavior_tree::BtStatus::SUCCEEDED:
@@ -340,3 +405,7 @@ BtNavigator::onGoalPoseReceived(const geometry_msgs::msg::PoseStamped::SharedPtr
 }
 
 }  // namespace nav2_bt_navigator
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_bt_navigator::BtNavigator)
@@ -12,21 +12,76 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <utility>
 #include "nav2_bt_navigator/ros_topic_logger.hpp"
+#include "behaviortree_cpp_v3/behavior_tree.h"
 #include "tf2_ros/buffer_interface.h"
 
 namespace nav2_bt_navigator
 {
 
+namespace
+{
+
+// BT timestamps are a duration since the epoch. Need to convert to a time_point
+// before converting to a msg.
+builtin_interfaces::msg::Time toMsg(BT::Duration timestamp)
+{
+#ifndef _WIN32
+  return tf2_ros::toMsg(std::chrono::time_point<std::chrono::high_resolution_clock>(timestamp));
+#else
+  return tf2_ros::toMsg(timestamp);
+#endif
+}
+
+template<typename PublisherT>
+bool hasSubscribers(const PublisherT & pub)
+{
+  return pub->get_subscription_count() + pub->get_intra_process_subscription_count() > 0;
+}
+
+}  // namespace
+
 RosTopicLogger::RosTopicLogger(
-  const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree)
-: StatusChangeLogger(tree.rootNode()), ros_node_(ros_node)
+  const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree,
+  std::chrono::milliseconds publish_period, bool compact)
+: StatusChangeLogger(tree.rootNode()), ros_node_(ros_node), publish_period_(publish_period),
+  last_publish_(std::chrono::steady_clock::now()), compact_(compact)
 {
-  log_pub_ = ros_node_->create_publisher<nav2_msgs::msg::BehaviorTreeLog>(
-    "behavior_tree_log",
+  if (!compact_) {
+    log_pub_ = ros_node_->create_publisher<nav2_msgs::msg::BehaviorTreeLog>(
+      "behavior_tree_log",
+      rclcpp::QoS(10));
+    subscribed_ = hasSubscribers(log_pub_);
+    return;
+  }
+
+  // Every logger numbers its tree, so the changes are never read with the names of another
+  static std::atomic<uint32_t> next_tree_id{0};
+  nav2_msgs::msg::BehaviorTreeNodes nodes;
+  nodes.tree_id = next_tree_id++;
+  compact_log_.tree_id = nodes.tree_id;
+  BT::applyRecursiveVisitor(
+    tree.rootNode(), [&](const BT::TreeNode * node) {
+      node_ids_.emplace(node->UID(), static_cast<uint16_t>(nodes.node_names.size()));
+      nodes.node_names.push_back(node->name());
+    });
+
+  nodes_pub_ = ros_node_->create_publisher<nav2_msgs::msg::BehaviorTreeNodes>(
+    "behavior_tree_log_nodes", rclcpp::QoS(1).transient_local());
+  nodes_pub_->publish(nodes);
+  compact_pub_ = ros_node_->create_publisher<nav2_msgs::msg::CompactBehaviorTreeLog>(
+    "behavior_tree_log_compact",
     rclcpp::QoS(10));
+  subscribed_ = hasSubscribers(compact_pub_);
+}
+
+RosTopicLogger::~RosTopicLogger()
+{
+  publish();
 }
 
 void RosTopicLogger::callback(
@@ -35,38 +90,73 @@ void RosTopicLogger::callback(
   BT::NodeStatus prev_status,
   BT::NodeStatus status)
 {
-  nav2_msgs::msg::BehaviorTreeStatusChange event;
-
-  // BT timestamps are a duration since the epoch. Need to convert to a time_point
-  // before converting to a msg.
-#ifndef _WIN32
-  event.timestamp =
-    tf2_ros::toMsg(std::chrono::time_point<std::chrono::high_resolution_clock>(timestamp));
-#else
-  event.timestamp = tf2_ros::toMsg(timestamp);
-#endif
-  event.node_name = node.name();
-  event.previous_status = toStr(prev_status, false);
-  event.current_status = toStr(status, false);
-  event_log_.push_back(std::move(event));
-
   RCLCPP_DEBUG(
     ros_node_->get_logger(), "[%.3f]: %25s %s -> %s",
     std::chrono::duration<double>(timestamp).count(),
     node.name().c_str(),
     toStr(prev_status, true).c_str(),
     toStr(status, true).c_str() );
+
+  if (!subscribed_) {
+    return;
+  }
+
+  if (compact_) {
+    auto id = node_ids_.find(node.UID());
+    if (id == node_ids_.end()) {
+      return;
+    }
+    if (compact_log_.node_ids.empty()) {
+      first_change_ = timestamp;
+    }
+    compact_log_.time_offsets.push_back(
+      static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(timestamp - first_change_).count()));
+    compact_log_.node_ids.push_back(id->second);
+    compact_log_.transitions.push_back(
+      static_cast<uint8_t>(static_cast<int>(prev_status) * 16 + static_cast<int>(status)));
+    return;
+  }
+
+  nav2_msgs::msg::BehaviorTreeStatusChange event;
+  event.timestamp = toMsg(timestamp);
+  event.node_name = node.name();
+  event.previous_status = toStr(prev_status, false);
+  event.current_status = toStr(status, false);
+  event_log_.push_back(std::move(event));
 }
 
 void RosTopicLogger::flush()
 {
-  if (event_log_.size() > 0) {
+  if (std::chrono::steady_clock::now() - last_publish_ >= publish_period_) {
+    publish();
+  }
+}
+
+void RosTopicLogger::publish()
+{
+  last_publish_ = std::chrono::steady_clock::now();
+
+  if (compact_) {
+    if (subscribed_ && !compact_log_.node_ids.empty()) {
+      compact_log_.timestamp = toMsg(first_change_);
+      compact_pub_->publish(compact_log_);
+    }
+    compact_log_.time_offsets.clear();
+    compact_log_.node_ids.clear();
+    compact_log_.transitions.clear();
+    subscribed_ = hasSubscribers(compact_pub_);
+    return;
+  }
+
+  if (subscribed_ && event_log_.size() > 0) {
     auto log_msg = std::make_unique<nav2_msgs::msg::BehaviorTreeLog>();
     log_msg->timestamp = ros_node_->now();
-    log_msg->event_log = event_log_;
+    log_msg->event_log = std::move(event_log_);
     log_pub_->publish(std::move(log_msg));
-    event_log_.clear();
   }
+  event_log_.clear();
+  subscribed_ = hasSubscribers(log_pub_);
 }
 
 }   // namespace nav2_bt_navigator
@@ -0,0 +1,166 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_CONTROLLER__COLLISION_MONITOR_HPP_
+#define NAV2_CONTROLLER__COLLISION_MONITOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav2_costmap_2d/cloud_transform.hpp"
+#include "nav2_costmap_2d/footprint_subscriber.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+#include "tf2_ros/buffer.h"
+#include "tf2_ros/transform_listener.h"
+
+namespace nav2_controller
+{
+
+/**
+ * @class nav2_controller::ZonePolygon
+ * @brief A polygon in the robot frame, counting the points inside it four at a time
+ */
+class ZonePolygon
+{
+public:
+  ZonePolygon() = default;
+  explicit ZonePolygon(const std::vector<geometry_msgs::msg::Point> & vertices);
+
+  bool empty() const {return edge_x_.empty();}
+
+  /**
+   * @brief Number of the points inside the polygon, by the crossing number test
+   * @param x X coordinates of the points
+   * @param y Y coordinates of the points
+   * @param n Number of points
+   * @param enough Stop counting once this many points are inside
+   */
+  std::size_t countInside(
+    const float * x, const float * y, std::size_t n, std::size_t enough) const;
+
+protected:
+  // Per edge: its lower end, the slope of x along y and its y extent
+  std::vector<float> edge_x_, edge_y_, edge_slope_, edge_top_;
+  float min_x_{0.0f}, max_x_{0.0f}, min_y_{0.0f}, max_y_{0.0f};
+};
+
+/**
+ * @class nav2_controller::CollisionMonitor
+ * @brief Gates the velocity commands of the controller on the raw scans and clouds
+ *
+ * Every observation source is checked against a stop and a slowdown zone, the robot
+ * footprint padded by stop_padding and slowdown_padding, in the robot frame. Commands
+ * from cmd_vel_in_topic are forwarded to cmd_vel_out_topic, scaled by slowdown_ratio
+ * while a source sees min_points in the slowdown zone and zeroed while one sees them in
+ * the stop zone, or has nothing newer than source_timeout. A source entering the stop
+ * zone zeroes the output at once rather than at the next command. Nothing here waits on
+ * a costmap update, the footprint is only read when it changes.
+ */
+class CollisionMonitor : public nav2_util::LifecycleNode
+{
+public:
+  explicit CollisionMonitor(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+  ~CollisionMonitor();
+
+  /// What the commands are subject to
+  enum class Action : uint8_t
+  {
+    PASS = 0,
+    SLOWDOWN = 1,
+    STOP = 2
+  };
+
+protected:
+  nav2_util::CallbackReturn on_configure(const rclcpp_lifecycle::State & state) override;
+  nav2_util::CallbackReturn on_activate(const rclcpp_lifecycle::State & state) override;
+  nav2_util::CallbackReturn on_deactivate(const rclcpp_lifecycle::State & state) override;
+  nav2_util::CallbackReturn on_cleanup(const rclcpp_lifecycle::State & state) override;
+  nav2_util::CallbackReturn on_shutdown(const rclcpp_lifecycle::State & state) override;
+
+  /// An observation source and the action its latest observation calls for
+  struct Source
+  {
+    std::string name;
+    double min_height;  ///< Heights of the cloud points kept, scans are planar
+    double max_height;
+    nav2_costmap_2d::ScanAngles angles;
+    std::vector<float> x, y;  ///< Points of the latest observation, in the robot frame
+    rclcpp::Time stamp;
+    Action action{Action::STOP};
+    bool received{false};
+  };
+
+  void scanCallback(Source & source, sensor_msgs::msg::LaserScan::ConstSharedPtr scan);
+  void cloudCallback(Source & source, sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud);
+  void cmdVelCallback(geometry_msgs::msg::Twist::ConstSharedPtr cmd_vel);
+
+  /**
+   * @brief Get the [R|t] transform from a sensor frame to the robot frame
+   */
+  bool sensorTransform(const std::string & frame, float transform[12]);
+
+  /**
+   * @brief Check the points of a source against the zones, and stop at once if it
+   * calls for a stop the output doesn't have yet
+   */
+  void updateSource(Source & source, const rclcpp::Time & stamp);
+
+  /**
+   * @brief Rebuild the zones if the footprint on footprint_topic changed
+   */
+  void updateZones();
+
+  /**
+   * @brief The most restrictive action of the sources, with their timeouts
+   */
+  Action currentAction();
+
+  void publish(const geometry_msgs::msg::Twist & cmd_vel);
+
+  std::string base_frame_;
+  std::string global_frame_;
+  double transform_tolerance_;
+  rclcpp::Duration source_timeout_{0, 0};
+  double stop_padding_;
+  double slowdown_padding_;
+  double slowdown_ratio_;
+  std::size_t min_points_;
+
+  std::shared_ptr<tf2_ros::Buffer> tf_;
+  std::shared_ptr<tf2_ros::TransformListener> transform_listener_;
+  std::unique_ptr<nav2_costmap_2d::FootprintSubscriber> footprint_sub_;
+  uint64_t footprint_version_{0};
+
+  // Guards the zones, the sources and the output action, the callbacks may run in parallel
+  std::mutex mutex_;
+  ZonePolygon stop_zone_;
+  ZonePolygon slowdown_zone_;
+  std::vector<std::unique_ptr<Source>> sources_;
+  Action output_action_{Action::STOP};
+
+  std::vector<rclcpp::SubscriptionBase::SharedPtr> source_subs_;
+  rclcpp::Subscription<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_sub_;
+  rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub_;
+};
+
+}  // namespace nav2_controller
+
+#endif  // NAV2_CONTROLLER__COLLISION_MONITOR_HPP_
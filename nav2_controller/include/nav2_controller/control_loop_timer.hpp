@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_CONTROLLER__CONTROL_LOOP_TIMER_HPP_
+#define NAV2_CONTROLLER__CONTROL_LOOP_TIMER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav2_msgs/msg/control_loop_statistics.hpp"
+
+namespace nav2_controller
+{
+
+/**
+ * @class nav2_controller::ControlLoopTimer
+ * @brief Paces a loop against absolute deadlines and keeps lateness and work time histograms
+ *
+ * Unlike rclcpp::Rate, which sleeps for the remainder of the period, the deadlines are fixed
+ * multiples of the period from start(), so the time spent waking up doesn't accumulate. A cycle
+ * that overruns skips the deadlines it missed instead of running several cycles back to back.
+ */
+class ControlLoopTimer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Constructor for nav2_controller::ControlLoopTimer
+   * @param frequency Loop frequency, in Hz
+   * @param histogram_bins Number of bins in each histogram
+   */
+  explicit ControlLoopTimer(double frequency, unsigned int histogram_bins = 20);
+
+  /**
+   * @brief Start the first cycle, with its deadline one period from now
+   */
+  void start();
+
+  /**
+   * @brief Sleep until the next deadline and start the next cycle
+   * @return false if the cycle ran past its deadline, in which case it doesn't sleep
+   */
+  bool sleep();
+
+  /**
+   * @brief Number of cycles recorded since the statistics were last taken
+   */
+  unsigned int cycles() const {return cycles_;}
+
+  /**
+   * @brief Fill in the statistics of the cycles since the last call and start a new window
+   * @param stats Message to fill, apart from its header
+   */
+  void takeStatistics(nav2_msgs::msg::ControlLoopStatistics & stats);
+
+  /**
+   * @brief Run the calling thread with SCHED_FIFO and/or pinned to a set of CPUs
+   * @param priority SCHED_FIFO priority, or 0 to keep the current scheduling policy
+   * @param cpus CPUs to run on, or empty to keep the current affinity
+   * @param error Set to the reason when false is returned
+   * @return true if every requested setting was applied
+   */
+  static bool setThreadScheduling(
+    int priority, const std::vector<int64_t> & cpus, std::string & error);
+
+protected:
+  // Sleep until the given time on the monotonic clock
+  static void sleepUntil(const Clock::time_point & time);
+
+  void record(std::vector<uint32_t> & histogram, Clock::duration bin_width, Clock::duration value);
+
+  double frequency_;
+  Clock::duration period_;
+  Clock::time_point deadline_;
+  Clock::time_point cycle_start_;
+
+  Clock::duration lateness_bin_width_;
+  Clock::duration work_time_bin_width_;
+  std::vector<uint32_t> lateness_histogram_;
+  std::vector<uint32_t> work_time_histogram_;
+  Clock::duration max_lateness_;
+  Clock::duration max_work_time_;
+  unsigned int cycles_;
+  unsigned int missed_deadlines_;
+};
+
+}  // namespace nav2_controller
+
+#endif  // NAV2_CONTROLLER__CONTROL_LOOP_TIMER_HPP_
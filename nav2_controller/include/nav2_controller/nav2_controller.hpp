@@ -15,7 +15,9 @@
 #ifndef NAV2_CONTROLLER__NAV2_CONTROLLER_HPP_
 #define NAV2_CONTROLLER__NAV2_CONTROLLER_HPP_
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -25,11 +27,16 @@
 #include "nav2_core/progress_checker.hpp"
 #include "nav2_core/goal_checker.hpp"
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/speed_filter.hpp"
 #include "tf2_ros/transform_listener.h"
 #include "nav2_msgs/action/follow_path.hpp"
+#include "nav2_msgs/msg/control_loop_statistics.hpp"
+#include "nav2_controller/control_loop_timer.hpp"
+#include "nav2_controller/velocity_smoother.hpp"
 #include "nav_2d_utils/odom_subscriber.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_util/simple_action_server.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "pluginlib/class_list_macros.hpp"
@@ -50,13 +57,19 @@ public:
 
   /**
    * @brief Constructor for nav2_controller::ControllerServer
+   * @param options Additional options to control creation of the node.
    */
-  ControllerServer();
+  explicit ControllerServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief Destructor for nav2_controller::ControllerServer
    */
   ~ControllerServer();
 
+  /**
+   * @brief The local costmap, for the process to spin it when costmap_thread is false
+   */
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> getCostmapROS() const {return costmap_ros_;}
+
 protected:
   /**
    * @brief Configures controller parameters and member variables
@@ -108,6 +121,8 @@ protected:
 
   // Our action server implements the FollowPath action
   std::unique_ptr<ActionServer> action_server_;
+  // Reused every cycle rather than allocated per published feedback
+  std::shared_ptr<Action::Feedback> feedback_;
 
   /**
    * @brief FollowPath action server callback. Handles action server updates and
@@ -134,29 +149,90 @@ protected:
    * @param path Path received from action server
    */
   void setPlannerPath(const nav_msgs::msg::Path & path);
+  /**
+   * @brief Assigns the path of a goal to controller, its compact path when its path is empty
+   * @param goal Goal received from action server
+   */
+  void setPlannerPath(const nav2_msgs::action::FollowPath::Goal & goal);
+  /**
+   * @brief Resets the goal checker and the progress checker for a new path
+   * @param header Header of the path
+   * @param size Number of poses of the path
+   * @param pose_at Gives pose i of the path
+   */
+  void setPathCheckers(
+    const std_msgs::msg::Header & header, size_t size,
+    const std::function<geometry_msgs::msg::Pose(size_t)> & pose_at);
   /**
    * @brief Calculates velocity and publishes to "cmd_vel" topic
+   * @param pose Current pose of the robot
+   * @param twist Current thresholded velocity of the robot
+   */
+  void computeAndPublishVelocity(
+    geometry_msgs::msg::PoseStamped & pose,
+    const nav_2d_msgs::msg::Twist2D & twist);
+  /**
+   * @brief Keep the inputs and output of a control cycle for snapshots, and save one if the
+   * controller took longer than the snapshot budget
+   * @param costmap Costmap snapshot at the start of the cycle
+   * @param duration Seconds the controller plugin took
    */
-  void computeAndPublishVelocity();
+  void recordCycle(
+    const geometry_msgs::msg::PoseStamped & pose,
+    const geometry_msgs::msg::Twist & velocity,
+    const geometry_msgs::msg::TwistStamped & cmd_vel,
+    const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & costmap,
+    double duration);
+  /**
+   * @brief Add the last control cycle recorded to a snapshot, for controller_replay
+   * @return false if no cycle ran yet
+   */
+  bool fillSnapshot(nav2_util::SnapshotWriter & writer);
+  /**
+   * @brief Scale a velocity down to the limit of the speed filter at the robot pose, keeping
+   * its curvature
+   * @param pose Current pose of the robot, in the costmap global frame
+   * @param velocity Velocity to limit
+   */
+  void applySpeedLimit(
+    const geometry_msgs::msg::PoseStamped & pose, geometry_msgs::msg::Twist & velocity);
   /**
    * @brief Calls setPlannerPath method with an updated path received from
    * action server
    */
   void updateGlobalPath();
   /**
-   * @brief Calls velocity publisher to publish the velocity on "cmd_vel" topic
+   * @brief Calls velocity publisher to publish the velocity on "cmd_vel" topic, or hands it to
+   * the velocity smoother when smoothing_frequency is set
    * @param velocity Twist velocity to be published
    */
   void publishVelocity(const geometry_msgs::msg::TwistStamped & velocity);
+  /**
+   * @brief Publish a velocity on "cmd_vel" right away
+   */
+  void sendVelocity(const geometry_msgs::msg::Twist & velocity);
+  /**
+   * @brief Publish the next output of the velocity smoother, on the smoothing timer
+   */
+  void publishSmoothedVelocity();
   /**
    * @brief Calls velocity publisher to publish zero velocity
    */
   void publishZeroVelocity();
   /**
    * @brief Checks if goal is reached
+   * @param pose Current pose of the robot
+   * @param twist Current thresholded velocity of the robot
    * @return true or false
    */
-  bool isGoalReached();
+  bool isGoalReached(
+    const geometry_msgs::msg::PoseStamped & pose,
+    const nav_2d_msgs::msg::Twist2D & twist);
+  /**
+   * @brief Publishes the control loop timing since the last call on "controller_loop_statistics"
+   * @param loop_timer Timer pacing the control loop
+   */
+  void publishLoopStatistics(ControlLoopTimer & loop_timer);
   /**
    * @brief Obtain current pose of the robot
    * @param pose To store current pose of the robot
@@ -196,6 +272,8 @@ protected:
   // Publishers and subscribers
   std::unique_ptr<nav_2d_utils::OdomSubscriber> odom_sub_;
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr vel_publisher_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::ControlLoopStatistics>::SharedPtr
+    loop_stats_publisher_;
 
   // Progress Checker Plugin
   pluginlib::ClassLoader<nav2_core::ProgressChecker> progress_checker_loader_;
@@ -223,10 +301,39 @@ protected:
   std::string controller_ids_concat_, current_controller_;
 
   double controller_frequency_;
+  int controller_thread_priority_;
+  std::vector<int64_t> controller_cpu_affinity_;
   double min_x_velocity_threshold_;
   double min_y_velocity_threshold_;
   double min_theta_velocity_threshold_;
 
+  // Velocity smoothing, between the control loop and the smoothing timer
+  double smoothing_frequency_{0.0};
+  bool smoothing_closed_loop_{false};
+  std::mutex smoother_mutex_;
+  std::unique_ptr<VelocitySmoother> smoother_;
+  rclcpp::TimerBase::SharedPtr smoothing_timer_;
+
+  // Speed filter layer of the local costmap, if it has one
+  std::shared_ptr<nav2_costmap_2d::SpeedFilter> speed_filter_;
+
+  // Snapshots of the last control cycle, on demand or when one runs over its budget. The
+  // plan is the one given to the progress checker, in the costmap frame, which a replay
+  // needs no transform for
+  struct LastCycle
+  {
+    std::string controller_id;
+    nav_msgs::msg::Path plan;
+    geometry_msgs::msg::PoseStamped pose;
+    geometry_msgs::msg::Twist velocity;
+    geometry_msgs::msg::TwistStamped cmd_vel;
+    std::shared_ptr<const nav2_costmap_2d::Costmap2D> costmap;
+    double duration;
+  };
+  std::unique_ptr<nav2_util::SnapshotRecorder> snapshot_recorder_;
+  LastCycle last_cycle_;
+  std::mutex last_cycle_mutex_;
+
   // Whether we've published the single controller warning yet
   geometry_msgs::msg::Pose end_pose_;
 };
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_CONTROLLER__PLUGINS__PATH_PROGRESS_CHECKER_HPP_
+#define NAV2_CONTROLLER__PLUGINS__PATH_PROGRESS_CHECKER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_lifecycle/lifecycle_node.hpp"
+#include "nav2_controller/plugins/simple_progress_checker.hpp"
+#include "nav_msgs/msg/path.hpp"
+
+namespace nav2_controller
+{
+
+/**
+ * @class PathProgressChecker
+ * @brief Progress checker measuring progress as the distance covered along the path
+ *
+ * The robot is projected on the path, searching forward from its previous projection
+ * only, so each check costs the same whatever the length of the path. Moving around
+ * without getting further along the path, circling an obstacle for instance, doesn't
+ * count as progress. Without a path it behaves like SimpleProgressChecker.
+ * required_movement_radius is the distance along the path that counts as progress.
+ */
+class PathProgressChecker : public SimpleProgressChecker
+{
+public:
+  void initialize(
+    const rclcpp_lifecycle::LifecycleNode::SharedPtr & node,
+    const std::string & plugin_name) override;
+  bool check(geometry_msgs::msg::PoseStamped & current_pose) override;
+  void reset() override;
+  void setPlan(const nav_msgs::msg::Path & path) override;
+
+  /**
+   * @brief Distance along the path of the last projection of the robot (m)
+   */
+  double getPathProgress() const {return progress_;}
+
+protected:
+  /**
+   * @brief Project a position on the path, from the segment of the previous projection
+   * up to search_distance_ further along the path
+   * @return Distance along the path of the projection
+   */
+  double project(double x, double y);
+
+  double search_distance_;
+
+  std::vector<double> xs_, ys_;
+  std::vector<double> arc_lengths_;  ///< Distance along the path of each pose
+  std::size_t segment_{0};  ///< Segment of the last projection
+  double progress_{0.0};
+  double baseline_progress_{0.0};  ///< Distance along the path of baseline_pose_
+};
+
+}  // namespace nav2_controller
+
+#endif  // NAV2_CONTROLLER__PLUGINS__PATH_PROGRESS_CHECKER_HPP_
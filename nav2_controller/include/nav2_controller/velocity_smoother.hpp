@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_CONTROLLER__VELOCITY_SMOOTHER_HPP_
+#define NAV2_CONTROLLER__VELOCITY_SMOOTHER_HPP_
+
+#include <array>
+#include <chrono>
+
+#include "nav_2d_msgs/msg/twist2_d.hpp"
+
+namespace nav2_controller
+{
+
+/**
+ * @class nav2_controller::VelocitySmoother
+ * @brief Turns the controller outputs into a velocity updated at a fixed rate of its own,
+ * within acceleration, deceleration and jerk limits
+ *
+ * Between two controller outputs, the target is extrapolated along the change between the last
+ * two, for at most the time between them, so that a ramp from the controller is followed without
+ * a controller period of lag. A target older than the timeout is replaced by zero.
+ */
+class VelocitySmoother
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Limits of an axis, all positive. A max_jerk of 0 leaves the jerk unlimited
+  struct Limits
+  {
+    double max_accel;
+    double max_decel;
+    double max_jerk;
+  };
+
+  /**
+   * @brief Constructor for nav2_controller::VelocitySmoother
+   * @param limits Limits of the x, y and theta axes
+   * @param timeout Age (s) past which the target is zero
+   */
+  VelocitySmoother(const std::array<Limits, 3> & limits, double timeout);
+
+  /**
+   * @brief Set the velocity the output goes to
+   * @param target Controller output
+   * @param stamp When the controller computed it
+   */
+  void setTarget(const nav_2d_msgs::msg::Twist2D & target, Clock::time_point stamp);
+
+  /**
+   * @brief Take the measured velocity as the current one, keeping the acceleration
+   */
+  void feedback(const nav_2d_msgs::msg::Twist2D & measured);
+
+  /**
+   * @brief Drop the target and its extrapolation, and set the velocity with a zero acceleration
+   */
+  void reset(const nav_2d_msgs::msg::Twist2D & velocity);
+
+  /**
+   * @brief Move the velocity towards the target
+   * @param now Time of this output, the first one after a reset only sets the clock
+   * @return The velocity to command
+   */
+  nav_2d_msgs::msg::Twist2D update(Clock::time_point now);
+
+protected:
+  /// Velocity of an axis after dt, moving from v at acceleration a towards reference
+  static double step(const Limits & limits, double reference, double dt, double & v, double & a);
+
+  std::array<Limits, 3> limits_;
+  double timeout_;
+
+  std::array<double, 3> target_{};
+  std::array<double, 3> target_rate_{};  ///< Change of the target per second
+  double extrapolation_{0.0};  ///< How long (s) the target can be extrapolated for
+  Clock::time_point target_stamp_;
+  bool has_target_{false};
+
+  std::array<double, 3> velocity_{};
+  std::array<double, 3> acceleration_{};
+  Clock::time_point last_update_;
+  bool started_{false};
+};
+
+}  // namespace nav2_controller
+
+#endif  // NAV2_CONTROLLER__VELOCITY_SMOOTHER_HPP_
@@ -0,0 +1,118 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_controller/plugins/path_progress_checker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include "nav_2d_utils/conversions.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "pluginlib/class_list_macros.hpp"
+
+namespace nav2_controller
+{
+
+void PathProgressChecker::initialize(
+  const rclcpp_lifecycle::LifecycleNode::SharedPtr & node,
+  const std::string & plugin_name)
+{
+  SimpleProgressChecker::initialize(node, plugin_name);
+  nav2_util::declare_parameter_if_not_declared(
+    nh_, plugin_name + ".search_distance", rclcpp::ParameterValue(2.0));
+  nh_->get_parameter(plugin_name + ".search_distance", search_distance_);
+}
+
+bool PathProgressChecker::check(geometry_msgs::msg::PoseStamped & current_pose)
+{
+  if (arc_lengths_.empty()) {
+    return SimpleProgressChecker::check(current_pose);
+  }
+
+  progress_ = project(current_pose.pose.position.x, current_pose.pose.position.y);
+  if (!baseline_pose_set_ || progress_ - baseline_progress_ > radius_) {
+    reset_baseline_pose(nav_2d_utils::poseToPose2D(current_pose.pose));
+    baseline_progress_ = progress_;
+    return true;
+  }
+  return nh_->now() - baseline_time_ <= time_allowance_;
+}
+
+void PathProgressChecker::reset()
+{
+  SimpleProgressChecker::reset();
+  segment_ = 0;
+  progress_ = 0.0;
+}
+
+void PathProgressChecker::setPlan(const nav_msgs::msg::Path & path)
+{
+  xs_.resize(path.poses.size());
+  ys_.resize(path.poses.size());
+  arc_lengths_.resize(path.poses.size());
+  double length = 0.0;
+  for (std::size_t i = 0; i < path.poses.size(); i++) {
+    xs_[i] = path.poses[i].pose.position.x;
+    ys_[i] = path.poses[i].pose.position.y;
+    if (i > 0) {
+      length += std::hypot(xs_[i] - xs_[i - 1], ys_[i] - ys_[i - 1]);
+    }
+    arc_lengths_[i] = length;
+  }
+
+  // Paths are replaced as the robot goes, the baseline carries over onto the new one
+  segment_ = 0;
+  progress_ = 0.0;
+  if (baseline_pose_set_ && !arc_lengths_.empty()) {
+    baseline_progress_ = project(baseline_pose_.x, baseline_pose_.y);
+  }
+}
+
+double PathProgressChecker::project(double x, double y)
+{
+  if (arc_lengths_.size() == 1) {
+    return 0.0;
+  }
+
+  const double search_end = arc_lengths_[segment_] + search_distance_;
+  double best_sq_distance = std::numeric_limits<double>::max();
+  double best_progress = arc_lengths_[segment_];
+  std::size_t best_segment = segment_;
+  for (std::size_t i = segment_; i + 1 < arc_lengths_.size(); i++) {
+    if (i > segment_ && arc_lengths_[i] > search_end) {
+      break;
+    }
+    const double dx = xs_[i + 1] - xs_[i];
+    const double dy = ys_[i + 1] - ys_[i];
+    const double length_sq = dx * dx + dy * dy;
+    double t = 0.0;
+    if (length_sq > 0.0) {
+      t = std::min(1.0, std::max(0.0, ((x - xs_[i]) * dx + (y - ys_[i]) * dy) / length_sq));
+    }
+    const double ex = xs_[i] + t * dx - x;
+    const double ey = ys_[i] + t * dy - y;
+    const double sq_distance = ex * ex + ey * ey;
+    if (sq_distance < best_sq_distance) {
+      best_sq_distance = sq_distance;
+      best_segment = i;
+      best_progress = arc_lengths_[i] + t * (arc_lengths_[i + 1] - arc_lengths_[i]);
+    }
+  }
+  segment_ = best_segment;
+  return best_progress;
+}
+
+}  // namespace nav2_controller
+
+PLUGINLIB_EXPORT_CLASS(nav2_controller::PathProgressChecker, nav2_core::ProgressChecker)
@@ -38,10 +38,7 @@
 #include "pluginlib/class_list_macros.hpp"
 #include "angles/angles.h"
 #include "nav2_util/node_utils.hpp"
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpedantic"
-#include "tf2/utils.h"
-#pragma GCC diagnostic pop
+#include "nav2_util/se2.hpp"
 
 namespace nav2_controller
 {
@@ -98,8 +95,8 @@ bool SimpleGoalChecker::isGoalReached(
     }
   }
   double dyaw = angles::shortest_angular_distance(
-    tf2::getYaw(query_pose.orientation),
-    tf2::getYaw(goal_pose.orientation));
+    nav2_util::se2::yaw(query_pose.orientation),
+    nav2_util::se2::yaw(goal_pose.orientation));
   return fabs(dyaw) < yaw_goal_tolerance_;
 }
 
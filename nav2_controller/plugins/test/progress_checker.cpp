@@ -36,10 +36,12 @@
 #include <string>
 
 #include "gtest/gtest.h"
+#include "nav2_controller/plugins/path_progress_checker.hpp"
 #include "nav2_controller/plugins/simple_progress_checker.hpp"
 #include "nav_2d_utils/conversions.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
+using nav2_controller::PathProgressChecker;
 using nav2_controller::SimpleProgressChecker;
 
 class TestLifecycleNode : public nav2_util::LifecycleNode
@@ -127,6 +129,62 @@ TEST(SimpleProgressChecker, unit_tests)
   checkMacro(pc, 0, 0, 0, 0, 11, false);
 }
 
+nav_msgs::msg::Path straightPath(double length, double spacing)
+{
+  nav_msgs::msg::Path path;
+  for (double x = 0.0; x <= length + 1e-9; x += spacing) {
+    geometry_msgs::msg::PoseStamped pose;
+    pose.pose.position.x = x;
+    path.poses.push_back(pose);
+  }
+  return path;
+}
+
+TEST(PathProgressChecker, measures_progress_along_the_path)
+{
+  auto x = std::make_shared<TestLifecycleNode>("path_progress_checker");
+  x->declare_parameter("pc.movement_time_allowance", rclcpp::ParameterValue(1.0));
+
+  PathProgressChecker pc;
+  pc.initialize(x, "pc");
+  pc.setPlan(straightPath(10.0, 0.1));
+
+  geometry_msgs::msg::PoseStamped pose;
+  pose.pose.position.x = 1.0;
+  pose.pose.position.y = 0.3;
+  EXPECT_TRUE(pc.check(pose));
+  EXPECT_NEAR(pc.getPathProgress(), 1.0, 1e-9);
+
+  // Moving sideways, away from the path, isn't progress
+  rclcpp::sleep_for(std::chrono::milliseconds(600));
+  pose.pose.position.y = 1.5;
+  EXPECT_TRUE(pc.check(pose));
+  rclcpp::sleep_for(std::chrono::milliseconds(600));
+  pose.pose.position.y = -1.5;
+  EXPECT_FALSE(pc.check(pose));
+
+  // Moving along it is
+  pose.pose.position.x = 1.6;
+  EXPECT_TRUE(pc.check(pose));
+  EXPECT_NEAR(pc.getPathProgress(), 1.6, 1e-9);
+
+  // A replanned path keeps the baseline
+  pc.setPlan(straightPath(10.0, 0.25));
+  rclcpp::sleep_for(std::chrono::milliseconds(1100));
+  pose.pose.position.x = 1.8;
+  EXPECT_FALSE(pc.check(pose));
+}
+
+TEST(PathProgressChecker, falls_back_without_a_path)
+{
+  auto x = std::make_shared<TestLifecycleNode>("path_progress_checker");
+
+  PathProgressChecker pc;
+  pc.initialize(x, "nav2_controller");
+  checkMacro(pc, 0, 0, 1, 0, 1, true);
+  checkMacro(pc, 0, 0, 0, 0, 11, false);
+}
+
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
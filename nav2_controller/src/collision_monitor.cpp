@@ -0,0 +1,497 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_controller/collision_monitor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "nav2_util/robot_utils.hpp"
+#include "nav2_util/se2.hpp"
+#include "nav2_util/shared_tf_buffer.hpp"
+#include "tf2/utils.h"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+#include "tf2_ros/create_timer_ros.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_CONTROLLER_SSE2
+#include <emmintrin.h>
+#endif
+
+using std::placeholders::_1;
+
+namespace nav2_controller
+{
+
+ZonePolygon::ZonePolygon(const std::vector<geometry_msgs::msg::Point> & vertices)
+{
+  if (vertices.size() < 3) {
+    return;
+  }
+  min_x_ = max_x_ = static_cast<float>(vertices[0].x);
+  min_y_ = max_y_ = static_cast<float>(vertices[0].y);
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    const auto & a = vertices[i];
+    const auto & b = vertices[(i + 1) % vertices.size()];
+    min_x_ = std::min(min_x_, static_cast<float>(a.x));
+    max_x_ = std::max(max_x_, static_cast<float>(a.x));
+    min_y_ = std::min(min_y_, static_cast<float>(a.y));
+    max_y_ = std::max(max_y_, static_cast<float>(a.y));
+    // Horizontal edges are never crossed by the rays along x
+    if (a.y == b.y) {
+      continue;
+    }
+    const auto & low = a.y < b.y ? a : b;
+    const auto & high = a.y < b.y ? b : a;
+    edge_x_.push_back(static_cast<float>(low.x));
+    edge_y_.push_back(static_cast<float>(low.y));
+    edge_slope_.push_back(static_cast<float>((high.x - low.x) / (high.y - low.y)));
+    edge_top_.push_back(static_cast<float>(high.y));
+  }
+}
+
+std::size_t ZonePolygon::countInside(
+  const float * x, const float * y, std::size_t n, std::size_t enough) const
+{
+  if (empty()) {
+    return 0;
+  }
+  const std::size_t edges = edge_x_.size();
+  std::size_t count = 0;
+  std::size_t i = 0;
+
+#ifdef NAV2_CONTROLLER_SSE2
+  const __m128 min_x = _mm_set1_ps(min_x_), max_x = _mm_set1_ps(max_x_);
+  const __m128 min_y = _mm_set1_ps(min_y_), max_y = _mm_set1_ps(max_y_);
+  for (; i + 4 <= n && count < enough; i += 4) {
+    const __m128 px = _mm_loadu_ps(x + i);
+    const __m128 py = _mm_loadu_ps(y + i);
+    const __m128 in_box = _mm_and_ps(
+      _mm_and_ps(_mm_cmpge_ps(px, min_x), _mm_cmple_ps(px, max_x)),
+      _mm_and_ps(_mm_cmpge_ps(py, min_y), _mm_cmple_ps(py, max_y)));
+    if (_mm_movemask_ps(in_box) == 0) {
+      continue;
+    }
+    // A lane flips every time the ray from its point along +x crosses an edge
+    __m128 inside = _mm_setzero_ps();
+    for (std::size_t e = 0; e < edges; ++e) {
+      const __m128 low = _mm_set1_ps(edge_y_[e]);
+      const __m128 spans = _mm_and_ps(
+        _mm_cmpge_ps(py, low), _mm_cmplt_ps(py, _mm_set1_ps(edge_top_[e])));
+      const __m128 cross_x = _mm_add_ps(
+        _mm_set1_ps(edge_x_[e]), _mm_mul_ps(_mm_sub_ps(py, low), _mm_set1_ps(edge_slope_[e])));
+      inside = _mm_xor_ps(inside, _mm_and_ps(spans, _mm_cmplt_ps(px, cross_x)));
+    }
+    const int mask = _mm_movemask_ps(_mm_and_ps(inside, in_box));
+    count += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+  }
+#endif
+
+  for (; i < n && count < enough; ++i) {
+    const float px = x[i];
+    const float py = y[i];
+    if (px < min_x_ || px > max_x_ || py < min_y_ || py > max_y_) {
+      continue;
+    }
+    bool inside = false;
+    for (std::size_t e = 0; e < edges; ++e) {
+      if (py >= edge_y_[e] && py < edge_top_[e] &&
+        px < edge_x_[e] + (py - edge_y_[e]) * edge_slope_[e])
+      {
+        inside = !inside;
+      }
+    }
+    count += inside ? 1 : 0;
+  }
+  return count;
+}
+
+CollisionMonitor::CollisionMonitor(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("collision_monitor", "", true, options)
+{
+  RCLCPP_INFO(get_logger(), "Creating collision monitor");
+
+  declare_parameter("base_frame_id", rclcpp::ParameterValue(std::string("base_link")));
+  declare_parameter("global_frame", rclcpp::ParameterValue(std::string("odom")));
+  declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.1));
+  declare_parameter("share_tf_buffer", rclcpp::ParameterValue(false));
+  declare_parameter("cmd_vel_in_topic", rclcpp::ParameterValue(std::string("cmd_vel_raw")));
+  declare_parameter("cmd_vel_out_topic", rclcpp::ParameterValue(std::string("cmd_vel")));
+  declare_parameter("footprint", rclcpp::ParameterValue(std::string("")));
+  declare_parameter(
+    "footprint_topic",
+    rclcpp::ParameterValue(std::string("local_costmap/published_footprint")));
+  declare_parameter("stop_padding", rclcpp::ParameterValue(0.05));
+  declare_parameter("slowdown_padding", rclcpp::ParameterValue(0.3));
+  declare_parameter("slowdown_ratio", rclcpp::ParameterValue(0.5));
+  declare_parameter("min_points", rclcpp::ParameterValue(1));
+  declare_parameter("source_timeout", rclcpp::ParameterValue(0.5));
+  declare_parameter("observation_sources", std::vector<std::string>());
+}
+
+CollisionMonitor::~CollisionMonitor()
+{
+}
+
+nav2_util::CallbackReturn
+CollisionMonitor::on_configure(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(get_logger(), "Configuring");
+  auto node = shared_from_this();
+
+  get_parameter("base_frame_id", base_frame_);
+  get_parameter("global_frame", global_frame_);
+  get_parameter("transform_tolerance", transform_tolerance_);
+  get_parameter("stop_padding", stop_padding_);
+  get_parameter("slowdown_padding", slowdown_padding_);
+  get_parameter("slowdown_ratio", slowdown_ratio_);
+  min_points_ = static_cast<std::size_t>(std::max<int64_t>(
+      get_parameter("min_points").as_int(), 1));
+  source_timeout_ = rclcpp::Duration::from_seconds(get_parameter("source_timeout").as_double());
+
+  if (get_parameter("share_tf_buffer").as_bool()) {
+    tf_ = nav2_util::getSharedTfBuffer(get_parameter("use_sim_time").as_bool());
+  } else {
+    tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      get_node_base_interface(), get_node_timers_interface());
+    tf_->setCreateTimerInterface(timer_interface);
+    transform_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_);
+  }
+
+  // A footprint given as a parameter is in the robot frame already and never changes
+  const std::string footprint = get_parameter("footprint").as_string();
+  if (!footprint.empty()) {
+    std::vector<geometry_msgs::msg::Point> spec;
+    if (!nav2_costmap_2d::makeFootprintFromString(footprint, spec)) {
+      RCLCPP_ERROR(get_logger(), "Invalid footprint %s", footprint.c_str());
+      return nav2_util::CallbackReturn::FAILURE;
+    }
+    auto stop = spec, slowdown = spec;
+    nav2_costmap_2d::padFootprint(stop, stop_padding_);
+    nav2_costmap_2d::padFootprint(slowdown, slowdown_padding_);
+    stop_zone_ = ZonePolygon(stop);
+    slowdown_zone_ = ZonePolygon(slowdown);
+  } else {
+    footprint_sub_ = std::make_unique<nav2_costmap_2d::FootprintSubscriber>(
+      node, get_parameter("footprint_topic").as_string(), 1.0);
+  }
+
+  cmd_vel_pub_ = create_publisher<geometry_msgs::msg::Twist>(
+    get_parameter("cmd_vel_out_topic").as_string(), 1);
+  cmd_vel_sub_ = create_subscription<geometry_msgs::msg::Twist>(
+    get_parameter("cmd_vel_in_topic").as_string(), 1,
+    std::bind(&CollisionMonitor::cmdVelCallback, this, _1));
+
+  // Sensor data queues would only add latency, each source keeps its latest message
+  const rclcpp::QoS qos = rclcpp::SensorDataQoS().keep_last(1);
+  for (const auto & name : get_parameter("observation_sources").as_string_array()) {
+    nav2_util::declare_parameter_if_not_declared(
+      node, name + ".topic", rclcpp::ParameterValue(name));
+    nav2_util::declare_parameter_if_not_declared(
+      node, name + ".data_type", rclcpp::ParameterValue(std::string("LaserScan")));
+    nav2_util::declare_parameter_if_not_declared(
+      node, name + ".min_obstacle_height", rclcpp::ParameterValue(0.05));
+    nav2_util::declare_parameter_if_not_declared(
+      node, name + ".max_obstacle_height", rclcpp::ParameterValue(2.0));
+
+    auto source = std::make_unique<Source>();
+    source->name = name;
+    source->stamp = now();
+    get_parameter(name + ".min_obstacle_height", source->min_height);
+    get_parameter(name + ".max_obstacle_height", source->max_height);
+    const std::string topic = get_parameter(name + ".topic").as_string();
+    const std::string data_type = get_parameter(name + ".data_type").as_string();
+    Source & ref = *source;
+    if (data_type == "LaserScan") {
+      source_subs_.push_back(
+        create_subscription<sensor_msgs::msg::LaserScan>(
+          topic, qos, [this, &ref](sensor_msgs::msg::LaserScan::ConstSharedPtr msg) {
+            scanCallback(ref, msg);
+          }));
+    } else if (data_type == "PointCloud2") {
+      source_subs_.push_back(
+        create_subscription<sensor_msgs::msg::PointCloud2>(
+          topic, qos, [this, &ref](sensor_msgs::msg::PointCloud2::ConstSharedPtr msg) {
+            cloudCallback(ref, msg);
+          }));
+    } else {
+      RCLCPP_ERROR(
+        get_logger(), "Source %s has data_type %s, only LaserScan and PointCloud2 are supported",
+        name.c_str(), data_type.c_str());
+      return nav2_util::CallbackReturn::FAILURE;
+    }
+    RCLCPP_INFO(get_logger(), "Monitoring %s on %s", name.c_str(), topic.c_str());
+    sources_.push_back(std::move(source));
+  }
+  if (sources_.empty()) {
+    RCLCPP_WARN(get_logger(), "No observation_sources, commands are only forwarded");
+  }
+
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn
+CollisionMonitor::on_activate(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(get_logger(), "Activating");
+  cmd_vel_pub_->on_activate();
+  createBond();
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn
+CollisionMonitor::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(get_logger(), "Deactivating");
+  publish(geometry_msgs::msg::Twist());
+  cmd_vel_pub_->on_deactivate();
+  destroyBond();
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn
+CollisionMonitor::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(get_logger(), "Cleaning up");
+  source_subs_.clear();
+  cmd_vel_sub_.reset();
+  cmd_vel_pub_.reset();
+  footprint_sub_.reset();
+  transform_listener_.reset();
+  tf_.reset();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  sources_.clear();
+  stop_zone_ = ZonePolygon();
+  slowdown_zone_ = ZonePolygon();
+  footprint_version_ = 0;
+  output_action_ = Action::STOP;
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn
+CollisionMonitor::on_shutdown(const rclcpp_lifecycle::State &)
+{
+  RCLCPP_INFO(get_logger(), "Shutting down");
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+bool CollisionMonitor::sensorTransform(const std::string & frame, float transform[12])
+{
+  // The latest transform, sensors are mounted on the robot and waiting would add latency
+  geometry_msgs::msg::TransformStamped sensor_to_base;
+  try {
+    sensor_to_base = tf_->lookupTransform(base_frame_, frame, tf2::TimePointZero);
+  } catch (const tf2::TransformException & ex) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), *get_clock(), 1000, "No transform from %s to %s: %s", frame.c_str(),
+      base_frame_.c_str(), ex.what());
+    return false;
+  }
+
+  tf2::Transform t;
+  tf2::fromMsg(sensor_to_base.transform, t);
+  const tf2::Matrix3x3 & r = t.getBasis();
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      transform[row * 4 + col] = static_cast<float>(r[row][col]);
+    }
+    transform[row * 4 + 3] = static_cast<float>(t.getOrigin()[row]);
+  }
+  return true;
+}
+
+void CollisionMonitor::scanCallback(
+  Source & source, sensor_msgs::msg::LaserScan::ConstSharedPtr scan)
+{
+  float transform[12];
+  if (!sensorTransform(scan->header.frame_id, transform)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  source.angles.update(*scan);
+  const std::size_t beams = std::min(scan->ranges.size(), source.angles.cos_table.size());
+  source.x.clear();
+  source.y.clear();
+  for (std::size_t i = 0; i < beams; ++i) {
+    const float range = scan->ranges[i];
+    // Also drops NaNs
+    if (!(range >= scan->range_min && range < scan->range_max)) {
+      continue;
+    }
+    const float bx = range * source.angles.cos_table[i];
+    const float by = range * source.angles.sin_table[i];
+    source.x.push_back(transform[0] * bx + transform[1] * by + transform[3]);
+    source.y.push_back(transform[4] * bx + transform[5] * by + transform[7]);
+  }
+  updateSource(source, scan->header.stamp);
+}
+
+void CollisionMonitor::cloudCallback(
+  Source & source, sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud)
+{
+  uint32_t offset_x, offset_y, offset_z;
+  if (!nav2_costmap_2d::floatFieldOffset(*cloud, "x", offset_x) ||
+    !nav2_costmap_2d::floatFieldOffset(*cloud, "y", offset_y) ||
+    !nav2_costmap_2d::floatFieldOffset(*cloud, "z", offset_z))
+  {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), *get_clock(), 1000, "Cloud of %s has no float32 x, y and z fields",
+      source.name.c_str());
+    return;
+  }
+  float transform[12];
+  if (!sensorTransform(cloud->header.frame_id, transform)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  source.x.clear();
+  source.y.clear();
+  for (uint32_t row = 0; row < cloud->height; ++row) {
+    const uint8_t * point = cloud->data.data() + static_cast<std::size_t>(row) * cloud->row_step;
+    for (uint32_t col = 0; col < cloud->width; ++col, point += cloud->point_step) {
+      const float px = nav2_costmap_2d::readFloat(point, offset_x);
+      const float py = nav2_costmap_2d::readFloat(point, offset_y);
+      const float pz = nav2_costmap_2d::readFloat(point, offset_z);
+      const float z = transform[8] * px + transform[9] * py + transform[10] * pz + transform[11];
+      // Also drops NaNs
+      if (!(z >= source.min_height && z <= source.max_height)) {
+        continue;
+      }
+      source.x.push_back(transform[0] * px + transform[1] * py + transform[2] * pz + transform[3]);
+      source.y.push_back(transform[4] * px + transform[5] * py + transform[6] * pz + transform[7]);
+    }
+  }
+  updateSource(source, cloud->header.stamp);
+}
+
+void CollisionMonitor::updateSource(Source & source, const rclcpp::Time & stamp)
+{
+  updateZones();
+  source.stamp = stamp;
+  source.received = true;
+  if (stop_zone_.empty()) {
+    source.action = Action::STOP;
+  } else if (stop_zone_.countInside(
+      source.x.data(), source.y.data(), source.x.size(), min_points_) >= min_points_)
+  {
+    source.action = Action::STOP;
+  } else if (slowdown_zone_.countInside(
+      source.x.data(), source.y.data(), source.x.size(), min_points_) >= min_points_)
+  {
+    source.action = Action::SLOWDOWN;
+  } else {
+    source.action = Action::PASS;
+  }
+
+  // Stopping can't wait for the next command
+  if (source.action == Action::STOP && output_action_ != Action::STOP) {
+    RCLCPP_WARN(get_logger(), "%s sees an obstacle in the stop zone", source.name.c_str());
+    output_action_ = Action::STOP;
+    publish(geometry_msgs::msg::Twist());
+  }
+}
+
+void CollisionMonitor::updateZones()
+{
+  if (!footprint_sub_) {
+    return;
+  }
+  // Read before the footprint itself, so a message arriving in between is picked up next time
+  const uint64_t version = footprint_sub_->getFootprintVersion();
+  if (version == footprint_version_) {
+    return;
+  }
+
+  // The footprint is published oriented in the global frame, at the current robot pose
+  std::vector<geometry_msgs::msg::Point> oriented;
+  geometry_msgs::msg::PoseStamped pose;
+  if (!footprint_sub_->getFootprint(oriented) ||
+    !nav2_util::getCurrentPose(pose, *tf_, global_frame_, base_frame_, transform_tolerance_))
+  {
+    return;
+  }
+  std::vector<geometry_msgs::msg::Point> temp, spec;
+  nav2_costmap_2d::transformFootprint(
+    -pose.pose.position.x, -pose.pose.position.y, 0, oriented, temp);
+  nav2_costmap_2d::transformFootprint(
+    0, 0, -nav2_util::se2::yaw(pose.pose.orientation), temp, spec);
+
+  auto stop = spec, slowdown = spec;
+  nav2_costmap_2d::padFootprint(stop, stop_padding_);
+  nav2_costmap_2d::padFootprint(slowdown, slowdown_padding_);
+  stop_zone_ = ZonePolygon(stop);
+  slowdown_zone_ = ZonePolygon(slowdown);
+  footprint_version_ = version;
+}
+
+CollisionMonitor::Action CollisionMonitor::currentAction()
+{
+  if (stop_zone_.empty()) {
+    RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 1000, "No footprint yet, stopping");
+    return Action::STOP;
+  }
+  const rclcpp::Time oldest = now() - source_timeout_;
+  Action action = Action::PASS;
+  for (const auto & source : sources_) {
+    if (!source->received || source->stamp < oldest) {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 1000, "%s timed out, stopping", source->name.c_str());
+      return Action::STOP;
+    }
+    action = std::max(action, source->action);
+  }
+  return action;
+}
+
+void CollisionMonitor::cmdVelCallback(geometry_msgs::msg::Twist::ConstSharedPtr cmd_vel)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  updateZones();
+  output_action_ = currentAction();
+  geometry_msgs::msg::Twist out;
+  if (output_action_ == Action::PASS) {
+    out = *cmd_vel;
+  } else if (output_action_ == Action::SLOWDOWN) {
+    out.linear.x = cmd_vel->linear.x * slowdown_ratio_;
+    out.linear.y = cmd_vel->linear.y * slowdown_ratio_;
+    out.angular.z = cmd_vel->angular.z * slowdown_ratio_;
+  }
+  publish(out);
+}
+
+void CollisionMonitor::publish(const geometry_msgs::msg::Twist & cmd_vel)
+{
+  if (cmd_vel_pub_ && cmd_vel_pub_->is_activated()) {
+    cmd_vel_pub_->publish(cmd_vel);
+  }
+}
+
+}  // namespace nav2_controller
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_controller::CollisionMonitor)
@@ -0,0 +1,170 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+#include "nav2_controller/control_loop_timer.hpp"
+
+namespace nav2_controller
+{
+
+ControlLoopTimer::ControlLoopTimer(double frequency, unsigned int histogram_bins)
+: frequency_(frequency),
+  period_(std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / frequency))),
+  // Lateness should be a small fraction of the period, work time up to a couple of periods
+  lateness_bin_width_(period_ / 100),
+  work_time_bin_width_(period_ / 10),
+  lateness_histogram_(histogram_bins, 0),
+  work_time_histogram_(histogram_bins, 0),
+  max_lateness_(Clock::duration::zero()),
+  max_work_time_(Clock::duration::zero()),
+  cycles_(0),
+  missed_deadlines_(0)
+{
+}
+
+void ControlLoopTimer::start()
+{
+  cycle_start_ = Clock::now();
+  deadline_ = cycle_start_ + period_;
+}
+
+bool ControlLoopTimer::sleep()
+{
+  auto now = Clock::now();
+  auto work_time = now - cycle_start_;
+  record(work_time_histogram_, work_time_bin_width_, work_time);
+  max_work_time_ = std::max(max_work_time_, work_time);
+  cycles_++;
+
+  bool on_time = now < deadline_;
+  if (on_time) {
+    sleepUntil(deadline_);
+    now = Clock::now();
+  } else {
+    missed_deadlines_++;
+  }
+
+  // A late cycle starts right away and the deadlines it missed are dropped
+  auto lateness = now - deadline_;
+  record(lateness_histogram_, lateness_bin_width_, lateness);
+  max_lateness_ = std::max(max_lateness_, lateness);
+
+  cycle_start_ = now;
+  deadline_ += period_ * ((now - deadline_) / period_ + 1);
+  return on_time;
+}
+
+void ControlLoopTimer::takeStatistics(nav2_msgs::msg::ControlLoopStatistics & stats)
+{
+  using seconds = std::chrono::duration<double>;
+
+  stats.desired_frequency = frequency_;
+  stats.cycles = cycles_;
+  stats.missed_deadlines = missed_deadlines_;
+  stats.max_lateness = seconds(max_lateness_).count();
+  stats.lateness_bin_width = seconds(lateness_bin_width_).count();
+  stats.lateness_histogram = lateness_histogram_;
+  stats.max_work_time = seconds(max_work_time_).count();
+  stats.work_time_bin_width = seconds(work_time_bin_width_).count();
+  stats.work_time_histogram = work_time_histogram_;
+
+  std::fill(lateness_histogram_.begin(), lateness_histogram_.end(), 0);
+  std::fill(work_time_histogram_.begin(), work_time_histogram_.end(), 0);
+  max_lateness_ = Clock::duration::zero();
+  max_work_time_ = Clock::duration::zero();
+  cycles_ = 0;
+  missed_deadlines_ = 0;
+}
+
+void ControlLoopTimer::record(
+  std::vector<uint32_t> & histogram, Clock::duration bin_width, Clock::duration value)
+{
+  if (histogram.empty()) {
+    return;
+  }
+  auto bin = value < Clock::duration::zero() ? 0 : value / bin_width;
+  histogram[std::min<decltype(bin)>(bin, histogram.size() - 1)]++;
+}
+
+void ControlLoopTimer::sleepUntil(const Clock::time_point & time)
+{
+#ifdef __linux__
+  // steady_clock is CLOCK_MONOTONIC, so its time points can be used as absolute deadlines
+  auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time.time_since_epoch()).count();
+  timespec ts;
+  ts.tv_sec = since_epoch / 1000000000;
+  ts.tv_nsec = since_epoch % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+#else
+  std::this_thread::sleep_until(time);
+#endif
+}
+
+bool ControlLoopTimer::setThreadScheduling(
+  int priority, const std::vector<int64_t> & cpus, std::string & error)
+{
+  if (priority <= 0 && cpus.empty()) {
+    return true;
+  }
+
+#ifdef __linux__
+  bool success = true;
+  if (priority > 0) {
+    sched_param param;
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+      error = std::string("SCHED_FIFO priority ") + std::to_string(priority) + ": " +
+        std::strerror(rc);
+      success = false;
+    }
+  }
+
+  if (!cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(static_cast<int>(cpu), &cpu_set);
+      }
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (rc != 0) {
+      error += std::string(error.empty() ? "" : ", ") + "CPU affinity: " + std::strerror(rc);
+      success = false;
+    }
+  }
+  return success;
+#else
+  error = "thread scheduling can only be configured on Linux";
+  return false;
+#endif
+}
+
+}  // namespace nav2_controller
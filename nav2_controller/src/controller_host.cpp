@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Hosts the controller servers of several robots in one process. The robots
+// share the process' middleware participant, the plugin libraries and one
+// executor, instead of a process and two spinning threads each.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_controller/nav2_controller.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  auto host = std::make_shared<rclcpp::Node>("controller_host");
+  const auto robots = host->declare_parameter("robots", std::vector<std::string>());
+  const int threads = host->declare_parameter("threads", 0);
+  if (robots.empty()) {
+    RCLCPP_ERROR(host->get_logger(), "No robots given in the robots parameter");
+    rclcpp::shutdown();
+    return 1;
+  }
+
+  // 0 threads is one per core
+  rclcpp::executors::MultiThreadedExecutor executor(
+    rclcpp::ExecutorOptions(), threads > 0 ? threads : 0);
+
+  // Every server takes the process' parameter files, wildcard namespaces
+  // (/**/controller_server) let the robots share one parameter set
+  std::vector<std::shared_ptr<nav2_controller::ControllerServer>> servers;
+  for (const auto & robot : robots) {
+    rclcpp::NodeOptions options;
+    options.arguments({"--ros-args", "-r", "__ns:=/" + robot});
+    options.parameter_overrides({rclcpp::Parameter("costmap_thread", false)});
+    auto server = std::make_shared<nav2_controller::ControllerServer>(options);
+    executor.add_node(server->get_node_base_interface());
+    executor.add_node(server->getCostmapROS()->get_node_base_interface());
+    servers.push_back(server);
+  }
+  RCLCPP_INFO(host->get_logger(), "Hosting the controllers of %zu robots", servers.size());
+
+  executor.add_node(host);
+  executor.spin();
+
+  servers.clear();
+  rclcpp::shutdown();
+  return 0;
+}
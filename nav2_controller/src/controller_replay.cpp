@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Computes again the velocity of a controller server snapshot, from the pose, velocity
+// and plan of its last cycle, against the local costmap of that cycle, with the
+// controller configured as the server had it:
+//
+//   ros2 run nav2_controller controller_replay <snapshot> [--plugin <controller id>]
+//     [--runs <n>] [--trace <file>]
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_core/controller.hpp"
+#include "nav2_costmap_2d/costmap_snapshot.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/snapshot.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
+#include "nav2_util/snapshot_replay.hpp"
+#include "pluginlib/class_loader.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  nav2_util::ReplayOptions options;
+  if (!nav2_util::parseReplayOptions(rclcpp::remove_ros_arguments(argc, argv), options)) {
+    return 1;
+  }
+  auto snapshot = nav2_util::Snapshot::load(options.snapshot);
+  if (!snapshot || !snapshot->has("controller/id")) {
+    std::fprintf(stderr, "%s is not a controller server snapshot\n", options.snapshot.c_str());
+    return 1;
+  }
+
+  nav_msgs::msg::Path plan;
+  geometry_msgs::msg::PoseStamped pose;
+  geometry_msgs::msg::Twist velocity, recorded_cmd_vel;
+  nav2_util::readPath(*snapshot, "controller/plan", plan);
+  nav2_util::readPose(*snapshot, "controller/pose", pose);
+  nav2_util::readTwist(*snapshot, "controller/velocity", velocity);
+  nav2_util::readTwist(*snapshot, "controller/cmd_vel", recorded_cmd_vel);
+  const std::string controller_id =
+    options.plugin.empty() ? snapshot->string("controller/id") : options.plugin;
+
+  // A node of the server's name and parameters, for the controller to configure from
+  rclcpp::NodeOptions node_options;
+  node_options.parameter_overrides(
+    nav2_util::readParameters(*snapshot, "controller/parameters"));
+  node_options.allow_undeclared_parameters(true);
+  auto node = std::make_shared<nav2_util::LifecycleNode>(
+    snapshot->source(), "", false, node_options);
+
+  std::string controller_type;
+  if (!node->get_parameter(controller_id + ".plugin", controller_type)) {
+    std::fprintf(
+      stderr, "Controller %s is not a plugin of the snapshot\n", controller_id.c_str());
+    return 1;
+  }
+
+  // The plan and pose are in the frame of this costmap, so no transform is needed
+  auto costmap_ros = nav2_costmap_2d::replayCostmapROS(*snapshot, "local_costmap");
+  if (!costmap_ros) {
+    std::fprintf(stderr, "The snapshot has no local costmap\n");
+    return 1;
+  }
+
+  pluginlib::ClassLoader<nav2_core::Controller> loader("nav2_core", "nav2_core::Controller");
+  nav2_core::Controller::Ptr controller = loader.createUniqueInstance(controller_type);
+  controller->configure(node, controller_id, costmap_ros->getTfBuffer(), costmap_ros);
+  controller->activate();
+
+  double recorded_duration = 0.0;
+  snapshot->value("controller/duration", recorded_duration);
+  std::printf(
+    "Replaying %s (%s) at (%.2f, %.2f) along a plan of %zu poses, recorded in %.3f ms "
+    "commanding (%.3f, %.3f, %.3f)\n", controller_id.c_str(), controller_type.c_str(),
+    pose.pose.position.x, pose.pose.position.y, plan.poses.size(), recorded_duration * 1e3,
+    recorded_cmd_vel.linear.x, recorded_cmd_vel.linear.y, recorded_cmd_vel.angular.z);
+
+  // Controllers may prune their plan as they go, so each run starts from the whole of it
+  geometry_msgs::msg::TwistStamped cmd_vel;
+  std::string failure;
+  nav2_util::runReplay(
+    options, "controller.plugin", controller_id,
+    [&]() {
+      try {
+        cmd_vel = controller->computeVelocityCommands(pose, velocity);
+      } catch (const std::exception & ex) {
+        failure = ex.what();
+      }
+    },
+    [&]() {
+      controller->setPlan(plan);
+    });
+  if (failure.empty()) {
+    std::printf(
+      "Replayed command (%.3f, %.3f, %.3f)\n",
+      cmd_vel.twist.linear.x, cmd_vel.twist.linear.y, cmd_vel.twist.angular.z);
+  } else {
+    std::printf("The controller failed: %s\n", failure.c_str());
+  }
+
+  controller->deactivate();
+  controller->cleanup();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -12,17 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <vector>
 #include <memory>
 #include <string>
 #include <utility>
 
 #include "nav2_core/exceptions.hpp"
+#include "nav2_costmap_2d/costmap_snapshot.hpp"
 #include "nav_2d_utils/conversions.hpp"
 #include "nav_2d_utils/tf_help.hpp"
+#include "nav2_util/compact_path.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "nav2_controller/nav2_controller.hpp"
 
 using namespace std::chrono_literals;
@@ -30,8 +36,8 @@ using namespace std::chrono_literals;
 namespace nav2_controller
 {
 
-ControllerServer::ControllerServer()
-: LifecycleNode("controller_server", "", true),
+ControllerServer::ControllerServer(const rclcpp::NodeOptions & options)
+: LifecycleNode("controller_server", "", true, options),
   progress_checker_loader_("nav2_core", "nav2_core::ProgressChecker"),
   default_progress_checker_id_{"progress_checker"},
   default_progress_checker_type_{"nav2_controller::SimpleProgressChecker"},
@@ -45,6 +51,8 @@ ControllerServer::ControllerServer()
   RCLCPP_INFO(get_logger(), "Creating controller server");
 
   declare_parameter("controller_frequency", 20.0);
+  declare_parameter("controller_thread_priority", 0);
+  declare_parameter("controller_cpu_affinity", std::vector<int64_t>());
 
   declare_parameter("progress_checker_plugin", default_progress_checker_id_);
   declare_parameter("goal_checker_plugin", default_goal_checker_id_);
@@ -52,13 +60,22 @@ ControllerServer::ControllerServer()
   declare_parameter("min_x_velocity_threshold", rclcpp::ParameterValue(0.0001));
   declare_parameter("min_y_velocity_threshold", rclcpp::ParameterValue(0.0001));
   declare_parameter("min_theta_velocity_threshold", rclcpp::ParameterValue(0.0001));
+  declare_parameter("costmap_thread", true);
+  declare_parameter("smoothing_frequency", rclcpp::ParameterValue(0.0));
+  declare_parameter("smoothing_feedback", rclcpp::ParameterValue(std::string("open_loop")));
+  declare_parameter("smoothing_timeout", rclcpp::ParameterValue(0.5));
+  declare_parameter("smoothing_max_accel", std::vector<double>{2.5, 2.5, 3.2});
+  declare_parameter("smoothing_max_decel", std::vector<double>{2.5, 2.5, 3.2});
+  declare_parameter("smoothing_max_jerk", std::vector<double>{0.0, 0.0, 0.0});
 
   // The costmap node is used in the implementation of the controller
   costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
     "local_costmap", std::string{get_namespace()}, "local_costmap");
 
-  // Launch a thread to run the costmap node
-  costmap_thread_ = std::make_unique<nav2_util::NodeThread>(costmap_ros_);
+  // Launch a thread to run the costmap node, unless the process spins it with others
+  if (get_parameter("costmap_thread").as_bool()) {
+    costmap_thread_ = std::make_unique<nav2_util::NodeThread>(costmap_ros_);
+  }
 }
 
 ControllerServer::~ControllerServer()
@@ -99,13 +116,51 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
   controller_types_.resize(controller_ids_.size());
 
   get_parameter("controller_frequency", controller_frequency_);
+  get_parameter("controller_thread_priority", controller_thread_priority_);
+  get_parameter("controller_cpu_affinity", controller_cpu_affinity_);
   get_parameter("min_x_velocity_threshold", min_x_velocity_threshold_);
   get_parameter("min_y_velocity_threshold", min_y_velocity_threshold_);
   get_parameter("min_theta_velocity_threshold", min_theta_velocity_threshold_);
   RCLCPP_INFO(get_logger(), "Controller frequency set to %.4fHz", controller_frequency_);
 
+  get_parameter("smoothing_frequency", smoothing_frequency_);
+  if (smoothing_frequency_ > 0.0) {
+    const std::string feedback = get_parameter("smoothing_feedback").as_string();
+    if (feedback != "open_loop" && feedback != "closed_loop") {
+      RCLCPP_ERROR(
+        get_logger(), "smoothing_feedback is %s, expected open_loop or closed_loop",
+        feedback.c_str());
+      return nav2_util::CallbackReturn::FAILURE;
+    }
+    smoothing_closed_loop_ = feedback == "closed_loop";
+    const auto accel = get_parameter("smoothing_max_accel").as_double_array();
+    const auto decel = get_parameter("smoothing_max_decel").as_double_array();
+    const auto jerk = get_parameter("smoothing_max_jerk").as_double_array();
+    if (accel.size() != 3 || decel.size() != 3 || jerk.size() != 3) {
+      RCLCPP_ERROR(
+        get_logger(), "smoothing_max_accel, smoothing_max_decel and smoothing_max_jerk need "
+        "an x, y and theta limit each");
+      return nav2_util::CallbackReturn::FAILURE;
+    }
+    std::array<VelocitySmoother::Limits, 3> limits;
+    for (std::size_t i = 0; i < 3; ++i) {
+      limits[i] = {accel[i], decel[i], jerk[i]};
+    }
+    smoother_ = std::make_unique<VelocitySmoother>(
+      limits, get_parameter("smoothing_timeout").as_double());
+    RCLCPP_INFO(get_logger(), "Smoothing velocities at %.4fHz", smoothing_frequency_);
+  }
+
   costmap_ros_->on_configure(state);
 
+  for (const auto & layer : *costmap_ros_->getLayeredCostmap()->getPlugins()) {
+    speed_filter_ = std::dynamic_pointer_cast<nav2_costmap_2d::SpeedFilter>(layer);
+    if (speed_filter_) {
+      RCLCPP_INFO(get_logger(), "Limiting speeds by %s", speed_filter_->getName().c_str());
+      break;
+    }
+  }
+
   try {
     progress_checker_type_ = nav2_util::get_plugin_type_param(node, progress_checker_id_);
     progress_checker_ = progress_checker_loader_.createUniqueInstance(progress_checker_type_);
@@ -160,11 +215,17 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
 
   odom_sub_ = std::make_unique<nav_2d_utils::OdomSubscriber>(node);
   vel_publisher_ = create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 1);
+  loop_stats_publisher_ = create_publisher<nav2_msgs::msg::ControlLoopStatistics>(
+    "controller_loop_statistics", 1);
 
   // Create the action server that we implement with our followPath method
   action_server_ = std::make_unique<ActionServer>(
     rclcpp_node_, "follow_path",
     std::bind(&ControllerServer::computeControl, this));
+  feedback_ = std::make_shared<Action::Feedback>();
+
+  snapshot_recorder_ = std::make_unique<nav2_util::SnapshotRecorder>(
+    this, [this](nav2_util::SnapshotWriter & writer) {return fillSnapshot(writer);});
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -180,7 +241,14 @@ ControllerServer::on_activate(const rclcpp_lifecycle::State & state)
     it->second->activate();
   }
   vel_publisher_->on_activate();
+  loop_stats_publisher_->on_activate();
   action_server_->activate();
+  if (smoother_) {
+    smoother_->reset(nav_2d_msgs::msg::Twist2D());
+    smoothing_timer_ = create_wall_timer(
+      std::chrono::duration<double>(1.0 / smoothing_frequency_),
+      std::bind(&ControllerServer::publishSmoothedVelocity, this));
+  }
 
   // create bond connection
   createBond();
@@ -200,8 +268,15 @@ ControllerServer::on_deactivate(const rclcpp_lifecycle::State & state)
   }
   costmap_ros_->on_deactivate(state);
 
-  publishZeroVelocity();
+  // Stopping here can't wait on the smoother
+  smoothing_timer_.reset();
+  if (smoother_) {
+    std::lock_guard<std::mutex> lock(smoother_mutex_);
+    smoother_->reset(nav_2d_msgs::msg::Twist2D());
+  }
+  sendVelocity(geometry_msgs::msg::Twist());
   vel_publisher_->on_deactivate();
+  loop_stats_publisher_->on_deactivate();
 
   // destroy bond connection
   destroyBond();
@@ -220,14 +295,22 @@ ControllerServer::on_cleanup(const rclcpp_lifecycle::State & state)
     it->second->cleanup();
   }
   controllers_.clear();
+  speed_filter_.reset();
   costmap_ros_->on_cleanup(state);
 
   // Release any allocated resources
   action_server_.reset();
   odom_sub_.reset();
   vel_publisher_.reset();
+  loop_stats_publisher_.reset();
   action_server_.reset();
   goal_checker_->reset();
+  smoother_.reset();
+  snapshot_recorder_.reset();
+  {
+    std::lock_guard<std::mutex> lock(last_cycle_mutex_);
+    last_cycle_ = LastCycle();
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -279,10 +362,25 @@ void ControllerServer::computeControl()
       return;
     }
 
-    setPlannerPath(action_server_->get_current_goal()->path);
+    if (!costmap_ros_->waitUntilReady()) {
+      RCLCPP_WARN(get_logger(), "Costmap is not ready, aborting the goal");
+      action_server_->terminate_current();
+      return;
+    }
+
+    setPlannerPath(*action_server_->get_current_goal());
     progress_checker_->reset();
 
-    rclcpp::Rate loop_rate(controller_frequency_);
+    // Each goal is run on a fresh action server thread, so set up its scheduling here
+    std::string error;
+    if (!ControlLoopTimer::setThreadScheduling(
+        controller_thread_priority_, controller_cpu_affinity_, error))
+    {
+      RCLCPP_WARN(get_logger(), "Failed to set control loop scheduling: %s", error.c_str());
+    }
+
+    ControlLoopTimer loop_timer(controller_frequency_);
+    loop_timer.start();
     while (rclcpp::ok()) {
       if (action_server_ == nullptr || !action_server_->is_server_active()) {
         RCLCPP_DEBUG(get_logger(), "Action server unavailable or inactive. Stopping.");
@@ -298,18 +396,29 @@ void ControllerServer::computeControl()
 
       updateGlobalPath();
 
-      computeAndPublishVelocity();
+      // Sample the robot state once per cycle, the odometry is already cached by its subscriber
+      geometry_msgs::msg::PoseStamped pose;
+      if (!getRobotPose(pose)) {
+        throw nav2_core::PlannerException("Failed to obtain robot pose");
+      }
+      nav_2d_msgs::msg::Twist2D twist = getThresholdedTwist(odom_sub_->getTwist());
+
+      computeAndPublishVelocity(pose, twist);
 
-      if (isGoalReached()) {
+      if (isGoalReached(pose, twist)) {
         RCLCPP_INFO(get_logger(), "Reached the goal!");
         break;
       }
 
-      if (!loop_rate.sleep()) {
-        RCLCPP_WARN(
+      if (!loop_timer.sleep()) {
+        RCLCPP_DEBUG(
           get_logger(), "Control loop missed its desired rate of %.4fHz",
           controller_frequency_);
       }
+
+      if (loop_timer.cycles() >= controller_frequency_) {
+        publishLoopStatistics(loop_timer);
+      }
     }
   } catch (nav2_core::PlannerException & e) {
     RCLCPP_ERROR(this->get_logger(), e.what());
@@ -334,50 +443,173 @@ void ControllerServer::setPlannerPath(const nav_msgs::msg::Path & path)
   if (path.poses.empty()) {
     throw nav2_core::PlannerException("Invalid path, Path is empty.");
   }
-  controllers_[current_controller_]->setPlan(path);
+  {
+    nav2_util::ScopedTrace trace("controller.set_plan", current_controller_);
+    controllers_[current_controller_]->setPlan(path);
+  }
+  setPathCheckers(
+    path.header, path.poses.size(), [&path](size_t i) {return path.poses[i].pose;});
+}
+
+void ControllerServer::setPlannerPath(const nav2_msgs::action::FollowPath::Goal & goal)
+{
+  const size_t size = nav2_util::compactPathSize(goal.compact_path);
+  if (!goal.path.poses.empty() || size == 0) {
+    setPlannerPath(goal.path);
+    return;
+  }
+
+  RCLCPP_DEBUG(
+    get_logger(),
+    "Providing compact path to the controller %s", current_controller_.c_str());
+  const nav2_msgs::msg::CompactPath & path = goal.compact_path;
+  {
+    nav2_util::ScopedTrace trace("controller.set_plan", current_controller_);
+    controllers_[current_controller_]->setPlan(path);
+  }
+  setPathCheckers(
+    path.header, size, [&path](size_t i) {return nav2_util::compactPathPose(path, i);});
+}
 
-  auto end_pose = path.poses.back();
-  end_pose.header.frame_id = path.header.frame_id;
+void ControllerServer::setPathCheckers(
+  const std_msgs::msg::Header & header, size_t size,
+  const std::function<geometry_msgs::msg::Pose(size_t)> & pose_at)
+{
+  geometry_msgs::msg::PoseStamped end_pose;
+  end_pose.header = header;
+  end_pose.pose = pose_at(size - 1);
   rclcpp::Duration tolerance(costmap_ros_->getTransformTolerance() * 1e9);
   nav_2d_utils::transformPose(
     costmap_ros_->getTfBuffer(), costmap_ros_->getGlobalFrameID(),
     end_pose, end_pose, tolerance);
   goal_checker_->reset();
 
+  // Once per path, so that checking progress along it takes no TF lookup per cycle
+  nav_msgs::msg::Path local_path;
+  local_path.header.frame_id = costmap_ros_->getGlobalFrameID();
+  local_path.header.stamp = header.stamp;
+  local_path.poses.resize(size);
+  for (size_t i = 0; i < size; i++) {
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header = header;
+    pose.pose = pose_at(i);
+    nav_2d_utils::transformPose(
+      costmap_ros_->getTfBuffer(), local_path.header.frame_id, pose, local_path.poses[i],
+      tolerance);
+  }
+  progress_checker_->setPlan(local_path);
+  if (snapshot_recorder_) {
+    std::lock_guard<std::mutex> lock(last_cycle_mutex_);
+    last_cycle_.controller_id = current_controller_;
+    last_cycle_.plan = local_path;
+    last_cycle_.costmap.reset();
+  }
+
   RCLCPP_DEBUG(
     get_logger(), "Path end point is (%.2f, %.2f)",
     end_pose.pose.position.x, end_pose.pose.position.y);
   end_pose_ = end_pose.pose;
 }
 
-void ControllerServer::computeAndPublishVelocity()
+void ControllerServer::computeAndPublishVelocity(
+  geometry_msgs::msg::PoseStamped & pose,
+  const nav_2d_msgs::msg::Twist2D & twist)
 {
-  geometry_msgs::msg::PoseStamped pose;
-
-  if (!getRobotPose(pose)) {
-    throw nav2_core::PlannerException("Failed to obtain robot pose");
+  nav2_util::ScopedTrace trace(
+    "controller.compute_velocity", current_controller_, nav2_util::traceStamp(pose.header.stamp));
+  {
+    nav2_util::ScopedTrace progress_trace("controller.check_progress", progress_checker_id_);
+    if (!progress_checker_->check(pose)) {
+      throw nav2_core::PlannerException("Failed to make progress");
+    }
   }
 
-  if (!progress_checker_->check(pose)) {
-    throw nav2_core::PlannerException("Failed to make progress");
+  geometry_msgs::msg::TwistStamped cmd_vel_2d;
+  {
+    nav2_util::ScopedTrace plugin_trace("controller.plugin", current_controller_);
+    const geometry_msgs::msg::Twist velocity = nav_2d_utils::twist2Dto3D(twist);
+    auto costmap = costmap_ros_->getCostmapSnapshot();
+    const auto started = std::chrono::steady_clock::now();
+    cmd_vel_2d = controllers_[current_controller_]->computeVelocityCommands(pose, velocity);
+    recordCycle(
+      pose, velocity, cmd_vel_2d, costmap,
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
   }
+  applySpeedLimit(pose, cmd_vel_2d.twist);
 
-  nav_2d_msgs::msg::Twist2D twist = getThresholdedTwist(odom_sub_->getTwist());
-
-  auto cmd_vel_2d =
-    controllers_[current_controller_]->computeVelocityCommands(
-    pose,
-    nav_2d_utils::twist2Dto3D(twist));
-
-  std::shared_ptr<Action::Feedback> feedback = std::make_shared<Action::Feedback>();
-  feedback->speed = std::hypot(cmd_vel_2d.twist.linear.x, cmd_vel_2d.twist.linear.y);
-  feedback->distance_to_goal = nav2_util::geometry_utils::euclidean_distance(end_pose_, pose.pose);
-  action_server_->publish_feedback(feedback);
+  feedback_->speed = std::hypot(cmd_vel_2d.twist.linear.x, cmd_vel_2d.twist.linear.y);
+  feedback_->distance_to_goal =
+    nav2_util::geometry_utils::euclidean_distance(end_pose_, pose.pose);
+  action_server_->publish_feedback(feedback_);
 
   RCLCPP_DEBUG(get_logger(), "Publishing velocity at time %.2f", now().seconds());
   publishVelocity(cmd_vel_2d);
 }
 
+void ControllerServer::recordCycle(
+  const geometry_msgs::msg::PoseStamped & pose,
+  const geometry_msgs::msg::Twist & velocity,
+  const geometry_msgs::msg::TwistStamped & cmd_vel,
+  const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & costmap,
+  double duration)
+{
+  if (!snapshot_recorder_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(last_cycle_mutex_);
+    last_cycle_.pose = pose;
+    last_cycle_.velocity = velocity;
+    last_cycle_.cmd_vel = cmd_vel;
+    last_cycle_.costmap = costmap;
+    last_cycle_.duration = duration;
+  }
+  snapshot_recorder_->checkCycle(duration);
+}
+
+bool ControllerServer::fillSnapshot(nav2_util::SnapshotWriter & writer)
+{
+  std::lock_guard<std::mutex> lock(last_cycle_mutex_);
+  if (!last_cycle_.costmap) {
+    return false;
+  }
+  writer.addString("controller/id", last_cycle_.controller_id);
+  nav2_util::addPath(writer, "controller/plan", last_cycle_.plan);
+  nav2_util::addPose(writer, "controller/pose", last_cycle_.pose);
+  nav2_util::addTwist(writer, "controller/velocity", last_cycle_.velocity);
+  nav2_util::addTwist(writer, "controller/cmd_vel", last_cycle_.cmd_vel.twist);
+  writer.addValue("controller/duration", last_cycle_.duration);
+  nav2_util::addParameters(writer, "controller/parameters", nav2_util::allParameters(this));
+  nav2_costmap_2d::addCostmapROS(writer, "local_costmap", costmap_ros_, last_cycle_.costmap);
+  return true;
+}
+
+void ControllerServer::applySpeedLimit(
+  const geometry_msgs::msg::PoseStamped & pose, geometry_msgs::msg::Twist & velocity)
+{
+  if (!speed_filter_) {
+    return;
+  }
+  const auto limit = speed_filter_->getSpeedLimit(pose.pose.position.x, pose.pose.position.y);
+  if (!limit.limited) {
+    return;
+  }
+
+  double scale = 1.0;
+  if (limit.percentage) {
+    scale = limit.value / 100.0;
+  } else {
+    const double speed = std::hypot(velocity.linear.x, velocity.linear.y);
+    if (speed > limit.value) {
+      scale = limit.value / speed;
+    }
+  }
+  scale = std::max(0.0, std::min(1.0, scale));
+  velocity.linear.x *= scale;
+  velocity.linear.y *= scale;
+  velocity.angular.z *= scale;
+}
+
 void ControllerServer::updateGlobalPath()
 {
   if (action_server_->is_preempt_requested()) {
@@ -393,13 +625,40 @@ void ControllerServer::updateGlobalPath()
       action_server_->terminate_current();
       return;
     }
-    setPlannerPath(goal->path);
+    setPlannerPath(*goal);
   }
 }
 
 void ControllerServer::publishVelocity(const geometry_msgs::msg::TwistStamped & velocity)
 {
-  auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>(velocity.twist);
+  // Attributed to the pose of the enclosing control cycle, if any
+  nav2_util::ScopedTrace trace("controller.publish_velocity");
+  if (smoother_) {
+    std::lock_guard<std::mutex> lock(smoother_mutex_);
+    smoother_->setTarget(
+      nav_2d_utils::twist3Dto2D(velocity.twist), VelocitySmoother::Clock::now());
+    return;
+  }
+  sendVelocity(velocity.twist);
+}
+
+void ControllerServer::publishSmoothedVelocity()
+{
+  nav_2d_msgs::msg::Twist2D velocity;
+  {
+    std::lock_guard<std::mutex> lock(smoother_mutex_);
+    // The odometry is read from its SeqLock, without waiting on the subscription
+    if (smoothing_closed_loop_) {
+      smoother_->feedback(odom_sub_->getTwist());
+    }
+    velocity = smoother_->update(VelocitySmoother::Clock::now());
+  }
+  sendVelocity(nav_2d_utils::twist2Dto3D(velocity));
+}
+
+void ControllerServer::sendVelocity(const geometry_msgs::msg::Twist & velocity)
+{
+  auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>(velocity);
   if (
     vel_publisher_->is_activated() &&
     this->count_subscribers(vel_publisher_->get_topic_name()) > 0)
@@ -422,17 +681,32 @@ void ControllerServer::publishZeroVelocity()
   publishVelocity(velocity);
 }
 
-bool ControllerServer::isGoalReached()
+bool ControllerServer::isGoalReached(
+  const geometry_msgs::msg::PoseStamped & pose,
+  const nav_2d_msgs::msg::Twist2D & twist)
 {
-  geometry_msgs::msg::PoseStamped pose;
+  nav2_util::ScopedTrace trace("controller.check_goal", goal_checker_id_);
+  geometry_msgs::msg::Twist velocity = nav_2d_utils::twist2Dto3D(twist);
+  return goal_checker_->isGoalReached(pose.pose, end_pose_, velocity);
+}
 
-  if (!getRobotPose(pose)) {
-    return false;
+void ControllerServer::publishLoopStatistics(ControlLoopTimer & loop_timer)
+{
+  auto stats = std::make_unique<nav2_msgs::msg::ControlLoopStatistics>();
+  loop_timer.takeStatistics(*stats);
+  stats->header.stamp = now();
+
+  if (stats->missed_deadlines > 0) {
+    RCLCPP_WARN(
+      get_logger(), "Control loop missed %u of %u deadlines at %.4fHz, worst lateness %.4fs",
+      stats->missed_deadlines, stats->cycles, controller_frequency_, stats->max_lateness);
   }
 
-  nav_2d_msgs::msg::Twist2D twist = getThresholdedTwist(odom_sub_->getTwist());
-  geometry_msgs::msg::Twist velocity = nav_2d_utils::twist2Dto3D(twist);
-  return goal_checker_->isGoalReached(pose.pose, end_pose_, velocity);
+  if (loop_stats_publisher_->is_activated() &&
+    this->count_subscribers(loop_stats_publisher_->get_topic_name()) > 0)
+  {
+    loop_stats_publisher_->publish(std::move(stats));
+  }
 }
 
 bool ControllerServer::getRobotPose(geometry_msgs::msg::PoseStamped & pose)
@@ -446,3 +720,7 @@ bool ControllerServer::getRobotPose(geometry_msgs::msg::PoseStamped & pose)
 }
 
 }  // namespace nav2_controller
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_controller::ControllerServer)
@@ -0,0 +1,146 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_controller/velocity_smoother.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace nav2_controller
+{
+
+namespace
+{
+
+std::array<double, 3> toArray(const nav_2d_msgs::msg::Twist2D & twist)
+{
+  return {{twist.x, twist.y, twist.theta}};
+}
+
+double clamp(double value, double limit)
+{
+  return std::max(-limit, std::min(limit, value));
+}
+
+}  // namespace
+
+VelocitySmoother::VelocitySmoother(const std::array<Limits, 3> & limits, double timeout)
+: limits_(limits), timeout_(timeout)
+{
+  // A limit of 0 leaves it unlimited, so that no setting can keep the robot from stopping
+  for (auto & axis : limits_) {
+    for (double * limit : {&axis.max_accel, &axis.max_decel, &axis.max_jerk}) {
+      if (*limit <= 0.0) {
+        *limit = std::numeric_limits<double>::infinity();
+      }
+    }
+  }
+}
+
+void VelocitySmoother::setTarget(
+  const nav_2d_msgs::msg::Twist2D & target, Clock::time_point stamp)
+{
+  const std::array<double, 3> next = toArray(target);
+  const double interval = std::chrono::duration<double>(stamp - target_stamp_).count();
+  if (has_target_ && interval > 0.0 && interval < timeout_) {
+    for (std::size_t i = 0; i < 3; ++i) {
+      target_rate_[i] = (next[i] - target_[i]) / interval;
+    }
+    extrapolation_ = interval;
+  } else {
+    target_rate_ = {};
+    extrapolation_ = 0.0;
+  }
+  target_ = next;
+  target_stamp_ = stamp;
+  has_target_ = true;
+}
+
+void VelocitySmoother::feedback(const nav_2d_msgs::msg::Twist2D & measured)
+{
+  velocity_ = toArray(measured);
+}
+
+void VelocitySmoother::reset(const nav_2d_msgs::msg::Twist2D & velocity)
+{
+  velocity_ = toArray(velocity);
+  acceleration_ = {};
+  target_rate_ = {};
+  extrapolation_ = 0.0;
+  has_target_ = false;
+  started_ = false;
+}
+
+nav_2d_msgs::msg::Twist2D VelocitySmoother::update(Clock::time_point now)
+{
+  const double dt = std::chrono::duration<double>(now - last_update_).count();
+  if (started_ && dt > 0.0) {
+    const double age = std::chrono::duration<double>(now - target_stamp_).count();
+    const bool valid = has_target_ && age < timeout_;
+    for (std::size_t i = 0; i < 3; ++i) {
+      double reference = 0.0;
+      if (valid) {
+        reference = target_[i] + target_rate_[i] * std::min(std::max(age, 0.0), extrapolation_);
+        // Never extrapolated through zero, a controller stopping would otherwise reverse
+        if (reference * target_[i] < 0.0 || (target_[i] == 0.0 && reference != 0.0)) {
+          reference = 0.0;
+        }
+      }
+      step(limits_[i], reference, dt, velocity_[i], acceleration_[i]);
+    }
+  }
+  if (dt > 0.0 || !started_) {
+    last_update_ = now;
+    started_ = true;
+  }
+
+  nav_2d_msgs::msg::Twist2D twist;
+  twist.x = velocity_[0];
+  twist.y = velocity_[1];
+  twist.theta = velocity_[2];
+  return twist;
+}
+
+double VelocitySmoother::step(
+  const Limits & limits, double reference, double dt, double & v, double & a)
+{
+  const double diff = reference - v;
+  // Slowing down when the change is against the velocity
+  const double limit = v * diff < 0.0 ? limits.max_decel : limits.max_accel;
+  double accel = clamp(diff / dt, limit);
+  if (std::isfinite(limits.max_jerk)) {
+    // No faster than what still brings the acceleration back to zero at the reference, in
+    // steps of dt: ramping a down covers a^2 / (2 max_jerk) + a dt / 2
+    const double change = limits.max_jerk * dt;
+    accel = clamp(
+      accel, std::sqrt(0.25 * change * change + 2.0 * limits.max_jerk * std::fabs(diff)) -
+      0.5 * change);
+    accel = clamp(std::max(a - change, std::min(a + change, accel)), limit);
+  }
+
+  const double next = v + accel * dt;
+  if ((diff >= 0.0 && next > reference && accel > 0.0) ||
+    (diff <= 0.0 && next < reference && accel < 0.0))
+  {
+    v = reference;
+    a = 0.0;
+  } else {
+    v = next;
+    a = accel;
+  }
+  return v;
+}
+
+}  // namespace nav2_controller
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_controller/collision_monitor.hpp"
+
+using nav2_controller::ZonePolygon;
+
+namespace
+{
+
+std::vector<geometry_msgs::msg::Point> polygon(const std::vector<std::pair<double, double>> & xy)
+{
+  std::vector<geometry_msgs::msg::Point> points;
+  for (const auto & p : xy) {
+    geometry_msgs::msg::Point point;
+    point.x = p.first;
+    point.y = p.second;
+    points.push_back(point);
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(ZonePolygon, CountsPointsInsideASquare)
+{
+  ZonePolygon zone(polygon({{-1.0, -1.0}, {1.0, -1.0}, {1.0, 1.0}, {-1.0, 1.0}}));
+  const std::vector<float> x{0.0f, 0.5f, 2.0f, -0.9f, 0.0f, 1.5f, 0.2f};
+  const std::vector<float> y{0.0f, -0.5f, 0.0f, 0.9f, 3.0f, 1.5f, 0.1f};
+  EXPECT_EQ(zone.countInside(x.data(), y.data(), x.size(), x.size()), 4u);
+  // Counting stops once enough points are inside
+  EXPECT_LE(zone.countInside(x.data(), y.data(), x.size(), 1), 4u);
+  EXPECT_GE(zone.countInside(x.data(), y.data(), x.size(), 1), 1u);
+  EXPECT_EQ(zone.countInside(x.data() + 2, y.data() + 2, 1, 1), 0u);
+}
+
+TEST(ZonePolygon, MatchesScalarTestOnConcavePolygon)
+{
+  // An L shape, both the SIMD groups and the remainder see points in and out of the notch
+  const auto vertices = polygon({{0.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {1.0, 1.0}, {1.0, 2.0},
+      {0.0, 2.0}});
+  ZonePolygon zone(vertices);
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> coord(-0.5f, 2.5f);
+  std::vector<float> x(1003), y(1003);
+  std::size_t expected = 0;
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = coord(rng);
+    y[i] = coord(rng);
+    const bool in_lower = x[i] > 0.0f && x[i] < 2.0f && y[i] > 0.0f && y[i] < 1.0f;
+    const bool in_upper = x[i] > 0.0f && x[i] < 1.0f && y[i] >= 1.0f && y[i] < 2.0f;
+    expected += in_lower || in_upper ? 1 : 0;
+  }
+  EXPECT_EQ(zone.countInside(x.data(), y.data(), x.size(), x.size()), expected);
+}
+
+TEST(ZonePolygon, DegeneratePolygonIsEmpty)
+{
+  ZonePolygon zone(polygon({{0.0, 0.0}, {1.0, 0.0}}));
+  EXPECT_TRUE(zone.empty());
+  const float x = 0.5f, y = 0.0f;
+  EXPECT_EQ(zone.countInside(&x, &y, 1, 1), 0u);
+}
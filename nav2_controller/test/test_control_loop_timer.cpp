@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_controller/control_loop_timer.hpp"
+
+using nav2_controller::ControlLoopTimer;
+
+TEST(ControlLoopTimer, KeepsAbsoluteDeadlines)
+{
+  ControlLoopTimer timer(50.0);
+  auto start = ControlLoopTimer::Clock::now();
+  timer.start();
+  for (int i = 0; i < 25; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    timer.sleep();
+  }
+
+  // 25 cycles of 20ms, however long each cycle took to wake up
+  auto elapsed = std::chrono::duration<double>(ControlLoopTimer::Clock::now() - start).count();
+  EXPECT_NEAR(elapsed, 0.5, 0.015);
+
+  nav2_msgs::msg::ControlLoopStatistics stats;
+  timer.takeStatistics(stats);
+  EXPECT_EQ(stats.cycles, 25u);
+  EXPECT_DOUBLE_EQ(stats.desired_frequency, 50.0);
+  EXPECT_EQ(
+    std::accumulate(stats.lateness_histogram.begin(), stats.lateness_histogram.end(), 0u), 25u);
+  EXPECT_EQ(
+    std::accumulate(stats.work_time_histogram.begin(), stats.work_time_histogram.end(), 0u), 25u);
+  EXPECT_GE(stats.max_work_time, 0.002);
+
+  // Taking the statistics starts a new window
+  timer.takeStatistics(stats);
+  EXPECT_EQ(stats.cycles, 0u);
+  EXPECT_EQ(stats.max_work_time, 0.0);
+}
+
+TEST(ControlLoopTimer, SkipsMissedDeadlines)
+{
+  ControlLoopTimer timer(50.0);
+  auto start = ControlLoopTimer::Clock::now();
+  timer.start();
+
+  // Overrun by a period and a half, which drops the deadline at 40ms
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(timer.sleep());
+  EXPECT_TRUE(timer.sleep());
+
+  auto elapsed = std::chrono::duration<double>(ControlLoopTimer::Clock::now() - start).count();
+  EXPECT_NEAR(elapsed, 0.06, 0.008);
+
+  nav2_msgs::msg::ControlLoopStatistics stats;
+  timer.takeStatistics(stats);
+  EXPECT_EQ(stats.cycles, 2u);
+  EXPECT_EQ(stats.missed_deadlines, 1u);
+  EXPECT_GE(stats.max_lateness, 0.03);
+  EXPECT_EQ(stats.work_time_histogram.back(), 1u);
+}
+
+TEST(ControlLoopTimer, DefaultSchedulingIsUnchanged)
+{
+  std::string error;
+  EXPECT_TRUE(ControlLoopTimer::setThreadScheduling(0, {}, error));
+  EXPECT_TRUE(error.empty());
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "nav2_controller/velocity_smoother.hpp"
+
+using nav2_controller::VelocitySmoother;
+
+namespace
+{
+
+const std::chrono::milliseconds PERIOD(10);
+
+nav_2d_msgs::msg::Twist2D twist(double x, double theta = 0.0)
+{
+  nav_2d_msgs::msg::Twist2D t;
+  t.x = x;
+  t.theta = theta;
+  return t;
+}
+
+VelocitySmoother makeSmoother(double max_jerk = 0.0)
+{
+  return VelocitySmoother(
+    {{{1.0, 2.0, max_jerk}, {1.0, 2.0, max_jerk}, {1.0, 2.0, max_jerk}}}, 0.5);
+}
+
+}  // namespace
+
+TEST(VelocitySmoother, RampsWithinTheAccelerationLimits)
+{
+  VelocitySmoother smoother = makeSmoother();
+  auto now = VelocitySmoother::Clock::now();
+  smoother.update(now);
+  smoother.setTarget(twist(0.5), now);
+
+  double last = 0.0;
+  for (int i = 1; i <= 60; ++i) {
+    now += PERIOD;
+    if (i % 5 == 0) {
+      // Controller outputs at a fifth of the smoother rate
+      smoother.setTarget(twist(0.5), now);
+    }
+    const double v = smoother.update(now).x;
+    EXPECT_LE(v - last, 1.0 * 0.01 + 1e-9);
+    EXPECT_LE(v, 0.5 + 1e-9);
+    last = v;
+  }
+  EXPECT_DOUBLE_EQ(last, 0.5);
+
+  // Slowing down uses the deceleration limit
+  smoother.setTarget(twist(0.0), now);
+  now += PERIOD;
+  EXPECT_NEAR(smoother.update(now).x, 0.5 - 2.0 * 0.01, 1e-9);
+}
+
+TEST(VelocitySmoother, StopsWhenTheTargetTimesOut)
+{
+  VelocitySmoother smoother = makeSmoother();
+  auto now = VelocitySmoother::Clock::now();
+  smoother.reset(twist(0.3));
+  smoother.update(now);
+  smoother.setTarget(twist(0.3), now);
+  now += std::chrono::milliseconds(600);
+  smoother.update(now);
+  for (int i = 0; i < 30; ++i) {
+    now += PERIOD;
+    smoother.update(now);
+  }
+  EXPECT_DOUBLE_EQ(smoother.update(now + PERIOD).x, 0.0);
+}
+
+TEST(VelocitySmoother, ExtrapolatesRampsButNotThroughZero)
+{
+  VelocitySmoother smoother = makeSmoother();
+  auto now = VelocitySmoother::Clock::now();
+  smoother.reset(twist(0.2));
+  smoother.update(now);
+  smoother.setTarget(twist(0.2), now);
+  now += std::chrono::milliseconds(50);
+  smoother.setTarget(twist(0.25), now);
+  // Half way to the next output the reference is already 0.275
+  now += std::chrono::milliseconds(25);
+  EXPECT_GT(smoother.update(now).x, 0.25);
+
+  // A controller stopping extrapolates to a reversing target, which is held at zero
+  smoother.reset(twist(0.05));
+  smoother.update(now);
+  smoother.setTarget(twist(0.05), now);
+  now += std::chrono::milliseconds(50);
+  smoother.setTarget(twist(0.0), now);
+  for (int i = 0; i < 8; ++i) {
+    now += PERIOD;
+    EXPECT_GE(smoother.update(now).x, 0.0);
+  }
+}
+
+TEST(VelocitySmoother, LimitsTheJerk)
+{
+  VelocitySmoother smoother = makeSmoother(10.0);
+  auto now = VelocitySmoother::Clock::now();
+  smoother.update(now);
+  smoother.setTarget(twist(0.0, 1.0), now);
+
+  double last_v = 0.0, last_a = 0.0;
+  for (int i = 0; i < 300; ++i) {
+    now += PERIOD;
+    if (i % 5 == 0) {
+      smoother.setTarget(twist(0.0, 1.0), now);
+    }
+    const double v = smoother.update(now).theta;
+    const double a = (v - last_v) / 0.01;
+    EXPECT_LE(std::fabs(a - last_a), 10.0 * 0.01 + 1e-6) << "at step " << i;
+    EXPECT_LE(a, 1.0 + 1e-9);
+    last_v = v;
+    last_a = a;
+  }
+  EXPECT_NEAR(last_v, 1.0, 1e-6);
+}
@@ -47,6 +47,8 @@
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/twist_stamped.hpp"
 #include "nav_msgs/msg/path.hpp"
+#include "nav2_msgs/msg/compact_path.hpp"
+#include "nav2_util/compact_path.hpp"
 
 
 namespace nav2_core
@@ -97,6 +99,18 @@ public:
    */
   virtual void setPlan(const nav_msgs::msg::Path & path) = 0;
 
+  /**
+   * @brief local setPlan - Sets the global plan from a compact path
+   *
+   * Unpacks the path for setPlan(nav_msgs::msg::Path) unless overridden, controllers
+   * working on 2D poses can take it as is instead.
+   * @param path The global plan
+   */
+  virtual void setPlan(const nav2_msgs::msg::CompactPath & path)
+  {
+    setPlan(nav2_util::fromCompactPath(path));
+  }
+
   /**
    * @brief Controller computeVelocityCommands - calculates the best command given the current pose and velocity
    *
@@ -15,8 +15,12 @@
 #ifndef NAV2_CORE__GLOBAL_PLANNER_HPP_
 #define NAV2_CORE__GLOBAL_PLANNER_HPP_
 
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 #include "tf2_ros/buffer.h"
@@ -76,6 +80,89 @@ public:
   virtual nav_msgs::msg::Path createPlan(
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal) = 0;
+
+  /**
+   * @brief Method create the plan from a starting and ending goal, giving up once
+   * cancel_checker returns true. Planners with long searches should override it and poll
+   * cancel_checker while searching, by default the plan is created without polling it.
+   * @param start          The starting pose of the robot
+   * @param goal           The goal pose of the robot
+   * @param cancel_checker Returns true once the plan is no longer wanted
+   * @return               The sequence of poses to get from start to goal, empty if none
+   *                       was found or the plan was canceled
+   */
+  virtual nav_msgs::msg::Path createCancellablePlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    std::function<bool()> /*cancel_checker*/)
+  {
+    return createPlan(start, goal);
+  }
+
+  /**
+   * @brief Method create the first part of the plan to a goal, for the robot to start on
+   * while the whole plan is computed. Planners able to plan the first part much faster
+   * than the whole plan should override it, by default there is no partial plan.
+   * @param start  The starting pose of the robot
+   * @param goal   The goal pose of the robot
+   * @param length Approximate length of the first part (m)
+   * @return       The first part of the plan, the whole plan if it ends at the goal,
+   *               empty when the planner can't plan it on its own
+   */
+  virtual nav_msgs::msg::Path createPartialPlan(
+    const geometry_msgs::msg::PoseStamped & /*start*/,
+    const geometry_msgs::msg::PoseStamped & /*goal*/,
+    double /*length*/)
+  {
+    return nav_msgs::msg::Path();
+  }
+
+  /**
+   * @brief Method create plans from a starting pose to several goals. Planners able
+   * to share work between the goals should override it, by default each goal is
+   * planned for on its own.
+   * @param start The starting pose of the robot
+   * @param goals The goal poses of the robot
+   * @return      One path per goal, empty when no path to that goal was found
+   */
+  virtual std::vector<nav_msgs::msg::Path> createPlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals)
+  {
+    std::vector<nav_msgs::msg::Path> plans;
+    plans.reserve(goals.size());
+    for (const auto & goal : goals) {
+      plans.push_back(createPlan(start, goal));
+    }
+    return plans;
+  }
+
+  /**
+   * @brief Method computing the cost of reaching several goals from a starting pose, without
+   * needing their paths. Planners able to get the costs from a single search should override
+   * it, by default it is the length of each path from createPlans.
+   * @param start The starting pose of the robot
+   * @param goals The goal poses of the robot
+   * @return      One cost per goal, comparable to the length of its path in meters,
+   *              infinity when no path to that goal was found
+   */
+  virtual std::vector<double> computeCosts(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals)
+  {
+    std::vector<double> costs;
+    costs.reserve(goals.size());
+    for (const auto & plan : createPlans(start, goals)) {
+      double length = plan.poses.empty() ? std::numeric_limits<double>::infinity() : 0.0;
+      for (size_t i = 1; i < plan.poses.size(); ++i) {
+        length += std::hypot(
+          plan.poses[i].pose.position.x - plan.poses[i - 1].pose.position.x,
+          plan.poses[i].pose.position.y - plan.poses[i - 1].pose.position.y);
+      }
+      costs.push_back(length);
+    }
+    return costs;
+  }
 };
 
 }  // namespace nav2_core
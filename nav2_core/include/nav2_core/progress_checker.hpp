@@ -22,6 +22,7 @@
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav_msgs/msg/path.hpp"
 
 namespace nav2_core
 {
@@ -52,6 +53,11 @@ public:
    * @return True if progress is made
    */
   virtual bool check(geometry_msgs::msg::PoseStamped & current_pose) = 0;
+  /**
+   * @brief Give the path being followed, for checkers measuring progress along it
+   * @param path Path, in the frame of the poses given to check()
+   */
+  virtual void setPlan(const nav_msgs::msg::Path & /*path*/) {}
   /**
    * @brief Reset class state upon calling
    */
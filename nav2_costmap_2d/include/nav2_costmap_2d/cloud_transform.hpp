@@ -0,0 +1,122 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__CLOUD_TRANSFORM_HPP_
+#define NAV2_COSTMAP_2D__CLOUD_TRANSFORM_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Filters applied while transforming a cloud with transformAndFilterCloud()
+ */
+struct CloudFilter
+{
+  double min_z;       ///< Lowest height kept, in the target frame
+  double max_z;       ///< Highest height kept, in the target frame
+  double voxel_size;  ///< Keep one point per voxel of this size, 0 keeps every point
+};
+
+/**
+ * @brief Transform a cloud and filter its points in a single pass
+ *
+ * Reads the float32 x, y and z fields of in directly, applies the rigid
+ * transform (a row-major 3x4 [R|t] matrix) with SIMD where available and copies
+ * each surviving point, with its transformed coordinates, into out. out keeps
+ * its allocated storage, so recycling it avoids reallocating every frame.
+ * @param voxels Scratch set for the voxel filter, reused across calls
+ * @return false if in has no float32 x, y and z fields, out is then left empty
+ */
+bool transformAndFilterCloud(
+  const sensor_msgs::msg::PointCloud2 & in, const float transform[12],
+  const CloudFilter & filter, std::unordered_set<uint64_t> & voxels,
+  sensor_msgs::msg::PointCloud2 & out);
+
+/**
+ * @brief Cosines and sines of the beam angles of a scanner
+ */
+struct ScanAngles
+{
+  /**
+   * @brief Recompute the tables if the angles of scan aren't the ones they hold
+   * @return true if they were recomputed
+   */
+  bool update(const sensor_msgs::msg::LaserScan & scan);
+
+  float angle_min{0.0f};
+  float angle_increment{0.0f};
+  std::vector<float> cos_table;
+  std::vector<float> sin_table;
+};
+
+/**
+ * @brief Project a laser scan and transform its points in a single pass, like
+ * transformAndFilterCloud() does for a cloud
+ *
+ * Like laser_geometry's projection, only the ranges in [range_min, range_max) are kept,
+ * out gets float32 x, y and z fields only.
+ * @param angles Tables of the scan's beams, up to date with update()
+ * @param inf_is_valid Whether positive infinities are free space up to range_max, they
+ * then give points just short of range_max
+ * @param voxels Scratch set for the voxel filter, reused across calls
+ */
+void transformAndFilterScan(
+  const sensor_msgs::msg::LaserScan & scan, const ScanAngles & angles,
+  const float transform[12], bool inf_is_valid, const CloudFilter & filter,
+  std::unordered_set<uint64_t> & voxels, sensor_msgs::msg::PointCloud2 & out);
+
+/**
+ * @brief Find the byte offset of a field in the points of a cloud
+ * @return false if the field is missing or not float32
+ */
+bool floatFieldOffset(
+  const sensor_msgs::msg::PointCloud2 & cloud, const std::string & name, uint32_t & offset);
+
+/**
+ * @brief Read a float32 field of a point, which may be unaligned
+ */
+inline float readFloat(const uint8_t * point, uint32_t offset)
+{
+  float value;
+  memcpy(&value, point + offset, sizeof(float));
+  return value;
+}
+
+/**
+ * @brief Key of the voxel holding a point, packed into 21 bits per axis
+ *
+ * This covers +-1 million voxels per axis, i.e. +-50 km at 5 cm voxels.
+ */
+inline uint64_t voxelKey(float x, float y, float z, double inv_voxel_size)
+{
+  const uint64_t mask = (1u << 21) - 1;
+  const uint64_t vx = static_cast<int64_t>(std::floor(x * inv_voxel_size)) & mask;
+  const uint64_t vy = static_cast<int64_t>(std::floor(y * inv_voxel_size)) & mask;
+  const uint64_t vz = static_cast<int64_t>(std::floor(z * inv_voxel_size)) & mask;
+  return (vx << 42) | (vy << 21) | vz;
+}
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__CLOUD_TRANSFORM_HPP_
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COMBINATION_KERNELS_HPP_
+#define NAV2_COSTMAP_2D__COMBINATION_KERNELS_HPP_
+
+#include <string>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * Row kernels used by CostmapLayer to combine a layer into the master grid.
+ * Each one processes n consecutive cells and is vectorized with the best
+ * instruction set available on the host (AVX2, SSE2 or NEON), picked once at
+ * runtime, falling back to a scalar loop.
+ */
+
+/**
+ * @brief master = max(master, layer), NO_INFORMATION in master is overwritten
+ * and NO_INFORMATION in the layer leaves master unchanged
+ */
+void combineRowMax(unsigned char * master, const unsigned char * layer, unsigned int n);
+
+/**
+ * @brief master = layer, except where the layer is NO_INFORMATION
+ */
+void combineRowOverwrite(unsigned char * master, const unsigned char * layer, unsigned int n);
+
+/**
+ * @brief master = min(master + layer, INSCRIBED_INFLATED_OBSTACLE - 1), NO_INFORMATION
+ * in master is overwritten and NO_INFORMATION in the layer leaves master unchanged
+ */
+void combineRowAddition(unsigned char * master, const unsigned char * layer, unsigned int n);
+
+/**
+ * @brief Name of the instruction set the kernels dispatch to, for logging
+ */
+std::string combinationKernelsName();
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COMBINATION_KERNELS_HPP_
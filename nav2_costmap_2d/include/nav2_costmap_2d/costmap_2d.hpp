@@ -43,11 +43,15 @@
 #include <limits.h>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <string>
+#include <utility>
 #include <vector>
 #include <queue>
 #include <mutex>
 #include "geometry_msgs/msg/point.hpp"
+#include "nav2_util/line_iterator.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -101,6 +105,7 @@ public:
    * @param win_origin_y The y origin (lower left corner) for the window to copy, in meters
    * @param win_size_x The x size of the window, in meters
    * @param win_size_y The y size of the window, in meters
+   * @return False, leaving this costmap unchanged, if the window is not inside the map
    */
   bool copyCostmapWindow(
     const Costmap2D & map, double win_origin_x, double win_origin_y,
@@ -248,13 +253,13 @@ public:
     default_value_ = c;
   }
 
-  unsigned char getDefaultValue()
+  unsigned char getDefaultValue() const
   {
     return default_value_;
   }
 
   /**
-   * @brief  Sets the cost of a convex polygon to a desired value
+   * @brief  Sets the cost of a convex polygon to a desired value, as setPolygonCost() does
    * @param polygon The polygon to perform the operation on
    * @param cost_value The value to set costs to
    * @return True if the polygon was filled... false if it could not be filled
@@ -263,6 +268,81 @@ public:
     const std::vector<geometry_msgs::msg::Point> & polygon,
     unsigned char cost_value);
 
+  /**
+   * @brief  Sets the cost of a polygon, convex or not, to a desired value, one row span at a time
+   * @param polygon The polygon to perform the operation on, in world coordinates
+   * @param cost_value The value to set costs to
+   * @return True if the polygon was filled... false if part of it lies outside the map
+   */
+  bool setPolygonCost(
+    const std::vector<geometry_msgs::msg::Point> & polygon,
+    unsigned char cost_value);
+
+  /**
+   * @brief  Calls fn(y, min_x, max_x) for each row span of the cells a polygon covers
+   *
+   * A polygon covers the cells of its outline, as polygonOutlineCells() traces
+   * it, and the cells the outline encloses. Rows come in increasing y and the
+   * spans of a row, several where a non-convex polygon folds back, in
+   * increasing x. Nothing is allocated for polygons of up to 32 vertices.
+   * @param polygon The polygon in map coordinates, its vertices must all be in the map
+   * @param fn Called with the row and the first and last cells of each span
+   */
+  template<class SpanFn>
+  void forEachPolygonSpan(const std::vector<MapLocation> & polygon, SpanFn fn) const
+  {
+    const std::size_t n = polygon.size();
+    if (n == 0) {
+      return;
+    }
+
+    // The outline spans of a row, at most one per edge, sorted by their first cell
+    std::pair<int, int> stack_spans[32];
+    std::vector<std::pair<int, int>> heap_spans;
+    std::pair<int, int> * spans = stack_spans;
+    if (n > 32) {
+      heap_spans.resize(n);
+      spans = heap_spans.data();
+    }
+
+    int min_y = polygon[0].y;
+    int max_y = polygon[0].y;
+    for (std::size_t i = 1; i < n; ++i) {
+      min_y = std::min(min_y, static_cast<int>(polygon[i].y));
+      max_y = std::max(max_y, static_cast<int>(polygon[i].y));
+    }
+
+    for (int y = min_y; y <= max_y; ++y) {
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        int lo, hi;
+        if (!outlineRowSpan(polygon[i], polygon[i + 1 < n ? i + 1 : 0], y, lo, hi)) {
+          continue;
+        }
+        std::size_t j = count++;
+        for (; j > 0 && spans[j - 1].first > lo; --j) {
+          spans[j] = spans[j - 1];
+        }
+        spans[j] = std::make_pair(lo, hi);
+      }
+      if (count == 0) {
+        continue;
+      }
+
+      // Join overlapping spans, and spans whose gap lies inside the polygon
+      int start = spans[0].first;
+      int end = spans[0].second;
+      for (std::size_t k = 1; k < count; ++k) {
+        if (spans[k].first > end + 1 && !enclosesCell(polygon, end + 1, y)) {
+          fn(y, start, end);
+          start = spans[k].first;
+        }
+        end = std::max(end, spans[k].second);
+      }
+      fn(y, start, end);
+    }
+  }
+
   /**
    * @brief  Get the map cells that make up the outline of a polygon
    * @param polygon The polygon in map coordinates to rasterize
@@ -351,6 +431,44 @@ protected:
     }
   }
 
+  /**
+   * @brief  Shift a map in place so that cell (x, y) takes the value of cell
+   * (x + shift_x, y + shift_y), filling the cells moved in from outside
+   * @param  map The map, size_x_ by size_y_
+   * @param  shift_x The shift along x, in cells
+   * @param  shift_y The shift along y, in cells
+   * @param  fill The value of the newly exposed cells
+   */
+  template<typename data_type>
+  void shiftMapRegion(data_type * map, int shift_x, int shift_y, data_type fill)
+  {
+    const int size_x = size_x_;
+    const int size_y = size_y_;
+    if (shift_x <= -size_x || shift_x >= size_x || shift_y <= -size_y || shift_y >= size_y) {
+      std::fill_n(map, static_cast<size_t>(size_x) * size_y, fill);
+      return;
+    }
+
+    // Each kept row is moved once, walking away from the rows it overwrites
+    const int width = size_x - std::abs(shift_x);
+    const int dest_x = std::max(-shift_x, 0);
+    const int step = shift_y > 0 ? 1 : -1;
+    const int first = shift_y > 0 ? 0 : size_y - 1;
+    for (int y = first; y >= 0 && y < size_y; y += step) {
+      data_type * row = map + static_cast<size_t>(y) * size_x;
+      const int source_y = y + shift_y;
+      if (source_y < 0 || source_y >= size_y) {
+        std::fill_n(row, size_x, fill);
+        continue;
+      }
+      memmove(
+        row + dest_x, map + static_cast<size_t>(source_y) * size_x + std::max(shift_x, 0),
+        width * sizeof(data_type));
+      std::fill_n(row, dest_x, fill);
+      std::fill_n(row + dest_x + width, size_x - dest_x - width, fill);
+    }
+  }
+
   /**
    * @brief  Deletes the costmap, static_map, and markers data structures
    */
@@ -383,65 +501,115 @@ protected:
     unsigned int y1,
     unsigned int max_length = UINT_MAX)
   {
-    int dx = x1 - x0;
-    int dy = y1 - y0;
-
-    unsigned int abs_dx = abs(dx);
-    unsigned int abs_dy = abs(dy);
+    nav2_util::walkLine(lineSteps(x0, y0, x1, y1, max_length), at);
+  }
 
-    int offset_dx = sign(dx);
-    int offset_dy = sign(dy) * size_x_;
+  /**
+   * @brief  Raytrace lines from one cell to many, stepping several lines at once
+   *
+   * Visits the cells of raytraceLine() for each end, but interleaves the lines,
+   * so the action must give the same result in any order, e.g. clearing.
+   * @param  at The action to take... a functor
+   * @param  x0 The starting x coordinate
+   * @param  y0 The starting y coordinate
+   * @param  ends Indices of the ending cells
+   * @param  count Number of ends
+   * @param  max_length The maximum desired length of the segments
+   */
+  template<class ActionType>
+  inline void raytraceLines(
+    ActionType at, unsigned int x0, unsigned int y0, const unsigned int * ends,
+    std::size_t count, unsigned int max_length = UINT_MAX)
+  {
+    nav2_util::walkLines(
+      count, [&](std::size_t i) {
+        return lineSteps(x0, y0, ends[i] % size_x_, ends[i] / size_x_, max_length);
+      }, at);
+  }
 
-    unsigned int offset = y0 * size_x_ + x0;
+private:
+  /**
+   * @brief  Offsets of a line, its dominant dimension scaled down to max_length
+   */
+  inline nav2_util::LineSteps lineSteps(
+    unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+    unsigned int max_length)
+  {
+    const int dx = x1 - x0;
+    const int dy = y1 - y0;
 
     // we need to chose how much to scale our dominant dimension,
     // based on the maximum length of the line
     double dist = std::hypot(dx, dy);
     double scale = (dist == 0.0) ? 1.0 : std::min(1.0, max_length / dist);
-
-    // if x is dominant
-    if (abs_dx >= abs_dy) {
-      int error_y = abs_dx / 2;
-      bresenham2D(
-        at, abs_dx, abs_dy, error_y, offset_dx, offset_dy, offset,
-        (unsigned int)(scale * abs_dx));
-      return;
-    }
-
-    // otherwise y is dominant
-    int error_x = abs_dy / 2;
-    bresenham2D(
-      at, abs_dy, abs_dx, error_x, offset_dy, offset_dx, offset,
-      (unsigned int)(scale * abs_dy));
+    const unsigned int abs_da = std::max(std::abs(dx), std::abs(dy));
+    return nav2_util::lineSteps(
+      size_x_, x0, y0, x1, y1, static_cast<unsigned int>(scale * abs_da));
   }
 
-private:
   /**
-   * @brief  A 2D implementation of Bresenham's raytracing algorithm... applies an action at each step
+   * @brief  Cells of row y that raytraceLine() visits between vertices a and b
+   * @return False if the line doesn't reach row y
    */
-  template<class ActionType>
-  inline void bresenham2D(
-    ActionType at, unsigned int abs_da, unsigned int abs_db, int error_b,
-    int offset_a,
-    int offset_b, unsigned int offset,
-    unsigned int max_length)
+  static inline bool outlineRowSpan(
+    const MapLocation & a, const MapLocation & b, int y, int & lo, int & hi)
   {
-    unsigned int end = std::min(max_length, abs_da);
-    for (unsigned int i = 0; i < end; ++i) {
-      at(offset);
-      offset += offset_a;
-      error_b += abs_db;
-      if ((unsigned int)error_b >= abs_da) {
-        offset += offset_b;
-        error_b -= abs_da;
+    const int x0 = a.x;
+    const int y0 = a.y;
+    const int abs_dx = std::abs(static_cast<int>(b.x) - x0);
+    const int abs_dy = std::abs(static_cast<int>(b.y) - y0);
+    const int step_x = static_cast<int>(b.x) > x0 ? 1 : -1;
+    // the number of steps taken along y before reaching row y
+    const int k = static_cast<int>(b.y) > y0 ? y - y0 : y0 - y;
+    if (k < 0 || k > abs_dy) {
+      return false;
+    }
+
+    if (abs_dx < abs_dy) {
+      // y is dominant, one cell per row
+      lo = hi = x0 + step_x * ((abs_dy / 2 + k * abs_dx) / abs_dy);
+      return true;
+    }
+
+    // x is dominant: after i steps along x the error is abs_dx / 2 + i * abs_dy,
+    // and the line has stepped along y once for each abs_dx it reached
+    int first = 0;
+    int last = abs_dx;
+    if (abs_dy > 0) {
+      const int64_t error = static_cast<int64_t>(abs_dx / 2);
+      const int64_t to_row = static_cast<int64_t>(k) * abs_dx - error;
+      const int64_t past_row = static_cast<int64_t>(k + 1) * abs_dx - error;
+      if (to_row > 0) {
+        first = static_cast<int>((to_row + abs_dy - 1) / abs_dy);
       }
+      last = std::min(last, static_cast<int>((past_row + abs_dy - 1) / abs_dy) - 1);
+    }
+    lo = x0 + step_x * first;
+    hi = x0 + step_x * last;
+    if (lo > hi) {
+      std::swap(lo, hi);
     }
-    at(offset);
+    return true;
   }
 
-  inline int sign(int x)
+  /**
+   * @brief  Whether the center of cell (x, y) is inside a polygon given in map coordinates
+   */
+  static inline bool enclosesCell(const std::vector<MapLocation> & polygon, int x, int y)
   {
-    return x > 0 ? 1.0 : -1.0;
+    bool inside = false;
+    for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+      const int yi = polygon[i].y;
+      const int yj = polygon[j].y;
+      if ((yi > y) != (yj > y)) {
+        const int xi = polygon[i].x;
+        const int xj = polygon[j].x;
+        if (x < xi + static_cast<double>(y - yi) * (xj - xi) / (yj - yi)) {
+          inside = !inside;
+        }
+      }
+    }
+    return inside;
   }
 
   mutex_t * access_;
@@ -453,6 +621,7 @@ protected:
   double origin_x_;
   double origin_y_;
   unsigned char * costmap_;
+  std::size_t costmap_capacity_{0};  ///< Size of the GridBufferPool buffer, 0 when not owned
   unsigned char default_value_;
 
   // *INDENT-OFF* Uncrustify doesn't handle indented public/private labels
@@ -45,9 +45,11 @@
 
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/dirty_region_set.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "map_msgs/msg/occupancy_grid_update.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/compressed_costmap.hpp"
 #include "nav2_msgs/srv/get_costmap.hpp"
 #include "tf2/transform_datatypes.h"
 #include "nav2_util/lifecycle_node.hpp"
@@ -65,13 +67,18 @@ class Costmap2DPublisher
 public:
   /**
    * @brief  Constructor for the Costmap2DPublisher
+   * @param keyframe_interval Seconds between full map republications, 0 to only
+   * publish the full map when its geometry changes
+   * @param max_dirty_regions Maximum number of update rectangles published per cycle
    */
   Costmap2DPublisher(
     nav2_util::LifecycleNode::SharedPtr ros_node,
     Costmap2D * costmap,
     std::string global_frame,
     std::string topic_name,
-    bool always_send_full_costmap = false);
+    bool always_send_full_costmap = false,
+    double keyframe_interval = 0.0,
+    unsigned int max_dirty_regions = 8);
 
   /**
    * @brief  Destructor
@@ -84,22 +91,23 @@ public:
     costmap_pub_->on_activate();
     costmap_update_pub_->on_activate();
     costmap_raw_pub_->on_activate();
+    costmap_compressed_pub_->on_activate();
+    costmap_intra_pub_->on_activate();
   }
   void on_deactivate()
   {
     costmap_pub_->on_deactivate();
     costmap_update_pub_->on_deactivate();
     costmap_raw_pub_->on_deactivate();
+    costmap_compressed_pub_->on_deactivate();
+    costmap_intra_pub_->on_deactivate();
   }
   void on_cleanup() {}
 
-  /** @brief Include the given bounds in the changed-rectangle. */
+  /** @brief Include the given bounds in the changed-rectangle set. */
   void updateBounds(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn)
   {
-    x0_ = std::min(x0, x0_);
-    xn_ = std::max(xn, xn_);
-    y0_ = std::min(y0, y0_);
-    yn_ = std::max(yn, yn_);
+    dirty_regions_.add(x0, xn, y0, yn);
   }
 
   /**
@@ -107,6 +115,15 @@ public:
    */
   void publishCostmap();
 
+  /**
+   * @brief  Publishes the visualization data of a snapshot of the costmap
+   *
+   * The snapshot is read without any lock, so it must not change while it is
+   * published, and must have the geometry of the costmap the bounds were given for.
+   * Lets a thread other than the updating one publish.
+   */
+  void publishCostmap(const Costmap2D & snapshot);
+
   /**
    * @brief Check if the publisher is active
    * @return True if the frequency for the publisher is non-zero, false otherwise
@@ -117,9 +134,18 @@ public:
   }
 
 private:
+  /** @brief Publish source_ */
+  void publish();
+
+  /** @brief Lock source_ if it is the live costmap */
+  std::unique_lock<Costmap2D::mutex_t> lockSource();
+
   /** @brief Prepare grid_ message for publication. */
   void prepareGrid();
   void prepareCostmap();
+  void prepareCompressedCostmap();
+  /** @brief Publish one OccupancyGridUpdate per changed rectangle. */
+  void publishUpdates();
 
   /** @brief Publish the latest full costmap to the new subscriber. */
   // void onNewSubscription(const ros::SingleSubscriberPublisher& pub);
@@ -132,9 +158,12 @@ private:
 
   nav2_util::LifecycleNode::SharedPtr node_;
   Costmap2D * costmap_;
+  const Costmap2D * source_;  ///< Costmap being published, costmap_ or a snapshot of it
   std::string global_frame_;
   std::string topic_name_;
-  unsigned int x0_, xn_, y0_, yn_;
+  DirtyRegionSet dirty_regions_;
+  rclcpp::Duration keyframe_interval_;
+  rclcpp::Time last_keyframe_;
   double saved_origin_x_;
   double saved_origin_y_;
   bool active_;
@@ -147,6 +176,12 @@ private:
 
   // Publisher for raw costmap values as msg::Costmap from layered costmap
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::Costmap>::SharedPtr costmap_raw_pub_;
+  // Publisher for the same raw values, run-length encoded
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CompressedCostmap>::SharedPtr
+    costmap_compressed_pub_;
+  // Publisher for the same raw values to consumers composed into this process,
+  // which receive the published message itself instead of a serialized copy
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::Costmap>::SharedPtr costmap_intra_pub_;
 
   // Service for getting the costmaps
   rclcpp::Service<nav2_msgs::srv::GetCostmap>::SharedPtr costmap_service_;
@@ -155,6 +190,7 @@ private:
   unsigned int grid_width, grid_height;
   std::unique_ptr<nav_msgs::msg::OccupancyGrid> grid_;
   std::unique_ptr<nav2_msgs::msg::Costmap> costmap_raw_;
+  std::unique_ptr<nav2_msgs::msg::CompressedCostmap> costmap_compressed_;
   // Translate from 0-255 values in costmap to -1 to 100 values in message.
   static char * cost_translation_table_;
 };
@@ -38,7 +38,13 @@
 #ifndef NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 #define NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -47,9 +53,12 @@
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_costmap_2d/clear_costmap_service.hpp"
+#include "nav2_costmap_2d/dirty_region_set.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/robot_state_cache.hpp"
+#include "nav2_util/timing_diagnostics.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "tf2/convert.h"
 #include "tf2/LinearMath/Transform.h"
@@ -102,6 +111,8 @@ public:
    * @brief  Subscribes to sensor topics if necessary and starts costmap
    * updates, can be called to restart the costmap after calls to either
    * stop() or pause()
+   *
+   * Blocks until an update cycle has run, unless async_activation is set.
    */
   void start();
 
@@ -116,10 +127,28 @@ public:
   void pause();
 
   /**
-   * @brief  Resumes costmap updates
+   * @brief  Resumes costmap updates, blocking like start()
    */
   void resume();
 
+  /**
+   * @brief Whether an update cycle has run since the costmap was last started,
+   * resumed or paused
+   */
+  bool isReady() const {return initialized_;}
+
+  /**
+   * @brief Get a future that becomes ready with the first update cycle after the
+   * costmap is started or resumed. Until then every call returns the same future
+   */
+  std::shared_future<void> getReadyFuture();
+
+  /**
+   * @brief Wait for the costmap to be ready, for at most ready_timeout
+   * @return Whether it is ready
+   */
+  bool waitUntilReady();
+
   void updateMap();
 
   /**
@@ -162,6 +191,46 @@ public:
     return layered_costmap_->getCostmap();
   }
 
+  /**
+   * @brief Return an immutable snapshot of the "master" costmap.
+   *
+   * A new snapshot is published after every map update. Reading it requires
+   * no lock: the returned grid is never modified while a reference to it is
+   * held, so planners and controllers see a consistent view without blocking
+   * the update loop. Returns nullptr until the first update has completed.
+   */
+  std::shared_ptr<const Costmap2D> getCostmapSnapshot() const
+  {
+    return std::atomic_load(&snapshot_);
+  }
+
+  /**
+   * @brief Return the snapshot together with its sequence number, the count of
+   * snapshots published before it. Pass sequence numbers to getChangedBounds()
+   * to find the cells that differ between two snapshots.
+   */
+  std::shared_ptr<const Costmap2D> getCostmapSnapshot(uint64_t & sequence) const
+  {
+    std::lock_guard<std::mutex> lock(snapshot_history_mutex_);
+    sequence = snapshot_sequence_;
+    return snapshot_;
+  }
+
+  /**
+   * @brief Get the cells that may have changed between two snapshots
+   * @param since Sequence number of the older snapshot
+   * @param until Sequence number of the newer snapshot
+   * @param x0 Output, first changed column
+   * @param xn Output, one past the last changed column, equal to x0 if nothing changed
+   * @param y0 Output, first changed row
+   * @param yn Output, one past the last changed row, equal to y0 if nothing changed
+   * @return false if the changes are no longer known or the map was resized,
+   * moved or reset in between, in which case every cell has to be considered changed
+   */
+  bool getChangedBounds(
+    uint64_t since, uint64_t until,
+    unsigned int & x0, unsigned int & xn, unsigned int & y0, unsigned int & yn) const;
+
   /**
    * @brief  Returns the global frame of the costmap
    * @return The global frame of the costmap
@@ -234,6 +303,12 @@ public:
    * getUnpaddedRobotFootprint(). */
   void setRobotFootprint(const std::vector<geometry_msgs::msg::Point> & points);
 
+  /**
+   * @brief Replace the master costmap by another one, e.g. one recorded in a snapshot,
+   * resizing the layers to match, and publish it as a new costmap snapshot
+   */
+  void setCostmap(const Costmap2D & costmap);
+
   /** @brief Set the footprint of the robot to be the given polygon,
    * padded by footprint_padding.
    *
@@ -248,6 +323,11 @@ public:
 
   std::shared_ptr<tf2_ros::Buffer> getTfBuffer() {return tf_buffer_;}
 
+  /**
+   * @brief Get the robot pose cache, or nullptr if robot_state_frequency is 0
+   */
+  std::shared_ptr<nav2_util::RobotStateCache> getRobotStateCache() {return robot_state_;}
+
 protected:
   rclcpp::Node::SharedPtr client_node_;
 
@@ -255,6 +335,7 @@ protected:
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PolygonStamped>::SharedPtr
     footprint_pub_;
   Costmap2DPublisher * costmap_publisher_{nullptr};
+  std::vector<std::unique_ptr<Costmap2DPublisher>> pyramid_publishers_;  ///< One per level
 
   rclcpp::Subscription<geometry_msgs::msg::Polygon>::SharedPtr footprint_sub_;
   rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_sub_;
@@ -262,42 +343,116 @@ protected:
   // Transform listener
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+  std::shared_ptr<nav2_util::RobotStateCache> robot_state_;
+
+  // Update times of the whole map and of each layer
+  std::shared_ptr<nav2_util::TimingStats> timing_stats_;
+  nav2_util::TimingHistogram * update_timing_{nullptr};
+  nav2_util::TimingHistogram * publish_timing_{nullptr};
+  std::unique_ptr<nav2_util::TimingDiagnostics> timing_diagnostics_;
 
   LayeredCostmap * layered_costmap_{nullptr};
   std::string name_;
   std::string parent_namespace_;
   void mapUpdateLoop(double frequency);
+
+  /**
+   * @brief Publish the latest snapshot whenever the update loop asks for it
+   *
+   * Runs when threaded_publishing is set, so serializing the costmap never
+   * delays the next update.
+   */
+  void publishLoop();
+
+  /**
+   * @brief Set whether the costmap is ready, making a new ready future when it stops being
+   */
+  void setReady(bool ready);
+
+  /** @brief Mark a window of the master grid, and of each published pyramid level, changed */
+  void updatePublishedBounds(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn);
+
+  /**
+   * @brief Copy the master costmap into a free snapshot buffer and publish it
+   *
+   * Buffers are recycled once the only remaining reference is the pool's own,
+   * i.e. once no reader holds them any longer.
+   */
+  void publishSnapshot(bool full_change = false);
+  std::shared_ptr<const Costmap2D> snapshot_;
+  std::vector<std::shared_ptr<Costmap2D>> snapshot_pool_;
+  std::mutex snapshot_mutex_;
+  static constexpr std::size_t SNAPSHOT_POOL_SIZE = 3;
+
+  // Cells updated for each recent snapshot, so readers can refresh what changed
+  struct SnapshotChange
+  {
+    uint64_t sequence;
+    unsigned int x0, xn, y0, yn;
+    bool full;
+  };
+  std::deque<SnapshotChange> snapshot_changes_;
+  uint64_t snapshot_sequence_{0};
+  mutable std::mutex snapshot_history_mutex_;
+  static constexpr std::size_t SNAPSHOT_HISTORY_SIZE = 64;
   bool map_update_thread_shutdown_{false};
   bool stop_updates_{false};
-  bool initialized_{false};
+  std::atomic<bool> initialized_{false};
   bool stopped_{true};
+  // Fulfilled along with initialized_, a fresh one waits for the next start or resume
+  std::mutex ready_mutex_;
+  std::promise<void> ready_promise_;
+  std::shared_future<void> ready_future_{ready_promise_.get_future().share()};
   std::thread * map_update_thread_{nullptr};  ///< @brief A thread for updating the map
   rclcpp::Time last_publish_{0, 0, RCL_ROS_TIME};
   rclcpp::Duration publish_cycle_{1, 0};
+  int64_t update_input_stamp_ns_{0};  ///< Stamp of the pose the last update used, for tracing
+
+  // Publish thread, the update loop hands it the changed windows
+  std::unique_ptr<std::thread> publish_thread_;
+  std::mutex publish_mutex_;
+  std::condition_variable publish_condition_;
+  DirtyRegionSet pending_regions_;
+  int64_t publish_input_stamp_ns_{0};
+  bool publish_requested_{false};
+  bool publish_thread_shutdown_{false};
   pluginlib::ClassLoader<Layer> plugin_loader_{"nav2_costmap_2d", "nav2_costmap_2d::Layer"};
 
   // Parameters
   void getParameters();
   bool always_send_full_costmap_{false};
+  bool async_activation_{false};   ///< Whether start() and resume() return before the first update
   std::string footprint_;
   float footprint_padding_{0};
   std::string global_frame_;       ///< The global frame for the costmap
   int map_height_meters_{0};
+  double keyframe_interval_{0};    ///< Seconds between full costmap republications
+  int max_dirty_regions_{8};       ///< Update rectangles published per cycle
   double map_publish_frequency_{0};
   double map_update_frequency_{0};
   int map_width_meters_{0};
   double origin_x_{0};
   double origin_y_{0};
+  double diagnostics_period_{0};   ///< Seconds between timing diagnostics, 0 disables them
   std::vector<std::string> default_plugins_;
   std::vector<std::string> default_types_;
   std::vector<std::string> plugin_names_;
   std::vector<std::string> plugin_types_;
+  bool parallel_plugin_initialization_{false};  ///< Whether to initialize the plugins concurrently
+  int pyramid_levels_{0};          ///< Max-pooled levels kept above the master grid
+  bool publish_pyramid_{false};
+  double ready_timeout_{10.0};     ///< Seconds waitUntilReady() waits for
   double resolution_{0};
   std::string robot_base_frame_;   ///< The frame_id of the robot base
   double robot_radius_;
+  bool share_tf_buffer_{false};  ///< Whether to use the process' shared TF buffer
+  double robot_state_frequency_{0};  ///< Rate of the cached robot pose lookups, 0 disables it
   bool rolling_window_{false};     ///< Whether to use a rolling window version of the costmap
   bool track_unknown_space_{false};
   double transform_tolerance_{0};  ///< The timeout before transform errors
+  bool threaded_publishing_{false};  ///< Whether to publish from snapshots on a thread of its own
+  int tile_update_threads_{1};     ///< Threads used to update the master grid in tiles
+  int tile_size_{256};             ///< Side of the update tiles, in cells
 
   // Derived parameters
   bool use_radius_{false};
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Run-length encode a cost array
+ * @param data The costs, size cells long
+ * @param size The number of cells
+ * @param values Filled with the cost of every run
+ * @param lengths Filled with the number of cells in every run
+ */
+void encodeCostRuns(
+  const unsigned char * data, std::size_t size,
+  std::vector<uint8_t> & values, std::vector<uint32_t> & lengths);
+
+/**
+ * @brief Decode runs produced by encodeCostRuns() straight into a cost array
+ * @param values The cost of every run
+ * @param lengths The number of cells in every run
+ * @param data The array to fill, size cells long
+ * @param size The number of cells
+ * @return false if the runs do not cover exactly size cells, in which case data
+ * is left partially written
+ */
+bool decodeCostRuns(
+  const std::vector<uint8_t> & values, const std::vector<uint32_t> & lengths,
+  unsigned char * data, std::size_t size);
+
+/**
+ * @brief Run-length encode an array of words, e.g. voxel columns
+ * @param data The words, size long
+ * @param size The number of words
+ * @param values Filled with the word of every run
+ * @param lengths Filled with the number of words in every run
+ */
+void encodeWordRuns(
+  const uint32_t * data, std::size_t size,
+  std::vector<uint32_t> & values, std::vector<uint32_t> & lengths);
+
+/**
+ * @brief Decode runs produced by encodeWordRuns()
+ * @return false if the runs do not cover exactly size words, in which case data
+ * is left partially written
+ */
+bool decodeWordRuns(
+  const std::vector<uint32_t> & values, const std::vector<uint32_t> & lengths,
+  uint32_t * data, std::size_t size);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_COMPRESSION_HPP_
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_FILTER_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_FILTER_HPP_
+
+#include <string>
+
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "tf2/LinearMath/Transform.h"
+#include "tf2/time.h"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapFilter
+ * @brief Base of the layers that apply a mask map to the costmap or to the robot
+ *
+ * The mask is loaded once, from mask_yaml if it is set, a YAML map or a binary map file,
+ * or else from the latched messages on mask_topic, and handed to processMask() which
+ * keeps what the filter needs of it.
+ */
+class CostmapFilter : public Layer
+{
+public:
+  CostmapFilter();
+
+  void onInitialize() override;
+  void reset() override {}
+
+protected:
+  /**
+   * @brief Declare and get the parameters of the filter, before the mask is loaded
+   */
+  virtual void initializeFilter() {}
+
+  /**
+   * @brief Take a new mask, called from the loading thread or from the mask subscription
+   */
+  virtual void processMask(const nav_msgs::msg::OccupancyGrid & mask) = 0;
+
+  /**
+   * @brief Get the transform from the costmap global frame to a mask frame
+   * @return false if it is not available, true with the identity for the global frame
+   */
+  bool lookupMaskTransform(const std::string & mask_frame, tf2::Transform & transform);
+
+  std::string global_frame_;
+  tf2::Duration transform_tolerance_;
+
+private:
+  void maskCallback(const nav_msgs::msg::OccupancyGrid::SharedPtr mask);
+
+  rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::SharedPtr mask_sub_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_FILTER_HPP_
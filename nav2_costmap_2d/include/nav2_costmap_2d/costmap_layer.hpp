@@ -60,7 +60,21 @@ public:
 
   virtual void matchSize();
 
-  virtual void clearArea(int start_x, int start_y, int end_x, int end_y);
+  /** @brief Bytes of the layer's own costmap */
+  std::size_t getMemoryUsage() const override;
+
+  /**
+   * @brief Set every cell outside of the window (start_x, end_x) x (start_y, end_y),
+   * bounds excluded, to NO_INFORMATION
+   */
+  void clearArea(int start_x, int start_y, int end_x, int end_y);
+
+  /**
+   * @brief Set every cell outside of the window [start_x, end_x) x [start_y, end_y)
+   * to value, and add the bounds of the cells that changed to the extra bounds,
+   * so that the next update only redraws those
+   */
+  void resetExceptArea(int start_x, int start_y, int end_x, int end_y, unsigned char value);
 
   /**
    * If an external source changes values in the costmap,
@@ -151,6 +165,17 @@ protected:
    * @param max_y bounding box (input and output)
    */
   void useExtraBounds(double * min_x, double * min_y, double * max_x, double * max_y);
+
+  /**
+   * @brief Set the cells outside of the window [x0, xn) x [y0, yn) to value, one
+   * span per row, writing only from the first to the last cell that differs
+   * @return Whether a cell changed, the changed cells are within
+   * [min_x, max_x] x [min_y, max_y]
+   */
+  virtual bool resetOutside(
+    int x0, int y0, int xn, int yn, unsigned char value,
+    int & min_x, int & min_y, int & max_x, int & max_y);
+
   bool has_extra_bounds_;
 
 private:
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_HPP_
+
+#include <memory>
+#include <string>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_util/snapshot.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Add a costmap to a snapshot, as the sections <name>/info, its size and
+ * origin, and <name>/costs, its cells in place
+ *
+ * Hold the mutex of a costmap that may change meanwhile, published snapshots need none.
+ */
+void addCostmap(
+  nav2_util::SnapshotWriter & writer, const std::string & name, const Costmap2D & costmap);
+
+/**
+ * @brief Read back a costmap added by addCostmap()
+ * @return false if the sections are missing or don't match
+ */
+bool readCostmap(
+  const nav2_util::Snapshot & snapshot, const std::string & name, Costmap2D & costmap);
+
+/**
+ * @brief Add a costmap to a snapshot, as its master grid under <name>/master, the grid of
+ * each layer that keeps one under <name>/layers/<layer>, its padded footprint and its
+ * frames
+ *
+ * Only the footprint and the frames are copied here. The grids are deferred to when the
+ * snapshot is written, see nav2_util::SnapshotWriter::defer(), so that the thread filling
+ * it takes none of the costmap locks. The layer grids are thus those at write time, which
+ * the layers may have updated since the cycle, only the master given is that of the cycle.
+ * @param master Master grid to add rather than the current one, e.g. the costmap snapshot
+ * a cycle ran on
+ */
+void addCostmapROS(
+  nav2_util::SnapshotWriter & writer, const std::string & name,
+  std::shared_ptr<Costmap2DROS> costmap_ros, std::shared_ptr<const Costmap2D> master = nullptr);
+
+/**
+ * @brief A costmap holding the master grid and footprint of one added by addCostmapROS(),
+ * configured without layers and left inactive, so that it waits for no transform and
+ * never updates, for replays to configure planners and controllers against
+ * @return nullptr if the snapshot has no such costmap
+ */
+std::shared_ptr<Costmap2DROS> replayCostmapROS(
+  const nav2_util::Snapshot & snapshot, const std::string & name);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_HPP_
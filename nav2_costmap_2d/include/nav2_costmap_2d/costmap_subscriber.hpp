@@ -15,38 +15,67 @@
 #ifndef NAV2_COSTMAP_2D__COSTMAP_SUBSCRIBER_HPP_
 #define NAV2_COSTMAP_2D__COSTMAP_SUBSCRIBER_HPP_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <memory>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/compressed_costmap.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
 {
 
+/**
+ * @class CostmapSubscriber
+ * @brief Subscribes to a costmap published by Costmap2DPublisher and converts it into a Costmap2D
+ */
 class CostmapSubscriber
 {
 public:
+  /** @brief How the costmap is received */
+  enum class Transport
+  {
+    /// nav2_msgs::msg::Costmap, e.g. on "costmap_raw"
+    RAW,
+    /// Run-length encoded nav2_msgs::msg::CompressedCostmap, e.g. on "costmap_raw_compressed"
+    COMPRESSED,
+    /// nav2_msgs::msg::Costmap over intra-process communication, e.g. on "costmap_raw_intra".
+    /// The costmap returned by getCostmap() reads the received message in place, without
+    /// a copy, and must not be modified.
+    INTRA_PROCESS
+  };
+
+  /** @brief Parse "raw", "compressed" or "intra_process", throws std::invalid_argument otherwise */
+  static Transport transportFromString(const std::string & transport);
+
   CostmapSubscriber(
     nav2_util::LifecycleNode::SharedPtr node,
-    const std::string & topic_name);
+    const std::string & topic_name,
+    Transport transport = Transport::RAW);
 
   CostmapSubscriber(
     rclcpp::Node::SharedPtr node,
-    const std::string & topic_name);
+    const std::string & topic_name,
+    Transport transport = Transport::RAW);
 
   CostmapSubscriber(
     const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base,
     const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
     const rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging,
-    const std::string & topic_name);
+    const std::string & topic_name,
+    Transport transport = Transport::RAW);
 
   ~CostmapSubscriber() {}
 
   std::shared_ptr<Costmap2D> getCostmap();
 
+  /** @brief Number of costmaps received so far, so callers can tell when getCostmap() changes */
+  uint64_t getCostmapVersion() const {return costmap_version_;}
+
 protected:
   // Interfaces used for logging and creating publishers and subscribers
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_;
@@ -54,13 +83,25 @@ protected:
   rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging_;
 
   void toCostmap2D();
+  /** @brief Make costmap_ match the size, resolution and origin in metadata */
+  void resizeCostmap(const nav2_msgs::msg::CostmapMetaData & metadata);
   void costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg);
+  void compressedCostmapCallback(const nav2_msgs::msg::CompressedCostmap::SharedPtr msg);
+  void intraProcessCostmapCallback(nav2_msgs::msg::Costmap::ConstSharedPtr msg);
 
   std::shared_ptr<Costmap2D> costmap_;
   nav2_msgs::msg::Costmap::SharedPtr costmap_msg_;
+  nav2_msgs::msg::CompressedCostmap::SharedPtr compressed_costmap_msg_;
+  nav2_msgs::msg::Costmap::ConstSharedPtr intra_process_costmap_msg_;
+  // The message costmap_ currently views, kept alive by costmap_ itself
+  const nav2_msgs::msg::Costmap * viewed_msg_{nullptr};
   std::string topic_name_;
   bool costmap_received_{false};
+  std::atomic<uint64_t> costmap_version_{0};
+  // The costmap_version_ last copied into costmap_
+  uint64_t decoded_version_{0};
   rclcpp::Subscription<nav2_msgs::msg::Costmap>::SharedPtr costmap_sub_;
+  rclcpp::Subscription<nav2_msgs::msg::CompressedCostmap>::SharedPtr compressed_costmap_sub_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -27,6 +27,7 @@
 #include "geometry_msgs/msg/pose2_d.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_costmap_2d/footprint_collision_checker.hpp"
+#include "nav2_costmap_2d/footprint_sweep.hpp"
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
 #include "nav2_costmap_2d/footprint_subscriber.hpp"
 #include "nav2_util/robot_utils.hpp"
@@ -48,17 +49,32 @@ public:
     std::string name = "collision_checker",
     std::string global_frame = "map",
     std::string robot_base_frame = "base_link",
-    double transform_tolerance = 0.1);
+    double transform_tolerance = 0.1,
+    unsigned int footprint_mask_yaw_bins = 0);
 
   ~CostmapTopicCollisionChecker() = default;
 
   // Returns the obstacle footprint score for a particular pose
   double scorePose(const geometry_msgs::msg::Pose2D & pose);
   bool isCollisionFree(const geometry_msgs::msg::Pose2D & pose);
+  // Scores a batch of poses with a single footprint and costmap lookup, stopping
+  // at the first lethal pose if requested. Returns that pose's index, or poses.size()
+  std::size_t scorePoses(
+    const std::vector<geometry_msgs::msg::Pose2D> & poses, std::vector<double> & costs,
+    bool stop_at_lethal = false);
+  // Whether every pose in the batch is collision free
+  bool isCollisionFree(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+  // Rasterizes the current footprint over poses into sweep, for repeated checks of a
+  // fixed motion. Returns false, leaving sweep empty, if the costmap or footprint is missing
+  bool buildSweep(const std::vector<geometry_msgs::msg::Pose2D> & poses, FootprintSweep & sweep);
+  // Whether poses [first, last) of sweep are collision free. The costmap is only re-read
+  // when a new one has been received since the sweep was last checked
+  bool isCollisionFree(FootprintSweep & sweep, std::size_t first, std::size_t last);
 
 protected:
   void unorientFootprint(const Footprint & oriented_footprint, Footprint & reset_footprint);
   Footprint getFootprint(const geometry_msgs::msg::Pose2D & pose);
+  Footprint getFootprintSpec();
 
   // Name used for logging
   std::string name_;
@@ -68,7 +84,13 @@ protected:
   CostmapSubscriber & costmap_sub_;
   FootprintSubscriber & footprint_sub_;
   double transform_tolerance_;
+  // Headings rasterized into cached footprint masks, 0 checks the exact footprint
+  unsigned int footprint_mask_yaw_bins_;
   FootprintCollisionChecker collision_checker_;
+
+  // The unoriented footprint, recomputed only when a new footprint message arrives
+  Footprint footprint_spec_;
+  uint64_t footprint_spec_version_{0};
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_WINDOW_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_WINDOW_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapWindow
+ * @brief A window of a costmap snapshot, e.g. the one around the robot a controller
+ * looks at, updated at a high rate without allocating
+ *
+ * A window inside the snapshot only points into its cells and keeps the snapshot
+ * alive. One reaching past its edges is copied into a buffer kept across updates,
+ * with the cells off the snapshot set to a fill cost. Either way the cells are read
+ * in window coordinates, the rows stride() cells apart.
+ */
+class CostmapWindow
+{
+public:
+  /**
+   * @brief Make this the window of size_x by size_y cells centred on a point
+   * @param snapshot Costmap the window is of, never written while held
+   * @param wx X of the point, in the frame of the snapshot
+   * @param wy Y of the point
+   * @param size_x Width of the window, in cells
+   * @param size_y Height of the window, in cells
+   * @param fill Cost of the cells off the snapshot
+   * @return Whether the window shares the cells of the snapshot, i.e. nothing was copied
+   */
+  bool update(
+    std::shared_ptr<const Costmap2D> snapshot, double wx, double wy,
+    unsigned int size_x, unsigned int size_y, unsigned char fill = NO_INFORMATION);
+
+  /** @brief Let go of the snapshot, the copy buffer keeps its capacity */
+  void reset();
+
+  /** @brief Whether the cells are the snapshot's rather than a copy */
+  bool isView() const {return snapshot_ && cells_ != buffer_.data();}
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+  /** @brief Cells between the starts of two rows */
+  unsigned int stride() const {return stride_;}
+  double getResolution() const {return resolution_;}
+  double getOriginX() const {return origin_x_;}
+  double getOriginY() const {return origin_y_;}
+  /** @brief Cell of the snapshot the window starts at, negative past its lower edges */
+  int getOffsetX() const {return offset_x_;}
+  int getOffsetY() const {return offset_y_;}
+
+  /** @brief First cell of a row of the window */
+  const unsigned char * row(unsigned int my) const {return cells_ + my * stride_;}
+
+  unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    return cells_[my * stride_ + mx];
+  }
+
+  /**
+   * @brief Convert a point to window cell coordinates
+   * @return Whether it is in the window
+   */
+  bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my) const;
+
+  /** @brief Centre of a window cell */
+  void mapToWorld(unsigned int mx, unsigned int my, double & wx, double & wy) const;
+
+  /**
+   * @brief Copy the window into a costmap of its geometry, reusing its buffer where it can
+   */
+  void copyTo(Costmap2D & costmap) const;
+
+protected:
+  std::shared_ptr<const Costmap2D> snapshot_;
+  std::vector<unsigned char> buffer_;  ///< Cells of a window reaching past the snapshot
+  const unsigned char * cells_{nullptr};
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  unsigned int stride_{0};
+  int offset_x_{0};
+  int offset_y_{0};
+  double resolution_{0.0};
+  double origin_x_{0.0};
+  double origin_y_{0.0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_WINDOW_HPP_
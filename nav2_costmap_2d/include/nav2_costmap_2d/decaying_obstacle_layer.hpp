@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
+#define NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+#include "nav2_costmap_2d/obstacle_marking.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class DecayingObstacleLayer
+ * @brief An obstacle layer whose obstacles expire decay_time after they were last seen
+ *
+ * Each cell keeps the time it was last marked at in 16 bits, 10 ms ticks.
+ * Every update, the stamps of the area holding live obstacles are swept once
+ * and the obstacles not seen again for decay_time are cleared. Obstacles no
+ * longer need rays to disappear, so clearing sources can be turned off, or
+ * thinned with their voxel_size, for dense sensors. Rays that are still
+ * traced clear cells as in ObstacleLayer.
+ */
+class DecayingObstacleLayer : public ObstacleLayer
+{
+public:
+  DecayingObstacleLayer() = default;
+
+  void onInitialize() override;
+  void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y,
+    double * max_x,
+    double * max_y) override;
+  void updateOrigin(double new_origin_x, double new_origin_y) override;
+  void matchSize() override;
+  void reset() override;
+
+  /** @brief Bytes of the layer's costmap and of its stamps */
+  std::size_t getMemoryUsage() const override;
+
+protected:
+  /** @brief updateBounds() stamps the cells it marks from the observations themselves */
+  bool canRasterizeObservations() const override {return false;}
+
+  /**
+   * @brief Clear the obstacles not seen for decay_time, update the area of the live ones
+   */
+  void decayObstacles(
+    uint16_t stamp, double * min_x, double * min_y, double * max_x,
+    double * max_y);
+
+  /** @brief Current time in stamp ticks */
+  uint16_t now() const;
+
+  uint16_t decay_ticks_{100};
+  std::vector<uint16_t> stamps_;
+  /// Cells that may hold live obstacles, empty if none do
+  MarkedCells live_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
@@ -0,0 +1,78 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DIRTY_REGION_SET_HPP_
+#define NAV2_COSTMAP_2D__DIRTY_REGION_SET_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class DirtyRegionSet
+ * @brief Coalesces changed map windows into a bounded set of rectangles
+ *
+ * Overlapping or touching windows are merged as they are added. When more
+ * than max_regions rectangles remain, the pair whose bounding box wastes the
+ * fewest unchanged cells is merged, so far apart updates do not degrade into
+ * one bounding box covering the whole map.
+ */
+class DirtyRegionSet
+{
+public:
+  /** @brief A half-open window [x0, xn) x [y0, yn) in map cells */
+  struct Region
+  {
+    unsigned int x0, xn, y0, yn;
+
+    uint64_t area() const
+    {
+      return static_cast<uint64_t>(xn - x0) * (yn - y0);
+    }
+  };
+
+  /**
+   * @brief Constructor
+   * @param max_regions Upper bound on the number of rectangles kept, at least 1
+   */
+  explicit DirtyRegionSet(unsigned int max_regions = 8);
+
+  /** @brief Change the upper bound on the number of rectangles kept */
+  void setMaxRegions(unsigned int max_regions);
+
+  /** @brief Mark the window [x0, xn) x [y0, yn) as changed. Empty windows are ignored. */
+  void add(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn);
+
+  /** @brief Forget all changed windows */
+  void clear() {regions_.clear();}
+
+  bool empty() const {return regions_.empty();}
+
+  /** @brief The disjoint rectangles covering every window added since the last clear() */
+  const std::vector<Region> & regions() const {return regions_;}
+
+private:
+  void add(Region region);
+  static Region merge(const Region & a, const Region & b);
+  static bool touches(const Region & a, const Region & b);
+
+  std::vector<Region> regions_;
+  unsigned int max_regions_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DIRTY_REGION_SET_HPP_
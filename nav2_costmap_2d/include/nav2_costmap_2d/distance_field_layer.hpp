@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DISTANCE_FIELD_LAYER_HPP_
+#define NAV2_COSTMAP_2D__DISTANCE_FIELD_LAYER_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class DistanceFieldLayer
+ * @brief Maintains the exact Euclidean distance from every master grid cell to the
+ * nearest lethal cell, without changing any costs.
+ *
+ * The layer only reads the master grid, so it should come after the layers that
+ * mark obstacles. Within each update window the field is recomputed with a linear
+ * time distance transform, over the window grown by max_distance so that obstacles
+ * appearing or disappearing there reach every cell they affect.
+ */
+class DistanceFieldLayer : public Layer
+{
+public:
+  DistanceFieldLayer();
+
+  void onInitialize() override;
+  void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y,
+    double * max_x,
+    double * max_y) override;
+  void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j) override;
+  void matchSize() override;
+  void reset() override;
+  std::size_t getMemoryUsage() const override;
+
+  /**
+   * @brief Distance field in meters, laid out like Costmap2D::getCharMap().
+   * Distances are capped at getMaxDistance(). Read it while holding the master
+   * costmap's mutex, which is held while the field is updated.
+   */
+  const float * getDistanceField() const
+  {
+    return distances_.data();
+  }
+
+  /**
+   * @brief Distance in meters from a cell to the nearest obstacle
+   */
+  float getDistance(unsigned int mx, unsigned int my) const
+  {
+    return distances_[my * size_x_ + mx];
+  }
+
+  /**
+   * @brief Distance in meters from a world point to the nearest obstacle
+   * @return false if the point is off the map
+   */
+  bool getDistanceAtWorld(double wx, double wy, float & distance) const;
+
+  /**
+   * @brief Distances are capped at this value, infinity if they are not capped
+   */
+  float getMaxDistance() const;
+
+  /**
+   * @brief First distance field layer among the plugins of a costmap, if any
+   */
+  static std::shared_ptr<DistanceFieldLayer> find(LayeredCostmap & layered_costmap);
+
+private:
+  double max_distance_;
+  bool unknown_is_obstacle_;
+
+  // Field in meters over the master grid and the squared cell distances scratch
+  std::vector<float> distances_;
+  std::vector<float> squared_distances_;
+  unsigned int size_x_, size_y_;
+  double origin_x_, origin_y_;
+  bool field_valid_;
+
+  std::unique_ptr<nav2_util::ThreadPool> pool_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DISTANCE_FIELD_LAYER_HPP_
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DISTANCE_TRANSFORM_HPP_
+#define NAV2_COSTMAP_2D__DISTANCE_TRANSFORM_HPP_
+
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Squared distance assigned to cells with no obstacle in the window
+ */
+const float DISTANCE_TRANSFORM_INF = 1e20f;
+
+/**
+ * @brief Exact Euclidean distance transform of a window of a cost grid
+ *
+ * Uses the separable lower envelope algorithm of Felzenszwalb and Huttenlocher,
+ * one pass over the rows followed by one over the columns, both linear in the
+ * number of cells. Rows and columns are processed in parallel when a pool is given.
+ * @param costs Cost grid, row major
+ * @param size_x Width of the cost grid in cells
+ * @param min_x First column of the window
+ * @param min_y First row of the window
+ * @param max_x One past the last column of the window
+ * @param max_y One past the last row of the window
+ * @param unknown_is_obstacle Whether NO_INFORMATION cells count as obstacles,
+ * in addition to LETHAL_OBSTACLE cells
+ * @param squared_distances Output, row major over the window, squared distance in
+ * cells to the nearest obstacle in the window, DISTANCE_TRANSFORM_INF if there is none
+ * @param pool Optional thread pool
+ */
+void squaredDistanceTransform(
+  const unsigned char * costs, unsigned int size_x,
+  unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y,
+  bool unknown_is_obstacle, float * squared_distances,
+  nav2_util::ThreadPool * pool = nullptr);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DISTANCE_TRANSFORM_HPP_
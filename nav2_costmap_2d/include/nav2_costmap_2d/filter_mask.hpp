@@ -0,0 +1,115 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__FILTER_MASK_HPP_
+#define NAV2_COSTMAP_2D__FILTER_MASK_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class FilterMask
+ * @brief The cells of a costmap filter mask that have an effect, cropped to their bounds
+ *
+ * Zones usually cover a small part of the map they are drawn on, so keeping their bounding
+ * box rather than the whole mask keeps a filter far smaller than a copy of the costmap.
+ */
+class FilterMask
+{
+public:
+  FilterMask() = default;
+
+  /**
+   * @brief Keep the cells of a mask with a value of at least min_value, the others read as 0
+   * @param mask Mask map, whose orientation is ignored like the static layer does
+   * @param min_value Lowest value that has an effect, at least 1
+   */
+  FilterMask(const nav_msgs::msg::OccupancyGrid & mask, int8_t min_value);
+
+  bool empty() const {return data_.empty();}
+
+  /**
+   * @brief Value of the mask at a point of its frame, 0 off the kept cells
+   */
+  int8_t valueAt(double x, double y) const
+  {
+    const double fx = (x - origin_x_) / resolution_;
+    const double fy = (y - origin_y_) / resolution_;
+    if (empty() || fx < 0.0 || fy < 0.0 || fx >= size_x_ || fy >= size_y_) {
+      return 0;
+    }
+    return data_[static_cast<unsigned int>(fy) * size_x_ + static_cast<unsigned int>(fx)];
+  }
+
+  const std::string & getFrame() const {return frame_;}
+  double getResolution() const {return resolution_;}
+  double getOriginX() const {return origin_x_;}
+  double getOriginY() const {return origin_y_;}
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+  std::size_t getMemoryUsage() const {return data_.capacity();}
+
+protected:
+  std::string frame_;
+  double resolution_{1.0};
+  double origin_x_{0.0};
+  double origin_y_{0.0};
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  std::vector<int8_t> data_;
+};
+
+/**
+ * @brief Costs of a mask resampled onto the cells of a costmap, laid out for the
+ * combination kernels
+ */
+struct MaskRaster
+{
+  double resolution{0.0};
+  double origin_x{0.0};
+  double origin_y{0.0};
+  unsigned int size_x{0};
+  unsigned int size_y{0};
+  std::vector<unsigned char> costs;  ///< NO_INFORMATION where the mask has no effect
+};
+
+/**
+ * @brief Resample a mask onto a grid, each cell taking the mask value at its center
+ * @param mask Mask to resample
+ * @param resolution Resolution of the grid
+ * @param grid_x, grid_y A cell corner of the grid, the raster cells line up with it
+ * @param cost Cost of the cells where the mask has an effect
+ */
+MaskRaster rasterizeMask(
+  const FilterMask & mask, double resolution, double grid_x, double grid_y,
+  unsigned char cost);
+
+/**
+ * @brief Combine a raster into the master grid with combineRowMax, within the given bounds
+ * @return false, without touching the master grid, if the raster cells do not line up with it
+ */
+bool applyMaskMax(
+  const MaskRaster & raster, Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__FILTER_MASK_HPP_
@@ -46,6 +46,7 @@
 #include "geometry_msgs/msg/polygon_stamped.hpp"
 #include "geometry_msgs/msg/point.hpp"
 #include "geometry_msgs/msg/point32.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
@@ -129,6 +130,58 @@ bool makeFootprintFromString(
   const std::string & footprint_string,
   std::vector<geometry_msgs::msg::Point> & footprint);
 
+/**
+ * @class CompactFootprint
+ * @brief A footprint as arrays of vertex coordinates, to be transformed to many poses
+ *
+ * The transforms are plain loops over the arrays, which the compiler vectorizes, with
+ * a single sine and cosine per pose and no message allocated per point.
+ */
+class CompactFootprint
+{
+public:
+  CompactFootprint() = default;
+  explicit CompactFootprint(const std::vector<geometry_msgs::msg::Point> & footprint);
+
+  std::size_t size() const {return x_.size();}
+  bool empty() const {return x_.empty();}
+  const double * x() const {return x_.data();}
+  const double * y() const {return y_.data();}
+
+  /** @brief Whether it has the vertices of a footprint */
+  bool matches(const std::vector<geometry_msgs::msg::Point> & footprint) const;
+
+  /** @brief Nearest distance of the outline to the origin, see calculateMinAndMaxDistances */
+  double getInscribedRadius() const {return inscribed_radius_;}
+  /** @brief Farthest distance of the outline to the origin */
+  double getCircumscribedRadius() const {return circumscribed_radius_;}
+
+  /**
+   * @brief Transform the vertices to a pose
+   * @param out_x Set to the size() x coordinates
+   * @param out_y Set to the size() y coordinates
+   */
+  void transform(double x, double y, double theta, double * out_x, double * out_y) const;
+
+  /**
+   * @brief Transform the vertices to several poses at once
+   * @param out_x Set to vertex i at pose p in out_x[p * size() + i], for n * size() values
+   */
+  void transform(
+    const geometry_msgs::msg::Pose2D * poses, std::size_t n,
+    double * out_x, double * out_y) const;
+
+  /** @brief Transform the vertices to a pose, as points */
+  void transform(
+    double x, double y, double theta, std::vector<geometry_msgs::msg::Point> & oriented) const;
+
+protected:
+  std::vector<double> x_;
+  std::vector<double> y_;
+  double inscribed_radius_{0.0};
+  double circumscribed_radius_{0.0};
+};
+
 }  // end namespace nav2_costmap_2d
 
 #endif  // NAV2_COSTMAP_2D__FOOTPRINT_HPP_
@@ -26,7 +26,9 @@
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/pose2_d.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_util/robot_utils.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -39,13 +41,86 @@ public:
   explicit FootprintCollisionChecker(std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap);
   double footprintCost(const Footprint footprint);
   double footprintCostAtPose(double x, double y, double theta, const Footprint footprint);
+  /**
+   * @brief Cost of the outline of a footprint at a pose, as footprintCostAtPose, with
+   * the vertices transformed one at a time instead of into an oriented footprint
+   */
+  double footprintCostAtPose(
+    double x, double y, double theta, const CompactFootprint & footprint);
+  /**
+   * @brief Cost of a footprint at a pose, read from a precomputed cell mask
+   *
+   * The footprint is rasterized once per yaw bin, relative to the center of the
+   * cell containing the pose, and cached until the footprint, the bin count or
+   * the costmap geometry changes. A check is then a max over a list of cell
+   * offsets. The result can differ from footprintCostAtPose by up to one cell
+   * along the outline and by half a yaw bin of rotation.
+   * @param x Pose x in world coordinates
+   * @param y Pose y in world coordinates
+   * @param theta Pose heading
+   * @param footprint Footprint centered at the origin
+   * @param yaw_bins Number of discrete headings to rasterize
+   * @param filled Whether to include the footprint interior, not only its outline
+   * @return Maximum cost under the mask, or LETHAL_OBSTACLE if it leaves the map
+   */
+  double footprintMaskCostAtPose(
+    double x, double y, double theta, const Footprint & footprint,
+    unsigned int yaw_bins = 72, bool filled = false);
+  /**
+   * @brief Score a batch of poses, e.g. a whole trajectory, with one footprint
+   *
+   * The costmap lock is taken once for the whole batch. A pose whose center is
+   * off the map scores LETHAL_OBSTACLE.
+   * @param poses Poses to score
+   * @param footprint Footprint centered at the origin
+   * @param costs Output, one cost per pose. With stop_at_lethal, poses after the
+   * first lethal one are not scored and are set to -1.0
+   * @param stop_at_lethal Whether to stop at the first pose at or above LETHAL_OBSTACLE
+   * @param yaw_bins If nonzero, score with cached masks, see footprintMaskCostAtPose
+   * @param pool Optional thread pool to score chunks of poses in parallel
+   * @return Index of the first pose at or above LETHAL_OBSTACLE, or poses.size() if none
+   */
+  std::size_t footprintCostsAtPoses(
+    const std::vector<geometry_msgs::msg::Pose2D> & poses, const Footprint & footprint,
+    std::vector<double> & costs, bool stop_at_lethal = false, unsigned int yaw_bins = 0,
+    nav2_util::ThreadPool * pool = nullptr);
   double lineCost(int x0, int x1, int y0, int y1) const;
   bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my);
   double pointCost(int x, int y) const;
   void setCostmap(std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap);
 
+  /**
+   * @brief Rebuild the footprint masks if the footprint or costmap geometry changed
+   *
+   * Together with maskCostAtPose, lets callers update the masks once and then
+   * score poses from several threads.
+   */
+  void updateFootprintMasks(const Footprint & footprint, unsigned int yaw_bins, bool filled);
+
+  /**
+   * @brief Cost under the current footprint masks, which must be up to date
+   *
+   * Only reads the masks and the costmap, so it may be called concurrently.
+   */
+  double maskCostAtPose(double x, double y, double theta) const;
+
 private:
+
+  struct FootprintMask
+  {
+    // Linear offsets from the pose cell, sorted so reads walk the grid row by row
+    std::vector<int> offsets;
+    int min_dx, max_dx, min_dy, max_dy;
+  };
+
   std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap_;
+
+  std::vector<FootprintMask> masks_;
+  Footprint mask_footprint_;
+  unsigned int mask_yaw_bins_{0};
+  bool mask_filled_{false};
+  double mask_resolution_{0.0};
+  unsigned int mask_size_x_{0};
 };
 
 }  // namespace nav2_costmap_2d
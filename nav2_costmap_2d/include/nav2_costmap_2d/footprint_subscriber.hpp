@@ -15,6 +15,8 @@
 #ifndef NAV2_COSTMAP_2D__FOOTPRINT_SUBSCRIBER_HPP_
 #define NAV2_COSTMAP_2D__FOOTPRINT_SUBSCRIBER_HPP_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -60,6 +62,9 @@ public:
     std::vector<geometry_msgs::msg::Point> & footprint,
     rclcpp::Time & stamp, rclcpp::Duration valid_footprint_timeout);
 
+  // Number of footprints received so far, so callers can cache what they derive from one
+  uint64_t getFootprintVersion() const {return footprint_version_;}
+
 protected:
   // Interfaces used for logging and creating publishers and subscribers
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_;
@@ -71,6 +76,7 @@ protected:
 
   std::string topic_name_;
   bool footprint_received_{false};
+  std::atomic<uint64_t> footprint_version_{0};
   rclcpp::Duration footprint_timeout_;
   geometry_msgs::msg::PolygonStamped::SharedPtr footprint_;
   rclcpp::Subscription<geometry_msgs::msg::PolygonStamped>::SharedPtr footprint_sub_;
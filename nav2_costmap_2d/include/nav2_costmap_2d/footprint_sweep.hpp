@@ -0,0 +1,115 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__FOOTPRINT_SWEEP_HPP_
+#define NAV2_COSTMAP_2D__FOOTPRINT_SWEEP_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class FootprintSweep
+ * @brief The footprint outline rasterized over a fixed sequence of poses
+ *
+ * Built once for a motion such as an in-place rotation or a straight back up,
+ * the sweep keeps the union of the cells under the outline at every pose and,
+ * for each cell, which poses cover it. Checking a range of poses is then a
+ * lookup of per-pose lethal counts. update() re-reads the swept cells from a
+ * new costmap and only adjusts the counts of poses covering cells that became
+ * or stopped being lethal, so the footprint is never re-transformed or
+ * re-rasterized while the motion stays on the sweep.
+ *
+ * Cells are anchored to the world, so a rolling costmap that moved by whole
+ * cells does not invalidate the sweep. The outline matches the cells visited by
+ * FootprintCollisionChecker::footprintCost, and cells off the map count as lethal.
+ */
+class FootprintSweep
+{
+public:
+  FootprintSweep() = default;
+
+  /**
+   * @brief Rasterize the footprint at every pose and read the cells from costmap
+   * @param costmap Costmap the poses are expressed in
+   * @param footprint Footprint centered at the origin
+   * @param poses Poses in the order they will be visited
+   * @param costmap_version Identifies costmap, see version()
+   */
+  void build(
+    const Costmap2D & costmap, const std::vector<geometry_msgs::msg::Point> & footprint,
+    const std::vector<geometry_msgs::msg::Pose2D> & poses, uint64_t costmap_version = 0);
+
+  /**
+   * @brief Re-read the swept cells from a newer costmap
+   * @return False if the resolution changed or the origin moved by a fraction of a
+   * cell, in which case the sweep must be built again
+   */
+  bool update(const Costmap2D & costmap, uint64_t costmap_version = 0);
+
+  /**
+   * @brief First pose in [first, last) whose outline touches a lethal cell
+   * @return The pose's index, or last if the whole range is collision free
+   */
+  std::size_t firstCollision(std::size_t first, std::size_t last) const;
+
+  /**
+   * @brief Whether the sweep still describes a robot at pose when it is expected at index
+   *
+   * True while pose is within one cell of the swept pose and rotated from it by
+   * less than it takes the outline to move a cell.
+   */
+  bool covers(const geometry_msgs::msg::Pose2D & pose, std::size_t index) const;
+
+  void clear();
+
+  bool empty() const {return poses_.empty();}
+  std::size_t size() const {return poses_.size();}
+  const std::vector<geometry_msgs::msg::Pose2D> & poses() const {return poses_;}
+  const std::vector<geometry_msgs::msg::Point> & footprint() const {return footprint_;}
+
+  /** @brief Number of distinct cells swept by the outline */
+  std::size_t cellCount() const {return cells_x_.size();}
+
+  /** @brief The costmap_version of the costmap last read by build() or update() */
+  uint64_t version() const {return version_;}
+
+private:
+  std::vector<geometry_msgs::msg::Pose2D> poses_;
+  std::vector<geometry_msgs::msg::Point> footprint_;
+
+  // Swept cells relative to the origin of the costmap the sweep was built on
+  std::vector<int> cells_x_, cells_y_;
+  // For cell i, the poses covering it are pose_ids_[pose_offsets_[i], pose_offsets_[i + 1])
+  std::vector<std::size_t> pose_offsets_;
+  std::vector<std::size_t> pose_ids_;
+
+  std::vector<unsigned char> cell_lethal_;
+  std::vector<unsigned int> pose_lethal_count_;
+
+  double resolution_{0.0};
+  double origin_x_{0.0}, origin_y_{0.0};
+  double yaw_tolerance_{0.0};
+  uint64_t version_{0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__FOOTPRINT_SWEEP_HPP_
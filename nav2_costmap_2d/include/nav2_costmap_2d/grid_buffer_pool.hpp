@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_COSTMAP_2D__GRID_BUFFER_POOL_HPP_
+#define NAV2_COSTMAP_2D__GRID_BUFFER_POOL_HPP_
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class GridBufferPool
+ * @brief Recycles the cell buffers of the costmaps by size class
+ *
+ * A resized map hands its old buffer back, and the next map of a size in the same
+ * class takes it instead of allocating, so that the layers of a costmap resized to
+ * a new static map, or a map resized back and forth, mostly swap buffers. Sizes are
+ * rounded up to four classes per doubling, and buffers of large grids are aligned
+ * for transparent huge pages.
+ */
+class GridBufferPool
+{
+public:
+  /// Grids from this size (bytes) on are aligned to, and advised to use, huge pages
+  static constexpr std::size_t HUGE_PAGE_THRESHOLD = std::size_t(64) << 20;
+  static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+  /// Size of the smallest class
+  static constexpr std::size_t MIN_CLASS = 4096;
+
+  /**
+   * @brief The pool shared by the process, never destroyed so that maps outliving
+   * others at exit can still give their buffer back
+   */
+  static GridBufferPool & instance();
+
+  GridBufferPool() = default;
+  GridBufferPool(const GridBufferPool &) = delete;
+  GridBufferPool & operator=(const GridBufferPool &) = delete;
+
+  /** @brief Frees the buffers kept, those acquired must not be released anymore */
+  ~GridBufferPool();
+
+  /**
+   * @brief Get a buffer of at least size bytes, its contents undefined
+   * @param size Number of bytes needed
+   * @param capacity Set to the size of the buffer, to give back with it
+   */
+  unsigned char * acquire(std::size_t size, std::size_t & capacity);
+
+  /**
+   * @brief Give a buffer of acquire() back, freeing it when the pool is full
+   */
+  void release(unsigned char * buffer, std::size_t capacity);
+
+  /** @brief Bound the bytes kept free in the pool, freeing those past it */
+  void setMaxFreeBytes(std::size_t bytes);
+
+  /** @brief Bytes kept free in the pool */
+  std::size_t freeBytes();
+
+  /** @brief Capacity of the buffers given for size bytes */
+  static std::size_t sizeClass(std::size_t size);
+
+protected:
+  static unsigned char * allocate(std::size_t capacity);
+  void trim();
+
+  std::mutex mutex_;
+  std::multimap<std::size_t, unsigned char *> free_;  ///< Free buffers by capacity
+  std::size_t free_bytes_{0};
+  std::size_t max_free_bytes_{std::size_t(256) << 20};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__GRID_BUFFER_POOL_HPP_
@@ -38,16 +38,25 @@
 #ifndef NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 #define NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
 #include <vector>
 #include <mutex>
+#include <queue>
+#include <utility>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_costmap_2d
 {
+class StaticLayer;
+
 /**
  * @class CellData
  * @brief Storage for cell information used during obstacle inflation
@@ -90,8 +99,39 @@ public:
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j) override;
 
+  /** @brief Tile-safe unless the persistent incremental field or the static base is in use */
+  bool isTileSafe() override
+  {
+    return !incremental_inflation_ && !static_inflation_;
+  }
+
+  /** @brief Obstacles up to the inflation radius away affect a tile */
+  unsigned int getTileHalo() override
+  {
+    return cell_inflation_radius_;
+  }
+
+  /**
+   * @brief Copy the costs of the window and its halo, which the tiles then take their
+   * obstacles from, the master cells of the halo being written by the other tiles
+   */
+  void prepareTiles(
+    const nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j) override;
+
+  /**
+   * @brief Inflate one tile using thread local scratch buffers, only writing
+   * costs inside the tile, from the obstacles copied by prepareTiles()
+   */
+  void updateCostsInTile(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j) override;
+
   void matchSize() override;
 
+  /** @brief Bytes of the seen flags, the incremental field and the distance caches */
+  std::size_t getMemoryUsage() const override;
+
   void reset() override
   {
     matchSize();
@@ -163,6 +203,11 @@ private:
 
   void computeCaches();
 
+  /**
+   * @brief Mark every cell as not seen, by starting a new epoch of seen_
+   */
+  void resetSeen();
+
   int generateIntegerDistances();
 
   unsigned int cellDistance(double world_dist)
@@ -174,6 +219,95 @@ private:
     unsigned int index, unsigned int mx, unsigned int my,
     unsigned int src_x, unsigned int src_y);
 
+  /**
+   * @brief Costs the obstacles of a window are found in, rows of size_x cells starting
+   * at cell (min_i, min_j) of the master, either the master itself or a copy of part of it
+   */
+  struct SourceWindow
+  {
+    const unsigned char * costs;
+    int min_i, min_j;
+    unsigned int size_x;
+
+    const unsigned char * row(int j) const
+    {
+      return costs + static_cast<std::size_t>(j - min_j) * size_x;
+    }
+  };
+
+  /// Whether a cost is an obstacle the others are inflated from
+  bool isSource(unsigned char cost) const
+  {
+    return cost == LETHAL_OBSTACLE || (inflate_around_unknown_ && cost == NO_INFORMATION);
+  }
+
+  /**
+   * @brief  Run the wavefront from the obstacle cells queued in the first bin, raising
+   * the costs of the given grid and leaving the bins empty
+   */
+  void propagateInflation(unsigned char * costs, unsigned int size_x, unsigned int size_y);
+
+  /**
+   * @brief  Bring the inflation of the static layers before this one up to date with
+   * their maps, if their obstacles can be told apart in the master grid
+   * @return Whether static_base_ holds it and the static obstacles are to be left out
+   */
+  bool updateStaticBase(const nav2_costmap_2d::Costmap2D & master_grid);
+
+  /**
+   * @brief  Raise the costs of the window to the static base, with the rules for
+   * unknown cells of the wavefront
+   */
+  void applyStaticBase(
+    unsigned char * master_array, unsigned int size_x,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Inflate the window using the persistent obstacle distance field,
+   * only propagating the obstacle cells that changed since the last cycle
+   */
+  void updateCostsIncremental(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Inflate the window from an exact distance transform of the obstacles
+   * around it, writing only the cells inside the window
+   * @param sources Costs holding the window and its halo, the obstacles are read from
+   * @param pool Optional pool the rows and columns of the transform are split over
+   */
+  void updateCostsDistanceTransform(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j, const SourceWindow & sources,
+    nav2_util::ThreadPool * pool);
+
+  /**
+   * @brief  Inflate the window by stamping the cost kernel of every obstacle around it,
+   * writing only the cells inside the window
+   * @param sources Costs holding the window and its halo, the obstacles are read from
+   */
+  void updateCostsKernel(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j, const SourceWindow & sources);
+
+  /**
+   * @brief  Drop the persistent distance field, forcing a full rebuild on the next update
+   */
+  void invalidateDistanceField();
+
+  /**
+   * @brief  Distance in cells between a cell and an obstacle source, both given as indices
+   */
+  inline double fieldDistance(unsigned int index, unsigned int src, unsigned int size_x)
+  {
+    return distanceLookup(index % size_x, index / size_x, src % size_x, src / size_x);
+  }
+
+  inline void fieldLower(unsigned int index, unsigned int size_x, unsigned int size_y);
+  inline void fieldRaise(unsigned int index, unsigned int size_x, unsigned int size_y);
+  inline void fieldLowerNeighbor(unsigned int n, unsigned int src, unsigned int size_x);
+  inline void fieldRaiseNeighbor(unsigned int n, unsigned int size_x);
+
   double inflation_radius_, inscribed_radius_, cost_scaling_factor_;
   bool inflate_unknown_, inflate_around_unknown_;
   unsigned int cell_inflation_radius_;
@@ -182,16 +316,52 @@ private:
 
   double resolution_;
 
-  std::vector<bool> seen_;
+  // A cell is seen when its mark is the current epoch, so a reset doesn't touch the map
+  std::vector<uint16_t> seen_;
+  uint16_t seen_epoch_{0};
 
   std::vector<unsigned char> cached_costs_;
   std::vector<double> cached_distances_;
   std::vector<std::vector<int>> distance_matrix_;
+  // Cost of a cell by its squared distance in cells to the nearest obstacle
+  std::vector<unsigned char> squared_distance_costs_;
+  // Costs around an obstacle, row-major over the square of side 2 * cell_inflation_radius_ + 1
+  std::vector<unsigned char> cost_kernel_;
   unsigned int cache_length_;
   double last_min_x_, last_min_y_, last_max_x_, last_max_y_;
 
   // Indicates that the entire costmap should be reinflated next time around.
   bool need_reinflation_;
+
+  // Incremental (dynamic brushfire) inflation state. For every cell we keep the
+  // index of the closest obstacle within the inflation radius (or NO_SOURCE) and
+  // its cost, so that a cycle only propagates the obstacles added or removed.
+  static constexpr unsigned int NO_SOURCE = std::numeric_limits<unsigned int>::max();
+  typedef std::pair<double, unsigned int> FieldEntry;
+  bool incremental_inflation_;
+  bool field_valid_;
+  double field_origin_x_, field_origin_y_;
+  std::vector<unsigned int> field_source_;
+  std::vector<unsigned char> field_cost_;
+  std::vector<bool> field_is_source_;
+  std::vector<bool> field_to_raise_;
+  std::priority_queue<FieldEntry, std::vector<FieldEntry>, std::greater<FieldEntry>> field_queue_;
+
+  // Costs of the window of a tiled stage and its halo, copied before its tiles run
+  std::vector<unsigned char> tile_sources_;
+  SourceWindow tile_window_{nullptr, 0, 0, 0};
+
+  bool distance_transform_inflation_;
+  std::unique_ptr<nav2_util::ThreadPool> transform_pool_;
+  bool kernel_inflation_;
+
+  // Inflation of the lethal cells of the static layers alone, computed once per map
+  // of them, so that a cycle only runs the wavefront from the other obstacles
+  bool static_inflation_;
+  std::vector<std::shared_ptr<StaticLayer>> static_layers_;
+  std::vector<uint64_t> static_versions_;
+  std::vector<unsigned char> static_base_;
+  bool static_base_valid_;
   mutex_t * access_;
 };
 
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__KEEPOUT_FILTER_HPP_
+#define NAV2_COSTMAP_2D__KEEPOUT_FILTER_HPP_
+
+#include <mutex>
+
+#include "nav2_costmap_2d/costmap_filter.hpp"
+#include "nav2_costmap_2d/filter_mask.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class KeepoutFilter
+ * @brief Marks the occupied cells of a keepout mask as lethal
+ *
+ * Only the bounding box of the zones is kept. When the mask is in the costmap global frame
+ * it is resampled once onto the master grid cells, and each update combines the rows of the
+ * zones within the update bounds with the vectorized max kernel; otherwise every cell of
+ * the bounds is looked up through the transform to the mask frame.
+ */
+class KeepoutFilter : public CostmapFilter
+{
+public:
+  KeepoutFilter();
+
+  void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y, double * max_x, double * max_y) override;
+  void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j) override;
+  void matchSize() override;
+  std::size_t getMemoryUsage() const override;
+
+protected:
+  void processMask(const nav_msgs::msg::OccupancyGrid & mask) override;
+
+  /**
+   * @brief Grow the bounds by the extent of a mask, in the global frame
+   */
+  void touchMask(
+    const FilterMask & mask, double * min_x, double * min_y, double * max_x,
+    double * max_y);
+
+  // Guards the mask and the raster, a new mask may come from the subscription
+  mutable std::mutex mutex_;
+  FilterMask mask_;
+  FilterMask previous_mask_;  ///< Cleared from the costmap at the next update
+  bool has_updated_data_{false};
+  MaskRaster raster_;
+  bool raster_valid_{false};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__KEEPOUT_FILTER_HPP_
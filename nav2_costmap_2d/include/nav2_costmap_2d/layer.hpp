@@ -91,9 +91,50 @@ public:
     Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j) = 0;
 
+  /**
+   * @brief Whether updateCosts() can run concurrently on disjoint tiles of
+   *        the master grid. A tile-safe layer must only write master cells
+   *        inside the window it is given and must not modify shared state.
+   */
+  virtual bool isTileSafe() {return false;}
+
+  /**
+   * @brief Number of cells around its window that the layer reads from the
+   *        master grid. When updating in tiles, a layer with a halo only runs
+   *        once all the earlier layers have finished the neighbouring tiles.
+   */
+  virtual unsigned int getTileHalo() {return 0;}
+
+  /**
+   * @brief Called on the updating thread before the tiles of a stage run, with the
+   *        whole window they cover. A layer with a halo copies here what it reads of
+   *        the master grid, its tiles then read the copy and not the cells that the
+   *        neighbouring tiles are writing.
+   */
+  virtual void prepareTiles(
+    const Costmap2D & /*master_grid*/,
+    int /*min_i*/, int /*min_j*/, int /*max_i*/, int /*max_j*/) {}
+
+  /**
+   * @brief Update one tile of the master grid, only called on tile-safe layers.
+   *        Defaults to updateCosts() restricted to the tile.
+   */
+  virtual void updateCostsInTile(
+    Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j)
+  {
+    updateCosts(master_grid, min_i, min_j, max_i, max_j);
+  }
+
   /** @brief Implement this to make this layer match the size of the parent costmap. */
   virtual void matchSize() {}
 
+  /**
+   * @brief Bytes of the grids and caches the layer holds, for memory reports.
+   *        Layers keeping no per cell data can leave it at 0
+   */
+  virtual std::size_t getMemoryUsage() const {return 0;}
+
   /** @brief LayeredCostmap calls this whenever the footprint there
    * changes (via LayeredCostmap::setFootprint()).  Override to be
    * notified of changes to the robot's footprint. */
@@ -119,6 +160,12 @@ public:
     return current_;
   }
 
+  /** @brief Whether the layer writes into the master grid */
+  bool isEnabled() const
+  {
+    return enabled_;
+  }
+
   /** @brief Convenience function for layered_costmap_->getFootprint(). */
   const std::vector<geometry_msgs::msg::Point> & getFootprint() const;
 
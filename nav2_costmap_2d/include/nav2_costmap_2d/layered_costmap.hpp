@@ -40,11 +40,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "nav2_util/timing_stats.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -162,7 +165,76 @@ public:
   * of poorly configured setups. */
   bool isOutofBounds(double robot_x, double robot_y);
 
+  /**
+   * @brief Split the update window into tiles of tile_size x tile_size cells and
+   * run the tile-safe layers on num_threads threads, keeping the layer order
+   * within each tile. num_threads of 1 restores the sequential update.
+   * The same threads resize the layers to a new map size.
+   */
+  void setTiledUpdate(unsigned int num_threads, unsigned int tile_size);
+
+  /**
+   * @brief Time updateBounds() and updateCosts() of each plugin into stats, under
+   * "<layer> update_bounds" and "<layer> update_costs". Null stops the timing
+   */
+  void setTimingStats(std::shared_ptr<nav2_util::TimingStats> stats);
+
+  /**
+   * @brief Stats the plugins may add their own histograms to, null when not timing
+   */
+  std::shared_ptr<nav2_util::TimingStats> getTimingStats() const {return timing_stats_;}
+
+  /**
+   * @brief Bytes held by the master grid, named "master", by the pyramid if any,
+   * named "pyramid", then by each plugin in order.
+   * Takes the master grid's lock, so it never reads a grid being resized
+   */
+  std::vector<std::pair<std::string, std::size_t>> getMemoryUsage();
+
+  /**
+   * @brief Maintain a max-pooled pyramid of the master grid
+   *
+   * Level i, for i from 1 to levels, has cells 2^i times larger than the master
+   * grid, each one holding the highest cost of the cells it covers, so
+   * NO_INFORMATION wins over every other cost. The levels are updated over the
+   * bounds of each updateMap(), and rebuilt whenever the master grid is resized
+   * or moves. 0 drops the pyramid.
+   */
+  void setPyramidLevels(unsigned int levels);
+
+  unsigned int getPyramidLevels() const
+  {
+    return static_cast<unsigned int>(pyramid_.size());
+  }
+
+  /**
+   * @brief Level of the pyramid, 0 being the master grid itself
+   *
+   * The levels are written under their own locks, so readers lock the level they read.
+   * @return Null past the last level
+   */
+  Costmap2D * getPyramidLevel(unsigned int level)
+  {
+    if (level == 0) {
+      return &costmap_;
+    }
+    return level <= pyramid_.size() ? pyramid_[level - 1].get() : nullptr;
+  }
+
 private:
+  /** @brief Run updateCosts() of every plugin over the window, tile by tile */
+  void updateCostsInTiles(int x0, int y0, int xn, int yn);
+
+  /** @brief Match the pyramid to the master grid's geometry and pool all of it */
+  void resizePyramid();
+
+  /** @brief Pool the cells of the master grid window [x0, xn) x [y0, yn) into the pyramid */
+  void updatePyramid(int x0, int y0, int xn, int yn);
+
+  /** @brief Histograms of the plugin at index, null when not timing */
+  nav2_util::TimingHistogram * boundsTiming(std::size_t index);
+  nav2_util::TimingHistogram * costsTiming(std::size_t index);
+
   Costmap2D costmap_;
   std::string global_frame_;
 
@@ -178,6 +250,18 @@ private:
   bool size_locked_;
   double circumscribed_radius_, inscribed_radius_;
   std::vector<geometry_msgs::msg::Point> footprint_;
+
+  std::unique_ptr<nav2_util::ThreadPool> tile_pool_;
+  unsigned int tile_threads_;
+  unsigned int tile_size_;
+
+  // Level i + 1 of the pyramid, the levels keep their addresses across resizes
+  std::vector<std::unique_ptr<Costmap2D>> pyramid_;
+
+  // Looked up again whenever plugins are added
+  std::shared_ptr<nav2_util::TimingStats> timing_stats_;
+  std::vector<nav2_util::TimingHistogram *> bounds_timings_;
+  std::vector<nav2_util::TimingHistogram *> costs_timings_;
 };
 
 }  // namespace nav2_costmap_2d
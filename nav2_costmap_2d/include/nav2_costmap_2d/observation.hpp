@@ -32,6 +32,8 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_HPP_
 
+#include <memory>
+
 #include <geometry_msgs/msg/point.hpp>
 #include <sensor_msgs/msg/point_cloud2.hpp>
 
@@ -40,8 +42,9 @@ namespace nav2_costmap_2d
 
 /**
  * @brief Stores an observation in terms of a point cloud and the origin of the source
- * @note Tried to make members and constructor arguments const but the compiler would not accept the default
- * assignment operator for vector insertion!
+ *
+ * The cloud is immutable and shared: copying an observation, e.g. out of an
+ * ObservationBuffer, only copies a reference to it.
  */
 class Observation
 {
@@ -50,13 +53,13 @@ public:
    * @brief  Creates an empty observation
    */
   Observation()
-  : cloud_(new sensor_msgs::msg::PointCloud2()), obstacle_range_(0.0), raytrace_range_(0.0)
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>()), obstacle_range_(0.0),
+    raytrace_range_(0.0)
   {
   }
 
   virtual ~Observation()
   {
-    delete cloud_;
   }
 
   /**
@@ -69,35 +72,27 @@ public:
   Observation(
     geometry_msgs::msg::Point & origin, const sensor_msgs::msg::PointCloud2 & cloud,
     double obstacle_range, double raytrace_range)
-  : origin_(origin), cloud_(new sensor_msgs::msg::PointCloud2(cloud)),
+  : origin_(origin), cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
     obstacle_range_(obstacle_range), raytrace_range_(raytrace_range)
   {
   }
 
-  /**
-   * @brief  Copy constructor
-   * @param obs The observation to copy
-   */
-  Observation(const Observation & obs)
-  : origin_(obs.origin_), cloud_(new sensor_msgs::msg::PointCloud2(*(obs.cloud_))),
-    obstacle_range_(obs.obstacle_range_), raytrace_range_(obs.raytrace_range_)
-  {
-  }
-
   /**
    * @brief  Creates an observation from a point cloud
    * @param cloud The point cloud of the observation
    * @param obstacle_range The range out to which an observation should be able to insert obstacles
    */
   Observation(const sensor_msgs::msg::PointCloud2 & cloud, double obstacle_range)
-  : cloud_(new sensor_msgs::msg::PointCloud2(cloud)), obstacle_range_(obstacle_range),
-    raytrace_range_(0.0)
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
+    obstacle_range_(obstacle_range), raytrace_range_(0.0)
   {
   }
 
   geometry_msgs::msg::Point origin_;
-  sensor_msgs::msg::PointCloud2 * cloud_;
+  std::shared_ptr<const sensor_msgs::msg::PointCloud2> cloud_;
   double obstacle_range_, raytrace_range_;
+  /// Angle bins of a planar scan to clear with a polar sweep, 0 traces a ray per point
+  unsigned int polar_clearing_bins_{0};
 };
 
 }  // namespace nav2_costmap_2d
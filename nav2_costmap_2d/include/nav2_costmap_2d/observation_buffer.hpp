@@ -37,15 +37,20 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 
+#include <cstdint>
 #include <vector>
 #include <list>
+#include <memory>
 #include <string>
+#include <unordered_set>
 
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "rclcpp/time.hpp"
 #include "tf2_ros/buffer.h"
 #include "tf2_sensor_msgs/tf2_sensor_msgs.h"
+#include "sensor_msgs/msg/laser_scan.hpp"
 #include "sensor_msgs/msg/point_cloud2.hpp"
+#include "nav2_costmap_2d/cloud_transform.hpp"
 #include "nav2_costmap_2d/observation.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
@@ -71,6 +76,8 @@ public:
    * @param  global_frame The frame to transform PointClouds into
    * @param  sensor_frame The frame of the origin of the sensor, can be left blank to be read from the messages
    * @param  tf_tolerance The amount of time to wait for a transform to be available when setting a new global frame
+   * @param  voxel_size Edge of the voxels clouds are downsampled to, 0 keeps every point
+   * @param  polar_clearing_bins Angle bins the observations are cleared in, 0 to trace rays
    */
   ObservationBuffer(
     nav2_util::LifecycleNode::SharedPtr nh,
@@ -80,7 +87,9 @@ public:
     double min_obstacle_height, double max_obstacle_height, double obstacle_range,
     double raytrace_range, tf2_ros::Buffer & tf2_buffer, std::string global_frame,
     std::string sensor_frame,
-    double tf_tolerance);
+    double tf_tolerance,
+    double voxel_size = 0.0,
+    unsigned int polar_clearing_bins = 0);
 
   /**
    * @brief  Destructor... cleans up
@@ -103,6 +112,15 @@ public:
    */
   void bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud);
 
+  /**
+   * @brief  Projects a laser scan straight into the global frame and buffers it, without
+   * going through an intermediate cloud
+   * <b>Note: The burden is on the user to make sure the transform is available... ie they should use a MessageNotifier</b>
+   * @param  scan The scan to be buffered
+   * @param  inf_is_valid Whether positive infinities are free space up to the scan's range_max
+   */
+  void bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid);
+
   /**
    * @brief  Pushes copies of all current observations onto the end of the vector passed in
    * @param  observations The vector to be filled
@@ -142,6 +160,18 @@ private:
    */
   void purgeStaleObservations();
 
+  /**
+   * @brief  Buffers an observation of the sensor at header, its cloud filled by
+   * transform_points(matrix, filter, cloud) from the transform to the global frame
+   */
+  template<typename TransformPointsT>
+  void bufferObservation(const std_msgs::msg::Header & header, TransformPointsT transform_points);
+
+  /**
+   * @brief  Returns a cloud from the pool that no observation refers to anymore, or a new one
+   */
+  std::shared_ptr<sensor_msgs::msg::PointCloud2> acquireCloud();
+
   tf2_ros::Buffer & tf2_buffer_;
   const rclcpp::Duration observation_keep_time_;
   const rclcpp::Duration expected_update_rate_;
@@ -155,6 +185,12 @@ private:
   std::recursive_mutex lock_;  ///< @brief A lock for accessing data in callbacks safely
   double obstacle_range_, raytrace_range_;
   double tf_tolerance_;
+  double voxel_size_;
+  unsigned int polar_clearing_bins_;
+  std::unordered_set<uint64_t> voxels_;  ///< @brief Scratch set of the voxels kept from a cloud
+  ScanAngles scan_angles_;  ///< @brief Beam tables of the scanner, kept across its scans
+  /// @brief Clouds handed out to observations, recycled once every observation dropped them
+  std::vector<std::shared_ptr<sensor_msgs::msg::PointCloud2>> cloud_pool_;
 };
 }  // namespace nav2_costmap_2d
 #endif  // NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
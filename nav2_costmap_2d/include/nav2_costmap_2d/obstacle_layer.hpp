@@ -38,8 +38,14 @@
 #ifndef NAV2_COSTMAP_2D__OBSTACLE_LAYER_HPP_
 #define NAV2_COSTMAP_2D__OBSTACLE_LAYER_HPP_
 
+#include <condition_variable>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
@@ -57,6 +63,9 @@
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/obstacle_marking.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "nav2_util/timing_stats.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -80,6 +89,9 @@ public:
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
 
+  /** @brief updateCosts() only combines this layer into its window */
+  virtual bool isTileSafe() {return true;}
+
   virtual void activate();
   virtual void deactivate();
   virtual void reset();
@@ -121,7 +133,13 @@ public:
 
 protected:
   /**
-   * @brief  Get the observations used to mark space
+   * @brief  Whether the sources may be rasterized off the update thread, false for
+   * layers whose updateBounds() reads the observations themselves
+   */
+  virtual bool canRasterizeObservations() const {return true;}
+
+  /**
+   * @brief  Get the observations used to mark space, but those of rasterized sources
    * @param marking_observations A reference to a vector that will be populated with the observations
    * @return True if all the observation buffers are current, false otherwise
    */
@@ -129,7 +147,7 @@ protected:
     std::vector<nav2_costmap_2d::Observation> & marking_observations) const;
 
   /**
-   * @brief  Get the observations used to clear space
+   * @brief  Get the observations used to clear space, but those of rasterized sources
    * @param clearing_observations A reference to a vector that will be populated with the observations
    * @return True if all the observation buffers are current, false otherwise
    */
@@ -150,6 +168,102 @@ protected:
     double * max_x,
     double * max_y);
 
+  /**
+   * @brief  Grow the bounds to hold a set of cells, through the centers of its corner cells
+   */
+  void touchCells(
+    const MarkedCells & cells, double * min_x, double * min_y, double * max_x,
+    double * max_y);
+
+  /**
+   * @brief  Buffer a message of a source that passed its TF filter, on the ingest thread
+   * if there is one. A message of the source still waiting there is dropped
+   * @param slot Index of the source in ingest_slots_
+   * @param stamp Stamp of the message
+   * @param work Buffers the message
+   */
+  void ingest(std::size_t slot, const rclcpp::Time & stamp, std::function<void()> work);
+
+  /**
+   * @brief  Count a message of a source dropped before it was buffered
+   */
+  void recordDrop(std::size_t slot, const rclcpp::Time & stamp);
+
+  /**
+   * @brief  Nanoseconds since a stamp, 0 for stamps in the future
+   */
+  int64_t ageOf(const rclcpp::Time & stamp) const;
+
+  /**
+   * @brief  Buffer the waiting message of every source until the layer is destroyed
+   */
+  void ingestLoop();
+
+  /// @brief The cells of the latest observation of a source, found as soon as it is buffered
+  struct RasterSource
+  {
+    std::shared_ptr<ObservationBuffer> buffer;
+    bool marking{false};
+    bool clearing{false};
+    /// Off the update thread: the buffered observation and the raster being filled
+    std::vector<Observation> latest;
+    ObservationRaster building;
+    /// Latest raster, newer than applied when fresh
+    std::mutex mutex;
+    ObservationRaster ready;
+    bool fresh{false};
+    /// Update thread only: the raster merged on every update until a newer one is ready,
+    /// whether this update merges it and its offset into the layer's grid
+    ObservationRaster applied;
+    bool apply{false};
+    int dx{0};
+    int dy{0};
+  };
+
+  /**
+   * @brief  Rasterize the observation just buffered by a source, on the thread that buffered it
+   */
+  void rasterizeLatest(RasterSource & source);
+
+  /**
+   * @brief  Whether the observations of a buffer are rasterized off the update thread
+   */
+  bool isRasterized(const ObservationBuffer * buffer) const;
+
+  /**
+   * @brief  Write a value into the cells of a raster, shifted by whole cells into this grid
+   */
+  void applyRasterCells(
+    const std::vector<unsigned int> & cells, const RasterGeometry & geometry, int dx, int dy,
+    unsigned char value);
+
+  /**
+   * @brief  Clears the cells of a planar observation in one pass over the cells in its
+   * raytrace range: a cell is cleared when it is nearer the sensor than the farthest point
+   * in its angle bin
+   * @param x0, y0 Cell of the sensor
+   */
+  void polarClearFreespace(
+    const nav2_costmap_2d::Observation & clearing_observation, unsigned int x0, unsigned int y0,
+    double * min_x, double * min_y, double * max_x, double * max_y);
+
+  /// @brief Angle bin and range in cells of the cells around a sensor's cell
+  struct PolarTable
+  {
+    std::vector<uint32_t> bin;  ///< Row-major over the square of side 2 * radius + 1
+    std::vector<float> range;
+  };
+
+  /**
+   * @brief  Table of a raytrace range in cells and a bin count, computed on first use
+   */
+  const PolarTable & polarTable(unsigned int radius, unsigned int bins);
+
+  /**
+   * @brief  Angle bin of an offset from the sensor, among bins bins starting at -pi
+   */
+  static unsigned int polarBin(double dx, double dy, unsigned int bins);
+
   void updateRaytraceBounds(
     double ox, double oy, double wx, double wy, double range,
     double * min_x, double * min_y,
@@ -184,8 +298,43 @@ protected:
   std::vector<nav2_costmap_2d::Observation> static_clearing_observations_;
   std::vector<nav2_costmap_2d::Observation> static_marking_observations_;
 
+  /// @brief Observations of the current update, emptied after it with their capacity kept
+  std::vector<nav2_costmap_2d::Observation> marking_scratch_;
+  std::vector<nav2_costmap_2d::Observation> clearing_scratch_;
+
   bool rolling_window_;
   int combination_method_;
+
+  /// @brief Threads clearing rays are traced on, nullptr to trace them on the update thread
+  std::unique_ptr<nav2_util::ThreadPool> raytrace_pool_;
+  /// @brief Scratch storage for the deduplicated end cells of one observation's rays
+  std::vector<unsigned int> raytrace_ends_;
+  /// @brief Polar tables by raytrace range in cells and bin count
+  std::map<std::pair<unsigned int, unsigned int>, PolarTable> polar_tables_;
+  /// @brief Scratch range of the farthest point in each bin, in cells, -1 for none
+  std::vector<float> polar_ranges_;
+
+  /// @brief Sources rasterized off the update thread, see rasterize_observations
+  std::vector<std::unique_ptr<RasterSource>> raster_sources_;
+  /// @brief Grid of the layer as of the last update, which sources rasterize against
+  RasterGeometry raster_geometry_;
+  std::mutex raster_geometry_mutex_;
+
+  /// @brief The newest message of a source waiting for the ingest thread, and its statistics
+  struct IngestSlot
+  {
+    std::function<void()> work;  ///< Buffers the waiting message, empty when none waits
+    RasterSource * raster{nullptr};  ///< Rasterizes the source once buffered, if not null
+    rclcpp::Time stamp;
+    nav2_util::TimingHistogram * lag{nullptr};  ///< Ages of the messages buffered
+    nav2_util::TimingHistogram * dropped{nullptr};  ///< Ages of the messages dropped
+  };
+  std::vector<IngestSlot> ingest_slots_;
+  /// @brief Buffers the messages off the executor, not joinable when they are buffered on it
+  std::thread ingest_thread_;
+  std::mutex ingest_mutex_;
+  std::condition_variable ingest_cv_;
+  bool ingest_stop_{false};
 };
 
 }  // namespace nav2_costmap_2d
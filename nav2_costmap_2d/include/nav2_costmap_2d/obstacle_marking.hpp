@@ -0,0 +1,128 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__OBSTACLE_MARKING_HPP_
+#define NAV2_COSTMAP_2D__OBSTACLE_MARKING_HPP_
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/observation.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Inclusive cell bounds of the cells marked by markObservation()
+ */
+struct MarkedCells
+{
+  int min_x{INT_MAX};
+  int min_y{INT_MAX};
+  int max_x{INT_MIN};
+  int max_y{INT_MIN};
+
+  bool empty() const {return min_x > max_x;}
+
+  void add(int x, int y)
+  {
+    min_x = std::min(min_x, x);
+    min_y = std::min(min_y, y);
+    max_x = std::max(max_x, x);
+    max_y = std::max(max_y, y);
+  }
+};
+
+/**
+ * @brief Stamps markObservation() gives the cells it marks, laid out like the costmap
+ */
+struct CellStamps
+{
+  uint16_t * data;
+  uint16_t now;  ///< Stamp written
+};
+
+/**
+ * @brief Mark the cells of the points of an observation as LETHAL_OBSTACLE
+ *
+ * Points above max_obstacle_height, at obstacle_range_ or further from the
+ * observation's origin, or outside of the costmap are skipped, exactly as the
+ * per point loop of ObstacleLayer::updateBounds() did. The float32 x, y and z
+ * fields are read in place and the points tested two at a time with SSE2
+ * where available; the bounds of the marked cells are kept as integers.
+ * @param marked Grown to hold the cells marked
+ * @param stamps If not null, the cells marked are given its stamp
+ * @return false if the cloud has no float32 x, y and z fields, nothing is marked then
+ */
+bool markObservation(
+  const Observation & observation, double max_obstacle_height,
+  Costmap2D & costmap, MarkedCells & marked, const CellStamps * stamps = nullptr);
+
+/**
+ * @brief Size, origin and resolution of a grid, without its cells
+ */
+struct RasterGeometry
+{
+  unsigned int size_x{0};
+  unsigned int size_y{0};
+  double origin_x{0.0};
+  double origin_y{0.0};
+  double resolution{0.0};
+
+  static RasterGeometry of(const Costmap2D & costmap);
+
+  /**
+   * @brief Whole cell offset from the cells of this geometry to those of another,
+   * the cell (x, y) here being (x + dx, y + dy) there
+   * @return False if the grids differ by more than a shift of their origin by whole cells
+   */
+  bool offsetTo(const RasterGeometry & other, int & dx, int & dy) const;
+};
+
+/**
+ * @brief The cells an observation clears and marks, computed without touching a costmap
+ */
+struct ObservationRaster
+{
+  RasterGeometry geometry;  ///< Grid the indices are in
+  std::vector<unsigned int> cleared;  ///< Cells its rays clear, sorted, each once
+  std::vector<unsigned int> marked;  ///< Cells it marks, sorted, each once
+  MarkedCells cleared_bounds;  ///< Bounds of the cleared cells and of the sensor's cell
+  MarkedCells marked_bounds;
+  bool valid{false};
+  std::vector<unsigned int> scratch;  ///< Ray end cells, kept for their capacity
+
+  /// @brief Empties the raster, keeping the capacity of its cells
+  void clear();
+};
+
+/**
+ * @brief Find the cells an observation clears and marks in a grid
+ *
+ * Marks are those of markObservation(), clears those of the rays
+ * ObstacleLayer::raytraceFreespace() traces, from the sensor's cell to the cell
+ * of each point clipped to the grid, up to the observation's raytrace range.
+ * Nothing is cleared when the sensor is out of the grid.
+ * @return false if the cloud has no float32 x, y and z fields, the raster is left invalid then
+ */
+bool rasterizeObservation(
+  const Observation & observation, double max_obstacle_height, bool marking, bool clearing,
+  const RasterGeometry & geometry, ObservationRaster & raster);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__OBSTACLE_MARKING_HPP_
@@ -0,0 +1,136 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__PAGED_GRID_HPP_
+#define NAV2_COSTMAP_2D__PAGED_GRID_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class PagedGrid
+ * @brief Sparse cost storage that only allocates the pages that were written
+ *
+ * The grid is split into PAGE_SIZE x PAGE_SIZE pages. A page is allocated the
+ * first time one of its cells is set to something other than the default
+ * value; until then reads come from a read-only page of default values shared
+ * by every grid with the same default. Memory therefore scales with the area
+ * that holds information rather than with the map's bounding box.
+ *
+ * Only the range sensor layer keeps its grid in one, with sparse_storage. The
+ * CostmapLayer grid of the static, obstacle and voxel layers stays dense, as
+ * the master grid and every reader of getCharMap() expect a row-major array.
+ */
+class PagedGrid
+{
+public:
+  static constexpr unsigned int PAGE_BITS = 6;
+  static constexpr unsigned int PAGE_SIZE = 1u << PAGE_BITS;
+  static constexpr unsigned int PAGE_MASK = PAGE_SIZE - 1;
+  static constexpr unsigned int PAGE_AREA = PAGE_SIZE * PAGE_SIZE;
+
+  PagedGrid();
+
+  PagedGrid(unsigned int size_x, unsigned int size_y, unsigned char default_value);
+
+  /** @brief Resize the grid, releasing every page so all cells read default_value */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned char default_value);
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+  unsigned char getDefaultValue() const {return default_value_;}
+
+  inline unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    const unsigned char * page = pages_[pageIndex(mx, my)].get();
+    return page ? page[pageOffset(mx, my)] : default_value_;
+  }
+
+  inline void setCost(unsigned int mx, unsigned int my, unsigned char cost)
+  {
+    std::unique_ptr<unsigned char[]> & page = pages_[pageIndex(mx, my)];
+    if (!page) {
+      if (cost == default_value_) {
+        return;
+      }
+      page = allocatePage();
+    }
+    page[pageOffset(mx, my)] = cost;
+  }
+
+  /**
+   * @brief Visit cells [x0, xn) of row y as contiguous read-only runs
+   * @param fn Called as fn(const unsigned char * run, unsigned int x, unsigned int length)
+   * for each run, in increasing x. Runs in unallocated pages point into the shared default page.
+   */
+  template<typename F>
+  void forEachRowSegment(unsigned int y, unsigned int x0, unsigned int xn, F && fn) const
+  {
+    while (x0 < xn) {
+      const unsigned int length = std::min(xn, (x0 | PAGE_MASK) + 1) - x0;
+      const unsigned char * page = pages_[pageIndex(x0, y)].get();
+      fn((page ? page : default_page_.get()) + pageOffset(x0, y), x0, length);
+      x0 += length;
+    }
+  }
+
+  /**
+   * @brief Fill the grid from a size_x * size_y row-major array, e.g. Costmap2D::getCharMap()
+   *
+   * Only pages holding at least one non-default cell are allocated.
+   */
+  void copyFromRowMajor(const unsigned char * costs);
+
+  /** @brief Write the grid out as a size_x * size_y row-major array */
+  void copyToRowMajor(unsigned char * costs) const;
+
+  /** @brief Release allocated pages whose cells all hold the default value again */
+  void compact();
+
+  std::size_t getAllocatedPages() const;
+
+  /** @brief Bytes used by allocated pages and the page table */
+  std::size_t getMemoryUsage() const;
+
+private:
+  inline std::size_t pageIndex(unsigned int mx, unsigned int my) const
+  {
+    return static_cast<std::size_t>(my >> PAGE_BITS) * pages_x_ + (mx >> PAGE_BITS);
+  }
+
+  static inline unsigned int pageOffset(unsigned int mx, unsigned int my)
+  {
+    return ((my & PAGE_MASK) << PAGE_BITS) | (mx & PAGE_MASK);
+  }
+
+  std::unique_ptr<unsigned char[]> allocatePage() const;
+
+  /** @brief The process-wide read-only page holding only value */
+  static std::shared_ptr<const unsigned char> sharedDefaultPage(unsigned char value);
+
+  unsigned int size_x_, size_y_;
+  unsigned int pages_x_;
+  unsigned char default_value_;
+  std::vector<std::unique_ptr<unsigned char[]>> pages_;
+  std::shared_ptr<const unsigned char> default_page_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__PAGED_GRID_HPP_
@@ -36,8 +36,11 @@
 #ifndef NAV2_COSTMAP_2D__RANGE_SENSOR_LAYER_HPP_
 #define NAV2_COSTMAP_2D__RANGE_SENSOR_LAYER_HPP_
 
+#include <cmath>
 #include <list>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <mutex>
 
@@ -45,6 +48,7 @@
 #include "message_filters/subscriber.h"
 #include "nav2_costmap_2d/costmap_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/paged_grid.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
@@ -76,8 +80,20 @@ public:
   virtual void deactivate();
   virtual void activate();
 
+  /** @brief Bytes of the dense or sparse grid and of the sensor stencils */
+  std::size_t getMemoryUsage() const override;
+
   void bufferIncomingRangeMsg(const sensor_msgs::msg::Range::SharedPtr range_message);
 
+protected:
+  /** @brief Allocate the dense grid, or size the sparse one when sparse_storage is set */
+  void initMaps(unsigned int size_x, unsigned int size_y) override;
+  void resetMaps() override;
+  /** @brief In sparse storage, cells reset to NO_INFORMATION get the prior instead */
+  bool resetOutside(
+    int x0, int y0, int xn, int yn, unsigned char value,
+    int & min_x, int & min_y, int & max_x, int & max_y) override;
+
 private:
   void updateCostmap();
   void updateCostmap(sensor_msgs::msg::Range & range_message, bool clear_sensor_cone);
@@ -92,10 +108,56 @@ private:
   inline double delta(double phi);
   inline double sensor_model(double r, double phi, double theta);
 
+  /**
+   * @brief Sensor model sampled on a grid in the sensor frame, for one range bin and field of view
+   */
+  struct SensorStencil
+  {
+    double min_x, min_y;  ///< Sensor frame coordinates of the first sample
+    double step;  ///< Spacing of the samples, half a cell
+    int size_x, size_y;
+    std::vector<double> probabilities;
+  };
+
+  /**
+   * @brief Returns the stencil of a range rounded to the resolution, building it if needed
+   *
+   * Uses max_angle_, so the field of view of the message must be set already
+   */
+  const SensorStencil & getStencil(double range, double field_of_view);
+
+  /**
+   * @brief Sensor model at a point in the sensor frame, read from a stencil
+   */
+  inline double stencil_model(
+    const SensorStencil & stencil, double r, double px, double py)
+  {
+    int ix = static_cast<int>(std::floor((px - stencil.min_x) / stencil.step + 0.5));
+    int iy = static_cast<int>(std::floor((py - stencil.min_y) / stencil.step + 0.5));
+    if (ix < 0 || iy < 0 || ix >= stencil.size_x || iy >= stencil.size_y) {
+      return sensor_model(r, std::hypot(px, py), std::atan2(py, px));
+    }
+    return stencil.probabilities[iy * stencil.size_x + ix];
+  }
+
   inline void get_deltas(double angle, double * dx, double * dy);
   inline void update_cell(
     double ox, double oy, double ot,
     double r, double nx, double ny, bool clear);
+  inline void update_cell(unsigned int x, unsigned int y, double sensor);
+
+  inline unsigned char getLayerCost(unsigned int x, unsigned int y) const
+  {
+    return sparse_storage_ ? sparse_costs_.getCost(x, y) : getCost(x, y);
+  }
+  inline void setLayerCost(unsigned int x, unsigned int y, unsigned char cost)
+  {
+    if (sparse_storage_) {
+      sparse_costs_.setCost(x, y, cost);
+    } else {
+      setCost(x, y, cost);
+    }
+  }
 
   inline double to_prob(unsigned char c)
   {
@@ -124,6 +186,14 @@ private:
   std::vector<rclcpp::Subscription<sensor_msgs::msg::Range>::SharedPtr> range_subs_;
   double min_x_, min_y_, max_x_, max_y_;
 
+  /// Stencils keyed on field of view, range bin and resolution
+  std::map<std::tuple<double, int, double>, SensorStencil> stencils_;
+
+  /// Whether the probabilities are kept in sparse_costs_ rather than the dense costmap_,
+  /// so this layer only holds memory for the pages its sensors have seen
+  bool sparse_storage_{false};
+  PagedGrid sparse_costs_;
+
   float area(int x1, int y1, int x2, int y2, int x3, int y3)
   {
     return fabs((x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2)) / 2.0);
@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_COSTMAP_2D__ROLLING_STATIC_CACHE_HPP_
+#define NAV2_COSTMAP_2D__ROLLING_STATIC_CACHE_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "tf2/LinearMath/Transform.h"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class RollingStaticCache
+ * @brief The cost of a static map at every cell of a rolling window, kept across
+ * updates so that only the cells that entered the window are transformed
+ *
+ * The cells are looked up with the transform the cache was built with for as
+ * long as no cell of the window moves by more than the tolerance under the
+ * current one, so that localization jitter does not rebuild it every cycle.
+ */
+class RollingStaticCache
+{
+public:
+  /**
+   * @param tolerance Distance a cell of the window may move before the cache is
+   * rebuilt, in cells of the finer of the window and the map
+   */
+  explicit RollingStaticCache(double tolerance = 0.25)
+  : tolerance_(tolerance) {}
+
+  /**
+   * @brief Bring the cache in line with the window and the transform, then look up
+   * the cells of the given region it lacks
+   * @param master Rolling window the cache is of
+   * @param map Static map the costs are looked up in
+   * @param transform From the frame of the window to the frame of the map
+   * @return Whether the cache was rebuilt
+   */
+  bool update(
+    const Costmap2D & master, const Costmap2D & map, const tf2::Transform & transform,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /** @brief Drop every cell, e.g. when the map changed */
+  void invalidate() {valid_ = false;}
+
+  /** @brief Whether a cell of the window, by index, lies on the map */
+  bool isInside(unsigned int index) const {return cells_[index] == INSIDE;}
+
+  /** @brief Cost of the map at a cell of the window that lies on it */
+  unsigned char getCost(unsigned int index) const {return costs_[index];}
+
+  /** @brief Transform the cells are looked up with */
+  const tf2::Transform & getTransform() const {return transform_;}
+
+  /** @brief Bytes held by the cache */
+  std::size_t getMemoryUsage() const {return costs_.capacity() + cells_.capacity();}
+
+protected:
+  enum Cell : unsigned char
+  {
+    UNKNOWN = 0,  // not looked up yet
+    OUTSIDE,  // outside of the map
+    INSIDE  // holds a cost of the map
+  };
+
+  /** @brief Whether some cell of the window moves by more than the tolerance */
+  bool movedBeyondTolerance(
+    const Costmap2D & master, const Costmap2D & map, const tf2::Transform & transform) const;
+
+  /** @brief Keep the cells still in a window that moved by whole cells */
+  void shift(const Costmap2D & master);
+
+  double tolerance_;
+  std::vector<unsigned char> costs_;
+  std::vector<unsigned char> cells_;
+  bool valid_{false};
+  tf2::Transform transform_;
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  double resolution_{0.0};
+  double origin_x_{0.0};
+  double origin_y_{0.0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__ROLLING_STATIC_CACHE_HPP_
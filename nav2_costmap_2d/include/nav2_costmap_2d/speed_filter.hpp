@@ -0,0 +1,78 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__SPEED_FILTER_HPP_
+#define NAV2_COSTMAP_2D__SPEED_FILTER_HPP_
+
+#include <mutex>
+
+#include "nav2_costmap_2d/costmap_filter.hpp"
+#include "nav2_costmap_2d/filter_mask.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class SpeedFilter
+ * @brief Keeps the speed limits of a speed mask, without changing any costs
+ *
+ * A mask cell of value v > 0 limits the speed to base + multiplier * v, in percent of the
+ * commanded speed or in m/s; cells of 0 or unknown have no limit. The limit at a point is
+ * a single cell lookup, so the controller can query it every cycle.
+ */
+class SpeedFilter : public CostmapFilter
+{
+public:
+  /// A speed limit, in percent of the commanded speed or absolute (m/s)
+  struct SpeedLimit
+  {
+    bool limited{false};
+    double value{0.0};
+    bool percentage{true};
+  };
+
+  SpeedFilter();
+
+  void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y, double * max_x, double * max_y) override;
+  void updateCosts(
+    nav2_costmap_2d::Costmap2D &, int, int, int, int) override {}
+  bool isTileSafe() override {return true;}
+  std::size_t getMemoryUsage() const override;
+
+  /**
+   * @brief Speed limit at a point of the costmap global frame, through the transform to the
+   * mask frame of the last costmap update
+   */
+  SpeedLimit getSpeedLimit(double x, double y) const;
+
+protected:
+  void initializeFilter() override;
+  void processMask(const nav_msgs::msg::OccupancyGrid & mask) override;
+
+  bool percentage_{true};
+  double base_{0.0};
+  double multiplier_{1.0};
+
+  // Guards the mask and its transform, read from the controller
+  mutable std::mutex mutex_;
+  FilterMask mask_;
+  tf2::Transform transform_;
+  bool has_transform_{false};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__SPEED_FILTER_HPP_
@@ -38,13 +38,17 @@
 #ifndef NAV2_COSTMAP_2D__STATIC_LAYER_HPP_
 #define NAV2_COSTMAP_2D__STATIC_LAYER_HPP_
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "map_msgs/msg/occupancy_grid_update.hpp"
 #include "message_filters/subscriber.h"
 #include "nav2_costmap_2d/costmap_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_costmap_2d/rolling_static_cache.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -72,10 +76,28 @@ public:
 
   virtual void matchSize();
 
+  /** @brief Bytes of the layer's costmap and of the rolling window caches */
+  std::size_t getMemoryUsage() const override;
+
+  /**
+   * @brief Changes every time the costs of the layer do, by a new map, a republished
+   * map that differs or an update
+   */
+  uint64_t getMapVersion() const
+  {
+    return map_version_.load();
+  }
+
 private:
   void getParameters();
   void processMap(const nav_msgs::msg::OccupancyGrid & new_map);
 
+  /**
+   * @brief  Applies the cells of a map with the same geometry as the current one that
+   * differ from it, and marks only their bounds for update
+   */
+  void applyMapDiff(const nav_msgs::msg::OccupancyGrid & new_map);
+
   /**
    * @brief  Callback to update the costmap's map from the map_server
    * @param new_map The map to put into the costmap. The origin of the new
@@ -112,7 +134,11 @@ private:
   bool map_received_{false};
   tf2::Duration transform_tolerance_;
   std::atomic<bool> update_in_progress_;
+  std::atomic<uint64_t> map_version_{0};
   nav_msgs::msg::OccupancyGrid::SharedPtr map_buffer_;
+
+  // Static costs of the cells of a rolling window
+  RollingStaticCache rolling_cache_;
 };
 
 }  // namespace nav2_costmap_2d
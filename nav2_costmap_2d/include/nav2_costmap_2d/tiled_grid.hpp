@@ -0,0 +1,124 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__TILED_GRID_HPP_
+#define NAV2_COSTMAP_2D__TILED_GRID_HPP_
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class TiledGrid
+ * @brief Cost storage blocked into square tiles instead of full rows
+ *
+ * Cells of a TILE_SIZE x TILE_SIZE tile are contiguous, so 2D neighbourhood
+ * walks (footprint checks, raytracing, inflation) stay inside a few cache
+ * lines on wide maps. The cell API mirrors Costmap2D's getCost, setCost,
+ * getIndex and indexToCells; getIndex returns an index into the tiled
+ * storage, not into a row-major array. Bulk loops use forEachRowSegment(),
+ * which visits a row as contiguous per-tile runs.
+ */
+class TiledGrid
+{
+public:
+  static constexpr unsigned int TILE_BITS = 6;
+  static constexpr unsigned int TILE_SIZE = 1u << TILE_BITS;
+  static constexpr unsigned int TILE_MASK = TILE_SIZE - 1;
+  static constexpr unsigned int TILE_AREA = TILE_SIZE * TILE_SIZE;
+
+  TiledGrid()
+  : size_x_(0), size_y_(0), tiles_x_(0) {}
+
+  TiledGrid(unsigned int size_x, unsigned int size_y, unsigned char default_value = 0);
+
+  /** @brief Resize the grid and set every cell to default_value */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned char default_value = 0);
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+
+  /** @brief Storage index of cell (mx, my) */
+  inline unsigned int getIndex(unsigned int mx, unsigned int my) const
+  {
+    return ((((my >> TILE_BITS) * tiles_x_) + (mx >> TILE_BITS)) << (2 * TILE_BITS)) |
+           ((my & TILE_MASK) << TILE_BITS) | (mx & TILE_MASK);
+  }
+
+  /** @brief Inverse of getIndex() */
+  inline void indexToCells(unsigned int index, unsigned int & mx, unsigned int & my) const
+  {
+    const unsigned int tile = index >> (2 * TILE_BITS);
+    mx = ((tile % tiles_x_) << TILE_BITS) | (index & TILE_MASK);
+    my = ((tile / tiles_x_) << TILE_BITS) | ((index >> TILE_BITS) & TILE_MASK);
+  }
+
+  inline unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    return data_[getIndex(mx, my)];
+  }
+
+  inline unsigned char getCost(unsigned int index) const
+  {
+    return data_[index];
+  }
+
+  inline void setCost(unsigned int mx, unsigned int my, unsigned char cost)
+  {
+    data_[getIndex(mx, my)] = cost;
+  }
+
+  /**
+   * @brief Visit cells [x0, xn) of row y as contiguous runs
+   * @param fn Called as fn(unsigned char * run, unsigned int x, unsigned int length)
+   * for each run, in increasing x
+   */
+  template<typename F>
+  void forEachRowSegment(unsigned int y, unsigned int x0, unsigned int xn, F && fn)
+  {
+    while (x0 < xn) {
+      const unsigned int length = std::min(xn, (x0 | TILE_MASK) + 1) - x0;
+      fn(&data_[getIndex(x0, y)], x0, length);
+      x0 += length;
+    }
+  }
+
+  /** @copydoc forEachRowSegment */
+  template<typename F>
+  void forEachRowSegment(unsigned int y, unsigned int x0, unsigned int xn, F && fn) const
+  {
+    while (x0 < xn) {
+      const unsigned int length = std::min(xn, (x0 | TILE_MASK) + 1) - x0;
+      fn(&data_[getIndex(x0, y)], x0, length);
+      x0 += length;
+    }
+  }
+
+  /** @brief Fill the grid from a size_x * size_y row-major array, e.g. Costmap2D::getCharMap() */
+  void copyFromRowMajor(const unsigned char * costs);
+
+  /** @brief Write the grid out as a size_x * size_y row-major array */
+  void copyToRowMajor(unsigned char * costs) const;
+
+private:
+  unsigned int size_x_, size_y_;
+  unsigned int tiles_x_;
+  std::vector<unsigned char> data_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__TILED_GRID_HPP_
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_COSTMAP_2D__VOXEL_GRID_UPDATES_HPP_
+#define NAV2_COSTMAP_2D__VOXEL_GRID_UPDATES_HPP_
+
+#include <cstddef>
+
+#include "nav2_msgs/msg/voxel_grid.hpp"
+#include "nav2_msgs/msg/voxel_grid_update.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Run-length encode the columns of an update, moving them from data to the runs
+ */
+void compressVoxelGridUpdate(nav2_msgs::msg::VoxelGridUpdate & update);
+
+/**
+ * @brief Fill the rectangle and columns of an update from a voxel grid
+ * @param grid A nav2_voxel_grid grid, dense or sparse
+ * @param x, y, width, height Rectangle of the grid to send, in cells
+ * @param compress Run-length encode the columns
+ * @param update The update to fill, its header and origin are left to the caller
+ */
+template<class Grid>
+void fillVoxelGridUpdate(
+  const Grid & grid, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+  bool compress, nav2_msgs::msg::VoxelGridUpdate & update)
+{
+  update.x = x;
+  update.y = y;
+  update.width = width;
+  update.height = height;
+  update.words_per_column = grid.wordsPerColumn();
+  update.data.resize(static_cast<std::size_t>(width) * height * update.words_per_column);
+  grid.copyColumnWords(x, y, width, height, update.data.data());
+  update.run_values.clear();
+  update.run_lengths.clear();
+  if (compress) {
+    compressVoxelGridUpdate(update);
+  }
+}
+
+/**
+ * @brief Apply an update to the grid it follows
+ *
+ * The columns first move by the whole cells the origin moved, the columns the
+ * window moved onto becoming unknown, then the columns of the update are
+ * copied in.
+ * @return false, leaving the grid untouched, if the update does not fit it
+ */
+bool applyVoxelGridUpdate(
+  const nav2_msgs::msg::VoxelGridUpdate & update, nav2_msgs::msg::VoxelGrid & grid);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__VOXEL_GRID_UPDATES_HPP_
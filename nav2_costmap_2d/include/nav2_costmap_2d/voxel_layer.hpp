@@ -38,12 +38,15 @@
 #ifndef NAV2_COSTMAP_2D__VOXEL_LAYER_HPP_
 #define NAV2_COSTMAP_2D__VOXEL_LAYER_HPP_
 
+#include <vector>
+
 #include <rclcpp/rclcpp.hpp>
 #include <nav2_costmap_2d/layer.hpp>
 #include <nav2_costmap_2d/layered_costmap.hpp>
 #include <nav2_costmap_2d/observation_buffer.hpp>
 #include <nav_msgs/msg/occupancy_grid.hpp>
 #include <nav2_msgs/msg/voxel_grid.hpp>
+#include <nav2_msgs/msg/voxel_grid_update.hpp>
 #include <sensor_msgs/msg/laser_scan.hpp>
 #include <laser_geometry/laser_geometry.hpp>
 #include <sensor_msgs/msg/point_cloud.hpp>
@@ -51,6 +54,7 @@
 #include <message_filters/subscriber.h>
 #include <nav2_costmap_2d/obstacle_layer.hpp>
 #include <nav2_voxel_grid/voxel_grid.hpp>
+#include <nav2_voxel_grid/sparse_voxel_grid.hpp>
 
 namespace nav2_costmap_2d
 {
@@ -59,7 +63,11 @@ class VoxelLayer : public ObstacleLayer
 {
 public:
   VoxelLayer()
-  : voxel_grid_(0, 0, 0)
+  : voxel_grid_(0, 0, 0), voxel_grid_64_(0, 0, 0)
+#ifdef __SIZEOF_INT128__
+    , voxel_grid_128_(0, 0, 0)
+#endif
+    , sparse_voxel_grid_(0, 0, 0)
   {
     costmap_ = NULL;  // this is the unsigned char* member of parent class's parent class Costmap2D
   }
@@ -81,9 +89,15 @@ public:
   virtual void matchSize();
   virtual void reset();
 
+  /** @brief Bytes of the layer's costmap and of its voxel grid */
+  std::size_t getMemoryUsage() const override;
+
 protected:
   virtual void resetMaps();
 
+  /** @brief updateBounds() marks and clears the voxel grid from the observations themselves */
+  bool canRasterizeObservations() const override {return false;}
+
 private:
   void reconfigureCB();
   void clearNonLethal(double wx, double wy, double w_size_x, double w_size_y, bool clear_no_info);
@@ -93,12 +107,87 @@ private:
     double * max_x,
     double * max_y);
 
+  /**
+   * @brief Publishes the voxel grid, as the columns that changed in the bounds of this
+   * cycle's voxel changes when an update is enough
+   */
+  void publishVoxelGrid(double min_x, double min_y, double max_x, double max_y);
+
   bool publish_voxel_;
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::VoxelGrid>::SharedPtr voxel_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::VoxelGridUpdate>::SharedPtr
+    voxel_update_pub_;
+  // 0 publishes every grid whole
+  rclcpp::Duration voxel_keyframe_interval_{0, 0};
+  rclcpp::Time last_voxel_keyframe_{0, 0, RCL_ROS_TIME};
+  // set when the grid changed outside of updateBounds(), e.g. on reset
+  bool voxel_keyframe_due_{true};
+  bool compress_voxel_updates_;
+  // origin of the last grid or update published, the subscribers shift their grids with it
+  double published_origin_x_{0.0}, published_origin_y_{0.0};
+  // only the narrowest grid that holds size_z_ levels is ever sized, see withVoxelGrid()
   nav2_voxel_grid::VoxelGrid voxel_grid_;
+  nav2_voxel_grid::VoxelGrid64 voxel_grid_64_;
+#ifdef __SIZEOF_INT128__
+  nav2_voxel_grid::VoxelGrid128 voxel_grid_128_;
+#endif
+  // replaces the dense grids with sparse_voxel_grid
+  bool sparse_{false};
+  nav2_voxel_grid::SparseVoxelGrid sparse_voxel_grid_;
   double z_resolution_, origin_z_;
   int unknown_threshold_, mark_threshold_, size_z_;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr clearing_endpoints_pub_;
+  rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr voxel_marked_cloud_pub_;
+  rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr voxel_unknown_cloud_pub_;
+  /// Scratch end points, in grid coordinates, of the rays of one clearing observation
+  std::vector<nav2_voxel_grid::RayEnd> clearing_ends_;
+
+  /**
+   * @brief Calls fn with the voxel grid in use, the sparse one or the narrowest dense one
+   * that holds size_z_ levels
+   */
+  template<class Fn>
+  inline void withVoxelGrid(Fn fn)
+  {
+    if (sparse_) {
+      fn(sparse_voxel_grid_);
+    } else if (size_z_ <= static_cast<int>(nav2_voxel_grid::VoxelGrid::MAX_SIZE_Z)) {
+      fn(voxel_grid_);
+#ifdef __SIZEOF_INT128__
+    } else if (size_z_ > static_cast<int>(nav2_voxel_grid::VoxelGrid64::MAX_SIZE_Z)) {
+      fn(voxel_grid_128_);
+#endif
+    } else {
+      fn(voxel_grid_64_);
+    }
+  }
+
+  /**
+   * @brief Moves the columns of a dense grid with the window, see updateOrigin()
+   */
+  template<class Grid>
+  void shiftVoxelGrid(Grid & grid, int cell_ox, int cell_oy)
+  {
+    shiftMapRegion<typename Grid::Column>(
+      grid.getData(), cell_ox, cell_oy, grid.unknownColumn());
+  }
+
+  void shiftVoxelGrid(nav2_voxel_grid::SparseVoxelGrid & grid, int cell_ox, int cell_oy)
+  {
+    grid.shift(cell_ox, cell_oy);
+  }
+
+  /**
+   * @brief Publishes the voxels of a status as a cloud of their centers, if subscribed
+   */
+  void publishVoxelCloud(
+    const rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr & publisher,
+    nav2_voxel_grid::VoxelStatus status);
+
+  /**
+   * @brief Number of levels the columns of the voxel grid in use hold
+   */
+  unsigned int maxSizeZ();
 
   inline bool worldToMap3DFloat(
     double wx, double wy, double wz, double & mx, double & my,
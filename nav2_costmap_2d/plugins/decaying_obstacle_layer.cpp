@@ -0,0 +1,176 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/decaying_obstacle_layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::DecayingObstacleLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+// Stamps are 10 ms ticks, which wrap around after 655 s
+constexpr double kTickSeconds = 0.01;
+// Ages are only told apart up to half of the wrap around
+constexpr double kMaxDecayTime = 300.0;
+
+}  // namespace
+
+void DecayingObstacleLayer::onInitialize()
+{
+  ObstacleLayer::onInitialize();
+
+  declareParameter("decay_time", rclcpp::ParameterValue(2.0));
+  double decay_time = 2.0;
+  node_->get_parameter(name_ + "." + "decay_time", decay_time);
+  if (decay_time <= 0.0 || decay_time > kMaxDecayTime) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: decay_time %.2f is outside of (0, %.0f] s, clamping it",
+      name_.c_str(), decay_time, kMaxDecayTime);
+    decay_time = std::min(std::max(decay_time, kTickSeconds), kMaxDecayTime);
+  }
+  decay_ticks_ = static_cast<uint16_t>(std::ceil(decay_time / kTickSeconds));
+
+  // ObstacleLayer::onInitialize() sized the costmap without calling matchSize() virtually
+  stamps_.assign(static_cast<std::size_t>(size_x_) * size_y_, 0);
+}
+
+uint16_t DecayingObstacleLayer::now() const
+{
+  return static_cast<uint16_t>(node_->now().nanoseconds() / 10000000);
+}
+
+void DecayingObstacleLayer::updateBounds(
+  double robot_x, double robot_y, double robot_yaw, double * min_x,
+  double * min_y, double * max_x, double * max_y)
+{
+  if (rolling_window_) {
+    updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
+  }
+  if (!enabled_) {
+    return;
+  }
+  useExtraBounds(min_x, min_y, max_x, max_y);
+
+  bool current = true;
+  std::vector<Observation> observations, clearing_observations;
+  current = current && getMarkingObservations(observations);
+  current = current && getClearingObservations(clearing_observations);
+  current_ = current;
+
+  for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
+    raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
+  }
+
+  // mark the new obstacles, stamped with the current time
+  const CellStamps stamps{stamps_.data(), now()};
+  MarkedCells marked;
+  for (const Observation & obs : observations) {
+    if (!markObservation(obs, max_obstacle_height_, *this, marked, &stamps)) {
+      RCLCPP_WARN(
+        node_->get_logger(), "%s: an observation cloud has no float32 x, y and z fields",
+        name_.c_str());
+    }
+  }
+  if (!marked.empty()) {
+    touchCells(marked, min_x, min_y, max_x, max_y);
+    live_.add(marked.min_x, marked.min_y);
+    live_.add(marked.max_x, marked.max_y);
+  }
+
+  decayObstacles(stamps.now, min_x, min_y, max_x, max_y);
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+void DecayingObstacleLayer::decayObstacles(
+  uint16_t stamp, double * min_x, double * min_y, double * max_x,
+  double * max_y)
+{
+  if (live_.empty()) {
+    return;
+  }
+
+  MarkedCells live, expired;
+  for (int y = live_.min_y; y <= live_.max_y; ++y) {
+    const unsigned int row = getIndex(0, y);
+    for (int x = live_.min_x; x <= live_.max_x; ++x) {
+      if (costmap_[row + x] != LETHAL_OBSTACLE) {
+        continue;
+      }
+      // the age wraps around with the stamps
+      if (static_cast<uint16_t>(stamp - stamps_[row + x]) >= decay_ticks_) {
+        costmap_[row + x] = FREE_SPACE;
+        expired.add(x, y);
+      } else {
+        live.add(x, y);
+      }
+    }
+  }
+  live_ = live;
+
+  if (!expired.empty()) {
+    touchCells(expired, min_x, min_y, max_x, max_y);
+  }
+}
+
+void DecayingObstacleLayer::updateOrigin(double new_origin_x, double new_origin_y)
+{
+  // the same cell shift as Costmap2D::updateOrigin()
+  const int cell_ox = static_cast<int>((new_origin_x - origin_x_) / resolution_);
+  const int cell_oy = static_cast<int>((new_origin_y - origin_y_) / resolution_);
+  {
+    std::unique_lock<mutex_t> lock(*access_);
+    shiftMapRegion(stamps_.data(), cell_ox, cell_oy, static_cast<uint16_t>(0));
+  }
+  ObstacleLayer::updateOrigin(new_origin_x, new_origin_y);
+
+  if (!live_.empty()) {
+    live_.min_x = std::max(live_.min_x - cell_ox, 0);
+    live_.min_y = std::max(live_.min_y - cell_oy, 0);
+    live_.max_x = std::min(live_.max_x - cell_ox, static_cast<int>(size_x_) - 1);
+    live_.max_y = std::min(live_.max_y - cell_oy, static_cast<int>(size_y_) - 1);
+    if (live_.min_x > live_.max_x || live_.min_y > live_.max_y) {
+      live_ = MarkedCells();
+    }
+  }
+}
+
+void DecayingObstacleLayer::matchSize()
+{
+  ObstacleLayer::matchSize();
+  stamps_.assign(static_cast<std::size_t>(size_x_) * size_y_, 0);
+  live_ = MarkedCells();
+}
+
+void DecayingObstacleLayer::reset()
+{
+  ObstacleLayer::reset();
+  live_ = MarkedCells();
+}
+
+std::size_t DecayingObstacleLayer::getMemoryUsage() const
+{
+  return ObstacleLayer::getMemoryUsage() + stamps_.size() * sizeof(uint16_t);
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,192 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/distance_field_layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/distance_transform.hpp"
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::DistanceFieldLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+DistanceFieldLayer::DistanceFieldLayer()
+: max_distance_(2.0),
+  unknown_is_obstacle_(false),
+  size_x_(0),
+  size_y_(0),
+  origin_x_(0.0),
+  origin_y_(0.0),
+  field_valid_(false)
+{
+}
+
+void
+DistanceFieldLayer::onInitialize()
+{
+  declareParameter("enabled", rclcpp::ParameterValue(true));
+  declareParameter("max_distance", rclcpp::ParameterValue(2.0));
+  declareParameter("unknown_is_obstacle", rclcpp::ParameterValue(false));
+  declareParameter("threads", rclcpp::ParameterValue(1));
+
+  node_->get_parameter(name_ + "." + "enabled", enabled_);
+  node_->get_parameter(name_ + "." + "max_distance", max_distance_);
+  node_->get_parameter(name_ + "." + "unknown_is_obstacle", unknown_is_obstacle_);
+
+  int threads = 1;
+  node_->get_parameter(name_ + "." + "threads", threads);
+  if (threads > 1) {
+    pool_ = std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::COSTMAP, threads);
+  }
+
+  current_ = true;
+  matchSize();
+}
+
+void
+DistanceFieldLayer::matchSize()
+{
+  Costmap2D * costmap = layered_costmap_->getCostmap();
+  size_x_ = costmap->getSizeInCellsX();
+  size_y_ = costmap->getSizeInCellsY();
+  distances_.assign(size_x_ * size_y_, getMaxDistance());
+  field_valid_ = false;
+}
+
+void
+DistanceFieldLayer::reset()
+{
+  matchSize();
+}
+
+std::size_t
+DistanceFieldLayer::getMemoryUsage() const
+{
+  return (distances_.capacity() + squared_distances_.capacity()) * sizeof(float);
+}
+
+void
+DistanceFieldLayer::updateBounds(
+  double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, double * /*min_x*/,
+  double * /*min_y*/, double * /*max_x*/, double * /*max_y*/)
+{
+  // Nothing is written to the master grid, the field follows the other layers' bounds
+}
+
+void
+DistanceFieldLayer::updateCosts(
+  nav2_costmap_2d::Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  if (!enabled_) {
+    return;
+  }
+
+  if (master_grid.getSizeInCellsX() != size_x_ || master_grid.getSizeInCellsY() != size_y_) {
+    matchSize();
+  }
+
+  // Rolling windows shift the master grid, start over rather than shifting the field
+  if (master_grid.getOriginX() != origin_x_ || master_grid.getOriginY() != origin_y_) {
+    origin_x_ = master_grid.getOriginX();
+    origin_y_ = master_grid.getOriginY();
+    field_valid_ = false;
+  }
+
+  const int size_x = static_cast<int>(size_x_);
+  const int size_y = static_cast<int>(size_y_);
+  const double resolution = master_grid.getResolution();
+
+  // Cells whose distance may have changed, and the cells whose obstacles they can see
+  int out_min_i = 0, out_min_j = 0, out_max_i = size_x, out_max_j = size_y;
+  int in_min_i = 0, in_min_j = 0, in_max_i = size_x, in_max_j = size_y;
+  if (field_valid_ && max_distance_ > 0.0) {
+    if (max_i <= min_i || max_j <= min_j) {
+      return;
+    }
+    const int radius = static_cast<int>(std::ceil(max_distance_ / resolution));
+    out_min_i = std::max(min_i - radius, 0);
+    out_min_j = std::max(min_j - radius, 0);
+    out_max_i = std::min(max_i + radius, size_x);
+    out_max_j = std::min(max_j + radius, size_y);
+    in_min_i = std::max(out_min_i - radius, 0);
+    in_min_j = std::max(out_min_j - radius, 0);
+    in_max_i = std::min(out_max_i + radius, size_x);
+    in_max_j = std::min(out_max_j + radius, size_y);
+  }
+  if (out_max_i <= out_min_i || out_max_j <= out_min_j) {
+    return;
+  }
+
+  const unsigned int in_width = in_max_i - in_min_i;
+  squared_distances_.resize(in_width * (in_max_j - in_min_j));
+  squaredDistanceTransform(
+    master_grid.getCharMap(), size_x_, in_min_i, in_min_j, in_max_i, in_max_j,
+    unknown_is_obstacle_, squared_distances_.data(), pool_.get());
+
+  const float max_distance = getMaxDistance();
+  for (int j = out_min_j; j < out_max_j; ++j) {
+    const float * squared = squared_distances_.data() + (j - in_min_j) * in_width +
+      (out_min_i - in_min_i);
+    float * distance = distances_.data() + j * size_x_;
+    for (int i = out_min_i; i < out_max_i; ++i, ++squared) {
+      distance[i] = *squared >= DISTANCE_TRANSFORM_INF ? max_distance :
+        std::min(static_cast<float>(std::sqrt(*squared) * resolution), max_distance);
+    }
+  }
+
+  field_valid_ = true;
+}
+
+bool
+DistanceFieldLayer::getDistanceAtWorld(double wx, double wy, float & distance) const
+{
+  unsigned int mx, my;
+  if (!layered_costmap_->getCostmap()->worldToMap(wx, wy, mx, my) ||
+    mx >= size_x_ || my >= size_y_)
+  {
+    return false;
+  }
+  distance = getDistance(mx, my);
+  return true;
+}
+
+float
+DistanceFieldLayer::getMaxDistance() const
+{
+  return max_distance_ > 0.0 ? static_cast<float>(max_distance_) :
+         std::numeric_limits<float>::infinity();
+}
+
+std::shared_ptr<DistanceFieldLayer>
+DistanceFieldLayer::find(LayeredCostmap & layered_costmap)
+{
+  for (auto & plugin : *layered_costmap.getPlugins()) {
+    auto layer = std::dynamic_pointer_cast<DistanceFieldLayer>(plugin);
+    if (layer) {
+      return layer;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace nav2_costmap_2d
@@ -37,14 +37,18 @@
  *********************************************************************/
 #include "nav2_costmap_2d/inflation_layer.hpp"
 
+#include <cstdlib>
 #include <limits>
 #include <map>
 #include <vector>
 #include <algorithm>
 #include <utility>
 
+#include "nav2_costmap_2d/combination_kernels.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
+#include "nav2_costmap_2d/distance_transform.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_costmap_2d/static_layer.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "rclcpp/parameter_events_filter.hpp"
 
@@ -57,6 +61,8 @@ using nav2_costmap_2d::NO_INFORMATION;
 namespace nav2_costmap_2d
 {
 
+constexpr unsigned int InflationLayer::NO_SOURCE;
+
 InflationLayer::InflationLayer()
 : inflation_radius_(0),
   inscribed_radius_(0),
@@ -69,7 +75,15 @@ InflationLayer::InflationLayer()
   last_min_x_(std::numeric_limits<double>::lowest()),
   last_min_y_(std::numeric_limits<double>::lowest()),
   last_max_x_(std::numeric_limits<double>::max()),
-  last_max_y_(std::numeric_limits<double>::max())
+  last_max_y_(std::numeric_limits<double>::max()),
+  incremental_inflation_(false),
+  field_valid_(false),
+  field_origin_x_(0.0),
+  field_origin_y_(0.0),
+  distance_transform_inflation_(false),
+  kernel_inflation_(false),
+  static_inflation_(false),
+  static_base_valid_(false)
 {
   access_ = new mutex_t();
 }
@@ -87,15 +101,57 @@ InflationLayer::onInitialize()
   declareParameter("cost_scaling_factor", rclcpp::ParameterValue(10.0));
   declareParameter("inflate_unknown", rclcpp::ParameterValue(false));
   declareParameter("inflate_around_unknown", rclcpp::ParameterValue(false));
+  declareParameter("incremental_inflation", rclcpp::ParameterValue(false));
+  declareParameter("distance_transform_inflation", rclcpp::ParameterValue(false));
+  declareParameter("distance_transform_threads", rclcpp::ParameterValue(1));
+  declareParameter("kernel_inflation", rclcpp::ParameterValue(false));
+  declareParameter("static_inflation", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "inflation_radius", inflation_radius_);
   node_->get_parameter(name_ + "." + "cost_scaling_factor", cost_scaling_factor_);
   node_->get_parameter(name_ + "." + "inflate_unknown", inflate_unknown_);
   node_->get_parameter(name_ + "." + "inflate_around_unknown", inflate_around_unknown_);
+  node_->get_parameter(name_ + "." + "incremental_inflation", incremental_inflation_);
+  node_->get_parameter(
+    name_ + "." + "distance_transform_inflation", distance_transform_inflation_);
+  node_->get_parameter(name_ + "." + "kernel_inflation", kernel_inflation_);
+  node_->get_parameter(name_ + "." + "static_inflation", static_inflation_);
+
+  int threads = 1;
+  node_->get_parameter(name_ + "." + "distance_transform_threads", threads);
+  if (distance_transform_inflation_ && threads > 1) {
+    transform_pool_ = std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::COSTMAP, threads);
+  }
+
+  // Only the static layers already written into the master grid when this one runs
+  static_layers_.clear();
+  static_inflation_ = static_inflation_ && !incremental_inflation_ &&
+    !distance_transform_inflation_ && !kernel_inflation_;
+  if (static_inflation_) {
+    for (const auto & plugin : *layered_costmap_->getPlugins()) {
+      if (plugin.get() == this) {
+        break;
+      }
+      auto static_layer = std::dynamic_pointer_cast<StaticLayer>(plugin);
+      if (static_layer) {
+        static_layers_.push_back(static_layer);
+      }
+    }
+    if (static_layers_.empty() || layered_costmap_->isRolling()) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("nav2_costmap_2d"),
+        "InflationLayer: static_inflation needs a static layer before it in a costmap that "
+        "does not roll, inflating all obstacles every cycle");
+      static_layers_.clear();
+      static_inflation_ = false;
+    }
+  }
 
   current_ = true;
   seen_.clear();
+  seen_epoch_ = 0;
   cached_distances_.clear();
   cached_costs_.clear();
   need_reinflation_ = false;
@@ -110,7 +166,28 @@ InflationLayer::matchSize()
   resolution_ = costmap->getResolution();
   cell_inflation_radius_ = cellDistance(inflation_radius_);
   computeCaches();
-  seen_ = std::vector<bool>(costmap->getSizeInCellsX() * costmap->getSizeInCellsY(), false);
+  seen_.assign(costmap->getSizeInCellsX() * costmap->getSizeInCellsY(), 0);
+  seen_epoch_ = 0;
+  invalidateDistanceField();
+  static_base_valid_ = false;
+}
+
+std::size_t
+InflationLayer::getMemoryUsage() const
+{
+  std::size_t bytes = seen_.capacity() * sizeof(uint16_t);
+  bytes += (field_is_source_.capacity() + field_to_raise_.capacity()) / 8;
+  bytes += field_source_.capacity() * sizeof(unsigned int) + field_cost_.capacity();
+  bytes += cached_costs_.capacity() + cached_distances_.capacity() * sizeof(double);
+  bytes += squared_distance_costs_.capacity() + cost_kernel_.capacity();
+  bytes += static_base_.capacity() + tile_sources_.capacity();
+  for (const auto & row : distance_matrix_) {
+    bytes += row.capacity() * sizeof(int);
+  }
+  for (const auto & level : inflation_cells_) {
+    bytes += level.capacity() * sizeof(CellData);
+  }
+  return bytes;
 }
 
 void
@@ -151,6 +228,8 @@ InflationLayer::onFootprintChanged()
   inscribed_radius_ = layered_costmap_->getInscribedRadius();
   cell_inflation_radius_ = cellDistance(inflation_radius_);
   computeCaches();
+  invalidateDistanceField();
+  static_base_valid_ = false;
   need_reinflation_ = true;
 
   RCLCPP_DEBUG(
@@ -178,6 +257,26 @@ InflationLayer::updateCosts(
       !dist.empty(), "The inflation list must be empty at the beginning of inflation");
   }
 
+  if (incremental_inflation_) {
+    updateCostsIncremental(master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
+
+  // Serially the window is written once all of its obstacles are found, so it reads them
+  // from the master itself
+  const SourceWindow master_sources{
+    master_grid.getCharMap(), 0, 0, master_grid.getSizeInCellsX()};
+  if (distance_transform_inflation_) {
+    updateCostsDistanceTransform(
+      master_grid, min_i, min_j, max_i, max_j, master_sources, transform_pool_.get());
+    return;
+  }
+
+  if (kernel_inflation_) {
+    updateCostsKernel(master_grid, min_i, min_j, max_i, max_j, master_sources);
+    return;
+  }
+
   unsigned char * master_array = master_grid.getCharMap();
   unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
 
@@ -185,10 +284,14 @@ InflationLayer::updateCosts(
     RCLCPP_WARN(
       rclcpp::get_logger(
         "nav2_costmap_2d"), "InflationLayer::updateCosts(): seen_ vector size is wrong");
-    seen_ = std::vector<bool>(size_x * size_y, false);
+    seen_.assign(size_x * size_y, 0);
+    seen_epoch_ = 0;
   }
 
-  std::fill(begin(seen_), end(seen_), false);
+  // The static obstacles are left to the base, built before the seen flags are reset
+  const bool split = updateStaticBase(master_grid);
+
+  resetSeen();
 
   // We need to include in the inflation cells outside the bounding
   // box min_i...max_j, by the amount cell_inflation_radius_.  Cells
@@ -215,12 +318,26 @@ InflationLayer::updateCosts(
     for (int i = min_i; i < max_i; i++) {
       int index = static_cast<int>(master_grid.getIndex(i, j));
       unsigned char cost = master_array[index];
-      if (cost == LETHAL_OBSTACLE || (inflate_around_unknown_ && cost == NO_INFORMATION)) {
+      if ((cost == LETHAL_OBSTACLE && !(split && static_base_[index] == LETHAL_OBSTACLE)) ||
+        (inflate_around_unknown_ && cost == NO_INFORMATION))
+      {
         obs_bin.emplace_back(index, i, j, i, j);
       }
     }
   }
 
+  // After the seeds, the base turns unknown cells into known ones
+  if (split) {
+    applyStaticBase(master_array, size_x, min_i, min_j, max_i, max_j);
+  }
+
+  propagateInflation(master_array, size_x, size_y);
+}
+
+void
+InflationLayer::propagateInflation(
+  unsigned char * costs, unsigned int size_x, unsigned int size_y)
+{
   // Process cells by increasing distance; new cells are appended to the
   // corresponding distance bin, so they
   // can overtake previously inserted but farther away cells
@@ -232,11 +349,11 @@ InflationLayer::updateCosts(
       unsigned int index = dist_bin[i].index_;
 
       // ignore if already visited
-      if (seen_[index]) {
+      if (seen_[index] == seen_epoch_) {
         continue;
       }
 
-      seen_[index] = true;
+      seen_[index] = seen_epoch_;
 
       unsigned int mx = dist_bin[i].x_;
       unsigned int my = dist_bin[i].y_;
@@ -245,13 +362,13 @@ InflationLayer::updateCosts(
 
       // assign the cost associated with the distance from an obstacle to the cell
       unsigned char cost = costLookup(mx, my, sx, sy);
-      unsigned char old_cost = master_array[index];
+      unsigned char old_cost = costs[index];
       if (old_cost == NO_INFORMATION &&
         (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
       {
-        master_array[index] = cost;
+        costs[index] = cost;
       } else {
-        master_array[index] = std::max(old_cost, cost);
+        costs[index] = std::max(old_cost, cost);
       }
 
       // attempt to put the neighbors of the current cell onto the inflation list
@@ -270,9 +387,239 @@ InflationLayer::updateCosts(
     }
   }
 
+  // Keeping their capacity, bins grown by a cycle don't grow again
   for (auto & dist : inflation_cells_) {
     dist.clear();
-    dist.reserve(200);
+  }
+}
+
+void
+InflationLayer::resetSeen()
+{
+  // Only once every 65535 resets is the whole map cleared, the marks of
+  // older epochs otherwise all read as not seen
+  if (++seen_epoch_ == 0) {
+    std::fill(begin(seen_), end(seen_), 0);
+    seen_epoch_ = 1;
+  }
+}
+
+bool
+InflationLayer::updateStaticBase(const nav2_costmap_2d::Costmap2D & master_grid)
+{
+  if (static_layers_.empty()) {
+    return false;
+  }
+
+  const unsigned int size_x = master_grid.getSizeInCellsX();
+  const unsigned int size_y = master_grid.getSizeInCellsY();
+  std::vector<uint64_t> versions;
+  for (const auto & layer : static_layers_) {
+    if (!layer->isEnabled()) {
+      continue;
+    }
+    // A map not matching the master yet, e.g. before the first one arrives
+    if (layer->getSizeInCellsX() != size_x || layer->getSizeInCellsY() != size_y) {
+      return false;
+    }
+    versions.push_back(layer->getMapVersion());
+  }
+  if (static_base_valid_ && versions == static_versions_) {
+    return true;
+  }
+
+  // A whole map to inflate, as often as the maps change, in place of every cycle
+  static_base_.assign(size_x * size_y, FREE_SPACE);
+  resetSeen();
+  versions.clear();
+  auto & obs_bin = inflation_cells_[0];
+  for (const auto & layer : static_layers_) {
+    if (!layer->isEnabled()) {
+      continue;
+    }
+    std::lock_guard<Costmap2D::mutex_t> guard(*layer->getMutex());
+    versions.push_back(layer->getMapVersion());
+    const unsigned char * layer_costs = layer->getCharMap();
+    unsigned int index = 0;
+    for (unsigned int j = 0; j < size_y; ++j) {
+      for (unsigned int i = 0; i < size_x; ++i, ++index) {
+        if (layer_costs[index] == LETHAL_OBSTACLE) {
+          obs_bin.emplace_back(index, i, j, i, j);
+        }
+      }
+    }
+  }
+  propagateInflation(static_base_.data(), size_x, size_y);
+
+  static_versions_.swap(versions);
+  static_base_valid_ = true;
+  return true;
+}
+
+void
+InflationLayer::applyStaticBase(
+  unsigned char * master_array, unsigned int size_x,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  const unsigned char unknown_threshold =
+    inflate_unknown_ ? FREE_SPACE + 1 : INSCRIBED_INFLATED_OBSTACLE;
+  for (int j = min_j; j < max_j; ++j) {
+    unsigned char * master_row = master_array + j * size_x;
+    const unsigned char * base_row = static_base_.data() + j * size_x;
+    for (int i = min_i; i < max_i; ++i) {
+      const unsigned char old_cost = master_row[i];
+      const unsigned char cost = base_row[i];
+      if (old_cost == NO_INFORMATION) {
+        if (cost >= unknown_threshold) {
+          master_row[i] = cost;
+        }
+      } else if (cost > old_cost) {
+        master_row[i] = cost;
+      }
+    }
+  }
+}
+
+void
+InflationLayer::prepareTiles(
+  const nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i, int max_j)
+{
+  if (!enabled_ || (cell_inflation_radius_ == 0)) {
+    return;
+  }
+
+  // The tiles inflate from the obstacles as they are before any of them writes, as
+  // updateCosts() does, e.g. unknown cells that a tile fills in still inflate the next one
+  const int size_x = static_cast<int>(master_grid.getSizeInCellsX());
+  const int size_y = static_cast<int>(master_grid.getSizeInCellsY());
+  const int r = static_cast<int>(cell_inflation_radius_);
+  const int w_min_i = std::max(0, min_i - r);
+  const int w_min_j = std::max(0, min_j - r);
+  const int w_max_i = std::max(w_min_i, std::min(size_x, max_i + r));
+  const int w_max_j = std::max(w_min_j, std::min(size_y, max_j + r));
+  const unsigned int w_size_x = w_max_i - w_min_i;
+
+  tile_sources_.resize(static_cast<std::size_t>(w_size_x) * (w_max_j - w_min_j));
+  const unsigned char * master_array = master_grid.getCharMap();
+  for (int j = w_min_j; j < w_max_j; ++j) {
+    std::copy_n(
+      master_array + master_grid.getIndex(w_min_i, j), w_size_x,
+      tile_sources_.data() + static_cast<std::size_t>(j - w_min_j) * w_size_x);
+  }
+  tile_window_ = SourceWindow{tile_sources_.data(), w_min_i, w_min_j, w_size_x};
+}
+
+void
+InflationLayer::updateCostsInTile(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i, int max_j)
+{
+  // No lock on the layer mutex: the caches are only rebuilt on footprint or size
+  // changes, which LayeredCostmap serializes with the update, so tiles share them
+  if (!enabled_ || (cell_inflation_radius_ == 0)) {
+    return;
+  }
+
+  // The tiles already run in parallel, the transform of each stays on its thread
+  if (distance_transform_inflation_) {
+    updateCostsDistanceTransform(master_grid, min_i, min_j, max_i, max_j, tile_window_, nullptr);
+    return;
+  }
+  if (kernel_inflation_) {
+    updateCostsKernel(master_grid, min_i, min_j, max_i, max_j, tile_window_);
+    return;
+  }
+
+  unsigned char * master_array = master_grid.getCharMap();
+  unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+
+  // Obstacles up to cell_inflation_radius_ outside the tile still reach into it
+  const int r = static_cast<int>(cell_inflation_radius_);
+  const int w_min_i = std::max(0, min_i - r);
+  const int w_min_j = std::max(0, min_j - r);
+  const int w_max_i = std::min(static_cast<int>(size_x), max_i + r);
+  const int w_max_j = std::min(static_cast<int>(size_y), max_j + r);
+  const unsigned int w_size_x = w_max_i - w_min_i;
+
+  // Scratch is per thread and only covers the window around the tile
+  static thread_local std::vector<bool> seen;
+  static thread_local std::vector<std::vector<CellData>> bins;
+  seen.assign(w_size_x * (w_max_j - w_min_j), false);
+  if (bins.size() < inflation_cells_.size()) {
+    bins.resize(inflation_cells_.size());
+  }
+
+  // The copy of prepareTiles(), not the master, whose halo the other tiles are writing
+  auto & obs_bin = bins[0];
+  for (int j = w_min_j; j < w_max_j; j++) {
+    const unsigned char * sources = tile_window_.row(j);
+    for (int i = w_min_i; i < w_max_i; i++) {
+      if (isSource(sources[i - tile_window_.min_i])) {
+        obs_bin.emplace_back(master_grid.getIndex(i, j), i, j, i, j);
+      }
+    }
+  }
+
+  const unsigned int cache_r = cell_inflation_radius_ + 2;
+  auto enqueue_local = [&](
+    unsigned int index, unsigned int mx, unsigned int my,
+    unsigned int src_x, unsigned int src_y)
+    {
+      if (seen[(my - w_min_j) * w_size_x + (mx - w_min_i)]) {
+        return;
+      }
+      if (distanceLookup(mx, my, src_x, src_y) > cell_inflation_radius_) {
+        return;
+      }
+      bins[distance_matrix_[mx - src_x + cache_r][my - src_y + cache_r]].emplace_back(
+        index, mx, my, src_x, src_y);
+    };
+
+  for (std::size_t level = 0; level < inflation_cells_.size(); ++level) {
+    auto & dist_bin = bins[level];
+    for (std::size_t i = 0; i < dist_bin.size(); ++i) {
+      const unsigned int index = dist_bin[i].index_;
+      const unsigned int mx = dist_bin[i].x_;
+      const unsigned int my = dist_bin[i].y_;
+      const unsigned int sx = dist_bin[i].src_x_;
+      const unsigned int sy = dist_bin[i].src_y_;
+
+      std::vector<bool>::reference visited = seen[(my - w_min_j) * w_size_x + (mx - w_min_i)];
+      if (visited) {
+        continue;
+      }
+      visited = true;
+
+      // Cells of the halo are only walked through, their costs belong to other tiles
+      if (static_cast<int>(mx) >= min_i && static_cast<int>(mx) < max_i &&
+        static_cast<int>(my) >= min_j && static_cast<int>(my) < max_j)
+      {
+        unsigned char cost = costLookup(mx, my, sx, sy);
+        unsigned char old_cost = master_array[index];
+        if (old_cost == NO_INFORMATION &&
+          (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+        {
+          master_array[index] = cost;
+        } else {
+          master_array[index] = std::max(old_cost, cost);
+        }
+      }
+
+      if (static_cast<int>(mx) > w_min_i) {
+        enqueue_local(index - 1, mx - 1, my, sx, sy);
+      }
+      if (static_cast<int>(my) > w_min_j) {
+        enqueue_local(index - size_x, mx, my - 1, sx, sy);
+      }
+      if (static_cast<int>(mx) < w_max_i - 1) {
+        enqueue_local(index + 1, mx + 1, my, sx, sy);
+      }
+      if (static_cast<int>(my) < w_max_j - 1) {
+        enqueue_local(index + size_x, mx, my + 1, sx, sy);
+      }
+    }
+    dist_bin.clear();
   }
 }
 
@@ -290,7 +637,7 @@ InflationLayer::enqueue(
   unsigned int index, unsigned int mx, unsigned int my,
   unsigned int src_x, unsigned int src_y)
 {
-  if (!seen_[index]) {
+  if (seen_[index] != seen_epoch_) {
     // we compute our distance table one cell further than the
     // inflation radius dictates so we can make the check below
     double distance = distanceLookup(mx, my, src_x, src_y);
@@ -309,6 +656,329 @@ InflationLayer::enqueue(
   }
 }
 
+void
+InflationLayer::updateCostsIncremental(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i, int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+
+  // The field is stored in master grid cell coordinates, so a resize or an origin
+  // shift (rolling window) makes it meaningless and it has to be rebuilt
+  if (field_source_.size() != size_x * size_y ||
+    field_origin_x_ != master_grid.getOriginX() || field_origin_y_ != master_grid.getOriginY())
+  {
+    invalidateDistanceField();
+  }
+
+  // Cells up to cell_inflation_radius_ outside the window can still influence
+  // the costs stored in cells inside the window
+  min_i = std::max(0, min_i - static_cast<int>(cell_inflation_radius_));
+  min_j = std::max(0, min_j - static_cast<int>(cell_inflation_radius_));
+  max_i = std::min(static_cast<int>(size_x), max_i + static_cast<int>(cell_inflation_radius_));
+  max_j = std::min(static_cast<int>(size_y), max_j + static_cast<int>(cell_inflation_radius_));
+
+  // A rebuilt field knows nothing about obstacles outside of the window,
+  // so seed it from the whole grid once
+  int scan_min_i = min_i, scan_min_j = min_j, scan_max_i = max_i, scan_max_j = max_j;
+  if (!field_valid_) {
+    const unsigned int no_source = NO_SOURCE;
+    field_source_.assign(size_x * size_y, no_source);
+    field_cost_.assign(size_x * size_y, FREE_SPACE);
+    field_is_source_.assign(size_x * size_y, false);
+    field_to_raise_.assign(size_x * size_y, false);
+    field_queue_ = decltype(field_queue_)();
+    field_origin_x_ = master_grid.getOriginX();
+    field_origin_y_ = master_grid.getOriginY();
+    field_valid_ = true;
+    scan_min_i = scan_min_j = 0;
+    scan_max_i = static_cast<int>(size_x);
+    scan_max_j = static_cast<int>(size_y);
+  }
+
+  // Diff the obstacle cells against the ones the field was built from. Sources are
+  // flagged before any propagation so that raise waves see the final obstacle set.
+  for (int j = scan_min_j; j < scan_max_j; j++) {
+    unsigned int index = master_grid.getIndex(scan_min_i, j);
+    for (int i = scan_min_i; i < scan_max_i; i++, index++) {
+      unsigned char cost = master_array[index];
+      bool is_source = cost == LETHAL_OBSTACLE ||
+        (inflate_around_unknown_ && cost == NO_INFORMATION);
+      if (is_source == field_is_source_[index]) {
+        continue;
+      }
+
+      field_is_source_[index] = is_source;
+      if (is_source) {
+        field_source_[index] = index;
+        field_cost_[index] = LETHAL_OBSTACLE;
+        field_to_raise_[index] = false;
+      } else {
+        field_source_[index] = NO_SOURCE;
+        field_cost_[index] = FREE_SPACE;
+        field_to_raise_[index] = true;
+      }
+      field_queue_.emplace(0.0, index);
+    }
+  }
+
+  // Process the lower and raise waves by increasing distance to their obstacle
+  while (!field_queue_.empty()) {
+    unsigned int index = field_queue_.top().second;
+    field_queue_.pop();
+    if (field_to_raise_[index]) {
+      fieldRaise(index, size_x, size_y);
+    } else if (field_source_[index] != NO_SOURCE && field_is_source_[field_source_[index]]) {
+      fieldLower(index, size_x, size_y);
+    }
+  }
+
+  // Write the field back into the master grid with the same combination rules
+  // as the batch wavefront
+  for (int j = min_j; j < max_j; j++) {
+    unsigned int index = master_grid.getIndex(min_i, j);
+    for (int i = min_i; i < max_i; i++, index++) {
+      if (field_source_[index] == NO_SOURCE) {
+        continue;
+      }
+      unsigned char cost = field_cost_[index];
+      unsigned char old_cost = master_array[index];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_array[index] = cost;
+      } else {
+        master_array[index] = std::max(old_cost, cost);
+      }
+    }
+  }
+}
+
+void
+InflationLayer::updateCostsDistanceTransform(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i, int max_j, const SourceWindow & sources, nav2_util::ThreadPool * pool)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  const int size_x = static_cast<int>(master_grid.getSizeInCellsX());
+  const int size_y = static_cast<int>(master_grid.getSizeInCellsY());
+  min_i = std::max(0, min_i);
+  min_j = std::max(0, min_j);
+  max_i = std::min(size_x, max_i);
+  max_j = std::min(size_y, max_j);
+  if (max_i <= min_i || max_j <= min_j) {
+    return;
+  }
+
+  // The transform sees every obstacle within the inflation radius of the window
+  const int r = static_cast<int>(cell_inflation_radius_);
+  const int w_min_i = std::max(0, min_i - r);
+  const int w_min_j = std::max(0, min_j - r);
+  const int w_max_i = std::min(size_x, max_i + r);
+  const int w_max_j = std::min(size_y, max_j + r);
+  const unsigned int w_size_x = w_max_i - w_min_i;
+
+  static thread_local std::vector<float> squared_distances;
+  squared_distances.resize(w_size_x * (w_max_j - w_min_j));
+  squaredDistanceTransform(
+    sources.costs, sources.size_x, w_min_i - sources.min_i, w_min_j - sources.min_j,
+    w_max_i - sources.min_i, w_max_j - sources.min_j, inflate_around_unknown_,
+    squared_distances.data(), pool);
+
+  // Squared distances are exact integers, so they index the cost table directly
+  const float max_squared = static_cast<float>(squared_distance_costs_.size() - 1);
+  for (int j = min_j; j < max_j; j++) {
+    const float * squared = squared_distances.data() + (j - w_min_j) * w_size_x +
+      (min_i - w_min_i);
+    unsigned int index = master_grid.getIndex(min_i, j);
+    for (int i = min_i; i < max_i; i++, index++, squared++) {
+      if (*squared > max_squared) {
+        continue;
+      }
+      unsigned char cost = squared_distance_costs_[static_cast<unsigned int>(*squared)];
+      unsigned char old_cost = master_array[index];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_array[index] = cost;
+      } else {
+        master_array[index] = std::max(old_cost, cost);
+      }
+    }
+  }
+}
+
+void
+InflationLayer::updateCostsKernel(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i, int max_j, const SourceWindow & sources)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  const int size_x = static_cast<int>(master_grid.getSizeInCellsX());
+  const int size_y = static_cast<int>(master_grid.getSizeInCellsY());
+  min_i = std::max(0, min_i);
+  min_j = std::max(0, min_j);
+  max_i = std::min(size_x, max_i);
+  max_j = std::min(size_y, max_j);
+  if (max_i <= min_i || max_j <= min_j) {
+    return;
+  }
+
+  const int r = static_cast<int>(cell_inflation_radius_);
+  const int side = 2 * r + 1;
+  const int w_min_i = std::max(0, min_i - r);
+  const int w_min_j = std::max(0, min_j - r);
+  const int w_max_i = std::min(size_x, max_i + r);
+  const int w_max_j = std::min(size_y, max_j + r);
+  const int width = max_i - min_i;
+
+  // Highest kernel cost of every cell of the window, 0 where no obstacle reaches
+  static thread_local std::vector<unsigned char> stamped;
+  stamped.assign(static_cast<std::size_t>(width) * (max_j - min_j), FREE_SPACE);
+
+  // Max of a kernel row into the cells [x0, x1] of a window row, k0 being x0's kernel cell
+  auto stamp = [&](unsigned char * row, const unsigned char * krow, int x0, int x1, int k0) {
+      const int lo = std::max(x0, min_i);
+      const int hi = std::min(x1, max_i - 1);
+      if (lo <= hi) {
+        combineRowMax(row + (lo - min_i), krow + k0 + (lo - x0), hi - lo + 1);
+      }
+    };
+
+  for (int j = w_min_j; j < w_max_j; j++) {
+    const unsigned char * row_sources = sources.row(j);
+    const int offset = sources.min_i;
+    const int dy_lo = std::max(-r, min_j - j);
+    const int dy_hi = std::min(r, max_j - 1 - j);
+    if (dy_lo > dy_hi) {
+      continue;
+    }
+    for (int a = w_min_i; a < w_max_i; a++) {
+      if (!isSource(row_sources[a - offset])) {
+        continue;
+      }
+      // The costs fall with the distance, so a run of obstacles stamps the left half of
+      // the kernel at its first cell, the center across it and the right half at its last
+      int b = a;
+      while (b + 1 < w_max_i && isSource(row_sources[b + 1 - offset])) {
+        b++;
+      }
+      for (int dy = dy_lo; dy <= dy_hi; dy++) {
+        const unsigned char * krow = cost_kernel_.data() + (dy + r) * side;
+        unsigned char * row = stamped.data() + static_cast<std::size_t>(j + dy - min_j) * width;
+        stamp(row, krow, a - r, a, 0);
+        if (b - a > 1) {
+          const int lo = std::max(a + 1, min_i) - min_i;
+          const int hi = std::min(b - 1, max_i - 1) - min_i;
+          for (int x = lo; x <= hi; x++) {
+            row[x] = std::max(row[x], krow[r]);
+          }
+        }
+        stamp(row, krow, b, b + r, r);
+      }
+      a = b;
+    }
+  }
+
+  for (int j = min_j; j < max_j; j++) {
+    const unsigned char * costs = stamped.data() + static_cast<std::size_t>(j - min_j) * width;
+    unsigned int index = master_grid.getIndex(min_i, j);
+    for (int i = 0; i < width; i++, index++) {
+      unsigned char cost = costs[i];
+      unsigned char old_cost = master_array[index];
+      if (old_cost == NO_INFORMATION &&
+        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+      {
+        master_array[index] = cost;
+      } else {
+        master_array[index] = std::max(old_cost, cost);
+      }
+    }
+  }
+}
+
+void
+InflationLayer::invalidateDistanceField()
+{
+  field_valid_ = false;
+}
+
+void
+InflationLayer::fieldLower(unsigned int index, unsigned int size_x, unsigned int size_y)
+{
+  unsigned int src = field_source_[index];
+  unsigned int mx = index % size_x, my = index / size_x;
+  if (mx > 0) {
+    fieldLowerNeighbor(index - 1, src, size_x);
+  }
+  if (my > 0) {
+    fieldLowerNeighbor(index - size_x, src, size_x);
+  }
+  if (mx < size_x - 1) {
+    fieldLowerNeighbor(index + 1, src, size_x);
+  }
+  if (my < size_y - 1) {
+    fieldLowerNeighbor(index + size_x, src, size_x);
+  }
+}
+
+void
+InflationLayer::fieldLowerNeighbor(unsigned int n, unsigned int src, unsigned int size_x)
+{
+  if (field_to_raise_[n]) {
+    return;
+  }
+
+  double distance = fieldDistance(n, src, size_x);
+  if (distance > cell_inflation_radius_) {
+    return;
+  }
+
+  unsigned int n_src = field_source_[n];
+  if (n_src == NO_SOURCE || distance < fieldDistance(n, n_src, size_x)) {
+    field_source_[n] = src;
+    field_cost_[n] = costLookup(n % size_x, n / size_x, src % size_x, src / size_x);
+    field_queue_.emplace(distance, n);
+  }
+}
+
+void
+InflationLayer::fieldRaise(unsigned int index, unsigned int size_x, unsigned int size_y)
+{
+  unsigned int mx = index % size_x, my = index / size_x;
+  if (mx > 0) {
+    fieldRaiseNeighbor(index - 1, size_x);
+  }
+  if (my > 0) {
+    fieldRaiseNeighbor(index - size_x, size_x);
+  }
+  if (mx < size_x - 1) {
+    fieldRaiseNeighbor(index + 1, size_x);
+  }
+  if (my < size_y - 1) {
+    fieldRaiseNeighbor(index + size_x, size_x);
+  }
+  field_to_raise_[index] = false;
+}
+
+void
+InflationLayer::fieldRaiseNeighbor(unsigned int n, unsigned int size_x)
+{
+  unsigned int n_src = field_source_[n];
+  if (n_src == NO_SOURCE || field_to_raise_[n]) {
+    return;
+  }
+
+  // Cells still backed by an obstacle are requeued so that they refill the cleared area
+  field_queue_.emplace(fieldDistance(n, n_src, size_x), n);
+  if (!field_is_source_[n_src]) {
+    field_source_[n] = NO_SOURCE;
+    field_cost_[n] = FREE_SPACE;
+    field_to_raise_[n] = true;
+  }
+}
+
 void
 InflationLayer::computeCaches()
 {
@@ -339,11 +1009,34 @@ InflationLayer::computeCaches()
     }
   }
 
+  // Same costs as the wavefront for the distances within the inflation radius
+  const unsigned int max_squared = cell_inflation_radius_ * cell_inflation_radius_;
+  squared_distance_costs_.assign(max_squared + 1, FREE_SPACE);
+  for (unsigned int i = 0; i <= cell_inflation_radius_; ++i) {
+    for (unsigned int j = 0; i * i + j * j <= max_squared; ++j) {
+      squared_distance_costs_[i * i + j * j] = cached_costs_[i * cache_length_ + j];
+    }
+  }
+
+  // The costs around an obstacle, zero past the inflation radius like the wavefront
+  const int r = static_cast<int>(cell_inflation_radius_);
+  const int side = 2 * r + 1;
+  cost_kernel_.assign(side * side, FREE_SPACE);
+  for (int dy = -r; dy <= r; ++dy) {
+    for (int dx = -r; dx <= r; ++dx) {
+      const unsigned int ax = std::abs(dx), ay = std::abs(dy);
+      if (cached_distances_[ax * cache_length_ + ay] <= cell_inflation_radius_) {
+        cost_kernel_[(dy + r) * side + dx + r] = cached_costs_[ax * cache_length_ + ay];
+      }
+    }
+  }
+
   int max_dist = generateIntegerDistances();
-  inflation_cells_.clear();
+  // The bins kept keep their capacity
+  const std::size_t old_bins = inflation_cells_.size();
   inflation_cells_.resize(max_dist + 1);
-  for (auto & dist : inflation_cells_) {
-    dist.reserve(200);
+  for (std::size_t i = old_bins; i < inflation_cells_.size(); ++i) {
+    inflation_cells_[i].reserve(200);
   }
 }
 
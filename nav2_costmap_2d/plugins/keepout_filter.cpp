@@ -0,0 +1,151 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/keepout_filter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::KeepoutFilter, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+// Occupied cells of a trinary map
+static constexpr int8_t KEEPOUT_VALUE = 100;
+
+KeepoutFilter::KeepoutFilter()
+{
+}
+
+void
+KeepoutFilter::processMask(const nav_msgs::msg::OccupancyGrid & mask)
+{
+  FilterMask keepout(mask, KEEPOUT_VALUE);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!has_updated_data_) {
+    previous_mask_ = std::move(mask_);
+  }
+  mask_ = std::move(keepout);
+  raster_ = MaskRaster();
+  raster_valid_ = false;
+  has_updated_data_ = true;
+}
+
+void
+KeepoutFilter::touchMask(
+  const FilterMask & mask, double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  if (mask.empty()) {
+    return;
+  }
+  tf2::Transform transform;
+  if (!lookupMaskTransform(mask.getFrame(), transform)) {
+    // Not knowing where the zones are, the whole grid is updated
+    *min_x = *min_y = -std::numeric_limits<double>::max();
+    *max_x = *max_y = std::numeric_limits<double>::max();
+    return;
+  }
+  const double x0 = mask.getOriginX();
+  const double y0 = mask.getOriginY();
+  const double x1 = x0 + mask.getSizeInCellsX() * mask.getResolution();
+  const double y1 = y0 + mask.getSizeInCellsY() * mask.getResolution();
+  const tf2::Transform to_global = transform.inverse();
+  for (const tf2::Vector3 & corner :
+    {tf2::Vector3(x0, y0, 0.0), tf2::Vector3(x1, y0, 0.0), tf2::Vector3(x0, y1, 0.0),
+      tf2::Vector3(x1, y1, 0.0)})
+  {
+    const tf2::Vector3 point = to_global * corner;
+    *min_x = std::min(*min_x, point.x());
+    *min_y = std::min(*min_y, point.y());
+    *max_x = std::max(*max_x, point.x());
+    *max_y = std::max(*max_y, point.y());
+  }
+}
+
+void
+KeepoutFilter::updateBounds(
+  double, double, double, double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!enabled_ || !has_updated_data_) {
+    return;
+  }
+  touchMask(previous_mask_, min_x, min_y, max_x, max_y);
+  touchMask(mask_, min_x, min_y, max_x, max_y);
+  previous_mask_ = FilterMask();
+  has_updated_data_ = false;
+}
+
+void
+KeepoutFilter::updateCosts(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j, int max_i, int max_j)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!enabled_ || mask_.empty()) {
+    return;
+  }
+
+  if (mask_.getFrame().empty() || mask_.getFrame() == global_frame_) {
+    // A rolling window moves by whole cells, so the raster only goes out of line with the
+    // master grid on a resize
+    if (raster_valid_ && applyMaskMax(raster_, master_grid, min_i, min_j, max_i, max_j)) {
+      return;
+    }
+    raster_ = rasterizeMask(
+      mask_, master_grid.getResolution(), master_grid.getOriginX(), master_grid.getOriginY(),
+      LETHAL_OBSTACLE);
+    raster_valid_ = true;
+    applyMaskMax(raster_, master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
+
+  tf2::Transform transform;
+  if (!lookupMaskTransform(mask_.getFrame(), transform)) {
+    return;
+  }
+  unsigned char * master = master_grid.getCharMap();
+  const unsigned int span = master_grid.getSizeInCellsX();
+  for (int j = min_j; j < max_j; ++j) {
+    unsigned int index = span * j + min_i;
+    for (int i = min_i; i < max_i; ++i, ++index) {
+      double wx, wy;
+      master_grid.mapToWorld(i, j, wx, wy);
+      const tf2::Vector3 point = transform * tf2::Vector3(wx, wy, 0.0);
+      if (mask_.valueAt(point.x(), point.y()) > 0) {
+        master[index] = LETHAL_OBSTACLE;
+      }
+    }
+  }
+}
+
+void
+KeepoutFilter::matchSize()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  raster_valid_ = false;
+}
+
+std::size_t
+KeepoutFilter::getMemoryUsage() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mask_.getMemoryUsage() + raster_.costs.capacity();
+}
+
+}  // namespace nav2_costmap_2d
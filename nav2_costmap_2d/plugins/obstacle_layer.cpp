@@ -39,6 +39,8 @@
 #include "nav2_costmap_2d/obstacle_layer.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -56,11 +58,42 @@ using nav2_costmap_2d::FREE_SPACE;
 using nav2_costmap_2d::ObservationBuffer;
 using nav2_costmap_2d::Observation;
 
+namespace
+{
+
+// Clears a cell with a relaxed atomic store, so that rays traced
+// concurrently may cross the same cells
+class AtomicClearCell
+{
+public:
+  explicit AtomicClearCell(unsigned char * costmap)
+  : costmap_(costmap)
+  {
+  }
+  inline void operator()(unsigned int offset)
+  {
+    __atomic_store_n(costmap_ + offset, FREE_SPACE, __ATOMIC_RELAXED);
+  }
+
+private:
+  unsigned char * costmap_;
+};
+
+}  // namespace
+
 namespace nav2_costmap_2d
 {
 
 ObstacleLayer::~ObstacleLayer()
 {
+  if (ingest_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(ingest_mutex_);
+      ingest_stop_ = true;
+    }
+    ingest_cv_.notify_one();
+    ingest_thread_.join();
+  }
   for (auto & notifier : observation_notifiers_) {
     notifier.reset();
   }
@@ -82,6 +115,9 @@ void ObstacleLayer::onInitialize()
   declareParameter("max_obstacle_height", rclcpp::ParameterValue(2.0));
   declareParameter("combination_method", rclcpp::ParameterValue(1));
   declareParameter("observation_sources", rclcpp::ParameterValue(std::string("")));
+  declareParameter("raytrace_threads", rclcpp::ParameterValue(1));
+  declareParameter("ingest_thread", rclcpp::ParameterValue(false));
+  declareParameter("rasterize_observations", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
@@ -90,6 +126,18 @@ void ObstacleLayer::onInitialize()
   node_->get_parameter("track_unknown_space", track_unknown_space);
   node_->get_parameter("transform_tolerance", transform_tolerance);
   node_->get_parameter(name_ + "." + "observation_sources", topics_string);
+  int raytrace_threads = 1;
+  node_->get_parameter(name_ + "." + "raytrace_threads", raytrace_threads);
+  if (raytrace_threads > 1) {
+    raytrace_pool_ = std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::COSTMAP, raytrace_threads);
+  }
+  bool ingest_thread = false;
+  node_->get_parameter(name_ + "." + "ingest_thread", ingest_thread);
+  bool rasterize_observations = false;
+  node_->get_parameter(name_ + "." + "rasterize_observations", rasterize_observations);
+  rasterize_observations = rasterize_observations && canRasterizeObservations();
+  std::shared_ptr<nav2_util::TimingStats> timing_stats = layered_costmap_->getTimingStats();
 
   RCLCPP_INFO(node_->get_logger(), "Subscribed to Topics: %s", topics_string.c_str());
 
@@ -103,6 +151,7 @@ void ObstacleLayer::onInitialize()
 
   ObstacleLayer::matchSize();
   current_ = true;
+  raster_geometry_ = RasterGeometry::of(*this);
 
   global_frame_ = layered_costmap_->getGlobalFrameID();
 
@@ -128,6 +177,9 @@ void ObstacleLayer::onInitialize()
     declareParameter(source + "." + "clearing", rclcpp::ParameterValue(false));
     declareParameter(source + "." + "obstacle_range", rclcpp::ParameterValue(2.5));
     declareParameter(source + "." + "raytrace_range", rclcpp::ParameterValue(3.0));
+    declareParameter(source + "." + "voxel_size", rclcpp::ParameterValue(0.0));
+    declareParameter(source + "." + "tf_queue_size", rclcpp::ParameterValue(50));
+    declareParameter(source + "." + "polar_clearing_bins", rclcpp::ParameterValue(0));
 
     node_->get_parameter(name_ + "." + source + "." + "topic", topic);
     node_->get_parameter(name_ + "." + source + "." + "sensor_frame", sensor_frame);
@@ -160,6 +212,16 @@ void ObstacleLayer::onInitialize()
     double raytrace_range;
     node_->get_parameter(name_ + "." + source + "." + "raytrace_range", raytrace_range);
 
+    // get the size of the voxels the clouds are downsampled to
+    double voxel_size;
+    node_->get_parameter(name_ + "." + source + "." + "voxel_size", voxel_size);
+    int tf_queue_size = 50;
+    node_->get_parameter(name_ + "." + source + "." + "tf_queue_size", tf_queue_size);
+    const uint32_t filter_depth = static_cast<uint32_t>(std::max(tf_queue_size, 1));
+    int polar_clearing_bins = 0;
+    node_->get_parameter(
+      name_ + "." + source + "." + "polar_clearing_bins", polar_clearing_bins);
+
     RCLCPP_DEBUG(
       node_->get_logger(),
       "Creating an observation buffer for source %s, topic %s, frame %s",
@@ -174,7 +236,8 @@ void ObstacleLayer::onInitialize()
           node_, topic, observation_keep_time, expected_update_rate,
           min_obstacle_height,
           max_obstacle_height, obstacle_range, raytrace_range, *tf_, global_frame_,
-          sensor_frame, transform_tolerance)));
+          sensor_frame, transform_tolerance, voxel_size,
+          static_cast<unsigned int>(std::max(polar_clearing_bins, 0)))));
 
     // check if we'll add this buffer to our marking observation buffers
     if (marking) {
@@ -193,6 +256,29 @@ void ObstacleLayer::onInitialize()
       source.c_str(), topic.c_str(),
       global_frame_.c_str(), expected_update_rate, observation_keep_time);
 
+    const std::size_t slot = ingest_slots_.size();
+    ingest_slots_.emplace_back();
+    if (timing_stats) {
+      ingest_slots_.back().lag = &timing_stats->histogram(name_ + " " + source + " lag");
+      ingest_slots_.back().dropped = &timing_stats->histogram(name_ + " " + source + " dropped");
+    }
+    std::shared_ptr<ObservationBuffer> buffer = observation_buffers_.back();
+
+    // A raster only holds the latest observation, and polar clearing has a pass of its own
+    if (rasterize_observations && (marking || clearing)) {
+      if (observation_keep_time == 0.0 && polar_clearing_bins <= 0) {
+        raster_sources_.push_back(std::make_unique<RasterSource>());
+        raster_sources_.back()->buffer = buffer;
+        raster_sources_.back()->marking = marking;
+        raster_sources_.back()->clearing = clearing;
+        ingest_slots_.back().raster = raster_sources_.back().get();
+      } else {
+        RCLCPP_WARN(
+          node_->get_logger(), "%s: not rasterizing source %s, which keeps observations or "
+          "clears by polar bins", name_.c_str(), source.c_str());
+      }
+    }
+
     rmw_qos_profile_t custom_qos_profile = rmw_qos_profile_sensor_data;
     custom_qos_profile.depth = 50;
 
@@ -205,20 +291,26 @@ void ObstacleLayer::onInitialize()
 
       std::shared_ptr<tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>> filter(
         new tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>(
-          *sub, *tf_, global_frame_, 50, rclcpp_node_));
+          *sub, *tf_, global_frame_, filter_depth, rclcpp_node_));
 
-      if (inf_is_valid) {
-        filter->registerCallback(
-          std::bind(
-            &ObstacleLayer::laserScanValidInfCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
-
-      } else {
-        filter->registerCallback(
-          std::bind(
-            &ObstacleLayer::laserScanCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
-      }
+      filter->registerCallback(
+        [this, slot, buffer, inf_is_valid](
+          const sensor_msgs::msg::LaserScan::ConstSharedPtr & message) {
+          ingest(
+            slot, message->header.stamp, [this, message, buffer, inf_is_valid]() {
+              if (inf_is_valid) {
+                laserScanValidInfCallback(message, buffer);
+              } else {
+                laserScanCallback(message, buffer);
+              }
+            });
+        });
+      filter->registerFailureCallback(
+        [this, slot](
+          const sensor_msgs::msg::LaserScan::ConstSharedPtr & message,
+          tf2_ros::FilterFailureReason) {
+          recordDrop(slot, message->header.stamp);
+        });
 
       observation_subscribers_.push_back(sub);
 
@@ -239,12 +331,21 @@ void ObstacleLayer::onInitialize()
 
       std::shared_ptr<tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>> filter(
         new tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>(
-          *sub, *tf_, global_frame_, 50, rclcpp_node_));
+          *sub, *tf_, global_frame_, filter_depth, rclcpp_node_));
 
       filter->registerCallback(
-        std::bind(
-          &ObstacleLayer::pointCloud2Callback, this, std::placeholders::_1,
-          observation_buffers_.back()));
+        [this, slot, buffer](const sensor_msgs::msg::PointCloud2::ConstSharedPtr & message) {
+          ingest(
+            slot, message->header.stamp, [this, message, buffer]() {
+              pointCloud2Callback(message, buffer);
+            });
+        });
+      filter->registerFailureCallback(
+        [this, slot](
+          const sensor_msgs::msg::PointCloud2::ConstSharedPtr & message,
+          tf2_ros::FilterFailureReason) {
+          recordDrop(slot, message->header.stamp);
+        });
 
       observation_subscribers_.push_back(sub);
       observation_notifiers_.push_back(filter);
@@ -257,68 +358,168 @@ void ObstacleLayer::onInitialize()
       observation_notifiers_.back()->setTargetFrames(target_frames);
     }
   }
+
+  if (ingest_thread && !ingest_slots_.empty()) {
+    ingest_thread_ = std::thread(&ObstacleLayer::ingestLoop, this);
+  }
 }
 
 void
-ObstacleLayer::laserScanCallback(
-  sensor_msgs::msg::LaserScan::ConstSharedPtr message,
-  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer)
+ObstacleLayer::ingest(std::size_t slot, const rclcpp::Time & stamp, std::function<void()> work)
 {
-  // project the laser into a point cloud
-  sensor_msgs::msg::PointCloud2 cloud;
-  cloud.header = message->header;
+  if (!ingest_thread_.joinable()) {
+    work();
+    if (ingest_slots_[slot].raster) {
+      rasterizeLatest(*ingest_slots_[slot].raster);
+    }
+    if (ingest_slots_[slot].lag) {
+      ingest_slots_[slot].lag->record(ageOf(stamp));
+    }
+    return;
+  }
 
-  // project the scan into a point cloud
-  try {
-    projector_.transformLaserScanToPointCloud(message->header.frame_id, *message, cloud, *tf_);
-  } catch (tf2::TransformException & ex) {
-    RCLCPP_WARN(
-      node_->get_logger(),
-      "High fidelity enabled, but TF returned a transform exception to frame %s: %s",
-      global_frame_.c_str(),
-      ex.what());
-    projector_.projectLaser(*message, cloud);
+  {
+    std::lock_guard<std::mutex> lock(ingest_mutex_);
+    IngestSlot & waiting = ingest_slots_[slot];
+    // Only the newest message of a source is worth buffering
+    if (waiting.work) {
+      recordDrop(slot, waiting.stamp);
+    }
+    waiting.work = std::move(work);
+    waiting.stamp = stamp;
   }
+  ingest_cv_.notify_one();
+}
 
-  // buffer the point cloud
-  buffer->lock();
-  buffer->bufferCloud(cloud);
-  buffer->unlock();
+void
+ObstacleLayer::recordDrop(std::size_t slot, const rclcpp::Time & stamp)
+{
+  if (ingest_slots_[slot].dropped) {
+    ingest_slots_[slot].dropped->record(ageOf(stamp));
+  }
+}
+
+int64_t
+ObstacleLayer::ageOf(const rclcpp::Time & stamp) const
+{
+  return std::max<int64_t>((node_->now() - stamp).nanoseconds(), 0);
 }
 
 void
-ObstacleLayer::laserScanValidInfCallback(
-  sensor_msgs::msg::LaserScan::ConstSharedPtr raw_message,
-  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer)
+ObstacleLayer::ingestLoop()
 {
-  // Filter positive infinities ("Inf"s) to max_range.
-  float epsilon = 0.0001;  // a tenth of a millimeter
-  sensor_msgs::msg::LaserScan message = *raw_message;
-  for (size_t i = 0; i < message.ranges.size(); i++) {
-    float range = message.ranges[i];
-    if (!std::isfinite(range) && range > 0) {
-      message.ranges[i] = message.range_max - epsilon;
+  auto pending = [this]() {
+      return std::any_of(
+        ingest_slots_.begin(), ingest_slots_.end(),
+        [](const IngestSlot & slot) {return static_cast<bool>(slot.work);});
+    };
+
+  std::unique_lock<std::mutex> lock(ingest_mutex_);
+  while (true) {
+    ingest_cv_.wait(lock, [&]() {return ingest_stop_ || pending();});
+    if (ingest_stop_) {
+      return;
+    }
+    for (IngestSlot & slot : ingest_slots_) {
+      if (!slot.work) {
+        continue;
+      }
+      std::function<void()> work = std::move(slot.work);
+      slot.work = nullptr;
+      const rclcpp::Time stamp = slot.stamp;
+      lock.unlock();
+      work();
+      if (slot.raster) {
+        rasterizeLatest(*slot.raster);
+      }
+      if (slot.lag) {
+        slot.lag->record(ageOf(stamp));
+      }
+      lock.lock();
     }
   }
+}
 
-  // project the laser into a point cloud
-  sensor_msgs::msg::PointCloud2 cloud;
-  cloud.header = message.header;
+void
+ObstacleLayer::rasterizeLatest(RasterSource & source)
+{
+  source.buffer->lock();
+  source.buffer->getObservations(source.latest);
+  source.buffer->unlock();
+  if (source.latest.empty()) {
+    return;
+  }
 
-  // project the scan into a point cloud
-  try {
-    projector_.transformLaserScanToPointCloud(message.header.frame_id, message, cloud, *tf_);
-  } catch (tf2::TransformException & ex) {
+  RasterGeometry geometry;
+  {
+    std::lock_guard<std::mutex> lock(raster_geometry_mutex_);
+    geometry = raster_geometry_;
+  }
+  if (!rasterizeObservation(
+      source.latest.back(), max_obstacle_height_, source.marking, source.clearing, geometry,
+      source.building))
+  {
     RCLCPP_WARN(
-      node_->get_logger(),
-      "High fidelity enabled, but TF returned a transform exception to frame %s: %s",
-      global_frame_.c_str(), ex.what());
-    projector_.projectLaser(message, cloud);
+      node_->get_logger(), "%s: an observation cloud has no float32 x, y and z fields",
+      name_.c_str());
   }
+  // Lets go of the cloud
+  source.latest.clear();
 
-  // buffer the point cloud
+  std::lock_guard<std::mutex> lock(source.mutex);
+  std::swap(source.building, source.ready);
+  source.fresh = true;
+}
+
+bool
+ObstacleLayer::isRasterized(const ObservationBuffer * buffer) const
+{
+  return std::any_of(
+    raster_sources_.begin(), raster_sources_.end(),
+    [buffer](const std::unique_ptr<RasterSource> & source) {
+      return source->buffer.get() == buffer;
+    });
+}
+
+void
+ObstacleLayer::applyRasterCells(
+  const std::vector<unsigned int> & cells, const RasterGeometry & geometry, int dx, int dy,
+  unsigned char value)
+{
+  if (dx == 0 && dy == 0) {
+    for (unsigned int cell : cells) {
+      costmap_[cell] = value;
+    }
+    return;
+  }
+  for (unsigned int cell : cells) {
+    const int x = static_cast<int>(cell % geometry.size_x) + dx;
+    const int y = static_cast<int>(cell / geometry.size_x) + dy;
+    if (x >= 0 && y >= 0 && x < static_cast<int>(size_x_) && y < static_cast<int>(size_y_)) {
+      costmap_[getIndex(x, y)] = value;
+    }
+  }
+}
+
+void
+ObstacleLayer::laserScanCallback(
+  sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer)
+{
+  // project the scan straight into the global frame
   buffer->lock();
-  buffer->bufferCloud(cloud);
+  buffer->bufferScan(*message, false);
+  buffer->unlock();
+}
+
+void
+ObstacleLayer::laserScanValidInfCallback(
+  sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer)
+{
+  // positive infinities ("Inf"s) are projected at range_max, without copying the scan
+  buffer->lock();
+  buffer->bufferScan(*message, true);
   buffer->unlock();
 }
 
@@ -347,7 +548,8 @@ ObstacleLayer::updateBounds(
   useExtraBounds(min_x, min_y, max_x, max_y);
 
   bool current = true;
-  std::vector<Observation> observations, clearing_observations;
+  std::vector<Observation> & observations = marking_scratch_;
+  std::vector<Observation> & clearing_observations = clearing_scratch_;
 
   // get the marking observations
   current = current && getMarkingObservations(observations);
@@ -358,58 +560,77 @@ ObstacleLayer::updateBounds(
   // update the global current status
   current_ = current;
 
+  // Take the newest rasters of the sources rasterized off this thread. One made
+  // against another grid than a shifted one of this layer, such as before a resize,
+  // is of no use, the observation then goes the way of the others
+  const RasterGeometry geometry = RasterGeometry::of(*this);
+  {
+    std::lock_guard<std::mutex> lock(raster_geometry_mutex_);
+    raster_geometry_ = geometry;
+  }
+  for (const std::unique_ptr<RasterSource> & source : raster_sources_) {
+    {
+      std::lock_guard<std::mutex> lock(source->mutex);
+      if (source->fresh) {
+        std::swap(source->ready, source->applied);
+        source->fresh = false;
+      }
+    }
+    source->apply = source->applied.valid &&
+      source->applied.geometry.offsetTo(geometry, source->dx, source->dy);
+    if (source->apply) {
+      continue;
+    }
+    source->buffer->lock();
+    if (source->marking) {
+      source->buffer->getObservations(observations);
+    }
+    if (source->clearing) {
+      source->buffer->getObservations(clearing_observations);
+    }
+    source->buffer->unlock();
+  }
+
   // raytrace freespace
   for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
     raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
   }
+  for (const std::unique_ptr<RasterSource> & source : raster_sources_) {
+    const ObservationRaster & raster = source->applied;
+    if (!source->apply || raster.cleared_bounds.empty()) {
+      continue;
+    }
+    applyRasterCells(raster.cleared, raster.geometry, source->dx, source->dy, FREE_SPACE);
+    MarkedCells cleared;
+    cleared.add(raster.cleared_bounds.min_x + source->dx, raster.cleared_bounds.min_y + source->dy);
+    cleared.add(raster.cleared_bounds.max_x + source->dx, raster.cleared_bounds.max_y + source->dy);
+    touchCells(cleared, min_x, min_y, max_x, max_y);
+  }
 
-  // place the new obstacles into a priority queue... each with a priority of zero to begin with
-  for (std::vector<Observation>::const_iterator it = observations.begin();
-    it != observations.end(); ++it)
-  {
-    const Observation & obs = *it;
-
-    const sensor_msgs::msg::PointCloud2 & cloud = *(obs.cloud_);
-
-    double sq_obstacle_range = obs.obstacle_range_ * obs.obstacle_range_;
-
-    sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
-
-    for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
-      double px = *iter_x, py = *iter_y, pz = *iter_z;
-
-      // if the obstacle is too high or too far away from the robot we won't add it
-      if (pz > max_obstacle_height_) {
-        RCLCPP_DEBUG(node_->get_logger(), "The point is too high");
-        continue;
-      }
-
-      // compute the squared distance from the hitpoint to the pointcloud's origin
-      double sq_dist =
-        (px -
-        obs.origin_.x) * (px - obs.origin_.x) + (py - obs.origin_.y) * (py - obs.origin_.y) +
-        (pz - obs.origin_.z) * (pz - obs.origin_.z);
-
-      // if the point is far enough away... we won't consider it
-      if (sq_dist >= sq_obstacle_range) {
-        RCLCPP_DEBUG(node_->get_logger(), "The point is too far away");
-        continue;
-      }
-
-      // now we need to compute the map coordinates for the observation
-      unsigned int mx, my;
-      if (!worldToMap(px, py, mx, my)) {
-        RCLCPP_DEBUG(node_->get_logger(), "Computing map coords failed");
-        continue;
-      }
-
-      unsigned int index = getIndex(mx, my);
-      costmap_[index] = LETHAL_OBSTACLE;
-      touch(px, py, min_x, min_y, max_x, max_y);
+  // mark the cells of the new obstacles
+  MarkedCells marked;
+  for (const Observation & obs : observations) {
+    if (!markObservation(obs, max_obstacle_height_, *this, marked)) {
+      RCLCPP_WARN(
+        node_->get_logger(), "%s: an observation cloud has no float32 x, y and z fields",
+        name_.c_str());
     }
   }
+  for (const std::unique_ptr<RasterSource> & source : raster_sources_) {
+    const ObservationRaster & raster = source->applied;
+    if (!source->apply || raster.marked_bounds.empty()) {
+      continue;
+    }
+    applyRasterCells(raster.marked, raster.geometry, source->dx, source->dy, LETHAL_OBSTACLE);
+    marked.add(raster.marked_bounds.min_x + source->dx, raster.marked_bounds.min_y + source->dy);
+    marked.add(raster.marked_bounds.max_x + source->dx, raster.marked_bounds.max_y + source->dy);
+  }
+  if (!marked.empty()) {
+    touchCells(marked, min_x, min_y, max_x, max_y);
+  }
+  // Keeps the capacity but lets go of the clouds
+  observations.clear();
+  clearing_observations.clear();
 
   updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
 }
@@ -427,6 +648,10 @@ ObstacleLayer::updateFootprint(
   for (unsigned int i = 0; i < transformed_footprint_.size(); i++) {
     touch(transformed_footprint_[i].x, transformed_footprint_[i].y, min_x, min_y, max_x, max_y);
   }
+
+  // Clear the footprint here rather than in updateCosts() so that the
+  // latter only reads this layer and can run on tiles concurrently
+  setPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
 }
 
 void
@@ -439,10 +664,6 @@ ObstacleLayer::updateCosts(
     return;
   }
 
-  if (footprint_clearing_enabled_) {
-    setConvexPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
-  }
-
   switch (combination_method_) {
     case 0:  // Overwrite
       updateWithOverwrite(master_grid, min_i, min_j, max_i, max_j);
@@ -486,7 +707,9 @@ ObstacleLayer::getMarkingObservations(std::vector<Observation> & marking_observa
   // get the marking observations
   for (unsigned int i = 0; i < marking_buffers_.size(); ++i) {
     marking_buffers_[i]->lock();
-    marking_buffers_[i]->getObservations(marking_observations);
+    if (!isRasterized(marking_buffers_[i].get())) {
+      marking_buffers_[i]->getObservations(marking_observations);
+    }
     current = marking_buffers_[i]->isCurrent() && current;
     marking_buffers_[i]->unlock();
   }
@@ -503,7 +726,9 @@ ObstacleLayer::getClearingObservations(std::vector<Observation> & clearing_obser
   // get the clearing observations
   for (unsigned int i = 0; i < clearing_buffers_.size(); ++i) {
     clearing_buffers_[i]->lock();
-    clearing_buffers_[i]->getObservations(clearing_observations);
+    if (!isRasterized(clearing_buffers_[i].get())) {
+      clearing_buffers_[i]->getObservations(clearing_observations);
+    }
     current = clearing_buffers_[i]->isCurrent() && current;
     clearing_buffers_[i]->unlock();
   }
@@ -534,6 +759,11 @@ ObstacleLayer::raytraceFreespace(
     return;
   }
 
+  if (clearing_observation.polar_clearing_bins_ > 0) {
+    polarClearFreespace(clearing_observation, x0, y0, min_x, min_y, max_x, max_y);
+    return;
+  }
+
   // we can pre-compute the enpoints of the map outside of the inner loop... we'll need these later
   double origin_x = origin_x_, origin_y = origin_y_;
   double map_end_x = origin_x + size_x_ * resolution_;
@@ -543,7 +773,10 @@ ObstacleLayer::raytraceFreespace(
   touch(ox, oy, min_x, min_y, max_x, max_y);
 
   // for each point in the cloud, we want to trace a line from the origin
-  // and clear obstacles along it
+  // and clear obstacles along it. Collect the end cells first: dense clouds
+  // put many points in the same cell, and tracing those again clears nothing
+  raytrace_ends_.clear();
+  raytrace_ends_.reserve(cloud.width * cloud.height);
   sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
   sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
 
@@ -588,15 +821,134 @@ ObstacleLayer::raytraceFreespace(
       continue;
     }
 
-    unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-    MarkCell marker(costmap_, FREE_SPACE);
-    // and finally... we can execute our trace to clear obstacles along that line
-    raytraceLine(marker, x0, y0, x1, y1, cell_raytrace_range);
+    raytrace_ends_.push_back(getIndex(x1, y1));
 
     updateRaytraceBounds(
       ox, oy, wx, wy, clearing_observation.raytrace_range_, min_x, min_y, max_x,
       max_y);
   }
+
+  std::sort(raytrace_ends_.begin(), raytrace_ends_.end());
+  raytrace_ends_.erase(
+    std::unique(raytrace_ends_.begin(), raytrace_ends_.end()), raytrace_ends_.end());
+
+  const unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+  // and finally... we can execute our traces to clear obstacles along those lines
+  auto trace = [&](auto marker, std::size_t begin, std::size_t end) {
+      raytraceLines(
+        marker, x0, y0, raytrace_ends_.data() + begin, end - begin, cell_raytrace_range);
+    };
+
+  // Spreading a handful of rays over the pool costs more than it saves
+  const std::size_t min_rays_per_task = 256;
+  if (!raytrace_pool_ || raytrace_ends_.size() < 2 * min_rays_per_task) {
+    trace(MarkCell(costmap_, FREE_SPACE), 0, raytrace_ends_.size());
+    return;
+  }
+
+  // Rays traced on different threads cross the same cells, so those clear
+  // with an atomic store. Every store writes FREE_SPACE, so their order
+  // does not matter, and marking only starts once all of them are done.
+  const std::size_t tasks = std::min(
+    raytrace_ends_.size() / min_rays_per_task,
+    static_cast<std::size_t>(raytrace_pool_->size()) * 4);
+  raytrace_pool_->parallelFor(
+    tasks, [&](std::size_t task) {
+      trace(
+        AtomicClearCell(costmap_),
+        raytrace_ends_.size() * task / tasks,
+        raytrace_ends_.size() * (task + 1) / tasks);
+    });
+}
+
+const ObstacleLayer::PolarTable &
+ObstacleLayer::polarTable(unsigned int radius, unsigned int bins)
+{
+  PolarTable & table = polar_tables_[std::make_pair(radius, bins)];
+  if (!table.bin.empty()) {
+    return table;
+  }
+
+  const int r = static_cast<int>(radius);
+  const std::size_t side = 2 * radius + 1;
+  table.bin.resize(side * side);
+  table.range.resize(side * side);
+  std::size_t t = 0;
+  for (int dy = -r; dy <= r; ++dy) {
+    for (int dx = -r; dx <= r; ++dx, ++t) {
+      table.bin[t] = polarBin(dx, dy, bins);
+      table.range[t] = static_cast<float>(std::hypot(dx, dy));
+    }
+  }
+  return table;
+}
+
+unsigned int
+ObstacleLayer::polarBin(double dx, double dy, unsigned int bins)
+{
+  const double turn = (std::atan2(dy, dx) + M_PI) / (2.0 * M_PI);
+  return std::min(static_cast<unsigned int>(turn * bins), bins - 1);
+}
+
+void
+ObstacleLayer::polarClearFreespace(
+  const Observation & clearing_observation, unsigned int x0, unsigned int y0,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  const unsigned int bins = clearing_observation.polar_clearing_bins_;
+  const unsigned int radius = cellDistance(clearing_observation.raytrace_range_);
+  const PolarTable & table = polarTable(radius, bins);
+
+  // the ranges are in cells from the center of the sensor's cell, as in the table
+  double cx, cy;
+  mapToWorld(x0, y0, cx, cy);
+  polar_ranges_.assign(bins, -1.0f);
+  const sensor_msgs::msg::PointCloud2 & cloud = *(clearing_observation.cloud_);
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  bool any = false;
+  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y) {
+    const double dx = (*iter_x - cx) / resolution_;
+    const double dy = (*iter_y - cy) / resolution_;
+    float & range = polar_ranges_[polarBin(dx, dy, bins)];
+    range = std::max(range, static_cast<float>(std::min<double>(std::hypot(dx, dy), radius)));
+    any = true;
+  }
+  if (!any) {
+    return;
+  }
+
+  // one pass over the cells in reach clears those nearer than the return of their bin
+  const int r = static_cast<int>(radius);
+  const int i0 = std::max(static_cast<int>(x0) - r, 0);
+  const int i1 = std::min(static_cast<int>(x0) + r, static_cast<int>(size_x_) - 1);
+  const int j0 = std::max(static_cast<int>(y0) - r, 0);
+  const int j1 = std::min(static_cast<int>(y0) + r, static_cast<int>(size_y_) - 1);
+  int lo_i = x0, hi_i = x0, lo_j = y0, hi_j = y0;
+  for (int j = j0; j <= j1; ++j) {
+    // table index of the cell (0, j) relative to the sensor's
+    const std::ptrdiff_t row = static_cast<std::ptrdiff_t>(j - static_cast<int>(y0) + r) *
+      (2 * r + 1) + r - static_cast<int>(x0);
+    unsigned char * cells = costmap_ + static_cast<std::size_t>(j) * size_x_;
+    for (int i = i0; i <= i1; ++i) {
+      const std::ptrdiff_t t = row + i;
+      if (table.range[t] <= polar_ranges_[table.bin[t]]) {
+        cells[i] = FREE_SPACE;
+        lo_i = std::min(lo_i, i);
+        hi_i = std::max(hi_i, i);
+        lo_j = std::min(lo_j, j);
+        hi_j = std::max(hi_j, j);
+      }
+    }
+  }
+  // the sensor's own cell starts every ray
+  costmap_[getIndex(x0, y0)] = FREE_SPACE;
+
+  double wx, wy;
+  mapToWorld(lo_i, lo_j, wx, wy);
+  touch(wx, wy, min_x, min_y, max_x, max_y);
+  mapToWorld(hi_i, hi_j, wx, wy);
+  touch(wx, wy, min_x, min_y, max_x, max_y);
 }
 
 void
@@ -625,6 +977,19 @@ ObstacleLayer::deactivate()
   }
 }
 
+void
+ObstacleLayer::touchCells(
+  const MarkedCells & cells, double * min_x, double * min_y, double * max_x,
+  double * max_y)
+{
+  // the cell centers keep the bounds to the cells themselves
+  double wx, wy;
+  mapToWorld(cells.min_x, cells.min_y, wx, wy);
+  touch(wx, wy, min_x, min_y, max_x, max_y);
+  mapToWorld(cells.max_x, cells.max_y, wx, wy);
+  touch(wx, wy, min_x, min_y, max_x, max_y);
+}
+
 void
 ObstacleLayer::updateRaytraceBounds(
   double ox, double oy, double wx, double wy, double range,
@@ -35,6 +35,7 @@
 
 #include <angles/angles.h>
 #include <algorithm>
+#include <cmath>
 #include <list>
 #include <limits>
 #include <string>
@@ -64,6 +65,16 @@ void RangeSensorLayer::onInitialize()
   last_reading_time_ = node_->now();
   default_value_ = to_cost(0.5);
 
+  // Read first, matchSize() allocates the grid it selects
+  declareParameter("sparse_storage", rclcpp::ParameterValue(false));
+  node_->get_parameter(name_ + "." + "sparse_storage", sparse_storage_);
+  if (sparse_storage_ && layered_costmap_->isRolling()) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: sparse_storage is not supported by rolling windows, "
+      "using a dense grid", name_.c_str());
+    sparse_storage_ = false;
+  }
+
   matchSize();
   resetRange();
 
@@ -203,6 +214,47 @@ double RangeSensorLayer::sensor_model(double r, double phi, double theta)
   }
 }
 
+const RangeSensorLayer::SensorStencil & RangeSensorLayer::getStencil(
+  double range, double field_of_view)
+{
+  // the costmap cannot place a return any finer than a cell
+  int range_bin = static_cast<int>(std::lround(range / resolution_));
+  auto key = std::make_tuple(field_of_view, range_bin, resolution_);
+  auto it = stencils_.find(key);
+  if (it != stencils_.end()) {
+    return it->second;
+  }
+
+  // ranges only come in so many bins per sensor, this only bounds the
+  // memory used when the resolution or the fields of view keep changing
+  if (stencils_.size() >= 256) {
+    stencils_.clear();
+  }
+
+  // sample the cone out to the 1.2 range the update triangle reaches, with
+  // a margin of a cell; cells outside of it fall back to sensor_model()
+  double r = range_bin * resolution_;
+  double reach = 1.2 * r + resolution_;
+  double half_width = reach * std::sin(std::min(max_angle_, M_PI / 2)) + resolution_;
+
+  SensorStencil & stencil = stencils_[key];
+  stencil.step = resolution_ / 2;
+  stencil.min_x = -resolution_;
+  stencil.min_y = -half_width;
+  stencil.size_x = static_cast<int>(std::ceil((reach - stencil.min_x) / stencil.step)) + 1;
+  stencil.size_y = static_cast<int>(std::ceil(2 * half_width / stencil.step)) + 1;
+  stencil.probabilities.resize(stencil.size_x * stencil.size_y);
+  for (int iy = 0; iy < stencil.size_y; ++iy) {
+    double py = stencil.min_y + iy * stencil.step;
+    for (int ix = 0; ix < stencil.size_x; ++ix) {
+      double px = stencil.min_x + ix * stencil.step;
+      stencil.probabilities[iy * stencil.size_x + ix] =
+        sensor_model(r, std::hypot(px, py), std::atan2(py, px));
+    }
+  }
+  return stencil;
+}
+
 void RangeSensorLayer::bufferIncomingRangeMsg(
   const sensor_msgs::msg::Range::SharedPtr range_message)
 {
@@ -324,7 +376,7 @@ void RangeSensorLayer::updateCostmap(
   // Update Map with Target Point
   unsigned int aa, ab;
   if (worldToMap(tx, ty, aa, ab)) {
-    setCost(aa, ab, 233);
+    setLayerCost(aa, ab, 233);
     touch(tx, ty, &min_x_, &min_y_, &max_x_, &max_y_);
   }
 
@@ -357,6 +409,13 @@ void RangeSensorLayer::updateCostmap(
   bx1 = std::min(static_cast<int>(size_x_), bx1);
   by1 = std::min(static_cast<int>(size_y_), by1);
 
+  // cells are rotated into the sensor frame and read from the stencil of
+  // this range, instead of evaluating the sensor model for each of them
+  const SensorStencil * stencil =
+    clear_sensor_cone ? nullptr : &getStencil(range_message.range, range_message.field_of_view);
+  const double r = range_message.range;
+  const double cos_theta = cos(theta), sin_theta = sin(theta);
+
   for (unsigned int x = bx0; x <= (unsigned int)bx1; x++) {
     for (unsigned int y = by0; y <= (unsigned int)by1; y++) {
       bool update_xy_cell = true;
@@ -378,10 +437,16 @@ void RangeSensorLayer::updateCostmap(
         update_xy_cell = w0 >= bcciath && w1 >= bcciath && w2 >= bcciath;
       }
 
-      if (update_xy_cell) {
+      if (update_xy_cell && x < size_x_ && y < size_y_) {
         double wx, wy;
         mapToWorld(x, y, wx, wy);
-        update_cell(ox, oy, theta, range_message.range, wx, wy, clear_sensor_cone);
+        double sensor = 0.0;
+        if (stencil) {
+          double dx = wx - ox, dy = wy - oy;
+          sensor = stencil_model(
+            *stencil, r, cos_theta * dx + sin_theta * dy, cos_theta * dy - sin_theta * dx);
+        }
+        update_cell(x, y, sensor);
       }
     }
   }
@@ -404,7 +469,7 @@ void RangeSensorLayer::update_cell(
     if (!clear) {
       sensor = sensor_model(r, phi, theta);
     }
-    double prior = to_prob(getCost(x, y));
+    double prior = to_prob(getLayerCost(x, y));
     double prob_occ = sensor * prior;
     double prob_not = (1 - sensor) * (1 - prior);
     double new_prob = prob_occ / (prob_occ + prob_not);
@@ -412,10 +477,19 @@ void RangeSensorLayer::update_cell(
     RCLCPP_DEBUG(node_->get_logger(), "%f %f | %f %f = %f", dx, dy, theta, phi, sensor);
     RCLCPP_DEBUG(node_->get_logger(), "%f | %f %f | %f", prior, prob_occ, prob_not, new_prob);
     unsigned char c = to_cost(new_prob);
-    setCost(x, y, c);
+    setLayerCost(x, y, c);
   }
 }
 
+void RangeSensorLayer::update_cell(unsigned int x, unsigned int y, double sensor)
+{
+  double prior = to_prob(getLayerCost(x, y));
+  double prob_occ = sensor * prior;
+  double prob_not = (1 - sensor) * (1 - prior);
+  double new_prob = prob_occ / (prob_occ + prob_not);
+  setLayerCost(x, y, to_cost(new_prob));
+}
+
 void RangeSensorLayer::resetRange()
 {
   min_x_ = min_y_ = std::numeric_limits<double>::max();
@@ -472,21 +546,16 @@ void RangeSensorLayer::updateCosts(
   unsigned int span = master_grid.getSizeInCellsX();
   unsigned char clear = to_cost(clear_threshold_), mark = to_cost(mark_threshold_);
 
-  for (int j = min_j; j < max_j; j++) {
-    unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      unsigned char prob = costmap_[it];
+  auto update_master = [&](unsigned char prob, unsigned int it) {
       unsigned char current;
       if (prob == nav2_costmap_2d::NO_INFORMATION) {
-        it++;
-        continue;
+        return;
       } else if (prob > mark) {
         current = nav2_costmap_2d::LETHAL_OBSTACLE;
       } else if (prob < clear) {
         current = nav2_costmap_2d::FREE_SPACE;
       } else {
-        it++;
-        continue;
+        return;
       }
 
       unsigned char old_cost = master_array[it];
@@ -494,7 +563,22 @@ void RangeSensorLayer::updateCosts(
       if (old_cost == NO_INFORMATION || old_cost < current) {
         master_array[it] = current;
       }
-      it++;
+    };
+
+  for (int j = min_j; j < max_j; j++) {
+    unsigned int row = j * span;
+    if (sparse_storage_) {
+      sparse_costs_.forEachRowSegment(
+        j, min_i, max_i,
+        [&](const unsigned char * run, unsigned int x, unsigned int length) {
+          for (unsigned int k = 0; k < length; k++) {
+            update_master(run[k], row + x + k);
+          }
+        });
+      continue;
+    }
+    for (int i = min_i; i < max_i; i++) {
+      update_master(costmap_[row + i], row + i);
     }
   }
 
@@ -511,6 +595,68 @@ void RangeSensorLayer::reset()
   activate();
 }
 
+void RangeSensorLayer::initMaps(unsigned int size_x, unsigned int size_y)
+{
+  if (!sparse_storage_) {
+    CostmapLayer::initMaps(size_x, size_y);
+    return;
+  }
+  deleteMaps();
+  sparse_costs_.resize(size_x, size_y, default_value_);
+}
+
+void RangeSensorLayer::resetMaps()
+{
+  if (!sparse_storage_) {
+    CostmapLayer::resetMaps();
+    return;
+  }
+  sparse_costs_.resize(size_x_, size_y_, default_value_);
+}
+
+bool RangeSensorLayer::resetOutside(
+  int x0, int y0, int xn, int yn, unsigned char value,
+  int & min_x, int & min_y, int & max_x, int & max_y)
+{
+  if (!sparse_storage_) {
+    return CostmapLayer::resetOutside(x0, y0, xn, yn, value, min_x, min_y, max_x, max_y);
+  }
+
+  // Cleared cells go back to the prior instead of NO_INFORMATION: neither
+  // touches the master grid, and the prior is what unallocated pages hold
+  if (value == NO_INFORMATION) {
+    value = default_value_;
+  }
+  min_x = size_x_;
+  min_y = size_y_;
+  max_x = -1;
+  max_y = -1;
+  for (int y = 0; y < static_cast<int>(size_y_); y++) {
+    bool yrange = y >= y0 && y < yn;
+    for (int x = 0; x < static_cast<int>(size_x_); x++) {
+      if ((yrange && x >= x0 && x < xn) || sparse_costs_.getCost(x, y) == value) {
+        continue;
+      }
+      sparse_costs_.setCost(x, y, value);
+      min_x = std::min(min_x, x);
+      max_x = std::max(max_x, x);
+      min_y = std::min(min_y, y);
+      max_y = std::max(max_y, y);
+    }
+  }
+  sparse_costs_.compact();
+  return max_x >= 0;
+}
+
+std::size_t RangeSensorLayer::getMemoryUsage() const
+{
+  std::size_t bytes = CostmapLayer::getMemoryUsage() + sparse_costs_.getMemoryUsage();
+  for (const auto & stencil : stencils_) {
+    bytes += stencil.second.probabilities.capacity() * sizeof(double);
+  }
+  return bytes;
+}
+
 void RangeSensorLayer::deactivate()
 {
   range_msgs_buffer_.clear();
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/speed_filter.hpp"
+
+#include <string>
+#include <utility>
+
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::SpeedFilter, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+SpeedFilter::SpeedFilter()
+{
+  transform_.setIdentity();
+}
+
+void
+SpeedFilter::initializeFilter()
+{
+  declareParameter("speed_limit_percentage", rclcpp::ParameterValue(true));
+  declareParameter("base", rclcpp::ParameterValue(0.0));
+  declareParameter("multiplier", rclcpp::ParameterValue(1.0));
+
+  node_->get_parameter(name_ + "." + "speed_limit_percentage", percentage_);
+  node_->get_parameter(name_ + "." + "base", base_);
+  node_->get_parameter(name_ + "." + "multiplier", multiplier_);
+}
+
+void
+SpeedFilter::processMask(const nav_msgs::msg::OccupancyGrid & mask)
+{
+  FilterMask speed(mask, 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  mask_ = std::move(speed);
+  has_transform_ = false;
+}
+
+void
+SpeedFilter::updateBounds(double, double, double, double *, double *, double *, double *)
+{
+  std::string frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mask_.empty()) {
+      return;
+    }
+    frame = mask_.getFrame();
+  }
+
+  // Looked up along with the costmap, rather than on every query from the controller
+  tf2::Transform transform;
+  const bool found = lookupMaskTransform(frame, transform);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mask_.getFrame() == frame) {
+    has_transform_ = found;
+    transform_ = transform;
+  }
+}
+
+SpeedFilter::SpeedLimit
+SpeedFilter::getSpeedLimit(double x, double y) const
+{
+  SpeedLimit limit;
+  limit.percentage = percentage_;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!enabled_ || !has_transform_) {
+    return limit;
+  }
+  const tf2::Vector3 point = transform_ * tf2::Vector3(x, y, 0.0);
+  const int8_t value = mask_.valueAt(point.x(), point.y());
+  if (value > 0) {
+    limit.limited = true;
+    limit.value = base_ + multiplier_ * value;
+  }
+  return limit;
+}
+
+std::size_t
+SpeedFilter::getMemoryUsage() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mask_.getMemoryUsage();
+}
+
+}  // namespace nav2_costmap_2d
@@ -40,8 +40,10 @@
 #include "nav2_costmap_2d/static_layer.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "nav2_costmap_2d/costmap_math.hpp"
 #include "pluginlib/class_list_macros.hpp"
@@ -167,6 +169,17 @@ StaticLayer::processMap(const nav_msgs::msg::OccupancyGrid & new_map)
     "StaticLayer: Received a %d X %d map at %f m/pix", size_x, size_y,
     new_map.info.resolution);
 
+  // a map republished with the same geometry only needs its changed cells
+  // applied, without resizing or invalidating anything downstream
+  if (size_x_ == size_x && size_y_ == size_y && resolution_ == new_map.info.resolution &&
+    origin_x_ == new_map.info.origin.position.x && origin_y_ == new_map.info.origin.position.y &&
+    map_frame_ == new_map.header.frame_id &&
+    new_map.data.size() == static_cast<size_t>(size_x) * size_y)
+  {
+    applyMapDiff(new_map);
+    return;
+  }
+
   // resize costmap if size, resolution or origin do not match
   Costmap2D * master = layered_costmap_->getCostmap();
   if (!layered_costmap_->isRolling() && (master->getSizeInCellsX() != size_x ||
@@ -206,23 +219,72 @@ StaticLayer::processMap(const nav_msgs::msg::OccupancyGrid & new_map)
   // we have a new map, update full size of map
   std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
 
+  unsigned char costs[256];
+  for (unsigned int value = 0; value < 256; ++value) {
+    costs[value] = interpretValue(value);
+  }
+
   // initialize the costmap with static data
   for (unsigned int i = 0; i < size_y; ++i) {
     for (unsigned int j = 0; j < size_x; ++j) {
       unsigned char value = new_map.data[index];
-      costmap_[index] = interpretValue(value);
+      costmap_[index] = costs[value];
       ++index;
     }
   }
 
   map_frame_ = new_map.header.frame_id;
+  rolling_cache_.invalidate();
 
   x_ = y_ = 0;
   width_ = size_x_;
   height_ = size_y_;
   has_updated_data_ = true;
+  ++map_version_;
+
+  current_ = true;
+}
+
+void
+StaticLayer::applyMapDiff(const nav_msgs::msg::OccupancyGrid & new_map)
+{
+  std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+
+  unsigned char costs[256];
+  for (unsigned int value = 0; value < 256; ++value) {
+    costs[value] = interpretValue(value);
+  }
+
+  unsigned int min_x = size_x_, min_y = size_y_, max_x = 0, max_y = 0;
+  unsigned int index = 0;
+  for (unsigned int j = 0; j < size_y_; ++j) {
+    for (unsigned int i = 0; i < size_x_; ++i, ++index) {
+      unsigned char cost = costs[static_cast<unsigned char>(new_map.data[index])];
+      if (cost != costmap_[index]) {
+        costmap_[index] = cost;
+        min_x = std::min(min_x, i);
+        min_y = std::min(min_y, j);
+        max_x = std::max(max_x, i);
+        max_y = std::max(max_y, j);
+      }
+    }
+  }
 
   current_ = true;
+  if (min_x > max_x) {
+    RCLCPP_DEBUG(node_->get_logger(), "StaticLayer: Received an unchanged map");
+    return;
+  }
+
+  RCLCPP_DEBUG(
+    node_->get_logger(), "StaticLayer: Map changed within cells (%u, %u) to (%u, %u)",
+    min_x, min_y, max_x, max_y);
+  double wx0, wy0, wx1, wy1;
+  mapToWorld(min_x, min_y, wx0, wy0);
+  mapToWorld(max_x + 1, max_y + 1, wx1, wy1);
+  addExtraBounds(wx0, wy0, wx1, wy1);
+  rolling_cache_.invalidate();
+  ++map_version_;
 }
 
 void
@@ -238,6 +300,12 @@ StaticLayer::matchSize()
   }
 }
 
+std::size_t
+StaticLayer::getMemoryUsage() const
+{
+  return CostmapLayer::getMemoryUsage() + rolling_cache_.getMemoryUsage();
+}
+
 unsigned char
 StaticLayer::interpretValue(unsigned char value)
 {
@@ -313,6 +381,8 @@ StaticLayer::incomingUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr u
   width_ = update->width;
   height_ = update->height;
   has_updated_data_ = true;
+  rolling_cache_.invalidate();
+  ++map_version_;
 }
 
 
@@ -344,15 +414,18 @@ StaticLayer::updateBounds(
 
   useExtraBounds(min_x, min_y, max_x, max_y);
 
-  double wx, wy;
+  // extra bounds alone, e.g. from a republished map, only cover what changed
+  if (layered_costmap_->isRolling() || has_updated_data_) {
+    double wx, wy;
 
-  mapToWorld(x_, y_, wx, wy);
-  *min_x = std::min(wx, *min_x);
-  *min_y = std::min(wy, *min_y);
+    mapToWorld(x_, y_, wx, wy);
+    *min_x = std::min(wx, *min_x);
+    *min_y = std::min(wy, *min_y);
 
-  mapToWorld(x_ + width_, y_ + height_, wx, wy);
-  *max_x = std::max(wx, *max_x);
-  *max_y = std::max(wy, *max_y);
+    mapToWorld(x_ + width_, y_ + height_, wx, wy);
+    *max_x = std::max(wx, *max_x);
+    *max_y = std::max(wy, *max_y);
+  }
 
   has_updated_data_ = false;
 }
@@ -386,8 +459,6 @@ StaticLayer::updateCosts(
     }
   } else {
     // If rolling window, the master_grid is unlikely to have same coordinates as this layer
-    unsigned int mx, my;
-    double wx, wy;
     // Might even be in a different frame
     geometry_msgs::msg::TransformStamped transform;
     try {
@@ -402,21 +473,20 @@ StaticLayer::updateCosts(
     // Copy map data given proper transformations
     tf2::Transform tf2_transform;
     tf2::fromMsg(transform.transform, tf2_transform);
-
-    for (int i = min_i; i < max_i; ++i) {
-      for (int j = min_j; j < max_j; ++j) {
-        // Convert master_grid coordinates (i,j) into global_frame_(wx,wy) coordinates
-        layered_costmap_->getCostmap()->mapToWorld(i, j, wx, wy);
-        // Transform from global_frame_ to map_frame_
-        tf2::Vector3 p(wx, wy, 0);
-        p = tf2_transform * p;
-        // Set master_grid with cell from map
-        if (worldToMap(p.x(), p.y(), mx, my)) {
-          if (!use_maximum_) {
-            master_grid.setCost(i, j, getCost(mx, my));
-          } else {
-            master_grid.setCost(i, j, std::max(getCost(mx, my), master_grid.getCost(i, j)));
-          }
+    rolling_cache_.update(master_grid, *this, tf2_transform, min_i, min_j, max_i, max_j);
+
+    unsigned char * master = master_grid.getCharMap();
+    unsigned int span = master_grid.getSizeInCellsX();
+    for (int j = min_j; j < max_j; ++j) {
+      unsigned int index = span * j + min_i;
+      for (int i = min_i; i < max_i; ++i, ++index) {
+        if (!rolling_cache_.isInside(index)) {
+          continue;
+        }
+        if (!use_maximum_) {
+          master[index] = rolling_cache_.getCost(index);
+        } else {
+          master[index] = std::max(rolling_cache_.getCost(index), master[index]);
         }
       }
     }
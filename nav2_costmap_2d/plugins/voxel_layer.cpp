@@ -38,16 +38,21 @@
 
 #include "nav2_costmap_2d/voxel_layer.hpp"
 
+#include <algorithm>
+#include <limits>
+
+#include "nav2_costmap_2d/voxel_grid_updates.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <vector>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 #include "pluginlib/class_list_macros.hpp"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 
-#define VOXEL_BITS 16
 PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::VoxelLayer, nav2_costmap_2d::Layer)
 
 using nav2_costmap_2d::NO_INFORMATION;
@@ -71,6 +76,9 @@ void VoxelLayer::onInitialize()
   declareParameter("mark_threshold", rclcpp::ParameterValue(0));
   declareParameter("combination_method", rclcpp::ParameterValue(1));
   declareParameter("publish_voxel_map", rclcpp::ParameterValue(false));
+  declareParameter("sparse_voxel_grid", rclcpp::ParameterValue(false));
+  declareParameter("voxel_map_keyframe_interval", rclcpp::ParameterValue(0.0));
+  declareParameter("compress_voxel_map_updates", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
@@ -82,20 +90,50 @@ void VoxelLayer::onInitialize()
   node_->get_parameter(name_ + "." + "mark_threshold", mark_threshold_);
   node_->get_parameter(name_ + "." + "combination_method", combination_method_);
   node_->get_parameter(name_ + "." + "publish_voxel_map", publish_voxel_);
+  node_->get_parameter(name_ + "." + "sparse_voxel_grid", sparse_);
+  double keyframe_interval = 0.0;
+  node_->get_parameter(name_ + "." + "voxel_map_keyframe_interval", keyframe_interval);
+  voxel_keyframe_interval_ = rclcpp::Duration::from_seconds(std::max(keyframe_interval, 0.0));
+  node_->get_parameter(
+    name_ + "." + "compress_voxel_map_updates", compress_voxel_updates_);
 
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
 
   if (publish_voxel_) {
     voxel_pub_ = node_->create_publisher<nav2_msgs::msg::VoxelGrid>(
       "voxel_grid", custom_qos);
+    voxel_pub_->on_activate();
+    if (voxel_keyframe_interval_ > rclcpp::Duration(0)) {
+      voxel_update_pub_ = node_->create_publisher<nav2_msgs::msg::VoxelGridUpdate>(
+        "voxel_grid_updates", custom_qos);
+      voxel_update_pub_->on_activate();
+    }
   }
 
-  voxel_pub_->on_activate();
-
   clearing_endpoints_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud>(
     "clearing_endpoints", custom_qos);
+  voxel_marked_cloud_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud2>(
+    "voxel_marked_cloud", custom_qos);
+  voxel_unknown_cloud_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud2>(
+    "voxel_unknown_cloud", custom_qos);
+
+  // the tallest dense grid holds 64 levels, or 32 without 128-bit integers
+  unsigned int max_size_z = 64;
+#ifndef __SIZEOF_INT128__
+  max_size_z = 32;
+#endif
+  if (sparse_) {
+    max_size_z = nav2_voxel_grid::SparseVoxelGrid::MAX_SIZE_Z;
+  }
+  if (size_z_ > static_cast<int>(max_size_z)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: z_voxels %d is above the maximum of %u, clamping it",
+      name_.c_str(), size_z_, max_size_z);
+    size_z_ = max_size_z;
+  }
 
-  unknown_threshold_ += (VOXEL_BITS - size_z_);
+  // the levels of a column above size_z_ always stay unknown
+  unknown_threshold_ += (maxSizeZ() - size_z_);
   matchSize();
 }
 
@@ -103,11 +141,37 @@ VoxelLayer::~VoxelLayer()
 {
 }
 
+unsigned int VoxelLayer::maxSizeZ()
+{
+  unsigned int max_size_z = 0;
+  withVoxelGrid(
+    [&](auto & grid) {
+      max_size_z = std::decay_t<decltype(grid)>::MAX_SIZE_Z;
+    });
+  return max_size_z;
+}
+
 void VoxelLayer::matchSize()
 {
   ObstacleLayer::matchSize();
-  voxel_grid_.resize(size_x_, size_y_, size_z_);
-  assert(voxel_grid_.sizeX() == size_x_ && voxel_grid_.sizeY() == size_y_);
+  withVoxelGrid(
+    [this](auto & grid) {
+      grid.resize(size_x_, size_y_, size_z_);
+      assert(grid.sizeX() == size_x_ && grid.sizeY() == size_y_);
+    });
+  voxel_keyframe_due_ = true;
+}
+
+std::size_t VoxelLayer::getMemoryUsage() const
+{
+  // the grids not in use are sized 0 x 0
+  std::size_t bytes = ObstacleLayer::getMemoryUsage() +
+    voxel_grid_.getMemoryUsage() + voxel_grid_64_.getMemoryUsage() +
+    sparse_voxel_grid_.getMemoryUsage();
+#ifdef __SIZEOF_INT128__
+  bytes += voxel_grid_128_.getMemoryUsage();
+#endif
+  return bytes;
 }
 
 void VoxelLayer::reset()
@@ -124,7 +188,8 @@ void VoxelLayer::resetMaps()
   // resetMaps so this goes to the next layer down Costmap2DLayer which also
   // doesn't implement this, so it actually goes all the way to Costmap2D
   ObstacleLayer::resetMaps();
-  voxel_grid_.reset();
+  withVoxelGrid([](auto & grid) {grid.reset();});
+  voxel_keyframe_due_ = true;
 }
 
 void VoxelLayer::updateBounds(
@@ -151,9 +216,16 @@ void VoxelLayer::updateBounds(
   // update the global current status
   current_ = current;
 
+  // bounds of the voxels changed this cycle, apart from the costmap's
+  double voxel_min_x = std::numeric_limits<double>::max();
+  double voxel_min_y = std::numeric_limits<double>::max();
+  double voxel_max_x = std::numeric_limits<double>::lowest();
+  double voxel_max_y = std::numeric_limits<double>::lowest();
+
   // raytrace freespace
   for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
-    raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
+    raytraceFreespace(
+      clearing_observations[i], &voxel_min_x, &voxel_min_y, &voxel_max_x, &voxel_max_y);
   }
 
   // place the new obstacles into a priority queue... each with a priority of zero to begin with
@@ -197,42 +269,137 @@ void VoxelLayer::updateBounds(
       }
 
       // mark the cell in the voxel grid and check if we should also mark it in the costmap
-      if (voxel_grid_.markVoxelInMap(mx, my, mz, mark_threshold_)) {
+      bool mark = false;
+      withVoxelGrid(
+        [&](auto & grid) {
+          mark = grid.markVoxelInMap(mx, my, mz, mark_threshold_);
+        });
+      if (mark) {
         unsigned int index = getIndex(mx, my);
 
         costmap_[index] = LETHAL_OBSTACLE;
         touch(
           static_cast<double>(*iter_x), static_cast<double>(*iter_y),
-          min_x, min_y, max_x, max_y);
+          &voxel_min_x, &voxel_min_y, &voxel_max_x, &voxel_max_y);
       }
     }
   }
 
+  *min_x = std::min(*min_x, voxel_min_x);
+  *min_y = std::min(*min_y, voxel_min_y);
+  *max_x = std::max(*max_x, voxel_max_x);
+  *max_y = std::max(*max_y, voxel_max_y);
+
   if (publish_voxel_) {
-    auto grid_msg = std::make_unique<nav2_msgs::msg::VoxelGrid>();
-    unsigned int size = voxel_grid_.sizeX() * voxel_grid_.sizeY();
-    grid_msg->size_x = voxel_grid_.sizeX();
-    grid_msg->size_y = voxel_grid_.sizeY();
-    grid_msg->size_z = voxel_grid_.sizeZ();
-    grid_msg->data.resize(size);
-    memcpy(&grid_msg->data[0], voxel_grid_.getData(), size * sizeof(unsigned int));
-
-    grid_msg->origin.x = origin_x_;
-    grid_msg->origin.y = origin_y_;
-    grid_msg->origin.z = origin_z_;
-
-    grid_msg->resolutions.x = resolution_;
-    grid_msg->resolutions.y = resolution_;
-    grid_msg->resolutions.z = z_resolution_;
-    grid_msg->header.frame_id = global_frame_;
-    grid_msg->header.stamp = node_->now();
-
-    voxel_pub_->publish(std::move(grid_msg));
+    publishVoxelGrid(voxel_min_x, voxel_min_y, voxel_max_x, voxel_max_y);
   }
 
+  publishVoxelCloud(voxel_marked_cloud_pub_, nav2_voxel_grid::MARKED);
+  publishVoxelCloud(voxel_unknown_cloud_pub_, nav2_voxel_grid::UNKNOWN);
+
   updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
 }
 
+void VoxelLayer::publishVoxelGrid(double min_x, double min_y, double max_x, double max_y)
+{
+  const rclcpp::Time now = node_->now();
+  // as for the costmap updates, a clock jumping back also sends a keyframe
+  const bool keyframe = voxel_keyframe_due_ || !voxel_update_pub_ ||
+    last_voxel_keyframe_ + voxel_keyframe_interval_ < now || now < last_voxel_keyframe_;
+  const bool moved = origin_x_ != published_origin_x_ || origin_y_ != published_origin_y_;
+  published_origin_x_ = origin_x_;
+  published_origin_y_ = origin_y_;
+
+  if (!keyframe) {
+    const bool changed = min_x <= max_x && min_y <= max_y;
+    if (!changed && !moved) {
+      return;
+    }
+
+    auto update = std::make_unique<nav2_msgs::msg::VoxelGridUpdate>();
+    int x0 = 0, y0 = 0, xn = -1, yn = -1;
+    if (changed) {
+      worldToMapEnforceBounds(min_x, min_y, x0, y0);
+      worldToMapEnforceBounds(max_x, max_y, xn, yn);
+    }
+    withVoxelGrid(
+      [&](auto & grid) {
+        fillVoxelGridUpdate(
+          grid, x0, y0, xn - x0 + 1, yn - y0 + 1, compress_voxel_updates_, *update);
+      });
+    update->origin.x = origin_x_;
+    update->origin.y = origin_y_;
+    update->origin.z = origin_z_;
+    update->header.frame_id = global_frame_;
+    update->header.stamp = now;
+    voxel_update_pub_->publish(std::move(update));
+    return;
+  }
+
+  auto grid_msg = std::make_unique<nav2_msgs::msg::VoxelGrid>();
+  withVoxelGrid(
+    [&](auto & grid) {
+      unsigned int size = grid.sizeX() * grid.sizeY();
+      grid_msg->size_x = grid.sizeX();
+      grid_msg->size_y = grid.sizeY();
+      grid_msg->size_z = grid.sizeZ();
+      grid_msg->words_per_column = grid.wordsPerColumn();
+      grid_msg->data.resize(size * grid_msg->words_per_column);
+      grid.copyColumnWords(0, 0, grid.sizeX(), grid.sizeY(), grid_msg->data.data());
+    });
+
+  grid_msg->origin.x = origin_x_;
+  grid_msg->origin.y = origin_y_;
+  grid_msg->origin.z = origin_z_;
+
+  grid_msg->resolutions.x = resolution_;
+  grid_msg->resolutions.y = resolution_;
+  grid_msg->resolutions.z = z_resolution_;
+  grid_msg->header.frame_id = global_frame_;
+  grid_msg->header.stamp = now;
+
+  voxel_pub_->publish(std::move(grid_msg));
+  last_voxel_keyframe_ = now;
+  voxel_keyframe_due_ = false;
+}
+
+void VoxelLayer::publishVoxelCloud(
+  const rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr & publisher,
+  nav2_voxel_grid::VoxelStatus status)
+{
+  if (publisher->get_subscription_count() == 0) {
+    return;
+  }
+
+  auto cloud = std::make_unique<sensor_msgs::msg::PointCloud2>();
+  cloud->header.frame_id = global_frame_;
+  cloud->header.stamp = node_->now();
+
+  sensor_msgs::PointCloud2Modifier modifier(*cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+
+  withVoxelGrid(
+    [&](auto & grid) {
+      modifier.resize(grid.countVoxels(status));
+      sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud, "x");
+      sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud, "y");
+      sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud, "z");
+      grid.forEachVoxel(
+        status, [&](unsigned int mx, unsigned int my, unsigned int mz) {
+          double wx, wy, wz;
+          mapToWorld3D(mx, my, mz, wx, wy, wz);
+          *iter_x = wx;
+          *iter_y = wy;
+          *iter_z = wz;
+          ++iter_x;
+          ++iter_y;
+          ++iter_z;
+        });
+    });
+
+  publisher->publish(std::move(cloud));
+}
+
 void VoxelLayer::clearNonLethal(
   double wx, double wy, double w_size_x, double w_size_y,
   bool clear_no_info)
@@ -275,7 +442,7 @@ void VoxelLayer::clearNonLethal(
       if (*current != LETHAL_OBSTACLE) {
         if (clear_no_info || *current != NO_INFORMATION) {
           *current = FREE_SPACE;
-          voxel_grid_.clearVoxelColumn(index);
+          withVoxelGrid([index](auto & grid) {grid.clearVoxelColumn(index);});
         }
       }
       current++;
@@ -324,6 +491,10 @@ void VoxelLayer::raytraceFreespace(
   double map_end_y = origin_y_ + getSizeInMetersY();
   double map_end_z = origin_z_ + getSizeInMetersZ();
 
+  // the rays are all traced together once their end points are known
+  clearing_ends_.clear();
+  clearing_ends_.reserve(clearing_observation_cloud_size);
+
   sensor_msgs::PointCloud2ConstIterator<float> iter_x(*(clearing_observation.cloud_), "x");
   sensor_msgs::PointCloud2ConstIterator<float> iter_y(*(clearing_observation.cloud_), "y");
   sensor_msgs::PointCloud2ConstIterator<float> iter_z(*(clearing_observation.cloud_), "z");
@@ -377,14 +548,7 @@ void VoxelLayer::raytraceFreespace(
 
     double point_x, point_y, point_z;
     if (worldToMap3DFloat(wpx, wpy, wpz, point_x, point_y, point_z)) {
-      unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-
-      // voxel_grid_.markVoxelLine(sensor_x, sensor_y, sensor_z, point_x, point_y, point_z);
-      voxel_grid_.clearVoxelLineInMap(
-        sensor_x, sensor_y, sensor_z, point_x, point_y, point_z,
-        costmap_,
-        unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
-        cell_raytrace_range);
+      clearing_ends_.push_back({point_x, point_y, point_z});
 
       updateRaytraceBounds(
         ox, oy, wpx, wpy, clearing_observation.raytrace_range_, min_x, min_y,
@@ -401,6 +565,15 @@ void VoxelLayer::raytraceFreespace(
     }
   }
 
+  unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+  withVoxelGrid(
+    [&](auto & grid) {
+      grid.clearVoxelLinesInMap(
+        sensor_x, sensor_y, sensor_z, clearing_ends_, costmap_,
+        unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+        cell_raytrace_range);
+    });
+
   if (publish_clearing_points) {
     clearing_endpoints_->header.frame_id = global_frame_;
     clearing_endpoints_->header.stamp = clearing_observation.cloud_->header.stamp;
@@ -422,58 +595,17 @@ void VoxelLayer::updateOrigin(double new_origin_x, double new_origin_y)
   new_grid_ox = origin_x_ + cell_ox * resolution_;
   new_grid_oy = origin_y_ + cell_oy * resolution_;
 
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-  unsigned int * local_voxel_map = new unsigned int[cell_size_x * cell_size_y];
-  unsigned int * voxel_map = voxel_grid_.getData();
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(
-    costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-  copyMapRegion(
-    voxel_map, lower_left_x, lower_left_y, size_x_, local_voxel_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // we'll reset our maps to unknown space if appropriate
-  resetMaps();
+  // move the overlaps of the old and new windows to their new location, the
+  // cells the window moved onto become unknown
+  {
+    std::unique_lock<mutex_t> lock(*access_);
+    shiftMapRegion(costmap_, cell_ox, cell_oy, default_value_);
+  }
+  withVoxelGrid([&](auto & grid) {shiftVoxelGrid(grid, cell_ox, cell_oy);});
 
   // update the origin with the appropriate world coordinates
   origin_x_ = new_grid_ox;
   origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(
-    local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-  copyMapRegion(
-    local_voxel_map, 0, 0, cell_size_x, voxel_map, start_x, start_y, size_x_,
-    cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
-  delete[] local_voxel_map;
 }
 
 }  // namespace nav2_costmap_2d
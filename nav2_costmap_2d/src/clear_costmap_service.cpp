@@ -145,7 +145,7 @@ void ClearCostmapService::clearAroundRobot(double window_size_x, double window_s
   pt.y = pose_y + window_size_y / 2;
   clear_poly.push_back(pt);
 
-  costmap_.getCostmap()->setConvexPolygonCost(clear_poly, reset_value_);
+  costmap_.getCostmap()->setPolygonCost(clear_poly, reset_value_);
 }
 
 void ClearCostmapService::clearEntirely()
@@ -173,22 +173,8 @@ void ClearCostmapService::clearLayerExceptRegion(
   costmap->worldToMapNoBounds(start_point_x, start_point_y, start_x, start_y);
   costmap->worldToMapNoBounds(end_point_x, end_point_y, end_x, end_y);
 
-  unsigned int size_x = costmap->getSizeInCellsX();
-  unsigned int size_y = costmap->getSizeInCellsY();
-
-  // Clearing the four rectangular regions around the one we want to keep
-  // top region
-  costmap->resetMapToValue(0, 0, size_x, start_y, reset_value_);
-  // left region
-  costmap->resetMapToValue(0, start_y, start_x, end_y, reset_value_);
-  // right region
-  costmap->resetMapToValue(end_x, start_y, size_x, end_y, reset_value_);
-  // bottom region
-  costmap->resetMapToValue(0, end_y, size_x, size_y, reset_value_);
-
-  double ox = costmap->getOriginX(), oy = costmap->getOriginY();
-  double width = costmap->getSizeInMetersX(), height = costmap->getSizeInMetersY();
-  costmap->addExtraBounds(ox, oy, ox + width, oy + height);
+  // Only the cells that were not at the reset value yet are redrawn on the next update
+  costmap->resetExceptArea(start_x, start_y, end_x, end_y, reset_value_);
 }
 
 bool ClearCostmapService::getPosition(double & x, double & y) const
@@ -0,0 +1,244 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/cloud_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_COSTMAP_2D_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+inline void writeFloat(uint8_t * point, uint32_t offset, float value)
+{
+  memcpy(point + offset, &value, sizeof(float));
+}
+
+}  // namespace
+
+bool floatFieldOffset(
+  const sensor_msgs::msg::PointCloud2 & cloud, const std::string & name, uint32_t & offset)
+{
+  for (const auto & field : cloud.fields) {
+    if (field.name == name) {
+      offset = field.offset;
+      return field.datatype == sensor_msgs::msg::PointField::FLOAT32;
+    }
+  }
+  return false;
+}
+
+bool transformAndFilterCloud(
+  const sensor_msgs::msg::PointCloud2 & in, const float transform[12],
+  const CloudFilter & filter, std::unordered_set<uint64_t> & voxels,
+  sensor_msgs::msg::PointCloud2 & out)
+{
+  out.header = in.header;
+  out.height = 1;
+  out.width = 0;
+  out.fields = in.fields;
+  out.is_bigendian = in.is_bigendian;
+  out.point_step = in.point_step;
+  out.row_step = 0;
+  out.is_dense = in.is_dense;
+  out.data.clear();
+
+  uint32_t offset_x, offset_y, offset_z;
+  if (!floatFieldOffset(in, "x", offset_x) || !floatFieldOffset(in, "y", offset_y) ||
+    !floatFieldOffset(in, "z", offset_z))
+  {
+    return false;
+  }
+
+  const std::size_t num_points = static_cast<std::size_t>(in.width) * in.height;
+  const uint32_t step = in.point_step;
+  // resize() only grows the recycled storage, it never shrinks it
+  out.data.resize(num_points * step);
+
+  const bool downsample = filter.voxel_size > 0.0;
+  const double inv_voxel_size = downsample ? 1.0 / filter.voxel_size : 0.0;
+  if (downsample) {
+    voxels.clear();
+    voxels.reserve(num_points);
+  }
+
+#ifdef NAV2_COSTMAP_2D_SSE2
+  // Columns of [R|t], the unused fourth lane stays zero
+  const __m128 col_x = _mm_setr_ps(transform[0], transform[4], transform[8], 0.0f);
+  const __m128 col_y = _mm_setr_ps(transform[1], transform[5], transform[9], 0.0f);
+  const __m128 col_z = _mm_setr_ps(transform[2], transform[6], transform[10], 0.0f);
+  const __m128 col_t = _mm_setr_ps(transform[3], transform[7], transform[11], 0.0f);
+#endif
+
+  uint8_t * out_point = out.data.data();
+  std::size_t kept = 0;
+  // The rows of an organized cloud may be padded past width * point_step
+  for (uint32_t row = 0; row < in.height; ++row) {
+    const uint8_t * in_point = in.data.data() + static_cast<std::size_t>(row) * in.row_step;
+    for (uint32_t col = 0; col < in.width; ++col, in_point += step) {
+      const float x = readFloat(in_point, offset_x);
+      const float y = readFloat(in_point, offset_y);
+      const float z = readFloat(in_point, offset_z);
+
+      float p[4];
+#ifdef NAV2_COSTMAP_2D_SSE2
+      __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(col_x, _mm_set1_ps(x)), _mm_mul_ps(col_y, _mm_set1_ps(y))),
+        _mm_add_ps(_mm_mul_ps(col_z, _mm_set1_ps(z)), col_t));
+      _mm_storeu_ps(p, r);
+#else
+      p[0] = transform[0] * x + transform[1] * y + transform[2] * z + transform[3];
+      p[1] = transform[4] * x + transform[5] * y + transform[6] * z + transform[7];
+      p[2] = transform[8] * x + transform[9] * y + transform[10] * z + transform[11];
+#endif
+
+      if (p[2] > filter.max_z || p[2] < filter.min_z) {
+        continue;
+      }
+      if (downsample && !voxels.insert(voxelKey(p[0], p[1], p[2], inv_voxel_size)).second) {
+        continue;
+      }
+
+      memcpy(out_point, in_point, step);
+      writeFloat(out_point, offset_x, p[0]);
+      writeFloat(out_point, offset_y, p[1]);
+      writeFloat(out_point, offset_z, p[2]);
+      out_point += step;
+      ++kept;
+    }
+  }
+
+  out.data.resize(kept * step);
+  out.width = static_cast<uint32_t>(kept);
+  out.row_step = out.width * step;
+  return true;
+}
+
+bool ScanAngles::update(const sensor_msgs::msg::LaserScan & scan)
+{
+  if (scan.angle_min == angle_min && scan.angle_increment == angle_increment &&
+    scan.ranges.size() == cos_table.size())
+  {
+    return false;
+  }
+
+  angle_min = scan.angle_min;
+  angle_increment = scan.angle_increment;
+  cos_table.resize(scan.ranges.size());
+  sin_table.resize(scan.ranges.size());
+  for (std::size_t i = 0; i < scan.ranges.size(); ++i) {
+    const double angle = static_cast<double>(angle_min) + i * static_cast<double>(angle_increment);
+    cos_table[i] = static_cast<float>(std::cos(angle));
+    sin_table[i] = static_cast<float>(std::sin(angle));
+  }
+  return true;
+}
+
+void transformAndFilterScan(
+  const sensor_msgs::msg::LaserScan & scan, const ScanAngles & angles,
+  const float transform[12], bool inf_is_valid, const CloudFilter & filter,
+  std::unordered_set<uint64_t> & voxels, sensor_msgs::msg::PointCloud2 & out)
+{
+  const uint32_t step = 3 * sizeof(float);
+  out.header = scan.header;
+  out.height = 1;
+  out.width = 0;
+  if (out.fields.size() != 3) {
+    const char * names[] = {"x", "y", "z"};
+    out.fields.resize(3);
+    for (uint32_t i = 0; i < 3; ++i) {
+      out.fields[i].name = names[i];
+      out.fields[i].offset = i * sizeof(float);
+      out.fields[i].datatype = sensor_msgs::msg::PointField::FLOAT32;
+      out.fields[i].count = 1;
+    }
+  }
+  out.is_bigendian = false;
+  out.point_step = step;
+  out.is_dense = true;
+  const std::size_t num_beams = std::min(scan.ranges.size(), angles.cos_table.size());
+  out.data.resize(num_beams * step);
+
+  const bool downsample = filter.voxel_size > 0.0;
+  const double inv_voxel_size = downsample ? 1.0 / filter.voxel_size : 0.0;
+  if (downsample) {
+    voxels.clear();
+    voxels.reserve(num_beams);
+  }
+
+  // A tenth of a millimeter short of range_max, as the projection of infinities always was
+  const float inf_range = scan.range_max - 0.0001f;
+
+#ifdef NAV2_COSTMAP_2D_SSE2
+  // The beams lie in the z = 0 plane of the scanner, only two columns of R are needed
+  const __m128 col_x = _mm_setr_ps(transform[0], transform[4], transform[8], 0.0f);
+  const __m128 col_y = _mm_setr_ps(transform[1], transform[5], transform[9], 0.0f);
+  const __m128 col_t = _mm_setr_ps(transform[3], transform[7], transform[11], 0.0f);
+#endif
+
+  uint8_t * out_point = out.data.data();
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < num_beams; ++i) {
+    float range = scan.ranges[i];
+    if (inf_is_valid && std::isinf(range) && range > 0.0f) {
+      range = inf_range;
+    }
+    // NaNs fail both comparisons
+    if (!(range < scan.range_max && range >= scan.range_min)) {
+      continue;
+    }
+    const float x = range * angles.cos_table[i];
+    const float y = range * angles.sin_table[i];
+
+    float p[4];
+#ifdef NAV2_COSTMAP_2D_SSE2
+    __m128 r = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(col_x, _mm_set1_ps(x)), _mm_mul_ps(col_y, _mm_set1_ps(y))), col_t);
+    _mm_storeu_ps(p, r);
+#else
+    p[0] = transform[0] * x + transform[1] * y + transform[3];
+    p[1] = transform[4] * x + transform[5] * y + transform[7];
+    p[2] = transform[8] * x + transform[9] * y + transform[11];
+#endif
+
+    if (p[2] > filter.max_z || p[2] < filter.min_z) {
+      continue;
+    }
+    if (downsample && !voxels.insert(voxelKey(p[0], p[1], p[2], inv_voxel_size)).second) {
+      continue;
+    }
+
+    memcpy(out_point, p, step);
+    out_point += step;
+    ++kept;
+  }
+
+  out.data.resize(kept * step);
+  out.width = static_cast<uint32_t>(kept);
+  out.row_step = out.width * step;
+}
+
+}  // namespace nav2_costmap_2d
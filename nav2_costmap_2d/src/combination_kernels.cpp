@@ -0,0 +1,295 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/combination_kernels.hpp"
+
+#include <string>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_COSTMAP_2D_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 is compiled per function and only used when the CPU reports it
+#define NAV2_COSTMAP_2D_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NAV2_COSTMAP_2D_NEON
+#include <arm_neon.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+typedef void (* RowKernel)(unsigned char *, const unsigned char *, unsigned int);
+
+const unsigned char ADDITION_CAP = INSCRIBED_INFLATED_OBSTACLE - 1;
+
+// Scalar references, also used for the tail of each row
+
+inline unsigned char maxCell(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  return (master == NO_INFORMATION || master < layer) ? layer : master;
+}
+
+inline unsigned char overwriteCell(unsigned char master, unsigned char layer)
+{
+  return layer == NO_INFORMATION ? master : layer;
+}
+
+inline unsigned char additionCell(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  if (master == NO_INFORMATION) {
+    return layer;
+  }
+  int sum = master + layer;
+  return sum >= INSCRIBED_INFLATED_OBSTACLE ? ADDITION_CAP : static_cast<unsigned char>(sum);
+}
+
+void maxScalar(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  for (unsigned int i = 0; i < n; ++i) {
+    master[i] = maxCell(master[i], layer[i]);
+  }
+}
+
+void overwriteScalar(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  for (unsigned int i = 0; i < n; ++i) {
+    master[i] = overwriteCell(master[i], layer[i]);
+  }
+}
+
+void additionScalar(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  for (unsigned int i = 0; i < n; ++i) {
+    master[i] = additionCell(master[i], layer[i]);
+  }
+}
+
+#ifdef NAV2_COSTMAP_2D_SSE2
+
+// blend(mask, a, b) = mask ? a : b
+inline __m128i blend128(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void maxSSE2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    // Unknown master cells take the layer value: treat them as 0 for the max
+    __m128i known_m = _mm_andnot_si128(_mm_cmpeq_epi8(m, unknown), m);
+    __m128i r = blend128(_mm_cmpeq_epi8(l, unknown), m, _mm_max_epu8(known_m, l));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), r);
+  }
+  maxScalar(master + i, layer + i, n - i);
+}
+
+void overwriteSSE2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    __m128i r = blend128(_mm_cmpeq_epi8(l, unknown), m, l);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), r);
+  }
+  overwriteScalar(master + i, layer + i, n - i);
+}
+
+void additionSSE2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  const __m128i cap = _mm_set1_epi8(static_cast<char>(ADDITION_CAP));
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    // Saturating add then clamp: any sum >= INSCRIBED_INFLATED_OBSTACLE becomes the cap
+    __m128i sum = _mm_min_epu8(_mm_adds_epu8(m, l), cap);
+    __m128i r = blend128(_mm_cmpeq_epi8(m, unknown), l, sum);
+    r = blend128(_mm_cmpeq_epi8(l, unknown), m, r);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), r);
+  }
+  additionScalar(master + i, layer + i, n - i);
+}
+
+#endif  // NAV2_COSTMAP_2D_SSE2
+
+#ifdef NAV2_COSTMAP_2D_AVX2
+
+__attribute__((target("avx2")))
+void maxAVX2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m256i unknown = _mm256_set1_epi8(static_cast<char>(NO_INFORMATION));
+  unsigned int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(master + i));
+    __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layer + i));
+    __m256i known_m = _mm256_andnot_si256(_mm256_cmpeq_epi8(m, unknown), m);
+    __m256i r = _mm256_blendv_epi8(
+      _mm256_max_epu8(known_m, l), m, _mm256_cmpeq_epi8(l, unknown));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(master + i), r);
+  }
+  maxSSE2(master + i, layer + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void overwriteAVX2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m256i unknown = _mm256_set1_epi8(static_cast<char>(NO_INFORMATION));
+  unsigned int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(master + i));
+    __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layer + i));
+    __m256i r = _mm256_blendv_epi8(l, m, _mm256_cmpeq_epi8(l, unknown));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(master + i), r);
+  }
+  overwriteSSE2(master + i, layer + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void additionAVX2(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const __m256i unknown = _mm256_set1_epi8(static_cast<char>(NO_INFORMATION));
+  const __m256i cap = _mm256_set1_epi8(static_cast<char>(ADDITION_CAP));
+  unsigned int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(master + i));
+    __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layer + i));
+    __m256i sum = _mm256_min_epu8(_mm256_adds_epu8(m, l), cap);
+    __m256i r = _mm256_blendv_epi8(sum, l, _mm256_cmpeq_epi8(m, unknown));
+    r = _mm256_blendv_epi8(r, m, _mm256_cmpeq_epi8(l, unknown));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(master + i), r);
+  }
+  additionSSE2(master + i, layer + i, n - i);
+}
+
+#endif  // NAV2_COSTMAP_2D_AVX2
+
+#ifdef NAV2_COSTMAP_2D_NEON
+
+void maxNEON(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    uint8x16_t known_m = vbicq_u8(m, vceqq_u8(m, unknown));
+    uint8x16_t r = vbslq_u8(vceqq_u8(l, unknown), m, vmaxq_u8(known_m, l));
+    vst1q_u8(master + i, r);
+  }
+  maxScalar(master + i, layer + i, n - i);
+}
+
+void overwriteNEON(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    vst1q_u8(master + i, vbslq_u8(vceqq_u8(l, unknown), m, l));
+  }
+  overwriteScalar(master + i, layer + i, n - i);
+}
+
+void additionNEON(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  const uint8x16_t cap = vdupq_n_u8(ADDITION_CAP);
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t l = vld1q_u8(layer + i);
+    uint8x16_t sum = vminq_u8(vqaddq_u8(m, l), cap);
+    uint8x16_t r = vbslq_u8(vceqq_u8(m, unknown), l, sum);
+    vst1q_u8(master + i, vbslq_u8(vceqq_u8(l, unknown), m, r));
+  }
+  additionScalar(master + i, layer + i, n - i);
+}
+
+#endif  // NAV2_COSTMAP_2D_NEON
+
+struct Kernels
+{
+  RowKernel max;
+  RowKernel overwrite;
+  RowKernel addition;
+  const char * name;
+};
+
+Kernels selectKernels()
+{
+#ifdef NAV2_COSTMAP_2D_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return {maxAVX2, overwriteAVX2, additionAVX2, "AVX2"};
+  }
+#endif
+#if defined(NAV2_COSTMAP_2D_SSE2)
+  return {maxSSE2, overwriteSSE2, additionSSE2, "SSE2"};
+#elif defined(NAV2_COSTMAP_2D_NEON)
+  return {maxNEON, overwriteNEON, additionNEON, "NEON"};
+#else
+  return {maxScalar, overwriteScalar, additionScalar, "scalar"};
+#endif
+}
+
+const Kernels & kernels()
+{
+  static const Kernels selected = selectKernels();
+  return selected;
+}
+
+}  // namespace
+
+void combineRowMax(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  kernels().max(master, layer, n);
+}
+
+void combineRowOverwrite(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  kernels().overwrite(master, layer, n);
+}
+
+void combineRowAddition(unsigned char * master, const unsigned char * layer, unsigned int n)
+{
+  kernels().addition(master, layer, n);
+}
+
+std::string combinationKernelsName()
+{
+  return kernels().name;
+}
+
+}  // namespace nav2_costmap_2d
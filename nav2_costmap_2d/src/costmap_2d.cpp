@@ -42,6 +42,8 @@
 #include <string>
 #include <vector>
 
+#include "nav2_costmap_2d/grid_buffer_pool.hpp"
+
 namespace nav2_costmap_2d
 {
 Costmap2D::Costmap2D(
@@ -61,15 +63,26 @@ void Costmap2D::deleteMaps()
 {
   // clean up data
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
+  if (costmap_capacity_ > 0) {
+    GridBufferPool::instance().release(costmap_, costmap_capacity_);
+  }
   costmap_ = NULL;
+  costmap_capacity_ = 0;
 }
 
 void Costmap2D::initMaps(unsigned int size_x, unsigned int size_y)
 {
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
-  costmap_ = new unsigned char[size_x * size_y];
+  const std::size_t size = static_cast<std::size_t>(size_x) * size_y;
+  // A buffer big enough is kept, unless most of it would go unused
+  if (costmap_capacity_ > 0 && size <= costmap_capacity_ && 2 * size >= costmap_capacity_) {
+    return;
+  }
+  GridBufferPool & pool = GridBufferPool::instance();
+  if (costmap_capacity_ > 0) {
+    pool.release(costmap_, costmap_capacity_);
+  }
+  costmap_ = pool.acquire(size, costmap_capacity_);
 }
 
 void Costmap2D::resizeMap(
@@ -120,10 +133,7 @@ bool Costmap2D::copyCostmapWindow(
     return false;
   }
 
-  // clean up old data
-  deleteMaps();
-
-  // compute the bounds of our new map
+  // compute the bounds of our new map, the old one is only replaced if they are valid
   unsigned int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
   if (!map.worldToMap(win_origin_x, win_origin_y, lower_left_x, lower_left_y) ||
     !map.worldToMap(
@@ -140,7 +150,8 @@ bool Costmap2D::copyCostmapWindow(
   origin_x_ = win_origin_x;
   origin_y_ = win_origin_y;
 
-  // initialize our various maps and reset markers for inflation
+  // initialize our various maps and reset markers for inflation, keeping the buffer of
+  // repeated copies of same sized windows
   initMaps(size_x_, size_y_);
 
   // copy the window of the static map and the costmap that we're taking
@@ -158,17 +169,22 @@ Costmap2D & Costmap2D::operator=(const Costmap2D & map)
     return *this;
   }
 
-  // clean up old data
-  deleteMaps();
+  // only reallocate when the size changes, so that repeated copies into the
+  // same map (e.g. costmap snapshots) reuse the existing buffer
+  if (costmap_ == NULL || size_x_ != map.size_x_ || size_y_ != map.size_y_) {
+    // clean up old data
+    deleteMaps();
+
+    // initialize our various maps
+    initMaps(map.size_x_, map.size_y_);
+  }
 
   size_x_ = map.size_x_;
   size_y_ = map.size_y_;
   resolution_ = map.resolution_;
   origin_x_ = map.origin_x_;
   origin_y_ = map.origin_y_;
-
-  // initialize our various maps
-  initMaps(size_x_, size_y_);
+  default_value_ = map.default_value_;
 
   // copy the cost map
   memcpy(costmap_, map.costmap_, size_x_ * size_y_ * sizeof(unsigned char));
@@ -280,56 +296,33 @@ void Costmap2D::updateOrigin(double new_origin_x, double new_origin_y)
   new_grid_ox = origin_x_ + cell_ox * resolution_;
   new_grid_oy = origin_y_ + cell_oy * resolution_;
 
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(
-    costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // now we'll set the costmap to be completely unknown if we track unknown space
-  resetMaps();
+  // move the overlap of the old and new windows to its new location, and set
+  // the cells the window moved onto to unknown if we track unknown space
+  {
+    std::unique_lock<mutex_t> lock(*access_);
+    shiftMapRegion(costmap_, cell_ox, cell_oy, default_value_);
+  }
 
   // update the origin with the appropriate world coordinates
   origin_x_ = new_grid_ox;
   origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(
-    local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
 }
 
 bool Costmap2D::setConvexPolygonCost(
   const std::vector<geometry_msgs::msg::Point> & polygon,
   unsigned char cost_value)
+{
+  return setPolygonCost(polygon, cost_value);
+}
+
+bool Costmap2D::setPolygonCost(
+  const std::vector<geometry_msgs::msg::Point> & polygon,
+  unsigned char cost_value)
 {
   // we assume the polygon is given in the global_frame...
   // we need to transform it to map coordinates
   std::vector<MapLocation> map_polygon;
+  map_polygon.reserve(polygon.size());
   for (unsigned int i = 0; i < polygon.size(); ++i) {
     MapLocation loc;
     if (!worldToMap(polygon[i].x, polygon[i].y, loc.x, loc.y)) {
@@ -339,16 +332,15 @@ bool Costmap2D::setConvexPolygonCost(
     map_polygon.push_back(loc);
   }
 
-  std::vector<MapLocation> polygon_cells;
-
-  // get the cells that fill the polygon
-  convexFillCells(map_polygon, polygon_cells);
-
-  // set the cost of those cells
-  for (unsigned int i = 0; i < polygon_cells.size(); ++i) {
-    unsigned int index = getIndex(polygon_cells[i].x, polygon_cells[i].y);
-    costmap_[index] = cost_value;
+  // a polygon needs at least a triangle to have an inside
+  if (map_polygon.size() < 3) {
+    return true;
   }
+
+  forEachPolygonSpan(
+    map_polygon, [this, cost_value](unsigned int y, unsigned int min_x, unsigned int max_x) {
+      memset(costmap_ + getIndex(min_x, y), cost_value, max_x - min_x + 1);
+    });
   return true;
 }
 
@@ -378,64 +370,15 @@ void Costmap2D::convexFillCells(
     return;
   }
 
-  // first get the cells that make up the outline of the polygon
-  polygonOutlineCells(polygon, polygon_cells);
-
-  // quick bubble sort to sort points by x
-  MapLocation swap;
-  unsigned int i = 0;
-  while (i < polygon_cells.size() - 1) {
-    if (polygon_cells[i].x > polygon_cells[i + 1].x) {
-      swap = polygon_cells[i];
-      polygon_cells[i] = polygon_cells[i + 1];
-      polygon_cells[i + 1] = swap;
-
-      if (i > 0) {
-        --i;
-      }
-    } else {
-      ++i;
-    }
-  }
-
-  i = 0;
-  MapLocation min_pt;
-  MapLocation max_pt;
-  unsigned int min_x = polygon_cells[0].x;
-  unsigned int max_x = polygon_cells[polygon_cells.size() - 1].x;
-
-  // walk through each column and mark cells inside the polygon
-  for (unsigned int x = min_x; x <= max_x; ++x) {
-    if (i >= polygon_cells.size() - 1) {
-      break;
-    }
-
-    if (polygon_cells[i].y < polygon_cells[i + 1].y) {
-      min_pt = polygon_cells[i];
-      max_pt = polygon_cells[i + 1];
-    } else {
-      min_pt = polygon_cells[i + 1];
-      max_pt = polygon_cells[i];
-    }
-
-    i += 2;
-    while (i < polygon_cells.size() && polygon_cells[i].x == x) {
-      if (polygon_cells[i].y < min_pt.y) {
-        min_pt = polygon_cells[i];
-      } else if (polygon_cells[i].y > max_pt.y) {
-        max_pt = polygon_cells[i];
+  forEachPolygonSpan(
+    polygon, [&polygon_cells](unsigned int y, unsigned int min_x, unsigned int max_x) {
+      for (unsigned int x = min_x; x <= max_x; ++x) {
+        MapLocation pt;
+        pt.x = x;
+        pt.y = y;
+        polygon_cells.push_back(pt);
       }
-      ++i;
-    }
-
-    MapLocation pt;
-    // loop though cells in the column
-    for (unsigned int y = min_pt.y; y < max_pt.y; ++y) {
-      pt.x = x;
-      pt.y = y;
-      polygon_cells.push_back(pt);
-    }
-  }
+    });
 }
 
 unsigned int Costmap2D::getSizeInCellsX() const
@@ -25,6 +25,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
@@ -35,6 +36,8 @@
 #include "sensor_msgs/msg/channel_float32.hpp"
 #include "nav2_voxel_grid/voxel_grid.hpp"
 #include "nav2_msgs/msg/voxel_grid.hpp"
+#include "nav2_msgs/msg/voxel_grid_update.hpp"
+#include "nav2_costmap_2d/voxel_grid_updates.hpp"
 #include "nav2_util/execution_timer.hpp"
 
 static inline void mapToWorld3D(
@@ -73,17 +76,14 @@ rclcpp::Node::SharedPtr g_node;
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_marked;
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_unknown;
 
-void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
-{
-  if (grid->data.empty()) {
-    RCLCPP_ERROR(g_node->get_logger(), "Received empty voxel grid");
-    return;
-  }
+// The last grid received with the updates received since applied, empty until a grid arrives
+nav2_msgs::msg::VoxelGrid::SharedPtr g_grid;
 
+void publishClouds(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr & grid)
+{
   nav2_util::ExecutionTimer timer;
   timer.start();
 
-  RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid");
   const std::string frame_id = grid->header.frame_id;
   const rclcpp::Time stamp = grid->header.stamp;
   const uint32_t * data = &grid->data.front();
@@ -96,6 +96,11 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   const uint32_t x_size = grid->size_x;
   const uint32_t y_size = grid->size_y;
   const uint32_t z_size = grid->size_z;
+  const uint32_t words_per_column = std::max<uint32_t>(grid->words_per_column, 1);
+  if (grid->data.size() < static_cast<size_t>(x_size) * y_size * words_per_column) {
+    RCLCPP_ERROR(g_node->get_logger(), "Received voxel grid with too little data");
+    return;
+  }
 
   g_marked.clear();
   g_unknown.clear();
@@ -105,9 +110,9 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
     for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
       for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
         nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(
+          nav2_voxel_grid::getVoxelFromWords(
           x_grid, y_grid,
-          z_grid, x_size, y_size, z_size, data);
+          z_grid, x_size, y_size, z_size, words_per_column, data);
         if (status == nav2_voxel_grid::UNKNOWN) {
           Cell c;
           c.status = status;
@@ -201,6 +206,33 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
     num_marked + num_unknown, timer.elapsed_time_in_seconds());
 }
 
+void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
+{
+  if (grid->data.empty()) {
+    RCLCPP_ERROR(g_node->get_logger(), "Received empty voxel grid");
+    return;
+  }
+
+  RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid");
+  g_grid = std::make_shared<nav2_msgs::msg::VoxelGrid>(*grid);
+  publishClouds(g_grid);
+}
+
+void voxelUpdateCallback(const nav2_msgs::msg::VoxelGridUpdate::ConstSharedPtr update)
+{
+  if (!g_grid) {
+    RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid update before a voxel grid");
+    return;
+  }
+  if (!nav2_costmap_2d::applyVoxelGridUpdate(*update, *g_grid)) {
+    // The next grid replaces the one that went out of sync
+    RCLCPP_WARN(g_node->get_logger(), "Received voxel grid update that does not fit the grid");
+    g_grid.reset();
+    return;
+  }
+  publishClouds(g_grid);
+}
+
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
@@ -214,6 +246,8 @@ int main(int argc, char ** argv)
     "voxel_unknown_cloud", 1);
   auto sub = g_node->create_subscription<nav2_msgs::msg::VoxelGrid>(
     "voxel_grid", rclcpp::SystemDefaultsQoS(), voxelCallback);
+  auto update_sub = g_node->create_subscription<nav2_msgs::msg::VoxelGridUpdate>(
+    "voxel_grid_updates", rclcpp::SystemDefaultsQoS(), voxelUpdateCallback);
 
   rclcpp::spin(g_node->get_node_base_interface());
   rclcpp::shutdown();
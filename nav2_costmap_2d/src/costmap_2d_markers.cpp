@@ -36,6 +36,7 @@
  *         David V. Lu!!
  *         Steve Macenski
  *********************************************************************/
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
@@ -89,6 +90,11 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   const uint32_t x_size = grid->size_x;
   const uint32_t y_size = grid->size_y;
   const uint32_t z_size = grid->size_z;
+  const uint32_t words_per_column = std::max<uint32_t>(grid->words_per_column, 1);
+  if (grid->data.size() < static_cast<size_t>(x_size) * y_size * words_per_column) {
+    RCLCPP_ERROR(g_node->get_logger(), "Received voxel grid with too little data");
+    return;
+  }
 
   g_cells.clear();
   uint32_t num_markers = 0;
@@ -96,9 +102,9 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
     for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
       for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
         nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(
+          nav2_voxel_grid::getVoxelFromWords(
           x_grid, y_grid,
-          z_grid, x_size, y_size, z_size, data);
+          z_grid, x_size, y_size, z_size, words_per_column, data);
         if (status == nav2_voxel_grid::MARKED) {
           Cell c;
           c.status = status;
@@ -38,11 +38,14 @@
  *********************************************************************/
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
 
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <utility>
 
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
+#include "nav2_util/trace.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -53,8 +56,14 @@ Costmap2DPublisher::Costmap2DPublisher(
   nav2_util::LifecycleNode::SharedPtr ros_node, Costmap2D * costmap,
   std::string global_frame,
   std::string topic_name,
-  bool always_send_full_costmap)
-: node_(ros_node), costmap_(costmap), global_frame_(global_frame), topic_name_(topic_name),
+  bool always_send_full_costmap,
+  double keyframe_interval,
+  unsigned int max_dirty_regions)
+: node_(ros_node), costmap_(costmap), source_(costmap), global_frame_(global_frame),
+  topic_name_(topic_name),
+  dirty_regions_(max_dirty_regions),
+  keyframe_interval_(rclcpp::Duration::from_seconds(keyframe_interval)),
+  last_keyframe_(0, 0, RCL_ROS_TIME),
   active_(false), always_send_full_costmap_(always_send_full_costmap)
 {
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
@@ -66,6 +75,17 @@ Costmap2DPublisher::Costmap2DPublisher(
   costmap_raw_pub_ = node_->create_publisher<nav2_msgs::msg::Costmap>(
     topic_name + "_raw",
     custom_qos);
+  costmap_compressed_pub_ = node_->create_publisher<nav2_msgs::msg::CompressedCostmap>(
+    topic_name + "_raw_compressed",
+    custom_qos);
+
+  // Intra-process delivery does not support transient local durability
+  rclcpp::PublisherOptions intra_options;
+  intra_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
+  costmap_intra_pub_ = node_->create_publisher<nav2_msgs::msg::Costmap>(
+    topic_name + "_raw_intra",
+    rclcpp::QoS(rclcpp::KeepLast(1)).reliable(),
+    intra_options);
   costmap_update_pub_ = node_->create_publisher<map_msgs::msg::OccupancyGridUpdate>(
     topic_name + "_updates", custom_qos);
 
@@ -92,9 +112,6 @@ Costmap2DPublisher::Costmap2DPublisher(
     }
   }
 
-  xn_ = yn_ = 0;
-  x0_ = costmap_->getSizeInCellsX();
-  y0_ = costmap_->getSizeInCellsY();
 }
 
 Costmap2DPublisher::~Costmap2DPublisher() {}
@@ -110,10 +127,10 @@ void Costmap2DPublisher::onNewSubscription(const ros::SingleSubscriberPublisher&
 // prepare grid_ message for publication.
 void Costmap2DPublisher::prepareGrid()
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-  grid_resolution = costmap_->getResolution();
-  grid_width = costmap_->getSizeInCellsX();
-  grid_height = costmap_->getSizeInCellsY();
+  auto lock = lockSource();
+  grid_resolution = source_->getResolution();
+  grid_width = source_->getSizeInCellsX();
+  grid_height = source_->getSizeInCellsY();
 
   grid_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
 
@@ -126,17 +143,17 @@ void Costmap2DPublisher::prepareGrid()
   grid_->info.height = grid_height;
 
   double wx, wy;
-  costmap_->mapToWorld(0, 0, wx, wy);
+  source_->mapToWorld(0, 0, wx, wy);
   grid_->info.origin.position.x = wx - grid_resolution / 2;
   grid_->info.origin.position.y = wy - grid_resolution / 2;
   grid_->info.origin.position.z = 0.0;
   grid_->info.origin.orientation.w = 1.0;
-  saved_origin_x_ = costmap_->getOriginX();
-  saved_origin_y_ = costmap_->getOriginY();
+  saved_origin_x_ = source_->getOriginX();
+  saved_origin_y_ = source_->getOriginY();
 
   grid_->data.resize(grid_->info.width * grid_->info.height);
 
-  unsigned char * data = costmap_->getCharMap();
+  unsigned char * data = source_->getCharMap();
   for (unsigned int i = 0; i < grid_->data.size(); i++) {
     grid_->data[i] = cost_translation_table_[data[i]];
   }
@@ -144,8 +161,8 @@ void Costmap2DPublisher::prepareGrid()
 
 void Costmap2DPublisher::prepareCostmap()
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-  double resolution = costmap_->getResolution();
+  auto lock = lockSource();
+  double resolution = source_->getResolution();
 
   costmap_raw_ = std::make_unique<nav2_msgs::msg::Costmap>();
 
@@ -155,11 +172,11 @@ void Costmap2DPublisher::prepareCostmap()
   costmap_raw_->metadata.layer = "master";
   costmap_raw_->metadata.resolution = resolution;
 
-  costmap_raw_->metadata.size_x = costmap_->getSizeInCellsX();
-  costmap_raw_->metadata.size_y = costmap_->getSizeInCellsY();
+  costmap_raw_->metadata.size_x = source_->getSizeInCellsX();
+  costmap_raw_->metadata.size_y = source_->getSizeInCellsY();
 
   double wx, wy;
-  costmap_->mapToWorld(0, 0, wx, wy);
+  source_->mapToWorld(0, 0, wx, wy);
   costmap_raw_->metadata.origin.position.x = wx - resolution / 2;
   costmap_raw_->metadata.origin.position.y = wy - resolution / 2;
   costmap_raw_->metadata.origin.position.z = 0.0;
@@ -167,56 +184,141 @@ void Costmap2DPublisher::prepareCostmap()
 
   costmap_raw_->data.resize(costmap_raw_->metadata.size_x * costmap_raw_->metadata.size_y);
 
-  unsigned char * data = costmap_->getCharMap();
+  unsigned char * data = source_->getCharMap();
   for (unsigned int i = 0; i < costmap_raw_->data.size(); i++) {
     costmap_raw_->data[i] = data[i];
   }
 }
 
+void Costmap2DPublisher::prepareCompressedCostmap()
+{
+  auto lock = lockSource();
+  double resolution = source_->getResolution();
+
+  costmap_compressed_ = std::make_unique<nav2_msgs::msg::CompressedCostmap>();
+
+  costmap_compressed_->header.frame_id = global_frame_;
+  costmap_compressed_->header.stamp = node_->now();
+
+  costmap_compressed_->metadata.layer = "master";
+  costmap_compressed_->metadata.resolution = resolution;
+
+  costmap_compressed_->metadata.size_x = source_->getSizeInCellsX();
+  costmap_compressed_->metadata.size_y = source_->getSizeInCellsY();
+
+  double wx, wy;
+  source_->mapToWorld(0, 0, wx, wy);
+  costmap_compressed_->metadata.origin.position.x = wx - resolution / 2;
+  costmap_compressed_->metadata.origin.position.y = wy - resolution / 2;
+  costmap_compressed_->metadata.origin.position.z = 0.0;
+  costmap_compressed_->metadata.origin.orientation.w = 1.0;
+
+  encodeCostRuns(
+    source_->getCharMap(),
+    costmap_compressed_->metadata.size_x * costmap_compressed_->metadata.size_y,
+    costmap_compressed_->run_values, costmap_compressed_->run_lengths);
+}
+
 void Costmap2DPublisher::publishCostmap()
 {
-  if (node_->count_subscribers(costmap_raw_pub_->get_topic_name()) > 0) {
+  source_ = costmap_;
+  publish();
+}
+
+void Costmap2DPublisher::publishCostmap(const Costmap2D & snapshot)
+{
+  source_ = &snapshot;
+  publish();
+  source_ = costmap_;
+}
+
+std::unique_lock<Costmap2D::mutex_t> Costmap2DPublisher::lockSource()
+{
+  // Snapshots are never written once taken, only the live costmap is locked
+  if (source_ == costmap_) {
+    return std::unique_lock<Costmap2D::mutex_t>(*(costmap_->getMutex()));
+  }
+  return std::unique_lock<Costmap2D::mutex_t>();
+}
+
+void Costmap2DPublisher::publish()
+{
+  nav2_util::ScopedTrace trace("costmap.publish", topic_name_);
+  const bool raw_wanted = node_->count_subscribers(costmap_raw_pub_->get_topic_name()) > 0;
+  const bool intra_wanted = node_->count_subscribers(costmap_intra_pub_->get_topic_name()) > 0;
+  if (raw_wanted || intra_wanted) {
     prepareCostmap();
-    costmap_raw_pub_->publish(std::move(costmap_raw_));
+    if (raw_wanted) {
+      costmap_raw_pub_->publish(*costmap_raw_);
+    }
+    if (intra_wanted) {
+      // Handing over ownership lets in-process subscribers share this message
+      costmap_intra_pub_->publish(std::move(costmap_raw_));
+    }
   }
-  float resolution = costmap_->getResolution();
+  if (node_->count_subscribers(costmap_compressed_pub_->get_topic_name()) > 0) {
+    prepareCompressedCostmap();
+    costmap_compressed_pub_->publish(std::move(costmap_compressed_));
+  }
+  float resolution = source_->getResolution();
 
-  if (always_send_full_costmap_ || grid_resolution != resolution ||
-    grid_width != costmap_->getSizeInCellsX() ||
-    grid_height != costmap_->getSizeInCellsY() ||
-    saved_origin_x_ != costmap_->getOriginX() ||
-    saved_origin_y_ != costmap_->getOriginY())
+  // Republish the full map periodically so that late subscribers, or ones
+  // that dropped an update, converge without waiting for a geometry change
+  auto current_time = node_->now();
+  bool keyframe_due = keyframe_interval_ > rclcpp::Duration(0) &&
+    (last_keyframe_ + keyframe_interval_ < current_time || current_time < last_keyframe_);
+
+  if (always_send_full_costmap_ || keyframe_due || grid_resolution != resolution ||
+    grid_width != source_->getSizeInCellsX() ||
+    grid_height != source_->getSizeInCellsY() ||
+    saved_origin_x_ != source_->getOriginX() ||
+    saved_origin_y_ != source_->getOriginY())
   {
     if (node_->count_subscribers(costmap_pub_->get_topic_name()) > 0) {
       prepareGrid();
       costmap_pub_->publish(std::move(grid_));
     }
-  } else if (x0_ < xn_) {
+    last_keyframe_ = current_time;
+  } else if (!dirty_regions_.empty()) {
     if (node_->count_subscribers(costmap_update_pub_->get_topic_name()) > 0) {
-      std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-      // Publish Just an Update
-      auto update = std::make_unique<map_msgs::msg::OccupancyGridUpdate>();
-      update->header.stamp = rclcpp::Time();
-      update->header.frame_id = global_frame_;
-      update->x = x0_;
-      update->y = y0_;
-      update->width = xn_ - x0_;
-      update->height = yn_ - y0_;
-      update->data.resize(update->width * update->height);
-      unsigned int i = 0;
-      for (unsigned int y = y0_; y < yn_; y++) {
-        for (unsigned int x = x0_; x < xn_; x++) {
-          unsigned char cost = costmap_->getCost(x, y);
-          update->data[i++] = cost_translation_table_[cost];
-        }
-      }
-      costmap_update_pub_->publish(std::move(update));
+      publishUpdates();
     }
   }
 
-  xn_ = yn_ = 0;
-  x0_ = costmap_->getSizeInCellsX();
-  y0_ = costmap_->getSizeInCellsY();
+  dirty_regions_.clear();
+}
+
+void Costmap2DPublisher::publishUpdates()
+{
+  auto lock = lockSource();
+  const unsigned int size_x = source_->getSizeInCellsX();
+  const unsigned int size_y = source_->getSizeInCellsY();
+  const unsigned char * data = source_->getCharMap();
+
+  for (const auto & region : dirty_regions_.regions()) {
+    const unsigned int xn = std::min(region.xn, size_x);
+    const unsigned int yn = std::min(region.yn, size_y);
+    if (region.x0 >= xn || region.y0 >= yn) {
+      continue;
+    }
+
+    auto update = std::make_unique<map_msgs::msg::OccupancyGridUpdate>();
+    update->header.stamp = rclcpp::Time();
+    update->header.frame_id = global_frame_;
+    update->x = region.x0;
+    update->y = region.y0;
+    update->width = xn - region.x0;
+    update->height = yn - region.y0;
+    update->data.resize(update->width * update->height);
+    unsigned int i = 0;
+    for (unsigned int y = region.y0; y < yn; y++) {
+      const unsigned char * row = data + y * size_x;
+      for (unsigned int x = region.x0; x < xn; x++) {
+        update->data[i++] = cost_translation_table_[row[x]];
+      }
+    }
+    costmap_update_pub_->publish(std::move(update));
+  }
 }
 
 void
@@ -38,6 +38,10 @@
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -49,6 +53,9 @@
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2_ros/create_timer_ros.h"
 #include "nav2_util/robot_utils.hpp"
+#include "nav2_util/se2.hpp"
+#include "nav2_util/shared_tf_buffer.hpp"
+#include "nav2_util/trace.hpp"
 
 using namespace std::chrono_literals;
 
@@ -87,24 +94,37 @@ Costmap2DROS::Costmap2DROS(
   std::vector<std::string> clearable_layers{"obstacle_layer", "voxel_layer", "range_layer"};
 
   declare_parameter("always_send_full_costmap", rclcpp::ParameterValue(false));
+  declare_parameter("async_activation", rclcpp::ParameterValue(false));
+  declare_parameter("diagnostics_period", rclcpp::ParameterValue(1.0));
   declare_parameter("footprint_padding", rclcpp::ParameterValue(0.01f));
   declare_parameter("footprint", rclcpp::ParameterValue(std::string("[]")));
   declare_parameter("global_frame", rclcpp::ParameterValue(std::string("map")));
   declare_parameter("height", rclcpp::ParameterValue(5));
   declare_parameter("width", rclcpp::ParameterValue(5));
+  declare_parameter("keyframe_interval", rclcpp::ParameterValue(0.0));
   declare_parameter("lethal_cost_threshold", rclcpp::ParameterValue(100));
+  declare_parameter("max_dirty_regions", rclcpp::ParameterValue(8));
   declare_parameter(
     "map_topic", rclcpp::ParameterValue(
       (parent_namespace_ == "/" ? "/" : parent_namespace_ + "/") + std::string("map")));
   declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
   declare_parameter("origin_x", rclcpp::ParameterValue(0.0));
   declare_parameter("origin_y", rclcpp::ParameterValue(0.0));
+  declare_parameter("parallel_plugin_initialization", rclcpp::ParameterValue(false));
   declare_parameter("plugins", rclcpp::ParameterValue(default_plugins_));
   declare_parameter("publish_frequency", rclcpp::ParameterValue(1.0));
+  declare_parameter("publish_pyramid", rclcpp::ParameterValue(false));
+  declare_parameter("pyramid_levels", rclcpp::ParameterValue(0));
+  declare_parameter("ready_timeout", rclcpp::ParameterValue(10.0));
   declare_parameter("resolution", rclcpp::ParameterValue(0.1));
   declare_parameter("robot_base_frame", rclcpp::ParameterValue(std::string("base_link")));
   declare_parameter("robot_radius", rclcpp::ParameterValue(0.1));
+  declare_parameter("robot_state_frequency", rclcpp::ParameterValue(0.0));
   declare_parameter("rolling_window", rclcpp::ParameterValue(false));
+  declare_parameter("share_tf_buffer", rclcpp::ParameterValue(false));
+  declare_parameter("tile_size", rclcpp::ParameterValue(256));
+  declare_parameter("threaded_publishing", rclcpp::ParameterValue(false));
+  declare_parameter("tile_update_threads", rclcpp::ParameterValue(1));
   declare_parameter("track_unknown_space", rclcpp::ParameterValue(false));
   declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.3));
   declare_parameter("trinary_costmap", rclcpp::ParameterValue(true));
@@ -127,6 +147,16 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   // Create the costmap itself
   layered_costmap_ = new LayeredCostmap(global_frame_, rolling_window_, track_unknown_space_);
+  layered_costmap_->setTiledUpdate(
+    static_cast<unsigned int>(std::max(tile_update_threads_, 1)),
+    static_cast<unsigned int>(std::max(tile_size_, 1)));
+  layered_costmap_->setPyramidLevels(static_cast<unsigned int>(std::max(pyramid_levels_, 0)));
+  if (diagnostics_period_ > 0.0) {
+    timing_stats_ = std::make_shared<nav2_util::TimingStats>();
+    update_timing_ = &timing_stats_->histogram("update_map");
+    publish_timing_ = &timing_stats_->histogram("publish");
+    layered_costmap_->setTimingStats(timing_stats_);
+  }
 
   if (!layered_costmap_->isSizeLocked()) {
     layered_costmap_->resizeMap(
@@ -135,26 +165,59 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   }
 
   // Create the transform-related objects
-  tf_buffer_ = std::make_shared<tf2_ros::Buffer>(rclcpp_node_->get_clock());
-  auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
-    rclcpp_node_->get_node_base_interface(),
-    rclcpp_node_->get_node_timers_interface());
-  tf_buffer_->setCreateTimerInterface(timer_interface);
-  tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
-
-  // Then load and add the plug-ins to the costmap
+  if (share_tf_buffer_) {
+    tf_buffer_ = nav2_util::getSharedTfBuffer(get_parameter("use_sim_time").as_bool());
+  } else {
+    tf_buffer_ = std::make_shared<tf2_ros::Buffer>(rclcpp_node_->get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      rclcpp_node_->get_node_base_interface(),
+      rclcpp_node_->get_node_timers_interface());
+    tf_buffer_->setCreateTimerInterface(timer_interface);
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+  }
+
+  // Look the robot pose up once per cycle for every reader of getRobotPose()
+  if (robot_state_frequency_ > 0.0) {
+    robot_state_ = std::make_shared<nav2_util::RobotStateCache>(
+      tf_buffer_, global_frame_, robot_base_frame_);
+    robot_state_->start(rclcpp_node_, robot_state_frequency_);
+  }
+
+  // Then load and add the plug-ins to the costmap, in order
+  std::vector<std::shared_ptr<Layer>> plugins;
   for (unsigned int i = 0; i < plugin_names_.size(); ++i) {
     RCLCPP_INFO(get_logger(), "Using plugin \"%s\"", plugin_names_[i].c_str());
 
-    std::shared_ptr<Layer> plugin = plugin_loader_.createSharedInstance(plugin_types_[i]);
-    layered_costmap_->addPlugin(plugin);
-
-    // TODO(mjeronimo): instead of get(), use a shared ptr
-    plugin->initialize(
-      layered_costmap_, plugin_names_[i], tf_buffer_.get(),
-      shared_from_this(), client_node_, rclcpp_node_);
+    plugins.push_back(plugin_loader_.createSharedInstance(plugin_types_[i]));
+    layered_costmap_->addPlugin(plugins.back());
+  }
 
-    RCLCPP_INFO(get_logger(), "Initialized plugin \"%s\"", plugin_names_[i].c_str());
+  auto initialize_plugin = [this, &plugins](unsigned int i) {
+      // TODO(mjeronimo): instead of get(), use a shared ptr
+      plugins[i]->initialize(
+        layered_costmap_, plugin_names_[i], tf_buffer_.get(),
+        shared_from_this(), client_node_, rclcpp_node_);
+
+      RCLCPP_INFO(get_logger(), "Initialized plugin \"%s\"", plugin_names_[i].c_str());
+    };
+  if (parallel_plugin_initialization_ && plugins.size() > 1) {
+    // Layers only declare their parameters and create their interfaces on the node
+    // when initialized, so a slow one doesn't hold the others up
+    std::vector<std::future<void>> initialized;
+    for (unsigned int i = 0; i < plugins.size(); ++i) {
+      initialized.push_back(std::async(std::launch::async, initialize_plugin, i));
+    }
+    // Rethrows the first failure, once every plugin is done
+    for (auto & done : initialized) {
+      done.wait();
+    }
+    for (auto & done : initialized) {
+      done.get();
+    }
+  } else {
+    for (unsigned int i = 0; i < plugins.size(); ++i) {
+      initialize_plugin(i);
+    }
   }
 
   // Create the publishers and subscribers
@@ -169,7 +232,18 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   costmap_publisher_ = new Costmap2DPublisher(
     shared_from_this(),
     layered_costmap_->getCostmap(), global_frame_,
-    "costmap", always_send_full_costmap_);
+    "costmap", always_send_full_costmap_, keyframe_interval_,
+    static_cast<unsigned int>(std::max(1, max_dirty_regions_)));
+
+  if (publish_pyramid_) {
+    for (unsigned int level = 1; level <= layered_costmap_->getPyramidLevels(); ++level) {
+      pyramid_publishers_.push_back(
+        std::make_unique<Costmap2DPublisher>(
+          shared_from_this(), layered_costmap_->getPyramidLevel(level), global_frame_,
+          "costmap_" + std::to_string(1u << level) + "x", always_send_full_costmap_,
+          keyframe_interval_, static_cast<unsigned int>(std::max(1, max_dirty_regions_))));
+    }
+  }
 
   // Set the footprint
   if (use_radius_) {
@@ -192,16 +266,25 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Activating");
 
   costmap_publisher_->on_activate();
+  for (auto & publisher : pyramid_publishers_) {
+    publisher->on_activate();
+  }
   footprint_pub_->on_activate();
+  if (timing_stats_) {
+    timing_diagnostics_ = std::make_unique<nav2_util::TimingDiagnostics>(
+      shared_from_this(), timing_stats_, name_,
+      std::chrono::duration<double>(diagnostics_period_));
+  }
 
   // First, make sure that the transform between the robot base frame
-  // and the global frame is available
+  // and the global frame is available. Activating asynchronously, the
+  // update loop waits for it, as it only updates with a robot pose
 
   std::string tf_error;
 
   RCLCPP_INFO(get_logger(), "Checking transform");
   rclcpp::Rate r(2);
-  while (rclcpp::ok() &&
+  while (rclcpp::ok() && !async_activation_ &&
     !tf_buffer_->canTransform(
       global_frame_, robot_base_frame_, tf2::TimePointZero, &tf_error))
   {
@@ -225,6 +308,14 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
     std::bind(
       &Costmap2DROS::mapUpdateLoop, this, map_update_frequency_));
 
+  if (threaded_publishing_ && publish_cycle_ > rclcpp::Duration(0)) {
+    publish_thread_shutdown_ = false;
+    publish_requested_ = false;
+    pending_regions_.setMaxRegions(static_cast<unsigned int>(std::max(1, max_dirty_regions_)));
+    pending_regions_.clear();
+    publish_thread_ = std::make_unique<std::thread>(&Costmap2DROS::publishLoop, this);
+  }
+
   start();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -236,7 +327,11 @@ Costmap2DROS::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   costmap_publisher_->on_deactivate();
+  for (auto & publisher : pyramid_publishers_) {
+    publisher->on_deactivate();
+  }
   footprint_pub_->on_deactivate();
+  timing_diagnostics_.reset();
 
   stop();
 
@@ -247,6 +342,16 @@ Costmap2DROS::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   delete map_update_thread_;
   map_update_thread_ = nullptr;
 
+  if (publish_thread_) {
+    {
+      std::lock_guard<std::mutex> lock(publish_mutex_);
+      publish_thread_shutdown_ = true;
+    }
+    publish_condition_.notify_one();
+    publish_thread_->join();
+    publish_thread_.reset();
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -255,9 +360,19 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
+  std::atomic_store(&snapshot_, std::shared_ptr<const Costmap2D>());
+  snapshot_pool_.clear();
+
   delete layered_costmap_;
   layered_costmap_ = nullptr;
+  update_timing_ = nullptr;
+  publish_timing_ = nullptr;
+  timing_stats_.reset();
 
+  if (robot_state_) {
+    robot_state_->stop();
+    robot_state_.reset();
+  }
   tf_listener_.reset();
   tf_buffer_.reset();
 
@@ -268,6 +383,7 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
     delete costmap_publisher_;
     costmap_publisher_ = nullptr;
   }
+  pyramid_publishers_.clear();
 
   clear_costmap_service_.reset();
 
@@ -288,21 +404,34 @@ Costmap2DROS::getParameters()
 
   // Get all of the required parameters
   get_parameter("always_send_full_costmap", always_send_full_costmap_);
+  get_parameter("async_activation", async_activation_);
+  get_parameter("diagnostics_period", diagnostics_period_);
   get_parameter("footprint", footprint_);
   get_parameter("footprint_padding", footprint_padding_);
   get_parameter("global_frame", global_frame_);
   get_parameter("height", map_height_meters_);
+  get_parameter("keyframe_interval", keyframe_interval_);
+  get_parameter("max_dirty_regions", max_dirty_regions_);
   get_parameter("origin_x", origin_x_);
   get_parameter("origin_y", origin_y_);
   get_parameter("publish_frequency", map_publish_frequency_);
+  get_parameter("publish_pyramid", publish_pyramid_);
+  get_parameter("pyramid_levels", pyramid_levels_);
+  get_parameter("ready_timeout", ready_timeout_);
   get_parameter("resolution", resolution_);
   get_parameter("robot_base_frame", robot_base_frame_);
   get_parameter("robot_radius", robot_radius_);
+  get_parameter("robot_state_frequency", robot_state_frequency_);
   get_parameter("rolling_window", rolling_window_);
+  get_parameter("share_tf_buffer", share_tf_buffer_);
+  get_parameter("tile_size", tile_size_);
+  get_parameter("threaded_publishing", threaded_publishing_);
+  get_parameter("tile_update_threads", tile_update_threads_);
   get_parameter("track_unknown_space", track_unknown_space_);
   get_parameter("transform_tolerance", transform_tolerance_);
   get_parameter("update_frequency", map_update_frequency_);
   get_parameter("width", map_width_meters_);
+  get_parameter("parallel_plugin_initialization", parallel_plugin_initialization_);
   get_parameter("plugins", plugin_names_);
 
   auto node = shared_from_this();
@@ -354,6 +483,27 @@ Costmap2DROS::setRobotFootprint(const std::vector<geometry_msgs::msg::Point> & p
   layered_costmap_->setFootprint(padded_footprint_);
 }
 
+void
+Costmap2DROS::setCostmap(const Costmap2D & costmap)
+{
+  Costmap2D * master = layered_costmap_->getCostmap();
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+    if (master->getSizeInCellsX() != costmap.getSizeInCellsX() ||
+      master->getSizeInCellsY() != costmap.getSizeInCellsY() ||
+      master->getResolution() != costmap.getResolution() ||
+      master->getOriginX() != costmap.getOriginX() ||
+      master->getOriginY() != costmap.getOriginY())
+    {
+      layered_costmap_->resizeMap(
+        costmap.getSizeInCellsX(), costmap.getSizeInCellsY(), costmap.getResolution(),
+        costmap.getOriginX(), costmap.getOriginY(), layered_costmap_->isSizeLocked());
+    }
+    *master = costmap;
+  }
+  publishSnapshot(true);
+}
+
 void
 Costmap2DROS::setRobotFootprintPolygon(
   const geometry_msgs::msg::Polygon::SharedPtr footprint)
@@ -369,7 +519,7 @@ Costmap2DROS::getOrientedFootprint(std::vector<geometry_msgs::msg::Point> & orie
     return;
   }
 
-  double yaw = tf2::getYaw(global_pose.pose.orientation);
+  double yaw = nav2_util::se2::yaw(global_pose.pose.orientation);
   transformFootprint(
     global_pose.pose.position.x, global_pose.pose.position.y, yaw,
     padded_footprint_, oriented_footprint);
@@ -390,7 +540,7 @@ Costmap2DROS::mapUpdateLoop(double frequency)
   rclcpp::Rate r(frequency);    // 200ms by default
 
   while (rclcpp::ok() && !map_update_thread_shutdown_) {
-    nav2_util::ExecutionTimer timer;
+    nav2_util::ExecutionTimer timer("costmap.map_update_cycle", name_);
 
     // Measure the execution time of the updateMap method
     timer.start();
@@ -398,17 +548,39 @@ Costmap2DROS::mapUpdateLoop(double frequency)
     timer.end();
 
     RCLCPP_DEBUG(get_logger(), "Map update time: %.9f", timer.elapsed_time_in_seconds());
+    if (update_timing_) {
+      update_timing_->record(timer.elapsed_time());
+    }
     if (publish_cycle_ > rclcpp::Duration(0) && layered_costmap_->isInitialized()) {
       unsigned int x0, y0, xn, yn;
       layered_costmap_->getBounds(&x0, &xn, &y0, &yn);
-      costmap_publisher_->updateBounds(x0, xn, y0, yn);
 
       auto current_time = now();
-      if ((last_publish_ + publish_cycle_ < current_time) ||  // publish_cycle_ is due
-        (current_time < last_publish_))      // time has moved backwards, probably due to a switch to sim_time // NOLINT
-      {
-        RCLCPP_DEBUG(get_logger(), "Publish costmap at %s", name_.c_str());
-        costmap_publisher_->publishCostmap();
+      const bool due = (last_publish_ + publish_cycle_ < current_time) ||  // publish_cycle_ is due
+        (current_time < last_publish_);      // time has moved backwards, probably due to a switch to sim_time // NOLINT
+      if (publish_thread_) {
+        // The update is already in the snapshot, so the publish thread never
+        // sees these bounds before the cells they cover
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        pending_regions_.add(x0, xn, y0, yn);
+        if (due) {
+          publish_input_stamp_ns_ = update_input_stamp_ns_;
+          publish_requested_ = true;
+          publish_condition_.notify_one();
+        }
+      } else {
+        updatePublishedBounds(x0, xn, y0, yn);
+        if (due) {
+          RCLCPP_DEBUG(get_logger(), "Publish costmap at %s", name_.c_str());
+          nav2_util::TraceInputScope input(update_input_stamp_ns_);
+          nav2_util::ScopedTiming timing(publish_timing_);
+          costmap_publisher_->publishCostmap();
+          for (auto & publisher : pyramid_publishers_) {
+            publisher->publishCostmap();
+          }
+        }
+      }
+      if (due) {
         last_publish_ = current_time;
       }
     }
@@ -428,6 +600,56 @@ Costmap2DROS::mapUpdateLoop(double frequency)
   }
 }
 
+void
+Costmap2DROS::publishLoop()
+{
+  std::unique_lock<std::mutex> lock(publish_mutex_);
+  while (true) {
+    publish_condition_.wait(
+      lock, [this]() {return publish_requested_ || publish_thread_shutdown_;});
+    if (publish_thread_shutdown_) {
+      return;
+    }
+    // Requests made while publishing are coalesced into the next one
+    publish_requested_ = false;
+    std::vector<DirtyRegionSet::Region> regions = pending_regions_.regions();
+    pending_regions_.clear();
+    const int64_t input_stamp_ns = publish_input_stamp_ns_;
+    lock.unlock();
+
+    for (const auto & region : regions) {
+      updatePublishedBounds(region.x0, region.xn, region.y0, region.yn);
+    }
+    // Taken after the bounds, the snapshot holds at least the changes they cover
+    std::shared_ptr<const Costmap2D> snapshot = getCostmapSnapshot();
+    if (snapshot) {
+      RCLCPP_DEBUG(get_logger(), "Publish costmap at %s", name_.c_str());
+      nav2_util::TraceInputScope input(input_stamp_ns);
+      nav2_util::ScopedTiming timing(publish_timing_);
+      costmap_publisher_->publishCostmap(*snapshot);
+      for (auto & publisher : pyramid_publishers_) {
+        publisher->publishCostmap();
+      }
+    }
+
+    lock.lock();
+  }
+}
+
+void
+Costmap2DROS::updatePublishedBounds(
+  unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn)
+{
+  costmap_publisher_->updateBounds(x0, xn, y0, yn);
+  for (std::size_t i = 0; i < pyramid_publishers_.size(); ++i) {
+    // the ends are exclusive, so they round up to the coarse cell they fall in
+    const unsigned int shift = static_cast<unsigned int>(i) + 1;
+    const unsigned int round = (1u << shift) - 1;
+    pyramid_publishers_[i]->updateBounds(
+      x0 >> shift, (xn + round) >> shift, y0 >> shift, (yn + round) >> shift);
+  }
+}
+
 void
 Costmap2DROS::updateMap()
 {
@@ -437,10 +659,13 @@ Costmap2DROS::updateMap()
     // get global pose
     geometry_msgs::msg::PoseStamped pose;
     if (getRobotPose(pose)) {
+      update_input_stamp_ns_ = nav2_util::traceStamp(pose.header.stamp);
+      nav2_util::ScopedTrace trace("costmap.update_map", name_, update_input_stamp_ns_);
       const double & x = pose.pose.position.x;
       const double & y = pose.pose.position.y;
-      const double yaw = tf2::getYaw(pose.pose.orientation);
+      const double yaw = nav2_util::se2::yaw(pose.pose.orientation);
       layered_costmap_->updateMap(x, y, yaw);
+      publishSnapshot();
 
       auto footprint = std::make_unique<geometry_msgs::msg::PolygonStamped>();
       footprint->header.frame_id = global_frame_;
@@ -449,7 +674,9 @@ Costmap2DROS::updateMap()
 
       RCLCPP_DEBUG(get_logger(), "Publishing footprint");
       footprint_pub_->publish(std::move(footprint));
-      initialized_ = true;
+      if (!initialized_) {
+        setReady(true);
+      }
     }
   }
 }
@@ -474,10 +701,11 @@ Costmap2DROS::start()
   stop_updates_ = false;
 
   // block until the costmap is re-initialized.. meaning one update cycle has run
-  rclcpp::Rate r(20.0);
-  while (rclcpp::ok() && !initialized_) {
+  std::shared_future<void> ready = getReadyFuture();
+  while (!async_activation_ && rclcpp::ok() &&
+    ready.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready)
+  {
     RCLCPP_DEBUG(get_logger(), "Sleeping, waiting for initialized_");
-    r.sleep();
   }
 }
 
@@ -492,7 +720,7 @@ Costmap2DROS::stop()
   {
     (*plugin)->deactivate();
   }
-  initialized_ = false;
+  setReady(false);
   stopped_ = true;
 }
 
@@ -500,7 +728,7 @@ void
 Costmap2DROS::pause()
 {
   stop_updates_ = true;
-  initialized_ = false;
+  setReady(false);
 }
 
 void
@@ -509,12 +737,45 @@ Costmap2DROS::resume()
   stop_updates_ = false;
 
   // block until the costmap is re-initialized.. meaning one update cycle has run
-  rclcpp::Rate r(100.0);
-  while (!initialized_) {
-    r.sleep();
+  std::shared_future<void> ready = getReadyFuture();
+  while (!async_activation_ && rclcpp::ok() &&
+    ready.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready)
+  {
+    RCLCPP_DEBUG(get_logger(), "Sleeping, waiting for initialized_");
   }
 }
 
+std::shared_future<void>
+Costmap2DROS::getReadyFuture()
+{
+  std::lock_guard<std::mutex> lock(ready_mutex_);
+  return ready_future_;
+}
+
+bool
+Costmap2DROS::waitUntilReady()
+{
+  return getReadyFuture().wait_for(std::chrono::duration<double>(ready_timeout_)) ==
+         std::future_status::ready;
+}
+
+void
+Costmap2DROS::setReady(bool ready)
+{
+  std::lock_guard<std::mutex> lock(ready_mutex_);
+  if (ready == initialized_) {
+    return;
+  }
+  if (ready) {
+    ready_promise_.set_value();
+  } else {
+    // Waiters on the fulfilled future are all done, the next ones wait for the next update
+    ready_promise_ = std::promise<void>();
+    ready_future_ = ready_promise_.get_future().share();
+  }
+  initialized_ = ready;
+}
+
 void
 Costmap2DROS::resetLayers()
 {
@@ -528,11 +789,114 @@ Costmap2DROS::resetLayers()
   {
     (*plugin)->reset();
   }
+
+  if (initialized_) {
+    publishSnapshot(true);
+  }
+}
+
+void
+Costmap2DROS::publishSnapshot(bool full_change)
+{
+  std::lock_guard<std::mutex> pool_lock(snapshot_mutex_);
+
+  // Find a buffer no reader holds anymore; the published snapshot is never
+  // picked since snapshot_ itself keeps a reference to it
+  std::shared_ptr<Costmap2D> buffer;
+  for (auto & candidate : snapshot_pool_) {
+    if (candidate.use_count() == 1) {
+      buffer = candidate;
+      break;
+    }
+  }
+
+  if (!buffer) {
+    // Every pooled buffer is still being read: grow the pool up to its limit,
+    // past that hand out a one-off buffer freed by its last reader
+    buffer = std::make_shared<Costmap2D>();
+    if (snapshot_pool_.size() < SNAPSHOT_POOL_SIZE) {
+      snapshot_pool_.push_back(buffer);
+    }
+  }
+
+  Costmap2D * master = layered_costmap_->getCostmap();
+  SnapshotChange change;
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+    *buffer = *master;
+    layered_costmap_->getBounds(&change.x0, &change.xn, &change.y0, &change.yn);
+  }
+
+  // A resized or moved grid changes every cell
+  std::shared_ptr<const Costmap2D> previous = std::atomic_load(&snapshot_);
+  change.full = full_change || !previous ||
+    previous->getSizeInCellsX() != buffer->getSizeInCellsX() ||
+    previous->getSizeInCellsY() != buffer->getSizeInCellsY() ||
+    previous->getResolution() != buffer->getResolution() ||
+    previous->getOriginX() != buffer->getOriginX() ||
+    previous->getOriginY() != buffer->getOriginY();
+
+  std::lock_guard<std::mutex> history_lock(snapshot_history_mutex_);
+  change.sequence = ++snapshot_sequence_;
+  snapshot_changes_.push_back(change);
+  if (snapshot_changes_.size() > SNAPSHOT_HISTORY_SIZE) {
+    snapshot_changes_.pop_front();
+  }
+  std::atomic_store(&snapshot_, std::shared_ptr<const Costmap2D>(buffer));
+}
+
+bool
+Costmap2DROS::getChangedBounds(
+  uint64_t since, uint64_t until,
+  unsigned int & x0, unsigned int & xn, unsigned int & y0, unsigned int & yn) const
+{
+  x0 = y0 = std::numeric_limits<unsigned int>::max();
+  xn = yn = 0;
+
+  std::lock_guard<std::mutex> lock(snapshot_history_mutex_);
+  if (since > until || until > snapshot_sequence_) {
+    return false;
+  }
+  if (since == until) {
+    x0 = xn = y0 = yn = 0;
+    return true;
+  }
+  if (snapshot_changes_.empty() || snapshot_changes_.front().sequence > since + 1) {
+    return false;
+  }
+
+  for (const SnapshotChange & change : snapshot_changes_) {
+    if (change.sequence <= since || change.sequence > until) {
+      continue;
+    }
+    if (change.full) {
+      return false;
+    }
+    if (change.xn > change.x0 && change.yn > change.y0) {
+      x0 = std::min(x0, change.x0);
+      xn = std::max(xn, change.xn);
+      y0 = std::min(y0, change.y0);
+      yn = std::max(yn, change.yn);
+    }
+  }
+
+  if (xn == 0 || yn == 0) {
+    x0 = xn = y0 = yn = 0;
+  }
+  return true;
 }
 
 bool
 Costmap2DROS::getRobotPose(geometry_msgs::msg::PoseStamped & global_pose)
 {
+  // Use the cached pose while it's fresh enough, otherwise fall back to TF
+  if (robot_state_ && robot_state_->getLatestPose(global_pose) &&
+    (rclcpp_node_->now() - rclcpp::Time(global_pose.header.stamp)).seconds() <=
+    transform_tolerance_)
+  {
+    return true;
+  }
+
   return nav2_util::getCurrentPose(
     global_pose, *tf_buffer_,
     global_frame_, robot_base_frame_, transform_tolerance_);
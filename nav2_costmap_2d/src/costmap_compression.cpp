@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_compression.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+template<typename T, typename V>
+void encodeRuns(
+  const T * data, std::size_t size, std::vector<V> & values, std::vector<uint32_t> & lengths)
+{
+  values.clear();
+  lengths.clear();
+
+  const uint32_t max_run = std::numeric_limits<uint32_t>::max();
+  std::size_t i = 0;
+  while (i < size) {
+    const T value = data[i];
+    std::size_t end = i + 1;
+    while (end < size && data[end] == value && end - i < max_run) {
+      ++end;
+    }
+    values.push_back(value);
+    lengths.push_back(static_cast<uint32_t>(end - i));
+    i = end;
+  }
+}
+
+template<typename T, typename V>
+bool decodeRuns(
+  const std::vector<V> & values, const std::vector<uint32_t> & lengths,
+  T * data, std::size_t size)
+{
+  if (values.size() != lengths.size()) {
+    return false;
+  }
+
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (lengths[i] > size - offset) {
+      return false;
+    }
+    std::fill_n(data + offset, lengths[i], static_cast<T>(values[i]));
+    offset += lengths[i];
+  }
+  return offset == size;
+}
+
+}  // namespace
+
+void encodeCostRuns(
+  const unsigned char * data, std::size_t size,
+  std::vector<uint8_t> & values, std::vector<uint32_t> & lengths)
+{
+  encodeRuns(data, size, values, lengths);
+}
+
+bool decodeCostRuns(
+  const std::vector<uint8_t> & values, const std::vector<uint32_t> & lengths,
+  unsigned char * data, std::size_t size)
+{
+  return decodeRuns(values, lengths, data, size);
+}
+
+void encodeWordRuns(
+  const uint32_t * data, std::size_t size,
+  std::vector<uint32_t> & values, std::vector<uint32_t> & lengths)
+{
+  encodeRuns(data, size, values, lengths);
+}
+
+bool decodeWordRuns(
+  const std::vector<uint32_t> & values, const std::vector<uint32_t> & lengths,
+  uint32_t * data, std::size_t size)
+{
+  return decodeRuns(values, lengths, data, size);
+}
+
+}  // namespace nav2_costmap_2d
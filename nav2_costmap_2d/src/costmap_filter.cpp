@@ -0,0 +1,104 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_filter.hpp"
+
+#include <string>
+
+#include "nav2_map_server/map_io.hpp"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+
+namespace nav2_costmap_2d
+{
+
+CostmapFilter::CostmapFilter()
+{
+}
+
+void
+CostmapFilter::onInitialize()
+{
+  global_frame_ = layered_costmap_->getGlobalFrameID();
+
+  declareParameter("enabled", rclcpp::ParameterValue(true));
+  declareParameter("mask_yaml", rclcpp::ParameterValue(""));
+  declareParameter("mask_topic", rclcpp::ParameterValue(""));
+  declareParameter("transform_tolerance", rclcpp::ParameterValue(0.1));
+
+  std::string mask_yaml, mask_topic;
+  double tf_tolerance = 0.0;
+  node_->get_parameter(name_ + "." + "enabled", enabled_);
+  node_->get_parameter(name_ + "." + "mask_yaml", mask_yaml);
+  node_->get_parameter(name_ + "." + "mask_topic", mask_topic);
+  node_->get_parameter(name_ + "." + "transform_tolerance", tf_tolerance);
+  transform_tolerance_ = tf2::durationFromSec(tf_tolerance);
+
+  initializeFilter();
+
+  if (!mask_yaml.empty()) {
+    nav_msgs::msg::OccupancyGrid mask;
+    if (nav2_map_server::loadMapFromYaml(mask_yaml, mask) !=
+      nav2_map_server::LOAD_MAP_SUCCESS)
+    {
+      RCLCPP_ERROR(
+        node_->get_logger(), "%s: Failed to load the mask %s", name_.c_str(),
+        mask_yaml.c_str());
+      return;
+    }
+    RCLCPP_INFO(
+      node_->get_logger(), "%s: Loaded the %u X %u mask %s", name_.c_str(),
+      mask.info.width, mask.info.height, mask_yaml.c_str());
+    processMask(mask);
+    return;
+  }
+
+  if (mask_topic.empty()) {
+    RCLCPP_ERROR(
+      node_->get_logger(), "%s: Neither mask_yaml nor mask_topic is set", name_.c_str());
+    return;
+  }
+  RCLCPP_INFO(
+    node_->get_logger(), "%s: Subscribing to the mask topic (%s)", name_.c_str(),
+    mask_topic.c_str());
+  mask_sub_ = node_->create_subscription<nav_msgs::msg::OccupancyGrid>(
+    mask_topic, rclcpp::QoS(1).transient_local().reliable(),
+    std::bind(&CostmapFilter::maskCallback, this, std::placeholders::_1));
+}
+
+void
+CostmapFilter::maskCallback(const nav_msgs::msg::OccupancyGrid::SharedPtr mask)
+{
+  processMask(*mask);
+}
+
+bool
+CostmapFilter::lookupMaskTransform(const std::string & mask_frame, tf2::Transform & transform)
+{
+  if (mask_frame.empty() || mask_frame == global_frame_) {
+    transform.setIdentity();
+    return true;
+  }
+  try {
+    tf2::fromMsg(
+      tf_->lookupTransform(
+        mask_frame, global_frame_, tf2::TimePointZero, transform_tolerance_).transform,
+      transform);
+  } catch (tf2::TransformException & ex) {
+    RCLCPP_ERROR(node_->get_logger(), "%s: %s", name_.c_str(), ex.what());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -40,6 +40,8 @@
 #include <stdexcept>
 #include <algorithm>
 
+#include "nav2_costmap_2d/combination_kernels.hpp"
+
 namespace nav2_costmap_2d
 {
 
@@ -61,22 +63,74 @@ void CostmapLayer::matchSize()
     master->getOriginX(), master->getOriginY());
 }
 
+std::size_t CostmapLayer::getMemoryUsage() const
+{
+  return costmap_ ? static_cast<std::size_t>(size_x_) * size_y_ : 0;
+}
+
 void CostmapLayer::clearArea(int start_x, int start_y, int end_x, int end_y)
 {
-  unsigned char * grid = getCharMap();
-  for (int x = 0; x < static_cast<int>(getSizeInCellsX()); x++) {
-    bool xrange = x > start_x && x < end_x;
+  int min_x, min_y, max_x, max_y;
+  resetOutside(start_x + 1, start_y + 1, end_x, end_y, NO_INFORMATION, min_x, min_y, max_x, max_y);
+}
 
-    for (int y = 0; y < static_cast<int>(getSizeInCellsY()); y++) {
-      if (xrange && y > start_y && y < end_y) {
-        continue;
+void CostmapLayer::resetExceptArea(
+  int start_x, int start_y, int end_x, int end_y, unsigned char value)
+{
+  int min_x, min_y, max_x, max_y;
+  if (!resetOutside(start_x, start_y, end_x, end_y, value, min_x, min_y, max_x, max_y)) {
+    return;
+  }
+  addExtraBounds(
+    origin_x_ + min_x * resolution_, origin_y_ + min_y * resolution_,
+    origin_x_ + (max_x + 1) * resolution_, origin_y_ + (max_y + 1) * resolution_);
+}
+
+bool CostmapLayer::resetOutside(
+  int x0, int y0, int xn, int yn, unsigned char value,
+  int & min_x, int & min_y, int & max_x, int & max_y)
+{
+  const int size_x = size_x_;
+  const int size_y = size_y_;
+  x0 = std::min(std::max(x0, 0), size_x);
+  xn = std::min(std::max(xn, x0), size_x);
+  y0 = std::min(std::max(y0, 0), size_y);
+  yn = std::min(std::max(yn, y0), size_y);
+
+  min_x = size_x;
+  min_y = size_y;
+  max_x = -1;
+  max_y = -1;
+  auto reset_span = [&](int y, int begin, int end) {
+      unsigned char * row = costmap_ + static_cast<size_t>(y) * size_x;
+      int first = begin;
+      while (first < end && row[first] == value) {
+        first++;
+      }
+      if (first == end) {
+        return;
       }
-      int index = getIndex(x, y);
-      if (grid[index] != NO_INFORMATION) {
-        grid[index] = NO_INFORMATION;
+      int last = end - 1;
+      while (row[last] == value) {
+        last--;
       }
+      memset(row + first, value, last - first + 1);
+      min_x = std::min(min_x, first);
+      max_x = std::max(max_x, last);
+      min_y = std::min(min_y, y);
+      max_y = std::max(max_y, y);
+    };
+
+  std::unique_lock<mutex_t> lock(*access_);
+  for (int y = 0; y < size_y; y++) {
+    if (y < y0 || y >= yn || x0 == xn) {
+      reset_span(y, 0, size_x);
+    } else {
+      reset_span(y, 0, x0);
+      reset_span(y, xn, size_x);
     }
   }
+  return max_x >= 0;
 }
 
 void CostmapLayer::addExtraBounds(double mx0, double my0, double mx1, double my1)
@@ -110,7 +164,7 @@ void CostmapLayer::updateWithMax(
   int max_i,
   int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
 
@@ -119,18 +173,7 @@ void CostmapLayer::updateWithMax(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION || old_cost < costmap_[it]) {
-        master_array[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineRowMax(master_array + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -148,15 +191,16 @@ void CostmapLayer::updateWithTrueOverwrite(
     throw std::runtime_error("Can't update costmap layer: It has't been initialized yet!");
   }
 
+  if (max_i <= min_i) {
+    return;
+  }
+
   unsigned char * master = master_grid.getCharMap();
   unsigned int span = master_grid.getSizeInCellsX();
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      master[it] = costmap_[it];
-      it++;
-    }
+    std::copy(costmap_ + it, costmap_ + it + (max_i - min_i), master + it);
   }
 }
 
@@ -164,7 +208,7 @@ void CostmapLayer::updateWithOverwrite(
   nav2_costmap_2d::Costmap2D & master_grid,
   int min_i, int min_j, int max_i, int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
   unsigned char * master = master_grid.getCharMap();
@@ -172,12 +216,7 @@ void CostmapLayer::updateWithOverwrite(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] != NO_INFORMATION) {
-        master[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineRowOverwrite(master + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -185,7 +224,7 @@ void CostmapLayer::updateWithAddition(
   nav2_costmap_2d::Costmap2D & master_grid,
   int min_i, int min_j, int max_i, int max_j)
 {
-  if (!enabled_) {
+  if (!enabled_ || max_i <= min_i) {
     return;
   }
   unsigned char * master_array = master_grid.getCharMap();
@@ -193,25 +232,7 @@ void CostmapLayer::updateWithAddition(
 
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION) {
-        master_array[it] = costmap_[it];
-      } else {
-        int sum = old_cost + costmap_[it];
-        if (sum >= nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
-          master_array[it] = nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1;
-        } else {
-          master_array[it] = sum;
-        }
-      }
-      it++;
-    }
+    combineRowAddition(master_array + it, costmap_ + it, max_i - min_i);
   }
 }
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,152 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_snapshot.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_layer.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+struct CostmapInfo
+{
+  uint32_t size_x;
+  uint32_t size_y;
+  double resolution;
+  double origin_x;
+  double origin_y;
+  uint8_t default_value;
+};
+
+}  // namespace
+
+void addCostmap(
+  nav2_util::SnapshotWriter & writer, const std::string & name, const Costmap2D & costmap)
+{
+  CostmapInfo info;
+  std::memset(&info, 0, sizeof(info));
+  info.size_x = costmap.getSizeInCellsX();
+  info.size_y = costmap.getSizeInCellsY();
+  info.resolution = costmap.getResolution();
+  info.origin_x = costmap.getOriginX();
+  info.origin_y = costmap.getOriginY();
+  info.default_value = costmap.getDefaultValue();
+  writer.addValue(name + "/info", info);
+  writer.addArray(
+    name + "/costs", costmap.getCharMap(),
+    static_cast<std::size_t>(info.size_x) * info.size_y);
+}
+
+bool readCostmap(
+  const nav2_util::Snapshot & snapshot, const std::string & name, Costmap2D & costmap)
+{
+  CostmapInfo info;
+  if (!snapshot.value(name + "/info", info)) {
+    return false;
+  }
+  std::size_t count = 0;
+  const unsigned char * costs = snapshot.array<unsigned char>(name + "/costs", count);
+  if (!costs || count != static_cast<std::size_t>(info.size_x) * info.size_y) {
+    return false;
+  }
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap.getMutex()));
+  costmap.setDefaultValue(info.default_value);
+  costmap.resizeMap(info.size_x, info.size_y, info.resolution, info.origin_x, info.origin_y);
+  std::memcpy(costmap.getCharMap(), costs, count);
+  return true;
+}
+
+void addCostmapROS(
+  nav2_util::SnapshotWriter & writer, const std::string & name,
+  std::shared_ptr<Costmap2DROS> costmap_ros, std::shared_ptr<const Costmap2D> master)
+{
+  std::vector<double> footprint;
+  for (const auto & point : costmap_ros->getRobotFootprint()) {
+    footprint.push_back(point.x);
+    footprint.push_back(point.y);
+  }
+  writer.addArray(name + "/footprint", footprint);
+  writer.addString(name + "/global_frame", costmap_ros->getGlobalFrameID());
+  writer.addString(name + "/robot_base_frame", costmap_ros->getBaseFrameID());
+
+  writer.defer(
+    [name, costmap_ros, master](nav2_util::SnapshotWriter & deferred) {
+      LayeredCostmap * layered_costmap = costmap_ros->getLayeredCostmap();
+      if (!layered_costmap) {
+        // Cleaned up meanwhile, the master of the cycle is all there is left
+        if (master) {
+          addCostmap(deferred, name + "/master", *master);
+        }
+        return;
+      }
+      // Layers are updated under the lock of the master
+      Costmap2D * current = layered_costmap->getCostmap();
+      std::unique_lock<Costmap2D::mutex_t> lock(*(current->getMutex()));
+      addCostmap(deferred, name + "/master", master ? *master : *current);
+      for (const auto & plugin : *layered_costmap->getPlugins()) {
+        // Only the layers that keep a grid of their own, inflation writes to the master
+        auto layer = std::dynamic_pointer_cast<CostmapLayer>(plugin);
+        if (layer) {
+          std::unique_lock<Costmap2D::mutex_t> layer_lock(*(layer->getMutex()));
+          addCostmap(deferred, name + "/layers/" + plugin->getName(), *layer);
+        }
+      }
+    });
+}
+
+std::shared_ptr<Costmap2DROS> replayCostmapROS(
+  const nav2_util::Snapshot & snapshot, const std::string & name)
+{
+  auto master = std::make_shared<Costmap2D>();
+  if (!readCostmap(snapshot, name + "/master", *master)) {
+    return nullptr;
+  }
+
+  auto costmap_ros = std::make_shared<Costmap2DROS>(name);
+  costmap_ros->set_parameters(
+  {
+    rclcpp::Parameter("plugins", std::vector<std::string>()),
+    rclcpp::Parameter("global_frame", snapshot.string(name + "/global_frame")),
+    rclcpp::Parameter("robot_base_frame", snapshot.string(name + "/robot_base_frame")),
+    rclcpp::Parameter("rolling_window", false),
+    rclcpp::Parameter("footprint_padding", 0.0)
+  });
+  costmap_ros->configure();
+  costmap_ros->setCostmap(*master);
+
+  // Stored padded, so set with no padding
+  std::vector<geometry_msgs::msg::Point> footprint;
+  const std::vector<double> points = snapshot.vector<double>(name + "/footprint");
+  for (std::size_t i = 0; i + 1 < points.size(); i += 2) {
+    geometry_msgs::msg::Point point;
+    point.x = points[i];
+    point.y = points[i + 1];
+    footprint.push_back(point);
+  }
+  if (!footprint.empty()) {
+    costmap_ros->setRobotFootprint(footprint);
+  }
+  return costmap_ros;
+}
+
+}  // namespace nav2_costmap_2d
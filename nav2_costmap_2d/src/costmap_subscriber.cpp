@@ -12,46 +12,123 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <memory>
+#include <stdexcept>
 
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/costmap_compression.hpp"
 
 namespace nav2_costmap_2d
 {
 
+namespace
+{
+
+// A Costmap2D reading its cells straight out of a received message, which it
+// keeps alive. It never owns or reallocates the cells, so it must be treated
+// as read-only.
+class CostmapMessageView : public Costmap2D
+{
+public:
+  explicit CostmapMessageView(nav2_msgs::msg::Costmap::ConstSharedPtr msg)
+  : msg_(msg)
+  {
+    size_x_ = msg_->metadata.size_x;
+    size_y_ = msg_->metadata.size_y;
+    resolution_ = msg_->metadata.resolution;
+    origin_x_ = msg_->metadata.origin.position.x;
+    origin_y_ = msg_->metadata.origin.position.y;
+    costmap_ = const_cast<unsigned char *>(msg_->data.data());
+  }
+
+  ~CostmapMessageView() override
+  {
+    // The cells belong to the message, keep ~Costmap2D from freeing them
+    costmap_ = NULL;
+  }
+
+private:
+  nav2_msgs::msg::Costmap::ConstSharedPtr msg_;
+};
+
+}  // namespace
+
+CostmapSubscriber::Transport CostmapSubscriber::transportFromString(
+  const std::string & transport)
+{
+  if (transport == "raw") {
+    return Transport::RAW;
+  }
+  if (transport == "compressed") {
+    return Transport::COMPRESSED;
+  }
+  if (transport == "intra_process") {
+    return Transport::INTRA_PROCESS;
+  }
+  throw std::invalid_argument(
+          "Unknown costmap transport \"" + transport +
+          "\", expected \"raw\", \"compressed\" or \"intra_process\"");
+}
+
 CostmapSubscriber::CostmapSubscriber(
   nav2_util::LifecycleNode::SharedPtr node,
-  const std::string & topic_name)
+  const std::string & topic_name,
+  Transport transport)
 : CostmapSubscriber(node->get_node_base_interface(),
     node->get_node_topics_interface(),
     node->get_node_logging_interface(),
-    topic_name)
+    topic_name, transport)
 {}
 
 CostmapSubscriber::CostmapSubscriber(
   rclcpp::Node::SharedPtr node,
-  const std::string & topic_name)
+  const std::string & topic_name,
+  Transport transport)
 : CostmapSubscriber(node->get_node_base_interface(),
     node->get_node_topics_interface(),
     node->get_node_logging_interface(),
-    topic_name)
+    topic_name, transport)
 {}
 
 CostmapSubscriber::CostmapSubscriber(
   const rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base,
   const rclcpp::node_interfaces::NodeTopicsInterface::SharedPtr node_topics,
   const rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging,
-  const std::string & topic_name)
+  const std::string & topic_name,
+  Transport transport)
 : node_base_(node_base),
   node_topics_(node_topics),
   node_logging_(node_logging),
   topic_name_(topic_name)
 {
-  costmap_sub_ = rclcpp::create_subscription<nav2_msgs::msg::Costmap>(
-    node_topics_, topic_name_,
-    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
-    std::bind(&CostmapSubscriber::costmapCallback, this, std::placeholders::_1));
+  auto qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
+  switch (transport) {
+    case Transport::COMPRESSED:
+      compressed_costmap_sub_ = rclcpp::create_subscription<nav2_msgs::msg::CompressedCostmap>(
+        node_topics_, topic_name_, qos,
+        std::bind(&CostmapSubscriber::compressedCostmapCallback, this, std::placeholders::_1));
+      break;
+    case Transport::INTRA_PROCESS:
+      {
+        // Intra-process delivery does not support transient local durability
+        rclcpp::SubscriptionOptions options;
+        options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
+        costmap_sub_ = rclcpp::create_subscription<nav2_msgs::msg::Costmap>(
+          node_topics_, topic_name_, rclcpp::QoS(rclcpp::KeepLast(1)).reliable(),
+          std::bind(
+            &CostmapSubscriber::intraProcessCostmapCallback, this, std::placeholders::_1),
+          options);
+        break;
+      }
+    case Transport::RAW:
+    default:
+      costmap_sub_ = rclcpp::create_subscription<nav2_msgs::msg::Costmap>(
+        node_topics_, topic_name_, qos,
+        std::bind(&CostmapSubscriber::costmapCallback, this, std::placeholders::_1));
+      break;
+  }
 }
 
 std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmap()
@@ -63,35 +140,75 @@ std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmap()
   return costmap_;
 }
 
-void CostmapSubscriber::toCostmap2D()
+void CostmapSubscriber::resizeCostmap(const nav2_msgs::msg::CostmapMetaData & metadata)
 {
   if (costmap_ == nullptr) {
     costmap_ = std::make_shared<Costmap2D>(
-      costmap_msg_->metadata.size_x, costmap_msg_->metadata.size_y,
-      costmap_msg_->metadata.resolution, costmap_msg_->metadata.origin.position.x,
-      costmap_msg_->metadata.origin.position.y);
-  } else if (costmap_->getSizeInCellsX() != costmap_msg_->metadata.size_x ||  // NOLINT
-    costmap_->getSizeInCellsY() != costmap_msg_->metadata.size_y ||
-    costmap_->getResolution() != costmap_msg_->metadata.resolution ||
-    costmap_->getOriginX() != costmap_msg_->metadata.origin.position.x ||
-    costmap_->getOriginY() != costmap_msg_->metadata.origin.position.y)
+      metadata.size_x, metadata.size_y,
+      metadata.resolution, metadata.origin.position.x,
+      metadata.origin.position.y);
+  } else if (costmap_->getSizeInCellsX() != metadata.size_x ||  // NOLINT
+    costmap_->getSizeInCellsY() != metadata.size_y ||
+    costmap_->getResolution() != metadata.resolution ||
+    costmap_->getOriginX() != metadata.origin.position.x ||
+    costmap_->getOriginY() != metadata.origin.position.y)
   {
     // Update the size of the costmap
     costmap_->resizeMap(
-      costmap_msg_->metadata.size_x, costmap_msg_->metadata.size_y,
-      costmap_msg_->metadata.resolution,
-      costmap_msg_->metadata.origin.position.x,
-      costmap_msg_->metadata.origin.position.y);
+      metadata.size_x, metadata.size_y,
+      metadata.resolution,
+      metadata.origin.position.x,
+      metadata.origin.position.y);
+  }
+}
+
+void CostmapSubscriber::toCostmap2D()
+{
+  if (intra_process_costmap_msg_) {
+    if (intra_process_costmap_msg_.get() == viewed_msg_) {
+      return;
+    }
+    const std::size_t size =
+      static_cast<std::size_t>(intra_process_costmap_msg_->metadata.size_x) *
+      intra_process_costmap_msg_->metadata.size_y;
+    if (intra_process_costmap_msg_->data.size() < size) {
+      throw std::runtime_error("Costmap data does not match its size");
+    }
+    costmap_ = std::make_shared<CostmapMessageView>(intra_process_costmap_msg_);
+    viewed_msg_ = intra_process_costmap_msg_.get();
+    return;
   }
 
-  unsigned char * master_array = costmap_->getCharMap();
-  unsigned int index = 0;
-  for (unsigned int i = 0; i < costmap_msg_->metadata.size_x; ++i) {
-    for (unsigned int j = 0; j < costmap_msg_->metadata.size_y; ++j) {
-      master_array[index] = costmap_msg_->data[index];
-      ++index;
+  // Keep the last decoded costmap until another message arrives. The message may
+  // already be newer than the version read here, which only costs a repeat decode.
+  const uint64_t version = costmap_version_;
+  if (costmap_ && version == decoded_version_) {
+    return;
+  }
+
+  if (compressed_costmap_msg_) {
+    resizeCostmap(compressed_costmap_msg_->metadata);
+    const std::size_t size =
+      static_cast<std::size_t>(compressed_costmap_msg_->metadata.size_x) *
+      compressed_costmap_msg_->metadata.size_y;
+    if (!decodeCostRuns(
+        compressed_costmap_msg_->run_values, compressed_costmap_msg_->run_lengths,
+        costmap_->getCharMap(), size))
+    {
+      throw std::runtime_error("Compressed costmap runs do not match its size");
     }
+    decoded_version_ = version;
+    return;
+  }
+
+  resizeCostmap(costmap_msg_->metadata);
+  const std::size_t size =
+    static_cast<std::size_t>(costmap_msg_->metadata.size_x) * costmap_msg_->metadata.size_y;
+  if (costmap_msg_->data.size() < size) {
+    throw std::runtime_error("Costmap data does not match its size");
   }
+  std::copy(costmap_msg_->data.begin(), costmap_msg_->data.begin() + size, costmap_->getCharMap());
+  decoded_version_ = version;
 }
 
 void CostmapSubscriber::costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg)
@@ -100,6 +217,27 @@ void CostmapSubscriber::costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr
   if (!costmap_received_) {
     costmap_received_ = true;
   }
+  ++costmap_version_;
+}
+
+void CostmapSubscriber::compressedCostmapCallback(
+  const nav2_msgs::msg::CompressedCostmap::SharedPtr msg)
+{
+  compressed_costmap_msg_ = msg;
+  if (!costmap_received_) {
+    costmap_received_ = true;
+  }
+  ++costmap_version_;
+}
+
+void CostmapSubscriber::intraProcessCostmapCallback(
+  nav2_msgs::msg::Costmap::ConstSharedPtr msg)
+{
+  intra_process_costmap_msg_ = msg;
+  if (!costmap_received_) {
+    costmap_received_ = true;
+  }
+  ++costmap_version_;
 }
 
 }  // namespace nav2_costmap_2d
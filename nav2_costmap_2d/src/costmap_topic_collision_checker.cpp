@@ -26,6 +26,7 @@
 #include "nav2_costmap_2d/exceptions.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_util/line_iterator.hpp"
+#include "nav2_util/se2.hpp"
 
 using namespace std::chrono_literals;
 
@@ -39,7 +40,8 @@ CostmapTopicCollisionChecker::CostmapTopicCollisionChecker(
   std::string name,
   std::string global_frame,
   std::string robot_base_frame,
-  double transform_tolerance)
+  double transform_tolerance,
+  unsigned int footprint_mask_yaw_bins)
 : name_(name),
   global_frame_(global_frame),
   robot_base_frame_(robot_base_frame),
@@ -47,6 +49,7 @@ CostmapTopicCollisionChecker::CostmapTopicCollisionChecker(
   costmap_sub_(costmap_sub),
   footprint_sub_(footprint_sub),
   transform_tolerance_(transform_tolerance),
+  footprint_mask_yaw_bins_(footprint_mask_yaw_bins),
   collision_checker_(nullptr)
 {
 }
@@ -71,6 +74,79 @@ bool CostmapTopicCollisionChecker::isCollisionFree(
   }
 }
 
+bool CostmapTopicCollisionChecker::isCollisionFree(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  try {
+    std::vector<double> costs;
+    return scorePoses(poses, costs, true) == poses.size();
+  } catch (const IllegalPoseException & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (const CollisionCheckerException & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (...) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "Failed to check pose scores!");
+    return false;
+  }
+}
+
+bool CostmapTopicCollisionChecker::buildSweep(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses, FootprintSweep & sweep)
+{
+  sweep.clear();
+  try {
+    const uint64_t version = costmap_sub_.getCostmapVersion();
+    sweep.build(*costmap_sub_.getCostmap(), getFootprintSpec(), poses, version);
+    return true;
+  } catch (const std::runtime_error & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+  }
+  sweep.clear();
+  return false;
+}
+
+bool CostmapTopicCollisionChecker::isCollisionFree(
+  FootprintSweep & sweep, std::size_t first, std::size_t last)
+{
+  if (sweep.empty()) {
+    return false;
+  }
+
+  const uint64_t version = costmap_sub_.getCostmapVersion();
+  if (version != sweep.version()) {
+    try {
+      auto costmap = costmap_sub_.getCostmap();
+      if (!sweep.update(*costmap, version)) {
+        // The grid moved by a fraction of a cell, so the swept cells no longer line up
+        const Footprint footprint = sweep.footprint();
+        const std::vector<geometry_msgs::msg::Pose2D> poses = sweep.poses();
+        sweep.build(*costmap, footprint, poses, version);
+      }
+    } catch (const std::runtime_error & e) {
+      RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+      return false;
+    }
+  }
+
+  return sweep.firstCollision(first, last) == std::min(last, sweep.size());
+}
+
+std::size_t CostmapTopicCollisionChecker::scorePoses(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses, std::vector<double> & costs,
+  bool stop_at_lethal)
+{
+  try {
+    collision_checker_.setCostmap(costmap_sub_.getCostmap());
+  } catch (const std::runtime_error & e) {
+    throw CollisionCheckerException(e.what());
+  }
+
+  return collision_checker_.footprintCostsAtPoses(
+    poses, getFootprintSpec(), costs, stop_at_lethal, footprint_mask_yaw_bins_);
+}
+
 double CostmapTopicCollisionChecker::scorePose(
   const geometry_msgs::msg::Pose2D & pose)
 {
@@ -86,21 +162,40 @@ double CostmapTopicCollisionChecker::scorePose(
     throw IllegalPoseException(name_, "Pose Goes Off Grid.");
   }
 
+  if (footprint_mask_yaw_bins_ > 0) {
+    return collision_checker_.footprintMaskCostAtPose(
+      pose.x, pose.y, pose.theta, getFootprintSpec(), footprint_mask_yaw_bins_);
+  }
+
   return collision_checker_.footprintCost(getFootprint(pose));
 }
 
 Footprint CostmapTopicCollisionChecker::getFootprint(const geometry_msgs::msg::Pose2D & pose)
 {
+  Footprint footprint;
+  transformFootprint(pose.x, pose.y, pose.theta, getFootprintSpec(), footprint);
+
+  return footprint;
+}
+
+Footprint CostmapTopicCollisionChecker::getFootprintSpec()
+{
+  // Read before the footprint itself, so a message arriving in between is picked up next time
+  const uint64_t version = footprint_sub_.getFootprintVersion();
+
   Footprint footprint;
   if (!footprint_sub_.getFootprint(footprint)) {
     throw CollisionCheckerException("Current footprint not available.");
   }
 
-  Footprint footprint_spec;
-  unorientFootprint(footprint, footprint_spec);
-  transformFootprint(pose.x, pose.y, pose.theta, footprint_spec, footprint);
+  if (version != footprint_spec_version_ || footprint_spec_.empty()) {
+    Footprint footprint_spec;
+    unorientFootprint(footprint, footprint_spec);
+    footprint_spec_ = footprint_spec;
+    footprint_spec_version_ = version;
+  }
 
-  return footprint;
+  return footprint_spec_;
 }
 
 void CostmapTopicCollisionChecker::unorientFootprint(
@@ -117,7 +212,7 @@ void CostmapTopicCollisionChecker::unorientFootprint(
 
   double x = current_pose.pose.position.x;
   double y = current_pose.pose.position.y;
-  double theta = tf2::getYaw(current_pose.pose.orientation);
+  double theta = nav2_util::se2::yaw(current_pose.pose.orientation);
 
   Footprint temp;
   transformFootprint(-x, -y, 0, oriented_footprint, temp);
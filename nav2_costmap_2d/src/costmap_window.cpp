@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_costmap_2d/costmap_window.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace nav2_costmap_2d
+{
+
+bool CostmapWindow::update(
+  std::shared_ptr<const Costmap2D> snapshot, double wx, double wy,
+  unsigned int size_x, unsigned int size_y, unsigned char fill)
+{
+  const int map_x = static_cast<int>(snapshot->getSizeInCellsX());
+  const int map_y = static_cast<int>(snapshot->getSizeInCellsY());
+  resolution_ = snapshot->getResolution();
+  offset_x_ = static_cast<int>(std::floor((wx - snapshot->getOriginX()) / resolution_)) -
+    static_cast<int>(size_x / 2);
+  offset_y_ = static_cast<int>(std::floor((wy - snapshot->getOriginY()) / resolution_)) -
+    static_cast<int>(size_y / 2);
+  origin_x_ = snapshot->getOriginX() + offset_x_ * resolution_;
+  origin_y_ = snapshot->getOriginY() + offset_y_ * resolution_;
+  size_x_ = size_x;
+  size_y_ = size_y;
+
+  const unsigned char * source = snapshot->getCharMap();
+  if (offset_x_ >= 0 && offset_y_ >= 0 && offset_x_ + static_cast<int>(size_x) <= map_x &&
+    offset_y_ + static_cast<int>(size_y) <= map_y)
+  {
+    stride_ = static_cast<unsigned int>(map_x);
+    cells_ = source + static_cast<std::size_t>(offset_y_) * map_x + offset_x_;
+    snapshot_ = std::move(snapshot);
+    return true;
+  }
+
+  // Only the part on the snapshot is copied, a row at a time
+  stride_ = size_x;
+  buffer_.assign(static_cast<std::size_t>(size_x) * size_y, fill);
+  const int x0 = std::max(offset_x_, 0);
+  const int xn = std::min(offset_x_ + static_cast<int>(size_x), map_x);
+  const int y0 = std::max(offset_y_, 0);
+  const int yn = std::min(offset_y_ + static_cast<int>(size_y), map_y);
+  for (int y = y0; y < yn && x0 < xn; ++y) {
+    std::memcpy(
+      buffer_.data() + static_cast<std::size_t>(y - offset_y_) * size_x + (x0 - offset_x_),
+      source + static_cast<std::size_t>(y) * map_x + x0, xn - x0);
+  }
+  cells_ = buffer_.data();
+  snapshot_ = std::move(snapshot);
+  return false;
+}
+
+void CostmapWindow::reset()
+{
+  snapshot_.reset();
+  cells_ = nullptr;
+  size_x_ = size_y_ = stride_ = 0;
+}
+
+bool CostmapWindow::worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my) const
+{
+  if (wx < origin_x_ || wy < origin_y_) {
+    return false;
+  }
+  mx = static_cast<unsigned int>((wx - origin_x_) / resolution_);
+  my = static_cast<unsigned int>((wy - origin_y_) / resolution_);
+  return mx < size_x_ && my < size_y_;
+}
+
+void CostmapWindow::mapToWorld(unsigned int mx, unsigned int my, double & wx, double & wy) const
+{
+  wx = origin_x_ + (mx + 0.5) * resolution_;
+  wy = origin_y_ + (my + 0.5) * resolution_;
+}
+
+void CostmapWindow::copyTo(Costmap2D & costmap) const
+{
+  if (costmap.getSizeInCellsX() != size_x_ || costmap.getSizeInCellsY() != size_y_ ||
+    costmap.getResolution() != resolution_ || costmap.getOriginX() != origin_x_ ||
+    costmap.getOriginY() != origin_y_)
+  {
+    costmap.resizeMap(size_x_, size_y_, resolution_, origin_x_, origin_y_);
+  }
+  unsigned char * dest = costmap.getCharMap();
+  for (unsigned int y = 0; y < size_y_; ++y) {
+    std::memcpy(dest + static_cast<std::size_t>(y) * size_x_, row(y), size_x_);
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,104 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/dirty_region_set.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+DirtyRegionSet::DirtyRegionSet(unsigned int max_regions)
+{
+  setMaxRegions(max_regions);
+}
+
+void DirtyRegionSet::setMaxRegions(unsigned int max_regions)
+{
+  max_regions_ = std::max(1u, max_regions);
+  // Re-adding enforces the new bound
+  std::vector<Region> regions;
+  regions.swap(regions_);
+  for (const Region & region : regions) {
+    add(region);
+  }
+}
+
+void DirtyRegionSet::add(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn)
+{
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+  add(Region{x0, xn, y0, yn});
+}
+
+void DirtyRegionSet::add(Region region)
+{
+  // Absorb every rectangle the new one overlaps or touches. Growing the region
+  // can make it reach rectangles that were checked before, so rescan until
+  // nothing merges.
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (auto it = regions_.begin(); it != regions_.end(); ++it) {
+      if (touches(region, *it)) {
+        region = merge(region, *it);
+        regions_.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+  regions_.push_back(region);
+
+  if (regions_.size() <= max_regions_) {
+    return;
+  }
+
+  // Over the limit: merge the pair that adds the fewest unchanged cells
+  std::size_t best_i = 0, best_j = 1;
+  uint64_t best_waste = std::numeric_limits<uint64_t>::max();
+  for (std::size_t i = 0; i < regions_.size(); ++i) {
+    for (std::size_t j = i + 1; j < regions_.size(); ++j) {
+      uint64_t waste = merge(regions_[i], regions_[j]).area() -
+        regions_[i].area() - regions_[j].area();
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_i = i;
+        best_j = j;
+      }
+    }
+  }
+
+  Region combined = merge(regions_[best_i], regions_[best_j]);
+  regions_.erase(regions_.begin() + best_j);
+  regions_.erase(regions_.begin() + best_i);
+  add(combined);
+}
+
+DirtyRegionSet::Region DirtyRegionSet::merge(const Region & a, const Region & b)
+{
+  return Region{std::min(a.x0, b.x0), std::max(a.xn, b.xn),
+    std::min(a.y0, b.y0), std::max(a.yn, b.yn)};
+}
+
+bool DirtyRegionSet::touches(const Region & a, const Region & b)
+{
+  return a.x0 <= b.xn && b.x0 <= a.xn && a.y0 <= b.yn && b.y0 <= a.yn;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/distance_transform.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+// Rows or columns handed to a worker at a time
+const unsigned int LINES_PER_TASK = 16;
+
+/**
+ * @brief 1D squared distance transform of n samples, Felzenszwalb and Huttenlocher
+ * @param f Input samples, 0 at obstacles and DISTANCE_TRANSFORM_INF elsewhere
+ * @param d Output squared distances
+ * @param v Scratch, n parabola locations
+ * @param z Scratch, n + 1 parabola boundaries
+ */
+void transformLine(const float * f, float * d, int n, int * v, double * z)
+{
+  // Boundaries are kept in double so squared indices of large maps stay exact
+  auto intersect = [f](int p, int q) {
+      return ((static_cast<double>(f[q]) + q * q) - (static_cast<double>(f[p]) + p * p)) /
+             (2.0 * (q - p));
+    };
+
+  int k = 0;
+  v[0] = 0;
+  z[0] = -std::numeric_limits<double>::infinity();
+  z[1] = std::numeric_limits<double>::infinity();
+  for (int q = 1; q < n; ++q) {
+    double s = intersect(v[k], q);
+    while (s <= z[k]) {
+      --k;
+      s = intersect(v[k], q);
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+
+  k = 0;
+  for (int q = 0; q < n; ++q) {
+    while (z[k + 1] < q) {
+      ++k;
+    }
+    const double dq = q - v[k];
+    d[q] = static_cast<float>(
+      std::min(dq * dq + f[v[k]], static_cast<double>(DISTANCE_TRANSFORM_INF)));
+  }
+}
+
+void runLines(
+  unsigned int num_lines, nav2_util::ThreadPool * pool,
+  const std::function<void(unsigned int, unsigned int)> & lines)
+{
+  const unsigned int num_tasks = (num_lines + LINES_PER_TASK - 1) / LINES_PER_TASK;
+  auto task = [&](std::size_t t) {
+      const unsigned int begin = static_cast<unsigned int>(t) * LINES_PER_TASK;
+      lines(begin, std::min(begin + LINES_PER_TASK, num_lines));
+    };
+  if (pool && pool->size() > 1 && num_tasks > 1) {
+    pool->parallelFor(num_tasks, task);
+  } else {
+    for (unsigned int t = 0; t < num_tasks; ++t) {
+      task(t);
+    }
+  }
+}
+
+}  // namespace
+
+void squaredDistanceTransform(
+  const unsigned char * costs, unsigned int size_x,
+  unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y,
+  bool unknown_is_obstacle, float * squared_distances,
+  nav2_util::ThreadPool * pool)
+{
+  if (max_x <= min_x || max_y <= min_y) {
+    return;
+  }
+  const unsigned int width = max_x - min_x;
+  const unsigned int height = max_y - min_y;
+
+  // Rows: distance to the nearest obstacle in the same row
+  runLines(
+    height, pool, [&](unsigned int begin, unsigned int end) {
+      std::vector<float> f(width);
+      std::vector<int> v(width);
+      std::vector<double> z(width + 1);
+      for (unsigned int y = begin; y < end; ++y) {
+        const unsigned char * row = costs + (min_y + y) * size_x + min_x;
+        for (unsigned int x = 0; x < width; ++x) {
+          const bool obstacle = row[x] == LETHAL_OBSTACLE ||
+          (unknown_is_obstacle && row[x] == NO_INFORMATION);
+          f[x] = obstacle ? 0.0f : DISTANCE_TRANSFORM_INF;
+        }
+        transformLine(
+          f.data(), squared_distances + y * width, static_cast<int>(width), v.data(), z.data());
+      }
+    });
+
+  // Columns: combine the row distances into the 2D distance
+  runLines(
+    width, pool, [&](unsigned int begin, unsigned int end) {
+      std::vector<float> f(height);
+      std::vector<float> d(height);
+      std::vector<int> v(height);
+      std::vector<double> z(height + 1);
+      for (unsigned int x = begin; x < end; ++x) {
+        for (unsigned int y = 0; y < height; ++y) {
+          f[y] = squared_distances[y * width + x];
+        }
+        transformLine(f.data(), d.data(), static_cast<int>(height), v.data(), z.data());
+        for (unsigned int y = 0; y < height; ++y) {
+          squared_distances[y * width + x] = d[y];
+        }
+      }
+    });
+}
+
+}  // namespace nav2_costmap_2d
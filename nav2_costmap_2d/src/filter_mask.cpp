@@ -0,0 +1,133 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/filter_mask.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "nav2_costmap_2d/combination_kernels.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+FilterMask::FilterMask(const nav_msgs::msg::OccupancyGrid & mask, int8_t min_value)
+: frame_(mask.header.frame_id), resolution_(mask.info.resolution)
+{
+  const unsigned int width = mask.info.width;
+  const unsigned int height = mask.info.height;
+  unsigned int min_x = width, min_y = height, max_x = 0, max_y = 0;
+  for (unsigned int y = 0; y < height; ++y) {
+    const int8_t * row = mask.data.data() + y * width;
+    for (unsigned int x = 0; x < width; ++x) {
+      if (row[x] >= min_value) {
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x + 1);
+        min_y = std::min(min_y, y);
+        max_y = y + 1;
+      }
+    }
+  }
+  if (min_x >= max_x) {
+    return;
+  }
+
+  size_x_ = max_x - min_x;
+  size_y_ = max_y - min_y;
+  origin_x_ = mask.info.origin.position.x + min_x * resolution_;
+  origin_y_ = mask.info.origin.position.y + min_y * resolution_;
+  data_.resize(size_x_ * size_y_);
+  for (unsigned int y = 0; y < size_y_; ++y) {
+    const int8_t * row = mask.data.data() + (min_y + y) * width + min_x;
+    int8_t * out = data_.data() + y * size_x_;
+    for (unsigned int x = 0; x < size_x_; ++x) {
+      out[x] = row[x] >= min_value ? row[x] : 0;
+    }
+  }
+}
+
+MaskRaster rasterizeMask(
+  const FilterMask & mask, double resolution, double grid_x, double grid_y,
+  unsigned char cost)
+{
+  MaskRaster raster;
+  raster.resolution = resolution;
+  if (mask.empty()) {
+    return raster;
+  }
+
+  const double end_x = mask.getOriginX() + mask.getSizeInCellsX() * mask.getResolution();
+  const double end_y = mask.getOriginY() + mask.getSizeInCellsY() * mask.getResolution();
+  // With some slack for the single precision resolution of the mask
+  const double slack = 1e-4;
+  raster.origin_x = grid_x +
+    std::floor((mask.getOriginX() - grid_x) / resolution + slack) * resolution;
+  raster.origin_y = grid_y +
+    std::floor((mask.getOriginY() - grid_y) / resolution + slack) * resolution;
+  raster.size_x = static_cast<unsigned int>(
+    std::ceil((end_x - raster.origin_x) / resolution - slack));
+  raster.size_y = static_cast<unsigned int>(
+    std::ceil((end_y - raster.origin_y) / resolution - slack));
+  raster.costs.assign(raster.size_x * raster.size_y, NO_INFORMATION);
+  for (unsigned int y = 0; y < raster.size_y; ++y) {
+    const double wy = raster.origin_y + (y + 0.5) * resolution;
+    unsigned char * row = raster.costs.data() + y * raster.size_x;
+    for (unsigned int x = 0; x < raster.size_x; ++x) {
+      if (mask.valueAt(raster.origin_x + (x + 0.5) * resolution, wy) > 0) {
+        row[x] = cost;
+      }
+    }
+  }
+  return raster;
+}
+
+bool applyMaskMax(
+  const MaskRaster & raster, Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  const double resolution = master_grid.getResolution();
+  if (std::fabs(raster.resolution - resolution) > 1e-6 * resolution) {
+    return false;
+  }
+  const double fx = (raster.origin_x - master_grid.getOriginX()) / resolution;
+  const double fy = (raster.origin_y - master_grid.getOriginY()) / resolution;
+  const double offset_x = std::round(fx);
+  const double offset_y = std::round(fy);
+  if (std::fabs(fx - offset_x) > 1e-3 || std::fabs(fy - offset_y) > 1e-3) {
+    return false;
+  }
+
+  // Master cell (i, j) is raster cell (i - off_x, j - off_y)
+  const int off_x = static_cast<int>(offset_x);
+  const int off_y = static_cast<int>(offset_y);
+  const int start_i = std::max(min_i, off_x);
+  const int end_i = std::min(max_i, off_x + static_cast<int>(raster.size_x));
+  const int start_j = std::max(min_j, off_y);
+  const int end_j = std::min(max_j, off_y + static_cast<int>(raster.size_y));
+  if (start_i >= end_i) {
+    return true;
+  }
+  unsigned char * master = master_grid.getCharMap();
+  const unsigned int size_x = master_grid.getSizeInCellsX();
+  for (int j = start_j; j < end_j; ++j) {
+    combineRowMax(
+      master + j * size_x + start_i,
+      raster.costs.data() + (j - off_y) * raster.size_x + (start_i - off_x),
+      end_i - start_i);
+  }
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
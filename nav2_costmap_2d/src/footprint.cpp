@@ -36,6 +36,7 @@
 #include "geometry_msgs/msg/point32.hpp"
 #include "nav2_costmap_2d/array_parser.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
+#include "nav2_util/se2.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -111,15 +112,13 @@ void transformFootprint(
   const std::vector<geometry_msgs::msg::Point> & footprint_spec,
   std::vector<geometry_msgs::msg::Point> & oriented_footprint)
 {
-  // build the oriented footprint at a given location
-  oriented_footprint.clear();
-  double cos_th = cos(theta);
-  double sin_th = sin(theta);
+  // build the oriented footprint at a given location, in place of the previous one
+  oriented_footprint.resize(footprint_spec.size());
+  const nav2_util::se2::Transform pose(x, y, theta);
   for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
-    geometry_msgs::msg::Point new_pt;
-    new_pt.x = x + (footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th);
-    new_pt.y = y + (footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th);
-    oriented_footprint.push_back(new_pt);
+    geometry_msgs::msg::Point & new_pt = oriented_footprint[i];
+    pose.apply(footprint_spec[i].x, footprint_spec[i].y, new_pt.x, new_pt.y);
+    new_pt.z = 0.0;
   }
 }
 
@@ -129,14 +128,16 @@ void transformFootprint(
   geometry_msgs::msg::PolygonStamped & oriented_footprint)
 {
   // build the oriented footprint at a given location
-  oriented_footprint.polygon.points.clear();
-  double cos_th = cos(theta);
-  double sin_th = sin(theta);
+  std::vector<geometry_msgs::msg::Point32> & points = oriented_footprint.polygon.points;
+  points.resize(footprint_spec.size());
+  const nav2_util::se2::Transform pose(x, y, theta);
   for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
-    geometry_msgs::msg::Point32 new_pt;
-    new_pt.x = x + (footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th);
-    new_pt.y = y + (footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th);
-    oriented_footprint.polygon.points.push_back(new_pt);
+    geometry_msgs::msg::Point32 & new_pt = points[i];
+    double px, py;
+    pose.apply(footprint_spec[i].x, footprint_spec[i].y, px, py);
+    new_pt.x = px;
+    new_pt.y = py;
+    new_pt.z = 0.0f;
   }
 }
 
@@ -216,4 +217,56 @@ bool makeFootprintFromString(
   return true;
 }
 
+CompactFootprint::CompactFootprint(const std::vector<geometry_msgs::msg::Point> & footprint)
+{
+  x_.reserve(footprint.size());
+  y_.reserve(footprint.size());
+  for (const auto & point : footprint) {
+    x_.push_back(point.x);
+    y_.push_back(point.y);
+  }
+  calculateMinAndMaxDistances(footprint, inscribed_radius_, circumscribed_radius_);
+}
+
+bool CompactFootprint::matches(const std::vector<geometry_msgs::msg::Point> & footprint) const
+{
+  if (footprint.size() != x_.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < footprint.size(); ++i) {
+    if (footprint[i].x != x_[i] || footprint[i].y != y_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CompactFootprint::transform(
+  double x, double y, double theta, double * out_x, double * out_y) const
+{
+  nav2_util::se2::transformPoints(
+    nav2_util::se2::Transform(x, y, theta), x_.data(), y_.data(), out_x, out_y, x_.size());
+}
+
+void CompactFootprint::transform(
+  const geometry_msgs::msg::Pose2D * poses, std::size_t n,
+  double * out_x, double * out_y) const
+{
+  const std::size_t size = x_.size();
+  for (std::size_t p = 0; p < n; ++p) {
+    transform(poses[p].x, poses[p].y, poses[p].theta, out_x + p * size, out_y + p * size);
+  }
+}
+
+void CompactFootprint::transform(
+  double x, double y, double theta, std::vector<geometry_msgs::msg::Point> & oriented) const
+{
+  const nav2_util::se2::Transform pose(x, y, theta);
+  oriented.resize(x_.size());
+  for (std::size_t i = 0; i < x_.size(); ++i) {
+    pose.apply(x_[i], y_[i], oriented[i].x, oriented[i].y);
+    oriented[i].z = 0.0;
+  }
+}
+
 }  // end namespace nav2_costmap_2d
@@ -18,6 +18,10 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 #include "nav2_costmap_2d/footprint_collision_checker.hpp"
 
@@ -31,6 +35,38 @@ using namespace std::chrono_literals;
 namespace nav2_costmap_2d
 {
 
+namespace
+{
+
+// Max cost along the closed outline of the n vertices given by vertex(i, wx, wy)
+template<typename VertexT>
+double outlineCost(FootprintCollisionChecker & checker, std::size_t n, VertexT vertex)
+{
+  double wx, wy;
+  unsigned int first_x = 0, first_y = 0, last_x = 0, last_y = 0, mx, my;
+  double cost = 0.0;
+  for (std::size_t i = 0; i < n; ++i) {
+    vertex(i, wx, wy);
+    if (!checker.worldToMap(wx, wy, mx, my)) {
+      return static_cast<double>(LETHAL_OBSTACLE);
+    }
+    if (i == 0) {
+      first_x = mx;
+      first_y = my;
+    } else {
+      cost = std::max(cost, checker.lineCost(last_x, mx, last_y, my));
+    }
+    last_x = mx;
+    last_y = my;
+  }
+  if (n == 0) {
+    return cost;
+  }
+  return std::max(cost, checker.lineCost(last_x, first_x, last_y, first_y));
+}
+
+}  // namespace
+
 FootprintCollisionChecker::FootprintCollisionChecker()
 : costmap_(nullptr)
 {
@@ -44,56 +80,20 @@ FootprintCollisionChecker::FootprintCollisionChecker(
 
 double FootprintCollisionChecker::footprintCost(const Footprint footprint)
 {
-  // now we really have to lay down the footprint in the costmap_ grid
-  unsigned int x0, x1, y0, y1;
-  double footprint_cost = 0.0;
-
-  // we need to rasterize each line in the footprint
-  for (unsigned int i = 0; i < footprint.size() - 1; ++i) {
-    // get the cell coord of the first point
-    if (!worldToMap(footprint[i].x, footprint[i].y, x0, y0)) {
-      return static_cast<double>(LETHAL_OBSTACLE);
-    }
-
-    // get the cell coord of the second point
-    if (!worldToMap(footprint[i + 1].x, footprint[i + 1].y, x1, y1)) {
-      return static_cast<double>(LETHAL_OBSTACLE);
-    }
-
-    footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
-  }
-
-  // we also need to connect the first point in the footprint to the last point
-  // get the cell coord of the last point
-  if (!worldToMap(footprint.back().x, footprint.back().y, x0, y0)) {
-    return static_cast<double>(LETHAL_OBSTACLE);
-  }
-
-  // get the cell coord of the first point
-  if (!worldToMap(footprint.front().x, footprint.front().y, x1, y1)) {
-    return static_cast<double>(LETHAL_OBSTACLE);
-  }
-
-  footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
-
-  // if all line costs are legal... then we can return that the footprint is legal
-  return footprint_cost;
+  // rasterize each line of the footprint, the last one back to the first point
+  return outlineCost(
+    *this, footprint.size(), [&footprint](std::size_t i, double & wx, double & wy) {
+      wx = footprint[i].x;
+      wy = footprint[i].y;
+    });
 }
 
 double FootprintCollisionChecker::lineCost(int x0, int x1, int y0, int y1) const
 {
-  double line_cost = 0.0;
-  double point_cost = -1.0;
-
-  for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
-
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
-  }
-
-  return line_cost;
+  // Nothing costs more than NO_INFORMATION, so the walk can end there
+  return nav2_util::maxCostAlongLine(
+    nav2_util::LineIterator(x0, y0, x1, y1), [this](int x, int y) {return pointCost(x, y);},
+    static_cast<double>(NO_INFORMATION));
 }
 
 bool FootprintCollisionChecker::worldToMap(
@@ -115,17 +115,228 @@ void FootprintCollisionChecker::setCostmap(std::shared_ptr<nav2_costmap_2d::Cost
 double FootprintCollisionChecker::footprintCostAtPose(
   double x, double y, double theta, const Footprint footprint)
 {
-  double cos_th = cos(theta);
-  double sin_th = sin(theta);
-  Footprint oriented_footprint;
-  for (unsigned int i = 0; i < footprint.size(); ++i) {
-    geometry_msgs::msg::Point new_pt;
-    new_pt.x = x + (footprint[i].x * cos_th - footprint[i].y * sin_th);
-    new_pt.y = y + (footprint[i].x * sin_th + footprint[i].y * cos_th);
-    oriented_footprint.push_back(new_pt);
+  const double cos_th = cos(theta);
+  const double sin_th = sin(theta);
+  return outlineCost(
+    *this, footprint.size(), [&](std::size_t i, double & wx, double & wy) {
+      wx = x + (footprint[i].x * cos_th - footprint[i].y * sin_th);
+      wy = y + (footprint[i].x * sin_th + footprint[i].y * cos_th);
+    });
+}
+
+double FootprintCollisionChecker::footprintCostAtPose(
+  double x, double y, double theta, const CompactFootprint & footprint)
+{
+  const double cos_th = cos(theta);
+  const double sin_th = sin(theta);
+  const double * fx = footprint.x();
+  const double * fy = footprint.y();
+  return outlineCost(
+    *this, footprint.size(), [&](std::size_t i, double & wx, double & wy) {
+      wx = x + (fx[i] * cos_th - fy[i] * sin_th);
+      wy = y + (fx[i] * sin_th + fy[i] * cos_th);
+    });
+}
+
+double FootprintCollisionChecker::footprintMaskCostAtPose(
+  double x, double y, double theta, const Footprint & footprint,
+  unsigned int yaw_bins, bool filled)
+{
+  if (footprint.empty() || yaw_bins == 0) {
+    return footprintCostAtPose(x, y, theta, footprint);
+  }
+
+  updateFootprintMasks(footprint, yaw_bins, filled);
+  return maskCostAtPose(x, y, theta);
+}
+
+double FootprintCollisionChecker::maskCostAtPose(double x, double y, double theta) const
+{
+  unsigned int mx, my;
+  if (!costmap_->worldToMap(x, y, mx, my)) {
+    return static_cast<double>(LETHAL_OBSTACLE);
+  }
+
+  const long yaw_bins = static_cast<long>(mask_yaw_bins_);
+  long bin = std::lround(theta / (2.0 * M_PI) * yaw_bins) % yaw_bins;
+  if (bin < 0) {
+    bin += yaw_bins;
+  }
+  const FootprintMask & mask = masks_[bin];
+
+  // The outline cells lie within the bounding box of its vertices, so this matches
+  // footprintCost rejecting any vertex that falls off the map
+  const int cx = static_cast<int>(mx);
+  const int cy = static_cast<int>(my);
+  if (cx + mask.min_dx < 0 || cy + mask.min_dy < 0 ||
+    cx + mask.max_dx >= static_cast<int>(costmap_->getSizeInCellsX()) ||
+    cy + mask.max_dy >= static_cast<int>(costmap_->getSizeInCellsY()))
+  {
+    return static_cast<double>(LETHAL_OBSTACLE);
+  }
+
+  const unsigned char * cell = costmap_->getCharMap() + costmap_->getIndex(mx, my);
+  unsigned char cost = 0;
+  for (const int offset : mask.offsets) {
+    cost = std::max(cost, cell[offset]);
+  }
+  return static_cast<double>(cost);
+}
+
+std::size_t FootprintCollisionChecker::footprintCostsAtPoses(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses, const Footprint & footprint,
+  std::vector<double> & costs, bool stop_at_lethal, unsigned int yaw_bins,
+  nav2_util::ThreadPool * pool)
+{
+  costs.assign(poses.size(), -1.0);
+
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  const bool use_masks = yaw_bins > 0 && !footprint.empty();
+  CompactFootprint compact;
+  if (use_masks) {
+    updateFootprintMasks(footprint, yaw_bins, false);
+  } else {
+    compact = CompactFootprint(footprint);
+  }
+
+  // Poses are handed out in chunks so an early exit skips whole chunks past the
+  // first lethal pose found so far
+  const std::size_t chunk_size = 16;
+  const std::size_t num_chunks = (poses.size() + chunk_size - 1) / chunk_size;
+  std::atomic<std::size_t> first_lethal(poses.size());
+
+  auto score_chunk = [&](std::size_t chunk) {
+      const std::size_t begin = chunk * chunk_size;
+      const std::size_t end = std::min(begin + chunk_size, poses.size());
+      for (std::size_t i = begin; i < end; ++i) {
+        if (stop_at_lethal && i > first_lethal.load(std::memory_order_relaxed)) {
+          return;
+        }
+
+        const geometry_msgs::msg::Pose2D & pose = poses[i];
+        unsigned int mx, my;
+        if (use_masks) {
+          costs[i] = maskCostAtPose(pose.x, pose.y, pose.theta);
+        } else if (!costmap_->worldToMap(pose.x, pose.y, mx, my)) {
+          costs[i] = static_cast<double>(LETHAL_OBSTACLE);
+        } else {
+          costs[i] = footprintCostAtPose(pose.x, pose.y, pose.theta, compact);
+        }
+
+        if (costs[i] >= LETHAL_OBSTACLE) {
+          std::size_t current = first_lethal.load(std::memory_order_relaxed);
+          while (i < current && !first_lethal.compare_exchange_weak(current, i)) {
+          }
+          if (stop_at_lethal) {
+            return;
+          }
+        }
+      }
+    };
+
+  if (pool && pool->size() > 1 && num_chunks > 1) {
+    pool->parallelFor(num_chunks, score_chunk);
+  } else {
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk) {
+      score_chunk(chunk);
+      if (stop_at_lethal && first_lethal.load() < poses.size()) {
+        break;
+      }
+    }
+  }
+
+  // Workers may have scored poses past the first lethal one before seeing it
+  const std::size_t result = first_lethal.load();
+  if (stop_at_lethal) {
+    for (std::size_t i = result + 1; i < costs.size(); ++i) {
+      costs[i] = -1.0;
+    }
+  }
+  return result;
+}
+
+void FootprintCollisionChecker::updateFootprintMasks(
+  const Footprint & footprint, unsigned int yaw_bins, bool filled)
+{
+  const double resolution = costmap_->getResolution();
+  const unsigned int size_x = costmap_->getSizeInCellsX();
+
+  bool same_footprint = footprint.size() == mask_footprint_.size();
+  for (unsigned int i = 0; same_footprint && i < footprint.size(); ++i) {
+    same_footprint = footprint[i].x == mask_footprint_[i].x &&
+      footprint[i].y == mask_footprint_[i].y;
+  }
+  if (same_footprint && yaw_bins == mask_yaw_bins_ && filled == mask_filled_ &&
+    resolution == mask_resolution_ && size_x == mask_size_x_)
+  {
+    return;
   }
 
-  return footprintCost(oriented_footprint);
+  mask_footprint_ = footprint;
+  mask_yaw_bins_ = yaw_bins;
+  mask_filled_ = filled;
+  mask_resolution_ = resolution;
+  mask_size_x_ = size_x;
+  masks_.assign(yaw_bins, FootprintMask());
+
+  std::vector<std::pair<int, int>> vertices(footprint.size());
+  std::vector<std::pair<int, int>> cells;
+  for (unsigned int bin = 0; bin < yaw_bins; ++bin) {
+    const double theta = 2.0 * M_PI * bin / yaw_bins;
+    const double cos_th = cos(theta);
+    const double sin_th = sin(theta);
+
+    // Vertex cells relative to a pose sitting at the center of its cell
+    for (unsigned int i = 0; i < footprint.size(); ++i) {
+      const double vx = footprint[i].x * cos_th - footprint[i].y * sin_th;
+      const double vy = footprint[i].x * sin_th + footprint[i].y * cos_th;
+      vertices[i].first = static_cast<int>(std::floor(vx / resolution + 0.5));
+      vertices[i].second = static_cast<int>(std::floor(vy / resolution + 0.5));
+    }
+
+    // Stored as (dy, dx) so that sorting orders the cells row by row
+    cells.clear();
+    for (unsigned int i = 0; i < vertices.size(); ++i) {
+      const std::pair<int, int> & a = vertices[i];
+      const std::pair<int, int> & b = vertices[(i + 1) % vertices.size()];
+      for (nav2_util::LineIterator line(a.first, a.second, b.first, b.second);
+        line.isValid(); line.advance())
+      {
+        cells.emplace_back(line.getY(), line.getX());
+      }
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    if (filled) {
+      // Fill each row between its outermost outline cells, as convexFillCells does
+      std::vector<std::pair<int, int>> outline;
+      outline.swap(cells);
+      for (auto row = outline.begin(); row != outline.end(); ) {
+        auto row_end = row;
+        while (row_end != outline.end() && row_end->first == row->first) {
+          ++row_end;
+        }
+        for (int dx = row->second; dx <= (row_end - 1)->second; ++dx) {
+          cells.emplace_back(row->first, dx);
+        }
+        row = row_end;
+      }
+    }
+
+    FootprintMask & mask = masks_[bin];
+    mask.offsets.reserve(cells.size());
+    mask.min_dx = mask.min_dy = std::numeric_limits<int>::max();
+    mask.max_dx = mask.max_dy = std::numeric_limits<int>::min();
+    for (const auto & cell : cells) {
+      mask.offsets.push_back(cell.first * static_cast<int>(size_x) + cell.second);
+      mask.min_dx = std::min(mask.min_dx, cell.second);
+      mask.max_dx = std::max(mask.max_dx, cell.second);
+      mask.min_dy = std::min(mask.min_dy, cell.first);
+      mask.max_dy = std::max(mask.max_dy, cell.first);
+    }
+  }
 }
 
 }  // namespace nav2_costmap_2d
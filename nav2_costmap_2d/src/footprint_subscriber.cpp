@@ -107,6 +107,7 @@ FootprintSubscriber::footprint_callback(const geometry_msgs::msg::PolygonStamped
   if (!footprint_received_) {
     footprint_received_ = true;
   }
+  ++footprint_version_;
 }
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,197 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/footprint_sweep.hpp"
+
+#include "angles/angles.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/line_iterator.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+inline uint64_t cellKey(int x, int y)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+}  // namespace
+
+void FootprintSweep::build(
+  const Costmap2D & costmap, const std::vector<geometry_msgs::msg::Point> & footprint,
+  const std::vector<geometry_msgs::msg::Pose2D> & poses, uint64_t costmap_version)
+{
+  clear();
+  poses_ = poses;
+  footprint_ = footprint;
+  resolution_ = costmap.getResolution();
+  origin_x_ = costmap.getOriginX();
+  origin_y_ = costmap.getOriginY();
+
+  double radius = 0.0;
+  for (const auto & point : footprint_) {
+    radius = std::max(radius, std::hypot(point.x, point.y));
+  }
+  yaw_tolerance_ = resolution_ / std::max(radius, resolution_);
+
+  if (footprint_.empty() || poses_.empty()) {
+    version_ = costmap_version;
+    return;
+  }
+
+  // Rasterize every outline into (cell, pose) pairs, each cell once per pose
+  std::unordered_map<uint64_t, std::size_t> cell_ids;
+  std::vector<std::pair<std::size_t, std::size_t>> coverage;
+  std::vector<std::size_t> pose_cells;
+  std::vector<geometry_msgs::msg::Point> oriented;
+  std::vector<int> vx(footprint_.size()), vy(footprint_.size());
+
+  for (std::size_t p = 0; p < poses_.size(); ++p) {
+    transformFootprint(poses_[p].x, poses_[p].y, poses_[p].theta, footprint_, oriented);
+    for (std::size_t i = 0; i < oriented.size(); ++i) {
+      vx[i] = static_cast<int>(std::floor((oriented[i].x - origin_x_) / resolution_));
+      vy[i] = static_cast<int>(std::floor((oriented[i].y - origin_y_) / resolution_));
+    }
+
+    pose_cells.clear();
+    for (std::size_t i = 0; i < oriented.size(); ++i) {
+      const std::size_t j = (i + 1) % oriented.size();
+      for (nav2_util::LineIterator line(vx[i], vy[i], vx[j], vy[j]); line.isValid();
+        line.advance())
+      {
+        auto inserted = cell_ids.emplace(cellKey(line.getX(), line.getY()), cells_x_.size());
+        if (inserted.second) {
+          cells_x_.push_back(line.getX());
+          cells_y_.push_back(line.getY());
+        }
+        pose_cells.push_back(inserted.first->second);
+      }
+    }
+
+    std::sort(pose_cells.begin(), pose_cells.end());
+    pose_cells.erase(std::unique(pose_cells.begin(), pose_cells.end()), pose_cells.end());
+    for (std::size_t cell : pose_cells) {
+      coverage.emplace_back(cell, p);
+    }
+  }
+
+  // Group the pairs by cell
+  pose_offsets_.assign(cells_x_.size() + 1, 0);
+  for (const auto & entry : coverage) {
+    ++pose_offsets_[entry.first + 1];
+  }
+  for (std::size_t i = 0; i < cells_x_.size(); ++i) {
+    pose_offsets_[i + 1] += pose_offsets_[i];
+  }
+  pose_ids_.resize(coverage.size());
+  std::vector<std::size_t> next(pose_offsets_.begin(), pose_offsets_.end() - 1);
+  for (const auto & entry : coverage) {
+    pose_ids_[next[entry.first]++] = entry.second;
+  }
+
+  cell_lethal_.assign(cells_x_.size(), 0);
+  pose_lethal_count_.assign(poses_.size(), 0);
+  update(costmap, costmap_version);
+}
+
+bool FootprintSweep::update(const Costmap2D & costmap, uint64_t costmap_version)
+{
+  const double resolution = costmap.getResolution();
+  if (std::fabs(resolution - resolution_) > 1e-9) {
+    return false;
+  }
+
+  const double shift_x = (origin_x_ - costmap.getOriginX()) / resolution_;
+  const double shift_y = (origin_y_ - costmap.getOriginY()) / resolution_;
+  const double rounded_x = std::round(shift_x);
+  const double rounded_y = std::round(shift_y);
+  if (std::fabs(shift_x - rounded_x) > 1e-3 || std::fabs(shift_y - rounded_y) > 1e-3) {
+    return false;
+  }
+
+  const int dx = static_cast<int>(rounded_x);
+  const int dy = static_cast<int>(rounded_y);
+  const int size_x = static_cast<int>(costmap.getSizeInCellsX());
+  const int size_y = static_cast<int>(costmap.getSizeInCellsY());
+  const unsigned char * grid = costmap.getCharMap();
+
+  for (std::size_t i = 0; i < cells_x_.size(); ++i) {
+    const int x = cells_x_[i] + dx;
+    const int y = cells_y_[i] + dy;
+    const unsigned char lethal = (x < 0 || y < 0 || x >= size_x || y >= size_y) ||
+      grid[static_cast<std::size_t>(y) * size_x + x] >= LETHAL_OBSTACLE;
+    if (lethal == cell_lethal_[i]) {
+      continue;
+    }
+
+    cell_lethal_[i] = lethal;
+    for (std::size_t k = pose_offsets_[i]; k < pose_offsets_[i + 1]; ++k) {
+      if (lethal) {
+        ++pose_lethal_count_[pose_ids_[k]];
+      } else {
+        --pose_lethal_count_[pose_ids_[k]];
+      }
+    }
+  }
+
+  version_ = costmap_version;
+  return true;
+}
+
+std::size_t FootprintSweep::firstCollision(std::size_t first, std::size_t last) const
+{
+  last = std::min(last, poses_.size());
+  for (std::size_t p = first; p < last; ++p) {
+    if (pose_lethal_count_[p] > 0) {
+      return p;
+    }
+  }
+  return last;
+}
+
+bool FootprintSweep::covers(const geometry_msgs::msg::Pose2D & pose, std::size_t index) const
+{
+  if (index >= poses_.size()) {
+    return false;
+  }
+
+  const auto & swept = poses_[index];
+  return std::hypot(pose.x - swept.x, pose.y - swept.y) <= resolution_ &&
+         std::fabs(angles::shortest_angular_distance(swept.theta, pose.theta)) <= yaw_tolerance_;
+}
+
+void FootprintSweep::clear()
+{
+  poses_.clear();
+  footprint_.clear();
+  cells_x_.clear();
+  cells_y_.clear();
+  pose_offsets_.clear();
+  pose_ids_.clear();
+  cell_lethal_.clear();
+  pose_lethal_count_.clear();
+  version_ = 0;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,136 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_costmap_2d/grid_buffer_pool.hpp"
+
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+constexpr std::size_t GridBufferPool::HUGE_PAGE_THRESHOLD;
+constexpr std::size_t GridBufferPool::HUGE_PAGE_SIZE;
+constexpr std::size_t GridBufferPool::MIN_CLASS;
+
+GridBufferPool & GridBufferPool::instance()
+{
+  static GridBufferPool * pool = new GridBufferPool();
+  return *pool;
+}
+
+GridBufferPool::~GridBufferPool()
+{
+  for (auto & buffer : free_) {
+    std::free(buffer.second);
+  }
+}
+
+std::size_t GridBufferPool::sizeClass(std::size_t size)
+{
+  if (size <= MIN_CLASS) {
+    return MIN_CLASS;
+  }
+  // Within (top, 2 top], rounded up to a quarter of top
+  std::size_t top = MIN_CLASS;
+  while (top * 2 < size) {
+    top *= 2;
+  }
+  const std::size_t quarter = top / 4;
+  return top + (size - top + quarter - 1) / quarter * quarter;
+}
+
+unsigned char * GridBufferPool::acquire(std::size_t size, std::size_t & capacity)
+{
+  capacity = sizeClass(size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = free_.find(capacity);
+    if (it != free_.end()) {
+      unsigned char * buffer = it->second;
+      free_.erase(it);
+      free_bytes_ -= capacity;
+      return buffer;
+    }
+  }
+  return allocate(capacity);
+}
+
+void GridBufferPool::release(unsigned char * buffer, std::size_t capacity)
+{
+  if (buffer == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_bytes_ + capacity <= max_free_bytes_) {
+      free_.emplace(capacity, buffer);
+      free_bytes_ += capacity;
+      return;
+    }
+  }
+  std::free(buffer);
+}
+
+void GridBufferPool::setMaxFreeBytes(std::size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_free_bytes_ = bytes;
+  trim();
+}
+
+std::size_t GridBufferPool::freeBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_bytes_;
+}
+
+unsigned char * GridBufferPool::allocate(std::size_t capacity)
+{
+  void * buffer = nullptr;
+#ifdef __linux__
+  if (capacity >= HUGE_PAGE_THRESHOLD) {
+    if (posix_memalign(&buffer, HUGE_PAGE_SIZE, capacity) != 0) {
+      throw std::bad_alloc();
+    }
+    // Only advice, a kernel without transparent huge pages keeps small ones
+    madvise(buffer, capacity, MADV_HUGEPAGE);
+    return static_cast<unsigned char *>(buffer);
+  }
+#endif
+  buffer = std::malloc(capacity);
+  if (buffer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return static_cast<unsigned char *>(buffer);
+}
+
+void GridBufferPool::trim()
+{
+  // The largest buffers go first, so that the fewest are freed
+  while (free_bytes_ > max_free_bytes_ && !free_.empty()) {
+    auto it = std::prev(free_.end());
+    free_bytes_ -= it->first;
+    std::free(it->second);
+    free_.erase(it);
+  }
+}
+
+}  // namespace nav2_costmap_2d
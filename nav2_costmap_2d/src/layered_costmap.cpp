@@ -41,10 +41,12 @@
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <limits>
 
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/trace.hpp"
 
 
 using std::vector;
@@ -52,6 +54,41 @@ using std::vector;
 namespace nav2_costmap_2d
 {
 
+namespace
+{
+
+/**
+ * @brief Set each cell of the coarse window to the highest cost of the up to
+ * 2 x 2 cells of the fine grid under it
+ */
+void maxPool(
+  const Costmap2D & fine, Costmap2D & coarse,
+  unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn)
+{
+  const unsigned char * fine_map = fine.getCharMap();
+  unsigned char * coarse_map = coarse.getCharMap();
+  const unsigned int fine_x = fine.getSizeInCellsX();
+  const unsigned int fine_y = fine.getSizeInCellsY();
+  const unsigned int coarse_x = coarse.getSizeInCellsX();
+  // coarse columns covering two fine columns, the last one may only cover one
+  const unsigned int pairs = std::min(xn, fine_x / 2);
+
+  for (unsigned int j = y0; j < yn; ++j) {
+    const unsigned char * row0 = fine_map + 2 * j * fine_x;
+    const unsigned char * row1 = 2 * j + 1 < fine_y ? row0 + fine_x : row0;
+    unsigned char * out = coarse_map + j * coarse_x;
+    for (unsigned int i = x0; i < pairs; ++i) {
+      out[i] = std::max(
+        std::max(row0[2 * i], row0[2 * i + 1]), std::max(row1[2 * i], row1[2 * i + 1]));
+    }
+    if (xn > pairs) {
+      out[pairs] = std::max(row0[2 * pairs], row1[2 * pairs]);
+    }
+  }
+}
+
+}  // namespace
+
 LayeredCostmap::LayeredCostmap(std::string global_frame, bool rolling_window, bool track_unknown)
 : costmap_(),
   global_frame_(global_frame),
@@ -68,7 +105,9 @@ LayeredCostmap::LayeredCostmap(std::string global_frame, bool rolling_window, bo
   initialized_(false),
   size_locked_(false),
   circumscribed_radius_(1.0),
-  inscribed_radius_(0.1)
+  inscribed_radius_(0.1),
+  tile_threads_(0),
+  tile_size_(0)
 {
   if (track_unknown) {
     costmap_.setDefaultValue(255);
@@ -93,11 +132,21 @@ void LayeredCostmap::resizeMap(
   std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
   size_locked_ = size_locked;
   costmap_.resizeMap(size_x, size_y, resolution, origin_x, origin_y);
-  for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
-    plugin != plugins_.end(); ++plugin)
-  {
-    (*plugin)->matchSize();
+  if (tile_pool_ && plugins_.size() > 1) {
+    // Each layer only resizes and resets its own grids to the master's, so the
+    // allocations and resets of a large map run side by side
+    tile_pool_->parallelFor(
+      plugins_.size(), [this](std::size_t i) {
+        plugins_[i]->matchSize();
+      });
+  } else {
+    for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
+      plugin != plugins_.end(); ++plugin)
+    {
+      (*plugin)->matchSize();
+    }
   }
+  resizePyramid();
 }
 
 bool LayeredCostmap::isOutofBounds(double robot_x, double robot_y)
@@ -140,7 +189,11 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     double prev_miny = miny_;
     double prev_maxx = maxx_;
     double prev_maxy = maxy_;
-    (*plugin)->updateBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    {
+      nav2_util::ScopedTrace trace("costmap.update_bounds", (*plugin)->getName());
+      nav2_util::ScopedTiming timing(boundsTiming(plugin - plugins_.begin()));
+      (*plugin)->updateBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    }
     if (minx_ > prev_minx || miny_ > prev_miny || maxx_ < prev_maxx || maxy_ < prev_maxy) {
       RCLCPP_WARN(
         rclcpp::get_logger(
@@ -166,16 +219,26 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
       "nav2_costmap_2d"), "Updating area x: [%d, %d] y: [%d, %d]", x0, xn, y0, yn);
 
   if (xn < x0 || yn < y0) {
+    // the window may still have moved
+    updatePyramid(0, 0, 0, 0);
     return;
   }
 
   costmap_.resetMap(x0, y0, xn, yn);
-  for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
-    plugin != plugins_.end(); ++plugin)
-  {
-    (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
+  if (tile_pool_) {
+    updateCostsInTiles(x0, y0, xn, yn);
+  } else {
+    for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
+      plugin != plugins_.end(); ++plugin)
+    {
+      nav2_util::ScopedTrace trace("costmap.update_costs", (*plugin)->getName());
+      nav2_util::ScopedTiming timing(costsTiming(plugin - plugins_.begin()));
+      (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
+    }
   }
 
+  updatePyramid(x0, y0, xn, yn);
+
   bx0_ = x0;
   bxn_ = xn;
   by0_ = y0;
@@ -184,6 +247,191 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
   initialized_ = true;
 }
 
+void LayeredCostmap::setTiledUpdate(unsigned int num_threads, unsigned int tile_size)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (num_threads <= 1 || tile_size == 0) {
+    tile_pool_.reset();
+    tile_size_ = 0;
+    return;
+  }
+
+  if (!tile_pool_ || tile_threads_ != num_threads) {
+    tile_pool_ = std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::COSTMAP, num_threads);
+    tile_threads_ = num_threads;
+  }
+  tile_size_ = tile_size;
+}
+
+void LayeredCostmap::setPyramidLevels(unsigned int levels)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  pyramid_.resize(levels);
+  for (auto & level : pyramid_) {
+    if (!level) {
+      level = std::make_unique<Costmap2D>();
+    }
+  }
+  resizePyramid();
+}
+
+void LayeredCostmap::resizePyramid()
+{
+  const unsigned int size_x = costmap_.getSizeInCellsX();
+  const unsigned int size_y = costmap_.getSizeInCellsY();
+  for (std::size_t i = 0; i < pyramid_.size(); ++i) {
+    const unsigned int factor = 2u << i;
+    Costmap2D & level = *pyramid_[i];
+    std::unique_lock<Costmap2D::mutex_t> level_lock(*(level.getMutex()));
+    level.setDefaultValue(costmap_.getDefaultValue());
+    level.resizeMap(
+      (size_x + factor - 1) / factor, (size_y + factor - 1) / factor,
+      costmap_.getResolution() * factor, costmap_.getOriginX(), costmap_.getOriginY());
+  }
+  updatePyramid(0, 0, size_x, size_y);
+}
+
+void LayeredCostmap::updatePyramid(int x0, int y0, int xn, int yn)
+{
+  if (pyramid_.empty()) {
+    return;
+  }
+
+  // A moved window shifts the master grid by whole cells, which rarely lines up
+  // with the coarse cells, so it is simpler to pool everything again
+  if (pyramid_[0]->getOriginX() != costmap_.getOriginX() ||
+    pyramid_[0]->getOriginY() != costmap_.getOriginY())
+  {
+    resizePyramid();
+    return;
+  }
+
+  nav2_util::ScopedTrace trace("costmap.update_pyramid");
+  const Costmap2D * fine = &costmap_;
+  for (auto & level : pyramid_) {
+    if (xn <= x0 || yn <= y0) {
+      return;
+    }
+    x0 /= 2;
+    y0 /= 2;
+    xn = (xn + 1) / 2;
+    yn = (yn + 1) / 2;
+    std::unique_lock<Costmap2D::mutex_t> level_lock(*(level->getMutex()));
+    maxPool(*fine, *level, x0, y0, xn, yn);
+    fine = level.get();
+  }
+}
+
+void LayeredCostmap::updateCostsInTiles(int x0, int y0, int xn, int yn)
+{
+  struct Tile
+  {
+    int min_i, min_j, max_i, max_j;
+  };
+
+  const int tile_size = static_cast<int>(tile_size_);
+  std::vector<Tile> tiles;
+  for (int j = y0; j < yn; j += tile_size) {
+    for (int i = x0; i < xn; i += tile_size) {
+      tiles.push_back({i, j, std::min(i + tile_size, xn), std::min(j + tile_size, yn)});
+    }
+  }
+
+  // Layers are grouped into stages that run back to back. Consecutive tile-safe
+  // layers without a halo share a stage, so each tile goes through all of them in
+  // order. A layer reading a halo needs the finished output of the earlier layers
+  // in the neighbouring tiles, so it gets a stage of its own, and layers that are
+  // not tile-safe run on the whole window.
+  std::size_t first = 0;
+  while (first < plugins_.size()) {
+    if (!plugins_[first]->isTileSafe()) {
+      nav2_util::ScopedTrace trace("costmap.update_costs", plugins_[first]->getName());
+      nav2_util::ScopedTiming timing(costsTiming(first));
+      plugins_[first]->updateCosts(costmap_, x0, y0, xn, yn);
+      ++first;
+      continue;
+    }
+
+    std::size_t last = first + 1;
+    if (plugins_[first]->getTileHalo() == 0) {
+      while (last < plugins_.size() && plugins_[last]->isTileSafe() &&
+        plugins_[last]->getTileHalo() == 0)
+      {
+        ++last;
+      }
+    }
+
+    // A stage is traced and timed as a whole, under the name of its first layer
+    nav2_util::ScopedTrace trace("costmap.update_costs_tiled", plugins_[first]->getName());
+    nav2_util::ScopedTiming timing(costsTiming(first));
+    for (std::size_t k = first; k < last; ++k) {
+      plugins_[k]->prepareTiles(costmap_, x0, y0, xn, yn);
+    }
+    tile_pool_->parallelFor(
+      tiles.size(), [&](std::size_t t) {
+        const Tile & tile = tiles[t];
+        for (std::size_t k = first; k < last; ++k) {
+          plugins_[k]->updateCostsInTile(
+            costmap_, tile.min_i, tile.min_j, tile.max_i, tile.max_j);
+        }
+      });
+    first = last;
+  }
+}
+
+void LayeredCostmap::setTimingStats(std::shared_ptr<nav2_util::TimingStats> stats)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  timing_stats_ = stats;
+  bounds_timings_.clear();
+  costs_timings_.clear();
+}
+
+std::vector<std::pair<std::string, std::size_t>> LayeredCostmap::getMemoryUsage()
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  std::vector<std::pair<std::string, std::size_t>> usage;
+  usage.emplace_back(
+    "master",
+    static_cast<std::size_t>(costmap_.getSizeInCellsX()) * costmap_.getSizeInCellsY());
+  if (!pyramid_.empty()) {
+    std::size_t bytes = 0;
+    for (const auto & level : pyramid_) {
+      bytes += static_cast<std::size_t>(level->getSizeInCellsX()) * level->getSizeInCellsY();
+    }
+    usage.emplace_back("pyramid", bytes);
+  }
+  for (const auto & plugin : plugins_) {
+    usage.emplace_back(plugin->getName(), plugin->getMemoryUsage());
+  }
+  return usage;
+}
+
+nav2_util::TimingHistogram * LayeredCostmap::boundsTiming(std::size_t index)
+{
+  if (!timing_stats_) {
+    return nullptr;
+  }
+  while (bounds_timings_.size() < plugins_.size()) {
+    const std::string & name = plugins_[bounds_timings_.size()]->getName();
+    bounds_timings_.push_back(&timing_stats_->histogram(name + " update_bounds"));
+  }
+  return bounds_timings_[index];
+}
+
+nav2_util::TimingHistogram * LayeredCostmap::costsTiming(std::size_t index)
+{
+  if (!timing_stats_) {
+    return nullptr;
+  }
+  while (costs_timings_.size() < plugins_.size()) {
+    const std::string & name = plugins_[costs_timings_.size()]->getName();
+    costs_timings_.push_back(&timing_stats_->histogram(name + " update_costs"));
+  }
+  return costs_timings_[index];
+}
+
 bool LayeredCostmap::isCurrent()
 {
   current_ = true;
@@ -197,6 +445,9 @@ bool LayeredCostmap::isCurrent()
 
 void LayeredCostmap::setFootprint(const std::vector<geometry_msgs::msg::Point> & footprint_spec)
 {
+  // Layers rebuild their footprint dependent caches here, which must not
+  // happen while they are updating the master grid
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
   footprint_ = footprint_spec;
   nav2_costmap_2d::calculateMinAndMaxDistances(
     footprint_spec,
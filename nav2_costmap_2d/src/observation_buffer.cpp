@@ -37,28 +37,33 @@
 #include "nav2_costmap_2d/observation_buffer.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <list>
 #include <string>
 #include <vector>
 
 #include "tf2/convert.h"
-#include "sensor_msgs/point_cloud2_iterator.hpp"
+#include "nav2_costmap_2d/cloud_transform.hpp"
+#include "nav2_util/trace.hpp"
 
 namespace nav2_costmap_2d
 {
+
 ObservationBuffer::ObservationBuffer(
   nav2_util::LifecycleNode::SharedPtr nh, std::string topic_name, double observation_keep_time,
   double expected_update_rate,
   double min_obstacle_height, double max_obstacle_height, double obstacle_range,
   double raytrace_range, tf2_ros::Buffer & tf2_buffer, std::string global_frame,
-  std::string sensor_frame, double tf_tolerance)
+  std::string sensor_frame, double tf_tolerance, double voxel_size,
+  unsigned int polar_clearing_bins)
 : tf2_buffer_(tf2_buffer),
   observation_keep_time_(rclcpp::Duration::from_seconds(observation_keep_time)),
   expected_update_rate_(rclcpp::Duration::from_seconds(expected_update_rate)), nh_(nh),
   last_updated_(nh->now()), global_frame_(global_frame), sensor_frame_(sensor_frame),
   topic_name_(topic_name),
   min_obstacle_height_(min_obstacle_height), max_obstacle_height_(max_obstacle_height),
-  obstacle_range_(obstacle_range), raytrace_range_(raytrace_range), tf_tolerance_(tf_tolerance)
+  obstacle_range_(obstacle_range), raytrace_range_(raytrace_range), tf_tolerance_(tf_tolerance),
+  voxel_size_(voxel_size), polar_clearing_bins_(polar_clearing_bins)
 {
 }
 
@@ -98,9 +103,12 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
       tf2_buffer_.transform(origin, origin, new_global_frame, tf2::durationFromSec(tf_tolerance_));
       obs.origin_ = origin.point;
 
-      // we also need to transform the cloud of the observation to the new global frame
+      // we also need to transform the cloud of the observation to the new global frame,
+      // the cloud may be shared with consumers so it is replaced rather than modified
+      auto cloud = std::make_shared<sensor_msgs::msg::PointCloud2>();
       tf2_buffer_.transform(
-        *(obs.cloud_), *(obs.cloud_), new_global_frame, tf2::durationFromSec(tf_tolerance_));
+        *(obs.cloud_), *cloud, new_global_frame, tf2::durationFromSec(tf_tolerance_));
+      obs.cloud_ = cloud;
     } catch (tf2::TransformException & ex) {
       RCLCPP_ERROR(
         rclcpp::get_logger(
@@ -116,7 +124,9 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
   return true;
 }
 
-void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
+template<typename TransformPointsT>
+void ObservationBuffer::bufferObservation(
+  const std_msgs::msg::Header & header, TransformPointsT transform_points)
 {
   geometry_msgs::msg::PointStamped global_origin;
 
@@ -125,13 +135,13 @@ void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
 
   // check whether the origin frame has been set explicitly
   // or whether we should get it from the cloud
-  std::string origin_frame = sensor_frame_ == "" ? cloud.header.frame_id : sensor_frame_;
+  std::string origin_frame = sensor_frame_ == "" ? header.frame_id : sensor_frame_;
 
   try {
     // given these observations come from sensors...
     // we'll need to store the origin pt of the sensor
     geometry_msgs::msg::PointStamped local_origin;
-    local_origin.header.stamp = cloud.header.stamp;
+    local_origin.header.stamp = header.stamp;
     local_origin.header.frame_id = origin_frame;
     local_origin.point.x = 0;
     local_origin.point.y = 0;
@@ -143,50 +153,38 @@ void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
     // of the observation buffer to the observations
     observation_list_.front().raytrace_range_ = raytrace_range_;
     observation_list_.front().obstacle_range_ = obstacle_range_;
+    observation_list_.front().polar_clearing_bins_ = polar_clearing_bins_;
 
-    sensor_msgs::msg::PointCloud2 global_frame_cloud;
-
-    // transform the point cloud
-    tf2_buffer_.transform(cloud, global_frame_cloud, global_frame_);
-    global_frame_cloud.header.stamp = cloud.header.stamp;
-
-    // now we need to remove observations from the cloud that are below
-    // or above our height thresholds
-    sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation_list_.front().cloud_);
-    observation_cloud.height = global_frame_cloud.height;
-    observation_cloud.width = global_frame_cloud.width;
-    observation_cloud.fields = global_frame_cloud.fields;
-    observation_cloud.is_bigendian = global_frame_cloud.is_bigendian;
-    observation_cloud.point_step = global_frame_cloud.point_step;
-    observation_cloud.row_step = global_frame_cloud.row_step;
-    observation_cloud.is_dense = global_frame_cloud.is_dense;
-
-    unsigned int cloud_size = global_frame_cloud.height * global_frame_cloud.width;
-    sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
-    modifier.resize(cloud_size);
-    unsigned int point_count = 0;
-
-    // copy over the points that are within our height bounds
-    sensor_msgs::PointCloud2Iterator<float> iter_z(global_frame_cloud, "z");
-    std::vector<unsigned char>::const_iterator iter_global = global_frame_cloud.data.begin(),
-      iter_global_end = global_frame_cloud.data.end();
-    std::vector<unsigned char>::iterator iter_obs = observation_cloud.data.begin();
-    for (; iter_global != iter_global_end; ++iter_z, iter_global +=
-      global_frame_cloud.point_step)
-    {
-      if ((*iter_z) <= max_obstacle_height_ &&
-        (*iter_z) >= min_obstacle_height_)
-      {
-        std::copy(iter_global, iter_global + global_frame_cloud.point_step, iter_obs);
-        iter_obs += global_frame_cloud.point_step;
-        ++point_count;
-      }
+    // look the transform up once, then transform the points and remove the ones
+    // that are below or above our height thresholds in a single pass
+    geometry_msgs::msg::TransformStamped transform_msg = tf2_buffer_.lookupTransform(
+      global_frame_, header.frame_id, tf2_ros::fromMsg(header.stamp));
+    tf2::Transform transform;
+    tf2::fromMsg(transform_msg.transform, transform);
+    float matrix[12];
+    for (int row = 0; row < 3; ++row) {
+      const tf2::Vector3 & basis = transform.getBasis()[row];
+      matrix[row * 4] = static_cast<float>(basis.x());
+      matrix[row * 4 + 1] = static_cast<float>(basis.y());
+      matrix[row * 4 + 2] = static_cast<float>(basis.z());
+      matrix[row * 4 + 3] = static_cast<float>(transform.getOrigin()[row]);
     }
 
-    // resize the cloud for the number of legal points
-    modifier.resize(point_count);
-    observation_cloud.header.stamp = cloud.header.stamp;
-    observation_cloud.header.frame_id = global_frame_cloud.header.frame_id;
+    // when downsampling, only the first point that falls in each voxel is kept:
+    // the costmap cannot tell the others apart, but would raytrace and mark
+    // every one of them
+    CloudFilter filter;
+    filter.min_z = min_obstacle_height_;
+    filter.max_z = max_obstacle_height_;
+    filter.voxel_size = voxel_size_;
+
+    std::shared_ptr<sensor_msgs::msg::PointCloud2> observation_cloud = acquireCloud();
+    if (!transform_points(matrix, filter, *observation_cloud)) {
+      observation_list_.pop_front();
+      return;
+    }
+    observation_cloud->header.frame_id = global_frame_;
+    observation_list_.front().cloud_ = observation_cloud;
   } catch (tf2::TransformException & ex) {
     // if an exception occurs, we need to remove the empty observation from the list
     observation_list_.pop_front();
@@ -195,7 +193,7 @@ void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
         "nav2_costmap_2d"),
       "TF Exception that should never happen for sensor frame: %s, cloud frame: %s, %s",
       sensor_frame_.c_str(),
-      cloud.header.frame_id.c_str(), ex.what());
+      header.frame_id.c_str(), ex.what());
     return;
   }
 
@@ -206,7 +204,53 @@ void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
   purgeStaleObservations();
 }
 
-// returns a copy of the observations
+void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
+{
+  nav2_util::ScopedTrace trace(
+    "costmap.buffer_cloud", topic_name_, nav2_util::traceStamp(cloud.header.stamp));
+  bufferObservation(
+    cloud.header,
+    [this, &cloud](const float * matrix, const CloudFilter & filter,
+    sensor_msgs::msg::PointCloud2 & out) {
+      if (!transformAndFilterCloud(cloud, matrix, filter, voxels_, out)) {
+        RCLCPP_ERROR(
+          rclcpp::get_logger("nav2_costmap_2d"),
+          "Cloud on %s has no float32 x, y and z fields, dropping it", topic_name_.c_str());
+        return false;
+      }
+      return true;
+    });
+}
+
+void ObservationBuffer::bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid)
+{
+  nav2_util::ScopedTrace trace(
+    "costmap.buffer_scan", topic_name_, nav2_util::traceStamp(scan.header.stamp));
+  // The beam angles of a scanner don't change, the tables are only computed once
+  scan_angles_.update(scan);
+  bufferObservation(
+    scan.header,
+    [this, &scan, inf_is_valid](const float * matrix, const CloudFilter & filter,
+    sensor_msgs::msg::PointCloud2 & out) {
+      transformAndFilterScan(scan, scan_angles_, matrix, inf_is_valid, filter, voxels_, out);
+      return true;
+    });
+}
+
+std::shared_ptr<sensor_msgs::msg::PointCloud2> ObservationBuffer::acquireCloud()
+{
+  // a cloud only referenced by the pool is no longer held by any observation,
+  // so its storage can be reused for the incoming cloud
+  for (auto & cloud : cloud_pool_) {
+    if (cloud.use_count() == 1) {
+      return cloud;
+    }
+  }
+  cloud_pool_.push_back(std::make_shared<sensor_msgs::msg::PointCloud2>());
+  return cloud_pool_.back();
+}
+
+// returns a copy of the observations, which share their clouds with the buffer
 void ObservationBuffer::getObservations(std::vector<Observation> & observations)
 {
   // first... let's make sure that we don't have any stale observations
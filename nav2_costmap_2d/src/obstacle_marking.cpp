@@ -0,0 +1,320 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/obstacle_marking.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "nav2_costmap_2d/cloud_transform.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/line_iterator.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_COSTMAP_2D_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+// Calls at(mx, my) for the cell of every point the per point tests keep
+template<typename CellAction>
+inline void markPoint(
+  const RasterGeometry & grid, const geometry_msgs::msg::Point & origin, double sq_range,
+  double max_z, double px, double py, double pz, CellAction & at)
+{
+  // The same tests, in the same order, as ObstacleLayer ran on each point
+  if (pz > max_z) {
+    return;
+  }
+  const double sq_dist = (px - origin.x) * (px - origin.x) + (py - origin.y) * (py - origin.y) +
+    (pz - origin.z) * (pz - origin.z);
+  if (sq_dist >= sq_range || px < grid.origin_x || py < grid.origin_y) {
+    return;
+  }
+  const unsigned int mx = static_cast<int>((px - grid.origin_x) / grid.resolution);
+  const unsigned int my = static_cast<int>((py - grid.origin_y) / grid.resolution);
+  if (mx < grid.size_x && my < grid.size_y) {
+    at(mx, my);
+  }
+}
+
+template<typename CellAction>
+bool forEachMarkedCell(
+  const Observation & observation, double max_obstacle_height,
+  const RasterGeometry & grid, CellAction at)
+{
+  const sensor_msgs::msg::PointCloud2 & cloud = *observation.cloud_;
+  uint32_t offset_x, offset_y, offset_z;
+  if (!floatFieldOffset(cloud, "x", offset_x) || !floatFieldOffset(cloud, "y", offset_y) ||
+    !floatFieldOffset(cloud, "z", offset_z))
+  {
+    return false;
+  }
+
+  const geometry_msgs::msg::Point & origin = observation.origin_;
+  const double sq_range = observation.obstacle_range_ * observation.obstacle_range_;
+  const uint32_t step = cloud.point_step;
+
+#ifdef NAV2_COSTMAP_2D_SSE2
+  const __m128d origin_x = _mm_set1_pd(origin.x);
+  const __m128d origin_y = _mm_set1_pd(origin.y);
+  const __m128d origin_z = _mm_set1_pd(origin.z);
+  const __m128d sq_range_2 = _mm_set1_pd(sq_range);
+  const __m128d max_z_2 = _mm_set1_pd(max_obstacle_height);
+  const __m128d grid_x = _mm_set1_pd(grid.origin_x);
+  const __m128d grid_y = _mm_set1_pd(grid.origin_y);
+  const __m128d resolution = _mm_set1_pd(grid.resolution);
+#endif
+
+  // The rows of an organized cloud may be padded past width * point_step
+  for (uint32_t row = 0; row < cloud.height; ++row) {
+    const uint8_t * point = cloud.data.data() + static_cast<std::size_t>(row) * cloud.row_step;
+    uint32_t col = 0;
+#ifdef NAV2_COSTMAP_2D_SSE2
+    for (; col + 1 < cloud.width; col += 2, point += 2 * step) {
+      const __m128d px = _mm_set_pd(
+        readFloat(point + step, offset_x), readFloat(point, offset_x));
+      const __m128d py = _mm_set_pd(
+        readFloat(point + step, offset_y), readFloat(point, offset_y));
+      const __m128d pz = _mm_set_pd(
+        readFloat(point + step, offset_z), readFloat(point, offset_z));
+
+      const __m128d dx = _mm_sub_pd(px, origin_x);
+      const __m128d dy = _mm_sub_pd(py, origin_y);
+      const __m128d dz = _mm_sub_pd(pz, origin_z);
+      const __m128d sq_dist = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+
+      // The negated comparisons hold for NaN, as the scalar early returns do
+      __m128d keep = _mm_and_pd(_mm_cmpngt_pd(pz, max_z_2), _mm_cmpnge_pd(sq_dist, sq_range_2));
+      keep = _mm_and_pd(keep, _mm_and_pd(_mm_cmpnlt_pd(px, grid_x), _mm_cmpnlt_pd(py, grid_y)));
+      const int lanes = _mm_movemask_pd(keep);
+      if (lanes == 0) {
+        continue;
+      }
+
+      int mx[4], my[4];
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(mx),
+        _mm_cvttpd_epi32(_mm_div_pd(_mm_sub_pd(px, grid_x), resolution)));
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(my),
+        _mm_cvttpd_epi32(_mm_div_pd(_mm_sub_pd(py, grid_y), resolution)));
+      for (int lane = 0; lane < 2; ++lane) {
+        const unsigned int cell_x = mx[lane];
+        const unsigned int cell_y = my[lane];
+        if ((lanes & (1 << lane)) && cell_x < grid.size_x && cell_y < grid.size_y) {
+          at(cell_x, cell_y);
+        }
+      }
+    }
+#endif
+    for (; col < cloud.width; ++col, point += step) {
+      markPoint(
+        grid, origin, sq_range, max_obstacle_height, readFloat(point, offset_x),
+        readFloat(point, offset_y), readFloat(point, offset_z), at);
+    }
+  }
+  return true;
+}
+
+// The end cells of the rays of ObstacleLayer::raytraceFreespace(), clipped to the grid
+void rayEnds(
+  const Observation & observation, const RasterGeometry & grid, std::vector<unsigned int> & ends)
+{
+  const double ox = observation.origin_.x;
+  const double oy = observation.origin_.y;
+  const double map_end_x = grid.origin_x + grid.size_x * grid.resolution;
+  const double map_end_y = grid.origin_y + grid.size_y * grid.resolution;
+
+  const sensor_msgs::msg::PointCloud2 & cloud = *observation.cloud_;
+  ends.clear();
+  ends.reserve(cloud.width * cloud.height);
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y) {
+    double wx = *iter_x;
+    double wy = *iter_y;
+    const double a = wx - ox;
+    const double b = wy - oy;
+    if (wx < grid.origin_x) {
+      const double t = (grid.origin_x - ox) / a;
+      wx = grid.origin_x;
+      wy = oy + b * t;
+    }
+    if (wy < grid.origin_y) {
+      const double t = (grid.origin_y - oy) / b;
+      wx = ox + a * t;
+      wy = grid.origin_y;
+    }
+    if (wx > map_end_x) {
+      const double t = (map_end_x - ox) / a;
+      wx = map_end_x - .001;
+      wy = oy + b * t;
+    }
+    if (wy > map_end_y) {
+      const double t = (map_end_y - oy) / b;
+      wx = ox + a * t;
+      wy = map_end_y - .001;
+    }
+    if (wx < grid.origin_x || wy < grid.origin_y) {
+      continue;
+    }
+    const unsigned int x1 = static_cast<unsigned int>((wx - grid.origin_x) / grid.resolution);
+    const unsigned int y1 = static_cast<unsigned int>((wy - grid.origin_y) / grid.resolution);
+    if (x1 >= grid.size_x || y1 >= grid.size_y) {
+      continue;
+    }
+    ends.push_back(y1 * grid.size_x + x1);
+  }
+
+  std::sort(ends.begin(), ends.end());
+  ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+}
+
+void sortUnique(std::vector<unsigned int> & cells)
+{
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+}
+
+}  // namespace
+
+bool markObservation(
+  const Observation & observation, double max_obstacle_height,
+  Costmap2D & costmap, MarkedCells & marked, const CellStamps * stamps)
+{
+  unsigned char * map = costmap.getCharMap();
+  const RasterGeometry grid = RasterGeometry::of(costmap);
+  return forEachMarkedCell(
+    observation, max_obstacle_height, grid,
+    [&](unsigned int mx, unsigned int my) {
+      const unsigned int index = my * grid.size_x + mx;
+      map[index] = LETHAL_OBSTACLE;
+      if (stamps) {
+        stamps->data[index] = stamps->now;
+      }
+      marked.add(static_cast<int>(mx), static_cast<int>(my));
+    });
+}
+
+RasterGeometry RasterGeometry::of(const Costmap2D & costmap)
+{
+  RasterGeometry geometry;
+  geometry.size_x = costmap.getSizeInCellsX();
+  geometry.size_y = costmap.getSizeInCellsY();
+  geometry.origin_x = costmap.getOriginX();
+  geometry.origin_y = costmap.getOriginY();
+  geometry.resolution = costmap.getResolution();
+  return geometry;
+}
+
+bool RasterGeometry::offsetTo(const RasterGeometry & other, int & dx, int & dy) const
+{
+  if (size_x != other.size_x || size_y != other.size_y || resolution != other.resolution ||
+    resolution <= 0.0)
+  {
+    return false;
+  }
+  const double cells_x = (origin_x - other.origin_x) / resolution;
+  const double cells_y = (origin_y - other.origin_y) / resolution;
+  dx = static_cast<int>(std::lround(cells_x));
+  dy = static_cast<int>(std::lround(cells_y));
+  // Rolling windows only move by whole cells
+  return std::abs(cells_x - dx) < 1e-3 && std::abs(cells_y - dy) < 1e-3;
+}
+
+void ObservationRaster::clear()
+{
+  cleared.clear();
+  marked.clear();
+  cleared_bounds = MarkedCells();
+  marked_bounds = MarkedCells();
+  valid = false;
+}
+
+bool rasterizeObservation(
+  const Observation & observation, double max_obstacle_height, bool marking, bool clearing,
+  const RasterGeometry & geometry, ObservationRaster & raster)
+{
+  raster.clear();
+  raster.geometry = geometry;
+  if (geometry.size_x == 0 || geometry.size_y == 0) {
+    return false;
+  }
+
+  if (marking) {
+    const bool has_fields = forEachMarkedCell(
+      observation, max_obstacle_height, geometry,
+      [&](unsigned int mx, unsigned int my) {
+        raster.marked.push_back(my * geometry.size_x + mx);
+        raster.marked_bounds.add(static_cast<int>(mx), static_cast<int>(my));
+      });
+    if (!has_fields) {
+      return false;
+    }
+    sortUnique(raster.marked);
+  }
+
+  const double ox = observation.origin_.x;
+  const double oy = observation.origin_.y;
+  if (clearing && ox >= geometry.origin_x && oy >= geometry.origin_y) {
+    const unsigned int x0 =
+      static_cast<unsigned int>((ox - geometry.origin_x) / geometry.resolution);
+    const unsigned int y0 =
+      static_cast<unsigned int>((oy - geometry.origin_y) / geometry.resolution);
+    if (x0 < geometry.size_x && y0 < geometry.size_y) {
+      std::vector<unsigned int> & ends = raster.scratch;
+      rayEnds(observation, geometry, ends);
+
+      // As Costmap2D::cellDistance() and Costmap2D::raytraceLines()
+      const double max_length =
+        std::max(0.0, std::ceil(observation.raytrace_range_ / geometry.resolution));
+      nav2_util::walkLines(
+        ends.size(), [&](std::size_t i) {
+          const int x1 = static_cast<int>(ends[i] % geometry.size_x);
+          const int y1 = static_cast<int>(ends[i] / geometry.size_x);
+          const int dx = x1 - static_cast<int>(x0);
+          const int dy = y1 - static_cast<int>(y0);
+          const double dist = std::hypot(dx, dy);
+          const double scale = (dist == 0.0) ? 1.0 : std::min(1.0, max_length / dist);
+          const unsigned int abs_da = std::max(std::abs(dx), std::abs(dy));
+          return nav2_util::lineSteps(
+            geometry.size_x, x0, y0, x1, y1, static_cast<unsigned int>(scale * abs_da));
+        },
+        [&](unsigned int offset) {raster.cleared.push_back(offset);});
+      sortUnique(raster.cleared);
+
+      raster.cleared_bounds.add(static_cast<int>(x0), static_cast<int>(y0));
+      for (unsigned int cell : raster.cleared) {
+        raster.cleared_bounds.add(
+          static_cast<int>(cell % geometry.size_x), static_cast<int>(cell / geometry.size_x));
+      }
+    }
+  }
+
+  raster.valid = true;
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
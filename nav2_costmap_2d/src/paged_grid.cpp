@@ -0,0 +1,147 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/paged_grid.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+constexpr unsigned int PagedGrid::PAGE_BITS;
+constexpr unsigned int PagedGrid::PAGE_SIZE;
+constexpr unsigned int PagedGrid::PAGE_MASK;
+constexpr unsigned int PagedGrid::PAGE_AREA;
+
+PagedGrid::PagedGrid()
+: PagedGrid(0, 0, 0)
+{
+}
+
+PagedGrid::PagedGrid(unsigned int size_x, unsigned int size_y, unsigned char default_value)
+{
+  resize(size_x, size_y, default_value);
+}
+
+void PagedGrid::resize(unsigned int size_x, unsigned int size_y, unsigned char default_value)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  default_value_ = default_value;
+  pages_x_ = (size_x + PAGE_MASK) >> PAGE_BITS;
+  const unsigned int pages_y = (size_y + PAGE_MASK) >> PAGE_BITS;
+
+  pages_.clear();
+  pages_.resize(static_cast<std::size_t>(pages_x_) * pages_y);
+  default_page_ = sharedDefaultPage(default_value);
+}
+
+void PagedGrid::copyFromRowMajor(const unsigned char * costs)
+{
+  for (unsigned int py = 0; py < size_y_; py += PAGE_SIZE) {
+    const unsigned int rows = std::min(PAGE_SIZE, size_y_ - py);
+    for (unsigned int px = 0; px < size_x_; px += PAGE_SIZE) {
+      const unsigned int cols = std::min(PAGE_SIZE, size_x_ - px);
+      std::unique_ptr<unsigned char[]> & page = pages_[pageIndex(px, py)];
+
+      // Leave pages unallocated when the source only holds the default there
+      bool all_default = true;
+      for (unsigned int r = 0; r < rows && all_default; ++r) {
+        const unsigned char * row = costs + static_cast<std::size_t>(py + r) * size_x_ + px;
+        all_default = std::all_of(
+          row, row + cols, [this](unsigned char c) {return c == default_value_;});
+      }
+      if (all_default) {
+        page.reset();
+        continue;
+      }
+
+      if (!page) {
+        page = allocatePage();
+      }
+      for (unsigned int r = 0; r < rows; ++r) {
+        const unsigned char * row = costs + static_cast<std::size_t>(py + r) * size_x_ + px;
+        memcpy(&page[r << PAGE_BITS], row, cols);
+      }
+    }
+  }
+}
+
+void PagedGrid::copyToRowMajor(unsigned char * costs) const
+{
+  for (unsigned int y = 0; y < size_y_; ++y) {
+    unsigned char * row = costs + static_cast<std::size_t>(y) * size_x_;
+    forEachRowSegment(
+      y, 0, size_x_, [row](const unsigned char * run, unsigned int x, unsigned int length) {
+        memcpy(row + x, run, length);
+      });
+  }
+}
+
+void PagedGrid::compact()
+{
+  for (auto & page : pages_) {
+    if (page && std::all_of(
+        page.get(), page.get() + PAGE_AREA,
+        [this](unsigned char c) {return c == default_value_;}))
+    {
+      page.reset();
+    }
+  }
+}
+
+std::size_t PagedGrid::getAllocatedPages() const
+{
+  return std::count_if(
+    pages_.begin(), pages_.end(),
+    [](const std::unique_ptr<unsigned char[]> & page) {return page != nullptr;});
+}
+
+std::size_t PagedGrid::getMemoryUsage() const
+{
+  return getAllocatedPages() * PAGE_AREA +
+         pages_.size() * sizeof(std::unique_ptr<unsigned char[]>);
+}
+
+std::unique_ptr<unsigned char[]> PagedGrid::allocatePage() const
+{
+  // Padding cells past the map edge hold the default too, which keeps
+  // compact() from having to special case partial pages
+  std::unique_ptr<unsigned char[]> page(new unsigned char[PAGE_AREA]);
+  memset(page.get(), default_value_, PAGE_AREA);
+  return page;
+}
+
+std::shared_ptr<const unsigned char> PagedGrid::sharedDefaultPage(unsigned char value)
+{
+  static std::mutex mutex;
+  static std::weak_ptr<const unsigned char> pages[256];
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const unsigned char> page = pages[value].lock();
+  if (!page) {
+    unsigned char * data = new unsigned char[PAGE_AREA];
+    memset(data, value, PAGE_AREA);
+    page = std::shared_ptr<const unsigned char>(
+      data, [](const unsigned char * p) {delete[] p;});
+    pages[value] = page;
+  }
+  return page;
+}
+
+}  // namespace nav2_costmap_2d
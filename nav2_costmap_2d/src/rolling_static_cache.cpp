@@ -0,0 +1,130 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_costmap_2d/rolling_static_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+bool RollingStaticCache::update(
+  const Costmap2D & master, const Costmap2D & map, const tf2::Transform & transform,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  const unsigned int size_x = master.getSizeInCellsX();
+  const unsigned int size_y = master.getSizeInCellsY();
+  const double resolution = master.getResolution();
+
+  bool rebuilt = false;
+  if (!valid_ || size_x != size_x_ || size_y != size_y_ || resolution != resolution_ ||
+    movedBeyondTolerance(master, map, transform))
+  {
+    costs_.assign(size_x * size_y, NO_INFORMATION);
+    cells_.assign(size_x * size_y, UNKNOWN);
+    size_x_ = size_x;
+    size_y_ = size_y;
+    resolution_ = resolution;
+    transform_ = transform;
+    origin_x_ = master.getOriginX();
+    origin_y_ = master.getOriginY();
+    valid_ = true;
+    rebuilt = true;
+  } else if (master.getOriginX() != origin_x_ || master.getOriginY() != origin_y_) {
+    shift(master);
+  }
+
+  // the transform is affine, so along a row of master cells the map point
+  // advances by a constant step
+  const tf2::Vector3 step = transform_.getBasis() * tf2::Vector3(resolution, 0, 0);
+  unsigned int mx, my;
+  double wx, wy;
+  for (int j = min_j; j < max_j; ++j) {
+    unsigned int index = size_x * j + min_i;
+    master.mapToWorld(min_i, j, wx, wy);
+    tf2::Vector3 p = transform_ * tf2::Vector3(wx, wy, 0);
+    for (int i = min_i; i < max_i; ++i, ++index, p += step) {
+      if (cells_[index] != UNKNOWN) {
+        continue;
+      }
+      if (map.worldToMap(p.x(), p.y(), mx, my)) {
+        costs_[index] = map.getCost(mx, my);
+        cells_[index] = INSIDE;
+      } else {
+        cells_[index] = OUTSIDE;
+      }
+    }
+  }
+  return rebuilt;
+}
+
+bool RollingStaticCache::movedBeyondTolerance(
+  const Costmap2D & master, const Costmap2D & map, const tf2::Transform & transform) const
+{
+  // both transforms are rigid, so the cell moving the most is at a corner
+  const double x0 = master.getOriginX();
+  const double y0 = master.getOriginY();
+  const double x1 = x0 + master.getSizeInCellsX() * master.getResolution();
+  const double y1 = y0 + master.getSizeInCellsY() * master.getResolution();
+  const double limit = tolerance_ * std::min(master.getResolution(), map.getResolution());
+  const double limit_sq = limit * limit;
+  const tf2::Vector3 corners[] = {
+    tf2::Vector3(x0, y0, 0), tf2::Vector3(x1, y0, 0),
+    tf2::Vector3(x0, y1, 0), tf2::Vector3(x1, y1, 0)};
+  for (const tf2::Vector3 & corner : corners) {
+    if ((transform * corner - transform_ * corner).length2() > limit_sq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RollingStaticCache::shift(const Costmap2D & master)
+{
+  // the window moved by whole cells, keep the overlap the same way
+  // Costmap2D::updateOrigin does and leave the rest to be looked up
+  const int cell_ox = static_cast<int>(
+    std::lround((master.getOriginX() - origin_x_) / resolution_));
+  const int cell_oy = static_cast<int>(
+    std::lround((master.getOriginY() - origin_y_) / resolution_));
+  const int sx = size_x_, sy = size_y_;
+  const int lower_left_x = std::min(std::max(cell_ox, 0), sx);
+  const int lower_left_y = std::min(std::max(cell_oy, 0), sy);
+  const int upper_right_x = std::min(std::max(cell_ox + sx, 0), sx);
+  const int upper_right_y = std::min(std::max(cell_oy + sy, 0), sy);
+  const unsigned int cell_size_x = upper_right_x - lower_left_x;
+
+  std::vector<unsigned char> costs(size_x_ * size_y_, NO_INFORMATION);
+  std::vector<unsigned char> cells(size_x_ * size_y_, UNKNOWN);
+  if (cell_size_x > 0) {
+    for (int y = lower_left_y; y < upper_right_y; ++y) {
+      const unsigned int source = y * size_x_ + lower_left_x;
+      const unsigned int dest = (y - cell_oy) * size_x_ + (lower_left_x - cell_ox);
+      memcpy(&costs[dest], &costs_[source], cell_size_x);
+      memcpy(&cells[dest], &cells_[source], cell_size_x);
+    }
+  }
+  costs_.swap(costs);
+  cells_.swap(cells);
+  origin_x_ = master.getOriginX();
+  origin_y_ = master.getOriginY();
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/tiled_grid.hpp"
+
+#include <algorithm>
+
+namespace nav2_costmap_2d
+{
+
+constexpr unsigned int TiledGrid::TILE_BITS;
+constexpr unsigned int TiledGrid::TILE_SIZE;
+constexpr unsigned int TiledGrid::TILE_MASK;
+constexpr unsigned int TiledGrid::TILE_AREA;
+
+TiledGrid::TiledGrid(unsigned int size_x, unsigned int size_y, unsigned char default_value)
+{
+  resize(size_x, size_y, default_value);
+}
+
+void TiledGrid::resize(unsigned int size_x, unsigned int size_y, unsigned char default_value)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  // Partial tiles at the right and top edges are padded to full tiles
+  tiles_x_ = (size_x + TILE_MASK) >> TILE_BITS;
+  const unsigned int tiles_y = (size_y + TILE_MASK) >> TILE_BITS;
+  data_.assign(static_cast<std::size_t>(tiles_x_) * tiles_y * TILE_AREA, default_value);
+}
+
+void TiledGrid::copyFromRowMajor(const unsigned char * costs)
+{
+  for (unsigned int y = 0; y < size_y_; ++y) {
+    const unsigned char * row = costs + static_cast<std::size_t>(y) * size_x_;
+    forEachRowSegment(
+      y, 0, size_x_, [row](unsigned char * run, unsigned int x, unsigned int length) {
+        std::copy(row + x, row + x + length, run);
+      });
+  }
+}
+
+void TiledGrid::copyToRowMajor(unsigned char * costs) const
+{
+  for (unsigned int y = 0; y < size_y_; ++y) {
+    unsigned char * row = costs + static_cast<std::size_t>(y) * size_x_;
+    forEachRowSegment(
+      y, 0, size_x_, [row](const unsigned char * run, unsigned int x, unsigned int length) {
+        std::copy(run, run + length, row + x);
+      });
+  }
+}
+
+}  // namespace nav2_costmap_2d
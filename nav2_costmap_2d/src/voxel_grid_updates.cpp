@@ -0,0 +1,104 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_costmap_2d/voxel_grid_updates.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_compression.hpp"
+
+namespace nav2_costmap_2d
+{
+
+void compressVoxelGridUpdate(nav2_msgs::msg::VoxelGridUpdate & update)
+{
+  encodeWordRuns(update.data.data(), update.data.size(), update.run_values, update.run_lengths);
+  update.data.clear();
+}
+
+bool applyVoxelGridUpdate(
+  const nav2_msgs::msg::VoxelGridUpdate & update, nav2_msgs::msg::VoxelGrid & grid)
+{
+  const unsigned int words_per_column = std::max<unsigned int>(grid.words_per_column, 1);
+  if (std::max<unsigned int>(update.words_per_column, 1) != words_per_column ||
+    update.x + update.width > grid.size_x || update.y + update.height > grid.size_y ||
+    grid.data.size() != static_cast<std::size_t>(grid.size_x) * grid.size_y * words_per_column ||
+    grid.resolutions.x <= 0.0 || grid.resolutions.y <= 0.0)
+  {
+    return false;
+  }
+
+  const std::size_t size = static_cast<std::size_t>(update.width) * update.height *
+    words_per_column;
+  std::vector<uint32_t> decoded;
+  const std::vector<uint32_t> * data = &update.data;
+  if (update.data.empty() && !update.run_lengths.empty()) {
+    decoded.resize(size);
+    if (!decodeWordRuns(update.run_values, update.run_lengths, decoded.data(), size)) {
+      return false;
+    }
+    data = &decoded;
+  }
+  if (data->size() != size) {
+    return false;
+  }
+
+  // The window moves by whole cells, see Costmap2D::updateOrigin()
+  const long dx = std::lround((update.origin.x - grid.origin.x) / grid.resolutions.x);
+  const long dy = std::lround((update.origin.y - grid.origin.y) / grid.resolutions.y);
+  if (dx != 0 || dy != 0) {
+    // The low half of an unknown column is set: a free/unknown bit per level
+    std::vector<uint32_t> unknown(words_per_column, 0);
+    for (unsigned int bit = 0; bit < words_per_column * 16; ++bit) {
+      unknown[bit / 32] |= static_cast<uint32_t>(1) << (bit % 32);
+    }
+
+    std::vector<uint32_t> shifted(grid.data.size());
+    for (long j = 0; j < static_cast<long>(grid.size_y); ++j) {
+      for (long i = 0; i < static_cast<long>(grid.size_x); ++i) {
+        const long old_i = i + dx;
+        const long old_j = j + dy;
+        uint32_t * column = &shifted[(j * grid.size_x + i) * words_per_column];
+        if (old_i < 0 || old_j < 0 || old_i >= static_cast<long>(grid.size_x) ||
+          old_j >= static_cast<long>(grid.size_y))
+        {
+          std::copy(unknown.begin(), unknown.end(), column);
+        } else {
+          const uint32_t * old_column =
+            &grid.data[(old_j * grid.size_x + old_i) * words_per_column];
+          std::copy(old_column, old_column + words_per_column, column);
+        }
+      }
+    }
+    grid.data.swap(shifted);
+  }
+  grid.origin = update.origin;
+  grid.header = update.header;
+
+  const std::size_t row_words = static_cast<std::size_t>(update.width) * words_per_column;
+  for (unsigned int j = 0; j < update.height; ++j) {
+    const std::size_t first =
+      (static_cast<std::size_t>(update.y + j) * grid.size_x + update.x) * words_per_column;
+    std::copy(
+      data->begin() + j * row_words, data->begin() + (j + 1) * row_words,
+      grid.data.begin() + first);
+  }
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -33,16 +33,20 @@
  */
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/obstacle_layer.hpp"
 #include "nav2_costmap_2d/inflation_layer.hpp"
+#include "nav2_costmap_2d/distance_field_layer.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
 #include "../testing_helper.hpp"
 #include "nav2_util/node_utils.hpp"
@@ -594,3 +598,372 @@ TEST_F(TestNode, testInflation3)
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 1u);
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE), 4u);
 }
+
+/**
+ * Test that the incremental inflation mode produces the same costs as the
+ * batch wavefront when obstacles are added and removed across cycles
+ */
+TEST_F(TestNode, testIncrementalInflation)
+{
+  std::vector<rclcpp::Parameter> parameters;
+  parameters.push_back(rclcpp::Parameter("inflation.cost_scaling_factor", 1.0));
+  parameters.push_back(rclcpp::Parameter("inflation.inflation_radius", 3.0));
+  parameters.push_back(rclcpp::Parameter("incremental.cost_scaling_factor", 1.0));
+  parameters.push_back(rclcpp::Parameter("incremental.inflation_radius", 3.0));
+  parameters.push_back(rclcpp::Parameter("incremental.incremental_inflation", true));
+  initNode(parameters);
+
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap batch_layers("frame", false, false);
+  nav2_costmap_2d::LayeredCostmap incremental_layers("frame", false, false);
+  batch_layers.resizeMap(20, 20, 1, 0, 0);
+  incremental_layers.resizeMap(20, 20, 1, 0, 0);
+
+  std::shared_ptr<nav2_costmap_2d::InflationLayer> batch = nullptr;
+  addInflationLayer(batch_layers, tf, node_, batch);
+  auto incremental = std::make_shared<nav2_costmap_2d::InflationLayer>();
+  incremental->initialize(&incremental_layers, "incremental", &tf, node_, nullptr, nullptr);
+  incremental_layers.addPlugin(incremental);
+
+  setRadii(batch_layers, 1, 1.75);
+  setRadii(incremental_layers, 1, 1.75);
+
+  nav2_costmap_2d::Costmap2D * batch_map = batch_layers.getCostmap();
+  nav2_costmap_2d::Costmap2D * incremental_map = incremental_layers.getCostmap();
+
+  auto cycle = [&](const std::vector<std::pair<unsigned int, unsigned int>> & obstacles) {
+      batch_map->resetMap(0, 0, 20, 20);
+      incremental_map->resetMap(0, 0, 20, 20);
+      for (const auto & cell : obstacles) {
+        batch_map->setCost(cell.first, cell.second, nav2_costmap_2d::LETHAL_OBSTACLE);
+        incremental_map->setCost(cell.first, cell.second, nav2_costmap_2d::LETHAL_OBSTACLE);
+      }
+      batch->updateCosts(*batch_map, 0, 0, 20, 20);
+      incremental->updateCosts(*incremental_map, 0, 0, 20, 20);
+      for (unsigned int j = 0; j < 20; ++j) {
+        for (unsigned int i = 0; i < 20; ++i) {
+          ASSERT_EQ(batch_map->getCost(i, j), incremental_map->getCost(i, j));
+        }
+      }
+    };
+
+  cycle({{5, 5}});
+  cycle({{5, 5}, {14, 12}});
+  cycle({{14, 12}});
+  cycle({});
+  EXPECT_EQ(countValues(*incremental_map, nav2_costmap_2d::FREE_SPACE), 400u);
+}
+
+/**
+ * Test that the distance transform inflation gives the wavefront costs around
+ * a single obstacle, and the costs of the nearest obstacle around several
+ */
+TEST_F(TestNode, testDistanceTransformInflation)
+{
+  std::vector<rclcpp::Parameter> parameters;
+  parameters.push_back(rclcpp::Parameter("inflation.cost_scaling_factor", 1.0));
+  parameters.push_back(rclcpp::Parameter("inflation.inflation_radius", 3.0));
+  parameters.push_back(rclcpp::Parameter("transform.cost_scaling_factor", 1.0));
+  parameters.push_back(rclcpp::Parameter("transform.inflation_radius", 3.0));
+  parameters.push_back(rclcpp::Parameter("transform.distance_transform_inflation", true));
+  parameters.push_back(rclcpp::Parameter("transform.distance_transform_threads", 2));
+  initNode(parameters);
+
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap batch_layers("frame", false, false);
+  nav2_costmap_2d::LayeredCostmap transform_layers("frame", false, false);
+  batch_layers.resizeMap(20, 20, 1, 0, 0);
+  transform_layers.resizeMap(20, 20, 1, 0, 0);
+
+  std::shared_ptr<nav2_costmap_2d::InflationLayer> batch = nullptr;
+  addInflationLayer(batch_layers, tf, node_, batch);
+  auto transform = std::make_shared<nav2_costmap_2d::InflationLayer>();
+  transform->initialize(&transform_layers, "transform", &tf, node_, nullptr, nullptr);
+  transform_layers.addPlugin(transform);
+
+  setRadii(batch_layers, 1, 1.75);
+  setRadii(transform_layers, 1, 1.75);
+
+  nav2_costmap_2d::Costmap2D * batch_map = batch_layers.getCostmap();
+  nav2_costmap_2d::Costmap2D * transform_map = transform_layers.getCostmap();
+
+  batch_map->setCost(5, 5, nav2_costmap_2d::LETHAL_OBSTACLE);
+  transform_map->setCost(5, 5, nav2_costmap_2d::LETHAL_OBSTACLE);
+  batch->updateCosts(*batch_map, 0, 0, 20, 20);
+  transform->updateCosts(*transform_map, 0, 0, 20, 20);
+  for (unsigned int j = 0; j < 20; ++j) {
+    for (unsigned int i = 0; i < 20; ++i) {
+      ASSERT_EQ(batch_map->getCost(i, j), transform_map->getCost(i, j));
+    }
+  }
+
+  const std::vector<std::pair<unsigned int, unsigned int>> obstacles = {{5, 5}, {8, 6}, {14, 12}};
+  transform_map->resetMap(0, 0, 20, 20);
+  for (const auto & cell : obstacles) {
+    transform_map->setCost(cell.first, cell.second, nav2_costmap_2d::LETHAL_OBSTACLE);
+  }
+  transform->updateCosts(*transform_map, 0, 0, 20, 20);
+  for (unsigned int j = 0; j < 20; ++j) {
+    for (unsigned int i = 0; i < 20; ++i) {
+      double distance = std::numeric_limits<double>::max();
+      for (const auto & cell : obstacles) {
+        distance = std::min(distance, std::hypot(1.0 * i - cell.first, 1.0 * j - cell.second));
+      }
+      unsigned char expected = distance > 3.0 ? nav2_costmap_2d::FREE_SPACE :
+        transform->computeCost(distance);
+      ASSERT_EQ(transform_map->getCost(i, j), expected);
+    }
+  }
+}
+
+/**
+ * Test that the kernel inflation gives the costs of the nearest obstacle, also
+ * across runs of obstacles and when only part of the map is updated
+ */
+TEST_F(TestNode, testKernelInflation)
+{
+  std::vector<rclcpp::Parameter> parameters;
+  parameters.push_back(rclcpp::Parameter("kernel.cost_scaling_factor", 1.0));
+  parameters.push_back(rclcpp::Parameter("kernel.inflation_radius", 3.0));
+  parameters.push_back(rclcpp::Parameter("kernel.kernel_inflation", true));
+  initNode(parameters);
+
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(20, 20, 1, 0, 0);
+  auto kernel = std::make_shared<nav2_costmap_2d::InflationLayer>();
+  kernel->initialize(&layers, "kernel", &tf, node_, nullptr, nullptr);
+  layers.addPlugin(kernel);
+  setRadii(layers, 1, 1.75);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  const std::vector<std::pair<unsigned int, unsigned int>> obstacles =
+  {{5, 5}, {8, 6}, {9, 6}, {10, 6}, {11, 6}, {14, 12}, {0, 19}};
+  for (const auto & cell : obstacles) {
+    costmap->setCost(cell.first, cell.second, nav2_costmap_2d::LETHAL_OBSTACLE);
+  }
+  auto expected = [&](unsigned int i, unsigned int j) {
+      double distance = std::numeric_limits<double>::max();
+      for (const auto & cell : obstacles) {
+        distance = std::min(distance, std::hypot(1.0 * i - cell.first, 1.0 * j - cell.second));
+      }
+      return distance > 3.0 ? nav2_costmap_2d::FREE_SPACE : kernel->computeCost(distance);
+    };
+
+  // Obstacles outside the window still reach into it, the cells outside are left alone
+  kernel->updateCosts(*costmap, 9, 8, 16, 14);
+  for (unsigned int j = 0; j < 20; ++j) {
+    for (unsigned int i = 0; i < 20; ++i) {
+      if (i >= 9 && i < 16 && j >= 8 && j < 14) {
+        ASSERT_EQ(costmap->getCost(i, j), expected(i, j));
+      } else if (costmap->getCost(i, j) != nav2_costmap_2d::LETHAL_OBSTACLE) {
+        ASSERT_EQ(costmap->getCost(i, j), nav2_costmap_2d::FREE_SPACE);
+      }
+    }
+  }
+
+  kernel->updateCosts(*costmap, 0, 0, 20, 20);
+  for (unsigned int j = 0; j < 20; ++j) {
+    for (unsigned int i = 0; i < 20; ++i) {
+      ASSERT_EQ(costmap->getCost(i, j), expected(i, j));
+    }
+  }
+}
+
+/**
+ * Test that updating the costmap in tiles on several threads gives the same
+ * costs as the sequential update, including obstacles whose inflation crosses tiles
+ */
+TEST_F(TestNode, testTiledUpdate)
+{
+  initNode(3);
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  nav2_costmap_2d::LayeredCostmap tiled_layers("frame", false, false);
+  layers.resizeMap(30, 30, 1, 0, 0);
+  tiled_layers.resizeMap(30, 30, 1, 0, 0);
+  tiled_layers.setTiledUpdate(3, 7);
+
+  std::shared_ptr<nav2_costmap_2d::ObstacleLayer> olayer = nullptr;
+  addObstacleLayer(layers, tf, node_, olayer);
+  std::shared_ptr<nav2_costmap_2d::InflationLayer> ilayer = nullptr;
+  addInflationLayer(layers, tf, node_, ilayer);
+
+  std::shared_ptr<nav2_costmap_2d::ObstacleLayer> tiled_olayer = nullptr;
+  addObstacleLayer(tiled_layers, tf, node_, tiled_olayer);
+  std::shared_ptr<nav2_costmap_2d::InflationLayer> tiled_ilayer = nullptr;
+  addInflationLayer(tiled_layers, tf, node_, tiled_ilayer);
+
+  setRadii(layers, 1, 1.75);
+  setRadii(tiled_layers, 1, 1.75);
+
+  // Obstacles on tile corners and edges so their inflation spans several tiles
+  addObservation(olayer, 7, 7, MAX_Z);
+  addObservation(olayer, 20, 13, MAX_Z);
+  addObservation(olayer, 26, 27, MAX_Z);
+  addObservation(tiled_olayer, 7, 7, MAX_Z);
+  addObservation(tiled_olayer, 20, 13, MAX_Z);
+  addObservation(tiled_olayer, 26, 27, MAX_Z);
+
+  layers.updateMap(0, 0, 0);
+  tiled_layers.updateMap(0, 0, 0);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  nav2_costmap_2d::Costmap2D * tiled_costmap = tiled_layers.getCostmap();
+  for (unsigned int j = 0; j < 30; ++j) {
+    for (unsigned int i = 0; i < 30; ++i) {
+      ASSERT_EQ(costmap->getCost(i, j), tiled_costmap->getCost(i, j));
+    }
+  }
+  EXPECT_EQ(countValues(*tiled_costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 3u);
+}
+
+namespace
+{
+
+// Writes fixed costs into the master on every update, tile by tile
+class CellsLayer : public nav2_costmap_2d::Layer
+{
+public:
+  explicit CellsLayer(std::vector<std::pair<std::pair<int, int>, unsigned char>> cells)
+  : cells_(std::move(cells)) {}
+
+  void reset() override {}
+
+  void updateBounds(
+    double, double, double, double * min_x, double * min_y, double * max_x,
+    double * max_y) override
+  {
+    for (const auto & cell : cells_) {
+      *min_x = std::min(*min_x, 1.0 * cell.first.first);
+      *min_y = std::min(*min_y, 1.0 * cell.first.second);
+      *max_x = std::max(*max_x, cell.first.first + 1.0);
+      *max_y = std::max(*max_y, cell.first.second + 1.0);
+    }
+  }
+
+  void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j, int max_i, int max_j) override
+  {
+    for (const auto & cell : cells_) {
+      const int i = cell.first.first, j = cell.first.second;
+      if (i >= min_i && i < max_i && j >= min_j && j < max_j) {
+        master_grid.setCost(i, j, cell.second);
+      }
+    }
+  }
+
+  bool isTileSafe() override {return true;}
+
+private:
+  std::vector<std::pair<std::pair<int, int>, unsigned char>> cells_;
+};
+
+}  // namespace
+
+/**
+ * Test that the tiled inflation around unknown cells matches the sequential one, for
+ * the wavefront, the distance transform and the kernel, with unknown cells on the tile
+ * borders that the neighbouring tiles fill in while the others inflate from them
+ */
+TEST_F(TestNode, testTiledInflationAroundUnknown)
+{
+  std::vector<rclcpp::Parameter> parameters;
+  for (const std::string name : {"inflation", "transform", "kernel"}) {
+    parameters.push_back(rclcpp::Parameter(name + ".cost_scaling_factor", 1.0));
+    parameters.push_back(rclcpp::Parameter(name + ".inflation_radius", 3.0));
+    parameters.push_back(rclcpp::Parameter(name + ".inflate_around_unknown", true));
+    parameters.push_back(rclcpp::Parameter(name + ".inflate_unknown", true));
+  }
+  parameters.push_back(rclcpp::Parameter("transform.distance_transform_inflation", true));
+  parameters.push_back(rclcpp::Parameter("kernel.kernel_inflation", true));
+  initNode(parameters);
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  // Tiles of 7 cells, so borders at 7, 14, 21 and 28, with unknown cells on both sides
+  // of them, next to obstacles and alone
+  const unsigned char unknown = nav2_costmap_2d::NO_INFORMATION;
+  const unsigned char lethal = nav2_costmap_2d::LETHAL_OBSTACLE;
+  const std::vector<std::pair<std::pair<int, int>, unsigned char>> cells = {
+    {{6, 6}, unknown}, {{7, 6}, unknown}, {{6, 7}, lethal}, {{7, 7}, unknown},
+    {{13, 3}, unknown}, {{14, 3}, lethal}, {{13, 14}, unknown}, {{14, 13}, unknown},
+    {{20, 21}, unknown}, {{21, 20}, lethal}, {{27, 27}, unknown}, {{28, 28}, unknown},
+    {{3, 20}, unknown}, {{3, 21}, unknown}, {{24, 6}, lethal}};
+
+  for (const std::string name : {"inflation", "transform", "kernel"}) {
+    nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+    layers.resizeMap(30, 30, 1, 0, 0);
+    layers.addPlugin(std::make_shared<CellsLayer>(cells));
+    auto ilayer = std::make_shared<nav2_costmap_2d::InflationLayer>();
+    ilayer->initialize(&layers, name, &tf, node_, nullptr, nullptr);
+    layers.addPlugin(ilayer);
+    setRadii(layers, 1, 1.75);
+    layers.updateMap(0, 0, 0);
+    const nav2_costmap_2d::Costmap2D serial(*layers.getCostmap());
+
+    // Every tile races its neighbours, so a few runs and thread counts
+    for (unsigned int threads : {2u, 4u, 8u}) {
+      layers.setTiledUpdate(threads, 7);
+      for (int run = 0; run < 10; ++run) {
+        // A new footprint has the whole map inflated again
+        setRadii(layers, 1, 1.75);
+        layers.updateMap(0, 0, 0);
+        const nav2_costmap_2d::Costmap2D * tiled = layers.getCostmap();
+        for (unsigned int j = 0; j < 30; ++j) {
+          for (unsigned int i = 0; i < 30; ++i) {
+            ASSERT_EQ(serial.getCost(i, j), tiled->getCost(i, j)) <<
+              name << " with " << threads << " threads at " << i << ", " << j;
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Test that the distance field layer keeps exact obstacle distances next to inflation
+ */
+TEST_F(TestNode, testDistanceField)
+{
+  std::vector<rclcpp::Parameter> parameters;
+  parameters.push_back(rclcpp::Parameter("distance_field.max_distance", 3.0));
+  initNode(parameters);
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+
+  std::shared_ptr<nav2_costmap_2d::ObstacleLayer> olayer = nullptr;
+  addObstacleLayer(layers, tf, node_, olayer);
+
+  std::shared_ptr<nav2_costmap_2d::DistanceFieldLayer> dlayer = nullptr;
+  addDistanceFieldLayer(layers, tf, node_, dlayer);
+
+  std::vector<Point> polygon = setRadii(layers, 1, 1);
+  layers.setFootprint(polygon);
+
+  EXPECT_EQ(nav2_costmap_2d::DistanceFieldLayer::find(layers), dlayer);
+
+  addObservation(olayer, 2, 2, MAX_Z);
+  addObservation(olayer, 7, 6, MAX_Z);
+  layers.updateMap(0, 0, 0);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  for (unsigned int j = 0; j < costmap->getSizeInCellsY(); ++j) {
+    for (unsigned int i = 0; i < costmap->getSizeInCellsX(); ++i) {
+      double expected = 3.0;
+      for (unsigned int oj = 0; oj < costmap->getSizeInCellsY(); ++oj) {
+        for (unsigned int oi = 0; oi < costmap->getSizeInCellsX(); ++oi) {
+          if (costmap->getCost(oi, oj) == nav2_costmap_2d::LETHAL_OBSTACLE) {
+            expected = std::min(expected, std::hypot(1.0 * i - oi, 1.0 * j - oj));
+          }
+        }
+      }
+      EXPECT_NEAR(dlayer->getDistance(i, j), expected, 1e-5);
+    }
+  }
+
+  float distance;
+  ASSERT_TRUE(dlayer->getDistanceAtWorld(2.5, 3.5, distance));
+  EXPECT_NEAR(distance, 1.0, 1e-5);
+  EXPECT_FALSE(dlayer->getDistanceAtWorld(11.0, 3.5, distance));
+}
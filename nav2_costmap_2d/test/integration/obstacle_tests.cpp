@@ -32,13 +32,17 @@
  * Test harness for ObstacleLayer for Costmap2D
  */
 
+#include <chrono>
+#include <cmath>
 #include <memory>
 #include <string>
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/decaying_obstacle_layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
 #include "../testing_helper.hpp"
@@ -256,6 +260,74 @@ TEST_F(TestNode, testWaveInterference) {
   ASSERT_EQ(5, countValues(*costmap, nav2_costmap_2d::FREE_SPACE));
 }
 
+/**
+ * The polar sweep clears the same cells as the rays of the wave interference test
+ */
+TEST_F(TestNode, testPolarClearing) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  node_->set_parameter(rclcpp::Parameter("track_unknown_space", true));
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, true);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  auto olayer = addObstacleLayer(layers, tf, node_);
+
+  // 4 degree bins, the diagonal falls inside one
+  for (double d : {3.0, 5.0, 7.0}) {
+    sensor_msgs::msg::PointCloud2 cloud;
+    sensor_msgs::PointCloud2Modifier modifier(cloud);
+    modifier.setPointCloud2FieldsByString(1, "xyz");
+    modifier.resize(1);
+    sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+    sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+    sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+    *iter_x = d;
+    *iter_y = d;
+    *iter_z = MAX_Z;
+    geometry_msgs::msg::Point p;
+    p.z = MAX_Z;
+    nav2_costmap_2d::Observation obs(p, cloud, 100.0, 100.0);
+    obs.polar_clearing_bins_ = 90;
+    olayer->addStaticObservation(obs, true, true);
+  }
+  layers.updateMap(0, 0, 0);
+
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  ASSERT_EQ(3, countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE));
+  ASSERT_EQ(92, countValues(*costmap, nav2_costmap_2d::NO_INFORMATION));
+  ASSERT_EQ(5, countValues(*costmap, nav2_costmap_2d::FREE_SPACE));
+  ASSERT_EQ(nav2_costmap_2d::FREE_SPACE, costmap->getCost(6, 6));
+}
+
+/**
+ * Test that resetting all but a window only redraws the cells that changed
+ */
+TEST_F(TestNode, testResetExceptArea) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+  auto olayer = addObstacleLayer(layers, tf, node_);
+
+  olayer->setCost(2, 2, nav2_costmap_2d::LETHAL_OBSTACLE);
+  olayer->setCost(5, 5, nav2_costmap_2d::LETHAL_OBSTACLE);
+  olayer->setCost(7, 7, nav2_costmap_2d::LETHAL_OBSTACLE);
+  olayer->addExtraBounds(0, 0, 10, 10);
+  layers.updateMap(0, 0, 0);
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  ASSERT_EQ(3, countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE));
+
+  // Mark a master cell away from the cleared obstacles, only a full redraw resets it
+  costmap->setCost(9, 0, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+
+  olayer->resetExceptArea(4, 4, 6, 6, nav2_costmap_2d::FREE_SPACE);
+  ASSERT_EQ(nav2_costmap_2d::FREE_SPACE, olayer->getCost(2, 2));
+  ASSERT_EQ(nav2_costmap_2d::LETHAL_OBSTACLE, olayer->getCost(5, 5));
+  ASSERT_EQ(nav2_costmap_2d::FREE_SPACE, olayer->getCost(7, 7));
+  layers.updateMap(0, 0, 0);
+
+  ASSERT_EQ(1, countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE));
+  ASSERT_EQ(nav2_costmap_2d::LETHAL_OBSTACLE, costmap->getCost(5, 5));
+  ASSERT_EQ(nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE, costmap->getCost(9, 0));
+}
+
 /**
  * Make sure we ignore points outside of our z threshold
  */
@@ -369,3 +441,136 @@ TEST_F(TestNode, testRepeatedResets) {
         plugin->reset();
       }));
 }
+
+/**
+ * Clearing rays traced on a pool must clear exactly what tracing them on
+ * the update thread clears
+ */
+TEST_F(TestNode, testParallelRaytracing) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  node_->declare_parameter("parallel.raytrace_threads", rclcpp::ParameterValue(3));
+
+  // A dense scan of points around the sensor, many of them in the same cells
+  sensor_msgs::msg::PointCloud2 cloud;
+  sensor_msgs::PointCloud2Modifier modifier(cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  const int num_points = 5000;
+  modifier.resize(num_points);
+  sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+  for (int i = 0; i < num_points; ++i, ++iter_x, ++iter_y, ++iter_z) {
+    double angle = 2.0 * M_PI * i / num_points;
+    double range = 3.0 + 5.0 * ((i * 37) % 100) / 100.0;
+    *iter_x = 10.0 + range * cos(angle);
+    *iter_y = 10.0 + range * sin(angle);
+    *iter_z = MAX_Z / 2;
+  }
+  geometry_msgs::msg::Point origin;
+  origin.x = 10.0;
+  origin.y = 10.0;
+  origin.z = MAX_Z / 2;
+  nav2_costmap_2d::Observation obs(origin, cloud, 100.0, 100.0);
+
+  auto run = [&](const std::string & name) {
+      auto layers = std::make_shared<nav2_costmap_2d::LayeredCostmap>("frame", false, false);
+      layers->resizeMap(200, 200, 0.1, 0, 0);
+      auto olayer = std::make_shared<nav2_costmap_2d::ObstacleLayer>();
+      olayer->initialize(layers.get(), name, &tf, node_, nullptr, nullptr);
+      layers->addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(olayer));
+      for (unsigned int y = 0; y < olayer->getSizeInCellsY(); ++y) {
+        for (unsigned int x = 0; x < olayer->getSizeInCellsX(); ++x) {
+          olayer->setCost(x, y, nav2_costmap_2d::LETHAL_OBSTACLE);
+        }
+      }
+      olayer->addStaticObservation(obs, true, true);
+      layers->updateMap(10.0, 10.0, 0.0);
+      return std::vector<unsigned char>(
+        olayer->getCharMap(),
+        olayer->getCharMap() + olayer->getSizeInCellsX() * olayer->getSizeInCellsY());
+    };
+
+  std::vector<unsigned char> serial = run("serial");
+  std::vector<unsigned char> parallel = run("parallel");
+
+  ASSERT_EQ(serial.size(), parallel.size());
+  EXPECT_GT(std::count(serial.begin(), serial.end(), nav2_costmap_2d::FREE_SPACE), 1000);
+  EXPECT_TRUE(serial == parallel);
+}
+
+/**
+ * Downsampling keeps one point per voxel
+ */
+TEST_F(TestNode, testVoxelDownsampling) {
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  // 40 points in each of 5 voxels of 0.1 m, plus one out of the height bounds
+  sensor_msgs::msg::PointCloud2 cloud;
+  cloud.header.frame_id = "frame";
+  sensor_msgs::PointCloud2Modifier modifier(cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(201);
+  sensor_msgs::PointCloud2Iterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(cloud, "z");
+  for (int i = 0; i < 200; ++i, ++iter_x, ++iter_y, ++iter_z) {
+    *iter_x = 1.001 + 0.1 * (i % 5) + 0.0025 * (i / 5);
+    *iter_y = 2.05;
+    *iter_z = 0.05;
+  }
+  *iter_x = 1.0;
+  *iter_y = 2.0;
+  *iter_z = 5.0;
+
+  auto buffered = [&](double voxel_size) {
+      nav2_costmap_2d::ObservationBuffer buffer(
+        node_, "cloud", 0.0, 0.0, 0.0, 1.0, 100.0, 100.0, tf, "frame", "frame", 0.3,
+        voxel_size);
+      buffer.bufferCloud(cloud);
+      std::vector<nav2_costmap_2d::Observation> observations;
+      buffer.getObservations(observations);
+      EXPECT_EQ(observations.size(), 1u);
+      return observations.empty() ? 0u :
+             observations[0].cloud_->width * observations[0].cloud_->height;
+    };
+
+  EXPECT_EQ(buffered(0.0), 200u);
+  EXPECT_EQ(buffered(0.1), 5u);
+}
+
+/**
+ * Obstacles of the decaying layer are cleared once they are no longer seen
+ */
+TEST_F(TestNode, testDecayingObstacles) {
+  tf2_ros::Buffer tf(node_->get_clock());
+  node_->declare_parameter("decaying.decay_time", rclcpp::ParameterValue(0.5));
+  nav2_costmap_2d::LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(10, 10, 1, 0, 0);
+
+  auto dlayer = std::make_shared<nav2_costmap_2d::DecayingObstacleLayer>();
+  dlayer->initialize(&layers, "decaying", &tf, node_, nullptr, nullptr);
+  layers.addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(dlayer));
+  std::shared_ptr<nav2_costmap_2d::ObstacleLayer> olayer(dlayer);
+
+  // Marked by two points, without clearing rays
+  addObservation(olayer, 5.0, 5.0, MAX_Z / 2, 0.0, 0.0, MAX_Z / 2, true, false);
+  addObservation(olayer, 2.0, 7.0, MAX_Z / 2, 0.0, 0.0, MAX_Z / 2, true, false);
+  layers.updateMap(0, 0, 0);
+  nav2_costmap_2d::Costmap2D * costmap = layers.getCostmap();
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 2);
+
+  // Seen again, they stay
+  rclcpp::sleep_for(std::chrono::milliseconds(300));
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 2);
+
+  // Once out of sight, they expire
+  olayer->clearStaticObservations(true, false);
+  rclcpp::sleep_for(std::chrono::milliseconds(100));
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 2);
+  rclcpp::sleep_for(std::chrono::milliseconds(500));
+  layers.updateMap(0, 0, 0);
+  ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 0);
+  EXPECT_EQ(costmap->getCost(5, 5), nav2_costmap_2d::FREE_SPACE);
+}
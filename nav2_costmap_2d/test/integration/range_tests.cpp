@@ -291,3 +291,62 @@ TEST_F(TestNode, testProbabalisticModelDownward) {
   ASSERT_EQ(layers.getCostmap()->getCost(3, 6), 0);
   ASSERT_EQ(layers.getCostmap()->getCost(3, 7), 254);
 }
+
+// Testing the sparse grid gives the costs of the dense one in less memory
+TEST_F(TestNode, testSparseStorage) {
+  geometry_msgs::msg::TransformStamped transform;
+  transform.header.frame_id = "frame";
+  transform.child_frame_id = "base_link";
+  transform.transform.translation.y = 5;
+
+  sensor_msgs::msg::Range msg;
+  msg.min_range = 1.0;
+  msg.max_range = 10.0;
+  msg.range = 3.0;
+  msg.header.frame_id = "base_link";
+  msg.radiation_type = msg.ULTRASOUND;
+  msg.field_of_view = 0.174533;  // 10 deg
+
+  auto run = [&](nav2_costmap_2d::LayeredCostmap & layers,
+      std::shared_ptr<nav2_costmap_2d::RangeSensorLayer> & rlayer) {
+      layers.resizeMap(400, 400, 0.025, 0, 0);
+      addRangeLayer(layers, tf_, node_, rlayer);
+      for (double x : {2.0, 4.0, 6.0}) {
+        transform.header.stamp = node_->now();
+        transform.transform.translation.x = x;
+        tf_.setTransform(transform, "default_authority", true);
+        msg.header.stamp = node_->now();
+        rlayer->bufferIncomingRangeMsg(std::make_shared<sensor_msgs::msg::Range>(msg));
+        layers.updateMap(0, 0, 0);  // 0, 0, 0 is robot pose
+      }
+    };
+
+  node_->declare_parameter("range.sparse_storage", rclcpp::ParameterValue(false));
+  nav2_costmap_2d::LayeredCostmap dense_layers("frame", false, false);
+  std::shared_ptr<nav2_costmap_2d::RangeSensorLayer> dense{nullptr};
+  run(dense_layers, dense);
+
+  node_->set_parameter(rclcpp::Parameter("range.sparse_storage", true));
+  nav2_costmap_2d::LayeredCostmap sparse_layers("frame", false, false);
+  std::shared_ptr<nav2_costmap_2d::RangeSensorLayer> sparse{nullptr};
+  run(sparse_layers, sparse);
+
+  auto dense_costmap = dense_layers.getCostmap();
+  auto sparse_costmap = sparse_layers.getCostmap();
+  int lethal = 0;
+  for (unsigned int j = 0; j < 400; j++) {
+    for (unsigned int i = 0; i < 400; i++) {
+      ASSERT_EQ(sparse_costmap->getCost(i, j), dense_costmap->getCost(i, j));
+      lethal += dense_costmap->getCost(i, j) == nav2_costmap_2d::LETHAL_OBSTACLE;
+    }
+  }
+  ASSERT_GT(lethal, 0);
+  ASSERT_LT(sparse->getMemoryUsage(), dense->getMemoryUsage());
+
+  auto usage = sparse_layers.getMemoryUsage();
+  ASSERT_EQ(usage.size(), 2u);
+  ASSERT_EQ(usage[0].first, "master");
+  ASSERT_EQ(usage[0].second, 400u * 400u);
+  ASSERT_EQ(usage[1].first, "range");
+  ASSERT_EQ(usage[1].second, sparse->getMemoryUsage());
+}
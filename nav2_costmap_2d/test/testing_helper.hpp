@@ -26,6 +26,7 @@
 #include "nav2_costmap_2d/range_sensor_layer.hpp"
 #include "nav2_costmap_2d/obstacle_layer.hpp"
 #include "nav2_costmap_2d/inflation_layer.hpp"
+#include "nav2_costmap_2d/distance_field_layer.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 const double MAX_Z(1.0);
@@ -144,5 +145,14 @@ void addInflationLayer(
   layers.addPlugin(ipointer);
 }
 
+void addDistanceFieldLayer(
+  nav2_costmap_2d::LayeredCostmap & layers,
+  tf2_ros::Buffer & tf, nav2_util::LifecycleNode::SharedPtr node,
+  std::shared_ptr<nav2_costmap_2d::DistanceFieldLayer> & dlayer)
+{
+  dlayer = std::make_shared<nav2_costmap_2d::DistanceFieldLayer>();
+  dlayer->initialize(&layers, "distance_field", &tf, node, nullptr, nullptr /*TODO*/);
+  layers.addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(dlayer));
+}
 
 #endif  // NAV2_COSTMAP_2D__TESTING_HELPER_HPP_
@@ -0,0 +1,160 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cloud_transform.hpp"
+
+namespace
+{
+
+// A cloud of x, y, z and intensity float32 fields
+sensor_msgs::msg::PointCloud2 makeCloud(const std::vector<std::array<float, 4>> & points)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  const char * names[] = {"x", "y", "z", "intensity"};
+  for (uint32_t i = 0; i < 4; ++i) {
+    sensor_msgs::msg::PointField field;
+    field.name = names[i];
+    field.offset = 4 * i;
+    field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+    field.count = 1;
+    cloud.fields.push_back(field);
+  }
+  cloud.header.frame_id = "sensor";
+  cloud.height = 1;
+  cloud.width = static_cast<uint32_t>(points.size());
+  cloud.point_step = 16;
+  cloud.row_step = cloud.width * cloud.point_step;
+  cloud.data.resize(cloud.row_step);
+  memcpy(cloud.data.data(), points.data(), cloud.data.size());
+  return cloud;
+}
+
+std::array<float, 4> point(const sensor_msgs::msg::PointCloud2 & cloud, std::size_t i)
+{
+  std::array<float, 4> p;
+  memcpy(p.data(), cloud.data.data() + i * cloud.point_step, sizeof(p));
+  return p;
+}
+
+// A quarter turn about z, then a (1, 2, 3) translation
+const float transform[12] = {
+  0.0f, -1.0f, 0.0f, 1.0f,
+  1.0f, 0.0f, 0.0f, 2.0f,
+  0.0f, 0.0f, 1.0f, 3.0f};
+
+}  // namespace
+
+TEST(CloudTransform, transformsAndKeepsOtherFields)
+{
+  auto in = makeCloud({{{1.0f, 0.0f, 0.0f, 7.0f}}, {{0.0f, 1.0f, -1.0f, 8.0f}}});
+  nav2_costmap_2d::CloudFilter filter{-100.0, 100.0, 0.0};
+  std::unordered_set<uint64_t> voxels;
+  sensor_msgs::msg::PointCloud2 out;
+  ASSERT_TRUE(nav2_costmap_2d::transformAndFilterCloud(in, transform, filter, voxels, out));
+
+  ASSERT_EQ(out.width, 2u);
+  ASSERT_EQ(out.row_step, 32u);
+  auto p = point(out, 0);
+  EXPECT_FLOAT_EQ(p[0], 1.0f);
+  EXPECT_FLOAT_EQ(p[1], 3.0f);
+  EXPECT_FLOAT_EQ(p[2], 3.0f);
+  EXPECT_FLOAT_EQ(p[3], 7.0f);
+  p = point(out, 1);
+  EXPECT_FLOAT_EQ(p[0], 0.0f);
+  EXPECT_FLOAT_EQ(p[1], 2.0f);
+  EXPECT_FLOAT_EQ(p[2], 2.0f);
+  EXPECT_FLOAT_EQ(p[3], 8.0f);
+}
+
+TEST(CloudTransform, filtersHeightAndVoxels)
+{
+  // z of 0 and 1 land at 3 and 4, outside [2.5, 3.5], the rest share a voxel
+  auto in = makeCloud(
+    {{{0.0f, 0.0f, 1.0f, 0.0f}}, {{0.0f, 0.0f, 0.0f, 1.0f}}, {{0.01f, 0.0f, 0.0f, 2.0f}},
+      {{0.0f, -0.01f, 0.0f, 3.0f}}});
+  nav2_costmap_2d::CloudFilter filter{2.5, 3.5, 0.0};
+  std::unordered_set<uint64_t> voxels;
+  sensor_msgs::msg::PointCloud2 out;
+  ASSERT_TRUE(nav2_costmap_2d::transformAndFilterCloud(in, transform, filter, voxels, out));
+  EXPECT_EQ(out.width, 3u);
+
+  filter.voxel_size = 0.5;
+  ASSERT_TRUE(nav2_costmap_2d::transformAndFilterCloud(in, transform, filter, voxels, out));
+  ASSERT_EQ(out.width, 1u);
+  EXPECT_EQ(out.data.size(), 16u);
+  EXPECT_FLOAT_EQ(point(out, 0)[3], 1.0f);
+}
+
+TEST(CloudTransform, rejectsCloudsWithoutFloatCoordinates)
+{
+  auto in = makeCloud({{{1.0f, 0.0f, 0.0f, 0.0f}}});
+  in.fields[2].datatype = sensor_msgs::msg::PointField::FLOAT64;
+  nav2_costmap_2d::CloudFilter filter{-100.0, 100.0, 0.0};
+  std::unordered_set<uint64_t> voxels;
+  sensor_msgs::msg::PointCloud2 out;
+  EXPECT_FALSE(nav2_costmap_2d::transformAndFilterCloud(in, transform, filter, voxels, out));
+  EXPECT_EQ(out.width, 0u);
+  EXPECT_TRUE(out.data.empty());
+}
+
+TEST(CloudTransform, projectsAndTransformsScans)
+{
+  sensor_msgs::msg::LaserScan scan;
+  scan.header.frame_id = "sensor";
+  scan.angle_min = 0.0f;
+  scan.angle_increment = static_cast<float>(M_PI / 2.0);
+  scan.range_min = 0.1f;
+  scan.range_max = 10.0f;
+  // Beams at 0, 90, 180 and 270 degrees: kept, too close, out of range and infinite
+  scan.ranges = {1.0f, 0.05f, 10.0f, std::numeric_limits<float>::infinity()};
+
+  nav2_costmap_2d::ScanAngles angles;
+  EXPECT_TRUE(angles.update(scan));
+  EXPECT_FALSE(angles.update(scan));
+
+  nav2_costmap_2d::CloudFilter filter{-100.0, 100.0, 0.0};
+  std::unordered_set<uint64_t> voxels;
+  sensor_msgs::msg::PointCloud2 out;
+  nav2_costmap_2d::transformAndFilterScan(scan, angles, transform, false, filter, voxels, out);
+  ASSERT_EQ(out.width, 1u);
+  ASSERT_EQ(out.point_step, 12u);
+  ASSERT_EQ(out.fields.size(), 3u);
+  EXPECT_EQ(out.header.frame_id, "sensor");
+  float p[3];
+  memcpy(p, out.data.data(), sizeof(p));
+  EXPECT_FLOAT_EQ(p[0], 1.0f);
+  EXPECT_FLOAT_EQ(p[1], 3.0f);
+  EXPECT_FLOAT_EQ(p[2], 3.0f);
+
+  // The infinite beam becomes a point just short of range_max, at (0, -10) in the sensor frame
+  nav2_costmap_2d::transformAndFilterScan(scan, angles, transform, true, filter, voxels, out);
+  ASSERT_EQ(out.width, 2u);
+  float q[3];
+  memcpy(q, out.data.data() + out.point_step, sizeof(q));
+  EXPECT_NEAR(q[0], 11.0f, 1e-3);
+  EXPECT_NEAR(q[1], 2.0f, 1e-3);
+  EXPECT_FLOAT_EQ(q[2], 3.0f);
+
+  // New beam angles give new tables
+  scan.angle_min = -1.0f;
+  EXPECT_TRUE(angles.update(scan));
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/combination_kernels.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+using nav2_costmap_2d::NO_INFORMATION;
+using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+
+namespace
+{
+
+// Mirrors the per cell rules CostmapLayer used before the kernels existed
+unsigned char referenceMax(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  if (master == NO_INFORMATION || master < layer) {
+    return layer;
+  }
+  return master;
+}
+
+unsigned char referenceOverwrite(unsigned char master, unsigned char layer)
+{
+  return layer != NO_INFORMATION ? layer : master;
+}
+
+unsigned char referenceAddition(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  if (master == NO_INFORMATION) {
+    return layer;
+  }
+  int sum = master + layer;
+  return sum >= INSCRIBED_INFLATED_OBSTACLE ? INSCRIBED_INFLATED_OBSTACLE - 1 : sum;
+}
+
+// Biased towards the special values so every branch of the kernels is exercised
+std::vector<unsigned char> randomRow(std::mt19937 & gen, unsigned int n)
+{
+  const unsigned char special[] = {0, 1, 126, 127, 128, 252, 253, 254, 255};
+  std::uniform_int_distribution<int> pick(0, 17);
+  std::uniform_int_distribution<int> any(0, 255);
+  std::vector<unsigned char> row(n);
+  for (auto & cell : row) {
+    int p = pick(gen);
+    cell = p < 9 ? special[p] : static_cast<unsigned char>(any(gen));
+  }
+  return row;
+}
+
+template<typename Kernel, typename Reference>
+void checkKernel(Kernel kernel, Reference reference)
+{
+  std::mt19937 gen(42);
+  // Lengths and offsets cover the vector bodies, the scalar tails and unaligned rows
+  for (unsigned int n = 0; n < 100; ++n) {
+    for (unsigned int offset = 0; offset < 3; ++offset) {
+      auto master = randomRow(gen, n + offset);
+      auto layer = randomRow(gen, n + offset);
+      auto expected = master;
+      for (unsigned int i = offset; i < n + offset; ++i) {
+        expected[i] = reference(master[i], layer[i]);
+      }
+      kernel(master.data() + offset, layer.data() + offset, n);
+      ASSERT_EQ(master, expected) << "n = " << n << " offset = " << offset;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(CombinationKernels, max)
+{
+  checkKernel(nav2_costmap_2d::combineRowMax, referenceMax);
+}
+
+TEST(CombinationKernels, overwrite)
+{
+  checkKernel(nav2_costmap_2d::combineRowOverwrite, referenceOverwrite);
+}
+
+TEST(CombinationKernels, addition)
+{
+  checkKernel(nav2_costmap_2d::combineRowAddition, referenceAddition);
+}
+
+TEST(CombinationKernels, name)
+{
+  EXPECT_FALSE(nav2_costmap_2d::combinationKernelsName().empty());
+}
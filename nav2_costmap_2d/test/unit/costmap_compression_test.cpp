@@ -0,0 +1,95 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_compression.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+using nav2_costmap_2d::encodeCostRuns;
+using nav2_costmap_2d::decodeCostRuns;
+using nav2_costmap_2d::encodeWordRuns;
+using nav2_costmap_2d::decodeWordRuns;
+
+TEST(CostmapCompression, roundTripsTypicalMap)
+{
+  // Mostly free and unknown space with a few obstacles, like a real costmap
+  std::vector<unsigned char> costs(200 * 150, nav2_costmap_2d::FREE_SPACE);
+  std::fill(costs.begin(), costs.begin() + 3000, nav2_costmap_2d::NO_INFORMATION);
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<std::size_t> cell(0, costs.size() - 1);
+  for (int i = 0; i < 50; ++i) {
+    costs[cell(gen)] = nav2_costmap_2d::LETHAL_OBSTACLE;
+  }
+
+  std::vector<uint8_t> values;
+  std::vector<uint32_t> lengths;
+  encodeCostRuns(costs.data(), costs.size(), values, lengths);
+  ASSERT_EQ(values.size(), lengths.size());
+  EXPECT_LT(values.size() * 5, costs.size() / 20);
+
+  std::vector<unsigned char> decoded(costs.size(), 42);
+  EXPECT_TRUE(decodeCostRuns(values, lengths, decoded.data(), decoded.size()));
+  EXPECT_EQ(decoded, costs);
+}
+
+TEST(CostmapCompression, roundTripsNoisyAndEmptyMaps)
+{
+  std::vector<unsigned char> costs(1000);
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> cost(0, 255);
+  for (auto & c : costs) {
+    c = static_cast<unsigned char>(cost(gen));
+  }
+
+  std::vector<uint8_t> values;
+  std::vector<uint32_t> lengths;
+  encodeCostRuns(costs.data(), costs.size(), values, lengths);
+  std::vector<unsigned char> decoded(costs.size());
+  EXPECT_TRUE(decodeCostRuns(values, lengths, decoded.data(), decoded.size()));
+  EXPECT_EQ(decoded, costs);
+
+  encodeCostRuns(costs.data(), 0, values, lengths);
+  EXPECT_TRUE(values.empty());
+  EXPECT_TRUE(decodeCostRuns(values, lengths, decoded.data(), 0));
+}
+
+TEST(CostmapCompression, rejectsMismatchedRuns)
+{
+  std::vector<unsigned char> decoded(10);
+  EXPECT_FALSE(decodeCostRuns({1, 2}, {5}, decoded.data(), decoded.size()));
+  EXPECT_FALSE(decodeCostRuns({1, 2}, {5, 4}, decoded.data(), decoded.size()));
+  EXPECT_FALSE(decodeCostRuns({1, 2}, {5, 6}, decoded.data(), decoded.size()));
+  EXPECT_TRUE(decodeCostRuns({1, 2}, {5, 5}, decoded.data(), decoded.size()));
+}
+
+TEST(CostmapCompression, roundTripsWords)
+{
+  // Unknown 16 level voxel columns with a few marked ones
+  std::vector<uint32_t> words(5000, 0x0000ffff);
+  words[10] = 0x00010000;
+  words[4000] = 0xffff0000;
+
+  std::vector<uint32_t> values;
+  std::vector<uint32_t> lengths;
+  encodeWordRuns(words.data(), words.size(), values, lengths);
+  EXPECT_EQ(values.size(), 5u);
+
+  std::vector<uint32_t> decoded(words.size());
+  EXPECT_TRUE(decodeWordRuns(values, lengths, decoded.data(), decoded.size()));
+  EXPECT_EQ(decoded, words);
+  EXPECT_FALSE(decodeWordRuns(values, lengths, decoded.data(), decoded.size() - 1));
+}
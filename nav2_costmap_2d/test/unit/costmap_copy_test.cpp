@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+TEST(CostmapCopy, copyMatchesSource)
+{
+  nav2_costmap_2d::Costmap2D source(10, 20, 0.05, 1.0, -2.0);
+  source.setCost(3, 7, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  nav2_costmap_2d::Costmap2D copy(source);
+  EXPECT_EQ(copy.getSizeInCellsX(), 10u);
+  EXPECT_EQ(copy.getSizeInCellsY(), 20u);
+  EXPECT_DOUBLE_EQ(copy.getResolution(), 0.05);
+  EXPECT_DOUBLE_EQ(copy.getOriginX(), 1.0);
+  EXPECT_DOUBLE_EQ(copy.getOriginY(), -2.0);
+  EXPECT_EQ(copy.getCost(3, 7), nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(copy.getCost(0, 0), nav2_costmap_2d::FREE_SPACE);
+}
+
+TEST(CostmapCopy, assignmentReusesBufferWhenSizeMatches)
+{
+  nav2_costmap_2d::Costmap2D source(10, 20, 0.05, 0.0, 0.0);
+  nav2_costmap_2d::Costmap2D target(10, 20, 0.1, 5.0, 5.0);
+  const unsigned char * buffer = target.getCharMap();
+
+  source.setCost(9, 19, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  target = source;
+  EXPECT_EQ(target.getCharMap(), buffer);
+  EXPECT_EQ(target.getCost(9, 19), nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  EXPECT_DOUBLE_EQ(target.getResolution(), 0.05);
+  EXPECT_DOUBLE_EQ(target.getOriginX(), 0.0);
+
+  // A different size still has to reallocate
+  nav2_costmap_2d::Costmap2D larger(30, 30, 0.05, 0.0, 0.0);
+  larger.setCost(29, 29, nav2_costmap_2d::LETHAL_OBSTACLE);
+  target = larger;
+  EXPECT_EQ(target.getSizeInCellsX(), 30u);
+  EXPECT_EQ(target.getCost(29, 29), nav2_costmap_2d::LETHAL_OBSTACLE);
+}
+
+TEST(CostmapCopy, updateOriginShiftsCellsInPlace)
+{
+  const unsigned int size_x = 7, size_y = 5;
+  const int shifts[][2] = {{0, 0}, {2, 1}, {-3, 2}, {1, -4}, {-6, -1}, {7, 0}, {0, -5}};
+  for (const auto & shift : shifts) {
+    nav2_costmap_2d::Costmap2D costmap(
+      size_x, size_y, 0.5, 0.0, 0.0, nav2_costmap_2d::NO_INFORMATION);
+    const unsigned char * buffer = costmap.getCharMap();
+    for (unsigned int j = 0; j < size_y; j++) {
+      for (unsigned int i = 0; i < size_x; i++) {
+        costmap.setCost(i, j, j * size_x + i);
+      }
+    }
+
+    costmap.updateOrigin(shift[0] * 0.5, shift[1] * 0.5);
+    EXPECT_EQ(costmap.getCharMap(), buffer);
+    EXPECT_DOUBLE_EQ(costmap.getOriginX(), shift[0] * 0.5);
+    EXPECT_DOUBLE_EQ(costmap.getOriginY(), shift[1] * 0.5);
+    for (int j = 0; j < static_cast<int>(size_y); j++) {
+      for (int i = 0; i < static_cast<int>(size_x); i++) {
+        const int old_i = i + shift[0], old_j = j + shift[1];
+        const bool kept = old_i >= 0 && old_i < static_cast<int>(size_x) &&
+          old_j >= 0 && old_j < static_cast<int>(size_y);
+        const unsigned char expected =
+          kept ? old_j * size_x + old_i : nav2_costmap_2d::NO_INFORMATION;
+        EXPECT_EQ(costmap.getCost(i, j), expected);
+      }
+    }
+  }
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::LayeredCostmap;
+
+namespace
+{
+
+/**
+ * Copies its own grid into the master grid, reporting the window changed since
+ * the last update as its bounds
+ */
+class WindowLayer : public nav2_costmap_2d::Layer
+{
+public:
+  explicit WindowLayer(LayeredCostmap * layers)
+  : layers_(layers) {}
+
+  void reset() override {}
+
+  void updateBounds(
+    double, double, double, double * min_x, double * min_y, double * max_x,
+    double * max_y) override
+  {
+    if (xn_ <= x0_) {
+      return;
+    }
+    Costmap2D * master = layers_->getCostmap();
+    double wx, wy;
+    master->mapToWorld(x0_, y0_, wx, wy);
+    *min_x = std::min(*min_x, wx);
+    *min_y = std::min(*min_y, wy);
+    master->mapToWorld(xn_ - 1, yn_ - 1, wx, wy);
+    *max_x = std::max(*max_x, wx);
+    *max_y = std::max(*max_y, wy);
+  }
+
+  void updateCosts(Costmap2D & master_grid, int min_i, int min_j, int max_i, int max_j) override
+  {
+    for (int j = min_j; j < max_j; ++j) {
+      for (int i = min_i; i < max_i; ++i) {
+        master_grid.setCost(i, j, costs_[j * master_grid.getSizeInCellsX() + i]);
+      }
+    }
+    x0_ = xn_ = 0;
+  }
+
+  /** Fill a random window of the grid with random costs */
+  void change(std::mt19937 & rng)
+  {
+    const unsigned int size_x = layers_->getCostmap()->getSizeInCellsX();
+    const unsigned int size_y = layers_->getCostmap()->getSizeInCellsY();
+    costs_.resize(size_x * size_y, 0);
+    x0_ = rng() % size_x;
+    y0_ = rng() % size_y;
+    xn_ = x0_ + 1 + rng() % (size_x - x0_);
+    yn_ = y0_ + 1 + rng() % (size_y - y0_);
+    for (unsigned int j = y0_; j < yn_; ++j) {
+      for (unsigned int i = x0_; i < xn_; ++i) {
+        costs_[j * size_x + i] = rng() % 256;
+      }
+    }
+  }
+
+private:
+  LayeredCostmap * layers_;
+  std::vector<unsigned char> costs_;
+  unsigned int x0_{0}, y0_{0}, xn_{0}, yn_{0};
+};
+
+void expectPooled(LayeredCostmap & layers)
+{
+  Costmap2D * master = layers.getPyramidLevel(0);
+  for (unsigned int level = 1; level <= layers.getPyramidLevels(); ++level) {
+    Costmap2D * coarse = layers.getPyramidLevel(level);
+    const unsigned int factor = 1u << level;
+    ASSERT_EQ(coarse->getSizeInCellsX(), (master->getSizeInCellsX() + factor - 1) / factor);
+    ASSERT_EQ(coarse->getSizeInCellsY(), (master->getSizeInCellsY() + factor - 1) / factor);
+    EXPECT_DOUBLE_EQ(coarse->getResolution(), master->getResolution() * factor);
+    EXPECT_DOUBLE_EQ(coarse->getOriginX(), master->getOriginX());
+    EXPECT_DOUBLE_EQ(coarse->getOriginY(), master->getOriginY());
+    for (unsigned int j = 0; j < coarse->getSizeInCellsY(); ++j) {
+      for (unsigned int i = 0; i < coarse->getSizeInCellsX(); ++i) {
+        unsigned char expected = 0;
+        for (unsigned int y = j * factor;
+          y < std::min(master->getSizeInCellsY(), (j + 1) * factor); ++y)
+        {
+          for (unsigned int x = i * factor;
+            x < std::min(master->getSizeInCellsX(), (i + 1) * factor); ++x)
+          {
+            expected = std::max(expected, master->getCost(x, y));
+          }
+        }
+        ASSERT_EQ(coarse->getCost(i, j), expected) << "level " << level;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(CostmapPyramid, PoolsTheUpdatedBounds)
+{
+  LayeredCostmap layers("frame", false, false);
+  layers.resizeMap(37, 21, 0.5, 1.0, 2.0);
+  auto layer = std::make_shared<WindowLayer>(&layers);
+  layers.addPlugin(layer);
+  layers.setPyramidLevels(3);
+
+  EXPECT_EQ(layers.getPyramidLevels(), 3u);
+  EXPECT_EQ(layers.getPyramidLevel(0), layers.getCostmap());
+  EXPECT_EQ(layers.getPyramidLevel(4), nullptr);
+
+  std::mt19937 rng(11);
+  for (int cycle = 0; cycle < 20; ++cycle) {
+    layer->change(rng);
+    layers.updateMap(10.0, 7.0, 0.0);
+    expectPooled(layers);
+  }
+
+  // a resize rebuilds the levels in place
+  Costmap2D * level_2 = layers.getPyramidLevel(2);
+  layers.resizeMap(50, 9, 0.25, 0.0, 0.0);
+  EXPECT_EQ(layers.getPyramidLevel(2), level_2);
+  layer->change(rng);
+  layers.updateMap(5.0, 1.0, 0.0);
+  expectPooled(layers);
+
+  layers.setPyramidLevels(0);
+  EXPECT_EQ(layers.getPyramidLevel(1), nullptr);
+}
+
+TEST(CostmapPyramid, FollowsARollingWindow)
+{
+  LayeredCostmap layers("frame", true, false);
+  layers.resizeMap(30, 30, 1.0, 0.0, 0.0);
+  auto layer = std::make_shared<WindowLayer>(&layers);
+  layers.addPlugin(layer);
+  layers.setPyramidLevels(2);
+
+  std::mt19937 rng(4);
+  for (int cycle = 0; cycle < 10; ++cycle) {
+    layer->change(rng);
+    layers.updateMap(15.0 + cycle * 1.7, 15.0 - cycle * 0.6, 0.0);
+    expectPooled(layers);
+  }
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_window.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::CostmapWindow;
+
+namespace
+{
+
+// A 20 x 10 map at 0.5 m from (1, 2), each cell's cost encoding its coordinates
+std::shared_ptr<Costmap2D> makeMap()
+{
+  auto map = std::make_shared<Costmap2D>(20, 10, 0.5, 1.0, 2.0);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      map->setCost(x, y, static_cast<unsigned char>(y * 20 + x));
+    }
+  }
+  return map;
+}
+
+}  // namespace
+
+TEST(CostmapWindow, sharesTheCellsOfAWindowInside)
+{
+  std::shared_ptr<Costmap2D> map = makeMap();
+  CostmapWindow window;
+  // Cell (8, 5) is at the centre
+  EXPECT_TRUE(window.update(map, 5.2, 4.7, 6, 4));
+  EXPECT_TRUE(window.isView());
+  EXPECT_EQ(window.getOffsetX(), 5);
+  EXPECT_EQ(window.getOffsetY(), 3);
+  EXPECT_EQ(window.stride(), 20u);
+  EXPECT_EQ(window.row(0), map->getCharMap() + 3 * 20 + 5);
+  EXPECT_DOUBLE_EQ(window.getOriginX(), 3.5);
+  EXPECT_DOUBLE_EQ(window.getOriginY(), 3.5);
+  for (unsigned int y = 0; y < 4; ++y) {
+    for (unsigned int x = 0; x < 6; ++x) {
+      EXPECT_EQ(window.getCost(x, y), map->getCost(x + 5, y + 3));
+    }
+  }
+
+  unsigned int mx, my;
+  ASSERT_TRUE(window.worldToMap(5.2, 4.7, mx, my));
+  EXPECT_EQ(mx, 3u);
+  EXPECT_EQ(my, 2u);
+  EXPECT_FALSE(window.worldToMap(3.4, 4.0, mx, my));
+  double wx, wy;
+  window.mapToWorld(mx, my, wx, wy);
+  EXPECT_DOUBLE_EQ(wx, 5.25);
+  EXPECT_DOUBLE_EQ(wy, 4.75);
+}
+
+TEST(CostmapWindow, copiesAWindowPastTheEdges)
+{
+  std::shared_ptr<Costmap2D> map = makeMap();
+  CostmapWindow window;
+  // Centred on cell (0, 9), the window starts at (-3, 7)
+  EXPECT_FALSE(window.update(map, 1.1, 6.9, 6, 4, 255));
+  EXPECT_FALSE(window.isView());
+  EXPECT_EQ(window.getOffsetX(), -3);
+  EXPECT_EQ(window.getOffsetY(), 7);
+  EXPECT_EQ(window.stride(), 6u);
+  for (unsigned int y = 0; y < 4; ++y) {
+    for (unsigned int x = 0; x < 6; ++x) {
+      const int sx = static_cast<int>(x) - 3, sy = static_cast<int>(y) + 7;
+      const unsigned char expected = sx >= 0 && sy < 10 ? map->getCost(sx, sy) : 255;
+      EXPECT_EQ(window.getCost(x, y), expected);
+    }
+  }
+
+  // The buffer is reused, and a window entirely off the map is all fill
+  const unsigned char * buffer = window.row(0);
+  EXPECT_FALSE(window.update(map, -10.0, -10.0, 6, 4, 7));
+  EXPECT_EQ(window.row(0), buffer);
+  EXPECT_EQ(window.getCost(5, 3), 7);
+}
+
+TEST(CostmapWindow, keepsTheSnapshotUntilReset)
+{
+  std::weak_ptr<Costmap2D> weak;
+  CostmapWindow window;
+  {
+    std::shared_ptr<Costmap2D> map = makeMap();
+    weak = map;
+    window.update(map, 5.0, 4.5, 4, 4);
+  }
+  EXPECT_FALSE(weak.expired());
+  window.reset();
+  EXPECT_TRUE(weak.expired());
+  EXPECT_FALSE(window.isView());
+}
+
+TEST(CostmapWindow, copiesIntoACostmap)
+{
+  std::shared_ptr<Costmap2D> map = makeMap();
+  CostmapWindow window;
+  window.update(map, 5.2, 4.7, 6, 4);
+  Costmap2D copy;
+  window.copyTo(copy);
+  EXPECT_EQ(copy.getSizeInCellsX(), 6u);
+  EXPECT_EQ(copy.getSizeInCellsY(), 4u);
+  EXPECT_DOUBLE_EQ(copy.getOriginX(), 3.5);
+  for (unsigned int y = 0; y < 4; ++y) {
+    for (unsigned int x = 0; x < 6; ++x) {
+      EXPECT_EQ(copy.getCost(x, y), window.getCost(x, y));
+    }
+  }
+
+  // The same geometry again is copied in place
+  const unsigned char * cells = copy.getCharMap();
+  window.update(map, 5.2, 4.7, 6, 4);
+  window.copyTo(copy);
+  EXPECT_EQ(copy.getCharMap(), cells);
+}
+
+TEST(CostmapWindow, copyCostmapWindowKeepsTheMapOnFailure)
+{
+  std::shared_ptr<Costmap2D> map = makeMap();
+  Costmap2D copy;
+  ASSERT_TRUE(copy.copyCostmapWindow(*map, 2.0, 3.0, 3.0, 2.0));
+  const unsigned char * cells = copy.getCharMap();
+  EXPECT_EQ(copy.getSizeInCellsX(), 6u);
+  EXPECT_EQ(copy.getCost(0, 0), map->getCost(2, 2));
+
+  EXPECT_FALSE(copy.copyCostmapWindow(*map, 0.0, 0.0, 3.0, 2.0));
+  EXPECT_EQ(copy.getCharMap(), cells);
+  EXPECT_EQ(copy.getSizeInCellsX(), 6u);
+
+  // Windows of the same size reuse the buffer
+  ASSERT_TRUE(copy.copyCostmapWindow(*map, 4.0, 3.0, 3.0, 2.0));
+  EXPECT_EQ(copy.getCharMap(), cells);
+  EXPECT_EQ(copy.getCost(0, 0), map->getCost(6, 2));
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/dirty_region_set.hpp"
+
+using nav2_costmap_2d::DirtyRegionSet;
+
+namespace
+{
+
+bool covered(const DirtyRegionSet & set, unsigned int x, unsigned int y)
+{
+  for (const auto & r : set.regions()) {
+    if (x >= r.x0 && x < r.xn && y >= r.y0 && y < r.yn) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(DirtyRegionSet, ignoresEmptyWindows)
+{
+  DirtyRegionSet set;
+  set.add(5, 5, 0, 10);
+  set.add(0, 10, 7, 3);
+  EXPECT_TRUE(set.empty());
+}
+
+TEST(DirtyRegionSet, keepsDistantWindowsApart)
+{
+  DirtyRegionSet set(4);
+  set.add(0, 10, 0, 10);
+  set.add(1000, 1010, 1000, 1010);
+  ASSERT_EQ(set.regions().size(), 2u);
+  EXPECT_EQ(set.regions()[0].area() + set.regions()[1].area(), 200u);
+}
+
+TEST(DirtyRegionSet, mergesOverlappingWindows)
+{
+  DirtyRegionSet set;
+  set.add(0, 10, 0, 10);
+  set.add(20, 30, 0, 10);
+  // Bridges the two windows above, so all three collapse into one
+  set.add(5, 25, 5, 8);
+  ASSERT_EQ(set.regions().size(), 1u);
+  const auto & r = set.regions()[0];
+  EXPECT_EQ(r.x0, 0u);
+  EXPECT_EQ(r.xn, 30u);
+  EXPECT_EQ(r.y0, 0u);
+  EXPECT_EQ(r.yn, 10u);
+}
+
+TEST(DirtyRegionSet, boundsRegionCountAndKeepsCoverage)
+{
+  DirtyRegionSet set(3);
+  std::vector<std::vector<unsigned int>> windows = {
+    {0, 4, 0, 4}, {100, 104, 0, 4}, {0, 4, 100, 104}, {100, 104, 100, 104}, {10, 14, 0, 4}};
+  for (const auto & w : windows) {
+    set.add(w[0], w[1], w[2], w[3]);
+    EXPECT_LE(set.regions().size(), 3u);
+  }
+
+  for (const auto & w : windows) {
+    for (unsigned int y = w[2]; y < w[3]; ++y) {
+      for (unsigned int x = w[0]; x < w[1]; ++x) {
+        EXPECT_TRUE(covered(set, x, y));
+      }
+    }
+  }
+
+  // The two windows closest together are the cheapest to merge
+  EXPECT_TRUE(covered(set, 7, 2));
+  EXPECT_FALSE(covered(set, 50, 50));
+
+  set.setMaxRegions(1);
+  ASSERT_EQ(set.regions().size(), 1u);
+  EXPECT_EQ(set.regions()[0].area(), 104u * 104u);
+
+  set.clear();
+  EXPECT_TRUE(set.empty());
+}
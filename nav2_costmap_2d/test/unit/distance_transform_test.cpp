@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/distance_transform.hpp"
+
+using nav2_costmap_2d::DISTANCE_TRANSFORM_INF;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_costmap_2d::NO_INFORMATION;
+
+namespace
+{
+
+std::vector<float> bruteForce(
+  const std::vector<unsigned char> & costs, unsigned int size_x,
+  unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y,
+  bool unknown_is_obstacle)
+{
+  const unsigned int width = max_x - min_x;
+  std::vector<float> result(width * (max_y - min_y), DISTANCE_TRANSFORM_INF);
+  for (unsigned int y = min_y; y < max_y; ++y) {
+    for (unsigned int x = min_x; x < max_x; ++x) {
+      const unsigned char cost = costs[y * size_x + x];
+      if (cost != LETHAL_OBSTACLE && !(unknown_is_obstacle && cost == NO_INFORMATION)) {
+        continue;
+      }
+      for (unsigned int j = min_y; j < max_y; ++j) {
+        for (unsigned int i = min_x; i < max_x; ++i) {
+          const float dx = static_cast<float>(i) - x;
+          const float dy = static_cast<float>(j) - y;
+          float & d = result[(j - min_y) * width + (i - min_x)];
+          d = std::min(d, dx * dx + dy * dy);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(DistanceTransform, matchesBruteForce)
+{
+  const unsigned int size_x = 61, size_y = 47;
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> cell(0, 99);
+  std::vector<unsigned char> costs(size_x * size_y, 0);
+  for (auto & cost : costs) {
+    const int r = cell(gen);
+    cost = r < 3 ? LETHAL_OBSTACLE : (r < 5 ? NO_INFORMATION : static_cast<unsigned char>(r));
+  }
+
+  nav2_util::ThreadPool pool(3);
+  for (nav2_util::ThreadPool * p : {static_cast<nav2_util::ThreadPool *>(nullptr), &pool}) {
+    for (bool unknown_is_obstacle : {false, true}) {
+      // Whole grid and an interior window
+      for (unsigned int w = 0; w < 2; ++w) {
+        const unsigned int min_x = w ? 7 : 0, min_y = w ? 5 : 0;
+        const unsigned int max_x = w ? 40 : size_x, max_y = w ? 44 : size_y;
+        std::vector<float> result((max_x - min_x) * (max_y - min_y));
+        nav2_costmap_2d::squaredDistanceTransform(
+          costs.data(), size_x, min_x, min_y, max_x, max_y, unknown_is_obstacle,
+          result.data(), p);
+        EXPECT_EQ(
+          result, bruteForce(costs, size_x, min_x, min_y, max_x, max_y, unknown_is_obstacle));
+      }
+    }
+  }
+}
+
+TEST(DistanceTransform, emptyAndSingleObstacle)
+{
+  const unsigned int size_x = 20, size_y = 10;
+  std::vector<unsigned char> costs(size_x * size_y, 0);
+  std::vector<float> result(size_x * size_y);
+
+  nav2_costmap_2d::squaredDistanceTransform(
+    costs.data(), size_x, 0, 0, size_x, size_y, false, result.data());
+  for (float d : result) {
+    EXPECT_EQ(d, DISTANCE_TRANSFORM_INF);
+  }
+
+  costs[4 * size_x + 15] = LETHAL_OBSTACLE;
+  nav2_costmap_2d::squaredDistanceTransform(
+    costs.data(), size_x, 0, 0, size_x, size_y, false, result.data());
+  EXPECT_EQ(result[4 * size_x + 15], 0.0f);
+  EXPECT_EQ(result[4 * size_x + 12], 9.0f);
+  EXPECT_EQ(result[0], 15.0f * 15.0f + 4.0f * 4.0f);
+  EXPECT_EQ(result[9 * size_x + 19], 4.0f * 4.0f + 5.0f * 5.0f);
+}
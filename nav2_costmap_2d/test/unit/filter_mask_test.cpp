@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/filter_mask.hpp"
+
+using nav2_costmap_2d::FilterMask;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_costmap_2d::FREE_SPACE;
+
+namespace
+{
+
+nav_msgs::msg::OccupancyGrid makeMask()
+{
+  nav_msgs::msg::OccupancyGrid mask;
+  mask.header.frame_id = "map";
+  mask.info.resolution = 0.1;
+  mask.info.width = 20;
+  mask.info.height = 10;
+  mask.info.origin.position.x = -1.0;
+  mask.info.origin.position.y = -2.0;
+  mask.data.assign(200, 0);
+  for (unsigned int y = 3; y < 5; ++y) {
+    for (unsigned int x = 5; x < 8; ++x) {
+      mask.data[y * 20 + x] = 100;
+    }
+  }
+  mask.data[8 * 20 + 12] = 50;
+  mask.data[0] = -1;
+  return mask;
+}
+
+// Every master cell whose center is in a zone is lethal within the bounds, the others unchanged
+void expectKeepout(
+  const FilterMask & mask, const nav2_costmap_2d::Costmap2D & master,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  for (unsigned int j = 0; j < master.getSizeInCellsY(); ++j) {
+    for (unsigned int i = 0; i < master.getSizeInCellsX(); ++i) {
+      double wx, wy;
+      master.mapToWorld(i, j, wx, wy);
+      const bool inside = static_cast<int>(i) >= min_i && static_cast<int>(i) < max_i &&
+        static_cast<int>(j) >= min_j && static_cast<int>(j) < max_j;
+      const unsigned char expected =
+        inside && mask.valueAt(wx, wy) > 0 ? LETHAL_OBSTACLE : FREE_SPACE;
+      EXPECT_EQ(master.getCost(i, j), expected) << i << ", " << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(FilterMask, keepsTheBoundsOfTheCellsWithAnEffect)
+{
+  const FilterMask keepout(makeMask(), 100);
+  EXPECT_EQ(keepout.getFrame(), "map");
+  EXPECT_EQ(keepout.getSizeInCellsX(), 3u);
+  EXPECT_EQ(keepout.getSizeInCellsY(), 2u);
+  EXPECT_NEAR(keepout.getOriginX(), -0.5, 1e-6);
+  EXPECT_NEAR(keepout.getOriginY(), -1.7, 1e-6);
+  EXPECT_EQ(keepout.getMemoryUsage(), 6u);
+  EXPECT_EQ(keepout.valueAt(-0.45, -1.65), 100);
+  EXPECT_EQ(keepout.valueAt(-0.25, -1.55), 100);
+  EXPECT_EQ(keepout.valueAt(-0.55, -1.65), 0);
+  EXPECT_EQ(keepout.valueAt(0.25, -1.15), 0);
+
+  const FilterMask speed(makeMask(), 1);
+  EXPECT_EQ(speed.getSizeInCellsX(), 8u);
+  EXPECT_EQ(speed.getSizeInCellsY(), 6u);
+  EXPECT_EQ(speed.valueAt(0.25, -1.15), 50);
+  EXPECT_EQ(speed.valueAt(-0.05, -1.15), 0);
+  EXPECT_EQ(speed.valueAt(-0.95, -1.95), 0);
+
+  nav_msgs::msg::OccupancyGrid free = makeMask();
+  free.data.assign(200, 0);
+  EXPECT_TRUE(FilterMask(free, 1).empty());
+  EXPECT_EQ(FilterMask(free, 1).valueAt(0.0, 0.0), 0);
+}
+
+TEST(FilterMask, appliesAlignedRasterWithinBounds)
+{
+  const FilterMask keepout(makeMask(), 1);
+  nav2_costmap_2d::Costmap2D master(30, 30, 0.1, -1.5, -2.5);
+  const auto raster = nav2_costmap_2d::rasterizeMask(
+    keepout, 0.1, master.getOriginX(), master.getOriginY(), LETHAL_OBSTACLE);
+  EXPECT_EQ(raster.size_x, 8u);
+  EXPECT_EQ(raster.size_y, 6u);
+
+  ASSERT_TRUE(nav2_costmap_2d::applyMaskMax(raster, master, 0, 0, 30, 30));
+  expectKeepout(keepout, master, 0, 0, 30, 30);
+
+  nav2_costmap_2d::Costmap2D partial(30, 30, 0.1, -1.5, -2.5);
+  ASSERT_TRUE(nav2_costmap_2d::applyMaskMax(raster, partial, 11, 9, 15, 14));
+  expectKeepout(keepout, partial, 11, 9, 15, 14);
+
+  // A rolling window moved by whole cells keeps the raster in line
+  nav2_costmap_2d::Costmap2D moved(30, 30, 0.1, -1.5 + 0.3, -2.5 - 0.7);
+  ASSERT_TRUE(nav2_costmap_2d::applyMaskMax(raster, moved, 0, 0, 30, 30));
+  expectKeepout(keepout, moved, 0, 0, 30, 30);
+}
+
+TEST(FilterMask, resamplesOntoOtherGrids)
+{
+  const FilterMask keepout(makeMask(), 100);
+  const auto aligned = nav2_costmap_2d::rasterizeMask(keepout, 0.1, 0.0, 0.0, LETHAL_OBSTACLE);
+
+  // Offset by half a cell, and at another resolution
+  for (double resolution : {0.1, 0.05, 0.25}) {
+    nav2_costmap_2d::Costmap2D master(40, 40, resolution, -1.55, -2.55);
+    if (resolution == 0.1) {
+      EXPECT_FALSE(nav2_costmap_2d::applyMaskMax(aligned, master, 0, 0, 40, 40));
+    }
+    const auto raster = nav2_costmap_2d::rasterizeMask(
+      keepout, resolution, master.getOriginX(), master.getOriginY(), LETHAL_OBSTACLE);
+    ASSERT_TRUE(nav2_costmap_2d::applyMaskMax(raster, master, 0, 0, 40, 40));
+    expectKeepout(keepout, master, 0, 0, 40, 40);
+  }
+}
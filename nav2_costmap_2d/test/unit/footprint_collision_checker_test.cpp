@@ -151,3 +151,230 @@ TEST(collision_footprint, test_point_and_line_cost)
   auto right_value = collision_checker.footprintCostAtPose(5.2, 5.0, 0.0, footprint);
   EXPECT_NEAR(right_value, 254.0, 0.001);
 }
+
+TEST(collision_footprint, test_footprint_mask_matches_exact_outline)
+{
+  std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap_ =
+    std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.1, 0, 0, 0);
+
+  for (unsigned int i = 0; i < 100; i += 3) {
+    for (unsigned int j = 0; j < 100; j += 7) {
+      costmap_->setCost(i, j, (i * 13 + j * 7) % 254);
+    }
+  }
+
+  geometry_msgs::msg::Point p1;
+  p1.x = -0.42;
+  p1.y = 0.31;
+  geometry_msgs::msg::Point p2;
+  p2.x = 0.53;
+  p2.y = 0.27;
+  geometry_msgs::msg::Point p3;
+  p3.x = 0.48;
+  p3.y = -0.36;
+  geometry_msgs::msg::Point p4;
+  p4.x = -0.39;
+  p4.y = -0.33;
+
+  nav2_costmap_2d::Footprint footprint = {p1, p2, p3, p4};
+
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker(costmap_);
+
+  // At cell centers and yaw bin centers the mask rasterizes the same outline
+  const unsigned int yaw_bins = 16;
+  for (unsigned int bin = 0; bin < yaw_bins; ++bin) {
+    double theta = 2.0 * M_PI * bin / yaw_bins;
+    for (double x = 2.05; x < 8.0; x += 0.7) {
+      for (double y = 2.05; y < 8.0; y += 0.9) {
+        EXPECT_NEAR(
+          collision_checker.footprintMaskCostAtPose(x, y, theta, footprint, yaw_bins),
+          collision_checker.footprintCostAtPose(x, y, theta, footprint), 0.001);
+      }
+    }
+  }
+}
+
+TEST(collision_footprint, test_footprint_mask_filled_and_off_map)
+{
+  std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap_ =
+    std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.1, 0, 0, 0);
+
+  costmap_->setCost(50, 50, 254);
+
+  geometry_msgs::msg::Point p1;
+  p1.x = -1.0;
+  p1.y = 1.0;
+  geometry_msgs::msg::Point p2;
+  p2.x = 1.0;
+  p2.y = 1.0;
+  geometry_msgs::msg::Point p3;
+  p3.x = 1.0;
+  p3.y = -1.0;
+  geometry_msgs::msg::Point p4;
+  p4.x = -1.0;
+  p4.y = -1.0;
+
+  nav2_costmap_2d::Footprint footprint = {p1, p2, p3, p4};
+
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker(costmap_);
+
+  // The outline does not touch the obstacle in the middle, the filled mask does
+  EXPECT_NEAR(collision_checker.footprintMaskCostAtPose(5.05, 5.05, 0.3, footprint), 0.0, 0.001);
+  EXPECT_NEAR(
+    collision_checker.footprintMaskCostAtPose(5.05, 5.05, 0.3, footprint, 72, true),
+    254.0, 0.001);
+
+  // Footprint hanging over the map edge is lethal
+  EXPECT_NEAR(
+    collision_checker.footprintMaskCostAtPose(0.5, 5.0, 0.0, footprint), 254.0, 0.001);
+  EXPECT_NEAR(
+    collision_checker.footprintMaskCostAtPose(9.5, 5.0, 0.0, footprint), 254.0, 0.001);
+}
+
+TEST(collision_footprint, test_footprint_costs_at_poses)
+{
+  std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap_ =
+    std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.1, 0, 0, 0);
+
+  for (unsigned int j = 0; j < 100; ++j) {
+    costmap_->setCost(80, j, 254);
+    costmap_->setCost(j, 30 + j % 5, 100);
+  }
+
+  geometry_msgs::msg::Point p1;
+  p1.x = -0.3;
+  p1.y = 0.2;
+  geometry_msgs::msg::Point p2;
+  p2.x = 0.3;
+  p2.y = 0.2;
+  geometry_msgs::msg::Point p3;
+  p3.x = 0.3;
+  p3.y = -0.2;
+  geometry_msgs::msg::Point p4;
+  p4.x = -0.3;
+  p4.y = -0.2;
+
+  nav2_costmap_2d::Footprint footprint = {p1, p2, p3, p4};
+
+  // A trajectory driving into the wall at x = 8.0
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  for (unsigned int i = 0; i < 100; ++i) {
+    geometry_msgs::msg::Pose2D pose;
+    pose.x = 1.0 + 0.08 * i;
+    pose.y = 3.0 + 0.01 * i;
+    pose.theta = 0.05 * i;
+    poses.push_back(pose);
+  }
+
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker(costmap_);
+
+  std::vector<double> costs;
+  std::size_t first_lethal = collision_checker.footprintCostsAtPoses(poses, footprint, costs);
+  ASSERT_EQ(costs.size(), poses.size());
+  ASSERT_LT(first_lethal, poses.size());
+  for (std::size_t i = 0; i < poses.size(); ++i) {
+    double expected = collision_checker.footprintCostAtPose(
+      poses[i].x, poses[i].y, poses[i].theta, footprint);
+    EXPECT_NEAR(costs[i], expected, 0.001);
+    if (i < first_lethal) {
+      EXPECT_LT(costs[i], 254.0);
+    }
+  }
+  EXPECT_NEAR(costs[first_lethal], 254.0, 0.001);
+
+  // Early exit leaves the remaining poses unscored, also when run on a pool
+  nav2_util::ThreadPool pool(4);
+  for (nav2_util::ThreadPool * p : {static_cast<nav2_util::ThreadPool *>(nullptr), &pool}) {
+    std::vector<double> early_costs;
+    EXPECT_EQ(
+      collision_checker.footprintCostsAtPoses(poses, footprint, early_costs, true, 0, p),
+      first_lethal);
+    for (std::size_t i = 0; i < poses.size(); ++i) {
+      EXPECT_NEAR(early_costs[i], i <= first_lethal ? costs[i] : -1.0, 0.001);
+    }
+  }
+
+  // Mask scoring agrees with the single pose mask check
+  std::vector<double> mask_costs;
+  collision_checker.footprintCostsAtPoses(poses, footprint, mask_costs, false, 36, &pool);
+  for (std::size_t i = 0; i < poses.size(); ++i) {
+    EXPECT_NEAR(
+      mask_costs[i], collision_checker.footprintMaskCostAtPose(
+        poses[i].x, poses[i].y, poses[i].theta, footprint, 36), 0.001);
+  }
+}
+
+TEST(collision_footprint, test_compact_footprint)
+{
+  std::shared_ptr<nav2_costmap_2d::Costmap2D> costmap_ =
+    std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.1, 0, 0, 0);
+
+  for (unsigned int i = 0; i < 100; i += 3) {
+    for (unsigned int j = 0; j < 100; j += 5) {
+      costmap_->setCost(i, j, (i * 11 + j * 3) % 254);
+    }
+  }
+
+  geometry_msgs::msg::Point p1;
+  p1.x = -0.4;
+  p1.y = 0.3;
+  geometry_msgs::msg::Point p2;
+  p2.x = 0.5;
+  p2.y = 0.2;
+  geometry_msgs::msg::Point p3;
+  p3.x = 0.45;
+  p3.y = -0.35;
+  geometry_msgs::msg::Point p4;
+  p4.x = -0.38;
+  p4.y = -0.3;
+
+  nav2_costmap_2d::Footprint footprint = {p1, p2, p3, p4};
+  nav2_costmap_2d::CompactFootprint compact(footprint);
+  ASSERT_EQ(compact.size(), footprint.size());
+  EXPECT_TRUE(compact.matches(footprint));
+  EXPECT_FALSE(compact.matches({p1, p2, p3}));
+
+  double min_dist, max_dist;
+  nav2_costmap_2d::calculateMinAndMaxDistances(footprint, min_dist, max_dist);
+  EXPECT_DOUBLE_EQ(compact.getInscribedRadius(), min_dist);
+  EXPECT_DOUBLE_EQ(compact.getCircumscribedRadius(), max_dist);
+
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  for (unsigned int i = 0; i < 20; ++i) {
+    geometry_msgs::msg::Pose2D pose;
+    pose.x = 2.0 + 0.3 * i;
+    pose.y = 7.0 - 0.25 * i;
+    pose.theta = 0.4 * i;
+    poses.push_back(pose);
+  }
+
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker(costmap_);
+
+  std::vector<double> batch_x(poses.size() * compact.size());
+  std::vector<double> batch_y(batch_x.size());
+  compact.transform(poses.data(), poses.size(), batch_x.data(), batch_y.data());
+  std::vector<double> out_x(compact.size()), out_y(compact.size());
+  std::vector<geometry_msgs::msg::Point> oriented, compact_oriented;
+  for (std::size_t p = 0; p < poses.size(); ++p) {
+    const geometry_msgs::msg::Pose2D & pose = poses[p];
+    nav2_costmap_2d::transformFootprint(pose.x, pose.y, pose.theta, footprint, oriented);
+    compact.transform(pose.x, pose.y, pose.theta, out_x.data(), out_y.data());
+    compact.transform(pose.x, pose.y, pose.theta, compact_oriented);
+    ASSERT_EQ(compact_oriented.size(), oriented.size());
+    for (std::size_t i = 0; i < oriented.size(); ++i) {
+      EXPECT_NEAR(out_x[i], oriented[i].x, 1e-9);
+      EXPECT_NEAR(out_y[i], oriented[i].y, 1e-9);
+      EXPECT_NEAR(batch_x[p * compact.size() + i], oriented[i].x, 1e-9);
+      EXPECT_NEAR(batch_y[p * compact.size() + i], oriented[i].y, 1e-9);
+      EXPECT_NEAR(compact_oriented[i].x, oriented[i].x, 1e-9);
+      EXPECT_NEAR(compact_oriented[i].y, oriented[i].y, 1e-9);
+    }
+
+    EXPECT_NEAR(
+      collision_checker.footprintCostAtPose(pose.x, pose.y, pose.theta, compact),
+      collision_checker.footprintCostAtPose(pose.x, pose.y, pose.theta, footprint), 0.001);
+  }
+
+  // Hanging over the map edge is lethal for both
+  EXPECT_NEAR(collision_checker.footprintCostAtPose(0.1, 5.0, 0.0, compact), 254.0, 0.001);
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/footprint_collision_checker.hpp"
+#include "nav2_costmap_2d/footprint_sweep.hpp"
+
+using nav2_costmap_2d::FootprintSweep;
+
+namespace
+{
+
+std::vector<geometry_msgs::msg::Point> rectangle(double half_x, double half_y)
+{
+  std::vector<geometry_msgs::msg::Point> footprint(4);
+  footprint[0].x = half_x;
+  footprint[0].y = half_y;
+  footprint[1].x = -half_x;
+  footprint[1].y = half_y;
+  footprint[2].x = -half_x;
+  footprint[2].y = -half_y;
+  footprint[3].x = half_x;
+  footprint[3].y = -half_y;
+  return footprint;
+}
+
+std::vector<geometry_msgs::msg::Pose2D> spin(double x, double y, double yaw, std::size_t steps)
+{
+  std::vector<geometry_msgs::msg::Pose2D> poses(steps + 1);
+  for (std::size_t i = 0; i <= steps; ++i) {
+    poses[i].x = x;
+    poses[i].y = y;
+    poses[i].theta = yaw * i / steps;
+  }
+  return poses;
+}
+
+// Collision flags per pose from the exact, per-pose footprint check
+std::vector<bool> expectedCollisions(
+  const std::shared_ptr<nav2_costmap_2d::Costmap2D> & costmap,
+  const std::vector<geometry_msgs::msg::Point> & footprint,
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  nav2_costmap_2d::FootprintCollisionChecker checker(costmap);
+  std::vector<bool> collisions;
+  for (const auto & pose : poses) {
+    collisions.push_back(
+      checker.footprintCostAtPose(pose.x, pose.y, pose.theta, footprint) >=
+      nav2_costmap_2d::LETHAL_OBSTACLE);
+  }
+  return collisions;
+}
+
+std::vector<bool> sweptCollisions(const FootprintSweep & sweep)
+{
+  std::vector<bool> collisions;
+  for (std::size_t i = 0; i < sweep.size(); ++i) {
+    collisions.push_back(sweep.firstCollision(i, i + 1) == i);
+  }
+  return collisions;
+}
+
+}  // namespace
+
+TEST(FootprintSweep, freeSpaceIsCollisionFree)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.05, 0.0, 0.0);
+  FootprintSweep sweep;
+  sweep.build(*costmap, rectangle(0.4, 0.3), spin(2.5, 2.5, M_PI, 30));
+
+  EXPECT_EQ(sweep.size(), 31u);
+  EXPECT_GT(sweep.cellCount(), 0u);
+  EXPECT_EQ(sweep.firstCollision(0, sweep.size()), sweep.size());
+}
+
+TEST(FootprintSweep, matchesPerPoseChecks)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.05, 0.0, 0.0);
+  costmap->setCost(60, 50, nav2_costmap_2d::LETHAL_OBSTACLE);
+  costmap->setCost(38, 64, nav2_costmap_2d::NO_INFORMATION);
+  costmap->setCost(50, 40, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+
+  const auto footprint = rectangle(0.45, 0.25);
+  const auto poses = spin(2.51, 2.49, 2.0 * M_PI, 60);
+  FootprintSweep sweep;
+  sweep.build(*costmap, footprint, poses);
+
+  const auto expected = expectedCollisions(costmap, footprint, poses);
+  EXPECT_EQ(sweptCollisions(sweep), expected);
+  EXPECT_LT(sweep.firstCollision(0, sweep.size()), sweep.size());
+}
+
+TEST(FootprintSweep, updatesOnlyChangedCells)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.05, 0.0, 0.0);
+  const auto footprint = rectangle(0.45, 0.25);
+  const auto poses = spin(2.5, 2.5, M_PI, 40);
+  FootprintSweep sweep;
+  sweep.build(*costmap, footprint, poses, 1);
+  EXPECT_EQ(sweep.version(), 1u);
+
+  costmap->setCost(59, 50, nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_TRUE(sweep.update(*costmap, 2));
+  EXPECT_EQ(sweep.version(), 2u);
+  EXPECT_EQ(sweptCollisions(sweep), expectedCollisions(costmap, footprint, poses));
+  EXPECT_LT(sweep.firstCollision(0, sweep.size()), sweep.size());
+
+  costmap->setCost(59, 50, nav2_costmap_2d::FREE_SPACE);
+  ASSERT_TRUE(sweep.update(*costmap, 3));
+  EXPECT_EQ(sweep.firstCollision(0, sweep.size()), sweep.size());
+}
+
+TEST(FootprintSweep, followsARollingCostmap)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.05, 0.0, 0.0);
+  costmap->setCost(60, 50, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  const auto footprint = rectangle(0.45, 0.25);
+  const auto poses = spin(2.5, 2.5, M_PI, 40);
+  FootprintSweep sweep;
+  sweep.build(*costmap, footprint, poses);
+  const auto before = sweptCollisions(sweep);
+
+  // Move the window by whole cells, the obstacle keeps its world position
+  costmap->updateOrigin(0.5, -0.25);
+  unsigned int mx, my;
+  ASSERT_TRUE(costmap->worldToMap(60 * 0.05 + 0.025, 50 * 0.05 + 0.025, mx, my));
+  costmap->setCost(mx, my, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  ASSERT_TRUE(sweep.update(*costmap));
+  EXPECT_EQ(sweptCollisions(sweep), before);
+  EXPECT_EQ(sweptCollisions(sweep), expectedCollisions(costmap, footprint, poses));
+
+  // A grid offset by a fraction of a cell, or with another resolution, cannot be followed
+  nav2_costmap_2d::Costmap2D offset(100, 100, 0.05, 0.01, 0.0);
+  EXPECT_FALSE(sweep.update(offset));
+  nav2_costmap_2d::Costmap2D coarser(50, 50, 0.1, 0.0, 0.0);
+  EXPECT_FALSE(sweep.update(coarser));
+}
+
+TEST(FootprintSweep, offMapCellsCollide)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(20, 20, 0.05, 0.0, 0.0);
+  FootprintSweep sweep;
+  sweep.build(*costmap, rectangle(0.45, 0.25), spin(0.5, 0.3, M_PI / 2.0, 10));
+
+  // At theta 0 the footprint fits on the map, once turned it sticks out below y = 0
+  EXPECT_EQ(sweep.firstCollision(0, 1), 1u);
+  EXPECT_LT(sweep.firstCollision(0, sweep.size()), sweep.size());
+}
+
+TEST(FootprintSweep, coversNearbyPoses)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2D>(100, 100, 0.05, 0.0, 0.0);
+  FootprintSweep sweep;
+  EXPECT_FALSE(sweep.covers(geometry_msgs::msg::Pose2D(), 0));
+
+  sweep.build(*costmap, rectangle(0.5, 0.0), spin(2.5, 2.5, M_PI, 10));
+
+  geometry_msgs::msg::Pose2D pose;
+  pose.x = 2.52;
+  pose.y = 2.49;
+  pose.theta = 0.05;
+  EXPECT_TRUE(sweep.covers(pose, 0));
+  EXPECT_FALSE(sweep.covers(pose, 5));
+  EXPECT_FALSE(sweep.covers(pose, 11));
+
+  pose.x = 2.6;
+  EXPECT_FALSE(sweep.covers(pose, 0));
+  pose.x = 2.5;
+  pose.theta = 0.2;
+  EXPECT_FALSE(sweep.covers(pose, 0));
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/grid_buffer_pool.hpp"
+
+using nav2_costmap_2d::GridBufferPool;
+
+TEST(GridBufferPool, sizeClassesCoverTheSizes)
+{
+  EXPECT_EQ(GridBufferPool::sizeClass(0), GridBufferPool::MIN_CLASS);
+  EXPECT_EQ(GridBufferPool::sizeClass(GridBufferPool::MIN_CLASS), GridBufferPool::MIN_CLASS);
+  EXPECT_EQ(GridBufferPool::sizeClass(4097), 5120u);
+  EXPECT_EQ(GridBufferPool::sizeClass(8192), 8192u);
+  for (std::size_t size = 1000; size < (std::size_t(1) << 30); size = size * 3 / 2 + 7) {
+    const std::size_t capacity = GridBufferPool::sizeClass(size);
+    EXPECT_GE(capacity, size);
+    // Four classes per doubling waste less than a third
+    EXPECT_LT(capacity, GridBufferPool::MIN_CLASS + size + size / 3);
+  }
+}
+
+TEST(GridBufferPool, recyclesBuffersOfTheSameClass)
+{
+  GridBufferPool pool;
+  std::size_t capacity;
+  unsigned char * buffer = pool.acquire(100000, capacity);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(capacity, GridBufferPool::sizeClass(100000));
+  pool.release(buffer, capacity);
+  EXPECT_EQ(pool.freeBytes(), capacity);
+
+  std::size_t other_capacity;
+  EXPECT_EQ(pool.acquire(capacity - 10, other_capacity), buffer);
+  EXPECT_EQ(other_capacity, capacity);
+  EXPECT_EQ(pool.freeBytes(), 0u);
+
+  // Another class allocates
+  std::size_t small_capacity;
+  unsigned char * small = pool.acquire(5000, small_capacity);
+  EXPECT_NE(small, buffer);
+  pool.release(small, small_capacity);
+  pool.release(buffer, capacity);
+}
+
+TEST(GridBufferPool, freesPastItsBound)
+{
+  GridBufferPool pool;
+  std::size_t a_capacity, b_capacity;
+  unsigned char * a = pool.acquire(100000, a_capacity);
+  unsigned char * b = pool.acquire(10000, b_capacity);
+  pool.setMaxFreeBytes(a_capacity);
+  pool.release(b, b_capacity);
+  // a no longer fits with b kept
+  pool.release(a, a_capacity);
+  EXPECT_EQ(pool.freeBytes(), b_capacity);
+
+  pool.setMaxFreeBytes(0);
+  EXPECT_EQ(pool.freeBytes(), 0u);
+}
+
+TEST(GridBufferPool, largeGridsAreHugePageAligned)
+{
+  GridBufferPool pool;
+  std::size_t capacity;
+  unsigned char * buffer = pool.acquire(GridBufferPool::HUGE_PAGE_THRESHOLD, capacity);
+#ifdef __linux__
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer) % GridBufferPool::HUGE_PAGE_SIZE, 0u);
+#endif
+  pool.setMaxFreeBytes(0);
+  pool.release(buffer, capacity);
+}
+
+TEST(GridBufferPool, costmapsKeepOrSwapTheirBuffers)
+{
+  nav2_costmap_2d::Costmap2D costmap(200, 200, 0.05, 0.0, 0.0, 3);
+  const unsigned char * cells = costmap.getCharMap();
+
+  // Smaller but not by half keeps the buffer, and still resets it
+  costmap.setCost(10, 10, 254);
+  costmap.resizeMap(180, 190, 0.05, 0.0, 0.0);
+  EXPECT_EQ(costmap.getCharMap(), cells);
+  for (unsigned int i = 0; i < 180 * 190; ++i) {
+    ASSERT_EQ(costmap.getCharMap()[i], 3);
+  }
+
+  // A map taking the released buffer's class gets it back
+  costmap.resizeMap(1000, 1000, 0.05, 0.0, 0.0);
+  nav2_costmap_2d::Costmap2D other(200, 200, 0.05, 0.0, 0.0, 0);
+  EXPECT_EQ(other.getCharMap(), cells);
+  EXPECT_EQ(other.getCost(199, 199), 0);
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/obstacle_marking.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::MarkedCells;
+using nav2_costmap_2d::Observation;
+
+namespace
+{
+
+// A cloud of x, y and z float32 fields followed by 4 bytes of padding
+sensor_msgs::msg::PointCloud2 makeCloud(const std::vector<std::array<float, 3>> & points)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  const char * names[] = {"x", "y", "z"};
+  for (uint32_t i = 0; i < 3; ++i) {
+    sensor_msgs::msg::PointField field;
+    field.name = names[i];
+    field.offset = 4 * i;
+    field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+    field.count = 1;
+    cloud.fields.push_back(field);
+  }
+  cloud.height = 1;
+  cloud.width = static_cast<uint32_t>(points.size());
+  cloud.point_step = 16;
+  cloud.row_step = cloud.width * cloud.point_step;
+  cloud.data.resize(cloud.row_step);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    memcpy(&cloud.data[i * cloud.point_step], points[i].data(), sizeof(points[i]));
+  }
+  return cloud;
+}
+
+}  // namespace
+
+TEST(ObstacleMarking, MatchesThePerPointTests)
+{
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> coordinate(-3.0f, 13.0f);
+  std::vector<std::array<float, 3>> points;
+  for (int i = 0; i < 2000; ++i) {
+    points.push_back({coordinate(random), coordinate(random), coordinate(random) * 0.25f});
+  }
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  points.push_back({5.0f, 5.0f, nan});
+  points.push_back({nan, 5.0f, 0.0f});
+  points.push_back({5.0f, nan, 0.0f});
+
+  geometry_msgs::msg::Point origin;
+  origin.x = 4.0;
+  origin.y = 5.0;
+  origin.z = 0.5;
+  Observation observation(origin, makeCloud(points), 6.0, 7.0);
+
+  Costmap2D costmap(200, 150, 0.05, -0.5, 0.25, nav2_costmap_2d::FREE_SPACE);
+  MarkedCells marked;
+  ASSERT_TRUE(nav2_costmap_2d::markObservation(observation, 2.0, costmap, marked));
+
+  // The loop ObstacleLayer::updateBounds() ran
+  Costmap2D expected(200, 150, 0.05, -0.5, 0.25, nav2_costmap_2d::FREE_SPACE);
+  MarkedCells expected_marked;
+  for (const auto & p : points) {
+    double px = p[0], py = p[1], pz = p[2];
+    if (pz > 2.0) {
+      continue;
+    }
+    double sq_dist = (px - origin.x) * (px - origin.x) + (py - origin.y) * (py - origin.y) +
+      (pz - origin.z) * (pz - origin.z);
+    if (sq_dist >= 36.0) {
+      continue;
+    }
+    unsigned int mx, my;
+    if (!expected.worldToMap(px, py, mx, my)) {
+      continue;
+    }
+    expected.setCost(mx, my, nav2_costmap_2d::LETHAL_OBSTACLE);
+    expected_marked.min_x = std::min(expected_marked.min_x, static_cast<int>(mx));
+    expected_marked.min_y = std::min(expected_marked.min_y, static_cast<int>(my));
+    expected_marked.max_x = std::max(expected_marked.max_x, static_cast<int>(mx));
+    expected_marked.max_y = std::max(expected_marked.max_y, static_cast<int>(my));
+  }
+
+  ASSERT_FALSE(expected_marked.empty());
+  EXPECT_EQ(marked.min_x, expected_marked.min_x);
+  EXPECT_EQ(marked.min_y, expected_marked.min_y);
+  EXPECT_EQ(marked.max_x, expected_marked.max_x);
+  EXPECT_EQ(marked.max_y, expected_marked.max_y);
+  EXPECT_EQ(memcmp(costmap.getCharMap(), expected.getCharMap(), 200 * 150), 0);
+}
+
+TEST(ObstacleMarking, RejectsCloudsWithoutCoordinates)
+{
+  sensor_msgs::msg::PointCloud2 cloud = makeCloud({{{1.0f, 1.0f, 0.0f}}});
+  cloud.fields[2].datatype = sensor_msgs::msg::PointField::FLOAT64;
+  geometry_msgs::msg::Point origin;
+  Observation observation(origin, cloud, 6.0, 7.0);
+
+  Costmap2D costmap(40, 40, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  MarkedCells marked;
+  EXPECT_FALSE(nav2_costmap_2d::markObservation(observation, 2.0, costmap, marked));
+  EXPECT_TRUE(marked.empty());
+}
+
+TEST(ObstacleMarking, RasterMatchesMarkingAndTracesRays)
+{
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> coordinate(-1.0f, 11.0f);
+  std::vector<std::array<float, 3>> points;
+  for (int i = 0; i < 500; ++i) {
+    points.push_back({coordinate(random), coordinate(random), 0.1f});
+  }
+  geometry_msgs::msg::Point origin;
+  origin.x = 4.0;
+  origin.y = 5.0;
+  Observation observation(origin, makeCloud(points), 3.0, 3.5);
+
+  Costmap2D costmap(200, 150, 0.05, -0.5, 0.25, nav2_costmap_2d::FREE_SPACE);
+  MarkedCells marked;
+  ASSERT_TRUE(nav2_costmap_2d::markObservation(observation, 2.0, costmap, marked));
+
+  const nav2_costmap_2d::RasterGeometry geometry = nav2_costmap_2d::RasterGeometry::of(costmap);
+  nav2_costmap_2d::ObservationRaster raster;
+  ASSERT_TRUE(
+    nav2_costmap_2d::rasterizeObservation(observation, 2.0, true, true, geometry, raster));
+  ASSERT_TRUE(raster.valid);
+
+  // The same cells as markObservation(), each once
+  std::vector<unsigned int> expected_marks;
+  for (unsigned int i = 0; i < 200 * 150; ++i) {
+    if (costmap.getCharMap()[i] == nav2_costmap_2d::LETHAL_OBSTACLE) {
+      expected_marks.push_back(i);
+    }
+  }
+  EXPECT_EQ(raster.marked, expected_marks);
+  EXPECT_EQ(raster.marked_bounds.min_x, marked.min_x);
+  EXPECT_EQ(raster.marked_bounds.max_y, marked.max_y);
+
+  // Rays start at the sensor's cell and stop at the raytrace range
+  unsigned int x0, y0;
+  ASSERT_TRUE(costmap.worldToMap(origin.x, origin.y, x0, y0));
+  EXPECT_TRUE(
+    std::binary_search(raster.cleared.begin(), raster.cleared.end(), costmap.getIndex(x0, y0)));
+  for (unsigned int cell : raster.cleared) {
+    const double dx = static_cast<double>(cell % 200) - x0;
+    const double dy = static_cast<double>(cell / 200) - y0;
+    EXPECT_LE(std::hypot(dx, dy), 3.5 / 0.05 + 1.5);
+  }
+}
+
+TEST(ObstacleMarking, RasterOfASingleRay)
+{
+  geometry_msgs::msg::Point origin;
+  origin.x = 0.52;
+  origin.y = 0.52;
+  Observation observation(origin, makeCloud({{{1.02f, 0.52f, 0.0f}}}), 2.0, 2.0);
+
+  Costmap2D costmap(40, 40, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::ObservationRaster raster;
+  ASSERT_TRUE(
+    nav2_costmap_2d::rasterizeObservation(
+      observation, 2.0, true, true, nav2_costmap_2d::RasterGeometry::of(costmap), raster));
+
+  std::vector<unsigned int> expected_clears;
+  for (unsigned int x = 10; x <= 20; ++x) {
+    expected_clears.push_back(costmap.getIndex(x, 10));
+  }
+  EXPECT_EQ(raster.cleared, expected_clears);
+  EXPECT_EQ(raster.marked, std::vector<unsigned int>{costmap.getIndex(20, 10)});
+
+  // A window rolled by whole cells maps the cells by an offset, a resized one not at all
+  nav2_costmap_2d::RasterGeometry rolled = raster.geometry;
+  rolled.origin_x += 0.15;
+  rolled.origin_y -= 0.05;
+  int dx = 0, dy = 0;
+  ASSERT_TRUE(raster.geometry.offsetTo(rolled, dx, dy));
+  EXPECT_EQ(dx, -3);
+  EXPECT_EQ(dy, 1);
+  nav2_costmap_2d::RasterGeometry resized = raster.geometry;
+  resized.size_x += 1;
+  EXPECT_FALSE(raster.geometry.offsetTo(resized, dx, dy));
+}
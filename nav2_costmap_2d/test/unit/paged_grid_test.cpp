@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/paged_grid.hpp"
+
+using nav2_costmap_2d::PagedGrid;
+using nav2_costmap_2d::NO_INFORMATION;
+using nav2_costmap_2d::FREE_SPACE;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+
+TEST(PagedGrid, allocatesOnlyWrittenPages)
+{
+  PagedGrid grid(1000, 1000, NO_INFORMATION);
+  EXPECT_EQ(grid.getAllocatedPages(), 0u);
+  EXPECT_EQ(grid.getCost(999, 999), NO_INFORMATION);
+
+  // Writing the default value does not allocate
+  grid.setCost(10, 10, NO_INFORMATION);
+  EXPECT_EQ(grid.getAllocatedPages(), 0u);
+
+  grid.setCost(10, 10, FREE_SPACE);
+  grid.setCost(20, 30, LETHAL_OBSTACLE);
+  grid.setCost(999, 999, FREE_SPACE);
+  EXPECT_EQ(grid.getAllocatedPages(), 2u);
+  EXPECT_EQ(grid.getCost(10, 10), FREE_SPACE);
+  EXPECT_EQ(grid.getCost(20, 30), LETHAL_OBSTACLE);
+  EXPECT_EQ(grid.getCost(11, 10), NO_INFORMATION);
+  EXPECT_EQ(grid.getCost(999, 999), FREE_SPACE);
+  EXPECT_LT(grid.getMemoryUsage(), 1000u * 1000u / 50);
+
+  grid.setCost(999, 999, NO_INFORMATION);
+  grid.compact();
+  EXPECT_EQ(grid.getAllocatedPages(), 1u);
+
+  grid.resize(500, 500, FREE_SPACE);
+  EXPECT_EQ(grid.getAllocatedPages(), 0u);
+  EXPECT_EQ(grid.getCost(10, 10), FREE_SPACE);
+}
+
+TEST(PagedGrid, rowMajorRoundTripStaysSparse)
+{
+  const unsigned int size_x = 300, size_y = 200;
+  std::vector<unsigned char> costs(size_x * size_y, NO_INFORMATION);
+  // A single aisle of known space
+  for (unsigned int y = 100; y < 110; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      costs[y * size_x + x] = (x % 17 == 0) ? LETHAL_OBSTACLE : FREE_SPACE;
+    }
+  }
+
+  PagedGrid grid(size_x, size_y, NO_INFORMATION);
+  grid.copyFromRowMajor(costs.data());
+  // Rows 100-109 fall in the second page row, which is 5 pages wide
+  EXPECT_EQ(grid.getAllocatedPages(), 5u);
+
+  std::vector<unsigned char> out(costs.size(), 0);
+  grid.copyToRowMajor(out.data());
+  EXPECT_EQ(out, costs);
+
+  unsigned int covered = 0;
+  grid.forEachRowSegment(
+    105, 0, size_x, [&](const unsigned char * run, unsigned int x, unsigned int length) {
+      for (unsigned int i = 0; i < length; ++i) {
+        EXPECT_EQ(run[i], costs[105 * size_x + x + i]);
+      }
+      covered += length;
+    });
+  EXPECT_EQ(covered, size_x);
+}
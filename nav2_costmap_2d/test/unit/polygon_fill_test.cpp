@@ -0,0 +1,138 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::MapLocation;
+
+namespace
+{
+
+std::vector<geometry_msgs::msg::Point> worldPolygon(const std::vector<MapLocation> & cells)
+{
+  // cell centers, with a 1 m resolution and the origin at 0
+  std::vector<geometry_msgs::msg::Point> polygon;
+  for (const auto & cell : cells) {
+    geometry_msgs::msg::Point point;
+    point.x = cell.x + 0.5;
+    point.y = cell.y + 0.5;
+    polygon.push_back(point);
+  }
+  return polygon;
+}
+
+}  // namespace
+
+TEST(PolygonFill, SpansCoverTheOutline)
+{
+  Costmap2D costmap(60, 60, 1.0, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  std::mt19937 random(7);
+  for (int trial = 0; trial < 500; ++trial) {
+    // convex polygons, vertices around an ellipse
+    std::vector<double> angles(3 + random() % 6);
+    for (auto & angle : angles) {
+      angle = (random() % 6283) / 1000.0;
+    }
+    std::sort(angles.begin(), angles.end());
+    const double cx = 10 + random() % 40;
+    const double cy = 10 + random() % 40;
+    const double rx = 1 + random() % 9;
+    const double ry = 1 + random() % 9;
+    std::vector<MapLocation> polygon;
+    for (double angle : angles) {
+      MapLocation vertex;
+      vertex.x = static_cast<unsigned int>(cx + rx * std::cos(angle) + 0.5);
+      vertex.y = static_cast<unsigned int>(cy + ry * std::sin(angle) + 0.5);
+      polygon.push_back(vertex);
+    }
+
+    std::vector<unsigned char> covered(60 * 60, 0);
+    unsigned int last_y = 0;
+    bool first = true;
+    costmap.forEachPolygonSpan(
+      polygon, [&](unsigned int y, unsigned int min_x, unsigned int max_x) {
+        ASSERT_LE(min_x, max_x);
+        ASSERT_LT(max_x, 60u);
+        // a convex polygon has one span per row, in increasing rows
+        EXPECT_TRUE(first || y > last_y);
+        first = false;
+        last_y = y;
+        for (unsigned int x = min_x; x <= max_x; ++x) {
+          ++covered[y * 60 + x];
+        }
+      });
+
+    std::vector<MapLocation> outline;
+    costmap.polygonOutlineCells(polygon, outline);
+    for (const auto & cell : outline) {
+      EXPECT_EQ(covered[cell.y * 60 + cell.x], 1);
+    }
+    for (unsigned char count : covered) {
+      EXPECT_LE(count, 1);
+    }
+
+    std::vector<MapLocation> filled;
+    costmap.convexFillCells(polygon, filled);
+    std::size_t area = 0;
+    for (unsigned char count : covered) {
+      area += count;
+    }
+    EXPECT_EQ(filled.size(), area);
+  }
+}
+
+TEST(PolygonFill, FillsNonConvexPolygons)
+{
+  Costmap2D costmap(40, 40, 1.0, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+
+  // A U opening upwards, the notch spans columns 16 to 24 above row 15
+  const std::vector<MapLocation> u_shape = {
+    {10, 10}, {30, 10}, {30, 30}, {25, 30}, {25, 15}, {15, 15}, {15, 30}, {10, 30}};
+  ASSERT_TRUE(costmap.setPolygonCost(worldPolygon(u_shape), nav2_costmap_2d::LETHAL_OBSTACLE));
+
+  for (unsigned int y = 0; y < 40; ++y) {
+    for (unsigned int x = 0; x < 40; ++x) {
+      const bool in_base = y >= 10 && y <= 15 && x >= 10 && x <= 30;
+      const bool in_arm = y > 15 && y <= 30 && ((x >= 10 && x <= 15) || (x >= 25 && x <= 30));
+      EXPECT_EQ(
+        costmap.getCost(x, y),
+        in_base || in_arm ? nav2_costmap_2d::LETHAL_OBSTACLE : nav2_costmap_2d::FREE_SPACE) <<
+        "cell " << x << ", " << y;
+    }
+  }
+
+  unsigned int spans = 0;
+  costmap.forEachPolygonSpan(
+    u_shape, [&spans](unsigned int y, unsigned int, unsigned int) {
+      if (y == 20) {
+        ++spans;
+      }
+    });
+  EXPECT_EQ(spans, 2u);
+
+  // Vertices outside of the map leave it untouched
+  std::vector<geometry_msgs::msg::Point> outside = worldPolygon(u_shape);
+  outside[1].x = 45.0;
+  Costmap2D untouched(40, 40, 1.0, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  EXPECT_FALSE(untouched.setPolygonCost(outside, nav2_costmap_2d::LETHAL_OBSTACLE));
+  EXPECT_EQ(untouched.getCost(20, 12), nav2_costmap_2d::FREE_SPACE);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/rolling_static_cache.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::RollingStaticCache;
+
+namespace
+{
+
+tf2::Transform makeTransform(double x, double y, double yaw)
+{
+  tf2::Quaternion rotation;
+  rotation.setRPY(0.0, 0.0, yaw);
+  return tf2::Transform(rotation, tf2::Vector3(x, y, 0.0));
+}
+
+// A static map of random costs that does not cover the whole window
+Costmap2D makeMap()
+{
+  Costmap2D map(160, 120, 0.05, -2.0, -1.5, nav2_costmap_2d::FREE_SPACE);
+  std::mt19937 random(11);
+  std::uniform_int_distribution<int> cost(0, 255);
+  for (unsigned int j = 0; j < map.getSizeInCellsY(); ++j) {
+    for (unsigned int i = 0; i < map.getSizeInCellsX(); ++i) {
+      map.setCost(i, j, static_cast<unsigned char>(cost(random)));
+    }
+  }
+  return map;
+}
+
+// Compare a region of the cache with looking every cell up on its own, the way
+// the static layer did before it kept a cache
+void expectPerCellLookup(
+  const RollingStaticCache & cache, const Costmap2D & master, const Costmap2D & map,
+  const tf2::Transform & transform, int min_i, int min_j, int max_i, int max_j)
+{
+  unsigned int mx, my;
+  double wx, wy;
+  for (int j = min_j; j < max_j; ++j) {
+    for (int i = min_i; i < max_i; ++i) {
+      const unsigned int index = master.getIndex(i, j);
+      master.mapToWorld(i, j, wx, wy);
+      const tf2::Vector3 p = transform * tf2::Vector3(wx, wy, 0.0);
+      if (map.worldToMap(p.x(), p.y(), mx, my)) {
+        ASSERT_TRUE(cache.isInside(index)) << i << ", " << j;
+        ASSERT_EQ(cache.getCost(index), map.getCost(mx, my)) << i << ", " << j;
+      } else {
+        ASSERT_FALSE(cache.isInside(index)) << i << ", " << j;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(RollingStaticCache, MatchesThePerCellLookup)
+{
+  const Costmap2D map = makeMap();
+  Costmap2D master(90, 70, 0.05, -1.0, -0.5);
+  RollingStaticCache cache;
+
+  // a translated and rotated window, moving by whole cells as a rolling window does
+  const tf2::Transform transform = makeTransform(0.37, -0.21, 0.43);
+  EXPECT_TRUE(cache.update(master, map, transform, 0, 0, 90, 70));
+  expectPerCellLookup(cache, master, map, transform, 0, 0, 90, 70);
+
+  const double moves[][2] = {{0.6, 0.25}, {2.2, -0.4}, {-1.1, 1.35}, {10.0, 10.0}};
+  for (const auto & move : moves) {
+    master.updateOrigin(master.getOriginX() + move[0], master.getOriginY() + move[1]);
+    EXPECT_FALSE(cache.update(master, map, transform, 0, 0, 90, 70));
+    expectPerCellLookup(cache, master, map, transform, 0, 0, 90, 70);
+  }
+
+  // a new transform rebuilds the cache, which then only looks up the region asked for
+  master.updateOrigin(-0.8, -0.3);
+  const tf2::Transform turned = makeTransform(-0.52, 0.18, -1.17);
+  EXPECT_TRUE(cache.update(master, map, turned, 20, 10, 60, 50));
+  expectPerCellLookup(cache, master, map, turned, 20, 10, 60, 50);
+  EXPECT_FALSE(cache.update(master, map, turned, 0, 0, 90, 70));
+  expectPerCellLookup(cache, master, map, turned, 0, 0, 90, 70);
+
+  // the map changed
+  cache.invalidate();
+  EXPECT_TRUE(cache.update(master, map, turned, 0, 0, 90, 70));
+  expectPerCellLookup(cache, master, map, turned, 0, 0, 90, 70);
+}
+
+TEST(RollingStaticCache, KeepsItsTransformThroughJitter)
+{
+  const Costmap2D map = makeMap();
+  Costmap2D master(90, 70, 0.05, -1.0, -0.5);
+  RollingStaticCache cache;
+
+  const tf2::Transform transform = makeTransform(0.37, -0.21, 0.43);
+  EXPECT_TRUE(cache.update(master, map, transform, 0, 0, 90, 70));
+
+  // less than a tenth of a cell of translation and a tiny yaw move no cell
+  // by a quarter of one, so the cells are still those of the first transform
+  const tf2::Transform jitter[] = {
+    makeTransform(0.373, -0.212, 0.43),
+    makeTransform(0.37, -0.21, 0.4302),
+    makeTransform(0.368, -0.208, 0.4299)};
+  for (const tf2::Transform & jittered : jitter) {
+    master.updateOrigin(master.getOriginX() + 0.25, master.getOriginY());
+    EXPECT_FALSE(cache.update(master, map, jittered, 0, 0, 90, 70));
+    expectPerCellLookup(cache, master, map, transform, 0, 0, 90, 70);
+  }
+
+  // a cell of translation, or a yaw that moves the far corner by one, rebuilds it
+  const tf2::Transform moved = makeTransform(0.42, -0.21, 0.43);
+  EXPECT_TRUE(cache.update(master, map, moved, 0, 0, 90, 70));
+  expectPerCellLookup(cache, master, map, moved, 0, 0, 90, 70);
+
+  const tf2::Transform turned = makeTransform(0.42, -0.21, 0.44);
+  EXPECT_TRUE(cache.update(master, map, turned, 0, 0, 90, 70));
+  expectPerCellLookup(cache, master, map, turned, 0, 0, 90, 70);
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/tiled_grid.hpp"
+
+using nav2_costmap_2d::TiledGrid;
+
+TEST(TiledGrid, indexRoundTripsAndIsUnique)
+{
+  // Sizes that are not a multiple of the tile size exercise the padding
+  TiledGrid grid(150, 70);
+  std::set<unsigned int> seen;
+  for (unsigned int y = 0; y < 70; ++y) {
+    for (unsigned int x = 0; x < 150; ++x) {
+      unsigned int index = grid.getIndex(x, y);
+      EXPECT_TRUE(seen.insert(index).second);
+      unsigned int mx, my;
+      grid.indexToCells(index, mx, my);
+      EXPECT_EQ(mx, x);
+      EXPECT_EQ(my, y);
+    }
+  }
+}
+
+TEST(TiledGrid, rowMajorRoundTrip)
+{
+  const unsigned int size_x = 200, size_y = 130;
+  std::vector<unsigned char> costs(size_x * size_y);
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<int> cost(0, 255);
+  for (auto & c : costs) {
+    c = static_cast<unsigned char>(cost(gen));
+  }
+
+  TiledGrid grid(size_x, size_y, 7);
+  grid.copyFromRowMajor(costs.data());
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      ASSERT_EQ(grid.getCost(x, y), costs[y * size_x + x]);
+    }
+  }
+
+  grid.setCost(199, 129, 42);
+  costs[129 * size_x + 199] = 42;
+  std::vector<unsigned char> out(costs.size());
+  grid.copyToRowMajor(out.data());
+  EXPECT_EQ(out, costs);
+}
+
+TEST(TiledGrid, rowSegmentsCoverRowInOrder)
+{
+  TiledGrid grid(300, 10, 1);
+  unsigned int expected_x = 10;
+  unsigned int segments = 0;
+  grid.forEachRowSegment(
+    4, 10, 290, [&](unsigned char * run, unsigned int x, unsigned int length) {
+      EXPECT_EQ(x, expected_x);
+      EXPECT_LE(length, TiledGrid::TILE_SIZE);
+      for (unsigned int i = 0; i < length; ++i) {
+        run[i] = 9;
+      }
+      expected_x += length;
+      ++segments;
+    });
+  EXPECT_EQ(expected_x, 290u);
+  // [10, 64) [64, 128) [128, 192) [192, 256) [256, 290)
+  EXPECT_EQ(segments, 5u);
+
+  EXPECT_EQ(grid.getCost(9, 4), 1);
+  EXPECT_EQ(grid.getCost(10, 4), 9);
+  EXPECT_EQ(grid.getCost(289, 4), 9);
+  EXPECT_EQ(grid.getCost(290, 4), 1);
+  EXPECT_EQ(grid.getCost(100, 3), 1);
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/voxel_grid_updates.hpp"
+
+using nav2_costmap_2d::applyVoxelGridUpdate;
+using nav2_costmap_2d::fillVoxelGridUpdate;
+
+namespace
+{
+
+// A 4 x 3 grid of 32 level columns, two words each, numbered by cell
+nav2_msgs::msg::VoxelGrid makeGrid()
+{
+  nav2_msgs::msg::VoxelGrid grid;
+  grid.size_x = 4;
+  grid.size_y = 3;
+  grid.size_z = 32;
+  grid.words_per_column = 2;
+  grid.resolutions.x = 0.5;
+  grid.resolutions.y = 0.5;
+  grid.resolutions.z = 0.1;
+  grid.origin.x = 1.0;
+  grid.origin.y = -1.0;
+  for (uint32_t cell = 0; cell < 12; ++cell) {
+    grid.data.push_back(cell);
+    grid.data.push_back(100 + cell);
+  }
+  return grid;
+}
+
+// The grid interface fillVoxelGridUpdate() reads, over the columns of a message
+struct MessageGrid
+{
+  const nav2_msgs::msg::VoxelGrid & msg;
+
+  unsigned int wordsPerColumn() const {return msg.words_per_column;}
+
+  void copyColumnWords(
+    unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+    uint32_t * words) const
+  {
+    for (unsigned int j = 0; j < height; ++j) {
+      const auto first = msg.data.begin() + ((y + j) * msg.size_x + x) * msg.words_per_column;
+      words = std::copy(first, first + width * msg.words_per_column, words);
+    }
+  }
+};
+
+}  // namespace
+
+TEST(VoxelGridUpdates, appliesChangedColumns)
+{
+  for (bool compress : {false, true}) {
+    nav2_msgs::msg::VoxelGrid current = makeGrid();
+    nav2_msgs::msg::VoxelGrid received = current;
+    current.data[2 * (1 * 4 + 2)] = 42;
+    current.data[2 * (2 * 4 + 3) + 1] = 43;
+
+    nav2_msgs::msg::VoxelGridUpdate update;
+    update.origin = current.origin;
+    fillVoxelGridUpdate(MessageGrid{current}, 2, 1, 2, 2, compress, update);
+    EXPECT_EQ(update.data.empty(), compress);
+    ASSERT_TRUE(applyVoxelGridUpdate(update, received));
+    EXPECT_EQ(received.data, current.data);
+  }
+}
+
+TEST(VoxelGridUpdates, shiftsWithTheOrigin)
+{
+  nav2_msgs::msg::VoxelGrid received = makeGrid();
+
+  // The window moved one cell along x, the last column of every row is new
+  nav2_msgs::msg::VoxelGridUpdate update;
+  update.origin = received.origin;
+  update.origin.x += 0.5;
+  update.words_per_column = 2;
+  ASSERT_TRUE(applyVoxelGridUpdate(update, received));
+  EXPECT_FLOAT_EQ(received.origin.x, 1.5);
+  for (unsigned int y = 0; y < 3; ++y) {
+    for (unsigned int x = 0; x < 3; ++x) {
+      EXPECT_EQ(received.data[2 * (y * 4 + x)], y * 4 + x + 1);
+    }
+    EXPECT_EQ(received.data[2 * (y * 4 + 3)], 0xffffffffu);
+    EXPECT_EQ(received.data[2 * (y * 4 + 3) + 1], 0u);
+  }
+}
+
+TEST(VoxelGridUpdates, rejectsUpdatesNotFittingTheGrid)
+{
+  const nav2_msgs::msg::VoxelGrid grid = makeGrid();
+  nav2_msgs::msg::VoxelGrid received = grid;
+
+  nav2_msgs::msg::VoxelGridUpdate update;
+  update.origin = grid.origin;
+  fillVoxelGridUpdate(MessageGrid{grid}, 2, 1, 2, 2, false, update);
+  update.x = 3;
+  EXPECT_FALSE(applyVoxelGridUpdate(update, received));
+
+  update.x = 2;
+  update.words_per_column = 1;
+  EXPECT_FALSE(applyVoxelGridUpdate(update, received));
+
+  update.words_per_column = 2;
+  update.data.pop_back();
+  EXPECT_FALSE(applyVoxelGridUpdate(update, received));
+  EXPECT_EQ(received, grid);
+}
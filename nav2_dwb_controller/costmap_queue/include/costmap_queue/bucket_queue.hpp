@@ -0,0 +1,131 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+#define COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+
+#include <stdexcept>
+#include <vector>
+
+namespace costmap_queue
+{
+/**
+ * @brief Priority queue for small non-negative integer priorities
+ *
+ * Same interface and ordering as MapBasedQueue (items with equal priority come out last-in,
+ * first-out), but the bins are a vector indexed by priority. Bins keep their capacity across
+ * reset(), so once warmed up an expansion over the same costmap does not allocate.
+ */
+template<class item_t>
+class BucketQueue
+{
+public:
+  /**
+   * @brief Default Constructor
+   */
+  BucketQueue()
+  : item_count_(0), current_(0)
+  {
+  }
+
+  virtual ~BucketQueue() = default;
+
+  /**
+   * @brief Clear the queue
+   */
+  virtual void reset()
+  {
+    if (item_count_ > 0) {
+      for (std::vector<item_t> & bin : bins_) {
+        bin.clear();
+      }
+      item_count_ = 0;
+    }
+    current_ = 0;
+  }
+
+  /**
+   * @brief Make sure priorities below the given number do not need to grow the bins
+   * @param num_priorities Number of distinct priorities
+   */
+  void reserveBins(unsigned int num_priorities)
+  {
+    if (bins_.size() < num_priorities) {
+      bins_.resize(num_priorities);
+    }
+  }
+
+  /**
+   * @brief Add a new item to the queue with a set priority
+   * @param priority Priority of the item
+   * @param item Payload item
+   */
+  void enqueue(const unsigned int priority, const item_t & item)
+  {
+    reserveBins(priority + 1);
+    bins_[priority].push_back(item);
+    if (item_count_ == 0 || priority < current_) {
+      current_ = priority;
+    }
+    item_count_++;
+  }
+
+  /**
+   * @brief Check to see if there is anything in the queue
+   * @return True if there is nothing in the queue
+   *
+   * Must be called prior to front/pop.
+   */
+  bool isEmpty()
+  {
+    return item_count_ == 0;
+  }
+
+  /**
+   * @brief Return the item at the front of the queue
+   * @return The item at the front of the queue
+   */
+  item_t & front()
+  {
+    if (item_count_ == 0) {
+      throw std::out_of_range("front() called on empty costmap_queue::BucketQueue!");
+    }
+    return bins_[current_].back();
+  }
+
+  /**
+   * @brief Remove (and destroy) the item at the front of the queue
+   */
+  void pop()
+  {
+    if (item_count_ == 0) {
+      return;
+    }
+    bins_[current_].pop_back();
+    item_count_--;
+    if (item_count_ > 0) {
+      while (bins_[current_].empty()) {
+        current_++;
+      }
+    }
+  }
+
+protected:
+  std::vector<std::vector<item_t>> bins_;
+  unsigned int item_count_;
+  unsigned int current_;  ///< Lowest non-empty bin while the queue is not empty
+};
+}  // namespace costmap_queue
+
+#endif  // COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
@@ -40,7 +40,7 @@
 #include <limits>
 #include <memory>
 #include "nav2_costmap_2d/costmap_2d.hpp"
-#include "costmap_queue/map_based_queue.hpp"
+#include "costmap_queue/bucket_queue.hpp"
 
 namespace costmap_queue
 {
@@ -104,8 +104,11 @@ public:
  * The validCellToQueue overridable-function allows for deriving classes to limit the queue traversal
  * to a subset of all costmap cells. LimitedCostmapQueue does this by ignoring distances above a limit.
  *
+ * Internally, every distance in the cached table is replaced by its rank among all the distinct
+ * cached distances, so the cells can be kept in a BucketQueue. Cells are marked as seen with the
+ * current generation number, so reset() does not need to clear the whole map.
  */
-class CostmapQueue : public MapBasedQueue<CellData>
+class CostmapQueue : public BucketQueue<CellData>
 {
 public:
   /**
@@ -160,7 +163,9 @@ protected:
   void computeCache();
 
   nav2_costmap_2d::Costmap2D & costmap_;
-  std::vector<bool> seen_;
+  std::vector<unsigned int> seen_;  ///< Generation in which each cell was last queued
+  unsigned int generation_;
+  int neighbour_offsets_[4];  ///< Index offsets of the left, lower, right and upper neighbours
   int max_distance_;
   bool manhattan_;
 
@@ -181,7 +186,21 @@ protected:
     unsigned int dy = CellData::absolute_difference(cur_y, src_y);
     return cached_distances_[dx][dy];
   }
+
+  /**
+   * @brief Lookup pre-computed rank of the distance between two cells
+   */
+  inline unsigned int rankLookup(
+    const unsigned int cur_x, const unsigned int cur_y,
+    const unsigned int src_x, const unsigned int src_y)
+  {
+    unsigned int dx = CellData::absolute_difference(cur_x, src_x);
+    unsigned int dy = CellData::absolute_difference(cur_y, src_y);
+    return cached_ranks_[dx][dy];
+  }
   std::vector<std::vector<double>> cached_distances_;
+  std::vector<std::vector<unsigned int>> cached_ranks_;
+  unsigned int num_ranks_;
   int cached_max_distance_;
 };
 }  // namespace costmap_queue
@@ -42,8 +42,8 @@ namespace costmap_queue
 {
 
 CostmapQueue::CostmapQueue(nav2_costmap_2d::Costmap2D & costmap, bool manhattan)
-: MapBasedQueue(), costmap_(costmap), max_distance_(-1), manhattan_(manhattan),
-  cached_max_distance_(-1)
+: BucketQueue(), costmap_(costmap), generation_(0), max_distance_(-1), manhattan_(manhattan),
+  num_ranks_(0), cached_max_distance_(-1)
 {
   reset();
 }
@@ -51,12 +51,19 @@ CostmapQueue::CostmapQueue(nav2_costmap_2d::Costmap2D & costmap, bool manhattan)
 void CostmapQueue::reset()
 {
   unsigned int size_x = costmap_.getSizeInCellsX(), size_y = costmap_.getSizeInCellsY();
-  if (seen_.size() != size_x * size_y) {
-    seen_.resize(size_x * size_y);
+  generation_++;
+  if (seen_.size() != size_x * size_y || generation_ == 0) {
+    // New map size or the generation counter wrapped around: start over
+    seen_.assign(size_x * size_y, 0);
+    generation_ = 1;
   }
-  std::fill(seen_.begin(), seen_.end(), false);
+  neighbour_offsets_[0] = -1;
+  neighbour_offsets_[1] = -static_cast<int>(size_x);
+  neighbour_offsets_[2] = 1;
+  neighbour_offsets_[3] = static_cast<int>(size_x);
   computeCache();
-  MapBasedQueue::reset();
+  BucketQueue::reset();
+  reserveBins(num_ranks_);
 }
 
 void CostmapQueue::enqueueCell(unsigned int x, unsigned int y)
@@ -69,15 +76,15 @@ void CostmapQueue::enqueueCell(
   unsigned int index, unsigned int cur_x, unsigned int cur_y,
   unsigned int src_x, unsigned int src_y)
 {
-  if (seen_[index]) {return;}
+  if (seen_[index] == generation_) {return;}
 
   // we compute our distance table one cell further than the inflation radius
   // dictates so we can make the check below
   double distance = distanceLookup(cur_x, cur_y, src_x, src_y);
   CellData data(distance, index, cur_x, cur_y, src_x, src_y);
   if (validCellToQueue(data)) {
-    seen_[index] = true;
-    enqueue(distance, data);
+    seen_[index] = generation_;
+    enqueue(rankLookup(cur_x, cur_y, src_x, src_y), data);
   }
 }
 
@@ -96,16 +103,16 @@ CellData CostmapQueue::getNextCell()
   // attempt to put the neighbors of the current cell onto the queue
   unsigned int size_x = costmap_.getSizeInCellsX();
   if (mx > 0) {
-    enqueueCell(index - 1, mx - 1, my, sx, sy);
+    enqueueCell(index + neighbour_offsets_[0], mx - 1, my, sx, sy);
   }
   if (my > 0) {
-    enqueueCell(index - size_x, mx, my - 1, sx, sy);
+    enqueueCell(index + neighbour_offsets_[1], mx, my - 1, sx, sy);
   }
   if (mx < size_x - 1) {
-    enqueueCell(index + 1, mx + 1, my, sx, sy);
+    enqueueCell(index + neighbour_offsets_[2], mx + 1, my, sx, sy);
   }
   if (my < costmap_.getSizeInCellsY() - 1) {
-    enqueueCell(index + size_x, mx, my + 1, sx, sy);
+    enqueueCell(index + neighbour_offsets_[3], mx, my + 1, sx, sy);
   }
 
   return current_cell;
@@ -131,6 +138,34 @@ void CostmapQueue::computeCache()
       }
     }
   }
+
+  // Rank the distances so they can be used as bucket indices. Both metrics only depend on an
+  // integer key (dx + dy or dx * dx + dy * dy) and grow with it, so the rank of a distance is the
+  // number of smaller keys that occur in the table.
+  unsigned int size = cached_distances_.size();
+  auto key = [this](unsigned int dx, unsigned int dy) {
+      return manhattan_ ? dx + dy : dx * dx + dy * dy;
+    };
+  std::vector<unsigned int> key_ranks(key(size - 1, size - 1) + 1, 0);
+  for (unsigned int i = 0; i < size; ++i) {
+    for (unsigned int j = 0; j < size; ++j) {
+      key_ranks[key(i, j)] = 1;
+    }
+  }
+  num_ranks_ = 0;
+  for (unsigned int & rank : key_ranks) {
+    unsigned int used = rank;
+    rank = num_ranks_;
+    num_ranks_ += used;
+  }
+
+  cached_ranks_.resize(size);
+  for (unsigned int i = 0; i < size; ++i) {
+    cached_ranks_[i].resize(size);
+    for (unsigned int j = 0; j < size; ++j) {
+      cached_ranks_[i][j] = key_ranks[key(i, j)];
+    }
+  }
   cached_max_distance_ = max_distance_;
 }
 
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include "gtest/gtest.h"
+#include "costmap_queue/bucket_queue.hpp"
+
+using costmap_queue::BucketQueue;
+
+void letter_test(BucketQueue<char> & q, const char test_letter)
+{
+  ASSERT_FALSE(q.isEmpty());
+  char c = q.front();
+  EXPECT_EQ(c, test_letter);
+  q.pop();
+}
+
+TEST(BucketQueue, emptyQueue)
+{
+  BucketQueue<char> q;
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_THROW(q.front(), std::out_of_range);
+  q.enqueue(1, 'A');
+  EXPECT_FALSE(q.isEmpty());
+}
+
+TEST(BucketQueue, checkOrdering)
+{
+  BucketQueue<char> q;
+  q.enqueue(1, 'A');
+  q.enqueue(3, 'B');
+  q.enqueue(2, 'C');
+  q.enqueue(5, 'D');
+  q.enqueue(0, 'E');
+
+  std::string expected = "EACBD";
+  for (unsigned int i = 0; i < expected.size(); i++) {
+    letter_test(q, expected[i]);
+  }
+  EXPECT_TRUE(q.isEmpty());
+}
+
+TEST(BucketQueue, checkTies)
+{
+  BucketQueue<char> q;
+  q.enqueue(2, 'A');
+  q.enqueue(2, 'B');
+  q.enqueue(1, 'C');
+
+  std::string expected = "CBA";
+  for (unsigned int i = 0; i < expected.size(); i++) {
+    letter_test(q, expected[i]);
+  }
+}
+
+TEST(BucketQueue, checkDynamicOrdering)
+{
+  BucketQueue<char> q;
+  q.enqueue(1, 'A');
+  q.enqueue(2, 'B');
+  q.enqueue(5, 'D');
+  letter_test(q, 'A');
+  letter_test(q, 'B');
+  q.enqueue(1, 'C');
+  letter_test(q, 'C');
+  letter_test(q, 'D');
+  EXPECT_TRUE(q.isEmpty());
+}
+
+TEST(BucketQueue, reset)
+{
+  BucketQueue<char> q;
+  q.enqueue(3, 'A');
+  q.enqueue(4, 'B');
+  q.reset();
+  EXPECT_TRUE(q.isEmpty());
+  q.enqueue(4, 'C');
+  letter_test(q, 'C');
+  EXPECT_TRUE(q.isEmpty());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
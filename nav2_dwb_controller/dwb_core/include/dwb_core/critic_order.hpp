@@ -0,0 +1,86 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DWB_CORE__CRITIC_ORDER_HPP_
+#define DWB_CORE__CRITIC_ORDER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dwb_core
+{
+
+/**
+ * @class CriticOrder
+ * @brief Order the critics are run in, learnt from their cost and selectivity
+ *
+ * The cost of a critic is its time per trajectory, its selectivity the share of
+ * the trajectories it gets that it rejects or that get cut short after it. Both
+ * are averaged over cycles. Critics are run by increasing cost per rejection,
+ * which is the order minimizing the expected time spent on a trajectory when the
+ * critics reject independently. Critics that never reject run last, cheapest
+ * first, and ties keep the configured order.
+ *
+ * Since the totals are sums of all the critics' scores, the order only changes
+ * how soon a trajectory is given up on, not which one is the best.
+ */
+class CriticOrder
+{
+public:
+  /**
+   * @brief Forget the stats and go back to the configured order
+   */
+  void reset(std::size_t num_critics);
+
+  /**
+   * @brief Critic indices, in the order they should be run
+   */
+  const std::vector<std::size_t> & order() const {return order_;}
+
+  /**
+   * @brief Add a sample of a critic to the current cycle
+   * @param critic Index of the critic
+   * @param elapsed_ns Time it took
+   * @param tried Number of trajectories it scored
+   * @param rejected How many of those were illegal or cut short after it
+   */
+  void record(std::size_t critic, int64_t elapsed_ns, std::size_t tried, std::size_t rejected);
+
+  /**
+   * @brief Fold the samples of the cycle into the averages and sort the critics
+   */
+  void update();
+
+protected:
+  struct Stats
+  {
+    double ns_per_trajectory{0.0};
+    double rejection_rate{0.0};
+    bool sampled{false};
+    // Current cycle
+    int64_t cycle_ns{0};
+    std::size_t cycle_tried{0};
+    std::size_t cycle_rejected{0};
+  };
+
+  static constexpr double kSmoothing = 0.1;  ///< Weight of the latest cycle
+
+  std::vector<Stats> stats_;
+  std::vector<std::size_t> order_;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__CRITIC_ORDER_HPP_
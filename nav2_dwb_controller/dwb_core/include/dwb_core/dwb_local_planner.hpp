@@ -35,17 +35,24 @@
 #ifndef DWB_CORE__DWB_LOCAL_PLANNER_HPP_
 #define DWB_CORE__DWB_LOCAL_PLANNER_HPP_
 
+#include <cstdint>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "nav2_core/controller.hpp"
 #include "nav2_core/goal_checker.hpp"
+#include "dwb_core/critic_order.hpp"
+#include "dwb_core/illegal_trajectory_tracker.hpp"
 #include "dwb_core/publisher.hpp"
+#include "dwb_core/trajectory_batch.hpp"
 #include "dwb_core/trajectory_critic.hpp"
 #include "dwb_core/trajectory_generator.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
 #include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "nav2_util/timing_diagnostics.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "pluginlib/class_loader.hpp"
@@ -83,6 +90,12 @@ public:
    */
   void setPlan(const nav_msgs::msg::Path & path) override;
 
+  /**
+   * @brief nav2_core setPlan - Sets the global plan from a compact path, with no unpacking
+   * @param path The global plan
+   */
+  void setPlan(const nav2_msgs::msg::CompactPath & path) override;
+
   /**
    * @brief nav2_core computeVelocityCommands - calculates the best command given the current pose and velocity
    *
@@ -132,6 +145,11 @@ public:
     std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results);
 
 protected:
+  /**
+   * @brief Reset the critics and the trajectory generator for a new global plan
+   */
+  void setPlan2D(nav_2d_msgs::msg::Path2D && path2d);
+
   /**
    * @brief Helper method for two common operations for the operating on the global_plan
    *
@@ -143,6 +161,15 @@ protected:
     const nav_2d_msgs::msg::Pose2DStamped & pose, nav_2d_msgs::msg::Path2D & transformed_plan,
     nav_2d_msgs::msg::Pose2DStamped & goal_pose, bool publish_plan = true);
 
+  /**
+   * @brief Bring scoring_costmap_ up to date with the latest costmap snapshot
+   *
+   * The copy is skipped when no update happened since the last cycle. The live
+   * costmap is only locked, briefly, before its first snapshot exists.
+   * @return Whether scoring_costmap_ changed
+   */
+  bool refreshScoringCostmap();
+
   /**
    * @brief Iterate through all the twists and find the best one
    */
@@ -151,6 +178,92 @@ protected:
     const nav_2d_msgs::msg::Twist2D velocity,
     std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results);
 
+  /**
+   * @brief Cache the scale of every critic for the current cycle
+   */
+  void updateCriticScales();
+
+  /**
+   * @brief Score a trajectory into raw critic scores, without building its score message
+   *
+   * Uses the scales cached by updateCriticScales(). Short circuits like scoreTrajectory,
+   * running the critics in the order of critic_order_.
+   *
+   * @param traj Trajectory to check
+   * @param best_score If positive, the threshold for early termination
+   * @param raw_scores Output, one raw score per critic, 0 for the critics not run
+   * @param num_scored Output, number of critics in critic_order_ up to the last one that was run
+   * @return The weighted total score
+   */
+  double scoreTrajectoryRaw(
+    const dwb_msgs::msg::Trajectory2D & traj, double best_score,
+    double * raw_scores, size_t & num_scored);
+
+  /**
+   * @brief Build the score message from the raw scores of scoreTrajectoryRaw()
+   */
+  dwb_msgs::msg::TrajectoryScore getTrajectoryScore(
+    const dwb_msgs::msg::Trajectory2D & traj, const double * raw_scores,
+    size_t num_scored, double total);
+
+  /**
+   * @brief Generate and score all the twists on the scoring pool
+   *
+   * The candidates are reduced in the order the generator produced them, so the
+   * best and worst trajectories are the ones the serial loop would pick.
+   */
+  void scoreTrajectoriesInParallel(
+    const geometry_msgs::msg::Pose2D & pose,
+    const nav_2d_msgs::msg::Twist2D & velocity,
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+    dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+    IllegalTrajectoryTracker & tracker);
+
+  /**
+   * @brief Generate all the twists into a batch and score it critic by critic
+   *
+   * Messages are only built for the best trajectory, and for all of them when
+   * results are recorded. The scores match scoreTrajectory's, without short circuiting.
+   */
+  void scoreTrajectoryBatch(
+    const geometry_msgs::msg::Pose2D & pose,
+    const nav_2d_msgs::msg::Twist2D & velocity,
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+    dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+    IllegalTrajectoryTracker & tracker);
+
+  /**
+   * @brief Sort the candidates of an anytime cycle, the previous command and its neighbours first
+   */
+  void orderCandidates(std::vector<nav_2d_msgs::msg::Twist2D> & twists) const;
+
+  /**
+   * @brief Whether the time budget of the cycle ran out. Always false without a budget
+   */
+  bool pastDeadline() const;
+
+  /**
+   * @brief Build the full score message of a trajectory of the batch
+   */
+  dwb_msgs::msg::TrajectoryScore getBatchScore(std::size_t i, double total);
+
+  /**
+   * @brief Record a legal trajectory's score, updating the best and worst ones
+   */
+  void addLegalScore(
+    const dwb_msgs::msg::TrajectoryScore & score,
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+    dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+    IllegalTrajectoryTracker & tracker);
+
+  /**
+   * @brief Record a trajectory that one of the critics rejected
+   */
+  void addIllegalScore(
+    const dwb_msgs::msg::Trajectory2D & traj, const IllegalTrajectoryException & e,
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+    IllegalTrajectoryTracker & tracker);
+
   /**
    * @brief Transforms global plan into same frame as pose, clips far away poses and possibly prunes passed poses
    *
@@ -164,6 +277,8 @@ protected:
   virtual nav_2d_msgs::msg::Path2D transformGlobalPlan(
     const nav_2d_msgs::msg::Pose2DStamped & pose);
   nav_2d_msgs::msg::Path2D global_plan_;  ///< Saved Global Plan
+  size_t plan_first_index_{0};  ///< Poses of global_plan_ before it were pruned
+  size_t plan_start_index_{0};  ///< Where the last transformed plan started in global_plan_
   bool prune_plan_;
   double prune_distance_;
   bool debug_trajectory_details_;
@@ -202,6 +317,73 @@ protected:
   std::string dwb_plugin_name_;
 
   bool short_circuit_trajectory_evaluation_;
+
+  // Order the critics are run in. Only learnt with adaptive_critic_order_,
+  // from every trajectory of the serial loop and the first chunk of a batch
+  bool adaptive_critic_order_{false};
+  bool sample_critics_{false};
+  CriticOrder critic_order_;
+
+  // Private copy of the local costmap the critics score against
+  std::unique_ptr<nav2_costmap_2d::Costmap2D> scoring_costmap_;
+  uint64_t scoring_sequence_{0};  ///< Sequence of the snapshot copied in
+  bool scoring_sequence_valid_{false};
+  // Whether a critic reads the live costmap, which is then locked while scoring
+  bool lock_live_costmap_{true};
+
+  // Critics whose prepare() is reused, because it only reads the transformed
+  // plan and the costmap and neither changed since it succeeded
+  nav_2d_msgs::msg::Path2D prepared_plan_;
+  std::vector<char> prepared_;
+
+  // Kept across cycles so that its counters keep their storage
+  IllegalTrajectoryTracker tracker_;
+
+  // Scales of the critics for the current cycle, and raw scores kept without
+  // building score messages. score_matrix_ has one row of critics per trajectory
+  std::vector<double> critic_scales_;
+  std::vector<double> raw_scores_;
+  std::vector<double> best_raw_scores_;
+  std::vector<double> score_matrix_;
+  std::vector<size_t> num_scored_;
+  std::vector<double> totals_;
+
+  // Pool the trajectories are scored on when every critic is thread safe
+  std::unique_ptr<nav2_util::ThreadPool> scoring_pool_;
+  bool parallel_scoring_{false};
+  // Per candidate results of a parallel cycle, kept so that cycles don't allocate them
+  std::vector<dwb_msgs::msg::Trajectory2D> parallel_trajs_;
+  std::vector<std::unique_ptr<IllegalTrajectoryException>> parallel_failures_;
+  std::vector<char> parallel_skipped_;
+
+  // Batch scoring, the storage is reused from cycle to cycle
+  bool batch_scoring_{false};
+  TrajectoryBatch batch_;
+  std::vector<nav_2d_msgs::msg::Twist2D> batch_twists_;
+  std::vector<std::vector<double>> batch_scores_;  ///< Raw scores, per critic
+  std::vector<std::string> batch_failures_;
+  std::vector<std::size_t> batch_failed_critic_;
+
+  // Anytime mode: once the cycle's time budget is spent, the best legal
+  // trajectory found so far is returned and the remaining twists are skipped
+  std::chrono::steady_clock::duration time_budget_{0};
+  std::chrono::steady_clock::time_point cycle_deadline_;
+  nav_2d_msgs::msg::Twist2D last_cmd_;  ///< Command chosen in the previous cycle
+  std::size_t num_skipped_{0};  ///< Twists skipped in the current cycle
+
+  // Time spent in each critic by the serial loop of the current cycle, when
+  // tracing or timing
+  bool time_critics_{false};
+  std::vector<int64_t> critic_time_ns_;
+  std::vector<uint32_t> critic_calls_;
+
+  // Cycle time and time per cycle of each critic, published as diagnostics
+  double diagnostics_period_{0.0};
+  std::shared_ptr<nav2_util::TimingStats> timing_stats_;
+  nav2_util::TimingHistogram * cycle_timing_{nullptr};
+  std::vector<nav2_util::TimingHistogram *> prepare_timings_;
+  std::vector<nav2_util::TimingHistogram *> score_timings_;
+  std::unique_ptr<nav2_util::TimingDiagnostics> timing_diagnostics_;
 };
 
 }  // namespace dwb_core
@@ -52,6 +52,11 @@ public:
   void addIllegalTrajectory(const IllegalTrajectoryException & e);
   void addLegalTrajectory();
 
+  /**
+   * @brief Zero the counts. The failure reasons seen so far keep their entries
+   */
+  void reset();
+
   std::map<std::pair<std::string, std::string>, double> getPercentages() const;
 
   std::string getMessage() const;
@@ -35,14 +35,20 @@
 #ifndef DWB_CORE__PUBLISHER_HPP_
 #define DWB_CORE__PUBLISHER_HPP_
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 #include "dwb_core/trajectory_critic.hpp"
 #include "dwb_msgs/msg/local_plan_evaluation.hpp"
 #include "nav_msgs/msg/path.hpp"
+#include "nav_2d_utils/path_ops.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "sensor_msgs/msg/point_cloud2.hpp"
 #include "visualization_msgs/msg/marker_array.hpp"
@@ -65,11 +71,17 @@ namespace dwb_core
  *   4) The Full LocalPlanEvaluation
  *   5) Markers representing the different trajectories evaluated
  *   6) The CostGrid (in the form of a complex PointCloud2)
+ *
+ * The evaluation, trajectory markers and cost grid are only built when someone
+ * subscribes, the last two at most visualization_frequency times a second. They
+ * are serialized and published from a thread of their own so the control loop
+ * only pays for gathering the critics' data.
  */
 class DWBPublisher
 {
 public:
   explicit DWBPublisher(nav2_util::LifecycleNode::SharedPtr node, const std::string & plugin_name);
+  ~DWBPublisher();
 
   nav2_util::CallbackReturn on_configure();
   nav2_util::CallbackReturn on_activate();
@@ -80,28 +92,58 @@ public:
    * @brief Does the publisher require that the LocalPlanEvaluation be saved
    * @return True if the Evaluation is needed to publish either directly or as trajectories
    */
-  bool shouldRecordEvaluation() {return publish_evaluation_ || publish_trajectories_;}
+  bool shouldRecordEvaluation();
 
   /**
    * @brief If the pointer is not null, publish the evaluation and trajectories as needed
+   *
+   * The evaluation is published later on the publishing thread, so it must not be
+   * modified once handed over.
    */
   void publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results);
   void publishLocalPlan(
     const std_msgs::msg::Header & header,
     const dwb_msgs::msg::Trajectory2D & traj);
+  /**
+   * @brief Publish the critics' scores of every cell
+   *
+   * The critics' channels are gathered right away, the cloud is completed and
+   * published on the publishing thread.
+   * @param costmap Grid the critics scored against, the master grid of costmap_ros if null
+   */
   void publishCostGrid(
     const std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros,
-    const std::vector<TrajectoryCritic::Ptr> critics);
-  void publishGlobalPlan(const nav_2d_msgs::msg::Path2D plan);
-  void publishTransformedPlan(const nav_2d_msgs::msg::Path2D plan);
-  void publishLocalPlan(const nav_2d_msgs::msg::Path2D plan);
+    const std::vector<TrajectoryCritic::Ptr> critics,
+    const nav2_costmap_2d::Costmap2D * costmap = nullptr);
+  void publishGlobalPlan(const nav_2d_msgs::msg::Path2D & plan);
+  /** @brief Publish part of the global plan, only copied if someone subscribes */
+  void publishGlobalPlan(const nav_2d_utils::PathView & plan);
+  void publishTransformedPlan(const nav_2d_msgs::msg::Path2D & plan);
+  void publishLocalPlan(const nav_2d_msgs::msg::Path2D & plan);
 
 protected:
   void publishTrajectories(const dwb_msgs::msg::LocalPlanEvaluation & results);
 
+  /** @brief Cost grid channels gathered on the control thread, completed by the publishing one */
+  struct CostGrid
+  {
+    std::unique_ptr<sensor_msgs::msg::PointCloud> cloud;
+    std::vector<std::pair<std::size_t, double>> scaled_channels;  ///< Channel index and scale
+    unsigned int size_x, size_y;
+    double origin_x, origin_y, resolution;
+  };
+  void publishCostGrid(CostGrid & grid);
+
+  /** @brief Whether a throttled visualization last published at last is due */
+  bool visualizationDue(std::chrono::steady_clock::time_point last) const;
+
+  void startPublishing();
+  void stopPublishing();
+  void publishLoop();
+
   // Helper function for publishing other plans
   void publishGenericPlan(
-    const nav_2d_msgs::msg::Path2D plan,
+    const nav_2d_utils::PathView & plan,
     rclcpp::Publisher<nav_msgs::msg::Path> & pub, bool flag);
 
   // Flags for turning on/off publishing specific components
@@ -116,6 +158,21 @@ protected:
   // Marker Lifetime
   builtin_interfaces::msg::Duration marker_lifetime_;
 
+  // Throttling of the trajectories and cost grid, no throttling if zero
+  std::chrono::steady_clock::duration visualization_period_{0};
+  std::chrono::steady_clock::time_point last_trajectories_;
+  std::chrono::steady_clock::time_point last_cost_grid_;
+
+  // Publishing thread, only the latest pending data of each kind is published
+  std::thread publish_thread_;
+  std::mutex publish_mutex_;
+  std::condition_variable publish_condition_;
+  bool publish_thread_shutdown_{false};
+  std::shared_ptr<const dwb_msgs::msg::LocalPlanEvaluation> pending_evaluation_;
+  bool pending_publish_evaluation_{false};
+  bool pending_trajectories_{false};
+  std::unique_ptr<CostGrid> pending_cost_grid_;
+
   // Publisher Objects
   std::shared_ptr<LifecyclePublisher<dwb_msgs::msg::LocalPlanEvaluation>> eval_pub_;
   std::shared_ptr<LifecyclePublisher<nav_msgs::msg::Path>> global_pub_;
@@ -0,0 +1,156 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DWB_CORE__TRAJECTORY_BATCH_HPP_
+#define DWB_CORE__TRAJECTORY_BATCH_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "dwb_msgs/msg/trajectory2_d.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav_2d_msgs/msg/twist2_d.hpp"
+
+namespace dwb_core
+{
+
+/**
+ * @class TrajectoryBatch
+ * @brief All the candidate trajectories of one control cycle in structure-of-arrays form
+ *
+ * The poses of every trajectory are stored back to back in shared x, y, theta and
+ * time arrays. clear() keeps the capacity, so a batch reused from cycle to cycle
+ * stops allocating once it has grown to the largest candidate set.
+ */
+class TrajectoryBatch
+{
+public:
+  /**
+   * @brief Remove all trajectories, keeping the allocated storage
+   */
+  void clear();
+
+  /**
+   * @brief Reserve storage for a number of trajectories and poses in total
+   */
+  void reserve(std::size_t num_trajectories, std::size_t num_poses);
+
+  /**
+   * @brief Number of trajectories in the batch
+   */
+  std::size_t size() const {return velocities_.size();}
+
+  /**
+   * @brief Start a new, empty trajectory
+   * @param velocity The command velocity the trajectory is generated from
+   * @return Index of the new trajectory
+   */
+  std::size_t addTrajectory(const nav_2d_msgs::msg::Twist2D & velocity);
+
+  /**
+   * @brief Append a whole trajectory message to the batch
+   * @return Index of the new trajectory
+   */
+  std::size_t addTrajectory(const dwb_msgs::msg::Trajectory2D & traj);
+
+  /**
+   * @brief Start a new trajectory of a fixed number of poses, to be filled in with setPose()
+   * @param velocity The command velocity the trajectory is generated from
+   * @param num_poses Number of poses of the trajectory
+   * @return Index of the new trajectory
+   */
+  std::size_t addTrajectory(const nav_2d_msgs::msg::Twist2D & velocity, std::size_t num_poses);
+
+  /**
+   * @brief Overwrite the pose at an index of the pose arrays
+   */
+  void setPose(std::size_t pose_index, double x, double y, double theta, double time_offset)
+  {
+    x_[pose_index] = x;
+    y_[pose_index] = y;
+    theta_[pose_index] = theta;
+    time_[pose_index] = time_offset;
+  }
+
+  /**
+   * @brief Append a pose to the trajectory added last
+   * @param time_offset Time of the pose, ignored for the first pose of a trajectory
+   */
+  void addPose(double x, double y, double theta, double time_offset)
+  {
+    x_.push_back(x);
+    y_.push_back(y);
+    theta_.push_back(theta);
+    time_.push_back(time_offset);
+    offsets_.back()++;
+  }
+
+  /**
+   * @brief Index of the first pose of trajectory i in the pose arrays
+   */
+  std::size_t begin(std::size_t i) const {return offsets_[i];}
+
+  /**
+   * @brief Index one past the last pose of trajectory i in the pose arrays
+   */
+  std::size_t end(std::size_t i) const {return offsets_[i + 1];}
+
+  const double * x() const {return x_.data();}
+  const double * y() const {return y_.data();}
+  const double * theta() const {return theta_.data();}
+  const double * time() const {return time_.data();}
+
+  /**
+   * @brief Pose at an index of the pose arrays
+   */
+  geometry_msgs::msg::Pose2D getPose(std::size_t pose_index) const
+  {
+    geometry_msgs::msg::Pose2D pose;
+    pose.x = x_[pose_index];
+    pose.y = y_[pose_index];
+    pose.theta = theta_[pose_index];
+    return pose;
+  }
+
+  const nav_2d_msgs::msg::Twist2D & velocity(std::size_t i) const {return velocities_[i];}
+
+  /**
+   * @brief Whether no critic rejected trajectory i yet
+   */
+  bool isLegal(std::size_t i) const {return legal_[i] != 0;}
+  void setLegal(std::size_t i, bool legal) {legal_[i] = legal;}
+
+  /**
+   * @brief Build the message for trajectory i
+   *
+   * As with TrajectoryGenerator::generateTrajectory, the first pose has no time offset.
+   */
+  dwb_msgs::msg::Trajectory2D toMsg(std::size_t i) const;
+
+protected:
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> theta_;
+  std::vector<double> time_;
+  // offsets_[i] is the first pose of trajectory i, with one extra entry at the end
+  std::vector<std::size_t> offsets_{0};
+  std::vector<nav_2d_msgs::msg::Twist2D> velocities_;
+  // Not a vector<bool>, so that different trajectories can be updated from different threads
+  std::vector<unsigned char> legal_;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__TRAJECTORY_BATCH_HPP_
@@ -45,6 +45,8 @@
 #include "nav_2d_msgs/msg/twist2_d.hpp"
 #include "nav_2d_msgs/msg/path2_d.hpp"
 #include "dwb_msgs/msg/trajectory2_d.hpp"
+#include "dwb_core/exceptions.hpp"
+#include "dwb_core/trajectory_batch.hpp"
 #include "sensor_msgs/msg/point_cloud.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
@@ -90,15 +92,19 @@ public:
    * @param name The name of this critic
    * @param parent_namespace The namespace of the planner
    * @param costmap_ros Pointer to the costmap
+   * @param costmap Grid to score against, kept in sync by the planner, or nullptr for
+   * the live master grid of costmap_ros
    */
   void initialize(
     const nav2_util::LifecycleNode::SharedPtr & nh,
     std::string & name,
     std::string & ns,
-    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros)
+    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros,
+    nav2_costmap_2d::Costmap2D * costmap = nullptr)
   {
     name_ = name;
     costmap_ros_ = costmap_ros;
+    scoring_costmap_ = costmap;
     nh_ = nh;
     dwb_plugin_name_ = ns;
     if (!nh_->has_parameter(dwb_plugin_name_ + "." + name_ + ".scale")) {
@@ -145,6 +151,63 @@ public:
    */
   virtual double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) = 0;
 
+  /**
+   * @brief Return raw scores for a range of the trajectories of a batch
+   *
+   * Trajectories the batch already marks illegal are skipped. A critic rejects a
+   * trajectory by setting its entry of failures to the reason, the message of the
+   * IllegalTrajectoryException scoreTrajectory would throw. The default builds
+   * the message of each trajectory and calls scoreTrajectory.
+   *
+   * @param batch The trajectories of this cycle
+   * @param first First trajectory to score
+   * @param last One past the last trajectory to score
+   * @param scores Output, raw score of each trajectory, indexed like the batch
+   * @param failures Output, why each rejected trajectory is illegal, indexed like the batch
+   */
+  virtual void scoreTrajectories(
+    const TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures)
+  {
+    for (std::size_t i = first; i < last; i++) {
+      if (!batch.isLegal(i)) {
+        continue;
+      }
+      try {
+        scores[i] = scoreTrajectory(batch.toMsg(i));
+      } catch (const IllegalTrajectoryException & e) {
+        failures[i] = e.what();
+      }
+    }
+  }
+
+  /**
+   * @brief Whether scoreTrajectory may be called from several threads at once
+   *
+   * Critics that only read state set up in prepare() can return true, which
+   * lets the planner score trajectories in parallel. Critics that keep state
+   * across scoreTrajectory calls must keep the default.
+   */
+  virtual bool isThreadSafe() const {return false;}
+
+  /**
+   * @brief Whether prepare() only depends on the transformed plan and the costmap
+   *
+   * Once it succeeded, the planner skips prepare() until either changes. Critics
+   * also reading the pose, velocity or goal, or updating state in prepare(), must
+   * keep the default.
+   */
+  virtual bool preparesFromPlanAndCostmap() const {return false;}
+
+  /**
+   * @brief Whether the critic reads the costmap only through getCostmap(), or not at all
+   *
+   * The planner then scores against its copy without locking the live costmap. While
+   * any loaded critic keeps the default, e.g. one reading costmap_ros_->getCostmap(),
+   * the planner holds the lock of the live costmap for the whole scoring pass.
+   */
+  virtual bool usesScoringCostmap() const {return false;}
+
   /**
    * @brief debrief informs the critic what the chosen cmd_vel was (if it cares)
    */
@@ -177,9 +240,46 @@ public:
   void setScale(const double scale) {scale_ = scale;}
 
 protected:
+  /**
+   * @brief scoreTrajectories for critics whose scoreTrajectory only reads the velocity
+   *
+   * The messages passed to scoreTrajectory carry the velocity but no poses, so
+   * they do not allocate.
+   */
+  void scoreVelocities(
+    const TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures)
+  {
+    dwb_msgs::msg::Trajectory2D traj;
+    for (std::size_t i = first; i < last; i++) {
+      if (!batch.isLegal(i)) {
+        continue;
+      }
+      traj.velocity = batch.velocity(i);
+      try {
+        scores[i] = scoreTrajectory(traj);
+      } catch (const IllegalTrajectoryException & e) {
+        failures[i] = e.what();
+      }
+    }
+  }
+
+  /**
+   * @brief The grid to score against
+   *
+   * The planner refreshes it before prepare() without any lock held on the live
+   * costmap, so critics should read this rather than costmap_ros_->getCostmap(), and
+   * say so with usesScoringCostmap().
+   */
+  nav2_costmap_2d::Costmap2D * getCostmap() const
+  {
+    return scoring_costmap_ ? scoring_costmap_ : costmap_ros_->getCostmap();
+  }
+
   std::string name_;
   std::string dwb_plugin_name_;
   std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
+  nav2_costmap_2d::Costmap2D * scoring_costmap_{nullptr};
   double scale_;
   nav2_util::LifecycleNode::SharedPtr nh_;
 };
@@ -41,6 +41,7 @@
 #include "rclcpp/rclcpp.hpp"
 #include "nav_2d_msgs/msg/twist2_d.hpp"
 #include "dwb_msgs/msg/trajectory2_d.hpp"
+#include "dwb_core/trajectory_batch.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace dwb_core
@@ -94,6 +95,16 @@ public:
    */
   virtual nav_2d_msgs::msg::Twist2D nextTwist() = 0;
 
+  /**
+   * @brief Report the total score of a twist of the current iteration
+   *
+   * Adaptive generators use it to choose the twists that follow and to warm start the next
+   * iteration. Twists requested through getTwists() are reported after they are all scored.
+   * @param twist A twist returned by nextTwist()
+   * @param score Its total score (lower is better), negative if it was illegal
+   */
+  virtual void reportScore(const nav_2d_msgs::msg::Twist2D & /*twist*/, double /*score*/) {}
+
   /**
    * @brief Get all the twists for an iteration.
    *
@@ -123,6 +134,36 @@ public:
     const geometry_msgs::msg::Pose2D & start_pose,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const nav_2d_msgs::msg::Twist2D & cmd_vel) = 0;
+
+  /**
+   * @brief Generate the trajectories for a set of twists straight into a batch
+   *
+   * The default goes through generateTrajectory. Generators can override it to
+   * write the poses directly, without building a message per trajectory.
+   *
+   * @param start_pose The starting pose of the robot
+   * @param start_vel The starting velocity of the robot
+   * @param cmd_vels The commanded velocities to generate trajectories for
+   * @param batch Output, the trajectories are appended to it in the order of cmd_vels
+   */
+  virtual void generateTrajectories(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+    TrajectoryBatch & batch)
+  {
+    for (const auto & cmd_vel : cmd_vels) {
+      batch.addTrajectory(generateTrajectory(start_pose, start_vel, cmd_vel));
+    }
+  }
+
+  /**
+   * @brief Whether generateTrajectory may be called from several threads at once
+   *
+   * Generators that do not modify their state in generateTrajectory can return
+   * true, which lets the planner generate trajectories in parallel.
+   */
+  virtual bool isThreadSafe() const {return false;}
 };
 
 }  // namespace dwb_core
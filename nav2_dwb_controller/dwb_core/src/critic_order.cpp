@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dwb_core/critic_order.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace dwb_core
+{
+
+void CriticOrder::reset(std::size_t num_critics)
+{
+  stats_.assign(num_critics, Stats());
+  order_.resize(num_critics);
+  std::iota(order_.begin(), order_.end(), 0);
+}
+
+void CriticOrder::record(
+  std::size_t critic, int64_t elapsed_ns, std::size_t tried, std::size_t rejected)
+{
+  Stats & stats = stats_[critic];
+  stats.cycle_ns += elapsed_ns;
+  stats.cycle_tried += tried;
+  stats.cycle_rejected += rejected;
+}
+
+void CriticOrder::update()
+{
+  bool changed = false;
+  for (auto & stats : stats_) {
+    if (stats.cycle_tried == 0) {
+      continue;
+    }
+    const double tried = static_cast<double>(stats.cycle_tried);
+    const double ns = static_cast<double>(stats.cycle_ns) / tried;
+    const double rate = static_cast<double>(stats.cycle_rejected) / tried;
+    if (stats.sampled) {
+      stats.ns_per_trajectory += kSmoothing * (ns - stats.ns_per_trajectory);
+      stats.rejection_rate += kSmoothing * (rate - stats.rejection_rate);
+    } else {
+      stats.ns_per_trajectory = ns;
+      stats.rejection_rate = rate;
+      stats.sampled = true;
+    }
+    stats.cycle_ns = 0;
+    stats.cycle_tried = 0;
+    stats.cycle_rejected = 0;
+    changed = true;
+  }
+  if (!changed) {
+    return;
+  }
+
+  // Cost per rejection, then cost. Critics not sampled yet keep their place
+  // behind the sampled ones
+  const double infinity = std::numeric_limits<double>::infinity();
+  auto key = [this, infinity](std::size_t c) {
+      const Stats & stats = stats_[c];
+      if (!stats.sampled) {
+        return std::make_pair(infinity, infinity);
+      }
+      const double per_rejection = stats.rejection_rate > 0.0 ?
+        stats.ns_per_trajectory / stats.rejection_rate : infinity;
+      return std::make_pair(per_rejection, stats.ns_per_trajectory);
+    };
+  std::iota(order_.begin(), order_.end(), 0);
+  std::stable_sort(
+    order_.begin(), order_.end(),
+    [&key](std::size_t a, std::size_t b) {return key(a) < key(b);});
+}
+
+}  // namespace dwb_core
@@ -33,6 +33,8 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
@@ -45,9 +47,11 @@
 #include "nav_2d_msgs/msg/twist2_d.hpp"
 #include "nav_2d_utils/conversions.hpp"
 #include "nav_2d_utils/parameters.hpp"
+#include "nav_2d_utils/path_ops.hpp"
 #include "nav_2d_utils/tf_help.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "geometry_msgs/msg/twist_stamped.hpp"
@@ -57,6 +61,27 @@ using nav2_util::declare_parameter_if_not_declared;
 namespace dwb_core
 {
 
+namespace
+{
+
+bool
+samePath(const nav_2d_msgs::msg::Path2D & a, const nav_2d_msgs::msg::Path2D & b)
+{
+  if (a.header.frame_id != b.header.frame_id || a.poses.size() != b.poses.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.poses.size(); i++) {
+    if (a.poses[i].x != b.poses[i].x || a.poses[i].y != b.poses[i].y ||
+      a.poses[i].theta != b.poses[i].theta)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 DWBLocalPlanner::DWBLocalPlanner()
 : traj_gen_loader_("dwb_core", "dwb_core::TrajectoryGenerator"),
   critic_loader_("dwb_core", "dwb_core::TrajectoryCritic")
@@ -92,6 +117,21 @@ void DWBLocalPlanner::configure(
   declare_parameter_if_not_declared(
     node_, dwb_plugin_name_ + ".short_circuit_trajectory_evaluation",
     rclcpp::ParameterValue(true));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".adaptive_critic_order",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".parallel_scoring_threads",
+    rclcpp::ParameterValue(1));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".batch_scoring",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".time_budget",
+    rclcpp::ParameterValue(0.0));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".diagnostics_period",
+    rclcpp::ParameterValue(1.0));
 
   std::string traj_generator_name;
 
@@ -107,6 +147,14 @@ void DWBLocalPlanner::configure(
   node_->get_parameter(
     dwb_plugin_name_ + ".short_circuit_trajectory_evaluation",
     short_circuit_trajectory_evaluation_);
+  node_->get_parameter(dwb_plugin_name_ + ".adaptive_critic_order", adaptive_critic_order_);
+  node_->get_parameter(dwb_plugin_name_ + ".batch_scoring", batch_scoring_);
+
+  double time_budget;
+  node_->get_parameter(dwb_plugin_name_ + ".time_budget", time_budget);
+  time_budget_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(std::max(time_budget, 0.0)));
+  node_->get_parameter(dwb_plugin_name_ + ".diagnostics_period", diagnostics_period_);
 
   pub_ = std::make_unique<DWBPublisher>(node_, dwb_plugin_name_);
   pub_->on_configure();
@@ -115,24 +163,74 @@ void DWBLocalPlanner::configure(
 
   traj_generator_->initialize(node_, dwb_plugin_name_);
 
+  scoring_costmap_ = std::make_unique<nav2_costmap_2d::Costmap2D>();
+  scoring_sequence_valid_ = false;
+  refreshScoringCostmap();
+
   try {
     loadCritics();
   } catch (const std::exception & e) {
     RCLCPP_ERROR(node_->get_logger(), "Couldn't load critics! Caught exception: %s", e.what());
     throw;
   }
+  critic_order_.reset(critics_.size());
+  prepared_.assign(critics_.size(), 0);
+
+  lock_live_costmap_ = !std::all_of(
+    critics_.begin(), critics_.end(),
+    [](const TrajectoryCritic::Ptr & critic) {return critic->usesScoringCostmap();});
+  if (lock_live_costmap_) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Not all critics read the scoring copy of the costmap, scoring under its lock");
+  }
+
+  int parallel_scoring_threads;
+  node_->get_parameter(dwb_plugin_name_ + ".parallel_scoring_threads", parallel_scoring_threads);
+  parallel_scoring_ = false;
+  if (parallel_scoring_threads != 1) {
+    parallel_scoring_ = std::all_of(
+      critics_.begin(), critics_.end(),
+      [](const TrajectoryCritic::Ptr & critic) {return critic->isThreadSafe();});
+    if (parallel_scoring_) {
+      scoring_pool_ = std::make_unique<nav2_util::ThreadPool>(
+        nav2_util::TaskPriority::CONTROL, std::max(parallel_scoring_threads, 0));
+      RCLCPP_INFO(
+        node_->get_logger(), "Scoring trajectories on %u threads", scoring_pool_->size());
+    } else {
+      RCLCPP_WARN(
+        node_->get_logger(), "Not all critics are thread safe, scoring trajectories serially");
+    }
+  }
+
+  if (diagnostics_period_ > 0.0) {
+    timing_stats_ = std::make_shared<nav2_util::TimingStats>();
+    cycle_timing_ = &timing_stats_->histogram("compute_velocity_commands");
+    prepare_timings_.clear();
+    score_timings_.clear();
+    for (const TrajectoryCritic::Ptr & critic : critics_) {
+      prepare_timings_.push_back(&timing_stats_->histogram(critic->getName() + " prepare"));
+      score_timings_.push_back(&timing_stats_->histogram(critic->getName() + " score"));
+    }
+  }
 }
 
 void
 DWBLocalPlanner::activate()
 {
   pub_->on_activate();
+  if (timing_stats_) {
+    timing_diagnostics_ = std::make_unique<nav2_util::TimingDiagnostics>(
+      node_, timing_stats_, std::string(node_->get_name()) + "/" + dwb_plugin_name_,
+      std::chrono::duration<double>(diagnostics_period_));
+  }
 }
 
 void
 DWBLocalPlanner::deactivate()
 {
   pub_->on_deactivate();
+  timing_diagnostics_.reset();
 }
 
 void
@@ -141,6 +239,15 @@ DWBLocalPlanner::cleanup()
   pub_->on_cleanup();
 
   traj_generator_.reset();
+  critics_.clear();
+  scoring_costmap_.reset();
+  scoring_pool_.reset();
+  parallel_scoring_ = false;
+
+  prepare_timings_.clear();
+  score_timings_.clear();
+  cycle_timing_ = nullptr;
+  timing_stats_.reset();
 }
 
 std::string
@@ -192,7 +299,8 @@ DWBLocalPlanner::loadCritics()
       "Using critic \"%s\" (%s)", critic_plugin_name.c_str(), plugin_class.c_str());
     critics_.push_back(plugin);
     try {
-      plugin->initialize(node_, critic_plugin_name, dwb_plugin_name_, costmap_ros_);
+      plugin->initialize(
+        node_, critic_plugin_name, dwb_plugin_name_, costmap_ros_, scoring_costmap_.get());
     } catch (const std::exception & e) {
       RCLCPP_ERROR(node_->get_logger(), "Couldn't initialize critic plugin!");
       throw;
@@ -257,15 +365,29 @@ DWBLocalPlanner::loadBackwardsCompatibleParameters()
 void
 DWBLocalPlanner::setPlan(const nav_msgs::msg::Path & path)
 {
-  auto path2d = nav_2d_utils::pathToPath2D(path);
+  setPlan2D(nav_2d_utils::pathToPath2D(path));
+}
+
+void
+DWBLocalPlanner::setPlan(const nav2_msgs::msg::CompactPath & path)
+{
+  setPlan2D(nav_2d_utils::compactPathToPath2D(path));
+}
+
+void
+DWBLocalPlanner::setPlan2D(nav_2d_msgs::msg::Path2D && path2d)
+{
   for (TrajectoryCritic::Ptr critic : critics_) {
     critic->reset();
   }
+  prepared_.assign(critics_.size(), 0);
 
   traj_generator_->reset();
 
   pub_->publishGlobalPlan(path2d);
-  global_plan_ = path2d;
+  global_plan_ = std::move(path2d);
+  plan_first_index_ = 0;
+  plan_start_index_ = 0;
 }
 
 geometry_msgs::msg::TwistStamped
@@ -315,6 +437,13 @@ DWBLocalPlanner::computeVelocityCommands(
   const nav_2d_msgs::msg::Twist2D & velocity,
   std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results)
 {
+  nav2_util::ScopedTrace trace(
+    "dwb.compute_velocity_commands", dwb_plugin_name_, nav2_util::traceStamp(pose.header.stamp));
+  nav2_util::ScopedTiming timing(cycle_timing_);
+
+  // The budget covers the whole cycle, including preparing the critics
+  cycle_deadline_ = std::chrono::steady_clock::now() + time_budget_;
+
   if (results) {
     results->header.frame_id = pose.header.frame_id;
     results->header.stamp = node_->now();
@@ -325,12 +454,30 @@ DWBLocalPlanner::computeVelocityCommands(
 
   prepareGlobalPlan(pose, transformed_plan, goal_pose);
 
-  nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
-  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap->getMutex()));
+  // The critics score against a copy, so the costmap keeps updating meanwhile
+  if (refreshScoringCostmap() || !samePath(transformed_plan, prepared_plan_)) {
+    prepared_.assign(critics_.size(), 0);
+    prepared_plan_ = transformed_plan;
+  }
 
-  for (TrajectoryCritic::Ptr critic : critics_) {
+  // Unless a critic reads the live grid, which must then not update until the cycle ends
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> live_lock;
+  if (lock_live_costmap_) {
+    live_lock = std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t>(
+      *(costmap_ros_->getCostmap()->getMutex()));
+  }
+
+  for (size_t c = 0; c < critics_.size(); c++) {
+    if (prepared_[c]) {
+      continue;
+    }
+    const TrajectoryCritic::Ptr & critic = critics_[c];
+    nav2_util::ScopedTrace prepare_trace("dwb.prepare", critic->getName());
+    nav2_util::ScopedTiming prepare_timing(timing_stats_ ? prepare_timings_[c] : nullptr);
     if (critic->prepare(pose.pose, velocity, goal_pose.pose, transformed_plan) == false) {
       RCLCPP_WARN(rclcpp::get_logger("DWBLocalPlanner"), "A scoring function failed to prepare");
+    } else {
+      prepared_[c] = critic->preparesFromPlanAndCostmap();
     }
   }
 
@@ -341,35 +488,57 @@ DWBLocalPlanner::computeVelocityCommands(
     nav_2d_msgs::msg::Twist2DStamped cmd_vel;
     cmd_vel.header.stamp = node_->now();
     cmd_vel.velocity = best.traj.velocity;
+    last_cmd_ = cmd_vel.velocity;
 
     // debrief stateful scoring functions
     for (TrajectoryCritic::Ptr critic : critics_) {
       critic->debrief(cmd_vel.velocity);
     }
 
-    lock.unlock();
-
     pub_->publishLocalPlan(pose.header, best.traj);
-    pub_->publishCostGrid(costmap_ros_, critics_);
+    pub_->publishCostGrid(costmap_ros_, critics_, scoring_costmap_.get());
 
     return cmd_vel;
   } catch (const dwb_core::NoLegalTrajectoriesException & e) {
     nav_2d_msgs::msg::Twist2D empty_cmd;
     dwb_msgs::msg::Trajectory2D empty_traj;
+    last_cmd_ = empty_cmd;
     // debrief stateful scoring functions
     for (TrajectoryCritic::Ptr critic : critics_) {
       critic->debrief(empty_cmd);
     }
 
-    lock.unlock();
-
     pub_->publishLocalPlan(pose.header, empty_traj);
-    pub_->publishCostGrid(costmap_ros_, critics_);
+    pub_->publishCostGrid(costmap_ros_, critics_, scoring_costmap_.get());
 
     throw;
   }
 }
 
+bool
+DWBLocalPlanner::refreshScoringCostmap()
+{
+  uint64_t sequence;
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot(sequence);
+  if (snapshot) {
+    if (scoring_sequence_valid_ && sequence == scoring_sequence_) {
+      return false;
+    }
+    *scoring_costmap_ = *snapshot;
+    scoring_sequence_ = sequence;
+    scoring_sequence_valid_ = true;
+    return true;
+  }
+
+  // No update has completed yet, copy the master grid itself
+  nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap->getMutex()));
+  *scoring_costmap_ = *costmap;
+  scoring_sequence_valid_ = false;
+  return true;
+}
+
 dwb_msgs::msg::TrajectoryScore
 DWBLocalPlanner::coreScoringAlgorithm(
   const geometry_msgs::msg::Pose2D & pose,
@@ -381,47 +550,116 @@ DWBLocalPlanner::coreScoringAlgorithm(
   dwb_msgs::msg::TrajectoryScore best, worst;
   best.total = -1;
   worst.total = -1;
-  IllegalTrajectoryTracker tracker;
+  IllegalTrajectoryTracker & tracker = tracker_;
+  tracker.reset();
+  num_skipped_ = 0;
 
-  traj_generator_->startNewIteration(velocity);
-  while (traj_generator_->hasMoreTwists()) {
-    twist = traj_generator_->nextTwist();
-    traj = traj_generator_->generateTrajectory(pose, velocity, twist);
+  updateCriticScales();
 
-    try {
-      dwb_msgs::msg::TrajectoryScore score = scoreTrajectory(traj, best.total);
-      tracker.addLegalTrajectory();
-      if (results) {
-        results->twists.push_back(score);
+  if (batch_scoring_) {
+    scoreTrajectoryBatch(pose, velocity, results, best, worst, tracker);
+  } else if (parallel_scoring_) {
+    scoreTrajectoriesInParallel(pose, velocity, results, best, worst, tracker);
+  } else {
+    // Critics are timed call by call here, and their times are summed over the
+    // cycle into one span and one sample per critic rather than one per trajectory
+    const bool tracing = nav2_util::TraceBuffer::instance().enabled();
+    time_critics_ = tracing || timing_stats_;
+    const int64_t trace_start_ns = tracing ? nav2_util::TraceBuffer::now() : 0;
+    if (time_critics_) {
+      critic_time_ns_.assign(critics_.size(), 0);
+      critic_calls_.assign(critics_.size(), 0);
+    }
+    sample_critics_ = adaptive_critic_order_;
+
+    // Without results, only the best trajectory and its raw scores are kept
+    dwb_msgs::msg::Trajectory2D best_traj;
+    size_t best_num_scored = 0;
+    raw_scores_.resize(critics_.size());
+    best_raw_scores_.resize(critics_.size());
+
+    // In anytime mode the candidates are taken up front, so that the most
+    // promising ones are scored before the deadline
+    const bool anytime = time_budget_.count() > 0;
+    std::vector<nav_2d_msgs::msg::Twist2D> candidates;
+    size_t next_candidate = 0;
+    if (anytime) {
+      candidates = traj_generator_->getTwists(velocity);
+      orderCandidates(candidates);
+    } else {
+      traj_generator_->startNewIteration(velocity);
+    }
+
+    while (anytime ? next_candidate < candidates.size() : traj_generator_->hasMoreTwists()) {
+      if (anytime && best.total >= 0 && pastDeadline()) {
+        num_skipped_ = candidates.size() - next_candidate;
+        break;
       }
-      if (best.total < 0 || score.total < best.total) {
-        best = score;
+      twist = anytime ? candidates[next_candidate++] : traj_generator_->nextTwist();
+      traj = traj_generator_->generateTrajectory(pose, velocity, twist);
+
+      try {
+        size_t num_scored;
+        double total = scoreTrajectoryRaw(traj, best.total, raw_scores_.data(), num_scored);
+        traj_generator_->reportScore(twist, total);
         if (results) {
-          results->best_index = results->twists.size() - 1;
+          addLegalScore(
+            getTrajectoryScore(traj, raw_scores_.data(), num_scored, total),
+            results, best, worst, tracker);
+          continue;
         }
-      }
-      if (worst.total < 0 || score.total > worst.total) {
-        worst = score;
-        if (results) {
-          results->worst_index = results->twists.size() - 1;
+
+        tracker.addLegalTrajectory();
+        if (best.total < 0 || total < best.total) {
+          best.total = total;
+          best_traj.poses.swap(traj.poses);
+          best_traj.time_offsets.swap(traj.time_offsets);
+          best_traj.velocity = traj.velocity;
+          raw_scores_.swap(best_raw_scores_);
+          best_num_scored = num_scored;
         }
+      } catch (const dwb_core::IllegalTrajectoryException & e) {
+        traj_generator_->reportScore(twist, -1.0);
+        addIllegalScore(traj, e, results, tracker);
       }
-    } catch (const dwb_core::IllegalTrajectoryException & e) {
-      if (results) {
-        dwb_msgs::msg::TrajectoryScore failed_score;
-        failed_score.traj = traj;
-
-        dwb_msgs::msg::CriticScore cs;
-        cs.name = e.getCriticName();
-        cs.raw_score = -1.0;
-        failed_score.scores.push_back(cs);
-        failed_score.total = -1.0;
-        results->twists.push_back(failed_score);
+    }
+
+    if (!results && best.total >= 0) {
+      best = getTrajectoryScore(best_traj, best_raw_scores_.data(), best_num_scored, best.total);
+    }
+
+    sample_critics_ = false;
+    if (time_critics_) {
+      time_critics_ = false;
+      for (size_t c = 0; c < critics_.size(); c++) {
+        if (critic_calls_[c] == 0) {
+          continue;
+        }
+        if (tracing) {
+          nav2_util::TraceBuffer::instance().recordSummed(
+            "dwb.score", critics_[c]->getName(), trace_start_ns, critic_time_ns_[c],
+            critic_calls_[c]);
+        }
+        if (timing_stats_) {
+          score_timings_[c]->record(critic_time_ns_[c]);
+        }
       }
-      tracker.addIllegalTrajectory(e);
     }
   }
 
+  if (adaptive_critic_order_) {
+    critic_order_.update();
+  }
+
+  if (num_skipped_ > 0) {
+    RCLCPP_DEBUG(
+      rclcpp::get_logger("DWBLocalPlanner"),
+      "Time budget ran out, %zu trajectories were not scored", num_skipped_);
+  }
+  if (results) {
+    results->num_skipped = num_skipped_;
+  }
+
   if (best.total < 0) {
     if (debug_trajectory_details_) {
       RCLCPP_ERROR(rclcpp::get_logger("DWBLocalPlanner"), "%s", tracker.getMessage().c_str());
@@ -438,34 +676,421 @@ DWBLocalPlanner::coreScoringAlgorithm(
   return best;
 }
 
+void
+DWBLocalPlanner::scoreTrajectoriesInParallel(
+  const geometry_msgs::msg::Pose2D & pose,
+  const nav_2d_msgs::msg::Twist2D & velocity,
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+  dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+  IllegalTrajectoryTracker & tracker)
+{
+  std::vector<nav_2d_msgs::msg::Twist2D> twists = traj_generator_->getTwists(velocity);
+  const bool anytime = time_budget_.count() > 0;
+  // Around the previous command first. The best total found early bounds
+  // the short circuiting of the other tasks sooner
+  if (anytime || short_circuit_trajectory_evaluation_) {
+    orderCandidates(twists);
+  }
+  std::vector<dwb_msgs::msg::Trajectory2D> & trajs = parallel_trajs_;
+  std::vector<std::unique_ptr<IllegalTrajectoryException>> & failures = parallel_failures_;
+  std::vector<char> & skipped = parallel_skipped_;
+  trajs.resize(twists.size());
+  failures.clear();
+  failures.resize(twists.size());
+  skipped.assign(twists.size(), 0);
+
+  // One row of raw scores per trajectory
+  const size_t num_critics = critics_.size();
+  score_matrix_.resize(twists.size() * num_critics);
+  num_scored_.resize(twists.size());
+  totals_.resize(twists.size());
+
+  // Generators that are not reentrant run up front on this thread
+  bool parallel_generation = traj_generator_->isThreadSafe();
+  if (!parallel_generation) {
+    for (size_t i = 0; i < twists.size(); i++) {
+      trajs[i] = traj_generator_->generateTrajectory(pose, velocity, twists[i]);
+    }
+  }
+
+  // Short circuiting compares against the best total found by any thread so
+  // far. The best trajectory always scores below it, so it is never cut short
+  // and the reduction below picks the same one as the serial loop.
+  std::atomic<double> shared_best{-1.0};
+  scoring_pool_->parallelFor(
+    twists.size(), [&](size_t i) {
+      // Tasks are handed out in order, so the skipped ones are the least promising
+      if (anytime && shared_best.load() >= 0 && pastDeadline()) {
+        skipped[i] = 1;
+        return;
+      }
+      if (parallel_generation) {
+        trajs[i] = traj_generator_->generateTrajectory(pose, velocity, twists[i]);
+      }
+      double total;
+      try {
+        total = scoreTrajectoryRaw(
+          trajs[i], shared_best.load(), &score_matrix_[i * num_critics], num_scored_[i]);
+      } catch (const dwb_core::IllegalTrajectoryException & e) {
+        failures[i] = std::make_unique<IllegalTrajectoryException>(e);
+        return;
+      }
+      totals_[i] = total;
+
+      double current = shared_best.load();
+      while ((current < 0 || total < current) &&
+      !shared_best.compare_exchange_weak(current, total))
+      {
+      }
+    });
+
+  size_t best_index = twists.size();
+  for (size_t i = 0; i < twists.size(); i++) {
+    if (skipped[i]) {
+      num_skipped_++;
+      continue;
+    }
+    traj_generator_->reportScore(twists[i], failures[i] ? -1.0 : totals_[i]);
+    if (failures[i]) {
+      addIllegalScore(trajs[i], *failures[i], results, tracker);
+    } else if (results) {
+      addLegalScore(
+        getTrajectoryScore(trajs[i], &score_matrix_[i * num_critics], num_scored_[i], totals_[i]),
+        results, best, worst, tracker);
+    } else {
+      tracker.addLegalTrajectory();
+      if (best.total < 0 || totals_[i] < best.total) {
+        best.total = totals_[i];
+        best_index = i;
+      }
+    }
+  }
+
+  if (best_index < twists.size()) {
+    best = getTrajectoryScore(
+      trajs[best_index], &score_matrix_[best_index * num_critics], num_scored_[best_index],
+      totals_[best_index]);
+  }
+}
+
+void
+DWBLocalPlanner::scoreTrajectoryBatch(
+  const geometry_msgs::msg::Pose2D & pose,
+  const nav_2d_msgs::msg::Twist2D & velocity,
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+  dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+  IllegalTrajectoryTracker & tracker)
+{
+  batch_twists_ = traj_generator_->getTwists(velocity);
+  const size_t n = batch_twists_.size();
+  batch_.clear();
+  traj_generator_->generateTrajectories(pose, velocity, batch_twists_, batch_);
+
+  batch_scores_.resize(critics_.size());
+  for (size_t c = 0; c < critics_.size(); c++) {
+    batch_scores_[c].assign(n, 0.0);
+  }
+  batch_failures_.assign(n, std::string());
+  batch_failed_critic_.assign(n, 0);
+
+  // Critic by critic, so that each critic's loop stays hot. A trajectory
+  // rejected by one critic is skipped by the following ones
+  auto score_range = [this](size_t first, size_t last) {
+      // The first chunk is scored by a single task, so it can feed the critic
+      // order without locking
+      const bool sampled = adaptive_critic_order_ && first == 0;
+      for (size_t c : critic_order_.order()) {
+        if (critic_scales_[c] == 0.0) {
+          continue;
+        }
+        size_t tried = 0;
+        if (sampled) {
+          for (size_t i = first; i < last; i++) {
+            tried += batch_.isLegal(i) ? 1 : 0;
+          }
+        }
+        // Chunks scored on the pool would each make a span and a sample, only the
+        // serial pass is traced and timed per critic
+        const bool trace = !parallel_scoring_ && nav2_util::TraceBuffer::instance().enabled();
+        const bool timed = !parallel_scoring_ && timing_stats_;
+        const int64_t start_ns = trace || timed || sampled ? nav2_util::TraceBuffer::now() : 0;
+        critics_[c]->scoreTrajectories(batch_, first, last, batch_scores_[c], batch_failures_);
+        const int64_t elapsed_ns = sampled ? nav2_util::TraceBuffer::now() - start_ns : 0;
+        if (trace || timed) {
+          const int64_t elapsed_ns = nav2_util::TraceBuffer::now() - start_ns;
+          if (trace) {
+            nav2_util::TraceBuffer::instance().recordSummed(
+              "dwb.score", critics_[c]->getName(), start_ns, elapsed_ns,
+              static_cast<uint32_t>(last - first));
+          }
+          if (timed) {
+            score_timings_[c]->record(elapsed_ns);
+          }
+        }
+        size_t rejected = 0;
+        for (size_t i = first; i < last; i++) {
+          if (batch_.isLegal(i) && !batch_failures_[i].empty()) {
+            batch_.setLegal(i, false);
+            batch_failed_critic_[i] = c;
+            rejected++;
+          }
+        }
+        if (sampled) {
+          critic_order_.record(c, elapsed_ns, tried, rejected);
+        }
+      }
+    };
+
+  if (parallel_scoring_) {
+    const size_t chunk = 32;
+    scoring_pool_->parallelFor(
+      (n + chunk - 1) / chunk, [&](size_t k) {
+        score_range(k * chunk, std::min(n, (k + 1) * chunk));
+      });
+  } else {
+    score_range(0, n);
+  }
+
+  size_t best_index = n, worst_index = n;
+  double best_total = -1.0, worst_total = -1.0;
+  for (size_t i = 0; i < n; i++) {
+    if (!batch_.isLegal(i)) {
+      traj_generator_->reportScore(batch_twists_[i], -1.0);
+      IllegalTrajectoryException e(
+        critics_[batch_failed_critic_[i]]->getName(), batch_failures_[i]);
+      addIllegalScore(
+        results ? batch_.toMsg(i) : dwb_msgs::msg::Trajectory2D(), e, results, tracker);
+      continue;
+    }
+
+    // Summed in critic order, as scoreTrajectory does
+    double total = 0.0;
+    for (size_t c = 0; c < critics_.size(); c++) {
+      if (critic_scales_[c] != 0.0) {
+        total += batch_scores_[c][i] * critic_scales_[c];
+      }
+    }
+
+    traj_generator_->reportScore(batch_twists_[i], total);
+    tracker.addLegalTrajectory();
+    if (results) {
+      results->twists.push_back(getBatchScore(i, total));
+    }
+    if (best_total < 0 || total < best_total) {
+      best_total = total;
+      best_index = i;
+      if (results) {
+        results->best_index = results->twists.size() - 1;
+      }
+    }
+    if (worst_total < 0 || total > worst_total) {
+      worst_total = total;
+      worst_index = i;
+      if (results) {
+        results->worst_index = results->twists.size() - 1;
+      }
+    }
+  }
+
+  if (best_index < n) {
+    best = getBatchScore(best_index, best_total);
+  }
+  if (worst_index < n && results) {
+    worst = results->twists[results->worst_index];
+  }
+}
+
+void
+DWBLocalPlanner::orderCandidates(std::vector<nav_2d_msgs::msg::Twist2D> & twists) const
+{
+  // Closest to the previous command first. The sort is stable, so equally
+  // close twists keep the order the generator produced them in
+  auto distance_sq = [this](const nav_2d_msgs::msg::Twist2D & twist) {
+      double dx = twist.x - last_cmd_.x;
+      double dy = twist.y - last_cmd_.y;
+      double dtheta = twist.theta - last_cmd_.theta;
+      return dx * dx + dy * dy + dtheta * dtheta;
+    };
+  std::vector<std::pair<double, size_t>> keys(twists.size());
+  for (size_t i = 0; i < twists.size(); i++) {
+    keys[i] = std::make_pair(distance_sq(twists[i]), i);
+  }
+  std::stable_sort(
+    keys.begin(), keys.end(),
+    [](const std::pair<double, size_t> & a, const std::pair<double, size_t> & b) {
+      return a.first < b.first;
+    });
+
+  std::vector<nav_2d_msgs::msg::Twist2D> ordered;
+  ordered.reserve(twists.size());
+  for (const auto & key : keys) {
+    ordered.push_back(twists[key.second]);
+  }
+  twists.swap(ordered);
+}
+
+bool
+DWBLocalPlanner::pastDeadline() const
+{
+  return time_budget_.count() > 0 && std::chrono::steady_clock::now() >= cycle_deadline_;
+}
+
+dwb_msgs::msg::TrajectoryScore
+DWBLocalPlanner::getBatchScore(size_t i, double total)
+{
+  dwb_msgs::msg::TrajectoryScore score;
+  score.traj = batch_.toMsg(i);
+  for (size_t c = 0; c < critics_.size(); c++) {
+    dwb_msgs::msg::CriticScore cs;
+    cs.name = critics_[c]->getName();
+    cs.scale = critic_scales_[c];
+    if (cs.scale != 0.0) {
+      cs.raw_score = batch_scores_[c][i];
+    }
+    score.scores.push_back(cs);
+  }
+  score.total = total;
+  return score;
+}
+
+void
+DWBLocalPlanner::addLegalScore(
+  const dwb_msgs::msg::TrajectoryScore & score,
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+  dwb_msgs::msg::TrajectoryScore & best, dwb_msgs::msg::TrajectoryScore & worst,
+  IllegalTrajectoryTracker & tracker)
+{
+  tracker.addLegalTrajectory();
+  if (results) {
+    results->twists.push_back(score);
+  }
+  if (best.total < 0 || score.total < best.total) {
+    best = score;
+    if (results) {
+      results->best_index = results->twists.size() - 1;
+    }
+  }
+  if (worst.total < 0 || score.total > worst.total) {
+    worst = score;
+    if (results) {
+      results->worst_index = results->twists.size() - 1;
+    }
+  }
+}
+
+void
+DWBLocalPlanner::addIllegalScore(
+  const dwb_msgs::msg::Trajectory2D & traj, const IllegalTrajectoryException & e,
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+  IllegalTrajectoryTracker & tracker)
+{
+  if (results) {
+    dwb_msgs::msg::TrajectoryScore failed_score;
+    failed_score.traj = traj;
+
+    dwb_msgs::msg::CriticScore cs;
+    cs.name = e.getCriticName();
+    cs.raw_score = -1.0;
+    failed_score.scores.push_back(cs);
+    failed_score.total = -1.0;
+    results->twists.push_back(failed_score);
+  }
+  tracker.addIllegalTrajectory(e);
+}
+
 dwb_msgs::msg::TrajectoryScore
 DWBLocalPlanner::scoreTrajectory(
   const dwb_msgs::msg::Trajectory2D & traj,
   double best_score)
 {
-  dwb_msgs::msg::TrajectoryScore score;
-  score.traj = traj;
+  updateCriticScales();
+  std::vector<double> raw_scores(critics_.size());
+  size_t num_scored;
+  double total = scoreTrajectoryRaw(traj, best_score, raw_scores.data(), num_scored);
+  return getTrajectoryScore(traj, raw_scores.data(), num_scored, total);
+}
 
-  for (TrajectoryCritic::Ptr critic : critics_) {
-    dwb_msgs::msg::CriticScore cs;
-    cs.name = critic->getName();
-    cs.scale = critic->getScale();
+void
+DWBLocalPlanner::updateCriticScales()
+{
+  critic_scales_.resize(critics_.size());
+  for (size_t c = 0; c < critics_.size(); c++) {
+    critic_scales_[c] = critics_[c]->getScale();
+  }
+}
 
-    if (cs.scale == 0.0) {
-      score.scores.push_back(cs);
+double
+DWBLocalPlanner::scoreTrajectoryRaw(
+  const dwb_msgs::msg::Trajectory2D & traj, double best_score,
+  double * raw_scores, size_t & num_scored)
+{
+  double total = 0.0;
+  num_scored = critics_.size();
+  std::fill(raw_scores, raw_scores + critics_.size(), 0.0);
+  const std::vector<size_t> & order = critic_order_.order();
+  for (size_t k = 0; k < order.size(); k++) {
+    const size_t c = order[k];
+    if (critic_scales_[c] == 0.0) {
       continue;
     }
 
-    double critic_score = critic->scoreTrajectory(traj);
-    cs.raw_score = critic_score;
-    score.scores.push_back(cs);
-    score.total += critic_score * cs.scale;
-    if (short_circuit_trajectory_evaluation_ && best_score > 0 && score.total > best_score) {
-      // since we keep adding positives, once we are worse than the best, we will stay worse
-      break;
+    const bool timed = time_critics_ || sample_critics_;
+    const int64_t start_ns = timed ? nav2_util::TraceBuffer::now() : 0;
+    try {
+      raw_scores[c] = critics_[c]->scoreTrajectory(traj);
+    } catch (const IllegalTrajectoryException &) {
+      if (sample_critics_) {
+        critic_order_.record(c, nav2_util::TraceBuffer::now() - start_ns, 1, 1);
+      }
+      throw;
+    }
+    const int64_t elapsed_ns = timed ? nav2_util::TraceBuffer::now() - start_ns : 0;
+    if (time_critics_) {
+      critic_time_ns_[c] += elapsed_ns;
+      critic_calls_[c]++;
+    }
+    total += raw_scores[c] * critic_scales_[c];
+    // since we keep adding positives, once we are worse than the best, we will stay worse
+    const bool cut_short =
+      short_circuit_trajectory_evaluation_ && best_score > 0 && total > best_score;
+    if (sample_critics_) {
+      critic_order_.record(c, elapsed_ns, 1, cut_short ? 1 : 0);
+    }
+    if (cut_short) {
+      num_scored = k + 1;
+      return total;
+    }
+  }
+
+  if (adaptive_critic_order_) {
+    // Summed again in critic order, for totals that don't depend on the order the critics ran in
+    total = 0.0;
+    for (size_t c = 0; c < critics_.size(); c++) {
+      if (critic_scales_[c] != 0.0) {
+        total += raw_scores[c] * critic_scales_[c];
+      }
     }
   }
+  return total;
+}
 
+dwb_msgs::msg::TrajectoryScore
+DWBLocalPlanner::getTrajectoryScore(
+  const dwb_msgs::msg::Trajectory2D & traj, const double * raw_scores,
+  size_t num_scored, double total)
+{
+  dwb_msgs::msg::TrajectoryScore score;
+  score.traj = traj;
+  for (size_t k = 0; k < num_scored; k++) {
+    // Trajectories cut short list the critics that ran, in the order they ran in
+    const size_t c = num_scored < critics_.size() ? critic_order_.order()[k] : k;
+    dwb_msgs::msg::CriticScore cs;
+    cs.name = critics_[c]->getName();
+    cs.scale = critic_scales_[c];
+    cs.raw_score = raw_scores[c];
+    score.scores.push_back(cs);
+  }
+  score.total = total;
   return score;
 }
 
@@ -484,7 +1109,7 @@ nav_2d_msgs::msg::Path2D
 DWBLocalPlanner::transformGlobalPlan(
   const nav_2d_msgs::msg::Pose2DStamped & pose)
 {
-  if (global_plan_.poses.size() == 0) {
+  if (plan_first_index_ >= global_plan_.poses.size()) {
     throw nav2_core::PlannerException("Received plan with zero length");
   }
 
@@ -536,12 +1161,22 @@ DWBLocalPlanner::transformGlobalPlan(
   }
 
   // Find the first pose in the plan that's less than sq_transform_start_threshold
-  // from the robot.
-  auto transformation_begin = std::find_if(
-    begin(global_plan_.poses), end(global_plan_.poses),
-    [&](const auto & global_plan_pose) {
+  // from the robot. The poses before last cycle's start have already been passed,
+  // so the search resumes there and only goes back to the start of the plan if
+  // nothing after it is close enough (e.g. after a relocalization).
+  auto near_robot = [&](const auto & global_plan_pose) {
       return getSquareDistance(robot_pose.pose, global_plan_pose) < sq_transform_start_threshold;
-    });
+    };
+  auto plan_begin = begin(global_plan_.poses) + plan_first_index_;
+  auto search_begin = begin(global_plan_.poses) +
+    std::min(std::max(plan_start_index_, plan_first_index_), global_plan_.poses.size());
+  auto transformation_begin = std::find_if(search_begin, end(global_plan_.poses), near_robot);
+  if (transformation_begin == end(global_plan_.poses)) {
+    transformation_begin = std::find_if(plan_begin, search_begin, near_robot);
+    if (transformation_begin == search_begin) {
+      transformation_begin = end(global_plan_.poses);
+    }
+  }
 
   // Find the first pose in the end of the plan that's further than sq_transform_end_threshold
   // from the robot
@@ -556,16 +1191,31 @@ DWBLocalPlanner::transformGlobalPlan(
   transformed_plan.header.frame_id = costmap_ros_->getGlobalFrameID();
   transformed_plan.header.stamp = pose.header.stamp;
 
+  // The plan poses carry no stamp, so they would all be transformed with the
+  // latest transform. Look it up once for the whole window.
+  const bool same_frame = global_plan_.header.frame_id == transformed_plan.header.frame_id;
+  geometry_msgs::msg::TransformStamped plan_to_local;
+  if (!same_frame) {
+    try {
+      plan_to_local = tf_->lookupTransform(
+        transformed_plan.header.frame_id, global_plan_.header.frame_id, tf2::TimePointZero);
+    } catch (tf2::TransformException & ex) {
+      throw dwb_core::PlannerTFException(
+              std::string("Unable to transform global plan into the local costmap's frame: ") +
+              ex.what());
+    }
+  }
+
   // Helper function for the transform below. Converts a pose2D from global
   // frame to local
   auto transformGlobalPoseToLocal = [&](const auto & global_plan_pose) {
-      nav_2d_msgs::msg::Pose2DStamped stamped_pose, transformed_pose;
-      stamped_pose.header.frame_id = global_plan_.header.frame_id;
-      stamped_pose.pose = global_plan_pose;
-      nav_2d_utils::transformPose(
-        tf_, transformed_plan.header.frame_id,
-        stamped_pose, transformed_pose, transform_tolerance_);
-      return transformed_pose.pose;
+      if (same_frame) {
+        return global_plan_pose;
+      }
+      geometry_msgs::msg::PoseStamped stamped_pose, transformed_pose;
+      stamped_pose.pose = nav_2d_utils::pose2DToPose(global_plan_pose);
+      tf2::doTransform(stamped_pose, transformed_pose, plan_to_local);
+      return nav_2d_utils::poseToPose2D(transformed_pose.pose);
     };
 
   std::transform(
@@ -573,11 +1223,14 @@ DWBLocalPlanner::transformGlobalPlan(
     std::back_inserter(transformed_plan.poses),
     transformGlobalPoseToLocal);
 
-  // Remove the portion of the global plan that we've already passed so we don't
-  // process it on the next iteration.
-  if (prune_plan_) {
-    global_plan_.poses.erase(begin(global_plan_.poses), transformation_begin);
-    pub_->publishGlobalPlan(global_plan_);
+  // Drop the portion of the global plan that we've already passed so we don't
+  // process it on the next iteration. The poses are kept, erasing them would
+  // move the whole rest of the plan every cycle.
+  plan_start_index_ = transformation_begin - begin(global_plan_.poses);
+  if (prune_plan_ && transformation_begin != plan_begin) {
+    plan_first_index_ = plan_start_index_;
+    pub_->publishGlobalPlan(
+      nav_2d_utils::PathView(global_plan_, plan_first_index_, global_plan_.poses.size()));
   }
 
   if (transformed_plan.poses.size() == 0) {
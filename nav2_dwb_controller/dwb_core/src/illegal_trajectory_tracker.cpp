@@ -52,12 +52,24 @@ void IllegalTrajectoryTracker::addLegalTrajectory()
   legal_count_++;
 }
 
+void IllegalTrajectoryTracker::reset()
+{
+  for (auto & x : counts_) {
+    x.second = 0;
+  }
+  legal_count_ = 0;
+  illegal_count_ = 0;
+}
+
 std::map<std::pair<std::string, std::string>,
   double> IllegalTrajectoryTracker::getPercentages() const
 {
   std::map<std::pair<std::string, std::string>, double> percents;
   double denominator = static_cast<double>(legal_count_ + illegal_count_);
   for (auto const & x : counts_) {
+    if (x.second == 0) {
+      continue;
+    }
     percents[x.first] = static_cast<double>(x.second) / denominator;
   }
   return percents;
@@ -35,6 +35,7 @@
 #include "dwb_core/publisher.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -79,6 +80,14 @@ DWBPublisher::DWBPublisher(
   declare_parameter_if_not_declared(
     node_, plugin_name + ".marker_lifetime",
     rclcpp::ParameterValue(0.1));
+  declare_parameter_if_not_declared(
+    node_, plugin_name + ".visualization_frequency",
+    rclcpp::ParameterValue(0.0));
+}
+
+DWBPublisher::~DWBPublisher()
+{
+  stopPublishing();
 }
 
 nav2_util::CallbackReturn
@@ -102,6 +111,14 @@ DWBPublisher::on_configure()
   node_->get_parameter(plugin_name_ + ".marker_lifetime", marker_lifetime);
   marker_lifetime_ = rclcpp::Duration::from_seconds(marker_lifetime);
 
+  double visualization_frequency = 0.0;
+  node_->get_parameter(plugin_name_ + ".visualization_frequency", visualization_frequency);
+  visualization_period_ = std::chrono::steady_clock::duration::zero();
+  if (visualization_frequency > 0.0) {
+    visualization_period_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / visualization_frequency));
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -114,6 +131,7 @@ DWBPublisher::on_activate()
   local_pub_->on_activate();
   marker_pub_->on_activate();
   cost_grid_pc_pub_->on_activate();
+  startPublishing();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -121,6 +139,7 @@ DWBPublisher::on_activate()
 nav2_util::CallbackReturn
 DWBPublisher::on_deactivate()
 {
+  stopPublishing();
   eval_pub_->on_deactivate();
   global_pub_->on_deactivate();
   transformed_pub_->on_deactivate();
@@ -145,18 +164,105 @@ DWBPublisher::on_cleanup()
 }
 
 void
-DWBPublisher::publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results)
+DWBPublisher::startPublishing()
 {
-  if (node_->count_subscribers(eval_pub_->get_topic_name()) < 1) {return;}
+  stopPublishing();
+  publish_thread_shutdown_ = false;
+  publish_thread_ = std::thread(&DWBPublisher::publishLoop, this);
+}
+
+void
+DWBPublisher::stopPublishing()
+{
+  if (!publish_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    publish_thread_shutdown_ = true;
+  }
+  publish_condition_.notify_one();
+  publish_thread_.join();
+
+  pending_evaluation_.reset();
+  pending_publish_evaluation_ = false;
+  pending_trajectories_ = false;
+  pending_cost_grid_.reset();
+}
 
-  if (results == nullptr) {return;}
+void
+DWBPublisher::publishLoop()
+{
+  std::unique_lock<std::mutex> lock(publish_mutex_);
+  while (true) {
+    publish_condition_.wait(
+      lock, [this]() {
+        return publish_thread_shutdown_ || pending_evaluation_ || pending_cost_grid_;
+      });
+    if (publish_thread_shutdown_) {
+      return;
+    }
+    std::shared_ptr<const dwb_msgs::msg::LocalPlanEvaluation> evaluation =
+      std::move(pending_evaluation_);
+    pending_evaluation_.reset();
+    const bool publish_evaluation = pending_publish_evaluation_;
+    const bool publish_trajectories = pending_trajectories_;
+    pending_publish_evaluation_ = pending_trajectories_ = false;
+    std::unique_ptr<CostGrid> cost_grid = std::move(pending_cost_grid_);
+    lock.unlock();
+
+    if (evaluation && publish_evaluation) {
+      eval_pub_->publish(std::make_unique<dwb_msgs::msg::LocalPlanEvaluation>(*evaluation));
+    }
+    if (evaluation && publish_trajectories) {
+      publishTrajectories(*evaluation);
+    }
+    if (cost_grid) {
+      publishCostGrid(*cost_grid);
+    }
 
-  if (publish_evaluation_) {
-    auto msg = std::make_unique<dwb_msgs::msg::LocalPlanEvaluation>(*results);
-    eval_pub_->publish(std::move(msg));
+    lock.lock();
   }
+}
 
-  publishTrajectories(*results);
+bool
+DWBPublisher::visualizationDue(std::chrono::steady_clock::time_point last) const
+{
+  return visualization_period_ == std::chrono::steady_clock::duration::zero() ||
+    std::chrono::steady_clock::now() - last >= visualization_period_;
+}
+
+bool
+DWBPublisher::shouldRecordEvaluation()
+{
+  return (publish_evaluation_ && node_->count_subscribers(eval_pub_->get_topic_name()) > 0) ||
+    (publish_trajectories_ && visualizationDue(last_trajectories_) &&
+    node_->count_subscribers(marker_pub_->get_topic_name()) > 0);
+}
+
+void
+DWBPublisher::publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results)
+{
+  if (results == nullptr || !publish_thread_.joinable()) {return;}
+
+  const bool publish_evaluation = publish_evaluation_ &&
+    node_->count_subscribers(eval_pub_->get_topic_name()) > 0;
+  const bool publish_trajectories = publish_trajectories_ && !results->twists.empty() &&
+    visualizationDue(last_trajectories_) &&
+    node_->count_subscribers(marker_pub_->get_topic_name()) > 0;
+  if (!publish_evaluation && !publish_trajectories) {return;}
+  if (publish_trajectories) {
+    last_trajectories_ = std::chrono::steady_clock::now();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    // A newer evaluation replaces one not published yet
+    pending_publish_evaluation_ = publish_evaluation || pending_publish_evaluation_;
+    pending_trajectories_ = publish_trajectories || pending_trajectories_;
+    pending_evaluation_ = std::move(results);
+  }
+  publish_condition_.notify_one();
 }
 
 void
@@ -243,27 +349,61 @@ DWBPublisher::publishLocalPlan(
 void
 DWBPublisher::publishCostGrid(
   const std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros,
-  const std::vector<TrajectoryCritic::Ptr> critics)
+  const std::vector<TrajectoryCritic::Ptr> critics,
+  const nav2_costmap_2d::Costmap2D * costmap)
 {
+  if (!publish_cost_grid_pc_ || !publish_thread_.joinable()) {return;}
+
+  if (!visualizationDue(last_cost_grid_)) {return;}
+
   if (node_->count_subscribers(cost_grid_pc_pub_->get_topic_name()) < 1) {return;}
 
-  if (!publish_cost_grid_pc_) {return;}
+  last_cost_grid_ = std::chrono::steady_clock::now();
 
-  auto cost_grid_pc = std::make_unique<sensor_msgs::msg::PointCloud>();
-  cost_grid_pc->header.frame_id = costmap_ros->getGlobalFrameID();
-  cost_grid_pc->header.stamp = node_->now();
+  if (!costmap) {
+    costmap = costmap_ros->getCostmap();
+  }
+  auto grid = std::make_unique<CostGrid>();
+  grid->cloud = std::make_unique<sensor_msgs::msg::PointCloud>();
+  grid->cloud->header.frame_id = costmap_ros->getGlobalFrameID();
+  grid->cloud->header.stamp = node_->now();
+  grid->size_x = costmap->getSizeInCellsX();
+  grid->size_y = costmap->getSizeInCellsY();
+  grid->origin_x = costmap->getOriginX();
+  grid->origin_y = costmap->getOriginY();
+  grid->resolution = costmap->getResolution();
+
+  // Only the critics' own data has to be read before their next prepare()
+  for (TrajectoryCritic::Ptr critic : critics) {
+    std::size_t channel_index = grid->cloud->channels.size();
+    critic->addCriticVisualization(*grid->cloud);
+    if (channel_index == grid->cloud->channels.size()) {
+      // No channels were added, so skip to next critic
+      continue;
+    }
+    grid->scaled_channels.emplace_back(channel_index, critic->getScale());
+  }
 
-  nav2_costmap_2d::Costmap2D * costmap = costmap_ros->getCostmap();
-  double x_coord, y_coord;
-  unsigned int size_x = costmap->getSizeInCellsX();
-  unsigned int size_y = costmap->getSizeInCellsY();
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    pending_cost_grid_ = std::move(grid);
+  }
+  publish_condition_.notify_one();
+}
+
+void
+DWBPublisher::publishCostGrid(CostGrid & grid)
+{
+  auto & cost_grid_pc = grid.cloud;
+  const unsigned int size_x = grid.size_x;
+  const unsigned int size_y = grid.size_y;
   cost_grid_pc->points.resize(size_x * size_y);
   unsigned int i = 0;
   for (unsigned int cy = 0; cy < size_y; cy++) {
     for (unsigned int cx = 0; cx < size_x; cx++) {
-      costmap->mapToWorld(cx, cy, x_coord, y_coord);
-      cost_grid_pc->points[i].x = x_coord;
-      cost_grid_pc->points[i].y = y_coord;
+      // Cell centers, as Costmap2D::mapToWorld gives them
+      cost_grid_pc->points[i].x = grid.origin_x + (cx + 0.5) * grid.resolution;
+      cost_grid_pc->points[i].y = grid.origin_y + (cy + 0.5) * grid.resolution;
       i++;
     }
   }
@@ -272,16 +412,11 @@ DWBPublisher::publishCostGrid(
   totals.name = "total_cost";
   totals.values.resize(size_x * size_y, 0.0);
 
-  for (TrajectoryCritic::Ptr critic : critics) {
-    unsigned int channel_index = cost_grid_pc->channels.size();
-    critic->addCriticVisualization(*cost_grid_pc);
-    if (channel_index == cost_grid_pc->channels.size()) {
-      // No channels were added, so skip to next critic
-      continue;
-    }
-    double scale = critic->getScale();
+  for (const auto & scaled_channel : grid.scaled_channels) {
+    const auto & values = cost_grid_pc->channels[scaled_channel.first].values;
+    const double scale = scaled_channel.second;
     for (i = 0; i < size_x * size_y; i++) {
-      totals.values[i] += cost_grid_pc->channels[channel_index].values[i] * scale;
+      totals.values[i] += values[i] * scale;
     }
   }
   cost_grid_pc->channels.push_back(totals);
@@ -293,31 +428,37 @@ DWBPublisher::publishCostGrid(
 }
 
 void
-DWBPublisher::publishGlobalPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishGlobalPlan(const nav_2d_msgs::msg::Path2D & plan)
+{
+  publishGenericPlan(nav_2d_utils::PathView(plan), *global_pub_, publish_global_plan_);
+}
+
+void
+DWBPublisher::publishGlobalPlan(const nav_2d_utils::PathView & plan)
 {
   publishGenericPlan(plan, *global_pub_, publish_global_plan_);
 }
 
 void
-DWBPublisher::publishTransformedPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishTransformedPlan(const nav_2d_msgs::msg::Path2D & plan)
 {
-  publishGenericPlan(plan, *transformed_pub_, publish_transformed_);
+  publishGenericPlan(nav_2d_utils::PathView(plan), *transformed_pub_, publish_transformed_);
 }
 
 void
-DWBPublisher::publishLocalPlan(const nav_2d_msgs::msg::Path2D plan)
+DWBPublisher::publishLocalPlan(const nav_2d_msgs::msg::Path2D & plan)
 {
-  publishGenericPlan(plan, *local_pub_, publish_local_plan_);
+  publishGenericPlan(nav_2d_utils::PathView(plan), *local_pub_, publish_local_plan_);
 }
 
 void
 DWBPublisher::publishGenericPlan(
-  const nav_2d_msgs::msg::Path2D plan,
+  const nav_2d_utils::PathView & plan,
   rclcpp::Publisher<nav_msgs::msg::Path> & pub, bool flag)
 {
   if (node_->count_subscribers(pub.get_topic_name()) < 1) {return;}
   if (!flag) {return;}
-  auto path = std::make_unique<nav_msgs::msg::Path>(nav_2d_utils::pathToPath(plan));
+  auto path = std::make_unique<nav_msgs::msg::Path>(nav_2d_utils::pathToPath(plan.toPath()));
   pub.publish(std::move(path));
 }
 
@@ -0,0 +1,89 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dwb_core/trajectory_batch.hpp"
+
+namespace dwb_core
+{
+
+void TrajectoryBatch::clear()
+{
+  x_.clear();
+  y_.clear();
+  theta_.clear();
+  time_.clear();
+  offsets_.resize(1);
+  velocities_.clear();
+  legal_.clear();
+}
+
+void TrajectoryBatch::reserve(std::size_t num_trajectories, std::size_t num_poses)
+{
+  x_.reserve(num_poses);
+  y_.reserve(num_poses);
+  theta_.reserve(num_poses);
+  time_.reserve(num_poses);
+  offsets_.reserve(num_trajectories + 1);
+  velocities_.reserve(num_trajectories);
+  legal_.reserve(num_trajectories);
+}
+
+std::size_t TrajectoryBatch::addTrajectory(const nav_2d_msgs::msg::Twist2D & velocity)
+{
+  velocities_.push_back(velocity);
+  legal_.push_back(1);
+  offsets_.push_back(offsets_.back());
+  return velocities_.size() - 1;
+}
+
+std::size_t TrajectoryBatch::addTrajectory(
+  const nav_2d_msgs::msg::Twist2D & velocity, std::size_t num_poses)
+{
+  std::size_t index = addTrajectory(velocity);
+  std::size_t size = x_.size() + num_poses;
+  x_.resize(size);
+  y_.resize(size);
+  theta_.resize(size);
+  time_.resize(size);
+  offsets_.back() = size;
+  return index;
+}
+
+std::size_t TrajectoryBatch::addTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
+{
+  std::size_t index = addTrajectory(traj.velocity);
+  for (std::size_t i = 0; i < traj.poses.size(); i++) {
+    const geometry_msgs::msg::Pose2D & pose = traj.poses[i];
+    double time_offset = i > 0 && i - 1 < traj.time_offsets.size() ?
+      rclcpp::Duration(traj.time_offsets[i - 1]).seconds() : 0.0;
+    addPose(pose.x, pose.y, pose.theta, time_offset);
+  }
+  return index;
+}
+
+dwb_msgs::msg::Trajectory2D TrajectoryBatch::toMsg(std::size_t i) const
+{
+  dwb_msgs::msg::Trajectory2D traj;
+  traj.velocity = velocities_[i];
+  traj.poses.reserve(end(i) - begin(i));
+  for (std::size_t j = begin(i); j < end(i); j++) {
+    traj.poses.push_back(getPose(j));
+    if (j > begin(i)) {
+      traj.time_offsets.push_back(rclcpp::Duration::from_seconds(time_[j]));
+    }
+  }
+  return traj;
+}
+
+}  // namespace dwb_core
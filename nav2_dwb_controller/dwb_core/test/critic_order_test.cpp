@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "dwb_core/critic_order.hpp"
+
+using dwb_core::CriticOrder;
+
+TEST(CriticOrder, StartsInConfiguredOrder)
+{
+  CriticOrder order;
+  order.reset(3);
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{0, 1, 2}));
+
+  // Nothing recorded, nothing moves
+  order.update();
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{0, 1, 2}));
+}
+
+TEST(CriticOrder, RunsCheapSelectiveCriticsFirst)
+{
+  CriticOrder order;
+  order.reset(4);
+  // 0: expensive, never rejects
+  order.record(0, 100000, 100, 0);
+  // 1: expensive, rejects half
+  order.record(1, 50000, 100, 50);
+  // 2: cheap, never rejects
+  order.record(2, 1000, 100, 0);
+  // 3: cheap, rejects a tenth
+  order.record(3, 1000, 100, 10);
+  order.update();
+  // 3 costs 100 ns per rejection, 1 costs 1000 ns, then 2 and 0 by cost
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{3, 1, 2, 0}));
+}
+
+TEST(CriticOrder, AveragesOverCycles)
+{
+  CriticOrder order;
+  order.reset(2);
+  order.record(0, 1000, 10, 5);
+  order.record(1, 1000, 10, 1);
+  order.update();
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{0, 1}));
+
+  // One cycle where critic 0 stops rejecting isn't enough to demote it
+  order.record(0, 1000, 10, 0);
+  order.record(1, 1000, 10, 1);
+  order.update();
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{0, 1}));
+
+  for (int i = 0; i < 50; i++) {
+    order.record(0, 1000, 10, 0);
+    order.record(1, 1000, 10, 1);
+    order.update();
+  }
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{1, 0}));
+
+  order.reset(2);
+  EXPECT_EQ(order.order(), (std::vector<std::size_t>{0, 1}));
+}
@@ -55,6 +55,11 @@ class BaseObstacleCritic : public dwb_core::TrajectoryCritic
 public:
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures) override;
+  bool isThreadSafe() const override {return true;}
+  bool usesScoringCostmap() const override {return true;}
   void addCriticVisualization(sensor_msgs::msg::PointCloud & pc) override;
 
   /**
@@ -71,8 +76,15 @@ public:
   virtual bool isValidCost(const unsigned char cost);
 
 protected:
+  /**
+   * @brief BaseObstacleCritic's own scorePose, which can be inlined into the trajectory loops
+   */
+  double scoreCell(const geometry_msgs::msg::Pose2D & pose);
+
   nav2_costmap_2d::Costmap2D * costmap_;
   bool sum_scores_;
+  /// Set when this is not a subclass, so that the poses are scored without virtual calls
+  bool inline_pose_scores_ = false;
 };
 }  // namespace dwb_critics
 
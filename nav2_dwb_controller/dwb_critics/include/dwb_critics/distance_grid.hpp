@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DWB_CRITICS__DISTANCE_GRID_HPP_
+#define DWB_CRITICS__DISTANCE_GRID_HPP_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace dwb_critics
+{
+/**
+ * @class DistanceGrid
+ * @brief Manhattan distance fields over a costmap, shared by the MapGridCritics of one planner
+ *
+ * The MapGridCritic queue ignores obstacles, so a field only depends on its seed cells and the
+ * dimensions of the costmap. Critics seeding the same cells (e.g. PathDist and PathAlign) get
+ * the same field back, and a field is only recomputed when its seeds change, i.e. when the plan
+ * changes or the rolling window moves under it.
+ */
+class DistanceGrid
+{
+public:
+  /**
+   * @brief A computed distance field. Never modified once handed out.
+   */
+  struct Field
+  {
+    std::vector<unsigned int> seeds;
+    unsigned int size_x, size_y;
+    std::vector<double> values;
+  };
+
+  /**
+   * @brief Constructor
+   * @param costmap Costmap which defines the size of the fields
+   */
+  explicit DistanceGrid(nav2_costmap_2d::Costmap2D & costmap);
+
+  /**
+   * @brief Get the grid shared by every critic of the given planner on the given costmap
+   * @param costmap Costmap the critics score against
+   * @param ns Name of the owning planner
+   */
+  static std::shared_ptr<DistanceGrid> getShared(
+    nav2_costmap_2d::Costmap2D & costmap, const std::string & ns);
+
+  /**
+   * @brief Get the field for a set of seed cells, computing it if no cached field matches
+   * @param seeds Costmap indices of the seed cells, which get distance 0
+   * @return The field. With no seeds, every cell holds size_x * size_y + 1 (unreachable).
+   */
+  std::shared_ptr<const Field> getField(const std::vector<unsigned int> & seeds);
+
+protected:
+  /**
+   * @brief Fill in the Manhattan distance of every cell to its closest seed
+   *
+   * Without obstacles this is exactly what the breadth-first MapGridQueue expansion produces,
+   * computed with one forward and one backward pass over the grid instead of a priority queue.
+   */
+  void propagate(Field & field);
+
+  nav2_costmap_2d::Costmap2D & costmap_;
+  std::mutex mutex_;
+  std::list<std::shared_ptr<Field>> fields_;  ///< Most recently used first
+};
+}  // namespace dwb_critics
+
+#endif  // DWB_CRITICS__DISTANCE_GRID_HPP_
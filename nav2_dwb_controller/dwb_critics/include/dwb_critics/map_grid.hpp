@@ -35,10 +35,12 @@
 #ifndef DWB_CRITICS__MAP_GRID_HPP_
 #define DWB_CRITICS__MAP_GRID_HPP_
 
-#include <vector>
 #include <memory>
+#include <string>
+#include <vector>
 #include "dwb_core/trajectory_critic.hpp"
 #include "costmap_queue/costmap_queue.hpp"
+#include "dwb_critics/distance_grid.hpp"
 
 namespace dwb_critics
 {
@@ -54,6 +56,10 @@ namespace dwb_critics
  *
  * This approach was chosen for computational efficiency, such that each trajectory
  * need not be compared to the list of source points.
+ *
+ * Subclasses either fill cell_values_ through queue_ themselves after reset(), or pass their
+ * source cells to setSeeds(), which shares the resulting scores with the other critics of the
+ * planner through a DistanceGrid.
  */
 class MapGridCritic : public dwb_core::TrajectoryCritic
 {
@@ -61,6 +67,11 @@ public:
   // Standard TrajectoryCritic Interface
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures) override;
+  bool isThreadSafe() const override {return true;}
+  bool usesScoringCostmap() const override {return true;}
   void addCriticVisualization(sensor_msgs::msg::PointCloud & pc) override;
   double getScale() const override {return costmap_->getResolution() * 0.5 * scale_;}
 
@@ -80,7 +91,7 @@ public:
    */
   inline double getScore(unsigned int x, unsigned int y)
   {
-    return cell_values_[costmap_->getIndex(x, y)];
+    return scores_[costmap_->getIndex(x, y)];
   }
 
   /**
@@ -100,6 +111,27 @@ protected:
   // cppcheck-suppress syntaxError
   enum class ScoreAggregationType {Last, Sum, Product};
 
+  /**
+   * @brief Aggregate the scores of the poses of one trajectory
+   * @param num_poses Number of poses in the trajectory
+   * @param pose_at Callable returning the pose at an index of the trajectory
+   */
+  template<typename PoseAt>
+  double scorePoses(std::size_t num_poses, PoseAt pose_at);
+
+  /**
+   * @brief Aggregate the scores of the poses of one trajectory
+   * @param num_poses Number of poses in the trajectory
+   * @param score_at Callable returning the score of the pose at an index of the trajectory
+   */
+  template<typename ScoreAt>
+  double aggregatePoses(std::size_t num_poses, ScoreAt score_at);
+
+  /**
+   * @brief MapGridCritic's own scorePose, which can be inlined into the trajectory loops
+   */
+  double scoreCell(const geometry_msgs::msg::Pose2D & pose);
+
   /**
    * @class MapGridQueue
    * @brief Subclass of CostmapQueue that avoids Obstacles and Unknown Values
@@ -126,12 +158,32 @@ protected:
    */
   void propogateManhattanDistances();
 
+  /**
+   * @brief Score every cell with its Manhattan distance to the closest seed cell
+   *
+   * Replaces reset() and propogateManhattanDistances(). The scores come from the DistanceGrid
+   * shared with the other critics of this planner and are only recomputed when the seeds change.
+   * @param seeds Costmap indices of the seed cells
+   */
+  void setSeeds(const std::vector<unsigned int> & seeds);
+
   std::shared_ptr<MapGridQueue> queue_;
+  std::shared_ptr<DistanceGrid> grid_;
+  std::shared_ptr<const DistanceGrid::Field> field_;  ///< Set by setSeeds
+  const double * scores_ = nullptr;  ///< Either field_ or cell_values_
   nav2_costmap_2d::Costmap2D * costmap_;
   std::vector<double> cell_values_;
   double obstacle_score_, unreachable_score_;  ///< Special cell_values
   bool stop_on_failure_;
   ScoreAggregationType aggregationType_;
+
+  /**
+   * Set in onInit by the built-in critics whose scorePose is scoreCell of the pose moved
+   * forward_point_distance_ ahead, only when they are not subclassed, so that the poses are
+   * scored without a virtual call per pose. Subclasses overriding scorePose are unaffected.
+   */
+  bool inline_pose_scores_ = false;
+  double forward_point_distance_ = 0.0;
 };
 }  // namespace dwb_critics
 
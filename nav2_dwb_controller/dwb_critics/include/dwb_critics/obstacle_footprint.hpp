@@ -37,6 +37,7 @@
 
 #include <vector>
 #include "dwb_critics/base_obstacle.hpp"
+#include "nav2_costmap_2d/footprint_collision_checker.hpp"
 
 namespace dwb_critics
 {
@@ -65,10 +66,17 @@ Footprint getOrientedFootprint(
 class ObstacleFootprintCritic : public BaseObstacleCritic
 {
 public:
+  ObstacleFootprintCritic()
+  : footprint_yaw_bins_(0) {}
+  void onInit() override;
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
   double scorePose(const geometry_msgs::msg::Pose2D & pose) override;
+  /**
+   * @brief Score an oriented footprint. scorePose(pose) no longer goes through it, it
+   * transforms the vertices one at a time instead, see outlineScorePose
+   */
   virtual double scorePose(
     const geometry_msgs::msg::Pose2D & pose,
     const Footprint & oriented_footprint);
@@ -93,7 +101,23 @@ protected:
    */
   double pointCost(int x, int y);
 
+  /**
+   * @brief Score a pose with the cached footprint outline of the closest heading
+   *
+   * The outlines are only rebuilt in prepare() when the footprint or the costmap geometry changes.
+   * A footprint leaving the map is reported as hitting an obstacle.
+   */
+  double maskScorePose(const geometry_msgs::msg::Pose2D & pose);
+
+  /**
+   * @brief Score the outline of the footprint at a pose, without building the oriented footprint
+   */
+  double outlineScorePose(const geometry_msgs::msg::Pose2D & pose);
+
   Footprint footprint_spec_;
+  nav2_costmap_2d::CompactFootprint compact_footprint_;  ///< footprint_spec_, as arrays
+  unsigned int footprint_yaw_bins_;  ///< Zero to rasterize the footprint for every pose
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker_;
 };
 }  // namespace dwb_critics
 
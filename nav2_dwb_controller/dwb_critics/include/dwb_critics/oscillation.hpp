@@ -86,6 +86,14 @@ public:
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures) override
+  {
+    scoreVelocities(batch, first, last, scores, failures);
+  }
+  bool isThreadSafe() const override {return true;}
+  bool usesScoringCostmap() const override {return true;}
   void reset() override;
   void debrief(const nav_2d_msgs::msg::Twist2D & cmd_vel) override;
 
@@ -57,7 +57,7 @@ class PathAlignCritic : public PathDistCritic
 {
 public:
   PathAlignCritic()
-  : zero_scale_(false), forward_point_distance_(0.0) {}
+  : zero_scale_(false) {}
   void onInit() override;
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
@@ -67,7 +67,6 @@ public:
 
 protected:
   bool zero_scale_;
-  double forward_point_distance_;
 };
 
 }  // namespace dwb_critics
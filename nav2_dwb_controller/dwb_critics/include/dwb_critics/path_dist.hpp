@@ -45,6 +45,8 @@ namespace dwb_critics
 class PathDistCritic : public MapGridCritic
 {
 public:
+  void onInit() override;
+  bool preparesFromPlanAndCostmap() const override;
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
@@ -57,6 +57,14 @@ public:
   : penalty_(1.0), strafe_x_(0.1), strafe_theta_(0.2), theta_scale_(10.0) {}
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures) override
+  {
+    scoreVelocities(batch, first, last, scores, failures);
+  }
+  bool isThreadSafe() const override {return true;}
+  bool usesScoringCostmap() const override {return true;}
 
 private:
   double penalty_, strafe_x_, strafe_theta_, theta_scale_;
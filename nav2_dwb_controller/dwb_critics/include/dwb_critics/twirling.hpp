@@ -53,6 +53,14 @@ class TwirlingCritic : public dwb_core::TrajectoryCritic
 public:
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void scoreTrajectories(
+    const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+    std::vector<double> & scores, std::vector<std::string> & failures) override
+  {
+    scoreVelocities(batch, first, last, scores, failures);
+  }
+  bool isThreadSafe() const override {return true;}
+  bool usesScoringCostmap() const override {return true;}
 };
 }  // namespace dwb_critics
 
@@ -33,6 +33,9 @@
  */
 
 #include "dwb_critics/base_obstacle.hpp"
+#include <string>
+#include <typeinfo>
+#include <vector>
 #include "dwb_core/exceptions.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
@@ -45,12 +48,13 @@ namespace dwb_critics
 
 void BaseObstacleCritic::onInit()
 {
-  costmap_ = costmap_ros_->getCostmap();
+  costmap_ = getCostmap();
 
   nav2_util::declare_parameter_if_not_declared(
     nh_,
     dwb_plugin_name_ + "." + name_ + ".sum_scores", rclcpp::ParameterValue(false));
   nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".sum_scores", sum_scores_);
+  inline_pose_scores_ = typeid(*this) == typeid(BaseObstacleCritic);
 }
 
 double BaseObstacleCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
@@ -65,7 +69,34 @@ double BaseObstacleCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & t
   return score;
 }
 
+void BaseObstacleCritic::scoreTrajectories(
+  const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+  std::vector<double> & scores, std::vector<std::string> & failures)
+{
+  for (std::size_t i = first; i < last; i++) {
+    if (!batch.isLegal(i)) {
+      continue;
+    }
+    try {
+      double score = 0.0;
+      for (std::size_t j = batch.begin(i); j < batch.end(i); ++j) {
+        double pose_score = inline_pose_scores_ ?
+          scoreCell(batch.getPose(j)) : scorePose(batch.getPose(j));
+        score = static_cast<double>(sum_scores_) * score + pose_score;
+      }
+      scores[i] = score;
+    } catch (const dwb_core::IllegalTrajectoryException & e) {
+      failures[i] = e.what();
+    }
+  }
+}
+
 double BaseObstacleCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+{
+  return scoreCell(pose);
+}
+
+double BaseObstacleCritic::scoreCell(const geometry_msgs::msg::Pose2D & pose)
 {
   unsigned int cell_x, cell_y;
   if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
@@ -73,7 +104,7 @@ double BaseObstacleCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
           IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
   }
   unsigned char cost = costmap_->getCost(cell_x, cell_y);
-  if (!isValidCost(cost)) {
+  if (inline_pose_scores_ ? !BaseObstacleCritic::isValidCost(cost) : !isValidCost(cost)) {
     throw dwb_core::
           IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
   }
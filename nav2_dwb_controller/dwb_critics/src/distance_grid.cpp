@@ -0,0 +1,127 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dwb_critics/distance_grid.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dwb_critics
+{
+
+// Enough for the path and goal fields of the stock critics plus their alignment variants
+static const std::size_t MAX_CACHED_FIELDS = 4;
+
+DistanceGrid::DistanceGrid(nav2_costmap_2d::Costmap2D & costmap)
+: costmap_(costmap)
+{
+}
+
+std::shared_ptr<DistanceGrid> DistanceGrid::getShared(
+  nav2_costmap_2d::Costmap2D & costmap, const std::string & ns)
+{
+  static std::mutex registry_mutex;
+  static std::map<std::pair<nav2_costmap_2d::Costmap2D *, std::string>,
+    std::weak_ptr<DistanceGrid>> registry;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  std::weak_ptr<DistanceGrid> & entry = registry[std::make_pair(&costmap, ns)];
+  std::shared_ptr<DistanceGrid> grid = entry.lock();
+  if (!grid) {
+    grid = std::make_shared<DistanceGrid>(costmap);
+    entry = grid;
+  }
+  return grid;
+}
+
+std::shared_ptr<const DistanceGrid::Field> DistanceGrid::getField(
+  const std::vector<unsigned int> & seeds)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  unsigned int size_x = costmap_.getSizeInCellsX(), size_y = costmap_.getSizeInCellsY();
+
+  auto recycled = fields_.end();
+  for (auto it = fields_.begin(); it != fields_.end(); ++it) {
+    Field & field = **it;
+    if (field.size_x == size_x && field.size_y == size_y && field.seeds == seeds) {
+      fields_.splice(fields_.begin(), fields_, it);
+      return fields_.front();
+    }
+    // A field nobody else holds can have its buffer reused. Keep the oldest one.
+    if (it->use_count() == 1) {
+      recycled = it;
+    }
+  }
+
+  std::shared_ptr<Field> field;
+  if (recycled != fields_.end()) {
+    field = *recycled;
+    fields_.erase(recycled);
+  } else {
+    field = std::make_shared<Field>();
+  }
+  field->seeds = seeds;
+  field->size_x = size_x;
+  field->size_y = size_y;
+  propagate(*field);
+
+  fields_.push_front(field);
+  if (fields_.size() > MAX_CACHED_FIELDS) {
+    fields_.pop_back();
+  }
+  return field;
+}
+
+void DistanceGrid::propagate(Field & field)
+{
+  unsigned int size_x = field.size_x, size_y = field.size_y;
+  std::vector<double> & values = field.values;
+  values.assign(size_x * size_y, static_cast<double>(size_x * size_y) + 1.0);
+  for (unsigned int index : field.seeds) {
+    values[index] = 0.0;
+  }
+  if (field.seeds.empty()) {
+    return;
+  }
+
+  for (unsigned int y = 0; y < size_y; y++) {
+    double * row = &values[y * size_x];
+    const double * prev = y > 0 ? row - size_x : nullptr;
+    for (unsigned int x = 0; x < size_x; x++) {
+      if (x > 0) {
+        row[x] = std::min(row[x], row[x - 1] + 1.0);
+      }
+      if (prev) {
+        row[x] = std::min(row[x], prev[x] + 1.0);
+      }
+    }
+  }
+  for (unsigned int y = size_y; y-- > 0; ) {
+    double * row = &values[y * size_x];
+    const double * next = y + 1 < size_y ? row + size_x : nullptr;
+    for (unsigned int x = size_x; x-- > 0; ) {
+      if (x + 1 < size_x) {
+        row[x] = std::min(row[x], row[x + 1] + 1.0);
+      }
+      if (next) {
+        row[x] = std::min(row[x], next[x] + 1.0);
+      }
+    }
+  }
+}
+
+}  // namespace dwb_critics
@@ -35,6 +35,7 @@
 #include "dwb_critics/goal_align.hpp"
 #include <vector>
 #include <string>
+#include <typeinfo>
 #include "dwb_critics/alignment_util.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_2d_utils/parameters.hpp"
@@ -49,6 +50,7 @@ void GoalAlignCritic::onInit()
   forward_point_distance_ = nav_2d_utils::searchAndGetParam(
     nh_,
     dwb_plugin_name_ + "." + name_ + ".forward_point_distance", 0.325);
+  inline_pose_scores_ = typeid(*this) == typeid(GoalAlignCritic);
 }
 
 bool GoalAlignCritic::prepare(
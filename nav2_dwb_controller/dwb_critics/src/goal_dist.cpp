@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/goal_dist.hpp"
+#include <typeinfo>
 #include <vector>
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_2d_utils/path_ops.hpp"
@@ -40,24 +41,32 @@
 
 namespace dwb_critics
 {
+void GoalDistCritic::onInit()
+{
+  MapGridCritic::onInit();
+  inline_pose_scores_ = typeid(*this) == typeid(GoalDistCritic);
+}
+
+bool GoalDistCritic::preparesFromPlanAndCostmap() const
+{
+  // Subclasses read the pose or the goal too
+  return typeid(*this) == typeid(GoalDistCritic);
+}
+
 bool GoalDistCritic::prepare(
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
-  reset();
-
   unsigned int local_goal_x, local_goal_y;
   if (!getLastPoseOnCostmap(global_plan, local_goal_x, local_goal_y)) {
+    // Leave every cell unreachable
+    setSeeds({});
     return false;
   }
 
-  // Enqueue just the last pose
-  int index = costmap_->getIndex(local_goal_x, local_goal_y);
-  cell_values_[index] = 0.0;
-  queue_->enqueueCell(local_goal_x, local_goal_y);
-
-  propogateManhattanDistances();
+  // Seed just the last pose
+  setSeeds({costmap_->getIndex(local_goal_x, local_goal_y)});
 
   return true;
 }
@@ -66,30 +75,28 @@ bool GoalDistCritic::getLastPoseOnCostmap(
   const nav_2d_msgs::msg::Path2D & global_plan,
   unsigned int & x, unsigned int & y)
 {
-  nav_2d_msgs::msg::Path2D adjusted_global_plan = nav_2d_utils::adjustPlanResolution(
-    global_plan,
-    costmap_->getResolution());
   bool started_path = false;
 
   // skip global path points until we reach the border of the local map
-  for (unsigned int i = 0; i < adjusted_global_plan.poses.size(); ++i) {
-    double g_x = adjusted_global_plan.poses[i].x;
-    double g_y = adjusted_global_plan.poses[i].y;
-    unsigned int map_x, map_y;
-    if (costmap_->worldToMap(
-        g_x, g_y, map_x,
+  nav_2d_utils::forEachPoseAtResolution(
+    nav_2d_utils::PathView(global_plan), costmap_->getResolution(),
+    [&](const geometry_msgs::msg::Pose2D & pose) {
+      unsigned int map_x, map_y;
+      if (costmap_->worldToMap(
+        pose.x, pose.y, map_x,
         map_y) && costmap_->getCost(map_x, map_y) != nav2_costmap_2d::NO_INFORMATION)
-    {
-      // Still on the costmap. Continue.
-      x = map_x;
-      y = map_y;
-      started_path = true;
-    } else if (started_path) {
-      // Off the costmap after being on the costmap. Return the last saved indices.
+      {
+        // Still on the costmap. Continue.
+        x = map_x;
+        y = map_y;
+        started_path = true;
+      } else if (started_path) {
+        // Off the costmap after being on the costmap. Keep the last saved indices.
+        return false;
+      }
+      // else, we have not yet found a point on the costmap, so we just continue
       return true;
-    }
-    // else, we have not yet found a point on the costmap, so we just continue
-  }
+    });
 
   if (started_path) {
     return true;
@@ -37,7 +37,9 @@
 #include <string>
 #include <algorithm>
 #include <memory>
+#include <vector>
 #include "dwb_core/exceptions.hpp"
+#include "dwb_critics/alignment_util.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_util/node_utils.hpp"
 
@@ -55,8 +57,9 @@ bool MapGridCritic::MapGridQueue::validCellToQueue(const costmap_queue::CellData
 
 void MapGridCritic::onInit()
 {
-  costmap_ = costmap_ros_->getCostmap();
+  costmap_ = getCostmap();
   queue_ = std::make_shared<MapGridQueue>(*costmap_, *this);
+  grid_ = DistanceGrid::getShared(*costmap_, dwb_plugin_name_);
 
   // Always set to true, but can be overriden by subclasses
   stop_on_failure_ = true;
@@ -86,16 +89,34 @@ void MapGridCritic::onInit()
 
 void MapGridCritic::setAsObstacle(unsigned int index)
 {
+  if (field_) {
+    // The shared field is read-only, so take a private copy first
+    cell_values_ = field_->values;
+    field_.reset();
+    scores_ = cell_values_.data();
+  }
   cell_values_[index] = obstacle_score_;
 }
 
 void MapGridCritic::reset()
 {
+  field_.reset();
   queue_->reset();
   cell_values_.resize(costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY());
   obstacle_score_ = static_cast<double>(cell_values_.size());
   unreachable_score_ = obstacle_score_ + 1.0;
   std::fill(cell_values_.begin(), cell_values_.end(), unreachable_score_);
+  scores_ = cell_values_.data();
+}
+
+void MapGridCritic::setSeeds(const std::vector<unsigned int> & seeds)
+{
+  // Let go of the previous field first so the grid can reuse its buffer
+  field_.reset();
+  field_ = grid_->getField(seeds);
+  obstacle_score_ = static_cast<double>(field_->values.size());
+  unreachable_score_ = obstacle_score_ + 1.0;
+  scores_ = field_->values.data();
 }
 
 void MapGridCritic::propogateManhattanDistances()
@@ -107,19 +128,46 @@ void MapGridCritic::propogateManhattanDistances()
   }
 }
 
-double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
+double MapGridCritic::scoreCell(const geometry_msgs::msg::Pose2D & pose)
+{
+  unsigned int cell_x, cell_y;
+  // we won't allow trajectories that go off the map... shouldn't happen that often anyways
+  if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
+    throw dwb_core::
+          IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
+  }
+  return getScore(cell_x, cell_y);
+}
+
+template<typename PoseAt>
+double MapGridCritic::scorePoses(std::size_t num_poses, PoseAt pose_at)
+{
+  if (!inline_pose_scores_) {
+    return aggregatePoses(num_poses, [&](std::size_t i) {return scorePose(pose_at(i));});
+  }
+  if (forward_point_distance_ == 0.0) {
+    return aggregatePoses(num_poses, [&](std::size_t i) {return scoreCell(pose_at(i));});
+  }
+  return aggregatePoses(
+    num_poses, [&](std::size_t i) {
+      return scoreCell(getForwardPose(pose_at(i), forward_point_distance_));
+    });
+}
+
+template<typename ScoreAt>
+double MapGridCritic::aggregatePoses(std::size_t num_poses, ScoreAt score_at)
 {
   double score = 0.0;
   unsigned int start_index = 0;
   if (aggregationType_ == ScoreAggregationType::Product) {
     score = 1.0;
   } else if (aggregationType_ == ScoreAggregationType::Last && !stop_on_failure_) {
-    start_index = traj.poses.size() - 1;
+    start_index = num_poses - 1;
   }
   double grid_dist;
 
-  for (unsigned int i = start_index; i < traj.poses.size(); ++i) {
-    grid_dist = scorePose(traj.poses[i]);
+  for (unsigned int i = start_index; i < num_poses; ++i) {
+    grid_dist = score_at(i);
     if (stop_on_failure_) {
       if (grid_dist == obstacle_score_) {
         throw dwb_core::
@@ -148,15 +196,35 @@ double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
   return score;
 }
 
-double MapGridCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
-  unsigned int cell_x, cell_y;
-  // we won't allow trajectories that go off the map... shouldn't happen that often anyways
-  if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
+  return scorePoses(
+    traj.poses.size(),
+    [&traj](std::size_t i) -> const geometry_msgs::msg::Pose2D & {return traj.poses[i];});
+}
+
+void MapGridCritic::scoreTrajectories(
+  const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+  std::vector<double> & scores, std::vector<std::string> & failures)
+{
+  for (std::size_t i = first; i < last; i++) {
+    if (!batch.isLegal(i)) {
+      continue;
+    }
+    std::size_t begin = batch.begin(i);
+    try {
+      scores[i] = scorePoses(
+        batch.end(i) - begin,
+        [&batch, begin](std::size_t j) {return batch.getPose(begin + j);});
+    } catch (const dwb_core::IllegalTrajectoryException & e) {
+      failures[i] = e.what();
+    }
   }
-  return getScore(cell_x, cell_y);
+}
+
+double MapGridCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+{
+  return scoreCell(pose);
 }
 
 void MapGridCritic::addCriticVisualization(sensor_msgs::msg::PointCloud & pc)
@@ -164,9 +232,8 @@ void MapGridCritic::addCriticVisualization(sensor_msgs::msg::PointCloud & pc)
   sensor_msgs::msg::ChannelFloat32 grid_scores;
   grid_scores.name = name_;
 
-  nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
-  unsigned int size_x = costmap->getSizeInCellsX();
-  unsigned int size_y = costmap->getSizeInCellsY();
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
   grid_scores.values.resize(size_x * size_y);
   unsigned int i = 0;
   for (unsigned int cy = 0; cy < size_y; cy++) {
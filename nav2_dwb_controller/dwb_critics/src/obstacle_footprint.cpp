@@ -34,11 +34,14 @@
 
 #include "dwb_critics/obstacle_footprint.hpp"
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include "dwb_critics/line_iterator.hpp"
 #include "dwb_core/exceptions.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "nav2_util/se2.hpp"
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::ObstacleFootprintCritic, dwb_core::TrajectoryCritic)
 
@@ -50,16 +53,30 @@ Footprint getOrientedFootprint(
 {
   std::vector<geometry_msgs::msg::Point> oriented_footprint;
   oriented_footprint.resize(footprint_spec.size());
-  double cos_th = cos(pose.theta);
-  double sin_th = sin(pose.theta);
+  const nav2_util::se2::Transform transform(pose.x, pose.y, pose.theta);
   for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
     geometry_msgs::msg::Point & new_pt = oriented_footprint[i];
-    new_pt.x = pose.x + footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th;
-    new_pt.y = pose.y + footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th;
+    transform.apply(footprint_spec[i].x, footprint_spec[i].y, new_pt.x, new_pt.y);
   }
   return oriented_footprint;
 }
 
+void ObstacleFootprintCritic::onInit()
+{
+  BaseObstacleCritic::onInit();
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh_,
+    dwb_plugin_name_ + "." + name_ + ".footprint_yaw_bins", rclcpp::ParameterValue(0));
+  int yaw_bins;
+  nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".footprint_yaw_bins", yaw_bins);
+  footprint_yaw_bins_ = static_cast<unsigned int>(std::max(0, yaw_bins));
+
+  // The costmap is owned by costmap_ros_, which outlives the critic
+  collision_checker_.setCostmap(
+    std::shared_ptr<nav2_costmap_2d::Costmap2D>(costmap_, [](nav2_costmap_2d::Costmap2D *) {}));
+}
+
 bool ObstacleFootprintCritic::prepare(
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Path2D &)
@@ -71,6 +88,13 @@ bool ObstacleFootprintCritic::prepare(
       "Footprint spec is empty, maybe missing call to setFootprint?");
     return false;
   }
+  if (!compact_footprint_.matches(footprint_spec_)) {
+    compact_footprint_ = nav2_costmap_2d::CompactFootprint(footprint_spec_);
+  }
+  if (footprint_yaw_bins_ > 0) {
+    // Scoring only reads the outlines, so they must be current before it starts
+    collision_checker_.updateFootprintMasks(footprint_spec_, footprint_yaw_bins_, false);
+  }
   return true;
 }
 
@@ -81,7 +105,53 @@ double ObstacleFootprintCritic::scorePose(const geometry_msgs::msg::Pose2D & pos
     throw dwb_core::
           IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
   }
-  return scorePose(pose, getOrientedFootprint(pose, footprint_spec_));
+  if (footprint_yaw_bins_ > 0) {
+    return maskScorePose(pose);
+  }
+  return outlineScorePose(pose);
+}
+
+double ObstacleFootprintCritic::outlineScorePose(const geometry_msgs::msg::Pose2D & pose)
+{
+  const nav2_util::se2::Transform transform(pose.x, pose.y, pose.theta);
+  const double * fx = compact_footprint_.x();
+  const double * fy = compact_footprint_.y();
+  unsigned int first_x = 0, first_y = 0, last_x = 0, last_y = 0, mx, my;
+  double footprint_cost = 0.0;
+
+  // The same lines as scorePose(pose, footprint), in the same order
+  for (std::size_t i = 0; i < compact_footprint_.size(); ++i) {
+    double wx, wy;
+    transform.apply(fx[i], fy[i], wx, wy);
+    if (!costmap_->worldToMap(wx, wy, mx, my)) {
+      throw dwb_core::
+            IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
+    }
+    if (i == 0) {
+      first_x = mx;
+      first_y = my;
+    } else {
+      footprint_cost = std::max(lineCost(last_x, mx, last_y, my), footprint_cost);
+    }
+    last_x = mx;
+    last_y = my;
+  }
+
+  // the last point connects back to the first
+  return std::max(lineCost(last_x, first_x, last_y, first_y), footprint_cost);
+}
+
+double ObstacleFootprintCritic::maskScorePose(const geometry_msgs::msg::Pose2D & pose)
+{
+  double cost = collision_checker_.maskCostAtPose(pose.x, pose.y, pose.theta);
+  if (cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
+    throw dwb_core::
+          IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
+  } else if (cost == nav2_costmap_2d::NO_INFORMATION) {
+    throw dwb_core::
+          IllegalTrajectoryException(name_, "Trajectory Hits Unknown Region.");
+  }
+  return cost;
 }
 
 double ObstacleFootprintCritic::scorePose(
@@ -133,18 +203,10 @@ double ObstacleFootprintCritic::scorePose(
 
 double ObstacleFootprintCritic::lineCost(int x0, int x1, int y0, int y1)
 {
-  double line_cost = 0.0;
-  double point_cost = -1.0;
-
-  for (LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
-
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
-  }
-
-  return line_cost;
+  // pointCost() throws on the cells ending the walk, none of the others reach lethal
+  return nav2_util::maxCostAlongLine(
+    LineIterator(x0, y0, x1, y1), [this](int x, int y) {return pointCost(x, y);},
+    static_cast<double>(nav2_costmap_2d::LETHAL_OBSTACLE));
 }
 
 double ObstacleFootprintCritic::pointCost(int x, int y)
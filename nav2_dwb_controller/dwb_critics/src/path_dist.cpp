@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/path_dist.hpp"
+#include <typeinfo>
 #include <vector>
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_2d_utils/path_ops.hpp"
@@ -40,52 +41,56 @@
 
 namespace dwb_critics
 {
+void PathDistCritic::onInit()
+{
+  MapGridCritic::onInit();
+  inline_pose_scores_ = typeid(*this) == typeid(PathDistCritic);
+}
+
+bool PathDistCritic::preparesFromPlanAndCostmap() const
+{
+  // Subclasses read the pose or the goal too
+  return typeid(*this) == typeid(PathDistCritic);
+}
+
 bool PathDistCritic::prepare(
   const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
   const geometry_msgs::msg::Pose2D &,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
-  reset();
   bool started_path = false;
+  std::size_t num_checked = 0;
 
-  nav_2d_msgs::msg::Path2D adjusted_global_plan =
-    nav_2d_utils::adjustPlanResolution(global_plan, costmap_->getResolution());
-
-  if (adjusted_global_plan.poses.size() != global_plan.poses.size()) {
-    RCLCPP_DEBUG(
-      rclcpp::get_logger(
-        "PathDistCritic"), "Adjusted global plan resolution, added %zu points",
-      adjusted_global_plan.poses.size() - global_plan.poses.size());
-  }
-
-  unsigned int i;
-  // put global path points into local map until we reach the border of the local map
-  for (i = 0; i < adjusted_global_plan.poses.size(); ++i) {
-    double g_x = adjusted_global_plan.poses[i].x;
-    double g_y = adjusted_global_plan.poses[i].y;
-    unsigned int map_x, map_y;
-    if (costmap_->worldToMap(
-        g_x, g_y, map_x,
+  std::vector<unsigned int> seeds;
+  // put global path points into local map until we reach the border of the local map,
+  // the plan is only densified that far
+  nav_2d_utils::forEachPoseAtResolution(
+    nav_2d_utils::PathView(global_plan), costmap_->getResolution(),
+    [&](const geometry_msgs::msg::Pose2D & pose) {
+      ++num_checked;
+      unsigned int map_x, map_y;
+      if (costmap_->worldToMap(
+        pose.x, pose.y, map_x,
         map_y) && costmap_->getCost(map_x, map_y) != nav2_costmap_2d::NO_INFORMATION)
-    {
-      int index = costmap_->getIndex(map_x, map_y);
-      cell_values_[index] = 0.0;
-      queue_->enqueueCell(map_x, map_y);
-      started_path = true;
-    } else if (started_path) {
-      break;
-    }
-  }
+      {
+        seeds.push_back(costmap_->getIndex(map_x, map_y));
+        started_path = true;
+      } else if (started_path) {
+        return false;
+      }
+      return true;
+    });
   if (!started_path) {
     RCLCPP_ERROR(
       rclcpp::get_logger("PathDistCritic"),
-      "None of the %d first of %zu (%zu) points of the global plan were in "
+      "None of the %zu points of the global plan (%zu once densified) were in "
       "the local costmap and free",
-      i, adjusted_global_plan.poses.size(), global_plan.poses.size());
+      global_plan.poses.size(), num_checked);
+    setSeeds(seeds);
     return false;
   }
 
-  propogateManhattanDistances();
+  setSeeds(seeds);
 
   return true;
 }
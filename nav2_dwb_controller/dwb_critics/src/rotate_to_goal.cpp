@@ -111,6 +111,20 @@ double RotateToGoalCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & t
   return scoreRotation(traj);
 }
 
+void RotateToGoalCritic::scoreTrajectories(
+  const dwb_core::TrajectoryBatch & batch, std::size_t first, std::size_t last,
+  std::vector<double> & scores, std::vector<std::string> & failures)
+{
+  // Away from the goal every trajectory scores 0, no need to build their messages
+  if (!in_window_) {
+    for (std::size_t i = first; i < last; i++) {
+      scores[i] = 0.0;
+    }
+    return;
+  }
+  dwb_core::TrajectoryCritic::scoreTrajectories(batch, first, last, scores, failures);
+}
+
 double RotateToGoalCritic::scoreRotation(const dwb_msgs::msg::Trajectory2D & traj)
 {
   if (traj.poses.empty()) {
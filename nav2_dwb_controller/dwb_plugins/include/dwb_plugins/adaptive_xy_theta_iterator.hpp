@@ -0,0 +1,89 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DWB_PLUGINS__ADAPTIVE_XY_THETA_ITERATOR_HPP_
+#define DWB_PLUGINS__ADAPTIVE_XY_THETA_ITERATOR_HPP_
+
+#include <string>
+#include <vector>
+
+#include "dwb_plugins/xy_theta_iterator.hpp"
+
+namespace dwb_plugins
+{
+/**
+ * @class AdaptiveXYThetaIterator
+ * @brief Coarse-to-fine sampling of the same velocity grid as XYThetaIterator
+ *
+ * The grid is the product of the OneDVelocityIterator samples of each dimension. Every
+ * iteration first returns the sample closest to the best twist of the previous iteration,
+ * then a coarse subgrid (every adaptive_stride-th sample, the last sample and zero in each
+ * dimension). Once the coarse twists are exhausted, the full-resolution neighbourhoods of the
+ * adaptive_top_k best scored twists are returned.
+ *
+ * Scores come in through reportScore(). Without them (e.g. when all the twists are requested
+ * up front) only the neighbourhood of the previous best twist is refined.
+ */
+class AdaptiveXYThetaIterator : public XYThetaIterator
+{
+public:
+  AdaptiveXYThetaIterator()
+  : stride_(3), top_k_(3), next_pending_(0), refined_(true), warm_start_(-1), has_best_(false),
+    best_score_(0.0) {}
+  void initialize(
+    const nav2_util::LifecycleNode::SharedPtr & nh,
+    KinematicsHandler::Ptr kinematics,
+    const std::string & plugin_name) override;
+  void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) override;
+  bool hasMoreTwists() override;
+  nav_2d_msgs::msg::Twist2D nextTwist() override;
+  void reportScore(const nav_2d_msgs::msg::Twist2D & twist, double score) override;
+
+protected:
+  /**
+   * @brief Queue a grid sample if it is a valid speed and has not been queued this iteration
+   */
+  void queueSample(unsigned int ix, unsigned int iy, unsigned int ith);
+
+  /**
+   * @brief Queue the neighbourhoods of the best scored samples
+   */
+  void queueRefinement();
+
+  /**
+   * @brief Index of the sample closest to a velocity in one dimension
+   */
+  static unsigned int closestSample(const std::vector<double> & samples, double velocity);
+
+  unsigned int gridIndex(unsigned int ix, unsigned int iy, unsigned int ith) const
+  {
+    return (ix * y_samples_.size() + iy) * th_samples_.size() + ith;
+  }
+
+  int stride_, top_k_;
+  std::vector<double> x_samples_, y_samples_, th_samples_;
+  std::vector<unsigned char> queued_;
+  std::vector<double> scores_;  ///< Per grid sample, negative if unscored or illegal
+  std::vector<unsigned int> pending_;
+  size_t next_pending_;
+  bool refined_;
+  int warm_start_;  ///< Grid index of the previous best twist, or -1
+
+  bool has_best_;
+  nav_2d_msgs::msg::Twist2D best_twist_;  ///< Best twist reported in this iteration
+  double best_score_;
+};
+}  // namespace dwb_plugins
+
+#endif  // DWB_PLUGINS__ADAPTIVE_XY_THETA_ITERATOR_HPP_
@@ -40,6 +40,7 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/node_utils.hpp"
 
 namespace dwb_plugins
 {
@@ -52,27 +53,29 @@ struct KinematicParameters
 {
   friend class KinematicsHandler;
 
-  inline double getMinX() {return min_vel_x_;}
-  inline double getMaxX() {return max_vel_x_;}
-  inline double getAccX() {return acc_lim_x_;}
-  inline double getDecelX() {return decel_lim_x_;}
+  using ConstPtr = std::shared_ptr<const KinematicParameters>;
 
-  inline double getMinY() {return min_vel_y_;}
-  inline double getMaxY() {return max_vel_y_;}
-  inline double getAccY() {return acc_lim_y_;}
-  inline double getDecelY() {return decel_lim_y_;}
+  inline double getMinX() const {return min_vel_x_;}
+  inline double getMaxX() const {return max_vel_x_;}
+  inline double getAccX() const {return acc_lim_x_;}
+  inline double getDecelX() const {return decel_lim_x_;}
 
-  inline double getMinSpeedXY() {return min_speed_xy_;}
-  inline double getMaxSpeedXY() {return max_speed_xy_;}
+  inline double getMinY() const {return min_vel_y_;}
+  inline double getMaxY() const {return max_vel_y_;}
+  inline double getAccY() const {return acc_lim_y_;}
+  inline double getDecelY() const {return decel_lim_y_;}
 
-  inline double getMinTheta() {return -max_vel_theta_;}
-  inline double getMaxTheta() {return max_vel_theta_;}
-  inline double getAccTheta() {return acc_lim_theta_;}
-  inline double getDecelTheta() {return decel_lim_theta_;}
-  inline double getMinSpeedTheta() {return min_speed_theta_;}
+  inline double getMinSpeedXY() const {return min_speed_xy_;}
+  inline double getMaxSpeedXY() const {return max_speed_xy_;}
 
-  inline double getMinSpeedXY_SQ() {return min_speed_xy_sq_;}
-  inline double getMaxSpeedXY_SQ() {return max_speed_xy_sq_;}
+  inline double getMinTheta() const {return -max_vel_theta_;}
+  inline double getMaxTheta() const {return max_vel_theta_;}
+  inline double getAccTheta() const {return acc_lim_theta_;}
+  inline double getDecelTheta() const {return decel_lim_theta_;}
+  inline double getMinSpeedTheta() const {return min_speed_theta_;}
+
+  inline double getMinSpeedXY_SQ() const {return min_speed_xy_sq_;}
+  inline double getMaxSpeedXY_SQ() const {return max_speed_xy_sq_;}
 
 protected:
   // For parameter descriptions, see cfg/KinematicParams.cfg
@@ -107,17 +110,27 @@ public:
   ~KinematicsHandler();
   void initialize(const nav2_util::LifecycleNode::SharedPtr & nh, const std::string & plugin_name);
 
-  inline KinematicParameters getKinematics() {return *kinematics_.load();}
+  inline KinematicParameters getKinematics() const {return *getKinematicsSnapshot();}
+
+  /**
+   * @brief Get the current kinematics, never modified once handed out
+   *
+   * Parameter updates swap in a new snapshot, so take one per control cycle and
+   * read it rather than calling this again in inner loops.
+   */
+  inline KinematicParameters::ConstPtr getKinematicsSnapshot() const
+  {
+    return std::atomic_load(&kinematics_);
+  }
 
   using Ptr = std::shared_ptr<KinematicsHandler>;
 
 protected:
-  std::atomic<KinematicParameters *> kinematics_;
+  KinematicParameters::ConstPtr kinematics_;
 
-  // Subscription for parameter change
-  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
-  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
-  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+  // Parameters are bound to pending_, published as a new snapshot after each change
+  std::unique_ptr<nav2_util::ParameterBindings> bindings_;
+  KinematicParameters pending_;
   void update_kinematics(KinematicParameters kinematics);
   std::string plugin_name_;
 };
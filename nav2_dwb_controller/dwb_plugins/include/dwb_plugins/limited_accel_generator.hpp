@@ -70,6 +70,7 @@ protected:
     const nav_2d_msgs::msg::Twist2D & cmd_vel,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const double dt) override;
+  bool limitsAcceleration() const override {return false;}
   double acceleration_time_;
   std::string plugin_name_;
 };
@@ -62,11 +62,18 @@ public:
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
   bool hasMoreTwists() override;
   nav_2d_msgs::msg::Twist2D nextTwist() override;
+  void reportScore(const nav_2d_msgs::msg::Twist2D & twist, double score) override;
 
   dwb_msgs::msg::Trajectory2D generateTrajectory(
     const geometry_msgs::msg::Pose2D & start_pose,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const nav_2d_msgs::msg::Twist2D & cmd_vel) override;
+  void generateTrajectories(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+    dwb_core::TrajectoryBatch & batch) override;
+  bool isThreadSafe() const override {return true;}
 
 protected:
   /**
@@ -113,7 +120,33 @@ protected:
    */
   virtual std::vector<double> getTimeSteps(const nav_2d_msgs::msg::Twist2D & cmd_vel);
 
+  /**
+   * @brief Number of time steps getTimeSteps() splits sim_time into for a command velocity
+   */
+  int getNumTimeSteps(const nav_2d_msgs::msg::Twist2D & cmd_vel) const;
+
+  /**
+   * @brief Whether the velocity approaches the command within the acceleration limits
+   *
+   * The lockstep rollout follows computeNewVelocity() through this. Generators
+   * overriding it to jump to the command velocity right away return false.
+   */
+  virtual bool limitsAcceleration() const {return true;}
+
+  /**
+   * @brief Simulate groups of command velocities with the same time steps side by side
+   *
+   * Implements the kinematic model of computeNewVelocity() and computeNewPosition(),
+   * with the sine and cosine of all the trajectories of a group computed at once.
+   */
+  void generateTrajectoriesLockstep(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+    dwb_core::TrajectoryBatch & batch);
+
   KinematicsHandler::Ptr kinematics_handler_;
+  KinematicParameters::ConstPtr kinematics_;  ///< Taken at the start of each iteration
   std::shared_ptr<VelocityIterator> velocity_iterator_;
 
   double sim_time_;
@@ -130,6 +163,9 @@ protected:
   /// @brief If not discretizing by time, the amount of angular space between points
   double angular_granularity_;
 
+  /// @brief Whether generateTrajectories uses generateTrajectoriesLockstep
+  bool lockstep_rollout_;
+
   /// @brief the name of the overlying plugin ID
   std::string plugin_name_;
 
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DWB_PLUGINS__TRAJECTORY_LIBRARY_GENERATOR_HPP_
+#define DWB_PLUGINS__TRAJECTORY_LIBRARY_GENERATOR_HPP_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dwb_plugins/standard_traj_generator.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+
+namespace dwb_plugins
+{
+
+/**
+ * @class TrajectoryLibraryGenerator
+ * @brief StandardTrajectoryGenerator reusing trajectories simulated in the robot frame
+ *
+ * In the robot frame, a trajectory only depends on the start and command velocities.
+ * Both are rounded to a lattice, the trajectory of each pair is simulated once from the
+ * origin and kept in a library, and each cycle only moves the stored poses to the start
+ * pose. The trajectories are off by at most the lattice resolution times sim_time.
+ */
+class TrajectoryLibraryGenerator : public StandardTrajectoryGenerator
+{
+public:
+  void initialize(
+    const nav2_util::LifecycleNode::SharedPtr & nh,
+    const std::string & plugin_name) override;
+  void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+
+  dwb_msgs::msg::Trajectory2D generateTrajectory(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel) override;
+  void generateTrajectories(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+    dwb_core::TrajectoryBatch & batch) override;
+
+  /**
+   * @brief Number of trajectories in the library
+   */
+  std::size_t librarySize();
+
+protected:
+  /// Robot frame poses of a trajectory
+  struct Primitive
+  {
+    std::vector<double> x, y, theta, time;
+  };
+
+  /// Start and command velocities, in lattice steps
+  using Key = std::array<int32_t, 6>;
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key & key) const;
+  };
+
+  /**
+   * @brief Get the trajectory of a pair of velocities, simulating it if it isn't in the library
+   */
+  std::shared_ptr<const Primitive> getPrimitive(
+    const nav_2d_msgs::msg::Twist2D & start_vel, const nav_2d_msgs::msg::Twist2D & cmd_vel);
+
+  double linear_resolution_;
+  double angular_resolution_;
+  std::size_t max_size_;
+
+  // Guards the library, trajectories may be generated on several threads
+  std::mutex library_mutex_;
+  std::unordered_map<Key, std::shared_ptr<const Primitive>, KeyHash> library_;
+  KinematicParameters::ConstPtr library_kinematics_;  ///< Kinematics the library follows
+};
+
+}  // namespace dwb_plugins
+
+#endif  // DWB_PLUGINS__TRAJECTORY_LIBRARY_GENERATOR_HPP_
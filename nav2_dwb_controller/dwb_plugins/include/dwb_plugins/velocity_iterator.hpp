@@ -56,6 +56,13 @@ public:
   virtual void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) = 0;
   virtual bool hasMoreTwists() = 0;
   virtual nav_2d_msgs::msg::Twist2D nextTwist() = 0;
+
+  /**
+   * @brief Feedback on a twist returned by nextTwist() in the current iteration
+   * @param twist The twist that was scored
+   * @param score Its total score (lower is better), negative if it was illegal
+   */
+  virtual void reportScore(const nav_2d_msgs::msg::Twist2D & /*twist*/, double /*score*/) {}
 };
 }  // namespace dwb_plugins
 
@@ -0,0 +1,217 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dwb_plugins/adaptive_xy_theta_iterator.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nav2_util/node_utils.hpp"
+
+namespace dwb_plugins
+{
+void AdaptiveXYThetaIterator::initialize(
+  const nav2_util::LifecycleNode::SharedPtr & nh,
+  KinematicsHandler::Ptr kinematics,
+  const std::string & plugin_name)
+{
+  XYThetaIterator::initialize(nh, kinematics, plugin_name);
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".adaptive_stride", rclcpp::ParameterValue(3));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".adaptive_top_k", rclcpp::ParameterValue(3));
+
+  nh->get_parameter(plugin_name + ".adaptive_stride", stride_);
+  nh->get_parameter(plugin_name + ".adaptive_top_k", top_k_);
+  stride_ = std::max(1, stride_);
+  top_k_ = std::max(0, top_k_);
+}
+
+void AdaptiveXYThetaIterator::startNewIteration(
+  const nav_2d_msgs::msg::Twist2D & current_velocity,
+  double dt)
+{
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
+  const KinematicParameters & kinematics = *kinematics_;
+  auto sample = [dt](
+    double current, double min, double max, double acc, double decel, int num_samples,
+    std::vector<double> & samples) {
+      samples.clear();
+      OneDVelocityIterator it(current, min, max, acc, decel, dt, num_samples);
+      for (; !it.isFinished(); ++it) {
+        samples.push_back(it.getVelocity());
+      }
+    };
+  sample(
+    current_velocity.x, kinematics.getMinX(), kinematics.getMaxX(),
+    kinematics.getAccX(), kinematics.getDecelX(), vx_samples_, x_samples_);
+  sample(
+    current_velocity.y, kinematics.getMinY(), kinematics.getMaxY(),
+    kinematics.getAccY(), kinematics.getDecelY(), vy_samples_, y_samples_);
+  sample(
+    current_velocity.theta, kinematics.getMinTheta(), kinematics.getMaxTheta(),
+    kinematics.getAccTheta(), kinematics.getDecelTheta(), vtheta_samples_, th_samples_);
+
+  size_t num_samples = x_samples_.size() * y_samples_.size() * th_samples_.size();
+  queued_.assign(num_samples, 0);
+  scores_.assign(num_samples, -1.0);
+  pending_.clear();
+  next_pending_ = 0;
+  refined_ = false;
+  warm_start_ = -1;
+  if (num_samples == 0) {
+    has_best_ = false;
+    return;
+  }
+
+  // Warm start from the best twist of the previous iteration
+  if (has_best_) {
+    unsigned int ix = closestSample(x_samples_, best_twist_.x);
+    unsigned int iy = closestSample(y_samples_, best_twist_.y);
+    unsigned int ith = closestSample(th_samples_, best_twist_.theta);
+    queueSample(ix, iy, ith);
+    if (!pending_.empty()) {
+      warm_start_ = gridIndex(ix, iy, ith);
+    }
+    has_best_ = false;
+  }
+
+  auto coarse = [this](const std::vector<double> & samples, unsigned int i) {
+      return i % stride_ == 0 || i + 1 == samples.size() || samples[i] == 0.0;
+    };
+  for (unsigned int ix = 0; ix < x_samples_.size(); ix++) {
+    if (!coarse(x_samples_, ix)) {continue;}
+    for (unsigned int iy = 0; iy < y_samples_.size(); iy++) {
+      if (!coarse(y_samples_, iy)) {continue;}
+      for (unsigned int ith = 0; ith < th_samples_.size(); ith++) {
+        if (coarse(th_samples_, ith)) {
+          queueSample(ix, iy, ith);
+        }
+      }
+    }
+  }
+}
+
+bool AdaptiveXYThetaIterator::hasMoreTwists()
+{
+  if (next_pending_ < pending_.size()) {
+    return true;
+  }
+  if (!refined_) {
+    refined_ = true;
+    queueRefinement();
+  }
+  return next_pending_ < pending_.size();
+}
+
+nav_2d_msgs::msg::Twist2D AdaptiveXYThetaIterator::nextTwist()
+{
+  unsigned int index = pending_[next_pending_++];
+  unsigned int ith = index % th_samples_.size();
+  index /= th_samples_.size();
+
+  nav_2d_msgs::msg::Twist2D velocity;
+  velocity.x = x_samples_[index / y_samples_.size()];
+  velocity.y = y_samples_[index % y_samples_.size()];
+  velocity.theta = th_samples_[ith];
+  return velocity;
+}
+
+void AdaptiveXYThetaIterator::reportScore(const nav_2d_msgs::msg::Twist2D & twist, double score)
+{
+  if (scores_.empty() || score < 0.0) {
+    return;
+  }
+  unsigned int index = gridIndex(
+    closestSample(x_samples_, twist.x), closestSample(y_samples_, twist.y),
+    closestSample(th_samples_, twist.theta));
+  scores_[index] = score;
+  if (!has_best_ || score < best_score_) {
+    has_best_ = true;
+    best_score_ = score;
+    best_twist_ = twist;
+  }
+}
+
+void AdaptiveXYThetaIterator::queueSample(unsigned int ix, unsigned int iy, unsigned int ith)
+{
+  unsigned int index = gridIndex(ix, iy, ith);
+  if (queued_[index]) {
+    return;
+  }
+  queued_[index] = 1;
+  if (isValidSpeed(x_samples_[ix], y_samples_[iy], th_samples_[ith])) {
+    pending_.push_back(index);
+  }
+}
+
+void AdaptiveXYThetaIterator::queueRefinement()
+{
+  std::vector<unsigned int> candidates;
+  for (unsigned int index = 0; index < scores_.size(); index++) {
+    if (scores_[index] >= 0.0) {
+      candidates.push_back(index);
+    }
+  }
+  size_t k = std::min(candidates.size(), static_cast<size_t>(top_k_));
+  std::partial_sort(
+    candidates.begin(), candidates.begin() + k, candidates.end(),
+    [this](unsigned int a, unsigned int b) {return scores_[a] < scores_[b];});
+  candidates.resize(k);
+  if (candidates.empty() && warm_start_ >= 0) {
+    candidates.push_back(warm_start_);
+  }
+
+  const unsigned int radius = stride_ - 1;
+  auto range = [radius](unsigned int center, size_t size, unsigned int & first,
+      unsigned int & last) {
+      first = center > radius ? center - radius : 0;
+      last = std::min<size_t>(center + radius, size - 1);
+    };
+  for (unsigned int index : candidates) {
+    unsigned int cth = index % th_samples_.size();
+    unsigned int cy = (index / th_samples_.size()) % y_samples_.size();
+    unsigned int cx = index / th_samples_.size() / y_samples_.size();
+    unsigned int x0, x1, y0, y1, th0, th1;
+    range(cx, x_samples_.size(), x0, x1);
+    range(cy, y_samples_.size(), y0, y1);
+    range(cth, th_samples_.size(), th0, th1);
+    for (unsigned int ix = x0; ix <= x1; ix++) {
+      for (unsigned int iy = y0; iy <= y1; iy++) {
+        for (unsigned int ith = th0; ith <= th1; ith++) {
+          queueSample(ix, iy, ith);
+        }
+      }
+    }
+  }
+}
+
+unsigned int AdaptiveXYThetaIterator::closestSample(
+  const std::vector<double> & samples, double velocity)
+{
+  auto it = std::lower_bound(samples.begin(), samples.end(), velocity);
+  if (it == samples.end()) {
+    return samples.size() - 1;
+  }
+  if (it != samples.begin() && velocity - *(it - 1) < *it - velocity) {
+    --it;
+  }
+  return it - samples.begin();
+}
+
+}  // namespace dwb_plugins
@@ -40,22 +40,18 @@
 #include "nav_2d_utils/parameters.hpp"
 #include "nav2_util/node_utils.hpp"
 
-using nav2_util::declare_parameter_if_not_declared;
 using nav_2d_utils::moveDeprecatedParameter;
-using rcl_interfaces::msg::ParameterType;
-using std::placeholders::_1;
 
 namespace dwb_plugins
 {
 
 KinematicsHandler::KinematicsHandler()
+: kinematics_(std::make_shared<KinematicParameters>())
 {
-  kinematics_.store(new KinematicParameters);
 }
 
 KinematicsHandler::~KinematicsHandler()
 {
-  delete kinematics_.load();
 }
 
 void KinematicsHandler::initialize(
@@ -69,119 +65,36 @@ void KinematicsHandler::initialize(
   moveDeprecatedParameter<double>(nh, plugin_name + ".max_speed_xy", "max_trans_vel");
   moveDeprecatedParameter<double>(nh, plugin_name + ".min_speed_theta", "min_rot_vel");
 
-  declare_parameter_if_not_declared(nh, plugin_name + ".min_vel_x", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".min_vel_y", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".max_vel_x", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".max_vel_y", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".max_vel_theta",
-    rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".min_speed_xy",
-    rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".max_speed_xy",
-    rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".min_speed_theta",
-    rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".acc_lim_x", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".acc_lim_y", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".acc_lim_theta",
-    rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".decel_lim_x", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(nh, plugin_name + ".decel_lim_y", rclcpp::ParameterValue(0.0));
-  declare_parameter_if_not_declared(
-    nh, plugin_name + ".decel_lim_theta",
-    rclcpp::ParameterValue(0.0));
-
-  KinematicParameters kinematics;
-
-  nh->get_parameter(plugin_name + ".min_vel_x", kinematics.min_vel_x_);
-  nh->get_parameter(plugin_name + ".min_vel_y", kinematics.min_vel_y_);
-  nh->get_parameter(plugin_name + ".max_vel_x", kinematics.max_vel_x_);
-  nh->get_parameter(plugin_name + ".max_vel_y", kinematics.max_vel_y_);
-  nh->get_parameter(plugin_name + ".max_vel_theta", kinematics.max_vel_theta_);
-  nh->get_parameter(plugin_name + ".min_speed_xy", kinematics.min_speed_xy_);
-  nh->get_parameter(plugin_name + ".max_speed_xy", kinematics.max_speed_xy_);
-  nh->get_parameter(plugin_name + ".min_speed_theta", kinematics.min_speed_theta_);
-  nh->get_parameter(plugin_name + ".acc_lim_x", kinematics.acc_lim_x_);
-  nh->get_parameter(plugin_name + ".acc_lim_y", kinematics.acc_lim_y_);
-  nh->get_parameter(plugin_name + ".acc_lim_theta", kinematics.acc_lim_theta_);
-  nh->get_parameter(plugin_name + ".decel_lim_x", kinematics.decel_lim_x_);
-  nh->get_parameter(plugin_name + ".decel_lim_y", kinematics.decel_lim_y_);
-  nh->get_parameter(plugin_name + ".decel_lim_theta", kinematics.decel_lim_theta_);
-
-  // Setup callback for changes to parameters.
-  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
-    nh->get_node_base_interface(),
-    nh->get_node_topics_interface(),
-    nh->get_node_graph_interface(),
-    nh->get_node_services_interface());
-
-  parameter_event_sub_ = parameters_client_->on_parameter_event(
-    std::bind(&KinematicsHandler::on_parameter_event_callback, this, _1));
-
-  kinematics.min_speed_xy_sq_ = kinematics.min_speed_xy_ * kinematics.min_speed_xy_;
-  kinematics.max_speed_xy_sq_ = kinematics.max_speed_xy_ * kinematics.max_speed_xy_;
-
-  update_kinematics(kinematics);
-}
-
-
-void
-KinematicsHandler::on_parameter_event_callback(
-  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
-{
-  KinematicParameters kinematics(*kinematics_.load());
-
-  for (auto & changed_parameter : event->changed_parameters) {
-    const auto & type = changed_parameter.value.type;
-    const auto & name = changed_parameter.name;
-    const auto & value = changed_parameter.value;
-
-    if (type == ParameterType::PARAMETER_DOUBLE) {
-      if (name == plugin_name_ + ".min_vel_x") {
-        kinematics.min_vel_x_ = value.double_value;
-      } else if (name == plugin_name_ + ".min_vel_y") {
-        kinematics.min_vel_y_ = value.double_value;
-      } else if (name == plugin_name_ + ".max_vel_x") {
-        kinematics.max_vel_x_ = value.double_value;
-      } else if (name == plugin_name_ + ".max_vel_y") {
-        kinematics.max_vel_y_ = value.double_value;
-      } else if (name == plugin_name_ + ".max_vel_theta") {
-        kinematics.max_vel_theta_ = value.double_value;
-      } else if (name == plugin_name_ + ".min_speed_xy") {
-        kinematics.min_speed_xy_ = value.double_value;
-        kinematics.min_speed_xy_sq_ = kinematics.min_speed_xy_ * kinematics.min_speed_xy_;
-      } else if (name == plugin_name_ + ".max_speed_xy") {
-        kinematics.max_speed_xy_ = value.double_value;
-      } else if (name == plugin_name_ + ".min_speed_theta") {
-        kinematics.min_speed_theta_ = value.double_value;
-        kinematics.max_speed_xy_sq_ = kinematics.max_speed_xy_ * kinematics.max_speed_xy_;
-      } else if (name == plugin_name_ + ".acc_lim_x") {
-        kinematics.acc_lim_x_ = value.double_value;
-      } else if (name == plugin_name_ + ".acc_lim_y") {
-        kinematics.acc_lim_y_ = value.double_value;
-      } else if (name == plugin_name_ + ".acc_lim_theta") {
-        kinematics.acc_lim_theta_ = value.double_value;
-      } else if (name == plugin_name_ + ".decel_lim_x") {
-        kinematics.decel_lim_x_ = value.double_value;
-      } else if (name == plugin_name_ + ".decel_lim_y") {
-        kinematics.decel_lim_y_ = value.double_value;
-      } else if (name == plugin_name_ + ".decel_lim_theta") {
-        kinematics.decel_lim_theta_ = value.double_value;
-      }
-    }
-  }
-  update_kinematics(kinematics);
+  // Set from parameter events as well, pending_ is only touched on their thread
+  bindings_ = std::make_unique<nav2_util::ParameterBindings>(nh);
+  const rclcpp::ParameterValue zero(0.0);
+  bindings_->bind(plugin_name + ".min_vel_x", zero, pending_.min_vel_x_);
+  bindings_->bind(plugin_name + ".min_vel_y", zero, pending_.min_vel_y_);
+  bindings_->bind(plugin_name + ".max_vel_x", zero, pending_.max_vel_x_);
+  bindings_->bind(plugin_name + ".max_vel_y", zero, pending_.max_vel_y_);
+  bindings_->bind(plugin_name + ".max_vel_theta", zero, pending_.max_vel_theta_);
+  bindings_->bind(plugin_name + ".min_speed_xy", zero, pending_.min_speed_xy_);
+  bindings_->bind(plugin_name + ".max_speed_xy", zero, pending_.max_speed_xy_);
+  bindings_->bind(plugin_name + ".min_speed_theta", zero, pending_.min_speed_theta_);
+  bindings_->bind(plugin_name + ".acc_lim_x", zero, pending_.acc_lim_x_);
+  bindings_->bind(plugin_name + ".acc_lim_y", zero, pending_.acc_lim_y_);
+  bindings_->bind(plugin_name + ".acc_lim_theta", zero, pending_.acc_lim_theta_);
+  bindings_->bind(plugin_name + ".decel_lim_x", zero, pending_.decel_lim_x_);
+  bindings_->bind(plugin_name + ".decel_lim_y", zero, pending_.decel_lim_y_);
+  bindings_->bind(plugin_name + ".decel_lim_theta", zero, pending_.decel_lim_theta_);
+  bindings_->on_update([this]() {update_kinematics(pending_);});
+
+  update_kinematics(pending_);
 }
 
 void KinematicsHandler::update_kinematics(KinematicParameters kinematics)
 {
-  delete kinematics_.load();
-  kinematics_.store(new KinematicParameters(kinematics));
+  kinematics.min_speed_xy_sq_ = kinematics.min_speed_xy_ * kinematics.min_speed_xy_;
+  kinematics.max_speed_xy_sq_ = kinematics.max_speed_xy_ * kinematics.max_speed_xy_;
+
+  // Readers keep the snapshot they hold until they let go of it
+  std::atomic_store(
+    &kinematics_, KinematicParameters::ConstPtr(std::make_shared<KinematicParameters>(kinematics)));
 }
 
 }  // namespace dwb_plugins
@@ -71,6 +71,7 @@ void LimitedAccelGenerator::initialize(
 
 void LimitedAccelGenerator::startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity)
 {
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
   // Limit our search space to just those within the limited acceleration_time
   velocity_iterator_->startNewIteration(current_velocity, acceleration_time_);
 }
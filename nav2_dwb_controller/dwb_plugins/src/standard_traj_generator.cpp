@@ -33,21 +33,127 @@
  */
 
 #include "dwb_plugins/standard_traj_generator.hpp"
+#include <cmath>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <memory>
 #include "dwb_plugins/xy_theta_iterator.hpp"
+#include "dwb_plugins/adaptive_xy_theta_iterator.hpp"
 #include "nav_2d_utils/parameters.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "dwb_core/exceptions.hpp"
 #include "nav2_util/node_utils.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define DWB_PLUGINS_SSE2
+#include <emmintrin.h>
+#endif
+
 using nav_2d_utils::loadParameterWithDeprecation;
 
 namespace dwb_plugins
 {
 
+namespace
+{
+
+// Number of trajectories integrated side by side
+constexpr size_t LOCKSTEP_WIDTH = 8;
+
+// Polynomials for sin and cos on [-pi/4, pi/4], from fdlibm's kernels
+constexpr double S1 = -1.66666666666666324348e-01;
+constexpr double S2 = 8.33333333332248946124e-03;
+constexpr double S3 = -1.98412698298579493134e-04;
+constexpr double S4 = 2.75573137070700676789e-06;
+constexpr double S5 = -2.50507602534068634195e-08;
+constexpr double S6 = 1.58969099521155010221e-10;
+constexpr double C1 = 4.16666666666666019037e-02;
+constexpr double C2 = -1.38888888888741095749e-03;
+constexpr double C3 = 2.48015872894767294178e-05;
+constexpr double C4 = -2.75573143513906633035e-07;
+constexpr double C5 = 2.08757232129817482790e-09;
+constexpr double C6 = -1.13596475577881948265e-11;
+// pi/2 split in two, so that the reduction is exact for the headings of a rollout
+constexpr double PIO2_HI = 1.57079632673412561417e+00;
+constexpr double PIO2_LO = 6.07710050650619224932e-11;
+constexpr double TWO_OVER_PI = 6.36619772367581382433e-01;
+
+inline void sinCos(double theta, double & s, double & c)
+{
+  double j = std::nearbyint(theta * TWO_OVER_PI);
+  double r = (theta - j * PIO2_HI) - j * PIO2_LO;
+  double z = r * r;
+  double sr = r + r * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+  double cr = 1.0 - 0.5 * z + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+  // Rotate by the quadrant
+  int q = static_cast<int>(j) & 3;
+  s = q == 0 ? sr : q == 1 ? cr : q == 2 ? -sr : -cr;
+  c = q == 0 ? cr : q == 1 ? -sr : q == 2 ? -cr : sr;
+}
+
+#ifdef DWB_PLUGINS_SSE2
+// Same as above for two headings at once, the quadrant picked with masks
+inline void sinCos2(const double * theta, double * s, double * c)
+{
+  __m128d t = _mm_loadu_pd(theta);
+  __m128i ji = _mm_cvtpd_epi32(_mm_mul_pd(t, _mm_set1_pd(TWO_OVER_PI)));
+  __m128d j = _mm_cvtepi32_pd(ji);
+  __m128d r = _mm_sub_pd(
+    _mm_sub_pd(t, _mm_mul_pd(j, _mm_set1_pd(PIO2_HI))), _mm_mul_pd(j, _mm_set1_pd(PIO2_LO)));
+  __m128d z = _mm_mul_pd(r, r);
+
+  __m128d ps = _mm_add_pd(_mm_set1_pd(S5), _mm_mul_pd(z, _mm_set1_pd(S6)));
+  ps = _mm_add_pd(_mm_set1_pd(S4), _mm_mul_pd(z, ps));
+  ps = _mm_add_pd(_mm_set1_pd(S3), _mm_mul_pd(z, ps));
+  ps = _mm_add_pd(_mm_set1_pd(S2), _mm_mul_pd(z, ps));
+  ps = _mm_add_pd(_mm_set1_pd(S1), _mm_mul_pd(z, ps));
+  __m128d sr = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+  __m128d pc = _mm_add_pd(_mm_set1_pd(C5), _mm_mul_pd(z, _mm_set1_pd(C6)));
+  pc = _mm_add_pd(_mm_set1_pd(C4), _mm_mul_pd(z, pc));
+  pc = _mm_add_pd(_mm_set1_pd(C3), _mm_mul_pd(z, pc));
+  pc = _mm_add_pd(_mm_set1_pd(C2), _mm_mul_pd(z, pc));
+  pc = _mm_add_pd(_mm_set1_pd(C1), _mm_mul_pd(z, pc));
+  __m128d cr = _mm_add_pd(
+    _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z)),
+    _mm_mul_pd(_mm_mul_pd(z, z), pc));
+
+  // Odd quadrants swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2 negate cos
+  __m128i q = _mm_shuffle_epi32(ji, _MM_SHUFFLE(1, 1, 0, 0));
+  __m128d swap = _mm_castsi128_pd(
+    _mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+  __m128d neg_s = _mm_castsi128_pd(
+    _mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+  __m128d neg_c = _mm_castsi128_pd(
+    _mm_cmpeq_epi32(
+      _mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)),
+      _mm_set1_epi32(2)));
+  __m128d sign = _mm_set1_pd(-0.0);
+  __m128d vs = _mm_or_pd(_mm_and_pd(swap, cr), _mm_andnot_pd(swap, sr));
+  __m128d vc = _mm_or_pd(_mm_and_pd(swap, sr), _mm_andnot_pd(swap, cr));
+  vs = _mm_xor_pd(vs, _mm_and_pd(neg_s, sign));
+  vc = _mm_xor_pd(vc, _mm_and_pd(neg_c, sign));
+  _mm_storeu_pd(s, vs);
+  _mm_storeu_pd(c, vc);
+}
+#endif
+
+void sinCos(const double * theta, double * s, double * c, size_t n)
+{
+  size_t i = 0;
+#ifdef DWB_PLUGINS_SSE2
+  for (; i + 2 <= n; i += 2) {
+    sinCos2(theta + i, s + i, c + i);
+  }
+#endif
+  for (; i < n; i++) {
+    sinCos(theta[i], s[i], c[i]);
+  }
+}
+
+}  // namespace
+
 void StandardTrajectoryGenerator::initialize(
   const nav2_util::LifecycleNode::SharedPtr & nh,
   const std::string & plugin_name)
@@ -55,6 +161,7 @@ void StandardTrajectoryGenerator::initialize(
   plugin_name_ = plugin_name;
   kinematics_handler_ = std::make_shared<KinematicsHandler>();
   kinematics_handler_->initialize(nh, plugin_name_);
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
   initializeIterator(nh);
 
   nav2_util::declare_parameter_if_not_declared(
@@ -76,6 +183,9 @@ void StandardTrajectoryGenerator::initialize(
   nav2_util::declare_parameter_if_not_declared(
     nh,
     plugin_name + ".include_last_point", rclcpp::ParameterValue(true));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".lockstep_rollout", rclcpp::ParameterValue(false));
 
   /*
    * If discretize_by_time, then sim_granularity represents the amount of time that should be between
@@ -91,18 +201,30 @@ void StandardTrajectoryGenerator::initialize(
   nh->get_parameter(plugin_name + ".linear_granularity", linear_granularity_);
   nh->get_parameter(plugin_name + ".angular_granularity", angular_granularity_);
   nh->get_parameter(plugin_name + ".include_last_point", include_last_point_);
+  nh->get_parameter(plugin_name + ".lockstep_rollout", lockstep_rollout_);
 }
 
 void StandardTrajectoryGenerator::initializeIterator(
   const nav2_util::LifecycleNode::SharedPtr & nh)
 {
-  velocity_iterator_ = std::make_shared<XYThetaIterator>();
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name_ + ".adaptive_sampling", rclcpp::ParameterValue(false));
+  bool adaptive_sampling;
+  nh->get_parameter(plugin_name_ + ".adaptive_sampling", adaptive_sampling);
+
+  if (adaptive_sampling) {
+    velocity_iterator_ = std::make_shared<AdaptiveXYThetaIterator>();
+  } else {
+    velocity_iterator_ = std::make_shared<XYThetaIterator>();
+  }
   velocity_iterator_->initialize(nh, kinematics_handler_, plugin_name_);
 }
 
 void StandardTrajectoryGenerator::startNewIteration(
   const nav_2d_msgs::msg::Twist2D & current_velocity)
 {
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
   velocity_iterator_->startNewIteration(current_velocity, sim_time_);
 }
 
@@ -116,12 +238,17 @@ nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::nextTwist()
   return velocity_iterator_->nextTwist();
 }
 
-std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
-  const nav_2d_msgs::msg::Twist2D & cmd_vel)
+void StandardTrajectoryGenerator::reportScore(
+  const nav_2d_msgs::msg::Twist2D & twist, double score)
+{
+  velocity_iterator_->reportScore(twist, score);
+}
+
+int StandardTrajectoryGenerator::getNumTimeSteps(const nav_2d_msgs::msg::Twist2D & cmd_vel) const
 {
-  std::vector<double> steps;
+  int num_steps;
   if (discretize_by_time_) {
-    steps.resize(ceil(sim_time_ / time_granularity_));
+    num_steps = ceil(sim_time_ / time_granularity_);
   } else {  // discretize by distance
     double vmag = hypot(cmd_vel.x, cmd_vel.y);
 
@@ -132,15 +259,18 @@ std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
     double projected_angular_distance = fabs(cmd_vel.theta) * sim_time_;
 
     // Pick the maximum of the two
-    int num_steps = ceil(
+    num_steps = ceil(
       std::max(
         projected_linear_distance / linear_granularity_,
         projected_angular_distance / angular_granularity_));
-    steps.resize(num_steps);
-  }
-  if (steps.size() == 0) {
-    steps.resize(1);
   }
+  return std::max(num_steps, 1);
+}
+
+std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
+  const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  std::vector<double> steps(getNumTimeSteps(cmd_vel));
   std::fill(steps.begin(), steps.end(), sim_time_ / steps.size());
   return steps;
 }
@@ -178,6 +308,130 @@ dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::generateTrajectory(
   return traj;
 }
 
+void StandardTrajectoryGenerator::generateTrajectories(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+  dwb_core::TrajectoryBatch & batch)
+{
+  if (lockstep_rollout_) {
+    generateTrajectoriesLockstep(start_pose, start_vel, cmd_vels, batch);
+    return;
+  }
+
+  // Same simulation as generateTrajectory, writing the poses into the batch
+  for (const auto & cmd_vel : cmd_vels) {
+    batch.addTrajectory(cmd_vel);
+    geometry_msgs::msg::Pose2D pose = start_pose;
+    nav_2d_msgs::msg::Twist2D vel = start_vel;
+    double running_time = 0.0;
+    std::vector<double> steps = getTimeSteps(cmd_vel);
+    batch.addPose(pose.x, pose.y, pose.theta, 0.0);
+    for (double dt : steps) {
+      vel = computeNewVelocity(cmd_vel, vel, dt);
+      pose = computeNewPosition(pose, vel, dt);
+      batch.addPose(pose.x, pose.y, pose.theta, running_time);
+      running_time += dt;
+    }
+
+    if (include_last_point_) {
+      batch.addPose(pose.x, pose.y, pose.theta, running_time);
+    }
+  }
+}
+
+void StandardTrajectoryGenerator::generateTrajectoriesLockstep(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+  dwb_core::TrajectoryBatch & batch)
+{
+  const KinematicParameters & kinematics = *kinematics_;
+  const bool limit_accel = limitsAcceleration();
+  const size_t extra_poses = include_last_point_ ? 2 : 1;
+
+  // Lay out all the trajectories in the batch first, in the order of cmd_vels
+  std::vector<int> num_steps(cmd_vels.size());
+  std::vector<size_t> first_pose(cmd_vels.size());
+  for (size_t i = 0; i < cmd_vels.size(); i++) {
+    num_steps[i] = getNumTimeSteps(cmd_vels[i]);
+    size_t index = batch.addTrajectory(cmd_vels[i], num_steps[i] + extra_poses);
+    first_pose[i] = batch.begin(index);
+  }
+
+  // Group the trajectories by their number of steps, they then share the time
+  // steps and can be integrated side by side
+  std::vector<size_t> order(cmd_vels.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(
+    order.begin(), order.end(),
+    [&num_steps](size_t a, size_t b) {return num_steps[a] < num_steps[b];});
+
+  double x[LOCKSTEP_WIDTH], y[LOCKSTEP_WIDTH], theta[LOCKSTEP_WIDTH];
+  double vx[LOCKSTEP_WIDTH], vy[LOCKSTEP_WIDTH], vtheta[LOCKSTEP_WIDTH];
+  double sin_theta[LOCKSTEP_WIDTH], cos_theta[LOCKSTEP_WIDTH];
+  size_t group = 0;
+  while (group < order.size()) {
+    const int steps = num_steps[order[group]];
+    size_t lanes = 1;
+    while (lanes < LOCKSTEP_WIDTH && group + lanes < order.size() &&
+      num_steps[order[group + lanes]] == steps)
+    {
+      lanes++;
+    }
+    const size_t * members = &order[group];
+    const double dt = sim_time_ / steps;
+
+    for (size_t l = 0; l < lanes; l++) {
+      x[l] = start_pose.x;
+      y[l] = start_pose.y;
+      theta[l] = start_pose.theta;
+      vx[l] = start_vel.x;
+      vy[l] = start_vel.y;
+      vtheta[l] = start_vel.theta;
+      batch.setPose(first_pose[members[l]], x[l], y[l], theta[l], 0.0);
+    }
+
+    double running_time = 0.0;
+    for (int k = 0; k < steps; k++) {
+      for (size_t l = 0; l < lanes; l++) {
+        const nav_2d_msgs::msg::Twist2D & cmd_vel = cmd_vels[members[l]];
+        if (limit_accel) {
+          vx[l] = projectVelocity(
+            vx[l], kinematics.getAccX(), kinematics.getDecelX(), dt, cmd_vel.x);
+          vy[l] = projectVelocity(
+            vy[l], kinematics.getAccY(), kinematics.getDecelY(), dt, cmd_vel.y);
+          vtheta[l] = projectVelocity(
+            vtheta[l], kinematics.getAccTheta(), kinematics.getDecelTheta(), dt, cmd_vel.theta);
+        } else {
+          vx[l] = cmd_vel.x;
+          vy[l] = cmd_vel.y;
+          vtheta[l] = cmd_vel.theta;
+        }
+      }
+
+      // cos(M_PI_2 + theta) = -sin(theta) and sin(M_PI_2 + theta) = cos(theta)
+      sinCos(theta, sin_theta, cos_theta, lanes);
+      for (size_t l = 0; l < lanes; l++) {
+        x[l] += (vx[l] * cos_theta[l] - vy[l] * sin_theta[l]) * dt;
+        y[l] += (vx[l] * sin_theta[l] + vy[l] * cos_theta[l]) * dt;
+        theta[l] += vtheta[l] * dt;
+        batch.setPose(first_pose[members[l]] + k + 1, x[l], y[l], theta[l], running_time);
+      }
+      running_time += dt;
+    }
+
+    if (include_last_point_) {
+      for (size_t l = 0; l < lanes; l++) {
+        batch.setPose(first_pose[members[l]] + steps + 1, x[l], y[l], theta[l], running_time);
+      }
+    }
+    group += lanes;
+  }
+}
+
 /**
  * change vel using acceleration limits to converge towards sample_target-vel
  */
@@ -185,7 +439,7 @@ nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::computeNewVelocity(
   const nav_2d_msgs::msg::Twist2D & cmd_vel,
   const nav_2d_msgs::msg::Twist2D & start_vel, const double dt)
 {
-  KinematicParameters kinematics = kinematics_handler_->getKinematics();
+  const KinematicParameters & kinematics = *kinematics_;
   nav_2d_msgs::msg::Twist2D new_vel;
   new_vel.x = projectVelocity(
     start_vel.x, kinematics.getAccX(),
@@ -0,0 +1,180 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dwb_plugins/trajectory_library_generator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "nav2_util/node_utils.hpp"
+#include "pluginlib/class_list_macros.hpp"
+
+namespace dwb_plugins
+{
+
+void TrajectoryLibraryGenerator::initialize(
+  const nav2_util::LifecycleNode::SharedPtr & nh,
+  const std::string & plugin_name)
+{
+  StandardTrajectoryGenerator::initialize(nh, plugin_name);
+  nav2_util::declare_parameter_if_not_declared(
+    nh, plugin_name + ".library_linear_resolution", rclcpp::ParameterValue(0.01));
+  nav2_util::declare_parameter_if_not_declared(
+    nh, plugin_name + ".library_angular_resolution", rclcpp::ParameterValue(0.02));
+  nav2_util::declare_parameter_if_not_declared(
+    nh, plugin_name + ".library_max_size", rclcpp::ParameterValue(100000));
+  nh->get_parameter(plugin_name + ".library_linear_resolution", linear_resolution_);
+  nh->get_parameter(plugin_name + ".library_angular_resolution", angular_resolution_);
+  int max_size;
+  nh->get_parameter(plugin_name + ".library_max_size", max_size);
+  max_size_ = static_cast<std::size_t>(std::max(max_size, 1));
+  if (linear_resolution_ <= 0.0 || angular_resolution_ <= 0.0) {
+    throw std::runtime_error(
+            plugin_name + ": library_linear_resolution and library_angular_resolution "
+            "must be positive");
+  }
+  library_kinematics_ = kinematics_;
+}
+
+void TrajectoryLibraryGenerator::startNewIteration(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  StandardTrajectoryGenerator::startNewIteration(current_velocity);
+  // The accelerations shape the trajectories, a new set of limits starts a new library
+  if (kinematics_ != library_kinematics_) {
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    library_.clear();
+    library_kinematics_ = kinematics_;
+  }
+}
+
+std::size_t TrajectoryLibraryGenerator::librarySize()
+{
+  std::lock_guard<std::mutex> lock(library_mutex_);
+  return library_.size();
+}
+
+std::size_t TrajectoryLibraryGenerator::KeyHash::operator()(const Key & key) const
+{
+  std::size_t hash = 0;
+  for (int32_t value : key) {
+    hash = hash * 1000003u ^ static_cast<uint32_t>(value);
+  }
+  return hash;
+}
+
+std::shared_ptr<const TrajectoryLibraryGenerator::Primitive>
+TrajectoryLibraryGenerator::getPrimitive(
+  const nav_2d_msgs::msg::Twist2D & start_vel, const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  auto step = [](double value, double resolution) {
+      return static_cast<int32_t>(std::lround(value / resolution));
+    };
+  const Key key{{
+      step(start_vel.x, linear_resolution_), step(start_vel.y, linear_resolution_),
+      step(start_vel.theta, angular_resolution_), step(cmd_vel.x, linear_resolution_),
+      step(cmd_vel.y, linear_resolution_), step(cmd_vel.theta, angular_resolution_)}};
+  {
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    auto it = library_.find(key);
+    if (it != library_.end()) {
+      return it->second;
+    }
+  }
+
+  // Simulated from the origin with the velocities of the lattice point
+  nav_2d_msgs::msg::Twist2D lattice_start, lattice_cmd;
+  lattice_start.x = key[0] * linear_resolution_;
+  lattice_start.y = key[1] * linear_resolution_;
+  lattice_start.theta = key[2] * angular_resolution_;
+  lattice_cmd.x = key[3] * linear_resolution_;
+  lattice_cmd.y = key[4] * linear_resolution_;
+  lattice_cmd.theta = key[5] * angular_resolution_;
+  const dwb_msgs::msg::Trajectory2D traj = StandardTrajectoryGenerator::generateTrajectory(
+    geometry_msgs::msg::Pose2D(), lattice_start, lattice_cmd);
+
+  auto primitive = std::make_shared<Primitive>();
+  const std::size_t n = traj.poses.size();
+  primitive->x.resize(n);
+  primitive->y.resize(n);
+  primitive->theta.resize(n);
+  primitive->time.resize(n);
+  for (std::size_t k = 0; k < n; k++) {
+    primitive->x[k] = traj.poses[k].x;
+    primitive->y[k] = traj.poses[k].y;
+    primitive->theta[k] = traj.poses[k].theta;
+    // The first pose has no time offset
+    primitive->time[k] = k == 0 ? 0.0 : rclcpp::Duration(traj.time_offsets[k - 1]).seconds();
+  }
+
+  std::lock_guard<std::mutex> lock(library_mutex_);
+  if (library_.size() >= max_size_) {
+    library_.clear();
+  }
+  library_.emplace(key, primitive);
+  return primitive;
+}
+
+dwb_msgs::msg::Trajectory2D TrajectoryLibraryGenerator::generateTrajectory(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel)
+{
+  const std::shared_ptr<const Primitive> primitive = getPrimitive(start_vel, cmd_vel);
+  const Primitive & p = *primitive;
+  const double c = cos(start_pose.theta);
+  const double s = sin(start_pose.theta);
+
+  dwb_msgs::msg::Trajectory2D traj;
+  traj.velocity = cmd_vel;
+  traj.poses.resize(p.x.size());
+  traj.time_offsets.reserve(p.x.size() - 1);
+  for (std::size_t k = 0; k < p.x.size(); k++) {
+    traj.poses[k].x = start_pose.x + c * p.x[k] - s * p.y[k];
+    traj.poses[k].y = start_pose.y + s * p.x[k] + c * p.y[k];
+    traj.poses[k].theta = start_pose.theta + p.theta[k];
+    if (k > 0) {
+      traj.time_offsets.push_back(rclcpp::Duration::from_seconds(p.time[k]));
+    }
+  }
+  return traj;
+}
+
+void TrajectoryLibraryGenerator::generateTrajectories(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const std::vector<nav_2d_msgs::msg::Twist2D> & cmd_vels,
+  dwb_core::TrajectoryBatch & batch)
+{
+  const double c = cos(start_pose.theta);
+  const double s = sin(start_pose.theta);
+  for (const auto & cmd_vel : cmd_vels) {
+    const std::shared_ptr<const Primitive> primitive = getPrimitive(start_vel, cmd_vel);
+    const Primitive & p = *primitive;
+    const std::size_t first = batch.begin(batch.addTrajectory(cmd_vel, p.x.size()));
+    for (std::size_t k = 0; k < p.x.size(); k++) {
+      batch.setPose(
+        first + k, start_pose.x + c * p.x[k] - s * p.y[k], start_pose.y + s * p.x[k] + c * p.y[k],
+        start_pose.theta + p.theta[k], p.time[k]);
+    }
+  }
+}
+
+}  // namespace dwb_plugins
+
+PLUGINLIB_EXPORT_CLASS(
+  dwb_plugins::TrajectoryLibraryGenerator,
+  dwb_core::TrajectoryGenerator)
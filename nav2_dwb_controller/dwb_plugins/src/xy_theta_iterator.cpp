@@ -51,6 +51,7 @@ void XYThetaIterator::initialize(
   const std::string & plugin_name)
 {
   kinematics_handler_ = kinematics;
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
 
   nav2_util::declare_parameter_if_not_declared(
     nh,
@@ -71,7 +72,8 @@ void XYThetaIterator::startNewIteration(
   const nav_2d_msgs::msg::Twist2D & current_velocity,
   double dt)
 {
-  KinematicParameters kinematics = kinematics_handler_->getKinematics();
+  kinematics_ = kinematics_handler_->getKinematicsSnapshot();
+  const KinematicParameters & kinematics = *kinematics_;
   x_it_ = std::make_shared<OneDVelocityIterator>(
     current_velocity.x,
     kinematics.getMinX(), kinematics.getMaxX(),
@@ -94,7 +96,7 @@ void XYThetaIterator::startNewIteration(
 
 bool XYThetaIterator::isValidSpeed(double x, double y, double theta)
 {
-  KinematicParameters kinematics = kinematics_handler_->getKinematics();
+  const KinematicParameters & kinematics = *kinematics_;
   double vmag_sq = x * x + y * y;
   if (kinematics.getMaxSpeedXY() >= 0.0 && vmag_sq > kinematics.getMaxSpeedXY_SQ() + EPSILON) {
     return false;
@@ -104,7 +106,7 @@ bool XYThetaIterator::isValidSpeed(double x, double y, double theta)
   {
     return false;
   }
-  if (vmag_sq == 0.0 && th_it_->getVelocity() == 0.0) {
+  if (vmag_sq == 0.0 && theta == 0.0) {
     return false;
   }
   return true;
@@ -40,6 +40,7 @@
 #include "gtest/gtest.h"
 #include "dwb_plugins/standard_traj_generator.hpp"
 #include "dwb_plugins/limited_accel_generator.hpp"
+#include "dwb_plugins/trajectory_library_generator.hpp"
 #include "dwb_core/exceptions.hpp"
 #include "nav2_util/node_utils.hpp"
 
@@ -144,6 +145,46 @@ TEST(VelocityIterator, standard_gen)
   checkLimits(twists, 0.0, 0.55, -0.1, 0.1, -1.0, 1.0, 0.55, 0.1, 0.4);
 }
 
+TEST(VelocityIterator, adaptive_gen)
+{
+  auto nh = makeTestNode("adaptive_gen", {rclcpp::Parameter("dwb.adaptive_sampling", true)});
+  StandardTrajectoryGenerator gen;
+  gen.initialize(nh, "dwb");
+  std::vector<nav_2d_msgs::msg::Twist2D> twists = gen.getTwists(zero);
+  EXPECT_LT(twists.size(), 1926u / 3);
+  checkLimits(twists, 0.0, 0.55, -0.1, 0.1, -1.0, 1.0, 0.55, 0.1, 0.4);
+
+  // With scores reported, refinement finds the best twist of the full grid
+  auto score = [](const nav_2d_msgs::msg::Twist2D & twist) {
+      return hypot(twist.x - 0.23, twist.y - 0.02) + fabs(twist.theta - 0.31);
+    };
+  auto full_nh = makeTestNode("adaptive_gen_full");
+  StandardTrajectoryGenerator full_gen;
+  full_gen.initialize(full_nh, "dwb");
+  double full_best = -1.0;
+  for (const nav_2d_msgs::msg::Twist2D & twist : full_gen.getTwists(zero)) {
+    if (full_best < 0.0 || score(twist) < full_best) {
+      full_best = score(twist);
+    }
+  }
+
+  for (int iteration = 0; iteration < 2; iteration++) {
+    double best = -1.0;
+    unsigned int count = 0;
+    gen.startNewIteration(zero);
+    while (gen.hasMoreTwists()) {
+      nav_2d_msgs::msg::Twist2D twist = gen.nextTwist();
+      gen.reportScore(twist, score(twist));
+      if (best < 0.0 || score(twist) < best) {
+        best = score(twist);
+      }
+      count++;
+    }
+    EXPECT_DOUBLE_EQ(best, full_best);
+    EXPECT_LT(count, 1926u / 3);
+  }
+}
+
 TEST(VelocityIterator, max_xy)
 {
   auto nh = makeTestNode("max_xy", {rclcpp::Parameter("dwb.max_speed_xy", 1.0)});
@@ -437,6 +478,103 @@ TEST(TrajectoryGenerator, dwa)
   matchPose(res.poses[5], 1.5, 0, 0);
 }
 
+void checkLockstep(StandardTrajectoryGenerator & gen, const nav_2d_msgs::msg::Twist2D & start_vel)
+{
+  geometry_msgs::msg::Pose2D start;
+  start.x = 1.0;
+  start.y = -2.0;
+  start.theta = 2.5;
+  std::vector<nav_2d_msgs::msg::Twist2D> twists = gen.getTwists(start_vel);
+  ASSERT_GT(twists.size(), 0u);
+
+  dwb_core::TrajectoryBatch batch;
+  gen.generateTrajectories(start, start_vel, twists, batch);
+  ASSERT_EQ(batch.size(), twists.size());
+  for (size_t i = 0; i < twists.size(); i++) {
+    dwb_msgs::msg::Trajectory2D expected = gen.generateTrajectory(start, start_vel, twists[i]);
+    dwb_msgs::msg::Trajectory2D res = batch.toMsg(i);
+    matchTwist(res.velocity, expected.velocity);
+    ASSERT_EQ(res.poses.size(), expected.poses.size());
+    ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+    for (size_t j = 0; j < res.poses.size(); j++) {
+      EXPECT_NEAR(res.poses[j].x, expected.poses[j].x, 1e-9);
+      EXPECT_NEAR(res.poses[j].y, expected.poses[j].y, 1e-9);
+      EXPECT_NEAR(res.poses[j].theta, expected.poses[j].theta, 1e-9);
+    }
+    for (size_t j = 0; j < res.time_offsets.size(); j++) {
+      EXPECT_NEAR(
+        durationToSec(res.time_offsets[j]), durationToSec(expected.time_offsets[j]), 1e-8);
+    }
+  }
+}
+
+TEST(TrajectoryGenerator, lockstep)
+{
+  auto nh = makeTestNode(
+    "lockstep", {
+    rclcpp::Parameter("dwb.lockstep_rollout", true),
+    rclcpp::Parameter("dwb.linear_granularity", 0.05),
+    rclcpp::Parameter("dwb.angular_granularity", 0.025)});
+  StandardTrajectoryGenerator gen;
+  gen.initialize(nh, "dwb");
+  checkLockstep(gen, forward);
+}
+
+TEST(TrajectoryGenerator, lockstep_dwa)
+{
+  auto nh = makeTestNode(
+    "lockstep_dwa", {
+    rclcpp::Parameter("dwb.lockstep_rollout", true),
+    rclcpp::Parameter("dwb.include_last_point", false),
+    rclcpp::Parameter("dwb.discretize_by_time", true),
+    rclcpp::Parameter("dwb.time_granularity", 0.1)});
+  dwb_plugins::LimitedAccelGenerator gen;
+  gen.initialize(nh, "dwb");
+  checkLockstep(gen, forward);
+}
+
+TEST(TrajectoryGenerator, library)
+{
+  auto nh = makeTestNode("library", {rclcpp::Parameter("dwb.linear_granularity", 0.05)});
+  StandardTrajectoryGenerator gen;
+  gen.initialize(nh, "dwb");
+  dwb_plugins::TrajectoryLibraryGenerator library_gen;
+  library_gen.initialize(nh, "dwb");
+
+  geometry_msgs::msg::Pose2D start;
+  start.x = 1.0;
+  start.y = -2.0;
+  start.theta = 0.7;
+  nav_2d_msgs::msg::Twist2D cmd;
+  cmd.x = 0.3;
+  cmd.theta = 0.5;
+  dwb_msgs::msg::Trajectory2D expected = gen.generateTrajectory(start, forward, cmd);
+  dwb_msgs::msg::Trajectory2D res = library_gen.generateTrajectory(start, forward, cmd);
+  EXPECT_EQ(library_gen.librarySize(), 1u);
+  matchTwist(res.velocity, cmd);
+  ASSERT_EQ(res.poses.size(), expected.poses.size());
+  ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+  for (unsigned int i = 0; i < res.poses.size(); i++) {
+    EXPECT_NEAR(res.poses[i].x, expected.poses[i].x, 1e-9);
+    EXPECT_NEAR(res.poses[i].y, expected.poses[i].y, 1e-9);
+    EXPECT_NEAR(res.poses[i].theta, expected.poses[i].theta, 1e-9);
+  }
+
+  // Velocities rounding to the same lattice point share the library trajectory
+  start.theta = -1.2;
+  cmd.x = 0.302;
+  res = library_gen.generateTrajectory(start, forward, cmd);
+  EXPECT_EQ(library_gen.librarySize(), 1u);
+  matchTwist(res.velocity, cmd);
+  expected = gen.generateTrajectory(start, forward, cmd);
+  ASSERT_EQ(res.poses.size(), expected.poses.size());
+  const double tolerance = 0.01 * DEFAULT_SIM_TIME;
+  for (unsigned int i = 0; i < res.poses.size(); i++) {
+    EXPECT_NEAR(res.poses[i].x, expected.poses[i].x, tolerance);
+    EXPECT_NEAR(res.poses[i].y, expected.poses[i].y, tolerance);
+  }
+}
+
 int main(int argc, char ** argv)
 {
   forward.x = 0.3;
@@ -43,6 +43,7 @@
 #include "nav_2d_msgs/msg/path2_d.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
 #include "nav_msgs/msg/path.hpp"
+#include "nav2_msgs/msg/compact_path.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "tf2/convert.h"
 
@@ -61,6 +62,7 @@ geometry_msgs::msg::PoseStamped pose2DToPoseStamped(
   const std::string & frame, const rclcpp::Time & stamp);
 nav_msgs::msg::Path posesToPath(const std::vector<geometry_msgs::msg::PoseStamped> & poses);
 nav_2d_msgs::msg::Path2D pathToPath2D(const nav_msgs::msg::Path & path);
+nav_2d_msgs::msg::Path2D compactPathToPath2D(const nav2_msgs::msg::CompactPath & path);
 nav_msgs::msg::Path poses2DToPath(
   const std::vector<geometry_msgs::msg::Pose2D> & poses,
   const std::string & frame, const rclcpp::Time & stamp);
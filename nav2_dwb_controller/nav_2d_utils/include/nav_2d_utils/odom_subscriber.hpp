@@ -36,6 +36,7 @@
 #define NAV_2D_UTILS__ODOM_SUBSCRIBER_HPP_
 
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -44,13 +45,15 @@
 #include "nav2_util/lifecycle_node.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/seqlock.hpp"
 
 namespace nav_2d_utils
 {
 
 /**
  * @class OdomSubscriber
- * Wrapper for some common odometry operations. Subscribes to the topic with a mutex.
+ * Wrapper for some common odometry operations. The latest velocity is kept in a SeqLock, so the
+ * controller reads it without waiting on the subscription callback.
  */
 class OdomSubscriber
 {
@@ -77,23 +80,62 @@ public:
       std::bind(&OdomSubscriber::odomCallback, this, std::placeholders::_1));
   }
 
-  inline nav_2d_msgs::msg::Twist2D getTwist() {return odom_vel_.velocity;}
-  inline nav_2d_msgs::msg::Twist2DStamped getTwistStamped() {return odom_vel_;}
+  inline nav_2d_msgs::msg::Twist2D getTwist()
+  {
+    const Velocity velocity = odom_vel_.load();
+    nav_2d_msgs::msg::Twist2D twist;
+    twist.x = velocity.x;
+    twist.y = velocity.y;
+    twist.theta = velocity.theta;
+    return twist;
+  }
+
+  inline nav_2d_msgs::msg::Twist2DStamped getTwistStamped()
+  {
+    const Velocity velocity = odom_vel_.load();
+    nav_2d_msgs::msg::Twist2DStamped twist;
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex_);
+      twist.header.frame_id = frame_id_;
+    }
+    twist.header.stamp.sec = velocity.sec;
+    twist.header.stamp.nanosec = velocity.nanosec;
+    twist.velocity.x = velocity.x;
+    twist.velocity.y = velocity.y;
+    twist.velocity.theta = velocity.theta;
+    return twist;
+  }
 
 protected:
   void odomCallback(const nav_msgs::msg::Odometry::SharedPtr msg)
   {
     // ROS_INFO_ONCE("odom received!");
-    std::lock_guard<std::mutex> lock(odom_mutex_);
-    odom_vel_.header = msg->header;
-    odom_vel_.velocity.x = msg->twist.twist.linear.x;
-    odom_vel_.velocity.y = msg->twist.twist.linear.y;
-    odom_vel_.velocity.theta = msg->twist.twist.angular.z;
+    Velocity velocity;
+    velocity.sec = msg->header.stamp.sec;
+    velocity.nanosec = msg->header.stamp.nanosec;
+    velocity.x = msg->twist.twist.linear.x;
+    velocity.y = msg->twist.twist.linear.y;
+    velocity.theta = msg->twist.twist.angular.z;
+    odom_vel_.store(velocity);
+
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (frame_id_ != msg->header.frame_id) {
+      frame_id_ = msg->header.frame_id;
+    }
   }
 
+  struct Velocity
+  {
+    int32_t sec;
+    uint32_t nanosec;
+    double x, y, theta;
+  };
+
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  nav_2d_msgs::msg::Twist2DStamped odom_vel_;
-  std::mutex odom_mutex_;
+  nav2_util::SeqLock<Velocity> odom_vel_;
+  // The frame id isn't trivially copyable, it only changes if the odometry source does
+  std::string frame_id_;
+  std::mutex frame_mutex_;
 };
 
 }  // namespace nav_2d_utils
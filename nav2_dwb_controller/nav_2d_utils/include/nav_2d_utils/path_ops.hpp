@@ -35,10 +35,125 @@
 #ifndef NAV_2D_UTILS__PATH_OPS_HPP_
 #define NAV_2D_UTILS__PATH_OPS_HPP_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
 #include "nav_2d_msgs/msg/path2_d.hpp"
 
 namespace nav_2d_utils
 {
+/**
+ * @class PathView
+ * @brief A contiguous range of the poses of a path, read in place
+ *
+ * The path must outlive the view and not be modified while it is in use.
+ */
+class PathView
+{
+public:
+  using const_iterator = std::vector<geometry_msgs::msg::Pose2D>::const_iterator;
+
+  explicit PathView(const nav_2d_msgs::msg::Path2D & path)
+  : PathView(path, 0, path.poses.size())
+  {
+  }
+
+  /**
+   * @brief View of the poses [first, last) of path, clamped to its size
+   */
+  PathView(const nav_2d_msgs::msg::Path2D & path, std::size_t first, std::size_t last)
+  : path_(&path),
+    last_(std::min(last, path.poses.size())),
+    first_(std::min(first, last_))
+  {
+  }
+
+  const std_msgs::msg::Header & header() const {return path_->header;}
+  std::size_t size() const {return last_ - first_;}
+  bool empty() const {return first_ == last_;}
+  const geometry_msgs::msg::Pose2D & operator[](std::size_t i) const
+  {
+    return path_->poses[first_ + i];
+  }
+  const geometry_msgs::msg::Pose2D & back() const {return path_->poses[last_ - 1];}
+  const_iterator begin() const {return path_->poses.begin() + first_;}
+  const_iterator end() const {return path_->poses.begin() + last_;}
+
+  /**
+   * @brief Copy the poses viewed into a path with the same header
+   */
+  nav_2d_msgs::msg::Path2D toPath() const
+  {
+    nav_2d_msgs::msg::Path2D path;
+    path.header = path_->header;
+    path.poses.assign(begin(), end());
+    return path;
+  }
+
+private:
+  const nav_2d_msgs::msg::Path2D * path_;
+  std::size_t last_;
+  std::size_t first_;
+};
+
+/**
+ * @brief Visit the poses of a plan as adjustPlanResolution would return them, without
+ * building the denser plan
+ *
+ * Points are interpolated one segment at a time, so stopping early costs nothing
+ * for the rest of the plan.
+ *
+ * @param plan Input plan
+ * @param resolution Desired distance between waypoints
+ * @param visit Called with each pose in order, returns false to stop
+ */
+template<typename Visitor>
+void forEachPoseAtResolution(const PathView & plan, double resolution, Visitor visit)
+{
+  if (plan.empty()) {
+    return;
+  }
+
+  geometry_msgs::msg::Pose2D last = plan[0];
+  if (!visit(last)) {
+    return;
+  }
+
+  // we can take "holes" in the plan smaller than 2 grid cells (squared = 4)
+  double min_sq_resolution = resolution * resolution * 4.0;
+
+  for (std::size_t i = 1; i < plan.size(); ++i) {
+    const geometry_msgs::msg::Pose2D & loop = plan[i];
+    double sq_dist = (loop.x - last.x) * (loop.x - last.x) + (loop.y - last.y) * (loop.y - last.y);
+    if (sq_dist > min_sq_resolution) {
+      // add points in-between
+      double diff = std::sqrt(sq_dist) - std::sqrt(min_sq_resolution);
+      int steps = static_cast<int>(diff / resolution) - 1;
+      double steps_double = static_cast<double>(steps);
+
+      double delta_x = (loop.x - last.x) / steps_double;
+      double delta_y = (loop.y - last.y) / steps_double;
+      double delta_t = (loop.theta - last.theta) / steps_double;
+
+      for (int j = 1; j < steps; ++j) {
+        geometry_msgs::msg::Pose2D pose;
+        pose.x = last.x + j * delta_x;
+        pose.y = last.y + j * delta_y;
+        pose.theta = last.theta + j * delta_t;
+        if (!visit(pose)) {
+          return;
+        }
+      }
+    }
+    if (!visit(loop)) {
+      return;
+    }
+    last = loop;
+  }
+}
+
 /**
  * @brief Increase plan resolution to match that of the costmap by adding points linearly between points
  *
@@ -49,6 +164,9 @@ namespace nav_2d_utils
 nav_2d_msgs::msg::Path2D adjustPlanResolution(
   const nav_2d_msgs::msg::Path2D & global_plan_in,
   double resolution);
+
+/** @brief adjustPlanResolution() of the poses of a view */
+nav_2d_msgs::msg::Path2D adjustPlanResolution(const PathView & global_plan_in, double resolution);
 }  // namespace nav_2d_utils
 
 #endif  // NAV_2D_UTILS__PATH_OPS_HPP_
@@ -35,11 +35,9 @@
 #include "nav_2d_utils/conversions.hpp"
 #include <vector>
 #include <string>
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpedantic"
-#include "tf2/utils.h"
-#pragma GCC diagnostic pop
+#include "nav2_util/se2.hpp"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/compact_path.hpp"
 
 namespace nav_2d_utils
 {
@@ -80,7 +78,7 @@ nav_2d_msgs::msg::Pose2DStamped poseStampedToPose2D(const geometry_msgs::msg::Po
   pose2d.header = pose.header;
   pose2d.pose.x = pose.pose.position.x;
   pose2d.pose.y = pose.pose.position.y;
-  pose2d.pose.theta = tf2::getYaw(pose.pose.orientation);
+  pose2d.pose.theta = nav2_util::se2::yaw(pose.pose.orientation);
   return pose2d;
 }
 
@@ -89,7 +87,7 @@ geometry_msgs::msg::Pose2D poseToPose2D(const geometry_msgs::msg::Pose & pose)
   geometry_msgs::msg::Pose2D pose2d;
   pose2d.x = pose.position.x;
   pose2d.y = pose.position.y;
-  pose2d.theta = tf2::getYaw(pose.orientation);
+  pose2d.theta = nav2_util::se2::yaw(pose.orientation);
   return pose2d;
 }
 
@@ -149,6 +147,19 @@ nav_2d_msgs::msg::Path2D pathToPath2D(const nav_msgs::msg::Path & path)
   return path2d;
 }
 
+nav_2d_msgs::msg::Path2D compactPathToPath2D(const nav2_msgs::msg::CompactPath & path)
+{
+  nav_2d_msgs::msg::Path2D path2d;
+  path2d.header = path.header;
+  path2d.poses.resize(nav2_util::compactPathSize(path));
+  for (size_t i = 0; i < path2d.poses.size(); i++) {
+    path2d.poses[i].x = path.x[i];
+    path2d.poses[i].y = path.y[i];
+    path2d.poses[i].theta = path.yaw[i];
+  }
+  return path2d;
+}
+
 
 nav_msgs::msg::Path poses2DToPath(
   const std::vector<geometry_msgs::msg::Pose2D> & poses,
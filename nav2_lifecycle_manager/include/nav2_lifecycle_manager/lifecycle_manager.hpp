@@ -17,6 +17,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -44,8 +45,9 @@ class LifecycleManager : public rclcpp::Node
 public:
   /**
    * @brief A constructor for nav2_lifecycle_manager::LifecycleManager
+   * @param options Additional options to control creation of the node.
    */
-  LifecycleManager();
+  explicit LifecycleManager(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_lifecycle_manager::LifecycleManager
    */
@@ -88,6 +90,18 @@ protected:
    * @return true or false
    */
   bool startup();
+  /**
+   * @brief Configure all the managed nodes at once, activating each as soon as
+   * the nodes it depends on are active
+   * @return true or false
+   */
+  bool startupInParallel();
+  /**
+   * @brief Order the managed nodes so each comes after its dependencies
+   * @param order Node names in bring-up order
+   * @return false if a dependency is unknown or the dependencies have a cycle
+   */
+  bool sortByDependencies(std::vector<std::string> & order);
   /**
    * @brief Deactivate, clean up and shut down all the managed nodes.
    * @return true or false
@@ -162,18 +176,48 @@ protected:
    */
   bool changeStateForAllNodes(std::uint8_t transition);
 
+  /**
+   * @brief Transition nodes together: all the requests are sent, then the
+   * responses are awaited at once, each up to transition_timeout_
+   * @return false if any node failed or timed out
+   */
+  bool changeStateForNodes(const std::vector<std::string> & node_names, std::uint8_t transition);
+
+  /**
+   * @brief Get the state of a node, waiting up to transition_timeout_
+   * @return false if the node didn't answer
+   */
+  bool getStateForNode(const std::string & node_name, std::uint8_t & state);
+
+  /**
+   * @brief Bring a node whose bond broke back to active, through whatever transitions
+   * its current state needs, leaving the other nodes as they are
+   * @return false if the node couldn't be brought back
+   */
+  bool restartNode(const std::string & node_name);
+
+  /**
+   * @brief Split the managed nodes in groups transitioned together, each group
+   * depending only on the groups before it
+   */
+  bool groupByDependencies(std::vector<std::vector<std::string>> & groups);
+
   // Convenience function to highlight the output on the console
   /**
    * @brief Helper function to highlight the output on the console
    */
   void message(const std::string & msg);
 
+  // One-shot timer that runs the autostart bring-up
+  rclcpp::TimerBase::SharedPtr init_timer_;
+
   // Timer thread to look at bond connections
   rclcpp::TimerBase::SharedPtr bond_timer_;
   std::chrono::milliseconds bond_timeout_;
 
   // A map of all nodes to check bond connection
   std::map<std::string, std::shared_ptr<bond::Bond>> bond_map_;
+  std::mutex bond_mutex_;
 
   // A map of all nodes to be controlled
   std::map<std::string, std::shared_ptr<nav2_util::LifecycleServiceClient>> node_map_;
@@ -189,6 +233,19 @@ protected:
   // Whether to automatically start up the system
   bool autostart_;
 
+  // Whether to bring the nodes up concurrently, ordered only by dependencies_
+  bool parallel_bringup_{false};
+
+  // The nodes each node has to wait for before it's activated
+  std::map<std::string, std::vector<std::string>> dependencies_;
+
+  // Whether to send the transitions of a stage to all the nodes at once
+  bool batch_transitions_{false};
+  std::chrono::milliseconds transition_timeout_;
+
+  // Whether to restart a node that stops sending heartbeats, instead of resetting all of them
+  bool restart_failed_nodes_{false};
+
   bool system_active_{false};
 };
 
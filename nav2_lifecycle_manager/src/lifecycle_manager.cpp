@@ -14,8 +14,13 @@
 
 #include "nav2_lifecycle_manager/lifecycle_manager.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -31,8 +36,8 @@ using nav2_util::LifecycleServiceClient;
 namespace nav2_lifecycle_manager
 {
 
-LifecycleManager::LifecycleManager()
-: Node("lifecycle_manager")
+LifecycleManager::LifecycleManager(const rclcpp::NodeOptions & options)
+: Node("lifecycle_manager", options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -41,12 +46,37 @@ LifecycleManager::LifecycleManager()
   declare_parameter("node_names");
   declare_parameter("autostart", rclcpp::ParameterValue(false));
   declare_parameter("bond_timeout_ms", 4000);
+  declare_parameter("parallel_bringup", rclcpp::ParameterValue(false));
+  declare_parameter(
+    "node_dependencies", rclcpp::ParameterValue(std::vector<std::string>()));
+  declare_parameter("batch_transitions", rclcpp::ParameterValue(false));
+  declare_parameter("transition_timeout_ms", 10000);
+  declare_parameter("restart_failed_nodes", rclcpp::ParameterValue(false));
 
   node_names_ = get_parameter("node_names").as_string_array();
   get_parameter("autostart", autostart_);
   int bond_timeout_int;
   get_parameter("bond_timeout_ms", bond_timeout_int);
   bond_timeout_ = std::chrono::milliseconds(bond_timeout_int);
+  get_parameter("parallel_bringup", parallel_bringup_);
+  get_parameter("batch_transitions", batch_transitions_);
+  int transition_timeout_int;
+  get_parameter("transition_timeout_ms", transition_timeout_int);
+  transition_timeout_ = std::chrono::milliseconds(transition_timeout_int);
+  get_parameter("restart_failed_nodes", restart_failed_nodes_);
+  std::vector<std::string> node_dependencies;
+  get_parameter("node_dependencies", node_dependencies);
+  for (auto & entry : node_dependencies) {
+    // Each entry is "<node>:<dependency>"
+    const auto separator = entry.find(':');
+    if (separator == std::string::npos) {
+      RCLCPP_WARN(
+        get_logger(), "Ignoring node dependency \"%s\", expected \"node:dependency\"",
+        entry.c_str());
+      continue;
+    }
+    dependencies_[entry.substr(0, separator)].push_back(entry.substr(separator + 1));
+  }
 
   manager_srv_ = create_service<ManageLifecycleNodes>(
     get_name() + std::string("/manage_nodes"),
@@ -81,7 +111,13 @@ LifecycleManager::LifecycleManager()
   createLifecycleServiceClients();
 
   if (autostart_) {
-    startup();
+    // Start up from the executor rather than the constructor, so that when loaded as a component
+    // the container is free to load the managed nodes first
+    init_timer_ = create_wall_timer(
+      0s, [this]() {
+        init_timer_->cancel();
+        startup();
+      });
   }
 }
 
@@ -129,7 +165,9 @@ LifecycleManager::createLifecycleServiceClients()
 {
   message("Creating and initializing lifecycle service clients");
   for (auto & node_name : node_names_) {
-    node_map_[node_name] =
+    // Clients used from several threads at once can't share the node they spin
+    node_map_[node_name] = parallel_bringup_ ?
+      std::make_shared<LifecycleServiceClient>(node_name) :
       std::make_shared<LifecycleServiceClient>(node_name, service_client_node_);
   }
 }
@@ -150,22 +188,33 @@ LifecycleManager::createBondConnection(const std::string & node_name)
     std::chrono::duration_cast<std::chrono::nanoseconds>(bond_timeout_).count();
   const double timeout_s = timeout_ns / 1e9;
 
-  if (bond_map_.find(node_name) == bond_map_.end() && bond_timeout_.count() > 0.0) {
-    bond_map_[node_name] =
-      std::make_shared<bond::Bond>("bond", node_name, bond_client_node_);
-    bond_map_[node_name]->setHeartbeatTimeout(timeout_s);
-    bond_map_[node_name]->setHeartbeatPeriod(0.10);
-    bond_map_[node_name]->start();
-    if (!bond_map_[node_name]->waitUntilFormed(rclcpp::Duration(timeout_ns / 2))) {
-      RCLCPP_ERROR(
-        get_logger(),
-        "Server %s was unable to be reached after %0.2fs by bond. "
-        "This server may be misconfigured.",
-        node_name.c_str(), timeout_s);
-      return false;
+  if (bond_timeout_.count() <= 0) {
+    return true;
+  }
+
+  std::shared_ptr<bond::Bond> bond;
+  {
+    std::lock_guard<std::mutex> lock(bond_mutex_);
+    if (bond_map_.find(node_name) != bond_map_.end()) {
+      return true;
     }
-    RCLCPP_INFO(get_logger(), "Server %s connected with bond.", node_name.c_str());
+    bond = std::make_shared<bond::Bond>("bond", node_name, bond_client_node_);
+    bond_map_[node_name] = bond;
+  }
+
+  bond->setHeartbeatTimeout(timeout_s);
+  bond->setHeartbeatPeriod(0.10);
+  bond->start();
+  // Short heartbeat timeouts still leave the bond time to form
+  if (!bond->waitUntilFormed(rclcpp::Duration(std::max(timeout_ns / 2, 1e9)))) {
+    RCLCPP_ERROR(
+      get_logger(),
+      "Server %s was unable to be reached after %0.2fs by bond. "
+      "This server may be misconfigured.",
+      node_name.c_str(), timeout_s);
+    return false;
   }
+  RCLCPP_INFO(get_logger(), "Server %s connected with bond.", node_name.c_str());
 
   return true;
 }
@@ -173,10 +222,11 @@ LifecycleManager::createBondConnection(const std::string & node_name)
 bool
 LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t transition)
 {
-  message(transition_label_map_[transition] + node_name);
+  message(transition_label_map_.at(transition) + node_name);
 
-  if (!node_map_[node_name]->change_state(transition) ||
-    !(node_map_[node_name]->get_state() == transition_state_map_[transition]))
+  auto & client = node_map_.at(node_name);
+  if (!client->change_state(transition) ||
+    !(client->get_state() == transition_state_map_.at(transition)))
   {
     RCLCPP_ERROR(get_logger(), "Failed to change state for node: %s", node_name.c_str());
     return false;
@@ -185,6 +235,7 @@ LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t
   if (transition == Transition::TRANSITION_ACTIVATE) {
     return createBondConnection(node_name);
   } else if (transition == Transition::TRANSITION_DEACTIVATE) {
+    std::lock_guard<std::mutex> lock(bond_mutex_);
     bond_map_.erase(node_name);
   }
 
@@ -194,6 +245,21 @@ LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t
 bool
 LifecycleManager::changeStateForAllNodes(std::uint8_t transition)
 {
+  if (batch_transitions_) {
+    std::vector<std::vector<std::string>> groups;
+    if (!groupByDependencies(groups)) {
+      return false;
+    }
+    const bool forward = transition == Transition::TRANSITION_CONFIGURE ||
+      transition == Transition::TRANSITION_ACTIVATE;
+    for (std::size_t i = 0; i < groups.size(); i++) {
+      if (!changeStateForNodes(forward ? groups[i] : groups[groups.size() - 1 - i], transition)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   if (transition == Transition::TRANSITION_CONFIGURE ||
     transition == Transition::TRANSITION_ACTIVATE)
   {
@@ -213,6 +279,181 @@ LifecycleManager::changeStateForAllNodes(std::uint8_t transition)
   return true;
 }
 
+namespace
+{
+
+// Spin until every future is ready or the deadline passes, returns which are ready
+template<typename FutureT>
+std::vector<bool> waitForAll(
+  const std::vector<std::shared_ptr<nav2_util::NodeSpinner>> & spinners,
+  const std::vector<FutureT> & futures, std::chrono::steady_clock::time_point deadline)
+{
+  std::vector<bool> ready(futures.size(), false);
+  std::size_t remaining = futures.size();
+  while (rclcpp::ok()) {
+    for (std::size_t i = 0; i < futures.size(); i++) {
+      if (!ready[i] && futures[i].wait_for(0s) == std::future_status::ready) {
+        ready[i] = true;
+        remaining--;
+      }
+    }
+    if (remaining == 0 || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+    for (auto & spinner : spinners) {
+      spinner->spin_once(std::chrono::nanoseconds(10ms) / spinners.size());
+    }
+  }
+  return ready;
+}
+
+}  // namespace
+
+bool
+LifecycleManager::changeStateForNodes(
+  const std::vector<std::string> & node_names, std::uint8_t transition)
+{
+  // Nodes share the client node unless parallel_bringup gives each its own
+  std::set<rclcpp::Node::SharedPtr> client_nodes;
+  for (auto & node_name : node_names) {
+    client_nodes.insert(node_map_.at(node_name)->get_node());
+  }
+  std::vector<std::shared_ptr<nav2_util::NodeSpinner>> spinners;
+  for (auto & node : client_nodes) {
+    spinners.push_back(nav2_util::NodeSpinner::get(node));
+  }
+
+  std::vector<LifecycleServiceClient::ChangeStateFuture> changes;
+  for (auto & node_name : node_names) {
+    message(transition_label_map_.at(transition) + node_name);
+    changes.push_back(node_map_.at(node_name)->async_change_state(transition));
+  }
+  auto changed = waitForAll(
+    spinners, changes, std::chrono::steady_clock::now() + transition_timeout_);
+
+  // As one at a time, the new state is checked
+  std::vector<LifecycleServiceClient::GetStateFuture> states(node_names.size());
+  std::vector<LifecycleServiceClient::GetStateFuture> requested;
+  for (std::size_t i = 0; i < node_names.size(); i++) {
+    if (changed[i] && changes[i].get()->success) {
+      states[i] = node_map_.at(node_names[i])->async_get_state();
+      requested.push_back(states[i]);
+    }
+  }
+  waitForAll(spinners, requested, std::chrono::steady_clock::now() + transition_timeout_);
+
+  bool success = true;
+  std::vector<std::future<bool>> bonds;
+  for (std::size_t i = 0; i < node_names.size(); i++) {
+    const std::string & node_name = node_names[i];
+    if (!states[i].valid() || states[i].wait_for(0s) != std::future_status::ready ||
+      states[i].get()->current_state.id != transition_state_map_.at(transition))
+    {
+      RCLCPP_ERROR(
+        get_logger(), "Failed to change state for node: %s%s", node_name.c_str(),
+        changed[i] ? "" : " (timed out)");
+      success = false;
+      continue;
+    }
+
+    if (transition == Transition::TRANSITION_ACTIVATE) {
+      bonds.push_back(
+        std::async(
+          std::launch::async, [this, node_name]() {return createBondConnection(node_name);}));
+    } else if (transition == Transition::TRANSITION_DEACTIVATE) {
+      std::lock_guard<std::mutex> lock(bond_mutex_);
+      bond_map_.erase(node_name);
+    }
+  }
+
+  for (auto & bond : bonds) {
+    success = bond.get() && success;
+  }
+  return success;
+}
+
+bool
+LifecycleManager::getStateForNode(const std::string & node_name, std::uint8_t & state)
+{
+  auto & client = node_map_.at(node_name);
+  std::vector<LifecycleServiceClient::GetStateFuture> futures{client->async_get_state()};
+  const bool ready = waitForAll(
+    {nav2_util::NodeSpinner::get(client->get_node())}, futures,
+    std::chrono::steady_clock::now() + transition_timeout_)[0];
+  if (!ready) {
+    return false;
+  }
+  state = futures[0].get()->current_state.id;
+  return true;
+}
+
+bool
+LifecycleManager::restartNode(const std::string & node_name)
+{
+  {
+    std::lock_guard<std::mutex> lock(bond_mutex_);
+    bond_map_.erase(node_name);
+  }
+
+  // Either a respawned process, unconfigured, or the same one, to bring down first
+  std::uint8_t state;
+  if (!getStateForNode(node_name, state)) {
+    RCLCPP_ERROR(get_logger(), "%s doesn't answer state requests", node_name.c_str());
+    return false;
+  }
+  std::vector<std::uint8_t> transitions;
+  if (state == State::PRIMARY_STATE_ACTIVE) {
+    transitions.push_back(Transition::TRANSITION_DEACTIVATE);
+  }
+  if (state == State::PRIMARY_STATE_ACTIVE || state == State::PRIMARY_STATE_INACTIVE) {
+    transitions.push_back(Transition::TRANSITION_CLEANUP);
+  }
+  if (state == State::PRIMARY_STATE_ACTIVE || state == State::PRIMARY_STATE_INACTIVE ||
+    state == State::PRIMARY_STATE_UNCONFIGURED)
+  {
+    transitions.push_back(Transition::TRANSITION_CONFIGURE);
+    transitions.push_back(Transition::TRANSITION_ACTIVATE);
+  }
+  if (transitions.empty()) {
+    return false;
+  }
+
+  for (auto transition : transitions) {
+    if (!changeStateForNodes({node_name}, transition)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+LifecycleManager::groupByDependencies(std::vector<std::vector<std::string>> & groups)
+{
+  groups.clear();
+  std::vector<std::string> order;
+  if (!sortByDependencies(order)) {
+    return false;
+  }
+
+  // Each node goes right after the last group it depends on
+  std::map<std::string, std::size_t> group_of;
+  for (auto & node_name : order) {
+    std::size_t group = 0;
+    auto it = dependencies_.find(node_name);
+    if (it != dependencies_.end()) {
+      for (auto & dependency : it->second) {
+        group = std::max(group, group_of[dependency] + 1);
+      }
+    }
+    group_of[node_name] = group;
+    if (groups.size() <= group) {
+      groups.resize(group + 1);
+    }
+    groups[group].push_back(node_name);
+  }
+  return true;
+}
+
 void
 LifecycleManager::shutdownAllNodes()
 {
@@ -222,13 +463,102 @@ LifecycleManager::shutdownAllNodes()
   changeStateForAllNodes(Transition::TRANSITION_UNCONFIGURED_SHUTDOWN);
 }
 
+bool
+LifecycleManager::sortByDependencies(std::vector<std::string> & order)
+{
+  order.clear();
+  std::set<std::string> done, visiting;
+
+  // Depth first, so each node comes after everything it depends on
+  std::function<bool(const std::string &)> visit = [&](const std::string & node_name) {
+      if (done.count(node_name)) {
+        return true;
+      }
+      if (!visiting.insert(node_name).second) {
+        RCLCPP_ERROR(get_logger(), "Node dependencies form a cycle through %s", node_name.c_str());
+        return false;
+      }
+      auto it = dependencies_.find(node_name);
+      if (it != dependencies_.end()) {
+        for (auto & dependency : it->second) {
+          if (node_map_.find(dependency) == node_map_.end()) {
+            RCLCPP_ERROR(
+              get_logger(), "%s depends on %s, which isn't a managed node",
+              node_name.c_str(), dependency.c_str());
+            return false;
+          }
+          if (!visit(dependency)) {
+            return false;
+          }
+        }
+      }
+      visiting.erase(node_name);
+      done.insert(node_name);
+      order.push_back(node_name);
+      return true;
+    };
+
+  for (auto & node_name : node_names_) {
+    if (!visit(node_name)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+LifecycleManager::startupInParallel()
+{
+  std::vector<std::string> order;
+  if (!sortByDependencies(order)) {
+    return false;
+  }
+
+  // Every node is configured right away, and activated once the nodes it depends on are active
+  std::map<std::string, std::shared_future<bool>> activated;
+  for (auto & node_name : order) {
+    std::vector<std::shared_future<bool>> dependencies;
+    auto it = dependencies_.find(node_name);
+    if (it != dependencies_.end()) {
+      for (auto & dependency : it->second) {
+        dependencies.push_back(activated[dependency]);
+      }
+    }
+
+    activated[node_name] = std::async(
+      std::launch::async, [this, node_name, dependencies]() {
+        if (!changeStateForNode(node_name, Transition::TRANSITION_CONFIGURE)) {
+          return false;
+        }
+        for (auto & dependency : dependencies) {
+          if (!dependency.get()) {
+            RCLCPP_ERROR(
+              get_logger(), "Not activating %s, a node it depends on failed",
+              node_name.c_str());
+            return false;
+          }
+        }
+        return changeStateForNode(node_name, Transition::TRANSITION_ACTIVATE);
+      }).share();
+  }
+
+  // Wait for all of them, even after a failure, so none is left mid-transition
+  bool success = true;
+  for (auto & kv : activated) {
+    success = kv.second.get() && success;
+  }
+  return success;
+}
+
 bool
 LifecycleManager::startup()
 {
   message("Starting managed nodes bringup...");
-  if (!changeStateForAllNodes(Transition::TRANSITION_CONFIGURE) ||
-    !changeStateForAllNodes(Transition::TRANSITION_ACTIVATE))
-  {
+  const bool success = parallel_bringup_ ?
+    startupInParallel() :
+    changeStateForAllNodes(Transition::TRANSITION_CONFIGURE) &&
+    changeStateForAllNodes(Transition::TRANSITION_ACTIVATE);
+  if (!success) {
     RCLCPP_ERROR(get_logger(), "Failed to bring up all requested nodes. Aborting bringup.");
     return false;
   }
@@ -310,8 +640,11 @@ LifecycleManager::createBondTimer()
 
   message("Creating bond timer...");
 
+  // Checked often enough not to add much to the detection time of short timeouts
+  const auto period = std::min<std::chrono::milliseconds>(
+    200ms, std::max<std::chrono::milliseconds>(bond_timeout_ / 4, 10ms));
   bond_timer_ = this->create_wall_timer(
-    200ms,
+    period,
     std::bind(&LifecycleManager::checkBondConnections, this));
 }
 
@@ -337,11 +670,24 @@ LifecycleManager::checkBondConnections()
       return;
     }
 
-    if (bond_map_[node_name]->isBroken()) {
+    auto bond = bond_map_.find(node_name);
+    if (bond != bond_map_.end() && bond->second->isBroken()) {
       message(
         std::string(
           "Have not received a heartbeat from " + node_name + "."));
 
+      if (restart_failed_nodes_) {
+        RCLCPP_ERROR(
+          get_logger(),
+          "SERVER %s IS DOWN after not receiving a heartbeat for %i ms. Restarting it.",
+          node_name.c_str(), static_cast<int>(bond_timeout_.count()));
+        if (restartNode(node_name)) {
+          message(node_name + " has been restarted");
+          continue;
+        }
+        RCLCPP_ERROR(get_logger(), "Failed to restart %s", node_name.c_str());
+      }
+
       // if one is down, bring them all down
       RCLCPP_ERROR(
         get_logger(),
@@ -364,3 +710,7 @@ LifecycleManager::message(const std::string & msg)
 }
 
 }  // namespace nav2_lifecycle_manager
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_lifecycle_manager::LifecycleManager)
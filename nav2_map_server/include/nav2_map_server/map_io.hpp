@@ -68,7 +68,8 @@ void loadMapFromFile(
 /**
  * @brief Load the map YAML, image from map file and
  * generate an OccupancyGrid
- * @param yaml_file Name of input YAML file
+ * @param yaml_file Name of input YAML file, or of a binary map file, which carries its own
+ * metadata
  * @param map Output loaded map
  * @return status of map loaded
  */
@@ -77,6 +78,28 @@ LOAD_MAP_STATUS loadMapFromYaml(
   nav_msgs::msg::OccupancyGrid & map);
 
 
+/**
+ * @brief Halve the resolution of a map. A coarse cell takes the highest value of the known
+ * cells under it, so that obstacles are kept, and is unknown only if all of them are
+ * @param map Input map
+ * @param coarse Output map, with the same origin and header
+ */
+void downsampleMap(
+  const nav_msgs::msg::OccupancyGrid & map,
+  nav_msgs::msg::OccupancyGrid & coarse);
+
+/**
+ * @brief Copy the cells of a map that overlap an axis-aligned box of the map frame
+ * @param map Input map
+ * @param min_x, min_y, max_x, max_y Corners of the box (m)
+ * @param region Output map, with the resolution, orientation and header of the input map
+ * @return false if the box does not overlap the map
+ */
+bool cropMap(
+  const nav_msgs::msg::OccupancyGrid & map,
+  double min_x, double min_y, double max_x, double max_y,
+  nav_msgs::msg::OccupancyGrid & region);
+
 /* Map output part */
 
 struct SaveParameters
@@ -89,7 +112,8 @@ struct SaveParameters
 };
 
 /**
- * @brief Write OccupancyGrid map to file
+ * @brief Write OccupancyGrid map to file. The "nmap" image format writes the cells as they are
+ * into a binary map file, which loads without decoding
  * @param map OccupancyGrid map data
  * @param save_parameters Map saving parameters.
  * @return true or false
@@ -18,12 +18,16 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <unordered_map>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "nav_msgs/srv/get_map.hpp"
+#include "nav2_msgs/srv/get_map_region.hpp"
 #include "nav2_msgs/srv/load_map.hpp"
+#include "nav2_map_server/map_io.hpp"
 
 namespace nav2_map_server
 {
@@ -38,8 +42,9 @@ class MapServer : public nav2_util::LifecycleNode
 public:
   /**
    * @brief A constructor for nav2_map_server::MapServer
+   * @param options Additional options to control creation of the node.
    */
-  MapServer();
+  explicit MapServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
 
   /**
    * @brief A Destructor for nav2_map_server::MapServer
@@ -79,9 +84,9 @@ protected:
   nav2_util::CallbackReturn on_shutdown(const rclcpp_lifecycle::State & state) override;
 
   /**
-   * @brief Load the map YAML, image from map file name and
-   * generate output response containing an OccupancyGrid.
-   * Update msg_ class variable.
+   * @brief Make a preloaded map the current one, or else load the map YAML, image from map
+   * file name, and generate output response containing an OccupancyGrid.
+   * Update current_ class variable.
    * @param yaml_file name of input YAML file
    * @param response Output response with loaded OccupancyGrid map
    * @return true or false
@@ -91,9 +96,19 @@ protected:
     std::shared_ptr<nav2_msgs::srv::LoadMap::Response> response);
 
   /**
-   * @brief Method correcting msg_ header when it belongs to instantiated object
+   * @brief Load a map file, through its decoded copy in map_cache_dir when that is set and
+   * newer than the map's YAML and image files, writing that copy otherwise
+   * @param yaml_file Name of input YAML file
+   * @param map Output loaded map
+   * @return status of map loaded
    */
-  void updateMsgHeader();
+  LOAD_MAP_STATUS loadMapThroughCache(
+    const std::string & yaml_file, nav_msgs::msg::OccupancyGrid & map);
+
+  /**
+   * @brief Method correcting a map header when it belongs to instantiated object
+   */
+  void updateMsgHeader(nav_msgs::msg::OccupancyGrid & msg);
 
   /**
    * @brief Map getting service callback
@@ -117,26 +132,65 @@ protected:
     const std::shared_ptr<nav2_msgs::srv::LoadMap::Request> request,
     std::shared_ptr<nav2_msgs::srv::LoadMap::Response> response);
 
+  /**
+   * @brief Map region getting service callback
+   * @param request_header Service request header
+   * @param request Service request
+   * @param response Service response
+   */
+  void getMapRegionCallback(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<nav2_msgs::srv::GetMapRegion::Request> request,
+    std::shared_ptr<nav2_msgs::srv::GetMapRegion::Response> response);
+
+  /**
+   * @brief Get the map at a level of the resolution pyramid, building the levels on demand
+   * @param level Each level halves the resolution. Capped at the level of a single cell
+   * @return The map at that level
+   */
+  const nav_msgs::msg::OccupancyGrid & getMapLevel(unsigned int level);
+
   // The name of the service for getting a map
   const std::string service_name_{"map"};
 
   // The name of the service for loading a map
   const std::string load_map_service_name_{"load_map"};
 
+  // The name of the service for getting a part of the map
+  const std::string map_region_service_name_{"map_region"};
+
   // A service to provide the occupancy grid (GetMap) and the message to return
   rclcpp::Service<nav_msgs::srv::GetMap>::SharedPtr occ_service_;
 
   // A service to load the occupancy grid from file at run time (LoadMap)
   rclcpp::Service<nav2_msgs::srv::LoadMap>::SharedPtr load_map_service_;
 
+  // A service to provide a part of the occupancy grid (GetMapRegion)
+  rclcpp::Service<nav2_msgs::srv::GetMapRegion>::SharedPtr map_region_service_;
+
   // A topic on which the occupancy grid will be published
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr occ_pub_;
 
   // The frame ID used in the returned OccupancyGrid message
   std::string frame_id_;
 
-  // The message to publish on the occupancy grid topic
-  nav_msgs::msg::OccupancyGrid msg_;
+  struct LoadedMap
+  {
+    // The message to publish on the occupancy grid topic
+    nav_msgs::msg::OccupancyGrid msg;
+    // msg at halved resolutions, level 1 first. Built on demand
+    std::vector<nav_msgs::msg::OccupancyGrid> pyramid;
+  };
+
+  // The current map
+  std::shared_ptr<LoadedMap> current_;
+
+  // The maps of preload_maps by file name, which load_map switches to without loading them.
+  // They keep their map_load_time, by which the nodes using them can recognize them
+  std::unordered_map<std::string, std::shared_ptr<LoadedMap>> preloaded_maps_;
+
+  // Where decoded copies of the maps are kept, empty for none
+  std::string map_cache_dir_;
 };
 
 }  // namespace nav2_map_server
@@ -32,16 +32,29 @@
 #include "nav2_map_server/map_io.hpp"
 
 #ifndef _WIN32
+#include <fcntl.h>
 #include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 #include <fstream>
 #include <stdexcept>
 
 #include "Magick++.h"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 #include "yaml-cpp/yaml.h"
 #include "tf2/LinearMath/Matrix3x3.h"
@@ -161,6 +174,227 @@ LoadParameters loadMapYaml(const std::string & yaml_filename)
   return load_parameters;
 }
 
+/// On a scale from 0.0 to 1.0 how bright a pixel is, to the cell value of the map
+int8_t shadeToCell(double shade, bool opaque, const LoadParameters & load_parameters)
+{
+  // If negate is true, we consider blacker pixels free, and whiter
+  // pixels occupied. Otherwise, it's vice versa.
+  /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
+  double occ = (load_parameters.negate ? shade : 1.0 - shade);
+
+  int8_t map_cell;
+  switch (load_parameters.mode) {
+    case MapMode::Trinary:
+      if (load_parameters.occupied_thresh < occ) {
+        map_cell = 100;
+      } else if (occ < load_parameters.free_thresh) {
+        map_cell = 0;
+      } else {
+        map_cell = -1;
+      }
+      break;
+    case MapMode::Scale:
+      if (!opaque) {
+        map_cell = -1;
+      } else if (load_parameters.occupied_thresh < occ) {
+        map_cell = 100;
+      } else if (occ < load_parameters.free_thresh) {
+        map_cell = 0;
+      } else {
+        map_cell = std::rint(
+          (occ - load_parameters.free_thresh) /
+          (load_parameters.occupied_thresh - load_parameters.free_thresh) * 100.0);
+      }
+      break;
+    case MapMode::Raw: {
+        double occ_percent = std::round(shade * 255);
+        if (0 <= occ_percent && occ_percent <= 100) {
+          map_cell = static_cast<int8_t>(occ_percent);
+        } else {
+          map_cell = -1;
+        }
+        break;
+      }
+    default:
+      throw std::runtime_error("Invalid map mode");
+  }
+  return map_cell;
+}
+
+/// Rows of the map converted by one task
+static const size_t ROWS_PER_TASK = 64;
+
+/// Run convert_rows(first, last) over blocks of rows of the map, on all the hardware threads
+void convertRows(size_t height, const std::function<void(size_t, size_t)> & convert_rows)
+{
+  const size_t num_tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  auto convert = [&](size_t task) {
+      size_t first = task * ROWS_PER_TASK;
+      convert_rows(first, std::min(height, first + ROWS_PER_TASK));
+    };
+  if (num_tasks < 2) {
+    for (size_t task = 0; task < num_tasks; task++) {
+      convert(task);
+    }
+    return;
+  }
+  nav2_util::ThreadPool pool;
+  pool.parallelFor(num_tasks, convert);
+}
+
+/// Skip the whitespace and comments of a PGM header, then read one of its numbers
+/// @return false if there is no number
+bool readPgmNumber(std::istream & file, size_t & value)
+{
+  int c = file.get();
+  while (c == '#' || std::isspace(c)) {
+    if (c == '#') {
+      while (c != '\n' && c != EOF) {
+        c = file.get();
+      }
+    }
+    c = file.get();
+  }
+  if (!std::isdigit(c)) {
+    return false;
+  }
+  value = 0;
+  while (std::isdigit(c)) {
+    value = value * 10 + (c - '0');
+    c = file.get();
+  }
+  // The single whitespace character after the number is part of it
+  return std::isspace(c);
+}
+
+/// Decode a binary 8-bit PGM straight into the map, without going through GraphicsMagick
+/// @return false if the file is not such a PGM, and should be decoded by GraphicsMagick
+/// @throw std::runtime_error if the file is such a PGM but is truncated
+bool loadPgmFile(const LoadParameters & load_parameters, nav_msgs::msg::OccupancyGrid & msg)
+{
+  std::ifstream file(load_parameters.image_file_name, std::ios::binary);
+  size_t width, height, max_value;
+  if (!file || file.get() != 'P' || file.get() != '5' ||
+    !readPgmNumber(file, width) || !readPgmNumber(file, height) ||
+    !readPgmNumber(file, max_value) || max_value != 255 || width == 0 || height == 0)
+  {
+    return false;
+  }
+
+  msg.info.width = width;
+  msg.info.height = height;
+  msg.data.resize(width * height);
+
+  // The image rows run from the top, the map rows from the bottom
+  for (size_t y = 0; y < height; y++) {
+    char * row = reinterpret_cast<char *>(&msg.data[width * (height - y - 1)]);
+    if (!file.read(row, width)) {
+      throw std::runtime_error("Truncated PGM image");
+    }
+  }
+
+  // A gray level is turned into the same shade as GraphicsMagick would, one table lookup per
+  // pixel then
+  int8_t cells[256];
+  for (int gray = 0; gray < 256; gray++) {
+    double shade = Magick::ColorGray::scaleQuantumToDouble(
+      static_cast<double>(gray * (MaxRGB / 255)));
+    cells[gray] = shadeToCell(shade, true, load_parameters);
+  }
+  convertRows(
+    height, [&](size_t first, size_t last) {
+      for (size_t i = first * width; i < last * width; i++) {
+        msg.data[i] = cells[static_cast<uint8_t>(msg.data[i])];
+      }
+    });
+  return true;
+}
+
+/// Header of the native binary map format. The cells follow at data_offset, in the order of
+/// OccupancyGrid::data and in the byte order of the host that saved them
+struct BinaryMapHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t data_offset;
+  uint32_t width;
+  uint32_t height;
+  double resolution;
+  double origin[3];
+  double free_thresh;
+  double occupied_thresh;
+};
+
+static const char BINARY_MAP_MAGIC[8] = "NAV2MAP";
+static const uint32_t BINARY_MAP_VERSION = 1;
+/// The cells start on a page boundary, so that they can be mapped straight from the file
+static const uint32_t BINARY_MAP_DATA_OFFSET = 4096;
+/// File extension, and image_format, of the binary map format
+static const char BINARY_MAP_FORMAT[] = "nmap";
+
+/// Read the header of a binary map file
+/// @return false if the file is not a binary map
+bool readBinaryMapHeader(const std::string & file_name, BinaryMapHeader & header)
+{
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+    std::memcmp(header.magic, BINARY_MAP_MAGIC, sizeof(header.magic)) != 0)
+  {
+    return false;
+  }
+  if (header.version != BINARY_MAP_VERSION || header.data_offset < sizeof(header)) {
+    throw std::runtime_error("Unsupported binary map version");
+  }
+  return true;
+}
+
+/// Copy the cells of a binary map into the map, without any decoding
+/// @return false if the file is not a binary map
+/// @throw std::runtime_error if the file is a binary map but is truncated
+bool loadBinaryMapFile(const std::string & file_name, nav_msgs::msg::OccupancyGrid & msg)
+{
+  BinaryMapHeader header;
+  if (!readBinaryMapHeader(file_name, header)) {
+    return false;
+  }
+  const size_t cell_count = static_cast<size_t>(header.width) * header.height;
+  const size_t file_size = header.data_offset + cell_count;
+  msg.info.width = header.width;
+  msg.info.height = header.height;
+
+#ifndef _WIN32
+  int fd = open(file_name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0 ||
+    static_cast<size_t>(file_stat.st_size) < file_size)
+  {
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::runtime_error("Truncated binary map");
+  }
+  void * mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Failed to map the binary map file");
+  }
+  madvise(mapped, file_size, MADV_SEQUENTIAL);
+  const int8_t * cells = reinterpret_cast<const int8_t *>(
+    static_cast<const char *>(mapped) + header.data_offset);
+  msg.data.assign(cells, cells + cell_count);
+  munmap(mapped, file_size);
+#else
+  std::ifstream file(file_name, std::ios::binary);
+  msg.data.resize(cell_count);
+  if (!file.seekg(header.data_offset) ||
+    !file.read(reinterpret_cast<char *>(msg.data.data()), cell_count))
+  {
+    throw std::runtime_error("Truncated binary map");
+  }
+#endif
+  return true;
+}
+
 void loadMapFromFile(
   const LoadParameters & load_parameters,
   nav_msgs::msg::OccupancyGrid & map)
@@ -170,11 +404,6 @@ void loadMapFromFile(
 
   std::cout << "[INFO] [map_io]: Loading image_file: " <<
     load_parameters.image_file_name << std::endl;
-  Magick::Image img(load_parameters.image_file_name);
-
-  // Copy the image data into the map structure
-  msg.info.width = img.size().width();
-  msg.info.height = img.size().height();
 
   msg.info.resolution = load_parameters.resolution;
   msg.info.origin.position.x = load_parameters.origin[0];
@@ -182,71 +411,48 @@ void loadMapFromFile(
   msg.info.origin.position.z = 0.0;
   msg.info.origin.orientation = orientationAroundZAxis(load_parameters.origin[2]);
 
-  // Allocate space to hold the data
-  msg.data.resize(msg.info.width * msg.info.height);
-
-  // Copy pixel data into the map structure
-  for (size_t y = 0; y < msg.info.height; y++) {
-    for (size_t x = 0; x < msg.info.width; x++) {
-      auto pixel = img.pixelColor(x, y);
+  if (loadBinaryMapFile(load_parameters.image_file_name, msg)) {
+    // The cells were thresholded when the map was saved
+  } else if (!loadPgmFile(load_parameters, msg)) {
+    Magick::Image img(load_parameters.image_file_name);
+
+    // Copy the image data into the map structure
+    msg.info.width = img.size().width();
+    msg.info.height = img.size().height();
+
+    // Allocate space to hold the data
+    msg.data.resize(msg.info.width * msg.info.height);
+
+    // To preserve existing behavior, average in alpha with color channels in Trinary mode.
+    const bool average_alpha = load_parameters.mode == MapMode::Trinary && img.matte();
+    const size_t width = msg.info.width;
+    const size_t height = msg.info.height;
+    const Magick::PixelPacket * pixels = img.getConstPixels(0, 0, width, height);
+    if (pixels == nullptr) {
+      throw std::runtime_error("Failed to read the image pixels");
+    }
 
-      std::vector<Magick::Quantum> channels = {pixel.redQuantum(), pixel.greenQuantum(),
-        pixel.blueQuantum()};
-      if (load_parameters.mode == MapMode::Trinary && img.matte()) {
-        // To preserve existing behavior, average in alpha with color channels in Trinary mode.
-        // CAREFUL. alpha is inverted from what you might expect. High = transparent, low = opaque
-        channels.push_back(MaxRGB - pixel.alphaQuantum());
-      }
-      double sum = 0;
-      for (auto c : channels) {
-        sum += c;
-      }
-      /// on a scale from 0.0 to 1.0 how bright is the pixel?
-      double shade = Magick::ColorGray::scaleQuantumToDouble(sum / channels.size());
-
-      // If negate is true, we consider blacker pixels free, and whiter
-      // pixels occupied. Otherwise, it's vice versa.
-      /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
-      double occ = (load_parameters.negate ? shade : 1.0 - shade);
-
-      int8_t map_cell;
-      switch (load_parameters.mode) {
-        case MapMode::Trinary:
-          if (load_parameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < load_parameters.free_thresh) {
-            map_cell = 0;
-          } else {
-            map_cell = -1;
-          }
-          break;
-        case MapMode::Scale:
-          if (pixel.alphaQuantum() != OpaqueOpacity) {
-            map_cell = -1;
-          } else if (load_parameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < load_parameters.free_thresh) {
-            map_cell = 0;
-          } else {
-            map_cell = std::rint(
-              (occ - load_parameters.free_thresh) /
-              (load_parameters.occupied_thresh - load_parameters.free_thresh) * 100.0);
-          }
-          break;
-        case MapMode::Raw: {
-            double occ_percent = std::round(shade * 255);
-            if (0 <= occ_percent && occ_percent <= 100) {
-              map_cell = static_cast<int8_t>(occ_percent);
-            } else {
-              map_cell = -1;
+    // Copy pixel data into the map structure
+    convertRows(
+      height, [&](size_t first, size_t last) {
+        for (size_t y = first; y < last; y++) {
+          const Magick::PixelPacket * pixel = pixels + width * y;
+          int8_t * row = &msg.data[width * (height - y - 1)];
+          for (size_t x = 0; x < width; x++, pixel++) {
+            double sum = static_cast<double>(pixel->red) + pixel->green + pixel->blue;
+            double channels = 3;
+            if (average_alpha) {
+              // CAREFUL. alpha is inverted from what you might expect. High = transparent,
+              // low = opaque
+              sum += MaxRGB - pixel->opacity;
+              channels = 4;
             }
-            break;
+            /// on a scale from 0.0 to 1.0 how bright is the pixel?
+            double shade = Magick::ColorGray::scaleQuantumToDouble(sum / channels);
+            row[x] = shadeToCell(shade, pixel->opacity == OpaqueOpacity, load_parameters);
           }
-        default:
-          throw std::runtime_error("Invalid map mode");
-      }
-      msg.data[msg.info.width * (msg.info.height - y - 1) + x] = map_cell;
-    }
+        }
+      });
   }
 
   // Since loadMapFromFile() does not belong to any node, publishing in a system time.
@@ -259,7 +465,7 @@ void loadMapFromFile(
     "[DEBUG] [map_io]: Read map " << load_parameters.image_file_name << ": " << msg.info.width <<
     " X " << msg.info.height << " map @ " << msg.info.resolution << " m/cell" << std::endl;
 
-  map = msg;
+  map = std::move(msg);
 }
 
 LOAD_MAP_STATUS loadMapFromYaml(
@@ -270,10 +476,23 @@ LOAD_MAP_STATUS loadMapFromYaml(
     std::cerr << "[ERROR] [map_io]: YAML file name is empty, can't load!" << std::endl;
     return MAP_DOES_NOT_EXIST;
   }
-  std::cout << "[INFO] [map_io]: Loading yaml file: " << yaml_file << std::endl;
   LoadParameters load_parameters;
   try {
-    load_parameters = loadMapYaml(yaml_file);
+    // A binary map carries its own metadata and may be loaded without a YAML file
+    BinaryMapHeader header;
+    if (readBinaryMapHeader(yaml_file, header)) {
+      std::cout << "[INFO] [map_io]: Loading binary map file: " << yaml_file << std::endl;
+      load_parameters.image_file_name = yaml_file;
+      load_parameters.resolution = header.resolution;
+      load_parameters.origin.assign(header.origin, header.origin + 3);
+      load_parameters.free_thresh = header.free_thresh;
+      load_parameters.occupied_thresh = header.occupied_thresh;
+      load_parameters.mode = MapMode::Trinary;
+      load_parameters.negate = false;
+    } else {
+      std::cout << "[INFO] [map_io]: Loading yaml file: " << yaml_file << std::endl;
+      load_parameters = loadMapYaml(yaml_file);
+    }
   } catch (YAML::Exception & e) {
     std::cerr <<
       "[ERROR] [map_io]: Failed processing YAML file " << yaml_file << " at position (" <<
@@ -298,6 +517,85 @@ LOAD_MAP_STATUS loadMapFromYaml(
   return LOAD_MAP_SUCCESS;
 }
 
+void downsampleMap(
+  const nav_msgs::msg::OccupancyGrid & map,
+  nav_msgs::msg::OccupancyGrid & coarse)
+{
+  const size_t width = map.info.width;
+  const size_t height = map.info.height;
+  coarse.header = map.header;
+  coarse.info = map.info;
+  coarse.info.resolution = map.info.resolution * 2;
+  coarse.info.width = (width + 1) / 2;
+  coarse.info.height = (height + 1) / 2;
+  coarse.data.assign(coarse.info.width * coarse.info.height, -1);
+
+  for (size_t y = 0; y < height; y++) {
+    const int8_t * row = &map.data[width * y];
+    int8_t * coarse_row = &coarse.data[coarse.info.width * (y / 2)];
+    for (size_t x = 0; x < width; x++) {
+      // Unknown cells are -1, below any known value
+      coarse_row[x / 2] = std::max(coarse_row[x / 2], row[x]);
+    }
+  }
+}
+
+bool cropMap(
+  const nav_msgs::msg::OccupancyGrid & map,
+  double min_x, double min_y, double max_x, double max_y,
+  nav_msgs::msg::OccupancyGrid & region)
+{
+  const geometry_msgs::msg::Pose & origin = map.info.origin;
+  tf2::Matrix3x3 mat(
+    tf2::Quaternion(
+      origin.orientation.x, origin.orientation.y, origin.orientation.z, origin.orientation.w));
+  double yaw, pitch, roll;
+  mat.getEulerYPR(yaw, pitch, roll);
+  const double cos_yaw = std::cos(yaw);
+  const double sin_yaw = std::sin(yaw);
+  const double resolution = map.info.resolution;
+
+  // Bounding box of the corners, in cells of the map
+  double min_i = std::numeric_limits<double>::max();
+  double min_j = std::numeric_limits<double>::max();
+  double max_i = std::numeric_limits<double>::lowest();
+  double max_j = std::numeric_limits<double>::lowest();
+  for (double x : {min_x, max_x}) {
+    for (double y : {min_y, max_y}) {
+      double dx = x - origin.position.x;
+      double dy = y - origin.position.y;
+      double i = (cos_yaw * dx + sin_yaw * dy) / resolution;
+      double j = (-sin_yaw * dx + cos_yaw * dy) / resolution;
+      min_i = std::min(min_i, i);
+      min_j = std::min(min_j, j);
+      max_i = std::max(max_i, i);
+      max_j = std::max(max_j, j);
+    }
+  }
+  if (max_i < 0 || max_j < 0 || min_i >= map.info.width || min_j >= map.info.height) {
+    return false;
+  }
+  const size_t first_i = static_cast<size_t>(std::max(0.0, std::floor(min_i)));
+  const size_t first_j = static_cast<size_t>(std::max(0.0, std::floor(min_j)));
+  const size_t last_i = std::min<size_t>(map.info.width - 1, static_cast<size_t>(max_i));
+  const size_t last_j = std::min<size_t>(map.info.height - 1, static_cast<size_t>(max_j));
+
+  region.header = map.header;
+  region.info = map.info;
+  region.info.width = last_i - first_i + 1;
+  region.info.height = last_j - first_j + 1;
+  region.info.origin.position.x = origin.position.x +
+    (cos_yaw * first_i - sin_yaw * first_j) * resolution;
+  region.info.origin.position.y = origin.position.y +
+    (sin_yaw * first_i + cos_yaw * first_j) * resolution;
+  region.data.resize(region.info.width * region.info.height);
+  for (size_t j = 0; j < region.info.height; j++) {
+    auto row = map.data.begin() + map.info.width * (first_j + j) + first_i;
+    std::copy(row, row + region.info.width, region.data.begin() + region.info.width * j);
+  }
+  return true;
+}
+
 // === Map output part ===
 
 /**
@@ -358,7 +656,7 @@ void checkSaveParameters(SaveParameters & save_parameters)
     save_parameters.image_format.begin(),
     [](unsigned char c) {return std::tolower(c);});
 
-  const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png"};
+  const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png", BINARY_MAP_FORMAT};
   if (
     std::find(BLESSED_FORMATS.begin(), BLESSED_FORMATS.end(), save_parameters.image_format) ==
     BLESSED_FORMATS.end())
@@ -378,6 +676,11 @@ void checkSaveParameters(SaveParameters & save_parameters)
   }
   const std::string FALLBACK_FORMAT = "png";
 
+  // The binary map format is written without GraphicsMagick
+  if (save_parameters.image_format == BINARY_MAP_FORMAT) {
+    return;
+  }
+
   try {
     Magick::CoderInfo info(save_parameters.image_format);
     if (!info.isWritable()) {
@@ -407,6 +710,163 @@ void checkSaveParameters(SaveParameters & save_parameters)
   }
 }
 
+/**
+ * @brief Tries to write map data into a binary map file, the cells as they are
+ * @param map Occupancy grid data
+ * @param save_parameters Map saving parameters
+ * @param file_name Name of the binary map file
+ * @throw std::expection in case of problem
+ */
+void tryWriteBinaryMapToFile(
+  const nav_msgs::msg::OccupancyGrid & map,
+  const SaveParameters & save_parameters,
+  const std::string & file_name)
+{
+  geometry_msgs::msg::Quaternion orientation = map.info.origin.orientation;
+  tf2::Matrix3x3 mat(tf2::Quaternion(orientation.x, orientation.y, orientation.z, orientation.w));
+  double yaw, pitch, roll;
+  mat.getEulerYPR(yaw, pitch, roll);
+
+  BinaryMapHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, BINARY_MAP_MAGIC, sizeof(header.magic));
+  header.version = BINARY_MAP_VERSION;
+  header.data_offset = BINARY_MAP_DATA_OFFSET;
+  header.width = map.info.width;
+  header.height = map.info.height;
+  header.resolution = map.info.resolution;
+  header.origin[0] = map.info.origin.position.x;
+  header.origin[1] = map.info.origin.position.y;
+  header.origin[2] = yaw;
+  header.free_thresh = save_parameters.free_thresh;
+  header.occupied_thresh = save_parameters.occupied_thresh;
+
+  std::vector<char> head(BINARY_MAP_DATA_OFFSET, 0);
+  std::memcpy(head.data(), &header, sizeof(header));
+
+  std::cout << "[INFO] [map_io]: Writing map occupancy data to " << file_name << std::endl;
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  file.write(head.data(), head.size());
+  file.write(reinterpret_cast<const char *>(map.data.data()), map.data.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write " + file_name);
+  }
+}
+
+/**
+ * @brief Convert the cells of a map into the 8-bit pixels of its image, top row first.
+ * The cells are converted through a table with one entry per cell value, on all the hardware
+ * threads
+ * @param map Occupancy grid data
+ * @param save_parameters Map saving parameters
+ * @param alpha Whether to write gray, gray, gray and alpha bytes per pixel rather than gray only
+ * @param pixels Output pixels
+ * @throw std::expection in case of problem
+ */
+void fillMapPixels(
+  const nav_msgs::msg::OccupancyGrid & map,
+  const SaveParameters & save_parameters,
+  bool alpha,
+  std::vector<uint8_t> & pixels)
+{
+  int free_thresh_int = std::rint(save_parameters.free_thresh * 100.0);
+  int occupied_thresh_int = std::rint(save_parameters.occupied_thresh * 100.0);
+
+  // Gray and alpha of each cell value, scaled the way GraphicsMagick scales colors
+  auto to_char = [](double value) {
+      return static_cast<uint8_t>(
+        ScaleQuantumToChar(Magick::Color::scaleDoubleToQuantum(value)));
+    };
+  uint8_t gray[256], opacity[256];
+  for (int value = -128; value < 128; value++) {
+    int8_t map_cell = static_cast<int8_t>(value);
+    uint8_t & g = gray[static_cast<uint8_t>(map_cell)];
+    uint8_t & a = opacity[static_cast<uint8_t>(map_cell)];
+    a = 255;
+    switch (save_parameters.mode) {
+      case MapMode::Trinary:
+        if (map_cell < 0 || 100 < map_cell) {
+          g = 205;
+        } else if (map_cell <= free_thresh_int) {
+          g = 254;
+        } else if (occupied_thresh_int <= map_cell) {
+          g = 0;
+        } else {
+          g = 205;
+        }
+        break;
+      case MapMode::Scale:
+        if (map_cell < 0 || 100 < map_cell) {
+          g = to_char(0.5);
+          a = 0;
+        } else {
+          g = to_char((100.0 - map_cell) / 100.0);
+        }
+        break;
+      case MapMode::Raw: {
+          Magick::Quantum q;
+          if (map_cell < 0 || 100 < map_cell) {
+            q = MaxRGB;
+          } else {
+            q = map_cell / 255.0 * MaxRGB;
+          }
+          g = static_cast<uint8_t>(ScaleQuantumToChar(q));
+          break;
+        }
+      default:
+        std::cerr << "[ERROR] [map_io]: Map mode should be Trinary, Scale or Raw" << std::endl;
+        throw std::runtime_error("Invalid map mode");
+    }
+  }
+
+  const size_t width = map.info.width;
+  const size_t height = map.info.height;
+  const size_t channels = alpha ? 4 : 1;
+  pixels.resize(width * height * channels);
+  convertRows(
+    height, [&](size_t first, size_t last) {
+      for (size_t y = first; y < last; y++) {
+        const int8_t * row = &map.data[width * (height - y - 1)];
+        uint8_t * pixel = &pixels[width * channels * y];
+        for (size_t x = 0; x < width; x++) {
+          uint8_t index = static_cast<uint8_t>(row[x]);
+          if (alpha) {
+            *pixel++ = gray[index];
+            *pixel++ = gray[index];
+            *pixel++ = gray[index];
+            *pixel++ = opacity[index];
+          } else {
+            *pixel++ = gray[index];
+          }
+        }
+      }
+    });
+}
+
+/**
+ * @brief Tries to write map data into a binary 8-bit PGM file, without GraphicsMagick
+ * @param map Occupancy grid data
+ * @param save_parameters Map saving parameters, in trinary or raw mode
+ * @param file_name Name of the PGM file
+ * @throw std::expection in case of problem
+ */
+void tryWritePgmToFile(
+  const nav_msgs::msg::OccupancyGrid & map,
+  const SaveParameters & save_parameters,
+  const std::string & file_name)
+{
+  std::vector<uint8_t> pixels;
+  fillMapPixels(map, save_parameters, false, pixels);
+
+  std::cout << "[INFO] [map_io]: Writing map occupancy data to " << file_name << std::endl;
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  file << "P5\n" << map.info.width << " " << map.info.height << "\n255\n";
+  file.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write " + file_name);
+  }
+}
+
 /**
  * @brief Tries to write map data into a file
  * @param map Occupancy grid data
@@ -422,66 +882,28 @@ void tryWriteMapToFile(
     map.info.resolution << " m/pix" << std::endl;
 
   std::string mapdatafile = save_parameters.map_file_name + "." + save_parameters.image_format;
-  {
-    // should never see this color, so the initialization value is just for debugging
-    Magick::Image image({map.info.width, map.info.height}, "red");
+  if (save_parameters.image_format == BINARY_MAP_FORMAT) {
+    tryWriteBinaryMapToFile(map, save_parameters, mapdatafile);
+  } else if (save_parameters.image_format == "pgm" && save_parameters.mode != MapMode::Scale) {
+    tryWritePgmToFile(map, save_parameters, mapdatafile);
+  } else {
+    // Gray, or gray and alpha in scale mode, of every pixel of the image
+    const bool alpha = save_parameters.mode == MapMode::Scale;
+    std::vector<uint8_t> pixels;
+    fillMapPixels(map, save_parameters, alpha, pixels);
+
+    Magick::Image image;
+    image.read(
+      map.info.width, map.info.height, alpha ? "RGBA" : "I", Magick::CharPixel, pixels.data());
 
     // In scale mode, we need the alpha (matte) channel. Else, we don't.
     // NOTE: GraphicsMagick seems to have trouble loading the alpha channel when saved with
     // Magick::GreyscaleMatte, so we use TrueColorMatte instead.
-    image.type(
-      save_parameters.mode == MapMode::Scale ?
-      Magick::TrueColorMatteType : Magick::GrayscaleType);
+    image.type(alpha ? Magick::TrueColorMatteType : Magick::GrayscaleType);
 
     // Since we only need to support 100 different pixel levels, 8 bits is fine
     image.depth(8);
 
-    int free_thresh_int = std::rint(save_parameters.free_thresh * 100.0);
-    int occupied_thresh_int = std::rint(save_parameters.occupied_thresh * 100.0);
-
-    for (size_t y = 0; y < map.info.height; y++) {
-      for (size_t x = 0; x < map.info.width; x++) {
-        int8_t map_cell = map.data[map.info.width * (map.info.height - y - 1) + x];
-
-        Magick::Color pixel;
-
-        switch (save_parameters.mode) {
-          case MapMode::Trinary:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray(205 / 255.0);
-            } else if (map_cell <= free_thresh_int) {
-              pixel = Magick::ColorGray(254 / 255.0);
-            } else if (occupied_thresh_int <= map_cell) {
-              pixel = Magick::ColorGray(0 / 255.0);
-            } else {
-              pixel = Magick::ColorGray(205 / 255.0);
-            }
-            break;
-          case MapMode::Scale:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray{0.5};
-              pixel.alphaQuantum(TransparentOpacity);
-            } else {
-              pixel = Magick::ColorGray{(100.0 - map_cell) / 100.0};
-            }
-            break;
-          case MapMode::Raw:
-            Magick::Quantum q;
-            if (map_cell < 0 || 100 < map_cell) {
-              q = MaxRGB;
-            } else {
-              q = map_cell / 255.0 * MaxRGB;
-            }
-            pixel = Magick::Color(q, q, q);
-            break;
-          default:
-            std::cerr << "[ERROR] [map_io]: Map mode should be Trinary, Scale or Raw" << std::endl;
-            throw std::runtime_error("Invalid map mode");
-        }
-        image.pixelColor(x, y, pixel);
-      }
-    }
-
     std::cout << "[INFO] [map_io]: Writing map occupancy data to " << mapdatafile << std::endl;
     image.write(mapdatafile);
   }
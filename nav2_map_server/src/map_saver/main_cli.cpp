@@ -35,7 +35,7 @@ const char * USAGE_STRING{
   "  -f <mapname>\n"
   "  --occ <threshold_occupied>\n"
   "  --free <threshold_free>\n"
-  "  --fmt <image_format>\n"
+  "  --fmt <image_format> (pgm, png, bmp, ... or nmap for the binary map format)\n"
   "  --mode trinary(default)/scale/raw\n"
   "\n"
   "NOTE: --ros-args should be passed at the end of command line"};
@@ -40,8 +40,8 @@ using namespace std::placeholders;
 
 namespace nav2_map_server
 {
-MapSaver::MapSaver()
-: nav2_util::LifecycleNode("map_saver", "", true)
+MapSaver::MapSaver(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("map_saver", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -212,3 +212,7 @@ bool MapSaver::saveMapTopicToFile(
 }
 
 }  // namespace nav2_map_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_map_server::MapSaver)
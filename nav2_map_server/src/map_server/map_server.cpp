@@ -49,8 +49,13 @@
 #include <string>
 #include <memory>
 #include <fstream>
+#include <functional>
+#include <sstream>
 #include <stdexcept>
 #include <utility>
+#include <vector>
+
+#include <sys/stat.h>
 
 #include "yaml-cpp/yaml.h"
 #include "lifecycle_msgs/msg/state.hpp"
@@ -62,8 +67,8 @@ using namespace std::placeholders;
 namespace nav2_map_server
 {
 
-MapServer::MapServer()
-: nav2_util::LifecycleNode("map_server")
+MapServer::MapServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("map_server", "", false, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -71,6 +76,8 @@ MapServer::MapServer()
   declare_parameter("yaml_filename");
   declare_parameter("topic_name", "map");
   declare_parameter("frame_id", "map");
+  declare_parameter("preload_maps", std::vector<std::string>());
+  declare_parameter("map_cache_dir", "");
 }
 
 MapServer::~MapServer()
@@ -88,6 +95,19 @@ MapServer::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   std::string topic_name = get_parameter("topic_name").as_string();
   frame_id_ = get_parameter("frame_id").as_string();
+  map_cache_dir_ = get_parameter("map_cache_dir").as_string();
+
+  for (const auto & map_file : get_parameter("preload_maps").as_string_array()) {
+    auto preloaded = std::make_shared<LoadedMap>();
+    if (loadMapThroughCache(map_file, preloaded->msg) != LOAD_MAP_SUCCESS) {
+      throw std::runtime_error("Failed to preload map: " + map_file);
+    }
+    updateMsgHeader(preloaded->msg);
+    preloaded_maps_[map_file] = preloaded;
+  }
+  if (!preloaded_maps_.empty()) {
+    RCLCPP_INFO(get_logger(), "Preloaded %zu maps", preloaded_maps_.size());
+  }
 
   // Shared pointer to LoadMap::Response is also should be initialized
   // in order to avoid null-pointer dereference
@@ -116,6 +136,11 @@ MapServer::on_configure(const rclcpp_lifecycle::State & /*state*/)
     service_prefix + std::string(load_map_service_name_),
     std::bind(&MapServer::loadMapCallback, this, _1, _2, _3));
 
+  // Create a service that provides a part of the occupancy grid
+  map_region_service_ = create_service<nav2_msgs::srv::GetMapRegion>(
+    service_prefix + std::string(map_region_service_name_),
+    std::bind(&MapServer::getMapRegionCallback, this, _1, _2, _3));
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -126,7 +151,7 @@ MapServer::on_activate(const rclcpp_lifecycle::State & /*state*/)
 
   // Publish the map using the latched topic
   occ_pub_->on_activate();
-  auto occ_grid = std::make_unique<nav_msgs::msg::OccupancyGrid>(msg_);
+  auto occ_grid = std::make_unique<nav_msgs::msg::OccupancyGrid>(current_->msg);
   occ_pub_->publish(std::move(occ_grid));
 
   // create bond connection
@@ -156,6 +181,9 @@ MapServer::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   occ_pub_.reset();
   occ_service_.reset();
   load_map_service_.reset();
+  map_region_service_.reset();
+  current_.reset();
+  preloaded_maps_.clear();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -180,7 +208,7 @@ void MapServer::getMapCallback(
     return;
   }
   RCLCPP_INFO(get_logger(), "Handling GetMap request");
-  response->map = msg_;
+  response->map = current_->msg;
 }
 
 void MapServer::loadMapCallback(
@@ -198,16 +226,65 @@ void MapServer::loadMapCallback(
   RCLCPP_INFO(get_logger(), "Handling LoadMap request");
   // Load from file
   if (loadMapResponseFromYaml(request->map_url, response)) {
-    auto occ_grid = std::make_unique<nav_msgs::msg::OccupancyGrid>(msg_);
+    auto occ_grid = std::make_unique<nav_msgs::msg::OccupancyGrid>(current_->msg);
     occ_pub_->publish(std::move(occ_grid));  // publish new map
   }
 }
 
+void MapServer::getMapRegionCallback(
+  const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+  const std::shared_ptr<nav2_msgs::srv::GetMapRegion::Request> request,
+  std::shared_ptr<nav2_msgs::srv::GetMapRegion::Response> response)
+{
+  // if not in ACTIVE state, ignore request
+  if (get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE) {
+    RCLCPP_WARN(
+      get_logger(),
+      "Received GetMapRegion request but not in ACTIVE state, ignoring!");
+    return;
+  }
+  RCLCPP_DEBUG(get_logger(), "Handling GetMapRegion request");
+  if (cropMap(
+      getMapLevel(request->level), request->min_x, request->min_y, request->max_x,
+      request->max_y, response->map))
+  {
+    response->result = nav2_msgs::srv::GetMapRegion::Response::RESULT_SUCCESS;
+  } else {
+    response->result = nav2_msgs::srv::GetMapRegion::Response::RESULT_OUTSIDE_MAP;
+  }
+}
+
+const nav_msgs::msg::OccupancyGrid & MapServer::getMapLevel(unsigned int level)
+{
+  const nav_msgs::msg::OccupancyGrid * map = &current_->msg;
+  std::vector<nav_msgs::msg::OccupancyGrid> & pyramid = current_->pyramid;
+  for (unsigned int l = 1; l <= level && (map->info.width > 1 || map->info.height > 1); l++) {
+    if (pyramid.size() < l) {
+      nav_msgs::msg::OccupancyGrid coarse;
+      downsampleMap(*map, coarse);
+      pyramid.push_back(std::move(coarse));
+    }
+    map = &pyramid[l - 1];
+  }
+  return *map;
+}
+
 bool MapServer::loadMapResponseFromYaml(
   const std::string & yaml_file,
   std::shared_ptr<nav2_msgs::srv::LoadMap::Response> response)
 {
-  switch (loadMapFromYaml(yaml_file, msg_)) {
+  auto preloaded = preloaded_maps_.find(yaml_file);
+  if (preloaded != preloaded_maps_.end()) {
+    // Only the stamp changes, map_load_time still identifies the map
+    current_ = preloaded->second;
+    current_->msg.header.stamp = now();
+    response->map = current_->msg;
+    response->result = nav2_msgs::srv::LoadMap::Response::RESULT_SUCCESS;
+    return true;
+  }
+
+  auto loaded = std::make_shared<LoadedMap>();
+  switch (loadMapThroughCache(yaml_file, loaded->msg)) {
     case MAP_DOES_NOT_EXIST:
       response->result = nav2_msgs::srv::LoadMap::Response::RESULT_MAP_DOES_NOT_EXIST;
       return false;
@@ -218,21 +295,76 @@ bool MapServer::loadMapResponseFromYaml(
       response->result = nav2_msgs::srv::LoadMap::Response::RESULT_INVALID_MAP_DATA;
       return false;
     case LOAD_MAP_SUCCESS:
-      // Correcting msg_ header when it belongs to spiecific node
-      updateMsgHeader();
+      // Correcting msg header when it belongs to spiecific node
+      updateMsgHeader(loaded->msg);
+      current_ = loaded;
 
-      response->map = msg_;
+      response->map = current_->msg;
       response->result = nav2_msgs::srv::LoadMap::Response::RESULT_SUCCESS;
   }
 
   return true;
 }
 
-void MapServer::updateMsgHeader()
+LOAD_MAP_STATUS MapServer::loadMapThroughCache(
+  const std::string & yaml_file, nav_msgs::msg::OccupancyGrid & map)
+{
+  // A binary map file loads without decoding already
+  const std::string binary_extension = ".nmap";
+  if (map_cache_dir_.empty() || (yaml_file.size() >= binary_extension.size() &&
+    yaml_file.compare(
+      yaml_file.size() - binary_extension.size(), binary_extension.size(),
+      binary_extension) == 0))
+  {
+    return loadMapFromYaml(yaml_file, map);
+  }
+
+  // Named after the whole path, so that maps of the same name in different places don't meet
+  std::ostringstream cache_name;
+  cache_name << map_cache_dir_ << "/" <<
+    yaml_file.substr(yaml_file.find_last_of('/') + 1) << "." << std::hex <<
+    std::hash<std::string>()(yaml_file);
+  const std::string cache_file = cache_name.str() + binary_extension;
+
+  struct stat cache_stat, yaml_stat, image_stat;
+  bool fresh = stat(cache_file.c_str(), &cache_stat) == 0 &&
+    stat(yaml_file.c_str(), &yaml_stat) == 0 && cache_stat.st_mtime >= yaml_stat.st_mtime;
+  if (fresh) {
+    try {
+      const std::string image_file = loadMapYaml(yaml_file).image_file_name;
+      fresh = stat(image_file.c_str(), &image_stat) == 0 &&
+        cache_stat.st_mtime >= image_stat.st_mtime;
+    } catch (std::exception &) {
+      // Either the map is not a YAML file or it is invalid, loading it tells which
+      fresh = false;
+    }
+  }
+  if (fresh && loadMapFromYaml(cache_file, map) == LOAD_MAP_SUCCESS) {
+    RCLCPP_INFO(get_logger(), "Loaded %s from %s", yaml_file.c_str(), cache_file.c_str());
+    return LOAD_MAP_SUCCESS;
+  }
+
+  const LOAD_MAP_STATUS status = loadMapFromYaml(yaml_file, map);
+  if (status == LOAD_MAP_SUCCESS) {
+    SaveParameters save_parameters;
+    save_parameters.map_file_name = cache_name.str();
+    save_parameters.image_format = "nmap";
+    if (!saveMapToFile(map, save_parameters)) {
+      RCLCPP_WARN(get_logger(), "Failed to write the map cache %s", cache_file.c_str());
+    }
+  }
+  return status;
+}
+
+void MapServer::updateMsgHeader(nav_msgs::msg::OccupancyGrid & msg)
 {
-  msg_.info.map_load_time = now();
-  msg_.header.frame_id = frame_id_;
-  msg_.header.stamp = now();
+  msg.info.map_load_time = now();
+  msg.header.frame_id = frame_id_;
+  msg.header.stamp = now();
 }
 
 }  // namespace nav2_map_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_map_server::MapServer)
@@ -38,7 +38,9 @@
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <cmath>
 #include <fstream>
+#include <iterator>
 
 #include "yaml-cpp/yaml.h"
 #include "nav2_map_server/map_io.hpp"
@@ -232,6 +234,131 @@ TEST_F(MapIOTester, loadSaveMapModes)
   verifyMapMsg(map_msg);
 }
 
+// Save the reference map in the binary map format. Then load it back, once through the saved
+// YAML file and once directly.
+// Succeeds if both loaded maps match the reference map.
+TEST_F(MapIOTester, loadSaveBinaryMap)
+{
+  // 1. Load reference map file
+  LoadParameters loadParameters;
+  fillLoadParameters(path(TEST_DIR) / path(g_valid_pgm_file), loadParameters);
+
+  nav_msgs::msg::OccupancyGrid map_msg;
+  ASSERT_NO_THROW(loadMapFromFile(loadParameters, map_msg));
+
+  // 2. Save OccupancyGrid into a tmp binary map file
+  SaveParameters saveParameters;
+  fillSaveParameters(path(g_tmp_dir) / path(g_valid_map_name), "nmap", saveParameters);
+
+  ASSERT_TRUE(saveMapToFile(map_msg, saveParameters));
+
+  // 3. Load saved map through its YAML file and verify it
+  nav_msgs::msg::OccupancyGrid loaded_msg;
+  LOAD_MAP_STATUS status =
+    loadMapFromYaml(path(g_tmp_dir) / path(g_valid_yaml_file), loaded_msg);
+  ASSERT_EQ(status, LOAD_MAP_SUCCESS);
+  verifyMapMsg(loaded_msg);
+
+  // 4. Load the binary map file on its own and verify it
+  nav_msgs::msg::OccupancyGrid direct_msg;
+  status = loadMapFromYaml(
+    std::string(path(g_tmp_dir) / path(g_valid_map_name)) + ".nmap", direct_msg);
+  ASSERT_EQ(status, LOAD_MAP_SUCCESS);
+  verifyMapMsg(direct_msg);
+  ASSERT_DOUBLE_EQ(
+    direct_msg.info.origin.position.x, map_msg.info.origin.position.x);
+  ASSERT_DOUBLE_EQ(
+    direct_msg.info.origin.position.y, map_msg.info.origin.position.y);
+}
+
+// Load a PGM file whose header has comments, and the same file cut short.
+// Succeeds if the first one matches the reference map and the second one fails to load.
+TEST_F(MapIOTester, loadPGMHeaderCommentsAndTruncated)
+{
+  // 1. Copy the raster of the reference PGM under a header with comments
+  std::ifstream reference(path(TEST_DIR) / path(g_valid_pgm_file), std::ios::binary);
+  std::string content(
+    (std::istreambuf_iterator<char>(reference)), std::istreambuf_iterator<char>());
+  const size_t raster_size = g_valid_image_width * g_valid_image_height;
+  ASSERT_GE(content.size(), raster_size);
+  const std::string raster = content.substr(content.size() - raster_size);
+
+  auto commented_pgm = path(g_tmp_dir) / path("commented.pgm");
+  {
+    std::ofstream file(commented_pgm, std::ios::binary);
+    file << "P5\n# a comment\n" << g_valid_image_width << " # another one\n" <<
+      g_valid_image_height << "\n255\n" << raster;
+  }
+
+  LoadParameters loadParameters;
+  fillLoadParameters(commented_pgm, loadParameters);
+  nav_msgs::msg::OccupancyGrid map_msg;
+  ASSERT_NO_THROW(loadMapFromFile(loadParameters, map_msg));
+  verifyMapMsg(map_msg);
+
+  // 2. Drop the last row
+  auto truncated_pgm = path(g_tmp_dir) / path("truncated.pgm");
+  {
+    std::ofstream file(truncated_pgm, std::ios::binary);
+    file << "P5\n" << g_valid_image_width << " " << g_valid_image_height << "\n255\n" <<
+      raster.substr(0, raster_size - g_valid_image_width);
+  }
+
+  fillLoadParameters(truncated_pgm, loadParameters);
+  ASSERT_ANY_THROW(loadMapFromFile(loadParameters, map_msg));
+}
+
+// Halve the resolution of a small map and crop parts of it, in axis-aligned and rotated maps.
+// Succeeds if the coarse cells and the crops hold the expected cells and origins.
+TEST_F(MapIOTester, downsampleAndCropMap)
+{
+  nav_msgs::msg::OccupancyGrid map_msg;
+  map_msg.info.width = 3;
+  map_msg.info.height = 3;
+  map_msg.info.resolution = 0.5;
+  map_msg.info.origin.position.x = 1.0;
+  map_msg.info.origin.position.y = 2.0;
+  map_msg.info.origin.orientation.w = 1.0;
+  map_msg.data = {
+    0, -1, 100,
+    -1, -1, 50,
+    20, 0, -1};
+
+  // 1. A coarse cell keeps the highest known value, unknown only when all cells are
+  nav_msgs::msg::OccupancyGrid coarse;
+  downsampleMap(map_msg, coarse);
+  ASSERT_EQ(coarse.info.width, 2u);
+  ASSERT_EQ(coarse.info.height, 2u);
+  ASSERT_FLOAT_EQ(coarse.info.resolution, 1.0);
+  ASSERT_EQ(coarse.data, std::vector<int8_t>({0, 100, 20, -1}));
+
+  // 2. Crop the two right columns of the two bottom rows
+  nav_msgs::msg::OccupancyGrid region;
+  ASSERT_TRUE(cropMap(map_msg, 1.6, 2.1, 2.4, 2.9, region));
+  ASSERT_EQ(region.info.width, 2u);
+  ASSERT_EQ(region.info.height, 2u);
+  ASSERT_DOUBLE_EQ(region.info.origin.position.x, 1.5);
+  ASSERT_DOUBLE_EQ(region.info.origin.position.y, 2.0);
+  ASSERT_EQ(region.data, std::vector<int8_t>({-1, 100, -1, 50}));
+
+  // 3. Boxes sticking out of the map are clipped, boxes outside of it are rejected
+  ASSERT_TRUE(cropMap(map_msg, -10.0, -10.0, 10.0, 10.0, region));
+  ASSERT_EQ(region.data, map_msg.data);
+  ASSERT_FALSE(cropMap(map_msg, -10.0, -10.0, 0.9, 10.0, region));
+
+  // 4. With the map turned by 90 degrees, its rows run along -x
+  map_msg.info.origin.position.x = 0.0;
+  map_msg.info.origin.position.y = 0.0;
+  map_msg.info.origin.orientation.z = std::sqrt(0.5);
+  map_msg.info.origin.orientation.w = std::sqrt(0.5);
+  ASSERT_TRUE(cropMap(map_msg, -0.7, 0.1, -0.6, 0.4, region));
+  ASSERT_EQ(region.info.width, 1u);
+  ASSERT_EQ(region.info.height, 1u);
+  ASSERT_NEAR(region.info.origin.position.x, -0.5, 1e-9);
+  ASSERT_NEAR(region.info.origin.position.y, 0.0, 1e-9);
+  ASSERT_EQ(region.data, std::vector<int8_t>({-1}));
+}
+
 // Try to load an invalid file with different ways.
 // Succeeds if all cases are got expected fail behaviours.
 TEST_F(MapIOTester, loadInvalidFile)
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_NAVFN_PLANNER__JUMP_POINT_PLANNER_HPP_
+#define NAV2_NAVFN_PLANNER__JUMP_POINT_PLANNER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_core/global_planner.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_navfn_planner/jump_point_search.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav_msgs/msg/path.hpp"
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class nav2_navfn_planner::JumpPointPlanner
+ * @brief Grid planner searching the costmap with a JumpPointSearch, much faster than
+ * NavFn across large open areas for paths of comparable cost
+ *
+ * Nothing is precomputed from the costmap, so every plan searches the latest snapshot
+ * as it is and costmap updates never invalidate anything.
+ */
+class JumpPointPlanner : public nav2_core::GlobalPlanner
+{
+public:
+  JumpPointPlanner();
+  ~JumpPointPlanner();
+
+  // plugin configure
+  void configure(
+    rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+    std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros) override;
+
+  // plugin cleanup
+  void cleanup() override;
+
+  // plugin activate
+  void activate() override;
+
+  // plugin deactivate
+  void deactivate() override;
+
+  // plugin create path
+  nav_msgs::msg::Path createPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal) override;
+
+  // plugin create path, polling cancel_checker every cancel_check_interval expansions
+  nav_msgs::msg::Path createCancellablePlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    std::function<bool()> cancel_checker) override;
+
+protected:
+  // Search a path between two poses in the planner's frame
+  bool makePlan(
+    const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+    const std::function<bool()> & cancel_checker, nav_msgs::msg::Path & plan);
+
+  std::shared_ptr<tf2_ros::Buffer> tf_;
+  nav2_util::LifecycleNode::SharedPtr node_;
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
+  std::string global_frame_, name_;
+
+  bool allow_unknown_;
+  int cancel_check_interval_{1000};
+
+  JumpPointSearch search_;
+  std::vector<JumpPointSearch::Cell> cells_;
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__JUMP_POINT_PLANNER_HPP_
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_NAVFN_PLANNER__JUMP_POINT_SEARCH_HPP_
+#define NAV2_NAVFN_PLANNER__JUMP_POINT_SEARCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class nav2_navfn_planner::JumpPointSearch
+ * @brief A* over the 8-connected cells of a costmap, jumping over the cells of free space
+ *
+ * A cell is free when its cost is FREE_SPACE. Moves into free space jump along their
+ * direction as in Jump Point Search, without cutting corners, the cells that are not free
+ * taken as obstacles. Jumps also stop on the gateways into inflated space, the free cells
+ * next to a passable cell that is not free, as a path may leave free space from any of
+ * them. Cells next to one that is not free, and the cells that are not free, are expanded
+ * in all 8 directions, so the search falls back to a weighted A* in inflated space, where
+ * moving into a cell of cost c costs its length times 1 + COST_FACTOR * c / COST_NEUTRAL,
+ * as NavFn weighs it. Paths then cost what a weighted A* over every cell finds, while the
+ * search only expands a few cells per turn of the path across open areas.
+ */
+class JumpPointSearch
+{
+public:
+  using Cell = std::pair<unsigned int, unsigned int>;
+
+  JumpPointSearch();
+
+  /**
+   * @brief Set the costs searched, which must outlive the searches
+   * @param costs Row-major costmap values
+   * @param allow_unknown Whether NO_INFORMATION cells may be crossed, at the highest cost
+   */
+  void setCostmap(
+    const unsigned char * costs, unsigned int size_x, unsigned int size_y, bool allow_unknown);
+
+  /**
+   * @brief Search the cheapest path between two cells
+   * @param cancel_checker Polled every cancel_check_interval expansions, may be empty
+   * @param path Output, every cell of the path, the start and goal included
+   * @return False if the goal can't be reached or the search was canceled
+   */
+  bool search(
+    const Cell & start, const Cell & goal, std::vector<Cell> & path,
+    const std::function<bool()> & cancel_checker = nullptr, int cancel_check_interval = 1000);
+
+  /// Cells expanded by the last search
+  std::size_t expansions() const {return expansions_;}
+
+  /// Cost of the last path found, in cells of free space
+  double pathCost() const {return path_cost_;}
+
+protected:
+  bool inside(int x, int y) const
+  {
+    return x >= 0 && y >= 0 && x < static_cast<int>(size_x_) && y < static_cast<int>(size_y_);
+  }
+
+  bool isFree(int x, int y) const;
+  bool isPassable(int x, int y) const;
+  /// Not free or off the map, what jumps treat as obstacles
+  bool isBlocked(int x, int y) const;
+  /// Next to a blocked cell
+  bool isBorder(int x, int y) const;
+  /// Free and next to a passable cell that is not free, where paths may enter inflated space
+  bool isGateway(int x, int y) const;
+
+  // Cost of moving into a passable cell, per cell of length
+  float weight(int x, int y) const;
+
+  /**
+   * @brief Jump from a cell along a straight direction over free space, to the goal, the
+   * first gateway or the first cell with a forced neighbor
+   * @return Index of the cell the jump stops on, -1 if it stops on nothing
+   */
+  int jumpStraight(int x, int y, int dx, int dy) const;
+
+  /**
+   * @brief Jump from a cell along a diagonal over free space, to the goal, the first
+   * gateway or the first cell a straight jump along its components stops from
+   * @return Index of the cell the jump stops on, -1 if it stops on nothing
+   */
+  int jumpDiagonal(int x, int y, int dx, int dy) const;
+
+  void push(int index, int parent, int dx, int dy, float g);
+
+  const unsigned char * costs_;
+  unsigned int size_x_, size_y_;
+  bool allow_unknown_;
+  int goal_x_, goal_y_;
+
+  // Search state, valid for the cells stamped with the current epoch
+  uint32_t epoch_;
+  std::vector<uint32_t> seen_;
+  std::vector<uint8_t> closed_;
+  std::vector<float> g_;
+  std::vector<int32_t> parent_;
+  std::vector<int8_t> dir_x_, dir_y_;  ///< Direction the cell was reached along
+
+  using Entry = std::pair<float, int>;
+  std::vector<Entry> open_;  ///< Binary heap, cheapest first
+
+  std::size_t expansions_;
+  double path_cost_;
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__JUMP_POINT_SEARCH_HPP_
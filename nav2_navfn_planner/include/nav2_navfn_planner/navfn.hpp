@@ -44,6 +44,13 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/thread_pool.hpp"
+
 namespace nav2_navfn_planner
 {
 
@@ -95,6 +102,72 @@ int create_nav_plan_astar(
   int * goal, int * start,
   float * plan, int nplan);
 
+/**
+ * @class PotentialBucketQueue
+ * @brief Monotone bucket queue of cells keyed on potential. Keys are grouped into
+ * buckets of a fixed width, kept in a ring that only has to span the largest
+ * difference between a key being pushed and the lowest key in the queue.
+ * Keys below the current bucket are filed into it.
+ */
+class PotentialBucketQueue
+{
+public:
+  /**
+   * @brief  Constructs the queue
+   * @param bucket_width Range of keys sharing a bucket, popped in no particular order
+   * @param num_buckets Initial size of the ring, grown when a key falls outside it
+   */
+  explicit PotentialBucketQueue(float bucket_width = 1.0f, unsigned int num_buckets = 512);
+
+  /**
+   * @brief  Remove every entry, keeping the allocated buckets
+   */
+  void clear();
+
+  /**
+   * @brief  Queue a cell
+   * @param cell Index of the cell
+   * @param key Priority key, lowest pops first
+   * @param potential Potential of the cell when it was queued, to detect stale entries
+   */
+  void push(int cell, float key, float potential);
+
+  /**
+   * @brief  Pop an entry of the lowest bucket
+   * @return False if the queue is empty
+   */
+  bool pop(int & cell, float & potential);
+
+  struct Entry
+  {
+    int cell;
+    float key;
+    float potential;
+  };
+
+  /**
+   * @brief  Pop every entry of the lowest bucket at once
+   * @param entries Filled with the entries, in no particular order
+   * @return False if the queue is empty
+   */
+  bool popBucket(std::vector<Entry> & entries);
+
+  /**
+   * @brief  Change the range of keys sharing a bucket, also clears the queue
+   */
+  void setBucketWidth(float bucket_width);
+
+  bool empty() const {return size_ == 0;}
+
+private:
+  void grow(long bucket);
+
+  float bucket_width_;
+  std::vector<std::vector<Entry>> buckets_;
+  long current_;  /**< absolute index of the lowest bucket that may hold entries */
+  std::size_t size_;
+};
+
 /**
  * @class NavFn
  * @brief Navigation function class. Holds buffers for costmap, navfn map. Maps are pixel-based.
@@ -113,11 +186,13 @@ public:
   ~NavFn();
 
   /**
-   * @brief  Sets or resets the size of the map
+   * @brief  Sets or resets the size of the map. The arrays are only reallocated
+   *   when the size changes, so the cost array keeps its contents otherwise
    * @param nx The x size of the map
    * @param ny The y size of the map
+   * @return True if the arrays were reallocated and the cost array cleared
    */
-  void setNavArr(int nx, int ny);
+  bool setNavArr(int nx, int ny);
   int nx, ny, ns;  /**< size of grid, in pixels */
 
   /**
@@ -129,6 +204,84 @@ public:
    */
   void setCostmap(const COSTTYPE * cmap, bool isROS = true, bool allow_unknown = true);
 
+  /**
+   * @brief  Translate a window of a ROS costmap into the cost array, leaving
+   *   the cells outside of it untouched
+   * @param cmap The costmap, of the same size as the cost array
+   * @param x0 First column of the window
+   * @param xn One past the last column of the window
+   * @param y0 First row of the window
+   * @param yn One past the last row of the window
+   * @param allow_unknown Whether or not the planner should be allowed to plan through
+   *   unknown space
+   */
+  void setCostmapRegion(
+    const COSTTYPE * cmap, int x0, int xn, int y0, int yn,
+    bool allow_unknown = true);
+
+  /**
+   * @brief  Set the cost of a single cell of the cost array
+   * @param n Index of the cell
+   * @param cost New navfn cost of the cell
+   */
+  void setCellCost(int n, COSTTYPE cost);
+
+  /**
+   * @brief  Select the propagation engine
+   * @param use_bucket_queue Whether to expand cells in potential order from a bucket queue
+   *   instead of the threshold based priority blocks
+   */
+  void setUseBucketQueue(bool use_bucket_queue) {use_bucket_queue_ = use_bucket_queue;}
+
+  /**
+   * @brief  Spread Dijkstra propagation over a thread pool, by delta-stepping
+   * @param pool Pool to relax each bucket's cells on, nullptr or a pool of size 1
+   *   to propagate on the calling thread only
+   * @param bucket_width Range of potentials whose cells are relaxed together
+   */
+  void setThreadPool(nav2_util::ThreadPool * pool, float bucket_width = COST_NEUTRAL);
+
+  /**
+   * @brief  Restrict propagation to a subset of the cells
+   * @param mask Array of the size of the map, nonzero for the cells propagation may
+   *   reach, or nullptr to propagate everywhere. It is not copied, and must stay
+   *   valid while it is set
+   */
+  void setPropagationMask(const unsigned char * mask) {propagation_mask_ = mask;}
+
+  /**
+   * @brief  Give up propagating once a checker returns true
+   * @param cancel_checker Polled while propagating, or an empty function to never give up
+   * @param interval Propagation steps between two polls: wavefronts of the priority
+   *   blocks, cells of the bucket queue and of the incremental search, or rounds of
+   *   delta-stepping
+   */
+  void setCancelChecker(std::function<bool()> cancel_checker, int interval = 1);
+
+  /**
+   * @brief  Choose between caching the gradient of the cells paths go through and
+   *   computing it on demand
+   * @param cache_gradients Whether to keep a gradient cache of the size of the map.
+   *   Without it, 12 bytes a cell are saved out of the 18 of the base arrays, at the price
+   *   of recomputing the gradient of a cell for every path step next to it
+   */
+  void setGradientCaching(bool cache_gradients);
+
+  /**
+   * @brief  Whether the last propagation was given up, its potential is then incomplete
+   */
+  bool isCanceled() const {return canceled_;}
+
+  /**
+   * @brief  Calculates the navigation function incrementally, in the manner of LPA*.
+   *   The potential is seeded at the goal and kept between calls, as long as the goal
+   *   stays the same, and only repaired around the cells whose cost changed since.
+   *   Propagation stops as soon as the potential at the start is final, which makes
+   *   moving the start cheap as well
+   * @return True if the start is reachable
+   */
+  bool calcNavFnIncremental();
+
   /**
    * @brief  Calculates a plan using the A* heuristic, returns true if one is found
    * @return True if a plan is found, false otherwise
@@ -164,6 +317,12 @@ public:
    */
   float getLastPathCost();
 
+  /**
+   * @brief  Gets the number of cells expanded by every propagation since construction
+   * @return The running count, the difference around a call gives its own expansions
+   */
+  uint64_t getExpandedCells() const {return expanded_cells_;}
+
   /** cell arrays */
   COSTTYPE * costarr;  /**< cost array in 2D configuration space */
   float * potarr;  /**< potential array, navigation function potential */
@@ -238,13 +397,101 @@ public:
    */
   bool propNavFnAstar(int cycles);  /**< returns true if start point found */
 
+  /**
+   * @brief  Run propagation in potential order from a bucket queue. Every open cell
+   * is expanded once per improvement of its potential, and no cell is ever dropped
+   * @param atStart Whether or not to stop when the start point is reached
+   * @param astar Whether to order cells by potential plus the Euclidean distance heuristic
+   * @return true if the start point is reached, or the whole map was propagated
+   */
+  bool propNavFnBuckets(bool atStart, bool astar);
+
+  /**
+   * @brief  Run Dijkstra propagation by delta-stepping. The cells of the lowest
+   * bucket are relaxed together, their neighbors' potentials being computed on
+   * the thread pool from the potentials left by the previous round, so the
+   * result does not depend on the number of threads. Cells lowered into the
+   * bucket being relaxed are relaxed again in the next round
+   * @param atStart Whether or not to stop when the start point is reached
+   * @return true if the start point is reached, or the whole map was propagated
+   */
+  bool propNavFnDeltaStepping(bool atStart);
+
+  /**
+   * @brief  Recompute the one-step lookahead potential of cell n for incremental
+   *   propagation, and queue the cell if it no longer matches its potential
+   */
+  void updateIncrementalCell(int n);
+
+  /**
+   * @brief  Forget the gradients that depend on the potential of cell n
+   */
+  void clearGradient(int n);
+
+  /**
+   * @brief  Forget every cached gradient, in constant time
+   */
+  void resetGradient();
+
+  /**
+   * @brief  Mark the outer bounds of the cost array as obstacles
+   */
+  void setBorderObstacles();
+
+  /**
+   * @brief  Whether propagation may reach cell n
+   */
+  bool inPropagationMask(int n) const {return !propagation_mask_ || propagation_mask_[n];}
+
+  /**
+   * @brief  Potential of cell n from its neighbors, as updateCell computes it
+   */
+  float cellPotential(int n) const;
+
+  /**
+   * @brief  Lower the potential of the open neighbors of cell n and queue them
+   */
+  void relaxNeighbors(int n, bool astar);
+
+  /**
+   * @brief  Poll the cancel checker on every cancel_interval_-th step
+   * @return True once the propagation is canceled
+   */
+  bool pollCancel(int step);
+
+  bool use_bucket_queue_;  /**< propagate with bucket_queue_ instead of priority blocks */
+  PotentialBucketQueue bucket_queue_;
+
+  const unsigned char * propagation_mask_;  /**< cells propagation may reach, not owned */
+  nav2_util::ThreadPool * thread_pool_;  /**< pool for delta-stepping, not owned */
+  float delta_;  /**< bucket width for delta-stepping */
+  std::function<bool()> cancel_checker_;  /**< polled while propagating, may be empty */
+  int cancel_interval_;  /**< propagation steps between two polls */
+  bool canceled_;  /**< whether the current propagation was canceled */
+  /** incremental propagation state, valid until a full propagation or cost update */
+  bool incremental_valid_;
+  int incremental_goal_;  /**< goal cell the incremental potential is seeded at */
+  std::vector<float> rhs_;  /**< one-step lookahead potential of every cell */
+  std::vector<int> changed_cells_;  /**< cells whose cost changed since the last repair */
+  std::priority_queue<
+    std::pair<float, int>, std::vector<std::pair<float, int>>,
+    std::greater<std::pair<float, int>>> incremental_queue_;
+
+  std::vector<PotentialBucketQueue::Entry> frontier_;  /**< bucket being relaxed */
+  std::vector<int> candidates_;  /**< neighbors of the frontier to recompute */
+  std::vector<float> candidate_pots_;  /**< recomputed potential of each candidate */
+  std::vector<unsigned int> candidate_round_;  /**< last round a cell was a candidate */
+  unsigned int candidate_stamp_;  /**< stamp of the round being gathered */
+
   /** gradient and paths */
-  float * gradx, * grady;  /**< gradient arrays, size of potential array */
-  float * pathx, * pathy;  /**< path points, as subpixel cell coordinates */
+  std::vector<float> grad;  /**< gradient of every cell, x and y interleaved */
+  std::vector<unsigned int> grad_stamp_;  /**< epoch each cell's gradient was computed in */
+  unsigned int grad_epoch_;  /**< current epoch, bumped whenever the potential is reset */
+  std::vector<float> pathx, pathy;  /**< path points, as subpixel cell coordinates */
   int npath;  /**< number of path points */
-  int npathbuf;  /**< size of pathx, pathy buffers */
 
   float last_path_cost_;  /**< Holds the cost of the path found the last time A* was called */
+  uint64_t expanded_cells_;  /**< Cells expanded by all propagations so far */
 
   /**
    * @brief  Calculates the path for at mose <n> cycles
@@ -254,6 +501,16 @@ public:
   int calcPath(int n, int * st = NULL);
 
   float gradCell(int n);  /**< calculates gradient at cell <n>, returns norm */
+
+  /**
+   * @brief  Compute the normalized gradient of cell n without caching it
+   * @param n The cell, which must not be on the first or last row
+   * @param g Output x and y of the gradient
+   * @return The inverse of the norm of the raw gradient, 0 if it is null
+   */
+  float cellGradient(int n, float * g) const;
+
+  bool cache_gradients_;  /**< whether grad caches the gradients, or they are computed on demand */
   float pathStep;  /**< step size for following gradient */
 
   /** display callback */
@@ -18,6 +18,8 @@
 #define NAV2_NAVFN_PLANNER__NAVFN_PLANNER_HPP_
 
 #include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <memory>
 #include <vector>
@@ -29,6 +31,7 @@
 #include "nav2_navfn_planner/navfn.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/thread_pool.hpp"
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 
 namespace nav2_navfn_planner
@@ -61,6 +64,34 @@ public:
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal) override;
 
+  // plugin create path, polling cancel_checker every cancel_check_interval steps of
+  // the propagation
+  nav_msgs::msg::Path createCancellablePlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    std::function<bool()> cancel_checker) override;
+
+  // plugin create a path to the point that far along the coarse path to the goal,
+  // only with hierarchical planning
+  nav_msgs::msg::Path createPartialPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    double length) override;
+
+  // plugin create paths to several goals from a single propagation
+  std::vector<nav_msgs::msg::Path> createPlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals) override;
+
+  // plugin costs to several goals, read off a single propagation without descending any path
+  std::vector<double> computeCosts(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals) override;
+
+  // Cells expanded by the planner's propagations since it was configured, the
+  // coarse ones of hierarchical planning included
+  uint64_t getExpandedCells() const;
+
 protected:
   // Compute a plan given start and goal poses, provided in global world frame.
   bool makePlan(
@@ -68,14 +99,36 @@ protected:
     const geometry_msgs::msg::Pose & goal, double tolerance,
     nav_msgs::msg::Path & plan);
 
+  // Compute plans from a start pose to several goals, sharing a single
+  // potential propagated from the start over the whole map
+  bool makePlans(
+    const geometry_msgs::msg::Pose & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals, double tolerance,
+    std::vector<nav_msgs::msg::Path> & plans);
+
   // Compute the navigation function given a seed point in the world to start from
   bool computePotential(const geometry_msgs::msg::Point & world_point);
 
+  // Compute a plan to a goal, or the closest reachable point within tolerance
+  // of it, from a potential - must call computePotential first
+  bool getPlanToGoal(
+    const geometry_msgs::msg::Pose & goal, double tolerance,
+    nav_msgs::msg::Path & plan);
+
   // Compute a plan to a goal from a potential - must call computePotential first
   bool getPlanFromPotential(
     const geometry_msgs::msg::Pose & goal,
     nav_msgs::msg::Path & plan);
 
+  // Compute a plan to a goal from the incremental potential, seeded at the goal
+  // - must call NavFn::calcNavFnIncremental first
+  bool getIncrementalPlan(
+    const geometry_msgs::msg::Pose & goal,
+    nav_msgs::msg::Path & plan);
+
+  // Append navfn's last path to a plan, in world coordinates, backwards if reverse
+  void appendPlannerPath(bool reverse, nav_msgs::msg::Path & plan);
+
   // Remove artifacts at the end of the path - originated from planning on a discretized world
   void smoothApproachToGoal(
     const geometry_msgs::msg::Pose & goal,
@@ -101,21 +154,71 @@ protected:
     return dx * dx + dy * dy;
   }
 
-  // Transform a point from world to map frame
+  // Transform a point from world to map frame, that of the grid the planner's costs
+  // were last taken from
   bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my);
 
-  // Transform a point from map to world frame
+  // Transform a point from map to world frame, as worldToMap()
   void mapToWorld(double mx, double my, double & wx, double & wy);
 
-  // Set the corresponding cell cost to be free space
+  // Set the corresponding cell of the navigation cost array to be free space
   void clearRobotCell(unsigned int mx, unsigned int my);
 
   // Determine if a new planner object should be made
   bool isPlannerOutOfDate();
 
+  // Record a window of the planner's cost array as changed since it was last
+  // pooled into the coarse planner's
+  void markCoarseDirty(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn);
+
+  // Bring the coarse planner's cost array up to date with the planner's
+  void updateCoarseCosts();
+
+  // Search the coarse planner and mark the full resolution cells around its path
+  // in corridor_mask_, returns false if the coarse search found no path
+  bool computeCorridor(const int * map_start, const int * map_goal);
+
+  // Bring the planner's cost array up to date with the costmap, from its
+  // latest snapshot when there is one, and take the origin of the grid used
+  void refreshPlannerCosts();
+
+  // Bring the planner's cost array up to date with a costmap snapshot, only
+  // translating the cells that changed since the last snapshot it was built from
+  void updatePlannerCosts(
+    const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & snapshot, uint64_t sequence);
+
   // Planner based on ROS1 NavFn algorithm
   std::unique_ptr<NavFn> planner_;
 
+  // Planner over the costs max-pooled by blocks of hierarchical_factor_ cells, its
+  // path bounds the full resolution propagation to corridor_mask_
+  std::unique_ptr<NavFn> coarse_planner_;
+  bool coarse_costs_valid_{false};
+  unsigned int coarse_dirty_x0_{0}, coarse_dirty_xn_{0};
+  unsigned int coarse_dirty_y0_{0}, coarse_dirty_yn_{0};
+  std::vector<unsigned char> corridor_mask_;
+
+  // Pool Dijkstra propagation is spread over, if more than one thread was asked for
+  std::unique_ptr<nav2_util::ThreadPool> propagation_pool_;
+
+  // Propagation steps between two polls of the cancel checker of a plan
+  int cancel_check_interval_{100};
+
+  // Whether NavFn keeps a map sized cache of gradients, instead of computing them on demand
+  bool cache_gradients_{true};
+
+  // Snapshot sequence the planner's cost array was translated from, if it is valid
+  bool planner_costs_valid_{false};
+  uint64_t planner_costs_sequence_{0};
+
+  // Origin of the grid the planner's costs were taken from, which on a rolling
+  // costmap the snapshot may have before or after the live one
+  double grid_origin_x_{0.0}, grid_origin_y_{0.0};
+
+  // Cell cleared by clearRobotCell, it no longer matches the costmap
+  bool robot_cell_cleared_{false};
+  unsigned int robot_cell_x_{0}, robot_cell_y_{0};
+
   // TF buffer
   std::shared_ptr<tf2_ros::Buffer> tf_;
 
@@ -123,6 +226,7 @@ protected:
   nav2_util::LifecycleNode::SharedPtr node_;
 
   // Global Costmap
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
   nav2_costmap_2d::Costmap2D * costmap_;
 
   // The global frame of the costmap
@@ -137,6 +241,18 @@ protected:
 
   // Whether to use the astar planner or default dijkstras
   bool use_astar_;
+
+  // Whether to propagate from a bucket queue instead of the priority blocks
+  bool use_bucket_queue_;
+
+  // Whether to repair the previous potential to the same goal instead of searching anew
+  bool use_incremental_;
+
+  // Side of the blocks pooled for the coarse search, 0 or 1 plans at full resolution only
+  int hierarchical_factor_;
+
+  // Distance from the coarse path the full resolution search may stray
+  double hierarchical_corridor_;
 };
 
 }  // namespace nav2_navfn_planner
@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_NAVFN_PLANNER__STATE_LATTICE_HPP_
+#define NAV2_NAVFN_PLANNER__STATE_LATTICE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "nav2_util/product_cache.hpp"
+
+namespace nav2_navfn_planner
+{
+
+/// A pose of the lattice, in meters and radians
+struct LatticePose
+{
+  double x;
+  double y;
+  double theta;
+};
+
+/**
+ * @struct nav2_navfn_planner::MotionPrimitive
+ * @brief A move of the lattice from one of its headings, straight or along an arc at the
+ * turning radius, forward or in reverse
+ */
+struct MotionPrimitive
+{
+  double dx, dy;  ///< Offset of the end of the move
+  unsigned int end_heading;  ///< Heading bin at the end of the move
+  double length;  ///< Distance traveled (m)
+  double penalty;  ///< Multiplier of the length for turning and reversing
+  bool reverse;
+  std::vector<LatticePose> samples;  ///< Offsets along the move at most a cell apart, end included
+};
+
+/// Parameters the primitives and the heuristic table are built from
+struct LatticeConfig
+{
+  unsigned int num_headings{72};
+  double turning_radius{1.0};
+  bool allow_reverse{false};
+  double reverse_penalty{2.0};
+  double turn_penalty{1.05};
+  double heuristic_radius{5.0};  ///< Half side (m) of the square the table covers
+};
+
+/**
+ * @class nav2_navfn_planner::StateLattice
+ * @brief Motion primitives over (x, y, heading) and the table of the cost of reaching a pose
+ * from another with them, without obstacles
+ *
+ * The headings are split in num_headings bins, and each move changes the heading by a whole
+ * number of them, so that the moves from any heading are those from heading 0 rotated. The
+ * table is then only computed from heading 0, by a Dijkstra search over the moves, and read
+ * in the frame of the pose a cost is wanted from. It takes seconds to compute on large
+ * configurations, so it is looked up in a product cache before and stored there after.
+ */
+class StateLattice
+{
+public:
+  /**
+   * @brief A constructor for nav2_navfn_planner::StateLattice
+   * @param config Moves and extent of the table
+   * @param resolution Cell size (m) of the grid searched
+   * @param cache Where the table is looked up before computing it, and stored after
+   */
+  StateLattice(
+    const LatticeConfig & config, double resolution,
+    const nav2_util::ProductCache & cache = nav2_util::ProductCache());
+
+  const LatticeConfig & config() const {return config_;}
+  double resolution() const {return resolution_;}
+
+  /// Whether the table was read from the cache rather than computed
+  bool tableFromCache() const {return table_from_cache_;}
+
+  /// Bin of the nearest heading
+  unsigned int headingBin(double theta) const;
+
+  /// Heading of a bin, in [0, 2 pi)
+  double headingAngle(unsigned int bin) const {return bin * bin_angle_;}
+
+  /// Moves from a heading bin
+  const std::vector<MotionPrimitive> & primitives(unsigned int heading) const
+  {
+    return primitives_[heading];
+  }
+
+  /**
+   * @brief Cost of the cheapest sequence of moves between two poses of the lattice without
+   * obstacles, the Euclidean distance where the table doesn't reach
+   */
+  double heuristic(
+    const LatticePose & from, unsigned int from_heading,
+    const LatticePose & to, unsigned int to_heading) const;
+
+protected:
+  void buildPrimitives();
+  void computeTable();
+  uint64_t tableKey() const;
+
+  LatticeConfig config_;
+  double resolution_;
+  double bin_angle_;
+  std::vector<double> cos_, sin_;  ///< Of the heading of every bin
+  std::vector<std::vector<MotionPrimitive>> primitives_;
+
+  int table_half_;  ///< Cells of the table on each side of its center
+  unsigned int table_side_;
+  std::vector<float> table_;  ///< Row-major over cells, then heading bins
+  bool table_from_cache_{false};
+};
+
+/**
+ * @brief Shortest forward path between two poses at a turning radius, the best of the six
+ * Dubins words
+ * @param step Spacing (m) of the poses sampled along it
+ * @param poses Output, the poses along the path, its end included but not its start
+ * @return Length (m) of the path
+ */
+double dubinsPath(
+  const LatticePose & from, const LatticePose & to, double radius, double step,
+  std::vector<LatticePose> & poses);
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__STATE_LATTICE_HPP_
@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_NAVFN_PLANNER__STATE_LATTICE_PLANNER_HPP_
+#define NAV2_NAVFN_PLANNER__STATE_LATTICE_PLANNER_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_core/global_planner.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/footprint_collision_checker.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
+#include "nav2_navfn_planner/state_lattice.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav_msgs/msg/path.hpp"
+
+namespace nav2_navfn_planner
+{
+
+/**
+ * @class nav2_navfn_planner::StateLatticePlanner
+ * @brief A* over (x, y, heading) with the motion primitives of a StateLattice, giving
+ * paths a robot with a minimum turning radius can follow
+ *
+ * Poses are kept as the primitives reach them, and only merged by cell and heading bin.
+ * The heuristic is the largest of the lattice table, the cost without obstacles, and of the
+ * distance to the goal around the obstacles, from a NavFn Dijkstra propagation seeded at
+ * the goal over the obstacles alone. Both stay below the cost of the moves, as A* needs.
+ * Every few expansions, a Dubins path to the goal is tried, which ends the search when it
+ * is free. A pose is checked on its center cell first, and on the footprint masks of the
+ * collision checker only when that cell is as close to an obstacle as the footprint could
+ * reach.
+ */
+class StateLatticePlanner : public nav2_core::GlobalPlanner
+{
+public:
+  StateLatticePlanner();
+  ~StateLatticePlanner();
+
+  // plugin configure
+  void configure(
+    rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+    std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros) override;
+
+  // plugin cleanup
+  void cleanup() override;
+
+  // plugin activate
+  void activate() override;
+
+  // plugin deactivate
+  void deactivate() override;
+
+  // plugin create path
+  nav_msgs::msg::Path createPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal) override;
+
+  // plugin create path, polling cancel_checker every cancel_check_interval expansions
+  nav_msgs::msg::Path createCancellablePlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    std::function<bool()> cancel_checker) override;
+
+protected:
+  /// A pose reached by the search
+  struct Node
+  {
+    LatticePose pose;
+    unsigned int heading;
+    double g;
+    int parent;
+    int primitive;  ///< Index of the move from the parent, -1 for the start
+    bool closed;
+  };
+
+  // Search a path between two poses in the planner's frame
+  bool makePlan(
+    const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+    const std::function<bool()> & cancel_checker, nav_msgs::msg::Path & plan);
+
+  // Rebuild the lattice if the configuration or the costmap resolution changed
+  void updateLattice(double resolution);
+
+  // Cost of the footprint at a pose of the planned costmap_, returns false if it collides.
+  // center_cost is set to the cost of the cell under the pose
+  bool poseCost(double x, double y, double theta, unsigned char & center_cost) const;
+
+  // Lower bound of the distance (m) to the goal around the obstacles from a cell, from
+  // navfn_'s potential
+  double obstacleHeuristic(unsigned int mx, unsigned int my) const;
+
+  // Append the poses of a node's chain of moves to a plan
+  void appendNodes(int node, nav_msgs::msg::Path & plan) const;
+
+  void appendPose(const LatticePose & pose, nav_msgs::msg::Path & plan) const;
+
+  std::shared_ptr<tf2_ros::Buffer> tf_;
+  nav2_util::LifecycleNode::SharedPtr node_;
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
+  std::string global_frame_, name_;
+
+  LatticeConfig config_;
+  std::string heuristic_cache_dir_;
+  std::unique_ptr<StateLattice> lattice_;
+  std::unique_ptr<NavFn> navfn_;
+  nav2_costmap_2d::FootprintCollisionChecker collision_checker_;
+
+  bool allow_unknown_;
+  double cost_penalty_;
+  int max_iterations_;
+  int analytic_expansion_interval_;
+  int cancel_check_interval_{1000};
+
+  // State of the plan being made
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> costmap_;
+  unsigned char circumscribed_cost_{0};  ///< Below it at the center, no footprint can collide
+  float start_potential_{0.0f};
+  std::vector<Node> nodes_;
+  std::unordered_map<uint64_t, int> node_index_;
+};
+
+}  // namespace nav2_navfn_planner
+
+#endif  // NAV2_NAVFN_PLANNER__STATE_LATTICE_PLANNER_HPP_
@@ -0,0 +1,177 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_navfn_planner/jump_point_planner.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_util/node_utils.hpp"
+
+using nav2_util::declare_parameter_if_not_declared;
+
+namespace nav2_navfn_planner
+{
+
+JumpPointPlanner::JumpPointPlanner()
+: tf_(nullptr)
+{
+}
+
+JumpPointPlanner::~JumpPointPlanner()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Destroying plugin %s of type JumpPointPlanner",
+    name_.c_str());
+}
+
+void
+JumpPointPlanner::configure(
+  rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+  std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros)
+{
+  node_ = parent;
+  tf_ = tf;
+  name_ = name;
+  costmap_ros_ = costmap_ros;
+  global_frame_ = costmap_ros->getGlobalFrameID();
+
+  RCLCPP_INFO(
+    node_->get_logger(), "Configuring plugin %s of type JumpPointPlanner",
+    name_.c_str());
+
+  declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
+  node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(
+    node_, name + ".cancel_check_interval", rclcpp::ParameterValue(1000));
+  node_->get_parameter(name + ".cancel_check_interval", cancel_check_interval_);
+  cancel_check_interval_ = std::max(cancel_check_interval_, 1);
+}
+
+void
+JumpPointPlanner::activate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Activating plugin %s of type JumpPointPlanner",
+    name_.c_str());
+}
+
+void
+JumpPointPlanner::deactivate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Deactivating plugin %s of type JumpPointPlanner",
+    name_.c_str());
+}
+
+void
+JumpPointPlanner::cleanup()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Cleaning up plugin %s of type JumpPointPlanner",
+    name_.c_str());
+  search_ = JumpPointSearch();
+  cells_ = std::vector<JumpPointSearch::Cell>();
+}
+
+nav_msgs::msg::Path JumpPointPlanner::createPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal)
+{
+  return createCancellablePlan(start, goal, nullptr);
+}
+
+nav_msgs::msg::Path JumpPointPlanner::createCancellablePlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  std::function<bool()> cancel_checker)
+{
+  nav_msgs::msg::Path path;
+  if (!makePlan(start.pose, goal.pose, cancel_checker, path)) {
+    path.poses.clear();
+    if (cancel_checker && cancel_checker()) {
+      RCLCPP_DEBUG(node_->get_logger(), "%s: plan canceled", name_.c_str());
+    } else {
+      RCLCPP_WARN(node_->get_logger(), "%s: failed to create plan.", name_.c_str());
+    }
+  }
+  return path;
+}
+
+bool
+JumpPointPlanner::makePlan(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+  const std::function<bool()> & cancel_checker, nav_msgs::msg::Path & plan)
+{
+  plan.poses.clear();
+  plan.header.stamp = node_->now();
+  plan.header.frame_id = global_frame_;
+
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> costmap_ptr =
+    costmap_ros_->getCostmapSnapshot();
+  if (!costmap_ptr) {
+    nav2_costmap_2d::Costmap2D * live = costmap_ros_->getCostmap();
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(live->getMutex()));
+    costmap_ptr = std::make_shared<const nav2_costmap_2d::Costmap2D>(*live);
+  }
+  const nav2_costmap_2d::Costmap2D & costmap = *costmap_ptr;
+
+  unsigned int start_x, start_y, goal_x, goal_y;
+  if (!costmap.worldToMap(start.position.x, start.position.y, start_x, start_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: the robot's start position is off the global costmap.",
+      name_.c_str());
+    return false;
+  }
+  if (!costmap.worldToMap(goal.position.x, goal.position.y, goal_x, goal_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: the goal sent to the planner is off the global costmap.",
+      name_.c_str());
+    return false;
+  }
+
+  search_.setCostmap(
+    costmap.getCharMap(), costmap.getSizeInCellsX(), costmap.getSizeInCellsY(), allow_unknown_);
+  const bool found = search_.search(
+    {start_x, start_y}, {goal_x, goal_y}, cells_, cancel_checker, cancel_check_interval_);
+  RCLCPP_DEBUG(
+    node_->get_logger(), "%s: %s after %zu expansions", name_.c_str(),
+    found ? "reached the goal" : "stopped", search_.expansions());
+  if (!found) {
+    return false;
+  }
+
+  plan.poses.reserve(cells_.size());
+  geometry_msgs::msg::PoseStamped pose;
+  pose.header = plan.header;
+  pose.pose.position.z = 0.0;
+  pose.pose.orientation.w = 1.0;
+  for (const JumpPointSearch::Cell & cell : cells_) {
+    costmap.mapToWorld(cell.first, cell.second, pose.pose.position.x, pose.pose.position.y);
+    plan.poses.push_back(pose);
+  }
+  // End exactly on the goal rather than on the center of its cell
+  plan.poses.back().pose = goal;
+  return true;
+}
+
+}  // namespace nav2_navfn_planner
+
+#include "pluginlib/class_list_macros.hpp"
+PLUGINLIB_EXPORT_CLASS(nav2_navfn_planner::JumpPointPlanner, nav2_core::GlobalPlanner)
@@ -0,0 +1,329 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_navfn_planner/jump_point_search.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
+
+using nav2_costmap_2d::FREE_SPACE;
+using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+using nav2_costmap_2d::NO_INFORMATION;
+
+namespace nav2_navfn_planner
+{
+
+namespace
+{
+
+constexpr float kSqrt2 = 1.41421356f;
+
+// The 8 directions, straight ones first
+constexpr int kDirections[8][2] = {
+  {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+int sign(int v)
+{
+  return (v > 0) - (v < 0);
+}
+
+}  // namespace
+
+JumpPointSearch::JumpPointSearch()
+: costs_(nullptr),
+  size_x_(0),
+  size_y_(0),
+  allow_unknown_(true),
+  goal_x_(0),
+  goal_y_(0),
+  epoch_(0),
+  expansions_(0),
+  path_cost_(0.0)
+{
+}
+
+void
+JumpPointSearch::setCostmap(
+  const unsigned char * costs, unsigned int size_x, unsigned int size_y, bool allow_unknown)
+{
+  costs_ = costs;
+  allow_unknown_ = allow_unknown;
+  if (size_x != size_x_ || size_y != size_y_) {
+    size_x_ = size_x;
+    size_y_ = size_y;
+    const std::size_t size = static_cast<std::size_t>(size_x) * size_y;
+    seen_.assign(size, 0);
+    closed_.assign(size, 0);
+    g_.resize(size);
+    parent_.resize(size);
+    dir_x_.resize(size);
+    dir_y_.resize(size);
+    epoch_ = 0;
+  }
+}
+
+bool
+JumpPointSearch::isFree(int x, int y) const
+{
+  return costs_[y * size_x_ + x] == FREE_SPACE;
+}
+
+bool
+JumpPointSearch::isPassable(int x, int y) const
+{
+  const unsigned char cost = costs_[y * size_x_ + x];
+  return cost < INSCRIBED_INFLATED_OBSTACLE || (allow_unknown_ && cost == NO_INFORMATION);
+}
+
+bool
+JumpPointSearch::isBlocked(int x, int y) const
+{
+  return !inside(x, y) || !isFree(x, y);
+}
+
+bool
+JumpPointSearch::isBorder(int x, int y) const
+{
+  if (x == 0 || y == 0 || x + 1 == static_cast<int>(size_x_) ||
+    y + 1 == static_cast<int>(size_y_))
+  {
+    return true;
+  }
+  const unsigned char * row = costs_ + (y - 1) * size_x_ + x - 1;
+  for (int j = 0; j < 3; ++j, row += size_x_) {
+    if (row[0] != FREE_SPACE || row[1] != FREE_SPACE || row[2] != FREE_SPACE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+JumpPointSearch::isGateway(int x, int y) const
+{
+  for (int j = y - 1; j <= y + 1; ++j) {
+    for (int i = x - 1; i <= x + 1; ++i) {
+      if (inside(i, j) && !isFree(i, j) && isPassable(i, j)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+float
+JumpPointSearch::weight(int x, int y) const
+{
+  unsigned char cost = costs_[y * size_x_ + x];
+  if (cost == NO_INFORMATION) {
+    cost = INSCRIBED_INFLATED_OBSTACLE - 1;
+  }
+  return 1.0f + static_cast<float>(COST_FACTOR) * cost / COST_NEUTRAL;
+}
+
+int
+JumpPointSearch::jumpStraight(int x, int y, int dx, int dy) const
+{
+  while (true) {
+    if (isBlocked(x + dx, y + dy)) {
+      return -1;
+    }
+    x += dx;
+    y += dy;
+    if ((x == goal_x_ && y == goal_y_) || isGateway(x, y)) {
+      return y * size_x_ + x;
+    }
+    // A forced neighbor beside the cell, only reached optimally through it since the
+    // blocked cell behind it can't be cut diagonally
+    if ((isBlocked(x - dx + dy, y - dy + dx) && !isBlocked(x + dy, y + dx)) ||
+      (isBlocked(x - dx - dy, y - dy - dx) && !isBlocked(x - dy, y - dx)))
+    {
+      return y * size_x_ + x;
+    }
+  }
+}
+
+int
+JumpPointSearch::jumpDiagonal(int x, int y, int dx, int dy) const
+{
+  while (true) {
+    if (isBlocked(x + dx, y + dy) || isBlocked(x + dx, y) || isBlocked(x, y + dy)) {
+      return -1;
+    }
+    x += dx;
+    y += dy;
+    if ((x == goal_x_ && y == goal_y_) || isGateway(x, y)) {
+      return y * size_x_ + x;
+    }
+    if (jumpStraight(x, y, dx, 0) >= 0 || jumpStraight(x, y, 0, dy) >= 0) {
+      return y * size_x_ + x;
+    }
+  }
+}
+
+void
+JumpPointSearch::push(int index, int parent, int dx, int dy, float g)
+{
+  if (seen_[index] == epoch_) {
+    if (closed_[index] || g >= g_[index]) {
+      return;
+    }
+  } else {
+    seen_[index] = epoch_;
+    closed_[index] = 0;
+  }
+  g_[index] = g;
+  parent_[index] = parent;
+  dir_x_[index] = static_cast<int8_t>(dx);
+  dir_y_[index] = static_cast<int8_t>(dy);
+
+  // Octile distance, admissible since no move costs less than its length
+  const int x = index % size_x_;
+  const int y = index / size_x_;
+  const int ax = std::abs(goal_x_ - x);
+  const int ay = std::abs(goal_y_ - y);
+  const float h = static_cast<float>(std::max(ax, ay) - std::min(ax, ay)) +
+    kSqrt2 * std::min(ax, ay);
+  open_.emplace_back(g + h, index);
+  std::push_heap(open_.begin(), open_.end(), std::greater<Entry>());
+}
+
+bool
+JumpPointSearch::search(
+  const Cell & start, const Cell & goal, std::vector<Cell> & path,
+  const std::function<bool()> & cancel_checker, int cancel_check_interval)
+{
+  path.clear();
+  expansions_ = 0;
+  path_cost_ = 0.0;
+  if (!costs_ || start.first >= size_x_ || start.second >= size_y_ ||
+    goal.first >= size_x_ || goal.second >= size_y_ ||
+    !isPassable(goal.first, goal.second))
+  {
+    return false;
+  }
+
+  // Restamp everything once the epochs wrap around
+  if (++epoch_ == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+    epoch_ = 1;
+  }
+  goal_x_ = static_cast<int>(goal.first);
+  goal_y_ = static_cast<int>(goal.second);
+  const int start_index = start.second * size_x_ + start.first;
+  const int goal_index = goal_y_ * size_x_ + goal_x_;
+  cancel_check_interval = std::max(cancel_check_interval, 1);
+
+  open_.clear();
+  push(start_index, -1, 0, 0, 0.0f);
+  while (!open_.empty()) {
+    std::pop_heap(open_.begin(), open_.end(), std::greater<Entry>());
+    const int index = open_.back().second;
+    open_.pop_back();
+    if (closed_[index]) {
+      continue;
+    }
+    closed_[index] = 1;
+
+    if (index == goal_index) {
+      path_cost_ = g_[index];
+      std::vector<int> jump_points;
+      for (int p = index; p >= 0; p = parent_[p]) {
+        jump_points.push_back(p);
+      }
+      // Jumps are straight or diagonal, fill in the cells they skipped
+      const int first = jump_points.back();
+      path.emplace_back(first % size_x_, first / size_x_);
+      for (auto it = jump_points.rbegin() + 1; it != jump_points.rend(); ++it) {
+        int x = path.back().first;
+        int y = path.back().second;
+        const int to_x = *it % size_x_;
+        const int to_y = *it / size_x_;
+        const int dx = sign(to_x - x);
+        const int dy = sign(to_y - y);
+        while (x != to_x || y != to_y) {
+          x += dx;
+          y += dy;
+          path.emplace_back(x, y);
+        }
+      }
+      return true;
+    }
+
+    if (cancel_checker && ++expansions_ % cancel_check_interval == 0 && cancel_checker()) {
+      return false;
+    }
+    if (!cancel_checker) {
+      ++expansions_;
+    }
+
+    const int x = index % size_x_;
+    const int y = index / size_x_;
+    const int in_x = dir_x_[index];
+    const int in_y = dir_y_[index];
+    // Away from the cells that are not free only the natural neighbors of the jump are
+    // worth expanding, the others are reached as cheaply without going through this cell
+    const bool natural_only = (in_x != 0 || in_y != 0) && isFree(x, y) && !isBorder(x, y);
+
+    for (const auto & direction : kDirections) {
+      const int dx = direction[0];
+      const int dy = direction[1];
+      if (natural_only && !((dx == in_x && dy == in_y) ||
+        (in_x != 0 && in_y != 0 && ((dx == in_x && dy == 0) || (dx == 0 && dy == in_y)))))
+      {
+        continue;
+      }
+      const int nx = x + dx;
+      const int ny = y + dy;
+      if (!inside(nx, ny) || !isPassable(nx, ny)) {
+        continue;
+      }
+      // No cutting corners of impassable cells
+      if (dx != 0 && dy != 0 && (!isPassable(x + dx, y) || !isPassable(x, y + dy))) {
+        continue;
+      }
+      const float length = (dx != 0 && dy != 0) ? kSqrt2 : 1.0f;
+
+      if (isFree(nx, ny)) {
+        if (dx != 0 && dy != 0 && (!isFree(x + dx, y) || !isFree(x, y + dy))) {
+          // Cutting a corner of inflated space, which the jumps don't cross
+          push(ny * size_x_ + nx, index, dx, dy, g_[index] + length);
+          continue;
+        }
+        const int next = (dx != 0 && dy != 0) ?
+          jumpDiagonal(x, y, dx, dy) : jumpStraight(x, y, dx, dy);
+        if (next >= 0) {
+          // Jumps only cross free space, of weight 1
+          const int next_x = next % size_x_;
+          const int next_y = next / size_x_;
+          const int steps = std::max(std::abs(next_x - x), std::abs(next_y - y));
+          push(next, index, dx, dy, g_[index] + length * steps);
+        }
+      } else {
+        push(ny * size_x_ + nx, index, dx, dy, g_[index] + length * weight(nx, ny));
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace nav2_navfn_planner
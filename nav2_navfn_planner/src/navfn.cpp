@@ -44,8 +44,15 @@
 #include "nav2_navfn_planner/navfn.hpp"
 
 #include <algorithm>
+#include <functional>
+#include <utility>
 #include "rclcpp/rclcpp.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_NAVFN_PLANNER_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace nav2_navfn_planner
 {
 
@@ -114,7 +121,7 @@ NavFn::NavFn(int xs, int ys)
   costarr = NULL;
   potarr = NULL;
   pending = NULL;
-  gradx = grady = NULL;
+  cache_gradients_ = true;
   setNavArr(xs, ys);
 
   // priority buffers
@@ -126,6 +133,17 @@ NavFn::NavFn(int xs, int ys)
   // for A* (best-first), set to COST_NEUTRAL
   priInc = 2 * COST_NEUTRAL;
 
+  use_bucket_queue_ = false;
+  thread_pool_ = nullptr;
+  propagation_mask_ = nullptr;
+  incremental_valid_ = false;
+  incremental_goal_ = -1;
+  delta_ = COST_NEUTRAL;
+  candidate_stamp_ = 0;
+  expanded_cells_ = 0;
+  cancel_interval_ = 1;
+  canceled_ = false;
+
   // goal and start
   goal[0] = goal[1] = 0;
   start[0] = start[1] = 0;
@@ -135,8 +153,7 @@ NavFn::NavFn(int xs, int ys)
   // displayInt = 0;
 
   // path buffers
-  npathbuf = npath = 0;
-  pathx = pathy = NULL;
+  npath = 0;
   pathStep = 0.5;
 }
 
@@ -152,18 +169,6 @@ NavFn::~NavFn()
   if (pending) {
     delete[] pending;
   }
-  if (gradx) {
-    delete[] gradx;
-  }
-  if (grady) {
-    delete[] grady;
-  }
-  if (pathx) {
-    delete[] pathx;
-  }
-  if (pathy) {
-    delete[] pathy;
-  }
   if (pb1) {
     delete[] pb1;
   }
@@ -202,9 +207,13 @@ NavFn::setStart(int * g)
 // Set/Reset map size
 //
 
-void
+bool
 NavFn::setNavArr(int xs, int ys)
 {
+  if (costarr && xs == nx && ys == ny) {
+    return false;
+  }
+
   RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"), "[NavFn] Array is %d x %d\n", xs, ys);
 
   nx = xs;
@@ -221,20 +230,37 @@ NavFn::setNavArr(int xs, int ys)
     delete[] pending;
   }
 
-  if (gradx) {
-    delete[] gradx;
-  }
-  if (grady) {
-    delete[] grady;
-  }
+  incremental_valid_ = false;
 
   costarr = new COSTTYPE[ns];  // cost array, 2d config space
   memset(costarr, 0, ns * sizeof(COSTTYPE));
   potarr = new float[ns];  // navigation potential array
   pending = new bool[ns];
   memset(pending, 0, ns * sizeof(bool));
-  gradx = new float[ns];
-  grady = new float[ns];
+  if (cache_gradients_) {
+    grad.assign(2 * ns, 0.0);
+    grad_stamp_.assign(ns, 0);
+  }
+  grad_epoch_ = 1;
+  return true;
+}
+
+void
+NavFn::setGradientCaching(bool cache_gradients)
+{
+  if (cache_gradients == cache_gradients_) {
+    return;
+  }
+  cache_gradients_ = cache_gradients;
+  if (cache_gradients_) {
+    grad.assign(2 * ns, 0.0);
+    grad_stamp_.assign(ns, 0);
+    grad_epoch_ = 1;
+  } else {
+    // Give the memory back, clear() would keep it
+    std::vector<float>().swap(grad);
+    std::vector<unsigned int>().swap(grad_stamp_);
+  }
 }
 
 
@@ -242,30 +268,40 @@ NavFn::setNavArr(int xs, int ys)
 // set up cost array, usually from ROS
 //
 
+namespace
+{
+
+// This transforms the incoming cost values:
+// COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
+// COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
+// values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
+inline COSTTYPE translateRosCost(int v, bool allow_unknown)
+{
+  if (v < COST_OBS_ROS) {
+    v = COST_NEUTRAL + COST_FACTOR * v;
+    if (v >= COST_OBS) {
+      v = COST_OBS - 1;
+    }
+    return v;
+  } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
+    return COST_OBS - 1;
+  }
+  return COST_OBS;
+}
+
+}  // namespace
+
 void
 NavFn::setCostmap(const COSTTYPE * cmap, bool isROS, bool allow_unknown)
 {
+  incremental_valid_ = false;
+
   COSTTYPE * cm = costarr;
   if (isROS) {  // ROS-type cost array
     for (int i = 0; i < ny; i++) {
       int k = i * nx;
       for (int j = 0; j < nx; j++, k++, cmap++, cm++) {
-        // This transforms the incoming cost values:
-        // COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
-        // COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
-        // values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
-        *cm = COST_OBS;
-        int v = *cmap;
-        if (v < COST_OBS_ROS) {
-          v = COST_NEUTRAL + COST_FACTOR * v;
-          if (v >= COST_OBS) {
-            v = COST_OBS - 1;
-          }
-          *cm = v;
-        } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
-          v = COST_OBS - 1;
-          *cm = v;
-        }
+        *cm = translateRosCost(*cmap, allow_unknown);
       }
     }
   } else {  // not a ROS map, just a PGM
@@ -292,11 +328,66 @@ NavFn::setCostmap(const COSTTYPE * cmap, bool isROS, bool allow_unknown)
   }
 }
 
+void
+NavFn::setCostmapRegion(
+  const COSTTYPE * cmap, int x0, int xn, int y0, int yn,
+  bool allow_unknown)
+{
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  xn = std::min(xn, nx);
+  yn = std::min(yn, ny);
+  for (int i = y0; i < yn; i++) {
+    const COSTTYPE * src = cmap + i * nx + x0;
+    COSTTYPE * cm = costarr + i * nx + x0;
+    for (int j = x0; j < xn; j++, src++, cm++) {
+      COSTTYPE cost = translateRosCost(*src, allow_unknown);
+      if (incremental_valid_ && cost != *cm) {
+        changed_cells_.push_back(i * nx + j);
+      }
+      *cm = cost;
+    }
+  }
+}
+
+void
+NavFn::setCellCost(int n, COSTTYPE cost)
+{
+  if (incremental_valid_ && cost != costarr[n]) {
+    changed_cells_.push_back(n);
+  }
+  costarr[n] = cost;
+}
+
+void
+NavFn::setCancelChecker(std::function<bool()> cancel_checker, int interval)
+{
+  cancel_checker_ = std::move(cancel_checker);
+  cancel_interval_ = std::max(interval, 1);
+}
+
+inline bool
+NavFn::pollCancel(int step)
+{
+  if (!canceled_ && cancel_checker_ && step % cancel_interval_ == 0) {
+    canceled_ = cancel_checker_();
+  }
+  return canceled_;
+}
+
 bool
 NavFn::calcNavFnDijkstra(bool atStart)
 {
   setupNavFn(true);
 
+  if (thread_pool_ && thread_pool_->size() > 1) {
+    return propNavFnDeltaStepping(atStart);
+  }
+
+  if (use_bucket_queue_) {
+    return propNavFnBuckets(atStart, false);
+  }
+
   // calculate the nav fn and path
   return propNavFnDijkstra(std::max(nx * ny / 20, nx + ny), atStart);
 }
@@ -311,6 +402,10 @@ NavFn::calcNavFnAstar()
 {
   setupNavFn(true);
 
+  if (use_bucket_queue_) {
+    return propNavFnBuckets(true, true);
+  }
+
   // calculate the nav fn and path
   return propNavFnAstar(std::max(nx * ny / 20, nx + ny));
 }
@@ -319,19 +414,19 @@ NavFn::calcNavFnAstar()
 // returning values
 //
 
-float * NavFn::getPathX() {return pathx;}
-float * NavFn::getPathY() {return pathy;}
+float * NavFn::getPathX() {return pathx.data();}
+float * NavFn::getPathY() {return pathy.data();}
 int NavFn::getPathLen() {return npath;}
 
 // inserting onto the priority blocks
 #define push_cur(n)  {if (n >= 0 && n < ns && !pending[n] && \
-      costarr[n] < COST_OBS && curPe < PRIORITYBUFSIZE) \
+      costarr[n] < COST_OBS && inPropagationMask(n) && curPe < PRIORITYBUFSIZE) \
     {curP[curPe++] = n; pending[n] = true;}}
 #define push_next(n) {if (n >= 0 && n < ns && !pending[n] && \
-      costarr[n] < COST_OBS && nextPe < PRIORITYBUFSIZE) \
+      costarr[n] < COST_OBS && inPropagationMask(n) && nextPe < PRIORITYBUFSIZE) \
     {nextP[nextPe++] = n; pending[n] = true;}}
 #define push_over(n) {if (n >= 0 && n < ns && !pending[n] && \
-      costarr[n] < COST_OBS && overPe < PRIORITYBUFSIZE) \
+      costarr[n] < COST_OBS && inPropagationMask(n) && overPe < PRIORITYBUFSIZE) \
     {overP[overPe++] = n; pending[n] = true;}}
 
 
@@ -346,27 +441,15 @@ NavFn::setupNavFn(bool keepit)
     if (!keepit) {
       costarr[i] = COST_NEUTRAL;
     }
-    gradx[i] = grady[i] = 0.0;
   }
+  resetGradient();
+  canceled_ = false;
+
+  // the potential no longer holds an incremental search
+  incremental_valid_ = false;
 
   // outer bounds of cost array
-  COSTTYPE * pc;
-  pc = costarr;
-  for (int i = 0; i < nx; i++) {
-    *pc++ = COST_OBS;
-  }
-  pc = costarr + (ny - 1) * nx;
-  for (int i = 0; i < nx; i++) {
-    *pc++ = COST_OBS;
-  }
-  pc = costarr;
-  for (int i = 0; i < ny; i++, pc += nx) {
-    *pc = COST_OBS;
-  }
-  pc = costarr + nx - 1;
-  for (int i = 0; i < ny; i++, pc += nx) {
-    *pc = COST_OBS;
-  }
+  setBorderObstacles();
 
   // priority buffers
   curT = COST_OBS;
@@ -383,7 +466,7 @@ NavFn::setupNavFn(bool keepit)
   initCost(k, 0);
 
   // find # of obstacle cells
-  pc = costarr;
+  COSTTYPE * pc = costarr;
   int ntot = 0;
   for (int i = 0; i < ns; i++, pc++) {
     if (*pc >= COST_OBS) {
@@ -394,6 +477,38 @@ NavFn::setupNavFn(bool keepit)
 }
 
 
+void
+NavFn::resetGradient()
+{
+  if (++grad_epoch_ == 0 && cache_gradients_) {  // stamps wrapped around, forget them
+    std::fill(grad_stamp_.begin(), grad_stamp_.end(), 0);
+    grad_epoch_ = 1;
+  }
+}
+
+void
+NavFn::setBorderObstacles()
+{
+  COSTTYPE * pc;
+  pc = costarr;
+  for (int i = 0; i < nx; i++) {
+    *pc++ = COST_OBS;
+  }
+  pc = costarr + (ny - 1) * nx;
+  for (int i = 0; i < nx; i++) {
+    *pc++ = COST_OBS;
+  }
+  pc = costarr;
+  for (int i = 0; i < ny; i++, pc += nx) {
+    *pc = COST_OBS;
+  }
+  pc = costarr + nx - 1;
+  for (int i = 0; i < ny; i++, pc += nx) {
+    *pc = COST_OBS;
+  }
+}
+
+
 // initialize a goal-type cost for starting propagation
 
 void
@@ -586,6 +701,9 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
     if (curPe == 0 && nextPe == 0) {  // priority blocks empty
       break;
     }
+    if (pollCancel(cycle)) {
+      break;
+    }
 
     // stats
     nc += curPe;
@@ -636,12 +754,14 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
     }
   }
 
+  expanded_cells_ += nc;
+
   RCLCPP_DEBUG(
     rclcpp::get_logger("rclcpp"),
     "[NavFn] Used %d cycles, %d cells visited (%d%%), priority buf max %d\n",
     cycle, nc, (int)((nc * 100.0) / (ns - nobs)), nwv);
 
-  return (cycle < cycles) ? true : false;
+  return (cycle < cycles && !canceled_) ? true : false;
 }
 
 //
@@ -672,6 +792,9 @@ NavFn::propNavFnAstar(int cycles)
     if (curPe == 0 && nextPe == 0) {  // priority blocks empty
       break;
     }
+    if (pollCancel(cycle)) {
+      break;
+    }
 
     // stats
     nc += curPe;
@@ -720,6 +843,7 @@ NavFn::propNavFnAstar(int cycles)
     }
   }
 
+  expanded_cells_ += nc;
   last_path_cost_ = potarr[startCell];
 
   RCLCPP_DEBUG(
@@ -735,6 +859,446 @@ NavFn::propNavFnAstar(int cycles)
 }
 
 
+//
+// bucket queue of cells keyed on potential
+//
+
+PotentialBucketQueue::PotentialBucketQueue(float bucket_width, unsigned int num_buckets)
+: bucket_width_(bucket_width),
+  buckets_(std::max(num_buckets, 1u)),
+  current_(0),
+  size_(0)
+{
+}
+
+void
+PotentialBucketQueue::clear()
+{
+  for (auto & bucket : buckets_) {
+    bucket.clear();
+  }
+  current_ = 0;
+  size_ = 0;
+}
+
+void
+PotentialBucketQueue::push(int cell, float key, float potential)
+{
+  long bucket = static_cast<long>(key / bucket_width_);
+  if (size_ == 0) {
+    current_ = bucket;
+  } else if (bucket < current_) {
+    bucket = current_;
+  }
+  if (bucket - current_ >= static_cast<long>(buckets_.size())) {
+    grow(bucket);
+  }
+  buckets_[bucket % buckets_.size()].push_back(Entry{cell, key, potential});
+  size_++;
+}
+
+bool
+PotentialBucketQueue::pop(int & cell, float & potential)
+{
+  if (size_ == 0) {
+    return false;
+  }
+  std::vector<Entry> * bucket = &buckets_[current_ % buckets_.size()];
+  while (bucket->empty()) {
+    current_++;
+    bucket = &buckets_[current_ % buckets_.size()];
+  }
+  cell = bucket->back().cell;
+  potential = bucket->back().potential;
+  bucket->pop_back();
+  size_--;
+  return true;
+}
+
+bool
+PotentialBucketQueue::popBucket(std::vector<Entry> & entries)
+{
+  entries.clear();
+  if (size_ == 0) {
+    return false;
+  }
+  std::vector<Entry> * bucket = &buckets_[current_ % buckets_.size()];
+  while (bucket->empty()) {
+    current_++;
+    bucket = &buckets_[current_ % buckets_.size()];
+  }
+  // hand the bucket's storage over, and keep the old one for reuse
+  entries.swap(*bucket);
+  size_ -= entries.size();
+  return true;
+}
+
+void
+PotentialBucketQueue::setBucketWidth(float bucket_width)
+{
+  clear();
+  bucket_width_ = bucket_width;
+}
+
+void
+PotentialBucketQueue::grow(long bucket)
+{
+  std::size_t num_buckets = buckets_.size();
+  while (bucket - current_ >= static_cast<long>(num_buckets)) {
+    num_buckets *= 2;
+  }
+
+  // Refile every entry, entries below the current bucket were filed into it
+  std::vector<std::vector<Entry>> buckets(num_buckets);
+  for (auto & old_bucket : buckets_) {
+    for (const Entry & entry : old_bucket) {
+      long b = std::max(static_cast<long>(entry.key / bucket_width_), current_);
+      buckets[b % num_buckets].push_back(entry);
+    }
+  }
+  buckets_.swap(buckets);
+}
+
+//
+// main propagation function
+// exact best-first order from a bucket queue, Dijkstra or A*
+// each cell is updated from its neighbors when one of them is expanded
+//   and queued whenever its potential drops
+//
+
+inline float
+NavFn::cellPotential(int n) const
+{
+  // find lowest, and its lowest neighbor
+  float ta, tc;
+  float l = potarr[n - 1];
+  float r = potarr[n + 1];
+  float u = potarr[n - nx];
+  float d = potarr[n + nx];
+  if (l < r) {tc = l;} else {tc = r;}
+  if (u < d) {ta = u;} else {ta = d;}
+
+  float hf = static_cast<float>(costarr[n]);  // traversability factor
+  float dc = tc - ta;  // relative cost between ta,tc
+  if (dc < 0) {  // ta is lowest
+    dc = -dc;
+    ta = tc;
+  }
+
+  if (dc >= hf) {  // if too large, use ta-only update
+    return ta + hf;
+  }
+  // two-neighbor interpolation update, quadratic approximation
+  float dr = dc / hf;
+  float v = -0.2301 * dr * dr + 0.5307 * dr + 0.7040;
+  // the approximation slightly overshoots the ta-only update as dr nears 1,
+  // capping it keeps the potential nondecreasing in both neighbors, which the
+  // incremental propagation relies on to raise potentials again
+  return ta + hf * std::min(v, 1.0f);
+}
+
+inline void
+NavFn::relaxNeighbors(int n, bool astar)
+{
+  const int neighbors[4] = {n - 1, n + 1, n - nx, n + nx};
+  for (int m : neighbors) {
+    // obstacles, the map border included, are never expanded
+    if (m < 0 || m >= ns || costarr[m] >= COST_OBS || !inPropagationMask(m)) {
+      continue;
+    }
+    float pot = cellPotential(m);
+    if (pot < potarr[m]) {
+      potarr[m] = pot;
+      float key = pot;
+      if (astar) {
+        key += hypot(m % nx - start[0], m / nx - start[1]) * static_cast<float>(COST_NEUTRAL);
+      }
+      bucket_queue_.push(m, key, pot);
+    }
+  }
+}
+
+bool
+NavFn::propNavFnBuckets(bool atStart, bool astar)
+{
+  int nc = 0;  // number of cells expanded
+
+  // the priority blocks set up by setupNavFn are not used
+  curPe = nextPe = overPe = 0;
+  bucket_queue_.clear();
+
+  // set up start cell
+  int startCell = start[1] * nx + start[0];
+
+  relaxNeighbors(goal[0] + goal[1] * nx, astar);
+
+  int n;
+  float pot;
+  int npops = 0;
+  while (bucket_queue_.pop(n, pot)) {
+    if (pollCancel(npops++)) {
+      break;
+    }
+    if (pot > potarr[n]) {
+      continue;  // superseded by a lower potential queued later
+    }
+    nc++;
+
+    // check if we've hit the Start cell
+    if ((atStart || astar) && n == startCell) {
+      break;
+    }
+    relaxNeighbors(n, astar);
+  }
+
+  expanded_cells_ += nc;
+  last_path_cost_ = potarr[startCell];
+
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("rclcpp"),
+    "[NavFn] Bucket queue expanded %d cells (%d%%)\n",
+    nc, (int)((nc * 100.0) / (ns - nobs)));
+
+  if (canceled_) {
+    return false;
+  }
+  if (atStart || astar) {
+    return potarr[startCell] < POT_HIGH;
+  }
+  return true;
+}
+
+void
+NavFn::setThreadPool(nav2_util::ThreadPool * pool, float bucket_width)
+{
+  thread_pool_ = pool;
+  delta_ = bucket_width;
+}
+
+//
+// main propagation function
+// delta-stepping Dijkstra, each bucket of potentials is relaxed in rounds:
+//   the neighbors of the bucket's cells are recomputed in parallel from the
+//   potentials of the previous round, then lowered and queued in order
+//
+
+bool
+NavFn::propNavFnDeltaStepping(bool atStart)
+{
+  // below this many candidates, a round is cheaper than waking the pool
+  const std::size_t chunk_size = 256;
+
+  int nc = 0;  // number of cells expanded
+  int nrounds = 0;
+
+  // the priority blocks set up by setupNavFn are not used
+  curPe = nextPe = overPe = 0;
+  bucket_queue_.setBucketWidth(delta_);
+  if (candidate_round_.size() != static_cast<std::size_t>(ns)) {
+    candidate_round_.assign(ns, 0);
+    candidate_stamp_ = 0;
+  }
+
+  // set up start cell
+  int startCell = start[1] * nx + start[0];
+  bool reached_start = false;
+
+  relaxNeighbors(goal[0] + goal[1] * nx, false);
+
+  while (!reached_start && !pollCancel(nrounds) && bucket_queue_.popBucket(frontier_)) {
+    nrounds++;
+    if (++candidate_stamp_ == 0) {  // stamps wrapped around, forget them
+      std::fill(candidate_round_.begin(), candidate_round_.end(), 0);
+      candidate_stamp_ = 1;
+    }
+
+    // gather the open neighbors of the bucket's cells, once each
+    candidates_.clear();
+    for (const auto & entry : frontier_) {
+      int n = entry.cell;
+      if (entry.potential > potarr[n]) {
+        continue;  // superseded by a lower potential queued later
+      }
+      nc++;
+
+      // check if we've hit the Start cell
+      if (atStart && n == startCell) {
+        reached_start = true;
+      }
+
+      const int neighbors[4] = {n - 1, n + 1, n - nx, n + nx};
+      for (int m : neighbors) {
+        // obstacles, the map border included, are never expanded
+        if (m < 0 || m >= ns || costarr[m] >= COST_OBS || !inPropagationMask(m) ||
+          candidate_round_[m] == candidate_stamp_)
+        {
+          continue;
+        }
+        candidate_round_[m] = candidate_stamp_;
+        candidates_.push_back(m);
+      }
+    }
+
+    // recompute the candidates, reading only potentials of the previous round
+    candidate_pots_.resize(candidates_.size());
+    std::size_t num_chunks = (candidates_.size() + chunk_size - 1) / chunk_size;
+    auto compute_chunk = [this, chunk_size](std::size_t chunk) {
+        std::size_t end = std::min((chunk + 1) * chunk_size, candidates_.size());
+        for (std::size_t i = chunk * chunk_size; i < end; ++i) {
+          candidate_pots_[i] = cellPotential(candidates_[i]);
+        }
+      };
+    if (num_chunks > 1) {
+      thread_pool_->parallelFor(num_chunks, compute_chunk);
+    } else if (num_chunks == 1) {
+      compute_chunk(0);
+    }
+
+    // lower and queue them, in gathering order so the result is deterministic
+    for (std::size_t i = 0; i < candidates_.size(); ++i) {
+      int m = candidates_[i];
+      float pot = candidate_pots_[i];
+      if (pot < potarr[m]) {
+        potarr[m] = pot;
+        bucket_queue_.push(m, pot, pot);
+      }
+    }
+  }
+
+  expanded_cells_ += nc;
+  last_path_cost_ = potarr[startCell];
+
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("rclcpp"),
+    "[NavFn] Delta-stepping expanded %d cells (%d%%) in %d rounds\n",
+    nc, (int)((nc * 100.0) / (ns - nobs)), nrounds);
+
+  if (canceled_) {
+    return false;
+  }
+  if (atStart) {
+    return potarr[startCell] < POT_HIGH;
+  }
+  return true;
+}
+
+//
+// main propagation function
+// incremental Dijkstra, after LPA* with a zero heuristic
+// potarr holds each cell's potential and rhs_ the potential its neighbors
+//   give it; cells where they differ are queued on the lower of the two,
+//   and settled in order until the start's potential is final
+//
+
+inline void
+NavFn::clearGradient(int n)
+{
+  if (!cache_gradients_) {
+    return;
+  }
+  const int cells[5] = {n, n - 1, n + 1, n - nx, n + nx};
+  for (int m : cells) {
+    if (m >= 0 && m < ns) {
+      grad_stamp_[m] = 0;
+    }
+  }
+}
+
+inline void
+NavFn::updateIncrementalCell(int n)
+{
+  if (n == incremental_goal_) {
+    return;
+  }
+  float rhs = POT_HIGH;
+  if (costarr[n] < COST_OBS) {
+    rhs = std::min(cellPotential(n), static_cast<float>(POT_HIGH));
+  }
+  rhs_[n] = rhs;
+  if (potarr[n] != rhs) {
+    incremental_queue_.push(std::make_pair(std::min(potarr[n], rhs), n));
+  }
+}
+
+bool
+NavFn::calcNavFnIncremental()
+{
+  int goalCell = goal[1] * nx + goal[0];
+  int startCell = start[1] * nx + start[0];
+  canceled_ = false;
+
+  // the map border is never expanded, whatever cost it was given since
+  setBorderObstacles();
+
+  if (!incremental_valid_ || goalCell != incremental_goal_) {
+    // start over from the goal
+    for (int i = 0; i < ns; i++) {
+      potarr[i] = POT_HIGH;
+    }
+    resetGradient();
+    rhs_.assign(ns, POT_HIGH);
+    incremental_queue_ = decltype(incremental_queue_)();
+    changed_cells_.clear();
+
+    incremental_valid_ = true;
+    incremental_goal_ = goalCell;
+    rhs_[goalCell] = 0.0;
+    incremental_queue_.push(std::make_pair(0.0f, goalCell));
+  } else {
+    for (int n : changed_cells_) {
+      updateIncrementalCell(n);
+    }
+    changed_cells_.clear();
+  }
+  curPe = nextPe = overPe = 0;
+
+  // every step leaves a consistent state, a canceled propagation resumes from the
+  // queue on the next call for the same goal
+  int nc = 0;  // number of cells settled
+  int nsteps = 0;
+  while (!incremental_queue_.empty() && !pollCancel(nsteps++)) {
+    std::pair<float, int> top = incremental_queue_.top();
+    int n = top.second;
+    if (potarr[n] == rhs_[n] || top.first != std::min(potarr[n], rhs_[n])) {
+      incremental_queue_.pop();
+      continue;  // consistent, or queued again since with another key
+    }
+
+    // check if the start's potential is final
+    if (potarr[startCell] == rhs_[startCell] &&
+      top.first >= potarr[startCell])
+    {
+      break;
+    }
+    incremental_queue_.pop();
+    nc++;
+
+    if (potarr[n] > rhs_[n]) {
+      potarr[n] = rhs_[n];  // lowered, settle it
+    } else {
+      potarr[n] = POT_HIGH;  // raised, let its neighbors give it a new potential
+      updateIncrementalCell(n);
+    }
+    clearGradient(n);
+
+    const int neighbors[4] = {n - 1, n + 1, n - nx, n + nx};
+    for (int m : neighbors) {
+      if (costarr[m] < COST_OBS || potarr[m] < POT_HIGH) {
+        updateIncrementalCell(m);
+      }
+    }
+  }
+
+  expanded_cells_ += nc;
+  last_path_cost_ = potarr[startCell];
+
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("rclcpp"),
+    "[NavFn] Incremental propagation settled %d cells\n", nc);
+
+  return !canceled_ && potarr[startCell] < POT_HIGH;
+}
+
 float NavFn::getLastPathCost()
 {
   return last_path_cost_;
@@ -758,14 +1322,9 @@ NavFn::calcPath(int n, int * st)
   // test write
   // savemap("test");
 
-  // check path arrays
-  if (npathbuf < n) {
-    if (pathx) {delete[] pathx;}
-    if (pathy) {delete[] pathy;}
-    pathx = new float[n];
-    pathy = new float[n];
-    npathbuf = n;
-  }
+  // path arrays keep their storage between calls, and only grow with the path
+  pathx.clear();
+  pathy.clear();
 
   // set up start position at cell
   // st is always upper left corner for 4-point bilinear interpolation
@@ -786,8 +1345,8 @@ NavFn::calcPath(int n, int * st)
         nx * ny - 1, stc + static_cast<int>(round(dx)) +
         static_cast<int>(nx * round(dy))));
     if (potarr[nearest_point] < COST_NEUTRAL) {
-      pathx[npath] = static_cast<float>(goal[0]);
-      pathy[npath] = static_cast<float>(goal[1]);
+      pathx.push_back(static_cast<float>(goal[0]));
+      pathy.push_back(static_cast<float>(goal[1]));
       return ++npath;  // done!
     }
 
@@ -797,8 +1356,8 @@ NavFn::calcPath(int n, int * st)
     }
 
     // add to path
-    pathx[npath] = stc % nx + dx;
-    pathy[npath] = stc / nx + dy;
+    pathx.push_back(stc % nx + dx);
+    pathy.push_back(stc / nx + dy);
     npath++;
 
     bool oscillation_detected = false;
@@ -865,27 +1424,54 @@ NavFn::calcPath(int n, int * st)
       }
     } else {  // have a good gradient here
       // get grad at four positions near cell
-      gradCell(stc);
-      gradCell(stc + 1);
-      gradCell(stcnx);
-      gradCell(stcnx + 1);
+      const float * upper;
+      const float * lower;
+      float block[8];
+      if (cache_gradients_) {
+        gradCell(stc);
+        gradCell(stc + 1);
+        gradCell(stcnx);
+        gradCell(stcnx + 1);
+        upper = &grad[2 * stc];
+        lower = &grad[2 * stcnx];
+      } else {
+        cellGradient(stc, block);
+        cellGradient(stc + 1, block + 2);
+        cellGradient(stcnx, block + 4);
+        cellGradient(stcnx + 1, block + 6);
+        upper = block;
+        lower = block + 4;
+      }
 
 
-      // get interpolated gradient
-      float x1 = (1.0 - dx) * gradx[stc] + dx * gradx[stc + 1];
-      float x2 = (1.0 - dx) * gradx[stcnx] + dx * gradx[stcnx + 1];
-      float x = (1.0 - dy) * x1 + dy * x2;  // interpolated x
-      float y1 = (1.0 - dx) * grady[stc] + dx * grady[stc + 1];
-      float y2 = (1.0 - dx) * grady[stcnx] + dx * grady[stcnx + 1];
-      float y = (1.0 - dy) * y1 + dy * y2;  // interpolated y
+      // get interpolated gradient, the x and y of two neighboring cells are
+      // contiguous in upper and lower, so each row of the block is a single load
+      float x, y;
+#ifdef NAV2_NAVFN_PLANNER_SSE2
+      __m128 upper_row = _mm_loadu_ps(upper);
+      __m128 lower_row = _mm_loadu_ps(lower);
+      __m128 rows = _mm_add_ps(
+        upper_row, _mm_mul_ps(_mm_set1_ps(dy), _mm_sub_ps(lower_row, upper_row)));
+      __m128 right = _mm_movehl_ps(rows, rows);
+      __m128 xy = _mm_add_ps(rows, _mm_mul_ps(_mm_set1_ps(dx), _mm_sub_ps(right, rows)));
+      x = _mm_cvtss_f32(xy);  // interpolated x
+      y = _mm_cvtss_f32(_mm_shuffle_ps(xy, xy, _MM_SHUFFLE(1, 1, 1, 1)));  // interpolated y
+#else
+      float x1 = upper[0] + dy * (lower[0] - upper[0]);
+      float y1 = upper[1] + dy * (lower[1] - upper[1]);
+      float x2 = upper[2] + dy * (lower[2] - upper[2]);
+      float y2 = upper[3] + dy * (lower[3] - upper[3]);
+      x = x1 + dx * (x2 - x1);  // interpolated x
+      y = y1 + dx * (y2 - y1);  // interpolated y
+#endif
 
 #if 0
       // show gradients
       RCLCPP_DEBUG(
         rclcpp::get_logger("rclcpp"),
         "[Path] %0.2f,%0.2f  %0.2f,%0.2f  %0.2f,%0.2f  %0.2f,%0.2f; final x=%.3f, y=%.3f\n",
-        gradx[stc], grady[stc], gradx[stc + 1], grady[stc + 1],
-        gradx[stcnx], grady[stcnx], gradx[stcnx + 1], grady[stcnx + 1],
+        upper[0], upper[1], upper[2], upper[3],
+        lower[0], lower[1], lower[2], lower[3],
         x, y);
 #endif
 
@@ -927,10 +1513,21 @@ NavFn::calcPath(int n, int * st)
 float
 NavFn::gradCell(int n)
 {
-  if (gradx[n] + grady[n] > 0.0) {  // check this cell
+  if (grad_stamp_[n] == grad_epoch_) {  // check this cell
     return 1.0;
   }
 
+  if (n < nx || n > ns - nx) {  // would be out of bounds
+    return 0.0;
+  }
+  grad_stamp_[n] = grad_epoch_;
+  return cellGradient(n, &grad[2 * n]);
+}
+
+float
+NavFn::cellGradient(int n, float * g) const
+{
+  g[0] = g[1] = 0.0;
   if (n < nx || n > ns - nx) {  // would be out of bounds
     return 0.0;
   }
@@ -973,8 +1570,8 @@ NavFn::gradCell(int n)
   float norm = hypot(dx, dy);
   if (norm > 0) {
     norm = 1.0 / norm;
-    gradx[n] = norm * dx;
-    grady[n] = norm * dy;
+    g[0] = norm * dx;
+    g[1] = norm * dy;
   }
   return norm;
 }
@@ -21,13 +21,16 @@
 
 #include "nav2_navfn_planner/navfn_planner.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "builtin_interfaces/msg/duration.hpp"
@@ -63,6 +66,7 @@ NavfnPlanner::configure(
   node_ = parent;
   tf_ = tf;
   name_ = name;
+  costmap_ros_ = costmap_ros;
   costmap_ = costmap_ros->getCostmap();
   global_frame_ = costmap_ros->getGlobalFrameID();
 
@@ -78,11 +82,46 @@ NavfnPlanner::configure(
   node_->get_parameter(name + ".use_astar", use_astar_);
   declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
   node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(
+    node_, name + ".use_bucket_queue", rclcpp::ParameterValue(false));
+  node_->get_parameter(name + ".use_bucket_queue", use_bucket_queue_);
+  declare_parameter_if_not_declared(
+    node_, name + ".use_incremental", rclcpp::ParameterValue(false));
+  node_->get_parameter(name + ".use_incremental", use_incremental_);
+  declare_parameter_if_not_declared(
+    node_, name + ".hierarchical_factor", rclcpp::ParameterValue(0));
+  node_->get_parameter(name + ".hierarchical_factor", hierarchical_factor_);
+  declare_parameter_if_not_declared(
+    node_, name + ".hierarchical_corridor", rclcpp::ParameterValue(1.0));
+  node_->get_parameter(name + ".hierarchical_corridor", hierarchical_corridor_);
+  declare_parameter_if_not_declared(
+    node_, name + ".propagation_threads", rclcpp::ParameterValue(1));
+  int propagation_threads = 1;
+  node_->get_parameter(name + ".propagation_threads", propagation_threads);
+  declare_parameter_if_not_declared(
+    node_, name + ".cancel_check_interval", rclcpp::ParameterValue(100));
+  node_->get_parameter(name + ".cancel_check_interval", cancel_check_interval_);
+  declare_parameter_if_not_declared(
+    node_, name + ".cache_gradients", rclcpp::ParameterValue(true));
+  node_->get_parameter(name + ".cache_gradients", cache_gradients_);
+  propagation_pool_.reset();
+  if (propagation_threads > 1) {
+    propagation_pool_ = std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::PLANNING, propagation_threads);
+  }
 
   // Create a planner based on the new costmap size
   planner_ = std::make_unique<NavFn>(
     costmap_->getSizeInCellsX(),
     costmap_->getSizeInCellsY());
+  planner_->setUseBucketQueue(use_bucket_queue_);
+  planner_->setThreadPool(propagation_pool_.get());
+  planner_->setGradientCaching(cache_gradients_);
+  coarse_planner_.reset();
+  coarse_costs_valid_ = false;
+  planner_costs_valid_ = false;
+  grid_origin_x_ = costmap_->getOriginX();
+  grid_origin_y_ = costmap_->getOriginY();
 }
 
 void
@@ -108,6 +147,8 @@ NavfnPlanner::cleanup()
     node_->get_logger(), "Cleaning up plugin %s of type NavfnPlanner",
     name_.c_str());
   planner_.reset();
+  propagation_pool_.reset();
+  coarse_planner_.reset();
 }
 
 nav_msgs::msg::Path NavfnPlanner::createPlan(
@@ -131,6 +172,144 @@ nav_msgs::msg::Path NavfnPlanner::createPlan(
   return path;
 }
 
+nav_msgs::msg::Path NavfnPlanner::createCancellablePlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  std::function<bool()> cancel_checker)
+{
+  planner_->setCancelChecker(std::move(cancel_checker), cancel_check_interval_);
+  nav_msgs::msg::Path path = createPlan(start, goal);
+  planner_->setCancelChecker(nullptr);
+  if (planner_->isCanceled()) {
+    RCLCPP_DEBUG(node_->get_logger(), "%s: plan canceled", name_.c_str());
+    path.poses.clear();
+  }
+  return path;
+}
+
+nav_msgs::msg::Path NavfnPlanner::createPartialPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  double length)
+{
+  if (hierarchical_factor_ <= 1) {
+    return nav_msgs::msg::Path();
+  }
+
+  // Update planner based on the new costmap size
+  if (isPlannerOutOfDate()) {
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+  }
+
+  // First, so that the cells are those of the grid planned over
+  refreshPlannerCosts();
+  unsigned int mx, my;
+  if (!worldToMap(start.pose.position.x, start.pose.position.y, mx, my)) {
+    return nav_msgs::msg::Path();
+  }
+  int map_start[2] = {static_cast<int>(mx), static_cast<int>(my)};
+  if (!worldToMap(goal.pose.position.x, goal.pose.position.y, mx, my)) {
+    return nav_msgs::msg::Path();
+  }
+  int map_goal[2] = {static_cast<int>(mx), static_cast<int>(my)};
+
+  if (!computeCorridor(map_start, map_goal)) {
+    return nav_msgs::msg::Path();
+  }
+
+  // The coarse path runs from the goal to the robot, its first part is at its end
+  const int factor = hierarchical_factor_;
+  const float * path_x = coarse_planner_->getPathX();
+  const float * path_y = coarse_planner_->getPathY();
+  const double block = factor * costmap_->getResolution();
+  double covered = 0.0;
+  int k = coarse_planner_->getPathLen() - 1;
+  for (; k > 0 && covered < length; --k) {
+    covered += block * std::hypot(path_x[k - 1] - path_x[k], path_y[k - 1] - path_y[k]);
+  }
+  if (covered < length) {
+    return createPlan(start, goal);
+  }
+
+  geometry_msgs::msg::PoseStamped intermediate = goal;
+  mapToWorld(
+    path_x[k] * factor + factor / 2, path_y[k] * factor + factor / 2,
+    intermediate.pose.position.x, intermediate.pose.position.y);
+  return createPlan(start, intermediate);
+}
+
+std::vector<nav_msgs::msg::Path> NavfnPlanner::createPlans(
+  const geometry_msgs::msg::PoseStamped & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals)
+{
+  // Update planner based on the new costmap size
+  if (isPlannerOutOfDate()) {
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+  }
+
+  std::vector<nav_msgs::msg::Path> plans;
+
+  if (!makePlans(start.pose, goals, tolerance_, plans)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: failed to create a plan to any of %zu goals with "
+      "tolerance %.2f.", name_.c_str(), goals.size(), tolerance_);
+  }
+  return plans;
+}
+
+std::vector<double> NavfnPlanner::computeCosts(
+  const geometry_msgs::msg::PoseStamped & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals)
+{
+  // Update planner based on the new costmap size
+  if (isPlannerOutOfDate()) {
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+  }
+
+  std::vector<double> costs(goals.size(), std::numeric_limits<double>::infinity());
+  if (!computePotential(start.pose.position)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: the robot's start position is off the global costmap, "
+      "none of %zu goals can be reached.", name_.c_str(), goals.size());
+    return costs;
+  }
+
+  // The potential grows by COST_NEUTRAL per cell of free space, in meters its
+  // goal value is the length of the path in free space, longer through costs
+  const double to_meters = costmap_->getResolution() / COST_NEUTRAL;
+  for (size_t i = 0; i < goals.size(); ++i) {
+    double potential = getPointPotential(goals[i].pose.position);
+    if (potential >= POT_HIGH) {
+      // Like createPlans, fall back to the closest reachable point within tolerance
+      nav_msgs::msg::Path plan;
+      if (!getPlanToGoal(goals[i].pose, tolerance_, plan) || plan.poses.empty()) {
+        continue;
+      }
+      potential = getPointPotential(plan.poses.back().pose.position);
+    }
+    if (potential < POT_HIGH) {
+      costs[i] = potential * to_meters;
+    }
+  }
+  return costs;
+}
+
+uint64_t
+NavfnPlanner::getExpandedCells() const
+{
+  uint64_t cells = planner_ ? planner_->getExpandedCells() : 0;
+  if (coarse_planner_) {
+    cells += coarse_planner_->getExpandedCells();
+  }
+  return cells;
+}
+
 bool
 NavfnPlanner::isPlannerOutOfDate()
 {
@@ -164,6 +343,9 @@ NavfnPlanner::makePlan(
     node_->get_logger(), "Making plan from (%.2f,%.2f) to (%.2f,%.2f)",
     start.position.x, start.position.y, goal.position.x, goal.position.y);
 
+  // First, so that the cells are those of the grid planned over
+  refreshPlannerCosts();
+
   unsigned int mx, my;
   if (!worldToMap(wx, wy, mx, my)) {
     RCLCPP_WARN(
@@ -174,20 +356,9 @@ NavfnPlanner::makePlan(
     return false;
   }
 
-  // clear the starting cell within the costmap because we know it can't be an obstacle
+  // clear the starting cell because we know it can't be an obstacle
   clearRobotCell(mx, my);
 
-  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
-
-  // make sure to resize the underlying array that Navfn uses
-  planner_->setNavArr(
-    costmap_->getSizeInCellsX(),
-    costmap_->getSizeInCellsY());
-
-  planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
-
-  lock.unlock();
-
   int map_start[2];
   map_start[0] = mx;
   map_start[1] = my;
@@ -210,14 +381,128 @@ NavfnPlanner::makePlan(
   // TODO(orduno): Explain why we are providing 'map_goal' to setStart().
   //               Same for setGoal, seems reversed. Computing backwards?
 
+  if (use_incremental_) {
+    // Seeded at the goal instead, so that the potential stays valid as the robot
+    // moves, and only has to be repaired where the costs changed since
+    planner_->setGoal(map_goal);
+    planner_->setStart(map_start);
+    if (planner_->calcNavFnIncremental() && getIncrementalPlan(goal, plan)) {
+      return true;
+    }
+    if (planner_->isCanceled()) {
+      return false;
+    }
+    // the goal may still be reachable within tolerance, which needs the potential
+    // around it, from a search seeded at the robot
+  }
+
   planner_->setStart(map_goal);
   planner_->setGoal(map_start);
+
+  // Propagate only along the coarse path first, and over the whole map if that
+  // does not reach the goal
+  if (hierarchical_factor_ > 1 && computeCorridor(map_start, map_goal)) {
+    planner_->setPropagationMask(corridor_mask_.data());
+    if (use_astar_) {
+      planner_->calcNavFnAstar();
+    } else {
+      planner_->calcNavFnDijkstra(true);
+    }
+    planner_->setPropagationMask(nullptr);
+
+    if (planner_->isCanceled()) {
+      return false;
+    }
+    if (getPlanToGoal(goal, tolerance, plan)) {
+      return true;
+    }
+    RCLCPP_DEBUG(
+      node_->get_logger(), "No plan inside the coarse path's corridor, planning on the whole map");
+  }
+
   if (use_astar_) {
     planner_->calcNavFnAstar();
   } else {
     planner_->calcNavFnDijkstra(true);
   }
 
+  return !planner_->isCanceled() && getPlanToGoal(goal, tolerance, plan);
+}
+
+bool
+NavfnPlanner::makePlans(
+  const geometry_msgs::msg::Pose & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals, double tolerance,
+  std::vector<nav_msgs::msg::Path> & plans)
+{
+  plans.assign(goals.size(), nav_msgs::msg::Path());
+  for (auto & plan : plans) {
+    plan.header.stamp = node_->now();
+    plan.header.frame_id = global_frame_;
+  }
+
+  RCLCPP_DEBUG(
+    node_->get_logger(), "Making plans from (%.2f,%.2f) to %zu goals",
+    start.position.x, start.position.y, goals.size());
+
+  if (!computePotential(start.position)) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Cannot create a plan: the robot's start position is off the global"
+      " costmap. Planning will always fail, are you sure"
+      " the robot has been properly localized?");
+    return false;
+  }
+
+  // The potential now holds the cost to every reachable cell, so each goal
+  // only needs its path descended from it
+  bool found_any = false;
+  for (size_t i = 0; i < goals.size(); ++i) {
+    unsigned int mx, my;
+    if (!worldToMap(goals[i].pose.position.x, goals[i].pose.position.y, mx, my)) {
+      RCLCPP_WARN(
+        node_->get_logger(),
+        "Goal %zu sent to the planner is off the global costmap."
+        " Planning will always fail to this goal.", i);
+      continue;
+    }
+    if (getPlanToGoal(goals[i].pose, tolerance, plans[i])) {
+      found_any = true;
+    }
+  }
+
+  return found_any;
+}
+
+bool
+NavfnPlanner::computePotential(const geometry_msgs::msg::Point & world_point)
+{
+  // First, so that the cells are those of the grid planned over
+  refreshPlannerCosts();
+
+  unsigned int mx, my;
+  if (!worldToMap(world_point.x, world_point.y, mx, my)) {
+    return false;
+  }
+
+  // clear the starting cell because we know it can't be an obstacle
+  clearRobotCell(mx, my);
+
+  // the wavefront is seeded from the navfn goal, and run over the whole map
+  int map_start[2];
+  map_start[0] = mx;
+  map_start[1] = my;
+  planner_->setGoal(map_start);
+  planner_->calcNavFnDijkstra(false);
+
+  return true;
+}
+
+bool
+NavfnPlanner::getPlanToGoal(
+  const geometry_msgs::msg::Pose & goal, double tolerance,
+  nav_msgs::msg::Path & plan)
+{
   double resolution = costmap_->getResolution();
   geometry_msgs::msg::Pose p, best_pose;
 
@@ -231,23 +516,54 @@ NavfnPlanner::makePlan(
     found_legal = true;
   } else {
     // Goal is not reachable. Trying to find nearest to the goal
-    // reachable point within its tolerance region
-    double best_sdist = std::numeric_limits<double>::max();
-
-    p.position.y = goal.position.y - tolerance;
-    while (p.position.y <= goal.position.y + tolerance) {
-      p.position.x = goal.position.x - tolerance;
-      while (p.position.x <= goal.position.x + tolerance) {
-        potential = getPointPotential(p.position);
-        double sdist = squared_distance(p, goal);
-        if (potential < POT_HIGH && sdist < best_sdist) {
-          best_sdist = sdist;
-          best_pose = p;
-          found_legal = true;
+    // reachable point within its tolerance region, searching the rings of
+    // cells around it from the inside out
+    unsigned int mx, my;
+    if (worldToMap(goal.position.x, goal.position.y, mx, my)) {
+      const int nx = planner_->nx;
+      const int ny = planner_->ny;
+      const int gx = static_cast<int>(mx);
+      const int gy = static_cast<int>(my);
+      const int max_ring = static_cast<int>(tolerance / resolution);
+      double best_sdist = std::numeric_limits<double>::max();
+      int best_x = 0, best_y = 0;
+
+      auto check = [&](int x, int y) {
+          if (x < 0 || y < 0 || x >= nx || y >= ny || planner_->potarr[y * nx + x] >= POT_HIGH) {
+            return;
+          }
+          double wx, wy;
+          mapToWorld(x, y, wx, wy);
+          double sdist = (wx - goal.position.x) * (wx - goal.position.x) +
+            (wy - goal.position.y) * (wy - goal.position.y);
+          if (sdist < best_sdist) {
+            best_sdist = sdist;
+            best_x = x;
+            best_y = y;
+            found_legal = true;
+          }
+        };
+
+      for (int r = 1; r <= max_ring; ++r) {
+        // every cell of this ring, and beyond, is at least this far from the goal
+        double ring_dist = (r - 0.5) * resolution;
+        if (found_legal && ring_dist * ring_dist >= best_sdist) {
+          break;
         }
-        p.position.x += resolution;
+        for (int i = -r; i <= r; ++i) {
+          check(gx + i, gy - r);
+          check(gx + i, gy + r);
+        }
+        for (int j = -r + 1; j < r; ++j) {
+          check(gx - r, gy + j);
+          check(gx + r, gy + j);
+        }
+      }
+
+      if (found_legal) {
+        best_pose = goal;
+        mapToWorld(best_x, best_y, best_pose.position.x, best_pose.position.y);
       }
-      p.position.y += resolution;
     }
   }
 
@@ -317,7 +633,7 @@ NavfnPlanner::getPlanFromPotential(
 
   planner_->setStart(map_goal);
 
-  int path_len = planner_->calcPath(costmap_->getSizeInCellsX() * 4);
+  int path_len = planner_->calcPath(4 * (planner_->nx + planner_->ny));
   if (path_len == 0) {
     return false;
   }
@@ -325,12 +641,46 @@ NavfnPlanner::getPlanFromPotential(
   auto cost = planner_->getLastPathCost();
   RCLCPP_DEBUG(node_->get_logger(), "Path found, %d steps, %f cost\n", path_len, cost);
 
-  // extract the plan
+  // extract the plan, navfn's path runs from the goal to the robot
+  appendPlannerPath(true, plan);
+
+  return !plan.poses.empty();
+}
+
+bool
+NavfnPlanner::getIncrementalPlan(
+  const geometry_msgs::msg::Pose & goal,
+  nav_msgs::msg::Path & plan)
+{
+  // clear the plan, just in case
+  plan.poses.clear();
+
+  int path_len = planner_->calcPath(4 * (planner_->nx + planner_->ny));
+  if (path_len == 0) {
+    return false;
+  }
+
+  RCLCPP_DEBUG(
+    node_->get_logger(), "Incremental path found, %d steps, %f cost\n",
+    path_len, planner_->getLastPathCost());
+
+  // navfn's path already runs from the robot to the goal
+  appendPlannerPath(false, plan);
+  smoothApproachToGoal(goal, plan);
+
+  return true;
+}
+
+void
+NavfnPlanner::appendPlannerPath(bool reverse, nav_msgs::msg::Path & plan)
+{
   float * x = planner_->getPathX();
   float * y = planner_->getPathY();
   int len = planner_->getPathLen();
 
-  for (int i = len - 1; i >= 0; --i) {
+  for (int k = 0; k < len; ++k) {
+    int i = reverse ? len - 1 - k : k;
+
     // convert the plan to world coordinates
     double world_x, world_y;
     mapToWorld(x[i], y[i], world_x, world_y);
@@ -345,8 +695,6 @@ NavfnPlanner::getPlanFromPotential(
     pose.pose.orientation.w = 1.0;
     plan.poses.push_back(pose);
   }
-
-  return !plan.poses.empty();
 }
 
 double
@@ -401,14 +749,12 @@ NavfnPlanner::getPointPotential(const geometry_msgs::msg::Point & world_point)
 bool
 NavfnPlanner::worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my)
 {
-  if (wx < costmap_->getOriginX() || wy < costmap_->getOriginY()) {
+  if (wx < grid_origin_x_ || wy < grid_origin_y_) {
     return false;
   }
 
-  mx = static_cast<int>(
-    std::round((wx - costmap_->getOriginX()) / costmap_->getResolution()));
-  my = static_cast<int>(
-    std::round((wy - costmap_->getOriginY()) / costmap_->getResolution()));
+  mx = static_cast<int>(std::round((wx - grid_origin_x_) / costmap_->getResolution()));
+  my = static_cast<int>(std::round((wy - grid_origin_y_) / costmap_->getResolution()));
 
   if (mx < costmap_->getSizeInCellsX() && my < costmap_->getSizeInCellsY()) {
     return true;
@@ -424,16 +770,213 @@ NavfnPlanner::worldToMap(double wx, double wy, unsigned int & mx, unsigned int &
 void
 NavfnPlanner::mapToWorld(double mx, double my, double & wx, double & wy)
 {
-  wx = costmap_->getOriginX() + mx * costmap_->getResolution();
-  wy = costmap_->getOriginY() + my * costmap_->getResolution();
+  wx = grid_origin_x_ + mx * costmap_->getResolution();
+  wy = grid_origin_y_ + my * costmap_->getResolution();
+}
+
+void
+NavfnPlanner::refreshPlannerCosts()
+{
+  // Read from the published snapshot when there is one, so that planning
+  // never contends with the map update loop for the costmap lock
+  uint64_t sequence = 0;
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot(sequence);
+  if (snapshot &&
+    snapshot->getSizeInCellsX() == costmap_->getSizeInCellsX() &&
+    snapshot->getSizeInCellsY() == costmap_->getSizeInCellsY())
+  {
+    updatePlannerCosts(snapshot, sequence);
+    grid_origin_x_ = snapshot->getOriginX();
+    grid_origin_y_ = snapshot->getOriginY();
+  } else {
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    grid_origin_x_ = costmap_->getOriginX();
+    grid_origin_y_ = costmap_->getOriginY();
+
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+
+    planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+    planner_costs_valid_ = false;
+    coarse_costs_valid_ = false;
+  }
+}
+
+void
+NavfnPlanner::updatePlannerCosts(
+  const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & snapshot, uint64_t sequence)
+{
+  // make sure to resize the underlying array that Navfn uses
+  if (planner_->setNavArr(snapshot->getSizeInCellsX(), snapshot->getSizeInCellsY())) {
+    planner_costs_valid_ = false;
+  }
+
+  unsigned int x0, xn, y0, yn;
+  if (!planner_costs_valid_ ||
+    !costmap_ros_->getChangedBounds(planner_costs_sequence_, sequence, x0, xn, y0, yn))
+  {
+    planner_->setCostmap(snapshot->getCharMap(), true, allow_unknown_);
+    coarse_costs_valid_ = false;
+  } else {
+    if (robot_cell_cleared_) {
+      planner_->setCostmapRegion(
+        snapshot->getCharMap(), robot_cell_x_, robot_cell_x_ + 1,
+        robot_cell_y_, robot_cell_y_ + 1, allow_unknown_);
+      markCoarseDirty(robot_cell_x_, robot_cell_x_ + 1, robot_cell_y_, robot_cell_y_ + 1);
+    }
+    planner_->setCostmapRegion(snapshot->getCharMap(), x0, xn, y0, yn, allow_unknown_);
+    markCoarseDirty(x0, xn, y0, yn);
+  }
+
+  robot_cell_cleared_ = false;
+  planner_costs_valid_ = true;
+  planner_costs_sequence_ = sequence;
 }
 
 void
 NavfnPlanner::clearRobotCell(unsigned int mx, unsigned int my)
 {
-  // TODO(orduno): check usage of this function, might instead be a request to
-  //               world_model / map server
-  costmap_->setCost(mx, my, nav2_costmap_2d::FREE_SPACE);
+  // Only the planner's own copy of the costs is touched, the shared costmap
+  // (and any snapshot of it) stays read-only
+  planner_->setCellCost(my * planner_->nx + mx, COST_NEUTRAL);
+  robot_cell_cleared_ = true;
+  robot_cell_x_ = mx;
+  robot_cell_y_ = my;
+  markCoarseDirty(mx, mx + 1, my, my + 1);
+}
+
+void
+NavfnPlanner::markCoarseDirty(unsigned int x0, unsigned int xn, unsigned int y0, unsigned int yn)
+{
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+  if (coarse_dirty_x0_ >= coarse_dirty_xn_ || coarse_dirty_y0_ >= coarse_dirty_yn_) {
+    coarse_dirty_x0_ = x0;
+    coarse_dirty_xn_ = xn;
+    coarse_dirty_y0_ = y0;
+    coarse_dirty_yn_ = yn;
+    return;
+  }
+  coarse_dirty_x0_ = std::min(coarse_dirty_x0_, x0);
+  coarse_dirty_xn_ = std::max(coarse_dirty_xn_, xn);
+  coarse_dirty_y0_ = std::min(coarse_dirty_y0_, y0);
+  coarse_dirty_yn_ = std::max(coarse_dirty_yn_, yn);
+}
+
+void
+NavfnPlanner::updateCoarseCosts()
+{
+  const int factor = hierarchical_factor_;
+  const int nx = planner_->nx;
+  const int ny = planner_->ny;
+  const int coarse_nx = (nx + factor - 1) / factor;
+  const int coarse_ny = (ny + factor - 1) / factor;
+
+  if (!coarse_planner_) {
+    coarse_planner_ = std::make_unique<NavFn>(coarse_nx, coarse_ny);
+    coarse_planner_->setGradientCaching(cache_gradients_);
+    coarse_costs_valid_ = false;
+  } else if (coarse_planner_->setNavArr(coarse_nx, coarse_ny)) {
+    coarse_costs_valid_ = false;
+  }
+
+  // Only the blocks covering cells translated since the last pooling change
+  int x0 = 0, xn = nx, y0 = 0, yn = ny;
+  if (coarse_costs_valid_) {
+    x0 = coarse_dirty_x0_;
+    xn = std::min(static_cast<int>(coarse_dirty_xn_), nx);
+    y0 = coarse_dirty_y0_;
+    yn = std::min(static_cast<int>(coarse_dirty_yn_), ny);
+  }
+  coarse_dirty_x0_ = coarse_dirty_xn_ = coarse_dirty_y0_ = coarse_dirty_yn_ = 0;
+  coarse_costs_valid_ = true;
+
+  // Max-pool the translated costs, so a coarse cell is as expensive as the
+  // worst cell it covers
+  for (int cy = y0 / factor; cy * factor < yn; ++cy) {
+    for (int cx = x0 / factor; cx * factor < xn; ++cx) {
+      COSTTYPE cost = 0;
+      for (int y = cy * factor; y < std::min((cy + 1) * factor, ny); ++y) {
+        const COSTTYPE * row = planner_->costarr + y * nx;
+        for (int x = cx * factor; x < std::min((cx + 1) * factor, nx); ++x) {
+          cost = std::max(cost, row[x]);
+        }
+      }
+      coarse_planner_->costarr[cy * coarse_nx + cx] = cost;
+    }
+  }
+}
+
+bool
+NavfnPlanner::computeCorridor(const int * map_start, const int * map_goal)
+{
+  updateCoarseCosts();
+
+  const int factor = hierarchical_factor_;
+  const int nx = planner_->nx;
+  const int ny = planner_->ny;
+  const int coarse_nx = coarse_planner_->nx;
+
+  int coarse_start[2] = {map_start[0] / factor, map_start[1] / factor};
+  int coarse_goal[2] = {map_goal[0] / factor, map_goal[1] / factor};
+
+  // The blocks of the robot and of the goal may be pooled into obstacles by
+  // their neighbors, they are cleared for this search only
+  const int start_cell = coarse_start[1] * coarse_nx + coarse_start[0];
+  const int goal_cell = coarse_goal[1] * coarse_nx + coarse_goal[0];
+  const COSTTYPE start_cost = coarse_planner_->costarr[start_cell];
+  const COSTTYPE goal_cost = coarse_planner_->costarr[goal_cell];
+  coarse_planner_->costarr[start_cell] = COST_NEUTRAL;
+  coarse_planner_->costarr[goal_cell] = COST_NEUTRAL;
+
+  // same reversed convention as the full resolution search
+  coarse_planner_->setStart(coarse_goal);
+  coarse_planner_->setGoal(coarse_start);
+  if (use_astar_) {
+    coarse_planner_->calcNavFnAstar();
+  } else {
+    coarse_planner_->calcNavFnDijkstra(true);
+  }
+  int path_len = coarse_planner_->calcPath(4 * (coarse_nx + coarse_planner_->ny));
+
+  coarse_planner_->costarr[start_cell] = start_cost;
+  coarse_planner_->costarr[goal_cell] = goal_cost;
+
+  if (path_len == 0) {
+    RCLCPP_DEBUG(
+      node_->get_logger(), "No coarse path found, planning on the whole map");
+    return false;
+  }
+
+  // Mark the full resolution cells within the corridor width of the coarse path
+  corridor_mask_.assign(static_cast<size_t>(nx) * ny, 0);
+  const int radius = factor / 2 + 1 +
+    static_cast<int>(std::ceil(hierarchical_corridor_ / costmap_->getResolution()));
+  auto mark = [&](int cx, int cy) {
+      const int x0 = std::max(cx - radius, 0);
+      const int xn = std::min(cx + radius + 1, nx);
+      const int yn = std::min(cy + radius + 1, ny);
+      for (int y = std::max(cy - radius, 0); y < yn; ++y) {
+        if (x0 < xn) {
+          memset(&corridor_mask_[y * nx + x0], 1, xn - x0);
+        }
+      }
+    };
+
+  const float * path_x = coarse_planner_->getPathX();
+  const float * path_y = coarse_planner_->getPathY();
+  for (int i = 0; i < path_len; ++i) {
+    mark(
+      static_cast<int>(path_x[i] * factor + factor / 2),
+      static_cast<int>(path_y[i] * factor + factor / 2));
+  }
+  mark(map_start[0], map_start[1]);
+  mark(map_goal[0], map_goal[1]);
+
+  return true;
 }
 
 }  // namespace nav2_navfn_planner
@@ -0,0 +1,339 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_navfn_planner/state_lattice.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace nav2_navfn_planner
+{
+
+namespace
+{
+
+constexpr double TWO_PI = 2.0 * M_PI;
+
+double mod2pi(double angle)
+{
+  angle = std::fmod(angle, TWO_PI);
+  return angle < 0.0 ? angle + TWO_PI : angle;
+}
+
+// Pose after traveling s, backwards if negative, at a curvature from a pose
+LatticePose advance(const LatticePose & pose, double curvature, double s)
+{
+  if (curvature == 0.0) {
+    return {pose.x + s * std::cos(pose.theta), pose.y + s * std::sin(pose.theta), pose.theta};
+  }
+  const double theta = pose.theta + curvature * s;
+  return {
+    pose.x + (std::sin(theta) - std::sin(pose.theta)) / curvature,
+    pose.y + (std::cos(pose.theta) - std::cos(theta)) / curvature,
+    theta};
+}
+
+}  // namespace
+
+StateLattice::StateLattice(
+  const LatticeConfig & config, double resolution, const nav2_util::ProductCache & cache)
+: config_(config), resolution_(resolution)
+{
+  config_.num_headings = std::max(config_.num_headings, 4u);
+  bin_angle_ = TWO_PI / config_.num_headings;
+  cos_.resize(config_.num_headings);
+  sin_.resize(config_.num_headings);
+  for (unsigned int bin = 0; bin < config_.num_headings; ++bin) {
+    cos_[bin] = std::cos(headingAngle(bin));
+    sin_[bin] = std::sin(headingAngle(bin));
+  }
+  buildPrimitives();
+
+  table_half_ = std::max(1, static_cast<int>(std::ceil(config_.heuristic_radius / resolution_)));
+  table_side_ = 2 * table_half_ + 1;
+  const std::size_t states =
+    static_cast<std::size_t>(table_side_) * table_side_ * config_.num_headings;
+
+  const uint64_t key = tableKey();
+  auto product = cache.load("lattice_heuristic_v2", key);
+  if (product && product->sectionCount() == 1 &&
+    product->sectionSize(0) == states * sizeof(float))
+  {
+    table_.resize(states);
+    std::memcpy(table_.data(), product->sectionData(0), states * sizeof(float));
+    table_from_cache_ = true;
+    return;
+  }
+
+  computeTable();
+  cache.store("lattice_heuristic_v2", key, {{table_.data(), table_.size() * sizeof(float)}});
+}
+
+unsigned int StateLattice::headingBin(double theta) const
+{
+  const long bins = static_cast<long>(config_.num_headings);
+  return static_cast<unsigned int>(std::lround(mod2pi(theta) / bin_angle_) % bins);
+}
+
+void StateLattice::buildPrimitives()
+{
+  const unsigned int headings = config_.num_headings;
+  const double radius = config_.turning_radius;
+
+  // The fewest bins an arc turns by for its end to leave the cell it starts in
+  unsigned int bins = 1;
+  while (bins < headings / 4 &&
+    2.0 * radius * std::sin(0.5 * bins * bin_angle_) < M_SQRT2 * resolution_)
+  {
+    ++bins;
+  }
+  // Straight moves are as long as the arcs, so that neither is favored by its length
+  const double length = std::max(radius * bins * bin_angle_, M_SQRT2 * resolution_);
+  const unsigned int samples = static_cast<unsigned int>(std::ceil(length / resolution_));
+
+  primitives_.assign(headings, {});
+  for (unsigned int heading = 0; heading < headings; ++heading) {
+    const LatticePose origin{0.0, 0.0, headingAngle(heading)};
+    for (int direction : {1, -1}) {
+      if (direction < 0 && !config_.allow_reverse) {
+        continue;
+      }
+      for (int turn : {0, 1, -1}) {
+        MotionPrimitive primitive;
+        primitive.length = length;
+        primitive.reverse = direction < 0;
+        primitive.penalty = (turn != 0 ? config_.turn_penalty : 1.0) *
+          (primitive.reverse ? config_.reverse_penalty : 1.0);
+        // Only arcs at the turning radius change the heading by whole bins
+        const double curvature = turn != 0 ? turn / radius : 0.0;
+        const double travel = turn != 0 ? direction * radius * bins * bin_angle_ :
+          direction * length;
+        for (unsigned int i = 1; i <= samples; ++i) {
+          primitive.samples.push_back(advance(origin, curvature, travel * i / samples));
+        }
+        primitive.dx = primitive.samples.back().x;
+        primitive.dy = primitive.samples.back().y;
+        const int end = static_cast<int>(heading) + turn * direction * static_cast<int>(bins);
+        primitive.end_heading = static_cast<unsigned int>(
+          (end + static_cast<int>(headings)) % static_cast<int>(headings));
+        primitives_[heading].push_back(std::move(primitive));
+      }
+    }
+  }
+}
+
+void StateLattice::computeTable()
+{
+  const unsigned int headings = config_.num_headings;
+  const std::size_t states = table_side_ * table_side_ * headings;
+  table_.assign(states, std::numeric_limits<float>::infinity());
+
+  // A move from anywhere in a cell may end in any of the cells its offset square overlaps,
+  // so that the cost of a state is never more than that of the moves reaching any position
+  // of its cell. Keeping a single position per state instead would round some of them away
+  using Entry = std::pair<float, std::size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  const std::size_t origin = (static_cast<std::size_t>(table_half_) * table_side_ + table_half_) *
+    headings;
+  table_[origin] = 0.0f;
+  queue.emplace(0.0f, origin);
+
+  while (!queue.empty()) {
+    const Entry entry = queue.top();
+    queue.pop();
+    const std::size_t state = entry.second;
+    if (entry.first > table_[state]) {
+      continue;
+    }
+    const long cell = static_cast<long>(state / headings);
+    const long cx = cell % static_cast<long>(table_side_);
+    const long cy = cell / static_cast<long>(table_side_);
+    for (const MotionPrimitive & primitive : primitives_[state % headings]) {
+      const double x = cx + primitive.dx / resolution_;
+      const double y = cy + primitive.dy / resolution_;
+      const float cost = entry.first + static_cast<float>(primitive.length * primitive.penalty);
+      for (long nx = static_cast<long>(std::floor(x)); nx <= static_cast<long>(std::ceil(x));
+        ++nx)
+      {
+        for (long ny = static_cast<long>(std::floor(y)); ny <= static_cast<long>(std::ceil(y));
+          ++ny)
+        {
+          if (nx < 0 || ny < 0 || nx >= static_cast<long>(table_side_) ||
+            ny >= static_cast<long>(table_side_))
+          {
+            continue;
+          }
+          const std::size_t next = (ny * table_side_ + nx) * headings + primitive.end_heading;
+          if (cost < table_[next]) {
+            table_[next] = cost;
+            queue.emplace(cost, next);
+          }
+        }
+      }
+    }
+  }
+}
+
+uint64_t StateLattice::tableKey() const
+{
+  const double fields[] = {
+    static_cast<double>(config_.num_headings), config_.turning_radius,
+    config_.allow_reverse ? 1.0 : 0.0, config_.reverse_penalty, config_.turn_penalty,
+    static_cast<double>(table_half_), resolution_};
+  return nav2_util::hashBytes(fields, sizeof(fields));
+}
+
+double StateLattice::heuristic(
+  const LatticePose & from, unsigned int from_heading,
+  const LatticePose & to, unsigned int to_heading) const
+{
+  // The search stops anywhere in the cell of the goal, at most half a diagonal from it
+  const double half_diagonal = 0.5 * M_SQRT2 * resolution_;
+  const double dx = to.x - from.x;
+  const double dy = to.y - from.y;
+  const double distance = std::max(0.0, std::hypot(dx, dy) - half_diagonal);
+
+  // The table is from heading 0, the goal is read in the frame of the start
+  const double rx = cos_[from_heading] * dx + sin_[from_heading] * dy;
+  const double ry = cos_[from_heading] * dy - sin_[from_heading] * dx;
+  const long cx = std::lround(rx / resolution_) + table_half_;
+  const long cy = std::lround(ry / resolution_) + table_half_;
+  if (cx < 1 || cy < 1 || cx + 1 >= static_cast<long>(table_side_) ||
+    cy + 1 >= static_cast<long>(table_side_))
+  {
+    return distance;
+  }
+
+  // Of the cells the goal's may overlap once rotated
+  const unsigned int headings = config_.num_headings;
+  const unsigned int heading = (to_heading + headings - from_heading) % headings;
+  float cost = std::numeric_limits<float>::infinity();
+  for (long y = cy - 1; y <= cy + 1; ++y) {
+    for (long x = cx - 1; x <= cx + 1; ++x) {
+      cost = std::min(cost, table_[(y * table_side_ + x) * headings + heading]);
+    }
+  }
+  // Moves leaving the table go to its edge and back at least
+  const double leaving = 2.0 * table_half_ * resolution_ - std::max(std::fabs(rx), std::fabs(ry));
+  return std::max(std::min(static_cast<double>(cost), leaving), distance);
+}
+
+double dubinsPath(
+  const LatticePose & from, const LatticePose & to, double radius, double step,
+  std::vector<LatticePose> & poses)
+{
+  poses.clear();
+
+  // In the frame of the line between the poses, with lengths in turning radii
+  const double dx = to.x - from.x;
+  const double dy = to.y - from.y;
+  const double d = std::hypot(dx, dy) / radius;
+  const double line = d > 0.0 ? std::atan2(dy, dx) : 0.0;
+  const double a = mod2pi(from.theta - line);
+  const double b = mod2pi(to.theta - line);
+  const double sa = std::sin(a), sb = std::sin(b), ca = std::cos(a), cb = std::cos(b);
+  const double cab = std::cos(a - b);
+
+  // Curvature signs of the three segments of each word
+  enum {LSL = 0, LSR, RSL, RSR, RLR, LRL};
+  static const int turns[6][3] = {
+    {1, 0, 1}, {1, 0, -1}, {-1, 0, 1}, {-1, 0, -1}, {-1, 1, -1}, {1, -1, 1}};
+  double best[3] = {0.0, 0.0, 0.0};
+  double best_length = std::numeric_limits<double>::infinity();
+  int best_word = -1;
+  auto consider = [&](int word, double t, double p, double q) {
+      if (t + p + q < best_length) {
+        best_length = t + p + q;
+        best[0] = t;
+        best[1] = p;
+        best[2] = q;
+        best_word = word;
+      }
+    };
+
+  // Rounding leaves the tangent length of words of touching circles just below zero
+  constexpr double kTolerance = 1e-9;
+  double p_sq = 2.0 + d * d - 2.0 * cab + 2.0 * d * (sa - sb);
+  if (p_sq >= -kTolerance) {
+    p_sq = std::max(p_sq, 0.0);
+    const double tmp = std::atan2(cb - ca, d + sa - sb);
+    consider(LSL, mod2pi(tmp - a), std::sqrt(p_sq), mod2pi(b - tmp));
+  }
+  p_sq = 2.0 + d * d - 2.0 * cab + 2.0 * d * (sb - sa);
+  if (p_sq >= -kTolerance) {
+    p_sq = std::max(p_sq, 0.0);
+    const double tmp = std::atan2(ca - cb, d - sa + sb);
+    consider(RSR, mod2pi(a - tmp), std::sqrt(p_sq), mod2pi(tmp - b));
+  }
+  p_sq = -2.0 + d * d + 2.0 * cab + 2.0 * d * (sa + sb);
+  if (p_sq >= -kTolerance) {
+    p_sq = std::max(p_sq, 0.0);
+    const double p = std::sqrt(p_sq);
+    const double tmp = std::atan2(-ca - cb, d + sa + sb) - std::atan2(-2.0, p);
+    consider(LSR, mod2pi(tmp - a), p, mod2pi(tmp - b));
+  }
+  p_sq = -2.0 + d * d + 2.0 * cab - 2.0 * d * (sa + sb);
+  if (p_sq >= -kTolerance) {
+    p_sq = std::max(p_sq, 0.0);
+    const double p = std::sqrt(p_sq);
+    const double tmp = std::atan2(ca + cb, d - sa - sb) - std::atan2(2.0, p);
+    consider(RSL, mod2pi(a - tmp), p, mod2pi(b - tmp));
+  }
+  double tmp = (6.0 - d * d + 2.0 * cab + 2.0 * d * (sa - sb)) / 8.0;
+  if (std::fabs(tmp) <= 1.0) {
+    const double phi = std::atan2(ca - cb, d - sa + sb);
+    const double p = mod2pi(TWO_PI - std::acos(tmp));
+    const double t = mod2pi(a - phi + mod2pi(0.5 * p));
+    consider(RLR, t, p, mod2pi(a - b - t + p));
+  }
+  tmp = (6.0 - d * d + 2.0 * cab + 2.0 * d * (sb - sa)) / 8.0;
+  if (std::fabs(tmp) <= 1.0) {
+    const double phi = std::atan2(ca - cb, d + sa - sb);
+    const double p = mod2pi(TWO_PI - std::acos(tmp));
+    const double t = mod2pi(-a - phi + 0.5 * p);
+    consider(LRL, t, p, mod2pi(b - a - t + p));
+  }
+  if (best_word < 0) {
+    return best_length;
+  }
+
+  const double length = best_length * radius;
+  const unsigned int samples = std::max(1u, static_cast<unsigned int>(std::ceil(length / step)));
+  poses.reserve(samples);
+  for (unsigned int i = 1; i <= samples; ++i) {
+    double s = length * i / samples;
+    LatticePose pose = from;
+    for (int segment = 0; segment < 3; ++segment) {
+      const double curvature = turns[best_word][segment] / radius;
+      const double segment_length = best[segment] * radius;
+      if (s <= segment_length || segment == 2) {
+        pose = advance(pose, curvature, std::min(s, segment_length));
+        break;
+      }
+      pose = advance(pose, curvature, segment_length);
+      s -= segment_length;
+    }
+    poses.push_back(pose);
+  }
+  return length;
+}
+
+}  // namespace nav2_navfn_planner
@@ -0,0 +1,471 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_navfn_planner/state_lattice_planner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/inflation_layer.hpp"
+#include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "tf2/utils.h"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+
+using nav2_util::declare_parameter_if_not_declared;
+using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_costmap_2d::NO_INFORMATION;
+
+namespace nav2_navfn_planner
+{
+
+StateLatticePlanner::StateLatticePlanner()
+: tf_(nullptr)
+{
+}
+
+StateLatticePlanner::~StateLatticePlanner()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Destroying plugin %s of type StateLatticePlanner",
+    name_.c_str());
+}
+
+void
+StateLatticePlanner::configure(
+  rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+  std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros)
+{
+  node_ = parent;
+  tf_ = tf;
+  name_ = name;
+  costmap_ros_ = costmap_ros;
+  global_frame_ = costmap_ros->getGlobalFrameID();
+
+  RCLCPP_INFO(
+    node_->get_logger(), "Configuring plugin %s of type StateLatticePlanner",
+    name_.c_str());
+
+  declare_parameter_if_not_declared(node_, name + ".num_headings", rclcpp::ParameterValue(72));
+  int num_headings = 72;
+  node_->get_parameter(name + ".num_headings", num_headings);
+  config_.num_headings = static_cast<unsigned int>(std::max(num_headings, 4));
+  declare_parameter_if_not_declared(
+    node_, name + ".turning_radius", rclcpp::ParameterValue(1.0));
+  node_->get_parameter(name + ".turning_radius", config_.turning_radius);
+  declare_parameter_if_not_declared(
+    node_, name + ".allow_reverse", rclcpp::ParameterValue(false));
+  node_->get_parameter(name + ".allow_reverse", config_.allow_reverse);
+  declare_parameter_if_not_declared(
+    node_, name + ".reverse_penalty", rclcpp::ParameterValue(2.0));
+  node_->get_parameter(name + ".reverse_penalty", config_.reverse_penalty);
+  declare_parameter_if_not_declared(
+    node_, name + ".turn_penalty", rclcpp::ParameterValue(1.05));
+  node_->get_parameter(name + ".turn_penalty", config_.turn_penalty);
+  declare_parameter_if_not_declared(
+    node_, name + ".heuristic_table_radius", rclcpp::ParameterValue(5.0));
+  node_->get_parameter(name + ".heuristic_table_radius", config_.heuristic_radius);
+  declare_parameter_if_not_declared(
+    node_, name + ".heuristic_cache_dir", rclcpp::ParameterValue(std::string("")));
+  node_->get_parameter(name + ".heuristic_cache_dir", heuristic_cache_dir_);
+  declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
+  node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(node_, name + ".cost_penalty", rclcpp::ParameterValue(2.0));
+  node_->get_parameter(name + ".cost_penalty", cost_penalty_);
+  declare_parameter_if_not_declared(
+    node_, name + ".max_iterations", rclcpp::ParameterValue(200000));
+  node_->get_parameter(name + ".max_iterations", max_iterations_);
+  declare_parameter_if_not_declared(
+    node_, name + ".analytic_expansion_interval", rclcpp::ParameterValue(10));
+  node_->get_parameter(name + ".analytic_expansion_interval", analytic_expansion_interval_);
+  declare_parameter_if_not_declared(
+    node_, name + ".cancel_check_interval", rclcpp::ParameterValue(1000));
+  node_->get_parameter(name + ".cancel_check_interval", cancel_check_interval_);
+  cancel_check_interval_ = std::max(cancel_check_interval_, 1);
+
+  nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
+  lattice_.reset();
+  updateLattice(costmap->getResolution());
+  navfn_ = std::make_unique<NavFn>(costmap->getSizeInCellsX(), costmap->getSizeInCellsY());
+}
+
+void
+StateLatticePlanner::activate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Activating plugin %s of type StateLatticePlanner",
+    name_.c_str());
+}
+
+void
+StateLatticePlanner::deactivate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Deactivating plugin %s of type StateLatticePlanner",
+    name_.c_str());
+}
+
+void
+StateLatticePlanner::cleanup()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Cleaning up plugin %s of type StateLatticePlanner",
+    name_.c_str());
+  lattice_.reset();
+  navfn_.reset();
+  nodes_ = std::vector<Node>();
+  node_index_ = std::unordered_map<uint64_t, int>();
+}
+
+nav_msgs::msg::Path StateLatticePlanner::createPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal)
+{
+  return createCancellablePlan(start, goal, nullptr);
+}
+
+nav_msgs::msg::Path StateLatticePlanner::createCancellablePlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  std::function<bool()> cancel_checker)
+{
+  nav_msgs::msg::Path path;
+  if (!makePlan(start.pose, goal.pose, cancel_checker, path)) {
+    path.poses.clear();
+    if (cancel_checker && cancel_checker()) {
+      RCLCPP_DEBUG(node_->get_logger(), "%s: plan canceled", name_.c_str());
+    } else {
+      RCLCPP_WARN(node_->get_logger(), "%s: failed to create plan.", name_.c_str());
+    }
+  }
+
+  // The snapshot planned on is not kept alive past the plan
+  costmap_.reset();
+  collision_checker_.setCostmap(nullptr);
+  return path;
+}
+
+void
+StateLatticePlanner::updateLattice(double resolution)
+{
+  if (lattice_ && lattice_->resolution() == resolution) {
+    return;
+  }
+  const auto begin = std::chrono::steady_clock::now();
+  lattice_ = std::make_unique<StateLattice>(
+    config_, resolution, nav2_util::ProductCache(heuristic_cache_dir_));
+  RCLCPP_INFO(
+    node_->get_logger(), "%s: %s the heuristic table of %u headings at %.3f m in %.2f s",
+    name_.c_str(), lattice_->tableFromCache() ? "read" : "computed", config_.num_headings,
+    resolution,
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+}
+
+bool
+StateLatticePlanner::makePlan(
+  const geometry_msgs::msg::Pose & start, const geometry_msgs::msg::Pose & goal,
+  const std::function<bool()> & cancel_checker, nav_msgs::msg::Path & plan)
+{
+  plan.poses.clear();
+  plan.header.stamp = node_->now();
+  plan.header.frame_id = global_frame_;
+
+  costmap_ = costmap_ros_->getCostmapSnapshot();
+  if (!costmap_) {
+    nav2_costmap_2d::Costmap2D * live = costmap_ros_->getCostmap();
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(live->getMutex()));
+    costmap_ = std::make_shared<const nav2_costmap_2d::Costmap2D>(*live);
+  }
+  const nav2_costmap_2d::Costmap2D & costmap = *costmap_;
+  const unsigned int size_x = costmap.getSizeInCellsX();
+  const double resolution = costmap.getResolution();
+  updateLattice(resolution);
+  const unsigned int headings = config_.num_headings;
+
+  unsigned int start_x, start_y, goal_x, goal_y;
+  if (!costmap.worldToMap(start.position.x, start.position.y, start_x, start_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: the robot's start position is off the global costmap.",
+      name_.c_str());
+    return false;
+  }
+  if (!costmap.worldToMap(goal.position.x, goal.position.y, goal_x, goal_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: the goal sent to the planner is off the global costmap.",
+      name_.c_str());
+    return false;
+  }
+
+  // The checker only reads the masks and the snapshot, which is never modified
+  collision_checker_.setCostmap(std::const_pointer_cast<nav2_costmap_2d::Costmap2D>(costmap_));
+  collision_checker_.updateFootprintMasks(costmap_ros_->getRobotFootprint(), headings, false);
+  circumscribed_cost_ = 0;
+  const double circumscribed_radius =
+    costmap_ros_->getLayeredCostmap()->getCircumscribedRadius();
+  for (const auto & plugin : *costmap_ros_->getLayeredCostmap()->getPlugins()) {
+    auto inflation = std::dynamic_pointer_cast<nav2_costmap_2d::InflationLayer>(plugin);
+    if (inflation) {
+      circumscribed_cost_ = inflation->computeCost(circumscribed_radius / resolution);
+      break;
+    }
+  }
+
+  const LatticePose goal_pose{goal.position.x, goal.position.y, tf2::getYaw(goal.orientation)};
+  unsigned char center_cost;
+  if (!poseCost(goal_pose.x, goal_pose.y, goal_pose.theta, center_cost)) {
+    RCLCPP_WARN(node_->get_logger(), "%s: the goal pose collides.", name_.c_str());
+    return false;
+  }
+
+  // Distance to the goal around the obstacles, only propagated as far as the start. The
+  // costs weigh the moves by at most 1 + cost_penalty, far less than NavFn weighs them, so
+  // only the obstacles are propagated through
+  navfn_->setNavArr(size_x, costmap.getSizeInCellsY());
+  navfn_->setCostmap(costmap.getCharMap(), true, allow_unknown_);
+  COSTTYPE * cost = navfn_->costarr;
+  for (COSTTYPE * end = cost + navfn_->ns; cost != end; ++cost) {
+    if (*cost < COST_OBS) {
+      *cost = COST_NEUTRAL;
+    }
+  }
+  const unsigned int start_index = start_y * size_x + start_x;
+  navfn_->setCellCost(start_index, COST_NEUTRAL);
+  int map_goal[2] = {static_cast<int>(goal_x), static_cast<int>(goal_y)};
+  int map_start[2] = {static_cast<int>(start_x), static_cast<int>(start_y)};
+  navfn_->setGoal(map_goal);
+  navfn_->setStart(map_start);
+  navfn_->setCancelChecker(cancel_checker, cancel_check_interval_);
+  navfn_->calcNavFnDijkstra(true);
+  navfn_->setCancelChecker(nullptr);
+  start_potential_ = navfn_->potarr[start_index];
+  if (navfn_->isCanceled() || start_potential_ >= POT_HIGH) {
+    return false;
+  }
+
+  const unsigned int goal_heading = lattice_->headingBin(goal_pose.theta);
+  auto heuristic = [&](const LatticePose & pose, unsigned int heading,
+      unsigned int mx, unsigned int my) {
+      return std::max(
+        lattice_->heuristic(pose, heading, goal_pose, goal_heading),
+        obstacleHeuristic(mx, my));
+    };
+  auto key = [&](unsigned int mx, unsigned int my, unsigned int heading) {
+      return (static_cast<uint64_t>(my) * size_x + mx) * headings + heading;
+    };
+
+  nodes_.clear();
+  node_index_.clear();
+  const unsigned int start_heading = lattice_->headingBin(tf2::getYaw(start.orientation));
+  const LatticePose start_pose{
+    start.position.x, start.position.y, lattice_->headingAngle(start_heading)};
+  nodes_.push_back({start_pose, start_heading, 0.0, -1, -1, false});
+  node_index_.emplace(key(start_x, start_y, start_heading), 0);
+
+  using Entry = std::pair<double, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  open.emplace(heuristic(start_pose, start_heading, start_x, start_y), 0);
+
+  // Costs count for up to cost_penalty times the length moved through them
+  const double cost_scale = cost_penalty_ / (INSCRIBED_INFLATED_OBSTACLE - 1);
+  std::vector<LatticePose> analytic;
+  int iterations = 0;
+  while (!open.empty()) {
+    const int current = open.top().second;
+    open.pop();
+    if (nodes_[current].closed) {
+      continue;
+    }
+    nodes_[current].closed = true;
+    if (++iterations > max_iterations_) {
+      RCLCPP_WARN(
+        node_->get_logger(), "%s: no path found within %d iterations.", name_.c_str(),
+        max_iterations_);
+      return false;
+    }
+    if (cancel_checker && iterations % cancel_check_interval_ == 0 && cancel_checker()) {
+      return false;
+    }
+
+    // A copy, nodes_ grows while the node is expanded
+    const Node node = nodes_[current];
+    unsigned int mx, my;
+    costmap.worldToMap(node.pose.x, node.pose.y, mx, my);
+    if (mx == goal_x && my == goal_y && node.heading == goal_heading) {
+      appendNodes(current, plan);
+      appendPose(goal_pose, plan);
+      RCLCPP_DEBUG(
+        node_->get_logger(), "%s: reached the goal after %d iterations", name_.c_str(),
+        iterations);
+      return true;
+    }
+
+    if (analytic_expansion_interval_ > 0 && (iterations - 1) % analytic_expansion_interval_ == 0 &&
+      std::isfinite(
+        dubinsPath(node.pose, goal_pose, config_.turning_radius, resolution, analytic)))
+    {
+      bool free = true;
+      for (const LatticePose & pose : analytic) {
+        if (!poseCost(pose.x, pose.y, pose.theta, center_cost)) {
+          free = false;
+          break;
+        }
+      }
+      if (free) {
+        appendNodes(current, plan);
+        for (const LatticePose & pose : analytic) {
+          appendPose(pose, plan);
+        }
+        RCLCPP_DEBUG(
+          node_->get_logger(), "%s: connected to the goal after %d iterations", name_.c_str(),
+          iterations);
+        return true;
+      }
+    }
+
+    const std::vector<MotionPrimitive> & primitives = lattice_->primitives(node.heading);
+    for (std::size_t k = 0; k < primitives.size(); ++k) {
+      const MotionPrimitive & primitive = primitives[k];
+      double cost_sum = 0.0;
+      bool free = true;
+      for (const LatticePose & sample : primitive.samples) {
+        if (!poseCost(node.pose.x + sample.x, node.pose.y + sample.y, sample.theta, center_cost)) {
+          free = false;
+          break;
+        }
+        cost_sum += center_cost;
+      }
+      if (!free) {
+        continue;
+      }
+
+      const LatticePose pose{
+        node.pose.x + primitive.dx, node.pose.y + primitive.dy,
+        lattice_->headingAngle(primitive.end_heading)};
+      unsigned int next_x, next_y;
+      costmap.worldToMap(pose.x, pose.y, next_x, next_y);
+      const double g = node.g + primitive.length * primitive.penalty *
+        (1.0 + cost_scale * cost_sum / primitive.samples.size());
+
+      // Poses of the same cell and heading are merged, the last sample is the end of the move
+      const uint64_t next_key = key(next_x, next_y, primitive.end_heading);
+      auto found = node_index_.find(next_key);
+      int next;
+      if (found == node_index_.end()) {
+        next = static_cast<int>(nodes_.size());
+        nodes_.push_back(
+          {pose, primitive.end_heading, g, current, static_cast<int>(k), false});
+        node_index_.emplace(next_key, next);
+      } else {
+        next = found->second;
+        Node & existing = nodes_[next];
+        if (existing.closed || g >= existing.g) {
+          continue;
+        }
+        existing.pose = pose;
+        existing.g = g;
+        existing.parent = current;
+        existing.primitive = static_cast<int>(k);
+      }
+      open.emplace(g + heuristic(pose, primitive.end_heading, next_x, next_y), next);
+    }
+  }
+
+  RCLCPP_WARN(
+    node_->get_logger(), "%s: no path found after %d iterations.", name_.c_str(), iterations);
+  return false;
+}
+
+bool
+StateLatticePlanner::poseCost(
+  double x, double y, double theta, unsigned char & center_cost) const
+{
+  unsigned int mx, my;
+  if (!costmap_->worldToMap(x, y, mx, my)) {
+    return false;
+  }
+  center_cost = costmap_->getCost(mx, my);
+  if (center_cost == NO_INFORMATION) {
+    center_cost = nav2_costmap_2d::FREE_SPACE;
+    return allow_unknown_;
+  }
+  if (center_cost >= INSCRIBED_INFLATED_OBSTACLE) {
+    return false;
+  }
+  if (center_cost < circumscribed_cost_) {
+    return true;
+  }
+  const double cost = collision_checker_.maskCostAtPose(x, y, theta);
+  return cost < LETHAL_OBSTACLE || (allow_unknown_ && cost == NO_INFORMATION);
+}
+
+double
+StateLatticePlanner::obstacleHeuristic(unsigned int mx, unsigned int my) const
+{
+  // Cells the propagation stopped before are at least as far as the start, but for the
+  // width of its priority threshold
+  float potential = navfn_->potarr[my * navfn_->nx + mx];
+  if (potential >= POT_HIGH) {
+    potential = std::max(start_potential_ - navfn_->priInc, 0.0f);
+  }
+  // NavFn's interpolated potential is up to 8% longer than the distance, and the pose and
+  // the goal may be anywhere in their cells
+  const double resolution = costmap_->getResolution();
+  return std::max(potential * resolution / COST_NEUTRAL / 1.08 - 2.0 * resolution, 0.0);
+}
+
+void
+StateLatticePlanner::appendNodes(int node, nav_msgs::msg::Path & plan) const
+{
+  std::vector<int> chain;
+  for (; node >= 0; node = nodes_[node].parent) {
+    chain.push_back(node);
+  }
+  appendPose(nodes_[chain.back()].pose, plan);
+  for (auto it = chain.rbegin() + 1; it != chain.rend(); ++it) {
+    const Node & parent = nodes_[nodes_[*it].parent];
+    const MotionPrimitive & primitive =
+      lattice_->primitives(parent.heading)[nodes_[*it].primitive];
+    for (const LatticePose & sample : primitive.samples) {
+      appendPose({parent.pose.x + sample.x, parent.pose.y + sample.y, sample.theta}, plan);
+    }
+  }
+}
+
+void
+StateLatticePlanner::appendPose(const LatticePose & pose, nav_msgs::msg::Path & plan) const
+{
+  geometry_msgs::msg::PoseStamped stamped;
+  stamped.header = plan.header;
+  stamped.pose.position.x = pose.x;
+  stamped.pose.position.y = pose.y;
+  stamped.pose.position.z = 0.0;
+  stamped.pose.orientation = nav2_util::geometry_utils::orientationAroundZAxis(pose.theta);
+  plan.poses.push_back(stamped);
+}
+
+}  // namespace nav2_navfn_planner
+
+#include "pluginlib/class_list_macros.hpp"
+PLUGINLIB_EXPORT_CLASS(nav2_navfn_planner::StateLatticePlanner, nav2_core::GlobalPlanner)
@@ -0,0 +1,278 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_navfn_planner/jump_point_search.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
+#include "gtest/gtest.h"
+
+using nav2_costmap_2d::FREE_SPACE;
+using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_navfn_planner::JumpPointSearch;
+
+struct Grid
+{
+  unsigned int size_x, size_y;
+  std::vector<unsigned char> costs;
+
+  unsigned char & at(int x, int y) {return costs[y * size_x + x];}
+  unsigned char at(int x, int y) const {return costs[y * size_x + x];}
+};
+
+// Inflate the lethal cells of a grid as the inflation layer does, with a cost decaying
+// exponentially past the inscribed radius
+void inflate(Grid & grid, int radius)
+{
+  const std::vector<unsigned char> lethal = grid.costs;
+  for (int y = 0; y < static_cast<int>(grid.size_y); ++y) {
+    for (int x = 0; x < static_cast<int>(grid.size_x); ++x) {
+      if (lethal[y * grid.size_x + x] != LETHAL_OBSTACLE) {
+        continue;
+      }
+      for (int j = std::max(0, y - radius); j <= std::min<int>(grid.size_y - 1, y + radius); ++j) {
+        for (int i = std::max(0, x - radius); i <= std::min<int>(grid.size_x - 1, x + radius);
+          ++i)
+        {
+          const double distance = std::hypot(i - x, j - y);
+          if (distance > radius) {
+            continue;
+          }
+          unsigned char cost = LETHAL_OBSTACLE;
+          if (distance > 0.0) {
+            cost = distance <= 1.0 ? INSCRIBED_INFLATED_OBSTACLE :
+              static_cast<unsigned char>(
+              (INSCRIBED_INFLATED_OBSTACLE - 1) * std::exp(-0.5 * (distance - 1.0)));
+          }
+          grid.at(i, j) = std::max(grid.at(i, j), cost);
+        }
+      }
+    }
+  }
+}
+
+// Round obstacles of random sizes scattered over the grid
+Grid blobs(unsigned int seed, unsigned int size)
+{
+  Grid grid{size, size, std::vector<unsigned char>(size * size, FREE_SPACE)};
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> position(0, size - 1);
+  std::uniform_int_distribution<int> radius(1, 8);
+  for (unsigned int n = 0; n < size * size / 800; ++n) {
+    const int cx = position(rng);
+    const int cy = position(rng);
+    const int r = radius(rng);
+    for (int y = std::max(0, cy - r); y <= std::min<int>(size - 1, cy + r); ++y) {
+      for (int x = std::max(0, cx - r); x <= std::min<int>(size - 1, cx + r); ++x) {
+        if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r) {
+          grid.at(x, y) = LETHAL_OBSTACLE;
+        }
+      }
+    }
+  }
+  inflate(grid, 10);
+  return grid;
+}
+
+// Rows of shelves with gaps, as in a warehouse
+Grid shelves(unsigned int size)
+{
+  Grid grid{size, size, std::vector<unsigned char>(size * size, FREE_SPACE)};
+  for (unsigned int y = 12; y + 12 < size; y += 16) {
+    for (unsigned int x = 10; x + 10 < size; ++x) {
+      if ((x / 30) % 3 != 2) {
+        grid.at(x, y) = LETHAL_OBSTACLE;
+        grid.at(x, y + 1) = LETHAL_OBSTACLE;
+      }
+    }
+  }
+  inflate(grid, 6);
+  return grid;
+}
+
+bool passable(const Grid & grid, int x, int y)
+{
+  return grid.at(x, y) < INSCRIBED_INFLATED_OBSTACLE;
+}
+
+// Plain weighted A* over the 8-connected cells, moving into a cell of cost c costing its
+// length times 1 + COST_FACTOR * c / COST_NEUTRAL and never cutting impassable corners,
+// as the jump point search weighs moves
+double referenceCost(const Grid & grid, int sx, int sy, int gx, int gy)
+{
+  const int size_x = grid.size_x;
+  std::vector<double> g(grid.costs.size(), std::numeric_limits<double>::infinity());
+  using Entry = std::pair<double, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  g[sy * size_x + sx] = 0.0;
+  open.emplace(0.0, sy * size_x + sx);
+  while (!open.empty()) {
+    const double f = open.top().first;
+    const int index = open.top().second;
+    open.pop();
+    const int x = index % size_x;
+    const int y = index / size_x;
+    if (x == gx && y == gy) {
+      return g[index];
+    }
+    const int ax = std::abs(gx - x);
+    const int ay = std::abs(gy - y);
+    if (f > g[index] + std::max(ax, ay) - std::min(ax, ay) + M_SQRT2 * std::min(ax, ay) + 1e-9) {
+      continue;
+    }
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        const int nx = x + dx;
+        const int ny = y + dy;
+        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= size_x ||
+          ny >= static_cast<int>(grid.size_y) || !passable(grid, nx, ny))
+        {
+          continue;
+        }
+        if (dx != 0 && dy != 0 && (!passable(grid, x + dx, y) || !passable(grid, x, y + dy))) {
+          continue;
+        }
+        const double length = (dx != 0 && dy != 0) ? M_SQRT2 : 1.0;
+        const double next_g = g[index] +
+          length * (1.0 + COST_FACTOR * grid.at(nx, ny) / COST_NEUTRAL);
+        const int next = ny * size_x + nx;
+        if (next_g < g[next]) {
+          g[next] = next_g;
+          const int bx = std::abs(gx - nx);
+          const int by = std::abs(gy - ny);
+          open.emplace(
+            next_g + std::max(bx, by) - std::min(bx, by) + M_SQRT2 * std::min(bx, by), next);
+        }
+      }
+    }
+  }
+  return -1.0;
+}
+
+// Cost of a path of adjacent cells, weighed as the reference does
+double pathCost(const Grid & grid, const std::vector<JumpPointSearch::Cell> & path)
+{
+  double cost = 0.0;
+  for (std::size_t i = 1; i < path.size(); ++i) {
+    const int dx = static_cast<int>(path[i].first) - static_cast<int>(path[i - 1].first);
+    const int dy = static_cast<int>(path[i].second) - static_cast<int>(path[i - 1].second);
+    EXPECT_TRUE(std::abs(dx) <= 1 && std::abs(dy) <= 1 && (dx != 0 || dy != 0));
+    EXPECT_TRUE(passable(grid, path[i].first, path[i].second));
+    const double length = (dx != 0 && dy != 0) ? M_SQRT2 : 1.0;
+    cost += length * (1.0 + COST_FACTOR * grid.at(path[i].first, path[i].second) / COST_NEUTRAL);
+  }
+  return cost;
+}
+
+// Search random queries of a grid, half of their goals inside the inflation, and check
+// the paths found cost what the reference A* finds
+void compareWithReference(const Grid & grid, unsigned int seed, int queries)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> px(0, grid.size_x - 1);
+  std::uniform_int_distribution<int> py(0, grid.size_y - 1);
+  auto randomCell = [&](bool inflated) {
+      while (true) {
+        const int x = px(rng);
+        const int y = py(rng);
+        if (passable(grid, x, y) && (grid.at(x, y) != FREE_SPACE) == inflated) {
+          return JumpPointSearch::Cell(x, y);
+        }
+      }
+    };
+
+  JumpPointSearch search;
+  search.setCostmap(grid.costs.data(), grid.size_x, grid.size_y, false);
+  std::vector<JumpPointSearch::Cell> path;
+  for (int query = 0; query < queries; ++query) {
+    const JumpPointSearch::Cell start = randomCell(false);
+    const JumpPointSearch::Cell goal = randomCell(query % 2 == 1);
+    const double expected = referenceCost(
+      grid, start.first, start.second, goal.first, goal.second);
+    const bool found = search.search(start, goal, path);
+    ASSERT_EQ(found, expected >= 0.0) << "seed " << seed << " query " << query;
+    if (!found) {
+      continue;
+    }
+    ASSERT_FALSE(path.empty());
+    EXPECT_EQ(path.front(), start);
+    EXPECT_EQ(path.back(), goal);
+    EXPECT_NEAR(pathCost(grid, path), search.pathCost(), 1e-3 * expected);
+    EXPECT_NEAR(search.pathCost(), expected, 1e-3 * expected) <<
+      "seed " << seed << " query " << query << " from (" << start.first << ", " <<
+      start.second << ") to (" << goal.first << ", " << goal.second << ")";
+  }
+}
+
+TEST(JumpPointSearch, OpenSpaceIsCrossedInFewExpansions)
+{
+  Grid grid{200, 200, std::vector<unsigned char>(200 * 200, FREE_SPACE)};
+  JumpPointSearch search;
+  search.setCostmap(grid.costs.data(), grid.size_x, grid.size_y, false);
+  std::vector<JumpPointSearch::Cell> path;
+  ASSERT_TRUE(search.search({10, 20}, {180, 120}, path));
+  EXPECT_NEAR(search.pathCost(), 70.0 + 100.0 * M_SQRT2, 1e-3);
+  EXPECT_EQ(path.size(), 171u);
+  EXPECT_LT(search.expansions(), 10u);
+}
+
+TEST(JumpPointSearch, BlockedGoalIsNotFound)
+{
+  Grid grid{50, 50, std::vector<unsigned char>(50 * 50, FREE_SPACE)};
+  for (int y = 0; y < 50; ++y) {
+    grid.at(25, y) = LETHAL_OBSTACLE;
+  }
+  JumpPointSearch search;
+  search.setCostmap(grid.costs.data(), grid.size_x, grid.size_y, false);
+  std::vector<JumpPointSearch::Cell> path;
+  EXPECT_FALSE(search.search({5, 5}, {45, 45}, path));
+  EXPECT_FALSE(search.search({5, 5}, {25, 10}, path));
+  EXPECT_TRUE(path.empty());
+}
+
+TEST(JumpPointSearch, MatchesWeightedAStarAmongBlobs)
+{
+  for (unsigned int seed = 0; seed < 8; ++seed) {
+    compareWithReference(blobs(seed, 200), seed, 20);
+  }
+}
+
+TEST(JumpPointSearch, MatchesWeightedAStarBetweenShelves)
+{
+  compareWithReference(shelves(200), 1, 60);
+}
+
+TEST(JumpPointSearch, ReachesGoalsDeepInInflation)
+{
+  // A goal right next to an obstacle, reached across a wide inflated band
+  Grid grid{120, 120, std::vector<unsigned char>(120 * 120, FREE_SPACE)};
+  for (int x = 20; x < 100; ++x) {
+    grid.at(x, 60) = LETHAL_OBSTACLE;
+  }
+  inflate(grid, 10);
+  JumpPointSearch search;
+  search.setCostmap(grid.costs.data(), grid.size_x, grid.size_y, false);
+  std::vector<JumpPointSearch::Cell> path;
+  ASSERT_TRUE(search.search({5, 100}, {60, 62}, path));
+  EXPECT_NEAR(search.pathCost(), referenceCost(grid, 5, 100, 60, 62), 1e-3 * search.pathCost());
+}
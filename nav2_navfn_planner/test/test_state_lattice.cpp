@@ -0,0 +1,156 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "nav2_navfn_planner/state_lattice.hpp"
+#include "gtest/gtest.h"
+
+using nav2_navfn_planner::LatticeConfig;
+using nav2_navfn_planner::LatticePose;
+using nav2_navfn_planner::MotionPrimitive;
+using nav2_navfn_planner::StateLattice;
+using nav2_navfn_planner::dubinsPath;
+
+double angleDifference(double a, double b)
+{
+  return std::fabs(std::remainder(a - b, 2.0 * M_PI));
+}
+
+TEST(DubinsPath, EndsOnTheGoalPose)
+{
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> position(-4.0, 4.0);
+  std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+  std::vector<LatticePose> poses;
+  for (int i = 0; i < 500; ++i) {
+    const LatticePose from{position(rng), position(rng), angle(rng)};
+    const LatticePose to{position(rng), position(rng), angle(rng)};
+    const double radius = 0.5 + (i % 4) * 0.5;
+    const double length = dubinsPath(from, to, radius, 0.05, poses);
+    ASSERT_TRUE(std::isfinite(length));
+    ASSERT_FALSE(poses.empty());
+    EXPECT_NEAR(poses.back().x, to.x, 1e-6);
+    EXPECT_NEAR(poses.back().y, to.y, 1e-6);
+    EXPECT_NEAR(angleDifference(poses.back().theta, to.theta), 0.0, 1e-6);
+    EXPECT_GE(length, std::hypot(to.x - from.x, to.y - from.y) - 1e-9);
+
+    // Samples at most a step apart, along a path no longer than its length
+    double traveled = std::hypot(poses.front().x - from.x, poses.front().y - from.y);
+    EXPECT_LE(traveled, 0.05 + 1e-9);
+    for (std::size_t k = 1; k < poses.size(); ++k) {
+      const double step = std::hypot(poses[k].x - poses[k - 1].x, poses[k].y - poses[k - 1].y);
+      EXPECT_LE(step, 0.05 + 1e-9);
+      traveled += step;
+    }
+    EXPECT_LE(traveled, length + 1e-6);
+  }
+}
+
+TEST(DubinsPath, KnownLengths)
+{
+  std::vector<LatticePose> poses;
+  // Straight ahead
+  EXPECT_NEAR(dubinsPath({0.0, 0.0, 0.0}, {3.0, 0.0, 0.0}, 1.0, 0.1, poses), 3.0, 1e-9);
+  // A half turn to the left onto the parallel line two radii away
+  EXPECT_NEAR(dubinsPath({0.0, 0.0, 0.0}, {0.0, 2.0, M_PI}, 1.0, 0.1, poses), M_PI, 1e-9);
+  // A quarter turn to the right
+  EXPECT_NEAR(
+    dubinsPath({0.0, 0.0, 0.0}, {2.0, -2.0, -M_PI_2}, 2.0, 0.1, poses), M_PI, 1e-9);
+}
+
+// Chain random moves from the origin and check the table never costs more than the moves
+void checkHeuristic(const LatticeConfig & config, double resolution, unsigned int seed)
+{
+  StateLattice lattice(config, resolution);
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<unsigned int> start_heading(0, config.num_headings - 1);
+  for (int walk = 0; walk < 200; ++walk) {
+    const unsigned int from_heading = start_heading(rng);
+    const LatticePose from{1.0, -2.0, lattice.headingAngle(from_heading)};
+    LatticePose pose = from;
+    unsigned int heading = from_heading;
+    double cost = 0.0;
+    for (int move = 0; move < 12; ++move) {
+      const std::vector<MotionPrimitive> & primitives = lattice.primitives(heading);
+      std::uniform_int_distribution<std::size_t> pick(0, primitives.size() - 1);
+      const MotionPrimitive & primitive = primitives[pick(rng)];
+      pose = {pose.x + primitive.dx, pose.y + primitive.dy,
+        lattice.headingAngle(primitive.end_heading)};
+      heading = primitive.end_heading;
+      cost += primitive.length * primitive.penalty;
+
+      const double h = lattice.heuristic(from, from_heading, pose, heading);
+      EXPECT_LE(h, cost + 1e-4) << "walk " << walk << " move " << move;
+      // The search stops anywhere in the cell of the goal
+      EXPECT_GE(h, std::hypot(pose.x - from.x, pose.y - from.y) - M_SQRT1_2 * resolution - 1e-9);
+    }
+  }
+}
+
+TEST(StateLattice, HeuristicNeverExceedsTheMoves)
+{
+  LatticeConfig config;
+  config.num_headings = 16;
+  config.turning_radius = 0.6;
+  config.heuristic_radius = 2.0;
+  checkHeuristic(config, 0.1, 1);
+
+  config.allow_reverse = true;
+  checkHeuristic(config, 0.1, 2);
+
+  config.num_headings = 72;
+  config.turning_radius = 1.0;
+  config.heuristic_radius = 1.5;
+  checkHeuristic(config, 0.05, 3);
+}
+
+TEST(StateLattice, HeuristicCountsTheTurns)
+{
+  LatticeConfig config;
+  config.num_headings = 16;
+  config.turning_radius = 0.6;
+  config.heuristic_radius = 2.0;
+  StateLattice lattice(config, 0.1);
+
+  // Straight ahead costs about the distance, while a pose just behind takes a loop
+  const LatticePose from{0.0, 0.0, 0.0};
+  EXPECT_NEAR(lattice.heuristic(from, 0, {1.0, 0.0, 0.0}, 0), 1.0, 0.15);
+  EXPECT_GT(lattice.heuristic(from, 0, {-0.3, 0.0, 0.0}, 0), 2.0 * M_PI * 0.6 * 0.5);
+  EXPECT_GT(lattice.heuristic(from, 0, {0.0, 0.0, M_PI}, 8), M_PI * 0.6 * 0.5);
+}
+
+TEST(StateLattice, PrimitivesFromEveryHeadingAreRotations)
+{
+  LatticeConfig config;
+  config.num_headings = 16;
+  config.allow_reverse = true;
+  StateLattice lattice(config, 0.05);
+  const std::vector<MotionPrimitive> & base = lattice.primitives(0);
+  for (unsigned int heading = 0; heading < config.num_headings; ++heading) {
+    const std::vector<MotionPrimitive> & primitives = lattice.primitives(heading);
+    ASSERT_EQ(primitives.size(), base.size());
+    const double angle = lattice.headingAngle(heading);
+    for (std::size_t k = 0; k < base.size(); ++k) {
+      EXPECT_NEAR(
+        primitives[k].dx, std::cos(angle) * base[k].dx - std::sin(angle) * base[k].dy, 1e-9);
+      EXPECT_NEAR(
+        primitives[k].dy, std::sin(angle) * base[k].dx + std::cos(angle) * base[k].dy, 1e-9);
+      EXPECT_EQ(
+        primitives[k].end_heading, (base[k].end_heading + heading) % config.num_headings);
+    }
+  }
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_PLANNER__PATH_SHORTENER_HPP_
+#define NAV2_PLANNER__PATH_SHORTENER_HPP_
+
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_planner
+{
+
+/**
+ * @brief Replace the grid moves of a path by straight lines between some of its poses,
+ * in the manner of an any-angle planner, and resample the lines
+ *
+ * From every pose kept, the path is followed to the furthest pose in line of sight, found
+ * by doubling the distance along the path and then bisecting, so that only a few lines
+ * are traced per pose kept. A line is in sight when no cell it crosses costs more than
+ * the more expensive of its two ends, or is inscribed in an obstacle, and it only crosses
+ * unknown space where the path did.
+ * @param path Path in the frame of the costmap
+ * @param costmap Costmap the path was planned on
+ * @param spacing Largest distance between the poses of the result (m), 0 for only the
+ * ends of the lines
+ * @return The shortened path, or the same path when a pose is off the costmap. Poses
+ * are oriented along their line, except for the last which keeps the goal orientation
+ */
+nav_msgs::msg::Path shortenPath(
+  const nav_msgs::msg::Path & path, const nav2_costmap_2d::Costmap2D & costmap, double spacing);
+
+}  // namespace nav2_planner
+
+#endif  // NAV2_PLANNER__PATH_SHORTENER_HPP_
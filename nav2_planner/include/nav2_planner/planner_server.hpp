@@ -15,9 +15,17 @@
 #ifndef NAV2_PLANNER__PLANNER_SERVER_HPP_
 #define NAV2_PLANNER__PLANNER_SERVER_HPP_
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <future>
+#include <list>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -26,9 +34,13 @@
 #include "nav_msgs/msg/path.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/compute_path_to_pose.hpp"
+#include "nav2_msgs/action/compute_paths_to_poses.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "nav2_util/simple_action_server.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
+#include "nav2_util/timing_diagnostics.hpp"
+#include "rclcpp_action/rclcpp_action.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
@@ -49,8 +61,9 @@ class PlannerServer : public nav2_util::LifecycleNode
 public:
   /**
    * @brief A constructor for nav2_planner::PlannerServer
+   * @param options Additional options to control creation of the node.
    */
-  PlannerServer();
+  explicit PlannerServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_planner::PlannerServer
    */
@@ -62,11 +75,51 @@ public:
    * @brief Method to get plan from the desired plugin
    * @param start starting pose
    * @param goal goal request
-   * @return Path
+   * @param cancel_checker Returns true once the plan is no longer wanted, may be empty
+   * @return Path, empty if canceled
    */
   nav_msgs::msg::Path getPlan(
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id,
+    const std::function<bool()> & cancel_checker = nullptr);
+
+  /**
+   * @brief Method to get the first part of a plan from the desired plugin, planning the
+   * whole plan in the background for the next request to the same goal
+   * @param start starting pose
+   * @param goal goal request
+   * @param planner_id Name of the planner
+   * @param cancel_checker Returns true once the whole plan is no longer wanted, may be empty
+   * @return The first part of the path, or the whole path when it's ready or the plugin
+   * has no partial plans
+   */
+  nav_msgs::msg::Path getPartialPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id,
+    const std::function<bool()> & cancel_checker = nullptr);
+
+  /**
+   * @brief Method to get plans to several goals from the desired plugin
+   * @param start starting pose
+   * @param goals goal requests
+   * @return One path per goal, empty for the goals no path was found to
+   */
+  std::vector<nav_msgs::msg::Path> getPlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+    const std::string & planner_id);
+
+  /**
+   * @brief Method to get the costs of reaching several goals from the desired plugin
+   * @param start starting pose
+   * @param goals goal requests
+   * @return One cost per goal, infinity for the goals that can't be reached
+   */
+  std::vector<double> getCosts(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals,
     const std::string & planner_id);
 
 protected:
@@ -107,11 +160,172 @@ protected:
   // Our action server implements the ComputePathToPose action
   std::unique_ptr<ActionServer> action_server_;
 
+  using ActionPlansT = nav2_msgs::action::ComputePathsToPoses;
+  using ActionPlansServer = nav2_util::SimpleActionServer<ActionPlansT>;
+
+  // Our second action server implements the ComputePathsToPoses action
+  std::unique_ptr<ActionPlansServer> action_server_plans_;
+
+  using ConcurrentGoalHandle = rclcpp_action::ServerGoalHandle<ActionT>;
+
+  // Optional server that plans several ComputePathToPose goals at once. Goals
+  // never preempt each other, each one is answered under its own goal ID
+  rclcpp_action::Server<ActionT>::SharedPtr concurrent_action_server_;
+
   /**
    * @brief The action server callback which calls planner to get the path
    */
   void computePlan();
 
+  /**
+   * @brief Start the workers and their planner instances for concurrent planning
+   * @param node Node the planner instances are configured with
+   */
+  void startConcurrentWorkers(const nav2_util::LifecycleNode::SharedPtr & node);
+
+  /**
+   * @brief Stop and join the concurrent planning workers, aborting queued goals
+   */
+  void stopConcurrentWorkers();
+
+  /**
+   * @brief Abort all goals waiting for a concurrent planning worker
+   */
+  void abortQueuedGoals();
+
+  /**
+   * @brief Worker loop taking goals off the concurrent queue
+   * @param index Index of the planner instances owned by this worker
+   */
+  void concurrentWorker(size_t index);
+
+  /**
+   * @brief Plan one concurrent goal with the planner instances of a worker
+   * @param handle Goal to plan for
+   * @param planners Planner instances owned by the calling worker
+   */
+  void computePlanConcurrent(
+    const std::shared_ptr<ConcurrentGoalHandle> & handle,
+    const PlannerMap & planners);
+
+  /**
+   * @brief The action server callback which calls planner to get paths to several goals
+   */
+  void computePlans();
+
+  /**
+   * @brief Find the plugin a request asked for
+   * @param planner_id Name of the planner, may be empty when there is only one
+   * @return The planner, or nullptr if there is no such planner
+   */
+  nav2_core::GlobalPlanner::Ptr findPlanner(const std::string & planner_id);
+
+  /**
+   * @brief Find the plugin a request asked for among a set of planner instances
+   * @param planners Planner instances to search
+   * @param planner_id Name of the planner, may be empty when there is only one
+   * @return The planner, or nullptr if there is no such planner
+   */
+  nav2_core::GlobalPlanner::Ptr findPlanner(
+    const PlannerMap & planners, const std::string & planner_id);
+
+  /**
+   * @brief Whether a request asks for a race between the racing planners
+   * @param planner_id Name of the planner requested
+   */
+  bool isRacing(const std::string & planner_id) const;
+
+  /**
+   * @brief Run the racing planners at the same time on the shared task scheduler, and
+   * return the first valid path no longer than racing_max_length_ratio times the distance
+   * between start and goal, canceling the others. When none is that short, the shortest
+   * valid path once they are all done
+   * @param start starting pose
+   * @param goal goal pose
+   * @param cancel_checker Returns true once the plan is no longer wanted, may be empty
+   * @return Path, empty if no planner found a valid one or the race was canceled
+   */
+  nav_msgs::msg::Path racePlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::function<bool()> & cancel_checker);
+
+  /**
+   * @brief Check a path of a racing planner against a costmap
+   * @param path Path to check
+   * @param costmap Costmap the race was started on
+   * @param length Output, the length of the path (m)
+   * @return false if the path is empty, not in the costmap's frame, or crosses a cell
+   * off the costmap or lethal after its start
+   */
+  bool checkRacePlan(
+    const nav_msgs::msg::Path & path, const nav2_costmap_2d::Costmap2D & costmap,
+    double & length) const;
+
+  /**
+   * @brief Look up a path planned before between the same cells that is still valid
+   * @param start starting pose
+   * @param goal goal pose
+   * @param planner_id Name of the planner
+   * @param path Output, the cached path
+   * @return true if a cached path was found
+   */
+  bool getCachedPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id,
+    nav_msgs::msg::Path & path);
+
+  /**
+   * @brief Store a new path in the plan cache, evicting the least recently used one
+   * @param start starting pose
+   * @param goal goal pose
+   * @param planner_id Name of the planner
+   * @param path The path found
+   * @param snapshot Costmap snapshot taken before planning the path
+   * @param sequence Sequence number of the snapshot
+   */
+  void cachePlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id,
+    const nav_msgs::msg::Path & path,
+    const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & snapshot,
+    uint64_t sequence);
+
+  /**
+   * @brief Histogram the calls of a planner are timed in, null when not timing
+   * @param planner_id Requested planner, empty for the only one
+   * @param call Planner method timed
+   */
+  nav2_util::TimingHistogram * plannerTiming(const std::string & planner_id, const char * call);
+
+  /**
+   * @brief Shorten a path into straight lines at path_spacing when shorten_paths is set
+   * @param path Path to shorten in place
+   */
+  void shortenPlan(nav_msgs::msg::Path & path);
+
+  /**
+   * @brief Keep the inputs and result of a plan for snapshots, and save one if it took
+   * longer than the snapshot budget
+   * @param costmap Costmap snapshot the plan was made on
+   * @param duration Seconds the planner took
+   */
+  void recordPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id,
+    const nav_msgs::msg::Path & path,
+    const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & costmap,
+    double duration);
+
+  /**
+   * @brief Add the last plan recorded to a snapshot, for planner_replay
+   * @return false if no plan was made yet
+   */
+  bool fillSnapshot(nav2_util::SnapshotWriter & writer);
+
   /**
    * @brief Publish a path for visualization purposes
    * @param path Reference to Global Path
@@ -128,6 +342,74 @@ protected:
   double max_planner_duration_;
   std::string planner_ids_concat_;
 
+  // Planning times of each planner, published as diagnostics
+  double diagnostics_period_;
+  std::shared_ptr<nav2_util::TimingStats> timing_stats_;
+  std::unique_ptr<nav2_util::TimingDiagnostics> timing_diagnostics_;
+
+  // Both action servers run their goals on their own threads, and planner
+  // plugins are not required to be reentrant
+  std::mutex planner_mutex_;
+
+  // Snapshots of the last plan, on demand or when a plan runs over its budget
+  struct LastPlan
+  {
+    geometry_msgs::msg::PoseStamped start, goal;
+    std::string planner_id;
+    nav_msgs::msg::Path path;
+    std::shared_ptr<const nav2_costmap_2d::Costmap2D> costmap;
+    double duration;
+  };
+  std::unique_ptr<nav2_util::SnapshotRecorder> snapshot_recorder_;
+  LastPlan last_plan_;
+  std::mutex last_plan_mutex_;
+
+  // Plan cache, most recently used path first
+  struct CachedPlan
+  {
+    std::string planner_id;
+    unsigned int start_x, start_y, goal_x, goal_y;
+    nav_msgs::msg::Path path;
+    // Costmap cells under the path, the costs they had and their bounds
+    std::vector<unsigned int> cells;
+    std::vector<unsigned char> costs;
+    unsigned int x0, xn, y0, yn;
+    // Sequence number of the costmap snapshot the costs were checked against
+    uint64_t sequence;
+  };
+  int plan_cache_size_;
+  std::list<CachedPlan> plan_cache_;
+
+  // Partial plans, the whole plan after a partial one is planned in the background
+  // and handed to the next request for the same goal
+  double partial_plan_length_;
+  std::future<nav_msgs::msg::Path> refinement_;
+  geometry_msgs::msg::PoseStamped refinement_goal_;
+  std::string refinement_planner_id_;
+  // Set to give up the refinement, when a request for another goal comes first
+  std::atomic<bool> refinement_canceled_{false};
+
+  // Any-angle shortening of the paths returned, against the latest costmap snapshot
+  bool shorten_paths_;
+  double path_spacing_;
+
+  // Planner racing, requested under racing_planner_id_. The racing planners are
+  // distinct plugins, so they never run on the same instance at the same time
+  std::string racing_planner_id_;
+  std::vector<std::string> racing_planners_;
+  double racing_max_length_ratio_;
+
+  // Concurrent planning. Every worker owns a full set of planner instances,
+  // so the workers never share a plugin and only read the costmap snapshot
+  int concurrent_planners_;
+  std::vector<PlannerMap> concurrent_instances_;
+  std::vector<std::thread> concurrent_workers_;
+  std::deque<std::shared_ptr<ConcurrentGoalHandle>> concurrent_queue_;
+  std::mutex concurrent_mutex_;
+  std::condition_variable concurrent_cv_;
+  bool concurrent_active_;
+  bool concurrent_stop_;
+
   // Clock
   rclcpp::Clock steady_clock_{RCL_STEADY_TIME};
 
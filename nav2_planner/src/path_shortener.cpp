@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_planner/path_shortener.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/line_iterator.hpp"
+
+namespace nav2_planner
+{
+
+namespace
+{
+
+unsigned char knownCost(unsigned char cost)
+{
+  return cost == nav2_costmap_2d::NO_INFORMATION ? 0 : cost;
+}
+
+}  // namespace
+
+nav_msgs::msg::Path shortenPath(
+  const nav_msgs::msg::Path & path, const nav2_costmap_2d::Costmap2D & costmap, double spacing)
+{
+  const size_t n = path.poses.size();
+  if (n < 3) {
+    return path;
+  }
+
+  const unsigned char * costs = costmap.getCharMap();
+  std::vector<unsigned int> cells(n);
+  // Number of the poses before each one in unknown space
+  std::vector<size_t> unknown_before(n + 1, 0);
+  for (size_t i = 0; i != n; i++) {
+    unsigned int mx, my;
+    if (!costmap.worldToMap(
+        path.poses[i].pose.position.x, path.poses[i].pose.position.y, mx, my))
+    {
+      return path;
+    }
+    cells[i] = costmap.getIndex(mx, my);
+    unknown_before[i + 1] = unknown_before[i] +
+      (costs[cells[i]] == nav2_costmap_2d::NO_INFORMATION ? 1 : 0);
+  }
+
+  const int size_x = static_cast<int>(costmap.getSizeInCellsX());
+  auto in_sight = [&](size_t from, size_t to) {
+      const unsigned char limit = std::min<unsigned char>(
+        std::max(knownCost(costs[cells[from]]), knownCost(costs[cells[to]])),
+        nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1);
+      unsigned char max_cost = 0;
+      bool unknown = false;
+      nav2_util::walkLine(
+        nav2_util::lineSteps(
+          size_x, cells[from] % size_x, cells[from] / size_x, cells[to] % size_x,
+          cells[to] / size_x),
+        [&](unsigned int offset) {
+          if (costs[offset] == nav2_costmap_2d::NO_INFORMATION) {
+            unknown = true;
+          } else {
+            max_cost = std::max(max_cost, costs[offset]);
+          }
+        });
+      return max_cost <= limit && (!unknown || unknown_before[to + 1] > unknown_before[from]);
+    };
+
+  std::vector<size_t> kept{0};
+  size_t anchor = 0;
+  while (anchor + 1 < n) {
+    // The next pose is always in sight, the path goes there
+    size_t seen = anchor + 1;
+    size_t hidden = n;
+    for (size_t step = 2; anchor + step < n; step *= 2) {
+      if (!in_sight(anchor, anchor + step)) {
+        hidden = anchor + step;
+        break;
+      }
+      seen = anchor + step;
+    }
+    if (hidden == n && seen != n - 1) {
+      if (in_sight(anchor, n - 1)) {
+        seen = n - 1;
+      } else {
+        hidden = n - 1;
+      }
+    }
+    while (hidden - seen > 1) {
+      const size_t middle = seen + (hidden - seen) / 2;
+      if (in_sight(anchor, middle)) {
+        seen = middle;
+      } else {
+        hidden = middle;
+      }
+    }
+    kept.push_back(seen);
+    anchor = seen;
+  }
+
+  nav_msgs::msg::Path shortened;
+  shortened.header = path.header;
+  for (size_t k = 0; k + 1 < kept.size(); k++) {
+    const geometry_msgs::msg::PoseStamped & from = path.poses[kept[k]];
+    const geometry_msgs::msg::Point & to = path.poses[kept[k + 1]].pose.position;
+    const double dx = to.x - from.pose.position.x;
+    const double dy = to.y - from.pose.position.y;
+    const double length = std::hypot(dx, dy);
+    if (length == 0.0) {
+      continue;
+    }
+    const size_t pieces = spacing > 0.0 ?
+      std::max<size_t>(1, static_cast<size_t>(std::ceil(length / spacing))) : 1;
+    geometry_msgs::msg::PoseStamped pose = from;
+    pose.pose.orientation = nav2_util::geometry_utils::orientationAroundZAxis(std::atan2(dy, dx));
+    for (size_t j = 0; j != pieces; j++) {
+      const double t = static_cast<double>(j) / pieces;
+      pose.pose.position.x = from.pose.position.x + t * dx;
+      pose.pose.position.y = from.pose.position.y + t * dy;
+      shortened.poses.push_back(pose);
+    }
+  }
+  shortened.poses.push_back(path.poses.back());
+  return shortened;
+}
+
+}  // namespace nav2_planner
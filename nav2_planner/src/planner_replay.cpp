@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Plans again the request of a planner server snapshot, against the costmap it was
+// planned on, with the planner configured as the server had it:
+//
+//   ros2 run nav2_planner planner_replay <snapshot> [--plugin <planner id>] [--runs <n>]
+//     [--trace <file>]
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_core/global_planner.hpp"
+#include "nav2_costmap_2d/costmap_snapshot.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/snapshot.hpp"
+#include "nav2_util/snapshot_recorder.hpp"
+#include "nav2_util/snapshot_replay.hpp"
+#include "pluginlib/class_loader.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  nav2_util::ReplayOptions options;
+  if (!nav2_util::parseReplayOptions(rclcpp::remove_ros_arguments(argc, argv), options)) {
+    return 1;
+  }
+  auto snapshot = nav2_util::Snapshot::load(options.snapshot);
+  if (!snapshot || !snapshot->has("planner/id")) {
+    std::fprintf(stderr, "%s is not a planner server snapshot\n", options.snapshot.c_str());
+    return 1;
+  }
+
+  geometry_msgs::msg::PoseStamped start, goal;
+  nav_msgs::msg::Path recorded;
+  nav2_util::readPose(*snapshot, "planner/start", start);
+  nav2_util::readPose(*snapshot, "planner/goal", goal);
+  nav2_util::readPath(*snapshot, "planner/plan", recorded);
+  const std::string planner_id =
+    options.plugin.empty() ? snapshot->string("planner/id") : options.plugin;
+
+  // A node of the server's name and parameters, for the planner to configure from
+  rclcpp::NodeOptions node_options;
+  node_options.parameter_overrides(nav2_util::readParameters(*snapshot, "planner/parameters"));
+  node_options.allow_undeclared_parameters(true);
+  auto node = std::make_shared<nav2_util::LifecycleNode>(
+    snapshot->source(), "", false, node_options);
+
+  std::string planner_type;
+  if (!node->get_parameter(planner_id + ".plugin", planner_type)) {
+    std::fprintf(
+      stderr, "Planner %s is not a plugin of the snapshot, racing requests are replayed "
+      "one planner at a time with --plugin\n", planner_id.c_str());
+    return 1;
+  }
+
+  auto costmap_ros = nav2_costmap_2d::replayCostmapROS(*snapshot, "global_costmap");
+  if (!costmap_ros) {
+    std::fprintf(stderr, "The snapshot has no global costmap\n");
+    return 1;
+  }
+
+  pluginlib::ClassLoader<nav2_core::GlobalPlanner> loader("nav2_core", "nav2_core::GlobalPlanner");
+  nav2_core::GlobalPlanner::Ptr planner = loader.createUniqueInstance(planner_type);
+  planner->configure(node, planner_id, costmap_ros->getTfBuffer(), costmap_ros);
+  planner->activate();
+
+  double recorded_duration = 0.0;
+  snapshot->value("planner/duration", recorded_duration);
+  std::printf(
+    "Replaying %s (%s) from (%.2f, %.2f) to (%.2f, %.2f), recorded in %.3f ms for a plan of "
+    "%zu poses\n", planner_id.c_str(), planner_type.c_str(),
+    start.pose.position.x, start.pose.position.y, goal.pose.position.x, goal.pose.position.y,
+    recorded_duration * 1e3, recorded.poses.size());
+
+  nav_msgs::msg::Path path;
+  std::string failure;
+  nav2_util::runReplay(
+    options, "planner.create_plan", planner_id, [&]() {
+      try {
+        path = planner->createPlan(start, goal);
+      } catch (const std::exception & ex) {
+        failure = ex.what();
+      }
+    });
+  if (failure.empty()) {
+    std::printf("Replayed plan of %zu poses\n", path.poses.size());
+  } else {
+    std::printf("The planner failed: %s\n", failure.c_str());
+  }
+
+  planner->deactivate();
+  planner->cleanup();
+  rclcpp::shutdown();
+  return 0;
+}
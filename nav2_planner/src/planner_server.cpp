@@ -13,6 +13,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -24,22 +25,36 @@
 #include <utility>
 
 #include "builtin_interfaces/msg/duration.hpp"
+#include "nav2_util/compact_path.hpp"
 #include "nav2_util/costmap.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/task_scheduler.hpp"
+#include "nav2_util/trace.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_snapshot.hpp"
 
 #include "nav2_planner/planner_server.hpp"
+#include "nav2_planner/path_shortener.hpp"
 
 using namespace std::chrono_literals;
 
 namespace nav2_planner
 {
 
-PlannerServer::PlannerServer()
-: nav2_util::LifecycleNode("nav2_planner", "", true),
+PlannerServer::PlannerServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("nav2_planner", "", true, options),
   gp_loader_("nav2_core", "nav2_core::GlobalPlanner"),
   default_ids_{"GridBased"},
   default_types_{"nav2_navfn_planner/NavfnPlanner"},
+  diagnostics_period_(0.0),
+  plan_cache_size_(0),
+  partial_plan_length_(0.0),
+  shorten_paths_(false),
+  path_spacing_(0.0),
+  racing_max_length_ratio_(0.0),
+  concurrent_planners_(0),
+  concurrent_active_(false),
+  concurrent_stop_(false),
   costmap_(nullptr)
 {
   RCLCPP_INFO(get_logger(), "Creating");
@@ -47,6 +62,15 @@ PlannerServer::PlannerServer()
   // Declare this node's parameters
   declare_parameter("planner_plugins", default_ids_);
   declare_parameter("expected_planner_frequency", 20.0);
+  declare_parameter("concurrent_planners", 0);
+  declare_parameter("plan_cache_size", 0);
+  declare_parameter("partial_plan_length", 0.0);
+  declare_parameter("shorten_paths", false);
+  declare_parameter("path_spacing", 0.25);
+  declare_parameter("racing_planner_id", std::string("Racing"));
+  declare_parameter("racing_planners", std::vector<std::string>());
+  declare_parameter("racing_max_length_ratio", 0.0);
+  declare_parameter("diagnostics_period", 1.0);
 
   get_parameter("planner_plugins", planner_ids_);
   if (planner_ids_ == default_ids_) {
@@ -66,6 +90,7 @@ PlannerServer::PlannerServer()
 PlannerServer::~PlannerServer()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
+  stopConcurrentWorkers();
   planners_.clear();
   costmap_thread_.reset();
 }
@@ -126,6 +151,46 @@ PlannerServer::on_configure(const rclcpp_lifecycle::State & state)
     max_planner_duration_ = 0.0;
   }
 
+  get_parameter("plan_cache_size", plan_cache_size_);
+  get_parameter("partial_plan_length", partial_plan_length_);
+  get_parameter("shorten_paths", shorten_paths_);
+  get_parameter("path_spacing", path_spacing_);
+
+  get_parameter("racing_planner_id", racing_planner_id_);
+  get_parameter("racing_max_length_ratio", racing_max_length_ratio_);
+  std::vector<std::string> racing_planners;
+  get_parameter("racing_planners", racing_planners);
+  racing_planners_.clear();
+  if (planners_.find(racing_planner_id_) != planners_.end()) {
+    RCLCPP_WARN(
+      get_logger(), "The racing planner ID %s is a planner plugin's, racing is disabled",
+      racing_planner_id_.c_str());
+    racing_planners.clear();
+  }
+  for (const auto & id : racing_planners) {
+    if (planners_.find(id) == planners_.end()) {
+      RCLCPP_WARN(
+        get_logger(), "Racing planner %s is not a planner plugin, skipping it", id.c_str());
+    } else if (std::find(racing_planners_.begin(), racing_planners_.end(), id) ==
+      racing_planners_.end())
+    {
+      racing_planners_.push_back(id);
+    }
+  }
+  if (!racing_planners_.empty()) {
+    RCLCPP_INFO(
+      get_logger(), "Requests for planner %s race %zu planners", racing_planner_id_.c_str(),
+      racing_planners_.size());
+  }
+
+  get_parameter("diagnostics_period", diagnostics_period_);
+  if (diagnostics_period_ > 0.0) {
+    timing_stats_ = std::make_shared<nav2_util::TimingStats>();
+  }
+
+  snapshot_recorder_ = std::make_unique<nav2_util::SnapshotRecorder>(
+    this, [this](nav2_util::SnapshotWriter & writer) {return fillSnapshot(writer);});
+
   // Initialize pubs & subs
   plan_publisher_ = create_publisher<nav_msgs::msg::Path>("plan", 1);
 
@@ -135,6 +200,16 @@ PlannerServer::on_configure(const rclcpp_lifecycle::State & state)
     "compute_path_to_pose",
     std::bind(&PlannerServer::computePlan, this));
 
+  action_server_plans_ = std::make_unique<ActionPlansServer>(
+    rclcpp_node_,
+    "compute_paths_to_poses",
+    std::bind(&PlannerServer::computePlans, this));
+
+  get_parameter("concurrent_planners", concurrent_planners_);
+  if (concurrent_planners_ > 0) {
+    startConcurrentWorkers(node);
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -145,13 +220,30 @@ PlannerServer::on_activate(const rclcpp_lifecycle::State & state)
 
   plan_publisher_->on_activate();
   action_server_->activate();
+  action_server_plans_->activate();
   costmap_ros_->on_activate(state);
+  if (timing_stats_) {
+    timing_diagnostics_ = std::make_unique<nav2_util::TimingDiagnostics>(
+      shared_from_this(), timing_stats_, get_name(),
+      std::chrono::duration<double>(diagnostics_period_));
+  }
 
   PlannerMap::iterator it;
   for (it = planners_.begin(); it != planners_.end(); ++it) {
     it->second->activate();
   }
 
+  for (auto & instances : concurrent_instances_) {
+    for (it = instances.begin(); it != instances.end(); ++it) {
+      it->second->activate();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(concurrent_mutex_);
+    concurrent_active_ = true;
+  }
+
   // create bond connection
   createBond();
 
@@ -164,7 +256,19 @@ PlannerServer::on_deactivate(const rclcpp_lifecycle::State & state)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   action_server_->deactivate();
+  action_server_plans_->deactivate();
+  {
+    std::lock_guard<std::mutex> lock(concurrent_mutex_);
+    concurrent_active_ = false;
+  }
+  abortQueuedGoals();
+  if (refinement_.valid()) {
+    refinement_canceled_ = true;
+    refinement_.wait();
+    refinement_ = std::future<nav_msgs::msg::Path>();
+  }
   plan_publisher_->on_deactivate();
+  timing_diagnostics_.reset();
   costmap_ros_->on_deactivate(state);
 
   PlannerMap::iterator it;
@@ -172,6 +276,12 @@ PlannerServer::on_deactivate(const rclcpp_lifecycle::State & state)
     it->second->deactivate();
   }
 
+  for (auto & instances : concurrent_instances_) {
+    for (it = instances.begin(); it != instances.end(); ++it) {
+      it->second->deactivate();
+    }
+  }
+
   // destroy bond connection
   destroyBond();
 
@@ -184,7 +294,15 @@ PlannerServer::on_cleanup(const rclcpp_lifecycle::State & state)
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
   action_server_.reset();
+  action_server_plans_.reset();
+  stopConcurrentWorkers();
   plan_publisher_.reset();
+  timing_stats_.reset();
+  snapshot_recorder_.reset();
+  {
+    std::lock_guard<std::mutex> lock(last_plan_mutex_);
+    last_plan_ = LastPlan();
+  }
   tf_.reset();
   costmap_ros_->on_cleanup(state);
 
@@ -193,6 +311,7 @@ PlannerServer::on_cleanup(const rclcpp_lifecycle::State & state)
     it->second->cleanup();
   }
   planners_.clear();
+  plan_cache_.clear();
   costmap_ = nullptr;
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -205,6 +324,188 @@ PlannerServer::on_shutdown(const rclcpp_lifecycle::State &)
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
+void
+PlannerServer::startConcurrentWorkers(const nav2_util::LifecycleNode::SharedPtr & node)
+{
+  // The instances share the parameters of the planner they are a copy of
+  concurrent_instances_.resize(concurrent_planners_);
+  for (auto & instances : concurrent_instances_) {
+    for (size_t i = 0; i != planner_ids_.size(); i++) {
+      try {
+        nav2_core::GlobalPlanner::Ptr planner =
+          gp_loader_.createUniqueInstance(planner_types_[i]);
+        planner->configure(node, planner_ids_[i], tf_, costmap_ros_);
+        instances.insert({planner_ids_[i], planner});
+      } catch (const pluginlib::PluginlibException & ex) {
+        RCLCPP_FATAL(
+          get_logger(), "Failed to create concurrent global planner. Exception: %s",
+          ex.what());
+      }
+    }
+  }
+
+  concurrent_stop_ = false;
+  for (int i = 0; i < concurrent_planners_; i++) {
+    concurrent_workers_.emplace_back(&PlannerServer::concurrentWorker, this, i);
+  }
+
+  concurrent_action_server_ = rclcpp_action::create_server<ActionT>(
+    rclcpp_node_->get_node_base_interface(),
+    rclcpp_node_->get_node_clock_interface(),
+    rclcpp_node_->get_node_logging_interface(),
+    rclcpp_node_->get_node_waitables_interface(),
+    "compute_path_to_pose_concurrent",
+    [this](const rclcpp_action::GoalUUID &, std::shared_ptr<const ActionT::Goal>) {
+      std::lock_guard<std::mutex> lock(concurrent_mutex_);
+      return concurrent_active_ ?
+      rclcpp_action::GoalResponse::ACCEPT_AND_EXECUTE :
+      rclcpp_action::GoalResponse::REJECT;
+    },
+    [](const std::shared_ptr<ConcurrentGoalHandle>) {
+      return rclcpp_action::CancelResponse::ACCEPT;
+    },
+    [this](const std::shared_ptr<ConcurrentGoalHandle> handle) {
+      {
+        std::lock_guard<std::mutex> lock(concurrent_mutex_);
+        concurrent_queue_.push_back(handle);
+      }
+      concurrent_cv_.notify_one();
+    });
+
+  RCLCPP_INFO(
+    get_logger(), "Planning up to %d goals concurrently on compute_path_to_pose_concurrent",
+    concurrent_planners_);
+}
+
+void
+PlannerServer::stopConcurrentWorkers()
+{
+  concurrent_action_server_.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(concurrent_mutex_);
+    concurrent_active_ = false;
+    concurrent_stop_ = true;
+  }
+  concurrent_cv_.notify_all();
+  for (auto & worker : concurrent_workers_) {
+    worker.join();
+  }
+  concurrent_workers_.clear();
+  abortQueuedGoals();
+
+  for (auto & instances : concurrent_instances_) {
+    for (auto it = instances.begin(); it != instances.end(); ++it) {
+      it->second->cleanup();
+    }
+  }
+  concurrent_instances_.clear();
+}
+
+void
+PlannerServer::abortQueuedGoals()
+{
+  std::deque<std::shared_ptr<ConcurrentGoalHandle>> queue;
+  {
+    std::lock_guard<std::mutex> lock(concurrent_mutex_);
+    queue.swap(concurrent_queue_);
+  }
+
+  for (auto & handle : queue) {
+    if (handle->is_active()) {
+      handle->abort(std::make_shared<ActionT::Result>());
+    }
+  }
+}
+
+void
+PlannerServer::concurrentWorker(size_t index)
+{
+  while (true) {
+    std::shared_ptr<ConcurrentGoalHandle> handle;
+    {
+      std::unique_lock<std::mutex> lock(concurrent_mutex_);
+      concurrent_cv_.wait(
+        lock, [this]() {return concurrent_stop_ || !concurrent_queue_.empty();});
+      if (concurrent_stop_) {
+        return;
+      }
+      handle = concurrent_queue_.front();
+      concurrent_queue_.pop_front();
+    }
+
+    computePlanConcurrent(handle, concurrent_instances_[index]);
+  }
+}
+
+void
+PlannerServer::computePlanConcurrent(
+  const std::shared_ptr<ConcurrentGoalHandle> & handle,
+  const PlannerMap & planners)
+{
+  auto start_time = steady_clock_.now();
+  auto goal = handle->get_goal();
+  auto result = std::make_shared<ActionT::Result>();
+
+  try {
+    if (handle->is_canceling()) {
+      handle->canceled(result);
+      return;
+    }
+
+    if (!costmap_ros_->waitUntilReady()) {
+      RCLCPP_WARN(get_logger(), "Costmap is not ready, aborting the planning goal");
+      handle->abort(result);
+      return;
+    }
+
+    geometry_msgs::msg::PoseStamped start;
+    if (goal->use_start) {
+      start = goal->start;
+    } else if (!costmap_ros_->getRobotPose(start)) {
+      handle->abort(result);
+      return;
+    }
+
+    nav2_core::GlobalPlanner::Ptr planner = findPlanner(planners, goal->planner_id);
+    if (planner) {
+      nav2_util::ScopedTrace trace("planner.create_plan", goal->planner_id);
+      nav2_util::ScopedTiming timing(plannerTiming(goal->planner_id, "create_plan"));
+      auto costmap = costmap_ros_->getCostmapSnapshot();
+      const auto started = std::chrono::steady_clock::now();
+      result->path = planner->createPlan(start, goal->pose);
+      recordPlan(
+        start, goal->pose, goal->planner_id, result->path, costmap,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    }
+
+    if (result->path.poses.size() == 0) {
+      RCLCPP_WARN(
+        get_logger(), "Planning algorithm %s failed to generate a valid"
+        " path to (%.2f, %.2f)", goal->planner_id.c_str(),
+        goal->pose.pose.position.x, goal->pose.pose.position.y);
+      handle->abort(result);
+      return;
+    }
+    shortenPlan(result->path);
+    if (goal->use_compact_path) {
+      result->compact_path = nav2_util::toCompactPath(result->path);
+      result->path = nav_msgs::msg::Path();
+    }
+
+    // These plans are usually queries for other robots, so unlike computePlan
+    // they are not published
+    result->planning_time = steady_clock_.now() - start_time;
+    handle->succeed(result);
+  } catch (std::exception & ex) {
+    RCLCPP_WARN(
+      get_logger(), "%s plugin failed to plan calculation to (%.2f, %.2f): \"%s\"",
+      goal->planner_id.c_str(), goal->pose.pose.position.x,
+      goal->pose.pose.position.y, ex.what());
+    handle->abort(result);
+  }
+}
+
 void
 PlannerServer::computePlan()
 {
@@ -226,17 +527,45 @@ PlannerServer::computePlan()
       return;
     }
 
-    geometry_msgs::msg::PoseStamped start;
-    if (!costmap_ros_->getRobotPose(start)) {
+    if (action_server_->is_preempt_requested()) {
+      goal = action_server_->accept_pending_goal();
+    }
+
+    if (!costmap_ros_->waitUntilReady()) {
+      RCLCPP_WARN(get_logger(), "Costmap is not ready, aborting the planning goal");
       action_server_->terminate_current();
       return;
     }
 
-    if (action_server_->is_preempt_requested()) {
-      goal = action_server_->accept_pending_goal();
+    geometry_msgs::msg::PoseStamped start;
+    if (goal->use_start) {
+      start = goal->start;
+    } else if (!costmap_ros_->getRobotPose(start)) {
+      action_server_->terminate_current();
+      return;
     }
 
-    result->path = getPlan(start, goal->pose, goal->planner_id);
+    nav2_util::ScopedTrace trace(
+      "planner.compute_plan", goal->planner_id, nav2_util::traceStamp(start.header.stamp),
+      nav2_util::traceStamp(goal->pose.header.stamp));
+    // A new goal or a cancellation interrupts the search, instead of waiting for it
+    auto cancel_checker = [this]() {
+        return action_server_->is_cancel_requested() || action_server_->is_preempt_requested();
+      };
+    result->path = partial_plan_length_ > 0.0 ?
+      getPartialPlan(start, goal->pose, goal->planner_id, cancel_checker) :
+      getPlan(start, goal->pose, goal->planner_id, cancel_checker);
+
+    if (action_server_->is_cancel_requested()) {
+      RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling planning action.");
+      action_server_->terminate_all();
+      return;
+    }
+    if (result->path.poses.size() == 0 && action_server_->is_preempt_requested()) {
+      // The action server moves on to the pending goal
+      RCLCPP_DEBUG(get_logger(), "Planning interrupted by a new goal.");
+      return;
+    }
 
     if (result->path.poses.size() == 0) {
       RCLCPP_WARN(
@@ -247,6 +576,7 @@ PlannerServer::computePlan()
       return;
     }
 
+    shortenPlan(result->path);
     RCLCPP_DEBUG(
       get_logger(),
       "Found valid path of size %u to (%.2f, %.2f)",
@@ -255,6 +585,10 @@ PlannerServer::computePlan()
 
     // Publish the plan for visualization purposes
     publishPlan(result->path);
+    if (goal->use_compact_path) {
+      result->compact_path = nav2_util::toCompactPath(result->path);
+      result->path = nav_msgs::msg::Path();
+    }
 
     auto cycle_duration = steady_clock_.now() - start_time;
     result->planning_time = cycle_duration;
@@ -278,26 +612,504 @@ PlannerServer::computePlan()
   }
 }
 
+void
+PlannerServer::computePlans()
+{
+  auto start_time = steady_clock_.now();
+
+  // Initialize the ComputePathsToPoses goal and result
+  auto goal = action_server_plans_->get_current_goal();
+  auto result = std::make_shared<nav2_msgs::action::ComputePathsToPoses::Result>();
+
+  try {
+    if (action_server_plans_ == nullptr || !action_server_plans_->is_server_active()) {
+      RCLCPP_DEBUG(get_logger(), "Action server unavailable or inactive. Stopping.");
+      return;
+    }
+
+    if (action_server_plans_->is_cancel_requested()) {
+      RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling planning action.");
+      action_server_plans_->terminate_all();
+      return;
+    }
+
+    if (action_server_plans_->is_preempt_requested()) {
+      goal = action_server_plans_->accept_pending_goal();
+    }
+
+    if (!costmap_ros_->waitUntilReady()) {
+      RCLCPP_WARN(get_logger(), "Costmap is not ready, aborting the planning goal");
+      action_server_plans_->terminate_current();
+      return;
+    }
+
+    geometry_msgs::msg::PoseStamped start;
+    if (goal->use_start) {
+      start = goal->start;
+    } else if (!costmap_ros_->getRobotPose(start)) {
+      action_server_plans_->terminate_current();
+      return;
+    }
+
+    nav2_util::ScopedTrace trace(
+      "planner.compute_plans", goal->planner_id, nav2_util::traceStamp(start.header.stamp));
+    size_t num_found = 0;
+    if (goal->costs_only) {
+      result->costs = getCosts(start, goal->poses, goal->planner_id);
+      result->paths.resize(goal->poses.size());
+      for (const double cost : result->costs) {
+        if (std::isfinite(cost)) {
+          num_found++;
+        }
+      }
+    } else {
+      result->paths = getPlans(start, goal->poses, goal->planner_id);
+      for (auto & path : result->paths) {
+        if (!path.poses.empty()) {
+          shortenPlan(path);
+          num_found++;
+        }
+      }
+    }
+
+    // Only fail when none of the goals could be planned to, the caller sees
+    // which goals are unreachable from their empty paths
+    if (num_found == 0) {
+      RCLCPP_WARN(
+        get_logger(), "Planning algorithm %s failed to generate a valid"
+        " path to any of %zu goals", goal->planner_id.c_str(), goal->poses.size());
+      action_server_plans_->terminate_current();
+      return;
+    }
+
+    RCLCPP_DEBUG(
+      get_logger(), "Found valid paths to %zu of %zu goals",
+      num_found, goal->poses.size());
+
+    auto cycle_duration = steady_clock_.now() - start_time;
+    result->planning_time = cycle_duration;
+
+    if (max_planner_duration_ && cycle_duration.seconds() > max_planner_duration_) {
+      RCLCPP_WARN(
+        get_logger(),
+        "Planner loop missed its desired rate of %.4f Hz. Current loop rate is %.4f Hz",
+        1 / max_planner_duration_, 1 / cycle_duration.seconds());
+    }
+
+    action_server_plans_->succeeded_current(result);
+  } catch (std::exception & ex) {
+    RCLCPP_WARN(
+      get_logger(), "%s plugin failed to plan calculation to %zu goals: \"%s\"",
+      goal->planner_id.c_str(), goal->poses.size(), ex.what());
+    action_server_plans_->terminate_current();
+  }
+}
+
 nav_msgs::msg::Path
 PlannerServer::getPlan(
   const geometry_msgs::msg::PoseStamped & start,
   const geometry_msgs::msg::PoseStamped & goal,
-  const std::string & planner_id)
+  const std::string & planner_id,
+  const std::function<bool()> & cancel_checker)
 {
   RCLCPP_DEBUG(
     get_logger(), "Attempting to a find path from (%.2f, %.2f) to "
     "(%.2f, %.2f).", start.pose.position.x, start.pose.position.y,
     goal.pose.position.x, goal.pose.position.y);
 
-  if (planners_.find(planner_id) != planners_.end()) {
-    return planners_[planner_id]->createPlan(start, goal);
+  std::lock_guard<std::mutex> lock(planner_mutex_);
+  const bool racing = isRacing(planner_id);
+  nav2_core::GlobalPlanner::Ptr planner = racing ? nullptr : findPlanner(planner_id);
+  if (!racing && !planner) {
+    return nav_msgs::msg::Path();
+  }
+
+  auto create_plan = [&]() -> nav_msgs::msg::Path {
+      nav2_util::ScopedTrace trace("planner.create_plan", planner_id);
+      nav2_util::ScopedTiming timing(plannerTiming(planner_id, "create_plan"));
+      auto costmap = costmap_ros_->getCostmapSnapshot();
+      const auto started = std::chrono::steady_clock::now();
+      nav_msgs::msg::Path path;
+      if (racing) {
+        path = racePlans(start, goal, cancel_checker);
+      } else {
+        path = cancel_checker ? planner->createCancellablePlan(start, goal, cancel_checker) :
+          planner->createPlan(start, goal);
+      }
+      recordPlan(
+        start, goal, planner_id, path, costmap,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+      return path;
+    };
+
+  if (plan_cache_size_ <= 0) {
+    return create_plan();
+  }
+
+  nav_msgs::msg::Path path;
+  if (getCachedPlan(start, goal, planner_id, path)) {
+    return path;
+  }
+
+  // Take the snapshot before planning, changes made while planning then
+  // invalidate the cached path the next time it is looked up
+  uint64_t sequence = 0;
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot(sequence);
+  path = create_plan();
+  if (snapshot && !path.poses.empty()) {
+    cachePlan(start, goal, planner_id, path, snapshot, sequence);
+  }
+  return path;
+}
+
+nav_msgs::msg::Path
+PlannerServer::getPartialPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const std::string & planner_id,
+  const std::function<bool()> & cancel_checker)
+{
+  // Only computePlan's thread touches the refinement. A refinement for another goal
+  // is given up rather than waited for
+  if (refinement_.valid()) {
+    const bool same_goal = refinement_planner_id_ == planner_id &&
+      refinement_goal_.header.frame_id == goal.header.frame_id &&
+      refinement_goal_.pose == goal.pose;
+    if (!same_goal) {
+      refinement_canceled_ = true;
+    }
+    nav_msgs::msg::Path path = refinement_.get();
+    if (same_goal && !path.poses.empty()) {
+      RCLCPP_DEBUG(get_logger(), "Handing over the whole path after a partial one.");
+      return path;
+    }
+  }
+
+  // Races only plan whole paths
+  if (isRacing(planner_id)) {
+    return getPlan(start, goal, planner_id, cancel_checker);
+  }
+
+  nav_msgs::msg::Path path;
+  {
+    std::lock_guard<std::mutex> lock(planner_mutex_);
+    nav2_core::GlobalPlanner::Ptr planner = findPlanner(planner_id);
+    if (!planner) {
+      return path;
+    }
+    nav2_util::ScopedTrace trace("planner.create_partial_plan", planner_id);
+    nav2_util::ScopedTiming timing(plannerTiming(planner_id, "create_partial_plan"));
+    path = planner->createPartialPlan(start, goal, partial_plan_length_);
+  }
+
+  if (path.poses.empty()) {
+    return getPlan(start, goal, planner_id, cancel_checker);
+  }
+  const auto & end = path.poses.back().pose.position;
+  if (std::hypot(end.x - goal.pose.position.x, end.y - goal.pose.position.y) <=
+    costmap_->getResolution())
+  {
+    return path;
+  }
+
+  refinement_goal_ = goal;
+  refinement_planner_id_ = planner_id;
+  refinement_canceled_ = false;
+  refinement_ = std::async(
+    std::launch::async, [this, start, goal, planner_id]() {
+      return getPlan(
+        start, goal, planner_id, [this]() {return refinement_canceled_.load();});
+    });
+  return path;
+}
+
+bool
+PlannerServer::isRacing(const std::string & planner_id) const
+{
+  return !racing_planners_.empty() && planner_id == racing_planner_id_;
+}
+
+nav_msgs::msg::Path
+PlannerServer::racePlans(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const std::function<bool()> & cancel_checker)
+{
+  // The paths are all checked against the costmap as it was when the race started
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot();
+  if (!snapshot) {
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    snapshot = std::make_shared<const nav2_costmap_2d::Costmap2D>(*costmap_);
+  }
+  const double max_length = racing_max_length_ratio_ > 0.0 ?
+    racing_max_length_ratio_ * std::hypot(
+    goal.pose.position.x - start.pose.position.x,
+    goal.pose.position.y - start.pose.position.y) :
+    std::numeric_limits<double>::infinity();
+
+  const size_t num_planners = racing_planners_.size();
+  std::vector<nav_msgs::msg::Path> paths(num_planners);
+  std::vector<double> lengths(num_planners, std::numeric_limits<double>::infinity());
+  std::mutex race_mutex;
+  int winner = -1;
+  std::atomic<bool> decided{false};
+  auto race_over = [&]() {
+      return decided.load() || (cancel_checker && cancel_checker());
+    };
+
+  // The calling thread races too, and a planner only starts if the race is still on
+  nav2_util::TaskScheduler::instance().parallelFor(
+    nav2_util::TaskPriority::PLANNING, num_planners, [&](size_t i) {
+      if (race_over()) {
+        return;
+      }
+      const std::string & id = racing_planners_[i];
+      nav_msgs::msg::Path path;
+      try {
+        nav2_util::ScopedTrace trace("planner.race_plan", id);
+        path = planners_.at(id)->createCancellablePlan(start, goal, race_over);
+      } catch (std::exception & ex) {
+        RCLCPP_WARN(get_logger(), "Racing planner %s failed: \"%s\"", id.c_str(), ex.what());
+        return;
+      }
+      double length;
+      if (!checkRacePlan(path, *snapshot, length)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(race_mutex);
+      paths[i] = std::move(path);
+      lengths[i] = length;
+      if (winner < 0 && length <= max_length) {
+        winner = static_cast<int>(i);
+        decided = true;
+      }
+    });
+
+  if (cancel_checker && cancel_checker()) {
+    return nav_msgs::msg::Path();
+  }
+  if (winner < 0) {
+    const auto shortest = std::min_element(lengths.begin(), lengths.end());
+    if (std::isinf(*shortest)) {
+      return nav_msgs::msg::Path();
+    }
+    winner = static_cast<int>(shortest - lengths.begin());
+    RCLCPP_DEBUG(
+      get_logger(), "No racing planner met the length threshold, %s has the shortest path",
+      racing_planners_[winner].c_str());
+  } else {
+    RCLCPP_DEBUG(get_logger(), "Racing planner %s won", racing_planners_[winner].c_str());
+  }
+  return std::move(paths[winner]);
+}
+
+bool
+PlannerServer::checkRacePlan(
+  const nav_msgs::msg::Path & path, const nav2_costmap_2d::Costmap2D & costmap,
+  double & length) const
+{
+  length = 0.0;
+  if (path.poses.empty() || path.header.frame_id != costmap_ros_->getGlobalFrameID()) {
+    return false;
+  }
+  // The robot may start in an obstacle's cell, the path must leave it
+  for (size_t i = 0; i != path.poses.size(); i++) {
+    const auto & position = path.poses[i].pose.position;
+    unsigned int mx, my;
+    if (!costmap.worldToMap(position.x, position.y, mx, my) ||
+      (i > 0 && costmap.getCost(mx, my) == nav2_costmap_2d::LETHAL_OBSTACLE))
+    {
+      return false;
+    }
+    if (i > 0) {
+      const auto & previous = path.poses[i - 1].pose.position;
+      length += std::hypot(position.x - previous.x, position.y - previous.y);
+    }
+  }
+  return true;
+}
+
+bool
+PlannerServer::getCachedPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const std::string & planner_id,
+  nav_msgs::msg::Path & path)
+{
+  uint64_t sequence = 0;
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot(sequence);
+  const std::string & frame = costmap_ros_->getGlobalFrameID();
+  unsigned int sx, sy, gx, gy;
+  if (!snapshot || start.header.frame_id != frame || goal.header.frame_id != frame ||
+    !snapshot->worldToMap(start.pose.position.x, start.pose.position.y, sx, sy) ||
+    !snapshot->worldToMap(goal.pose.position.x, goal.pose.position.y, gx, gy))
+  {
+    return false;
+  }
+
+  auto it = plan_cache_.begin();
+  for (; it != plan_cache_.end(); ++it) {
+    if (it->start_x == sx && it->start_y == sy && it->goal_x == gx && it->goal_y == gy &&
+      it->planner_id == planner_id)
+    {
+      break;
+    }
+  }
+  if (it == plan_cache_.end()) {
+    return false;
+  }
+
+  if (it->sequence != sequence) {
+    // Only the cells under the path that changed since it was last checked
+    // have to be compared, a change anywhere else leaves the path valid
+    unsigned int x0, xn, y0, yn;
+    if (!costmap_ros_->getChangedBounds(it->sequence, sequence, x0, xn, y0, yn)) {
+      plan_cache_.erase(it);
+      return false;
+    }
+
+    if (x0 < it->xn && it->x0 < xn && y0 < it->yn && it->y0 < yn) {
+      const unsigned char * costs = snapshot->getCharMap();
+      for (size_t i = 0; i != it->cells.size(); i++) {
+        if (costs[it->cells[i]] != it->costs[i]) {
+          plan_cache_.erase(it);
+          return false;
+        }
+      }
+    }
+    it->sequence = sequence;
+  }
+
+  RCLCPP_DEBUG(
+    get_logger(), "Reusing cached path from (%.2f, %.2f) to (%.2f, %.2f).",
+    start.pose.position.x, start.pose.position.y,
+    goal.pose.position.x, goal.pose.position.y);
+
+  plan_cache_.splice(plan_cache_.begin(), plan_cache_, it);
+  path = it->path;
+  path.header.stamp = now();
+  return true;
+}
+
+void
+PlannerServer::cachePlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const std::string & planner_id,
+  const nav_msgs::msg::Path & path,
+  const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & snapshot,
+  uint64_t sequence)
+{
+  const std::string & frame = costmap_ros_->getGlobalFrameID();
+  CachedPlan entry;
+  if (start.header.frame_id != frame || goal.header.frame_id != frame ||
+    path.header.frame_id != frame ||
+    !snapshot->worldToMap(start.pose.position.x, start.pose.position.y,
+    entry.start_x, entry.start_y) ||
+    !snapshot->worldToMap(goal.pose.position.x, goal.pose.position.y,
+    entry.goal_x, entry.goal_y))
+  {
+    return;
+  }
+
+  // The costmap is inflated by the robot's footprint, so the costs under the
+  // path cover everything its footprint sweeps through
+  const unsigned char * costs = snapshot->getCharMap();
+  entry.x0 = entry.y0 = std::numeric_limits<unsigned int>::max();
+  entry.xn = entry.yn = 0;
+  entry.cells.reserve(path.poses.size());
+  entry.costs.reserve(path.poses.size());
+  for (const auto & pose : path.poses) {
+    unsigned int mx, my;
+    if (!snapshot->worldToMap(pose.pose.position.x, pose.pose.position.y, mx, my)) {
+      return;
+    }
+    unsigned int index = snapshot->getIndex(mx, my);
+    if (!entry.cells.empty() && entry.cells.back() == index) {
+      continue;
+    }
+    entry.cells.push_back(index);
+    entry.costs.push_back(costs[index]);
+    entry.x0 = std::min(entry.x0, mx);
+    entry.xn = std::max(entry.xn, mx + 1);
+    entry.y0 = std::min(entry.y0, my);
+    entry.yn = std::max(entry.yn, my + 1);
+  }
+
+  entry.planner_id = planner_id;
+  entry.path = path;
+  entry.sequence = sequence;
+
+  plan_cache_.push_front(std::move(entry));
+  while (plan_cache_.size() > static_cast<size_t>(plan_cache_size_)) {
+    plan_cache_.pop_back();
+  }
+}
+
+std::vector<nav_msgs::msg::Path>
+PlannerServer::getPlans(
+  const geometry_msgs::msg::PoseStamped & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+  const std::string & planner_id)
+{
+  RCLCPP_DEBUG(
+    get_logger(), "Attempting to a find paths from (%.2f, %.2f) to "
+    "%zu goals.", start.pose.position.x, start.pose.position.y, goals.size());
+
+  std::lock_guard<std::mutex> lock(planner_mutex_);
+  nav2_core::GlobalPlanner::Ptr planner = findPlanner(planner_id);
+  if (planner) {
+    nav2_util::ScopedTrace trace("planner.create_plans", planner_id);
+    nav2_util::ScopedTiming timing(plannerTiming(planner_id, "create_plans"));
+    return planner->createPlans(start, goals);
+  }
+
+  return std::vector<nav_msgs::msg::Path>(goals.size());
+}
+
+std::vector<double>
+PlannerServer::getCosts(
+  const geometry_msgs::msg::PoseStamped & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+  const std::string & planner_id)
+{
+  RCLCPP_DEBUG(
+    get_logger(), "Attempting to find the costs from (%.2f, %.2f) to "
+    "%zu goals.", start.pose.position.x, start.pose.position.y, goals.size());
+
+  std::lock_guard<std::mutex> lock(planner_mutex_);
+  nav2_core::GlobalPlanner::Ptr planner = findPlanner(planner_id);
+  if (planner) {
+    nav2_util::ScopedTrace trace("planner.compute_costs", planner_id);
+    nav2_util::ScopedTiming timing(plannerTiming(planner_id, "compute_costs"));
+    return planner->computeCosts(start, goals);
+  }
+
+  return std::vector<double>(goals.size(), std::numeric_limits<double>::infinity());
+}
+
+nav2_core::GlobalPlanner::Ptr
+PlannerServer::findPlanner(const std::string & planner_id)
+{
+  return findPlanner(planners_, planner_id);
+}
+
+nav2_core::GlobalPlanner::Ptr
+PlannerServer::findPlanner(const PlannerMap & planners, const std::string & planner_id)
+{
+  auto it = planners.find(planner_id);
+  if (it != planners.end()) {
+    return it->second;
   } else {
-    if (planners_.size() == 1 && planner_id.empty()) {
+    if (planners.size() == 1 && planner_id.empty()) {
       RCLCPP_WARN_ONCE(
         get_logger(), "No planners specified in action call. "
         "Server will use only plugin %s in server."
         " This warning will appear once.", planner_ids_concat_.c_str());
-      return planners_[planners_.begin()->first]->createPlan(start, goal);
+      return planners.begin()->second;
     } else {
       RCLCPP_ERROR(
         get_logger(), "planner %s is not a valid planner. "
@@ -306,19 +1118,88 @@ PlannerServer::getPlan(
     }
   }
 
-  return nav_msgs::msg::Path();
+  return nullptr;
+}
+
+nav2_util::TimingHistogram *
+PlannerServer::plannerTiming(const std::string & planner_id, const char * call)
+{
+  if (!timing_stats_) {
+    return nullptr;
+  }
+  const std::string & id =
+    planner_id.empty() && planner_ids_.size() == 1 ? planner_ids_.front() : planner_id;
+  return &timing_stats_->histogram(id + " " + call);
+}
+
+void
+PlannerServer::shortenPlan(nav_msgs::msg::Path & path)
+{
+  if (!shorten_paths_ || path.header.frame_id != costmap_ros_->getGlobalFrameID()) {
+    return;
+  }
+  std::shared_ptr<const nav2_costmap_2d::Costmap2D> snapshot =
+    costmap_ros_->getCostmapSnapshot();
+  if (snapshot) {
+    path = shortenPath(path, *snapshot, path_spacing_);
+  }
+}
+
+void
+PlannerServer::recordPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const std::string & planner_id,
+  const nav_msgs::msg::Path & path,
+  const std::shared_ptr<const nav2_costmap_2d::Costmap2D> & costmap,
+  double duration)
+{
+  if (!snapshot_recorder_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(last_plan_mutex_);
+    last_plan_.start = start;
+    last_plan_.goal = goal;
+    last_plan_.planner_id = planner_id;
+    last_plan_.path = path;
+    last_plan_.costmap = costmap;
+    last_plan_.duration = duration;
+  }
+  snapshot_recorder_->checkCycle(duration);
+}
+
+bool
+PlannerServer::fillSnapshot(nav2_util::SnapshotWriter & writer)
+{
+  std::lock_guard<std::mutex> lock(last_plan_mutex_);
+  if (!last_plan_.costmap) {
+    return false;
+  }
+  writer.addString("planner/id", last_plan_.planner_id);
+  nav2_util::addPose(writer, "planner/start", last_plan_.start);
+  nav2_util::addPose(writer, "planner/goal", last_plan_.goal);
+  nav2_util::addPath(writer, "planner/plan", last_plan_.path);
+  writer.addValue("planner/duration", last_plan_.duration);
+  nav2_util::addParameters(writer, "planner/parameters", nav2_util::allParameters(this));
+  nav2_costmap_2d::addCostmapROS(writer, "global_costmap", costmap_ros_, last_plan_.costmap);
+  return true;
 }
 
 void
 PlannerServer::publishPlan(const nav_msgs::msg::Path & path)
 {
-  auto msg = std::make_unique<nav_msgs::msg::Path>(path);
+  // Copied only when someone is listening, long paths are several MB
   if (
     plan_publisher_->is_activated() &&
     this->count_subscribers(plan_publisher_->get_topic_name()) > 0)
   {
-    plan_publisher_->publish(std::move(msg));
+    plan_publisher_->publish(std::make_unique<nav_msgs::msg::Path>(path));
   }
 }
 
 }  // namespace nav2_planner
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_planner::PlannerServer)
@@ -15,21 +15,27 @@
 #ifndef NAV2_RECOVERIES__RECOVERY_HPP_
 #define NAV2_RECOVERIES__RECOVERY_HPP_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <cmath>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <mutex>
 #include <thread>
 #include <utility>
 
 #include "rclcpp/rclcpp.hpp"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
+#include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/twist.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "nav2_util/robot_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "nav2_core/recovery.hpp"
+#include "nav2_recoveries/recovery_context.hpp"
 
 namespace nav2_recoveries
 {
@@ -44,7 +50,7 @@ enum class Status : int8_t
 using namespace std::chrono_literals;  //NOLINT
 
 template<typename ActionT>
-class Recovery : public nav2_core::Recovery
+class Recovery : public ContextRecovery
 {
 public:
   using ActionServer = nav2_util::SimpleActionServer<ActionT, rclcpp_lifecycle::LifecycleNode>;
@@ -105,9 +111,14 @@ public:
       node_, recovery_name_,
       std::bind(&Recovery::execute, this));
 
-    collision_checker_ = collision_checker;
-
-    vel_pub_ = node_->create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 1);
+    // Recoveries configured outside of a server run on a context of their own
+    owns_context_ = !context_;
+    if (owns_context_) {
+      context_ = std::make_shared<RecoveryContext>(node_, collision_checker, cycle_frequency_);
+    }
+    cycle_frequency_ = context_->cycleFrequency();
+    collision_checker_ = context_->collisionChecker();
+    vel_pub_ = context_->velocityPublisher();
 
     onConfigure();
   }
@@ -116,6 +127,8 @@ public:
   {
     action_server_.reset();
     vel_pub_.reset();
+    collision_checker_.reset();
+    context_.reset();
     onCleanup();
   }
 
@@ -123,16 +136,23 @@ public:
   {
     RCLCPP_INFO(node_->get_logger(), "Activating %s", recovery_name_.c_str());
 
-    vel_pub_->on_activate();
+    if (owns_context_) {
+      context_->activate();
+    }
     action_server_->activate();
     enabled_ = true;
   }
 
   void deactivate() override
   {
-    vel_pub_->on_deactivate();
-    action_server_->deactivate();
     enabled_ = false;
+    // Stop cycling a running recovery, for its goal to be terminated
+    context_->stop(this);
+    finishRun();
+    if (owns_context_) {
+      context_->deactivate();
+    }
+    action_server_->deactivate();
   }
 
 protected:
@@ -144,7 +164,8 @@ protected:
   std::shared_ptr<tf2_ros::Buffer> tf_;
 
   double cycle_frequency_;
-  double enabled_;
+  std::atomic<bool> enabled_;
+  bool owns_context_{false};
   std::string global_frame_;
   std::string robot_base_frame_;
   double transform_tolerance_;
@@ -152,6 +173,21 @@ protected:
   // Clock
   rclcpp::Clock steady_clock_{RCL_STEADY_TIME};
 
+  // Commands, filled in and published by the cycles without allocating
+  geometry_msgs::msg::Twist cmd_vel_;
+  const geometry_msgs::msg::Twist zero_cmd_vel_;
+  // Robot pose of the last cycle, looked up into the same message cycle after cycle
+  geometry_msgs::msg::PoseStamped current_pose_;
+
+  // The goal being run, the cycles of which end it from the context's timer
+  std::shared_ptr<typename ActionT::Result> result_;
+  rclcpp::Time start_time_;
+  std::mutex run_mutex_;
+  std::condition_variable run_cv_;
+  bool running_{false};
+
+  // Runs a goal on the worker thread of the action server, which waits for the cycles
+  // of the context's timer to end it
   void execute()
   {
     RCLCPP_INFO(node_->get_logger(), "Attempting %s", recovery_name_.c_str());
@@ -161,75 +197,111 @@ protected:
       return;
     }
 
-    if (onRun(action_server_->get_current_goal()) != Status::SUCCEEDED) {
+    Status status;
+    {
+      nav2_util::ScopedTrace trace("recovery.run", recovery_name_);
+      status = onRun(action_server_->get_current_goal());
+    }
+    if (status != Status::SUCCEEDED) {
       RCLCPP_INFO(node_->get_logger(), "Initial checks failed for %s", recovery_name_.c_str());
       action_server_->terminate_current();
       return;
     }
 
-    // Log a message every second
-    auto timer = node_->create_wall_timer(
-      1s,
-      [&]() {RCLCPP_INFO(node_->get_logger(), "%s running...", recovery_name_.c_str());});
-
-    auto start_time = steady_clock_.now();
+    start_time_ = steady_clock_.now();
 
     // Initialize the ActionT result
-    auto result = std::make_shared<typename ActionT::Result>();
-
-    rclcpp::Rate loop_rate(cycle_frequency_);
-
-    while (rclcpp::ok()) {
-      if (action_server_->is_cancel_requested()) {
-        RCLCPP_INFO(node_->get_logger(), "Canceling %s", recovery_name_.c_str());
-        stopRobot();
-        result->total_elapsed_time = steady_clock_.now() - start_time;
-        action_server_->terminate_all(result);
-        return;
-      }
-
-      // TODO(orduno) #868 Enable preempting a Recovery on-the-fly without stopping
-      if (action_server_->is_preempt_requested()) {
-        RCLCPP_ERROR(
-          node_->get_logger(), "Received a preemption request for %s,"
-          " however feature is currently not implemented. Aborting and stopping.",
-          recovery_name_.c_str());
-        stopRobot();
-        result->total_elapsed_time = steady_clock_.now() - start_time;
-        action_server_->terminate_current(result);
-        return;
-      }
-
-      switch (onCycleUpdate()) {
-        case Status::SUCCEEDED:
-          RCLCPP_INFO(node_->get_logger(), "%s completed successfully", recovery_name_.c_str());
-          result->total_elapsed_time = steady_clock_.now() - start_time;
-          action_server_->succeeded_current(result);
-          return;
-
-        case Status::FAILED:
-          RCLCPP_WARN(node_->get_logger(), "%s failed", recovery_name_.c_str());
-          result->total_elapsed_time = steady_clock_.now() - start_time;
-          action_server_->terminate_current(result);
-          return;
-
-        case Status::RUNNING:
-
-        default:
-          loop_rate.sleep();
-          break;
-      }
+    result_ = std::make_shared<typename ActionT::Result>();
+
+    {
+      std::lock_guard<std::mutex> lock(run_mutex_);
+      running_ = true;
     }
+    context_->start(this, [this]() {return cycle();});
+
+    std::unique_lock<std::mutex> lock(run_mutex_);
+    run_cv_.wait(lock, [this]() {return !running_;});
   }
 
-  void stopRobot()
+  // A cycle of the goal being run, false once it has ended it
+  bool cycle()
+  {
+    if (!rclcpp::ok() || !enabled_) {
+      finishRun();
+      return false;
+    }
+
+    if (action_server_->is_cancel_requested()) {
+      RCLCPP_INFO(node_->get_logger(), "Canceling %s", recovery_name_.c_str());
+      stopRobot();
+      result_->total_elapsed_time = steady_clock_.now() - start_time_;
+      action_server_->terminate_all(result_);
+      finishRun();
+      return false;
+    }
+
+    // TODO(orduno) #868 Enable preempting a Recovery on-the-fly without stopping
+    if (action_server_->is_preempt_requested()) {
+      RCLCPP_ERROR(
+        node_->get_logger(), "Received a preemption request for %s,"
+        " however feature is currently not implemented. Aborting and stopping.",
+        recovery_name_.c_str());
+      stopRobot();
+      result_->total_elapsed_time = steady_clock_.now() - start_time_;
+      action_server_->terminate_current(result_);
+      finishRun();
+      return false;
+    }
+
+    RCLCPP_INFO_THROTTLE(
+      node_->get_logger(), steady_clock_, 1000, "%s running...", recovery_name_.c_str());
+
+    Status status;
+    {
+      nav2_util::ScopedTrace trace("recovery.cycle", recovery_name_);
+      status = onCycleUpdate();
+    }
+    switch (status) {
+      case Status::SUCCEEDED:
+        RCLCPP_INFO(node_->get_logger(), "%s completed successfully", recovery_name_.c_str());
+        result_->total_elapsed_time = steady_clock_.now() - start_time_;
+        action_server_->succeeded_current(result_);
+        finishRun();
+        return false;
+
+      case Status::FAILED:
+        RCLCPP_WARN(node_->get_logger(), "%s failed", recovery_name_.c_str());
+        result_->total_elapsed_time = steady_clock_.now() - start_time_;
+        action_server_->terminate_current(result_);
+        finishRun();
+        return false;
+
+      case Status::RUNNING:
+
+      default:
+        return true;
+    }
+  }
+
+  // Let execute() return
+  void finishRun()
   {
-    auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>();
-    cmd_vel->linear.x = 0.0;
-    cmd_vel->linear.y = 0.0;
-    cmd_vel->angular.z = 0.0;
+    {
+      std::lock_guard<std::mutex> lock(run_mutex_);
+      running_ = false;
+    }
+    run_cv_.notify_all();
+  }
 
-    vel_pub_->publish(std::move(cmd_vel));
+  // Publish cmd_vel_
+  void publishCommand()
+  {
+    vel_pub_->publish(cmd_vel_);
+  }
+
+  void stopRobot()
+  {
+    vel_pub_->publish(zero_cmd_vel_);
   }
 };
 
@@ -0,0 +1,151 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_RECOVERIES__RECOVERY_CONTEXT_HPP_
+#define NAV2_RECOVERIES__RECOVERY_CONTEXT_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_lifecycle/lifecycle_node.hpp"
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav2_core/recovery.hpp"
+#include "nav2_costmap_2d/costmap_topic_collision_checker.hpp"
+
+namespace nav2_recoveries
+{
+
+/**
+ * @class nav2_recoveries::RecoveryContext
+ * @brief What the recoveries of a server share: the collision checker, with its decoded
+ * costmap and footprint masks, the cmd_vel publisher and the cycle running them
+ *
+ * The cycle is a single timer at cycle_frequency, which only exists while a recovery
+ * runs, so that idle recoveries cost nothing.
+ */
+class RecoveryContext
+{
+public:
+  /// One cycle of a running recovery, false once it is done
+  using Step = std::function<bool ()>;
+
+  RecoveryContext(
+    const rclcpp_lifecycle::LifecycleNode::SharedPtr & node,
+    std::shared_ptr<nav2_costmap_2d::CostmapTopicCollisionChecker> collision_checker,
+    double cycle_frequency)
+  : node_(node),
+    collision_checker_(std::move(collision_checker)),
+    cycle_frequency_(cycle_frequency)
+  {
+    vel_pub_ = node->create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 1);
+  }
+
+  ~RecoveryContext()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer_.reset();
+  }
+
+  const std::shared_ptr<nav2_costmap_2d::CostmapTopicCollisionChecker> &
+  collisionChecker() const {return collision_checker_;}
+
+  const rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr &
+  velocityPublisher() const {return vel_pub_;}
+
+  double cycleFrequency() const {return cycle_frequency_;}
+
+  void activate() {vel_pub_->on_activate();}
+
+  void deactivate() {vel_pub_->on_deactivate();}
+
+  /**
+   * @brief Run the first cycle of a recovery now, then one per period of the timer
+   * until it is done or stopped
+   * @param owner Identifies the recovery to stop()
+   */
+  void start(const void * owner, Step step)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!step()) {
+      return;
+    }
+    running_.emplace_back(owner, std::move(step));
+    if (!timer_) {
+      timer_ = node_->create_wall_timer(
+        std::chrono::duration<double>(1.0 / cycle_frequency_), [this]() {cycle();});
+    }
+  }
+
+  /// Stop the cycles of a recovery, none of them running once this returns
+  void stop(const void * owner)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_.erase(
+      std::remove_if(
+        running_.begin(), running_.end(),
+        [owner](const std::pair<const void *, Step> & entry) {return entry.first == owner;}),
+      running_.end());
+    if (running_.empty()) {
+      timer_.reset();
+    }
+  }
+
+protected:
+  void cycle()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_.erase(
+      std::remove_if(
+        running_.begin(), running_.end(),
+        [](std::pair<const void *, Step> & entry) {return !entry.second();}),
+      running_.end());
+    if (running_.empty()) {
+      // The executor holds the timer until this callback returns
+      timer_.reset();
+    }
+  }
+
+  rclcpp_lifecycle::LifecycleNode::SharedPtr node_;
+  std::shared_ptr<nav2_costmap_2d::CostmapTopicCollisionChecker> collision_checker_;
+  rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr vel_pub_;
+  double cycle_frequency_;
+
+  std::mutex mutex_;
+  std::vector<std::pair<const void *, Step>> running_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+
+/**
+ * @class nav2_recoveries::ContextRecovery
+ * @brief A recovery that can share the context of its server, given before it is
+ * configured. Without one, it makes a context of its own
+ */
+class ContextRecovery : public nav2_core::Recovery
+{
+public:
+  void setContext(std::shared_ptr<RecoveryContext> context) {context_ = std::move(context);}
+
+protected:
+  std::shared_ptr<RecoveryContext> context_;
+};
+
+}  // namespace nav2_recoveries
+
+#endif  // NAV2_RECOVERIES__RECOVERY_CONTEXT_HPP_
@@ -24,6 +24,7 @@
 #include "pluginlib/class_loader.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_core/recovery.hpp"
+#include "nav2_recoveries/recovery_context.hpp"
 
 #ifndef NAV2_RECOVERIES__RECOVERY_SERVER_HPP_
 #define NAV2_RECOVERIES__RECOVERY_SERVER_HPP_
@@ -34,7 +35,7 @@ namespace recovery_server
 class RecoveryServer : public nav2_util::LifecycleNode
 {
 public:
-  RecoveryServer();
+  explicit RecoveryServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~RecoveryServer();
 
   void loadRecoveryPlugins();
@@ -62,6 +63,8 @@ protected:
   std::unique_ptr<nav2_costmap_2d::CostmapSubscriber> costmap_sub_;
   std::unique_ptr<nav2_costmap_2d::FootprintSubscriber> footprint_sub_;
   std::shared_ptr<nav2_costmap_2d::CostmapTopicCollisionChecker> collision_checker_;
+  // Shared by the recoveries, with the cmd_vel publisher and the cycle timer
+  std::shared_ptr<nav2_recoveries::RecoveryContext> context_;
 
   double transform_tolerance_;
 };
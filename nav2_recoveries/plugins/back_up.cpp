@@ -12,13 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "back_up.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/se2.hpp"
 
 using namespace std::chrono_literals;
 
@@ -63,12 +67,15 @@ Status BackUp::onRun(const std::shared_ptr<const BackUpAction::Goal> command)
     return Status::FAILED;
   }
 
+  // One sweep pose per cycle at the commanded speed
+  sweep_step_ = std::max(command_speed_ / cycle_frequency_, 1e-3);
+  sweep_.clear();
   return Status::SUCCEEDED;
 }
 
 Status BackUp::onCycleUpdate()
 {
-  geometry_msgs::msg::PoseStamped current_pose;
+  geometry_msgs::msg::PoseStamped & current_pose = current_pose_;
   if (!nav2_util::getCurrentPose(
       current_pose, *tf_, global_frame_, robot_base_frame_,
       transform_tolerance_))
@@ -90,23 +97,21 @@ Status BackUp::onCycleUpdate()
   }
 
   // TODO(mhpanah): cmd_vel value should be passed as a parameter
-  auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>();
-  cmd_vel->linear.y = 0.0;
-  cmd_vel->angular.z = 0.0;
-  cmd_vel->linear.x = -command_speed_;
+  cmd_vel_ = zero_cmd_vel_;
+  cmd_vel_.linear.x = -command_speed_;
 
   geometry_msgs::msg::Pose2D pose2d;
   pose2d.x = current_pose.pose.position.x;
   pose2d.y = current_pose.pose.position.y;
-  pose2d.theta = tf2::getYaw(current_pose.pose.orientation);
+  pose2d.theta = nav2_util::se2::yaw(current_pose.pose.orientation);
 
-  if (!isCollisionFree(distance, cmd_vel.get(), pose2d)) {
+  if (!isCollisionFree(distance, &cmd_vel_, pose2d)) {
     stopRobot();
     RCLCPP_WARN(node_->get_logger(), "Collision Ahead - Exiting BackUp");
     return Status::SUCCEEDED;
   }
 
-  vel_pub_->publish(std::move(cmd_vel));
+  publishCommand();
 
   return Status::RUNNING;
 }
@@ -116,27 +121,38 @@ bool BackUp::isCollisionFree(
   geometry_msgs::msg::Twist * cmd_vel,
   geometry_msgs::msg::Pose2D & pose2d)
 {
-  // Simulate ahead by simulate_ahead_time_ in cycle_frequency_ increments
-  int cycle_count = 0;
-  double sim_position_change;
-  const double diff_dist = abs(command_x_) - distance;
-  const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
-
-  while (cycle_count < max_cycle_count) {
-    sim_position_change = cmd_vel->linear.x * (cycle_count / cycle_frequency_);
-    pose2d.x += sim_position_change * cos(pose2d.theta);
-    pose2d.y += sim_position_change * sin(pose2d.theta);
-    cycle_count++;
-
-    if (diff_dist - abs(sim_position_change) <= 0.) {
-      break;
-    }
+  // The sweep pose nearest to where the robot should be by now
+  const double progress = std::max(distance - sweep_offset_, 0.0);
+  std::size_t current = static_cast<std::size_t>(progress / sweep_step_ + 0.5);
 
-    if (!collision_checker_->isCollisionFree(pose2d)) {
+  if (!sweep_.covers(pose2d, current)) {
+    if (!buildSweep(pose2d, command_x_ - distance)) {
       return false;
     }
+    sweep_offset_ = distance;
+    current = 0;
   }
-  return true;
+
+  // Only check as far as the robot travels within simulate_ahead_time_
+  const double lookahead = std::fabs(cmd_vel->linear.x) * simulate_ahead_time_;
+  const std::size_t last =
+    current + 1 + static_cast<std::size_t>(std::ceil(lookahead / sweep_step_));
+  return collision_checker_->isCollisionFree(sweep_, current, last);
+}
+
+bool BackUp::buildSweep(const geometry_msgs::msg::Pose2D & start, double distance)
+{
+  distance = std::max(distance, 0.0);
+  const std::size_t steps = static_cast<std::size_t>(std::ceil(distance / sweep_step_));
+
+  std::vector<geometry_msgs::msg::Pose2D> poses(steps + 1, start);
+  for (std::size_t i = 1; i <= steps; ++i) {
+    const double travel = std::min(i * sweep_step_, distance);
+    poses[i].x = start.x - travel * std::cos(start.theta);
+    poses[i].y = start.y - travel * std::sin(start.theta);
+  }
+
+  return collision_checker_->buildSweep(poses, sweep_);
 }
 
 }  // namespace nav2_recoveries
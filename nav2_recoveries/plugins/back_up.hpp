@@ -20,6 +20,7 @@
 
 #include "nav2_recoveries/recovery.hpp"
 #include "nav2_msgs/action/back_up.hpp"
+#include "nav2_costmap_2d/footprint_sweep.hpp"
 
 namespace nav2_recoveries
 {
@@ -40,6 +41,8 @@ protected:
     const double & distance,
     geometry_msgs::msg::Twist * cmd_vel,
     geometry_msgs::msg::Pose2D & pose2d);
+  // Sweep the footprint backwards over the next distance meters, starting at start
+  bool buildSweep(const geometry_msgs::msg::Pose2D & start, double distance);
 
   void onConfigure() override;
 
@@ -53,6 +56,12 @@ protected:
   double simulate_ahead_time_;
 
   BackUpAction::Feedback::SharedPtr feedback_;
+
+  nav2_costmap_2d::FootprintSweep sweep_;
+  // Distance between consecutive sweep poses, and the distance already backed up when
+  // the sweep was built
+  double sweep_step_{0.0};
+  double sweep_offset_{0.0};
 };
 
 }  // namespace nav2_recoveries
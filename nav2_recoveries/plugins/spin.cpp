@@ -19,15 +19,13 @@
 #include <algorithm>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "spin.hpp"
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpedantic"
-#include "tf2/utils.h"
-#pragma GCC diagnostic pop
 #include "tf2/LinearMath/Quaternion.h"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/se2.hpp"
 
 using namespace std::chrono_literals;
 
@@ -37,7 +35,9 @@ namespace nav2_recoveries
 Spin::Spin()
 : Recovery<SpinAction>(),
   feedback_(std::make_shared<SpinAction::Feedback>()),
-  prev_yaw_(0.0)
+  prev_yaw_(0.0),
+  sweep_step_(0.0),
+  sweep_offset_(0.0)
 {
 }
 
@@ -79,19 +79,23 @@ Status Spin::onRun(const std::shared_ptr<const SpinAction::Goal> command)
     return Status::FAILED;
   }
 
-  prev_yaw_ = tf2::getYaw(current_pose.pose.orientation);
+  prev_yaw_ = nav2_util::se2::yaw(current_pose.pose.orientation);
   relative_yaw_ = 0.0;
 
   cmd_yaw_ = command->target_yaw;
   RCLCPP_INFO(
     node_->get_logger(), "Turning %0.2f for spin recovery.",
     cmd_yaw_);
+
+  // One sweep pose per cycle at full speed. It is rebuilt if the robot drifts off it.
+  sweep_step_ = std::max(max_rotational_vel_ / cycle_frequency_, 1e-3);
+  sweep_.clear();
   return Status::SUCCEEDED;
 }
 
 Status Spin::onCycleUpdate()
 {
-  geometry_msgs::msg::PoseStamped current_pose;
+  geometry_msgs::msg::PoseStamped & current_pose = current_pose_;
   if (!nav2_util::getCurrentPose(
       current_pose, *tf_, global_frame_, robot_base_frame_,
       transform_tolerance_))
@@ -100,7 +104,7 @@ Status Spin::onCycleUpdate()
     return Status::FAILED;
   }
 
-  const double current_yaw = tf2::getYaw(current_pose.pose.orientation);
+  const double current_yaw = nav2_util::se2::yaw(current_pose.pose.orientation);
 
   double delta_yaw = current_yaw - prev_yaw_;
   if (abs(delta_yaw) > M_PI) {
@@ -122,21 +126,21 @@ Status Spin::onCycleUpdate()
   double vel = sqrt(2 * rotational_acc_lim_ * remaining_yaw);
   vel = std::min(std::max(vel, min_rotational_vel_), max_rotational_vel_);
 
-  auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>();
-  cmd_vel->angular.z = copysign(vel, cmd_yaw_);
+  cmd_vel_ = zero_cmd_vel_;
+  cmd_vel_.angular.z = copysign(vel, cmd_yaw_);
 
   geometry_msgs::msg::Pose2D pose2d;
   pose2d.x = current_pose.pose.position.x;
   pose2d.y = current_pose.pose.position.y;
-  pose2d.theta = tf2::getYaw(current_pose.pose.orientation);
+  pose2d.theta = current_yaw;
 
-  if (!isCollisionFree(relative_yaw_, cmd_vel.get(), pose2d)) {
+  if (!isCollisionFree(relative_yaw_, &cmd_vel_, pose2d)) {
     stopRobot();
     RCLCPP_WARN(node_->get_logger(), "Collision Ahead - Exiting Spin");
     return Status::SUCCEEDED;
   }
 
-  vel_pub_->publish(std::move(cmd_vel));
+  publishCommand();
 
   return Status::RUNNING;
 }
@@ -146,25 +150,36 @@ bool Spin::isCollisionFree(
   geometry_msgs::msg::Twist * cmd_vel,
   geometry_msgs::msg::Pose2D & pose2d)
 {
-  // Simulate ahead by simulate_ahead_time_ in cycle_frequency_ increments
-  int cycle_count = 0;
-  double sim_position_change;
-  const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
-
-  while (cycle_count < max_cycle_count) {
-    sim_position_change = cmd_vel->angular.z * (cycle_count / cycle_frequency_);
-    pose2d.theta += sim_position_change;
-    cycle_count++;
-
-    if (abs(relative_yaw) - abs(sim_position_change) <= 0.) {
-      break;
-    }
+  // The sweep pose nearest to where the robot should be by now
+  const double progress = std::max(std::fabs(relative_yaw) - sweep_offset_, 0.0);
+  std::size_t current = static_cast<std::size_t>(progress / sweep_step_ + 0.5);
 
-    if (!collision_checker_->isCollisionFree(pose2d)) {
+  if (!sweep_.covers(pose2d, current)) {
+    if (!buildSweep(pose2d, std::fabs(cmd_yaw_) - std::fabs(relative_yaw))) {
       return false;
     }
+    sweep_offset_ = std::fabs(relative_yaw);
+    current = 0;
+  }
+
+  // Only check as far as the robot turns within simulate_ahead_time_
+  const double lookahead = std::fabs(cmd_vel->angular.z) * simulate_ahead_time_;
+  const std::size_t last =
+    current + 1 + static_cast<std::size_t>(std::ceil(lookahead / sweep_step_));
+  return collision_checker_->isCollisionFree(sweep_, current, last);
+}
+
+bool Spin::buildSweep(const geometry_msgs::msg::Pose2D & start, double yaw)
+{
+  yaw = std::max(yaw, 0.0);
+  const std::size_t steps = static_cast<std::size_t>(std::ceil(yaw / sweep_step_));
+
+  std::vector<geometry_msgs::msg::Pose2D> poses(steps + 1, start);
+  for (std::size_t i = 1; i <= steps; ++i) {
+    poses[i].theta = start.theta + copysign(std::min(i * sweep_step_, yaw), cmd_yaw_);
   }
-  return true;
+
+  return collision_checker_->buildSweep(poses, sweep_);
 }
 
 }  // namespace nav2_recoveries
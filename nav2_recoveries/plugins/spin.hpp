@@ -22,6 +22,7 @@
 #include "nav2_recoveries/recovery.hpp"
 #include "nav2_msgs/action/spin.hpp"
 #include "geometry_msgs/msg/quaternion.hpp"
+#include "nav2_costmap_2d/footprint_sweep.hpp"
 
 namespace nav2_recoveries
 {
@@ -42,8 +43,14 @@ protected:
     const double & distance,
     geometry_msgs::msg::Twist * cmd_vel,
     geometry_msgs::msg::Pose2D & pose2d);
+  // Sweep the footprint over the next yaw radians of the spin, starting at start
+  bool buildSweep(const geometry_msgs::msg::Pose2D & start, double yaw);
 
   SpinAction::Feedback::SharedPtr feedback_;
+  nav2_costmap_2d::FootprintSweep sweep_;
+  // Yaw between consecutive sweep poses, and the spin already done when it was built
+  double sweep_step_;
+  double sweep_offset_;
 
   double min_rotational_vel_;
   double max_rotational_vel_;
@@ -13,17 +13,20 @@
 // limitations under the License. Reserved.
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <utility>
+#include <algorithm>
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/shared_tf_buffer.hpp"
 #include "nav2_recoveries/recovery_server.hpp"
 
 namespace recovery_server
 {
 
-RecoveryServer::RecoveryServer()
-: LifecycleNode("recoveries_server", "", true),
+RecoveryServer::RecoveryServer(const rclcpp::NodeOptions & options)
+: LifecycleNode("recoveries_server", "", true, options),
   plugin_loader_("nav2_core", "nav2_core::Recovery"),
   default_ids_{"spin", "backup", "wait"},
   default_types_{"nav2_recoveries/Spin", "nav2_recoveries/BackUp", "nav2_recoveries/Wait"}
@@ -31,10 +34,12 @@ RecoveryServer::RecoveryServer()
   declare_parameter(
     "costmap_topic",
     rclcpp::ParameterValue(std::string("local_costmap/costmap_raw")));
+  declare_parameter("costmap_transport", rclcpp::ParameterValue(std::string("raw")));
   declare_parameter(
     "footprint_topic",
     rclcpp::ParameterValue(std::string("local_costmap/published_footprint")));
   declare_parameter("cycle_frequency", rclcpp::ParameterValue(10.0));
+  declare_parameter("share_tf_buffer", rclcpp::ParameterValue(false));
   declare_parameter("recovery_plugins", default_ids_);
 
   get_parameter("recovery_plugins", recovery_ids_);
@@ -53,6 +58,7 @@ RecoveryServer::RecoveryServer()
   declare_parameter(
     "transform_tolerance",
     rclcpp::ParameterValue(0.1));
+  declare_parameter("footprint_mask_yaw_bins", rclcpp::ParameterValue(0));
 }
 
 
@@ -65,28 +71,49 @@ RecoveryServer::on_configure(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Configuring");
 
-  tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
-  auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
-    get_node_base_interface(),
-    get_node_timers_interface());
-  tf_->setCreateTimerInterface(timer_interface);
-  transform_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_);
+  if (get_parameter("share_tf_buffer").as_bool()) {
+    tf_ = nav2_util::getSharedTfBuffer(get_parameter("use_sim_time").as_bool());
+  } else {
+    tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      get_node_base_interface(),
+      get_node_timers_interface());
+    tf_->setCreateTimerInterface(timer_interface);
+    transform_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_);
+  }
 
   std::string costmap_topic, footprint_topic;
   this->get_parameter("costmap_topic", costmap_topic);
   this->get_parameter("footprint_topic", footprint_topic);
+  std::string costmap_transport;
+  this->get_parameter("costmap_transport", costmap_transport);
   this->get_parameter("transform_tolerance", transform_tolerance_);
+  nav2_costmap_2d::CostmapSubscriber::Transport transport;
+  try {
+    transport = nav2_costmap_2d::CostmapSubscriber::transportFromString(costmap_transport);
+  } catch (const std::invalid_argument & ex) {
+    RCLCPP_ERROR(get_logger(), "%s", ex.what());
+    return nav2_util::CallbackReturn::FAILURE;
+  }
   costmap_sub_ = std::make_unique<nav2_costmap_2d::CostmapSubscriber>(
-    shared_from_this(), costmap_topic);
+    shared_from_this(), costmap_topic, transport);
   footprint_sub_ = std::make_unique<nav2_costmap_2d::FootprintSubscriber>(
     shared_from_this(), footprint_topic, 1.0);
 
   std::string global_frame, robot_base_frame;
   get_parameter("global_frame", global_frame);
   get_parameter("robot_base_frame", robot_base_frame);
+  int footprint_mask_yaw_bins;
+  get_parameter("footprint_mask_yaw_bins", footprint_mask_yaw_bins);
   collision_checker_ = std::make_shared<nav2_costmap_2d::CostmapTopicCollisionChecker>(
     *costmap_sub_, *footprint_sub_, *tf_, this->get_name(),
-    global_frame, robot_base_frame, transform_tolerance_);
+    global_frame, robot_base_frame, transform_tolerance_,
+    static_cast<unsigned int>(std::max(footprint_mask_yaw_bins, 0)));
+
+  double cycle_frequency;
+  get_parameter("cycle_frequency", cycle_frequency);
+  context_ = std::make_shared<nav2_recoveries::RecoveryContext>(
+    shared_from_this(), collision_checker_, cycle_frequency);
 
   recovery_types_.resize(recovery_ids_.size());
   loadRecoveryPlugins();
@@ -107,6 +134,11 @@ RecoveryServer::loadRecoveryPlugins()
         get_logger(), "Creating recovery plugin %s of type %s",
         recovery_ids_[i].c_str(), recovery_types_[i].c_str());
       recoveries_.push_back(plugin_loader_.createUniqueInstance(recovery_types_[i]));
+      // Recoveries of other bases keep their own publisher and loop
+      auto shared = dynamic_cast<nav2_recoveries::ContextRecovery *>(recoveries_.back().get());
+      if (shared) {
+        shared->setContext(context_);
+      }
       recoveries_.back()->configure(node, recovery_ids_[i], tf_, collision_checker_);
     } catch (const pluginlib::PluginlibException & ex) {
       RCLCPP_FATAL(
@@ -122,6 +154,7 @@ nav2_util::CallbackReturn
 RecoveryServer::on_activate(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Activating");
+  context_->activate();
   std::vector<pluginlib::UniquePtr<nav2_core::Recovery>>::iterator iter;
   for (iter = recoveries_.begin(); iter != recoveries_.end(); ++iter) {
     (*iter)->activate();
@@ -142,6 +175,7 @@ RecoveryServer::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   for (iter = recoveries_.begin(); iter != recoveries_.end(); ++iter) {
     (*iter)->deactivate();
   }
+  context_->deactivate();
 
   // destroy bond connection
   destroyBond();
@@ -160,6 +194,7 @@ RecoveryServer::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   }
 
   recoveries_.clear();
+  context_.reset();
   transform_listener_.reset();
   tf_.reset();
   footprint_sub_.reset();
@@ -177,3 +212,7 @@ RecoveryServer::on_shutdown(const rclcpp_lifecycle::State &)
 }
 
 }  // end namespace recovery_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(recovery_server::RecoveryServer)
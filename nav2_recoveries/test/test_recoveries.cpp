@@ -253,6 +253,14 @@ TEST_F(RecoveryTest, testingTotalElapsedTimeIsZeroIfFailureOnRun)
   SUCCEED();
 }
 
+TEST_F(RecoveryTest, testingDeactivateEndsRunningGoal)
+{
+  ASSERT_TRUE(sendCommand("Testing success"));
+  recovery_->deactivate();
+  EXPECT_EQ(getOutcome(), Status::FAILED);
+  SUCCEED();
+}
+
 int main(int argc, char ** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -16,9 +16,9 @@
 #define NAV2_RVIZ_PLUGINS__NAV2_PANEL_HPP_
 
 #include <QtWidgets>
-#include <QBasicTimer>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -32,6 +32,7 @@
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "visualization_msgs/msg/marker_array.hpp"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/node_thread.hpp"
 
 class QPushButton;
 
@@ -69,7 +70,6 @@ private Q_SLOTS:
 private:
   void loadLogFiles();
   void onCancelButtonPressed();
-  void timerEvent(QTimerEvent * event) override;
 
   int unique_id {0};
 
@@ -81,11 +81,12 @@ private:
   using WaypointFollowerGoalHandle =
     rclcpp_action::ClientGoalHandle<nav2_msgs::action::FollowWaypoints>;
 
-  // The (non-spinning) client node used to invoke the action client
+  // The client node used to invoke the action client
   rclcpp::Node::SharedPtr client_node_;
 
-  // A timer used to check on the completion status of the action
-  QBasicTimer timer_;
+  // Spins client_node_, the action callbacks post their state changes to the state machine
+  // from there, so the Qt thread never waits on the network
+  std::unique_ptr<nav2_util::NodeThread> client_node_thread_;
 
   // The NavigateToPose action client
   rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SharedPtr navigation_action_client_;
@@ -97,6 +98,7 @@ private:
   nav2_msgs::action::FollowWaypoints::Goal waypoint_follower_goal_;
   NavigationGoalHandle::SharedPtr navigation_goal_handle_;
   WaypointFollowerGoalHandle::SharedPtr waypoint_follower_goal_handle_;
+  std::mutex goal_handles_mutex_;  ///< Handles are set from client_node_thread_
 
   // The client used to control the nav2 stack
   nav2_lifecycle_manager::LifecycleManagerClient client_nav_;
@@ -287,6 +287,8 @@ Nav2Panel::Nav2Panel(QWidget * parent)
     "waypoints",
     rclcpp::QoS(1).transient_local());
 
+  client_node_thread_ = std::make_unique<nav2_util::NodeThread>(client_node_);
+
   QObject::connect(
     &GoalUpdater, SIGNAL(updateGoal(double,double,double,QString)),                 // NOLINT
     this, SLOT(onNewGoal(double,double,double,QString)));  // NOLINT
@@ -294,6 +296,8 @@ Nav2Panel::Nav2Panel(QWidget * parent)
 
 Nav2Panel::~Nav2Panel()
 {
+  // The action callbacks use the panel, stop them before anything else goes
+  client_node_thread_.reset();
 }
 
 void
@@ -367,17 +371,12 @@ Nav2Panel::onShutdown()
     std::bind(
       &nav2_lifecycle_manager::LifecycleManagerClient::reset,
       &client_loc_));
-  timer_.stop();
 }
 
 void
 Nav2Panel::onCancel()
 {
-  QFuture<void> future =
-    QtConcurrent::run(
-    std::bind(
-      &Nav2Panel::onCancelButtonPressed,
-      this));
+  onCancelButtonPressed();
 }
 
 void
@@ -405,28 +404,31 @@ Nav2Panel::onNewGoal(double x, double y, double theta, QString frame)
 void
 Nav2Panel::onCancelButtonPressed()
 {
+  // The cancellations complete on client_node_thread_, and the result callbacks move the
+  // state machine out of running
+  using CancelResponse = action_msgs::srv::CancelGoal::Response;
+  std::lock_guard<std::mutex> lock(goal_handles_mutex_);
   if (state_machine_.configuration().contains(accumulating_)) {
-    auto future_cancel =
-      waypoint_follower_action_client_->async_cancel_goal(waypoint_follower_goal_handle_);
-
-    if (rclcpp::spin_until_future_complete(client_node_, future_cancel) !=
-      rclcpp::FutureReturnCode::SUCCESS)
-    {
-      RCLCPP_ERROR(client_node_->get_logger(), "Failed to cancel waypoint follower");
-      return;
+    if (waypoint_follower_goal_handle_) {
+      waypoint_follower_action_client_->async_cancel_goal(
+        waypoint_follower_goal_handle_,
+        [this](CancelResponse::SharedPtr response) {
+          if (!response || response->return_code != CancelResponse::ERROR_NONE) {
+            RCLCPP_ERROR(client_node_->get_logger(), "Failed to cancel waypoint follower");
+          }
+        });
     }
   } else {
-    auto future_cancel = navigation_action_client_->async_cancel_goal(navigation_goal_handle_);
-
-    if (rclcpp::spin_until_future_complete(client_node_, future_cancel) !=
-      rclcpp::FutureReturnCode::SUCCESS)
-    {
-      RCLCPP_ERROR(client_node_->get_logger(), "Failed to cancel goal");
-      return;
+    if (navigation_goal_handle_) {
+      navigation_action_client_->async_cancel_goal(
+        navigation_goal_handle_,
+        [this](CancelResponse::SharedPtr response) {
+          if (!response || response->return_code != CancelResponse::ERROR_NONE) {
+            RCLCPP_ERROR(client_node_->get_logger(), "Failed to cancel goal");
+          }
+        });
     }
   }
-
-  timer_.stop();
 }
 
 void
@@ -443,63 +445,14 @@ Nav2Panel::onAccumulating()
   acummulated_poses_.clear();
 }
 
-void
-Nav2Panel::timerEvent(QTimerEvent * event)
-{
-  if (state_machine_.configuration().contains(accumulating_)) {
-    if (event->timerId() == timer_.timerId()) {
-      if (!waypoint_follower_goal_handle_) {
-        RCLCPP_DEBUG(client_node_->get_logger(), "Waiting for Goal");
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
-        return;
-      }
-
-      rclcpp::spin_some(client_node_);
-      auto status = waypoint_follower_goal_handle_->get_status();
-
-      // Check if the goal is still executing
-      if (status == action_msgs::msg::GoalStatus::STATUS_ACCEPTED ||
-        status == action_msgs::msg::GoalStatus::STATUS_EXECUTING)
-      {
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::ACTIVE));
-      } else {
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
-        timer_.stop();
-      }
-    }
-  } else {
-    if (event->timerId() == timer_.timerId()) {
-      if (!navigation_goal_handle_) {
-        RCLCPP_DEBUG(client_node_->get_logger(), "Waiting for Goal");
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
-        return;
-      }
-
-      rclcpp::spin_some(client_node_);
-      auto status = navigation_goal_handle_->get_status();
-
-      // Check if the goal is still executing
-      if (status == action_msgs::msg::GoalStatus::STATUS_ACCEPTED ||
-        status == action_msgs::msg::GoalStatus::STATUS_EXECUTING)
-      {
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::ACTIVE));
-      } else {
-        state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
-        timer_.stop();
-      }
-    }
-  }
-}
-
 void
 Nav2Panel::startWaypointFollowing(std::vector<geometry_msgs::msg::PoseStamped> poses)
 {
-  auto is_action_server_ready =
-    waypoint_follower_action_client_->wait_for_action_server(std::chrono::seconds(5));
-  if (!is_action_server_ready) {
+  if (!waypoint_follower_action_client_->action_server_is_ready()) {
     RCLCPP_ERROR(
       client_node_->get_logger(), "FollowWaypoints action server is not available."
       " Is the initial pose set?");
+    state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
     return;
   }
 
@@ -515,68 +468,65 @@ Nav2Panel::startWaypointFollowing(std::vector<geometry_msgs::msg::PoseStamped> p
       "\t(%lf, %lf)", waypoint.pose.position.x, waypoint.pose.position.y);
   }
 
-  // Enable result awareness by providing an empty lambda function
+  // The goal response and the result update the state machine as they arrive
   auto send_goal_options =
     rclcpp_action::Client<nav2_msgs::action::FollowWaypoints>::SendGoalOptions();
-  send_goal_options.result_callback = [](auto) {};
-
-  auto future_goal_handle =
-    waypoint_follower_action_client_->async_send_goal(waypoint_follower_goal_, send_goal_options);
-  if (rclcpp::spin_until_future_complete(client_node_, future_goal_handle) !=
-    rclcpp::FutureReturnCode::SUCCESS)
-  {
-    RCLCPP_ERROR(client_node_->get_logger(), "Send goal call failed");
-    return;
-  }
-
-  // Get the goal handle and save so that we can check on completion in the timer callback
-  waypoint_follower_goal_handle_ = future_goal_handle.get();
-  if (!waypoint_follower_goal_handle_) {
-    RCLCPP_ERROR(client_node_->get_logger(), "Goal was rejected by server");
-    return;
-  }
-
-  timer_.start(200, this);
+  send_goal_options.goal_response_callback =
+    [this](std::shared_future<WaypointFollowerGoalHandle::SharedPtr> future) {
+      auto goal_handle = future.get();
+      {
+        std::lock_guard<std::mutex> lock(goal_handles_mutex_);
+        waypoint_follower_goal_handle_ = goal_handle;
+      }
+      if (!goal_handle) {
+        RCLCPP_ERROR(client_node_->get_logger(), "Goal was rejected by server");
+      }
+      state_machine_.postEvent(
+        new ROSActionQEvent(goal_handle ? QActionState::ACTIVE : QActionState::INACTIVE));
+    };
+  send_goal_options.result_callback = [this](const WaypointFollowerGoalHandle::WrappedResult &) {
+      state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
+    };
+
+  waypoint_follower_action_client_->async_send_goal(waypoint_follower_goal_, send_goal_options);
 }
 
 void
 Nav2Panel::startNavigation(geometry_msgs::msg::PoseStamped pose)
 {
-  auto is_action_server_ready =
-    navigation_action_client_->wait_for_action_server(std::chrono::seconds(5));
-  if (!is_action_server_ready) {
+  if (!navigation_action_client_->action_server_is_ready()) {
     RCLCPP_ERROR(
       client_node_->get_logger(),
       "FollowWaypoints action server is not available."
       " Is the initial pose set?");
+    state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
     return;
   }
 
   // Send the goal pose
   navigation_goal_.pose = pose;
 
-  // Enable result awareness by providing an empty lambda function
+  // The goal response and the result update the state machine as they arrive
   auto send_goal_options =
     rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SendGoalOptions();
-  send_goal_options.result_callback = [](auto) {};
-
-  auto future_goal_handle =
-    navigation_action_client_->async_send_goal(navigation_goal_, send_goal_options);
-  if (rclcpp::spin_until_future_complete(client_node_, future_goal_handle) !=
-    rclcpp::FutureReturnCode::SUCCESS)
-  {
-    RCLCPP_ERROR(client_node_->get_logger(), "Send goal call failed");
-    return;
-  }
-
-  // Get the goal handle and save so that we can check on completion in the timer callback
-  navigation_goal_handle_ = future_goal_handle.get();
-  if (!navigation_goal_handle_) {
-    RCLCPP_ERROR(client_node_->get_logger(), "Goal was rejected by server");
-    return;
-  }
-
-  timer_.start(200, this);
+  send_goal_options.goal_response_callback =
+    [this](std::shared_future<NavigationGoalHandle::SharedPtr> future) {
+      auto goal_handle = future.get();
+      {
+        std::lock_guard<std::mutex> lock(goal_handles_mutex_);
+        navigation_goal_handle_ = goal_handle;
+      }
+      if (!goal_handle) {
+        RCLCPP_ERROR(client_node_->get_logger(), "Goal was rejected by server");
+      }
+      state_machine_.postEvent(
+        new ROSActionQEvent(goal_handle ? QActionState::ACTIVE : QActionState::INACTIVE));
+    };
+  send_goal_options.result_callback = [this](const NavigationGoalHandle::WrappedResult &) {
+      state_machine_.postEvent(new ROSActionQEvent(QActionState::INACTIVE));
+    };
+
+  navigation_action_client_->async_send_goal(navigation_goal_, send_goal_options);
 }
 
 void
@@ -0,0 +1,115 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License. Reserved.
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "planner_tester.hpp"
+
+using nav2_system_tests::PlannerBenchmarkOptions;
+using nav2_system_tests::PlannerTester;
+
+namespace
+{
+
+const char USAGE[] =
+  "Usage: planner_benchmark [--sizes 1000,2000,...] [--densities 0.0,0.05,...]\n"
+  "  [--planners GridBased,...] [--queries <n>] [--resolution <m>] [--seed <n>]\n"
+  "  [--csv <file>] [--json <file>] [--ros-args -p planner_plugins:=...]\n";
+
+template<typename T>
+std::vector<T> parseList(const std::string & value)
+{
+  std::vector<T> list;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    std::stringstream item_stream(item);
+    T parsed;
+    if (!(item_stream >> parsed)) {
+      throw std::invalid_argument("can't parse " + item);
+    }
+    list.push_back(parsed);
+  }
+  return list;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  const std::vector<std::string> args = rclcpp::remove_ros_arguments(argc, argv);
+
+  PlannerBenchmarkOptions options;
+  std::string csv_file, json_file;
+  try {
+    for (std::size_t i = 1; i < args.size(); ++i) {
+      const std::string & arg = args[i];
+      if (i + 1 == args.size()) {
+        throw std::invalid_argument(arg + " needs a value");
+      }
+      const std::string & value = args[++i];
+      if (arg == "--sizes") {
+        options.map_sizes = parseList<unsigned int>(value);
+      } else if (arg == "--densities") {
+        options.obstacle_densities = parseList<double>(value);
+      } else if (arg == "--planners") {
+        options.planner_ids = parseList<std::string>(value);
+      } else if (arg == "--queries") {
+        options.queries = std::stoul(value);
+      } else if (arg == "--resolution") {
+        options.resolution = std::stod(value);
+      } else if (arg == "--seed") {
+        options.seed = std::stoul(value);
+      } else if (arg == "--csv") {
+        csv_file = value;
+      } else if (arg == "--json") {
+        json_file = value;
+      } else {
+        throw std::invalid_argument("unknown option " + arg);
+      }
+    }
+  } catch (const std::exception & ex) {
+    std::cerr << ex.what() << "\n" << USAGE;
+    rclcpp::shutdown();
+    return 2;
+  }
+
+  auto tester = std::make_shared<PlannerTester>();
+  tester->activate();
+  auto results = tester->plannerBenchmark(options);
+  tester->deactivate();
+
+  if (csv_file.empty() && json_file.empty()) {
+    PlannerTester::writeBenchmarkCsv(std::cout, results);
+  }
+  if (!csv_file.empty()) {
+    std::ofstream csv(csv_file);
+    PlannerTester::writeBenchmarkCsv(csv, results);
+  }
+  if (!json_file.empty()) {
+    std::ofstream json(json_file);
+    PlannerTester::writeBenchmarkJson(json, results);
+  }
+
+  rclcpp::shutdown();
+  return results.empty() ? 1 : 0;
+}
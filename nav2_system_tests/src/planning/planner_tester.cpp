@@ -22,12 +22,17 @@
 #include <chrono>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <future>
+#include <cmath>
 
 #include "planner_tester.hpp"
 #include "geometry_msgs/msg/twist.hpp"
+#include "nav2_benchmarks/synthetic_maps.hpp"
 #include "nav2_map_server/map_mode.hpp"
 #include "nav2_map_server/map_io.hpp"
 #include "nav2_msgs/msg/costmap_meta_data.hpp"
+#include "nav2_navfn_planner/navfn_planner.hpp"
 
 using namespace std::chrono_literals;
 using namespace std::chrono;  // NOLINT
@@ -47,7 +52,7 @@ PlannerTester::PlannerTester()
 {
 }
 
-void PlannerTester::activate()
+void PlannerTester::activate(int concurrent_planners)
 {
   if (is_active_) {
     throw std::runtime_error("Trying to activate while already active");
@@ -73,6 +78,9 @@ void PlannerTester::activate()
     rclcpp::Parameter(std::string("GridBased.use_astar"), rclcpp::ParameterValue(true)));
   planner_tester_->set_parameter(
     rclcpp::Parameter(std::string("expected_planner_frequency"), rclcpp::ParameterValue(-1.0)));
+  planner_tester_->set_parameter(
+    rclcpp::Parameter(
+      std::string("concurrent_planners"), rclcpp::ParameterValue(concurrent_planners)));
   planner_tester_->onConfigure(state);
   publishRobotTransform();
   map_pub_ = this->create_publisher<nav_msgs::msg::OccupancyGrid>("map", 1);
@@ -354,6 +362,298 @@ bool PlannerTester::defaultPlannerRandomTests(
   return true;
 }
 
+bool PlannerTester::concurrentPlannerTest()
+{
+  using ActionT = nav2_msgs::action::ComputePathToPose;
+  using GoalHandle = rclcpp_action::ClientGoalHandle<ActionT>;
+
+  if (!is_active_ || !map_set_) {
+    RCLCPP_ERROR(this->get_logger(), "The tester must be active with the default map loaded");
+    return false;
+  }
+
+  auto client = rclcpp_action::create_client<ActionT>(
+    get_node_base_interface(), get_node_graph_interface(), get_node_logging_interface(),
+    get_node_waitables_interface(), "compute_path_to_pose_concurrent");
+  if (!client->wait_for_action_server(10s)) {
+    RCLCPP_ERROR(this->get_logger(), "Concurrent planning action server not available");
+    return false;
+  }
+
+  // The end points of the default test, planned both ways so that the paths overlap
+  auto pose = [](double x, double y) {
+      ComputePathToPoseCommand pose;
+      pose.header.frame_id = "map";
+      pose.pose.position.x = x;
+      pose.pose.position.y = y;
+      pose.pose.orientation.w = 1.0;
+      return pose;
+    };
+  const std::vector<std::pair<ComputePathToPoseCommand, ComputePathToPoseCommand>> queries = {
+    {pose(390.0, 10.0), pose(10.0, 390.0)},
+    {pose(10.0, 390.0), pose(390.0, 10.0)}};
+
+  // This node is spun by its own thread, so the futures are only waited on
+  auto send_goals = [&]() {
+      std::vector<GoalHandle::SharedPtr> handles;
+      for (const auto & query : queries) {
+        ActionT::Goal goal;
+        goal.start = query.first;
+        goal.pose = query.second;
+        goal.use_start = true;
+        goal.planner_id = "GridBased";
+        auto future = client->async_send_goal(goal);
+        bool sent = future.wait_for(5s) == std::future_status::ready;
+        handles.push_back(sent ? future.get() : nullptr);
+      }
+      return handles;
+    };
+  auto get_result = [&](const GoalHandle::SharedPtr & handle) {
+      GoalHandle::WrappedResult result;
+      result.code = rclcpp_action::ResultCode::UNKNOWN;
+      if (handle) {
+        auto future = client->async_get_result(handle);
+        if (future.wait_for(30s) == std::future_status::ready) {
+          result = future.get();
+        }
+      }
+      return result;
+    };
+  auto is_valid = [&](std::size_t query, const GoalHandle::WrappedResult & result) {
+      if (result.code != rclcpp_action::ResultCode::SUCCEEDED ||
+        result.result->path.poses.empty())
+      {
+        return false;
+      }
+      const auto & path = result.result->path;
+      return isCollisionFree(path) &&
+             isWithinTolerance(queries[query].first.pose.position, queries[query].second, path);
+    };
+
+  // The costmap of the planner takes the map from one of its next publications
+  bool planned = false;
+  for (int attempt = 0; attempt != 3 && !planned; ++attempt) {
+    std::this_thread::sleep_for(1s);
+    auto handles = send_goals();
+    planned = true;
+    for (std::size_t i = 0; i != handles.size(); ++i) {
+      planned = is_valid(i, get_result(handles[i])) && planned;
+    }
+  }
+  if (!planned) {
+    RCLCPP_ERROR(this->get_logger(), "Overlapping concurrent goals were not both planned");
+    return false;
+  }
+
+  // Canceling the first goal leaves the second one alone. The first may have
+  // been planned before the cancel reached it, its path must then be valid too
+  auto handles = send_goals();
+  if (!handles[0] || !handles[1]) {
+    RCLCPP_ERROR(this->get_logger(), "Concurrent goals were rejected");
+    return false;
+  }
+  auto cancel = client->async_cancel_goal(handles[0]);
+  if (cancel.wait_for(5s) != std::future_status::ready) {
+    RCLCPP_ERROR(this->get_logger(), "Canceling a concurrent goal timed out");
+    return false;
+  }
+  auto canceled = get_result(handles[0]);
+  if (canceled.code != rclcpp_action::ResultCode::CANCELED && !is_valid(0, canceled)) {
+    RCLCPP_ERROR(this->get_logger(), "Canceled concurrent goal neither canceled nor planned");
+    return false;
+  }
+  if (!is_valid(1, get_result(handles[1]))) {
+    RCLCPP_ERROR(this->get_logger(), "Canceling a concurrent goal affected another one");
+    return false;
+  }
+
+  return true;
+}
+
+namespace
+{
+
+// Peak resident size of the process in kB, from /proc, or -1 if unknown
+int64_t peakMemoryKb()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoll(line.substr(6));
+    }
+  }
+  return -1;
+}
+
+// Restart the peak from the current resident size, the peak stays the one of
+// the whole process where the kernel does not support it
+void resetPeakMemory()
+{
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+double pathLength(const nav_msgs::msg::Path & path)
+{
+  double length = 0.0;
+  for (std::size_t i = 1; i < path.poses.size(); ++i) {
+    length += std::hypot(
+      path.poses[i].pose.position.x - path.poses[i - 1].pose.position.x,
+      path.poses[i].pose.position.y - path.poses[i - 1].pose.position.y);
+  }
+  return length;
+}
+
+}  // namespace
+
+std::vector<PlannerBenchmarkResult> PlannerTester::plannerBenchmark(
+  const PlannerBenchmarkOptions & options)
+{
+  std::vector<PlannerBenchmarkResult> results;
+  if (!is_active_) {
+    RCLCPP_ERROR(this->get_logger(), "The tester must be active to run the benchmark");
+    return results;
+  }
+
+  std::vector<std::string> planner_ids = options.planner_ids;
+  if (planner_ids.empty()) {
+    planner_ids = planner_tester_->getPlannerIds();
+  }
+
+  for (unsigned int size : options.map_sizes) {
+    for (std::size_t d = 0; d < options.obstacle_densities.size(); ++d) {
+      const double density = options.obstacle_densities[d];
+      const uint32_t seed = options.seed + size + static_cast<uint32_t>(d);
+      std::vector<unsigned char> grid = nav2_benchmarks::randomObstacles(
+        size, size, density, 4, seed);
+      if (std::find(grid.begin(), grid.end(), nav2_benchmarks::FREE_CELL) == grid.end()) {
+        RCLCPP_WARN(this->get_logger(), "No free cell to plan from at density %.2f", density);
+        continue;
+      }
+      planner_tester_->setCostmap(grid, size, size, options.resolution);
+
+      // The same queries for every planner, far enough apart to cross the map
+      std::mt19937 generator(seed);
+      std::uniform_int_distribution<unsigned int> pick(0, size - 1);
+      auto random_free_cell = [&]() {
+          std::size_t cell;
+          do {
+            cell = static_cast<std::size_t>(pick(generator)) * size + pick(generator);
+          } while (grid[cell] != nav2_benchmarks::FREE_CELL);
+          return cell;
+        };
+      auto cell_pose = [&](std::size_t cell) {
+          geometry_msgs::msg::PoseStamped pose;
+          pose.header.frame_id = "map";
+          pose.pose.position.x = (cell % size + 0.5) * options.resolution;
+          pose.pose.position.y = (cell / size + 0.5) * options.resolution;
+          pose.pose.orientation.w = 1.0;
+          return pose;
+        };
+      std::vector<std::pair<std::size_t, std::size_t>> queries;
+      for (unsigned int q = 0; q < options.queries; ++q) {
+        std::size_t start = random_free_cell(), goal = random_free_cell();
+        for (int attempt = 0; attempt < 100; ++attempt) {
+          const double dx = static_cast<double>(goal % size) - static_cast<double>(start % size);
+          const double dy = static_cast<double>(goal / size) - static_cast<double>(start / size);
+          if (std::hypot(dx, dy) >= size / 2.0) {
+            break;
+          }
+          goal = random_free_cell();
+        }
+        queries.emplace_back(start, goal);
+      }
+
+      for (const std::string & planner_id : planner_ids) {
+        auto planner = planner_tester_->getPlanner(planner_id);
+        if (!planner) {
+          RCLCPP_ERROR(this->get_logger(), "No planner %s is loaded", planner_id.c_str());
+          continue;
+        }
+        auto navfn = std::dynamic_pointer_cast<nav2_navfn_planner::NavfnPlanner>(planner);
+
+        unsigned int num_success = 0;
+        double total_ms = 0.0;
+        for (unsigned int q = 0; q < queries.size(); ++q) {
+          PlannerBenchmarkResult result;
+          result.planner_id = planner_id;
+          result.map_size = size;
+          result.obstacle_density = density;
+          result.query = q;
+
+          const uint64_t expanded_before = navfn ? navfn->getExpandedCells() : 0;
+          resetPeakMemory();
+          nav_msgs::msg::Path path;
+          auto start_time = steady_clock::now();
+          try {
+            path = planner->createPlan(cell_pose(queries[q].first), cell_pose(queries[q].second));
+          } catch (const std::exception & ex) {
+            RCLCPP_WARN(
+              this->get_logger(), "%s failed to plan: %s", planner_id.c_str(), ex.what());
+          }
+          result.plan_time_ms =
+            duration<double, std::milli>(steady_clock::now() - start_time).count();
+          result.peak_memory_kb = peakMemoryKb();
+          result.expanded_cells = navfn ?
+            static_cast<int64_t>(navfn->getExpandedCells() - expanded_before) : -1;
+          result.success = !path.poses.empty();
+          result.path_length = pathLength(path);
+
+          num_success += result.success ? 1 : 0;
+          total_ms += result.plan_time_ms;
+          results.push_back(result);
+        }
+
+        RCLCPP_INFO(
+          this->get_logger(),
+          "%s on %ux%u cells with %.0f%% obstacles: %u of %zu plans, %.1f ms on average",
+          planner_id.c_str(), size, size, density * 100.0, num_success, queries.size(),
+          queries.empty() ? 0.0 : total_ms / queries.size());
+      }
+    }
+  }
+
+  return results;
+}
+
+void PlannerTester::writeBenchmarkCsv(
+  std::ostream & out, const std::vector<PlannerBenchmarkResult> & results)
+{
+  out << "planner,map_size,obstacle_density,query,success,plan_time_ms,expanded_cells,"
+    "peak_memory_kb,path_length\n";
+  for (const auto & result : results) {
+    out << result.planner_id << "," << result.map_size << "," << result.obstacle_density <<
+      "," << result.query << "," << (result.success ? 1 : 0) << "," << result.plan_time_ms <<
+      "," << result.expanded_cells << "," << result.peak_memory_kb << "," <<
+      result.path_length << "\n";
+  }
+}
+
+void PlannerTester::writeBenchmarkJson(
+  std::ostream & out, const std::vector<PlannerBenchmarkResult> & results)
+{
+  // Unknown values are null, planner ids are plain identifiers needing no escaping
+  auto optional = [](int64_t value) {
+      return value < 0 ? std::string("null") : std::to_string(value);
+    };
+
+  out << "[";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto & result = results[i];
+    out << (i == 0 ? "\n" : ",\n") <<
+      "  {\"planner\": \"" << result.planner_id << "\", \"map_size\": " << result.map_size <<
+      ", \"obstacle_density\": " << result.obstacle_density <<
+      ", \"query\": " << result.query <<
+      ", \"success\": " << (result.success ? "true" : "false") <<
+      ", \"plan_time_ms\": " << result.plan_time_ms <<
+      ", \"expanded_cells\": " << optional(result.expanded_cells) <<
+      ", \"peak_memory_kb\": " << optional(result.peak_memory_kb) <<
+      ", \"path_length\": " << result.path_length << "}";
+  }
+  out << "\n]\n";
+}
+
 bool PlannerTester::plannerTest(
   const geometry_msgs::msg::Point & robot_position,
   const ComputePathToPoseCommand & goal,
@@ -16,10 +16,13 @@
 #define PLANNING__PLANNER_TESTER_HPP_
 
 #include <gtest/gtest.h>
+#include <cstdint>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <thread>
 #include <algorithm>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
@@ -59,6 +62,30 @@ public:
     std::cout << "" << std::endl;
   }
 
+  // Replace the costmap by a grid of costmap_2d costs, with its origin at 0, 0.
+  // Map updates are paused for good, so that no layer overwrites the grid
+  void setCostmap(
+    const std::vector<unsigned char> & costs,
+    unsigned int size_x, unsigned int size_y, double resolution)
+  {
+    costmap_ros_->pause();
+    nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap->getMutex()));
+    costmap->resizeMap(size_x, size_y, resolution, 0.0, 0.0);
+    std::copy(costs.begin(), costs.end(), costmap->getCharMap());
+  }
+
+  std::vector<std::string> getPlannerIds() const
+  {
+    return planner_ids_;
+  }
+
+  nav2_core::GlobalPlanner::Ptr getPlanner(const std::string & planner_id)
+  {
+    auto it = planners_.find(planner_id);
+    return it == planners_.end() ? nullptr : it->second;
+  }
+
   void setCostmap(nav2_util::Costmap * costmap)
   {
     nav2_msgs::msg::CostmapMetaData prop;
@@ -124,6 +151,29 @@ enum class TaskStatus : int8_t
   RUNNING = 3,
 };
 
+struct PlannerBenchmarkOptions
+{
+  std::vector<unsigned int> map_sizes{1000, 2000, 5000, 10000, 20000};  // side, in cells
+  std::vector<double> obstacle_densities{0.0, 0.05, 0.2};  // fraction of occupied cells
+  std::vector<std::string> planner_ids;  // every planner loaded if empty
+  unsigned int queries{10};  // start and goal pairs planned on each map
+  double resolution{0.05};
+  uint32_t seed{42};
+};
+
+struct PlannerBenchmarkResult
+{
+  std::string planner_id;
+  unsigned int map_size;
+  double obstacle_density;
+  unsigned int query;
+  bool success;
+  double plan_time_ms;
+  int64_t expanded_cells;  // -1 for planners other than NavFn
+  int64_t peak_memory_kb;  // peak resident size while planning, -1 if unknown
+  double path_length;  // meters
+};
+
 class PlannerTester : public rclcpp::Node
 {
 public:
@@ -133,8 +183,9 @@ public:
   PlannerTester();
   ~PlannerTester();
 
-  // Activate the tester before running tests
-  void activate();
+  // Activate the tester before running tests, optionally with workers
+  // planning goals of compute_path_to_pose_concurrent
+  void activate(int concurrent_planners = 0);
   void deactivate();
 
   // Loads the provided map and and generates a costmap from it.
@@ -155,6 +206,22 @@ public:
     const unsigned int number_tests,
     const float acceptable_fail_ratio);
 
+  // Plans two overlapping goals on compute_path_to_pose_concurrent, then two
+  // more canceling one of them. Requires the default map and concurrent
+  // planners. Success criteria is a collision free path between the end
+  // points of every goal, but for the canceled one if it was not planned yet
+  bool concurrentPlannerTest();
+
+  // Plans between the same random free cells with every planner, on generated
+  // maps of each size and obstacle density. Returns a result per plan
+  std::vector<PlannerBenchmarkResult> plannerBenchmark(const PlannerBenchmarkOptions & options);
+
+  static void writeBenchmarkCsv(
+    std::ostream & out, const std::vector<PlannerBenchmarkResult> & results);
+
+  static void writeBenchmarkJson(
+    std::ostream & out, const std::vector<PlannerBenchmarkResult> & results);
+
 private:
   void setCostmap();
 
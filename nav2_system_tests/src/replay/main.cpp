@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "replay/replay_harness.hpp"
+
+namespace
+{
+
+const char USAGE[] =
+  "Usage: replay_benchmark <bag> [--controller-frequency <hz>] [--controller <plugin>]\n"
+  "  [--controller-id <id>] [--odom-topic <topic>] [--plan-topic <topic>]\n"
+  "  [--settle-us <us>] [--storage <id>] [--trace <file>]\n"
+  "  [--ros-args --params-file <params.yaml>]\n";
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  const std::vector<std::string> args = rclcpp::remove_ros_arguments(argc, argv);
+
+  nav2_system_tests::ReplayOptions options;
+  try {
+    for (std::size_t i = 1; i < args.size(); ++i) {
+      const std::string & arg = args[i];
+      if (arg.compare(0, 2, "--") != 0) {
+        options.bag_uri = arg;
+        continue;
+      }
+      if (i + 1 == args.size()) {
+        throw std::invalid_argument(arg + " needs a value");
+      }
+      const std::string & value = args[++i];
+      if (arg == "--controller-frequency") {
+        options.controller_frequency = std::stod(value);
+      } else if (arg == "--controller") {
+        options.controller_plugin = value;
+      } else if (arg == "--controller-id") {
+        options.controller_id = value;
+      } else if (arg == "--odom-topic") {
+        options.odom_topic = value;
+      } else if (arg == "--plan-topic") {
+        options.plan_topic = value;
+      } else if (arg == "--settle-us") {
+        options.settle_time = std::chrono::microseconds(std::stol(value));
+      } else if (arg == "--storage") {
+        options.storage_id = value;
+      } else if (arg == "--trace") {
+        options.trace_file = value;
+      } else {
+        throw std::invalid_argument("unknown option " + arg);
+      }
+    }
+    if (options.bag_uri.empty() || options.controller_frequency <= 0.0) {
+      throw std::invalid_argument("a bag and a positive controller frequency are needed");
+    }
+  } catch (const std::exception & ex) {
+    std::cerr << ex.what() << "\n" << USAGE;
+    rclcpp::shutdown();
+    return 2;
+  }
+
+  int result = 0;
+  try {
+    nav2_system_tests::ReplayHarness harness(options);
+    harness.run();
+    harness.report(std::cout);
+  } catch (const std::runtime_error & ex) {
+    std::cerr << ex.what() << "\n";
+    result = 1;
+  }
+
+  rclcpp::shutdown();
+  return result;
+}
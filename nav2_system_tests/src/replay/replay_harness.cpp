@@ -0,0 +1,324 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "replay/replay_harness.hpp"
+
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_with_covariance_stamped.hpp"
+#include "nav2_util/trace.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "rosbag2_cpp/converter_options.hpp"
+#include "rosbag2_cpp/readers/sequential_reader.hpp"
+#include "rosbag2_cpp/storage_options.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+#include "tf2_msgs/msg/tf_message.hpp"
+
+namespace nav2_system_tests
+{
+
+namespace
+{
+
+// Large enough for the spans of one slice, the buffer is drained after each
+const std::size_t TRACE_CAPACITY = 1 << 16;
+
+}  // namespace
+
+ReplayHarness::ReplayHarness(const ReplayOptions & options)
+: options_(options),
+  controller_loader_("nav2_core", "nav2_core::Controller")
+{
+  createStack();
+}
+
+ReplayHarness::~ReplayHarness()
+{
+  if (controller_) {
+    controller_->deactivate();
+    controller_->cleanup();
+  }
+  rclcpp_lifecycle::State state;
+  if (costmap_active_) {
+    costmap_->on_deactivate(state);
+  }
+  amcl_->on_deactivate(state);
+  amcl_->on_cleanup(state);
+  costmap_->on_cleanup(state);
+}
+
+void ReplayHarness::createStack()
+{
+  // Nodes taking options get intra-process communication, the costmap and the
+  // TF listeners create their own nodes and go through the middleware
+  const rclcpp::Parameter sim_time("use_sim_time", true);
+  auto options = rclcpp::NodeOptions().use_intra_process_comms(true).parameter_overrides(
+    {sim_time});
+
+  replay_node_ = rclcpp::Node::make_shared("replay", options);
+  clock_pub_ = replay_node_->create_publisher<rosgraph_msgs::msg::Clock>(
+    "/clock", rclcpp::QoS(10));
+
+  amcl_ = std::make_shared<nav2_amcl::AmclNode>(options);
+
+  // The costmap is updated by the harness, on the simulated clock
+  costmap_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>("local_costmap");
+  costmap_->set_parameter(sim_time);
+  costmap_->get_parameter("update_frequency", costmap_update_frequency_);
+  costmap_->set_parameter(rclcpp::Parameter("update_frequency", 0.0));
+
+  controller_node_ = std::make_shared<nav2_util::LifecycleNode>(
+    "controller_server", "", false, options);
+
+  rclcpp_lifecycle::State state;
+  amcl_->on_configure(state);
+  amcl_->on_activate(state);
+  costmap_->on_configure(state);
+
+  try {
+    controller_ = controller_loader_.createUniqueInstance(options_.controller_plugin);
+  } catch (const pluginlib::PluginlibException & ex) {
+    throw std::runtime_error(
+            "Failed to load controller " + options_.controller_plugin + ": " + ex.what());
+  }
+  controller_->configure(
+    controller_node_, options_.controller_id, costmap_->getTfBuffer(), costmap_);
+
+  executor_.add_node(replay_node_);
+  executor_.add_node(amcl_->get_node_base_interface());
+  executor_.add_node(costmap_->get_node_base_interface());
+  executor_.add_node(controller_node_->get_node_base_interface());
+}
+
+void ReplayHarness::addTopic(const std::string & topic, const std::string & type)
+{
+  const auto reliable = rclcpp::QoS(rclcpp::KeepLast(100)).reliable();
+  const auto latched = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
+
+  std::unique_ptr<TopicReplayer> replayer;
+  if (type == "sensor_msgs/msg/LaserScan") {
+    replayer = std::make_unique<TypedTopicReplayer<sensor_msgs::msg::LaserScan>>(
+      replay_node_, topic, reliable);
+  } else if (type == "sensor_msgs/msg/PointCloud2") {
+    replayer = std::make_unique<TypedTopicReplayer<sensor_msgs::msg::PointCloud2>>(
+      replay_node_, topic, reliable);
+  } else if (type == "tf2_msgs/msg/TFMessage") {
+    replayer = std::make_unique<TypedTopicReplayer<tf2_msgs::msg::TFMessage>>(
+      replay_node_, topic, topic == "/tf_static" ? latched : reliable);
+  } else if (type == "nav_msgs/msg/OccupancyGrid") {
+    replayer = std::make_unique<TypedTopicReplayer<nav_msgs::msg::OccupancyGrid>>(
+      replay_node_, topic, latched);
+  } else if (type == "geometry_msgs/msg/PoseWithCovarianceStamped") {
+    using PoseT = geometry_msgs::msg::PoseWithCovarianceStamped;
+    replayer = std::make_unique<TypedTopicReplayer<PoseT>>(replay_node_, topic, reliable);
+  } else if (type == "nav_msgs/msg/Odometry") {
+    std::function<void(const nav_msgs::msg::Odometry &)> callback;
+    if (topic == options_.odom_topic) {
+      callback = [this](const nav_msgs::msg::Odometry & odom) {velocity_ = odom.twist.twist;};
+    }
+    replayer = std::make_unique<TypedTopicReplayer<nav_msgs::msg::Odometry>>(
+      replay_node_, topic, reliable, callback);
+  } else if (type == "nav_msgs/msg/Path") {
+    std::function<void(const nav_msgs::msg::Path &)> callback;
+    if (topic == options_.plan_topic) {
+      callback = [this](const nav_msgs::msg::Path & path) {
+          plan_ = path;
+          has_plan_ = true;
+          if (costmap_active_) {
+            controller_->setPlan(plan_);
+          }
+        };
+    }
+    replayer = std::make_unique<TypedTopicReplayer<nav_msgs::msg::Path>>(
+      replay_node_, topic, reliable, callback);
+  } else {
+    RCLCPP_WARN(
+      replay_node_->get_logger(), "Not replaying %s, %s messages are not supported",
+      topic.c_str(), type.c_str());
+    return;
+  }
+
+  topic_types_[topic] = type;
+  replayers_[topic] = std::move(replayer);
+}
+
+void ReplayHarness::run()
+{
+  rosbag2_cpp::StorageOptions storage_options;
+  storage_options.uri = options_.bag_uri;
+  storage_options.storage_id = options_.storage_id;
+  rosbag2_cpp::ConverterOptions converter_options;
+  converter_options.input_serialization_format = "cdr";
+  converter_options.output_serialization_format = "cdr";
+
+  rosbag2_cpp::readers::SequentialReader reader;
+  try {
+    reader.open(storage_options, converter_options);
+  } catch (const std::exception & ex) {
+    throw std::runtime_error("Failed to open " + options_.bag_uri + ": " + ex.what());
+  }
+  for (const auto & topic : reader.get_all_topics_and_types()) {
+    addTopic(topic.name, topic.type);
+  }
+
+  nav2_util::TraceBuffer::instance().enable(TRACE_CAPACITY);
+  const rclcpp::Duration slice = rclcpp::Duration::from_seconds(
+    1.0 / options_.controller_frequency);
+  const auto wall_start = std::chrono::steady_clock::now();
+
+  bool started = false;
+  rclcpp::Time bag_start, slice_end;
+  while (reader.has_next()) {
+    auto bag_message = reader.read_next();
+    const rclcpp::Time stamp(bag_message->time_stamp, RCL_ROS_TIME);
+    if (!started) {
+      started = true;
+      bag_start = stamp;
+      slice_end = stamp + slice;
+      next_costmap_update_ = stamp;
+    }
+    while (stamp >= slice_end) {
+      finishSlice(slice_end);
+      slice_end = slice_end + slice;
+    }
+
+    auto replayer = replayers_.find(bag_message->topic_name);
+    if (replayer != replayers_.end()) {
+      replayer->second->publish(*bag_message);
+      ++messages_;
+    }
+  }
+  if (started) {
+    finishSlice(slice_end);
+    bag_seconds_ = (slice_end - bag_start).seconds();
+  }
+
+  wall_seconds_ = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - wall_start).count();
+  if (!options_.trace_file.empty() &&
+    !nav2_util::TraceBuffer::instance().writeChromeTrace(options_.trace_file))
+  {
+    RCLCPP_WARN(
+      replay_node_->get_logger(), "Could not write the trace to %s",
+      options_.trace_file.c_str());
+  }
+  collectTraces();
+  nav2_util::TraceBuffer::instance().disable();
+}
+
+void ReplayHarness::finishSlice(const rclcpp::Time & now)
+{
+  rosgraph_msgs::msg::Clock clock;
+  clock.clock = now;
+  clock_pub_->publish(clock);
+  settle();
+
+  // The costmap waits for the transform to the robot when activated, so it is
+  // only activated once the bag has provided it
+  if (!costmap_active_) {
+    if (!costmap_->getTfBuffer()->canTransform(
+        costmap_->getGlobalFrameID(), costmap_->getBaseFrameID(), tf2::TimePointZero))
+    {
+      return;
+    }
+    rclcpp_lifecycle::State state;
+    costmap_->on_activate(state);
+    controller_->activate();
+    if (has_plan_) {
+      controller_->setPlan(plan_);
+    }
+    costmap_active_ = true;
+  }
+
+  if (costmap_update_frequency_ > 0.0 && now >= next_costmap_update_) {
+    costmap_->updateMap();
+    next_costmap_update_ = now + rclcpp::Duration::from_seconds(1.0 / costmap_update_frequency_);
+  }
+
+  if (has_plan_) {
+    geometry_msgs::msg::PoseStamped pose;
+    if (costmap_->getRobotPose(pose)) {
+      ++controller_cycles_;
+      try {
+        controller_->computeVelocityCommands(pose, velocity_);
+      } catch (const std::exception &) {
+        ++controller_failures_;
+      }
+    }
+  }
+
+  // A slice replays in well under the trace capacity, drain it before it wraps
+  collectTraces();
+}
+
+void ReplayHarness::settle()
+{
+  // There is no acknowledgement that a subscriber got a message, so the stack
+  // counts as done once it has had nothing to do for the settle time
+  while (rclcpp::ok() && executor_.spinOnce(options_.settle_time)) {
+  }
+}
+
+void ReplayHarness::collectTraces()
+{
+  for (const nav2_util::TraceEvent & event : nav2_util::TraceBuffer::instance().drain()) {
+    std::string stage = event.name;
+    if (event.detail[0] != '\0') {
+      stage += std::string(" ") + event.detail;
+    }
+    auto & histogram = stages_[stage];
+    if (!histogram) {
+      histogram = std::make_unique<nav2_util::TimingHistogram>();
+    }
+    // Spans summing several calls count once, as their total
+    histogram->record(event.end_ns - event.start_ns);
+  }
+}
+
+void ReplayHarness::report(std::ostream & out) const
+{
+  out << std::fixed << std::setprecision(1) <<
+    "Replayed " << messages_ << " messages, " << bag_seconds_ << " s of data in " <<
+    wall_seconds_ << " s (" << (wall_seconds_ > 0.0 ? bag_seconds_ / wall_seconds_ : 0.0) <<
+    "x real time)\n" <<
+    "Controller ran " << controller_cycles_ << " cycles, " << controller_failures_ <<
+    " without a command\n\n";
+
+  out << std::left << std::setw(40) << "topic" << std::setw(46) << "type" <<
+    std::right << std::setw(10) << "messages" << "\n";
+  for (const auto & replayer : replayers_) {
+    out << std::left << std::setw(40) << replayer.first <<
+      std::setw(46) << topic_types_.at(replayer.first) <<
+      std::right << std::setw(10) << replayer.second->count() << "\n";
+  }
+
+  out << "\n" << std::left << std::setw(56) << "stage (ms)" << std::right <<
+    std::setw(9) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50" <<
+    std::setw(10) << "p99" << std::setw(10) << "max" << "\n" << std::setprecision(3);
+  for (const auto & stage : stages_) {
+    const auto summary = stage.second->summarize();
+    out << std::left << std::setw(56) << stage.first << std::right <<
+      std::setw(9) << summary.count << std::setw(10) << summary.mean_ms <<
+      std::setw(10) << summary.p50_ms << std::setw(10) << summary.p99_ms <<
+      std::setw(10) << summary.max_ms << "\n";
+  }
+}
+
+}  // namespace nav2_system_tests
@@ -0,0 +1,203 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef REPLAY__REPLAY_HARNESS_HPP_
+#define REPLAY__REPLAY_HARNESS_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav2_amcl/amcl_node.hpp"
+#include "nav2_core/controller.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/timing_stats.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "pluginlib/class_loader.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialization.hpp"
+#include "rosbag2_storage/serialized_bag_message.hpp"
+#include "rosgraph_msgs/msg/clock.hpp"
+
+namespace nav2_system_tests
+{
+
+struct ReplayOptions
+{
+  std::string bag_uri;
+  std::string storage_id{"sqlite3"};
+  std::string odom_topic{"/odom"};  ///< Velocity the controller is given
+  std::string plan_topic{"/plan"};  ///< Paths the controller follows
+  std::string controller_id{"FollowPath"};
+  std::string controller_plugin{"dwb_core::DWBLocalPlanner"};
+  double controller_frequency{20.0};
+  /// Wall time the stack must stay idle for a bag slice to count as processed
+  std::chrono::microseconds settle_time{1000};
+  std::string trace_file;  ///< Chrome trace of the run, not written if empty
+};
+
+/**
+ * @class nav2_system_tests::TopicReplayer
+ * @brief Publishes the bagged messages of one topic
+ */
+class TopicReplayer
+{
+public:
+  virtual ~TopicReplayer() = default;
+
+  virtual void publish(const rosbag2_storage::SerializedBagMessage & bag_message) = 0;
+
+  uint64_t count() const {return count_;}
+
+protected:
+  uint64_t count_{0};
+};
+
+/**
+ * @class nav2_system_tests::TypedTopicReplayer
+ * @brief Deserializes bagged messages of a known type, hands them to an
+ * optional callback and publishes them
+ */
+template<typename MessageT>
+class TypedTopicReplayer : public TopicReplayer
+{
+public:
+  TypedTopicReplayer(
+    const rclcpp::Node::SharedPtr & node, const std::string & topic, const rclcpp::QoS & qos,
+    std::function<void(const MessageT &)> callback = nullptr)
+  : publisher_(node->create_publisher<MessageT>(topic, qos)),
+    callback_(callback)
+  {
+  }
+
+  void publish(const rosbag2_storage::SerializedBagMessage & bag_message) override
+  {
+    rclcpp::SerializedMessage serialized(*bag_message.serialized_data);
+    auto message = std::make_unique<MessageT>();
+    serialization_.deserialize_message(&serialized, message.get());
+    if (callback_) {
+      callback_(*message);
+    }
+    publisher_->publish(std::move(message));
+    ++count_;
+  }
+
+protected:
+  typename rclcpp::Publisher<MessageT>::SharedPtr publisher_;
+  rclcpp::Serialization<MessageT> serialization_;
+  std::function<void(const MessageT &)> callback_;
+};
+
+/**
+ * @class nav2_system_tests::SettlingExecutor
+ * @brief Single threaded executor telling whether there was anything to run
+ */
+class SettlingExecutor : public rclcpp::executors::SingleThreadedExecutor
+{
+public:
+  /**
+   * @brief Run one ready callback, waiting up to timeout for one
+   * @return False if nothing became ready in time
+   */
+  bool spinOnce(std::chrono::nanoseconds timeout)
+  {
+    rclcpp::AnyExecutable any_executable;
+    if (!get_next_executable(any_executable, timeout)) {
+      return false;
+    }
+    execute_any_executable(any_executable);
+    return true;
+  }
+};
+
+/**
+ * @class nav2_system_tests::ReplayHarness
+ * @brief Replays a bag through AMCL, a local costmap and a controller plugin
+ * composed in one process, as fast as they keep up
+ *
+ * The bag is cut into slices of one controller period. The messages of a slice
+ * are published in bag order, the simulated clock is moved to its end, and once
+ * the stack has gone idle the costmap is updated and the controller run, both
+ * on the replay thread. The spans the stack traces are summed per stage.
+ */
+class ReplayHarness
+{
+public:
+  explicit ReplayHarness(const ReplayOptions & options);
+  ~ReplayHarness();
+
+  /**
+   * @brief Replay the whole bag
+   * @throw std::runtime_error if the bag can't be opened or the controller loaded
+   */
+  void run();
+
+  /**
+   * @brief Write the throughput and per stage times of the run
+   */
+  void report(std::ostream & out) const;
+
+protected:
+  void createStack();
+  void addTopic(const std::string & topic, const std::string & type);
+
+  /** @brief Move the clock to the end of a slice and run the stages due */
+  void finishSlice(const rclcpp::Time & now);
+
+  /** @brief Spin the stack until it stays idle for the settle time */
+  void settle();
+
+  /** @brief Sum the spans traced since the last call into the stage histograms */
+  void collectTraces();
+
+  ReplayOptions options_;
+
+  rclcpp::Node::SharedPtr replay_node_;
+  rclcpp::Publisher<rosgraph_msgs::msg::Clock>::SharedPtr clock_pub_;
+  std::map<std::string, std::unique_ptr<TopicReplayer>> replayers_;
+  std::map<std::string, std::string> topic_types_;
+
+  std::shared_ptr<nav2_amcl::AmclNode> amcl_;
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_;
+  nav2_util::LifecycleNode::SharedPtr controller_node_;
+  pluginlib::ClassLoader<nav2_core::Controller> controller_loader_;
+  nav2_core::Controller::Ptr controller_;
+  SettlingExecutor executor_;
+
+  bool costmap_active_{false};
+  bool has_plan_{false};
+  nav_msgs::msg::Path plan_;
+  double costmap_update_frequency_{5.0};
+  rclcpp::Time next_costmap_update_;
+  geometry_msgs::msg::Twist velocity_;
+
+  // Results
+  uint64_t messages_{0};
+  uint64_t controller_cycles_{0};
+  uint64_t controller_failures_{0};
+  double bag_seconds_{0.0};
+  double wall_seconds_{0.0};
+  std::map<std::string, std::unique_ptr<nav2_util::TimingHistogram>> stages_;
+};
+
+}  // namespace nav2_system_tests
+
+#endif  // REPLAY__REPLAY_HARNESS_HPP_
@@ -0,0 +1,136 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_UTIL__COMPACT_PATH_HPP_
+#define NAV2_UTIL__COMPACT_PATH_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "geometry_msgs/msg/pose.hpp"
+#include "nav2_msgs/msg/compact_path.hpp"
+#include "nav_msgs/msg/path.hpp"
+
+namespace nav2_util
+{
+
+/// Number of poses of a compact path, those with all of x, y and yaw
+std::size_t compactPathSize(const nav2_msgs::msg::CompactPath & path);
+
+/// Pose i of a compact path
+geometry_msgs::msg::Pose compactPathPose(const nav2_msgs::msg::CompactPath & path, std::size_t i);
+
+/**
+ * @brief Pack a path into a compact path, keeping x, y and yaw of every pose and the
+ * header of the path
+ */
+nav2_msgs::msg::CompactPath toCompactPath(const nav_msgs::msg::Path & path);
+
+/**
+ * @brief Unpack a compact path, every pose gets the header of the path
+ */
+nav_msgs::msg::Path fromCompactPath(const nav2_msgs::msg::CompactPath & path);
+
+/**
+ * @class nav2_util::CompactPathView
+ * @brief The poses [first, last) of a shared compact path, read in place
+ *
+ * The path is never modified through a view, so views of it can be passed around and
+ * narrowed without copying it. The last pose of a view can be given a yaw of its own,
+ * the one thing a truncated path changes.
+ */
+class CompactPathView
+{
+public:
+  using PathPtr = nav2_msgs::msg::CompactPath::ConstSharedPtr;
+
+  CompactPathView() = default;
+
+  explicit CompactPathView(PathPtr path)
+  : CompactPathView(path, 0, path ? compactPathSize(*path) : 0)
+  {
+  }
+
+  /**
+   * @brief View of the poses [first, last) of path, clamped to its size
+   */
+  CompactPathView(PathPtr path, std::size_t first, std::size_t last)
+  : path_(std::move(path)),
+    last_(path_ ? std::min(last, compactPathSize(*path_)) : 0),
+    first_(std::min(first, last_))
+  {
+  }
+
+  const PathPtr & path() const {return path_;}
+  std::size_t first() const {return first_;}
+  std::size_t size() const {return last_ - first_;}
+  bool empty() const {return first_ == last_;}
+
+  float x(std::size_t i) const {return path_->x[first_ + i];}
+  float y(std::size_t i) const {return path_->y[first_ + i];}
+  float yaw(std::size_t i) const
+  {
+    return has_end_yaw_ && first_ + i + 1 == last_ ? end_yaw_ : path_->yaw[first_ + i];
+  }
+
+  /**
+   * @brief View of the poses [first, last) of this view, clamped to its size
+   */
+  CompactPathView slice(std::size_t first, std::size_t last) const
+  {
+    CompactPathView view(path_, first_ + first, first_ + std::min(last, size()));
+    if (view.last_ == last_) {
+      view.has_end_yaw_ = has_end_yaw_;
+      view.end_yaw_ = end_yaw_;
+    }
+    return view;
+  }
+
+  /**
+   * @brief The same view with the yaw of its last pose replaced
+   */
+  CompactPathView withEndYaw(float yaw) const
+  {
+    CompactPathView view(*this);
+    view.has_end_yaw_ = true;
+    view.end_yaw_ = yaw;
+    return view;
+  }
+
+  /// Same path, poses and end yaw, without comparing the poses
+  bool operator==(const CompactPathView & other) const
+  {
+    return path_ == other.path_ && first_ == other.first_ && last_ == other.last_ &&
+           has_end_yaw_ == other.has_end_yaw_ && (!has_end_yaw_ || end_yaw_ == other.end_yaw_);
+  }
+  bool operator!=(const CompactPathView & other) const {return !(*this == other);}
+
+  /**
+   * @brief Copy the poses viewed into a compact path with the same header
+   */
+  nav2_msgs::msg::CompactPath toCompactPath() const;
+
+private:
+  PathPtr path_;
+  std::size_t last_{0};
+  std::size_t first_{0};
+  bool has_end_yaw_{false};
+  float end_yaw_{0.0f};
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__COMPACT_PATH_HPP_
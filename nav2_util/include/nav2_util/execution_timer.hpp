@@ -16,6 +16,10 @@
 #define NAV2_UTIL__EXECUTION_TIMER_HPP_
 
 #include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "nav2_util/trace.hpp"
 
 namespace nav2_util
 {
@@ -27,11 +31,32 @@ public:
   using Clock = std::chrono::high_resolution_clock;
   using nanoseconds = std::chrono::nanoseconds;
 
+  ExecutionTimer() = default;
+
+  /**
+   * @brief A timer that also records what it measures as a trace span, while tracing is on
+   * @param zone Tracepoint, must be a string literal
+   * @param detail What the span is about
+   */
+  explicit ExecutionTimer(const char * zone, const std::string & detail = "")
+  : zone_(zone), detail_(detail) {}
+
   /// @brief Call just prior to code you want to measure
-  void start() {start_ = Clock::now();}
+  void start()
+  {
+    trace_start_ns_ = zone_ && TraceBuffer::instance().enabled() ? TraceBuffer::now() : 0;
+    start_ = Clock::now();
+  }
 
   /// @brief Call just after the code you want to measure
-  void end() {end_ = Clock::now();}
+  void end()
+  {
+    end_ = Clock::now();
+    if (trace_start_ns_ != 0) {
+      TraceBuffer::instance().recordSummed(
+        zone_, detail_, trace_start_ns_, elapsed_time().count(), 1);
+    }
+  }
 
   /// @brief Extract the measured time as an integral std::chrono::duration object
   nanoseconds elapsed_time() {return end_ - start_;}
@@ -45,6 +70,9 @@ public:
 protected:
   Clock::time_point start_;
   Clock::time_point end_;
+  const char * zone_ = nullptr;
+  std::string detail_;
+  int64_t trace_start_ns_ = 0;
 };
 
 }  // namespace nav2_util
@@ -22,6 +22,7 @@
 #include "geometry_msgs/msg/point.hpp"
 #include "geometry_msgs/msg/quaternion.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+#include "nav2_util/se2.hpp"
 
 namespace nav2_util
 {
@@ -30,9 +31,7 @@ namespace geometry_utils
 
 inline geometry_msgs::msg::Quaternion orientationAroundZAxis(double angle)
 {
-  tf2::Quaternion q;
-  q.setRPY(0, 0, angle);  // void returning function
-  return tf2::toMsg(q);
+  return se2::quaternion(angle);
 }
 
 inline double euclidean_distance(
@@ -20,6 +20,7 @@
 #include <thread>
 
 #include "nav2_util/node_thread.hpp"
+#include "nav2_util/trace_service.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "bondcpp/bond.hpp"
@@ -150,6 +151,9 @@ protected:
 
   // Connection to tell that server is still up
   std::unique_ptr<bond::Bond> bond_{nullptr};
+
+  // Saves the process' trace on request, whatever state the node is in
+  std::unique_ptr<TraceService> trace_service_;
 };
 
 }  // namespace nav2_util
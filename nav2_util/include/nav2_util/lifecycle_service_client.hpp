@@ -52,6 +52,18 @@ public:
    */
   uint8_t get_state(const std::chrono::seconds timeout = std::chrono::seconds::max());
 
+  using ChangeStateFuture = rclcpp::Client<lifecycle_msgs::srv::ChangeState>::SharedFuture;
+  using GetStateFuture = rclcpp::Client<lifecycle_msgs::srv::GetState>::SharedFuture;
+
+  /// Request a state change, completed as get_node() is spun
+  ChangeStateFuture async_change_state(std::uint8_t transition);
+
+  /// Request the current state, completed as get_node() is spun
+  GetStateFuture async_get_state();
+
+  /// Node the responses are received on
+  rclcpp::Node::SharedPtr get_node() const {return node_;}
+
 protected:
   rclcpp::Node::SharedPtr node_;
   ServiceClient<lifecycle_msgs::srv::ChangeState> change_state_;
@@ -33,8 +33,18 @@
 #ifndef NAV2_UTIL__LINE_ITERATOR_HPP_
 #define NAV2_UTIL__LINE_ITERATOR_HPP_
 
+#include <stdint.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NAV2_UTIL_LINE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace nav2_util
 {
 
@@ -105,6 +115,64 @@ public:
     curpixel_++;
   }
 
+  /**
+   * @brief Restrict the rest of the line to a window, jumping over the cells before it
+   *
+   * The cells visited afterwards are exactly the cells of the unclipped line
+   * inside the window, in the same order.
+   * @param min_x First column of the window
+   * @param min_y First row of the window
+   * @param max_x Last column of the window, inclusive
+   * @param max_y Last row of the window, inclusive
+   * @return False if none of the remaining cells is inside the window, the
+   * iterator is then no longer valid
+   */
+  bool clip(int min_x, int min_y, int max_x, int max_y)
+  {
+    const bool x_dominant = xinc2_ != 0;
+    int & dominant = x_dominant ? x_ : y_;
+    int & minor = x_dominant ? y_ : x_;
+    const int dominant_step = x_dominant ? xinc2_ : yinc2_;
+    const int minor_step = x_dominant ? yinc1_ : xinc1_;
+
+    // after j more steps the line has moved j cells along the dominant axis and
+    // (num_ + j * numadd_) / den_ cells along the minor one
+    int64_t first = 0;
+    int64_t last = numpixels_ - curpixel_;
+    const int64_t to_min = (x_dominant ? min_x : min_y) - static_cast<int64_t>(dominant);
+    const int64_t to_max = (x_dominant ? max_x : max_y) - static_cast<int64_t>(dominant);
+    first = std::max(first, dominant_step > 0 ? to_min : -to_max);
+    last = std::min(last, dominant_step > 0 ? to_max : -to_min);
+
+    const int64_t minor_to_min = (x_dominant ? min_y : min_x) - static_cast<int64_t>(minor);
+    const int64_t minor_to_max = (x_dominant ? max_y : max_x) - static_cast<int64_t>(minor);
+    const int64_t min_steps = minor_step > 0 ? minor_to_min : -minor_to_max;
+    const int64_t max_steps = minor_step > 0 ? minor_to_max : -minor_to_min;
+    if (max_steps < 0 || (numadd_ == 0 && min_steps > 0)) {
+      first = last + 1;
+    } else if (numadd_ > 0) {
+      if (min_steps > 0) {
+        first = std::max(first, (min_steps * den_ - num_ + numadd_ - 1) / numadd_);
+      }
+      last = std::min(last, ((max_steps + 1) * den_ - num_ - 1) / numadd_);
+    }
+
+    if (first > last) {
+      curpixel_ = numpixels_ + 1;
+      return false;
+    }
+
+    if (first > 0) {
+      const int64_t total = num_ + first * numadd_;
+      dominant += static_cast<int>(dominant_step * first);
+      minor += static_cast<int>(minor_step * (total / den_));
+      num_ = static_cast<int>(total % den_);
+    }
+    numpixels_ = curpixel_ + static_cast<int>(last);
+    curpixel_ += static_cast<int>(first);
+    return true;
+  }
+
   int getX() const
   {
     return x_;
@@ -150,6 +218,179 @@ private:
   int den_, num_, numadd_, numpixels_;
 };
 
+/**
+ * @brief Highest cost of the cells of a line, stopping at the first cost
+ * reaching stop_at, e.g. LETHAL_OBSTACLE when anything lethal fails a check
+ * @param line Line to walk, possibly clipped
+ * @param cost Functor giving the cost of cell (x, y)
+ * @param stop_at Cost ending the walk early
+ * @return The highest cost seen, or CostT() if the line has no cells
+ */
+template<typename CostT, typename CostFunctor>
+inline CostT maxCostAlongLine(LineIterator line, CostFunctor cost, CostT stop_at)
+{
+  CostT line_cost = CostT();
+  for (; line.isValid(); line.advance()) {
+    const CostT cell_cost = cost(line.getX(), line.getY());
+    if (line_cost < cell_cost) {
+      line_cost = cell_cost;
+      if (!(line_cost < stop_at)) {
+        break;
+      }
+    }
+  }
+  return line_cost;
+}
+
+/**
+ * @brief A line as linear offsets into a row major grid, for walkLine() and walkLines()
+ *
+ * Stepping it visits the same cells as LineIterator: the offset moves along the
+ * dominant axis every step, and along the other one whenever the error reaches
+ * the dominant length.
+ */
+struct LineSteps
+{
+  int32_t offset;  ///< Offset of the first cell
+  int32_t step_a;  ///< Offset change along the dominant axis
+  int32_t step_b;  ///< Offset change along the other axis
+  int32_t error;
+  int32_t abs_da;  ///< Length along the dominant axis
+  int32_t abs_db;  ///< Length along the other axis
+  uint32_t steps;  ///< Steps after the first cell, the line visits steps + 1 cells
+};
+
+/**
+ * @brief Offsets of the line from (x0, y0) to (x1, y1)
+ * @param stride Row length of the grid
+ * @param max_steps Steps along the dominant axis the line is cut to
+ */
+inline LineSteps lineSteps(
+  int stride, int x0, int y0, int x1, int y1, unsigned int max_steps = UINT_MAX)
+{
+  const int dx = x1 - x0;
+  const int dy = y1 - y0;
+  const int32_t step_x = dx >= 0 ? 1 : -1;
+  const int32_t step_y = dy >= 0 ? stride : -stride;
+  LineSteps line;
+  line.offset = y0 * stride + x0;
+  if (abs(dx) >= abs(dy)) {
+    line.abs_da = abs(dx);
+    line.abs_db = abs(dy);
+    line.step_a = step_x;
+    line.step_b = step_y;
+  } else {
+    line.abs_da = abs(dy);
+    line.abs_db = abs(dx);
+    line.step_a = step_y;
+    line.step_b = step_x;
+  }
+  line.error = line.abs_da / 2;
+  line.steps = std::min(max_steps, static_cast<unsigned int>(line.abs_da));
+  return line;
+}
+
+/**
+ * @brief Apply an action to the offset of every cell of a line, in order
+ */
+template<typename ActionT>
+inline void walkLine(LineSteps line, ActionT at)
+{
+  for (uint32_t i = 0; i < line.steps; ++i) {
+    at(static_cast<unsigned int>(line.offset));
+    line.offset += line.step_a;
+    line.error += line.abs_db;
+    if (line.error >= line.abs_da) {
+      line.offset += line.step_b;
+      line.error -= line.abs_da;
+    }
+  }
+  at(static_cast<unsigned int>(line.offset));
+}
+
+/**
+ * @brief Apply an action to the offset of every cell of many lines
+ *
+ * Four lines are stepped together, with SSE2 where available. Each line's
+ * cells are visited in order, but cells of different lines interleave, so the
+ * action must not depend on the order of the lines.
+ * @param count Number of lines
+ * @param line Functor giving the LineSteps of line i, called once per line in order
+ * @param at Action taking the offset of a cell
+ */
+template<typename LineFunctor, typename ActionT>
+inline void walkLines(std::size_t count, LineFunctor line, ActionT at)
+{
+  const int lanes = 4;
+  alignas(16) int32_t offset[lanes], step_a[lanes], step_b[lanes];
+  alignas(16) int32_t error[lanes], abs_da[lanes], abs_db[lanes];
+  uint32_t remaining[lanes];
+
+  // loads the next line with steps left into a lane, after visiting its first cell
+  std::size_t next = 0;
+  auto load = [&](int lane) {
+      while (next < count) {
+        const LineSteps l = line(next++);
+        at(static_cast<unsigned int>(l.offset));
+        if (l.steps > 0) {
+          offset[lane] = l.offset;
+          step_a[lane] = l.step_a;
+          step_b[lane] = l.step_b;
+          error[lane] = l.error;
+          abs_da[lane] = l.abs_da;
+          abs_db[lane] = l.abs_db;
+          remaining[lane] = l.steps;
+          return true;
+        }
+      }
+      // no lines left, park the lane where stepping never moves it along b
+      offset[lane] = step_a[lane] = step_b[lane] = error[lane] = abs_db[lane] = 0;
+      abs_da[lane] = 1;
+      remaining[lane] = 0;
+      return false;
+    };
+
+  int num_active = 0;
+  for (int lane = 0; lane < lanes; ++lane) {
+    num_active += load(lane);
+  }
+
+  while (num_active > 0) {
+#ifdef NAV2_UTIL_LINE_SSE2
+    const __m128i e = _mm_add_epi32(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(error)),
+      _mm_load_si128(reinterpret_cast<const __m128i *>(abs_db)));
+    const __m128i da = _mm_load_si128(reinterpret_cast<const __m128i *>(abs_da));
+    const __m128i step = _mm_cmpgt_epi32(e, _mm_sub_epi32(da, _mm_set1_epi32(1)));
+    _mm_store_si128(reinterpret_cast<__m128i *>(error), _mm_sub_epi32(e, _mm_and_si128(step, da)));
+    __m128i o = _mm_add_epi32(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(offset)),
+      _mm_load_si128(reinterpret_cast<const __m128i *>(step_a)));
+    o = _mm_add_epi32(
+      o, _mm_and_si128(step, _mm_load_si128(reinterpret_cast<const __m128i *>(step_b))));
+    _mm_store_si128(reinterpret_cast<__m128i *>(offset), o);
+#else
+    for (int lane = 0; lane < lanes; ++lane) {
+      offset[lane] += step_a[lane];
+      error[lane] += abs_db[lane];
+      if (error[lane] >= abs_da[lane]) {
+        offset[lane] += step_b[lane];
+        error[lane] -= abs_da[lane];
+      }
+    }
+#endif
+    for (int lane = 0; lane < lanes; ++lane) {
+      if (remaining[lane] == 0) {
+        continue;
+      }
+      at(static_cast<unsigned int>(offset[lane]));
+      if (--remaining[lane] == 0) {
+        num_active -= !load(lane);
+      }
+    }
+  }
+}
+
 }  // end namespace nav2_util
 
 #endif  // NAV2_UTIL__LINE_ITERATOR_HPP_
@@ -0,0 +1,133 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__MONITORING_BRIDGE_HPP_
+#define NAV2_UTIL__MONITORING_BRIDGE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "map_msgs/msg/occupancy_grid_update.hpp"
+#include "nav2_msgs/msg/compact_particle_cloud.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief Smallest rectangle holding every cell that differs between two grids of the same size
+ * @param before Previous cells
+ * @param after Current cells
+ * @param width Width of the grids, in cells
+ * @param[out] update Rectangle and cells of after in it, empty if nothing changed
+ * @return False if the grids don't have the same size
+ */
+bool changedRegion(
+  const std::vector<int8_t> & before, const std::vector<int8_t> & after,
+  unsigned int width, map_msgs::msg::OccupancyGridUpdate & update);
+
+/**
+ * @brief Douglas-Peucker simplification of a path
+ * @param path Path to simplify
+ * @param tolerance Largest distance of a dropped pose to the simplified path (m)
+ * @return The poses of path within tolerance of the path, always the first and last ones
+ */
+nav_msgs::msg::Path simplifyPath(const nav_msgs::msg::Path & path, double tolerance);
+
+/**
+ * @brief Systematic resampling of a particle cloud down to max_particles equally weighted
+ * particles, so that the heavier particles are the ones kept
+ */
+nav2_msgs::msg::CompactParticleCloud downsampleParticles(
+  const nav2_msgs::msg::CompactParticleCloud & cloud, std::size_t max_particles);
+
+/**
+ * @class nav2_util::MonitoringBridge
+ * @brief Republishes the costmaps, plans and particle clouds of a robot for remote monitoring,
+ * under a bandwidth limit
+ *
+ * Every input topic is republished under output_prefix. Only the latest message of a topic
+ * waits to be sent, older ones are dropped. Costmaps are sent as the rectangle that changed
+ * since the last grid sent, on <topic>_updates, with a full grid every costmap_keyframe_period.
+ * Paths are simplified and particle clouds downsampled.
+ *
+ * The waiting messages are sent publish_frequency times a second while their approximate
+ * serialized size fits in the bandwidth left. Paths go first, then particle clouds, then
+ * costmaps, and a message gains priority for every cycle it waits, so none starves. Running
+ * the bridge in the container of the servers keeps the full size inputs in-process.
+ */
+class MonitoringBridge : public rclcpp::Node
+{
+public:
+  explicit MonitoringBridge(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+
+protected:
+  /// An output topic and its latest message waiting to be sent
+  struct Stream
+  {
+    int priority;
+    bool pending{false};
+    std::size_t bytes{0};  ///< Approximate serialized size of the waiting message
+    unsigned int waited{0};  ///< Cycles the waiting message has waited
+    std::function<void()> send;
+  };
+
+  /// Last costmap sent on a topic, the updates are relative to it
+  struct CostmapState
+  {
+    nav_msgs::msg::OccupancyGrid::SharedPtr sent;
+    nav_msgs::msg::OccupancyGrid::SharedPtr latest;
+    rclcpp::Time last_keyframe;
+    rclcpp::Publisher<nav_msgs::msg::OccupancyGrid>::SharedPtr grid_pub;
+    rclcpp::Publisher<map_msgs::msg::OccupancyGridUpdate>::SharedPtr update_pub;
+  };
+
+  std::string outputTopic(const std::string & topic) const;
+  void addCostmap(const std::string & topic);
+  void addPath(const std::string & topic);
+  void addParticleCloud(const std::string & topic);
+
+  /**
+   * @brief Queue the latest grid of a costmap, as an update or a keyframe
+   */
+  void queueCostmap(const std::shared_ptr<CostmapState> & state, Stream & stream);
+
+  /**
+   * @brief Send the waiting messages that fit in the bandwidth, by priority
+   */
+  void schedule();
+
+  double bandwidth_limit_;
+  double publish_frequency_;
+  double path_tolerance_;
+  std::size_t max_particles_;
+  rclcpp::Duration keyframe_period_{0, 0};
+  std::string output_prefix_;
+
+  // Streams are only touched from the callbacks of this node, which don't run concurrently
+  std::vector<std::unique_ptr<Stream>> streams_;
+  double budget_{0.0};  ///< Bytes that can be sent now, negative after an oversized message
+  std::vector<rclcpp::SubscriptionBase::SharedPtr> subscriptions_;
+  std::vector<rclcpp::PublisherBase::SharedPtr> publishers_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__MONITORING_BRIDGE_HPP_
@@ -15,7 +15,11 @@
 #ifndef NAV2_UTIL__NODE_UTILS_HPP_
 #define NAV2_UTIL__NODE_UTILS_HPP_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "rclcpp/rclcpp.hpp"
 
 namespace nav2_util
@@ -107,6 +111,109 @@ std::string get_plugin_type_param(
   return plugin_type;
 }
 
+/// Parameters bound to variables, kept up to date from the node's parameter events
+/**
+ * bind() declares a parameter if needed and reads it into its variable once. Parameter
+ * events of the node only look the changed names up, so no names are built at runtime,
+ * and code reading the parameters reads the variables. The variables are written on the
+ * thread delivering parameter events; readers on other threads should take the snapshot
+ * an on_update() callback publishes.
+ */
+class ParameterBindings
+{
+public:
+  using Setter = std::function<void (const rclcpp::Parameter &)>;
+
+  template<typename NodeT>
+  explicit ParameterBindings(const NodeT & node)
+  : node_name_(node->get_fully_qualified_name()),
+    logger_(node->get_logger())
+  {
+    std::weak_ptr<typename NodeT::element_type> weak_node = node;
+    declare_ = [weak_node](
+      const std::string & name, const rclcpp::ParameterValue & default_value) {
+        auto node = weak_node.lock();
+        declare_parameter_if_not_declared(node, name, default_value);
+        return node->get_parameter(name);
+      };
+
+    parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+      node->get_node_base_interface(),
+      node->get_node_topics_interface(),
+      node->get_node_graph_interface(),
+      node->get_node_services_interface());
+    parameter_event_sub_ = parameters_client_->on_parameter_event(
+      [this](const rcl_interfaces::msg::ParameterEvent::SharedPtr event) {
+        onParameterEvent(*event);
+      });
+  }
+
+  /**
+   * @brief Bind a parameter to a variable of its type
+   */
+  template<typename T>
+  void bind(const std::string & name, const rclcpp::ParameterValue & default_value, T & variable)
+  {
+    bind_setter(
+      name, default_value, [&variable](const rclcpp::Parameter & parameter) {
+        variable = parameter.get_value<T>();
+      });
+  }
+
+  /**
+   * @brief Bind a parameter to a setter, called with its current value and its updates
+   */
+  void bind_setter(
+    const std::string & name, const rclcpp::ParameterValue & default_value, Setter setter)
+  {
+    setter(declare_(name, default_value));
+    setters_[name] = std::move(setter);
+  }
+
+  /**
+   * @brief Call back after each parameter event that changed bound parameters
+   */
+  void on_update(std::function<void()> callback)
+  {
+    update_callbacks_.push_back(std::move(callback));
+  }
+
+protected:
+  void onParameterEvent(const rcl_interfaces::msg::ParameterEvent & event)
+  {
+    if (event.node != node_name_) {
+      return;
+    }
+    bool updated = false;
+    for (auto & changed_parameter : event.changed_parameters) {
+      auto it = setters_.find(changed_parameter.name);
+      if (it == setters_.end()) {
+        continue;
+      }
+      try {
+        it->second(rclcpp::Parameter::from_parameter_msg(changed_parameter));
+        updated = true;
+      } catch (const rclcpp::ParameterTypeException & e) {
+        RCLCPP_WARN(
+          logger_, "Ignoring %s: %s", changed_parameter.name.c_str(), e.what());
+      }
+    }
+    if (updated) {
+      for (auto & callback : update_callbacks_) {
+        callback();
+      }
+    }
+  }
+
+  std::string node_name_;
+  rclcpp::Logger logger_;
+  std::function<rclcpp::Parameter(const std::string &, const rclcpp::ParameterValue &)> declare_;
+  std::unordered_map<std::string, Setter> setters_;
+  std::vector<std::function<void()>> update_callbacks_;
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
+};
+
 }  // namespace nav2_util
 
 #endif  // NAV2_UTIL__NODE_UTILS_HPP_
@@ -16,12 +16,14 @@
 #ifndef NAV2_UTIL__ODOMETRY_UTILS_HPP_
 #define NAV2_UTIL__ODOMETRY_UTILS_HPP_
 
+#include <array>
 #include <cmath>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <deque>
+#include <vector>
 
 #include "geometry_msgs/msg/twist.hpp"
 #include "geometry_msgs/msg/twist_stamped.hpp"
@@ -29,6 +31,7 @@
 #include "nav2_util/lifecycle_node.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/seqlock.hpp"
 
 namespace nav2_util
 {
@@ -36,7 +39,9 @@ namespace nav2_util
 /**
  * @class OdomSmoother
  * Wrapper for getting smooth odometry readings using a simple moving avergae.
- * Subscribes to the topic with a mutex.
+ * Only the twists of the odometry history are kept, in a ring buffer, and the
+ * average is updated from running sums. Readers get the latest average from a
+ * sequence lock, without waiting on the subscription.
  */
 class OdomSmoother
 {
@@ -52,22 +57,37 @@ public:
     double filter_duration = 0.3,
     std::string odom_topic = "odom");
 
-  inline geometry_msgs::msg::Twist getTwist() {return vel_smooth_.twist;}
-  inline geometry_msgs::msg::TwistStamped getTwistStamped() {return vel_smooth_;}
+  geometry_msgs::msg::Twist getTwist();
+  geometry_msgs::msg::TwistStamped getTwistStamped();
 
 protected:
+  /// Linear x, y, z then angular x, y, z
+  using TwistArray = std::array<double, 6>;
+
+  /// Also the published average, stamped with the latest odometry
+  struct Sample
+  {
+    int64_t stamp;  ///< Nanoseconds
+    TwistArray twist;
+  };
+
   void odomCallback(nav_msgs::msg::Odometry::SharedPtr msg);
-  void updateState();
+  void updateState(const std_msgs::msg::Header & header);
 
   rclcpp::Node::SharedPtr node_;
 
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  nav_msgs::msg::Odometry odom_cumulate_;
-  geometry_msgs::msg::TwistStamped vel_smooth_;
-  std::mutex odom_mutex_;
+  std::mutex odom_mutex_;  ///< Guards the history against concurrent callbacks
 
   rclcpp::Duration odom_history_duration_;
-  std::deque<nav_msgs::msg::Odometry> odom_history_;
+  // Ring buffer of the history, only grown while it holds less than odom_history_duration_
+  std::vector<Sample> odom_history_;
+  std::size_t head_{0};  ///< Oldest sample
+  std::size_t count_{0};
+  TwistArray odom_cumulate_{};
+
+  SeqLock<Sample> vel_smooth_;
+  std::shared_ptr<const std::string> frame_id_;  ///< Accessed with std::atomic_load/store
 };
 
 }  // namespace nav2_util
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__PRODUCT_CACHE_HPP_
+#define NAV2_UTIL__PRODUCT_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/section_file.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief 64 bit hash of a range of bytes, read 8 bytes at a time
+ * @param data Start of the range
+ * @param size Number of bytes
+ * @param seed Hash to continue from, e.g. that of a previous range
+ */
+uint64_t hashBytes(const void * data, std::size_t size, uint64_t seed = 0);
+
+/**
+ * @class nav2_util::ProductCache
+ * @brief A directory of products derived from some data, e.g. the distance field of a map,
+ * stored under the hash of that data so that they are only computed once
+ *
+ * A product is a section file, see writeSectionFile(), so that it can be mapped back and
+ * its sections read in place, and a reader never sees a partial one. The kind of a
+ * product names its layout, and should change along with it.
+ */
+class ProductCache
+{
+public:
+  /// A product read back, mapped from its file for as long as it lives
+  class Product
+  {
+public:
+    std::size_t sectionCount() const {return file_->sectionCount();}
+    const void * sectionData(std::size_t i) const {return file_->sectionData(i);}
+    std::size_t sectionSize(std::size_t i) const {return file_->sectionSize(i);}
+
+protected:
+    friend class ProductCache;
+    explicit Product(std::unique_ptr<SectionFile> file)
+    : file_(std::move(file)) {}
+
+    std::unique_ptr<SectionFile> file_;
+  };
+
+  /// Bytes of a section to store
+  using Section = std::pair<const void *, std::size_t>;
+
+  /**
+   * @brief A constructor for nav2_util::ProductCache
+   * @param directory Directory of the product files, empty to disable the cache
+   */
+  explicit ProductCache(const std::string & directory = "");
+
+  bool enabled() const {return !directory_.empty();}
+
+  /**
+   * @brief Path of the file of a product
+   */
+  std::string path(const std::string & kind, uint64_t key) const;
+
+  /**
+   * @brief Store a product, replacing any older one of the same kind and key
+   * @return false if the cache is disabled or the file could not be written
+   */
+  bool store(const std::string & kind, uint64_t key, const std::vector<Section> & sections) const;
+
+  /**
+   * @brief Read a product back
+   * @return nullptr if the cache is disabled, or the product is missing or invalid
+   */
+  std::unique_ptr<Product> load(const std::string & kind, uint64_t key) const;
+
+private:
+  std::string directory_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__PRODUCT_CACHE_HPP_
@@ -0,0 +1,163 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__ROBOT_STATE_CACHE_HPP_
+#define NAV2_UTIL__ROBOT_STATE_CACHE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/twist_stamped.hpp"
+#include "nav_msgs/msg/odometry.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_ros/buffer.h"
+#include "nav2_util/seqlock.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::RobotStateCache
+ * @brief Keeps the recent robot poses from TF and the latest odometry twist for many readers.
+ * The pose is looked up in TF once per update, instead of once per reader, and readers copy it
+ * out of a SeqLock without taking the TF buffer mutex or any other lock. Poses between updates
+ * are interpolated.
+ */
+class RobotStateCache
+{
+public:
+  /**
+   * @brief A constructor for nav2_util::RobotStateCache
+   * @param tf_buffer Buffer to look up the robot pose in
+   * @param global_frame Frame the poses are given in
+   * @param robot_frame Robot base frame
+   */
+  RobotStateCache(
+    std::shared_ptr<tf2_ros::Buffer> tf_buffer,
+    const std::string & global_frame,
+    const std::string & robot_frame);
+
+  /**
+   * @brief Update the pose from TF on a timer and the twist from an odometry topic
+   * @param node Node to create the timer and subscription with
+   * @param frequency Pose update rate, in Hz
+   * @param odom_topic Odometry topic, or empty to not track the twist
+   */
+  template<typename NodeT>
+  void start(const NodeT & node, double frequency, const std::string & odom_topic = "")
+  {
+    timer_ = node->create_wall_timer(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(1.0 / frequency)),
+      [this]() {updatePose();});
+
+    if (!odom_topic.empty()) {
+      odom_sub_ = node->template create_subscription<nav_msgs::msg::Odometry>(
+        odom_topic, rclcpp::SystemDefaultsQoS(),
+        [this](const nav_msgs::msg::Odometry::SharedPtr msg) {updateOdometry(*msg);});
+    }
+  }
+
+  /**
+   * @brief Stop the updates started by start()
+   */
+  void stop();
+
+  /**
+   * @brief Look up the latest robot pose in TF and add it to the history
+   * @return false if the transform isn't available
+   */
+  bool updatePose();
+
+  /**
+   * @brief Record the twist of an odometry message
+   */
+  void updateOdometry(const nav_msgs::msg::Odometry & odom);
+
+  /**
+   * @brief Get the most recent pose
+   * @return false if no pose has been received yet
+   */
+  bool getLatestPose(geometry_msgs::msg::PoseStamped & pose) const;
+
+  /**
+   * @brief Get the pose at a given time, interpolating between the recorded poses
+   * @param stamp Time of the pose
+   * @param tolerance How far outside the recorded poses stamp may be, the closest pose is
+   * returned in that case
+   * @param pose Interpolated pose, stamped with the requested time
+   * @return false if stamp isn't covered by the history
+   */
+  bool getPose(
+    const rclcpp::Time & stamp, const rclcpp::Duration & tolerance,
+    geometry_msgs::msg::PoseStamped & pose) const;
+
+  /**
+   * @brief Get the twist of the most recent odometry message
+   * @return false if no odometry has been received yet
+   */
+  bool getTwist(geometry_msgs::msg::TwistStamped & twist) const;
+
+  const std::string & getGlobalFrame() const {return global_frame_;}
+  const std::string & getRobotFrame() const {return robot_frame_;}
+
+  // Number of poses kept for interpolation
+  static const std::size_t HISTORY_SIZE = 8;
+
+protected:
+  struct PoseSample
+  {
+    int64_t stamp;
+    double x, y, z;
+    double qx, qy, qz, qw;
+  };
+
+  struct PoseHistory
+  {
+    std::size_t count;
+    std::size_t newest;
+    PoseSample samples[HISTORY_SIZE];
+  };
+
+  struct TwistSample
+  {
+    bool valid;
+    int64_t stamp;
+    double linear_x, linear_y, linear_z;
+    double angular_x, angular_y, angular_z;
+  };
+
+  void fillPose(const PoseSample & sample, geometry_msgs::msg::PoseStamped & pose) const;
+
+  std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::string global_frame_;
+  std::string robot_frame_;
+
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+
+  // Writers only serialize with each other, readers go through the SeqLocks
+  std::mutex update_mutex_;
+  PoseHistory history_;
+  SeqLock<PoseHistory> poses_;
+  SeqLock<TwistSample> twist_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__ROBOT_STATE_CACHE_HPP_
@@ -0,0 +1,173 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SE2_HPP_
+#define NAV2_UTIL__SE2_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "geometry_msgs/msg/pose.hpp"
+#include "geometry_msgs/msg/quaternion.hpp"
+
+namespace nav2_util
+{
+namespace se2
+{
+
+/**
+ * @brief Yaw of a quaternion, as tf2::getYaw() gives it away from pitches of +-90 degrees
+ *
+ * Only the closed form, without building a matrix or the roll and pitch, so it is cheap
+ * enough for the loops that read a heading per pose.
+ */
+inline double yaw(const geometry_msgs::msg::Quaternion & q)
+{
+  return std::atan2(
+    2.0 * (q.w * q.z + q.x * q.y), q.w * q.w + q.x * q.x - q.y * q.y - q.z * q.z);
+}
+
+/**
+ * @brief Unit quaternion of a rotation around the z axis
+ */
+inline geometry_msgs::msg::Quaternion quaternion(double yaw)
+{
+  geometry_msgs::msg::Quaternion q;
+  q.x = 0.0;
+  q.y = 0.0;
+  q.z = std::sin(0.5 * yaw);
+  q.w = std::cos(0.5 * yaw);
+  return q;
+}
+
+/**
+ * @struct nav2_util::se2::Transform
+ * @brief A rigid transform of the plane, kept as its translation and the cosine and
+ * sine of its rotation so that applying it takes no trigonometry
+ */
+struct Transform
+{
+  double x = 0.0;
+  double y = 0.0;
+  double c = 1.0;
+  double s = 0.0;
+
+  Transform() = default;
+
+  Transform(double x, double y, double theta)
+  : x(x), y(y), c(std::cos(theta)), s(std::sin(theta)) {}
+
+  /// A transform of a pose message, only its position in the plane and its yaw
+  static Transform fromPose(const geometry_msgs::msg::Pose & pose)
+  {
+    Transform t;
+    t.x = pose.position.x;
+    t.y = pose.position.y;
+    // The cosine and sine of the yaw straight from the quaternion, no atan2 needed
+    const auto & q = pose.orientation;
+    const double c = q.w * q.w + q.x * q.x - q.y * q.y - q.z * q.z;
+    const double s = 2.0 * (q.w * q.z + q.x * q.y);
+    const double norm = std::hypot(c, s);
+    if (norm > 0.0) {
+      t.c = c / norm;
+      t.s = s / norm;
+    }
+    return t;
+  }
+
+  double theta() const {return std::atan2(s, c);}
+
+  /// Apply to a point, out_x and out_y may alias x and y
+  void apply(double px, double py, double & out_x, double & out_y) const
+  {
+    const double tx = x + c * px - s * py;
+    out_y = y + s * px + c * py;
+    out_x = tx;
+  }
+
+  /// Apply the inverse to a point, out_x and out_y may alias x and y
+  void applyInverse(double px, double py, double & out_x, double & out_y) const
+  {
+    const double dx = px - x;
+    const double dy = py - y;
+    out_x = c * dx + s * dy;
+    out_y = -s * dx + c * dy;
+  }
+
+  /// This transform then other, so that (a * b).apply(p) == a.apply(b.apply(p))
+  Transform operator*(const Transform & other) const
+  {
+    Transform t;
+    apply(other.x, other.y, t.x, t.y);
+    t.c = c * other.c - s * other.s;
+    t.s = s * other.c + c * other.s;
+    return t;
+  }
+
+  Transform inverse() const
+  {
+    Transform t;
+    t.c = c;
+    t.s = -s;
+    t.x = -(c * x + s * y);
+    t.y = s * x - c * y;
+    return t;
+  }
+
+  geometry_msgs::msg::Pose toPose() const
+  {
+    geometry_msgs::msg::Pose pose;
+    pose.position.x = x;
+    pose.position.y = y;
+    pose.orientation = quaternion(theta());
+    return pose;
+  }
+};
+
+/**
+ * @brief Apply a transform to n points, out_x and out_y may alias x and y
+ *
+ * Written as a plain loop over separate arrays so that the compiler vectorizes it.
+ */
+inline void transformPoints(
+  const Transform & t, const double * x, const double * y,
+  double * out_x, double * out_y, std::size_t n)
+{
+  const double c = t.c, s = t.s, tx = t.x, ty = t.y;
+  for (std::size_t i = 0; i < n; ++i) {
+    const double px = x[i];
+    const double py = y[i];
+    out_x[i] = tx + c * px - s * py;
+    out_y[i] = ty + s * px + c * py;
+  }
+}
+
+/**
+ * @brief Sines and cosines of n angles, as a loop that compilers with a vector math
+ * library turn into vector calls, the others into the scalar ones
+ */
+inline void sincos(const double * theta, double * s, double * c, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i) {
+    s[i] = std::sin(theta[i]);
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    c[i] = std::cos(theta[i]);
+  }
+}
+
+}  // namespace se2
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SE2_HPP_
@@ -0,0 +1,118 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SECTION_FILE_HPP_
+#define NAV2_UTIL__SECTION_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+/**
+ * @brief What a section file says of itself besides its sections
+ *
+ * The magic names the kind of file and the version its layout, both checked when it is
+ * read back. The key and the stamp are free for the kind of file to use, e.g. for the
+ * hash of the data a product was derived from, and the label is cut to
+ * SectionFile::name_size bytes.
+ */
+struct SectionFileInfo
+{
+  std::string magic;
+  uint32_t version{0};
+  uint64_t key{0};
+  int64_t stamp{0};
+  std::string label;
+};
+
+/// Bytes of a section to write, with its name, cut to SectionFile::name_size bytes
+struct SectionBytes
+{
+  std::string name;
+  const void * data;
+  std::size_t size;
+};
+
+/**
+ * @brief Write a section file: a header, the table of its sections and the sections,
+ * each on a 64 byte boundary, so that SectionFile maps it back and reads them in place
+ *
+ * The file is written under a temporary name unique to the process and renamed, a reader
+ * never sees a partial one. Values are stored in the byte order of the writer.
+ * @return false if the file could not be written
+ */
+bool writeSectionFile(
+  const std::string & path, const SectionFileInfo & info,
+  const std::vector<SectionBytes> & sections);
+
+/**
+ * @class nav2_util::SectionFile
+ * @brief A file written by writeSectionFile(), mapped for as long as it lives
+ */
+class SectionFile
+{
+public:
+  /// Bytes of the names of the sections and of the label
+  static constexpr std::size_t name_size = 48;
+
+  /**
+   * @brief Map a section file, checking its table of sections against its size
+   * @param magic Kind of file expected
+   * @param version Layout expected
+   * @return nullptr if the file is missing, of another kind or version, or truncated
+   */
+  static std::unique_ptr<SectionFile> open(
+    const std::string & path, const std::string & magic, uint32_t version);
+
+  ~SectionFile();
+  SectionFile(const SectionFile &) = delete;
+  SectionFile & operator=(const SectionFile &) = delete;
+
+  uint64_t key() const {return key_;}
+  int64_t stamp() const {return stamp_;}
+  const std::string & label() const {return label_;}
+
+  std::size_t sectionCount() const {return sections_.size();}
+  const std::string & sectionName(std::size_t i) const {return sections_[i].name;}
+  const void * sectionData(std::size_t i) const {return base_ + sections_[i].offset;}
+  std::size_t sectionSize(std::size_t i) const {return sections_[i].size;}
+
+protected:
+  SectionFile() = default;
+
+  struct Section
+  {
+    std::string name;
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  const char * base_{nullptr};
+  std::size_t length_{0};
+  bool mapped_{false};
+  std::vector<char> buffer_;  ///< Holds the file where it can't be mapped
+  uint64_t key_{0};
+  int64_t stamp_{0};
+  std::string label_;
+  std::vector<Section> sections_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SECTION_FILE_HPP_
@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SEQLOCK_HPP_
+#define NAV2_UTIL__SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::SeqLock
+ * @brief A value with one writer and any number of readers that never block each other.
+ * Readers retry while a write is in progress, so reads are cheap as long as the value is small
+ * and written far less often than the time it takes to copy it. The value is kept in atomic
+ * words, so there is no data race even while a reader is retrying.
+ */
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock values must be trivially copyable");
+
+public:
+  SeqLock()
+  : sequence_(0)
+  {
+    const T value{};
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+    for (std::size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Replace the value. Must not be called concurrently with itself
+   * @param value New value
+   */
+  void store(const T & value)
+  {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Get a consistent copy of the latest value
+   */
+  T load() const
+  {
+    uint64_t words[kWords];
+    uint64_t before, after;
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  /**
+   * @brief Number of times the value has been stored since construction
+   */
+  uint64_t version() const {return sequence_.load(std::memory_order_acquire) / 2;}
+
+protected:
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> sequence_;
+  std::atomic<uint64_t> words_[kWords];
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SEQLOCK_HPP_
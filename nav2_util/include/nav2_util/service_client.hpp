@@ -15,7 +15,14 @@
 #ifndef NAV2_UTIL__SERVICE_CLIENT_HPP_
 #define NAV2_UTIL__SERVICE_CLIENT_HPP_
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "nav2_util/node_utils.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -23,6 +30,49 @@
 namespace nav2_util
 {
 
+/**
+ * @class NodeSpinner
+ * @brief Executor kept with a node, to spin it while waiting on service responses
+ *
+ * Clients sharing a node share its spinner. The node is added to the executor on
+ * first use and stays in it, so it must not be spun anywhere else.
+ */
+class NodeSpinner
+{
+public:
+  /**
+   * @brief Get the spinner of a node, creating it if the node has none
+   */
+  static std::shared_ptr<NodeSpinner> get(const rclcpp::Node::SharedPtr & node);
+
+  explicit NodeSpinner(const rclcpp::Node::SharedPtr & node);
+  ~NodeSpinner();
+
+  /**
+   * @brief Spin until a future is complete
+   * @return false on timeout or interruption
+   */
+  template<typename FutureT>
+  bool spin_until_complete(
+    const FutureT & future,
+    const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return executor_.spin_until_future_complete(future, timeout) ==
+           rclcpp::FutureReturnCode::SUCCESS;
+  }
+
+  /**
+   * @brief Process the work that is ready, waiting up to a timeout for some
+   */
+  void spin_once(const std::chrono::nanoseconds timeout);
+
+protected:
+  rclcpp::Node::SharedPtr node_;
+  std::mutex mutex_;
+  rclcpp::executors::SingleThreadedExecutor executor_;
+};
+
 template<class ServiceT>
 class ServiceClient
 {
@@ -49,29 +99,16 @@ public:
 
   using RequestType = typename ServiceT::Request;
   using ResponseType = typename ServiceT::Response;
+  using SharedFuture = typename rclcpp::Client<ServiceT>::SharedFuture;
+  using ResponseCallback = std::function<void (typename ResponseType::SharedPtr)>;
 
   typename ResponseType::SharedPtr invoke(
     typename RequestType::SharedPtr & request,
     const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
   {
-    while (!client_->wait_for_service(std::chrono::seconds(1))) {
-      if (!rclcpp::ok()) {
-        throw std::runtime_error(
-                service_name_ + " service client: interrupted while waiting for service");
-      }
-      RCLCPP_INFO(
-        node_->get_logger(), "%s service client: waiting for service to appear...",
-        service_name_.c_str());
-    }
-
-    RCLCPP_DEBUG(
-      node_->get_logger(), "%s service client: send async request",
-      service_name_.c_str());
-    auto future_result = client_->async_send_request(request);
-
-    if (rclcpp::spin_until_future_complete(node_, future_result, timeout) !=
-      rclcpp::FutureReturnCode::SUCCESS)
-    {
+    wait_for_service_interruptible();
+    auto future_result = invoke_async(request);
+    if (!spinner()->spin_until_complete(future_result, timeout)) {
       throw std::runtime_error(service_name_ + " service client: async_send_request failed");
     }
 
@@ -82,29 +119,82 @@ public:
     typename RequestType::SharedPtr & request,
     typename ResponseType::SharedPtr & response)
   {
-    while (!client_->wait_for_service(std::chrono::seconds(1))) {
-      if (!rclcpp::ok()) {
-        throw std::runtime_error(
-                service_name_ + " service client: interrupted while waiting for service");
-      }
-      RCLCPP_INFO(
-        node_->get_logger(), "%s service client: waiting for service to appear...",
-        service_name_.c_str());
+    wait_for_service_interruptible();
+    auto future_result = invoke_async(request);
+    if (!spinner()->spin_until_complete(future_result)) {
+      return false;
     }
 
+    response = future_result.get();
+    return response.get();
+  }
+
+  /**
+   * @brief Send a request without waiting, the response arrives as the node is spun,
+   * by spin() or whatever else spins it
+   */
+  SharedFuture invoke_async(typename RequestType::SharedPtr & request)
+  {
     RCLCPP_DEBUG(
       node_->get_logger(), "%s service client: send async request",
       service_name_.c_str());
-    auto future_result = client_->async_send_request(request);
+    return client_->async_send_request(request);
+  }
 
-    if (rclcpp::spin_until_future_complete(node_, future_result) !=
-      rclcpp::FutureReturnCode::SUCCESS)
-    {
-      return false;
+  /**
+   * @brief Send a request without waiting, calling back with the response as the node is spun
+   */
+  void invoke_async(typename RequestType::SharedPtr & request, ResponseCallback callback)
+  {
+    RCLCPP_DEBUG(
+      node_->get_logger(), "%s service client: send async request",
+      service_name_.c_str());
+    client_->async_send_request(
+      request, [callback](SharedFuture future) {callback(future.get());});
+  }
+
+  /**
+   * @brief Send all the requests, then wait for all the responses
+   * @return Responses in the order of the requests, null for those not received in time
+   */
+  std::vector<typename ResponseType::SharedPtr> invoke_batch(
+    std::vector<typename RequestType::SharedPtr> & requests,
+    const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+  {
+    wait_for_service_interruptible();
+    std::vector<SharedFuture> futures;
+    futures.reserve(requests.size());
+    for (auto & request : requests) {
+      futures.push_back(invoke_async(request));
     }
 
-    response = future_result.get();
-    return response.get();
+    const bool bounded = timeout != std::chrono::nanoseconds::max();
+    const auto deadline = std::chrono::steady_clock::now() +
+      (bounded ? timeout : std::chrono::nanoseconds::zero());
+    std::vector<typename ResponseType::SharedPtr> responses(requests.size());
+    for (std::size_t i = 0; i < futures.size(); i++) {
+      auto left = std::chrono::nanoseconds::max();
+      if (bounded) {
+        left = std::max(
+          std::chrono::nanoseconds::zero(), std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline - std::chrono::steady_clock::now()));
+      }
+      if (spinner()->spin_until_complete(futures[i], left)) {
+        responses[i] = futures[i].get();
+      }
+    }
+    return responses;
+  }
+
+  /**
+   * @brief Spin the node of the client until a future sent by invoke_async() is complete
+   * @return false on timeout or interruption
+   */
+  bool spin_until_complete(
+    const SharedFuture & future,
+    const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+  {
+    return spinner()->spin_until_complete(future, timeout);
   }
 
   void wait_for_service(const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
@@ -120,9 +210,31 @@ public:
   }
 
 protected:
+  void wait_for_service_interruptible()
+  {
+    while (!client_->wait_for_service(std::chrono::seconds(1))) {
+      if (!rclcpp::ok()) {
+        throw std::runtime_error(
+                service_name_ + " service client: interrupted while waiting for service");
+      }
+      RCLCPP_INFO(
+        node_->get_logger(), "%s service client: waiting for service to appear...",
+        service_name_.c_str());
+    }
+  }
+
+  // Taken on the first wait, so clients only sending requests don't claim the node
+  const std::shared_ptr<NodeSpinner> & spinner()
+  {
+    std::call_once(spinner_flag_, [this]() {spinner_ = NodeSpinner::get(node_);});
+    return spinner_;
+  }
+
   std::string service_name_;
   rclcpp::Node::SharedPtr node_;
   typename rclcpp::Client<ServiceT>::SharedPtr client_;
+  std::once_flag spinner_flag_;
+  std::shared_ptr<NodeSpinner> spinner_;
 };
 
 }  // namespace nav2_util
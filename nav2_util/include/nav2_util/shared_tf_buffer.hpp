@@ -0,0 +1,42 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SHARED_TF_BUFFER_HPP_
+#define NAV2_UTIL__SHARED_TF_BUFFER_HPP_
+
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+#include "tf2_ros/buffer.h"
+
+namespace nav2_util
+{
+
+/**
+ * @brief Get the TF buffer shared by the servers of this process
+ *
+ * The buffer is filled by a single listener, which spins an internal node on its own
+ * thread, so composed servers subscribe to /tf and /tf_static and keep the transform
+ * history once instead of once each. The buffer and its listener live as long as
+ * someone holds the buffer.
+ *
+ * @param use_sim_time Whether the buffer follows simulated time, servers with different
+ * settings get different buffers
+ * @return The shared buffer
+ */
+std::shared_ptr<tf2_ros::Buffer> getSharedTfBuffer(bool use_sim_time);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SHARED_TF_BUFFER_HPP_
@@ -15,12 +15,13 @@
 #ifndef NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 #define NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
-#include <future>
-#include <chrono>
 
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
@@ -75,6 +76,20 @@ public:
       std::bind(&SimpleActionServer::handle_accepted, this, _1));
   }
 
+  ~SimpleActionServer()
+  {
+    {
+      std::lock_guard<std::mutex> lock(worker_mutex_);
+      stop_execution_ = true;
+      shutdown_worker_ = true;
+    }
+    worker_cv_.notify_all();
+
+    if (worker_thread_.joinable()) {
+      worker_thread_.join();
+    }
+  }
+
   rclcpp_action::GoalResponse handle_goal(
     const rclcpp_action::GoalUUID & /*uuid*/,
     std::shared_ptr<const typename ActionT::Goal>/*goal*/)
@@ -90,10 +105,17 @@ public:
   }
 
   rclcpp_action::CancelResponse handle_cancel(
-    const std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>>/*handle*/)
+    const std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> handle)
   {
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
     debug_msg("Received request for goal cancellation");
+
+    // The handle only transitions to canceling after we return, so flag its slot now
+    if (handle == current_handle_) {
+      goal_state_ |= CURRENT_CANCELING;
+    } else if (handle == pending_handle_) {
+      goal_state_ |= PENDING_CANCELING;
+    }
     return rclcpp_action::CancelResponse::ACCEPT;
   }
 
@@ -112,20 +134,21 @@ public:
         terminate(pending_handle_);
       }
       pending_handle_ = handle;
-      preempt_requested_ = true;
+      set_state(PENDING_GOAL | PENDING_CANCELING, PENDING_GOAL, handle, PENDING_CANCELING);
     } else {
       if (is_active(pending_handle_)) {
         // Shouldn't reach a state with a pending goal but no current one.
         error_msg("Forgot to handle a preemption. Terminating the pending goal.");
         terminate(pending_handle_);
-        preempt_requested_ = false;
+        goal_state_ &= ~PENDING_GOAL;
       }
 
       current_handle_ = handle;
+      set_state(CURRENT_GOAL | CURRENT_CANCELING, CURRENT_GOAL, handle, CURRENT_CANCELING);
 
-      // Return quickly to avoid blocking the executor, so spin up a new thread
+      // Return quickly to avoid blocking the executor, so hand off to the worker thread
       debug_msg("Executing goal asynchronously.");
-      execution_future_ = std::async(std::launch::async, [this]() {work();});
+      start_worker();
     }
   }
 
@@ -168,6 +191,37 @@ public:
     debug_msg("Worker thread done.");
   }
 
+  void worker_loop()
+  {
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    while (true) {
+      worker_cv_.wait(lock, [this]() {return work_requested_ || shutdown_worker_;});
+      if (shutdown_worker_) {
+        break;
+      }
+      work_requested_ = false;
+      lock.unlock();
+
+      while (true) {
+        work();
+
+        // A goal accepted after work() gave up the mutex was parked in the pending slot
+        // because we still looked busy, so pick it up here rather than stranding it.
+        std::lock_guard<std::recursive_mutex> update_lock(update_mutex_);
+        if (!stop_execution_ && !is_active(current_handle_) && is_active(pending_handle_)) {
+          accept_pending_goal();
+          continue;
+        }
+        std::lock_guard<std::mutex> worker_lock(worker_mutex_);
+        running_ = false;
+        break;
+      }
+
+      idle_cv_.notify_all();
+      lock.lock();
+    }
+  }
+
   void activate()
   {
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
@@ -185,21 +239,21 @@ public:
       stop_execution_ = true;
     }
 
-    if (!execution_future_.valid()) {
+    if (!is_running()) {
       return;
     }
 
-    if (is_running()) {
-      warn_msg(
-        "Requested to deactivate server but goal is still executing."
-        " Should check if action server is running before deactivating.");
-    }
+    warn_msg(
+      "Requested to deactivate server but goal is still executing."
+      " Should check if action server is running before deactivating.");
 
     using namespace std::chrono;  //NOLINT
     auto start_time = steady_clock::now();
-    while (execution_future_.wait_for(milliseconds(100)) != std::future_status::ready) {
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    while (!idle_cv_.wait_for(lock, milliseconds(100), [this]() {return !running_;})) {
       info_msg("Waiting for async process to finish.");
       if (steady_clock::now() - start_time >= server_timeout_) {
+        lock.unlock();
         terminate_all();
         throw std::runtime_error("Action callback is still running and missed deadline to stop");
       }
@@ -210,21 +264,17 @@ public:
 
   bool is_running()
   {
-    return execution_future_.valid() &&
-           (execution_future_.wait_for(std::chrono::milliseconds(0)) ==
-           std::future_status::timeout);
+    return running_;
   }
 
   bool is_server_active()
   {
-    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
     return server_active_;
   }
 
   bool is_preempt_requested() const
   {
-    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
-    return preempt_requested_;
+    return goal_state_ & PENDING_GOAL;
   }
 
   const std::shared_ptr<const typename ActionT::Goal> accept_pending_goal()
@@ -243,7 +293,10 @@ public:
 
     current_handle_ = pending_handle_;
     pending_handle_.reset();
-    preempt_requested_ = false;
+
+    // The pending slot's cancel flag follows its handle into the current slot
+    unsigned int state = goal_state_;
+    goal_state_ = CURRENT_GOAL | ((state & PENDING_CANCELING) ? CURRENT_CANCELING : 0u);
 
     debug_msg("Preempted goal");
 
@@ -264,6 +317,12 @@ public:
 
   bool is_cancel_requested() const
   {
+    // Fast path for the execution loop: nothing has asked to cancel either slot
+    const unsigned int state = goal_state_;
+    if ((state & CURRENT_GOAL) && !(state & (CURRENT_CANCELING | PENDING_CANCELING))) {
+      return false;
+    }
+
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
 
     // A cancel request is assumed if either handle is canceled by the client.
@@ -287,7 +346,7 @@ public:
     std::lock_guard<std::recursive_mutex> lock(update_mutex_);
     terminate(current_handle_, result);
     terminate(pending_handle_, result);
-    preempt_requested_ = false;
+    goal_state_ &= ~PENDING_GOAL;
   }
 
   void terminate_current(
@@ -308,6 +367,7 @@ public:
       debug_msg("Setting succeed on current goal.");
       current_handle_->succeed(result);
       current_handle_.reset();
+      goal_state_ &= ~(CURRENT_GOAL | CURRENT_CANCELING);
     }
   }
 
@@ -330,19 +390,59 @@ protected:
   std::string action_name_;
 
   ExecuteCallback execute_callback_;
-  std::future<void> execution_future_;
-  bool stop_execution_{false};
+  std::atomic<bool> stop_execution_{false};
+
+  // One worker thread serves every goal instead of launching a thread per goal
+  std::thread worker_thread_;
+  std::mutex worker_mutex_;
+  std::condition_variable worker_cv_;
+  std::condition_variable idle_cv_;
+  bool work_requested_{false};
+  bool shutdown_worker_{false};
+  std::atomic<bool> running_{false};
 
   mutable std::recursive_mutex update_mutex_;
-  bool server_active_{false};
-  bool preempt_requested_{false};
+  std::atomic<bool> server_active_{false};
   std::chrono::milliseconds server_timeout_;
 
+  // Slot occupancy and cancel flags, written under update_mutex_ and read without it so
+  // the execution loop can poll for preemption and cancellation every cycle cheaply.
+  static constexpr unsigned int CURRENT_GOAL = 1u << 0;
+  static constexpr unsigned int PENDING_GOAL = 1u << 1;
+  static constexpr unsigned int CURRENT_CANCELING = 1u << 2;
+  static constexpr unsigned int PENDING_CANCELING = 1u << 3;
+  std::atomic<unsigned int> goal_state_{0u};
+
   std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> current_handle_;
   std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> pending_handle_;
 
   typename rclcpp_action::Server<ActionT>::SharedPtr action_server_;
 
+  void set_state(
+    unsigned int mask, unsigned int bits,
+    const std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> & handle,
+    unsigned int canceling_bit)
+  {
+    if (handle->is_canceling()) {
+      bits |= canceling_bit;
+    }
+    goal_state_ = (goal_state_ & ~mask) | bits;
+  }
+
+  void start_worker()
+  {
+    {
+      std::lock_guard<std::mutex> lock(worker_mutex_);
+      work_requested_ = true;
+      running_ = true;
+    }
+
+    if (!worker_thread_.joinable()) {
+      worker_thread_ = std::thread([this]() {worker_loop();});
+    }
+    worker_cv_.notify_one();
+  }
+
   constexpr auto empty_result() const
   {
     return std::make_shared<typename ActionT::Result>();
@@ -0,0 +1,204 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SNAPSHOT_HPP_
+#define NAV2_UTIL__SNAPSHOT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/section_file.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::SnapshotWriter
+ * @brief Collects the named sections of a snapshot, the inputs of a cycle of some server,
+ * and writes them to a file that nav2_util::Snapshot maps back
+ *
+ * The file is a section file, see writeSectionFile(), so that arrays such as costmaps are
+ * read in place. Values are stored in the byte order of the writer, snapshots are meant
+ * to be replayed on the same kind of machine.
+ */
+class SnapshotWriter
+{
+public:
+  /// Adds sections when the snapshot is written, see defer()
+  using Deferred = std::function<void (SnapshotWriter &)>;
+
+  /**
+   * @param source What the snapshot was taken of, e.g. the name of the server
+   */
+  explicit SnapshotWriter(const std::string & source);
+
+  /**
+   * @brief Add a section, replacing any of the same name
+   * @return Its bytes, to fill in, valid until the next section is added
+   */
+  void * addSection(const std::string & name, std::size_t size);
+
+  void addBytes(const std::string & name, const void * data, std::size_t size)
+  {
+    if (size > 0) {
+      std::memcpy(addSection(name, size), data, size);
+    } else {
+      addSection(name, 0);
+    }
+  }
+
+  template<typename T>
+  void addArray(const std::string & name, const T * data, std::size_t count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be stored");
+    addBytes(name, data, count * sizeof(T));
+  }
+
+  template<typename T>
+  void addArray(const std::string & name, const std::vector<T> & values)
+  {
+    addArray(name, values.data(), values.size());
+  }
+
+  template<typename T>
+  void addValue(const std::string & name, const T & value)
+  {
+    addArray(name, &value, 1);
+  }
+
+  void addString(const std::string & name, const std::string & value)
+  {
+    addBytes(name, value.data(), value.size());
+  }
+
+  /**
+   * @brief Add sections only when the snapshot is written, on the thread writing it, for
+   * those too costly to copy on the thread filling it, e.g. grids under a lock that the
+   * cycle being saved has already waited on
+   *
+   * What they add is then as it is at write time, not as it was when the snapshot was
+   * filled, and whatever they use must live until then.
+   */
+  void defer(Deferred fill);
+
+  bool has(const std::string & name) const;
+
+  /// Bytes of the sections added so far
+  std::size_t size() const;
+
+  /**
+   * @brief Add the deferred sections, then write the snapshot, under a temporary name
+   * first so that no reader sees a partial file
+   * @return false if the file could not be written
+   */
+  bool write(const std::string & path);
+
+protected:
+  struct Section
+  {
+    std::string name;
+    std::vector<char> data;
+  };
+
+  std::string source_;
+  std::deque<Section> sections_;
+  std::vector<Deferred> deferred_;
+};
+
+/**
+ * @class nav2_util::Snapshot
+ * @brief A snapshot read back, mapped from its file for as long as it lives
+ */
+class Snapshot
+{
+public:
+  /**
+   * @brief Map a snapshot file
+   * @return nullptr if the file is missing or not a snapshot
+   */
+  static std::unique_ptr<Snapshot> load(const std::string & path);
+
+  const std::string & source() const {return file_->label();}
+
+  /// System time the snapshot was written at, in nanoseconds
+  int64_t stamp() const {return file_->stamp();}
+
+  std::vector<std::string> sectionNames() const;
+
+  bool has(const std::string & name) const {return sections_.count(name) > 0;}
+
+  /**
+   * @brief Bytes of a section, in place
+   * @return nullptr if there is no such section
+   */
+  const void * section(const std::string & name, std::size_t & size) const;
+
+  /**
+   * @brief Elements of an array section, in place, which sections being aligned on 64
+   * bytes keeps aligned
+   * @return nullptr if there is no such section
+   */
+  template<typename T>
+  const T * array(const std::string & name, std::size_t & count) const
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be stored");
+    std::size_t size = 0;
+    const void * data = section(name, size);
+    count = size / sizeof(T);
+    return static_cast<const T *>(data);
+  }
+
+  template<typename T>
+  std::vector<T> vector(const std::string & name) const
+  {
+    std::size_t count = 0;
+    const T * data = array<T>(name, count);
+    return data ? std::vector<T>(data, data + count) : std::vector<T>();
+  }
+
+  /// Read a single value, false if the section is missing or of another size
+  template<typename T>
+  bool value(const std::string & name, T & out) const
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be stored");
+    std::size_t size = 0;
+    const void * data = section(name, size);
+    if (!data || size != sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&out, data, sizeof(T));
+    return true;
+  }
+
+  std::string string(const std::string & name) const;
+
+protected:
+  explicit Snapshot(std::unique_ptr<SectionFile> file);
+
+  std::unique_ptr<SectionFile> file_;
+  std::map<std::string, std::size_t> sections_;  ///< Index in the file of every name
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SNAPSHOT_HPP_
@@ -0,0 +1,181 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SNAPSHOT_RECORDER_HPP_
+#define NAV2_UTIL__SNAPSHOT_RECORDER_HPP_
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav2_msgs/srv/save_snapshot.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "nav2_util/snapshot.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief Store parameters in a snapshot section, so that a replay configures its plugins
+ * as the server had them
+ */
+void addParameters(
+  SnapshotWriter & writer, const std::string & name,
+  const std::vector<rclcpp::Parameter> & parameters);
+
+/**
+ * @brief Read back parameters stored by addParameters()
+ * @return Empty if the section is missing or invalid
+ */
+std::vector<rclcpp::Parameter> readParameters(
+  const Snapshot & snapshot, const std::string & name);
+
+/**
+ * @brief Store a pose, as its position and orientation under <name> and its frame
+ * under <name>/frame
+ */
+void addPose(
+  SnapshotWriter & writer, const std::string & name,
+  const geometry_msgs::msg::PoseStamped & pose);
+
+/// Read back a pose stored by addPose(), false if it is missing
+bool readPose(
+  const Snapshot & snapshot, const std::string & name, geometry_msgs::msg::PoseStamped & pose);
+
+/**
+ * @brief Store the poses of a path as addPose() does, all under <name>, and its frame
+ */
+void addPath(SnapshotWriter & writer, const std::string & name, const nav_msgs::msg::Path & path);
+
+/// Read back a path stored by addPath(), false if it is missing
+bool readPath(const Snapshot & snapshot, const std::string & name, nav_msgs::msg::Path & path);
+
+/// Store the linear then the angular components of a twist
+void addTwist(
+  SnapshotWriter & writer, const std::string & name, const geometry_msgs::msg::Twist & twist);
+
+/// Read back a twist stored by addTwist(), false if it is missing
+bool readTwist(
+  const Snapshot & snapshot, const std::string & name, geometry_msgs::msg::Twist & twist);
+
+/**
+ * @brief Every parameter of a node, to store with addParameters()
+ */
+template<typename NodeT>
+std::vector<rclcpp::Parameter> allParameters(NodeT node)
+{
+  // A depth of 0 lists the parameters at any depth
+  return node->get_parameters(node->list_parameters({}, 0).names);
+}
+
+/**
+ * @class nav2_util::SnapshotRecorder
+ * @brief Saves snapshots of the inputs of a server's cycles, on demand through the
+ * ~/save_snapshot service, and by itself when a cycle runs over its budget
+ *
+ * The server fills the snapshot with the inputs it keeps of its last cycle. Its replay
+ * tool then runs that cycle again against the snapshot, as often as wanted and under a
+ * profiler or the tracer, away from the robot.
+ */
+class SnapshotRecorder
+{
+public:
+  /// Adds the sections of a snapshot, false if there is nothing to save yet
+  using Fill = std::function<bool (SnapshotWriter &)>;
+
+  /**
+   * @param node Node offering the service and holding the snapshot_budget and
+   * snapshot_directory parameters, a plain or a lifecycle node
+   * @param fill Called on the thread saving the snapshot, which it should only hold for
+   * copies of the inputs kept of the last cycle, deferring costlier sections with
+   * SnapshotWriter::defer()
+   */
+  template<typename NodeT>
+  SnapshotRecorder(NodeT node, Fill fill)
+  : name_(node->get_name()),
+    logger_(node->get_logger()),
+    fill_(std::move(fill))
+  {
+    declare_parameter_if_not_declared(node, "snapshot_budget", rclcpp::ParameterValue(0.0));
+    declare_parameter_if_not_declared(
+      node, "snapshot_directory", rclcpp::ParameterValue(std::string("/tmp")));
+    node->get_parameter("snapshot_budget", budget_);
+    node->get_parameter("snapshot_directory", directory_);
+
+    service_ = node->template create_service<nav2_msgs::srv::SaveSnapshot>(
+      "~/save_snapshot",
+      [this](
+        const std::shared_ptr<rmw_request_id_t>,
+        const std::shared_ptr<nav2_msgs::srv::SaveSnapshot::Request> request,
+        std::shared_ptr<nav2_msgs::srv::SaveSnapshot::Response> response) {
+        response->filename = save(request->filename, response->size);
+        response->success = !response->filename.empty();
+        response->message = response->success ?
+          "Saved " + std::to_string(response->size) + " bytes" :
+          "Nothing to save yet, or the file could not be written";
+      });
+  }
+
+  /// Whether cycles over budget are saved, which servers may check before keeping inputs
+  bool automatic() const {return budget_ > 0.0;}
+
+  /// Seconds a cycle may take before it is saved, 0 if none are
+  double budget() const {return budget_;}
+
+  /**
+   * @brief Save a snapshot if a cycle ran over the budget, at most one every
+   * min_interval so that a slow stretch doesn't fill the disk
+   *
+   * The snapshot is filled on the calling thread and written, deferred sections
+   * included, on a planning worker of the nav2_util::TaskScheduler.
+   * @param duration Seconds the cycle took
+   * @return Whether a snapshot is being saved
+   */
+  bool checkCycle(double duration);
+
+  /**
+   * @brief Save a snapshot of the last cycle
+   * @param filename Path of the file, empty for one in the snapshot directory
+   * @param size Output, bytes of the sections written
+   * @return Path of the file written, empty if none
+   */
+  std::string save(const std::string & filename, uint64_t & size);
+
+  static constexpr std::chrono::seconds min_interval{10};
+
+protected:
+  /// A new file in the snapshot directory
+  std::string defaultPath() const;
+
+  std::string name_;
+  rclcpp::Logger logger_;
+  Fill fill_;
+  double budget_{0.0};
+  std::string directory_;
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point last_automatic_{};
+  rclcpp::Service<nav2_msgs::srv::SaveSnapshot>::SharedPtr service_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SNAPSHOT_RECORDER_HPP_
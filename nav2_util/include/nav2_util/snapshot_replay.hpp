@@ -0,0 +1,60 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SNAPSHOT_REPLAY_HPP_
+#define NAV2_UTIL__SNAPSHOT_REPLAY_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+/**
+ * @struct nav2_util::ReplayOptions
+ * @brief Command line of the tools replaying snapshots:
+ * <snapshot> [--plugin <name>] [--runs <n>] [--trace <file>]
+ */
+struct ReplayOptions
+{
+  std::string snapshot;
+  std::string plugin;  ///< Plugin to replay rather than the recorded one, empty for it
+  int runs{100};
+  std::string trace;  ///< Chrome trace file to write the runs to, empty for none
+};
+
+/**
+ * @brief Parse the command line of a replay tool, once stripped of its ROS arguments
+ * @return false, having printed the usage, if it is not valid
+ */
+bool parseReplayOptions(const std::vector<std::string> & arguments, ReplayOptions & options);
+
+/**
+ * @brief Run a replayed cycle options.runs times, each traced as zone, then print the
+ * spread of their durations and write the trace if asked
+ *
+ * The runs are back to back so that a sampling profiler attached to the tool, e.g.
+ * perf record, sees little besides the cycle.
+ * @param prepare Called untimed before each run, e.g. to restore the state a cycle
+ * changes, may be empty
+ * @return Duration of each run, in seconds
+ */
+std::vector<double> runReplay(
+  const ReplayOptions & options, const char * zone, const std::string & detail,
+  const std::function<void()> & cycle, const std::function<void()> & prepare = nullptr);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SNAPSHOT_REPLAY_HPP_
@@ -0,0 +1,174 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TASK_SCHEDULER_HPP_
+#define NAV2_UTIL__TASK_SCHEDULER_HPP_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nav2_util
+{
+
+/**
+ * @brief Priority classes of the shared task scheduler, the most urgent first
+ */
+enum class TaskPriority : unsigned int
+{
+  CONTROL = 0,
+  LOCALIZATION = 1,
+  COSTMAP = 2,
+  PLANNING = 3
+};
+
+/**
+ * @brief Configuration of the shared task scheduler
+ */
+struct TaskSchedulerOptions
+{
+  /// Number of worker threads, 0 for one less than the hardware threads
+  unsigned int num_threads = 0;
+  /// Workers that only ever run CONTROL tasks, taken out of num_threads
+  unsigned int reserved_control_threads = 0;
+  /// CPUs the workers are pinned to, in turn, empty to leave them unpinned
+  std::vector<int> cpu_affinity;
+  /// CPUs the reserved control workers are pinned to, empty to use cpu_affinity
+  std::vector<int> control_cpu_affinity;
+
+  /**
+   * @brief Options read from the environment, the defaults where a variable is unset:
+   * NAV2_TASK_THREADS, NAV2_TASK_RESERVED_CONTROL_THREADS, NAV2_TASK_CPUS and
+   * NAV2_TASK_CONTROL_CPUS, the latter two as CPU lists such as "0-3,6"
+   */
+  static TaskSchedulerOptions fromEnvironment();
+};
+
+/**
+ * @brief Parse a CPU list such as "0-3,6", ignoring malformed entries
+ */
+std::vector<int> parseCpuList(const std::string & list);
+
+/**
+ * @class nav2_util::TaskScheduler
+ * @brief Process wide work stealing scheduler shared by the parallel hot paths
+ *
+ * Every worker has a deque per priority class. A task submitted from a worker goes
+ * to its own deque, others are spread over the workers in turn. An idle worker
+ * looks for the most urgent class first, taking from its own deque newest first
+ * and stealing from the others oldest first, so planning work never runs while
+ * control work is waiting for a worker. Workers reserved for control never run
+ * anything else, and the thread calling parallelFor() works on its own loop, so
+ * a control loop keeps progressing even when planning saturates every worker.
+ *
+ * The scheduler starts on first use with the options given to configure() or,
+ * failing that, read from the environment.
+ */
+class TaskScheduler
+{
+public:
+  static TaskScheduler & instance();
+
+  /**
+   * @brief A constructor for a private scheduler, mostly for tests, prefer instance()
+   */
+  explicit TaskScheduler(const TaskSchedulerOptions & options);
+
+  /**
+   * @brief A destructor for nav2_util::TaskScheduler, runs the queued tasks and joins the workers
+   */
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler & operator=(const TaskScheduler &) = delete;
+
+  /**
+   * @brief Configure the shared scheduler before its first use
+   * @return False if it was already started, in which case nothing changes
+   */
+  static bool configure(const TaskSchedulerOptions & options);
+
+  /**
+   * @brief Number of workers, without the calling threads
+   */
+  unsigned int numWorkers() const {return static_cast<unsigned int>(workers_.size());}
+
+  /**
+   * @brief Number of workers that run tasks of a priority, without the calling threads
+   */
+  unsigned int numWorkers(TaskPriority priority) const;
+
+  /**
+   * @brief Queue a task, its exception if any is delivered through the future
+   */
+  std::future<void> submit(TaskPriority priority, std::function<void()> task);
+
+  /**
+   * @brief Run task(i) for every i in [0, num_tasks) and block until all are done
+   *
+   * The calling thread takes part, and at most max_concurrency - 1 workers help
+   * it, all workers of the class when 0. Tasks are handed out dynamically, so
+   * they may be of uneven cost, and nested calls from a task cannot deadlock. The
+   * first exception thrown by a task is rethrown here once every task has finished.
+   */
+  void parallelFor(
+    TaskPriority priority, std::size_t num_tasks,
+    const std::function<void(std::size_t)> & task, unsigned int max_concurrency = 0);
+
+  /**
+   * @brief Whether the calling thread is one of this scheduler's workers
+   */
+  bool onWorkerThread() const;
+
+protected:
+  static constexpr std::size_t kNumPriorities = 4;
+
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::array<std::deque<std::function<void()>>, kNumPriorities> tasks;
+  };
+
+  void push(TaskPriority priority, std::function<void()> task);
+  bool pop(std::size_t worker, std::function<void()> & task);
+  void workerLoop(std::size_t worker, int cpu);
+
+  static std::mutex & configMutex();
+  static std::unique_ptr<TaskSchedulerOptions> & pendingOptions();
+
+  unsigned int reserved_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> next_queue_;
+
+  // Guards sleeping and waking, pending_ is only changed with it held
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::size_t pending_;
+  std::array<std::size_t, kNumPriorities> pending_by_priority_;
+  bool stop_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TASK_SCHEDULER_HPP_
@@ -0,0 +1,108 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__THREAD_POOL_HPP_
+#define NAV2_UTIL__THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/task_scheduler.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::ThreadPool
+ * @brief A fixed set of worker threads to run data-parallel loops in hot paths.
+ * The calling thread takes part in the work, so a pool of size 1 runs everything inline.
+ * A pool made with a priority class owns no threads and runs its loops on the shared
+ * TaskScheduler instead, so the hot paths of a process don't oversubscribe its cores.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief A constructor for nav2_util::ThreadPool
+   * @param num_threads Total concurrency, including the calling thread.
+   * 0 uses the number of hardware threads
+   */
+  explicit ThreadPool(unsigned int num_threads = 0);
+
+  /**
+   * @brief A constructor for nav2_util::ThreadPool running on the shared TaskScheduler
+   * @param priority Priority class of the loops
+   * @param max_concurrency Total concurrency, including the calling thread.
+   * 0 uses every worker of the shared scheduler that runs the class
+   */
+  ThreadPool(TaskPriority priority, unsigned int max_concurrency);
+
+  /**
+   * @brief A destructor for nav2_util::ThreadPool, joins the workers
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Total concurrency of the pool, including the calling thread
+   */
+  unsigned int size() const;
+
+  /**
+   * @brief Run task(i) for every i in [0, num_tasks) and block until all are done.
+   * Tasks are handed out dynamically, so they may be of uneven cost. The first
+   * exception thrown by a task is rethrown here once every task has finished.
+   * @param num_tasks Number of tasks to run
+   * @param task Callable invoked once per task index
+   */
+  void parallelFor(std::size_t num_tasks, const std::function<void(std::size_t)> & task);
+
+protected:
+  void workerLoop();
+  void runTasks();
+
+  std::vector<std::thread> workers_;
+
+  // Set when running on the shared scheduler rather than on workers_
+  TaskScheduler * scheduler_;
+  TaskPriority priority_;
+  unsigned int max_concurrency_;
+
+  // Serializes concurrent parallelFor() callers
+  std::mutex call_mutex_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_;
+  std::size_t generation_;
+  std::size_t active_workers_;
+
+  const std::function<void(std::size_t)> * task_;
+  std::size_t num_tasks_;
+  std::atomic<std::size_t> next_task_;
+  std::exception_ptr error_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__THREAD_POOL_HPP_
@@ -0,0 +1,77 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TIMING_DIAGNOSTICS_HPP_
+#define NAV2_UTIL__TIMING_DIAGNOSTICS_HPP_
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "nav2_util/timing_stats.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::TimingDiagnostics
+ * @brief Periodically publishes the summaries of timing stats on /diagnostics,
+ * one status per histogram, named "<name>: <histogram>"
+ */
+class TimingDiagnostics
+{
+public:
+  /**
+   * @param node Node publishing, a plain publisher is used for lifecycle nodes too
+   * @param stats Stats published, their windows are rotated at each publication
+   * @param name Prefix of the status names, usually the node's name
+   * @param period Time between publications
+   */
+  template<typename NodeT>
+  TimingDiagnostics(
+    NodeT node, std::shared_ptr<TimingStats> stats, const std::string & name,
+    std::chrono::duration<double> period)
+  : stats_(stats), name_(name), clock_(node->get_clock())
+  {
+    publisher_ = rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+      node, "/diagnostics", rclcpp::QoS(10));
+    timer_ = node->create_wall_timer(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(period), [this]() {publish();});
+  }
+
+  /**
+   * @brief Publish the stats now and rotate their windows
+   */
+  void publish();
+
+  /**
+   * @brief Build the diagnostics of a set of summaries, without a stamp
+   */
+  static diagnostic_msgs::msg::DiagnosticArray toMessage(
+    const std::string & name, const std::vector<TimingStats::NamedSummary> & summaries);
+
+protected:
+  std::shared_ptr<TimingStats> stats_;
+  std::string name_;
+  rclcpp::Clock::SharedPtr clock_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr publisher_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TIMING_DIAGNOSTICS_HPP_
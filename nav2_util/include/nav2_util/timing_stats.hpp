@@ -0,0 +1,163 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TIMING_STATS_HPP_
+#define NAV2_UTIL__TIMING_STATS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::TimingHistogram
+ * @brief Lock-free histogram of durations over a sliding window
+ *
+ * Durations are counted in log-linear buckets, four per power of two, so that
+ * percentiles are exact to within 25%. The window is made of kWindows slots:
+ * record() adds to the newest one and rotate() drops the oldest, so a summary
+ * covers the last kWindows - 1 rotation periods and the one in progress.
+ * Any number of threads may record, rotate() is meant for a single reader.
+ */
+class TimingHistogram
+{
+public:
+  static constexpr std::size_t kSubBuckets = 4;
+  static constexpr std::size_t kBuckets = 40 * kSubBuckets;  ///< Up to 2^41 ns, a half hour
+  static constexpr std::size_t kWindows = 4;
+
+  struct Summary
+  {
+    uint64_t count{0};
+    double mean_ms{0.0};
+    double p50_ms{0.0};
+    double p99_ms{0.0};
+    double max_ms{0.0};
+  };
+
+  TimingHistogram();
+
+  TimingHistogram(const TimingHistogram &) = delete;
+  TimingHistogram & operator=(const TimingHistogram &) = delete;
+
+  /**
+   * @brief Count a duration in the newest window
+   * @param duration_ns Duration in nanoseconds, negative ones are counted as 0
+   */
+  void record(int64_t duration_ns);
+
+  void record(std::chrono::nanoseconds duration) {record(duration.count());}
+
+  /**
+   * @brief Percentiles of the durations in the window. Percentiles are the upper
+   * bound of the bucket they fall in, capped by the largest duration counted
+   */
+  Summary summarize() const;
+
+  /**
+   * @brief Start a new window slot, forgetting the oldest one
+   */
+  void rotate();
+
+  /// @brief Bucket a duration is counted in
+  static std::size_t bucket(uint64_t duration_ns);
+
+  /// @brief Largest duration counted in a bucket
+  static uint64_t bucketUpperBound(std::size_t bucket);
+
+protected:
+  struct Window
+  {
+    std::atomic<uint64_t> counts[kBuckets];
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+  };
+
+  static void clear(Window & window);
+
+  std::atomic<std::size_t> current_;
+  Window windows_[kWindows];
+};
+
+/**
+ * @class nav2_util::TimingStats
+ * @brief Named timing histograms of a server, listed for publishing
+ */
+class TimingStats
+{
+public:
+  using NamedSummary = std::pair<std::string, TimingHistogram::Summary>;
+
+  /**
+   * @brief The histogram of a name, created on first use. The reference stays
+   * valid for the lifetime of the stats, so callers look it up once and keep it
+   */
+  TimingHistogram & histogram(const std::string & name);
+
+  /**
+   * @brief Summaries of every histogram holding durations, by name, after
+   * which the windows of all histograms are rotated
+   */
+  std::vector<NamedSummary> summarizeAndRotate();
+
+protected:
+  std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<TimingHistogram>> histograms_;
+};
+
+/**
+ * @class nav2_util::ScopedTiming
+ * @brief Records the time between its construction and destruction in a histogram
+ */
+class ScopedTiming
+{
+public:
+  /**
+   * @param histogram Histogram recorded in, nothing is measured if null
+   */
+  explicit ScopedTiming(TimingHistogram * histogram)
+  : histogram_(histogram)
+  {
+    if (histogram_) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTiming()
+  {
+    if (histogram_) {
+      histogram_->record(std::chrono::steady_clock::now() - start_);
+    }
+  }
+
+  ScopedTiming(const ScopedTiming &) = delete;
+  ScopedTiming & operator=(const ScopedTiming &) = delete;
+
+protected:
+  TimingHistogram * histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TIMING_STATS_HPP_
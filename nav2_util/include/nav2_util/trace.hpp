@@ -0,0 +1,221 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TRACE_HPP_
+#define NAV2_UTIL__TRACE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "builtin_interfaces/msg/time.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief One span recorded by a tracepoint
+ *
+ * Times are on the system clock, in nanoseconds since the epoch, which is the
+ * clock of the header stamps of a robot not running on simulated time. The
+ * latency from a causal input to a tracepoint is then start_ns - input_stamps_ns[i].
+ */
+struct TraceEvent
+{
+  static constexpr std::size_t kDetailSize = 32;
+  static constexpr std::size_t kMaxInputs = 2;
+
+  const char * name;  ///< Tracepoint, a string literal
+  char detail[kDetailSize];  ///< Layer, critic or tree the span is about, may be empty
+  int64_t start_ns;
+  int64_t end_ns;
+  /// Header stamps of the messages the span was caused by, 0 where unknown
+  int64_t input_stamps_ns[kMaxInputs];
+  /// Number of calls summed into the span, end_ns - start_ns is then their total time
+  uint32_t calls;
+  uint32_t thread;  ///< Small per process id of the recording thread
+};
+
+/**
+ * @class nav2_util::TraceBuffer
+ * @brief Process wide buffer of the latest trace events, a ring per recording thread
+ *
+ * Tracing is off until enable() is called, or the NAV2_TRACE_EVENTS environment
+ * variable gives a capacity, and a tracepoint then costs a single relaxed load.
+ * Each thread records into a ring of its own, without locking or contending with
+ * the others, and readers skip the events overwritten while they copy them. When
+ * NAV2_TRACE_FILE is also set, the events still in the buffer are written there
+ * at exit, in the Chrome trace event format that chrome://tracing and Perfetto open.
+ */
+class TraceBuffer
+{
+public:
+  static TraceBuffer & instance();
+
+  ~TraceBuffer();
+
+  TraceBuffer(const TraceBuffer &) = delete;
+  TraceBuffer & operator=(const TraceBuffer &) = delete;
+
+  /**
+   * @brief Start recording, dropping the events recorded so far
+   * @param capacity Number of events kept per thread, the oldest are overwritten
+   */
+  void enable(std::size_t capacity = 65536);
+
+  void disable();
+
+  bool enabled() const {return enabled_.load(std::memory_order_relaxed);}
+
+  /// Number of events kept per thread, 0 if tracing was never enabled
+  std::size_t capacity() const {return capacity_.load(std::memory_order_relaxed);}
+
+  void record(const TraceEvent & event);
+
+  /**
+   * @brief Record a span of calls whose time was summed by the caller
+   */
+  void recordSummed(
+    const char * name, const std::string & detail, int64_t start_ns, int64_t total_ns,
+    uint32_t calls, int64_t input_stamp_ns = 0);
+
+  /**
+   * @brief The events in the buffer, in the order they ended
+   */
+  std::vector<TraceEvent> snapshot() const;
+
+  /**
+   * @brief Take the events out of the buffer, in the order they ended, leaving it empty
+   */
+  std::vector<TraceEvent> drain();
+
+  /**
+   * @brief Number of events overwritten before being read, since enable() or drain()
+   */
+  uint64_t overwritten() const;
+
+  /**
+   * @brief Write the events in the buffer as a Chrome trace event file
+   * @return False if the file could not be written
+   */
+  bool writeChromeTrace(const std::string & path) const;
+
+  /**
+   * @brief Write events as a Chrome trace event file
+   * @return False if the file could not be written
+   */
+  static bool writeChromeTrace(const std::string & path, const std::vector<TraceEvent> & events);
+
+  /// @brief The current time, on the clock of the events
+  static int64_t now();
+
+protected:
+  TraceBuffer();
+
+  struct Ring;
+
+  /// @brief The ring of the calling thread for the current capacity, made on first use
+  Ring * threadRing();
+
+  /**
+   * @brief The unread events of every ring, in the order they ended, with the mutex held
+   * @param consume Whether to mark them read
+   */
+  std::vector<TraceEvent> copyEvents(bool consume) const;
+
+  std::atomic<bool> enabled_;
+  std::atomic<std::size_t> capacity_;
+  /// Bumped by enable(), rings of an older generation are replaced on their next use
+  std::atomic<uint64_t> generation_;
+  // Guards the list of rings, never taken by a thread recording into its own ring
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  std::string file_;
+};
+
+/**
+ * @brief A header stamp in nanoseconds, as carried by TraceEvent
+ */
+inline int64_t traceStamp(const builtin_interfaces::msg::Time & stamp)
+{
+  return static_cast<int64_t>(stamp.sec) * 1000000000LL + stamp.nanosec;
+}
+
+/**
+ * @class nav2_util::ScopedTrace
+ * @brief Records the span between its construction and destruction
+ *
+ * A span without input stamps inherits those of the innermost enclosing span on
+ * the same thread, so the work nested in a span that knows its input, such as the
+ * layers of a costmap update, is attributed to it.
+ */
+class ScopedTrace
+{
+public:
+  /**
+   * @param name Tracepoint, must be a string literal
+   * @param detail What the span is about, truncated to TraceEvent::kDetailSize - 1
+   * @param input_stamp_ns Header stamp of the main causal input, 0 to inherit
+   * @param second_input_stamp_ns Header stamp of another causal input, 0 if none
+   */
+  explicit ScopedTrace(
+    const char * name, const char * detail = "",
+    int64_t input_stamp_ns = 0, int64_t second_input_stamp_ns = 0);
+
+  ScopedTrace(
+    const char * name, const std::string & detail,
+    int64_t input_stamp_ns = 0, int64_t second_input_stamp_ns = 0)
+  : ScopedTrace(name, detail.c_str(), input_stamp_ns, second_input_stamp_ns) {}
+
+  ~ScopedTrace();
+
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace & operator=(const ScopedTrace &) = delete;
+
+  /**
+   * @brief Main input stamp of the innermost span open on this thread, 0 if none
+   */
+  static int64_t currentInputStamp();
+
+protected:
+  bool active_;
+  TraceEvent event_;
+  int64_t parent_stamp_ns_;
+};
+
+/**
+ * @class nav2_util::TraceInputScope
+ * @brief Attributes the spans opened on this thread while it lives to an input,
+ * without recording a span of its own
+ */
+class TraceInputScope
+{
+public:
+  explicit TraceInputScope(int64_t input_stamp_ns);
+  ~TraceInputScope();
+
+  TraceInputScope(const TraceInputScope &) = delete;
+  TraceInputScope & operator=(const TraceInputScope &) = delete;
+
+protected:
+  int64_t parent_stamp_ns_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TRACE_HPP_
@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TRACE_SERVICE_HPP_
+#define NAV2_UTIL__TRACE_SERVICE_HPP_
+
+#include <memory>
+#include <string>
+
+#include "nav2_msgs/srv/save_trace.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @class nav2_util::TraceService
+ * @brief Offers the ~/save_trace service, which starts tracing in the process or
+ * writes the events recorded so far, so a running robot can be traced on demand
+ */
+class TraceService
+{
+public:
+  /**
+   * @param node Node offering the service, a plain or a lifecycle node
+   */
+  template<typename NodeT>
+  explicit TraceService(NodeT node)
+  : name_(node->get_name()),
+    logger_(node->get_logger())
+  {
+    service_ = node->template create_service<nav2_msgs::srv::SaveTrace>(
+      "~/save_trace",
+      [this](
+        const std::shared_ptr<rmw_request_id_t>,
+        const std::shared_ptr<nav2_msgs::srv::SaveTrace::Request> request,
+        std::shared_ptr<nav2_msgs::srv::SaveTrace::Response> response) {
+        save(*request, *response);
+      });
+  }
+
+  /**
+   * @brief Handle a request, see nav2_msgs/srv/SaveTrace
+   */
+  void save(
+    const nav2_msgs::srv::SaveTrace::Request & request,
+    nav2_msgs::srv::SaveTrace::Response & response);
+
+protected:
+  std::string name_;
+  rclcpp::Logger logger_;
+  rclcpp::Service<nav2_msgs::srv::SaveTrace>::SharedPtr service_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__TRACE_SERVICE_HPP_
@@ -0,0 +1,86 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_util/compact_path.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "nav2_util/geometry_utils.hpp"
+
+namespace nav2_util
+{
+
+std::size_t compactPathSize(const nav2_msgs::msg::CompactPath & path)
+{
+  return std::min(path.x.size(), std::min(path.y.size(), path.yaw.size()));
+}
+
+geometry_msgs::msg::Pose compactPathPose(const nav2_msgs::msg::CompactPath & path, std::size_t i)
+{
+  geometry_msgs::msg::Pose pose;
+  pose.position.x = path.x[i];
+  pose.position.y = path.y[i];
+  pose.orientation = geometry_utils::orientationAroundZAxis(path.yaw[i]);
+  return pose;
+}
+
+nav2_msgs::msg::CompactPath toCompactPath(const nav_msgs::msg::Path & path)
+{
+  nav2_msgs::msg::CompactPath compact;
+  compact.header = path.header;
+  compact.x.reserve(path.poses.size());
+  compact.y.reserve(path.poses.size());
+  compact.yaw.reserve(path.poses.size());
+  for (const auto & pose : path.poses) {
+    const auto & q = pose.pose.orientation;
+    compact.x.push_back(static_cast<float>(pose.pose.position.x));
+    compact.y.push_back(static_cast<float>(pose.pose.position.y));
+    compact.yaw.push_back(
+      static_cast<float>(
+        std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z))));
+  }
+  return compact;
+}
+
+nav_msgs::msg::Path fromCompactPath(const nav2_msgs::msg::CompactPath & path)
+{
+  nav_msgs::msg::Path full;
+  full.header = path.header;
+  full.poses.resize(compactPathSize(path));
+  for (std::size_t i = 0; i != full.poses.size(); i++) {
+    full.poses[i].header = path.header;
+    full.poses[i].pose = compactPathPose(path, i);
+  }
+  return full;
+}
+
+nav2_msgs::msg::CompactPath CompactPathView::toCompactPath() const
+{
+  nav2_msgs::msg::CompactPath compact;
+  if (!path_) {
+    return compact;
+  }
+  compact.header = path_->header;
+  compact.x.assign(path_->x.begin() + first_, path_->x.begin() + last_);
+  compact.y.assign(path_->y.begin() + first_, path_->y.begin() + last_);
+  compact.yaw.assign(path_->yaw.begin() + first_, path_->yaw.begin() + last_);
+  if (has_end_yaw_ && !compact.yaw.empty()) {
+    compact.yaw.back() = end_yaw_;
+  }
+  return compact;
+}
+
+}  // namespace nav2_util
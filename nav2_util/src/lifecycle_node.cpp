@@ -64,6 +64,8 @@ LifecycleNode::LifecycleNode(
     rclcpp_thread_ = std::make_unique<NodeThread>(rclcpp_node_);
   }
 
+  trace_service_ = std::make_unique<TraceService>(this);
+
   print_lifecycle_node_notification();
 }
 
@@ -87,7 +89,14 @@ void LifecycleNode::createBond()
     this->get_name(),
     shared_from_this());
 
-  bond_->setHeartbeatPeriod(0.10);
+  // Shorter periods let the lifecycle manager use shorter bond timeouts
+  if (!has_parameter("bond_heartbeat_period")) {
+    declare_parameter("bond_heartbeat_period", 0.1);
+  }
+  double heartbeat_period;
+  get_parameter("bond_heartbeat_period", heartbeat_period);
+
+  bond_->setHeartbeatPeriod(heartbeat_period);
   bond_->setHeartbeatTimeout(4.0);
   bond_->start();
 }
@@ -74,4 +74,18 @@ uint8_t LifecycleServiceClient::get_state(
   return result->current_state.id;
 }
 
+LifecycleServiceClient::ChangeStateFuture LifecycleServiceClient::async_change_state(
+  std::uint8_t transition)
+{
+  auto request = std::make_shared<lifecycle_msgs::srv::ChangeState::Request>();
+  request->transition.id = transition;
+  return change_state_.invoke_async(request);
+}
+
+LifecycleServiceClient::GetStateFuture LifecycleServiceClient::async_get_state()
+{
+  auto request = std::make_shared<lifecycle_msgs::srv::GetState::Request>();
+  return get_state_.invoke_async(request);
+}
+
 }  // namespace nav2_util
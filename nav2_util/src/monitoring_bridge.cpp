@@ -0,0 +1,374 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/monitoring_bridge.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+// Approximate serialized sizes, the scheduling only needs the order of magnitude
+constexpr std::size_t kHeaderBytes = 16;
+constexpr std::size_t kPoseBytes = 7 * sizeof(double);
+constexpr std::size_t kGridInfoBytes = 80;
+constexpr std::size_t kUpdateInfoBytes = 16;
+
+// Stream priorities, before aging
+constexpr int kPathPriority = 2;
+constexpr int kParticlePriority = 1;
+constexpr int kCostmapPriority = 0;
+
+double segmentDistance(
+  const geometry_msgs::msg::Point & p,
+  const geometry_msgs::msg::Point & a, const geometry_msgs::msg::Point & b)
+{
+  const double dx = b.x - a.x;
+  const double dy = b.y - a.y;
+  const double length_sq = dx * dx + dy * dy;
+  double t = 0.0;
+  if (length_sq > 0.0) {
+    t = std::min(1.0, std::max(0.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sq));
+  }
+  return std::hypot(a.x + t * dx - p.x, a.y + t * dy - p.y);
+}
+
+bool sameGeometry(const nav_msgs::msg::MapMetaData & a, const nav_msgs::msg::MapMetaData & b)
+{
+  return a.width == b.width && a.height == b.height && a.resolution == b.resolution &&
+         a.origin == b.origin;
+}
+
+}  // namespace
+
+bool changedRegion(
+  const std::vector<int8_t> & before, const std::vector<int8_t> & after,
+  unsigned int width, map_msgs::msg::OccupancyGridUpdate & update)
+{
+  if (before.size() != after.size() || width == 0 || after.size() % width != 0) {
+    return false;
+  }
+
+  const unsigned int height = after.size() / width;
+  unsigned int x0 = width, y0 = height, xn = 0, yn = 0;
+  for (unsigned int y = 0; y < height; y++) {
+    const int8_t * row_before = before.data() + y * width;
+    const int8_t * row_after = after.data() + y * width;
+    for (unsigned int x = 0; x < width; x++) {
+      if (row_before[x] != row_after[x]) {
+        x0 = std::min(x0, x);
+        xn = std::max(xn, x + 1);
+        y0 = std::min(y0, y);
+        yn = y + 1;
+      }
+    }
+  }
+
+  update.data.clear();
+  if (xn == 0) {
+    update.x = update.y = update.width = update.height = 0;
+    return true;
+  }
+  update.x = x0;
+  update.y = y0;
+  update.width = xn - x0;
+  update.height = yn - y0;
+  update.data.reserve(update.width * update.height);
+  for (unsigned int y = y0; y < yn; y++) {
+    const auto row = after.begin() + y * width;
+    update.data.insert(update.data.end(), row + x0, row + xn);
+  }
+  return true;
+}
+
+nav_msgs::msg::Path simplifyPath(const nav_msgs::msg::Path & path, double tolerance)
+{
+  if (path.poses.size() < 3) {
+    return path;
+  }
+
+  std::vector<bool> keep(path.poses.size(), false);
+  keep.front() = keep.back() = true;
+  std::vector<std::pair<std::size_t, std::size_t>> spans{{0, path.poses.size() - 1}};
+  while (!spans.empty()) {
+    const auto span = spans.back();
+    spans.pop_back();
+    const auto & a = path.poses[span.first].pose.position;
+    const auto & b = path.poses[span.second].pose.position;
+    double farthest = 0.0;
+    std::size_t index = span.first;
+    for (std::size_t i = span.first + 1; i < span.second; i++) {
+      const double distance = segmentDistance(path.poses[i].pose.position, a, b);
+      if (distance > farthest) {
+        farthest = distance;
+        index = i;
+      }
+    }
+    if (farthest > tolerance) {
+      keep[index] = true;
+      spans.emplace_back(span.first, index);
+      spans.emplace_back(index, span.second);
+    }
+  }
+
+  nav_msgs::msg::Path simplified;
+  simplified.header = path.header;
+  for (std::size_t i = 0; i < path.poses.size(); i++) {
+    if (keep[i]) {
+      simplified.poses.push_back(path.poses[i]);
+    }
+  }
+  return simplified;
+}
+
+nav2_msgs::msg::CompactParticleCloud downsampleParticles(
+  const nav2_msgs::msg::CompactParticleCloud & cloud, std::size_t max_particles)
+{
+  const std::size_t size = cloud.x.size();
+  if (size <= max_particles || max_particles == 0) {
+    return cloud;
+  }
+
+  double total = 0.0;
+  for (float weight : cloud.weight) {
+    total += weight;
+  }
+  const bool weighted = cloud.weight.size() == size && total > 0.0;
+  if (!weighted) {
+    total = static_cast<double>(size);
+  }
+
+  nav2_msgs::msg::CompactParticleCloud downsampled;
+  downsampled.header = cloud.header;
+  downsampled.x.reserve(max_particles);
+  downsampled.y.reserve(max_particles);
+  downsampled.yaw.reserve(max_particles);
+  downsampled.weight.assign(max_particles, static_cast<float>(1.0 / max_particles));
+
+  // A fixed offset rather than a random one, the same cloud gives the same particles
+  const double step = total / max_particles;
+  double target = step / 2.0;
+  double cumulative = 0.0;
+  std::size_t i = 0;
+  for (std::size_t k = 0; k < max_particles; k++) {
+    while (i + 1 < size && cumulative + (weighted ? cloud.weight[i] : 1.0) < target) {
+      cumulative += weighted ? cloud.weight[i] : 1.0;
+      i++;
+    }
+    downsampled.x.push_back(cloud.x[i]);
+    downsampled.y.push_back(cloud.y[i]);
+    downsampled.yaw.push_back(cloud.yaw[i]);
+    target += step;
+  }
+  return downsampled;
+}
+
+MonitoringBridge::MonitoringBridge(const rclcpp::NodeOptions & options)
+: rclcpp::Node("monitoring_bridge", options)
+{
+  bandwidth_limit_ = declare_parameter("bandwidth_limit", 250000.0);
+  publish_frequency_ = declare_parameter("publish_frequency", 10.0);
+  path_tolerance_ = declare_parameter("path_tolerance", 0.05);
+  max_particles_ = static_cast<std::size_t>(std::max<int64_t>(
+      declare_parameter("max_particles", 200), 1));
+  keyframe_period_ = rclcpp::Duration::from_seconds(
+    declare_parameter("costmap_keyframe_period", 10.0));
+  output_prefix_ = declare_parameter("output_prefix", std::string("monitor"));
+  const auto costmap_topics = declare_parameter(
+    "costmap_topics",
+    std::vector<std::string>{"global_costmap/costmap", "local_costmap/costmap"});
+  const auto path_topics = declare_parameter(
+    "path_topics", std::vector<std::string>{"plan", "local_plan"});
+  const auto particle_cloud_topics = declare_parameter(
+    "particle_cloud_topics", std::vector<std::string>{"particle_cloud_compact"});
+
+  if (publish_frequency_ <= 0.0) {
+    throw std::runtime_error("monitoring_bridge: publish_frequency must be positive");
+  }
+
+  for (const auto & topic : costmap_topics) {
+    addCostmap(topic);
+  }
+  for (const auto & topic : path_topics) {
+    addPath(topic);
+  }
+  for (const auto & topic : particle_cloud_topics) {
+    addParticleCloud(topic);
+  }
+
+  budget_ = bandwidth_limit_;
+  timer_ = create_wall_timer(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(1.0 / publish_frequency_)),
+    [this]() {schedule();});
+
+  RCLCPP_INFO(
+    get_logger(), "Republishing %zu topics under %s, within %.0f bytes/s",
+    streams_.size(), output_prefix_.c_str(), bandwidth_limit_);
+}
+
+std::string MonitoringBridge::outputTopic(const std::string & topic) const
+{
+  const std::string relative = !topic.empty() && topic[0] == '/' ? topic.substr(1) : topic;
+  return output_prefix_.empty() ? relative : output_prefix_ + "/" + relative;
+}
+
+void MonitoringBridge::addCostmap(const std::string & topic)
+{
+  auto state = std::make_shared<CostmapState>();
+  state->grid_pub = create_publisher<nav_msgs::msg::OccupancyGrid>(
+    outputTopic(topic), rclcpp::QoS(1).transient_local());
+  state->update_pub = create_publisher<map_msgs::msg::OccupancyGridUpdate>(
+    outputTopic(topic) + "_updates", rclcpp::QoS(10));
+  publishers_.push_back(state->grid_pub);
+  publishers_.push_back(state->update_pub);
+
+  streams_.push_back(std::make_unique<Stream>());
+  Stream & stream = *streams_.back();
+  stream.priority = kCostmapPriority;
+  subscriptions_.push_back(
+    create_subscription<nav_msgs::msg::OccupancyGrid>(
+      topic, rclcpp::QoS(1),
+      [this, state, &stream](const nav_msgs::msg::OccupancyGrid::SharedPtr msg) {
+        state->latest = msg;
+        queueCostmap(state, stream);
+      }));
+}
+
+void MonitoringBridge::queueCostmap(const std::shared_ptr<CostmapState> & state, Stream & stream)
+{
+  const auto grid = state->latest;
+  const rclcpp::Time now = this->now();
+  bool keyframe = !state->sent || !sameGeometry(state->sent->info, grid->info) ||
+    (keyframe_period_ > rclcpp::Duration(0) && now - state->last_keyframe >= keyframe_period_);
+
+  auto update = std::make_shared<map_msgs::msg::OccupancyGridUpdate>();
+  if (!keyframe) {
+    changedRegion(state->sent->data, grid->data, grid->info.width, *update);
+    if (update->data.empty()) {
+      // Whatever was waiting has been undone, the remote grid is up to date
+      stream.pending = false;
+      return;
+    }
+    // A grid is cheaper than an update covering most of it
+    keyframe = update->data.size() * 2 > grid->data.size();
+  }
+
+  stream.pending = true;
+  if (keyframe) {
+    stream.bytes = kGridInfoBytes + grid->header.frame_id.size() + grid->data.size();
+    stream.send = [this, state, grid]() {
+        state->grid_pub->publish(*grid);
+        state->sent = grid;
+        state->last_keyframe = this->now();
+      };
+  } else {
+    update->header = grid->header;
+    stream.bytes = kHeaderBytes + kUpdateInfoBytes + grid->header.frame_id.size() +
+      update->data.size();
+    stream.send = [state, grid, update]() {
+        state->update_pub->publish(*update);
+        state->sent = grid;
+      };
+  }
+}
+
+void MonitoringBridge::addPath(const std::string & topic)
+{
+  auto pub = create_publisher<nav_msgs::msg::Path>(outputTopic(topic), rclcpp::QoS(1));
+  publishers_.push_back(pub);
+
+  streams_.push_back(std::make_unique<Stream>());
+  Stream & stream = *streams_.back();
+  stream.priority = kPathPriority;
+  subscriptions_.push_back(
+    create_subscription<nav_msgs::msg::Path>(
+      topic, rclcpp::QoS(1),
+      [this, pub, &stream](const nav_msgs::msg::Path::SharedPtr msg) {
+        auto path = std::make_shared<nav_msgs::msg::Path>(simplifyPath(*msg, path_tolerance_));
+        const std::size_t frame_bytes = kHeaderBytes + path->header.frame_id.size();
+        stream.pending = true;
+        stream.bytes = frame_bytes + path->poses.size() * (frame_bytes + kPoseBytes);
+        stream.send = [pub, path]() {pub->publish(*path);};
+      }));
+}
+
+void MonitoringBridge::addParticleCloud(const std::string & topic)
+{
+  auto pub = create_publisher<nav2_msgs::msg::CompactParticleCloud>(
+    outputTopic(topic), rclcpp::SensorDataQoS());
+  publishers_.push_back(pub);
+
+  streams_.push_back(std::make_unique<Stream>());
+  Stream & stream = *streams_.back();
+  stream.priority = kParticlePriority;
+  subscriptions_.push_back(
+    create_subscription<nav2_msgs::msg::CompactParticleCloud>(
+      topic, rclcpp::SensorDataQoS(),
+      [this, pub, &stream](const nav2_msgs::msg::CompactParticleCloud::SharedPtr msg) {
+        auto cloud = std::make_shared<nav2_msgs::msg::CompactParticleCloud>(
+          downsampleParticles(*msg, max_particles_));
+        stream.pending = true;
+        stream.bytes = kHeaderBytes + cloud->header.frame_id.size() +
+          4 * sizeof(float) * cloud->x.size();
+        stream.send = [pub, cloud]() {pub->publish(*cloud);};
+      }));
+}
+
+void MonitoringBridge::schedule()
+{
+  const bool limited = bandwidth_limit_ > 0.0;
+  // Unused bandwidth carries over for up to a second
+  budget_ = std::min(budget_ + bandwidth_limit_ / publish_frequency_, bandwidth_limit_);
+
+  std::vector<Stream *> waiting;
+  for (auto & stream : streams_) {
+    if (stream->pending) {
+      waiting.push_back(stream.get());
+    }
+  }
+  std::stable_sort(
+    waiting.begin(), waiting.end(), [](const Stream * a, const Stream * b) {
+      return a->priority + static_cast<int>(a->waited) > b->priority + static_cast<int>(b->waited);
+    });
+
+  bool blocked = false;
+  for (Stream * stream : waiting) {
+    // A message bigger than a second of bandwidth goes on a full budget and leaves a debt,
+    // the ones after it wait so that it isn't overtaken forever
+    if (!blocked &&
+      (!limited || stream->bytes <= budget_ || budget_ >= bandwidth_limit_))
+    {
+      stream->send();
+      stream->pending = false;
+      stream->waited = 0;
+      budget_ -= stream->bytes;
+    } else {
+      blocked = true;
+      stream->waited++;
+    }
+  }
+}
+
+}  // namespace nav2_util
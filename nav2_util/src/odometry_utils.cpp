@@ -13,7 +13,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "nav2_util/odometry_utils.hpp"
 
@@ -28,74 +30,101 @@ OdomSmoother::OdomSmoother(
   double filter_duration,
   std::string odom_topic)
 : node_(nh),
-  odom_history_duration_(rclcpp::Duration::from_seconds(filter_duration))
+  odom_history_duration_(rclcpp::Duration::from_seconds(filter_duration)),
+  odom_history_(64),
+  frame_id_(std::make_shared<const std::string>())
 {
   odom_sub_ = nh->create_subscription<nav_msgs::msg::Odometry>(
     odom_topic,
     rclcpp::SystemDefaultsQoS(),
     std::bind(&OdomSmoother::odomCallback, this, std::placeholders::_1));
-
-  odom_cumulate_.twist.twist.linear.x = 0;
-  odom_cumulate_.twist.twist.linear.y = 0;
-  odom_cumulate_.twist.twist.linear.z = 0;
-  odom_cumulate_.twist.twist.angular.x = 0;
-  odom_cumulate_.twist.twist.angular.y = 0;
-  odom_cumulate_.twist.twist.angular.z = 0;
 }
 
 void OdomSmoother::odomCallback(const nav_msgs::msg::Odometry::SharedPtr msg)
 {
   std::lock_guard<std::mutex> lock(odom_mutex_);
 
-  // update cumulated odom only if history is not empty
-  if (!odom_history_.empty()) {
-    // to store current time
-    auto current_time = rclcpp::Time(msg->header.stamp);
-
-    // to store time of the first odom in history
-    auto front_time = rclcpp::Time(odom_history_.front().header.stamp);
-
-    // update cumulated odom when duration has exceeded and pop earliest msg
-    while (current_time - front_time > odom_history_duration_) {
-      const auto & odom = odom_history_.front();
-      odom_cumulate_.twist.twist.linear.x -= odom.twist.twist.linear.x;
-      odom_cumulate_.twist.twist.linear.y -= odom.twist.twist.linear.y;
-      odom_cumulate_.twist.twist.linear.z -= odom.twist.twist.linear.z;
-      odom_cumulate_.twist.twist.angular.x -= odom.twist.twist.angular.x;
-      odom_cumulate_.twist.twist.angular.y -= odom.twist.twist.angular.y;
-      odom_cumulate_.twist.twist.angular.z -= odom.twist.twist.angular.z;
-      odom_history_.pop_front();
-
-      if (odom_history_.empty()) {
-        break;
-      }
-
-      // update with the timestamp of earliest odom message in history
-      front_time = rclcpp::Time(odom_history_.front().header.stamp);
+  const int64_t current_time = rclcpp::Time(msg->header.stamp).nanoseconds();
+  const int64_t history_duration = odom_history_duration_.nanoseconds();
+
+  // update cumulated odom when duration has exceeded and pop earliest msg
+  while (count_ > 0 && current_time - odom_history_[head_].stamp > history_duration) {
+    const TwistArray & twist = odom_history_[head_].twist;
+    for (std::size_t i = 0; i < twist.size(); i++) {
+      odom_cumulate_[i] -= twist[i];
+    }
+    head_ = (head_ + 1) % odom_history_.size();
+    count_--;
+  }
+
+  if (count_ == 0) {
+    // Nothing left to subtract from, drop the rounding errors of the running sums
+    odom_cumulate_.fill(0.0);
+  } else if (count_ == odom_history_.size()) {
+    // A full history is shorter than odom_history_duration_, make room in order
+    std::vector<Sample> history(odom_history_.size() * 2);
+    for (std::size_t i = 0; i < count_; i++) {
+      history[i] = odom_history_[(head_ + i) % odom_history_.size()];
     }
+    odom_history_.swap(history);
+    head_ = 0;
+  }
+
+  Sample & sample = odom_history_[(head_ + count_) % odom_history_.size()];
+  sample.stamp = current_time;
+  const auto & twist = msg->twist.twist;
+  sample.twist = {{twist.linear.x, twist.linear.y, twist.linear.z,
+      twist.angular.x, twist.angular.y, twist.angular.z}};
+  count_++;
+  for (std::size_t i = 0; i < sample.twist.size(); i++) {
+    odom_cumulate_[i] += sample.twist[i];
+  }
+
+  updateState(msg->header);
+}
+
+void OdomSmoother::updateState(const std_msgs::msg::Header & header)
+{
+  std::shared_ptr<const std::string> frame_id = std::atomic_load(&frame_id_);
+  if (*frame_id != header.frame_id) {
+    std::atomic_store(&frame_id_, std::make_shared<const std::string>(header.frame_id));
   }
 
-  odom_history_.push_back(*msg);
-  updateState();
+  Sample average;
+  average.stamp = rclcpp::Time(header.stamp).nanoseconds();
+  for (std::size_t i = 0; i < odom_cumulate_.size(); i++) {
+    average.twist[i] = odom_cumulate_[i] / count_;
+  }
+  vel_smooth_.store(average);
+}
+
+geometry_msgs::msg::Twist OdomSmoother::getTwist()
+{
+  const TwistArray twist = vel_smooth_.load().twist;
+  geometry_msgs::msg::Twist msg;
+  msg.linear.x = twist[0];
+  msg.linear.y = twist[1];
+  msg.linear.z = twist[2];
+  msg.angular.x = twist[3];
+  msg.angular.y = twist[4];
+  msg.angular.z = twist[5];
+  return msg;
 }
 
-void OdomSmoother::updateState()
+geometry_msgs::msg::TwistStamped OdomSmoother::getTwistStamped()
 {
-  const auto & odom = odom_history_.back();
-  odom_cumulate_.twist.twist.linear.x += odom.twist.twist.linear.x;
-  odom_cumulate_.twist.twist.linear.y += odom.twist.twist.linear.y;
-  odom_cumulate_.twist.twist.linear.z += odom.twist.twist.linear.z;
-  odom_cumulate_.twist.twist.angular.x += odom.twist.twist.angular.x;
-  odom_cumulate_.twist.twist.angular.y += odom.twist.twist.angular.y;
-  odom_cumulate_.twist.twist.angular.z += odom.twist.twist.angular.z;
-
-  vel_smooth_.header = odom.header;
-  vel_smooth_.twist.linear.x = odom_cumulate_.twist.twist.linear.x / odom_history_.size();
-  vel_smooth_.twist.linear.y = odom_cumulate_.twist.twist.linear.y / odom_history_.size();
-  vel_smooth_.twist.linear.z = odom_cumulate_.twist.twist.linear.z / odom_history_.size();
-  vel_smooth_.twist.angular.x = odom_cumulate_.twist.twist.angular.x / odom_history_.size();
-  vel_smooth_.twist.angular.y = odom_cumulate_.twist.twist.angular.y / odom_history_.size();
-  vel_smooth_.twist.angular.z = odom_cumulate_.twist.twist.angular.z / odom_history_.size();
+  const Sample average = vel_smooth_.load();
+  const TwistArray & twist = average.twist;
+  geometry_msgs::msg::TwistStamped msg;
+  msg.header.stamp = rclcpp::Time(average.stamp);
+  msg.header.frame_id = *std::atomic_load(&frame_id_);
+  msg.twist.linear.x = twist[0];
+  msg.twist.linear.y = twist[1];
+  msg.twist.linear.z = twist[2];
+  msg.twist.angular.x = twist[3];
+  msg.twist.angular.y = twist[4];
+  msg.twist.angular.z = twist[5];
+  return msg;
 }
 
 }  // namespace nav2_util
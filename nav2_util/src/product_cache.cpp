@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/product_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+const char PRODUCT_MAGIC[] = "NAV2PRD";
+const uint32_t PRODUCT_VERSION = 2;
+
+uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+uint64_t mix(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+}  // namespace
+
+uint64_t hashBytes(const void * data, std::size_t size, uint64_t seed)
+{
+  const uint64_t k1 = 0x87c37b91114253d5ULL;
+  const uint64_t k2 = 0x4cf5ad432745937fULL;
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  uint64_t h = seed ^ (size * k1);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    h ^= rotl(word * k1, 31) * k2;
+    h = rotl(h, 27) * 5 + 0x52dce729;
+  }
+  uint64_t tail = 0;
+  for (std::size_t shift = 0; i < size; ++i, shift += 8) {
+    tail |= static_cast<uint64_t>(bytes[i]) << shift;
+  }
+  h ^= rotl(tail * k1, 31) * k2;
+  return mix(h);
+}
+
+ProductCache::ProductCache(const std::string & directory)
+: directory_(directory)
+{
+}
+
+std::string ProductCache::path(const std::string & kind, uint64_t key) const
+{
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+  return directory_ + "/" + kind + "-" + name + ".bin";
+}
+
+bool ProductCache::store(
+  const std::string & kind, uint64_t key, const std::vector<Section> & sections) const
+{
+  if (!enabled()) {
+    return false;
+  }
+  SectionFileInfo info;
+  info.magic = PRODUCT_MAGIC;
+  info.version = PRODUCT_VERSION;
+  info.key = key;
+  info.label = kind;
+  std::vector<SectionBytes> bytes;
+  bytes.reserve(sections.size());
+  for (const Section & section : sections) {
+    bytes.push_back(SectionBytes{"", section.first, section.second});
+  }
+  return writeSectionFile(path(kind, key), info, bytes);
+}
+
+std::unique_ptr<ProductCache::Product> ProductCache::load(
+  const std::string & kind, uint64_t key) const
+{
+  if (!enabled()) {
+    return nullptr;
+  }
+  auto file = SectionFile::open(path(kind, key), PRODUCT_MAGIC, PRODUCT_VERSION);
+  if (!file || file->key() != key) {
+    return nullptr;
+  }
+  return std::unique_ptr<Product>(new Product(std::move(file)));
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,200 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "nav2_util/robot_state_cache.hpp"
+#include "tf2/LinearMath/Quaternion.h"
+#include "tf2/time.h"
+
+namespace nav2_util
+{
+
+const std::size_t RobotStateCache::HISTORY_SIZE;
+
+RobotStateCache::RobotStateCache(
+  std::shared_ptr<tf2_ros::Buffer> tf_buffer,
+  const std::string & global_frame,
+  const std::string & robot_frame)
+: tf_buffer_(tf_buffer),
+  global_frame_(global_frame),
+  robot_frame_(robot_frame),
+  history_()
+{
+}
+
+void RobotStateCache::stop()
+{
+  timer_.reset();
+  odom_sub_.reset();
+}
+
+bool RobotStateCache::updatePose()
+{
+  geometry_msgs::msg::TransformStamped transform;
+  try {
+    transform = tf_buffer_->lookupTransform(global_frame_, robot_frame_, tf2::TimePointZero);
+  } catch (tf2::TransformException & ex) {
+    RCLCPP_DEBUG(
+      rclcpp::get_logger("RobotStateCache"),
+      "Failed to look up robot pose: %s", ex.what());
+    return false;
+  }
+
+  PoseSample sample;
+  sample.stamp = rclcpp::Time(transform.header.stamp).nanoseconds();
+  sample.x = transform.transform.translation.x;
+  sample.y = transform.transform.translation.y;
+  sample.z = transform.transform.translation.z;
+  sample.qx = transform.transform.rotation.x;
+  sample.qy = transform.transform.rotation.y;
+  sample.qz = transform.transform.rotation.z;
+  sample.qw = transform.transform.rotation.w;
+
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  if (history_.count > 0) {
+    const int64_t newest_stamp = history_.samples[history_.newest].stamp;
+    if (sample.stamp == newest_stamp) {
+      // TF hasn't received anything newer
+      return true;
+    }
+    if (sample.stamp < newest_stamp) {
+      // Time went backwards, e.g. a simulation was restarted
+      history_.count = 0;
+    }
+  }
+
+  history_.newest = history_.count == 0 ? 0 : (history_.newest + 1) % HISTORY_SIZE;
+  history_.samples[history_.newest] = sample;
+  history_.count = std::min(history_.count + 1, HISTORY_SIZE);
+  poses_.store(history_);
+  return true;
+}
+
+void RobotStateCache::updateOdometry(const nav_msgs::msg::Odometry & odom)
+{
+  TwistSample sample;
+  sample.valid = true;
+  sample.stamp = rclcpp::Time(odom.header.stamp).nanoseconds();
+  sample.linear_x = odom.twist.twist.linear.x;
+  sample.linear_y = odom.twist.twist.linear.y;
+  sample.linear_z = odom.twist.twist.linear.z;
+  sample.angular_x = odom.twist.twist.angular.x;
+  sample.angular_y = odom.twist.twist.angular.y;
+  sample.angular_z = odom.twist.twist.angular.z;
+
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  twist_.store(sample);
+}
+
+void RobotStateCache::fillPose(
+  const PoseSample & sample, geometry_msgs::msg::PoseStamped & pose) const
+{
+  pose.header.frame_id = global_frame_;
+  pose.header.stamp = rclcpp::Time(sample.stamp);
+  pose.pose.position.x = sample.x;
+  pose.pose.position.y = sample.y;
+  pose.pose.position.z = sample.z;
+  pose.pose.orientation.x = sample.qx;
+  pose.pose.orientation.y = sample.qy;
+  pose.pose.orientation.z = sample.qz;
+  pose.pose.orientation.w = sample.qw;
+}
+
+bool RobotStateCache::getLatestPose(geometry_msgs::msg::PoseStamped & pose) const
+{
+  const PoseHistory history = poses_.load();
+  if (history.count == 0) {
+    return false;
+  }
+  fillPose(history.samples[history.newest], pose);
+  return true;
+}
+
+bool RobotStateCache::getPose(
+  const rclcpp::Time & stamp, const rclcpp::Duration & tolerance,
+  geometry_msgs::msg::PoseStamped & pose) const
+{
+  const PoseHistory history = poses_.load();
+  if (history.count == 0) {
+    return false;
+  }
+
+  const int64_t time = stamp.nanoseconds();
+  const int64_t tolerance_ns = tolerance.nanoseconds();
+  const PoseSample & newest = history.samples[history.newest];
+  const PoseSample & oldest =
+    history.samples[(history.newest + HISTORY_SIZE - (history.count - 1)) % HISTORY_SIZE];
+
+  if (time >= newest.stamp || time <= oldest.stamp) {
+    const PoseSample & closest = time >= newest.stamp ? newest : oldest;
+    if (std::abs(time - closest.stamp) > tolerance_ns) {
+      return false;
+    }
+    fillPose(closest, pose);
+    pose.header.stamp = stamp;
+    return true;
+  }
+
+  // Walk back from the newest pose to the pair around the requested time
+  std::size_t after = history.newest;
+  std::size_t before = (after + HISTORY_SIZE - 1) % HISTORY_SIZE;
+  while (history.samples[before].stamp > time) {
+    after = before;
+    before = (before + HISTORY_SIZE - 1) % HISTORY_SIZE;
+  }
+
+  const PoseSample & a = history.samples[before];
+  const PoseSample & b = history.samples[after];
+  const double ratio = static_cast<double>(time - a.stamp) / static_cast<double>(b.stamp - a.stamp);
+
+  tf2::Quaternion qa(a.qx, a.qy, a.qz, a.qw);
+  tf2::Quaternion qb(b.qx, b.qy, b.qz, b.qw);
+  tf2::Quaternion q = qa.slerp(qb, ratio);
+
+  PoseSample sample;
+  sample.stamp = time;
+  sample.x = a.x + (b.x - a.x) * ratio;
+  sample.y = a.y + (b.y - a.y) * ratio;
+  sample.z = a.z + (b.z - a.z) * ratio;
+  sample.qx = q.x();
+  sample.qy = q.y();
+  sample.qz = q.z();
+  sample.qw = q.w();
+  fillPose(sample, pose);
+  pose.header.stamp = stamp;
+  return true;
+}
+
+bool RobotStateCache::getTwist(geometry_msgs::msg::TwistStamped & twist) const
+{
+  const TwistSample sample = twist_.load();
+  if (!sample.valid) {
+    return false;
+  }
+  twist.header.frame_id = robot_frame_;
+  twist.header.stamp = rclcpp::Time(sample.stamp);
+  twist.twist.linear.x = sample.linear_x;
+  twist.twist.linear.y = sample.linear_y;
+  twist.twist.linear.z = sample.linear_z;
+  twist.twist.angular.x = sample.angular_x;
+  twist.twist.angular.y = sample.angular_y;
+  twist.twist.angular.z = sample.angular_z;
+  return true;
+}
+
+}  // namespace nav2_util
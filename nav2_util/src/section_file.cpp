@@ -0,0 +1,214 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/section_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nav2_util
+{
+
+constexpr std::size_t SectionFile::name_size;
+
+namespace
+{
+
+const std::size_t SECTION_ALIGNMENT = 64;
+const std::size_t MAGIC_SIZE = 8;
+
+struct FileHeader
+{
+  char magic[MAGIC_SIZE];
+  uint32_t version;
+  uint32_t section_count;
+  uint64_t key;
+  int64_t stamp;
+  char label[SectionFile::name_size];
+};
+
+struct SectionEntry
+{
+  char name[SectionFile::name_size];
+  uint64_t offset;
+  uint64_t size;
+};
+
+std::size_t alignUp(std::size_t offset)
+{
+  return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// Strings are cut to fit, and need not be terminated when they fill the field
+template<std::size_t N>
+void copyField(char (& field)[N], const std::string & value)
+{
+  std::memset(field, 0, N);
+  std::memcpy(field, value.data(), std::min(value.size(), N));
+}
+
+template<std::size_t N>
+std::string readField(const char (& field)[N])
+{
+  return std::string(field, strnlen(field, N));
+}
+
+}  // namespace
+
+bool writeSectionFile(
+  const std::string & path, const SectionFileInfo & info,
+  const std::vector<SectionBytes> & sections)
+{
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  copyField(header.magic, info.magic);
+  header.version = info.version;
+  header.section_count = static_cast<uint32_t>(sections.size());
+  header.key = info.key;
+  header.stamp = info.stamp;
+  copyField(header.label, info.label);
+
+  std::vector<SectionEntry> table(sections.size());
+  std::size_t offset = alignUp(sizeof(header) + table.size() * sizeof(SectionEntry));
+  for (std::size_t i = 0; i < sections.size(); ++i) {
+    copyField(table[i].name, sections[i].name);
+    table[i].offset = offset;
+    table[i].size = sections[i].size;
+    offset = alignUp(offset + sections[i].size);
+  }
+
+  // Unique to the process, so that two of them writing the same file don't mix their writes
+  std::ostringstream temporary;
+  temporary << path << ".tmp";
+#ifndef _WIN32
+  temporary << "." << getpid();
+#endif
+  {
+    std::ofstream file(temporary.str(), std::ios::binary | std::ios::trunc);
+    const char padding[SECTION_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(
+      reinterpret_cast<const char *>(table.data()), table.size() * sizeof(SectionEntry));
+    std::size_t written = sizeof(header) + table.size() * sizeof(SectionEntry);
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+      file.write(padding, table[i].offset - written);
+      if (sections[i].size > 0) {
+        file.write(static_cast<const char *>(sections[i].data), sections[i].size);
+      }
+      written = table[i].offset + sections[i].size;
+    }
+    if (!file) {
+      std::remove(temporary.str().c_str());
+      return false;
+    }
+  }
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temporary.str().c_str(), path.c_str()) != 0) {
+    std::remove(temporary.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<SectionFile> SectionFile::open(
+  const std::string & path, const std::string & magic, uint32_t version)
+{
+  std::unique_ptr<SectionFile> file(new SectionFile());
+
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+    close(fd);
+    return nullptr;
+  }
+  file->length_ = static_cast<std::size_t>(file_stat.st_size);
+  void * mapped = mmap(nullptr, file->length_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  file->base_ = static_cast<const char *>(mapped);
+  file->mapped_ = true;
+#else
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+  if (!stream) {
+    return nullptr;
+  }
+  file->buffer_.resize(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0);
+  if (!stream.read(file->buffer_.data(), file->buffer_.size())) {
+    return nullptr;
+  }
+  file->base_ = file->buffer_.data();
+  file->length_ = file->buffer_.size();
+#endif
+
+  FileHeader header;
+  if (file->length_ < sizeof(header)) {
+    return nullptr;
+  }
+  std::memcpy(&header, file->base_, sizeof(header));
+  char expected_magic[MAGIC_SIZE];
+  copyField(expected_magic, magic);
+  const std::size_t table_end = sizeof(header) + header.section_count * sizeof(SectionEntry);
+  if (std::memcmp(header.magic, expected_magic, MAGIC_SIZE) != 0 ||
+    header.version != version || table_end > file->length_)
+  {
+    return nullptr;
+  }
+  file->key_ = header.key;
+  file->stamp_ = header.stamp;
+  file->label_ = readField(header.label);
+  file->sections_.reserve(header.section_count);
+  for (uint32_t i = 0; i < header.section_count; ++i) {
+    SectionEntry entry;
+    std::memcpy(&entry, file->base_ + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    if (entry.offset > file->length_ || entry.size > file->length_ - entry.offset) {
+      return nullptr;
+    }
+    file->sections_.push_back(
+      Section{readField(entry.name), static_cast<std::size_t>(entry.offset),
+        static_cast<std::size_t>(entry.size)});
+  }
+  return file;
+}
+
+SectionFile::~SectionFile()
+{
+#ifndef _WIN32
+  if (mapped_) {
+    munmap(const_cast<char *>(base_), length_);
+  }
+#endif
+}
+
+}  // namespace nav2_util
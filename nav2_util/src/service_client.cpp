@@ -0,0 +1,61 @@
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/service_client.hpp"
+
+#include <map>
+#include <memory>
+
+namespace nav2_util
+{
+
+std::shared_ptr<NodeSpinner> NodeSpinner::get(const rclcpp::Node::SharedPtr & node)
+{
+  static std::mutex spinners_mutex;
+  // A live spinner holds its node, so the address isn't reused while the entry is alive
+  static std::map<const rclcpp::Node *, std::weak_ptr<NodeSpinner>> spinners;
+
+  std::lock_guard<std::mutex> lock(spinners_mutex);
+  auto & entry = spinners[node.get()];
+  auto spinner = entry.lock();
+  if (!spinner) {
+    spinner = std::make_shared<NodeSpinner>(node);
+    entry = spinner;
+  }
+
+  // Forget the nodes that are gone
+  for (auto it = spinners.begin(); it != spinners.end(); ) {
+    it = it->second.expired() ? spinners.erase(it) : std::next(it);
+  }
+  return spinner;
+}
+
+NodeSpinner::NodeSpinner(const rclcpp::Node::SharedPtr & node)
+: node_(node)
+{
+  executor_.add_node(node_);
+}
+
+NodeSpinner::~NodeSpinner()
+{
+  executor_.remove_node(node_);
+}
+
+void NodeSpinner::spin_once(const std::chrono::nanoseconds timeout)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  executor_.spin_once(timeout);
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/shared_tf_buffer.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "nav2_util/node_utils.hpp"
+#include "tf2_ros/create_timer_ros.h"
+#include "tf2_ros/transform_listener.h"
+
+namespace nav2_util
+{
+
+namespace
+{
+
+struct SharedTf
+{
+  explicit SharedTf(bool use_sim_time)
+  {
+    auto options = rclcpp::NodeOptions()
+      .start_parameter_services(false)
+      .start_parameter_event_publisher(false)
+      .parameter_overrides({rclcpp::Parameter("use_sim_time", use_sim_time)});
+    node = rclcpp::Node::make_shared(
+      generate_internal_node_name(use_sim_time ? "shared_tf_sim" : "shared_tf"), options);
+
+    buffer = std::make_shared<tf2_ros::Buffer>(node->get_clock());
+    buffer->setCreateTimerInterface(
+      std::make_shared<tf2_ros::CreateTimerROS>(
+        node->get_node_base_interface(), node->get_node_timers_interface()));
+    buffer->setUsingDedicatedThread(true);
+    // Spins the node, with the /clock subscription of simulated time, on its own thread
+    listener = std::make_shared<tf2_ros::TransformListener>(*buffer, node, true);
+  }
+
+  rclcpp::Node::SharedPtr node;
+  std::shared_ptr<tf2_ros::Buffer> buffer;
+  std::shared_ptr<tf2_ros::TransformListener> listener;
+};
+
+}  // namespace
+
+std::shared_ptr<tf2_ros::Buffer> getSharedTfBuffer(bool use_sim_time)
+{
+  static std::mutex mutex;
+  static std::weak_ptr<SharedTf> shared[2];
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto tf = shared[use_sim_time].lock();
+  if (!tf) {
+    tf = std::make_shared<SharedTf>(use_sim_time);
+    shared[use_sim_time] = tf;
+  }
+  // Holding the buffer holds its listener
+  return std::shared_ptr<tf2_ros::Buffer>(tf, tf->buffer.get());
+}
+
+}  // namespace nav2_util
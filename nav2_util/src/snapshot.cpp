@@ -0,0 +1,145 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/snapshot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+const char SNAPSHOT_MAGIC[] = "NAV2SNP";
+const uint32_t SNAPSHOT_VERSION = 2;
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string & source)
+: source_(source)
+{
+}
+
+void * SnapshotWriter::addSection(const std::string & name, std::size_t size)
+{
+  const std::string key = name.substr(0, SectionFile::name_size);
+  auto it = std::find_if(
+    sections_.begin(), sections_.end(),
+    [&key](const Section & section) {return section.name == key;});
+  if (it == sections_.end()) {
+    sections_.push_back(Section{key, {}});
+    it = sections_.end() - 1;
+  }
+  it->data.assign(size, 0);
+  return it->data.data();
+}
+
+void SnapshotWriter::defer(Deferred fill)
+{
+  deferred_.push_back(std::move(fill));
+}
+
+bool SnapshotWriter::has(const std::string & name) const
+{
+  const std::string key = name.substr(0, SectionFile::name_size);
+  return std::any_of(
+    sections_.begin(), sections_.end(),
+    [&key](const Section & section) {return section.name == key;});
+}
+
+std::size_t SnapshotWriter::size() const
+{
+  std::size_t size = 0;
+  for (const auto & section : sections_) {
+    size += section.data.size();
+  }
+  return size;
+}
+
+bool SnapshotWriter::write(const std::string & path)
+{
+  // Taken out first, a deferred fill may defer another
+  while (!deferred_.empty()) {
+    std::vector<Deferred> deferred;
+    deferred.swap(deferred_);
+    for (const Deferred & fill : deferred) {
+      fill(*this);
+    }
+  }
+
+  SectionFileInfo info;
+  info.magic = SNAPSHOT_MAGIC;
+  info.version = SNAPSHOT_VERSION;
+  info.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  info.label = source_;
+  std::vector<SectionBytes> sections;
+  sections.reserve(sections_.size());
+  for (const Section & section : sections_) {
+    sections.push_back(SectionBytes{section.name, section.data.data(), section.data.size()});
+  }
+  return writeSectionFile(path, info, sections);
+}
+
+std::unique_ptr<Snapshot> Snapshot::load(const std::string & path)
+{
+  auto file = SectionFile::open(path, SNAPSHOT_MAGIC, SNAPSHOT_VERSION);
+  if (!file) {
+    return nullptr;
+  }
+  return std::unique_ptr<Snapshot>(new Snapshot(std::move(file)));
+}
+
+Snapshot::Snapshot(std::unique_ptr<SectionFile> file)
+: file_(std::move(file))
+{
+  for (std::size_t i = 0; i < file_->sectionCount(); ++i) {
+    sections_[file_->sectionName(i)] = i;
+  }
+}
+
+std::vector<std::string> Snapshot::sectionNames() const
+{
+  std::vector<std::string> names;
+  names.reserve(sections_.size());
+  for (const auto & section : sections_) {
+    names.push_back(section.first);
+  }
+  return names;
+}
+
+const void * Snapshot::section(const std::string & name, std::size_t & size) const
+{
+  auto it = sections_.find(name);
+  if (it == sections_.end()) {
+    size = 0;
+    return nullptr;
+  }
+  size = file_->sectionSize(it->second);
+  return file_->sectionData(it->second);
+}
+
+std::string Snapshot::string(const std::string & name) const
+{
+  std::size_t size = 0;
+  const void * data = section(name, size);
+  return data ? std::string(static_cast<const char *>(data), size) : std::string();
+}
+
+}  // namespace nav2_util
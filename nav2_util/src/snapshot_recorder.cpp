@@ -0,0 +1,438 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/snapshot_recorder.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_util/task_scheduler.hpp"
+
+namespace nav2_util
+{
+
+namespace
+{
+
+// Parameters are stored as their count, then per parameter its name, type and value.
+// Strings and arrays are led by their length.
+class Encoder
+{
+public:
+  template<typename T>
+  void put(const T & value)
+  {
+    const char * bytes = reinterpret_cast<const char *>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+  }
+
+  void putString(const std::string & value)
+  {
+    put(static_cast<uint32_t>(value.size()));
+    data_.insert(data_.end(), value.begin(), value.end());
+  }
+
+  template<typename T>
+  void putArray(const std::vector<T> & values)
+  {
+    put(static_cast<uint32_t>(values.size()));
+    for (const auto & value : values) {
+      put(value);
+    }
+  }
+
+  const std::vector<char> & data() const {return data_;}
+
+private:
+  std::vector<char> data_;
+};
+
+class Decoder
+{
+public:
+  Decoder(const char * data, std::size_t size)
+  : data_(data), size_(size) {}
+
+  template<typename T>
+  bool get(T & value)
+  {
+    if (size_ - offset_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool getString(std::string & value)
+  {
+    uint32_t length = 0;
+    if (!get(length) || size_ - offset_ < length) {
+      return false;
+    }
+    value.assign(data_ + offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  template<typename T>
+  bool getArray(std::vector<T> & values)
+  {
+    uint32_t count = 0;
+    if (!get(count)) {
+      return false;
+    }
+    values.resize(count);
+    for (auto & value : values) {
+      T element;
+      if (!get(element)) {
+        return false;
+      }
+      value = element;
+    }
+    return true;
+  }
+
+private:
+  const char * data_;
+  std::size_t size_;
+  std::size_t offset_{0};
+};
+
+// Position then orientation, 7 values per pose
+void putPose(const geometry_msgs::msg::Pose & pose, double * values)
+{
+  values[0] = pose.position.x;
+  values[1] = pose.position.y;
+  values[2] = pose.position.z;
+  values[3] = pose.orientation.x;
+  values[4] = pose.orientation.y;
+  values[5] = pose.orientation.z;
+  values[6] = pose.orientation.w;
+}
+
+void getPose(const double * values, geometry_msgs::msg::Pose & pose)
+{
+  pose.position.x = values[0];
+  pose.position.y = values[1];
+  pose.position.z = values[2];
+  pose.orientation.x = values[3];
+  pose.orientation.y = values[4];
+  pose.orientation.z = values[5];
+  pose.orientation.w = values[6];
+}
+
+const std::size_t POSE_VALUES = 7;
+
+}  // namespace
+
+void addPose(
+  SnapshotWriter & writer, const std::string & name,
+  const geometry_msgs::msg::PoseStamped & pose)
+{
+  double values[POSE_VALUES];
+  putPose(pose.pose, values);
+  writer.addArray(name, values, POSE_VALUES);
+  writer.addString(name + "/frame", pose.header.frame_id);
+}
+
+bool readPose(
+  const Snapshot & snapshot, const std::string & name, geometry_msgs::msg::PoseStamped & pose)
+{
+  std::size_t count = 0;
+  const double * values = snapshot.array<double>(name, count);
+  if (!values || count != POSE_VALUES) {
+    return false;
+  }
+  getPose(values, pose.pose);
+  pose.header.frame_id = snapshot.string(name + "/frame");
+  return true;
+}
+
+void addPath(SnapshotWriter & writer, const std::string & name, const nav_msgs::msg::Path & path)
+{
+  double * values = static_cast<double *>(
+    writer.addSection(name, path.poses.size() * POSE_VALUES * sizeof(double)));
+  for (const auto & pose : path.poses) {
+    putPose(pose.pose, values);
+    values += POSE_VALUES;
+  }
+  writer.addString(name + "/frame", path.header.frame_id);
+}
+
+bool readPath(const Snapshot & snapshot, const std::string & name, nav_msgs::msg::Path & path)
+{
+  std::size_t count = 0;
+  const double * values = snapshot.array<double>(name, count);
+  if (!values) {
+    return false;
+  }
+  path.header.frame_id = snapshot.string(name + "/frame");
+  path.poses.resize(count / POSE_VALUES);
+  for (auto & pose : path.poses) {
+    pose.header.frame_id = path.header.frame_id;
+    getPose(values, pose.pose);
+    values += POSE_VALUES;
+  }
+  return true;
+}
+
+void addTwist(
+  SnapshotWriter & writer, const std::string & name, const geometry_msgs::msg::Twist & twist)
+{
+  const double values[6] = {
+    twist.linear.x, twist.linear.y, twist.linear.z,
+    twist.angular.x, twist.angular.y, twist.angular.z};
+  writer.addArray(name, values, 6);
+}
+
+bool readTwist(
+  const Snapshot & snapshot, const std::string & name, geometry_msgs::msg::Twist & twist)
+{
+  std::size_t count = 0;
+  const double * values = snapshot.array<double>(name, count);
+  if (!values || count != 6) {
+    return false;
+  }
+  twist.linear.x = values[0];
+  twist.linear.y = values[1];
+  twist.linear.z = values[2];
+  twist.angular.x = values[3];
+  twist.angular.y = values[4];
+  twist.angular.z = values[5];
+  return true;
+}
+
+void addParameters(
+  SnapshotWriter & writer, const std::string & name,
+  const std::vector<rclcpp::Parameter> & parameters)
+{
+  Encoder encoder;
+  encoder.put(static_cast<uint32_t>(parameters.size()));
+  for (const auto & parameter : parameters) {
+    encoder.putString(parameter.get_name());
+    encoder.put(static_cast<uint8_t>(parameter.get_type()));
+    switch (parameter.get_type()) {
+      case rclcpp::ParameterType::PARAMETER_BOOL:
+        encoder.put(static_cast<uint8_t>(parameter.as_bool()));
+        break;
+      case rclcpp::ParameterType::PARAMETER_INTEGER:
+        encoder.put(static_cast<int64_t>(parameter.as_int()));
+        break;
+      case rclcpp::ParameterType::PARAMETER_DOUBLE:
+        encoder.put(parameter.as_double());
+        break;
+      case rclcpp::ParameterType::PARAMETER_STRING:
+        encoder.putString(parameter.as_string());
+        break;
+      case rclcpp::ParameterType::PARAMETER_BYTE_ARRAY:
+        encoder.putArray(parameter.as_byte_array());
+        break;
+      case rclcpp::ParameterType::PARAMETER_BOOL_ARRAY:
+        {
+          std::vector<uint8_t> values;
+          for (bool value : parameter.as_bool_array()) {
+            values.push_back(value);
+          }
+          encoder.putArray(values);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_INTEGER_ARRAY:
+        encoder.putArray(parameter.as_integer_array());
+        break;
+      case rclcpp::ParameterType::PARAMETER_DOUBLE_ARRAY:
+        encoder.putArray(parameter.as_double_array());
+        break;
+      case rclcpp::ParameterType::PARAMETER_STRING_ARRAY:
+        {
+          const auto & values = parameter.as_string_array();
+          encoder.put(static_cast<uint32_t>(values.size()));
+          for (const auto & value : values) {
+            encoder.putString(value);
+          }
+          break;
+        }
+      default:
+        break;
+    }
+  }
+  writer.addArray(name, encoder.data());
+}
+
+std::vector<rclcpp::Parameter> readParameters(
+  const Snapshot & snapshot, const std::string & name)
+{
+  std::size_t size = 0;
+  const void * data = snapshot.section(name, size);
+  if (!data) {
+    return {};
+  }
+  Decoder decoder(static_cast<const char *>(data), size);
+
+  uint32_t count = 0;
+  if (!decoder.get(count)) {
+    return {};
+  }
+  std::vector<rclcpp::Parameter> parameters;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string parameter_name;
+    uint8_t type = 0;
+    if (!decoder.getString(parameter_name) || !decoder.get(type)) {
+      return {};
+    }
+    bool ok = true;
+    switch (static_cast<rclcpp::ParameterType>(type)) {
+      case rclcpp::ParameterType::PARAMETER_BOOL:
+        {
+          uint8_t value = 0;
+          ok = decoder.get(value);
+          parameters.emplace_back(parameter_name, value != 0);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_INTEGER:
+        {
+          int64_t value = 0;
+          ok = decoder.get(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_DOUBLE:
+        {
+          double value = 0.0;
+          ok = decoder.get(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_STRING:
+        {
+          std::string value;
+          ok = decoder.getString(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_BYTE_ARRAY:
+        {
+          std::vector<uint8_t> value;
+          ok = decoder.getArray(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_BOOL_ARRAY:
+        {
+          std::vector<uint8_t> bytes;
+          ok = decoder.getArray(bytes);
+          parameters.emplace_back(parameter_name, std::vector<bool>(bytes.begin(), bytes.end()));
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_INTEGER_ARRAY:
+        {
+          std::vector<int64_t> value;
+          ok = decoder.getArray(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_DOUBLE_ARRAY:
+        {
+          std::vector<double> value;
+          ok = decoder.getArray(value);
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      case rclcpp::ParameterType::PARAMETER_STRING_ARRAY:
+        {
+          uint32_t length = 0;
+          ok = decoder.get(length);
+          std::vector<std::string> value(ok ? length : 0);
+          for (auto & element : value) {
+            ok = ok && decoder.getString(element);
+          }
+          parameters.emplace_back(parameter_name, value);
+          break;
+        }
+      default:
+        // Unset parameters carry no value
+        break;
+    }
+    if (!ok) {
+      return {};
+    }
+  }
+  return parameters;
+}
+
+constexpr std::chrono::seconds SnapshotRecorder::min_interval;
+
+bool SnapshotRecorder::checkCycle(double duration)
+{
+  if (!automatic() || duration <= budget_) {
+    return false;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (last_automatic_ != std::chrono::steady_clock::time_point() &&
+      now - last_automatic_ < min_interval)
+    {
+      return false;
+    }
+    last_automatic_ = now;
+  }
+
+  // Filled here while the inputs are those of the cycle, but written on a worker, along
+  // with the deferred sections, the cycle is late enough already
+  auto writer = std::make_shared<SnapshotWriter>(name_);
+  if (!fill_ || !fill_(*writer)) {
+    return false;
+  }
+  const std::string path = defaultPath();
+  RCLCPP_WARN(
+    logger_, "A cycle took %.1f ms, over the budget of %.1f ms, saving its inputs to %s",
+    duration * 1e3, budget_ * 1e3, path.c_str());
+  rclcpp::Logger logger = logger_;
+  TaskScheduler::instance().submit(
+    TaskPriority::PLANNING, [writer, path, logger]() {
+      if (!writer->write(path)) {
+        RCLCPP_WARN(logger, "Failed to write a snapshot to %s", path.c_str());
+      }
+    });
+  return true;
+}
+
+std::string SnapshotRecorder::save(const std::string & filename, uint64_t & size)
+{
+  size = 0;
+  SnapshotWriter writer(name_);
+  if (!fill_ || !fill_(writer)) {
+    return "";
+  }
+
+  const std::string path = filename.empty() ? defaultPath() : filename;
+  if (!writer.write(path)) {
+    RCLCPP_WARN(logger_, "Failed to write a snapshot to %s", path.c_str());
+    return "";
+  }
+  size = writer.size();
+  return path;
+}
+
+std::string SnapshotRecorder::defaultPath() const
+{
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  return directory_ + "/nav2_snapshot_" + name_ + "_" + std::to_string(ms) + ".snap";
+}
+
+}  // namespace nav2_util
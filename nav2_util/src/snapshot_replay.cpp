@@ -0,0 +1,102 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/snapshot_replay.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nav2_util/trace.hpp"
+
+namespace nav2_util
+{
+
+bool parseReplayOptions(const std::vector<std::string> & arguments, ReplayOptions & options)
+{
+  bool valid = true;
+  for (std::size_t i = 1; i < arguments.size() && valid; ++i) {
+    const std::string & argument = arguments[i];
+    const bool has_value = i + 1 < arguments.size();
+    if (argument == "--plugin" && has_value) {
+      options.plugin = arguments[++i];
+    } else if (argument == "--runs" && has_value) {
+      try {
+        options.runs = std::stoi(arguments[++i]);
+      } catch (const std::exception &) {
+        valid = false;
+      }
+    } else if (argument == "--trace" && has_value) {
+      options.trace = arguments[++i];
+    } else if (argument.compare(0, 2, "--") != 0 && options.snapshot.empty()) {
+      options.snapshot = argument;
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid || options.snapshot.empty() || options.runs < 1) {
+    std::fprintf(
+      stderr, "Usage: %s <snapshot> [--plugin <name>] [--runs <n>] [--trace <file>]\n",
+      arguments.empty() ? "replay" : arguments[0].c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<double> runReplay(
+  const ReplayOptions & options, const char * zone, const std::string & detail,
+  const std::function<void()> & cycle, const std::function<void()> & prepare)
+{
+  TraceBuffer & buffer = TraceBuffer::instance();
+  if (!options.trace.empty() && !buffer.enabled()) {
+    buffer.enable();
+  }
+
+  std::vector<double> durations;
+  durations.reserve(options.runs);
+  for (int i = 0; i < options.runs; ++i) {
+    if (prepare) {
+      prepare();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    {
+      ScopedTrace trace(zone, detail);
+      cycle();
+    }
+    durations.push_back(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  std::vector<double> sorted = durations;
+  std::sort(sorted.begin(), sorted.end());
+  std::printf(
+    "%s %s: %zu runs, min %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms\n",
+    zone, detail.c_str(), sorted.size(), sorted.front() * 1e3,
+    sorted[sorted.size() / 2] * 1e3, sorted[(sorted.size() - 1) * 95 / 100] * 1e3,
+    sorted.back() * 1e3);
+
+  if (!options.trace.empty()) {
+    if (buffer.writeChromeTrace(options.trace)) {
+      std::printf("Wrote the trace to %s\n", options.trace.c_str());
+    } else {
+      std::fprintf(stderr, "Failed to write the trace to %s\n", options.trace.c_str());
+    }
+  }
+  return durations;
+}
+
+}  // namespace nav2_util
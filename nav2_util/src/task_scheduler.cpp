@@ -0,0 +1,377 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/task_scheduler.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+// Scheduler and index of the worker running on this thread, if any
+thread_local const TaskScheduler * g_scheduler = nullptr;
+thread_local std::size_t g_worker = 0;
+
+bool g_started = false;
+
+unsigned int envUnsigned(const char * name, unsigned int default_value)
+{
+  const char * value = std::getenv(name);
+  if (!value || *value == '\0') {
+    return default_value;
+  }
+  const long parsed = std::atol(value);  // NOLINT
+  return parsed > 0 ? static_cast<unsigned int>(parsed) : 0u;
+}
+
+void pinCurrentThread(int cpu, std::size_t worker)
+{
+#ifdef __linux__
+  if (cpu >= 0 && cpu < CPU_SETSIZE) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+  const std::string name = "nav2_task_" + std::to_string(worker);
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+  (void)cpu;
+  (void)worker;
+#endif
+}
+
+// State of one parallelFor(), shared with helpers that may start after it returned
+struct LoopState
+{
+  const std::function<void(std::size_t)> * task;
+  std::size_t num_tasks;
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  std::size_t done{0};
+  std::exception_ptr error;
+
+  void run()
+  {
+    for (std::size_t i = next.fetch_add(1); i < num_tasks; i = next.fetch_add(1)) {
+      std::exception_ptr task_error;
+      try {
+        (*task)(i);
+      } catch (...) {
+        task_error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (task_error && !error) {
+        error = task_error;
+      }
+      if (++done == num_tasks) {
+        done_cv.notify_all();
+      }
+    }
+  }
+};
+
+}  // namespace
+
+TaskSchedulerOptions TaskSchedulerOptions::fromEnvironment()
+{
+  TaskSchedulerOptions options;
+  options.num_threads = envUnsigned("NAV2_TASK_THREADS", options.num_threads);
+  options.reserved_control_threads =
+    envUnsigned("NAV2_TASK_RESERVED_CONTROL_THREADS", options.reserved_control_threads);
+  if (const char * cpus = std::getenv("NAV2_TASK_CPUS")) {
+    options.cpu_affinity = parseCpuList(cpus);
+  }
+  if (const char * cpus = std::getenv("NAV2_TASK_CONTROL_CPUS")) {
+    options.control_cpu_affinity = parseCpuList(cpus);
+  }
+  return options;
+}
+
+std::vector<int> parseCpuList(const std::string & list)
+{
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string entry;
+  while (std::getline(stream, entry, ',')) {
+    const std::size_t dash = entry.find('-');
+    try {
+      if (dash == std::string::npos) {
+        cpus.push_back(std::stoi(entry));
+        continue;
+      }
+      const int first = std::stoi(entry.substr(0, dash));
+      const int last = std::stoi(entry.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+    }
+  }
+  cpus.erase(
+    std::remove_if(cpus.begin(), cpus.end(), [](int cpu) {return cpu < 0;}), cpus.end());
+  return cpus;
+}
+
+std::mutex & TaskScheduler::configMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::unique_ptr<TaskSchedulerOptions> & TaskScheduler::pendingOptions()
+{
+  static std::unique_ptr<TaskSchedulerOptions> options;
+  return options;
+}
+
+bool TaskScheduler::configure(const TaskSchedulerOptions & options)
+{
+  std::lock_guard<std::mutex> lock(configMutex());
+  if (g_started) {
+    return false;
+  }
+  pendingOptions() = std::make_unique<TaskSchedulerOptions>(options);
+  return true;
+}
+
+TaskScheduler & TaskScheduler::instance()
+{
+  static TaskScheduler scheduler([]() {
+      std::lock_guard<std::mutex> lock(configMutex());
+      g_started = true;
+      return pendingOptions() ? *pendingOptions() : TaskSchedulerOptions::fromEnvironment();
+    }());
+  return scheduler;
+}
+
+TaskScheduler::TaskScheduler(const TaskSchedulerOptions & options)
+: reserved_(0),
+  next_queue_(0),
+  pending_(0),
+  stop_(false)
+{
+  pending_by_priority_.fill(0);
+
+  unsigned int num_threads = options.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  }
+  // Keep a worker for the other classes whenever there is more than one
+  reserved_ = num_threads > 1 ?
+    std::min(options.reserved_control_threads, num_threads - 1) :
+    0;
+
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+
+  // Reserved control workers come first and take the control CPUs, if any
+  const std::vector<int> & control_cpus = options.control_cpu_affinity.empty() ?
+    options.cpu_affinity : options.control_cpu_affinity;
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    int cpu = -1;
+    if (i < reserved_ && !control_cpus.empty()) {
+      cpu = control_cpus[i % control_cpus.size()];
+    } else if (i >= reserved_ && !options.cpu_affinity.empty()) {
+      cpu = options.cpu_affinity[(i - reserved_) % options.cpu_affinity.size()];
+    }
+    workers_.emplace_back(&TaskScheduler::workerLoop, this, i, cpu);
+  }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto & worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned int TaskScheduler::numWorkers(TaskPriority priority) const
+{
+  const unsigned int workers = numWorkers();
+  return priority == TaskPriority::CONTROL ? workers : workers - reserved_;
+}
+
+bool TaskScheduler::onWorkerThread() const
+{
+  return g_scheduler == this;
+}
+
+std::future<void> TaskScheduler::submit(TaskPriority priority, std::function<void()> task)
+{
+  auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+  std::future<void> result = packaged->get_future();
+  if (numWorkers(priority) == 0) {
+    (*packaged)();
+    return result;
+  }
+  push(priority, [packaged]() {(*packaged)();});
+  return result;
+}
+
+void TaskScheduler::parallelFor(
+  TaskPriority priority, std::size_t num_tasks,
+  const std::function<void(std::size_t)> & task, unsigned int max_concurrency)
+{
+  if (num_tasks == 0) {
+    return;
+  }
+
+  std::size_t helpers = std::min<std::size_t>(num_tasks - 1, numWorkers(priority));
+  if (max_concurrency > 0) {
+    helpers = std::min<std::size_t>(helpers, max_concurrency - 1);
+  }
+
+  // Nothing to share, don't pay for the hand-off
+  if (helpers == 0) {
+    for (std::size_t i = 0; i < num_tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  auto state = std::make_shared<LoopState>();
+  state->task = &task;
+  state->num_tasks = num_tasks;
+  for (std::size_t i = 0; i < helpers; ++i) {
+    push(priority, [state]() {state->run();});
+  }
+
+  state->run();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done_cv.wait(lock, [&]() {return state->done == state->num_tasks;});
+    error = state->error;
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void TaskScheduler::push(TaskPriority priority, std::function<void()> task)
+{
+  const auto p = static_cast<std::size_t>(priority);
+
+  // Only control tasks may land on a reserved worker's deque
+  const std::size_t first = p == 0 ? 0 : reserved_;
+  std::size_t queue;
+  if (onWorkerThread() && g_worker >= first) {
+    queue = g_worker;
+  } else {
+    queue = first + next_queue_.fetch_add(1, std::memory_order_relaxed) %
+      (queues_.size() - first);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+    queues_[queue]->tasks[p].push_back(std::move(task));
+  }
+
+  // Counted once queued, so a worker that claims a count always finds a task
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_;
+    ++pending_by_priority_[p];
+  }
+  if (p == 0) {
+    work_cv_.notify_all();
+  } else {
+    work_cv_.notify_one();
+  }
+}
+
+bool TaskScheduler::pop(std::size_t worker, std::function<void()> & task)
+{
+  const bool reserved = worker < reserved_;
+  std::size_t p = 0;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_cv_.wait(
+      lock, [&]() {
+        return stop_ || (reserved ? pending_by_priority_[0] > 0 : pending_ > 0);
+      });
+    if (reserved ? pending_by_priority_[0] == 0 : pending_ == 0) {
+      return false;
+    }
+    // Claim the most urgent class that has work
+    while (pending_by_priority_[p] == 0) {
+      ++p;
+    }
+    --pending_;
+    --pending_by_priority_[p];
+  }
+
+  // The claimed task may sit on any deque, own newest first, then steal oldest first
+  while (true) {
+    {
+      WorkerQueue & own = *queues_[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks[p].empty()) {
+        task = std::move(own.tasks[p].back());
+        own.tasks[p].pop_back();
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      WorkerQueue & victim = *queues_[(worker + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks[p].empty()) {
+        task = std::move(victim.tasks[p].front());
+        victim.tasks[p].pop_front();
+        return true;
+      }
+    }
+    std::this_thread::yield();
+  }
+}
+
+void TaskScheduler::workerLoop(std::size_t worker, int cpu)
+{
+  g_scheduler = this;
+  g_worker = worker;
+  pinCurrentThread(cpu, worker);
+
+  std::function<void()> task;
+  while (pop(worker, task)) {
+    task();
+    task = nullptr;
+  }
+}
+
+}  // namespace nav2_util
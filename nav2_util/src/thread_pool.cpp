@@ -0,0 +1,161 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace nav2_util
+{
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+: scheduler_(nullptr),
+  priority_(TaskPriority::PLANNING),
+  max_concurrency_(0),
+  stop_(false),
+  generation_(0),
+  active_workers_(0),
+  task_(nullptr),
+  num_tasks_(0),
+  next_task_(0)
+{
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::ThreadPool(TaskPriority priority, unsigned int max_concurrency)
+: scheduler_(&TaskScheduler::instance()),
+  priority_(priority),
+  max_concurrency_(max_concurrency),
+  stop_(false),
+  generation_(0),
+  active_workers_(0),
+  task_(nullptr),
+  num_tasks_(0),
+  next_task_(0)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto & worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned int ThreadPool::size() const
+{
+  if (scheduler_) {
+    const unsigned int shared = scheduler_->numWorkers(priority_) + 1;
+    return max_concurrency_ > 0 ? std::min(max_concurrency_, shared) : shared;
+  }
+  return static_cast<unsigned int>(workers_.size()) + 1;
+}
+
+void ThreadPool::parallelFor(
+  std::size_t num_tasks, const std::function<void(std::size_t)> & task)
+{
+  if (scheduler_) {
+    scheduler_->parallelFor(priority_, num_tasks, task, max_concurrency_);
+    return;
+  }
+
+  if (num_tasks == 0) {
+    return;
+  }
+
+  // Nothing to share, don't pay for the hand-off
+  if (workers_.empty() || num_tasks == 1) {
+    for (std::size_t i = 0; i < num_tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> call_lock(call_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_.store(0);
+    error_ = nullptr;
+    active_workers_ = workers_.size();
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  runTasks();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() {return active_workers_ == 0;});
+    task_ = nullptr;
+    error = error_;
+    error_ = nullptr;
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadPool::workerLoop()
+{
+  std::size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [&]() {return stop_ || generation_ != seen_generation;});
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    runTasks();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --active_workers_;
+    }
+    done_cv_.notify_one();
+  }
+}
+
+void ThreadPool::runTasks()
+{
+  for (std::size_t i = next_task_.fetch_add(1); i < num_tasks_; i = next_task_.fetch_add(1)) {
+    try {
+      (*task_)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/timing_diagnostics.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+diagnostic_msgs::msg::KeyValue keyValue(const std::string & key, const std::string & value)
+{
+  diagnostic_msgs::msg::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = value;
+  return key_value;
+}
+
+std::string milliseconds(double value)
+{
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.3f", value);
+  return text;
+}
+
+}  // namespace
+
+void TimingDiagnostics::publish()
+{
+  auto message = toMessage(name_, stats_->summarizeAndRotate());
+  if (message.status.empty()) {
+    return;
+  }
+  message.header.stamp = clock_->now();
+  publisher_->publish(message);
+}
+
+diagnostic_msgs::msg::DiagnosticArray TimingDiagnostics::toMessage(
+  const std::string & name, const std::vector<TimingStats::NamedSummary> & summaries)
+{
+  diagnostic_msgs::msg::DiagnosticArray message;
+  for (const auto & named : summaries) {
+    const TimingHistogram::Summary & summary = named.second;
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = name + ": " + named.first;
+    status.hardware_id = name;
+    status.message = "p50 " + milliseconds(summary.p50_ms) + " ms, p99 " +
+      milliseconds(summary.p99_ms) + " ms, max " + milliseconds(summary.max_ms) + " ms";
+    status.values.push_back(keyValue("count", std::to_string(summary.count)));
+    status.values.push_back(keyValue("mean_ms", milliseconds(summary.mean_ms)));
+    status.values.push_back(keyValue("p50_ms", milliseconds(summary.p50_ms)));
+    status.values.push_back(keyValue("p99_ms", milliseconds(summary.p99_ms)));
+    status.values.push_back(keyValue("max_ms", milliseconds(summary.max_ms)));
+    message.status.push_back(status);
+  }
+  return message;
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,153 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/timing_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+TimingHistogram::TimingHistogram()
+: current_(0)
+{
+  for (Window & window : windows_) {
+    clear(window);
+  }
+}
+
+void TimingHistogram::record(int64_t duration_ns)
+{
+  const uint64_t duration = duration_ns > 0 ? static_cast<uint64_t>(duration_ns) : 0;
+  Window & window = windows_[current_.load(std::memory_order_acquire)];
+  window.counts[bucket(duration)].fetch_add(1, std::memory_order_relaxed);
+  window.total_ns.fetch_add(duration, std::memory_order_relaxed);
+
+  uint64_t max = window.max_ns.load(std::memory_order_relaxed);
+  while (duration > max &&
+    !window.max_ns.compare_exchange_weak(max, duration, std::memory_order_relaxed))
+  {
+  }
+}
+
+TimingHistogram::Summary TimingHistogram::summarize() const
+{
+  uint64_t counts[kBuckets] = {};
+  uint64_t count = 0, total_ns = 0, max_ns = 0;
+  for (const Window & window : windows_) {
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+      const uint64_t n = window.counts[b].load(std::memory_order_relaxed);
+      counts[b] += n;
+      count += n;
+    }
+    total_ns += window.total_ns.load(std::memory_order_relaxed);
+    max_ns = std::max(max_ns, window.max_ns.load(std::memory_order_relaxed));
+  }
+
+  Summary summary;
+  summary.count = count;
+  if (count == 0) {
+    return summary;
+  }
+
+  auto percentile = [&](double q) {
+      const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+      uint64_t seen = 0;
+      for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += counts[b];
+        if (seen >= rank) {
+          return std::min(bucketUpperBound(b), max_ns);
+        }
+      }
+      return max_ns;
+    };
+
+  summary.mean_ms = static_cast<double>(total_ns) / static_cast<double>(count) / 1e6;
+  summary.p50_ms = percentile(0.5) / 1e6;
+  summary.p99_ms = percentile(0.99) / 1e6;
+  summary.max_ms = max_ns / 1e6;
+  return summary;
+}
+
+void TimingHistogram::rotate()
+{
+  // The slot is cleared before recorders are pointed at it, a recorder still
+  // holding the previous index only adds to the window being left
+  const std::size_t next = (current_.load(std::memory_order_relaxed) + 1) % kWindows;
+  clear(windows_[next]);
+  current_.store(next, std::memory_order_release);
+}
+
+std::size_t TimingHistogram::bucket(uint64_t duration_ns)
+{
+  if (duration_ns < kSubBuckets) {
+    return static_cast<std::size_t>(duration_ns);
+  }
+
+  // The power of two, then the two bits below the leading one
+  const int exponent = 63 - __builtin_clzll(duration_ns);
+  const std::size_t index = (exponent - 1) * kSubBuckets + ((duration_ns >> (exponent - 2)) & 3);
+  return std::min(index, kBuckets - 1);
+}
+
+uint64_t TimingHistogram::bucketUpperBound(std::size_t bucket)
+{
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+
+  const int exponent = static_cast<int>(bucket / kSubBuckets) + 1;
+  const uint64_t step = uint64_t{1} << (exponent - 2);
+  return (kSubBuckets + bucket % kSubBuckets) * step + step - 1;
+}
+
+void TimingHistogram::clear(Window & window)
+{
+  for (auto & count : window.counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  window.total_ns.store(0, std::memory_order_relaxed);
+  window.max_ns.store(0, std::memory_order_relaxed);
+}
+
+TimingHistogram & TimingStats::histogram(const std::string & name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & histogram = histograms_[name];
+  if (!histogram) {
+    histogram = std::make_unique<TimingHistogram>();
+  }
+  return *histogram;
+}
+
+std::vector<TimingStats::NamedSummary> TimingStats::summarizeAndRotate()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<NamedSummary> summaries;
+  for (auto & histogram : histograms_) {
+    const TimingHistogram::Summary summary = histogram.second->summarize();
+    if (summary.count > 0) {
+      summaries.emplace_back(histogram.first, summary);
+    }
+    histogram.second->rotate();
+  }
+  return summaries;
+}
+
+}  // namespace nav2_util
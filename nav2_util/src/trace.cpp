@@ -0,0 +1,357 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/trace.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+uint32_t threadId()
+{
+  static std::atomic<uint32_t> next_id{1};
+  thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+thread_local int64_t g_current_input_stamp_ns = 0;
+
+void setDetail(TraceEvent & event, const char * detail)
+{
+  std::strncpy(event.detail, detail ? detail : "", TraceEvent::kDetailSize - 1);
+  event.detail[TraceEvent::kDetailSize - 1] = '\0';
+}
+
+// Names and details are identifiers, only quotes and backslashes need escaping
+std::string escape(const char * text)
+{
+  std::string escaped;
+  for (const char * c = text; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      escaped.push_back('\\');
+    }
+    if (static_cast<unsigned char>(*c) >= 0x20) {
+      escaped.push_back(*c);
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+/**
+ * @brief Ring of the events recorded by one thread, which alone writes into it
+ *
+ * A slot holds the index + 1 of its event once written, 0 while being written, so
+ * a reader copying it concurrently can tell it was overwritten meanwhile.
+ */
+struct TraceBuffer::Ring
+{
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence{0};
+    TraceEvent event;
+  };
+
+  Ring(std::size_t capacity, uint64_t generation)
+  : slots(new Slot[capacity]), capacity(capacity), generation(generation) {}
+
+  std::unique_ptr<Slot[]> slots;
+  const std::size_t capacity;
+  const uint64_t generation;
+  std::atomic<uint64_t> next{0};  ///< Events recorded so far
+  uint64_t read{0};  ///< Events taken out by drain(), with the buffer's mutex held
+  std::atomic<bool> orphaned{false};  ///< Whether its thread is gone
+};
+
+TraceBuffer & TraceBuffer::instance()
+{
+  static TraceBuffer buffer;
+  return buffer;
+}
+
+TraceBuffer::TraceBuffer()
+: enabled_(false),
+  capacity_(0),
+  generation_(0)
+{
+  const char * capacity = std::getenv("NAV2_TRACE_EVENTS");
+  if (capacity && std::atoll(capacity) > 0) {
+    enable(static_cast<std::size_t>(std::atoll(capacity)));
+  }
+
+  const char * file = std::getenv("NAV2_TRACE_FILE");
+  if (file) {
+    file_ = file;
+  }
+}
+
+TraceBuffer::~TraceBuffer()
+{
+  if (!file_.empty() && enabled()) {
+    writeChromeTrace(file_);
+  }
+}
+
+void TraceBuffer::enable(std::size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The threads replace their rings on their next event, the old ones are left to them
+  capacity_.store(std::max<std::size_t>(capacity, 1), std::memory_order_relaxed);
+  generation_.fetch_add(1, std::memory_order_release);
+  rings_.clear();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceBuffer::disable()
+{
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+TraceBuffer::Ring * TraceBuffer::threadRing()
+{
+  struct ThreadRing
+  {
+    std::shared_ptr<Ring> ring;
+
+    ~ThreadRing()
+    {
+      if (ring) {
+        ring->orphaned.store(true, std::memory_order_relaxed);
+      }
+    }
+  };
+  thread_local ThreadRing current;
+
+  if (current.ring &&
+    current.ring->generation == generation_.load(std::memory_order_acquire))
+  {
+    return current.ring.get();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::size_t capacity = capacity_.load(std::memory_order_relaxed);
+  if (capacity == 0) {
+    return nullptr;
+  }
+  // Forget the rings of the threads that are gone once they were read
+  rings_.erase(
+    std::remove_if(
+      rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring> & ring) {
+        return ring->orphaned.load(std::memory_order_relaxed) &&
+        ring->read == ring->next.load(std::memory_order_relaxed);
+      }), rings_.end());
+  current.ring = std::make_shared<Ring>(
+    capacity, generation_.load(std::memory_order_relaxed));
+  rings_.push_back(current.ring);
+  return current.ring.get();
+}
+
+void TraceBuffer::record(const TraceEvent & event)
+{
+  Ring * ring = threadRing();
+  if (!ring) {
+    return;
+  }
+
+  const uint64_t index = ring->next.load(std::memory_order_relaxed);
+  Ring::Slot & slot = ring->slots[index % ring->capacity];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = event;
+  slot.sequence.store(index + 1, std::memory_order_release);
+  ring->next.store(index + 1, std::memory_order_release);
+}
+
+void TraceBuffer::recordSummed(
+  const char * name, const std::string & detail, int64_t start_ns, int64_t total_ns,
+  uint32_t calls, int64_t input_stamp_ns)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  TraceEvent event;
+  event.name = name;
+  setDetail(event, detail.c_str());
+  event.start_ns = start_ns;
+  event.end_ns = start_ns + total_ns;
+  event.input_stamps_ns[0] = input_stamp_ns ? input_stamp_ns : ScopedTrace::currentInputStamp();
+  event.input_stamps_ns[1] = 0;
+  event.calls = calls;
+  event.thread = threadId();
+  record(event);
+}
+
+std::vector<TraceEvent> TraceBuffer::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return copyEvents(false);
+}
+
+std::vector<TraceEvent> TraceBuffer::drain()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return copyEvents(true);
+}
+
+std::vector<TraceEvent> TraceBuffer::copyEvents(bool consume) const
+{
+  std::vector<TraceEvent> events;
+  const auto ended_first = [](const TraceEvent & a, const TraceEvent & b) {
+      return a.end_ns < b.end_ns;
+    };
+
+  for (const auto & ring : rings_) {
+    const std::size_t merged = events.size();
+    const uint64_t next = ring->next.load(std::memory_order_acquire);
+    const uint64_t first = std::max(ring->read, next > ring->capacity ? next - ring->capacity : 0);
+    for (uint64_t i = first; i < next; ++i) {
+      const Ring::Slot & slot = ring->slots[i % ring->capacity];
+      if (slot.sequence.load(std::memory_order_acquire) != i + 1) {
+        continue;
+      }
+      TraceEvent event = slot.event;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Overwritten while being copied
+      if (slot.sequence.load(std::memory_order_relaxed) != i + 1) {
+        continue;
+      }
+      events.push_back(event);
+    }
+    if (consume) {
+      ring->read = next;
+    }
+    // Each ring is in the order its events ended, merging keeps it
+    std::inplace_merge(
+      events.begin(), events.begin() + merged, events.end(), ended_first);
+  }
+  return events;
+}
+
+uint64_t TraceBuffer::overwritten() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t count = 0;
+  for (const auto & ring : rings_) {
+    const uint64_t unread = ring->next.load(std::memory_order_acquire) - ring->read;
+    count += unread > ring->capacity ? unread - ring->capacity : 0;
+  }
+  return count;
+}
+
+bool TraceBuffer::writeChromeTrace(const std::string & path) const
+{
+  return writeChromeTrace(path, snapshot());
+}
+
+bool TraceBuffer::writeChromeTrace(
+  const std::string & path, const std::vector<TraceEvent> & events)
+{
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+
+  const int pid = static_cast<int>(getpid());
+  // Microseconds since the epoch, down to the nanosecond
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (std::size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent & event = events[i];
+    file << (i ? ",\n" : "\n") <<
+      "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"nav2\",\"ph\":\"X\"" <<
+      ",\"ts\":" << event.start_ns / 1000.0 <<
+      ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0 <<
+      ",\"pid\":" << pid << ",\"tid\":" << event.thread <<
+      ",\"args\":{\"detail\":\"" << escape(event.detail) << "\",\"calls\":" << event.calls;
+    for (std::size_t k = 0; k < TraceEvent::kMaxInputs; ++k) {
+      if (event.input_stamps_ns[k] != 0) {
+        file << ",\"input_" << k << "_latency_ms\":" <<
+          (event.start_ns - event.input_stamps_ns[k]) / 1e6;
+      }
+    }
+    file << "}}";
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+int64_t TraceBuffer::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ScopedTrace::ScopedTrace(
+  const char * name, const char * detail,
+  int64_t input_stamp_ns, int64_t second_input_stamp_ns)
+: active_(TraceBuffer::instance().enabled()),
+  parent_stamp_ns_(g_current_input_stamp_ns)
+{
+  if (!active_) {
+    return;
+  }
+
+  event_.name = name;
+  setDetail(event_, detail);
+  event_.input_stamps_ns[0] = input_stamp_ns ? input_stamp_ns : parent_stamp_ns_;
+  event_.input_stamps_ns[1] = second_input_stamp_ns;
+  event_.calls = 1;
+  event_.thread = threadId();
+  g_current_input_stamp_ns = event_.input_stamps_ns[0];
+  event_.start_ns = TraceBuffer::now();
+}
+
+ScopedTrace::~ScopedTrace()
+{
+  if (!active_) {
+    return;
+  }
+
+  event_.end_ns = TraceBuffer::now();
+  g_current_input_stamp_ns = parent_stamp_ns_;
+  TraceBuffer::instance().record(event_);
+}
+
+int64_t ScopedTrace::currentInputStamp()
+{
+  return g_current_input_stamp_ns;
+}
+
+TraceInputScope::TraceInputScope(int64_t input_stamp_ns)
+: parent_stamp_ns_(g_current_input_stamp_ns)
+{
+  g_current_input_stamp_ns = input_stamp_ns;
+}
+
+TraceInputScope::~TraceInputScope()
+{
+  g_current_input_stamp_ns = parent_stamp_ns_;
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/trace_service.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nav2_util/trace.hpp"
+
+namespace nav2_util
+{
+
+void TraceService::save(
+  const nav2_msgs::srv::SaveTrace::Request & request,
+  nav2_msgs::srv::SaveTrace::Response & response)
+{
+  TraceBuffer & buffer = TraceBuffer::instance();
+  response.events = 0;
+
+  if (!buffer.enabled()) {
+    if (request.enable_events == 0) {
+      response.success = false;
+      response.message = "Tracing is off, set enable_events to start it";
+      return;
+    }
+    buffer.enable(request.enable_events);
+    RCLCPP_INFO(
+      logger_, "Tracing started, keeping %u events per thread", request.enable_events);
+    response.success = true;
+    response.message = "Tracing started";
+    return;
+  }
+
+  std::vector<TraceEvent> events = buffer.snapshot();
+  if (request.duration > 0.0) {
+    // Events are in the order they ended
+    const int64_t since_ns = TraceBuffer::now() - static_cast<int64_t>(request.duration * 1e9);
+    events.erase(
+      events.begin(),
+      std::partition_point(
+        events.begin(), events.end(),
+        [since_ns](const TraceEvent & event) {return event.end_ns < since_ns;}));
+  }
+
+  std::string filename = request.filename;
+  if (filename.empty()) {
+    filename = "nav2_trace_" + name_ + "_" + std::to_string(TraceBuffer::now() / 1000000) +
+      ".json";
+  }
+
+  if (!TraceBuffer::writeChromeTrace(filename, events)) {
+    RCLCPP_WARN(logger_, "Failed to write the trace to %s", filename.c_str());
+    response.success = false;
+    response.message = "Failed to write " + filename;
+    return;
+  }
+
+  const uint64_t overwritten = buffer.overwritten();
+  RCLCPP_INFO(
+    logger_, "Saved %zu trace events to %s, %lu older ones were overwritten",
+    events.size(), filename.c_str(), static_cast<unsigned long>(overwritten));  // NOLINT
+  response.success = true;
+  response.filename = filename;
+  response.events = static_cast<uint32_t>(events.size());
+  response.message = "Saved " + std::to_string(events.size()) + " events, " +
+    std::to_string(overwritten) + " older ones were overwritten";
+}
+
+}  // namespace nav2_util
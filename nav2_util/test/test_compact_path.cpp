@@ -0,0 +1,101 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cmath>
+#include <memory>
+
+#include "nav2_util/compact_path.hpp"
+#include "nav2_util/geometry_utils.hpp"
+#include "gtest/gtest.h"
+
+TEST(CompactPath, round_trip)
+{
+  nav_msgs::msg::Path path;
+  path.header.frame_id = "map";
+  path.header.stamp.sec = 12;
+  for (int i = 0; i < 5; i++) {
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header = path.header;
+    pose.pose.position.x = 100.0 + 0.05 * i;
+    pose.pose.position.y = -3.0 * i;
+    pose.pose.orientation = nav2_util::geometry_utils::orientationAroundZAxis(-3.0 + 1.4 * i);
+    path.poses.push_back(pose);
+  }
+
+  nav2_msgs::msg::CompactPath compact = nav2_util::toCompactPath(path);
+  EXPECT_EQ(compact.header.frame_id, "map");
+  EXPECT_EQ(nav2_util::compactPathSize(compact), 5u);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_NEAR(compact.yaw[i], -3.0 + 1.4 * i, 1e-5);
+  }
+
+  nav_msgs::msg::Path unpacked = nav2_util::fromCompactPath(compact);
+  ASSERT_EQ(unpacked.poses.size(), 5u);
+  for (int i = 0; i < 5; i++) {
+    const auto & pose = unpacked.poses[i];
+    EXPECT_EQ(pose.header.frame_id, "map");
+    EXPECT_EQ(pose.header.stamp.sec, 12);
+    EXPECT_NEAR(pose.pose.position.x, path.poses[i].pose.position.x, 1e-4);
+    EXPECT_NEAR(pose.pose.position.y, path.poses[i].pose.position.y, 1e-4);
+    EXPECT_NEAR(pose.pose.orientation.z, path.poses[i].pose.orientation.z, 1e-5);
+    EXPECT_NEAR(pose.pose.orientation.w, path.poses[i].pose.orientation.w, 1e-5);
+  }
+}
+
+TEST(CompactPath, uneven_arrays)
+{
+  nav2_msgs::msg::CompactPath compact;
+  compact.x = {1.0f, 2.0f, 3.0f};
+  compact.y = {1.0f, 2.0f};
+  compact.yaw = {0.0f, 0.0f, 0.0f};
+  EXPECT_EQ(nav2_util::compactPathSize(compact), 2u);
+  EXPECT_EQ(nav2_util::fromCompactPath(compact).poses.size(), 2u);
+}
+
+TEST(CompactPath, view)
+{
+  auto path = std::make_shared<nav2_msgs::msg::CompactPath>();
+  path->header.frame_id = "map";
+  path->x = {0.0f, 1.0f, 2.0f, 3.0f};
+  path->y = {0.0f, 0.0f, 0.0f, 0.0f};
+  path->yaw = {0.0f, 0.1f, 0.2f, 0.3f};
+
+  nav2_util::CompactPathView view(path);
+  EXPECT_EQ(view.size(), 4u);
+  EXPECT_EQ(view, nav2_util::CompactPathView(path, 0, 10));
+
+  nav2_util::CompactPathView sliced = view.slice(1, 3).withEndYaw(1.5f);
+  EXPECT_EQ(sliced.path(), path);
+  EXPECT_EQ(sliced.first(), 1u);
+  ASSERT_EQ(sliced.size(), 2u);
+  EXPECT_EQ(sliced.x(0), 1.0f);
+  EXPECT_EQ(sliced.yaw(0), 0.1f);
+  EXPECT_EQ(sliced.yaw(1), 1.5f);
+  EXPECT_EQ(path->yaw[2], 0.2f);
+  EXPECT_NE(sliced, view.slice(1, 3));
+
+  // the end yaw stays with the last pose
+  EXPECT_EQ(sliced.slice(1, 2).yaw(0), 1.5f);
+  EXPECT_EQ(sliced.slice(0, 1).yaw(0), 0.1f);
+
+  nav2_msgs::msg::CompactPath copy = sliced.toCompactPath();
+  EXPECT_EQ(copy.header.frame_id, "map");
+  ASSERT_EQ(copy.x.size(), 2u);
+  EXPECT_EQ(copy.x[1], 2.0f);
+  EXPECT_EQ(copy.yaw[1], 1.5f);
+
+  EXPECT_TRUE(nav2_util::CompactPathView().empty());
+  EXPECT_TRUE(nav2_util::CompactPathView().toCompactPath().x.empty());
+}
@@ -31,3 +31,23 @@ TEST(ExecutionTimer, BasicDelay)
   ASSERT_GE(t.elapsed_time(), 10ns);
   ASSERT_GE(t.elapsed_time_in_seconds(), 1e-8);
 }
+
+TEST(ExecutionTimer, RecordsZonesWhileTracing)
+{
+  ExecutionTimer untraced("test.zone");
+  untraced.start();
+  untraced.end();
+
+  nav2_util::TraceBuffer::instance().enable(4);
+  ExecutionTimer t("test.zone", "detail");
+  t.start();
+  sleep_for(1ms);
+  t.end();
+
+  const auto events = nav2_util::TraceBuffer::instance().snapshot();
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_STREQ(events[0].name, "test.zone");
+  EXPECT_STREQ(events[0].detail, "detail");
+  EXPECT_EQ(events[0].end_ns - events[0].start_ns, t.elapsed_time().count());
+  nav2_util::TraceBuffer::instance().disable();
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/line_iterator.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::LineIterator;
+
+namespace
+{
+
+const int kStride = 64;
+
+std::vector<std::pair<int, int>> lineCells(LineIterator line)
+{
+  std::vector<std::pair<int, int>> cells;
+  for (; line.isValid(); line.advance()) {
+    cells.emplace_back(line.getX(), line.getY());
+  }
+  return cells;
+}
+
+std::vector<unsigned int> lineOffsets(int x0, int y0, int x1, int y1)
+{
+  std::vector<unsigned int> offsets;
+  for (auto cell : lineCells(LineIterator(x0, y0, x1, y1))) {
+    offsets.push_back(cell.second * kStride + cell.first);
+  }
+  return offsets;
+}
+
+}  // namespace
+
+TEST(LineIterator, ClipKeepsTheCellsInsideTheWindow)
+{
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> coord(-20, 80);
+  for (int t = 0; t < 5000; ++t) {
+    const int x0 = coord(rng), y0 = coord(rng), x1 = coord(rng), y1 = coord(rng);
+    int min_x = coord(rng), max_x = coord(rng), min_y = coord(rng), max_y = coord(rng);
+    if (min_x > max_x) {
+      std::swap(min_x, max_x);
+    }
+    if (min_y > max_y) {
+      std::swap(min_y, max_y);
+    }
+
+    std::vector<std::pair<int, int>> expected;
+    for (auto cell : lineCells(LineIterator(x0, y0, x1, y1))) {
+      if (cell.first >= min_x && cell.first <= max_x &&
+        cell.second >= min_y && cell.second <= max_y)
+      {
+        expected.push_back(cell);
+      }
+    }
+
+    LineIterator clipped(x0, y0, x1, y1);
+    // clipping part way through only considers the cells left
+    if (t % 2 && clipped.isValid()) {
+      clipped.advance();
+      if (!expected.empty() && expected.front() == std::make_pair(x0, y0)) {
+        expected.erase(expected.begin());
+      }
+    }
+    EXPECT_EQ(clipped.clip(min_x, min_y, max_x, max_y), !expected.empty());
+    ASSERT_EQ(lineCells(clipped), expected);
+  }
+}
+
+TEST(LineIterator, MaxCostStopsEarly)
+{
+  int visited = 0;
+  auto cost = [&visited](int x, int) {
+      ++visited;
+      return x == 5 ? 254 : x;
+    };
+  EXPECT_EQ(nav2_util::maxCostAlongLine(LineIterator(0, 0, 9, 2), cost, 254), 254);
+  EXPECT_EQ(visited, 6);
+
+  visited = 0;
+  EXPECT_EQ(nav2_util::maxCostAlongLine(LineIterator(0, 0, 4, 2), cost, 254), 4);
+  EXPECT_EQ(visited, 5);
+}
+
+TEST(LineSteps, WalkTheLineIteratorCells)
+{
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> coord(0, kStride - 1);
+  std::vector<std::pair<int, int>> ends;
+  std::vector<unsigned int> expected;
+  const int x0 = 31, y0 = 17;
+  for (int t = 0; t < 1000; ++t) {
+    const int x1 = coord(rng), y1 = coord(rng);
+    ends.emplace_back(x1, y1);
+    const std::vector<unsigned int> offsets = lineOffsets(x0, y0, x1, y1);
+    expected.insert(expected.end(), offsets.begin(), offsets.end());
+
+    std::vector<unsigned int> walked;
+    nav2_util::walkLine(
+      nav2_util::lineSteps(kStride, x0, y0, x1, y1),
+      [&walked](unsigned int offset) {walked.push_back(offset);});
+    ASSERT_EQ(walked, offsets);
+  }
+
+  // the batch walks the same cells, with the lines interleaved
+  std::vector<unsigned int> batch;
+  nav2_util::walkLines(
+    ends.size(),
+    [&](std::size_t i) {
+      return nav2_util::lineSteps(kStride, x0, y0, ends[i].first, ends[i].second);
+    },
+    [&batch](unsigned int offset) {batch.push_back(offset);});
+  std::sort(expected.begin(), expected.end());
+  std::sort(batch.begin(), batch.end());
+  EXPECT_EQ(batch, expected);
+
+  // cut lines stop after max_steps steps along the dominant axis
+  std::vector<unsigned int> cut;
+  nav2_util::walkLine(
+    nav2_util::lineSteps(kStride, 0, 0, 10, 3, 4),
+    [&cut](unsigned int offset) {cut.push_back(offset);});
+  const std::vector<unsigned int> full = lineOffsets(0, 0, 10, 3);
+  EXPECT_EQ(cut, std::vector<unsigned int>(full.begin(), full.begin() + 5));
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+
+#include "nav2_util/monitoring_bridge.hpp"
+#include "gtest/gtest.h"
+
+TEST(MonitoringBridge, ChangedRegion)
+{
+  // 4x3 grid
+  std::vector<int8_t> before(12, 0);
+  std::vector<int8_t> after(before);
+  map_msgs::msg::OccupancyGridUpdate update;
+
+  ASSERT_TRUE(nav2_util::changedRegion(before, after, 4, update));
+  EXPECT_TRUE(update.data.empty());
+
+  after[1 * 4 + 1] = 100;
+  after[2 * 4 + 2] = 50;
+  ASSERT_TRUE(nav2_util::changedRegion(before, after, 4, update));
+  EXPECT_EQ(update.x, 1u);
+  EXPECT_EQ(update.y, 1u);
+  EXPECT_EQ(update.width, 2u);
+  EXPECT_EQ(update.height, 2u);
+  EXPECT_EQ(update.data, (std::vector<int8_t>{100, 0, 0, 50}));
+
+  EXPECT_FALSE(nav2_util::changedRegion(before, std::vector<int8_t>(8, 0), 4, update));
+}
+
+TEST(MonitoringBridge, SimplifyPath)
+{
+  nav_msgs::msg::Path path;
+  path.header.frame_id = "map";
+  // A straight line to (10, 0), then a corner and a straight line to (10, 5)
+  for (int i = 0; i <= 10; i++) {
+    path.poses.emplace_back();
+    path.poses.back().pose.position.x = i;
+    path.poses.back().pose.position.y = i % 2 ? 0.01 : 0.0;
+  }
+  for (int i = 1; i <= 5; i++) {
+    path.poses.emplace_back();
+    path.poses.back().pose.position.x = 10.0;
+    path.poses.back().pose.position.y = i;
+  }
+
+  const auto simplified = nav2_util::simplifyPath(path, 0.05);
+  EXPECT_EQ(simplified.header.frame_id, "map");
+  ASSERT_EQ(simplified.poses.size(), 3u);
+  EXPECT_DOUBLE_EQ(simplified.poses[0].pose.position.x, 0.0);
+  EXPECT_DOUBLE_EQ(simplified.poses[1].pose.position.x, 10.0);
+  EXPECT_DOUBLE_EQ(simplified.poses[1].pose.position.y, 0.0);
+  EXPECT_DOUBLE_EQ(simplified.poses[2].pose.position.y, 5.0);
+
+  // Below the wiggles of the first line, only the poses inside the second one are dropped
+  EXPECT_EQ(nav2_util::simplifyPath(path, 0.001).poses.size(), 12u);
+}
+
+TEST(MonitoringBridge, DownsampleParticles)
+{
+  nav2_msgs::msg::CompactParticleCloud cloud;
+  for (int i = 0; i < 100; i++) {
+    cloud.x.push_back(i);
+    cloud.y.push_back(0.0f);
+    cloud.yaw.push_back(0.0f);
+    // All of the weight is on the last 10 particles
+    cloud.weight.push_back(i >= 90 ? 0.1f : 0.0f);
+  }
+
+  EXPECT_EQ(nav2_util::downsampleParticles(cloud, 200).x.size(), 100u);
+
+  const auto downsampled = nav2_util::downsampleParticles(cloud, 10);
+  ASSERT_EQ(downsampled.x.size(), 10u);
+  ASSERT_EQ(downsampled.weight.size(), 10u);
+  for (std::size_t k = 0; k < 10; k++) {
+    EXPECT_GE(downsampled.x[k], 90.0f);
+    EXPECT_FLOAT_EQ(downsampled.weight[k], 0.1f);
+  }
+}
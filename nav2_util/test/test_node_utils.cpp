@@ -93,3 +93,29 @@ TEST(GetPluginTypeParam, GetPluginTypeParam)
   ASSERT_EQ(get_plugin_type_param(node, "Foo"), "bar");
   ASSERT_EXIT(get_plugin_type_param(node, "Waldo"), ::testing::ExitedWithCode(255), ".*");
 }
+
+TEST(ParameterBindings, ParameterBindings)
+{
+  auto node = std::make_shared<rclcpp::Node>("test_bindings_node");
+  node->declare_parameter("foo.gain", 2.0);
+
+  nav2_util::ParameterBindings bindings(node);
+  double gain = 0.0;
+  int count = 0;
+  int updates = 0;
+  bindings.bind("foo.gain", rclcpp::ParameterValue(1.0), gain);
+  bindings.bind("foo.count", rclcpp::ParameterValue(3), count);
+  bindings.on_update([&updates]() {updates++;});
+  ASSERT_EQ(gain, 2.0);
+  ASSERT_EQ(count, 3);
+  ASSERT_TRUE(node->has_parameter("foo.count"));
+
+  node->set_parameter(rclcpp::Parameter("foo.gain", 4.0));
+  for (int i = 0; i < 100 && updates == 0; i++) {
+    rclcpp::spin_some(node);
+    rclcpp::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(gain, 4.0);
+  ASSERT_EQ(count, 3);
+  ASSERT_EQ(updates, 1);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "nav2_util/product_cache.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::ProductCache;
+
+namespace
+{
+
+class ProductCacheTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char directory[] = "/tmp/product_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    directory_ = directory;
+  }
+
+  void TearDown() override
+  {
+    for (const auto & file : files_) {
+      std::remove(file.c_str());
+    }
+    rmdir(directory_.c_str());
+  }
+
+  std::string directory_;
+  std::vector<std::string> files_;
+};
+
+}  // namespace
+
+TEST(HashBytes, DependsOnEveryByte)
+{
+  std::vector<unsigned char> data(37);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 7);
+  }
+  const uint64_t hash = nav2_util::hashBytes(data.data(), data.size());
+  EXPECT_EQ(hash, nav2_util::hashBytes(data.data(), data.size()));
+  EXPECT_NE(hash, nav2_util::hashBytes(data.data(), data.size(), 1));
+  EXPECT_NE(hash, nav2_util::hashBytes(data.data(), data.size() - 1));
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] ^= 1;
+    EXPECT_NE(hash, nav2_util::hashBytes(data.data(), data.size())) << i;
+    data[i] ^= 1;
+  }
+}
+
+TEST_F(ProductCacheTest, StoresAndMapsBackSections)
+{
+  ProductCache cache(directory_);
+  ASSERT_TRUE(cache.enabled());
+  files_.push_back(cache.path("test_v1", 42));
+
+  std::vector<uint16_t> distances(1000);
+  for (std::size_t i = 0; i < distances.size(); ++i) {
+    distances[i] = static_cast<uint16_t>(i * 3);
+  }
+  const double step = 0.25;
+  ASSERT_TRUE(
+    cache.store(
+      "test_v1", 42, {{distances.data(), distances.size() * sizeof(uint16_t)},
+        {&step, sizeof(step)}, {nullptr, 0}}));
+
+  auto product = cache.load("test_v1", 42);
+  ASSERT_NE(product, nullptr);
+  ASSERT_EQ(product->sectionCount(), 3u);
+  ASSERT_EQ(product->sectionSize(0), distances.size() * sizeof(uint16_t));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(product->sectionData(0)) % 64, 0u);
+  EXPECT_EQ(
+    std::memcmp(product->sectionData(0), distances.data(), product->sectionSize(0)), 0);
+  ASSERT_EQ(product->sectionSize(1), sizeof(step));
+  EXPECT_EQ(*static_cast<const double *>(product->sectionData(1)), step);
+  EXPECT_EQ(product->sectionSize(2), 0u);
+
+  EXPECT_EQ(cache.load("test_v1", 43), nullptr);
+  EXPECT_EQ(cache.load("test_v2", 42), nullptr);
+}
+
+TEST_F(ProductCacheTest, RejectsInvalidFiles)
+{
+  ProductCache cache(directory_);
+  const std::vector<char> data(200, 'x');
+  ASSERT_TRUE(cache.store("test_v1", 7, {{data.data(), data.size()}}));
+
+  // Truncated within its last section
+  const std::string file_name = cache.path("test_v1", 7);
+  files_.push_back(file_name);
+  ASSERT_EQ(truncate(file_name.c_str(), 150), 0);
+  EXPECT_EQ(cache.load("test_v1", 7), nullptr);
+
+  // Under another key
+  ASSERT_TRUE(cache.store("test_v1", 7, {{data.data(), data.size()}}));
+  files_.push_back(cache.path("test_v1", 8));
+  ASSERT_EQ(std::rename(file_name.c_str(), cache.path("test_v1", 8).c_str()), 0);
+  EXPECT_EQ(cache.load("test_v1", 8), nullptr);
+
+  // Not a product
+  std::ofstream(file_name) << "not a product";
+  EXPECT_EQ(cache.load("test_v1", 7), nullptr);
+}
+
+TEST(ProductCache, DisabledWithoutDirectory)
+{
+  ProductCache cache;
+  EXPECT_FALSE(cache.enabled());
+  const int value = 1;
+  EXPECT_FALSE(cache.store("test_v1", 1, {{&value, sizeof(value)}}));
+  EXPECT_EQ(cache.load("test_v1", 1), nullptr);
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_util/robot_state_cache.hpp"
+#include "nav2_util/seqlock.hpp"
+#include "gtest/gtest.h"
+
+struct Pair
+{
+  int64_t a;
+  int64_t b;
+};
+
+TEST(SeqLock, ReadersSeeConsistentValues)
+{
+  nav2_util::SeqLock<Pair> lock;
+  EXPECT_EQ(lock.load().a, 0);
+  EXPECT_EQ(lock.version(), 0u);
+
+  std::atomic<bool> done(false);
+  std::atomic<int> torn(0);
+  std::thread reader([&]() {
+      while (!done) {
+        const Pair value = lock.load();
+        if (value.a != -value.b) {
+          torn++;
+        }
+      }
+    });
+
+  for (int64_t i = 1; i <= 100000; ++i) {
+    lock.store(Pair{i, -i});
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(lock.load().a, 100000);
+  EXPECT_EQ(lock.version(), 100000u);
+}
+
+class RobotStateCacheTest : public ::testing::Test
+{
+protected:
+  RobotStateCacheTest()
+  {
+    clock_ = std::make_shared<rclcpp::Clock>(RCL_ROS_TIME);
+    buffer_ = std::make_shared<tf2_ros::Buffer>(clock_);
+    cache_ = std::make_shared<nav2_util::RobotStateCache>(buffer_, "map", "base_link");
+  }
+
+  void setPose(double seconds, double x, double yaw)
+  {
+    geometry_msgs::msg::TransformStamped transform;
+    transform.header.frame_id = "map";
+    transform.header.stamp = rclcpp::Time(static_cast<int64_t>(seconds * 1e9));
+    transform.child_frame_id = "base_link";
+    transform.transform.translation.x = x;
+    transform.transform.rotation.z = std::sin(yaw / 2.0);
+    transform.transform.rotation.w = std::cos(yaw / 2.0);
+    buffer_->setTransform(transform, "test");
+  }
+
+  rclcpp::Clock::SharedPtr clock_;
+  std::shared_ptr<tf2_ros::Buffer> buffer_;
+  std::shared_ptr<nav2_util::RobotStateCache> cache_;
+};
+
+TEST_F(RobotStateCacheTest, EmptyUntilUpdated)
+{
+  geometry_msgs::msg::PoseStamped pose;
+  EXPECT_FALSE(cache_->getLatestPose(pose));
+  EXPECT_FALSE(cache_->updatePose());
+  EXPECT_FALSE(cache_->getLatestPose(pose));
+
+  geometry_msgs::msg::TwistStamped twist;
+  EXPECT_FALSE(cache_->getTwist(twist));
+}
+
+TEST_F(RobotStateCacheTest, LatestPose)
+{
+  setPose(1.0, 1.0, 0.0);
+  EXPECT_TRUE(cache_->updatePose());
+  setPose(2.0, 3.0, 0.0);
+  EXPECT_TRUE(cache_->updatePose());
+
+  geometry_msgs::msg::PoseStamped pose;
+  EXPECT_TRUE(cache_->getLatestPose(pose));
+  EXPECT_EQ(pose.header.frame_id, "map");
+  EXPECT_EQ(rclcpp::Time(pose.header.stamp).nanoseconds(), 2000000000);
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, 3.0);
+}
+
+TEST_F(RobotStateCacheTest, InterpolatesPose)
+{
+  setPose(1.0, 0.0, 0.0);
+  cache_->updatePose();
+  setPose(2.0, 2.0, 1.0);
+  cache_->updatePose();
+
+  geometry_msgs::msg::PoseStamped pose;
+  const rclcpp::Duration tolerance(0, 100000000);
+  EXPECT_TRUE(cache_->getPose(rclcpp::Time(1500000000), tolerance, pose));
+  EXPECT_NEAR(pose.pose.position.x, 1.0, 1e-9);
+  EXPECT_NEAR(pose.pose.orientation.z, std::sin(0.25), 1e-9);
+  EXPECT_EQ(rclcpp::Time(pose.header.stamp).nanoseconds(), 1500000000);
+
+  // Within tolerance of either end the closest pose is used
+  EXPECT_TRUE(cache_->getPose(rclcpp::Time(2050000000), tolerance, pose));
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, 2.0);
+  EXPECT_TRUE(cache_->getPose(rclcpp::Time(950000000), tolerance, pose));
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, 0.0);
+
+  EXPECT_FALSE(cache_->getPose(rclcpp::Time(2500000000), tolerance, pose));
+  EXPECT_FALSE(cache_->getPose(rclcpp::Time(500000000), tolerance, pose));
+}
+
+TEST_F(RobotStateCacheTest, KeepsBoundedHistory)
+{
+  const std::size_t count = nav2_util::RobotStateCache::HISTORY_SIZE + 4;
+  for (std::size_t i = 1; i <= count; ++i) {
+    setPose(static_cast<double>(i), static_cast<double>(i), 0.0);
+    cache_->updatePose();
+  }
+
+  geometry_msgs::msg::PoseStamped pose;
+  const rclcpp::Duration tolerance(0, 0);
+  const int64_t oldest = static_cast<int64_t>(count - cache_->HISTORY_SIZE + 1);
+  EXPECT_TRUE(cache_->getPose(rclcpp::Time(oldest * 1000000000), tolerance, pose));
+  EXPECT_DOUBLE_EQ(pose.pose.position.x, static_cast<double>(oldest));
+  EXPECT_FALSE(cache_->getPose(rclcpp::Time((oldest - 1) * 1000000000), tolerance, pose));
+  const rclcpp::Time between(static_cast<int64_t>(count) * 1000000000 - 500000000);
+  EXPECT_TRUE(cache_->getPose(between, tolerance, pose));
+  EXPECT_NEAR(pose.pose.position.x, static_cast<double>(count) - 0.5, 1e-9);
+}
+
+TEST_F(RobotStateCacheTest, Twist)
+{
+  nav_msgs::msg::Odometry odom;
+  odom.header.stamp = rclcpp::Time(3000000000);
+  odom.twist.twist.linear.x = 0.5;
+  odom.twist.twist.angular.z = -0.2;
+  cache_->updateOdometry(odom);
+
+  geometry_msgs::msg::TwistStamped twist;
+  EXPECT_TRUE(cache_->getTwist(twist));
+  EXPECT_EQ(twist.header.frame_id, "base_link");
+  EXPECT_DOUBLE_EQ(twist.twist.linear.x, 0.5);
+  EXPECT_DOUBLE_EQ(twist.twist.angular.z, -0.2);
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  rclcpp::init(0, nullptr);
+  int result = RUN_ALL_TESTS();
+  rclcpp::shutdown();
+  return result;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "nav2_util/se2.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::se2::Transform;
+
+TEST(SE2, yaw_round_trip)
+{
+  for (double yaw = -3.1; yaw < 3.1; yaw += 0.1) {
+    EXPECT_NEAR(nav2_util::se2::yaw(nav2_util::se2::quaternion(yaw)), yaw, 1e-12);
+  }
+
+  // Not normalized
+  geometry_msgs::msg::Quaternion q = nav2_util::se2::quaternion(1.0);
+  q.z *= 2.0;
+  q.w *= 2.0;
+  EXPECT_NEAR(nav2_util::se2::yaw(q), 1.0, 1e-12);
+}
+
+TEST(SE2, from_pose)
+{
+  geometry_msgs::msg::Pose pose;
+  pose.position.x = 1.0;
+  pose.position.y = -2.0;
+  pose.orientation = nav2_util::se2::quaternion(2.5);
+
+  const Transform t = Transform::fromPose(pose);
+  EXPECT_DOUBLE_EQ(t.x, 1.0);
+  EXPECT_DOUBLE_EQ(t.y, -2.0);
+  EXPECT_NEAR(t.theta(), 2.5, 1e-12);
+
+  const geometry_msgs::msg::Pose back = t.toPose();
+  EXPECT_NEAR(nav2_util::se2::yaw(back.orientation), 2.5, 1e-12);
+}
+
+TEST(SE2, compose_and_inverse)
+{
+  const Transform a(1.0, 2.0, 0.7);
+  const Transform b(-0.5, 0.25, -1.9);
+  const Transform ab = a * b;
+
+  double x1, y1, x2, y2;
+  b.apply(0.3, -0.4, x1, y1);
+  a.apply(x1, y1, x1, y1);
+  ab.apply(0.3, -0.4, x2, y2);
+  EXPECT_NEAR(x1, x2, 1e-12);
+  EXPECT_NEAR(y1, y2, 1e-12);
+
+  const Transform identity = ab * ab.inverse();
+  EXPECT_NEAR(identity.x, 0.0, 1e-12);
+  EXPECT_NEAR(identity.y, 0.0, 1e-12);
+  EXPECT_NEAR(identity.theta(), 0.0, 1e-12);
+
+  ab.applyInverse(x2, y2, x2, y2);
+  EXPECT_NEAR(x2, 0.3, 1e-12);
+  EXPECT_NEAR(y2, -0.4, 1e-12);
+}
+
+TEST(SE2, batches)
+{
+  const double x[3] = {1.0, 0.0, 2.0};
+  const double y[3] = {0.0, 1.0, 2.0};
+  double out_x[3], out_y[3];
+  const Transform t(1.0, 1.0, M_PI_2);
+  nav2_util::se2::transformPoints(t, x, y, out_x, out_y, 3);
+  for (int i = 0; i < 3; ++i) {
+    double px, py;
+    t.apply(x[i], y[i], px, py);
+    EXPECT_DOUBLE_EQ(out_x[i], px);
+    EXPECT_DOUBLE_EQ(out_y[i], py);
+  }
+  EXPECT_NEAR(out_x[0], 1.0, 1e-12);
+  EXPECT_NEAR(out_y[0], 2.0, 1e-12);
+
+  const double angles[4] = {0.0, 0.5, -2.0, 3.0};
+  double s[4], c[4];
+  nav2_util::se2::sincos(angles, s, c, 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_DOUBLE_EQ(s[i], std::sin(angles[i]));
+    EXPECT_DOUBLE_EQ(c[i], std::cos(angles[i]));
+  }
+}
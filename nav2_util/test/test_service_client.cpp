@@ -12,7 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
 #include <string>
+#include <vector>
+#include "nav2_util/node_thread.hpp"
 #include "nav2_util/service_client.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "std_srvs/srv/empty.hpp"
@@ -56,3 +59,41 @@ TEST(ServiceClient, can_ServiceClient_use_passed_in_node)
   ASSERT_EQ(t.getNode(), node);
   ASSERT_EQ(t.name(), "test_node");
 }
+
+TEST(ServiceClient, async_and_batched_invocations)
+{
+  auto server_node = rclcpp::Node::make_shared("test_server");
+  int calls = 0;
+  auto server = server_node->create_service<std_srvs::srv::Empty>(
+    "empty",
+    [&calls](
+      const std::shared_ptr<std_srvs::srv::Empty::Request>,
+      std::shared_ptr<std_srvs::srv::Empty::Response>) {calls++;});
+  nav2_util::NodeThread server_thread(server_node);
+
+  TestServiceClient t("empty");
+  auto request = std::make_shared<std_srvs::srv::Empty::Request>();
+  EXPECT_TRUE(t.invoke(request, std::chrono::seconds(5)) != nullptr);
+
+  bool called_back = false;
+  t.invoke_async(
+    request, [&called_back](std_srvs::srv::Empty::Response::SharedPtr response) {
+      called_back = response != nullptr;
+    });
+  auto future = t.invoke_async(request);
+  EXPECT_TRUE(t.spin_until_complete(future, std::chrono::seconds(5)));
+  for (int i = 0; i < 100 && !called_back; i++) {
+    rclcpp::sleep_for(std::chrono::milliseconds(10));
+    t.spin_until_complete(t.invoke_async(request), std::chrono::seconds(5));
+  }
+  EXPECT_TRUE(called_back);
+
+  std::vector<std_srvs::srv::Empty::Request::SharedPtr> requests(
+    3, std::make_shared<std_srvs::srv::Empty::Request>());
+  auto responses = t.invoke_batch(requests, std::chrono::seconds(5));
+  ASSERT_EQ(responses.size(), 3u);
+  for (auto & response : responses) {
+    EXPECT_TRUE(response != nullptr);
+  }
+  EXPECT_GE(calls, 6);
+}
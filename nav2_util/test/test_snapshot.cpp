@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "nav2_util/snapshot.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::Snapshot;
+using nav2_util::SnapshotWriter;
+
+namespace
+{
+
+class SnapshotTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char directory[] = "/tmp/snapshot_XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    directory_ = directory;
+    path_ = directory_ + "/test.snap";
+  }
+
+  void TearDown() override
+  {
+    std::remove(path_.c_str());
+    rmdir(directory_.c_str());
+  }
+
+  std::string directory_;
+  std::string path_;
+};
+
+}  // namespace
+
+TEST_F(SnapshotTest, WritesAndMapsBackSections)
+{
+  std::vector<unsigned char> costs(1001);
+  for (std::size_t i = 0; i < costs.size(); ++i) {
+    costs[i] = static_cast<unsigned char>(i % 254);
+  }
+  std::vector<double> pose = {1.5, -2.0, 0.25};
+
+  SnapshotWriter writer("planner_server");
+  writer.addArray("costmap/costs", costs);
+  writer.addArray("pose", pose);
+  writer.addValue("planner/iterations", static_cast<uint32_t>(7));
+  writer.addString("frame", "map");
+  writer.addBytes("empty", nullptr, 0);
+  EXPECT_TRUE(writer.has("pose"));
+  EXPECT_EQ(writer.size(), costs.size() + 3 * sizeof(double) + sizeof(uint32_t) + 3);
+  ASSERT_TRUE(writer.write(path_));
+
+  auto snapshot = Snapshot::load(path_);
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(snapshot->source(), "planner_server");
+  EXPECT_GT(snapshot->stamp(), 0);
+  EXPECT_EQ(snapshot->sectionNames().size(), 5u);
+
+  std::size_t count = 0;
+  const unsigned char * mapped = snapshot->array<unsigned char>("costmap/costs", count);
+  ASSERT_NE(mapped, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped) % 64, 0u);
+  EXPECT_EQ(std::vector<unsigned char>(mapped, mapped + count), costs);
+  EXPECT_EQ(snapshot->vector<double>("pose"), pose);
+
+  uint32_t iterations = 0;
+  EXPECT_TRUE(snapshot->value("planner/iterations", iterations));
+  EXPECT_EQ(iterations, 7u);
+  double wrong_size = 0.0;
+  EXPECT_FALSE(snapshot->value("planner/iterations", wrong_size));
+
+  EXPECT_EQ(snapshot->string("frame"), "map");
+  EXPECT_TRUE(snapshot->has("empty"));
+  EXPECT_FALSE(snapshot->has("missing"));
+  EXPECT_TRUE(snapshot->vector<double>("missing").empty());
+}
+
+TEST_F(SnapshotTest, ReplacesSectionsOfTheSameName)
+{
+  SnapshotWriter writer("controller_server");
+  writer.addValue("velocity", 1.0);
+  writer.addValue("velocity", 2.0);
+  ASSERT_TRUE(writer.write(path_));
+
+  auto snapshot = Snapshot::load(path_);
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(snapshot->sectionNames().size(), 1u);
+  double velocity = 0.0;
+  EXPECT_TRUE(snapshot->value("velocity", velocity));
+  EXPECT_EQ(velocity, 2.0);
+}
+
+TEST_F(SnapshotTest, AddsDeferredSectionsWhenWritten)
+{
+  SnapshotWriter writer("planner_server");
+  int grid = 1;
+  writer.defer(
+    [&grid](SnapshotWriter & deferred) {
+      deferred.addValue("grid", grid);
+      deferred.defer([](SnapshotWriter & nested) {nested.addString("frame", "map");});
+    });
+  EXPECT_FALSE(writer.has("grid"));
+  grid = 2;
+  ASSERT_TRUE(writer.write(path_));
+
+  auto snapshot = Snapshot::load(path_);
+  ASSERT_NE(snapshot, nullptr);
+  int saved = 0;
+  EXPECT_TRUE(snapshot->value("grid", saved));
+  EXPECT_EQ(saved, 2);
+  EXPECT_EQ(snapshot->string("frame"), "map");
+}
+
+TEST_F(SnapshotTest, RejectsOtherFiles)
+{
+  EXPECT_EQ(Snapshot::load(path_), nullptr);
+  {
+    std::ofstream file(path_, std::ios::binary);
+    file << std::string(256, 'x');
+  }
+  EXPECT_EQ(Snapshot::load(path_), nullptr);
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "nav2_util/task_scheduler.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::TaskPriority;
+using nav2_util::TaskScheduler;
+using nav2_util::TaskSchedulerOptions;
+
+TaskSchedulerOptions options(unsigned int threads, unsigned int reserved = 0)
+{
+  TaskSchedulerOptions options;
+  options.num_threads = threads;
+  options.reserved_control_threads = reserved;
+  return options;
+}
+
+TEST(TaskScheduler, ParallelForRunsEveryTaskOnce)
+{
+  TaskScheduler scheduler(options(3));
+  std::vector<std::atomic<int>> counts(1000);
+  for (int round = 0; round < 10; ++round) {
+    scheduler.parallelFor(
+      TaskPriority::COSTMAP, counts.size(), [&](std::size_t i) {counts[i]++;});
+  }
+  for (auto & count : counts) {
+    EXPECT_EQ(count.load(), 10);
+  }
+}
+
+TEST(TaskScheduler, NestedParallelFor)
+{
+  TaskScheduler scheduler(options(2));
+  std::atomic<int> sum{0};
+  scheduler.parallelFor(
+    TaskPriority::PLANNING, 8, [&](std::size_t) {
+      scheduler.parallelFor(
+        TaskPriority::CONTROL, 8, [&](std::size_t j) {sum += static_cast<int>(j);});
+    });
+  EXPECT_EQ(sum.load(), 8 * 28);
+}
+
+TEST(TaskScheduler, RethrowsTaskException)
+{
+  TaskScheduler scheduler(options(3));
+  EXPECT_THROW(
+    scheduler.parallelFor(
+      TaskPriority::LOCALIZATION, 100, [](std::size_t i) {
+        if (i == 42) {
+          throw std::runtime_error("task failed");
+        }
+      }),
+    std::runtime_error);
+
+  auto failed = scheduler.submit(
+    TaskPriority::PLANNING, []() {throw std::runtime_error("task failed");});
+  EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(TaskScheduler, ReservedWorkersKeepControlResponsive)
+{
+  TaskScheduler scheduler(options(2, 1));
+  EXPECT_EQ(scheduler.numWorkers(), 2u);
+  EXPECT_EQ(scheduler.numWorkers(TaskPriority::CONTROL), 2u);
+  EXPECT_EQ(scheduler.numWorkers(TaskPriority::PLANNING), 1u);
+
+  // Planning saturates its only worker
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto planning = scheduler.submit(TaskPriority::PLANNING, [released]() {released.wait();});
+
+  auto control = scheduler.submit(TaskPriority::CONTROL, []() {});
+  EXPECT_EQ(control.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+
+  release.set_value();
+  planning.get();
+}
+
+TEST(TaskScheduler, KeepsAWorkerForOtherClasses)
+{
+  TaskScheduler scheduler(options(1, 1));
+  EXPECT_EQ(scheduler.numWorkers(TaskPriority::PLANNING), 1u);
+
+  int sum = 0;
+  scheduler.parallelFor(
+    TaskPriority::PLANNING, 10, [&](std::size_t i) {sum += static_cast<int>(i);}, 1);
+  EXPECT_EQ(sum, 45);
+}
+
+TEST(TaskScheduler, ParsesCpuLists)
+{
+  EXPECT_EQ(nav2_util::parseCpuList("0-3,6"), (std::vector<int>{0, 1, 2, 3, 6}));
+  EXPECT_EQ(nav2_util::parseCpuList("2,x,4"), (std::vector<int>{2, 4}));
+  EXPECT_TRUE(nav2_util::parseCpuList("").empty());
+}
+
+TEST(TaskScheduler, SharedThreadPool)
+{
+  nav2_util::ThreadPool pool(TaskPriority::COSTMAP, 2);
+  EXPECT_LE(pool.size(), 2u);
+  EXPECT_GE(pool.size(), 1u);
+
+  std::vector<std::atomic<int>> counts(100);
+  pool.parallelFor(counts.size(), [&](std::size_t i) {counts[i]++;});
+  for (auto & count : counts) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "nav2_util/thread_pool.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::ThreadPool;
+
+TEST(ThreadPool, RunsEveryTaskOnce)
+{
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.size(), 4u);
+
+  std::vector<std::atomic<int>> counts(1000);
+  for (int round = 0; round < 10; ++round) {
+    pool.parallelFor(counts.size(), [&](std::size_t i) {counts[i]++;});
+  }
+
+  for (auto & count : counts) {
+    EXPECT_EQ(count.load(), 10);
+  }
+}
+
+TEST(ThreadPool, InlineWithSingleThread)
+{
+  ThreadPool pool(1);
+  EXPECT_EQ(pool.size(), 1u);
+
+  int sum = 0;
+  pool.parallelFor(10, [&](std::size_t i) {sum += static_cast<int>(i);});
+  EXPECT_EQ(sum, 45);
+  pool.parallelFor(0, [&](std::size_t) {sum = -1;});
+  EXPECT_EQ(sum, 45);
+}
+
+TEST(ThreadPool, RethrowsTaskException)
+{
+  ThreadPool pool(3);
+  std::atomic<int> ran{0};
+  EXPECT_THROW(
+    pool.parallelFor(
+      100, [&](std::size_t i) {
+        ran++;
+        if (i == 42) {
+          throw std::runtime_error("task failed");
+        }
+      }), std::runtime_error);
+  EXPECT_EQ(ran.load(), 100);
+
+  // The pool is still usable afterwards
+  ran = 0;
+  pool.parallelFor(10, [&](std::size_t) {ran++;});
+  EXPECT_EQ(ran.load(), 10);
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/timing_stats.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::TimingHistogram;
+using nav2_util::TimingStats;
+
+TEST(TimingHistogram, BucketsCoverEveryDuration)
+{
+  uint64_t previous_bound = 0;
+  for (std::size_t b = 1; b < TimingHistogram::kBuckets; ++b) {
+    const uint64_t bound = TimingHistogram::bucketUpperBound(b);
+    EXPECT_GT(bound, previous_bound);
+    EXPECT_EQ(TimingHistogram::bucket(previous_bound + 1), b);
+    EXPECT_EQ(TimingHistogram::bucket(bound), b);
+    previous_bound = bound;
+  }
+  EXPECT_EQ(TimingHistogram::bucket(UINT64_MAX), TimingHistogram::kBuckets - 1);
+}
+
+TEST(TimingHistogram, SummarizesPercentiles)
+{
+  TimingHistogram histogram;
+  EXPECT_EQ(histogram.summarize().count, 0u);
+
+  // 1 to 100 ms
+  for (int i = 1; i <= 100; ++i) {
+    histogram.record(std::chrono::milliseconds(i));
+  }
+  histogram.record(-5);
+
+  const auto summary = histogram.summarize();
+  EXPECT_EQ(summary.count, 101u);
+  EXPECT_NEAR(summary.mean_ms, 5050.0 / 101, 1e-9);
+  EXPECT_GE(summary.p50_ms, 50.0);
+  EXPECT_LE(summary.p50_ms, 50.0 * 1.25);
+  EXPECT_GE(summary.p99_ms, 99.0);
+  EXPECT_LE(summary.p99_ms, 100.0);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 100.0);
+}
+
+TEST(TimingHistogram, ForgetsOldWindows)
+{
+  TimingHistogram histogram;
+  histogram.record(std::chrono::milliseconds(40));
+  for (std::size_t i = 1; i < TimingHistogram::kWindows; ++i) {
+    histogram.rotate();
+    histogram.record(std::chrono::milliseconds(1));
+    EXPECT_DOUBLE_EQ(histogram.summarize().max_ms, 40.0);
+  }
+
+  histogram.rotate();
+  const auto summary = histogram.summarize();
+  EXPECT_EQ(summary.count, TimingHistogram::kWindows - 1);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 1.0);
+}
+
+TEST(TimingHistogram, CountsConcurrentRecords)
+{
+  TimingHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back(
+      [&histogram, t]() {
+        for (int i = 0; i < 10000; ++i) {
+          histogram.record(1000 * (t + 1));
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  const auto summary = histogram.summarize();
+  EXPECT_EQ(summary.count, 40000u);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 0.004);
+}
+
+TEST(TimingStats, ListsTheHistogramsInUse)
+{
+  TimingStats stats;
+  TimingHistogram & costs = stats.histogram("static_layer update_costs");
+  EXPECT_EQ(&stats.histogram("static_layer update_costs"), &costs);
+  stats.histogram("obstacle_layer update_costs");
+  costs.record(std::chrono::microseconds(300));
+  {
+    nav2_util::ScopedTiming timing(&stats.histogram("inflation_layer update_costs"));
+  }
+  {
+    nav2_util::ScopedTiming timing(nullptr);
+  }
+
+  auto summaries = stats.summarizeAndRotate();
+  ASSERT_EQ(summaries.size(), 2u);
+  EXPECT_EQ(summaries[0].first, "inflation_layer update_costs");
+  EXPECT_EQ(summaries[1].first, "static_layer update_costs");
+  EXPECT_EQ(summaries[1].second.count, 1u);
+  EXPECT_DOUBLE_EQ(summaries[1].second.max_ms, 0.3);
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/trace.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::ScopedTrace;
+using nav2_util::TraceBuffer;
+
+TEST(Trace, RecordsNothingWhileDisabled)
+{
+  TraceBuffer::instance().enable(8);
+  TraceBuffer::instance().disable();
+  {
+    ScopedTrace trace("test.disabled");
+  }
+  EXPECT_TRUE(TraceBuffer::instance().snapshot().empty());
+}
+
+TEST(Trace, NestedSpansInheritTheInputStamp)
+{
+  TraceBuffer::instance().enable(8);
+  {
+    ScopedTrace outer("test.outer", "", 1000, 2000);
+    EXPECT_EQ(ScopedTrace::currentInputStamp(), 1000);
+    {
+      ScopedTrace inner("test.inner", std::string("a_layer_with_a_very_long_name_indeed"));
+    }
+    {
+      ScopedTrace other("test.other", "", 3000);
+      EXPECT_EQ(ScopedTrace::currentInputStamp(), 3000);
+    }
+    EXPECT_EQ(ScopedTrace::currentInputStamp(), 1000);
+  }
+  EXPECT_EQ(ScopedTrace::currentInputStamp(), 0);
+
+  const auto events = TraceBuffer::instance().snapshot();
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_STREQ(events[0].name, "test.inner");
+  EXPECT_EQ(events[0].input_stamps_ns[0], 1000);
+  EXPECT_EQ(events[0].input_stamps_ns[1], 0);
+  EXPECT_EQ(std::string(events[0].detail).size(), nav2_util::TraceEvent::kDetailSize - 1);
+  EXPECT_STREQ(events[1].name, "test.other");
+  EXPECT_EQ(events[1].input_stamps_ns[0], 3000);
+  EXPECT_STREQ(events[2].name, "test.outer");
+  EXPECT_EQ(events[2].input_stamps_ns[1], 2000);
+  EXPECT_LE(events[2].start_ns, events[0].start_ns);
+  EXPECT_GE(events[2].end_ns, events[1].end_ns);
+  TraceBuffer::instance().disable();
+}
+
+TEST(Trace, InputScopesAttributeWithoutRecording)
+{
+  TraceBuffer::instance().enable(8);
+  {
+    nav2_util::TraceInputScope scope(42);
+    ScopedTrace trace("test.scoped");
+  }
+  EXPECT_EQ(ScopedTrace::currentInputStamp(), 0);
+
+  const auto events = TraceBuffer::instance().snapshot();
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].input_stamps_ns[0], 42);
+  TraceBuffer::instance().disable();
+}
+
+TEST(Trace, KeepsTheLatestEvents)
+{
+  TraceBuffer::instance().enable(4);
+  for (int i = 0; i < 10; ++i) {
+    TraceBuffer::instance().recordSummed("test.summed", std::to_string(i), i, 10, 3);
+  }
+
+  const auto events = TraceBuffer::instance().snapshot();
+  ASSERT_EQ(events.size(), 4u);
+  EXPECT_STREQ(events.front().detail, "6");
+  EXPECT_STREQ(events.back().detail, "9");
+  EXPECT_EQ(events.back().end_ns - events.back().start_ns, 10);
+  EXPECT_EQ(events.back().calls, 3u);
+  EXPECT_EQ(TraceBuffer::instance().overwritten(), 6u);
+  TraceBuffer::instance().disable();
+}
+
+TEST(Trace, DrainsTheBuffer)
+{
+  TraceBuffer::instance().enable(4);
+  for (int i = 0; i < 6; ++i) {
+    TraceBuffer::instance().recordSummed("test.drained", std::to_string(i), i, 1, 1);
+  }
+
+  const auto events = TraceBuffer::instance().drain();
+  ASSERT_EQ(events.size(), 4u);
+  EXPECT_STREQ(events.front().detail, "2");
+  EXPECT_TRUE(TraceBuffer::instance().snapshot().empty());
+  EXPECT_EQ(TraceBuffer::instance().overwritten(), 0u);
+
+  TraceBuffer::instance().recordSummed("test.drained", "6", 6, 1, 1);
+  ASSERT_EQ(TraceBuffer::instance().drain().size(), 1u);
+  TraceBuffer::instance().disable();
+}
+
+TEST(Trace, WritesChromeTraceFiles)
+{
+  TraceBuffer::instance().enable(4);
+  {
+    builtin_interfaces::msg::Time stamp;
+    stamp.sec = 1;
+    stamp.nanosec = 5;
+    EXPECT_EQ(nav2_util::traceStamp(stamp), 1000000005);
+    ScopedTrace trace("test.file", "say \"hi\"", nav2_util::traceStamp(stamp));
+  }
+
+  const std::string path = "test_trace.json";
+  ASSERT_TRUE(TraceBuffer::instance().writeChromeTrace(path));
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  EXPECT_NE(contents.str().find("\"name\":\"test.file\""), std::string::npos);
+  EXPECT_NE(contents.str().find("say \\\"hi\\\""), std::string::npos);
+  EXPECT_NE(contents.str().find("input_0_latency_ms"), std::string::npos);
+  std::remove(path.c_str());
+  TraceBuffer::instance().disable();
+}
+
+TEST(Trace, KeepsARingPerThread)
+{
+  TraceBuffer::instance().enable(4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 3; ++t) {
+    threads.emplace_back(
+      []() {
+        for (int i = 0; i < 6; ++i) {
+          ScopedTrace trace("test.thread");
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  // Each thread keeps its own latest events, those of exited threads included
+  const auto events = TraceBuffer::instance().drain();
+  ASSERT_EQ(events.size(), 12u);
+  for (std::size_t i = 1; i < events.size(); ++i) {
+    EXPECT_LE(events[i - 1].end_ns, events[i].end_ns);
+  }
+  EXPECT_TRUE(TraceBuffer::instance().snapshot().empty());
+  TraceBuffer::instance().disable();
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
+#define NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
+
+#include <stdint.h>
+#include <limits.h>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "nav2_voxel_grid/voxel_grid.hpp"
+
+namespace nav2_voxel_grid
+{
+
+/**
+ * @class SparseVoxelGrid
+ * @brief A voxel grid that only stores the 8 x 8 x 8 bricks of voxels observed
+ *
+ * A brick holds a known and a marked bit per voxel, and the voxels of the
+ * bricks never created are unknown. The bricks over an 8 x 8 tile of columns
+ * are kept together with the number of known and marked voxels of each
+ * column, so clearing and marking update the costmap cell of a column without
+ * visiting its bricks, and the tiles are found by hash. Memory follows the
+ * volume the sensors observed instead of the window, which affords tall and
+ * finely resolved columns.
+ *
+ * It has the interface of VoxelGridT the voxel layer uses, with the same
+ * Bresenham rays. As there, the levels of a column above size_z count as
+ * unknown, up to MAX_SIZE_Z.
+ */
+class SparseVoxelGrid
+{
+public:
+  /// Number of vertical cells a column holds
+  static constexpr unsigned int MAX_SIZE_Z = 2048;
+
+  SparseVoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  /**
+   * @brief  Resizes the grid, leaving every voxel unknown
+   * @param size_z The z size of the grid, only sizes <= MAX_SIZE_Z are supported
+   */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  /** @brief Makes every voxel unknown, dropping the bricks */
+  void reset();
+
+  unsigned int sizeX() const {return size_x_;}
+  unsigned int sizeY() const {return size_y_;}
+  unsigned int sizeZ() const {return size_z_;}
+
+  /** @brief Bytes of the tiles, the bricks and the hash table */
+  std::size_t getMemoryUsage() const;
+
+  void markVoxel(unsigned int x, unsigned int y, unsigned int z);
+
+  /**
+   * @brief  Marks a voxel
+   * @return Whether more than marked_threshold voxels of its column are marked
+   */
+  bool markVoxelInMap(
+    unsigned int x, unsigned int y, unsigned int z, unsigned int marked_threshold);
+
+  void clearVoxel(unsigned int x, unsigned int y, unsigned int z);
+
+  /** @brief Clears every voxel of the column at index y * size_x + x */
+  void clearVoxelColumn(unsigned int index);
+
+  /**
+   * @brief  Clears the lines from one origin to many end points in the grid and in map_2d,
+   * as VoxelGridT::clearVoxelLinesInMap() does
+   */
+  void clearVoxelLinesInMap(
+    double x0, double y0, double z0, const std::vector<RayEnd> & ends, unsigned char * map_2d,
+    unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX);
+
+  VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+  VoxelStatus getVoxelColumn(
+    unsigned int x, unsigned int y,
+    unsigned int unknown_threshold = 0, unsigned int marked_threshold = 0) const;
+
+  /**
+   * @brief  Number of voxels of the grid that are MARKED or UNKNOWN
+   */
+  std::size_t countVoxels(VoxelStatus status) const;
+
+  /**
+   * @brief  Calls fn(x, y, z) for every voxel that is MARKED or UNKNOWN
+   *
+   * Marked voxels are found from the bricks, unknown ones visit every column
+   * of the window.
+   */
+  template<class Fn>
+  void forEachVoxel(VoxelStatus status, Fn fn) const
+  {
+    if (status == MARKED) {
+      for (const auto & entry : tiles_) {
+        const Tile & tile = entry.second;
+        for (std::size_t b = 0; b < tile.bricks.size(); ++b) {
+          if (!tile.bricks[b]) {
+            continue;
+          }
+          for (unsigned int layer = 0; layer < 8; ++layer) {
+            uint64_t bits = tile.bricks[b]->marked[layer];
+            while (bits) {
+              const unsigned int column = lowestBit(bits);
+              fn(
+                tile.x * 8 + (column & 7) - offset_x_, tile.y * 8 + (column >> 3) - offset_y_,
+                b * 8 + layer);
+              bits &= bits - 1;
+            }
+          }
+        }
+      }
+      return;
+    }
+
+    for (unsigned int y = 0; y < size_y_; ++y) {
+      for (unsigned int x = 0; x < size_x_; ++x) {
+        for (unsigned int z = 0; z < size_z_; ++z) {
+          if (getVoxel(x, y, z) == UNKNOWN) {
+            fn(x, y, z);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief  Moves the window by whole cells, as Costmap2D::updateOrigin() moves a costmap:
+   * the column at (x, y) afterwards is the one at (x + cell_ox, y + cell_oy) before, and the
+   * columns the window moved onto are unknown
+   */
+  void shift(int cell_ox, int cell_oy);
+
+  /** @brief 32 bit words of a column, as published in a nav2_msgs VoxelGrid */
+  unsigned int wordsPerColumn() const;
+
+  /**
+   * @brief  Writes the columns of a rectangle row by row, wordsPerColumn() words each,
+   * in the layout of VoxelGridT
+   */
+  void copyColumnWords(
+    unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+    uint32_t * words) const;
+
+private:
+  /// A known and a marked bit per voxel, one word per level of 8 x 8 voxels
+  struct Brick
+  {
+    std::array<uint64_t, 8> known{};
+    std::array<uint64_t, 8> marked{};
+  };
+
+  /// The bricks over 8 x 8 columns, and the counts of the columns
+  struct Tile
+  {
+    int x, y;  ///< Position in tiles, absolute
+    std::array<uint16_t, 64> known{};
+    std::array<uint16_t, 64> marked{};
+    std::vector<std::unique_ptr<Brick>> bricks;  ///< By level of bricks, null when unknown
+  };
+
+  /// Absolute cell of a window cell: the window moves, the tiles stay
+  int absX(unsigned int x) const {return static_cast<int>(x) + offset_x_;}
+  int absY(unsigned int y) const {return static_cast<int>(y) + offset_y_;}
+
+  static uint64_t tileKey(int tile_x, int tile_y)
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tile_x)) << 32) |
+           static_cast<uint32_t>(tile_y);
+  }
+
+  /// Bit of a column in the words of its tile's bricks
+  static unsigned int columnBit(int abs_x, int abs_y) {return (abs_y & 7) * 8 + (abs_x & 7);}
+
+  const Tile * findTile(int abs_x, int abs_y) const;
+  Tile & getTile(int abs_x, int abs_y);
+  Brick & getBrick(Tile & tile, unsigned int z);
+
+  /// Makes a voxel known and marked or free, keeping the counts of its column
+  void setVoxel(Tile & tile, unsigned int column, unsigned int z, bool mark);
+
+  /// Makes the voxels of a column of a tile unknown
+  void forgetColumn(Tile & tile, unsigned int column);
+
+  /**
+   * @brief  Calls fn(x, y, z) for the voxels of a line, with the steps of VoxelGridT::raytraceLine()
+   */
+  template<class Fn>
+  void traceLine(
+    double x0, double y0, double z0, double x1, double y1, double z1,
+    unsigned int max_length, Fn fn) const;
+
+  unsigned int size_x_, size_y_, size_z_;
+  int offset_x_{0}, offset_y_{0};
+  std::unordered_map<uint64_t, Tile> tiles_;
+  std::size_t brick_count_{0};
+  rclcpp::Logger logger;
+};
+
+}  // namespace nav2_voxel_grid
+
+#endif  // NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
@@ -44,14 +44,9 @@
 #include <math.h>
 #include <limits.h>
 #include <algorithm>
+#include <vector>
 #include "rclcpp/rclcpp.hpp"
 
-/**
- * @class VoxelGrid
- * @brief A 3D grid structure that stores points as an integer array.
- *        X and Y index the array and Z selects which bit of the integer
- *        is used giving a limit of 16 vertical cells.
- */
 namespace nav2_voxel_grid
 {
 
@@ -62,29 +57,120 @@ enum VoxelStatus
   MARKED = 2,
 };
 
-class VoxelGrid
+/**
+ * @brief  Number of set bits, used by the column lookups
+ */
+inline unsigned int popcount(uint32_t n)
+{
+  return __builtin_popcount(n);
+}
+
+inline unsigned int popcount(uint64_t n)
+{
+  return __builtin_popcountll(n);
+}
+
+/**
+ * @brief  Index of the lowest set bit, n must not be 0
+ */
+inline unsigned int lowestBit(uint32_t n)
+{
+  return __builtin_ctz(n);
+}
+
+inline unsigned int lowestBit(uint64_t n)
+{
+  return __builtin_ctzll(n);
+}
+
+#ifdef __SIZEOF_INT128__
+// __extension__ keeps -Wpedantic quiet about the compiler provided type
+__extension__ typedef unsigned __int128 uint128_t;
+
+inline unsigned int popcount(uint128_t n)
+{
+  return __builtin_popcountll(static_cast<uint64_t>(n)) +
+         __builtin_popcountll(static_cast<uint64_t>(n >> 64));
+}
+
+inline unsigned int lowestBit(uint128_t n)
+{
+  const uint64_t low = static_cast<uint64_t>(n);
+  return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<uint64_t>(n >> 64));
+}
+#endif
+
+/**
+ * @brief  End point of a ray, in grid coordinates
+ */
+struct RayEnd
+{
+  double x, y, z;
+};
+
+/**
+ * @class VoxelGridT
+ * @brief A 3D grid structure that stores points as an integer array.
+ *        X and Y index the array and Z selects which bit of the integer
+ *        is used. The low half of each column word holds the unknown/free
+ *        bits and the high half the marked bits, giving a limit of 16, 32
+ *        or 64 vertical cells for 32, 64 or 128-bit words.
+ */
+template<class ColumnWord>
+class VoxelGridT
 {
 public:
+  typedef ColumnWord Column;
+
+  /// Number of vertical cells a column holds
+  static constexpr unsigned int MAX_SIZE_Z = sizeof(Column) * 4;
+
   /**
    * @brief  Constructor for a voxel grid
    * @param size_x The x size of the grid
    * @param size_y The y size of the grid
-   * @param size_z The z size of the grid, only sizes <= 16 are supported
+   * @param size_z The z size of the grid, only sizes <= MAX_SIZE_Z are supported
    */
-  VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+  VoxelGridT(unsigned int size_x, unsigned int size_y, unsigned int size_z);
 
-  ~VoxelGrid();
+  ~VoxelGridT();
 
   /**
    * @brief  Resizes a voxel grid to the desired size
    * @param size_x The x size of the grid
    * @param size_y The y size of the grid
-   * @param size_z The z size of the grid, only sizes <= 16 are supported
+   * @param size_z The z size of the grid, only sizes <= MAX_SIZE_Z are supported
    */
   void resize(unsigned int size_x, unsigned int size_y, unsigned int size_z);
 
   void reset();
-  uint32_t * getData() {return data_;}
+  Column * getData() {return data_;}
+
+  /** @brief Value of a column whose cells are all unknown, as reset() leaves them */
+  static Column unknownColumn() {return ~static_cast<Column>(0) >> MAX_SIZE_Z;}
+
+  /** @brief Bytes of the columns */
+  std::size_t getMemoryUsage() const
+  {
+    return static_cast<std::size_t>(size_x_) * size_y_ * sizeof(Column);
+  }
+
+  /** @brief 32 bit words of a column, as published in a nav2_msgs VoxelGrid */
+  static constexpr unsigned int wordsPerColumn() {return sizeof(Column) / sizeof(uint32_t);}
+
+  /**
+   * @brief  Copies the columns of a rectangle row by row, wordsPerColumn() words each
+   */
+  void copyColumnWords(
+    unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+    uint32_t * words) const
+  {
+    for (unsigned int j = 0; j < height; ++j) {
+      memcpy(
+        words + static_cast<std::size_t>(j) * width * wordsPerColumn(),
+        data_ + (y + j) * size_x_ + x, width * sizeof(Column));
+    }
+  }
 
   inline void markVoxel(unsigned int x, unsigned int y, unsigned int z)
   {
@@ -92,7 +178,7 @@ public:
       RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
       return;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
+    Column full_mask = zMask(z);
     data_[y * size_x_ + x] |= full_mask;  // clear unknown and mark cell
   }
 
@@ -106,11 +192,11 @@ public:
     }
 
     int index = y * size_x_ + x;
-    uint32_t * col = &data_[index];
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
+    Column * col = &data_[index];
+    Column full_mask = zMask(z);
     *col |= full_mask;  // clear unknown and mark cell
 
-    unsigned int marked_bits = *col >> 16;
+    Column marked_bits = *col >> MAX_SIZE_Z;
 
     // make sure the number of bits in each is below our thesholds
     return !bitsBelowThreshold(marked_bits, marked_threshold);
@@ -122,7 +208,7 @@ public:
       RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
       return;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
+    Column full_mask = zMask(z);
     data_[y * size_x_ + x] &= ~(full_mask);  // clear unknown and clear cell
   }
 
@@ -139,12 +225,12 @@ public:
       return;
     }
     int index = y * size_x_ + x;
-    uint32_t * col = &data_[index];
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
+    Column * col = &data_[index];
+    Column full_mask = zMask(z);
     *col &= ~(full_mask);  // clear unknown and clear cell
 
-    unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-    unsigned int marked_bits = *col >> 16;
+    Column unknown_bits = unknownBits(*col);
+    Column marked_bits = *col >> MAX_SIZE_Z;
 
     // make sure the number of bits in each is below our thesholds
     if (bitsBelowThreshold(unknown_bits, 1) && bitsBelowThreshold(marked_bits, 1)) {
@@ -152,37 +238,87 @@ public:
     }
   }
 
-  inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
+  static inline bool bitsBelowThreshold(Column n, unsigned int bit_threshold)
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ) {
-      ++bit_count;
-      if (bit_count > bit_threshold) {
-        return false;
-      }
-      n &= n - 1;  // clear the least significant bit set
+    return popcount(n) <= bit_threshold;
+  }
+
+  static inline unsigned int numBits(Column n)
+  {
+    return popcount(n);
+  }
+
+  /**
+   * @brief  Both bits of a z level, after a column was cleared there: 01 unknown, 11 marked
+   */
+  static inline Column zMask(unsigned int z)
+  {
+    return ((Column)1 << z << MAX_SIZE_Z) | ((Column)1 << z);
+  }
+
+  /**
+   * @brief  The z levels of a column that are unknown, one bit each
+   */
+  static inline Column unknownBits(Column col)
+  {
+    return (col ^ (col >> MAX_SIZE_Z)) & (~(Column)0 >> MAX_SIZE_Z);
+  }
+
+  /**
+   * @brief  The z levels of a column in a status, one bit each, FREE is not supported
+   */
+  static inline Column statusBits(Column col, VoxelStatus status)
+  {
+    if (status == MARKED) {
+      return col & (col >> MAX_SIZE_Z) & (~(Column)0 >> MAX_SIZE_Z);
+    }
+    return unknownBits(col);
+  }
+
+  /**
+   * @brief  Number of voxels of the grid that are MARKED or UNKNOWN
+   */
+  std::size_t countVoxels(VoxelStatus status) const
+  {
+    const Column levels = ((Column)1 << size_z_) - 1;
+    std::size_t count = 0;
+    for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
+      count += popcount(statusBits(data_[i], status) & levels);
     }
-    return true;
+    return count;
   }
 
-  static inline unsigned int numBits(unsigned int n)
+  /**
+   * @brief  Calls fn(x, y, z) for every voxel that is MARKED or UNKNOWN, column by column
+   *
+   * Only the set levels of a column are visited, so a scan costs one test per
+   * column plus one step per voxel found.
+   */
+  template<class Fn>
+  void forEachVoxel(VoxelStatus status, Fn fn) const
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ++bit_count) {
-      n &= n - 1;  // clear the least significant bit set
+    const Column levels = ((Column)1 << size_z_) - 1;
+    unsigned int index = 0;
+    for (unsigned int y = 0; y < size_y_; ++y) {
+      for (unsigned int x = 0; x < size_x_; ++x, ++index) {
+        Column bits = statusBits(data_[index], status) & levels;
+        while (bits) {
+          fn(x, y, lowestBit(bits));
+          bits &= bits - 1;
+        }
+      }
     }
-    return bit_count;
   }
 
   static VoxelStatus getVoxel(
     unsigned int x, unsigned int y, unsigned int z,
-    unsigned int size_x, unsigned int size_y, unsigned int size_z, const uint32_t * data)
+    unsigned int size_x, unsigned int size_y, unsigned int size_z, const Column * data)
   {
     if (x >= size_x || y >= size_y || z >= size_z) {
       return UNKNOWN;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    uint32_t result = data[y * size_x + x] & full_mask;
+    Column full_mask = zMask(z);
+    Column result = data[y * size_x + x] & full_mask;
     unsigned int bits = numBits(result);
 
     // known marked: 11 = 2 bits, unknown: 01 = 1 bit, known free: 00 = 0 bits
@@ -207,6 +343,20 @@ public:
     unsigned char free_cost = 0, unsigned char unknown_cost = 255,
     unsigned int max_length = UINT_MAX);
 
+  /**
+   * @brief  Clears the lines from one origin to many end points in the grid and in map_2d
+   *
+   * Produces the same grid and map as calling clearVoxelLineInMap() for every
+   * end point. Rays are traced together, several at a time in SIMD lanes where
+   * the CPU supports it, and the consecutive voxels a ray clears in the same
+   * column are applied as one bitmask.
+   */
+  void clearVoxelLinesInMap(
+    double x0, double y0, double z0, const std::vector<RayEnd> & ends, unsigned char * map_2d,
+    unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX);
+
   VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z);
 
   // Are there any obstacles at that (x, y) location in the grid?
@@ -237,7 +387,7 @@ public:
     int offset_dy = sign(dy) * size_x_;
     int offset_dz = sign(dz);
 
-    unsigned int z_mask = ((1 << 16) | 1) << (unsigned int)z0;
+    Column z_mask = zMask((unsigned int)z0);
     unsigned int offset = (unsigned int)y0 * size_x_ + (unsigned int)x0;
 
     GridOffset grid_off(offset);
@@ -286,7 +436,7 @@ private:
     ActionType at, OffA off_a, OffB off_b, OffC off_c,
     unsigned int abs_da, unsigned int abs_db, unsigned int abs_dc,
     int error_b, int error_c, int offset_a, int offset_b, int offset_c, unsigned int & offset,
-    unsigned int & z_mask, unsigned int max_length = UINT_MAX)
+    Column & z_mask, unsigned int max_length = UINT_MAX)
   {
     unsigned int end = std::min(max_length, abs_da);
     for (unsigned int i = 0; i < end; ++i) {
@@ -317,7 +467,7 @@ private:
   }
 
   unsigned int size_x_, size_y_, size_z_;
-  uint32_t * data_;
+  Column * data_;
   unsigned char * costmap;
   rclcpp::Logger logger;
 
@@ -326,36 +476,36 @@ private:
   class MarkVoxel
   {
 public:
-    explicit MarkVoxel(uint32_t * data)
+    explicit MarkVoxel(Column * data)
     : data_(data) {}
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, Column z_mask)
     {
       data_[offset] |= z_mask;  // clear unknown and mark cell
     }
 
 private:
-    uint32_t * data_;
+    Column * data_;
   };
 
   class ClearVoxel
   {
 public:
-    explicit ClearVoxel(uint32_t * data)
+    explicit ClearVoxel(Column * data)
     : data_(data) {}
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, Column z_mask)
     {
       data_[offset] &= ~(z_mask);  // clear unknown and clear cell
     }
 
 private:
-    uint32_t * data_;
+    Column * data_;
   };
 
   class ClearVoxelInMap
   {
 public:
     ClearVoxelInMap(
-      uint32_t * data, unsigned char * costmap,
+      Column * data, unsigned char * costmap,
       unsigned int unknown_clear_threshold, unsigned int marked_clear_threshold,
       unsigned char free_cost = 0, unsigned char unknown_cost = 255)
     : data_(data), costmap_(costmap),
@@ -365,13 +515,13 @@ public:
     {
     }
 
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, Column z_mask)
     {
-      uint32_t * col = &data_[offset];
+      Column * col = &data_[offset];
       *col &= ~(z_mask);  // clear unknown and clear cell
 
-      unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-      unsigned int marked_bits = *col >> 16;
+      Column unknown_bits = unknownBits(*col);
+      Column marked_bits = *col >> MAX_SIZE_Z;
 
       // make sure the number of bits in each is below our thesholds
       if (bitsBelowThreshold(marked_bits, marked_clear_threshold_)) {
@@ -384,20 +534,7 @@ public:
     }
 
 private:
-    inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
-    {
-      unsigned int bit_count;
-      for (bit_count = 0; n; ) {
-        ++bit_count;
-        if (bit_count > bit_threshold) {
-          return false;
-        }
-        n &= n - 1;  // clear the least significant bit set
-      }
-      return true;
-    }
-
-    uint32_t * data_;
+    Column * data_;
     unsigned char * costmap_;
     unsigned int unknown_clear_threshold_, marked_clear_threshold_;
     unsigned char free_cost_, unknown_cost_;
@@ -420,7 +557,7 @@ private:
   class ZOffset
   {
 public:
-    explicit ZOffset(unsigned int & z_mask)
+    explicit ZOffset(Column & z_mask)
     : z_mask_(z_mask) {}
     inline void operator()(int offset_val)
     {
@@ -428,10 +565,56 @@ public:
     }
 
 private:
-    unsigned int & z_mask_;
+    Column & z_mask_;
   };
 };
 
+template<class ColumnWord>
+constexpr unsigned int VoxelGridT<ColumnWord>::MAX_SIZE_Z;
+
+extern template class VoxelGridT<uint32_t>;
+extern template class VoxelGridT<uint64_t>;
+
+/// The original 16 level grid
+typedef VoxelGridT<uint32_t> VoxelGrid;
+/// A 32 level grid
+typedef VoxelGridT<uint64_t> VoxelGrid64;
+
+#ifdef __SIZEOF_INT128__
+extern template class VoxelGridT<uint128_t>;
+/// A 64 level grid
+typedef VoxelGridT<uint128_t> VoxelGrid128;
+#endif
+
+/**
+ * @brief  Status of a voxel in the data of a nav2_msgs VoxelGrid
+ *
+ * The message stores each column as words_per_column 32-bit words, least
+ * significant first, with the layout of the grid that published it.
+ */
+inline VoxelStatus getVoxelFromWords(
+  unsigned int x, unsigned int y, unsigned int z,
+  unsigned int size_x, unsigned int size_y, unsigned int size_z,
+  unsigned int words_per_column, const uint32_t * data)
+{
+  if (x >= size_x || y >= size_y || z >= size_z) {
+    return UNKNOWN;
+  }
+  const uint32_t * col = data + (y * size_x + x) * words_per_column;
+  const unsigned int marked_bit = words_per_column * 16 + z;
+  unsigned int bits = ((col[z / 32] >> (z % 32)) & 1) +
+    ((col[marked_bit / 32] >> (marked_bit % 32)) & 1);
+
+  // known marked: 11 = 2 bits, unknown: 01 = 1 bit, known free: 00 = 0 bits
+  if (bits < 2) {
+    if (bits < 1) {
+      return FREE;
+    }
+    return UNKNOWN;
+  }
+  return MARKED;
+}
+
 }  // namespace nav2_voxel_grid
 
 #endif  // NAV2_VOXEL_GRID__VOXEL_GRID_HPP_
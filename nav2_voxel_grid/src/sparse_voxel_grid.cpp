@@ -0,0 +1,402 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nav2_voxel_grid/sparse_voxel_grid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace nav2_voxel_grid
+{
+
+constexpr unsigned int SparseVoxelGrid::MAX_SIZE_Z;
+
+namespace
+{
+
+// Tile of an absolute cell, rounding down for the cells left of or below the first window
+inline int tileOf(int cell)
+{
+  return (cell - (cell & 7)) / 8;
+}
+
+}  // namespace
+
+SparseVoxelGrid::SparseVoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+: size_x_(0), size_y_(0), size_z_(0), logger(rclcpp::get_logger("sparse_voxel_grid"))
+{
+  resize(size_x, size_y, size_z);
+}
+
+void SparseVoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+{
+  if (size_z > MAX_SIZE_Z) {
+    RCLCPP_INFO(
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      MAX_SIZE_Z, size_z);
+    size_z = MAX_SIZE_Z;
+  }
+  size_x_ = size_x;
+  size_y_ = size_y;
+  size_z_ = size_z;
+  offset_x_ = 0;
+  offset_y_ = 0;
+  reset();
+}
+
+void SparseVoxelGrid::reset()
+{
+  tiles_.clear();
+  brick_count_ = 0;
+}
+
+std::size_t SparseVoxelGrid::getMemoryUsage() const
+{
+  // the nodes of the hash table hold the key, the tile and a next pointer
+  std::size_t bytes = tiles_.bucket_count() * sizeof(void *) +
+    tiles_.size() * (sizeof(uint64_t) + sizeof(Tile) + sizeof(void *)) +
+    brick_count_ * sizeof(Brick);
+  for (const auto & entry : tiles_) {
+    bytes += entry.second.bricks.capacity() * sizeof(std::unique_ptr<Brick>);
+  }
+  return bytes;
+}
+
+const SparseVoxelGrid::Tile * SparseVoxelGrid::findTile(int abs_x, int abs_y) const
+{
+  auto it = tiles_.find(tileKey(tileOf(abs_x), tileOf(abs_y)));
+  return it == tiles_.end() ? nullptr : &it->second;
+}
+
+SparseVoxelGrid::Tile & SparseVoxelGrid::getTile(int abs_x, int abs_y)
+{
+  const int tile_x = tileOf(abs_x);
+  const int tile_y = tileOf(abs_y);
+  auto inserted = tiles_.emplace(tileKey(tile_x, tile_y), Tile());
+  Tile & tile = inserted.first->second;
+  if (inserted.second) {
+    tile.x = tile_x;
+    tile.y = tile_y;
+    tile.bricks.resize((size_z_ + 7) / 8);
+  }
+  return tile;
+}
+
+SparseVoxelGrid::Brick & SparseVoxelGrid::getBrick(Tile & tile, unsigned int z)
+{
+  std::unique_ptr<Brick> & brick = tile.bricks[z / 8];
+  if (!brick) {
+    brick = std::make_unique<Brick>();
+    ++brick_count_;
+  }
+  return *brick;
+}
+
+void SparseVoxelGrid::setVoxel(Tile & tile, unsigned int column, unsigned int z, bool mark)
+{
+  Brick & brick = getBrick(tile, z);
+  const uint64_t bit = static_cast<uint64_t>(1) << column;
+  uint64_t & known = brick.known[z & 7];
+  uint64_t & marked = brick.marked[z & 7];
+  if (!(known & bit)) {
+    known |= bit;
+    ++tile.known[column];
+  }
+  if (mark && !(marked & bit)) {
+    marked |= bit;
+    ++tile.marked[column];
+  } else if (!mark && (marked & bit)) {
+    marked &= ~bit;
+    --tile.marked[column];
+  }
+}
+
+void SparseVoxelGrid::forgetColumn(Tile & tile, unsigned int column)
+{
+  const uint64_t bit = static_cast<uint64_t>(1) << column;
+  for (auto & brick : tile.bricks) {
+    if (brick) {
+      for (unsigned int layer = 0; layer < 8; ++layer) {
+        brick->known[layer] &= ~bit;
+        brick->marked[layer] &= ~bit;
+      }
+    }
+  }
+  tile.known[column] = 0;
+  tile.marked[column] = 0;
+}
+
+void SparseVoxelGrid::markVoxel(unsigned int x, unsigned int y, unsigned int z)
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+    return;
+  }
+  setVoxel(getTile(absX(x), absY(y)), columnBit(absX(x), absY(y)), z, true);
+}
+
+bool SparseVoxelGrid::markVoxelInMap(
+  unsigned int x, unsigned int y, unsigned int z, unsigned int marked_threshold)
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+    return false;
+  }
+  Tile & tile = getTile(absX(x), absY(y));
+  const unsigned int column = columnBit(absX(x), absY(y));
+  setVoxel(tile, column, z, true);
+  return tile.marked[column] > marked_threshold;
+}
+
+void SparseVoxelGrid::clearVoxel(unsigned int x, unsigned int y, unsigned int z)
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+    return;
+  }
+  setVoxel(getTile(absX(x), absY(y)), columnBit(absX(x), absY(y)), z, false);
+}
+
+void SparseVoxelGrid::clearVoxelColumn(unsigned int index)
+{
+  assert(index < size_x_ * size_y_);
+  const unsigned int x = index % size_x_;
+  const unsigned int y = index / size_x_;
+  Tile & tile = getTile(absX(x), absY(y));
+  const unsigned int column = columnBit(absX(x), absY(y));
+  for (unsigned int z = 0; z < size_z_; ++z) {
+    setVoxel(tile, column, z, false);
+  }
+}
+
+template<class Fn>
+void SparseVoxelGrid::traceLine(
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  unsigned int max_length, Fn fn) const
+{
+  int cell[3] = {int(x0), int(y0), int(z0)};  // NOLINT
+  const int delta[3] = {int(x1) - cell[0], int(y1) - cell[1], int(z1) - cell[2]};  // NOLINT
+  unsigned int abs_d[3];
+  int step[3];
+  for (int i = 0; i < 3; ++i) {
+    abs_d[i] = abs(delta[i]);
+    step[i] = delta[i] > 0 ? 1 : -1;
+  }
+
+  // the dominant axis a steps every time, b and c follow their error terms
+  const int a = abs_d[0] >= std::max(abs_d[1], abs_d[2]) ? 0 : (abs_d[1] >= abs_d[2] ? 1 : 2);
+  const int b = a == 0 ? 1 : 0;
+  const int c = a == 2 ? 1 : 2;
+  int error_b = abs_d[a] / 2;
+  int error_c = abs_d[a] / 2;
+
+  double dist = sqrt((x0 - x1) * (x0 - x1) + (y0 - y1) * (y0 - y1) + (z0 - z1) * (z0 - z1));
+  double scale = std::min(1.0, max_length / dist);
+  const unsigned int end = std::min(static_cast<unsigned int>(scale * abs_d[a]), abs_d[a]);
+
+  for (unsigned int i = 0; i < end; ++i) {
+    fn(cell[0], cell[1], cell[2]);
+    cell[a] += step[a];
+    error_b += abs_d[b];
+    error_c += abs_d[c];
+    if (static_cast<unsigned int>(error_b) >= abs_d[a]) {
+      cell[b] += step[b];
+      error_b -= abs_d[a];
+    }
+    if (static_cast<unsigned int>(error_c) >= abs_d[a]) {
+      cell[c] += step[c];
+      error_c -= abs_d[a];
+    }
+  }
+  fn(cell[0], cell[1], cell[2]);
+}
+
+void SparseVoxelGrid::clearVoxelLinesInMap(
+  double x0, double y0, double z0, const std::vector<RayEnd> & ends, unsigned char * map_2d,
+  unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
+  unsigned char unknown_cost, unsigned int max_length)
+{
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(
+      logger, "Error, line origin out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+      x0, y0, z0, size_x_, size_y_, size_z_);
+    return;
+  }
+
+  // consecutive voxels of a ray mostly share a tile
+  Tile * tile = nullptr;
+  int tile_x = 0, tile_y = 0;
+  auto clear = [&](int x, int y, int z) {
+      const int abs_x = x + offset_x_;
+      const int abs_y = y + offset_y_;
+      if (!tile || tileOf(abs_x) != tile_x || tileOf(abs_y) != tile_y) {
+        tile = &getTile(abs_x, abs_y);
+        tile_x = tile->x;
+        tile_y = tile->y;
+      }
+      const unsigned int column = columnBit(abs_x, abs_y);
+      setVoxel(*tile, column, z, false);
+
+      if (map_2d && tile->marked[column] <= mark_threshold) {
+        // the levels above size_z are unknown, as in VoxelGridT
+        const unsigned int unknown = MAX_SIZE_Z - tile->known[column];
+        map_2d[y * size_x_ + x] = unknown <= unknown_threshold ? free_cost : unknown_cost;
+      }
+    };
+
+  for (const RayEnd & end : ends) {
+    if (end.x >= size_x_ || end.y >= size_y_ || end.z >= size_z_) {
+      RCLCPP_DEBUG(
+        logger,
+        "Error, line endpoint out of bounds. "
+        "(%.2f, %.2f, %.2f) to (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+        x0, y0, z0, end.x, end.y, end.z, size_x_, size_y_, size_z_);
+      continue;
+    }
+    traceLine(x0, y0, z0, end.x, end.y, end.z, max_length, clear);
+  }
+}
+
+VoxelStatus SparseVoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z) const
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d, %d)\n", x, y, z);
+    return UNKNOWN;
+  }
+  const Tile * tile = findTile(absX(x), absY(y));
+  if (!tile || !tile->bricks[z / 8]) {
+    return UNKNOWN;
+  }
+  const uint64_t bit = static_cast<uint64_t>(1) << columnBit(absX(x), absY(y));
+  const Brick & brick = *tile->bricks[z / 8];
+  if (!(brick.known[z & 7] & bit)) {
+    return UNKNOWN;
+  }
+  return (brick.marked[z & 7] & bit) ? MARKED : FREE;
+}
+
+VoxelStatus SparseVoxelGrid::getVoxelColumn(
+  unsigned int x, unsigned int y,
+  unsigned int unknown_threshold, unsigned int marked_threshold) const
+{
+  if (x >= size_x_ || y >= size_y_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d)\n", x, y);
+    return UNKNOWN;
+  }
+  const Tile * tile = findTile(absX(x), absY(y));
+  const unsigned int column = columnBit(absX(x), absY(y));
+  const unsigned int marked = tile ? tile->marked[column] : 0;
+  const unsigned int known = tile ? tile->known[column] : 0;
+  if (marked > marked_threshold) {
+    return MARKED;
+  }
+  if (MAX_SIZE_Z - known > unknown_threshold) {
+    return UNKNOWN;
+  }
+  return FREE;
+}
+
+std::size_t SparseVoxelGrid::countVoxels(VoxelStatus status) const
+{
+  std::size_t marked = 0;
+  std::size_t known = 0;
+  for (const auto & entry : tiles_) {
+    for (unsigned int column = 0; column < 64; ++column) {
+      marked += entry.second.marked[column];
+      known += entry.second.known[column];
+    }
+  }
+  if (status == MARKED) {
+    return marked;
+  }
+  return static_cast<std::size_t>(size_x_) * size_y_ * size_z_ - known;
+}
+
+void SparseVoxelGrid::shift(int cell_ox, int cell_oy)
+{
+  offset_x_ += cell_ox;
+  offset_y_ += cell_oy;
+
+  // the window's first and one past its last absolute cells
+  const int x_begin = offset_x_, x_end = offset_x_ + static_cast<int>(size_x_);
+  const int y_begin = offset_y_, y_end = offset_y_ + static_cast<int>(size_y_);
+  for (auto it = tiles_.begin(); it != tiles_.end(); ) {
+    Tile & tile = it->second;
+    const int tile_x0 = tile.x * 8, tile_y0 = tile.y * 8;
+    const bool inside = tile_x0 >= x_begin && tile_x0 + 8 <= x_end &&
+      tile_y0 >= y_begin && tile_y0 + 8 <= y_end;
+    if (!inside) {
+      // the columns left behind must be unknown when the window comes back to them
+      bool empty = true;
+      for (unsigned int column = 0; column < 64; ++column) {
+        const int x = tile_x0 + static_cast<int>(column & 7);
+        const int y = tile_y0 + static_cast<int>(column >> 3);
+        if (x < x_begin || x >= x_end || y < y_begin || y >= y_end) {
+          forgetColumn(tile, column);
+        } else if (tile.known[column]) {
+          empty = false;
+        }
+      }
+      if (empty) {
+        for (const auto & brick : tile.bricks) {
+          brick_count_ -= brick ? 1 : 0;
+        }
+        it = tiles_.erase(it);
+        continue;
+      }
+    }
+    ++it;
+  }
+}
+
+unsigned int SparseVoxelGrid::wordsPerColumn() const
+{
+  return std::max<unsigned int>((size_z_ + 15) / 16, 1);
+}
+
+void SparseVoxelGrid::copyColumnWords(
+  unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+  uint32_t * words) const
+{
+  // VoxelGridT's layout: the low half holds a free/unknown bit per level, set
+  // unless the level is free, and the high half a marked bit per level
+  const unsigned int words_per_column = wordsPerColumn();
+  const unsigned int half = words_per_column * 16;
+  for (unsigned int j = 0; j < height; ++j) {
+    for (unsigned int i = 0; i < width; ++i) {
+      uint32_t * column = words + (static_cast<std::size_t>(j) * width + i) * words_per_column;
+      std::fill_n(column, words_per_column, 0);
+      const int abs_x = absX(x + i);
+      const int abs_y = absY(y + j);
+      const Tile * tile = findTile(abs_x, abs_y);
+      const uint64_t bit = static_cast<uint64_t>(1) << columnBit(abs_x, abs_y);
+      for (unsigned int z = 0; z < half; ++z) {
+        const Brick * brick = tile && z < size_z_ ? tile->bricks[z / 8].get() : nullptr;
+        const bool known = brick && (brick->known[z & 7] & bit);
+        const bool marked = brick && (brick->marked[z & 7] & bit);
+        if (!known || marked) {
+          column[z / 32] |= static_cast<uint32_t>(1) << (z % 32);
+        }
+        if (marked) {
+          column[(half + z) / 32] |= static_cast<uint32_t>(1) << ((half + z) % 32);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace nav2_voxel_grid
@@ -36,32 +36,160 @@
 *********************************************************************/
 #include <nav2_voxel_grid/voxel_grid.hpp>
 
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// AVX2 is compiled per function and only used when the CPU reports it
+#define NAV2_VOXEL_GRID_AVX2
+#include <immintrin.h>
+#endif
+
 namespace nav2_voxel_grid
 {
-VoxelGrid::VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+
+namespace
+{
+
+const int LANES = 8;
+
+// Bresenham state of the rays traced together, one ray per lane. Every axis
+// carries its own error term against the dominant length n, so rays with
+// different dominant axes share the same stepping code: the dominant axis,
+// with abs_d == n, simply steps every time.
+struct RayLanes
+{
+  alignas(32) int32_t offset[LANES];
+  alignas(32) int32_t z[LANES];
+  alignas(32) int32_t error_x[LANES];
+  alignas(32) int32_t error_y[LANES];
+  alignas(32) int32_t error_z[LANES];
+  alignas(32) int32_t abs_dx[LANES];
+  alignas(32) int32_t abs_dy[LANES];
+  alignas(32) int32_t abs_dz[LANES];
+  alignas(32) int32_t n[LANES];
+  alignas(32) int32_t step_x[LANES];
+  alignas(32) int32_t step_y[LANES];
+  alignas(32) int32_t step_z[LANES];
+  alignas(32) int32_t remaining[LANES];
+};
+
+typedef void (* StepKernel)(RayLanes &);
+
+void stepLanesScalar(RayLanes & lanes)
+{
+  for (int i = 0; i < LANES; ++i) {
+    lanes.error_x[i] += lanes.abs_dx[i];
+    if (lanes.error_x[i] >= lanes.n[i]) {
+      lanes.offset[i] += lanes.step_x[i];
+      lanes.error_x[i] -= lanes.n[i];
+    }
+    lanes.error_y[i] += lanes.abs_dy[i];
+    if (lanes.error_y[i] >= lanes.n[i]) {
+      lanes.offset[i] += lanes.step_y[i];
+      lanes.error_y[i] -= lanes.n[i];
+    }
+    lanes.error_z[i] += lanes.abs_dz[i];
+    if (lanes.error_z[i] >= lanes.n[i]) {
+      lanes.z[i] += lanes.step_z[i];
+      lanes.error_z[i] -= lanes.n[i];
+    }
+    --lanes.remaining[i];
+  }
+}
+
+#ifdef NAV2_VOXEL_GRID_AVX2
+
+__attribute__((target("avx2")))
+inline __m256i loadLanes(const int32_t * lanes)
+{
+  return _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes));
+}
+
+__attribute__((target("avx2")))
+inline void storeLanes(int32_t * lanes, __m256i v)
+{
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+}
+
+// Advances an error term, returns the mask of the lanes that step on its axis
+__attribute__((target("avx2")))
+inline __m256i advanceError(int32_t * error, const int32_t * abs_d, __m256i n, __m256i n_minus_1)
+{
+  __m256i e = _mm256_add_epi32(loadLanes(error), loadLanes(abs_d));
+  __m256i step = _mm256_cmpgt_epi32(e, n_minus_1);
+  storeLanes(error, _mm256_sub_epi32(e, _mm256_and_si256(step, n)));
+  return step;
+}
+
+__attribute__((target("avx2")))
+void stepLanesAVX2(RayLanes & lanes)
+{
+  const __m256i n = loadLanes(lanes.n);
+  const __m256i n_minus_1 = _mm256_sub_epi32(n, _mm256_set1_epi32(1));
+
+  __m256i offset = loadLanes(lanes.offset);
+  __m256i step = advanceError(lanes.error_x, lanes.abs_dx, n, n_minus_1);
+  offset = _mm256_add_epi32(offset, _mm256_and_si256(step, loadLanes(lanes.step_x)));
+  step = advanceError(lanes.error_y, lanes.abs_dy, n, n_minus_1);
+  offset = _mm256_add_epi32(offset, _mm256_and_si256(step, loadLanes(lanes.step_y)));
+  storeLanes(lanes.offset, offset);
+
+  step = advanceError(lanes.error_z, lanes.abs_dz, n, n_minus_1);
+  storeLanes(
+    lanes.z, _mm256_add_epi32(
+      loadLanes(lanes.z), _mm256_and_si256(step, loadLanes(lanes.step_z))));
+
+  storeLanes(
+    lanes.remaining, _mm256_sub_epi32(loadLanes(lanes.remaining), _mm256_set1_epi32(1)));
+}
+
+#endif  // NAV2_VOXEL_GRID_AVX2
+
+StepKernel selectStepKernel()
+{
+#ifdef NAV2_VOXEL_GRID_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return stepLanesAVX2;
+  }
+#endif
+  return stepLanesScalar;
+}
+
+// Selected on first use rather than during static initialization, which may run before
+// the CPU features are known in a shared library
+StepKernel stepKernel()
+{
+  static const StepKernel kernel = selectStepKernel();
+  return kernel;
+}
+
+}  // namespace
+template<class ColumnWord>
+VoxelGridT<ColumnWord>::VoxelGridT(unsigned int size_x, unsigned int size_y, unsigned int size_z)
 : logger(rclcpp::get_logger("voxel_grid"))
 {
   size_x_ = size_x;
   size_y_ = size_y;
   size_z_ = size_z;
 
-  if (size_z_ > 16) {
+  if (size_z_ > MAX_SIZE_Z) {
     RCLCPP_INFO(
-      logger, "Error, this implementation can only support up to 16 z values (%d)",
-      size_z_);
-    size_z_ = 16;
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      MAX_SIZE_Z, size_z_);
+    size_z_ = MAX_SIZE_Z;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  data_ = new Column[size_x_ * size_y_];
+  Column unknown_col = ~((Column)0) >> MAX_SIZE_Z;
+  Column * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
 {
   // if we're not actually changing the size, we can just reset things
   if (size_x == size_x_ && size_y == size_y_ && size_z == size_z_) {
@@ -74,38 +202,41 @@ void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int si
   size_y_ = size_y;
   size_z_ = size_z;
 
-  if (size_z_ > 16) {
+  if (size_z_ > MAX_SIZE_Z) {
     RCLCPP_INFO(
-      logger, "Error, this implementation can only support up to 16 z values (%d)",
-      size_z);
-    size_z_ = 16;
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      MAX_SIZE_Z, size_z);
+    size_z_ = MAX_SIZE_Z;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  data_ = new Column[size_x_ * size_y_];
+  Column unknown_col = ~((Column)0) >> MAX_SIZE_Z;
+  Column * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-VoxelGrid::~VoxelGrid()
+template<class ColumnWord>
+VoxelGridT<ColumnWord>::~VoxelGridT()
 {
   delete[] data_;
 }
 
-void VoxelGrid::reset()
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::reset()
 {
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  Column unknown_col = ~((Column)0) >> MAX_SIZE_Z;
+  Column * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-void VoxelGrid::markVoxelLine(
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::markVoxelLine(
   double x0, double y0, double z0, double x1, double y1, double z1,
   unsigned int max_length)
 {
@@ -124,7 +255,8 @@ void VoxelGrid::markVoxelLine(
   raytraceLine(mv, x0, y0, z0, x1, y1, z1, max_length);
 }
 
-void VoxelGrid::clearVoxelLine(
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::clearVoxelLine(
   double x0, double y0, double z0, double x1, double y1, double z1,
   unsigned int max_length)
 {
@@ -143,7 +275,8 @@ void VoxelGrid::clearVoxelLine(
   raytraceLine(cv, x0, y0, z0, x1, y1, z1, max_length);
 }
 
-void VoxelGrid::clearVoxelLineInMap(
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::clearVoxelLineInMap(
   double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
   unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
   unsigned char unknown_cost, unsigned int max_length)
@@ -169,14 +302,151 @@ void VoxelGrid::clearVoxelLineInMap(
   raytraceLine(cvm, x0, y0, z0, x1, y1, z1, max_length);
 }
 
-VoxelStatus VoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z)
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::clearVoxelLinesInMap(
+  double x0, double y0, double z0, const std::vector<RayEnd> & ends, unsigned char * map_2d,
+  unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
+  unsigned char unknown_cost, unsigned int max_length)
+{
+  if (map_2d == NULL) {
+    for (const RayEnd & end : ends) {
+      clearVoxelLine(x0, y0, z0, end.x, end.y, end.z, max_length);
+    }
+    return;
+  }
+  costmap = map_2d;
+
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(
+      logger, "Error, line origin out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+      x0, y0, z0, size_x_, size_y_, size_z_);
+    return;
+  }
+
+  ClearVoxelInMap cvm(data_, costmap, unknown_threshold, mark_threshold, free_cost, unknown_cost);
+
+  RayLanes lanes;
+  bool active[LANES];
+  // the column each lane is clearing, and the voxels of it cleared so far
+  int32_t pending_offset[LANES];
+  Column pending_mask[LANES];
+
+  const int32_t start_offset = static_cast<int32_t>(
+    (unsigned int)y0 * size_x_ + (unsigned int)x0);
+  const int32_t start_z = static_cast<int32_t>(z0);
+
+  // consecutive voxels in one column are cleared together, which gives the
+  // same column and, because clearing only ever frees it more, the same map
+  // cell as clearing them one after the other
+  auto apply = [&](int lane) {
+      const Column z_mask = zMask(lanes.z[lane]);
+      if (pending_mask[lane] && pending_offset[lane] == lanes.offset[lane]) {
+        pending_mask[lane] |= z_mask;
+        return;
+      }
+      if (pending_mask[lane]) {
+        cvm(pending_offset[lane], pending_mask[lane]);
+      }
+      pending_offset[lane] = lanes.offset[lane];
+      pending_mask[lane] = z_mask;
+    };
+
+  auto flush = [&](int lane) {
+      if (pending_mask[lane]) {
+        cvm(pending_offset[lane], pending_mask[lane]);
+        pending_mask[lane] = 0;
+      }
+    };
+
+  // loads the next ray with steps left into a lane, after clearing its first voxel
+  std::size_t next = 0;
+  auto load = [&](int lane) {
+      while (next < ends.size()) {
+        const RayEnd & end = ends[next++];
+        if (end.x >= size_x_ || end.y >= size_y_ || end.z >= size_z_) {
+          RCLCPP_DEBUG(
+            logger,
+            "Error, line endpoint out of bounds. "
+            "(%.2f, %.2f, %.2f) to (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+            x0, y0, z0, end.x, end.y, end.z, size_x_, size_y_, size_z_);
+          continue;
+        }
+
+        int dx = int(end.x) - int(x0);  // NOLINT
+        int dy = int(end.y) - int(y0);  // NOLINT
+        int dz = int(end.z) - int(z0);  // NOLINT
+        unsigned int abs_dx = abs(dx);
+        unsigned int abs_dy = abs(dy);
+        unsigned int abs_dz = abs(dz);
+        unsigned int n = max(abs_dx, max(abs_dy, abs_dz));
+
+        // same scaling of the dominant dimension as raytraceLine()
+        double dist = sqrt(
+          (x0 - end.x) * (x0 - end.x) + (y0 - end.y) * (y0 - end.y) +
+          (z0 - end.z) * (z0 - end.z));
+        double scale = std::min(1.0, max_length / dist);
+
+        lanes.offset[lane] = start_offset;
+        lanes.z[lane] = start_z;
+        lanes.error_x[lane] = lanes.error_y[lane] = lanes.error_z[lane] = n / 2;
+        lanes.abs_dx[lane] = abs_dx;
+        lanes.abs_dy[lane] = abs_dy;
+        lanes.abs_dz[lane] = abs_dz;
+        lanes.n[lane] = n;
+        lanes.step_x[lane] = sign(dx);
+        lanes.step_y[lane] = sign(dy) * static_cast<int32_t>(size_x_);
+        lanes.step_z[lane] = sign(dz);
+        lanes.remaining[lane] = std::min((unsigned int)(scale * n), n);
+
+        pending_mask[lane] = 0;
+        apply(lane);
+        if (lanes.remaining[lane] > 0) {
+          active[lane] = true;
+          return;
+        }
+        flush(lane);
+      }
+
+      // no rays left, park the lane where stepping leaves it untouched
+      active[lane] = false;
+      lanes.abs_dx[lane] = lanes.abs_dy[lane] = lanes.abs_dz[lane] = 0;
+      lanes.error_x[lane] = lanes.error_y[lane] = lanes.error_z[lane] = 0;
+      lanes.n[lane] = 1;
+      lanes.remaining[lane] = 0;
+    };
+
+  const StepKernel step_lanes = stepKernel();
+  int num_active = 0;
+  for (int lane = 0; lane < LANES; ++lane) {
+    load(lane);
+    num_active += active[lane];
+  }
+
+  while (num_active > 0) {
+    step_lanes(lanes);
+    for (int lane = 0; lane < LANES; ++lane) {
+      if (!active[lane]) {
+        continue;
+      }
+      apply(lane);
+      if (lanes.remaining[lane] == 0) {
+        flush(lane);
+        load(lane);
+        num_active -= !active[lane];
+      }
+    }
+  }
+}
+
+template<class ColumnWord>
+VoxelStatus VoxelGridT<ColumnWord>::getVoxel(unsigned int x, unsigned int y, unsigned int z)
 {
   if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
     RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d, %d)\n", x, y, z);
     return UNKNOWN;
   }
-  uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-  uint32_t result = data_[y * size_x_ + x] & full_mask;
+  Column full_mask = zMask(z);
+  Column result = data_[y * size_x_ + x] & full_mask;
   unsigned int bits = numBits(result);
 
   // known marked: 11 = 2 bits, unknown: 01 = 1 bit, known free: 00 = 0 bits
@@ -191,7 +461,8 @@ VoxelStatus VoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z)
   return MARKED;
 }
 
-VoxelStatus VoxelGrid::getVoxelColumn(
+template<class ColumnWord>
+VoxelStatus VoxelGridT<ColumnWord>::getVoxelColumn(
   unsigned int x, unsigned int y,
   unsigned int unknown_threshold, unsigned int marked_threshold)
 {
@@ -200,10 +471,10 @@ VoxelStatus VoxelGrid::getVoxelColumn(
     return UNKNOWN;
   }
 
-  uint32_t * col = &data_[y * size_x_ + x];
+  Column * col = &data_[y * size_x_ + x];
 
-  unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-  unsigned int marked_bits = *col >> 16;
+  Column unknown_bits = unknownBits(*col);
+  Column marked_bits = *col >> MAX_SIZE_Z;
 
   // check if the number of marked bits qualifies the col as marked
   if (!bitsBelowThreshold(marked_bits, marked_threshold)) {
@@ -218,22 +489,26 @@ VoxelStatus VoxelGrid::getVoxelColumn(
   return FREE;
 }
 
-unsigned int VoxelGrid::sizeX()
+template<class ColumnWord>
+unsigned int VoxelGridT<ColumnWord>::sizeX()
 {
   return size_x_;
 }
 
-unsigned int VoxelGrid::sizeY()
+template<class ColumnWord>
+unsigned int VoxelGridT<ColumnWord>::sizeY()
 {
   return size_y_;
 }
 
-unsigned int VoxelGrid::sizeZ()
+template<class ColumnWord>
+unsigned int VoxelGridT<ColumnWord>::sizeZ()
 {
   return size_z_;
 }
 
-void VoxelGrid::printVoxelGrid()
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::printVoxelGrid()
 {
   for (unsigned int z = 0; z < size_z_; z++) {
     printf("Layer z = %u:\n", z);
@@ -246,14 +521,22 @@ void VoxelGrid::printVoxelGrid()
   }
 }
 
-void VoxelGrid::printColumnGrid()
+template<class ColumnWord>
+void VoxelGridT<ColumnWord>::printColumnGrid()
 {
   printf("Column view:\n");
   for (unsigned int y = 0; y < size_y_; y++) {
     for (unsigned int x = 0; x < size_x_; x++) {
-      printf((getVoxelColumn(x, y, 16, 0) == nav2_voxel_grid::MARKED) ? "#" : " ");
+      printf((getVoxelColumn(x, y, MAX_SIZE_Z, 0) == nav2_voxel_grid::MARKED) ? "#" : " ");
     }
     printf("|\n");
   }
 }
+
+template class VoxelGridT<uint32_t>;
+template class VoxelGridT<uint64_t>;
+#ifdef __SIZEOF_INT128__
+template class VoxelGridT<uint128_t>;
+#endif
+
 }  // namespace nav2_voxel_grid
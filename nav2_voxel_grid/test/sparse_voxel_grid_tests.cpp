@@ -0,0 +1,138 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <nav2_voxel_grid/sparse_voxel_grid.hpp>
+#include <nav2_voxel_grid/voxel_grid.hpp>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const unsigned int SIZE_X = 37, SIZE_Y = 29, SIZE_Z = 10;
+
+// Random rays from a few origins, and random obstacles
+void fill(
+  std::vector<nav2_voxel_grid::RayEnd> & ends,
+  std::vector<std::array<unsigned int, 3>> & marks, unsigned int seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> x(0.0, SIZE_X - 0.01);
+  std::uniform_real_distribution<double> y(0.0, SIZE_Y - 0.01);
+  std::uniform_real_distribution<double> z(0.0, SIZE_Z - 0.01);
+  for (int i = 0; i < 300; ++i) {
+    ends.push_back({x(gen), y(gen), z(gen)});
+  }
+  for (int i = 0; i < 100; ++i) {
+    marks.push_back(
+      {{static_cast<unsigned int>(x(gen)), static_cast<unsigned int>(y(gen)),
+        static_cast<unsigned int>(z(gen))}});
+  }
+}
+
+}  // namespace
+
+TEST(sparse_voxel_grid, matchesDenseGrid)
+{
+  nav2_voxel_grid::VoxelGrid dense(SIZE_X, SIZE_Y, SIZE_Z);
+  nav2_voxel_grid::SparseVoxelGrid sparse(SIZE_X, SIZE_Y, SIZE_Z);
+  std::vector<unsigned char> dense_map(SIZE_X * SIZE_Y, 255), sparse_map(SIZE_X * SIZE_Y, 255);
+
+  // the levels above SIZE_Z are unknown in both, there are more of them in the sparse grid
+  const unsigned int unknown_threshold = 3;
+  const unsigned int sparse_unknown_threshold =
+    unknown_threshold + nav2_voxel_grid::SparseVoxelGrid::MAX_SIZE_Z -
+    nav2_voxel_grid::VoxelGrid::MAX_SIZE_Z;
+
+  for (unsigned int seed = 0; seed < 3; ++seed) {
+    std::vector<nav2_voxel_grid::RayEnd> ends;
+    std::vector<std::array<unsigned int, 3>> marks;
+    fill(ends, marks, seed);
+    for (const auto & mark : marks) {
+      EXPECT_EQ(
+        dense.markVoxelInMap(mark[0], mark[1], mark[2], 1),
+        sparse.markVoxelInMap(mark[0], mark[1], mark[2], 1));
+    }
+    const double x0 = 3.5 + seed * 10.0, y0 = 14.2, z0 = 4.5;
+    dense.clearVoxelLinesInMap(x0, y0, z0, ends, dense_map.data(), unknown_threshold, 0, 0, 255, 20);
+    sparse.clearVoxelLinesInMap(
+      x0, y0, z0, ends, sparse_map.data(), sparse_unknown_threshold, 0, 0, 255, 20);
+  }
+
+  EXPECT_EQ(dense_map, sparse_map);
+  for (unsigned int y = 0; y < SIZE_Y; ++y) {
+    for (unsigned int x = 0; x < SIZE_X; ++x) {
+      for (unsigned int z = 0; z < SIZE_Z; ++z) {
+        ASSERT_EQ(dense.getVoxel(x, y, z), sparse.getVoxel(x, y, z)) << x << " " << y << " " << z;
+      }
+      EXPECT_EQ(
+        dense.getVoxelColumn(x, y, unknown_threshold, 1),
+        sparse.getVoxelColumn(x, y, sparse_unknown_threshold, 1));
+    }
+  }
+  EXPECT_EQ(dense.countVoxels(nav2_voxel_grid::MARKED), sparse.countVoxels(nav2_voxel_grid::MARKED));
+  EXPECT_EQ(
+    dense.countVoxels(nav2_voxel_grid::UNKNOWN), sparse.countVoxels(nav2_voxel_grid::UNKNOWN));
+
+  std::size_t visited = 0;
+  sparse.forEachVoxel(
+    nav2_voxel_grid::MARKED, [&](unsigned int x, unsigned int y, unsigned int z) {
+      EXPECT_EQ(dense.getVoxel(x, y, z), nav2_voxel_grid::MARKED);
+      ++visited;
+    });
+  EXPECT_EQ(visited, sparse.countVoxels(nav2_voxel_grid::MARKED));
+
+  // published with the layout of the dense grid
+  std::vector<uint32_t> dense_words(SIZE_X * SIZE_Y), sparse_words(SIZE_X * SIZE_Y);
+  ASSERT_EQ(sparse.wordsPerColumn(), 1u);
+  dense.copyColumnWords(0, 0, SIZE_X, SIZE_Y, dense_words.data());
+  sparse.copyColumnWords(0, 0, SIZE_X, SIZE_Y, sparse_words.data());
+  EXPECT_EQ(dense_words, sparse_words);
+}
+
+TEST(sparse_voxel_grid, shiftsWithTheWindow)
+{
+  nav2_voxel_grid::SparseVoxelGrid grid(20, 20, 100);
+  grid.markVoxel(2, 3, 90);
+  grid.markVoxel(15, 15, 5);
+  grid.clearVoxel(15, 16, 5);
+
+  // moving the window 10 cells along x and back leaves the columns left behind unknown
+  grid.shift(10, 0);
+  EXPECT_EQ(grid.getVoxel(5, 15, 5), nav2_voxel_grid::MARKED);
+  EXPECT_EQ(grid.getVoxel(5, 16, 5), nav2_voxel_grid::FREE);
+  EXPECT_EQ(grid.countVoxels(nav2_voxel_grid::MARKED), 1u);
+  grid.shift(-10, 0);
+  EXPECT_EQ(grid.getVoxel(2, 3, 90), nav2_voxel_grid::UNKNOWN);
+  EXPECT_EQ(grid.getVoxel(15, 15, 5), nav2_voxel_grid::MARKED);
+}
+
+TEST(sparse_voxel_grid, memoryFollowsObservedVoxels)
+{
+  // a 10 m tall window at 5 cm, with a wall observed in it
+  nav2_voxel_grid::SparseVoxelGrid grid(400, 400, 200);
+  const std::size_t empty = grid.getMemoryUsage();
+  for (unsigned int x = 100; x < 300; ++x) {
+    for (unsigned int z = 0; z < 200; ++z) {
+      grid.markVoxel(x, 200, z);
+    }
+  }
+  EXPECT_EQ(grid.countVoxels(nav2_voxel_grid::MARKED), 200u * 200u);
+  // far below the 2 bits per voxel of a dense grid
+  EXPECT_LT(grid.getMemoryUsage() - empty, 400u * 400u * 200u / 4 / 10);
+}
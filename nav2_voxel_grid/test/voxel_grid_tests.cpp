@@ -37,6 +37,9 @@
 #include <nav2_voxel_grid/voxel_grid.hpp>
 #include <gtest/gtest.h>
 
+#include <random>
+#include <vector>
+
 TEST(voxel_grid, basicMarkingAndClearing) {
   int size_x = 50, size_y = 10, size_z = 16;
   nav2_voxel_grid::VoxelGrid vg(size_x, size_y, size_z);
@@ -187,6 +190,150 @@ TEST(voxel_grid, GetVoxelData) {
   delete[] data;
 }
 
+template<class Grid>
+void expectBatchedClearingMatchesSingleLines()
+{
+  int size_x = 60, size_y = 50, size_z = Grid::MAX_SIZE_Z;
+  Grid single(size_x, size_y, size_z);
+  Grid batched(size_x, size_y, size_z);
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> rand_x(0.0, size_x - 0.01);
+  std::uniform_real_distribution<double> rand_y(0.0, size_y - 0.01);
+  std::uniform_real_distribution<double> rand_z(0.0, size_z - 0.01);
+  for (int i = 0; i < 500; ++i) {
+    unsigned int x = rand_x(rng), y = rand_y(rng), z = rand_z(rng);
+    single.markVoxelInMap(x, y, z, 0);
+    batched.markVoxelInMap(x, y, z, 0);
+  }
+
+  // rays along every dominant axis, including a few degenerate and out of bounds ones
+  double oz = size_z / 2 + 0.5;
+  std::vector<nav2_voxel_grid::RayEnd> ends;
+  for (int i = 0; i < 300; ++i) {
+    ends.push_back({rand_x(rng), rand_y(rng), rand_z(rng)});
+  }
+  ends.push_back({30.5, 25.5, size_z - 0.5});
+  ends.push_back({30.5, 25.5, 0.5});
+  ends.push_back({30.2, 25.2, oz - 0.3});
+  ends.push_back({70.0, 25.0, oz});
+
+  for (unsigned int max_length : {UINT_MAX, 10u}) {
+    std::vector<unsigned char> single_map(size_x * size_y, 254);
+    std::vector<unsigned char> batched_map(size_x * size_y, 254);
+    for (const auto & end : ends) {
+      single.clearVoxelLineInMap(
+        30.5, 25.5, oz, end.x, end.y, end.z, single_map.data(), 2, 0, 0, 255, max_length);
+    }
+    batched.clearVoxelLinesInMap(
+      30.5, 25.5, oz, ends, batched_map.data(), 2, 0, 0, 255, max_length);
+
+    EXPECT_EQ(single_map, batched_map);
+    for (int i = 0; i < size_x * size_y; ++i) {
+      ASSERT_TRUE(single.getData()[i] == batched.getData()[i]) << "column " << i;
+    }
+  }
+}
+
+TEST(voxel_grid, clearVoxelLinesInMapMatchesSingleLines) {
+  expectBatchedClearingMatchesSingleLines<nav2_voxel_grid::VoxelGrid>();
+  expectBatchedClearingMatchesSingleLines<nav2_voxel_grid::VoxelGrid64>();
+#ifdef __SIZEOF_INT128__
+  expectBatchedClearingMatchesSingleLines<nav2_voxel_grid::VoxelGrid128>();
+#endif
+}
+
+template<class Grid>
+void expectTallColumns()
+{
+  unsigned int size_z = Grid::MAX_SIZE_Z;
+  Grid vg(5, 5, size_z + 1);
+  ASSERT_EQ(vg.sizeZ(), size_z);
+
+  // every level of a new column is unknown
+  EXPECT_EQ(vg.getVoxelColumn(2, 2, size_z - 1, 0), nav2_voxel_grid::UNKNOWN);
+  EXPECT_EQ(vg.getVoxelColumn(2, 2, size_z, 0), nav2_voxel_grid::FREE);
+
+  vg.markVoxel(2, 2, size_z - 1);
+  EXPECT_EQ(vg.getVoxel(2, 2, size_z - 1), nav2_voxel_grid::MARKED);
+  EXPECT_EQ(vg.getVoxel(2, 2, size_z - 2), nav2_voxel_grid::UNKNOWN);
+  EXPECT_EQ(vg.getVoxelColumn(2, 2, size_z, 0), nav2_voxel_grid::MARKED);
+
+  vg.clearVoxelLine(2, 2, 0, 2, 2, size_z - 1);
+  for (unsigned int z = 0; z < size_z; ++z) {
+    EXPECT_EQ(vg.getVoxel(2, 2, z), nav2_voxel_grid::FREE);
+  }
+
+  // a message carries the column as 32-bit words, least significant first
+  vg.markVoxel(1, 3, size_z - 1);
+  std::vector<uint32_t> words(25 * sizeof(typename Grid::Column) / 4);
+  memcpy(words.data(), vg.getData(), words.size() * 4);
+  const unsigned int words_per_column = sizeof(typename Grid::Column) / 4;
+  for (unsigned int z = 0; z < size_z; ++z) {
+    EXPECT_EQ(
+      nav2_voxel_grid::getVoxelFromWords(1, 3, z, 5, 5, size_z, words_per_column, words.data()),
+      vg.getVoxel(1, 3, z));
+    EXPECT_EQ(
+      nav2_voxel_grid::getVoxelFromWords(2, 2, z, 5, 5, size_z, words_per_column, words.data()),
+      nav2_voxel_grid::FREE);
+  }
+}
+
+TEST(voxel_grid, tallColumns) {
+  expectTallColumns<nav2_voxel_grid::VoxelGrid>();
+  expectTallColumns<nav2_voxel_grid::VoxelGrid64>();
+#ifdef __SIZEOF_INT128__
+  expectTallColumns<nav2_voxel_grid::VoxelGrid128>();
+#endif
+}
+
+template<class Grid>
+void expectForEachVoxelMatchesGetVoxel()
+{
+  const unsigned int size_z = Grid::MAX_SIZE_Z - 1;
+  Grid vg(7, 5, size_z);
+  vg.markVoxel(0, 0, 0);
+  vg.markVoxel(6, 4, size_z - 1);
+  vg.markVoxel(3, 2, size_z / 2);
+  vg.clearVoxel(3, 2, 1);
+  vg.clearVoxel(6, 4, 0);
+
+  for (auto status : {nav2_voxel_grid::MARKED, nav2_voxel_grid::UNKNOWN}) {
+    std::vector<bool> visited(7 * 5 * size_z, false);
+    std::size_t visits = 0;
+    vg.forEachVoxel(
+      status, [&](unsigned int x, unsigned int y, unsigned int z) {
+        ASSERT_LT(z, size_z);
+        EXPECT_EQ(vg.getVoxel(x, y, z), status);
+        visited[(y * 7 + x) * size_z + z] = true;
+        ++visits;
+      });
+    EXPECT_EQ(visits, vg.countVoxels(status));
+
+    std::size_t expected = 0;
+    for (unsigned int y = 0; y < 5; ++y) {
+      for (unsigned int x = 0; x < 7; ++x) {
+        for (unsigned int z = 0; z < size_z; ++z) {
+          if (vg.getVoxel(x, y, z) == status) {
+            EXPECT_TRUE(visited[(y * 7 + x) * size_z + z]);
+            ++expected;
+          }
+        }
+      }
+    }
+    EXPECT_EQ(visits, expected);
+  }
+  EXPECT_EQ(vg.countVoxels(nav2_voxel_grid::MARKED), 3u);
+}
+
+TEST(voxel_grid, forEachVoxel) {
+  expectForEachVoxelMatchesGetVoxel<nav2_voxel_grid::VoxelGrid>();
+  expectForEachVoxelMatchesGetVoxel<nav2_voxel_grid::VoxelGrid64>();
+#ifdef __SIZEOF_INT128__
+  expectForEachVoxelMatchesGetVoxel<nav2_voxel_grid::VoxelGrid128>();
+#endif
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_WAYPOINT_FOLLOWER__ROUTE_OPTIMIZER_HPP_
+#define NAV2_WAYPOINT_FOLLOWER__ROUTE_OPTIMIZER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_waypoint_follower
+{
+
+/**
+ * @class nav2_waypoint_follower::RouteOptimizer
+ * @brief Orders a set of locations to visit so that the route from a start location is short.
+ * Routes are built nearest neighbour first and improved with 2-opt and Or-opt moves until neither
+ * finds an improvement. Several randomized starts are searched in parallel and the best is kept.
+ */
+class RouteOptimizer
+{
+public:
+  using CostMatrix = std::vector<std::vector<double>>;
+
+  /**
+   * @brief A constructor for nav2_waypoint_follower::RouteOptimizer
+   * @param num_starts Number of routes to build and improve, the first one is the plain
+   * nearest neighbour route
+   * @param num_threads Threads to search with, 0 uses every planning worker of the
+   * shared nav2_util::TaskScheduler
+   */
+  explicit RouteOptimizer(std::size_t num_starts = 16, unsigned int num_threads = 0);
+
+  /**
+   * @brief Find a short open route through every location
+   * @param costs costs[i][j] is the cost of going from location i to location j, location 0 is
+   * where the route starts. Costs need not be symmetric
+   * @return The locations in visiting order, starting with 0
+   */
+  std::vector<std::size_t> solve(const CostMatrix & costs);
+
+  /**
+   * @brief Total cost of an open route
+   */
+  static double routeCost(const CostMatrix & costs, const std::vector<std::size_t> & route);
+
+protected:
+  std::vector<std::size_t> buildRoute(const CostMatrix & costs, std::size_t seed) const;
+  void improveRoute(const CostMatrix & costs, std::vector<std::size_t> & route) const;
+  bool twoOpt(const CostMatrix & costs, std::vector<std::size_t> & route) const;
+  bool orOpt(const CostMatrix & costs, std::vector<std::size_t> & route) const;
+
+  std::size_t num_starts_;
+  std::unique_ptr<nav2_util::ThreadPool> thread_pool_;
+};
+
+}  // namespace nav2_waypoint_follower
+
+#endif  // NAV2_WAYPOINT_FOLLOWER__ROUTE_OPTIMIZER_HPP_
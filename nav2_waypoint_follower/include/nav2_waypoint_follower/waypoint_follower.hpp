@@ -22,6 +22,10 @@
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
 #include "nav2_msgs/action/follow_waypoints.hpp"
+#include "nav2_msgs/action/follow_optimized_waypoints.hpp"
+#include "nav2_msgs/action/compute_paths_to_poses.hpp"
+#include "nav2_waypoint_follower/route_optimizer.hpp"
+#include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
@@ -49,11 +53,15 @@ public:
   using ClientT = nav2_msgs::action::NavigateToPose;
   using ActionServer = nav2_util::SimpleActionServer<ActionT>;
   using ActionClient = rclcpp_action::Client<ClientT>;
+  using OptimizedActionT = nav2_msgs::action::FollowOptimizedWaypoints;
+  using OptimizedActionServer = nav2_util::SimpleActionServer<OptimizedActionT>;
+  using PathsActionT = nav2_msgs::action::ComputePathsToPoses;
 
   /**
    * @brief A constructor for nav2_waypoint_follower::WaypointFollower class
+   * @param options Additional options to control creation of the node.
    */
-  WaypointFollower();
+  explicit WaypointFollower(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_waypoint_follower::WaypointFollower class
    */
@@ -98,18 +106,50 @@ protected:
    */
   void followWaypoints();
 
+  /**
+   * @brief FollowOptimizedWaypoints action server callback, orders the waypoints into a short
+   * route and follows it through the FollowWaypoints action
+   */
+  void followOptimizedWaypoints();
+
+  /**
+   * @brief Plan from the robot and from every waypoint to every waypoint
+   * @param goal FollowOptimizedWaypoints goal
+   * @param costs Path lengths, location 0 is the robot and location i waypoint i - 1
+   * @return false if canceled or preempted, or if the planner wasn't available
+   */
+  bool computeRouteCosts(
+    const std::shared_ptr<const OptimizedActionT::Goal> & goal,
+    RouteOptimizer::CostMatrix & costs);
+
   /**
    * @brief Action client result callback
    * @param result Result of action server updated asynchronously
+   * @param sequence Number of the navigation goal the result is for
    */
-  void resultCallback(const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result);
+  void resultCallback(
+    const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result,
+    uint32_t sequence);
 
   /**
    * @brief Action client goal response callback
    * @param future Shared future to goalhandle
+   * @param sequence Number of the navigation goal the response is for
    */
   void goalResponseCallback(
-    std::shared_future<rclcpp_action::ClientGoalHandle<ClientT>::SharedPtr> future);
+    std::shared_future<rclcpp_action::ClientGoalHandle<ClientT>::SharedPtr> future,
+    uint32_t sequence);
+
+  /**
+   * @brief Action client feedback callback, tracks the distance to the current waypoint
+   * @param feedback Feedback of the navigation goal
+   * @param waypoint Waypoint the goal is navigating to
+   * @param sequence Number of the navigation goal the feedback is for
+   */
+  void feedbackCallback(
+    const std::shared_ptr<const ClientT::Feedback> feedback,
+    const geometry_msgs::msg::PoseStamped & waypoint,
+    uint32_t sequence);
 
   // Our action server
   std::unique_ptr<ActionServer> action_server_;
@@ -120,6 +160,20 @@ protected:
   ActionStatus current_goal_status_;
   int loop_rate_;
   std::vector<int> failed_ids_;
+
+  // Distance from a waypoint at which to move on to the next one without stopping, 0 disables it
+  double blend_radius_;
+  double waypoint_distance_;
+
+  // Results of goals that have been superseded by the next waypoint are ignored
+  uint32_t goal_sequence_{0};
+
+  // Route optimization, with its own client node as it's spun from another action's thread
+  std::unique_ptr<OptimizedActionServer> optimized_action_server_;
+  rclcpp::Node::SharedPtr route_client_node_;
+  rclcpp_action::Client<PathsActionT>::SharedPtr paths_client_;
+  rclcpp_action::Client<ActionT>::SharedPtr follow_client_;
+  std::unique_ptr<RouteOptimizer> route_optimizer_;
 };
 
 }  // namespace nav2_waypoint_follower
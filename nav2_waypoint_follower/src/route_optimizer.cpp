@@ -0,0 +1,189 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_waypoint_follower/route_optimizer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace nav2_waypoint_follower
+{
+
+RouteOptimizer::RouteOptimizer(std::size_t num_starts, unsigned int num_threads)
+: num_starts_(std::max<std::size_t>(num_starts, 1)),
+  thread_pool_(std::make_unique<nav2_util::ThreadPool>(
+      nav2_util::TaskPriority::PLANNING, num_threads))
+{
+}
+
+std::vector<std::size_t>
+RouteOptimizer::solve(const CostMatrix & costs)
+{
+  std::vector<std::size_t> route(costs.size());
+  std::iota(route.begin(), route.end(), 0);
+  if (costs.size() <= 2) {
+    return route;
+  }
+
+  std::vector<std::vector<std::size_t>> routes(num_starts_);
+  thread_pool_->parallelFor(
+    num_starts_, [&](std::size_t start) {
+      routes[start] = buildRoute(costs, start);
+      improveRoute(costs, routes[start]);
+    });
+
+  // Ties go to the lowest start, so the result doesn't depend on the thread timing
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (auto & candidate : routes) {
+    const double cost = routeCost(costs, candidate);
+    if (cost < best_cost) {
+      best_cost = cost;
+      route = std::move(candidate);
+    }
+  }
+  return route;
+}
+
+double
+RouteOptimizer::routeCost(const CostMatrix & costs, const std::vector<std::size_t> & route)
+{
+  double cost = 0.0;
+  for (std::size_t i = 1; i < route.size(); ++i) {
+    cost += costs[route[i - 1]][route[i]];
+  }
+  return cost;
+}
+
+std::vector<std::size_t>
+RouteOptimizer::buildRoute(const CostMatrix & costs, std::size_t seed) const
+{
+  // The first route is plain nearest neighbour, the others pick randomly among the few nearest
+  const std::size_t choices = seed == 0 ? 1 : 3;
+  std::mt19937 random(static_cast<std::mt19937::result_type>(seed));
+
+  const std::size_t n = costs.size();
+  std::vector<std::size_t> route{0};
+  std::vector<bool> visited(n, false);
+  visited[0] = true;
+  std::vector<std::pair<double, std::size_t>> nearest;
+
+  while (route.size() < n) {
+    nearest.clear();
+    const auto & row = costs[route.back()];
+    for (std::size_t j = 0; j < n; ++j) {
+      if (!visited[j]) {
+        nearest.emplace_back(row[j], j);
+      }
+    }
+    const std::size_t count = std::min(choices, nearest.size());
+    std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+    const std::size_t next =
+      nearest[std::uniform_int_distribution<std::size_t>(0, count - 1)(random)].second;
+    visited[next] = true;
+    route.push_back(next);
+  }
+  return route;
+}
+
+void
+RouteOptimizer::improveRoute(const CostMatrix & costs, std::vector<std::size_t> & route) const
+{
+  // Each move strictly shortens the route, the bound only guards against rounding
+  const std::size_t max_moves = 100 * route.size() * route.size();
+  for (std::size_t moves = 0; moves < max_moves; ++moves) {
+    if (!twoOpt(costs, route) && !orOpt(costs, route)) {
+      return;
+    }
+  }
+}
+
+bool
+RouteOptimizer::twoOpt(const CostMatrix & costs, std::vector<std::size_t> & route) const
+{
+  const std::size_t n = route.size();
+
+  // Costs along the route forwards and backwards, so reversing any section is scored in O(1)
+  std::vector<double> forward(n, 0.0), backward(n, 0.0);
+  for (std::size_t t = 1; t < n; ++t) {
+    forward[t] = forward[t - 1] + costs[route[t - 1]][route[t]];
+    backward[t] = backward[t - 1] + costs[route[t]][route[t - 1]];
+  }
+  const double epsilon = 1e-9 * (1.0 + forward[n - 1] + backward[n - 1]);
+
+  for (std::size_t i = 1; i + 1 < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j) {
+      double before = costs[route[i - 1]][route[i]] + forward[j] - forward[i];
+      double after = costs[route[i - 1]][route[j]] + backward[j] - backward[i];
+      if (j + 1 < n) {
+        before += costs[route[j]][route[j + 1]];
+        after += costs[route[i]][route[j + 1]];
+      }
+      if (after < before - epsilon) {
+        std::reverse(route.begin() + i, route.begin() + j + 1);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool
+RouteOptimizer::orOpt(const CostMatrix & costs, std::vector<std::size_t> & route) const
+{
+  const std::size_t n = route.size();
+  const double epsilon = 1e-9 * (1.0 + routeCost(costs, route));
+
+  // Move a section of up to three locations to somewhere else along the route
+  for (std::size_t length = 1; length <= 3; ++length) {
+    for (std::size_t i = 1; i + length <= n; ++i) {
+      const std::size_t first = route[i];
+      const std::size_t last = route[i + length - 1];
+      const std::size_t prev = route[i - 1];
+
+      double removed = costs[prev][first];
+      if (i + length < n) {
+        const std::size_t next = route[i + length];
+        removed += costs[last][next] - costs[prev][next];
+      }
+
+      for (std::size_t k = 0; k < n; ++k) {
+        if (k + 1 >= i && k < i + length) {
+          continue;
+        }
+        const std::size_t a = route[k];
+        double added = costs[a][first];
+        if (k + 1 < n) {
+          const std::size_t b = route[k + 1];
+          added += costs[last][b] - costs[a][b];
+        }
+        if (added < removed - epsilon) {
+          if (k < i) {
+            std::rotate(route.begin() + k + 1, route.begin() + i, route.begin() + i + length);
+          } else {
+            std::rotate(route.begin() + i, route.begin() + i + length, route.begin() + k + 1);
+          }
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace nav2_waypoint_follower
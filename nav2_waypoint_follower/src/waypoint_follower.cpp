@@ -14,7 +14,11 @@
 
 #include "nav2_waypoint_follower/waypoint_follower.hpp"
 
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <future>
+#include <limits>
 #include <memory>
 #include <streambuf>
 #include <string>
@@ -24,13 +28,16 @@
 namespace nav2_waypoint_follower
 {
 
-WaypointFollower::WaypointFollower()
-: nav2_util::LifecycleNode("WaypointFollower", "", false)
+WaypointFollower::WaypointFollower(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("WaypointFollower", "", false, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   declare_parameter("stop_on_failure", true);
   declare_parameter("loop_rate", 20);
+  declare_parameter("blend_radius", 0.0);
+  declare_parameter("route_optimizer_starts", 16);
+  declare_parameter("route_optimizer_threads", 0);
 }
 
 WaypointFollower::~WaypointFollower()
@@ -45,6 +52,7 @@ WaypointFollower::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   stop_on_failure_ = get_parameter("stop_on_failure").as_bool();
   loop_rate_ = get_parameter("loop_rate").as_int();
+  blend_radius_ = get_parameter("blend_radius").as_double();
 
   std::vector<std::string> new_args = rclcpp::NodeOptions().arguments();
   new_args.push_back("--ros-args");
@@ -64,6 +72,25 @@ WaypointFollower::on_configure(const rclcpp_lifecycle::State & /*state*/)
     get_node_waitables_interface(),
     "FollowWaypoints", std::bind(&WaypointFollower::followWaypoints, this));
 
+  route_optimizer_ = std::make_unique<RouteOptimizer>(
+    get_parameter("route_optimizer_starts").as_int(),
+    get_parameter("route_optimizer_threads").as_int());
+
+  std::vector<std::string> route_args = {
+    "--ros-args", "-r", std::string("__node:=") + this->get_name() + "_route_client", "--"};
+  route_client_node_ = std::make_shared<rclcpp::Node>(
+    "_", "", rclcpp::NodeOptions().arguments(route_args));
+  paths_client_ = rclcpp_action::create_client<PathsActionT>(
+    route_client_node_, "compute_paths_to_poses");
+  follow_client_ = rclcpp_action::create_client<ActionT>(route_client_node_, "FollowWaypoints");
+
+  optimized_action_server_ = std::make_unique<OptimizedActionServer>(
+    get_node_base_interface(),
+    get_node_clock_interface(),
+    get_node_logging_interface(),
+    get_node_waitables_interface(),
+    "FollowOptimizedWaypoints", std::bind(&WaypointFollower::followOptimizedWaypoints, this));
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -73,6 +100,7 @@ WaypointFollower::on_activate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Activating");
 
   action_server_->activate();
+  optimized_action_server_->activate();
 
   // create bond connection
   createBond();
@@ -86,6 +114,7 @@ WaypointFollower::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   action_server_->deactivate();
+  optimized_action_server_->deactivate();
 
   // destroy bond connection
   destroyBond();
@@ -100,6 +129,11 @@ WaypointFollower::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   action_server_.reset();
   nav_to_pose_client_.reset();
+  optimized_action_server_.reset();
+  paths_client_.reset();
+  follow_client_.reset();
+  route_client_node_.reset();
+  route_optimizer_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -157,14 +191,31 @@ WaypointFollower::followWaypoints()
       ClientT::Goal client_goal;
       client_goal.pose = goal->poses[goal_index];
 
+      // A goal sent while the previous one is still running preempts it, so the robot carries
+      // on to the next waypoint without stopping
+      const uint32_t sequence = ++goal_sequence_;
       auto send_goal_options = rclcpp_action::Client<ClientT>::SendGoalOptions();
       send_goal_options.result_callback =
-        std::bind(&WaypointFollower::resultCallback, this, std::placeholders::_1);
+        std::bind(&WaypointFollower::resultCallback, this, std::placeholders::_1, sequence);
       send_goal_options.goal_response_callback =
-        std::bind(&WaypointFollower::goalResponseCallback, this, std::placeholders::_1);
+        std::bind(&WaypointFollower::goalResponseCallback, this, std::placeholders::_1, sequence);
+      send_goal_options.feedback_callback = std::bind(
+        &WaypointFollower::feedbackCallback, this, std::placeholders::_2,
+        client_goal.pose, sequence);
       future_goal_handle_ =
         nav_to_pose_client_->async_send_goal(client_goal, send_goal_options);
       current_goal_status_ = ActionStatus::PROCESSING;
+      waypoint_distance_ = std::numeric_limits<double>::max();
+    }
+
+    // Pass through every waypoint but the last once the robot is close enough to it
+    if (current_goal_status_ == ActionStatus::PROCESSING && blend_radius_ > 0.0 &&
+      goal_index + 1 < goal->poses.size() && waypoint_distance_ <= blend_radius_)
+    {
+      RCLCPP_INFO(
+        get_logger(), "Within %.2f m of waypoint %i, blending into the next.",
+        blend_radius_, goal_index);
+      current_goal_status_ = ActionStatus::SUCCEEDED;
     }
 
     feedback->current_waypoint = goal_index;
@@ -220,10 +271,201 @@ WaypointFollower::followWaypoints()
   }
 }
 
+void
+WaypointFollower::followOptimizedWaypoints()
+{
+  auto goal = optimized_action_server_->get_current_goal();
+  auto feedback = std::make_shared<OptimizedActionT::Feedback>();
+  auto result = std::make_shared<OptimizedActionT::Result>();
+
+  if (!optimized_action_server_ || !optimized_action_server_->is_server_active()) {
+    RCLCPP_DEBUG(get_logger(), "Action server inactive. Stopping.");
+    return;
+  }
+
+  while (rclcpp::ok()) {
+    RCLCPP_INFO(
+      get_logger(), "Received request to visit %zu waypoints in the best order.",
+      goal->poses.size());
+
+    RouteOptimizer::CostMatrix costs;
+    if (!computeRouteCosts(goal, costs)) {
+      if (optimized_action_server_->is_preempt_requested()) {
+        goal = optimized_action_server_->accept_pending_goal();
+        continue;
+      }
+      optimized_action_server_->terminate_all();
+      return;
+    }
+
+    // Location 0 is the robot, drop it to get the order of the waypoints
+    const auto route = route_optimizer_->solve(costs);
+    result->order.clear();
+    ActionT::Goal follow_goal;
+    for (std::size_t i = 1; i < route.size(); ++i) {
+      result->order.push_back(static_cast<int>(route[i] - 1));
+      follow_goal.poses.push_back(goal->poses[route[i] - 1]);
+    }
+    RCLCPP_INFO(
+      get_logger(), "Visiting order found, route length is %.2f m.",
+      RouteOptimizer::routeCost(costs, route));
+
+    if (!follow_client_->wait_for_action_server(std::chrono::seconds(1))) {
+      RCLCPP_ERROR(get_logger(), "FollowWaypoints action server is not available.");
+      optimized_action_server_->terminate_current(result);
+      return;
+    }
+
+    auto order = result->order;
+    auto send_goal_options = rclcpp_action::Client<ActionT>::SendGoalOptions();
+    send_goal_options.feedback_callback =
+      [this, feedback, order](
+      rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr,
+      const std::shared_ptr<const ActionT::Feedback> follow_feedback) {
+        if (follow_feedback->current_waypoint < order.size()) {
+          feedback->current_waypoint = order[follow_feedback->current_waypoint];
+          optimized_action_server_->publish_feedback(feedback);
+        }
+      };
+    auto goal_handle_future = follow_client_->async_send_goal(follow_goal, send_goal_options);
+    if (rclcpp::spin_until_future_complete(route_client_node_, goal_handle_future) !=
+      rclcpp::FutureReturnCode::SUCCESS || !goal_handle_future.get())
+    {
+      RCLCPP_ERROR(get_logger(), "FollowWaypoints goal was rejected.");
+      optimized_action_server_->terminate_current(result);
+      return;
+    }
+    auto goal_handle = goal_handle_future.get();
+    auto result_future = follow_client_->async_get_result(goal_handle);
+
+    rclcpp::Rate r(loop_rate_);
+    bool preempted = false;
+    while (rclcpp::ok() &&
+      result_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      if (optimized_action_server_->is_cancel_requested() ||
+        optimized_action_server_->is_preempt_requested())
+      {
+        auto cancel_future = follow_client_->async_cancel_goal(goal_handle);
+        rclcpp::spin_until_future_complete(route_client_node_, cancel_future);
+        preempted = optimized_action_server_->is_preempt_requested();
+        break;
+      }
+      rclcpp::spin_some(route_client_node_);
+      r.sleep();
+    }
+
+    if (preempted) {
+      goal = optimized_action_server_->accept_pending_goal();
+      continue;
+    }
+    if (!rclcpp::ok() || optimized_action_server_->is_cancel_requested()) {
+      optimized_action_server_->terminate_all();
+      return;
+    }
+
+    // Report the missed waypoints by their index in the request
+    const auto follow_result = result_future.get();
+    result->missed_waypoints.clear();
+    if (follow_result.result) {
+      for (int missed : follow_result.result->missed_waypoints) {
+        if (missed >= 0 && static_cast<std::size_t>(missed) < order.size()) {
+          result->missed_waypoints.push_back(order[missed]);
+        }
+      }
+    }
+
+    if (follow_result.code == rclcpp_action::ResultCode::SUCCEEDED) {
+      optimized_action_server_->succeeded_current(result);
+    } else {
+      optimized_action_server_->terminate_current(result);
+    }
+    return;
+  }
+}
+
+bool
+WaypointFollower::computeRouteCosts(
+  const std::shared_ptr<const OptimizedActionT::Goal> & goal,
+  RouteOptimizer::CostMatrix & costs)
+{
+  // Unreachable legs get a cost far above any real one, so they are left for last
+  const double unreachable = 1e9;
+  const std::size_t n = goal->poses.size() + 1;
+  costs.assign(n, std::vector<double>(n, unreachable));
+
+  if (!paths_client_->wait_for_action_server(std::chrono::seconds(1))) {
+    RCLCPP_ERROR(get_logger(), "compute_paths_to_poses action server is not available.");
+    return false;
+  }
+
+  // One request per start location, each plans to every waypoint at once
+  for (std::size_t from = 0; from < n; ++from) {
+    if (optimized_action_server_->is_cancel_requested() ||
+      optimized_action_server_->is_preempt_requested())
+    {
+      return false;
+    }
+
+    costs[from][0] = 0.0;
+    costs[from][from] = 0.0;
+
+    PathsActionT::Goal paths_goal;
+    paths_goal.poses = goal->poses;
+    paths_goal.planner_id = goal->planner_id;
+    paths_goal.use_start = from > 0;
+    if (paths_goal.use_start) {
+      paths_goal.start = goal->poses[from - 1];
+    }
+
+    auto goal_handle_future = paths_client_->async_send_goal(paths_goal);
+    if (rclcpp::spin_until_future_complete(route_client_node_, goal_handle_future) !=
+      rclcpp::FutureReturnCode::SUCCESS || !goal_handle_future.get())
+    {
+      RCLCPP_ERROR(get_logger(), "compute_paths_to_poses goal was rejected.");
+      return false;
+    }
+    auto result_future = paths_client_->async_get_result(goal_handle_future.get());
+    if (rclcpp::spin_until_future_complete(route_client_node_, result_future) !=
+      rclcpp::FutureReturnCode::SUCCESS)
+    {
+      return false;
+    }
+
+    // An aborted request means none of the waypoints are reachable from here
+    auto paths_result = result_future.get();
+    if (paths_result.code != rclcpp_action::ResultCode::SUCCEEDED) {
+      RCLCPP_WARN(get_logger(), "No waypoint can be reached from location %zu.", from);
+      continue;
+    }
+
+    const auto & paths = paths_result.result->paths;
+    for (std::size_t to = 1; to < n && to - 1 < paths.size(); ++to) {
+      const auto & poses = paths[to - 1].poses;
+      if (to == from || poses.empty()) {
+        continue;
+      }
+      double length = 0.0;
+      for (std::size_t i = 1; i < poses.size(); ++i) {
+        length += std::hypot(
+          poses[i].pose.position.x - poses[i - 1].pose.position.x,
+          poses[i].pose.position.y - poses[i - 1].pose.position.y);
+      }
+      costs[from][to] = length;
+    }
+  }
+  return true;
+}
+
 void
 WaypointFollower::resultCallback(
-  const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result)
+  const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result,
+  uint32_t sequence)
 {
+  if (sequence != goal_sequence_) {
+    return;
+  }
+
   switch (result.code) {
     case rclcpp_action::ResultCode::SUCCEEDED:
       current_goal_status_ = ActionStatus::SUCCEEDED;
@@ -242,10 +484,11 @@ WaypointFollower::resultCallback(
 
 void
 WaypointFollower::goalResponseCallback(
-  std::shared_future<rclcpp_action::ClientGoalHandle<ClientT>::SharedPtr> future)
+  std::shared_future<rclcpp_action::ClientGoalHandle<ClientT>::SharedPtr> future,
+  uint32_t sequence)
 {
   auto goal_handle = future.get();
-  if (!goal_handle) {
+  if (!goal_handle && sequence == goal_sequence_) {
     RCLCPP_ERROR(
       get_logger(),
       "navigate_to_pose action client failed to send goal to server.");
@@ -253,4 +496,23 @@ WaypointFollower::goalResponseCallback(
   }
 }
 
+void
+WaypointFollower::feedbackCallback(
+  const std::shared_ptr<const ClientT::Feedback> feedback,
+  const geometry_msgs::msg::PoseStamped & waypoint,
+  uint32_t sequence)
+{
+  if (sequence != goal_sequence_) {
+    return;
+  }
+
+  waypoint_distance_ = std::hypot(
+    feedback->current_pose.pose.position.x - waypoint.pose.position.x,
+    feedback->current_pose.pose.position.y - waypoint.pose.position.y);
+}
+
 }  // namespace nav2_waypoint_follower
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_waypoint_follower::WaypointFollower)
@@ -0,0 +1,130 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "nav2_waypoint_follower/route_optimizer.hpp"
+#include "gtest/gtest.h"
+
+using nav2_waypoint_follower::RouteOptimizer;
+
+RouteOptimizer::CostMatrix distances(const std::vector<std::pair<double, double>> & points)
+{
+  RouteOptimizer::CostMatrix costs(points.size(), std::vector<double>(points.size()));
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    for (std::size_t j = 0; j < points.size(); ++j) {
+      costs[i][j] = std::hypot(
+        points[i].first - points[j].first, points[i].second - points[j].second);
+    }
+  }
+  return costs;
+}
+
+bool isPermutation(const std::vector<std::size_t> & route, std::size_t n)
+{
+  std::vector<std::size_t> sorted = route;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::size_t> expected(n);
+  std::iota(expected.begin(), expected.end(), 0);
+  return sorted == expected;
+}
+
+TEST(RouteOptimizer, TrivialRoutes)
+{
+  RouteOptimizer optimizer(4, 2);
+  EXPECT_TRUE(optimizer.solve(RouteOptimizer::CostMatrix()).empty());
+  EXPECT_EQ(optimizer.solve(distances({{0.0, 0.0}})), std::vector<std::size_t>({0}));
+  EXPECT_EQ(
+    optimizer.solve(distances({{0.0, 0.0}, {1.0, 0.0}})), std::vector<std::size_t>({0, 1}));
+}
+
+TEST(RouteOptimizer, OrdersPointsAlongALine)
+{
+  // Shuffled points on a line, starting from one end
+  std::vector<std::pair<double, double>> points{{0.0, 0.0}};
+  std::vector<int> positions(20);
+  std::iota(positions.begin(), positions.end(), 1);
+  std::shuffle(positions.begin(), positions.end(), std::mt19937(42));
+  for (int x : positions) {
+    points.emplace_back(static_cast<double>(x), 0.0);
+  }
+
+  RouteOptimizer optimizer(4, 2);
+  auto costs = distances(points);
+  auto route = optimizer.solve(costs);
+  ASSERT_TRUE(isPermutation(route, points.size()));
+  EXPECT_EQ(route.front(), 0u);
+  EXPECT_DOUBLE_EQ(RouteOptimizer::routeCost(costs, route), 20.0);
+}
+
+TEST(RouteOptimizer, ImprovesOnNearestNeighbour)
+{
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> coordinate(0.0, 50.0);
+  std::vector<std::pair<double, double>> points;
+  for (int i = 0; i < 60; ++i) {
+    points.emplace_back(coordinate(random), coordinate(random));
+  }
+  auto costs = distances(points);
+
+  // Greedy route to compare with
+  std::vector<std::size_t> greedy{0};
+  std::vector<bool> visited(points.size(), false);
+  visited[0] = true;
+  while (greedy.size() < points.size()) {
+    std::size_t best = 0;
+    double best_cost = 1e12;
+    for (std::size_t j = 0; j < points.size(); ++j) {
+      if (!visited[j] && costs[greedy.back()][j] < best_cost) {
+        best = j;
+        best_cost = costs[greedy.back()][j];
+      }
+    }
+    visited[best] = true;
+    greedy.push_back(best);
+  }
+
+  RouteOptimizer optimizer(8, 4);
+  auto route = optimizer.solve(costs);
+  ASSERT_TRUE(isPermutation(route, points.size()));
+  EXPECT_EQ(route.front(), 0u);
+  EXPECT_LT(
+    RouteOptimizer::routeCost(costs, route), RouteOptimizer::routeCost(costs, greedy));
+
+  // The same problem gives the same route whatever the thread timing
+  RouteOptimizer single_thread(8, 1);
+  EXPECT_EQ(single_thread.solve(costs), route);
+}
+
+TEST(RouteOptimizer, AsymmetricCosts)
+{
+  // Going "up" the indices is cheap and coming back expensive
+  const std::size_t n = 8;
+  RouteOptimizer::CostMatrix costs(n, std::vector<double>(n));
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      costs[i][j] = j > i ? static_cast<double>(j - i) : 10.0 * static_cast<double>(i - j + 1);
+    }
+  }
+
+  RouteOptimizer optimizer(4, 2);
+  auto route = optimizer.solve(costs);
+  std::vector<std::size_t> expected(n);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(route, expected);
+}